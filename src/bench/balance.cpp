@@ -0,0 +1,54 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "entities/account.h"
+
+static const uint64_t BALANCE_AMOUNT = 1000000 * COIN;
+static const uint64_t STAKE_AMOUNT   = 100 * COIN;
+static const uint64_t STAKE_FEES     = 1000000;
+
+// an account holding the tokens of a stake and cdp user, the ops of the bench on its WICC
+static CAccount MakeBalanceAccount() {
+    CAccount account;
+    for (const auto &symbol : {SYMB::WICC, SYMB::WGRT, SYMB::WUSD, SYMB::WBTC, SYMB::WETH})
+        account.OperateBalance(symbol, ADD_FREE, BALANCE_AMOUNT);
+    return account;
+}
+
+// the fees and the stake of a coin stake tx, then the unstake to keep the balance
+static void BalanceOpsSeparate(benchmark::State &state) {
+    CAccount account = MakeBalanceAccount();
+    state.SetItemsPerIteration(4);
+    while (state.KeepRunning()) {
+        account.OperateBalance(SYMB::WICC, SUB_FREE, STAKE_FEES);
+        account.OperateBalance(SYMB::WICC, STAKE, STAKE_AMOUNT);
+        account.OperateBalance(SYMB::WICC, UNSTAKE, STAKE_AMOUNT);
+        account.OperateBalance(SYMB::WICC, ADD_FREE, STAKE_FEES);
+    }
+}
+
+static void BalanceOpsBatched(benchmark::State &state) {
+    CAccount account = MakeBalanceAccount();
+    size_t failedIndex = 0;
+    state.SetItemsPerIteration(4);
+    while (state.KeepRunning()) {
+        account.OperateBalances(SYMB::WICC, {{SUB_FREE, STAKE_FEES}, {STAKE, STAKE_AMOUNT},
+                                             {UNSTAKE, STAKE_AMOUNT}, {ADD_FREE, STAKE_FEES}}, failedIndex);
+    }
+}
+
+// the names of the ops in the tx logs and the vm logs
+static void BalanceOpTypeName(benchmark::State &state) {
+    state.SetItemsPerIteration(UNVOTE);
+    while (state.KeepRunning()) {
+        for (uint8_t opType = ADD_FREE; opType <= UNVOTE; opType++)
+            string name = GetBalanceOpTypeName((BalanceOpType)opType);
+    }
+}
+
+BENCHMARK(BalanceOpsSeparate);
+BENCHMARK(BalanceOpsBatched);
+BENCHMARK(BalanceOpTypeName);
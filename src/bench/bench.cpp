@@ -0,0 +1,153 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <new>
+
+static std::atomic<uint64_t> allocCount{0};
+static std::atomic<uint64_t> allocBytes{0};
+
+// the replaceable allocation functions, counting the allocations of the whole bench_coin
+static void *CountedAlloc(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size) { return CountedAlloc(size); }
+void *operator new[](size_t size) { return CountedAlloc(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+namespace benchmark {
+
+    uint64_t GetAllocCount() { return allocCount.load(std::memory_order_relaxed); }
+    uint64_t GetAllocBytes() { return allocBytes.load(std::memory_order_relaxed); }
+
+    double GetTimeSeconds() {
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+        return tv.tv_sec + tv.tv_usec * 0.000001;
+    }
+
+    BenchRunner::BenchmarkMap &BenchRunner::Benchmarks() {
+        static BenchmarkMap benchmarks;
+        return benchmarks;
+    }
+
+    BenchRunner::BenchRunner(const std::string &name, BenchFunction func) {
+        Benchmarks().emplace(name, func);
+    }
+
+    void BenchRunner::RunAll(const std::string &filter, double maxElapsed) {
+        std::cout << "#Benchmark" << "," << "count" << "," << "min(s)" << "," << "max(s)" << "," << "average(s)"
+                  << "," << "items/s" << "," << "allocs/iter" << "," << "bytes/iter" << "\n";
+
+        for (const auto &item : Benchmarks()) {
+            if (!filter.empty() && item.first.find(filter) == std::string::npos)
+                continue;
+
+            State state(item.first, maxElapsed);
+            item.second(state);
+        }
+    }
+
+    void BenchRunner::ListAll() {
+        for (const auto &item : Benchmarks())
+            std::cout << item.first << "\n";
+    }
+
+    State::State(const std::string &nameIn, double maxElapsedIn)
+        : name(nameIn), maxElapsed(maxElapsedIn), beginTime(0), lastTime(0), pausedTime(0), totalPausedTime(0),
+          pauseBegin(0), minTime(std::numeric_limits<double>::max()), maxTime(0), allocBegin(0), allocBytesBegin(0),
+          pausedAllocs(0), pausedAllocBytes(0), pauseAllocBegin(0), pauseAllocBytesBegin(0), count(0), countMask(0),
+          itemsPerIteration(0) {}
+
+    void State::PauseTiming() {
+        pauseBegin           = GetTimeSeconds();
+        pauseAllocBegin      = GetAllocCount();
+        pauseAllocBytesBegin = GetAllocBytes();
+    }
+
+    void State::ResumeTiming() {
+        double paused = GetTimeSeconds() - pauseBegin;
+        pausedTime += paused;
+        totalPausedTime += paused;
+        pausedAllocs += GetAllocCount() - pauseAllocBegin;
+        pausedAllocBytes += GetAllocBytes() - pauseAllocBytesBegin;
+    }
+
+    bool State::KeepRunning() {
+        if (count & countMask) {
+            ++count;
+            return true;
+        }
+
+        double now;
+        if (count == 0) {
+            lastTime = beginTime = now = GetTimeSeconds();
+            totalPausedTime  = 0;
+            allocBegin       = GetAllocCount();
+            allocBytesBegin  = GetAllocBytes();
+            pausedAllocs     = 0;
+            pausedAllocBytes = 0;
+        } else {
+            now = GetTimeSeconds();
+            double elapsed    = now - lastTime - pausedTime;
+            double elapsedOne = elapsed / (countMask + 1);
+            if (elapsedOne < minTime) minTime = elapsedOne;
+            if (elapsedOne > maxTime) maxTime = elapsedOne;
+
+            if (elapsed * 128 < maxElapsed) {
+                // the batch is much too short to be timed accurately, make it 8x longer and restart the timing,
+                // so that the overhead of this code is not measured
+                countMask = ((countMask << 3) | 7) & ((1ULL << 60) - 1);
+                count     = 0;
+                minTime   = std::numeric_limits<double>::max();
+                maxTime   = 0;
+                pausedTime = 0;
+                return true;
+            }
+            if (elapsed * 16 < maxElapsed) {
+                uint64_t newCountMask = ((countMask << 1) | 1) & ((1ULL << 60) - 1);
+                if ((count & newCountMask) == 0)
+                    countMask = newCountMask;
+            }
+        }
+        lastTime   = now;
+        pausedTime = 0;
+        ++count;
+
+        // the paused time counts for the budget, or a benchmark with a costly setup would never end
+        if (now - beginTime < maxElapsed)
+            return true;
+
+        --count;
+
+        double average = (now - beginTime - totalPausedTime) / count;
+        std::cout << std::fixed << std::setprecision(9) << name << "," << count << "," << minTime << ","
+                  << maxTime << "," << average << ",";
+        if (itemsPerIteration > 0 && average > 0)
+            std::cout << std::setprecision(0) << itemsPerIteration / average;
+        double allocs = (double)(GetAllocCount() - allocBegin - pausedAllocs) / count;
+        double bytes  = (double)(GetAllocBytes() - allocBytesBegin - pausedAllocBytes) / count;
+        std::cout << "," << std::setprecision(1) << allocs << "," << std::setprecision(0) << bytes;
+        std::cout << "\n";
+
+        return false;
+    }
+}
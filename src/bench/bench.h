@@ -0,0 +1,104 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+/**
+ * Minimal microbenchmark framework of bench_coin.
+ *
+ * A benchmark is a function taking a benchmark::State, which runs the measured code while
+ * state.KeepRunning() is true:
+ *
+ *   static void CodeToTime(benchmark::State &state) {
+ *       ...do any setup needed...
+ *       while (state.KeepRunning()) {
+ *           ...do the work to be timed...
+ *       }
+ *       ...do any cleanup needed...
+ *   }
+ *
+ *   BENCHMARK(CodeToTime);
+ *
+ * The iterations are timed in batches which grow until the batch takes long enough for the clock,
+ * the benchmark stops after its time budget and reports the min, max and average time per iteration.
+ * state.PauseTiming()/ResumeTiming() exclude the per-iteration setup which must not be measured.
+ * The heap allocations of the timed code are counted too, by the operator new of bench_coin, and
+ * reported per iteration.
+ */
+namespace benchmark {
+
+    class State {
+    public:
+        State(const std::string &nameIn, double maxElapsedIn);
+
+        bool KeepRunning();
+
+        // exclude the code between them from the timing of the current iteration
+        void PauseTiming();
+        void ResumeTiming();
+
+        // the count of items processed by each iteration, reported as items per second
+        void SetItemsPerIteration(uint64_t items) { itemsPerIteration = items; }
+
+    private:
+        std::string name;
+        double maxElapsed;
+        double beginTime;
+        double lastTime;
+        double pausedTime;       // of the current batch
+        double totalPausedTime;
+        double pauseBegin;
+        double minTime;
+        double maxTime;
+        uint64_t allocBegin;     // the counters at the begin of the timing
+        uint64_t allocBytesBegin;
+        uint64_t pausedAllocs;
+        uint64_t pausedAllocBytes;
+        uint64_t pauseAllocBegin;
+        uint64_t pauseAllocBytesBegin;
+        uint64_t count;
+        uint64_t countMask;
+        uint64_t itemsPerIteration;
+    };
+
+    typedef std::function<void(State &)> BenchFunction;
+
+    class BenchRunner {
+    public:
+        BenchRunner(const std::string &name, BenchFunction func);
+
+        // run the benchmarks whose name contains the filter, each for about maxElapsed seconds
+        static void RunAll(const std::string &filter, double maxElapsed = 1);
+        static void ListAll();
+
+    private:
+        typedef std::map<std::string, BenchFunction> BenchmarkMap;
+        static BenchmarkMap &Benchmarks();
+    };
+
+    // wall time in seconds
+    double GetTimeSeconds();
+
+    // the count and the requested bytes of the heap allocations by operator new since the start
+    uint64_t GetAllocCount();
+    uint64_t GetAllocBytes();
+
+    // the mixed workload of bench_coin -throughput, its report is one json object on stdout
+    bool RunThroughput();
+}
+
+// BENCHMARK(foo) expands to:  benchmark::BenchRunner bench_11foo("foo", foo);
+#define BENCHMARK(n) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n);
+
+#endif  // BENCH_BENCH_H
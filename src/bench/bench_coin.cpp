@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench_env.h"
+
+#include "commons/util/util.h"
+#include "config/chainparams.h"
+#include "entities/key.h"
+#include "main.h"
+#include "persistence/cachewrapper.h"
+
+#include <boost/filesystem.hpp>
+
+/**
+ * Microbenchmarks of the hot paths of block connection, run on regtest params against fresh dbs in
+ * a temporary data dir:
+ *
+ *   bench_coin [-filter=<name part>] [-maxtime=<seconds per benchmark>] [-list] [-datadir=<dir>]
+ *
+ * With -throughput it runs a mixed workload instead, reproducible for its seed, and prints one json object
+ * of the tps, the block fill, the percentiles of the block execution time and the peak rss:
+ *
+ *   bench_coin -throughput [-accounts=<n>] [-blocks=<n>] [-blocktxs=<n>] [-flushblocks=<n>] [-seed=<n>]
+ *              [-mix=transfer:80,wicctransfer:10,settle:10]
+ *
+ * Each block runs its txs in tx layers over a block layer, as ConnectBlock does without the signatures,
+ * then flushes the block layer into the dbs, which are written every -flushblocks blocks.
+ *
+ * The per tx type timings of a replay of real blocks come from the node itself, see -benchmark with
+ * -reindex or -loadblock.
+ */
+int main(int argc, char *argv[]) {
+    SetupEnvironment();
+    CBaseParams::ParseParameters(argc, argv);
+
+    if (CBaseParams::GetBoolArg("-list", false)) {
+        benchmark::BenchRunner::ListAll();
+        return 0;
+    }
+
+    bool fTempDataDir = !CBaseParams::IsArgCount("-datadir");
+    boost::filesystem::path dataDir;
+    if (fTempDataDir) {
+        dataDir = GetTempPath() / boost::filesystem::unique_path("coin_bench_%%%%-%%%%-%%%%");
+        boost::filesystem::create_directories(dataDir);
+        CBaseParams::SoftSetArg("-datadir", dataDir.string());
+    }
+    CBaseParams::SoftSetArg("-nettype", "regtest");
+    SysCfg().InitializeConfig();
+
+    ECC_Start();
+    {
+        LOCK(cs_main);
+        pCdMan = new CCacheDBManager(false, false);
+    }
+
+    bool fSuccess = true;
+    if (CBaseParams::GetBoolArg("-throughput", false))
+        fSuccess = benchmark::RunThroughput();
+    else
+        benchmark::BenchRunner::RunAll(CBaseParams::GetArg("-filter", ""),
+                                       CBaseParams::GetArg("-maxtime", 1));
+
+    {
+        LOCK(cs_main);
+        delete pCdMan;
+        pCdMan = nullptr;
+    }
+    ECC_Stop();
+
+    if (fTempDataDir)
+        boost::filesystem::remove_all(dataDir);
+
+    return fSuccess ? 0 : 1;
+}
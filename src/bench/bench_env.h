@@ -0,0 +1,33 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BENCH_BENCH_ENV_H
+#define BENCH_BENCH_ENV_H
+
+#include "crypto/hash.h"
+#include "entities/account.h"
+#include "entities/id.h"
+
+/**
+ * The benchmarks run against the global pCdMan, opened by bench_coin on fresh dbs. They work on
+ * CCacheWrapper layers over it and only flush into pCdMan the state they read back later.
+ */
+namespace benchmark {
+
+    // the first regid height of the bench accounts, far from the regids of the regtest genesis
+    static const uint32_t BENCH_ACCOUNT_HEIGHT = 1000000;
+
+    // a registered account with a keyid derived from the regid, not yet saved
+    inline CAccount MakeBenchAccount(const CRegID &regid) {
+        CAccount account(CKeyID(Hash160(regid.GetRegIdRaw())));
+        account.regid = regid;
+        return account;
+    }
+
+    inline CRegID MakeBenchRegId(uint32_t index) {
+        return CRegID(BENCH_ACCOUNT_HEIGHT + index / 65536, index % 65536);
+    }
+}
+
+#endif  // BENCH_BENCH_ENV_H
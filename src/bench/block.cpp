@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench_env.h"
+
+#include "commons/serialize.h"
+#include "config/version.h"
+#include "persistence/block.h"
+#include "tx/blockrewardtx.h"
+#include "tx/cointransfertx.h"
+
+static const uint32_t BLOCK_TX_COUNT = 1000;
+
+static CBlock MakeBlock() {
+    CBlock block;
+    block.SetHeight(benchmark::BENCH_ACCOUNT_HEIGHT);
+    block.vptx.push_back(std::make_shared<CBlockRewardTx>(benchmark::MakeBenchRegId(0).GetRegIdRaw(), 0,
+                                                          benchmark::BENCH_ACCOUNT_HEIGHT));
+    for (uint32_t i = 1; i <= BLOCK_TX_COUNT; i++) {
+        auto pTx = std::make_shared<CCoinTransferTx>(benchmark::MakeBenchRegId(i), benchmark::MakeBenchRegId(i + 1),
+                                                     benchmark::BENCH_ACCOUNT_HEIGHT, SYMB::WICC, COIN + i,
+                                                     SYMB::WICC, 10000, "");
+        pTx->signature.assign(72, (uint8_t)i);
+        block.vptx.push_back(pTx);
+    }
+    block.SetMerkleRootHash(block.BuildMerkleTree());
+    return block;
+}
+
+static void BlockSerialize(benchmark::State &state) {
+    CBlock block = MakeBlock();
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream.reserve(::GetSerializeSize(block, SER_DISK, CLIENT_VERSION));
+
+    state.SetItemsPerIteration(block.vptx.size());
+    while (state.KeepRunning()) {
+        stream.clear();
+        stream << block;
+    }
+}
+
+static void BlockDeserialize(benchmark::State &state) {
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << MakeBlock();
+    string data = stream.str();
+
+    state.SetItemsPerIteration(BLOCK_TX_COUNT + 1);
+    while (state.KeepRunning()) {
+        CDataStream blockStream(data.data(), data.data() + data.size(), SER_DISK, CLIENT_VERSION);
+        CBlock block;
+        blockStream >> block;
+    }
+}
+
+// the tx hashes and the merkle tree the block validation computes for a block read from disk
+static void BlockMerkleRoot(benchmark::State &state) {
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << MakeBlock();
+    string data = stream.str();
+
+    state.SetItemsPerIteration(BLOCK_TX_COUNT + 1);
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        CDataStream blockStream(data.data(), data.data() + data.size(), SER_DISK, CLIENT_VERSION);
+        CBlock block;
+        blockStream >> block;
+        state.ResumeTiming();
+
+        block.BuildMerkleTree();
+    }
+}
+
+BENCHMARK(BlockSerialize);
+BENCHMARK(BlockDeserialize);
+BENCHMARK(BlockMerkleRoot);
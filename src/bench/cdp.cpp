@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench_env.h"
+
+#include "main.h"
+#include "persistence/cachewrapper.h"
+
+static const uint32_t CDP_COUNT              = 10000;
+static const uint64_t CDP_BCOIN_PRICE        = PRICE_BOOST / 10;
+static const uint64_t CDP_LIQUIDATE_RATIO    = 10400;  // 104%, the default CDP_FORCE_LIQUIDATE_RATIO
+static const uint64_t CDP_OWED_SCOINS        = 1000 * COIN;
+static const int32_t  CDP_HEIGHT             = benchmark::BENCH_ACCOUNT_HEIGHT;
+
+// the cdps with staked/owed from 5 to 50, about an eighth of them under the liquidate ratio at the price
+static void NewCdps(CCdpDBCache &cdpCache) {
+    for (uint32_t i = 0; i < CDP_COUNT; i++) {
+        uint64_t stakedBcoins = CDP_OWED_SCOINS * 5 + CDP_OWED_SCOINS * 45 / CDP_COUNT * i;
+        CUserCDP cdp(benchmark::MakeBenchRegId(i), Hash(BEGIN(i), END(i)), CDP_HEIGHT, SYMB::WICC, SYMB::WUSD,
+                     stakedBcoins, CDP_OWED_SCOINS);
+        cdpCache.NewCDP(CDP_HEIGHT, cdp);
+    }
+}
+
+/**
+ * The scan of the cdps to liquidate of CCdpForcedLiquidater, which runs in the tx layer of the block
+ * price median tx over the block layer. The liquidation itself is file local to the tx and not benched.
+ */
+static void CdpForceLiquidateScan(benchmark::State &state) {
+    LOCK(cs_main);
+    CCacheWrapper blockCw(pCdMan);
+    NewCdps(blockCw.cdpCache);
+    CCacheWrapper txCw(&blockCw);
+
+    CCdpCoinPair cdpCoinPair(SYMB::WICC, SYMB::WUSD);
+    uint64_t count = 0;
+    while (state.KeepRunning()) {
+        auto spCdpIt = txCw.cdpCache.CreateCdpRatioIterator(cdpCoinPair, CDP_LIQUIDATE_RATIO, CDP_BCOIN_PRICE);
+        count        = 0;
+        for (spCdpIt->First(); spCdpIt->IsValid(); spCdpIt->Next()) {
+            CUserCDP cdp = spCdpIt->GetValue();
+            if (++count >= FORCE_SETTLE_CDP_MAX_COUNT_PER_BLOCK)
+                break;
+        }
+        state.SetItemsPerIteration(count);
+    }
+}
+
+// the same cdps copied out at once, as the testnet compat path does
+static void CdpListByCollateralRatio(benchmark::State &state) {
+    LOCK(cs_main);
+    CCacheWrapper blockCw(pCdMan);
+    NewCdps(blockCw.cdpCache);
+    CCacheWrapper txCw(&blockCw);
+
+    CCdpCoinPair cdpCoinPair(SYMB::WICC, SYMB::WUSD);
+    while (state.KeepRunning()) {
+        CdpRatioSortedCache::Map cdpMap;
+        txCw.cdpCache.GetCdpListByCollateralRatio(cdpCoinPair, CDP_LIQUIDATE_RATIO, CDP_BCOIN_PRICE, cdpMap);
+        state.SetItemsPerIteration(cdpMap.size());
+    }
+}
+
+BENCHMARK(CdpForceLiquidateScan);
+BENCHMARK(CdpListByCollateralRatio);
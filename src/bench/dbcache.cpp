@@ -0,0 +1,246 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench_env.h"
+
+#include "main.h"
+#include "persistence/cachewrapper.h"
+#include "persistence/dbiterator.h"
+
+#include <memory>
+
+static const uint32_t CACHE_ACCOUNT_COUNT       = 10000;
+static const uint32_t FLUSH_ACCOUNT_COUNT       = 1000;
+static const uint32_t FLUSH_LARGE_ACCOUNT_COUNT = 100000;
+static const uint32_t VOTE_CANDIDATE_COUNT      = 1000;
+static const uint32_t OPLOG_ACCOUNT_COUNT       = 10;  // the accounts written by a tx with its undo log
+
+typedef decltype(CAccountDBCache::accountCache) AccountCacheType;
+
+static vector<CAccount> MakeAccounts(uint32_t count, uint32_t firstIndex) {
+    vector<CAccount> accounts;
+    accounts.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        CAccount account = benchmark::MakeBenchAccount(benchmark::MakeBenchRegId(firstIndex + i));
+        account.OperateBalance(SYMB::WICC, ADD_FREE, COIN + i);
+        accounts.push_back(account);
+    }
+    return accounts;
+}
+
+// the leaf of a hierarchy of cache layers over pCdMan, of 1 level the top level cache itself, of 2 levels
+// a block layer over it, of 3 levels a tx layer over the block layer
+class CCacheLevels {
+public:
+    explicit CCacheLevels(uint32_t levels) {
+        for (uint32_t i = 1; i < levels; i++) {
+            if (layers.empty())
+                layers.emplace_back(new CCacheWrapper(pCdMan));
+            else
+                layers.emplace_back(new CCacheWrapper(layers.back().get()));
+        }
+    }
+
+    AccountCacheType &GetAccountCache() {
+        return layers.empty() ? pCdMan->pAccountCache->accountCache : layers.back()->accountCache.accountCache;
+    }
+
+private:
+    vector<std::unique_ptr<CCacheWrapper>> layers;
+};
+
+// reads of the leaf which miss the layers above the top level cache and hit it, as the txs of a block do
+static void CompositeKVCacheGet(benchmark::State &state, uint32_t levels) {
+    LOCK(cs_main);
+    vector<CAccount> accounts = MakeAccounts(CACHE_ACCOUNT_COUNT, 0);
+    for (const auto &account : accounts)
+        pCdMan->pAccountCache->accountCache.SetData(account.keyid, account);
+
+    {
+        CCacheLevels cacheLevels(levels);
+        CAccount account;
+        uint32_t i = 0;
+        while (state.KeepRunning()) {
+            cacheLevels.GetAccountCache().GetData(accounts[i++ % accounts.size()].keyid, account);
+        }
+    }
+    pCdMan->pAccountCache->accountCache.Clear();
+}
+
+static void CompositeKVCacheSet(benchmark::State &state, uint32_t levels) {
+    LOCK(cs_main);
+    vector<CAccount> accounts = MakeAccounts(CACHE_ACCOUNT_COUNT, 0);
+
+    {
+        CCacheLevels cacheLevels(levels);
+        uint32_t i = 0;
+        while (state.KeepRunning()) {
+            const CAccount &account = accounts[i++ % accounts.size()];
+            cacheLevels.GetAccountCache().SetData(account.keyid, account);
+        }
+    }
+    pCdMan->pAccountCache->accountCache.Clear();
+}
+
+// erasures in the leaf of the keys of the top level cache, which leave erased entries in the leaf
+static void CompositeKVCacheErase(benchmark::State &state, uint32_t levels) {
+    LOCK(cs_main);
+    vector<CAccount> accounts = MakeAccounts(CACHE_ACCOUNT_COUNT, 0);
+    for (const auto &account : accounts)
+        pCdMan->pAccountCache->accountCache.SetData(account.keyid, account);
+
+    {
+        CCacheLevels cacheLevels(levels);
+        uint32_t i = 0;
+        while (state.KeepRunning()) {
+            cacheLevels.GetAccountCache().EraseData(accounts[i++ % accounts.size()].keyid);
+        }
+    }
+    pCdMan->pAccountCache->accountCache.Clear();
+}
+
+static void CompositeKVCacheGet1Level(benchmark::State &state) { CompositeKVCacheGet(state, 1); }
+static void CompositeKVCacheGet2Levels(benchmark::State &state) { CompositeKVCacheGet(state, 2); }
+static void CompositeKVCacheGet3Levels(benchmark::State &state) { CompositeKVCacheGet(state, 3); }
+static void CompositeKVCacheSet1Level(benchmark::State &state) { CompositeKVCacheSet(state, 1); }
+static void CompositeKVCacheSet2Levels(benchmark::State &state) { CompositeKVCacheSet(state, 2); }
+static void CompositeKVCacheSet3Levels(benchmark::State &state) { CompositeKVCacheSet(state, 3); }
+static void CompositeKVCacheErase1Level(benchmark::State &state) { CompositeKVCacheErase(state, 1); }
+static void CompositeKVCacheErase2Levels(benchmark::State &state) { CompositeKVCacheErase(state, 2); }
+static void CompositeKVCacheErase3Levels(benchmark::State &state) { CompositeKVCacheErase(state, 3); }
+
+// reads of the leveldb under the top level cache
+static void DBAccessGet(benchmark::State &state) {
+    LOCK(cs_main);
+    vector<CAccount> accounts = MakeAccounts(CACHE_ACCOUNT_COUNT, 0);
+    for (const auto &account : accounts)
+        pCdMan->pAccountCache->accountCache.SetData(account.keyid, account);
+    pCdMan->pAccountCache->accountCache.Flush();
+
+    CAccount account;
+    uint32_t i = 0;
+    while (state.KeepRunning()) {
+        pCdMan->pAccountDb->GetData(dbk::KEYID_ACCOUNT, accounts[i++ % accounts.size()].keyid, account);
+    }
+}
+
+// flush of a tx layer into the block layer
+static void FlushTxLayer(benchmark::State &state, uint32_t accountCount) {
+    LOCK(cs_main);
+    vector<CAccount> accounts = MakeAccounts(accountCount, 0);
+
+    CCacheWrapper blockCw(pCdMan);
+    state.SetItemsPerIteration(accountCount);
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        CCacheWrapper txCw(&blockCw);
+        for (const auto &account : accounts)
+            txCw.accountCache.accountCache.SetData(account.keyid, account);
+        state.ResumeTiming();
+
+        txCw.accountCache.accountCache.Flush();
+    }
+}
+
+static void CompositeKVCacheFlush(benchmark::State &state) { FlushTxLayer(state, FLUSH_ACCOUNT_COUNT); }
+static void CompositeKVCacheFlushLarge(benchmark::State &state) {
+    FlushTxLayer(state, FLUSH_LARGE_ACCOUNT_COUNT);
+}
+
+// flush of the top level cache into the leveldb
+static void CompositeKVCacheFlushToDb(benchmark::State &state) {
+    LOCK(cs_main);
+    vector<CAccount> accounts = MakeAccounts(FLUSH_ACCOUNT_COUNT, CACHE_ACCOUNT_COUNT);
+
+    state.SetItemsPerIteration(FLUSH_ACCOUNT_COUNT);
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (auto &account : accounts) {
+            account.OperateBalance(SYMB::WICC, ADD_FREE, 1);
+            pCdMan->pAccountCache->accountCache.SetData(account.keyid, account);
+        }
+        state.ResumeTiming();
+
+        pCdMan->pAccountCache->accountCache.Flush();
+    }
+}
+
+// the writes of a tx which log the old values for its undo
+static void CompositeKVCacheSetOpLog(benchmark::State &state) {
+    LOCK(cs_main);
+    vector<CAccount> accounts = MakeAccounts(OPLOG_ACCOUNT_COUNT, 0);
+    for (const auto &account : accounts)
+        pCdMan->pAccountCache->accountCache.SetData(account.keyid, account);
+
+    {
+        CCacheWrapper blockCw(pCdMan);
+        state.SetItemsPerIteration(OPLOG_ACCOUNT_COUNT);
+        while (state.KeepRunning()) {
+            state.PauseTiming();
+            CCacheWrapper txCw(&blockCw);
+            CDBOpLogMap dbOpLogMap;
+            txCw.SetDbOpLogMap(&dbOpLogMap);
+            state.ResumeTiming();
+
+            for (const auto &account : accounts)
+                txCw.accountCache.accountCache.SetData(account.keyid, account);
+        }
+    }
+    pCdMan->pAccountCache->accountCache.Clear();
+}
+
+// the votes of the candidates in a block layer, with some of them changed again in a tx layer
+static void SetCandidateVotes(CCacheWrapper &blockCw, CCacheWrapper &txCw) {
+    for (uint32_t i = 0; i < VOTE_CANDIDATE_COUNT; i++)
+        blockCw.delegateCache.SetDelegateVotes(benchmark::MakeBenchRegId(i), (i + 1) * COIN);
+    for (uint32_t i = 0; i < VOTE_CANDIDATE_COUNT; i += 100)
+        txCw.delegateCache.SetDelegateVotes(benchmark::MakeBenchRegId(i), (VOTE_CANDIDATE_COUNT + i) * COIN);
+}
+
+// the top n of the vote index merged over the layers, as each block does
+static void DelegateGetTopVotes(benchmark::State &state) {
+    LOCK(cs_main);
+    CCacheWrapper blockCw(pCdMan);
+    CCacheWrapper txCw(&blockCw);
+    SetCandidateVotes(blockCw, txCw);
+
+    VoteDelegateVector delegates;
+    while (state.KeepRunning()) {
+        delegates.clear();
+        txCw.delegateCache.GetTopVoteDelegates(delegates);
+    }
+}
+
+// a full scan of the vote index merged over the layers and the db
+static void DBIteratorScan(benchmark::State &state) {
+    LOCK(cs_main);
+    CCacheWrapper blockCw(pCdMan);
+    CCacheWrapper txCw(&blockCw);
+    SetCandidateVotes(blockCw, txCw);
+
+    state.SetItemsPerIteration(VOTE_CANDIDATE_COUNT);
+    while (state.KeepRunning()) {
+        CDBIterator<DBVoteRegIdCache> dbIt(txCw.delegateCache.voteRegIdCache);
+        for (dbIt.First(); dbIt.IsValid(); dbIt.Next()) {
+        }
+    }
+}
+
+BENCHMARK(CompositeKVCacheGet1Level);
+BENCHMARK(CompositeKVCacheGet2Levels);
+BENCHMARK(CompositeKVCacheGet3Levels);
+BENCHMARK(DBAccessGet);
+BENCHMARK(CompositeKVCacheSet1Level);
+BENCHMARK(CompositeKVCacheSet2Levels);
+BENCHMARK(CompositeKVCacheSet3Levels);
+BENCHMARK(CompositeKVCacheErase1Level);
+BENCHMARK(CompositeKVCacheErase2Levels);
+BENCHMARK(CompositeKVCacheErase3Levels);
+BENCHMARK(CompositeKVCacheFlush);
+BENCHMARK(CompositeKVCacheFlushLarge);
+BENCHMARK(CompositeKVCacheFlushToDb);
+BENCHMARK(CompositeKVCacheSetOpLog);
+BENCHMARK(DelegateGetTopVotes);
+BENCHMARK(DBIteratorScan);
@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench_env.h"
+
+#include "config/chainparams.h"
+#include "main.h"
+#include "persistence/cachewrapper.h"
+#include "tx/dextx.h"
+
+using namespace dex;
+
+static const uint32_t SETTLE_DEAL_COUNT  = 100;
+static const uint32_t SETTLE_USER_COUNT  = 20;   // the half of them buy, the other half sell
+static const uint64_t SETTLE_DEAL_PRICE  = PRICE_BOOST / 10;
+static const uint64_t SETTLE_DEAL_ASSETS = 100 * COIN;
+static const int32_t  SETTLE_HEIGHT      = benchmark::BENCH_ACCOUNT_HEIGHT;
+
+static uint256 MakeOrderId(uint64_t n) {
+    return Hash(BEGIN(n), END(n));
+}
+
+// the users with enough frozen coins and assets for all the deals, and the account of the match service
+static void SaveSettleAccounts(CCacheWrapper &cw) {
+    CAccount settlerAccount = benchmark::MakeBenchAccount(SysCfg().GetDexMatchSvcRegId());
+    settlerAccount.OperateBalance(SYMB::WICC, ADD_FREE, 1000 * COIN);
+    cw.accountCache.SaveAccount(settlerAccount);
+
+    uint64_t dealCoins = CDEXOrderBaseTx::CalcCoinAmount(SETTLE_DEAL_ASSETS, SETTLE_DEAL_PRICE);
+    for (uint32_t i = 0; i < SETTLE_USER_COUNT; i++) {
+        CAccount account = benchmark::MakeBenchAccount(benchmark::MakeBenchRegId(i));
+        if (i % 2 == 0) {
+            account.OperateBalance(SYMB::WUSD, ADD_FREE, dealCoins * SETTLE_DEAL_COUNT);
+            account.OperateBalance(SYMB::WUSD, FREEZE, dealCoins * SETTLE_DEAL_COUNT);
+        } else {
+            account.OperateBalance(SYMB::WICC, ADD_FREE, SETTLE_DEAL_ASSETS * SETTLE_DEAL_COUNT);
+            account.OperateBalance(SYMB::WICC, FREEZE, SETTLE_DEAL_ASSETS * SETTLE_DEAL_COUNT);
+        }
+        cw.accountCache.SaveAccount(account);
+    }
+}
+
+static CDEXOrderDetail MakeOrder(OrderSide side, uint32_t userIndex, uint32_t txIndex) {
+    CDEXOrderDetail order;
+    order.generate_type = USER_GEN_ORDER;
+    order.order_type    = ORDER_LIMIT_PRICE;
+    order.order_side    = side;
+    order.coin_symbol   = SYMB::WUSD;
+    order.asset_symbol  = SYMB::WICC;
+    order.asset_amount  = SETTLE_DEAL_ASSETS;
+    order.coin_amount   = CDEXOrderBaseTx::CalcCoinAmount(SETTLE_DEAL_ASSETS, SETTLE_DEAL_PRICE);
+    order.price         = SETTLE_DEAL_PRICE;
+    order.tx_cord       = CTxCord(SETTLE_HEIGHT - 1, txIndex);
+    order.user_regid    = benchmark::MakeBenchRegId(userIndex);
+    return order;
+}
+
+// a settle tx of the deals fulfilling pairs of new orders, the orders are created in the cache
+static CDEXSettleTx MakeSettleTx(CCacheWrapper &cw, uint64_t &orderSeq) {
+    vector<CDEXSettleTx::DealItem> dealItems;
+    for (uint32_t i = 0; i < SETTLE_DEAL_COUNT; i++) {
+        uint32_t userIndex = (i * 2) % SETTLE_USER_COUNT;
+        uint256 buyOrderId  = MakeOrderId(orderSeq++);
+        uint256 sellOrderId = MakeOrderId(orderSeq++);
+        cw.dexCache.CreateActiveOrder(buyOrderId, MakeOrder(ORDER_BUY, userIndex, i * 2 + 1));
+        cw.dexCache.CreateActiveOrder(sellOrderId, MakeOrder(ORDER_SELL, userIndex + 1, i * 2 + 2));
+
+        dealItems.push_back({buyOrderId, sellOrderId, SETTLE_DEAL_PRICE,
+                             CDEXOrderBaseTx::CalcCoinAmount(SETTLE_DEAL_ASSETS, SETTLE_DEAL_PRICE),
+                             SETTLE_DEAL_ASSETS});
+    }
+    return CDEXSettleTx(SysCfg().GetDexMatchSvcRegId(), SETTLE_HEIGHT, SYMB::WICC, 10000, dealItems);
+}
+
+// execution of a settle tx in a tx layer over the block layer holding the accounts and orders
+static void DEXSettleTxExecute(benchmark::State &state) {
+    LOCK(cs_main);
+    CCacheWrapper blockCw(pCdMan);
+    SaveSettleAccounts(blockCw);
+
+    uint64_t orderSeq = 0;
+    state.SetItemsPerIteration(SETTLE_DEAL_COUNT);
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        CCacheWrapper ordersCw(&blockCw);
+        CDEXSettleTx tx = MakeSettleTx(ordersCw, orderSeq);
+        CCacheWrapper txCw(&ordersCw);
+        CValidationState validationState;
+        CTxExecuteContext context(SETTLE_HEIGHT, 1, 1, GetTime(), GetTime(), &txCw, &validationState);
+        state.ResumeTiming();
+
+        if (!tx.ExecuteTx(context)) {
+            fprintf(stderr, "DEXSettleTxExecute: execute the settle tx failed: %s\n",
+                    validationState.GetRejectReason().c_str());
+            return;
+        }
+    }
+}
+
+BENCHMARK(DEXSettleTxExecute);
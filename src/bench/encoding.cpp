@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/base58.h"
+#include "commons/uint256.h"
+#include "commons/util/util.h"
+#include "crypto/hash.h"
+
+static const uint32_t RAW_TX_SIZE     = 4000;
+static const uint32_t TXID_COUNT      = 1000;
+static const uint32_t ADDRESS_COUNT   = 1000;
+static const uint32_t ADDRESS_SIZE    = 25;  // the version, the key id and the checksum
+
+static uint256 MakeTxid(uint32_t n) {
+    return Hash(BEGIN(n), END(n));
+}
+
+// the bytes of a raw tx of a getblock or gettxdetail reply
+static vector<unsigned char> MakeRawTx() {
+    vector<unsigned char> raw;
+    for (uint32_t i = 0; raw.size() < RAW_TX_SIZE; i++) {
+        uint256 hash = MakeTxid(i);
+        raw.insert(raw.end(), hash.begin(), hash.end());
+    }
+    raw.resize(RAW_TX_SIZE);
+    return raw;
+}
+
+static vector<vector<unsigned char>> MakeAddresses() {
+    vector<vector<unsigned char>> addresses;
+    for (uint32_t i = 0; i < ADDRESS_COUNT; i++) {
+        uint256 hash = MakeTxid(i);
+        addresses.emplace_back(hash.begin(), hash.begin() + ADDRESS_SIZE);
+        addresses.back()[0] = 73;  // the version byte of the mainnet addresses
+    }
+    return addresses;
+}
+
+static void HexStrRawTx(benchmark::State &state) {
+    vector<unsigned char> raw = MakeRawTx();
+    state.SetItemsPerIteration(RAW_TX_SIZE);
+    while (state.KeepRunning()) {
+        string hex = HexStr(raw);
+    }
+}
+
+static void ParseHexRawTx(benchmark::State &state) {
+    string hex = HexStr(MakeRawTx());
+    state.SetItemsPerIteration(RAW_TX_SIZE);
+    while (state.KeepRunning()) {
+        vector<unsigned char> raw = ParseHex(hex);
+    }
+}
+
+// the txids of a getblock reply
+static void Uint256GetHex(benchmark::State &state) {
+    vector<uint256> txids;
+    for (uint32_t i = 0; i < TXID_COUNT; i++)
+        txids.push_back(MakeTxid(i));
+
+    state.SetItemsPerIteration(TXID_COUNT);
+    while (state.KeepRunning()) {
+        for (const auto &txid : txids) {
+            string hex = txid.GetHex();
+        }
+    }
+}
+
+static void EncodeBase58Address(benchmark::State &state) {
+    vector<vector<unsigned char>> addresses = MakeAddresses();
+    state.SetItemsPerIteration(ADDRESS_COUNT);
+    while (state.KeepRunning()) {
+        for (const auto &address : addresses) {
+            string str = EncodeBase58(address);
+        }
+    }
+}
+
+static void DecodeBase58Address(benchmark::State &state) {
+    vector<string> addresses;
+    for (const auto &address : MakeAddresses())
+        addresses.push_back(EncodeBase58(address));
+
+    vector<unsigned char> vch;
+    state.SetItemsPerIteration(ADDRESS_COUNT);
+    while (state.KeepRunning()) {
+        for (const auto &address : addresses) {
+            DecodeBase58(address, vch);
+        }
+    }
+}
+
+BENCHMARK(HexStrRawTx);
+BENCHMARK(ParseHexRawTx);
+BENCHMARK(Uint256GetHex);
+BENCHMARK(EncodeBase58Address);
+BENCHMARK(DecodeBase58Address);
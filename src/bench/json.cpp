@@ -0,0 +1,160 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/json/json_spirit_reader_template.h"
+#include "commons/json/json_spirit_utils.h"
+#include "commons/json/json_spirit_writer_template.h"
+#include "commons/json/jsonreader.h"
+#include "commons/json/jsonwriter.h"
+#include "commons/uint256.h"
+#include "commons/util/util.h"
+#include "crypto/hash.h"
+
+using namespace json_spirit;
+
+static const uint32_t JSON_ENTRY_COUNT   = 2000;
+static const uint32_t JSON_REQUEST_COUNT = 500;
+
+static uint256 MakeTxid(uint32_t n) {
+    return Hash(BEGIN(n), END(n));
+}
+
+// a verbose getrawmempool result, the entries are objects of numbers and strings
+static Object BuildMempoolValue() {
+    Object obj;
+    for (uint32_t i = 0; i < JSON_ENTRY_COUNT; i++) {
+        Object info;
+        info.push_back(Pair("size",         (int)(200 + i % 100)));
+        info.push_back(Pair("fees_type",    "WICC"));
+        info.push_back(Pair("fees",         (double)(10000 + i) / 100000000));
+        info.push_back(Pair("time",         (int64_t)1570000000 + i));
+        info.push_back(Pair("height",       (int)(5000000 + i / 10)));
+        info.push_back(Pair("priority",     (double)i * 1.5));
+
+        obj.push_back(Pair(MakeTxid(i).ToString(), info));
+    }
+    return obj;
+}
+
+static void WriteMempoolStream(CJsonWriter &writer) {
+    writer.BeginObject();
+    for (uint32_t i = 0; i < JSON_ENTRY_COUNT; i++) {
+        writer.Key(MakeTxid(i).ToString());
+        writer.BeginObject();
+        writer.Field("size",        (int32_t)(200 + i % 100));
+        writer.Field("fees_type",   "WICC");
+        writer.Field("fees",        (double)(10000 + i) / 100000000);
+        writer.Field("time",        (int64_t)1570000000 + i);
+        writer.Field("height",      (int32_t)(5000000 + i / 10));
+        writer.Field("priority",    (double)i * 1.5);
+        writer.EndObject();
+    }
+    writer.EndObject();
+}
+
+// the tree building and write_string of the replies until now
+static void JsonWriteSpirit(benchmark::State &state) {
+    state.SetItemsPerIteration(JSON_ENTRY_COUNT);
+    while (state.KeepRunning()) {
+        Object obj = BuildMempoolValue();
+        string json = write_string(Value(obj), false);
+    }
+}
+
+// the same tree written by the json writer, as the results of the RPCs without a streaming variant
+static void JsonWriteValue(benchmark::State &state) {
+    CJsonWriter writer;
+    state.SetItemsPerIteration(JSON_ENTRY_COUNT);
+    while (state.KeepRunning()) {
+        Object obj = BuildMempoolValue();
+        writer.Clear();
+        writer.WriteValue(obj);
+    }
+}
+
+// the streaming RPCs write the same text without a tree, into the reused buffer
+static void JsonWriteStream(benchmark::State &state) {
+    CJsonWriter writer;
+    WriteMempoolStream(writer);
+    Object obj = BuildMempoolValue();
+    if (writer.GetString() != write_string(Value(obj), false)) {
+        fprintf(stderr, "JsonWriteStream: the written json differs from write_string\n");
+        return;
+    }
+
+    state.SetItemsPerIteration(JSON_ENTRY_COUNT);
+    while (state.KeepRunning()) {
+        writer.Clear();
+        WriteMempoolStream(writer);
+    }
+}
+
+// a batch of getaccountinfo calls as the wallet backends send them
+static string BuildBatchRequest() {
+    Array batch;
+    for (uint32_t i = 0; i < JSON_REQUEST_COUNT; i++) {
+        Object request;
+        request.push_back(Pair("jsonrpc",   "2.0"));
+        request.push_back(Pair("id",        (int)i));
+        request.push_back(Pair("method",    "getaccountinfo"));
+        Array params;
+        params.push_back(strprintf("wLKf2NqwtHk3BfzK5wMDfbKYN1SC3weyR%d", i % 10));
+        request.push_back(Pair("params",    params));
+        batch.push_back(request);
+    }
+    return write_string(Value(batch), false);
+}
+
+static void JsonParseBatchRequest(benchmark::State &state) {
+    string body = BuildBatchRequest();
+
+    state.SetItemsPerIteration(JSON_REQUEST_COUNT);
+    while (state.KeepRunning()) {
+        Value value;
+        if (!read_string(body, value)) {
+            fprintf(stderr, "JsonParseBatchRequest: parse the request failed\n");
+            return;
+        }
+    }
+}
+
+// the envelopes walked by the pull parser as the RPC server does, the params are built only
+static void JsonReadBatchEnvelopes(benchmark::State &state) {
+    string body = BuildBatchRequest();
+    Value expected, value;
+    if (!read_string(body, expected) || !ReadJson(body, value) ||
+        write_string(value, false) != write_string(expected, false)) {
+        fprintf(stderr, "JsonReadBatchEnvelopes: the read json differs from read_string\n");
+        return;
+    }
+
+    state.SetItemsPerIteration(JSON_REQUEST_COUNT);
+    while (state.KeepRunning()) {
+        CJsonReader reader(body);
+        string name;
+        reader.BeginArray();
+        while (reader.NextItem()) {
+            Value id, method, params;
+            reader.BeginObject();
+            while (reader.NextMember(name)) {
+                if (name == "id")
+                    reader.ReadValue(id);
+                else if (name == "method")
+                    reader.ReadValue(method);
+                else if (name == "params")
+                    reader.ReadValue(params);
+                else
+                    reader.SkipValue();
+            }
+        }
+    }
+}
+
+BENCHMARK(JsonWriteSpirit);
+BENCHMARK(JsonWriteValue);
+BENCHMARK(JsonWriteStream);
+BENCHMARK(JsonParseBatchRequest);
+BENCHMARK(JsonReadBatchEnvelopes);
@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/messagequeue.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+static const size_t QUEUE_LEN            = 1024;
+static const size_t QUEUE_ITEMS          = 100000;  // moved through the queue by each iteration
+static const size_t QUEUE_THREADS        = 4;       // producers, and as many consumers
+static const size_t QUEUE_BATCH_SIZE     = 32;
+
+namespace {
+
+    // the mutex and condition variables queue MsgQueue was, to compare with
+    class CLockedQueue {
+    public:
+        explicit CLockedQueue(size_t maxLenIn) : maxLen(maxLenIn) {}
+
+        void Push(uint64_t item) {
+            std::unique_lock<std::mutex> lock(mtx);
+            pushCond.wait(lock, [&]() { return items.size() < maxLen; });
+            items.push(item);
+            popCond.notify_one();
+        }
+
+        bool Pop(uint64_t *item) {
+            std::unique_lock<std::mutex> lock(mtx);
+            if (!popCond.wait_for(lock, POP_DEFAULT_TIMEOUT, [&]() { return !items.empty(); }))
+                return false;
+            *item = items.front();
+            items.pop();
+            pushCond.notify_one();
+            return true;
+        }
+
+    private:
+        size_t maxLen;
+        std::queue<uint64_t> items;
+        std::mutex mtx;
+        std::condition_variable popCond;
+        std::condition_variable pushCond;
+    };
+
+    // QUEUE_ITEMS through the queue by QUEUE_THREADS producers and as many consumers
+    template <typename PushFunc, typename PopFunc>
+    void RunContention(PushFunc push, PopFunc pop) {
+        std::atomic<size_t> popped{0};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < QUEUE_THREADS; i++) {
+            threads.emplace_back([&, i]() {
+                for (size_t item = i; item < QUEUE_ITEMS; item += QUEUE_THREADS)
+                    push(item);
+            });
+            threads.emplace_back([&]() {
+                while (popped.load(std::memory_order_relaxed) < QUEUE_ITEMS)
+                    popped += pop();
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+}  // namespace
+
+static void MessageQueueLocked(benchmark::State &state) {
+    state.SetItemsPerIteration(QUEUE_ITEMS);
+    while (state.KeepRunning()) {
+        CLockedQueue queue(QUEUE_LEN);
+        RunContention([&](uint64_t item) { queue.Push(item); },
+                      [&]() {
+                          uint64_t item;
+                          return queue.Pop(&item) ? 1 : 0;
+                      });
+    }
+}
+
+static void MessageQueueRing(benchmark::State &state) {
+    state.SetItemsPerIteration(QUEUE_ITEMS);
+    while (state.KeepRunning()) {
+        MsgQueue<uint64_t> queue(QUEUE_LEN);
+        RunContention([&](uint64_t item) { queue.Push(item); },
+                      [&]() {
+                          uint64_t item;
+                          return queue.Pop(&item) ? 1 : 0;
+                      });
+    }
+}
+
+// the consumers take the items in batches, as the parse threads of a block import could
+static void MessageQueueRingBatch(benchmark::State &state) {
+    state.SetItemsPerIteration(QUEUE_ITEMS);
+    while (state.KeepRunning()) {
+        MsgQueue<uint64_t> queue(QUEUE_LEN);
+        RunContention([&](uint64_t item) { queue.Push(item); },
+                      [&]() {
+                          std::vector<uint64_t> items;
+                          return queue.PopBatch(items, QUEUE_BATCH_SIZE);
+                      });
+    }
+}
+
+BENCHMARK(MessageQueueLocked);
+BENCHMARK(MessageQueueRing);
+BENCHMARK(MessageQueueRingBatch);
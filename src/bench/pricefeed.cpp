@@ -0,0 +1,71 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench_env.h"
+
+#include "main.h"
+#include "persistence/cachewrapper.h"
+
+static const uint32_t FEED_DELEGATE_COUNT = 11;
+static const int32_t MEDIAN_BLOCK_HEIGHT  = benchmark::BENCH_ACCOUNT_HEIGHT;
+static const int32_t FEED_BLOCK_COUNT     = 11; // the default MEDIAN_PRICE_SLIDE_WINDOW_BLOCKCOUNT
+
+static vector<CPricePoint> MakePricePoints(uint32_t seed) {
+    return {
+        CPricePoint(CoinPricePair(SYMB::WICC, SYMB::USD), 10000000 + seed * 1000),
+        CPricePoint(CoinPricePair(SYMB::WGRT, SYMB::USD), 1000000 + seed * 100)
+    };
+}
+
+// the price points of all the delegates in the slide window, in the block layer of the block
+static void FeedPrices(CPricePointMemCache &ppCache) {
+    for (int32_t height = MEDIAN_BLOCK_HEIGHT - FEED_BLOCK_COUNT + 1; height <= MEDIAN_BLOCK_HEIGHT; height++) {
+        for (uint32_t i = 0; i < FEED_DELEGATE_COUNT; i++)
+            ppCache.AddPrice(height, benchmark::MakeBenchRegId(i), MakePricePoints(i * 7 + height % 13));
+    }
+}
+
+// the price feed txs of a block, one per delegate
+static void PricePointAdd(benchmark::State &state) {
+    LOCK(cs_main);
+    CCacheWrapper cw(pCdMan);
+
+    state.SetItemsPerIteration(FEED_DELEGATE_COUNT);
+    int32_t height = MEDIAN_BLOCK_HEIGHT;
+    while (state.KeepRunning()) {
+        ++height;
+        for (uint32_t i = 0; i < FEED_DELEGATE_COUNT; i++)
+            cw.ppCache.AddPrice(height, benchmark::MakeBenchRegId(i), MakePricePoints(i));
+    }
+}
+
+// the median prices of the block price median tx
+static void BlockMedianPrices(benchmark::State &state) {
+    LOCK(cs_main);
+    CCacheWrapper cw(pCdMan);
+    FeedPrices(cw.ppCache);
+
+    while (state.KeepRunning()) {
+        PriceMap medianPrices;
+        cw.ppCache.CalcBlockMedianPrices(cw, MEDIAN_BLOCK_HEIGHT, medianPrices);
+    }
+}
+
+// the same from a tx layer, the price points are looked up in the block layer
+static void BlockMedianPricesFromChild(benchmark::State &state) {
+    LOCK(cs_main);
+    CCacheWrapper blockCw(pCdMan);
+    FeedPrices(blockCw.ppCache);
+    CCacheWrapper txCw(&blockCw);
+
+    while (state.KeepRunning()) {
+        PriceMap medianPrices;
+        txCw.ppCache.CalcBlockMedianPrices(txCw, MEDIAN_BLOCK_HEIGHT, medianPrices);
+    }
+}
+
+BENCHMARK(PricePointAdd);
+BENCHMARK(BlockMedianPrices);
+BENCHMARK(BlockMedianPricesFromChild);
@@ -0,0 +1,251 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench_env.h"
+
+#include "commons/json/json_spirit_writer_template.h"
+#include "config/chainparams.h"
+#include "main.h"
+#include "persistence/cachewrapper.h"
+#include "tx/cointransfertx.h"
+#include "tx/dextx.h"
+
+#include <sys/resource.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+using namespace dex;
+using namespace json_spirit;
+
+static const uint64_t THROUGHPUT_FUNDS         = 1000000 * COIN;  // free and frozen of each symbol per account
+static const uint64_t THROUGHPUT_AMOUNT        = COIN;
+static const uint64_t THROUGHPUT_FEES          = COIN / 10;
+static const uint32_t THROUGHPUT_SETTLE_DEALS  = 20;
+static const uint64_t THROUGHPUT_DEAL_PRICE    = PRICE_BOOST / 10;
+static const uint64_t THROUGHPUT_DEAL_ASSETS   = 10 * COIN;
+
+namespace {
+
+    // a tx of the workload with the untimed setup it needs in the block layer
+    struct CWorkloadTx {
+        std::shared_ptr<CBaseTx> pTx;
+        bool fCheck;  // run CheckTx before ExecuteTx as ConnectBlock does, the settle only executes
+    };
+
+    class CThroughputRun {
+    public:
+        CThroughputRun(uint32_t accountsIn, uint64_t seed) : accounts(accountsIn), rng(seed), orderSeq(0) {}
+
+        uint32_t RandomAccount() { return rng() % accounts; }
+        uint32_t OtherAccount(uint32_t account) { return (account + 1 + rng() % (accounts - 1)) % accounts; }
+
+        CWorkloadTx MakeCoinTransfer(int32_t height) {
+            uint32_t from = RandomAccount(), to = OtherAccount(from);
+            return {std::make_shared<CCoinTransferTx>(benchmark::MakeBenchRegId(from), benchmark::MakeBenchRegId(to),
+                                                      height, SYMB::WICC, THROUGHPUT_AMOUNT, SYMB::WICC,
+                                                      THROUGHPUT_FEES, ""),
+                    true};
+        }
+
+        CWorkloadTx MakeBaseCoinTransfer(int32_t height) {
+            uint32_t from = RandomAccount(), to = OtherAccount(from);
+            return {std::make_shared<CBaseCoinTransferTx>(benchmark::MakeBenchRegId(from),
+                                                          benchmark::MakeBenchRegId(to), height, THROUGHPUT_AMOUNT,
+                                                          THROUGHPUT_FEES, ""),
+                    true};
+        }
+
+        // the orders of the deals are put in the block layer as if placed by the earlier blocks
+        CWorkloadTx MakeSettle(CCacheWrapper &blockCw, int32_t height) {
+            uint64_t dealCoins = CDEXOrderBaseTx::CalcCoinAmount(THROUGHPUT_DEAL_ASSETS, THROUGHPUT_DEAL_PRICE);
+            vector<CDEXSettleTx::DealItem> dealItems;
+            for (uint32_t i = 0; i < THROUGHPUT_SETTLE_DEALS; i++) {
+                uint256 buyOrderId  = MakeOrderId(orderSeq++);
+                uint256 sellOrderId = MakeOrderId(orderSeq++);
+                uint32_t buyer = RandomAccount(), seller = OtherAccount(buyer);
+                blockCw.dexCache.CreateActiveOrder(buyOrderId, MakeOrder(ORDER_BUY, buyer, height, i * 2 + 1));
+                blockCw.dexCache.CreateActiveOrder(sellOrderId, MakeOrder(ORDER_SELL, seller, height, i * 2 + 2));
+                dealItems.push_back({buyOrderId, sellOrderId, THROUGHPUT_DEAL_PRICE, dealCoins, THROUGHPUT_DEAL_ASSETS});
+            }
+            return {std::make_shared<CDEXSettleTx>(SysCfg().GetDexMatchSvcRegId(), height, SYMB::WICC, 10000,
+                                                   dealItems),
+                    false};
+        }
+
+        std::mt19937_64 &GetRng() { return rng; }
+
+    private:
+        static uint256 MakeOrderId(uint64_t n) { return Hash(BEGIN(n), END(n)); }
+
+        static CDEXOrderDetail MakeOrder(OrderSide side, uint32_t userIndex, int32_t height, uint32_t txIndex) {
+            CDEXOrderDetail order;
+            order.generate_type = USER_GEN_ORDER;
+            order.order_type    = ORDER_LIMIT_PRICE;
+            order.order_side    = side;
+            order.coin_symbol   = SYMB::WUSD;
+            order.asset_symbol  = SYMB::WICC;
+            order.asset_amount  = THROUGHPUT_DEAL_ASSETS;
+            order.coin_amount   = CDEXOrderBaseTx::CalcCoinAmount(THROUGHPUT_DEAL_ASSETS, THROUGHPUT_DEAL_PRICE);
+            order.price         = THROUGHPUT_DEAL_PRICE;
+            order.tx_cord       = CTxCord(height - 1, txIndex);
+            order.user_regid    = benchmark::MakeBenchRegId(userIndex);
+            return order;
+        }
+
+        uint32_t accounts;
+        std::mt19937_64 rng;
+        uint64_t orderSeq;
+    };
+
+    // the accounts with free and frozen coins for any number of transfers and deals, and the match service
+    void SaveThroughputAccounts(uint32_t accounts) {
+        CCacheWrapper cw(pCdMan);
+        CAccount settlerAccount = benchmark::MakeBenchAccount(SysCfg().GetDexMatchSvcRegId());
+        settlerAccount.OperateBalance(SYMB::WICC, ADD_FREE, THROUGHPUT_FUNDS);
+        cw.accountCache.SaveAccount(settlerAccount);
+
+        for (uint32_t i = 0; i < accounts; i++) {
+            CAccount account = benchmark::MakeBenchAccount(benchmark::MakeBenchRegId(i));
+            for (const auto &symbol : {SYMB::WICC, SYMB::WUSD}) {
+                account.OperateBalance(symbol, ADD_FREE, THROUGHPUT_FUNDS * 2);
+                account.OperateBalance(symbol, FREEZE, THROUGHPUT_FUNDS);
+            }
+            cw.accountCache.SaveAccount(account);
+        }
+        cw.Flush();
+        pCdMan->Flush();
+    }
+
+    // parse "name:weight,..." into the cumulative weights of the workloads
+    bool ParseMix(const string &mixStr, vector<pair<string, uint32_t>> &mix) {
+        uint32_t total = 0;
+        vector<string> items;
+        boost::split(items, mixStr, boost::is_any_of(","));
+        for (const auto &item : items) {
+            size_t pos = item.find(':');
+            string name = item.substr(0, pos);
+            uint32_t weight = pos == string::npos ? 1 : atoi(item.substr(pos + 1));
+            if (name != "transfer" && name != "wicctransfer" && name != "settle") {
+                fprintf(stderr, "unknown workload %s, expected transfer, wicctransfer or settle\n", name.c_str());
+                return false;
+            }
+            if (weight == 0)
+                continue;
+            total += weight;
+            mix.emplace_back(name, total);
+        }
+        return !mix.empty();
+    }
+
+    double Percentile(const vector<double> &sorted, double p) {
+        if (sorted.empty())
+            return 0;
+        return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+    }
+}
+
+namespace benchmark {
+
+    bool RunThroughput() {
+        uint32_t accounts      = std::max<int64_t>(2, CBaseParams::GetArg("-accounts", 10000));
+        uint32_t blocks        = std::max<int64_t>(1, CBaseParams::GetArg("-blocks", 100));
+        uint32_t blockTxs      = std::max<int64_t>(1, CBaseParams::GetArg("-blocktxs", 1000));
+        uint32_t flushInterval = std::max<int64_t>(1, CBaseParams::GetArg("-flushblocks", 10));
+        uint64_t seed          = CBaseParams::GetArg("-seed", 1);
+        string mixStr          = CBaseParams::GetArg("-mix", "transfer:80,wicctransfer:10,settle:10");
+
+        vector<pair<string, uint32_t>> mix;
+        if (!ParseMix(mixStr, mix))
+            return false;
+
+        LOCK(cs_main);
+        int64_t setupBegin = GetTimeMillis();
+        SaveThroughputAccounts(accounts);
+        int64_t setupTime = GetTimeMillis() - setupBegin;
+
+        CThroughputRun run(accounts, seed);
+        vector<double> latencies;
+        uint64_t txCount = 0, failedCount = 0, dealCount = 0, blockBytes = 0;
+        double totalTime = 0;
+        for (uint32_t b = 0; b < blocks; b++) {
+            int32_t height = BENCH_ACCOUNT_HEIGHT + b;
+            CCacheWrapper blockCw(pCdMan);
+
+            // the txs are generated and their prerequisites put in place before the timing
+            vector<CWorkloadTx> txs;
+            txs.reserve(blockTxs);
+            for (uint32_t i = 0; i < blockTxs; i++) {
+                uint32_t pick = run.GetRng()() % mix.back().second;
+                const string &name = std::find_if(mix.begin(), mix.end(), [&](const pair<string, uint32_t> &item) {
+                    return pick < item.second;
+                })->first;
+                if (name == "transfer") {
+                    txs.push_back(run.MakeCoinTransfer(height));
+                } else if (name == "wicctransfer") {
+                    txs.push_back(run.MakeBaseCoinTransfer(height));
+                } else {
+                    txs.push_back(run.MakeSettle(blockCw, height));
+                    dealCount += THROUGHPUT_SETTLE_DEALS;
+                }
+                blockBytes += txs.back().pTx->GetTxSize();
+            }
+
+            double beginTime = GetTimeSeconds();
+            for (uint32_t i = 0; i < txs.size(); i++) {
+                CCacheWrapper txCw(&blockCw);
+                CValidationState state;
+                CTxExecuteContext context(height, i + 1, 1, GetTime(), GetTime(), &txCw, &state);
+                context.skip_sig_check = true;
+                if ((txs[i].fCheck && !txs[i].pTx->CheckTx(context)) || !txs[i].pTx->ExecuteTx(context)) {
+                    if (failedCount++ == 0)
+                        fprintf(stderr, "%s tx failed: %s\n", txs[i].pTx->GetTxTypeName().c_str(),
+                                state.GetRejectReason().c_str());
+                    continue;
+                }
+                txCw.Flush();
+            }
+            blockCw.Flush();
+            if ((b + 1) % flushInterval == 0 || b + 1 == blocks)
+                pCdMan->Flush();
+
+            double elapsed = GetTimeSeconds() - beginTime;
+            latencies.push_back(elapsed);
+            totalTime += elapsed;
+            txCount += txs.size();
+        }
+        sort(latencies.begin(), latencies.end());
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        Object latencyObj;
+        latencyObj.push_back(Pair("p50", Percentile(latencies, 0.5) * 1000));
+        latencyObj.push_back(Pair("p90", Percentile(latencies, 0.9) * 1000));
+        latencyObj.push_back(Pair("p99", Percentile(latencies, 0.99) * 1000));
+        latencyObj.push_back(Pair("max", latencies.back() * 1000));
+
+        Object result;
+        result.push_back(Pair("accounts",           (int64_t)accounts));
+        result.push_back(Pair("blocks",             (int64_t)blocks));
+        result.push_back(Pair("block_txs",          (int64_t)blockTxs));
+        result.push_back(Pair("mix",                mixStr));
+        result.push_back(Pair("seed",               (int64_t)seed));
+        result.push_back(Pair("setup_ms",           setupTime));
+        result.push_back(Pair("txs",                (int64_t)txCount));
+        result.push_back(Pair("failed_txs",         (int64_t)failedCount));
+        result.push_back(Pair("deals",              (int64_t)dealCount));
+        result.push_back(Pair("elapsed_s",          totalTime));
+        result.push_back(Pair("tps",                totalTime > 0 ? txCount / totalTime : 0));
+        result.push_back(Pair("block_fill",         (double)blockBytes / blocks / MAX_BLOCK_SIZE));
+        result.push_back(Pair("block_latency_ms",   latencyObj));
+        result.push_back(Pair("peak_rss_kb",        (int64_t)usage.ru_maxrss));
+        std::cout << write_string(Value(result), false) << "\n";
+        return failedCount == 0;
+    }
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench_env.h"
+
+#include "main.h"
+#include "persistence/cachewrapper.h"
+#include "tx/cointransfertx.h"
+
+static const uint32_t TRANSFER_USER_COUNT = 1000;
+static const uint64_t TRANSFER_AMOUNT     = COIN;
+static const uint64_t TRANSFER_FEES       = COIN / 10;
+static const int32_t  TRANSFER_HEIGHT     = benchmark::BENCH_ACCOUNT_HEIGHT;
+
+// the registered users with coins for all the transfers
+static void SaveTransferAccounts(CCacheWrapper &cw) {
+    for (uint32_t i = 0; i < TRANSFER_USER_COUNT; i++) {
+        CAccount account = benchmark::MakeBenchAccount(benchmark::MakeBenchRegId(i));
+        account.OperateBalance(SYMB::WICC, ADD_FREE, 1000000 * COIN);
+        cw.accountCache.SaveAccount(account);
+    }
+}
+
+/**
+ * The check and execution of a tx transferring from each user to the next one, in a tx layer over the block
+ * layer holding the accounts as ConnectBlock runs them. The signatures are not verified.
+ */
+template <typename TxType>
+static void TransferTxExecute(benchmark::State &state, std::function<TxType(const CRegID &, const CRegID &)> makeTx) {
+    LOCK(cs_main);
+    CCacheWrapper blockCw(pCdMan);
+    SaveTransferAccounts(blockCw);
+
+    uint32_t userIndex = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        TxType tx = makeTx(benchmark::MakeBenchRegId(userIndex),
+                           benchmark::MakeBenchRegId((userIndex + 1) % TRANSFER_USER_COUNT));
+        userIndex = (userIndex + 1) % TRANSFER_USER_COUNT;
+        CCacheWrapper txCw(&blockCw);
+        CValidationState validationState;
+        CTxExecuteContext context(TRANSFER_HEIGHT, 1, 1, GetTime(), GetTime(), &txCw, &validationState);
+        context.skip_sig_check = true;
+        state.ResumeTiming();
+
+        if (!tx.CheckTx(context) || !tx.ExecuteTx(context)) {
+            fprintf(stderr, "TransferTxExecute: execute the transfer tx failed: %s\n",
+                    validationState.GetRejectReason().c_str());
+            return;
+        }
+    }
+}
+
+static void CoinTransferTxExecute(benchmark::State &state) {
+    TransferTxExecute<CCoinTransferTx>(state, [](const CRegID &from, const CRegID &to) {
+        return CCoinTransferTx(from, to, TRANSFER_HEIGHT, SYMB::WICC, TRANSFER_AMOUNT, SYMB::WICC, TRANSFER_FEES, "");
+    });
+}
+
+static void BaseCoinTransferTxExecute(benchmark::State &state) {
+    TransferTxExecute<CBaseCoinTransferTx>(state, [](const CRegID &from, const CRegID &to) {
+        return CBaseCoinTransferTx(from, to, TRANSFER_HEIGHT, TRANSFER_AMOUNT, TRANSFER_FEES, "");
+    });
+}
+
+BENCHMARK(CoinTransferTxExecute);
+BENCHMARK(BaseCoinTransferTxExecute);
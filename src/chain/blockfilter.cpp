@@ -0,0 +1,221 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "commons/util/util.h"
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// the bits of the golomb-rice code, most significant first within each byte
+class CBitWriter {
+public:
+    explicit CBitWriter(vector<uint8_t> &dataIn) : data(dataIn), bitCount(0) {}
+
+    void Write(uint64_t value, uint32_t nBits) {
+        while (nBits > 0) {
+            if (bitCount == 0)
+                data.push_back(0);
+            uint32_t n = min<uint32_t>(8 - bitCount, nBits);
+            uint8_t bits = (value >> (nBits - n)) & ((1U << n) - 1);
+            data.back() |= bits << (8 - bitCount - n);
+            bitCount = (bitCount + n) % 8;
+            nBits -= n;
+        }
+    }
+
+    void WriteGolombRice(uint64_t value) {
+        for (uint64_t q = value >> BLOCK_FILTER_P; q > 0; q--)
+            Write(1, 1);
+        Write(0, 1);
+        Write(value, BLOCK_FILTER_P);
+    }
+
+private:
+    vector<uint8_t> &data;
+    uint32_t bitCount;  // the bits used of the last byte
+};
+
+class CBitReader {
+public:
+    CBitReader(const vector<uint8_t> &dataIn, size_t posIn) : data(dataIn), pos(posIn), bitCount(0) {}
+
+    // false at the end of the data
+    bool Read(uint32_t nBits, uint64_t &value) {
+        value = 0;
+        while (nBits > 0) {
+            if (pos >= data.size())
+                return false;
+            uint32_t n = min<uint32_t>(8 - bitCount, nBits);
+            value = (value << n) | ((data[pos] >> (8 - bitCount - n)) & ((1U << n) - 1));
+            bitCount += n;
+            if (bitCount == 8) {
+                bitCount = 0;
+                pos++;
+            }
+            nBits -= n;
+        }
+        return true;
+    }
+
+    bool ReadGolombRice(uint64_t &value) {
+        uint64_t q = 0, bit;
+        while (true) {
+            if (!Read(1, bit))
+                return false;
+            if (bit == 0)
+                break;
+            q++;
+        }
+        uint64_t r;
+        if (!Read(BLOCK_FILTER_P, r))
+            return false;
+        value = (q << BLOCK_FILTER_P) + r;
+        return true;
+    }
+
+private:
+    const vector<uint8_t> &data;
+    size_t pos;
+    uint32_t bitCount;  // the bits read of the current byte
+};
+
+void WriteFilterSize(vector<uint8_t> &data, uint64_t size) {
+    uint32_t nBytes = 0;
+    if (size < 253) {
+        data.push_back(size);
+    } else if (size <= 0xffff) {
+        data.push_back(253);
+        nBytes = 2;
+    } else if (size <= 0xffffffff) {
+        data.push_back(254);
+        nBytes = 4;
+    } else {
+        data.push_back(255);
+        nBytes = 8;
+    }
+    for (uint32_t i = 0; i < nBytes; i++)
+        data.push_back((size >> (8 * i)) & 0xff);
+}
+
+// the size and the position after it, false if truncated
+bool ReadFilterSize(const vector<uint8_t> &data, uint64_t &size, size_t &pos) {
+    pos = 0;
+    if (data.empty())
+        return false;
+
+    uint8_t first = data[pos++];
+    uint32_t nBytes = first < 253 ? 0 : (first == 253 ? 2 : (first == 254 ? 4 : 8));
+    if (data.size() < pos + nBytes)
+        return false;
+
+    size = nBytes == 0 ? first : 0;
+    for (uint32_t i = 0; i < nBytes; i++)
+        size |= (uint64_t)data[pos++] << (8 * i);
+    return true;
+}
+
+}  // namespace
+
+CBlockFilter::CBlockFilter(const uint256 &blockHashIn, const vector<BlockFilterElement> &elements,
+                           const uint256 &prevHeader)
+    : blockHash(blockHashIn) {
+    // the set of the elements, each counted once
+    vector<BlockFilterElement> uniqueElements(elements);
+    sort(uniqueElements.begin(), uniqueElements.end());
+    uniqueElements.erase(unique(uniqueElements.begin(), uniqueElements.end()), uniqueElements.end());
+    elementCount = uniqueElements.size();
+
+    vector<uint64_t> hashes;
+    hashes.reserve(elementCount);
+    for (const auto &element : uniqueElements)
+        hashes.push_back(HashToRange(element));
+    sort(hashes.begin(), hashes.end());
+
+    WriteFilterSize(encoded, elementCount);
+    CBitWriter writer(encoded);
+    uint64_t last = 0;
+    for (uint64_t hash : hashes) {
+        writer.WriteGolombRice(hash - last);
+        last = hash;
+    }
+
+    uint256 filterHash = GetFilterHash();
+    header = Hash(filterHash.begin(), filterHash.end(), prevHeader.begin(), prevHeader.end());
+}
+
+uint256 CBlockFilter::GetFilterHash() const {
+    return Hash(encoded.begin(), encoded.end());
+}
+
+uint64_t CBlockFilter::HashToRange(const BlockFilterElement &element) const {
+    uint64_t hash = CSipHasher(blockHash.GetUint64(0), blockHash.GetUint64(1))
+                        .Write(element.data(), element.size())
+                        .Finalize();
+    // map the hash uniformly into [0, N * M) without a division
+    return (uint64_t)(((unsigned __int128)hash * (elementCount * BLOCK_FILTER_M)) >> 64);
+}
+
+void CBlockFilter::ReadElementCount() {
+    size_t pos;
+    if (!ReadFilterSize(encoded, elementCount, pos))
+        elementCount = 0;
+}
+
+bool CBlockFilter::Match(const BlockFilterElement &element) const {
+    return MatchAny({element});
+}
+
+bool CBlockFilter::MatchAny(const vector<BlockFilterElement> &elements) const {
+    if (elementCount == 0 || elements.empty())
+        return false;
+
+    vector<uint64_t> queries;
+    queries.reserve(elements.size());
+    for (const auto &element : elements)
+        queries.push_back(HashToRange(element));
+    sort(queries.begin(), queries.end());
+    return MatchSorted(queries);
+}
+
+bool CBlockFilter::MatchSorted(const vector<uint64_t> &queries) const {
+    uint64_t count;
+    size_t pos;
+    if (!ReadFilterSize(encoded, count, pos))
+        return false;
+
+    CBitReader reader(encoded, pos);
+    uint64_t value = 0;
+    auto it        = queries.begin();
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t delta;
+        if (!reader.ReadGolombRice(delta))
+            return false;
+        value += delta;
+
+        // both sides are sorted, walk them together
+        while (it != queries.end() && *it < value)
+            ++it;
+        if (it == queries.end())
+            return false;
+        if (*it == value)
+            return true;
+    }
+    return false;
+}
+
+BlockFilterElement CBlockFilter::GetElement(const uint160 &keyId) {
+    return BlockFilterElement(keyId.begin(), keyId.end());
+}
+
+string CBlockFilter::ToString() const {
+    return strprintf("block_hash=%s, elements=%llu, size=%u, header=%s", blockHash.GetHex(), elementCount,
+                     encoded.size(), header.GetHex());
+}
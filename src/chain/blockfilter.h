@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_BLOCK_FILTER_H
+#define CHAIN_BLOCK_FILTER_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// the only filter type, over the keyids and regids involved in the txs of a block
+static const uint8_t BLOCK_FILTER_BASIC = 0;
+// the golomb-rice parameter P and the inverse false positive rate M of BIP158
+static const uint8_t BLOCK_FILTER_P     = 19;
+static const uint32_t BLOCK_FILTER_M    = 784931;
+
+// max. number of filters served by one getcfilters and of filter hashes by one getcfheaders
+static const uint32_t MAX_GETCFILTERS_SIZE = 1000;
+static const uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+
+typedef std::vector<uint8_t> BlockFilterElement;
+
+/**
+ * A compact block filter in the way of BIP158: the elements of a block, here the raw keyids and regids
+ * involved in its txs, are hashed by SipHash keyed with the block hash into [0, N * M), sorted and their
+ * deltas golomb-rice coded with P bits of remainder. A light wallet tests its own ids against the filters
+ * and downloads only the blocks matching, with a false positive rate of 1/M per element. The header chains
+ * the hashes of the filters as in BIP157, so the filters served by different peers can be compared.
+ */
+class CBlockFilter {
+public:
+    CBlockFilter() : elementCount(0) {}
+    CBlockFilter(const uint256 &blockHashIn, const std::vector<BlockFilterElement> &elements,
+                 const uint256 &prevHeader);
+
+    const uint256 &GetBlockHash() const { return blockHash; }
+    const std::vector<uint8_t> &GetEncoded() const { return encoded; }
+    const uint256 &GetHeader() const { return header; }
+    uint64_t GetElementCount() const { return elementCount; }
+
+    uint256 GetFilterHash() const;
+    // whether the element may be in the block, false positives are possible
+    bool Match(const BlockFilterElement &element) const;
+    // whether any of the elements may be in the block, in one pass over the filter
+    bool MatchAny(const std::vector<BlockFilterElement> &elements) const;
+
+    // the elements of the raw keyid and of the raw regid
+    static BlockFilterElement GetElement(const uint160 &keyId);
+    static BlockFilterElement GetElement(const std::vector<uint8_t> &regIdRaw) { return regIdRaw; }
+
+    bool IsEmpty() const { return encoded.empty(); }
+    void SetEmpty() {
+        blockHash.SetNull();
+        encoded.clear();
+        header.SetNull();
+        elementCount = 0;
+    }
+    std::string ToString() const;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(encoded);
+        READWRITE(header);
+        if (fRead)
+            const_cast<CBlockFilter *>(this)->ReadElementCount();
+    )
+
+private:
+    uint64_t HashToRange(const BlockFilterElement &element) const;
+    void ReadElementCount();
+    bool MatchSorted(const std::vector<uint64_t> &queries) const;
+
+    uint256 blockHash;
+    std::vector<uint8_t> encoded;  // the element count and the golomb-rice coded set
+    uint256 header;                // hash of the filter hash and the header of the previous block
+    uint64_t elementCount;
+};
+
+#endif  // CHAIN_BLOCK_FILTER_H
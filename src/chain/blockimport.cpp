@@ -0,0 +1,254 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+
+#include "main.h"
+#include "logging.h"
+#include "config/configuration.h"
+#include "chain/blockreplay.h"
+#include "persistence/block.h"
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+// number of parsed blocks the workers may keep ahead of the connection
+static const uint64_t IMPORT_REORDER_WINDOW = 64;
+// number of raw blocks queued between the scanner and the workers
+static const size_t IMPORT_RAW_QUEUE_SIZE   = 64;
+// size of the chunks the raw block bytes are read in, must stay below the rewind size of the file buffer
+static const size_t IMPORT_READ_CHUNK_SIZE  = 64 * 1024;
+// interval of the progress log in microseconds
+static const int64_t IMPORT_LOG_INTERVAL    = 10 * 1000000;
+
+CBlockImportPipeline::CBlockImportPipeline(FILE *fileIn, CDiskBlockPos *dbpIn, uint32_t workersIn)
+    : file(fileIn),
+      dbp(dbpIn),
+      workers(max<uint32_t>(1, workersIn)),
+      rawQueue(IMPORT_RAW_QUEUE_SIZE),
+      fStop(false),
+      startTime(0),
+      lastLogTime(0),
+      scannedBytes(0),
+      parseMicros(0) {}
+
+uint32_t CBlockImportPipeline::GetWorkerCount() {
+    int64_t count = SysCfg().GetArg("-importthreads", 0);
+    if (count <= 0)
+        count = (int64_t)boost::thread::hardware_concurrency() - 1;
+    return (uint32_t)max<int64_t>(1, min<int64_t>(count, MAX_IMPORT_THREADS));
+}
+
+int32_t CBlockImportPipeline::Run() {
+    startTime   = GetTimeMicros();
+    lastLogTime = startTime;
+
+    boost::thread scanner(boost::bind(&CBlockImportPipeline::ScanFile, this));
+    boost::thread_group parsers;
+    for (uint32_t i = 0; i < workers; ++i)
+        parsers.create_thread(boost::bind(&CBlockImportPipeline::ParseBlocks, this));
+
+    int32_t nLoaded = 0;
+    try {
+        nLoaded = ConnectBlocks();
+    } catch (...) {
+        {
+            lock_guard<mutex> lock(parsedMutex);
+            fStop = true;
+        }
+        parsedCond.notify_all();
+        scanner.join();
+        parsers.join_all();
+        throw;
+    }
+
+    {
+        lock_guard<mutex> lock(parsedMutex);
+        fStop = true;
+    }
+    parsedCond.notify_all();
+    scanner.join();
+    parsers.join_all();
+
+    LogProgress(true);
+    return nLoaded;
+}
+
+void CBlockImportPipeline::ScanFile() {
+    RenameThread("coin-importscan");
+
+    uint64_t seq = 0;
+    try {
+        CBufferedFile blkdat(file, 2 * MAX_BLOCK_SIZE, MAX_BLOCK_SIZE + 8, SER_DISK, CLIENT_VERSION);
+        uint64_t nStartByte = 0;
+        if (dbp) {
+            // (try to) skip already indexed part
+            CBlockFileInfo info;
+            if (pCdMan->pBlockIndexDb->ReadBlockFileInfo(dbp->nFile, info)) {
+                nStartByte = info.nSize;
+                blkdat.Seek(info.nSize);
+            }
+        }
+        uint64_t nRewind = blkdat.GetPos();
+        while (!fStop && blkdat.good() && !blkdat.eof()) {
+            blkdat.SetPos(nRewind);
+            nRewind++;          // start one byte further next time, in case of failure
+            blkdat.SetLimit();  // remove former limit
+            uint32_t nSize = 0;
+            try {
+                // locate a header
+                uint8_t buf[MESSAGE_START_SIZE];
+                blkdat.FindByte(SysCfg().MessageStart()[0]);
+                nRewind = blkdat.GetPos() + 1;
+                blkdat >> FLATDATA(buf);
+                if (memcmp(buf, SysCfg().MessageStart(), MESSAGE_START_SIZE))
+                    continue;
+                // read size
+                blkdat >> nSize;
+                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
+                    continue;
+            } catch (std::exception &e) {
+                // no valid block header found; don't complain
+                break;
+            }
+            try {
+                // read the raw block, it is deserialized by the workers
+                CRawBlock raw;
+                raw.pos = blkdat.GetPos();
+                raw.data.resize(nSize);
+                for (size_t offset = 0; offset < nSize; offset += IMPORT_READ_CHUNK_SIZE)
+                    blkdat.read(&raw.data[offset], min<size_t>(IMPORT_READ_CHUNK_SIZE, nSize - offset));
+                nRewind = blkdat.GetPos();
+                scannedBytes += nSize;
+
+                if (raw.pos >= nStartByte) {
+                    raw.seq = seq++;
+                    rawQueue.Push(std::move(raw));
+                }
+            } catch (std::exception &e) {
+                LogPrint(BCLog::INFO, "%s : I/O error - %s\n", __func__, e.what());
+            }
+        }
+    } catch (std::exception &e) {
+        LogPrint(BCLog::ERROR, "%s : file scan failed - %s\n", __func__, e.what());
+    }
+
+    {
+        lock_guard<mutex> lock(parsedMutex);
+        scannedCount = seq;
+        fScanDone    = true;
+    }
+    parsedCond.notify_all();
+}
+
+void CBlockImportPipeline::ParseBlocks() {
+    RenameThread("coin-importparse");
+
+    CRawBlock raw;
+    while (true) {
+        if (!rawQueue.Pop(&raw)) {
+            // keep draining after a stop so the scanner never blocks on a full queue
+            lock_guard<mutex> lock(parsedMutex);
+            if (fScanDone && rawQueue.Empty())
+                break;
+            continue;
+        }
+
+        CParsedBlock parsed;
+        parsed.pos = raw.pos;
+        if (!fStop) {
+            int64_t beginTime = GetTimeMicros();
+            try {
+                CDataStream ss(raw.data.data(), raw.data.data() + raw.data.size(), SER_DISK, CLIENT_VERSION);
+                auto pBlock = std::make_shared<CBlock>();
+                ss >> *pBlock;
+
+                // verify the signatures whose pubkey is embedded in the tx, the result is kept in
+                // signatureCache and consumed by CheckBlock. Any failure is reported there again.
+                for (const auto &pBaseTx : pBlock->vptx) {
+                    if (pBaseTx->IsBlockRewardTx() || pBaseTx->IsPriceMedianTx() || !pBaseTx->txUid.is<CPubKey>() ||
+                        pBaseTx->signature.empty() || pBaseTx->signature.size() >= MAX_SIGNATURE_SIZE)
+                        continue;
+
+                    VerifySignature(pBaseTx->GetHash(), pBaseTx->signature, pBaseTx->txUid.get<CPubKey>());
+                }
+                parsed.pBlock = pBlock;
+            } catch (std::exception &e) {
+                LogPrint(BCLog::INFO, "%s : Deserialize error at pos %llu - %s\n", __func__, raw.pos, e.what());
+            }
+            parseMicros += GetTimeMicros() - beginTime;
+        }
+
+        unique_lock<mutex> lock(parsedMutex);
+        // bound the memory held by blocks waiting for their turn
+        parsedCond.wait(lock, [&]() { return fStop || raw.seq < nextSeq + IMPORT_REORDER_WINDOW; });
+        if (!fStop) {
+            parsedBlocks.emplace(raw.seq, std::move(parsed));
+            if (raw.seq == nextSeq)
+                parsedCond.notify_all();
+        }
+    }
+}
+
+int32_t CBlockImportPipeline::ConnectBlocks() {
+    int32_t nLoaded = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        CParsedBlock parsed;
+        {
+            unique_lock<mutex> lock(parsedMutex);
+            while (!parsedBlocks.count(nextSeq) && !(fScanDone && nextSeq >= scannedCount)) {
+                parsedCond.wait_for(lock, std::chrono::milliseconds(100));
+                boost::this_thread::interruption_point();
+            }
+
+            auto it = parsedBlocks.find(nextSeq);
+            if (it == parsedBlocks.end())
+                break;  // all the scanned blocks are connected
+
+            parsed = std::move(it->second);
+            parsedBlocks.erase(it);
+            ++nextSeq;
+        }
+        parsedCond.notify_all();
+
+        if (!parsed.pBlock)
+            continue;
+
+        int64_t beginTime = GetTimeMicros();
+        {
+            LOCK(cs_main);
+            if (dbp)
+                dbp->nPos = parsed.pos;
+            CValidationState state;
+            if (ProcessBlock(state, nullptr, parsed.pBlock.get(), dbp))
+                nLoaded++;
+            if (state.IsError())
+                break;
+            // the replay of -replayblocks stops at its last block
+            if (blockReplay.IsActive() && chainActive.Height() >= blockReplay.GetTo())
+                break;
+        }
+        connectMicros += GetTimeMicros() - beginTime;
+        ++connectedCount;
+
+        if (GetTimeMicros() - lastLogTime >= IMPORT_LOG_INTERVAL)
+            LogProgress(false);
+    }
+    return nLoaded;
+}
+
+void CBlockImportPipeline::LogProgress(bool fDone) {
+    int64_t now     = GetTimeMicros();
+    double seconds  = max<int64_t>(1, now - startTime) / 1000000.0;
+    double mebibyte = scannedBytes / (1024.0 * 1024.0);
+    lastLogTime     = now;
+
+    LogPrint(BCLog::INFO,
+             "%s : %s %llu blocks in %.1fs (%.1f blocks/s, %.2f MiB/s), parse=%.1fs on %u threads, connect=%.1fs\n",
+             __func__, fDone ? "imported" : "importing", connectedCount, seconds, connectedCount / seconds,
+             mebibyte / seconds, parseMicros / 1000000.0, workers, connectMicros / 1000000.0);
+}
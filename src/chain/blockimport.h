@@ -0,0 +1,82 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+
+#ifndef CHAIN_BLOCK_IMPORT_H
+#define CHAIN_BLOCK_IMPORT_H
+
+#include "commons/messagequeue.h"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class CBlock;
+struct CDiskBlockPos;
+
+/**
+ * Pipelined import of one block file for -reindex, bootstrap.dat and -loadblock.
+ *
+ * Stage 1, a scanner thread, locates the block frames in the file and queues their raw bytes.
+ * Stage 2, a pool of workers, deserializes the blocks and verifies the signatures of txs signed by
+ * an embedded public key, which leaves them in the signature cache for the connection.
+ * Stage 3, the calling thread, passes the blocks to ProcessBlock in file order.
+ * Both queues between the stages are bounded, so memory stays flat whatever the file size.
+ */
+class CBlockImportPipeline {
+public:
+    CBlockImportPipeline(FILE *fileIn, CDiskBlockPos *dbpIn, uint32_t workersIn);
+
+    // Import the whole file, return the number of blocks accepted
+    int32_t Run();
+
+    // Number of stage 2 workers configured by -importthreads
+    static uint32_t GetWorkerCount();
+
+private:
+    struct CRawBlock {
+        uint64_t seq = 0;
+        uint64_t pos = 0;
+        std::vector<char> data;
+    };
+
+    struct CParsedBlock {
+        uint64_t pos = 0;
+        std::shared_ptr<CBlock> pBlock;  // null if the block could not be deserialized
+    };
+
+    void ScanFile();
+    void ParseBlocks();
+    int32_t ConnectBlocks();
+    void LogProgress(bool fDone);
+
+    FILE *file;
+    CDiskBlockPos *dbp;
+    uint32_t workers;
+
+    MsgQueue<CRawBlock> rawQueue;
+
+    std::mutex parsedMutex;
+    std::condition_variable parsedCond;
+    std::map<uint64_t, CParsedBlock> parsedBlocks;  // parsed blocks waiting for their turn
+    uint64_t nextSeq      = 0;                     // seq of the next block to connect
+    uint64_t scannedCount = 0;                     // number of frames found, valid when fScanDone
+    bool fScanDone        = false;
+    std::atomic<bool> fStop;
+
+    // metrics
+    int64_t startTime;
+    int64_t lastLogTime;
+    std::atomic<uint64_t> scannedBytes;
+    std::atomic<int64_t> parseMicros;
+    int64_t connectMicros = 0;
+    uint64_t connectedCount = 0;
+};
+
+#endif //CHAIN_BLOCK_IMPORT_H
@@ -0,0 +1,201 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockprefetch.h"
+
+#include "main.h"
+#include "logging.h"
+#include "metrics.h"
+#include "persistence/cachewrapper.h"
+#include "taskscheduler.h"
+#include "tx/tx.h"
+
+#include <atomic>
+
+using namespace std;
+
+// keys read by one call to the storage
+static const size_t PREFETCH_CHUNK_SIZE = 64;
+
+// The keys of one cache missing in it, read on the workers chunk by chunk, put in the cache afterwards
+class CBlockPrefetcher::CJob {
+public:
+    virtual ~CJob() {}
+
+    size_t GetCount() const { return dbKeys.size(); }
+    bool IsFailed() const { return fFailed; }
+
+    void Read(size_t begin, size_t end) {
+        if (fFailed)
+            return;
+        try {
+            vector<string> keys(dbKeys.begin() + begin, dbKeys.begin() + end);
+            vector<optional<string>> chunkValues;
+            GetDbAccess()->MultiGetRaw(keys, chunkValues);
+            for (size_t i = 0; i < chunkValues.size(); i++)
+                values[begin + i] = std::move(chunkValues[i]);
+        } catch (const std::exception &e) {
+            // a failed read must not put the keys in the cache as missing, the execution reads them again
+            LogPrint(BCLog::ERROR, "CBlockPrefetcher: failed to read the keys of %s, %s\n",
+                     dbk::GetKeyPrefix(GetPrefixType()), e.what());
+            fFailed = true;
+        }
+    }
+
+    // Return the number of the keys found in the db
+    virtual uint32_t Apply() = 0;
+
+protected:
+    virtual CDBAccess *GetDbAccess() = 0;
+    virtual dbk::PrefixType GetPrefixType() const = 0;
+
+    vector<string> dbKeys;
+    vector<optional<string>> values;
+    atomic<bool> fFailed{false};
+};
+
+namespace {
+
+template <typename CacheType>
+class CCacheJob : public CBlockPrefetcher::CJob {
+public:
+    typedef typename CacheType::KeyType KeyType;
+
+    explicit CCacheJob(CacheType &cacheIn) : cache(cacheIn) {}
+
+    void Add(const KeyType &key) {
+        if (db_util::IsEmpty(key) || cache.IsCached(key) || !keySet.insert(key).second)
+            return;
+        keys.push_back(key);
+        dbKeys.push_back(dbk::GenDbKey(CacheType::PREFIX_TYPE, key));
+        values.emplace_back();
+    }
+
+    uint32_t Apply() override {
+        uint32_t found = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (values[i])
+                found++;
+            cache.AddPrefetched(keys[i], values[i]);
+        }
+        return found;
+    }
+
+protected:
+    CDBAccess *GetDbAccess() override { return cache.GetDbAccessPtr(); }
+    dbk::PrefixType GetPrefixType() const override { return CacheType::PREFIX_TYPE; }
+
+private:
+    CacheType &cache;
+    set<KeyType> keySet;
+    vector<KeyType> keys;
+};
+
+template <typename CacheType>
+shared_ptr<CCacheJob<CacheType>> NewJob(CacheType &cache) {
+    return make_shared<CCacheJob<CacheType>>(cache);
+}
+
+// the regids go to the regid job and are returned for the second round, the keyids and the pubkeys
+// to the account job
+template <typename RegIdJobType, typename AccountJobType>
+void AddUids(const vector<CUserID> &uids, RegIdJobType &regIdJob, AccountJobType &accountJob,
+             vector<CRegID> &regIds) {
+    for (const auto &uid : uids) {
+        if (uid.is<CRegID>()) {
+            regIdJob.Add(CRegIDKey(uid.get<CRegID>()));
+            regIds.push_back(uid.get<CRegID>());
+        } else if (uid.is<CKeyID>()) {
+            accountJob.Add(uid.get<CKeyID>());
+        } else if (uid.is<CPubKey>() && uid.get<CPubKey>().IsFullyValid()) {
+            accountJob.Add(uid.get<CPubKey>().GetKeyId());
+        }
+    }
+}
+
+}  // namespace
+
+uint32_t CBlockPrefetcher::GetThreadCount() {
+    static const uint32_t threadCount = []() {
+        int64_t count = SysCfg().GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS);
+        if (count <= 0)
+            return (uint32_t)0;
+        return (uint32_t)min<int64_t>(count, MAX_PREFETCH_THREADS);
+    }();
+    return threadCount;
+}
+
+uint32_t CBlockPrefetcher::Prefetch(const CBlock &block) {
+    AssertLockHeld(cs_main);
+    CMetricTimer timer(metricBlockPrefetch);
+
+    CTxPrefetchKeys txKeys;
+    for (const auto &pTx : block.vptx)
+        pTx->GetPrefetchKeys(txKeys);
+
+    auto regIdJob   = NewJob(cdMan.pAccountCache->regId2KeyIdCache);
+    auto accountJob = NewJob(cdMan.pAccountCache->accountCache);
+    auto cdpJob     = NewJob(cdMan.pCdpCache->cdpCache);
+    auto orderJob   = NewJob(cdMan.pDexCache->activeOrderCache);
+    vector<CRegID> regIds;
+    AddUids(txKeys.uids, *regIdJob, *accountJob, regIds);
+    for (const auto &cdpId : txKeys.cdpIds)
+        cdpJob->Add(cdpId);
+    for (const auto &orderId : txKeys.orderIds)
+        orderJob->Add(orderId);
+
+    uint32_t count = RunJobs({regIdJob, accountJob, cdpJob, orderJob});
+    return count + PrefetchRegIdAccounts(regIds);
+}
+
+uint32_t CBlockPrefetcher::PrefetchAccounts(const vector<CUserID> &uids) {
+    AssertLockHeld(cs_main);
+
+    auto regIdJob   = NewJob(cdMan.pAccountCache->regId2KeyIdCache);
+    auto accountJob = NewJob(cdMan.pAccountCache->accountCache);
+    vector<CRegID> regIds;
+    AddUids(uids, *regIdJob, *accountJob, regIds);
+
+    uint32_t count = RunJobs({regIdJob, accountJob});
+    return count + PrefetchRegIdAccounts(regIds);
+}
+
+uint32_t CBlockPrefetcher::PrefetchRegIdAccounts(const vector<CRegID> &regIds) {
+    // the accounts of the regids, known now their keyids are in the cache
+    auto accountJob = NewJob(cdMan.pAccountCache->accountCache);
+    for (const auto &regId : regIds) {
+        CKeyID keyId;
+        if (cdMan.pAccountCache->GetKeyId(regId, keyId))
+            accountJob->Add(keyId);
+    }
+    return RunJobs({accountJob});
+}
+
+uint32_t CBlockPrefetcher::RunJobs(const vector<shared_ptr<CJob>> &jobs) {
+    // the chunks of all jobs, taken by the workers one after the other
+    vector<pair<CJob *, size_t>> chunks;
+    for (const auto &pJob : jobs) {
+        for (size_t begin = 0; begin < pJob->GetCount(); begin += PREFETCH_CHUNK_SIZE)
+            chunks.emplace_back(pJob.get(), begin);
+    }
+    if (chunks.empty())
+        return 0;
+
+    ParallelFor(TASK_PRIORITY_CONSENSUS, chunks.size(), threads, [&](size_t i) {
+        CJob *pJob = chunks[i].first;
+        size_t begin = chunks[i].second;
+        pJob->Read(begin, min(begin + PREFETCH_CHUNK_SIZE, pJob->GetCount()));
+    });
+
+    uint32_t count = 0;
+    for (const auto &pJob : jobs) {
+        if (pJob->IsFailed())
+            continue;
+        uint32_t found = pJob->Apply();
+        metricPrefetchKeys.Get("found").Inc(found);
+        metricPrefetchKeys.Get("missing").Inc(pJob->GetCount() - found);
+        count += pJob->GetCount();
+    }
+    return count;
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_BLOCK_PREFETCH_H
+#define CHAIN_BLOCK_PREFETCH_H
+
+#include "entities/id.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+class CBlock;
+class CCacheDBManager;
+
+/**
+ * Prefetch of the db values a block reads which are known from the fields of its txs, see
+ * CBaseTx::GetPrefetchKeys(): the accounts of the uids, the CDPs and the active dex orders. The keys
+ * missing in the top level caches of the manager are read from the dbs in batches on the task scheduler
+ * and put in the read caches, so the execution of the block finds them in memory. The regids of the
+ * uids are resolved in a first round, the accounts they map to are read in a second one.
+ *
+ * The db reads run on the workers only, the caches are looked up and filled on the calling thread,
+ * which must hold cs_main like ConnectBlock.
+ */
+class CBlockPrefetcher {
+public:
+    class CJob;
+
+    CBlockPrefetcher(CCacheDBManager &cdManIn, uint32_t threadsIn) : cdMan(cdManIn), threads(threadsIn) {}
+
+    // Number of the parallel reads configured by -prefetchthreads, 0 disables the prefetch
+    static uint32_t GetThreadCount();
+
+    // Return the number of keys read from the dbs
+    uint32_t Prefetch(const CBlock &block);
+
+    // Prefetch the accounts of the uids only, e.g. of the voters processed at a fork height
+    uint32_t PrefetchAccounts(const std::vector<CUserID> &uids);
+
+private:
+    // read the keys of the jobs from the dbs on the workers, then put them in their caches
+    uint32_t RunJobs(const std::vector<std::shared_ptr<CJob>> &jobs);
+    // the second round, the accounts of the regids resolved by the first one
+    uint32_t PrefetchRegIdAccounts(const std::vector<CRegID> &regIds);
+
+    CCacheDBManager &cdMan;
+    uint32_t threads;
+};
+
+#endif  // CHAIN_BLOCK_PREFETCH_H
@@ -0,0 +1,213 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockreplay.h"
+
+#include "commons/json/json_spirit_utils.h"
+#include "commons/json/json_spirit_writer_template.h"
+#include "commons/util/util.h"
+#include "tx/tx.h"
+
+#include <algorithm>
+
+#include <boost/filesystem/fstream.hpp>
+
+using namespace std;
+using namespace json_spirit;
+
+CBlockReplay blockReplay;
+
+namespace {
+
+Object ToJson(const CDBPrefixStats::CPrefixCounts &counts) {
+    Object obj;
+    obj.push_back(Pair("reads",  (int64_t)counts.reads));
+    obj.push_back(Pair("writes", (int64_t)counts.writes));
+    obj.push_back(Pair("hits",   (int64_t)counts.hits));
+    obj.push_back(Pair("misses", (int64_t)counts.misses));
+    return obj;
+}
+
+double Percentile(const vector<int64_t> &sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    return sorted[min(sorted.size() - 1, (size_t)(p * sorted.size()))] * 0.001;
+}
+
+}  // namespace
+
+bool CBlockReplay::Init(const string &range) {
+    size_t pos = range.find(':');
+    if (pos == string::npos)
+        return false;
+
+    from = atoi(range.substr(0, pos));
+    to   = atoi(range.substr(pos + 1));
+    if (from <= 0 || to < from) {
+        from = to = 0;
+        return false;
+    }
+    return true;
+}
+
+void CBlockReplay::AddTx(const CTxExecStats &stats) {
+    CTotals &totals = txTypeTotals[stats.txType];
+    totals.count++;
+    totals.micros += stats.wallMicros;
+    totals.steps += stats.runSteps;
+    for (uint32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++) {
+        totals.dbCounts[i].reads += stats.dbStats.counts[i].reads;
+        totals.dbCounts[i].writes += stats.dbStats.counts[i].writes;
+        totals.dbCounts[i].hits += stats.dbStats.counts[i].hits;
+        totals.dbCounts[i].misses += stats.dbStats.counts[i].misses;
+    }
+}
+
+void CBlockReplay::AddBlock(const CBlockTimes &times) {
+    if (blocks.empty())
+        beginTime = GetTimeMillis() - times.GetTotal() / 1000;
+    blocks.push_back(times);
+}
+
+string CBlockReplay::GetVmName(uint8_t txType) {
+    switch (txType) {
+        case LCONTRACT_DEPLOY_TX:
+        case LCONTRACT_INVOKE_TX:
+        case UCONTRACT_DEPLOY_TX:
+        case UCONTRACT_INVOKE_TX:
+            return "lua";
+        case WASM_CONTRACT_TX:
+            return "wasm";
+        default:
+            return "none";
+    }
+}
+
+bool CBlockReplay::Finish() {
+    if (fFinished)
+        return true;
+    fFinished = true;
+
+    int64_t wallTime = blocks.empty() ? 0 : GetTimeMillis() - beginTime;
+    vector<int64_t> blockTimes;
+    CBlockTimes phases;
+    uint64_t txCount = 0;
+    Array blockArray;
+    for (const auto &times : blocks) {
+        blockTimes.push_back(times.GetTotal());
+        phases.read += times.read;
+        phases.connect += times.connect;
+        phases.flush += times.flush;
+        phases.write += times.write;
+        txCount += times.txs;
+
+        Array item;
+        item.push_back(times.height);
+        item.push_back((int64_t)times.txs);
+        item.push_back(times.read);
+        item.push_back(times.connect);
+        item.push_back(times.flush);
+        item.push_back(times.write);
+        blockArray.push_back(item);
+    }
+    sort(blockTimes.begin(), blockTimes.end());
+    double totalSeconds = phases.GetTotal() / 1000000.0;
+
+    Object blockTimeObj;
+    blockTimeObj.push_back(Pair("p50", Percentile(blockTimes, 0.5)));
+    blockTimeObj.push_back(Pair("p90", Percentile(blockTimes, 0.9)));
+    blockTimeObj.push_back(Pair("p99", Percentile(blockTimes, 0.99)));
+    blockTimeObj.push_back(Pair("max", blockTimes.empty() ? 0 : blockTimes.back() * 0.001));
+
+    Object phaseObj;
+    phaseObj.push_back(Pair("read",    phases.read * 0.001));
+    phaseObj.push_back(Pair("connect", phases.connect * 0.001));
+    phaseObj.push_back(Pair("flush",   phases.flush * 0.001));
+    phaseObj.push_back(Pair("write",   phases.write * 0.001));
+
+    // the totals by tx type, summed up by VM and by db
+    map<string, CTotals> vmTotals;
+    CTotals allTotals;
+    Array txTypeArray;
+    for (const auto &item : txTypeTotals) {
+        const CTotals &totals = item.second;
+        CTotals &vm = vmTotals[GetVmName(item.first)];
+        for (CTotals *pSum : {&vm, &allTotals}) {
+            pSum->count += totals.count;
+            pSum->micros += totals.micros;
+            pSum->steps += totals.steps;
+            for (uint32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++) {
+                pSum->dbCounts[i].reads += totals.dbCounts[i].reads;
+                pSum->dbCounts[i].writes += totals.dbCounts[i].writes;
+                pSum->dbCounts[i].hits += totals.dbCounts[i].hits;
+                pSum->dbCounts[i].misses += totals.dbCounts[i].misses;
+            }
+        }
+
+        Object obj;
+        obj.push_back(Pair("tx_type",  GetTxTypeName((TxType)item.first)));
+        obj.push_back(Pair("vm",       GetVmName(item.first)));
+        obj.push_back(Pair("count",    (int64_t)totals.count));
+        obj.push_back(Pair("total_ms", totals.micros * 0.001));
+        obj.push_back(Pair("avg_us",   (double)totals.micros / totals.count));
+        obj.push_back(Pair("steps",    (int64_t)totals.steps));
+        txTypeArray.push_back(obj);
+    }
+
+    Array vmArray;
+    for (const auto &item : vmTotals) {
+        Object obj;
+        obj.push_back(Pair("vm",       item.first));
+        obj.push_back(Pair("count",    (int64_t)item.second.count));
+        obj.push_back(Pair("total_ms", item.second.micros * 0.001));
+        obj.push_back(Pair("steps",    (int64_t)item.second.steps));
+        vmArray.push_back(obj);
+    }
+
+    Object dbObj;
+    for (uint32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++) {
+        if (!allTotals.dbCounts[i].IsEmpty())
+            dbObj.push_back(Pair(GetDbName((DBNameType)i), ToJson(allTotals.dbCounts[i])));
+    }
+
+    Object prefixObj;
+    for (uint32_t i = 0; i < dbk::PREFIX_COUNT; i++) {
+        if (!prefixStats.counts[i].IsEmpty())
+            prefixObj.push_back(Pair(dbk::GetKeyPrefix((dbk::PrefixType)i), ToJson(prefixStats.counts[i])));
+    }
+
+    Object report;
+    report.push_back(Pair("version",          FormatFullVersion()));
+    report.push_back(Pair("from",             from));
+    report.push_back(Pair("to",               to));
+    report.push_back(Pair("blocks",           (int64_t)blocks.size()));
+    report.push_back(Pair("txs",              (int64_t)txCount));
+    report.push_back(Pair("wall_s",           wallTime * 0.001));
+    report.push_back(Pair("connect_tip_s",    totalSeconds));
+    report.push_back(Pair("blocks_per_s",     totalSeconds > 0 ? blocks.size() / totalSeconds : 0));
+    report.push_back(Pair("txs_per_s",        totalSeconds > 0 ? txCount / totalSeconds : 0));
+    report.push_back(Pair("block_ms",         blockTimeObj));
+    report.push_back(Pair("phase_ms",         phaseObj));
+    report.push_back(Pair("tx_types",         txTypeArray));
+    report.push_back(Pair("vms",              vmArray));
+    report.push_back(Pair("dbs",              dbObj));
+    report.push_back(Pair("prefixes",         prefixObj));
+    // [height, txs, read_us, connect_us, flush_us, write_us] of each block
+    report.push_back(Pair("block_times",      blockArray));
+
+    LogPrint(BCLog::INFO, "Replayed %u blocks of %d:%d with %llu txs, connect_tip=%.2fs (%.1f blocks/s, %.1f txs/s)\n",
+             blocks.size(), from, to, txCount, totalSeconds, totalSeconds > 0 ? blocks.size() / totalSeconds : 0,
+             totalSeconds > 0 ? txCount / totalSeconds : 0);
+    if (blocks.empty() || blocks.back().height != to)
+        LogPrint(BCLog::INFO, "Warning: the replay ended before the block %d\n", to);
+
+    boost::filesystem::path path = GetDataDir() / strprintf("replay-%d-%d.json", from, to);
+    boost::filesystem::ofstream file(path);
+    file << write_string(Value(report), true) << "\n";
+    if (!file.good())
+        return ERRORMSG("CBlockReplay::Finish() : failed to write the report %s", path.string());
+
+    LogPrint(BCLog::INFO, "Wrote the replay report %s\n", path.string());
+    return true;
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_BLOCK_REPLAY_H
+#define CHAIN_BLOCK_REPLAY_H
+
+#include "chain/txexecstats.h"
+#include "persistence/dbaccess.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * The replay of the blocks <from> to <to> of -replayblocks=<from>:<to>, to compare the validation speed
+ * of releases on the same blocks. The node starts from the state of the block before <from>, usually
+ * loaded by -loadstate, and connects the blocks of -loadblock or -reindex without networking. When the
+ * block <to> is connected or the files are exhausted, the report is written to replay-<from>-<to>.json
+ * in the data directory and the node shuts down.
+ *
+ * The report has the time of each block and of its phases, and the time, VM steps and db accesses by tx
+ * type, by VM and by db. The accesses by key prefix, cache hits vs. leveldb reads, are counted on the
+ * connecting thread only, so they miss the speculation of the workers of -parallelconnect.
+ */
+class CBlockReplay {
+public:
+    // the time of a block in ConnectTip, in micros
+    struct CBlockTimes {
+        int32_t height = 0;
+        uint32_t txs   = 0;
+        int64_t read    = 0;
+        int64_t connect = 0;
+        int64_t flush   = 0;
+        int64_t write   = 0;  // WriteChainState and UpdateTip
+
+        int64_t GetTotal() const { return read + connect + flush + write; }
+    };
+
+    // parse "<from>:<to>", false if invalid
+    bool Init(const std::string &range);
+    bool IsActive() const { return to > 0; }
+    bool IsInRange(int32_t height) const { return height >= from && height <= to; }
+    int32_t GetFrom() const { return from; }
+    int32_t GetTo() const { return to; }
+
+    // the scope of the counts by key prefix, guarded by cs_main like the rest
+    CDBPrefixStats *GetPrefixStats() { return &prefixStats; }
+    void AddTx(const CTxExecStats &stats);
+    void AddBlock(const CBlockTimes &times);
+
+    // write the report once, false if it could not be written
+    bool Finish();
+
+private:
+    struct CTotals {
+        uint64_t count = 0;
+        int64_t micros = 0;
+        uint64_t steps = 0;
+        CDBPrefixStats::CPrefixCounts dbCounts[DBNameType::DB_NAME_COUNT];
+    };
+
+    static std::string GetVmName(uint8_t txType);
+
+    int32_t from  = 0;
+    int32_t to    = 0;
+    bool fFinished = false;
+    int64_t beginTime = 0;
+
+    std::vector<CBlockTimes> blocks;
+    std::map<uint8_t, CTotals> txTypeTotals;
+    CDBPrefixStats prefixStats;
+};
+
+extern CBlockReplay blockReplay;
+
+#endif  // CHAIN_BLOCK_REPLAY_H
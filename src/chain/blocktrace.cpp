@@ -0,0 +1,95 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blocktrace.h"
+
+#include "commons/util/time.h"
+
+#include <chrono>
+
+using namespace std;
+
+CBlockTracer blockTracer;
+
+// the trace of the block being connected by the thread, its steady start and the depth of its next span
+static thread_local CBlockTrace *t_pTrace = nullptr;
+static thread_local int64_t t_start       = 0;
+static thread_local uint32_t t_depth      = 0;
+
+static int64_t GetSteadyMicros() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CBlockTracer::CBlockScope::CBlockScope(int32_t height, const uint256 &hash) {
+    // a nested scope is a no-op, the spans go to the outer trace
+    if (blockTracer.GetCapacity() <= 0 || t_pTrace != nullptr)
+        return;
+
+    pTrace.reset(new CBlockTrace());
+    pTrace->height    = height;
+    pTrace->hash      = hash;
+    pTrace->startTime = GetTimeMicros();
+    t_start           = GetSteadyMicros();
+    t_pTrace          = pTrace.get();
+    t_depth           = 0;
+}
+
+CBlockTracer::CBlockScope::~CBlockScope() {
+    if (!pTrace)
+        return;
+
+    pTrace->durationMicros = GetSteadyMicros() - t_start;
+    t_pTrace = nullptr;
+    blockTracer.Add(std::move(pTrace));
+}
+
+CBlockTracer::CSpanScope::CSpanScope(const char *name, int32_t txIndex, const char *detail)
+    : pTrace(t_pTrace), index(0), start(0) {
+    if (pTrace == nullptr)
+        return;
+
+    start = GetSteadyMicros();
+    CBlockTraceSpan span;
+    span.name        = name;
+    span.detail      = detail;
+    span.txIndex     = txIndex;
+    span.depth       = t_depth++;
+    span.startMicros = start - t_start;
+    index            = pTrace->spans.size();
+    pTrace->spans.push_back(span);
+}
+
+void CBlockTracer::CSpanScope::End() {
+    if (pTrace == nullptr)
+        return;
+
+    pTrace->spans[index].durationMicros = GetSteadyMicros() - start;
+    pTrace = nullptr;
+    --t_depth;
+}
+
+void CBlockTracer::SetCapacity(int32_t capacity) {
+    capacity = max<int32_t>(0, min<int32_t>(capacity, MAX_BLOCK_TRACES));
+    nCapacity.store(capacity, memory_order_relaxed);
+
+    lock_guard<mutex> lock(mtx);
+    while ((int32_t)traces.size() > capacity)
+        traces.pop_front();
+}
+
+vector<shared_ptr<const CBlockTrace>> CBlockTracer::GetTraces(int32_t count) const {
+    lock_guard<mutex> lock(mtx);
+    size_t n = min<size_t>(max<int32_t>(0, count), traces.size());
+    return vector<shared_ptr<const CBlockTrace>>(traces.end() - n, traces.end());
+}
+
+void CBlockTracer::Add(unique_ptr<CBlockTrace> pTrace) {
+    shared_ptr<const CBlockTrace> pShared(std::move(pTrace));
+    int32_t capacity = GetCapacity();
+
+    lock_guard<mutex> lock(mtx);
+    traces.push_back(std::move(pShared));
+    while ((int32_t)traces.size() > max<int32_t>(1, capacity))
+        traces.pop_front();
+}
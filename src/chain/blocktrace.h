@@ -0,0 +1,93 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_BLOCK_TRACE_H
+#define CHAIN_BLOCK_TRACE_H
+
+#include "commons/uint256.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static const int32_t DEFAULT_BLOCK_TRACES = 100;
+static const int32_t MAX_BLOCK_TRACES     = 10000;
+
+/** A phase of the connection of a block, the offsets are from the start of the trace */
+struct CBlockTraceSpan {
+    const char *name   = "";       // a string literal
+    const char *detail = nullptr;  // the tx type of ExecuteTx, a static string or null
+    int32_t txIndex    = -1;       // the index in the block of the tx of the span, -1 if none
+    uint32_t depth     = 0;        // the number of the spans enclosing it
+    int64_t startMicros    = 0;
+    int64_t durationMicros = -1;   // -1 until the span ends
+};
+
+struct CBlockTrace {
+    int32_t height = 0;
+    uint256 hash;
+    int64_t startTime      = 0;  // unix time in microseconds
+    int64_t durationMicros = 0;
+    bool fConnected        = false;
+    std::vector<CBlockTraceSpan> spans;  // in the order they started
+};
+
+/**
+ * Per block breakdown of the time of ConnectTip, kept for the last -blocktraces blocks and returned
+ * by getblocktraces, as JSON or as the trace events of chrome://tracing and Perfetto.
+ *
+ * The trace of a block is collected in a thread local of the thread connecting it, so the span
+ * scopes cost two clock reads when a trace is active and a branch otherwise, e.g. in
+ * TestBlockValidity. The speculation of the parallel executor is one span, its workers are not traced.
+ */
+class CBlockTracer {
+public:
+    /** Trace the connection of the block on the calling thread for the scope */
+    class CBlockScope {
+    public:
+        CBlockScope(int32_t height, const uint256 &hash);
+        ~CBlockScope();
+
+        void SetConnected() { if (pTrace) pTrace->fConnected = true; }
+
+    private:
+        std::unique_ptr<CBlockTrace> pTrace;
+    };
+
+    /** A span of the trace active on the calling thread, if any */
+    class CSpanScope {
+    public:
+        explicit CSpanScope(const char *name, int32_t txIndex = -1, const char *detail = nullptr);
+        ~CSpanScope() { End(); }
+
+        // end the span before the end of the scope
+        void End();
+
+    private:
+        CBlockTrace *pTrace;
+        size_t index;
+        int64_t start;
+    };
+
+    // 0 disables the tracing, the traces beyond the capacity are dropped
+    void SetCapacity(int32_t capacity);
+    int32_t GetCapacity() const { return nCapacity.load(std::memory_order_relaxed); }
+    // the last traces, the newest last
+    std::vector<std::shared_ptr<const CBlockTrace>> GetTraces(int32_t count) const;
+
+private:
+    void Add(std::unique_ptr<CBlockTrace> pTrace);
+
+    mutable std::mutex mtx;
+    std::deque<std::shared_ptr<const CBlockTrace>> traces;
+    std::atomic<int32_t> nCapacity{DEFAULT_BLOCK_TRACES};
+};
+
+extern CBlockTracer blockTracer;
+
+#endif  // CHAIN_BLOCK_TRACE_H
@@ -64,6 +64,9 @@ CBlockLocator CChain::GetLocator(const CBlockIndex *pIndex) const {
 
     if (!pIndex)
         pIndex = Tip();
+    // The blocks up to the fork are accessed by height in this chain, the ones above it by the skip list.
+    const CBlockIndex *pFork = FindFork(pIndex);
+    int32_t forkHeight       = pFork ? pFork->height : -1;
     while (pIndex) {
         vHave.push_back(pIndex->GetBlockHash());
         // Stop when we have added the genesis block.
@@ -71,16 +74,7 @@ CBlockLocator CChain::GetLocator(const CBlockIndex *pIndex) const {
             break;
         // Exponentially larger steps back, plus the genesis block.
         int32_t height = max(pIndex->height - nStep, 0);
-        // Jump back quickly to the same height as the chain.
-        if (pIndex->height > height)
-            pIndex = pIndex->GetAncestor(height);
-        // In case pIndex is not in this chain, iterate pIndex->pprev to find blocks.
-        while (!Contains(pIndex))
-            pIndex = pIndex->pprev;
-
-        // If pIndex is in this chain, use direct height-based access.
-        if (pIndex->height > height)
-            pIndex = (*this)[height];
+        pIndex = height <= forkHeight ? (*this)[height] : pIndex->GetAncestor(height);
 
         if (vHave.size() > 10)
             nStep *= 2;
@@ -89,10 +83,10 @@ CBlockLocator CChain::GetLocator(const CBlockIndex *pIndex) const {
     return CBlockLocator(vHave);
 }
 
-CBlockIndex* CChain::FindFork(map<uint256, CBlockIndex *> &mapBlockIndex, const CBlockLocator &locator) const {
+CBlockIndex* CChain::FindFork(BlockMap &mapBlockIndex, const CBlockLocator &locator) const {
     // Find the first block the caller has in the main chain
     for (const auto &hash : locator.vHave) {
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hash);
+        BlockMap::iterator mi = mapBlockIndex.find(hash);
         if (mi != mapBlockIndex.end()) {
             CBlockIndex *pIndex = (*mi).second;
             if (pIndex && Contains(pIndex))
@@ -102,3 +96,24 @@ CBlockIndex* CChain::FindFork(map<uint256, CBlockIndex *> &mapBlockIndex, const
 
     return Genesis();
 }
+
+const CBlockIndex *CChain::FindFork(const CBlockIndex *pIndex) const {
+    if (pIndex == nullptr)
+        return nullptr;
+    if (pIndex->height > Height())
+        pIndex = pIndex->GetAncestor(Height());
+    if (pIndex == nullptr || Contains(pIndex))
+        return pIndex;
+
+    // The ancestors in this chain are the ones up to the fork, bisect its height with the skip list
+    // instead of walking back block by block.
+    int32_t low = -1, high = pIndex->height;
+    while (high - low > 1) {
+        int32_t mid = low + (high - low) / 2;
+        if (Contains(pIndex->GetAncestor(mid)))
+            low = mid;
+        else
+            high = mid;
+    }
+    return low < 0 ? nullptr : pIndex->GetAncestor(low);
+}
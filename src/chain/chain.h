@@ -48,7 +48,10 @@ public:
     CBlockLocator GetLocator(const CBlockIndex *pIndex = nullptr) const;
 
     /** Find the last common block between this chain and a locator. */
-    CBlockIndex *FindFork(map<uint256, CBlockIndex *> &mapBlockIndex, const CBlockLocator &locator) const;
+    CBlockIndex *FindFork(BlockMap &mapBlockIndex, const CBlockLocator &locator) const;
+
+    /** Find the last common block between this chain and the branch of a block, nullptr if none. */
+    const CBlockIndex *FindFork(const CBlockIndex *pIndex) const;
 
 }; //end of CChain
 
@@ -8,24 +8,15 @@
 ////////////////////////////////////////////////////////////////////////////////
 // class CPartialMerkleTree
 
-uint256 CPartialMerkleTree::CalcHash(int32_t height, uint32_t pos, const vector<uint256> &vTxid) {
-    if (height == 0) {
-        // hash at height 0 is the txids themself
-        return vTxid[pos];
-    } else {
-        // calculate left hash
-        uint256 left = CalcHash(height - 1, pos * 2, vTxid), right;
-        // calculate right hash if not beyond the end of the array - copy left hash otherwise1
-        if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            right = CalcHash(height - 1, pos * 2 + 1, vTxid);
-        else
-            right = left;
-        // combine subhashes
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
-    }
+const uint256 &CPartialMerkleTree::CalcHash(int32_t height, uint32_t pos, const vector<uint256> &vTree) {
+    // the levels below height come first in vTree
+    uint32_t offset = 0;
+    for (int32_t h = 0; h < height; h++)
+        offset += CalcTreeWidth(h);
+    return vTree[offset + pos];
 }
 
-void CPartialMerkleTree::TraverseAndBuild(int32_t height, uint32_t pos, const vector<uint256> &vTxid, const vector<bool> &vMatch) {
+void CPartialMerkleTree::TraverseAndBuild(int32_t height, uint32_t pos, const vector<uint256> &vTree, const vector<bool> &vMatch) {
     // determine whether this node is the parent of at least one matched txid
     bool fParentOfMatch = false;
     for (uint32_t p = pos << height; p < (pos + 1) << height && p < nTransactions; p++)
@@ -34,12 +25,12 @@ void CPartialMerkleTree::TraverseAndBuild(int32_t height, uint32_t pos, const ve
     vBits.push_back(fParentOfMatch);
     if (height == 0 || !fParentOfMatch) {
         // if at height 0, or nothing interesting below, store hash and stop
-        vHash.push_back(CalcHash(height, pos, vTxid));
+        vHash.push_back(CalcHash(height, pos, vTree));
     } else {
         // otherwise, don't store any hash, but descend into the subtrees
-        TraverseAndBuild(height - 1, pos * 2, vTxid, vMatch);
+        TraverseAndBuild(height - 1, pos * 2, vTree, vMatch);
         if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            TraverseAndBuild(height - 1, pos * 2 + 1, vTxid, vMatch);
+            TraverseAndBuild(height - 1, pos * 2 + 1, vTree, vMatch);
     }
 }
 
@@ -85,8 +76,12 @@ CPartialMerkleTree::CPartialMerkleTree(const vector<uint256> &vTxid, const vecto
     while (CalcTreeWidth(height) > 1)
         height++;
 
+    // hash the whole tree level by level once, the traversal only picks its nodes
+    vector<uint256> vTree(vTxid);
+    ComputeMerkleTree(vTree);
+
     // traverse the partial tree
-    TraverseAndBuild(height, 0, vTxid, vMatch);
+    TraverseAndBuild(height, 0, vTree, vMatch);
 }
 
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
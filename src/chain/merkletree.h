@@ -62,11 +62,11 @@ protected:
         return (nTransactions + (1 << height) - 1) >> height;
     }
 
-    // calculate the hash of a node in the merkle tree (at leaf level: the txid's themself)
-    uint256 CalcHash(int32_t height, uint32_t pos, const vector<uint256> &vTxid);
+    // the hash of a node in vTree, the txids extended by ComputeMerkleTree (at leaf level: the txid's themself)
+    const uint256 &CalcHash(int32_t height, uint32_t pos, const vector<uint256> &vTree);
 
     // recursive function that traverses tree nodes, storing the data as bits and hashes
-    void TraverseAndBuild(int32_t height, uint32_t pos, const vector<uint256> &vTxid, const vector<bool> &vMatch);
+    void TraverseAndBuild(int32_t height, uint32_t pos, const vector<uint256> &vTree, const vector<bool> &vMatch);
 
     // recursive function that traverses tree nodes, consuming the bits and hashes produced by TraverseAndBuild.
     // it returns the hash of the respective node.
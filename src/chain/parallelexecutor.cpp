@@ -0,0 +1,126 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parallelexecutor.h"
+
+#include "main.h"
+#include "commons/util/threadaffinity.h"
+#include "logging.h"
+#include "metrics.h"
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+CParallelTxExecutor::CParallelTxExecutor(CBlock &blockIn, CBlockIndex *pIndexIn, CCacheWrapper &cwIn,
+                                         uint32_t threadsIn)
+    : block(blockIn), pIndex(pIndexIn), cw(cwIn), threads(threadsIn), nextPending(0) {
+    results.resize(block.vptx.size());
+}
+
+bool CParallelTxExecutor::IsParallelizable(const CBaseTx &tx) {
+    switch (tx.nTxType) {
+        case BCOIN_TRANSFER_TX:
+        case UCOIN_TRANSFER_TX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t CParallelTxExecutor::GetThreadCount() {
+    static const uint32_t threadCount = []() {
+        int64_t count = SysCfg().GetArg("-parallelconnect", 1);
+        if (count <= 0)
+            count = boost::thread::hardware_concurrency();
+        return (uint32_t)max<int64_t>(1, min<int64_t>(count, MAX_PARALLEL_CONNECT_THREADS));
+    }();
+    return threadCount;
+}
+
+void CParallelTxExecutor::Speculate() {
+    uint32_t fuelRate = block.GetFuelRate();
+    for (int32_t index = 1; index < (int32_t)block.vptx.size(); ++index) {
+        auto &pBaseTx = block.vptx[index];
+        if (IsParallelizable(*pBaseTx)) {
+            pBaseTx->nFuelRate = fuelRate;
+            pendingIndexes.push_back(index);
+        }
+    }
+
+    if (pendingIndexes.size() < 2)
+        return;
+
+    uint32_t workerCount = min<uint32_t>(threads, pendingIndexes.size());
+    boost::thread_group workers;
+    for (uint32_t i = 0; i < workerCount; ++i)
+        workers.create_thread(boost::bind(&CParallelTxExecutor::ExecuteWorker, this));
+
+    workers.join_all();
+}
+
+void CParallelTxExecutor::ExecuteWorker() {
+    SetThreadPool(THREAD_POOL_VALIDATION);
+    uint32_t next;
+    while ((next = nextPending.fetch_add(1)) < pendingIndexes.size()) {
+        ExecuteSpeculatively(pendingIndexes[next]);
+    }
+}
+
+void CParallelTxExecutor::ExecuteSpeculatively(int32_t index) {
+    CSpeculativeResult &result = results[index];
+    auto &pBaseTx              = block.vptx[index];
+
+    result.tracker.pBaseMutex = &baseMutex;
+    CDBAccessTracker::CScope trackerScope(&result.tracker);
+    CDBAccessStats::CScope statsScope(&result.dbStats);
+    try {
+        {
+            auto baseLock = CDBAccessTracker::LockBase();
+            result.spCw   = std::make_shared<CCacheWrapper>(&cw);
+        }
+
+        CValidationState state;
+        uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
+        CTxExecuteContext context(pIndex->height, index, block.GetFuelRate(), pIndex->nTime, prevBlockTime,
+                                  result.spCw.get(), &state);
+        {
+            CTxUndoOpLogger opLogger(*result.spCw, pBaseTx->GetHash(), result.txUndo);
+            CMetricTimer metricTimer(metricExecuteTx.Get(pBaseTx->GetTxTypeName()));
+            int64_t start     = GetTimeMicros();
+            result.success    = pBaseTx->ExecuteTx(context);
+            result.wallMicros = GetTimeMicros() - start;
+        }
+        result.executed = true;
+    } catch (std::exception &e) {
+        LogPrint(BCLog::INFO, "%s(), speculative execution of txid=%s aborted: %s\n", __FUNCTION__,
+                 pBaseTx->GetHash().GetHex(), e.what());
+        result.executed = false;
+    }
+}
+
+bool CParallelTxExecutor::MergeResult(int32_t index, CBlockUndo &blockUndo, CTxExecStats *pStats) {
+    CSpeculativeResult &result = results[index];
+    if (!result.executed)
+        return false;
+
+    // failed txs are re-executed serially so that the rejection is reported exactly as before
+    bool merged = result.success && !result.tracker.fMergeUnsafe && !result.tracker.IsConflict(dirtyKeys) &&
+                  result.txUndo.vtxundo.size() == 1;
+    if (merged) {
+        result.spCw->Flush();
+        blockUndo.vtxundo.push_back(std::move(result.txUndo.vtxundo[0]));
+        dirtyKeys.MergeWrites(result.tracker);
+        ++mergedCount;
+
+        if (pStats != nullptr) {
+            pStats->fParallel  = true;
+            pStats->wallMicros = result.wallMicros;
+            pStats->dbStats    = result.dbStats;
+        }
+    }
+
+    result.spCw = nullptr;
+    return merged;
+}
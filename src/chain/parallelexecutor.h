@@ -0,0 +1,82 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+
+#ifndef CHAIN_PARALLEL_EXECUTOR_H
+#define CHAIN_PARALLEL_EXECUTOR_H
+
+#include "chain/txexecstats.h"
+#include "persistence/blockundo.h"
+#include "persistence/cachewrapper.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CBaseTx;
+
+/**
+ * Optimistic parallel executor for the transactions of one block.
+ *
+ * Speculate() runs every parallelizable tx on its own child CCacheWrapper of cw, all against the
+ * state before the block, recording the keys each one reads and writes. ConnectBlock then walks
+ * the block in order: a speculative result is merged into cw only if it read nothing written by
+ * an earlier tx of the block, otherwise the tx is executed again serially. Because a merged tx saw
+ * exactly the values the serial path would have seen, state and undo data are byte-identical.
+ */
+class CParallelTxExecutor {
+public:
+    CParallelTxExecutor(CBlock &blockIn, CBlockIndex *pIndexIn, CCacheWrapper &cwIn, uint32_t threadsIn);
+
+    // Only txs whose execution touches nothing but the db caches may be speculated, VM contracts,
+    // price points and iterator based dex/cdp scans stay on the serial path.
+    static bool IsParallelizable(const CBaseTx &tx);
+
+    // Number of worker threads configured by -parallelconnect, 1 means serial execution
+    static uint32_t GetThreadCount();
+
+    // Execute all parallelizable txs of the block on worker threads
+    void Speculate();
+
+    // Merge the speculative result of the tx at index into cw and blockUndo in block order, and its
+    // time and db accesses into pStats if not null. Return false when the tx must be executed serially.
+    bool MergeResult(int32_t index, CBlockUndo &blockUndo, CTxExecStats *pStats = nullptr);
+
+    // Account the writes of a serially executed tx for the conflict checks of the later ones
+    void AddSerialWrites(const CDBAccessTracker &tracker) { dirtyKeys.MergeWrites(tracker); }
+
+    uint32_t GetMergedCount() const { return mergedCount; }
+
+private:
+    struct CSpeculativeResult {
+        bool executed = false;
+        bool success  = false;
+        std::shared_ptr<CCacheWrapper> spCw;
+        CDBAccessTracker tracker;
+        CBlockUndo txUndo;
+        CDBAccessStats dbStats;
+        int64_t wallMicros = 0;
+    };
+
+    void ExecuteWorker();
+    void ExecuteSpeculatively(int32_t index);
+
+    CBlock &block;
+    CBlockIndex *pIndex;
+    CCacheWrapper &cw;
+    uint32_t threads;
+
+    std::vector<CSpeculativeResult> results;
+    std::vector<int32_t> pendingIndexes;
+    std::atomic<uint32_t> nextPending;
+    std::recursive_mutex baseMutex;
+
+    CDBAccessTracker dirtyKeys;  // all keys written by the txs merged or executed so far
+    uint32_t mergedCount = 0;
+};
+
+#endif //CHAIN_PARALLEL_EXECUTOR_H
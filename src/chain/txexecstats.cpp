@@ -0,0 +1,49 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txexecstats.h"
+
+using namespace std;
+
+CTxExecStatsCache txExecStats;
+
+void CTxExecStatsCache::SetCapacity(int32_t capacity) {
+    capacity = max<int32_t>(0, min<int32_t>(capacity, MAX_TX_STATS));
+    nCapacity.store(capacity, memory_order_relaxed);
+
+    lock_guard<mutex> lock(mtx);
+    Evict(capacity);
+}
+
+void CTxExecStatsCache::Add(const uint256 &txid, const CTxExecStats &stats) {
+    int32_t capacity = nCapacity.load(memory_order_relaxed);
+    if (capacity <= 0)
+        return;
+
+    lock_guard<mutex> lock(mtx);
+    CEntry &entry = entries[txid];
+    entry.seq     = nextSeq++;
+    entry.stats   = stats;
+    order.emplace_back(entry.seq, txid);
+    Evict(capacity);
+}
+
+bool CTxExecStatsCache::Get(const uint256 &txid, CTxExecStats &stats) const {
+    lock_guard<mutex> lock(mtx);
+    auto it = entries.find(txid);
+    if (it == entries.end())
+        return false;
+
+    stats = it->second.stats;
+    return true;
+}
+
+void CTxExecStatsCache::Evict(size_t capacity) {
+    while (entries.size() > capacity && !order.empty()) {
+        auto it = entries.find(order.front().second);
+        if (it != entries.end() && it->second.seq == order.front().first)
+            entries.erase(it);
+        order.pop_front();
+    }
+}
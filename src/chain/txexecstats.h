@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_TX_EXEC_STATS_H
+#define CHAIN_TX_EXEC_STATS_H
+
+#include "commons/uint256.h"
+#include "persistence/dbaccess.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+
+static const int32_t DEFAULT_TX_STATS = 0;
+static const int32_t MAX_TX_STATS     = 10000000;
+
+/** The cost of the execution of a tx in ConnectBlock, node local, not part of consensus */
+struct CTxExecStats {
+    int32_t height     = 0;
+    int32_t index      = 0;      // the index of the tx in the block
+    uint8_t txType     = 0;
+    bool fParallel     = false;  // merged from the speculative execution of the parallel executor
+    int64_t wallMicros = 0;      // the time of ExecuteTx, on a worker thread if fParallel
+    uint64_t runSteps  = 0;      // the VM steps
+    CDBAccessStats dbStats;
+};
+
+/**
+ * Execution stats of the txs of the last blocks connected, enabled by -txstats=<n> which keeps the
+ * last n txs in memory, returned by gettxdetail with verbose. The stats of a tx connected again
+ * after a reorg replace the old ones.
+ */
+class CTxExecStatsCache {
+public:
+    // 0 disables the stats, the oldest txs beyond the capacity are dropped
+    void SetCapacity(int32_t capacity);
+    bool IsEnabled() const { return nCapacity.load(std::memory_order_relaxed) > 0; }
+
+    void Add(const uint256 &txid, const CTxExecStats &stats);
+    bool Get(const uint256 &txid, CTxExecStats &stats) const;
+
+private:
+    struct CEntry {
+        uint64_t seq = 0;
+        CTxExecStats stats;
+    };
+
+    void Evict(size_t capacity);
+
+    mutable std::mutex mtx;
+    std::map<uint256, CEntry> entries;
+    std::deque<std::pair<uint64_t, uint256>> order;  // seq and txid, oldest first, a replaced tx stays until popped
+    uint64_t nextSeq = 0;
+    std::atomic<int32_t> nCapacity{DEFAULT_TX_STATS};
+};
+
+extern CTxExecStatsCache txExecStats;
+
+#endif  // CHAIN_TX_EXEC_STATS_H
@@ -0,0 +1,146 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txlatency.h"
+
+#include "commons/util/time.h"
+#include "metrics.h"
+#include "tx/tx.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+CTxLatencyTracer txLatencyTracer;
+
+namespace {
+
+const char *const kTxLatencyStageNames[TX_STAGE_COUNT] = {
+    "rpc_received", "p2p_received", "mempool_accepted", "relayed", "packed", "connected", "finalized"};
+
+// the metric is only used here, constructed on first use as the LOCK profiles of sync.cpp
+CMetricHistogramFamily &StageLatencyMetric() {
+    static CMetricHistogramFamily metric("coind_tx_stage_latency_seconds", "Time from the first stage of the traced txs to each later stage", "stage");
+    return metric;
+}
+
+bool IsEntryStage(TxLatencyStage stage) {
+    return stage == TX_STAGE_RPC_RECEIVED || stage == TX_STAGE_P2P_RECEIVED || stage == TX_STAGE_MEMPOOL_ACCEPTED;
+}
+
+}  // namespace
+
+const char *GetTxLatencyStageName(TxLatencyStage stage) {
+    assert(stage < TX_STAGE_COUNT);
+    return kTxLatencyStageNames[stage];
+}
+
+int64_t CTxLatencyTrace::GetStartTime() const {
+    int64_t start = 0;
+    for (int64_t time : stageTimes) {
+        if (time != 0 && (start == 0 || time < start))
+            start = time;
+    }
+    return start;
+}
+
+void CTxLatencyTracer::SetCapacity(int32_t capacity) {
+    capacity = max<int32_t>(0, min<int32_t>(capacity, MAX_TX_LATENCY_TRACES));
+    nCapacity.store(capacity, memory_order_relaxed);
+
+    lock_guard<mutex> lock(mtx);
+    while ((int32_t)order.size() > capacity) {
+        traces.erase(order.front());
+        order.pop_front();
+    }
+}
+
+bool CTxLatencyTracer::StampTrace(CTxLatencyTrace &trace, TxLatencyStage stage, int64_t now) {
+    if (trace.stageTimes[stage] != 0)
+        return false;
+
+    // the latency of a stage is observed once, from the first stage reached before it
+    int64_t start = trace.GetStartTime();
+    trace.stageTimes[stage] = now;
+    if (start != 0)
+        StageLatencyMetric().Get(GetTxLatencyStageName(stage)).Observe(max<int64_t>(0, now - start));
+    return true;
+}
+
+void CTxLatencyTracer::Stamp(const uint256 &txid, TxLatencyStage stage) {
+    int32_t capacity = GetCapacity();
+    if (capacity <= 0)
+        return;
+
+    int64_t now = GetTimeMicros();
+    lock_guard<mutex> lock(mtx);
+    auto it = traces.find(txid);
+    if (it == traces.end()) {
+        if (!IsEntryStage(stage))
+            return;
+
+        it = traces.emplace(txid, CTxLatencyTrace()).first;
+        it->second.txid = txid;
+        order.push_back(txid);
+        while ((int32_t)order.size() > capacity) {
+            traces.erase(order.front());
+            order.pop_front();
+        }
+    }
+    StampTrace(it->second, stage, now);
+}
+
+void CTxLatencyTracer::OnBlockConnected(int32_t height, const vector<shared_ptr<CBaseTx>> &vptx) {
+    if (!IsEnabled())
+        return;
+
+    int64_t now = GetTimeMicros();
+    lock_guard<mutex> lock(mtx);
+    for (const auto &pTx : vptx) {
+        auto it = traces.find(pTx->GetHash());
+        if (it == traces.end())
+            continue;
+
+        StampTrace(it->second, TX_STAGE_CONNECTED, now);
+        it->second.blockHeight = height;
+    }
+}
+
+void CTxLatencyTracer::OnBlockDisconnected(int32_t height) {
+    if (!IsEnabled())
+        return;
+
+    lock_guard<mutex> lock(mtx);
+    for (auto &item : traces) {
+        CTxLatencyTrace &trace = item.second;
+        if (trace.blockHeight == height && trace.stageTimes[TX_STAGE_FINALIZED] == 0) {
+            trace.blockHeight = -1;
+            trace.stageTimes[TX_STAGE_CONNECTED] = 0;
+        }
+    }
+}
+
+void CTxLatencyTracer::OnBlockFinalized(int32_t height) {
+    if (!IsEnabled())
+        return;
+
+    int64_t now = GetTimeMicros();
+    lock_guard<mutex> lock(mtx);
+    for (auto &item : traces) {
+        CTxLatencyTrace &trace = item.second;
+        if (trace.blockHeight >= 0 && trace.blockHeight <= height)
+            StampTrace(trace, TX_STAGE_FINALIZED, now);
+    }
+}
+
+bool CTxLatencyTracer::GetTrace(const uint256 &txid, CTxLatencyTrace &trace) const {
+    lock_guard<mutex> lock(mtx);
+    auto it = traces.find(txid);
+    if (it == traces.end())
+        return false;
+
+    trace = it->second;
+    return true;
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_TX_LATENCY_H
+#define CHAIN_TX_LATENCY_H
+
+#include "commons/uint256.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class CBaseTx;
+
+static const int32_t DEFAULT_TX_LATENCY_TRACES = 0;
+static const int32_t MAX_TX_LATENCY_TRACES     = 100000;
+
+/** The stages of a tx on its way to a final block, as seen by this node */
+enum TxLatencyStage : uint8_t {
+    TX_STAGE_RPC_RECEIVED = 0,  // submitted through the rpc
+    TX_STAGE_P2P_RECEIVED,      // first received from a peer, e.g. by the producer
+    TX_STAGE_MEMPOOL_ACCEPTED,  // AcceptToMemoryPool done
+    TX_STAGE_RELAYED,           // first announced to a peer
+    TX_STAGE_PACKED,            // packed in a block produced by this node
+    TX_STAGE_CONNECTED,         // its block connected to the active chain
+    TX_STAGE_FINALIZED,         // its block finalized by pbft
+    TX_STAGE_COUNT
+};
+
+const char *GetTxLatencyStageName(TxLatencyStage stage);
+
+struct CTxLatencyTrace {
+    uint256 txid;
+    int64_t stageTimes[TX_STAGE_COUNT] = {};  // unix time in microseconds, 0 until the stage is reached
+    int32_t blockHeight = -1;                 // the height of its block while connected
+
+    // the time of the first stage reached
+    int64_t GetStartTime() const;
+};
+
+/**
+ * Timestamps of the txs at each stage from their submission or first receipt to their finality, kept for the
+ * last -txlatencytraces txs and returned by gettxlatency. The time from the first stage to each later one is
+ * observed in the coind_tx_stage_latency_seconds histograms of the metrics endpoint.
+ *
+ * A tx is traced from its first rpc, p2p or mempool stamp, the later stages of the txs not traced, e.g. the
+ * ones only seen in a block, are ignored. The first stamp of a stage is kept. Disabled, a stamp costs a
+ * relaxed load.
+ */
+class CTxLatencyTracer {
+public:
+    // 0 disables the tracing, the oldest traces beyond the capacity are dropped
+    void SetCapacity(int32_t capacity);
+    int32_t GetCapacity() const { return nCapacity.load(std::memory_order_relaxed); }
+    bool IsEnabled() const { return GetCapacity() > 0; }
+
+    void Stamp(const uint256 &txid, TxLatencyStage stage);
+    void OnBlockConnected(int32_t height, const std::vector<std::shared_ptr<CBaseTx>> &vptx);
+    // the txs of the block are connected again when a block of another fork has them
+    void OnBlockDisconnected(int32_t height);
+    // the txs connected up to the height are final
+    void OnBlockFinalized(int32_t height);
+
+    bool GetTrace(const uint256 &txid, CTxLatencyTrace &trace) const;
+
+private:
+    // stamp the stage at now unless it is already, true if it was not
+    bool StampTrace(CTxLatencyTrace &trace, TxLatencyStage stage, int64_t now);
+
+    mutable std::mutex mtx;
+    std::unordered_map<uint256, CTxLatencyTrace, CSaltedUint256Hasher> traces;
+    std::deque<uint256> order;  // the txids in the order they were first traced
+    std::atomic<int32_t> nCapacity{DEFAULT_TX_LATENCY_TRACES};
+};
+
+extern CTxLatencyTracer txLatencyTracer;
+
+#endif  // CHAIN_TX_LATENCY_H
@@ -0,0 +1,47 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txlookupcache.h"
+
+using namespace std;
+
+CTxLookupCache txLookupCache;
+
+bool CTxLookupCache::Get(const uint256 &txid, CConfirmedTx &tx) {
+    lock_guard<mutex> lock(mtx);
+    auto it = entryMap.find(txid);
+    if (it == entryMap.end())
+        return false;
+
+    entries.splice(entries.begin(), entries, it->second);
+    tx = it->second->second;
+    return true;
+}
+
+void CTxLookupCache::Add(const uint256 &txid, const CConfirmedTx &tx) {
+    lock_guard<mutex> lock(mtx);
+    auto it = entryMap.find(txid);
+    if (it != entryMap.end()) {
+        entries.splice(entries.begin(), entries, it->second);
+        it->second->second = tx;
+        return;
+    }
+
+    entries.emplace_front(txid, tx);
+    entryMap.emplace(txid, entries.begin());
+    if (entries.size() > MAX_TX_LOOKUP_CACHE_TXS) {
+        entryMap.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void CTxLookupCache::Remove(const uint256 &txid) {
+    lock_guard<mutex> lock(mtx);
+    auto it = entryMap.find(txid);
+    if (it == entryMap.end())
+        return;
+
+    entries.erase(it->second);
+    entryMap.erase(it);
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_TX_LOOKUP_CACHE_H
+#define CHAIN_TX_LOOKUP_CACHE_H
+
+#include "commons/uint256.h"
+
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class CBaseTx;
+
+// the confirmed txs kept by txLookupCache, the least recently used beyond it are dropped
+static const size_t MAX_TX_LOOKUP_CACHE_TXS = 10000;
+
+/** A tx read from the block files through the tx index, with the header fields of its block */
+struct CConfirmedTx {
+    std::shared_ptr<CBaseTx> pBaseTx;
+    int32_t height  = -1;
+    uint32_t time   = 0;
+    uint256 blockHash;
+};
+
+/**
+ * The txs recently read through the tx index, for the contracts and the RPCs looking up the same txs again
+ * and again, each lookup otherwise opens the block file and deserializes the header and the tx. The entries
+ * are not cleared on a reorg, GetConfirmedTx drops a hit whose block has left chainActive.
+ */
+class CTxLookupCache {
+public:
+    bool Get(const uint256 &txid, CConfirmedTx &tx);
+    void Add(const uint256 &txid, const CConfirmedTx &tx);
+    void Remove(const uint256 &txid);
+
+private:
+    typedef std::list<std::pair<uint256, CConfirmedTx>> EntryList;
+
+    std::mutex mtx;
+    EntryList entries;  // the most recently used first
+    std::unordered_map<uint256, EntryList::iterator, CSaltedUint256Hasher> entryMap;
+};
+
+extern CTxLookupCache txLookupCache;
+
+#endif  // CHAIN_TX_LOOKUP_CACHE_H
@@ -30,7 +30,9 @@ static bool AppInitRPC(int argc, char* argv[])
             _("Usage:") + "\n" +
               "  coincli [options] <command> [params]  " + _("Send command to Coin Core") + "\n" +
               "  coincli [options] help                " + _("List commands") + "\n" +
-              "  coincli [options] help <command>      " + _("Get help for a command") + "\n";
+              "  coincli [options] help <command>      " + _("Get help for a command") + "\n" +
+              "  coincli [options] -batch[=<file>]     " + _("Send the commands of a file or of stdin in batches") + "\n" +
+              "  coincli [options] -cliserver          " + _("Send the commands of stdin over one connection") + "\n";
 
         strUsage += "\n" + HelpMessageCli(true);
 
@@ -0,0 +1,145 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_ARENA_H
+#define COIN_ARENA_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Monotonic arena: allocations are carved out of large blocks and never freed one by one. The
+ * arena counts its live allocations and rewinds to its first block as soon as the last one is
+ * released, so a set of containers that are always emptied together (the caches of one
+ * CCacheWrapper layer) reuse the same memory without going through malloc for every node.
+ *
+ * The arena is owned by the allocators drawing from it, so it outlives the containers moved out of
+ * the object that created it. It never returns its blocks before it is destroyed, it is meant for
+ * short-lived containers such as the ones of a per-block or per-tx cache layer.
+ *
+ * The arena is not thread safe, its users must serialize access like they do for the containers.
+ */
+class CMonotonicArena {
+public:
+    static constexpr size_t MIN_BLOCK_SIZE = 16 * 1024;
+    static constexpr size_t MAX_BLOCK_SIZE = 1024 * 1024;
+
+    CMonotonicArena() : curBlock(0), offset(0), liveCount(0) {}
+    CMonotonicArena(const CMonotonicArena &) = delete;
+    CMonotonicArena &operator=(const CMonotonicArena &) = delete;
+
+    void *Allocate(size_t size, size_t align) {
+        assert(align <= alignof(std::max_align_t));
+        while (curBlock < blocks.size()) {
+            size_t start = (offset + align - 1) & ~(align - 1);
+            if (start + size <= blocks[curBlock].size) {
+                offset = start + size;
+                ++liveCount;
+                return blocks[curBlock].data.get() + start;
+            }
+            ++curBlock;
+            offset = 0;
+        }
+
+        size_t blockSize = blocks.empty() ? MIN_BLOCK_SIZE : std::min(blocks.back().size * 2, MAX_BLOCK_SIZE);
+        blocks.push_back(CBlock(std::max(blockSize, size)));
+        curBlock = blocks.size() - 1;
+        offset   = size;
+        ++liveCount;
+        return blocks[curBlock].data.get();
+    }
+
+    void Deallocate(void *p) {
+        assert(liveCount > 0);
+        if (--liveCount == 0) {
+            // everything is released, the blocks can be handed out again from the start
+            curBlock = 0;
+            offset   = 0;
+        }
+    }
+
+    size_t GetLiveCount() const { return liveCount; }
+
+    size_t GetReservedSize() const {
+        size_t total = 0;
+        for (const auto &block : blocks)
+            total += block.size;
+        return total;
+    }
+
+    // Arena used by the default constructed CArenaAllocator of the current thread, none for the heap
+    static const std::shared_ptr<CMonotonicArena> &GetCurrent() { return spCurrent; }
+    static std::shared_ptr<CMonotonicArena> SetCurrent(std::shared_ptr<CMonotonicArena> spArena) {
+        std::swap(spCurrent, spArena);
+        return spArena;
+    }
+
+private:
+    struct CBlock {
+        std::unique_ptr<char[]> data;
+        size_t size;
+
+        explicit CBlock(size_t sizeIn) : data(new char[sizeIn]), size(sizeIn) {}
+    };
+
+    std::vector<CBlock> blocks;
+    size_t curBlock;
+    size_t offset;
+    size_t liveCount;
+
+    static inline thread_local std::shared_ptr<CMonotonicArena> spCurrent;
+};
+
+/**
+ * STL allocator drawing from a CMonotonicArena, or from the heap when it has no arena. A default
+ * constructed allocator binds to the current arena of the thread, which lets a container pick up
+ * the arena of the object constructing it without passing it through every constructor. Copies of
+ * a container bind to the current arena again instead of sharing the one of the source. The
+ * allocators share the ownership of their arena.
+ */
+template <typename T>
+class CArenaAllocator {
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::false_type propagate_on_container_swap;
+
+    CArenaAllocator() : spArena(CMonotonicArena::GetCurrent()) {}
+    explicit CArenaAllocator(std::shared_ptr<CMonotonicArena> spArenaIn) : spArena(std::move(spArenaIn)) {}
+
+    template <typename U>
+    CArenaAllocator(const CArenaAllocator<U> &other) : spArena(other.spArena) {}
+
+    T *allocate(size_t n) {
+        if (!spArena)
+            return std::allocator<T>().allocate(n);
+
+        return static_cast<T *>(spArena->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (!spArena)
+            std::allocator<T>().deallocate(p, n);
+        else
+            spArena->Deallocate(p);
+    }
+
+    CArenaAllocator select_on_container_copy_construction() const { return CArenaAllocator(); }
+
+    template <typename U>
+    bool operator==(const CArenaAllocator<U> &other) const { return spArena == other.spArena; }
+    template <typename U>
+    bool operator!=(const CArenaAllocator<U> &other) const { return spArena != other.spArena; }
+
+    std::shared_ptr<CMonotonicArena> spArena;
+};
+
+#endif  // COIN_ARENA_H
@@ -20,6 +20,21 @@
 /* All alphanumeric characters except for "0", "I", "O", and "l" */
 static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 
+// the digit of each char, -1 if not in the alphabet
+static const struct CBase58Digits {
+	int8_t digits[256];
+	CBase58Digits() {
+		memset(digits, -1, sizeof(digits));
+		for (int8_t i = 0; i < 58; i++)
+			digits[(uint8_t)pszBase58[i]] = i;
+	}
+} base58Digits;
+
+// The conversions work on limbs of 5 base58 digits (58^5 < 2^32) or of 32 bits, so a step takes
+// several digits or bytes at once, as in base58 of libbase58, instead of one with a loop over the digits.
+static const uint32_t BASE58_LIMB_DIGITS = 5;
+static const uint64_t BASE58_LIMB        = 58ULL * 58 * 58 * 58 * 58;
+
 bool DecodeBase58(const char *psz, vector<unsigned char>& vch) {
 	// Skip leading spaces.
 	while (*psz && isspace(*psz))
@@ -30,38 +45,44 @@ bool DecodeBase58(const char *psz, vector<unsigned char>& vch) {
 		zeroes++;
 		psz++;
 	}
-	// Allocate enough space in big-endian base256 representation.
-	vector<unsigned char> b256(strlen(psz) * 733 / 1000 + 1); // log(58) / log(256), rounded up.
-	// Process the characters.
+	// The number in little endian limbs of 32 bits, log(58) / log(256), rounded up.
+	vector<uint32_t> limbs;
+	limbs.reserve(strlen(psz) * 733 / 1000 / 4 + 1);
+	// Process the characters, 5 per step.
 	while (*psz && !isspace(*psz)) {
-		// Decode base58 character
-		const char *ch = strchr(pszBase58, *psz);
-		if (ch == NULL)
-			return false;
-		// Apply "b256 = b256 * 58 + ch".
-		int carry = ch - pszBase58;
-		for (vector<unsigned char>::reverse_iterator it = b256.rbegin(); it != b256.rend(); it++) {
-			carry += 58 * (*it);
-			*it = carry % 256;
-			carry /= 256;
+		uint64_t carry = 0;
+		uint64_t mul   = 1;
+		for (uint32_t i = 0; i < BASE58_LIMB_DIGITS && *psz && !isspace(*psz); i++, psz++) {
+			int8_t digit = base58Digits.digits[(uint8_t)*psz];
+			if (digit < 0)
+				return false;
+			carry = carry * 58 + digit;
+			mul *= 58;
 		}
-		assert(carry == 0);
-		psz++;
+		// Apply "limbs = limbs * 58^n + carry".
+		for (uint32_t &limb : limbs) {
+			carry += limb * mul;
+			limb  = (uint32_t)carry;
+			carry >>= 32;
+		}
+		for (; carry > 0; carry >>= 32)
+			limbs.push_back((uint32_t)carry);
 	}
 	// Skip trailing spaces.
 	while (isspace(*psz))
 		psz++;
 	if (*psz != 0)
 		return false;
-	// Skip leading zeroes in b256.
-	vector<unsigned char>::iterator it = b256.begin();
-	while (it != b256.end() && *it == 0)
-		it++;
-	// Copy result into output vector.
-	vch.reserve(zeroes + (b256.end() - it));
+	// Copy result into output vector, the leading zeroes of the top limb skipped.
+	vch.reserve(zeroes + limbs.size() * 4);
 	vch.assign(zeroes, 0x00);
-	while (it != b256.end())
-		vch.push_back(*(it++));
+	for (size_t i = limbs.size(); i-- > 0;) {
+		for (int shift = 24; shift >= 0; shift -= 8) {
+			uint8_t byte = (uint8_t)(limbs[i] >> shift);
+			if (byte != 0 || vch.size() > (size_t)zeroes)
+				vch.push_back(byte);
+		}
+	}
 	return true;
 }
 
@@ -72,30 +93,43 @@ string EncodeBase58(const unsigned char* pbegin, const unsigned char* pend) {
 		pbegin++;
 		zeroes++;
 	}
-	// Allocate enough space in big-endian base58 representation.
-	vector<unsigned char> b58((pend - pbegin) * 138 / 100 + 1); // log(256) / log(58), rounded up.
-	// Process the bytes.
+	// The number in little endian limbs of 5 digits, log(256) / log(58), rounded up.
+	vector<uint32_t> limbs;
+	limbs.reserve(((pend - pbegin) * 138 / 100 + 1) / BASE58_LIMB_DIGITS + 1);
+	// Process the bytes, 3 per step so that a limb times 2^24 fits in 64 bits.
 	while (pbegin != pend) {
-		int carry = *pbegin;
-		// Apply "b58 = b58 * 256 + ch".
-		for (vector<unsigned char>::reverse_iterator it = b58.rbegin(); it != b58.rend(); it++) {
-			carry += 256 * (*it);
-			*it = carry % 58;
-			carry /= 58;
+		uint64_t carry = 0;
+		uint64_t mul   = 1;
+		for (uint32_t i = 0; i < 3 && pbegin != pend; i++, pbegin++) {
+			carry = (carry << 8) | *pbegin;
+			mul <<= 8;
 		}
-		assert(carry == 0);
-		pbegin++;
+		// Apply "limbs = limbs * 256^n + carry".
+		for (uint32_t &limb : limbs) {
+			carry += limb * mul;
+			limb  = (uint32_t)(carry % BASE58_LIMB);
+			carry /= BASE58_LIMB;
+		}
+		for (; carry > 0; carry /= BASE58_LIMB)
+			limbs.push_back((uint32_t)(carry % BASE58_LIMB));
 	}
-	// Skip leading zeroes in base58 result.
-	vector<unsigned char>::iterator it = b58.begin();
-	while (it != b58.end() && *it == 0)
-		it++;
-	// Translate the result into a string.
+	// Translate the result into a string, the leading zeroes of the top limb skipped.
 	string str;
-	str.reserve(zeroes + (b58.end() - it));
+	str.reserve(zeroes + limbs.size() * BASE58_LIMB_DIGITS);
 	str.assign(zeroes, '1');
-	while (it != b58.end())
-		str += pszBase58[*(it++)];
+	for (size_t i = limbs.size(); i-- > 0;) {
+		char digits[BASE58_LIMB_DIGITS];
+		uint32_t limb = limbs[i];
+		for (uint32_t j = BASE58_LIMB_DIGITS; j-- > 0; limb /= 58)
+			digits[j] = pszBase58[limb % 58];
+
+		uint32_t first = 0;
+		if (i == limbs.size() - 1) {
+			while (first < BASE58_LIMB_DIGITS - 1 && digits[first] == '1')
+				first++;
+		}
+		str.append(digits + first, BASE58_LIMB_DIGITS - first);
+	}
 	return str;
 }
 
@@ -86,4 +86,32 @@ public:
     void Clear();
 };
 
+/**
+ * RollingBloomFilter is a probabilistic "keep track of most recently inserted" set.
+ * Construct it with the number of items to keep track of, and a false-positive rate.
+ *
+ * The items are kept in three generations of nElements / 2 items each, the oldest generation is
+ * forgotten when a new one is full, so at least nElements and at most 1.5 * nElements recent items
+ * are always known. Each bit of the filter takes two bits, the generation that set it last.
+ */
+class CRollingBloomFilter {
+public:
+    CRollingBloomFilter(uint32_t nElements, double nFPRate);
+
+    void insert(const vector<uint8_t>& vKey);
+    void insert(const uint256& hash);
+    bool contains(const vector<uint8_t>& vKey) const;
+    bool contains(const uint256& hash) const;
+
+    void reset();
+
+private:
+    int32_t nEntriesPerGeneration;
+    int32_t nEntriesThisGeneration;
+    int32_t nGeneration;
+    vector<uint64_t> data;
+    uint32_t nTweak;
+    int32_t nHashFuncs;
+};
+
 #endif /* COIN_BLOOM_H */
@@ -0,0 +1,170 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_FLATHASHMAP_H
+#define COIN_FLATHASHMAP_H
+
+#include "random.h"
+#include "serialize.h"
+
+#include <stdint.h>
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+ * Hasher for any serializable key: FNV-1a over the serialized bytes, salted per process so the
+ * slots of a node can not be predicted from chain data, and finalized with the murmur3 mixer.
+ */
+template <typename K>
+class CSerializeHasher {
+private:
+    class CWriter {
+    public:
+        int32_t nType;
+        int32_t nVersion;
+        uint64_t hash;
+
+        CWriter(uint64_t seed) : nType(SER_GETHASH), nVersion(0), hash(seed) {}
+
+        CWriter &write(const char *pch, size_t size) {
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= (uint8_t)pch[i];
+                hash *= 0x100000001b3ULL;
+            }
+            return (*this);
+        }
+    };
+
+    static uint64_t GetSeed() {
+        static const uint64_t seed = 0xcbf29ce484222325ULL ^ GetRand(std::numeric_limits<uint64_t>::max());
+        return seed;
+    }
+
+public:
+    size_t operator()(const K &key) const {
+        CWriter writer(GetSeed());
+        ::Serialize(writer, key, writer.nType, writer.nVersion);
+
+        uint64_t h = writer.hash;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return (size_t)h;
+    }
+};
+
+/**
+ * STL-like hash map with open addressing. The elements are kept densely in insertion order and
+ * found through a linear probing table of element indexes, so a lookup touches two flat arrays
+ * instead of walking a tree of heap nodes.
+ *
+ * It only supports what the db caches need: there is no erase, the whole map is cleared at once.
+ * Iterators and references are invalidated by every insertion.
+ */
+template <typename K, typename V, typename Hasher = std::hash<K>>
+class CFlatHashMap {
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+private:
+    static const size_t MIN_SLOTS = 16;
+
+    std::vector<value_type> entries;
+    std::vector<uint32_t> slots;  // element index + 1 for every used slot, 0 for an empty one
+    Hasher hasher;
+
+    // return the slot holding key, or the empty slot where it would be inserted
+    size_t FindSlot(const K &key) const {
+        size_t mask = slots.size() - 1;
+        size_t slot = hasher(key) & mask;
+        while (slots[slot] != 0 && !(entries[slots[slot] - 1].first == key)) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void Rehash(size_t slotCount) {
+        slots.assign(slotCount, 0);
+        size_t mask = slotCount - 1;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            size_t slot = hasher(entries[i].first) & mask;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = i + 1;
+        }
+    }
+
+    // keep the load factor of the probing table at most 3/4
+    void ReserveForInsert() {
+        if (slots.empty()) {
+            Rehash(MIN_SLOTS);
+        } else if ((entries.size() + 1) * 4 > slots.size() * 3) {
+            Rehash(slots.size() * 2);
+        }
+    }
+
+public:
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    void clear() {
+        entries.clear();
+        slots.clear();
+    }
+
+    iterator find(const K &key) {
+        if (entries.empty())
+            return entries.end();
+
+        size_t slot = FindSlot(key);
+        return slots[slot] != 0 ? entries.begin() + (slots[slot] - 1) : entries.end();
+    }
+
+    const_iterator find(const K &key) const {
+        if (entries.empty())
+            return entries.end();
+
+        size_t slot = FindSlot(key);
+        return slots[slot] != 0 ? entries.begin() + (slots[slot] - 1) : entries.end();
+    }
+
+    size_t count(const K &key) const { return find(key) != end() ? 1 : 0; }
+
+    template <typename KeyArg, typename ValueArg>
+    std::pair<iterator, bool> emplace(KeyArg &&keyIn, ValueArg &&valueIn) {
+        ReserveForInsert();
+        K key(std::forward<KeyArg>(keyIn));
+        size_t slot = FindSlot(key);
+        if (slots[slot] != 0)
+            return std::make_pair(entries.begin() + (slots[slot] - 1), false);
+
+        entries.emplace_back(std::move(key), std::forward<ValueArg>(valueIn));
+        slots[slot] = entries.size();
+        return std::make_pair(entries.end() - 1, true);
+    }
+
+    V &operator[](const K &key) {
+        iterator it = find(key);
+        if (it != entries.end())
+            return it->second;
+
+        return emplace(key, V()).first->second;
+    }
+};
+
+#endif  // COIN_FLATHASHMAP_H
@@ -0,0 +1,268 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "jsonreader.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <charconv>
+
+using namespace json_spirit;
+
+static int HexToNum(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+void CJsonReader::Fail(const char *what) const {
+    throw Error(std::string(what) + " at offset " + std::to_string(p - begin));
+}
+
+void CJsonReader::SkipSpaces() {
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\f' || *p == '\v'))
+        ++p;
+}
+
+void CJsonReader::Expect(char c) {
+    SkipSpaces();
+    if (p == end || *p != c)
+        Fail("unexpected char");
+    ++p;
+}
+
+char CJsonReader::PeekValue() {
+    SkipSpaces();
+    if (p == end)
+        Fail("unexpected end");
+    return *p;
+}
+
+void CJsonReader::BeginObject() {
+    if (levels.size() >= MAX_DEPTH)
+        Fail("too deep");
+    Expect('{');
+    levels.push_back(false);
+}
+
+bool CJsonReader::NextMember(std::string &name) {
+    SkipSpaces();
+    if (p != end && *p == '}') {
+        ++p;
+        levels.pop_back();
+        return false;
+    }
+    if (levels.back())
+        Expect(',');
+    levels.back() = true;
+    ReadString(name);
+    Expect(':');
+    return true;
+}
+
+void CJsonReader::BeginArray() {
+    if (levels.size() >= MAX_DEPTH)
+        Fail("too deep");
+    Expect('[');
+    levels.push_back(false);
+}
+
+bool CJsonReader::NextItem() {
+    SkipSpaces();
+    if (p != end && *p == ']') {
+        ++p;
+        levels.pop_back();
+        return false;
+    }
+    if (levels.back())
+        Expect(',');
+    levels.back() = true;
+    return true;
+}
+
+// the escapes of the json_spirit reader, \u is truncated to a char and the unknown ones are dropped
+void CJsonReader::ReadString(std::string &str) {
+    Expect('"');
+    str.clear();
+    const char *start = p;
+    while (true) {
+        if (p == end)
+            Fail("unterminated string");
+        char c = *p;
+        if (c == '"') {
+            str.append(start, p - start);
+            ++p;
+            return;
+        }
+        if (c != '\\') {
+            ++p;
+            continue;
+        }
+
+        str.append(start, p - start);
+        if (++p == end)
+            Fail("unterminated string");
+        switch (*p) {
+            case 't':  str += '\t'; break;
+            case 'b':  str += '\b'; break;
+            case 'f':  str += '\f'; break;
+            case 'n':  str += '\n'; break;
+            case 'r':  str += '\r'; break;
+            case '\\': str += '\\'; break;
+            case '/':  str += '/';  break;
+            case '"':  str += '"';  break;
+            case 'x':
+                if (end - p >= 3) {
+                    str += (char)((HexToNum(p[1]) << 4) + HexToNum(p[2]));
+                    p += 2;
+                }
+                break;
+            case 'u':
+                if (end - p >= 5) {
+                    str += (char)((HexToNum(p[1]) << 12) + (HexToNum(p[2]) << 8) + (HexToNum(p[3]) << 4) +
+                                  HexToNum(p[4]));
+                    p += 4;
+                }
+                break;
+        }
+        start = ++p;
+    }
+}
+
+// a real if it has a fraction or an exponent, otherwise an int64 or an uint64 which does not fit
+void CJsonReader::ReadNumber(Value &value) {
+    const char *start = p;
+    bool isReal       = false;
+    if (p != end && (*p == '-' || *p == '+'))
+        ++p;
+    const char *digits = p;
+    while (p != end && *p >= '0' && *p <= '9')
+        ++p;
+    if (p == digits)
+        Fail("invalid value");
+    if (p != end && *p == '.') {
+        isReal = true;
+        ++p;
+        while (p != end && *p >= '0' && *p <= '9')
+            ++p;
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        isReal = true;
+        ++p;
+        if (p != end && (*p == '-' || *p == '+'))
+            ++p;
+        const char *expDigits = p;
+        while (p != end && *p >= '0' && *p <= '9')
+            ++p;
+        if (p == expDigits)
+            Fail("invalid number");
+    }
+
+    if (isReal) {
+        std::string num(start, p);
+        value = strtod(num.c_str(), nullptr);
+        return;
+    }
+
+    const char *intBegin = (*start == '+') ? start + 1 : start;
+    int64_t num;
+    auto res = std::from_chars(intBegin, p, num);
+    if (res.ec == std::errc() && res.ptr == p) {
+        value = num;
+        return;
+    }
+    uint64_t unum;
+    res = std::from_chars(digits, p, unum);
+    if (*start != '-' && res.ec == std::errc() && res.ptr == p) {
+        value = unum;
+        return;
+    }
+    Fail("number out of range");
+}
+
+void CJsonReader::ReadLiteral(const char *literal) {
+    for (const char *l = literal; *l != 0; ++l, ++p) {
+        if (p == end || *p != *l)
+            Fail("invalid value");
+    }
+}
+
+void CJsonReader::ReadValue(Value &value) {
+    switch (PeekValue()) {
+        case '{': {
+            BeginObject();
+            value = Object();
+            Object &obj = value.get_obj();
+            std::string name;
+            while (NextMember(name)) {
+                obj.push_back(Pair(name, Value()));
+                ReadValue(obj.back().value_);
+            }
+            break;
+        }
+        case '[': {
+            BeginArray();
+            value = Array();
+            Array &arr = value.get_array();
+            while (NextItem()) {
+                arr.push_back(Value());
+                ReadValue(arr.back());
+            }
+            break;
+        }
+        case '"': {
+            std::string str;
+            ReadString(str);
+            value = str;
+            break;
+        }
+        case 't':
+            ReadLiteral("true");
+            value = true;
+            break;
+        case 'f':
+            ReadLiteral("false");
+            value = false;
+            break;
+        case 'n':
+            ReadLiteral("null");
+            value = Value::null;
+            break;
+        default:
+            ReadNumber(value);
+    }
+}
+
+void CJsonReader::SkipValue() {
+    switch (PeekValue()) {
+        case '{': {
+            BeginObject();
+            std::string name;
+            while (NextMember(name))
+                SkipValue();
+            break;
+        }
+        case '[':
+            BeginArray();
+            while (NextItem())
+                SkipValue();
+            break;
+        default: {
+            Value value;
+            ReadValue(value);
+        }
+    }
+}
+
+bool ReadJson(const std::string &str, Value &value) {
+    try {
+        CJsonReader reader(str);
+        reader.ReadValue(value);
+        return true;
+    } catch (const CJsonReader::Error &) {
+        return false;
+    }
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_JSONREADER_H
+#define COIN_JSONREADER_H
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "json_spirit_value.h"
+
+/**
+ * Pull parser for JSON text, a replacement of json_spirit::read_string for the RPC requests which
+ * does not go through boost::spirit. The containers are walked member by member, so the caller
+ * only builds values for the members it needs and skips the others, and ReadValue() builds a
+ * json_spirit value as read_string does, with the same number types and string escapes.
+ *
+ * A malformed text throws a CJsonReader::Error.
+ */
+class CJsonReader {
+public:
+    class Error : public std::runtime_error {
+    public:
+        explicit Error(const std::string &what) : std::runtime_error(what) {}
+    };
+
+    static const size_t MAX_DEPTH = 512;
+
+    CJsonReader(const char *beginIn, const char *endIn) : begin(beginIn), p(beginIn), end(endIn) {}
+    explicit CJsonReader(const std::string &str) : CJsonReader(str.data(), str.data() + str.size()) {}
+
+    // the first char of the next value, '{', '[', '"' or the first of a number or literal
+    char PeekValue();
+
+    void BeginObject();
+    // read the name of the next member and the colon, false at the end of the object
+    bool NextMember(std::string &name);
+    void BeginArray();
+    // false at the end of the array
+    bool NextItem();
+
+    void ReadValue(json_spirit::Value &value);
+    void ReadString(std::string &str);
+    void SkipValue();
+
+private:
+    void SkipSpaces();
+    void Expect(char c);
+    void ReadNumber(json_spirit::Value &value);
+    void ReadLiteral(const char *literal);
+    [[noreturn]] void Fail(const char *what) const;
+
+    const char *begin;
+    const char *p;
+    const char *end;
+    std::vector<bool> levels;  // whether each open object or array had items already
+};
+
+// read_string() with CJsonReader, false if the text is malformed
+bool ReadJson(const std::string &str, json_spirit::Value &value);
+
+#endif  // COIN_JSONREADER_H
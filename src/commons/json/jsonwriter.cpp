@@ -0,0 +1,179 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "jsonwriter.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <charconv>
+
+using namespace json_spirit;
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+void CJsonWriter::BeginItem() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (!levels.empty()) {
+        if (levels.back())
+            buf += ',';
+        else
+            levels.back() = true;
+    }
+}
+
+void CJsonWriter::BeginLevel(char c) {
+    BeginItem();
+    buf += c;
+    levels.push_back(false);
+}
+
+void CJsonWriter::EndLevel(char c) {
+    assert(!levels.empty() && !afterKey);
+    levels.pop_back();
+    buf += c;
+}
+
+void CJsonWriter::Key(const char *key, size_t len) {
+    assert(!levels.empty() && !afterKey);
+    BeginItem();
+    buf += '"';
+    AppendEscaped(key, len);
+    buf += "\":";
+    afterKey = true;
+}
+
+// the escapes of json_spirit in the C locale: the non printable chars, including all the ones
+// above 0x7E, are written as \u00XX
+void CJsonWriter::AppendEscaped(const char *str, size_t len) {
+    const char *begin = str;
+    const char *end   = str + len;
+    for (const char *p = str; p != end; ++p) {
+        uint8_t c = *p;
+        if (c >= 0x20 && c < 0x7F && c != '"' && c != '\\')
+            continue;
+
+        buf.append(begin, p - begin);
+        begin = p + 1;
+        switch (c) {
+            case '"':  buf += "\\\""; break;
+            case '\\': buf += "\\\\"; break;
+            case '\b': buf += "\\b";  break;
+            case '\f': buf += "\\f";  break;
+            case '\n': buf += "\\n";  break;
+            case '\r': buf += "\\r";  break;
+            case '\t': buf += "\\t";  break;
+            default: {
+                char esc[6] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0x0F]};
+                buf.append(esc, sizeof(esc));
+            }
+        }
+    }
+    buf.append(begin, end - begin);
+}
+
+void CJsonWriter::String(const char *str, size_t len) {
+    BeginItem();
+    buf += '"';
+    AppendEscaped(str, len);
+    buf += '"';
+}
+
+void CJsonWriter::Int(int64_t value) {
+    BeginItem();
+    char num[24];
+    auto res = std::to_chars(num, num + sizeof(num), value);
+    buf.append(num, res.ptr - num);
+}
+
+void CJsonWriter::Uint(uint64_t value) {
+    BeginItem();
+    char num[24];
+    auto res = std::to_chars(num, num + sizeof(num), value);
+    buf.append(num, res.ptr - num);
+}
+
+// std::fixed with the precision 8 as the json_spirit writer
+void CJsonWriter::Real(double value) {
+    BeginItem();
+    char num[512];
+    int len = snprintf(num, sizeof(num), "%.8f", value);
+    buf.append(num, len > 0 ? std::min<size_t>(len, sizeof(num) - 1) : 0);
+}
+
+void CJsonWriter::Bool(bool value) {
+    BeginItem();
+    buf += value ? "true" : "false";
+}
+
+void CJsonWriter::Null() {
+    BeginItem();
+    buf += "null";
+}
+
+void CJsonWriter::Raw(const std::string &json) {
+    BeginItem();
+    buf += json;
+}
+
+void CJsonWriter::WriteValue(const Value &value) {
+    switch (value.type()) {
+        case obj_type:
+            BeginObject();
+            for (const auto &member : value.get_obj()) {
+                Key(member.name_);
+                WriteValue(member.value_);
+            }
+            EndObject();
+            break;
+        case array_type:
+            BeginArray();
+            for (const auto &item : value.get_array())
+                WriteValue(item);
+            EndArray();
+            break;
+        case str_type:
+            String(value.get_str());
+            break;
+        case bool_type:
+            Bool(value.get_bool());
+            break;
+        case int_type:
+            if (value.is_uint64())
+                Uint(value.get_uint64());
+            else
+                Int(value.get_int64());
+            break;
+        case real_type:
+            Real(value.get_real());
+            break;
+        case null_type:
+            Null();
+            break;
+        default:
+            assert(false);
+    }
+}
+
+CJsonWriter::Mark CJsonWriter::GetMark() const {
+    return {buf.size(), levels.size(), !levels.empty() && levels.back(), afterKey};
+}
+
+void CJsonWriter::Rewind(const Mark &mark) {
+    assert(mark.size <= buf.size() && mark.depth <= levels.size());
+    buf.resize(mark.size);
+    levels.resize(mark.depth);
+    if (!levels.empty())
+        levels.back() = mark.hasItems;
+    afterKey = mark.afterKey;
+}
+
+CJsonWriter &CJsonWriter::ThreadLocal() {
+    static thread_local CJsonWriter writer;
+    return writer;
+}
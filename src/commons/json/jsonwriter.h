@@ -0,0 +1,96 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_JSONWRITER_H
+#define COIN_JSONWRITER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "json_spirit_value.h"
+
+/**
+ * Streaming JSON writer appending compact JSON text to a string buffer, the commas are inserted by
+ * the writer. It produces the same text as json_spirit::write_string(value, false) for the same
+ * content, so the hot RPCs can write their results into it directly instead of building a Value
+ * tree, and the others are written with WriteValue() without going through an ostringstream.
+ *
+ * The buffer keeps its capacity across Clear(), ThreadLocal() is the writer reused by the RPC
+ * replies of a thread.
+ */
+class CJsonWriter {
+public:
+    // the position to rewind to when a result written partially is replaced by an error
+    struct Mark {
+        size_t size;
+        size_t depth;
+        bool hasItems;
+        bool afterKey;
+    };
+
+    CJsonWriter() {}
+
+    void Clear() {
+        buf.clear();
+        levels.clear();
+        afterKey = false;
+    }
+    const std::string &GetString() const { return buf; }
+    size_t GetSize() const { return buf.size(); }
+
+    void BeginObject() { BeginLevel('{'); }
+    void EndObject() { EndLevel('}'); }
+    void BeginArray() { BeginLevel('['); }
+    void EndArray() { EndLevel(']'); }
+
+    void Key(const char *key, size_t len);
+    void Key(const char *key) { Key(key, strlen(key)); }
+    void Key(const std::string &key) { Key(key.data(), key.size()); }
+
+    void String(const char *str, size_t len);
+    void String(const char *str) { String(str, strlen(str)); }
+    void String(const std::string &str) { String(str.data(), str.size()); }
+    void Int(int64_t value);
+    void Uint(uint64_t value);
+    void Real(double value);
+    void Bool(bool value);
+    void Null();
+    // a json_spirit value, e.g. a part of a result still built as an Object
+    void WriteValue(const json_spirit::Value &value);
+    // text which is valid JSON already
+    void Raw(const std::string &json);
+    // the newline ending a reply, after the top level value
+    void EndLine() { buf += '\n'; }
+
+    // the members of objects
+    void Field(const char *key, const std::string &value) { Key(key); String(value); }
+    void Field(const char *key, const char *value) { Key(key); String(value); }
+    void Field(const char *key, int32_t value) { Key(key); Int(value); }
+    void Field(const char *key, int64_t value) { Key(key); Int(value); }
+    void Field(const char *key, uint32_t value) { Key(key); Uint(value); }
+    void Field(const char *key, uint64_t value) { Key(key); Uint(value); }
+    void Field(const char *key, double value) { Key(key); Real(value); }
+    void Field(const char *key, bool value) { Key(key); Bool(value); }
+
+    Mark GetMark() const;
+    void Rewind(const Mark &mark);
+
+    static CJsonWriter &ThreadLocal();
+
+private:
+    void BeginLevel(char c);
+    void EndLevel(char c);
+    // the comma before an item, nothing after a key
+    void BeginItem();
+    void AppendEscaped(const char *str, size_t len);
+
+    std::string buf;
+    std::vector<bool> levels;  // whether each open object or array has items already
+    bool afterKey = false;
+};
+
+#endif  // COIN_JSONWRITER_H
@@ -19,6 +19,7 @@ public:
     I value;
     static_assert(sizeof(I) == sizeof(UnsignedInt), "sizeof(I) == sizeof(UnsignedInt)");
     static const uint32_t SIZE = (sizeof(I) * 8 + 6) / 7;
+    static constexpr uint32_t FIXED_SERIALIZE_SIZE = SIZE;
 
     template<typename Stream>
     static inline unsigned int SerReadWrite(Stream& s, const I& v, int nType, int nVersion, CSerActionGetSerializeSize ser_action) {
@@ -7,101 +7,342 @@
 #ifndef COIN_MESSAGEQUEUE_H
 #define COIN_MESSAGEQUEUE_H
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
 constexpr std::chrono::milliseconds POP_DEFAULT_TIMEOUT{20};
 constexpr size_t MSG_QUEUE_DEFAULT_MAX_LEN = 10000;
 constexpr size_t MSG_QUEUE_MAX_LEN         = 60000;
 
+// the size of the cache lines the positions of the producers and of the consumers are kept apart by
+constexpr size_t MSG_QUEUE_CACHE_LINE_SIZE = 64;
+
+/**
+ * The threads waiting for a queue to change, an event count: a waiter reads the epoch, checks the queue
+ * again and sleeps only while the epoch is unchanged, a notifier bumps the epoch and wakes the waiters if
+ * there are any. On Linux the waiters sleep on a futex of the epoch, elsewhere on a condition variable.
+ */
+class CQueueWaiters final {
+public:
+    using Timeout = std::chrono::milliseconds;
+
+    // Begin a wait, the queue must be checked again before Wait() with the returned key
+    uint32_t PrepareWait() {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch.load(std::memory_order_seq_cst);
+    }
+
+    void CancelWait() { waiters.fetch_sub(1, std::memory_order_relaxed); }
+
+    // Sleep until notified after PrepareWait() or the timeout, ends the wait
+    void Wait(uint32_t key, const Timeout &timeout) {
+#ifdef __linux__
+        struct timespec ts;
+        ts.tv_sec  = timeout.count() / 1000;
+        ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&epoch), FUTEX_WAIT_PRIVATE, key, &ts, nullptr, 0);
+#else
+        std::unique_lock<std::mutex> lock(mtx);
+        cond.wait_for(lock, timeout, [&]() { return epoch.load(std::memory_order_relaxed) != key; });
+#endif
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Wake the waiters, called after the queue has changed
+    void Notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+#ifdef __linux__
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&epoch), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#else
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+        }
+        cond.notify_all();
+#endif
+    }
+
+private:
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "the futex is the epoch itself");
+
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> waiters{0};
+#ifndef __linux__
+    std::mutex mtx;
+    std::condition_variable cond;
+#endif
+};
+
+/**
+ * A bounded multi-producer multi-consumer queue on a ring of cells, lock free: each cell has a sequence
+ * telling whether it is free for the producer of a position or filled for its consumer, the producers and
+ * the consumers claim their positions with a CAS, so none of them waits for another one in the middle of a
+ * push or a pop. The capacity is the max length rounded up to a power of two.
+ * The Try* calls never block, Push() waits while the queue is full and Pop() while it is empty up to the
+ * timeout, both sleeping on CQueueWaiters. The batch calls claim a run of positions with one CAS.
+ */
 template <typename T>
 class MsgQueue final {
 public:
-    using SizeType = typename std::queue<T>::size_type;
+    using SizeType = size_t;
     using Timeout  = std::chrono::milliseconds;
 
 public:
-    MsgQueue(const SizeType maxLen = MSG_QUEUE_DEFAULT_MAX_LEN) : mqMaxLen(maxLen) {}
+    MsgQueue(const SizeType maxLen = MSG_QUEUE_DEFAULT_MAX_LEN);
+    ~MsgQueue();
+
+    MsgQueue(const MsgQueue &) = delete;
+    MsgQueue &operator=(const MsgQueue &) = delete;
 
 public:
-    bool Pop(T* t = nullptr, const Timeout& timeout = POP_DEFAULT_TIMEOUT);
-    void Push(const T& t);
-    void Push(T&& t);
+    bool Pop(T *t = nullptr, const Timeout &timeout = POP_DEFAULT_TIMEOUT);
+    void Push(const T &t);
+    void Push(T &&t);
+
+    bool TryPop(T *t = nullptr);
+    bool TryPush(T &&t);
+
+    // Move up to maxCount items into items, waiting up to the timeout while the queue is empty, return the count
+    SizeType PopBatch(std::vector<T> &items, SizeType maxCount, const Timeout &timeout = POP_DEFAULT_TIMEOUT);
+    // Move all the items into the queue in their order, waiting while it is full
+    void PushBatch(std::vector<T> &&items);
 
 public:
-    bool Empty();
-    bool Full();
-    SizeType Len();
+    bool Empty() const { return Len() == 0; }
+    bool Full() const { return Len() >= capacity; }
+    // the count of the items, exact only while no push or pop is in progress
+    SizeType Len() const;
+    SizeType Capacity() const { return capacity; }
 
 private:
-    std::queue<T> mq;
-    SizeType mqMaxLen;
-    std::condition_variable popCond;
-    std::condition_variable pushCond;
-    std::mutex mtx;
+    struct Cell {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T *Get() { return reinterpret_cast<T *>(&storage); }
+    };
+
+    static SizeType RoundUpCapacity(SizeType maxLen) {
+        SizeType capacity = 1;
+        while (capacity < maxLen)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    // claim up to maxCount positions of filled cells from the head, return the count claimed
+    SizeType ClaimPop(SizeType maxCount, size_t &pos);
+    // claim up to maxCount positions of free cells from the tail, return the count claimed
+    SizeType ClaimPush(SizeType maxCount, size_t &pos);
+
+    void Fill(size_t pos, T &&t) {
+        Cell &cell = cells[pos & mask];
+        new (cell.Get()) T(std::move(t));
+        cell.sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    void Drain(size_t pos, T *t) {
+        Cell &cell = cells[pos & mask];
+        if (t)
+            *t = std::move(*cell.Get());
+        cell.Get()->~T();
+        cell.sequence.store(pos + capacity, std::memory_order_release);
+    }
+
+    const SizeType capacity;
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(MSG_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> tail{0};  // the next position to push
+    alignas(MSG_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> head{0};  // the next position to pop
+    alignas(MSG_QUEUE_CACHE_LINE_SIZE) CQueueWaiters notEmpty;
+    CQueueWaiters notFull;
 };
 
 template <typename T>
-bool MsgQueue<T>::Pop(T* t, const Timeout& timeout) {
-    std::unique_lock<std::mutex> lock(mtx);
-
-    if (mq.empty()) {
-        // `wait_for' will return after popCond has been notified or
-        // specious wake-up happens or times out.
-        // so `Pop' may return before times out though popCond is not notified
-        popCond.wait_for(lock, timeout);
-    }
+MsgQueue<T>::MsgQueue(const SizeType maxLen)
+    : capacity(RoundUpCapacity(maxLen)), mask(capacity - 1), cells(new Cell[capacity]) {
+    for (size_t i = 0; i < capacity; i++)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+MsgQueue<T>::~MsgQueue() {
+    while (TryPop(nullptr)) {}
+}
 
-    if (!mq.empty()) {
-        if (mq.size() == mqMaxLen) {
-            pushCond.notify_all();
+template <typename T>
+typename MsgQueue<T>::SizeType MsgQueue<T>::ClaimPush(SizeType maxCount, size_t &pos) {
+    pos = tail.load(std::memory_order_relaxed);
+    while (true) {
+        // the free cells from the tail, a cell is free for the position when its sequence is the position
+        SizeType count = 0;
+        while (count < maxCount &&
+               cells[(pos + count) & mask].sequence.load(std::memory_order_acquire) == pos + count)
+            count++;
+        if (count == 0) {
+            size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+            if ((intptr_t)(seq - pos) < 0)
+                return 0;  // full, the cell still holds the item of the previous round
+            pos = tail.load(std::memory_order_relaxed);  // another producer took the position
+            continue;
         }
-        if (t) {
-            *t = std::move(mq.front());
+        if (tail.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+            return count;
+    }
+}
+
+template <typename T>
+typename MsgQueue<T>::SizeType MsgQueue<T>::ClaimPop(SizeType maxCount, size_t &pos) {
+    pos = head.load(std::memory_order_relaxed);
+    while (true) {
+        // the filled cells from the head, a cell is filled for the position when its sequence is the position + 1
+        SizeType count = 0;
+        while (count < maxCount &&
+               cells[(pos + count) & mask].sequence.load(std::memory_order_acquire) == pos + count + 1)
+            count++;
+        if (count == 0) {
+            size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+            if ((intptr_t)(seq - (pos + 1)) < 0)
+                return 0;  // empty
+            pos = head.load(std::memory_order_relaxed);  // another consumer took the position
+            continue;
         }
-        mq.pop();
-        return true;
+        if (head.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+            return count;
     }
+}
 
-    return false;
+template <typename T>
+bool MsgQueue<T>::TryPush(T &&t) {
+    size_t pos;
+    if (ClaimPush(1, pos) == 0)
+        return false;
+    Fill(pos, std::move(t));
+    notEmpty.Notify();
+    return true;
 }
 
 template <typename T>
-void MsgQueue<T>::Push(const T& t) {
-    Push(T(t));
+bool MsgQueue<T>::TryPop(T *t) {
+    size_t pos;
+    if (ClaimPop(1, pos) == 0)
+        return false;
+    Drain(pos, t);
+    notFull.Notify();
+    return true;
 }
 
 template <typename T>
-void MsgQueue<T>::Push(T&& t) {
-    std::unique_lock<std::mutex> lock(mtx);
+void MsgQueue<T>::Push(const T &t) {
+    Push(T(t));
+}
 
-    while (mq.size() == mqMaxLen) {
-        pushCond.wait(lock);
+template <typename T>
+void MsgQueue<T>::Push(T &&t) {
+    while (!TryPush(std::move(t))) {
+        uint32_t key = notFull.PrepareWait();
+        if (!Full()) {
+            notFull.CancelWait();
+            continue;
+        }
+        notFull.Wait(key, POP_DEFAULT_TIMEOUT);
     }
-    if (mq.empty()) {
-        popCond.notify_all();
+}
+
+template <typename T>
+bool MsgQueue<T>::Pop(T *t, const Timeout &timeout) {
+    if (TryPop(t))
+        return true;
+
+    // `Pop' may return before the timeout when woken up by a push another consumer took first
+    uint32_t key = notEmpty.PrepareWait();
+    if (TryPop(t)) {
+        notEmpty.CancelWait();
+        return true;
     }
-    mq.emplace(std::move(t));
+    notEmpty.Wait(key, timeout);
+    return TryPop(t);
 }
 
 template <typename T>
-bool MsgQueue<T>::Empty() {
-    std::unique_lock<std::mutex> lock(mtx);
-    return mq.empty();
+typename MsgQueue<T>::SizeType MsgQueue<T>::PopBatch(std::vector<T> &items, SizeType maxCount,
+                                                     const Timeout &timeout) {
+    if (maxCount == 0)
+        return 0;
+
+    size_t pos;
+    SizeType count = ClaimPop(maxCount, pos);
+    if (count == 0) {
+        uint32_t key = notEmpty.PrepareWait();
+        count = ClaimPop(maxCount, pos);
+        if (count > 0) {
+            notEmpty.CancelWait();
+        } else {
+            notEmpty.Wait(key, timeout);
+            count = ClaimPop(maxCount, pos);
+            if (count == 0)
+                return 0;
+        }
+    }
+
+    items.reserve(items.size() + count);
+    for (SizeType i = 0; i < count; i++) {
+        items.emplace_back();
+        Drain(pos + i, &items.back());
+    }
+    notFull.Notify();
+    return count;
 }
 
 template <typename T>
-bool MsgQueue<T>::Full() {
-    std::unique_lock<std::mutex> lock(mtx);
-    return mq.size() == mqMaxLen;
+void MsgQueue<T>::PushBatch(std::vector<T> &&items) {
+    SizeType done = 0;
+    while (done < items.size()) {
+        size_t pos;
+        SizeType count = ClaimPush(items.size() - done, pos);
+        if (count == 0) {
+            uint32_t key = notFull.PrepareWait();
+            if (!Full()) {
+                notFull.CancelWait();
+                continue;
+            }
+            notFull.Wait(key, POP_DEFAULT_TIMEOUT);
+            continue;
+        }
+        for (SizeType i = 0; i < count; i++)
+            Fill(pos + i, std::move(items[done + i]));
+        done += count;
+        notEmpty.Notify();
+    }
+    items.clear();
 }
 
 template <typename T>
-typename MsgQueue<T>::SizeType MsgQueue<T>::Len() {
-    std::unique_lock<std::mutex> lock(mtx);
-    return mq.size();
+typename MsgQueue<T>::SizeType MsgQueue<T>::Len() const {
+    size_t headPos = head.load(std::memory_order_acquire);
+    size_t tailPos = tail.load(std::memory_order_acquire);
+    return tailPos > headPos ? std::min<SizeType>(tailPos - headPos, capacity) : 0;
 }
 
-#endif  // COIN_MESSAGEQUEUE_H
\ No newline at end of file
+#endif  // COIN_MESSAGEQUEUE_H
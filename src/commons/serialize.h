@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <string>
 #include <string.h>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -30,7 +31,6 @@
 #include <boost/type_traits/is_fundamental.hpp>
 
 class CAutoFile;
-class CDataStream;
 class CBaseTx;
 class CProposal ;
 
@@ -954,17 +954,22 @@ inline void SerConvertValue(const SerializeType &value, OriginType &origin) {
     origin = OriginType(value);
 }
 
-typedef vector<char, zero_after_free_allocator<char> > CSerializeData;
+typedef vector<char> CSerializeData;
+// wiped on free, for the streams which may hold keys, i.e. the wallet db
+typedef vector<char, zero_after_free_allocator<char> > CSecureSerializeData;
 
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
  * Fills with data in linear time; some stringstream implementations take N^2 time.
+ *
+ * CDataStream frees its buffer as is, CSecureDataStream wipes it first.
  */
-class CDataStream
+template <typename SerializeType>
+class CBaseDataStream
 {
 protected:
-    typedef CSerializeData vector_type;
+    typedef SerializeType vector_type;
     vector_type vch;
     unsigned int nReadPos;
     short state;
@@ -973,48 +978,44 @@ public:
     int nType;
     int nVersion;
 
-    typedef vector_type::allocator_type   allocator_type;
-    typedef vector_type::size_type        size_type;
-    typedef vector_type::difference_type  difference_type;
-    typedef vector_type::reference        reference;
-    typedef vector_type::const_reference  const_reference;
-    typedef vector_type::value_type       value_type;
-    typedef vector_type::iterator         iterator;
-    typedef vector_type::const_iterator   const_iterator;
-    typedef vector_type::reverse_iterator reverse_iterator;
-
-    explicit CDataStream(int nTypeIn, int nVersionIn)
+    typedef typename vector_type::allocator_type   allocator_type;
+    typedef typename vector_type::size_type        size_type;
+    typedef typename vector_type::difference_type  difference_type;
+    typedef typename vector_type::reference        reference;
+    typedef typename vector_type::const_reference  const_reference;
+    typedef typename vector_type::value_type       value_type;
+    typedef typename vector_type::iterator         iterator;
+    typedef typename vector_type::const_iterator   const_iterator;
+    typedef typename vector_type::reverse_iterator reverse_iterator;
+
+    explicit CBaseDataStream(int nTypeIn, int nVersionIn)
     {
         Init(nTypeIn, nVersionIn);
     }
 
-    CDataStream(const_iterator pbegin, const_iterator pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
+    CBaseDataStream(const_iterator pbegin, const_iterator pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
     {
         Init(nTypeIn, nVersionIn);
     }
 
 #if !defined(_MSC_VER) || _MSC_VER >= 1300
-    CDataStream(const char* pbegin, const char* pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
+    CBaseDataStream(const char* pbegin, const char* pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
     {
         Init(nTypeIn, nVersionIn);
     }
 #endif
 
-    CDataStream(const vector_type& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
+    template <typename A>
+    CBaseDataStream(const vector<char, A>& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
     {
         Init(nTypeIn, nVersionIn);
     }
 
-    CDataStream(const vector<char>& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
-    {
+    CBaseDataStream(const string & str, int nTypeIn, int nVersionIn) : vch(str.begin(), str.end()) {
         Init(nTypeIn, nVersionIn);
     }
 
-    CDataStream(const string & str, int nTypeIn, int nVersionIn) : vch(str.begin(), str.end()) {
-        Init(nTypeIn, nVersionIn);
-    }
-
-    CDataStream(const vector<unsigned char>& vchIn, int nTypeIn, int nVersionIn) : vch((char*)&vchIn.begin()[0], (char*)&vchIn.end()[0])
+    CBaseDataStream(const vector<unsigned char>& vchIn, int nTypeIn, int nVersionIn) : vch((char*)&vchIn.begin()[0], (char*)&vchIn.end()[0])
     {
         Init(nTypeIn, nVersionIn);
     }
@@ -1028,15 +1029,15 @@ public:
         exceptmask = ios::badbit | ios::failbit;
     }
 
-    CDataStream& operator+=(const CDataStream& b)
+    CBaseDataStream& operator+=(const CBaseDataStream& b)
     {
         vch.insert(vch.end(), b.begin(), b.end());
         return *this;
     }
 
-    friend CDataStream operator+(const CDataStream& a, const CDataStream& b)
+    friend CBaseDataStream operator+(const CBaseDataStream& a, const CBaseDataStream& b)
     {
-        CDataStream ret = a;
+        CBaseDataStream ret = a;
         ret += b;
         return (ret);
     }
@@ -1061,6 +1062,8 @@ public:
     const_reference operator[](size_type pos) const  { return vch[pos + nReadPos]; }
     reference operator[](size_type pos)              { return vch[pos + nReadPos]; }
     void clear()                                     { vch.clear(); nReadPos = 0; }
+    void swap(vector_type& vchIn)                    { vch.swap(vchIn); nReadPos = 0; }
+    size_type capacity() const                       { return vch.capacity(); }
     iterator insert(iterator it, const char& x=char()) { return vch.insert(it, x); }
     void insert(iterator it, size_type n, const char& x) { vch.insert(it, n, x); }
 
@@ -1161,7 +1164,7 @@ public:
     void clear(short n)          { state = n; }  // name conflict with vector clear()
     short exceptions()           { return exceptmask; }
     short exceptions(short mask) { short prev = exceptmask; exceptmask = mask; setstate(0, "CDataStream"); return prev; }
-    CDataStream* rdbuf()         { return this; }
+    CBaseDataStream* rdbuf()     { return this; }
     int in_avail()               { return size(); }
 
     void SetType(int n)          { nType = n; }
@@ -1171,7 +1174,7 @@ public:
     void ReadVersion()           { *this >> nVersion; }
     void WriteVersion()          { *this << nVersion; }
 
-    CDataStream& read(char* pch, int nSize)
+    CBaseDataStream& read(char* pch, int nSize)
     {
         // Read from the beginning of the buffer
         assert(nSize >= 0);
@@ -1194,7 +1197,7 @@ public:
         return (*this);
     }
 
-    CDataStream& ignore(int nSize)
+    CBaseDataStream& ignore(int nSize)
     {
         // Ignore from the beginning of the buffer
         assert(nSize >= 0);
@@ -1211,7 +1214,7 @@ public:
         return (*this);
     }
 
-    CDataStream& write(const char* pch, int nSize)
+    CBaseDataStream& write(const char* pch, int nSize)
     {
         // Write to the end of the buffer
         assert(nSize >= 0);
@@ -1227,6 +1230,12 @@ public:
             s.write((char*)&vch[0], vch.size() * sizeof(vch[0]));
     }
 
+    // the size of the stream as serialized into another one, raw
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return size();
+    }
+
     template<typename T>
     unsigned int GetSerializeSize(const T& obj)
     {
@@ -1235,7 +1244,7 @@ public:
     }
 
     template<typename T>
-    CDataStream& operator<<(const T& obj)
+    CBaseDataStream& operator<<(const T& obj)
     {
         // Serialize to this stream
         ::Serialize(*this, obj, nType, nVersion);
@@ -1243,19 +1252,113 @@ public:
     }
 
     template<typename T>
-    CDataStream& operator>>(T& obj)
+    CBaseDataStream& operator>>(T& obj)
     {
         // Unserialize from this stream
         ::Unserialize(*this, obj, nType, nVersion);
         return (*this);
     }
 
-    void GetAndClear(CSerializeData &data) {
+    void GetAndClear(vector_type &data) {
         data.insert(data.end(), begin(), end());
         clear();
     }
 };
 
+typedef CBaseDataStream<CSerializeData> CDataStream;
+typedef CBaseDataStream<CSecureSerializeData> CSecureDataStream;
+
+/**
+ * The serialized size of every value of T if it is known at compile time, 0 otherwise. A class
+ * declares it by FIXED_SERIALIZE_SIZE, as the blobs and the fixed LEB128 ints of the db keys do,
+ * and the pairs and tuples of such types have the sum of their sizes.
+ */
+template <typename T, typename = void>
+struct CFixedSerializeSize {
+    static constexpr uint32_t value = 0;
+};
+
+template <typename T>
+struct CFixedSerializeSize<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static constexpr uint32_t value = sizeof(T);
+};
+
+template <typename T>
+struct CFixedSerializeSize<T, std::void_t<decltype(T::FIXED_SERIALIZE_SIZE)>> {
+    static constexpr uint32_t value = T::FIXED_SERIALIZE_SIZE;
+};
+
+template <typename... Ts>
+struct CFixedSerializeSize<std::tuple<Ts...>> {
+    static constexpr bool fixed     = ((CFixedSerializeSize<Ts>::value > 0) && ...);
+    static constexpr uint32_t value = fixed ? (CFixedSerializeSize<Ts>::value + ... + 0) : 0;
+};
+
+template <typename K, typename T>
+struct CFixedSerializeSize<std::pair<K, T>> : CFixedSerializeSize<std::tuple<K, T>> {};
+
+/** Stream appending the serialized data to a string, e.g. a db key built in its own buffer */
+class CStringWriter {
+private:
+    std::string &str;
+
+public:
+    int nType;
+    int nVersion;
+
+    CStringWriter(std::string &strIn, int nTypeIn, int nVersionIn) : str(strIn), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    CStringWriter& write(const char* pch, size_t nSize) {
+        str.append(pch, nSize);
+        return (*this);
+    }
+
+    template<typename T>
+    CStringWriter& operator<<(const T& obj) {
+        ::Serialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/** Stream reading the serialized data in place from a buffer it does not own, e.g. a db key */
+class CSpanReader {
+private:
+    const char *pBegin;
+    const char *pEnd;
+
+public:
+    int nType;
+    int nVersion;
+
+    CSpanReader(const char* pBeginIn, const char* pEndIn, int nTypeIn, int nVersionIn)
+        : pBegin(pBeginIn), pEnd(pEndIn), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    const char* data() const { return pBegin; }
+    size_t size() const { return pEnd - pBegin; }
+    bool empty() const { return pBegin == pEnd; }
+
+    CSpanReader& read(char* pch, size_t nSize) {
+        if (nSize > size())
+            throw ios_base::failure("CSpanReader::read() : end of data");
+        memcpy(pch, pBegin, nSize);
+        pBegin += nSize;
+        return (*this);
+    }
+
+    CSpanReader& ignore(size_t nSize) {
+        if (nSize > size())
+            throw ios_base::failure("CSpanReader::ignore() : end of data");
+        pBegin += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CSpanReader& operator>>(T& obj) {
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 
 
 /** RAII wrapper for FILE*.
@@ -5,9 +5,14 @@
 
 #include "uint256.h"
 
+#include "crypto/siphash.h"
+#include "random.h"
+
 #include <stdio.h>
 #include <string.h>
 
+#include <limits>
+
 template <unsigned int BITS>
 base_blob<BITS>::base_blob(const std::vector<unsigned char>& vch)
 {
@@ -18,10 +23,13 @@ base_blob<BITS>::base_blob(const std::vector<unsigned char>& vch)
 template <unsigned int BITS>
 std::string base_blob<BITS>::GetHex() const
 {
-    char psz[sizeof(data) * 2 + 1];
+    // the hex of a blob is in the byte order reversed
+    unsigned char reversed[sizeof(data)];
     for (unsigned int i = 0; i < sizeof(data); i++)
-        sprintf(psz + i * 2, "%02x", data[sizeof(data) - i - 1]);
-    return std::string(psz, psz + sizeof(data) * 2);
+        reversed[i] = data[sizeof(data) - i - 1];
+    std::string str(sizeof(data) * 2, '\0');
+    HexEncode(reversed, sizeof(data), &str[0]);
+    return str;
 }
 
 template <unsigned int BITS>
@@ -142,3 +150,14 @@ uint64_t uint256::GetHash(const uint256& salt) const
 
     return ((((uint64_t)b) << 32) | c);
 }
+
+CSaltedUint256Hasher::CSaltedUint256Hasher() {
+    static const uint64_t salt0 = GetRand(std::numeric_limits<uint64_t>::max());
+    static const uint64_t salt1 = GetRand(std::numeric_limits<uint64_t>::max());
+    k0 = salt0;
+    k1 = salt1;
+}
+
+size_t CSaltedUint256Hasher::operator()(const uint256& key) const {
+    return SipHashUint256(k0, k1, key);
+}
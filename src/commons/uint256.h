@@ -20,11 +20,15 @@ extern const signed char p_util_hexdigit[256];  // defined in util.cpp
 
 inline signed char HexDigit(char c) { return p_util_hexdigit[(unsigned char)c]; }
 
+// write the 2 * len lowercase hex digits of the bytes to out, 16 bytes per step with SSE2
+void HexEncode(const unsigned char* pch, size_t len, char* out);
+
 /** Template base class for fixed-sized opaque blobs. */
 template <unsigned int BITS>
 class base_blob {
 public:
     enum { WIDTH = BITS / 8 };
+    static constexpr uint32_t FIXED_SERIALIZE_SIZE = WIDTH;
 protected:
     uint8_t data[WIDTH];
 
@@ -143,6 +147,14 @@ public:
         return result;
     }
 
+    /** The 64 bits at the position pos (0..3) in little endian, as the siphash key and input words. */
+    uint64_t GetUint64(int pos) const {
+        const uint8_t* ptr = data + pos * 8;
+        return ((uint64_t)ptr[0]) | ((uint64_t)ptr[1]) << 8 | ((uint64_t)ptr[2]) << 16 | ((uint64_t)ptr[3]) << 24 |
+               ((uint64_t)ptr[4]) << 32 | ((uint64_t)ptr[5]) << 40 | ((uint64_t)ptr[6]) << 48 |
+               ((uint64_t)ptr[7]) << 56;
+    }
+
     /** A more secure, salted hash function.
      * @note This hash is not stable between little and big endian.
      */
@@ -176,12 +188,27 @@ inline uint256 uint256S(const char* str) {
  */
 inline uint256 uint256S(const std::string& str) { return uint256S(str.c_str()); }
 
+/** The leading bytes of the hash, only for the keys a peer can not choose cheaply, e.g. the indexed blocks */
 class CUint256Hasher {
 public:
     size_t operator()(const uint256& key) const { return key.GetCheapHash(); }
 };
 
-typedef std::unordered_set<uint256, CUint256Hasher> UnorderedHashSet;
+/**
+ * SipHash-2-4 of the hash with a salt random per process, for the containers keyed by the hashes
+ * a peer controls, e.g. the txids and the signature cache entries, so it can not fill one bucket.
+ */
+class CSaltedUint256Hasher {
+private:
+    uint64_t k0;
+    uint64_t k1;
+
+public:
+    CSaltedUint256Hasher();
+    size_t operator()(const uint256& key) const;
+};
+
+typedef std::unordered_set<uint256, CSaltedUint256Hasher> UnorderedHashSet;
 
 typedef uint256 TxID;
 
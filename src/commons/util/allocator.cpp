@@ -0,0 +1,122 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/coin-config.h"
+#endif
+
+#include "allocator.h"
+
+#include "commons/tinyformat.h"
+#include "config/chainparams.h"
+#include "config/const.h"
+#include "logging.h"
+
+#include <cerrno>
+#include <fstream>
+
+#if defined(USE_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#elif defined(USE_TCMALLOC)
+#include <gperftools/malloc_extension.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const char *GetAllocatorName() {
+#if defined(USE_JEMALLOC)
+    return "jemalloc";
+#elif defined(USE_TCMALLOC)
+    return "tcmalloc";
+#else
+    return "system";
+#endif
+}
+
+vector<pair<string, uint64_t>> GetAllocatorStats() {
+    vector<pair<string, uint64_t>> stats;
+#if defined(USE_JEMALLOC)
+    // the stats are a snapshot taken when the epoch is advanced
+    uint64_t epoch = 1;
+    size_t epochLen = sizeof(epoch);
+    mallctl("epoch", &epoch, &epochLen, &epoch, epochLen);
+    for (const char *name : {"allocated", "active", "metadata", "resident", "mapped", "retained"}) {
+        size_t value = 0;
+        size_t valueLen = sizeof(value);
+        if (mallctl(strprintf("stats.%s", name).c_str(), &value, &valueLen, nullptr, 0) == 0)
+            stats.emplace_back(name, value);
+    }
+#elif defined(USE_TCMALLOC)
+    const pair<const char *, const char *> properties[] = {
+        {"allocated",   "generic.current_allocated_bytes"},
+        {"heap",        "generic.heap_size"},
+        {"free",        "tcmalloc.pageheap_free_bytes"},
+        {"unmapped",    "tcmalloc.pageheap_unmapped_bytes"},
+        {"thread_cache","tcmalloc.current_total_thread_cache_bytes"},
+    };
+    for (const auto &property : properties) {
+        size_t value = 0;
+        if (MallocExtension::instance()->GetNumericProperty(property.second, &value))
+            stats.emplace_back(property.first, value);
+    }
+#elif defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+#else
+    struct mallinfo info = mallinfo();
+#endif
+    stats.emplace_back("allocated", (uint64_t)info.uordblks + (uint64_t)info.hblkhd);
+    stats.emplace_back("arena",     (uint64_t)info.arena);
+    stats.emplace_back("mmapped",   (uint64_t)info.hblkhd);
+    stats.emplace_back("free",      (uint64_t)info.fordblks);
+    stats.emplace_back("trimmable", (uint64_t)info.keepcost);
+#endif
+    return stats;
+}
+
+uint64_t GetResidentBytes() {
+#ifdef __linux__
+    // the second field of statm is the resident pages
+    ifstream file("/proc/self/statm");
+    uint64_t sizePages = 0, residentPages = 0;
+    if (file >> sizePages >> residentPages)
+        return residentPages * (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+bool ReleaseFreeMemory() {
+#if defined(USE_JEMALLOC)
+    return mallctl(strprintf("arena.%u.purge", MALLCTL_ARENAS_ALL).c_str(), nullptr, nullptr, nullptr, 0) == 0;
+#elif defined(USE_TCMALLOC)
+    MallocExtension::instance()->ReleaseFreeMemory();
+    return true;
+#elif defined(__GLIBC__)
+    malloc_trim(0);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool IsHugePagesEnabled() {
+    static const bool fEnabled = SysCfg().GetBoolArg("-hugepages", DEFAULT_HUGE_PAGES);
+    return fEnabled;
+}
+
+void AdviseHugePages(void *pAddr, size_t len) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (!IsHugePagesEnabled())
+        return;
+    if (madvise(pAddr, len, MADV_HUGEPAGE) != 0)
+        LogPrint(BCLog::ERROR, "AdviseHugePages() : madvise of %u bytes failed, errno=%d\n", len, errno);
+#endif
+}
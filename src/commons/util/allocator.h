@@ -0,0 +1,40 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COMMONS_UTIL_ALLOCATOR_H
+#define COMMONS_UTIL_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The malloc the node is linked with, chosen by ./configure --with-allocator=system|jemalloc|tcmalloc.
+ * The allocators of jemalloc and tcmalloc keep the fragmentation of the long lived caches low, the stats
+ * of each are read with its own API and reported by getmemoryinfo.
+ */
+
+// "system", "jemalloc" or "tcmalloc"
+const char *GetAllocatorName();
+
+// The stats of the allocator by name in bytes, e.g. allocated, active and resident for jemalloc
+std::vector<std::pair<std::string, uint64_t>> GetAllocatorStats();
+
+// The resident set size of the process, 0 if unknown
+uint64_t GetResidentBytes();
+
+// Give the free pages held by the allocator back to the OS, false if the allocator can not
+bool ReleaseFreeMemory();
+
+// Whether -hugepages is set to back the large regions with transparent huge pages
+bool IsHugePagesEnabled();
+
+// Advise the kernel to back the region with transparent huge pages if -hugepages is set, the region is
+// expected to be aligned to the system pages
+void AdviseHugePages(void *pAddr, size_t len);
+
+#endif  // COMMONS_UTIL_ALLOCATOR_H
@@ -0,0 +1,173 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "iouring.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+
+namespace {
+
+int SysIoUringSetup(uint32_t entries, struct io_uring_params *pParams) {
+    return (int)syscall(__NR_io_uring_setup, entries, pParams);
+}
+
+int SysIoUringEnter(int ringFd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags) {
+    return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+uint32_t *RingField(void *pRing, uint32_t offset) { return (uint32_t *)((char *)pRing + offset); }
+
+}  // namespace
+
+CIoUring::~CIoUring() {
+    if (pSqes != nullptr)
+        munmap(pSqes, sqesSize);
+    if (pCqRing != nullptr && pCqRing != pSqRing)
+        munmap(pCqRing, cqRingSize);
+    if (pSqRing != nullptr)
+        munmap(pSqRing, sqRingSize);
+    if (ringFd >= 0)
+        close(ringFd);
+}
+
+bool CIoUring::Init(uint32_t entries) {
+    if (ringFd >= 0)
+        return true;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = SysIoUringSetup(entries, &params);
+    if (fd < 0)
+        return false;
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool fSingleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (fSingleMmap)
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+    void *pSq = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (pSq == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    void *pCq = pSq;
+    if (!fSingleMmap) {
+        pCq = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (pCq == MAP_FAILED) {
+            munmap(pSq, sqRingSize);
+            close(fd);
+            return false;
+        }
+    }
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *pEntries = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (pEntries == MAP_FAILED) {
+        if (pCq != pSq)
+            munmap(pCq, cqRingSize);
+        munmap(pSq, sqRingSize);
+        close(fd);
+        return false;
+    }
+
+    ringFd    = fd;
+    pSqRing   = pSq;
+    pCqRing   = pCq;
+    pSqes     = pEntries;
+    pSqHead   = RingField(pSq, params.sq_off.head);
+    pSqTail   = RingField(pSq, params.sq_off.tail);
+    pSqArray  = RingField(pSq, params.sq_off.array);
+    sqMask    = *RingField(pSq, params.sq_off.ring_mask);
+    sqEntries = params.sq_entries;
+    pCqHead   = RingField(pCq, params.cq_off.head);
+    pCqTail   = RingField(pCq, params.cq_off.tail);
+    pCqes     = (char *)pCq + params.cq_off.cqes;
+    cqMask    = *RingField(pCq, params.cq_off.ring_mask);
+    return true;
+}
+
+bool CIoUring::SubmitWrite(int fd, const void *buf, uint32_t len, uint64_t offset, uint64_t userData) {
+    // the completion queue is twice the submission queue, a full submission queue bounds both
+    if (ringFd < 0 || inFlight >= sqEntries)
+        return false;
+
+    uint32_t tail = *pSqTail;
+    uint32_t index = tail & sqMask;
+    struct io_uring_sqe *pSqe = (struct io_uring_sqe *)pSqes + index;
+    memset(pSqe, 0, sizeof(*pSqe));
+    pSqe->opcode    = IORING_OP_WRITE;
+    pSqe->fd        = fd;
+    pSqe->addr      = (uint64_t)(uintptr_t)buf;
+    pSqe->len       = len;
+    pSqe->off       = offset;
+    pSqe->user_data = userData;
+    pSqArray[index] = index;
+    __atomic_store_n(pSqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int ret;
+    do {
+        ret = SysIoUringEnter(ringFd, 1, 0, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        // the kernel did not take the entry, it is withdrawn
+        __atomic_store_n(pSqTail, tail, __ATOMIC_RELEASE);
+        return false;
+    }
+    inFlight++;
+    return true;
+}
+
+uint32_t CIoUring::Reap(uint32_t minComplete, const std::function<void(uint64_t, int32_t)> &onComplete) {
+    uint32_t count = 0;
+    while (true) {
+        uint32_t head = *pCqHead;
+        uint32_t tail = __atomic_load_n(pCqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++, count++) {
+            const struct io_uring_cqe *pCqe = (const struct io_uring_cqe *)pCqes + (head & cqMask);
+            uint64_t userData = pCqe->user_data;
+            int32_t res = pCqe->res;
+            __atomic_store_n(pCqHead, head + 1, __ATOMIC_RELEASE);
+            inFlight--;
+            onComplete(userData, res);
+        }
+        if (count >= minComplete || inFlight == 0)
+            return count;
+
+        if (SysIoUringEnter(ringFd, 0, minComplete - count, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            return count;
+    }
+}
+
+#else  // HAVE_IO_URING
+
+CIoUring::~CIoUring() {}
+
+bool CIoUring::Init(uint32_t entries) { return false; }
+
+bool CIoUring::SubmitWrite(int fd, const void *buf, uint32_t len, uint64_t offset, uint64_t userData) {
+    return false;
+}
+
+uint32_t CIoUring::Reap(uint32_t minComplete, const std::function<void(uint64_t, int32_t)> &onComplete) {
+    return 0;
+}
+
+#endif  // HAVE_IO_URING
@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COMMONS_UTIL_IOURING_H
+#define COMMONS_UTIL_IOURING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+/**
+ * A minimal io_uring of one submitter, driven by the raw syscalls so the node needs no liburing. Only the
+ * writes at an offset are submitted, e.g. the appends of the blk and rev files, each with the user data
+ * identifying it in its completion. The ring is not thread safe, the owner serializes the calls.
+ * On other platforms and on kernels without io_uring Init() fails and the caller writes synchronously.
+ */
+class CIoUring {
+public:
+    CIoUring() {}
+    ~CIoUring();
+
+    CIoUring(const CIoUring &) = delete;
+    CIoUring &operator=(const CIoUring &) = delete;
+
+    // Set up a ring of the entries, false if io_uring is not available or not permitted, e.g. by seccomp
+    bool Init(uint32_t entries);
+    bool IsInitialized() const { return ringFd >= 0; }
+
+    // Submit a write of len bytes of buf at offset of fd, the buffer must live until its completion.
+    // Return false if the submission queue is full, the caller reaps completions first.
+    bool SubmitWrite(int fd, const void *buf, uint32_t len, uint64_t offset, uint64_t userData);
+
+    // Wait for at least minComplete completions and pass each to onComplete with the user data of the
+    // write and its result, the bytes written or -errno. Return the number of the completions.
+    uint32_t Reap(uint32_t minComplete, const std::function<void(uint64_t, int32_t)> &onComplete);
+
+    // The writes submitted and not yet reaped
+    uint32_t GetInFlight() const { return inFlight; }
+
+private:
+    int ringFd = -1;
+    uint32_t inFlight = 0;
+
+    void *pSqRing = nullptr;
+    void *pCqRing = nullptr;
+    void *pSqes   = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize   = 0;
+
+    uint32_t *pSqHead  = nullptr;
+    uint32_t *pSqTail  = nullptr;
+    uint32_t *pSqArray = nullptr;
+    uint32_t sqMask    = 0;
+    uint32_t sqEntries = 0;
+    uint32_t *pCqHead  = nullptr;
+    uint32_t *pCqTail  = nullptr;
+    void *pCqes        = nullptr;
+    uint32_t cqMask    = 0;
+};
+
+#endif  // COMMONS_UTIL_IOURING_H
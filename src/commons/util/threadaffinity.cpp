@@ -0,0 +1,252 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "threadaffinity.h"
+
+#include "commons/tinyformat.h"
+#include "commons/util/util.h"
+#include "logging.h"
+
+#include <cassert>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const char *const kThreadPoolNames[THREAD_POOL_COUNT] = {"none", "validation", "net", "rpc", "db", "tasks"};
+
+// the pools of the names given to RenameThread(), the names of TraceThread() and LoopForever() are prefixed
+const struct {
+    const char *name;
+    ThreadPoolType pool;
+} kNamedThreads[] = {
+    {"coin-sigcheck",       THREAD_POOL_VALIDATION},
+    {"coin-loadblk",        THREAD_POOL_VALIDATION},
+    {"coin-importscan",     THREAD_POOL_VALIDATION},
+    {"coin-importparse",    THREAD_POOL_VALIDATION},
+    {"coin-txadmission",    THREAD_POOL_VALIDATION},
+    {"coin-pbft",           THREAD_POOL_VALIDATION},
+    {"Coin-miner",          THREAD_POOL_VALIDATION},
+    {"coin-net",            THREAD_POOL_NET},
+    {"coin-msghand",        THREAD_POOL_NET},
+    {"coin-pbfthand",       THREAD_POOL_NET},
+    {"coin-opencon",        THREAD_POOL_NET},
+    {"coin-addcon",         THREAD_POOL_NET},
+    {"coin-prioritycon",    THREAD_POOL_NET},
+    {"coin-dnsseed",        THREAD_POOL_NET},
+    {"coin-ext-ip",         THREAD_POOL_NET},
+    {"coin-post-ip",        THREAD_POOL_NET},
+    {"coin-upnp",           THREAD_POOL_NET},
+    {"coin-dumpaddr",       THREAD_POOL_NET},
+    {"bitcoin-http",        THREAD_POOL_RPC},
+    {"bitcoin-httpworker",  THREAD_POOL_RPC},
+    {"coin-dbflush",        THREAD_POOL_DB},
+    {"coin-statediff",      THREAD_POOL_DB},
+    {"coin-checkstate",     THREAD_POOL_DB},
+    {"coin-tasks",          THREAD_POOL_TASKS},
+};
+
+// a thread in a pool, removed with the thread local of its thread
+struct CPoolMember {
+    ThreadPoolType pool = THREAD_POOL_NONE;
+#ifdef __linux__
+    clockid_t clockId;
+#endif
+
+    ~CPoolMember();
+};
+
+struct CPoolState {
+    set<CPoolMember *> members;
+    uint64_t exitedCpuMicros = 0;  // the cpu time of the threads which left the pool
+};
+
+std::mutex poolsMutex;
+CPoolState poolStates[THREAD_POOL_COUNT];
+vector<int32_t> poolCpus[THREAD_POOL_COUNT];  // written by InitThreadAffinity() before the threads start
+
+thread_local CPoolMember currentMember;
+
+#ifdef __linux__
+uint64_t GetCpuMicros(clockid_t clockId) {
+    struct timespec ts;
+    if (clock_gettime(clockId, &ts) != 0)
+        return 0;
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+// the current thread leaves its pool, poolsMutex held
+void LeavePool(CPoolMember &member) {
+    if (member.pool == THREAD_POOL_NONE)
+        return;
+    CPoolState &state = poolStates[member.pool];
+    state.members.erase(&member);
+#ifdef __linux__
+    state.exitedCpuMicros += GetCpuMicros(member.clockId);
+#endif
+    member.pool = THREAD_POOL_NONE;
+}
+
+CPoolMember::~CPoolMember() {
+    std::lock_guard<std::mutex> lock(poolsMutex);
+    LeavePool(*this);
+}
+
+bool ParseCpu(const string &str, int32_t &cpu) {
+    return ParseInt32(str, &cpu) && cpu >= 0
+#ifdef __linux__
+        && cpu < CPU_SETSIZE
+#endif
+        ;
+}
+
+// "3", "0-15" or a list of them separated by commas as in /sys/devices/system/node/node<n>/cpulist
+bool ParseCpuList(const string &str, vector<int32_t> &cpus) {
+    size_t begin = 0;
+    while (begin <= str.size()) {
+        size_t end = str.find(',', begin);
+        if (end == string::npos)
+            end = str.size();
+        string item = str.substr(begin, end - begin);
+        size_t dash = item.find('-');
+        int32_t first, last;
+        if (dash == string::npos) {
+            if (!ParseCpu(item, first))
+                return false;
+            last = first;
+        } else if (!ParseCpu(item.substr(0, dash), first) || !ParseCpu(item.substr(dash + 1), last) ||
+                   last < first) {
+            return false;
+        }
+        for (int32_t cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+        begin = end + 1;
+    }
+    return true;
+}
+
+bool ReadNumaNodeCpus(int32_t node, vector<int32_t> &cpus) {
+    std::ifstream file(strprintf("/sys/devices/system/node/node%d/cpulist", node));
+    string line;
+    if (!file.good() || !std::getline(file, line))
+        return false;
+    line.erase(line.find_last_not_of(" \n\r\t") + 1);
+    return !line.empty() && ParseCpuList(line, cpus);
+}
+
+}  // namespace
+
+const char *GetThreadPoolName(ThreadPoolType pool) {
+    assert(pool < THREAD_POOL_COUNT);
+    return kThreadPoolNames[pool];
+}
+
+bool InitThreadAffinity(const string &spec, string &error) {
+    if (spec.empty())
+        return true;
+#ifndef __linux__
+    error = "-cpuaffinity is only supported on Linux";
+    return false;
+#else
+    vector<int32_t> cpus[THREAD_POOL_COUNT];
+    size_t begin = 0;
+    while (begin <= spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == string::npos)
+            end = spec.size();
+        string item = spec.substr(begin, end - begin);
+        begin = end + 1;
+
+        size_t colon = item.find(':');
+        string poolName = item.substr(0, colon);
+        string cpuStr = colon == string::npos ? "" : item.substr(colon + 1);
+        int32_t pool = 1;
+        while (pool < THREAD_POOL_COUNT && poolName != kThreadPoolNames[pool])
+            pool++;
+        if (pool == THREAD_POOL_COUNT) {
+            error = strprintf("unknown thread pool '%s' in -cpuaffinity, expected validation, net, rpc, db or tasks",
+                              poolName);
+            return false;
+        }
+
+        int32_t node;
+        if (cpuStr.compare(0, 4, "node") == 0) {
+            if (!ParseInt32(cpuStr.substr(4), &node) || !ReadNumaNodeCpus(node, cpus[pool])) {
+                error = strprintf("unknown NUMA node '%s' in -cpuaffinity", cpuStr);
+                return false;
+            }
+        } else if (!ParseCpuList(cpuStr, cpus[pool])) {
+            error = strprintf("invalid cpus '%s' of the pool %s in -cpuaffinity", cpuStr, poolName);
+            return false;
+        }
+    }
+
+    for (int32_t pool = 0; pool < THREAD_POOL_COUNT; pool++)
+        poolCpus[pool] = cpus[pool];
+    return true;
+#endif
+}
+
+void SetThreadPool(ThreadPoolType pool) {
+    assert(pool < THREAD_POOL_COUNT);
+    {
+        std::lock_guard<std::mutex> lock(poolsMutex);
+        LeavePool(currentMember);
+        bool fJoin = pool != THREAD_POOL_NONE;
+#ifdef __linux__
+        // the clock of the thread is read by the metrics from other threads
+        fJoin = fJoin && pthread_getcpuclockid(pthread_self(), &currentMember.clockId) == 0;
+#endif
+        if (fJoin) {
+            currentMember.pool = pool;
+            poolStates[pool].members.insert(&currentMember);
+        }
+    }
+
+#ifdef __linux__
+    if (pool == THREAD_POOL_NONE || poolCpus[pool].empty())
+        return;
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int32_t cpu : poolCpus[pool])
+        CPU_SET(cpu, &cpuSet);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (ret != 0)
+        LogPrint(BCLog::ERROR, "failed to bind a thread of the pool %s to its cpus, error=%d\n",
+                 GetThreadPoolName(pool), ret);
+#endif
+}
+
+ThreadPoolType GetThreadPoolByName(const string &name) {
+    for (const auto &item : kNamedThreads) {
+        if (name == item.name)
+            return item.pool;
+    }
+    return THREAD_POOL_NONE;
+}
+
+CThreadPoolStats GetThreadPoolStats(ThreadPoolType pool) {
+    assert(pool < THREAD_POOL_COUNT);
+    CThreadPoolStats stats;
+    std::lock_guard<std::mutex> lock(poolsMutex);
+    const CPoolState &state = poolStates[pool];
+    stats.threads   = state.members.size();
+    stats.cpuMicros = state.exitedCpuMicros;
+#ifdef __linux__
+    for (const CPoolMember *pMember : state.members)
+        stats.cpuMicros += GetCpuMicros(pMember->clockId);
+#endif
+    return stats;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COMMONS_UTIL_THREADAFFINITY_H
+#define COMMONS_UTIL_THREADAFFINITY_H
+
+#include <stdint.h>
+
+#include <string>
+
+/**
+ * The pools of the threads of the node, bound to the cpus given to each by -cpuaffinity. The named threads
+ * join the pool of their name when RenameThread() is called, the unnamed workers of the validation and the
+ * db join theirs with SetThreadPool(). The workers of the shared task scheduler are the tasks pool. The cpu time of the threads is summed up by pool for the metrics.
+ */
+enum ThreadPoolType : uint8_t {
+    THREAD_POOL_NONE = 0,
+    THREAD_POOL_VALIDATION,
+    THREAD_POOL_NET,
+    THREAD_POOL_RPC,
+    THREAD_POOL_DB,
+    THREAD_POOL_TASKS,
+    THREAD_POOL_COUNT
+};
+
+const char *GetThreadPoolName(ThreadPoolType pool);
+
+// Parse -cpuaffinity, e.g. "validation:0-15,net:16-19,rpc:node1", where the cpus of a pool are a cpu, a
+// range of cpus or all the cpus of a NUMA node and are added up over the items of the pool. Return false
+// with the error if the spec is invalid or not supported by the platform.
+bool InitThreadAffinity(const std::string &spec, std::string &error);
+
+// Move the current thread into the pool and bind it to the cpus of the pool if it has any
+void SetThreadPool(ThreadPoolType pool);
+
+// The pool of a thread name given to RenameThread(), THREAD_POOL_NONE for the names of no pool
+ThreadPoolType GetThreadPoolByName(const std::string &name);
+
+struct CThreadPoolStats {
+    uint32_t threads   = 0;  // the threads in the pool now
+    uint64_t cpuMicros = 0;  // the cpu time of all the threads which were in the pool
+};
+
+CThreadPoolStats GetThreadPoolStats(ThreadPoolType pool);
+
+#endif  // COMMONS_UTIL_THREADAFFINITY_H
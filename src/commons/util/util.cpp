@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "./util.h"
+#include "./threadaffinity.h"
 #include "commons/uint256.h"
 #include "logging.h"
 #include "config/chainparams.h"
@@ -71,6 +72,11 @@
 #include <boost/filesystem/fstream.hpp>
 #include <boost/program_options/detail/config_file.hpp>
 #include <boost/program_options/parsers.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // Work around clang compilation problem in Boost 1.46:
 // /usr/include/boost/program_options/detail/config_file.hpp:163:17: error: call to function
 // 'to_internal' that is neither visible in the template definition nor found by argument-dependent
@@ -214,20 +220,91 @@ bool IsHex(const string& str) {
     return (str.size() > 0) && (str.size() % 2 == 0);
 }
 
+void HexEncode(const unsigned char* pch, size_t len, char* out) {
+    static const char hexmap[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i mask  = _mm_set1_epi8(0x0f);
+    const __m128i nine  = _mm_set1_epi8(9);
+    const __m128i digit = _mm_set1_epi8('0');
+    const __m128i alpha = _mm_set1_epi8('a' - '0' - 10);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v  = _mm_loadu_si128((const __m128i*)(pch + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        __m128i lo = _mm_and_si128(v, mask);
+        // the nibble plus '0', plus the gap to 'a' above 9
+        hi = _mm_add_epi8(_mm_add_epi8(hi, digit), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), alpha));
+        lo = _mm_add_epi8(_mm_add_epi8(lo, digit), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), alpha));
+        _mm_storeu_si128((__m128i*)(out + i * 2), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(out + i * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#endif
+    for (; i < len; i++) {
+        out[i * 2]     = hexmap[pch[i] >> 4];
+        out[i * 2 + 1] = hexmap[pch[i] & 15];
+    }
+}
+
+#if defined(__SSE2__)
+// decode the 32 hex digits at psz into 16 bytes, false if any of them is not a hex digit
+static bool HexDecode32(const char* psz, unsigned char* out) {
+    const __m128i digit  = _mm_set1_epi8('0');
+    const __m128i alpha  = _mm_set1_epi8('a');
+    const __m128i lower  = _mm_set1_epi8(0x20);
+    const __m128i nine   = _mm_set1_epi8(9);
+    const __m128i five   = _mm_set1_epi8(5);
+    const __m128i ten    = _mm_set1_epi8(10);
+    const __m128i lowMask = _mm_set1_epi16(0x00f0);
+
+    __m128i packed[2];
+    for (int k = 0; k < 2; k++) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(psz + k * 16));
+        // '0'..'9' as is, 'A'..'F' and 'a'..'f' lowercased, compared unsigned by the min
+        __m128i d        = _mm_sub_epi8(c, digit);
+        __m128i isDigit  = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+        __m128i a        = _mm_sub_epi8(_mm_or_si128(c, lower), alpha);
+        __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(a, five), a);
+        if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff)
+            return false;
+
+        __m128i nibbles = _mm_or_si128(_mm_and_si128(isDigit, d), _mm_and_si128(isLetter, _mm_add_epi8(a, ten)));
+        // each 16 bits lane holds the high nibble in its low byte and the low nibble in its high byte
+        packed[k] = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(nibbles, 4), lowMask), _mm_srli_epi16(nibbles, 8));
+    }
+    _mm_storeu_si128((__m128i*)out, _mm_packus_epi16(packed[0], packed[1]));
+    return true;
+}
+#endif
+
 vector<unsigned char> ParseHex(const char* psz) {
     // convert hex dump to vector
     vector<unsigned char> vch;
+    const char* pend = psz + strlen(psz);
+    vch.reserve((pend - psz) / 2);
     while (true) {
-        while (isspace(*psz)) psz++;
-        signed char c = HexDigit(*psz++);
-        if (c == (signed char)-1) break;
-        unsigned char n = (c << 4);
-        c               = HexDigit(*psz++);
-        if (c == (signed char)-1) break;
-        n |= c;
-        vch.push_back(n);
+#if defined(__SSE2__)
+        // the runs of hex digits 32 at a time, the scalar loop takes over up to the end of the chunk
+        // holding the first space or non hex digit
+        while (pend - psz >= 32) {
+            unsigned char bytes[16];
+            if (!HexDecode32(psz, bytes))
+                break;
+            vch.insert(vch.end(), bytes, bytes + 16);
+            psz += 32;
+        }
+#endif
+        const char* pnext = psz + 32;
+        while (psz < pnext) {
+            while (isspace(*psz)) psz++;
+            signed char c = HexDigit(*psz++);
+            if (c == (signed char)-1) return vch;
+            unsigned char n = (c << 4);
+            c               = HexDigit(*psz++);
+            if (c == (signed char)-1) return vch;
+            n |= c;
+            vch.push_back(n);
+        }
     }
-    return vch;
 }
 
 vector<unsigned char> ParseHex(const string& str) { return ParseHex(str.c_str()); }
@@ -983,6 +1060,8 @@ void runCommand(string strCommand) {
 }
 
 void RenameThread(const char* name) {
+    SetThreadPool(GetThreadPoolByName(name));
+
 #if defined(PR_SET_NAME)
     // Only the first 15 characters are used (16 - NUL terminator)
     ::prctl(PR_SET_NAME, name, 0, 0, 0);
@@ -234,6 +234,19 @@ inline int64_t abs64(int64_t n) { return (n >= 0 ? n : -n); }
 
 template <typename T>
 string HexStr(const T itbegin, const T itend, bool fSpaces = false) {
+    // the contiguous bytes, i.e. the pointers and the iterators of the byte vectors
+    if constexpr (std::is_same<T, vector<unsigned char>::const_iterator>::value ||
+                  std::is_same<T, vector<unsigned char>::iterator>::value ||
+                  (std::is_pointer<T>::value && sizeof(*itbegin) == 1)) {
+        if (!fSpaces) {
+            size_t len = itend - itbegin;
+            string rv(len * 2, '\0');
+            if (len > 0)
+                HexEncode((const unsigned char*)&*itbegin, len, &rv[0]);
+            return rv;
+        }
+    }
+
     string rv;
     static const char hexmap[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
     rv.reserve((itend - itbegin) * 3);
@@ -48,10 +48,11 @@ public:
         nFeatureForkHeight                 = IniCfg().GetFeatureForkHeight(MAIN_NET);
         nStableCoinGenesisHeight           = IniCfg().GetStableCoinGenesisHeight(MAIN_NET);
         nVer3ForkHeight                    = IniCfg().GetVer3ForkHeight(MAIN_NET);
+        nVer4ForkHeight                    = IniCfg().GetVer4ForkHeight(MAIN_NET);
         assert(CreateGenesisBlockRewardTx(genesis.vptx, MAIN_NET));
         assert(CreateGenesisDelegateTx(genesis.vptx, MAIN_NET));
         genesis.SetPrevBlockHash(uint256());
-        genesis.SetMerkleRootHash(genesis.BuildMerkleTree());
+        genesis.SetMerkleRootHash(genesis.ComputeMerkleRoot());
 
         genesis.SetVersion(INIT_BLOCK_VERSION);
         genesis.SetTime(IniCfg().GetStartTimeInit(MAIN_NET));
@@ -120,13 +121,14 @@ public:
         nFeatureForkHeight       = IniCfg().GetFeatureForkHeight(TEST_NET);
         nStableCoinGenesisHeight = IniCfg().GetStableCoinGenesisHeight(TEST_NET);
         nVer3ForkHeight          = IniCfg().GetVer3ForkHeight(TEST_NET);
+        nVer4ForkHeight          = IniCfg().GetVer4ForkHeight(TEST_NET);
         // Modify the testnet genesis block so the timestamp is valid for a later start.
         genesis.SetTime(IniCfg().GetStartTimeInit(TEST_NET));
         genesis.SetNonce(IniCfg().GetGenesisBlockNonce(TEST_NET));
         genesis.vptx.clear();
         assert(CreateGenesisBlockRewardTx(genesis.vptx, TEST_NET));
         assert(CreateGenesisDelegateTx(genesis.vptx, TEST_NET));
-        genesis.SetMerkleRootHash(genesis.BuildMerkleTree());
+        genesis.SetMerkleRootHash(genesis.ComputeMerkleRoot());
         genesisBlockHash = genesis.GetHash();
         for (auto& item : vFixedSeeds)
             item.SetPort(GetDefaultPort());
@@ -157,6 +159,9 @@ public:
         nVer3ForkHeight          = std::max<uint32_t>(nFeatureForkHeight + 1,
                                                 GetArg("-ver3forkheight", IniCfg().GetVer3ForkHeight(TEST_NET)));
 
+        nVer4ForkHeight          = std::max<uint32_t>(nVer3ForkHeight + 1,
+                                                GetArg("-ver4forkheight", IniCfg().GetVer4ForkHeight(TEST_NET)));
+
         fServer = true;
 
         return true;
@@ -177,12 +182,13 @@ public:
         nFeatureForkHeight       = IniCfg().GetFeatureForkHeight(REGTEST_NET);
         nStableCoinGenesisHeight = IniCfg().GetStableCoinGenesisHeight(REGTEST_NET);
         nVer3ForkHeight          = IniCfg().GetVer3ForkHeight(REGTEST_NET);
+        nVer4ForkHeight          = IniCfg().GetVer4ForkHeight(REGTEST_NET);
         genesis.SetTime(IniCfg().GetStartTimeInit(REGTEST_NET));
         genesis.SetNonce(IniCfg().GetGenesisBlockNonce(REGTEST_NET));
         genesis.vptx.clear();
         assert(CreateGenesisBlockRewardTx(genesis.vptx, REGTEST_NET));
         assert(CreateGenesisDelegateTx(genesis.vptx, REGTEST_NET));
-        genesis.SetMerkleRootHash(genesis.BuildMerkleTree());
+        genesis.SetMerkleRootHash(genesis.ComputeMerkleRoot());
         genesisBlockHash = genesis.GetHash();
         assert(genesisBlockHash == IniCfg().GetGenesisBlockHash(REGTEST_NET));
 
@@ -206,6 +212,9 @@ public:
 
         nVer3ForkHeight          = std::max<uint32_t>(nFeatureForkHeight + 1,
                                                 GetArg("-ver3forkheight", IniCfg().GetVer3ForkHeight(REGTEST_NET)));
+
+        nVer4ForkHeight          = std::max<uint32_t>(nVer3ForkHeight + 1,
+                                                GetArg("-ver4forkheight", IniCfg().GetVer4ForkHeight(REGTEST_NET)));
         fServer = true;
 
         return true;
@@ -431,6 +440,9 @@ CBaseParams::CBaseParams() {
     fReindex                = false;
     fBenchmark              = false;
     fTxIndex                = false;
+    fAddressIndex           = false;
+    fBlockFilterIndex       = false;
+    fMedianPriceIndex       = false;
     fLogFailures            = false;
     nTxCacheHeight          = 500;
     nTimeBestReceived       = 0;
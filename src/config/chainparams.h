@@ -65,6 +65,9 @@ protected:
     mutable bool fReindex;
     mutable bool fBenchmark;
     mutable bool fTxIndex;
+    mutable bool fAddressIndex;
+    mutable bool fBlockFilterIndex;
+    mutable bool fMedianPriceIndex;
     mutable bool fLogFailures;
     mutable bool fGenReceipt;
     mutable int64_t nTimeBestReceived;
@@ -100,6 +103,9 @@ public:
         te += strprintf("fReindex:%d\n",                            fReindex);
         te += strprintf("fBenchmark:%d\n",                          fBenchmark);
         te += strprintf("fTxIndex:%d\n",                            fTxIndex);
+        te += strprintf("fAddressIndex:%d\n",                       fAddressIndex);
+        te += strprintf("fBlockFilterIndex:%d\n",                   fBlockFilterIndex);
+        te += strprintf("fMedianPriceIndex:%d\n",                   fMedianPriceIndex);
         te += strprintf("fLogFailures:%d\n",                        fLogFailures);
         te += strprintf("nTimeBestReceived:%llu\n",                 nTimeBestReceived);
         te += strprintf("nBlockIntervalPreStableCoinRelease:%u\n",  nBlockIntervalPreStableCoinRelease);
@@ -153,6 +159,9 @@ public:
     bool IsReindex() const { return fReindex; }
     bool IsBenchmark() const { return fBenchmark; }
     bool IsTxIndex() const { return fTxIndex; }
+    bool IsAddressIndex() const { return fAddressIndex; }
+    bool IsBlockFilterIndex() const { return fBlockFilterIndex; }
+    bool IsMedianPriceIndex() const { return fMedianPriceIndex; }
     bool IsLogFailures() const { return fLogFailures; };
     bool IsGenReceipt() const { return fGenReceipt; };
     int64_t GetBestRecvTime() const { return nTimeBestReceived; }
@@ -162,6 +171,9 @@ public:
     void SetReIndex(bool flag) const { fReindex = flag; }
     void SetBenchMark(bool flag) const { fBenchmark = flag; }
     void SetTxIndex(bool flag) const { fTxIndex = flag; }
+    void SetAddressIndex(bool flag) const { fAddressIndex = flag; }
+    void SetBlockFilterIndex(bool flag) const { fBlockFilterIndex = flag; }
+    void SetMedianPriceIndex(bool flag) const { fMedianPriceIndex = flag; }
     void SetLogFailures(bool flag) const { fLogFailures = flag; }
     void SetGenReceipt(bool flag) const { fGenReceipt = flag; }
     void SetBestRecvTime(int64_t nTime) const { nTimeBestReceived = nTime; }
@@ -174,6 +186,7 @@ public:
     uint32_t GetFeatureForkHeight() const { return nFeatureForkHeight; }
     uint32_t GetStableCoinGenesisHeight() const { return nStableCoinGenesisHeight; }
     uint32_t GetVer3ForkHeight() const { return nVer3ForkHeight; }
+    uint32_t GetVer4ForkHeight() const { return nVer4ForkHeight; }
     uint32_t GetContinuousCountBeforeFork() const { return nContinuousCountBeforeFork; }
     uint32_t GetContinuousCountAfterFork() const { return nContinuousCountAfterFork; }
     CRegID GetFcoinGenesisRegId() const { return CRegID(nStableCoinGenesisHeight, 1); }
@@ -227,6 +240,7 @@ protected:
     uint32_t nStableCoinGenesisHeight;
     uint32_t nFeatureForkHeight;
     uint32_t nVer3ForkHeight;
+    uint32_t nVer4ForkHeight;
     uint32_t nBlockIntervalPreStableCoinRelease;
     uint32_t nBlockIntervalStableCoinRelease;
     uint32_t nContinuousProduceForkHeight ;
@@ -90,6 +90,11 @@ uint32_t G_CONFIG_TABLE::GetVer3ForkHeight(const NET_TYPE type) const {
     return nVer3ForkHeight[type];
 }
 
+uint32_t G_CONFIG_TABLE::GetVer4ForkHeight(const NET_TYPE type) const {
+    assert(type >= 0 && type < 3);
+    return nVer4ForkHeight[type];
+}
+
 vector<uint32_t> G_CONFIG_TABLE::GetSeedNodeIP() const { return pnSeed; }
 
 uint8_t* G_CONFIG_TABLE::GetMagicNumber(const NET_TYPE type) const {
@@ -283,3 +288,9 @@ uint32_t G_CONFIG_TABLE::nVer3ForkHeight[3] {
     8000000,    // mainnet:
     2000000,    // testnet
     500};       // regtest
+
+// Block height to enable MAJOR_VER_R4, not scheduled on mainnet and testnet yet
+uint32_t G_CONFIG_TABLE::nVer4ForkHeight[3] {
+    2147483647, // mainnet
+    2147483647, // testnet
+    600};       // regtest
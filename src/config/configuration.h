@@ -51,6 +51,7 @@ public:
 	uint32_t GetFeatureForkHeight(const NET_TYPE type) const;
     uint32_t GetStableCoinGenesisHeight(const NET_TYPE type) const;
     uint32_t GetVer3ForkHeight(const NET_TYPE type) const;
+    uint32_t GetVer4ForkHeight(const NET_TYPE type) const;
     const vector<string> GetStableCoinGenesisTxid(const NET_TYPE type) const;
 
 private:
@@ -124,10 +125,16 @@ private:
     /* soft fork height for MAJOR_VER_R3 */
     static uint32_t nVer3ForkHeight[3];
 
+    /* soft fork height for MAJOR_VER_R4 */
+    static uint32_t nVer4ForkHeight[3];
+
 };
 
 inline FeatureForkVersionEnum GetFeatureForkVersion(const int32_t currBlockHeight) {
-    if (currBlockHeight >= (int32_t)SysCfg().GetVer3ForkHeight())
+    if (currBlockHeight >= (int32_t)SysCfg().GetVer4ForkHeight())
+        return MAJOR_VER_R4;
+
+    else if (currBlockHeight >= (int32_t)SysCfg().GetVer3ForkHeight())
         return MAJOR_VER_R3;
 
     else if (currBlockHeight >= (int32_t)SysCfg().GetFeatureForkHeight())
@@ -109,10 +109,42 @@ static const uint32_t MAX_STANDARD_TX_SIZE = 100000;
 
 /** The maximum number of orphan blocks kept in memory */
 static const uint32_t MAX_ORPHAN_BLOCKS = 750;
+/** The maximum bytes of the serialized orphan blocks kept in memory */
+static const uint64_t MAX_ORPHAN_BLOCKS_SIZE = 64 * 1024 * 1024;
+/** The maximum number of fork tip states kept to validate the blocks extending them */
+static const uint32_t MAX_FORK_STATES = 16;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int32_t MAX_BLOCKS_IN_TRANSIT_PER_PEER = 128;
 /** Timeout in seconds before considering a block download peer unresponsive. */
 static const uint32_t BLOCK_DOWNLOAD_TIMEOUT  = 60;
+/** Maximum number of headers in a headers message */
+static const uint32_t MAX_HEADERS_RESULTS = 2000;
+/** Number of blocks above the tip that headers-first sync downloads in parallel, must stay below MAX_ORPHAN_BLOCKS */
+static const int32_t BLOCK_DOWNLOAD_WINDOW = 512;
+/** Minimum number of blocks a peer must be ahead of the tip to start a headers-first sync from it */
+static const int32_t HEADERS_SYNC_MIN_GAP = 100;
+/** Timeout in seconds before the headers sync peer is considered unresponsive. */
+static const int64_t HEADERS_RESPONSE_TIMEOUT = 30;
+/** Timeout in seconds before the block holding back the download window is requested from another peer. */
+static const int64_t BLOCK_STALLING_TIMEOUT = 5;
+/** Blocks requested from a peer before its throughput is known, and the lower bound of its budget */
+static const int32_t MIN_BLOCKS_IN_TRANSIT_PER_PEER = 8;
+/** Seconds of a peer's measured block throughput kept in flight to it during headers-first sync */
+static const int64_t BLOCK_FETCH_TARGET_TIME = 2;
+/** Average milliseconds between the batches of tx invs announced to a peer (-txinvinterval), twice it to inbound peers */
+static const int64_t DEFAULT_TX_INV_INTERVAL = 500;
+/** Max. tx invs announced to a peer per second (-maxtxinvrate), the rest waits for the next batches */
+static const int64_t DEFAULT_MAX_TX_INV_RATE = 1000;
+/** Whether the block, tx and headers payloads are accepted compressed and sent so to the peers accepting them (-p2pcompress) */
+static const bool DEFAULT_P2P_COMPRESS = true;
+/** Whether a block of the scheduled producer is relayed once its header and signature check out, before its full validation (-prevalidationrelay) */
+static const bool DEFAULT_PREVALIDATION_RELAY = true;
+/** Version of the compact block relay announced by sendcmpct */
+static const uint64_t COMPACT_BLOCKS_VERSION = 1;
+/** Maximum depth below the tip of a block that is sent as a compact block */
+static const int32_t MAX_CMPCTBLOCK_DEPTH = 5;
+/** Maximum depth below the tip of a block whose transactions are sent in response to getblocktxn */
+static const int32_t MAX_BLOCKTXN_DEPTH = 10;
 
 /** Minimum disk space required */
 static const uint64_t MIN_DISK_SPACE = 52428800;
@@ -121,13 +153,108 @@ static const uint32_t MAX_BLOCKFILE_SIZE = 0x8000000;  // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
 static const uint32_t BLOCKFILE_CHUNK_SIZE = 0x1000000;  // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
-static const uint32_t UNDOFILE_CHUNK_SIZE = 0x100000;  // 1 MiB
+static const uint32_t UNDOFILE_CHUNK_SIZE = 0x400000;  // 4 MiB
+/** The unsynced bytes of a blk/rev file which are synced before the next flush of the chain state */
+static const uint64_t BLOCK_FILE_SYNC_BYTES = 0x2000000;  // 32 MiB
+/** The age in seconds of the oldest unsynced write of a blk/rev file which is synced before the next flush */
+static const int64_t BLOCK_FILE_SYNC_INTERVAL = 30;
+/** default -iouring writing the blk/rev files asynchronously through an io_uring (Linux only) */
+static const bool DEFAULT_IO_URING = false;
+/** entries of the submission queue of the io_uring of the blk/rev files */
+static const uint32_t IO_URING_ENTRIES = 64;
+/** bytes of the blk/rev records in flight in the io_uring, a writer beyond it waits for completions */
+static const uint64_t MAX_IO_URING_PENDING_BYTES = 0x4000000;  // 64 MiB
+/** -prune default (MiB), 0 keeps all the block and undo files */
+static const uint64_t DEFAULT_PRUNE_TARGET_MB = 0;
+/** min. -prune (MiB), the files of the blocks kept and a few more */
+static const uint64_t MIN_PRUNE_TARGET_MB = 550;
+/** The blocks below the tip never pruned, nor the ones above the global finality */
+static const int32_t MIN_BLOCKS_TO_KEEP = 5000;
+/** cache size of the block index database (bytes) */
+static const size_t BLOCK_INDEX_DB_CACHE = 2 << 20;
 /** -dbcache default (MiB) */
 static const int64_t DEFAULT_DB_CACHE = 100;
 /** max. -dbcache in (MiB) */
 static const int64_t MAX_DB_CACHE = sizeof(void *) > 4 ? 4096 : 1024;
 /** min. -dbcache in (MiB) */
 static const int64_t MIN_DB_CACHE = 4;
+/** -dbreadcache default (MiB), the clean values kept by the top-level db caches across the flushes */
+static const int64_t DEFAULT_DB_READ_CACHE = 64;
+/** max. -dbreadcache (MiB) */
+static const int64_t MAX_DB_READ_CACHE = sizeof(void *) > 4 ? 8192 : 512;
+/** -dbwarmup default, whether the hot prefixes of the dbs are read into their block caches at startup */
+static const bool DEFAULT_DB_WARMUP = false;
+/** -singlestatedb default, whether the chain state dbs are kept in the one db of blocks/state */
+static const bool DEFAULT_SINGLE_STATE_DB = false;
+/** default blocks of tx receipts kept by -receiptretention and of failure logs by -logfailuresretention, 0 = all */
+static const int64_t DEFAULT_RECEIPT_RETENTION = 0;
+static const int64_t DEFAULT_LOG_FAILURES_RETENTION = 0;
+/** -wasmtraces default, whether the traces of the wasm txs are stored for gettxtrace */
+static const bool DEFAULT_WASM_TRACES = true;
+/** default -wasmtracesmaxsize (MiB) of the stored wasm traces, 0 = unbounded */
+static const int64_t DEFAULT_WASM_TRACES_MAX_SIZE = 0;
+/** default bloom filter bits per key of the LevelDB databases */
+static const int32_t DEFAULT_DB_BLOOM_BITS = 10;
+/** max. bloom filter bits per key of the LevelDB databases */
+static const int32_t MAX_DB_BLOOM_BITS = 32;
+/** default max. open files of each LevelDB database */
+static const int32_t DEFAULT_DB_MAX_OPEN_FILES = 64;
+/** min. max. open files of each LevelDB database */
+static const int32_t MIN_DB_MAX_OPEN_FILES = 16;
+/** default keys between the restart points of the LevelDB blocks, the keys in between keep only the bytes after
+ *  the prefix shared with the previous key */
+static const int32_t DEFAULT_DB_RESTART_INTERVAL = 16;
+/** default restart interval of the contract database, whose data keys all repeat the prefix and the contract regid */
+static const int32_t CONTRACT_DB_RESTART_INTERVAL = 64;
+/** max. restart interval of the LevelDB blocks */
+static const int32_t MAX_DB_RESTART_INTERVAL = 1024;
+/** max. -dbcompactionthreads background compactions and flushes of rocksdb */
+static const int64_t MAX_DB_COMPACTION_THREADS = 64;
+/** max. -parallelconnect worker threads */
+static const int64_t MAX_PARALLEL_CONNECT_THREADS = 64;
+/** default and max. -prefetchthreads reading the state of a block ahead of its connection */
+static const int64_t DEFAULT_PREFETCH_THREADS = 4;
+static const int64_t MAX_PREFETCH_THREADS = 64;
+/** default -hugepages backing the wasm linear memories with transparent huge pages */
+static const bool DEFAULT_HUGE_PAGES = false;
+/** default number of blk/rev files kept memory mapped for reading */
+static const int64_t DEFAULT_BLOCK_FILE_MAPPINGS = 8;
+/** max. number of blk/rev files kept memory mapped for reading */
+static const int64_t MAX_BLOCK_FILE_MAPPINGS = 256;
+/** number of latest blocks whose price points are kept in the price point memory cache */
+static const uint32_t PRICE_POINT_CACHE_HEIGHT = 11;
+/** max. -checkthreads startup verification workers */
+static const int64_t MAX_CHECK_THREADS = 64;
+/** max. -schedulerthreads workers of the shared task scheduler */
+static const int64_t MAX_SCHEDULER_THREADS = 64;
+/** max. -loadthreads block index loading workers */
+static const int64_t MAX_LOAD_THREADS = 64;
+/** max. -importthreads block import workers */
+static const int64_t MAX_IMPORT_THREADS = 64;
+/** max. -rescanthreads wallet rescan workers */
+static const int64_t MAX_RESCAN_THREADS = 64;
+/** max. -par signature verification threads */
+static const int32_t MAX_SIGCHECK_THREADS = 16;
+/** -par default (0 = auto) */
+static const int32_t DEFAULT_SIGCHECK_THREADS = 0;
+/** max. -msghandlers p2p message handler threads */
+static const int32_t MAX_MESSAGE_HANDLER_THREADS = 16;
+/** -msghandlers default, bounded by the number of cores */
+static const int32_t DEFAULT_MESSAGE_HANDLER_THREADS = 4;
+/** -wasmcachesize default, number of instantiated wasm modules kept in memory */
+static const int32_t DEFAULT_WASM_MODULE_CACHE_SIZE = 64;
+/** -addressindex default */
+static const bool DEFAULT_ADDRESSINDEX = false;
+/** max. number of txids returned by one getaddresstxids call */
+static const int32_t MAX_ADDRESS_TXIDS_COUNT = 1000;
+/** -blockfilterindex default */
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+/** -medianpriceindex default */
+static const bool DEFAULT_MEDIANPRICEINDEX = false;
+/** the heights between the key records of the median price index */
+static const uint32_t MEDIAN_PRICE_KEY_INTERVAL = 1000;
+/** max. number of heights returned by one getmedianpricehistory call */
+static const int32_t MAX_MEDIAN_PRICE_HISTORY_COUNT = 10000;
 
 /** Coinbase transaction outputs can only be spent after this number of new blocks (network rule) */
 static const int32_t BLOCK_REWARD_MATURITY = 100;
@@ -21,6 +21,7 @@ using namespace std;
 static const uint16_t RATIO_BOOST          = 10000;
 static const uint32_t PRICE_BOOST          = 100000000;
 static const uint32_t CDP_BASE_RATIO_BOOST = 100000000;
+static const uint64_t CDP_RATIO_BUCKET_WIDTH = CDP_BASE_RATIO_BOOST / 100;  // 0.01 bcoin per scoin
 
 static const uint64_t FUND_COIN_GENESIS_TOTAL_RELEASE_AMOUNT   = 20160000000;  // 96% * 21 billion
 static const uint32_t FUND_COIN_GENESIS_INITIAL_RESERVE_AMOUNT = 1000000;      // 1 m WUSD
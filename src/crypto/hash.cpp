@@ -5,6 +5,9 @@
 
 #include "hash.h"
 
+#include "crypto/ripemd160.h"
+#include "crypto/sha256.h"
+
 inline uint32_t ROTL32(uint32_t x, int8_t r) { return (x << r) | (x >> (32 - r)); }
 
 uint32_t MurmurHash3(uint32_t nHashSeed, const vector<uint8_t> &vDataToHash) {
@@ -94,3 +97,18 @@ int32_t HMAC_SHA512_Final(uint8_t *pmd, HMAC_SHA512_CTX *pctx) {
     SHA512_Update(&pctx->ctxOuter, buf, 64);
     return SHA512_Final(pmd, &pctx->ctxOuter);
 }
+
+uint160 Hash160(const uint8_t *data, size_t len) {
+    uint160 hash;
+    Hash160Batch(&hash, &data, &len, 1);
+    return hash;
+}
+
+void Hash160Batch(uint160 *out, const uint8_t *const *pin, const size_t *len, size_t count) {
+    CSHA256 sha256;
+    uint8_t hash1[CSHA256::OUTPUT_SIZE];
+    for (size_t i = 0; i < count; i++) {
+        sha256.Reset().Write(pin[i], len[i]).Finalize(hash1);
+        RIPEMD160_32(out[i].begin(), hash1);
+    }
+}
@@ -110,15 +110,19 @@ uint256 SerializeHash(const T &obj, int32_t nType = SER_GETHASH, int32_t nVersio
     return ss.GetHash();
 }
 
+// RIPEMD160(SHA256(data)), the SHA256 by the transform picked by SHA256AutoDetect
+uint160 Hash160(const uint8_t *data, size_t len);
+
+/**
+ * The Hash160 of count inputs, pin[i] of len[i] bytes, e.g. the keys of a wallet rescan or of the
+ * signers of a multisig tx, with one hasher reused and the RIPEMD160 of the 32 bytes in one block.
+ */
+void Hash160Batch(uint160 *out, const uint8_t *const *pin, const size_t *len, size_t count);
+
 template <typename T1>
 inline uint160 Hash160(const T1 pbegin, const T1 pend) {
     static uint8_t pblank[1];
-    uint256 hash1;
-    SHA256((pbegin == pend ? pblank : (uint8_t *)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]),
-           (uint8_t *)&hash1);
-    uint160 hash2;
-    RIPEMD160((uint8_t *)&hash1, sizeof(hash1), (uint8_t *)&hash2);
-    return hash2;
+    return Hash160((pbegin == pend ? pblank : (const uint8_t *)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]));
 }
 
 inline uint160 Hash160(const vector<uint8_t> &vch) { return Hash160(vch.begin(), vch.end()); }
@@ -290,3 +290,21 @@ CRIPEMD160& CRIPEMD160::Reset()
     ripemd160::Initialize(s);
     return *this;
 }
+
+void RIPEMD160_32(unsigned char out[CRIPEMD160::OUTPUT_SIZE], const unsigned char in[32])
+{
+    // the input, the 0x80 terminator and the bit length 256 in the last 8 bytes
+    unsigned char block[64] = {0};
+    memcpy(block, in, 32);
+    block[32] = 0x80;
+    WriteLE64(block + 56, 32 << 3);
+
+    uint32_t s[5];
+    ripemd160::Initialize(s);
+    ripemd160::Transform(s, block);
+    WriteLE32(out, s[0]);
+    WriteLE32(out + 4, s[1]);
+    WriteLE32(out + 8, s[2]);
+    WriteLE32(out + 12, s[3]);
+    WriteLE32(out + 16, s[4]);
+}
@@ -25,4 +25,7 @@ public:
     CRIPEMD160& Reset();
 };
 
+/** RIPEMD-160 of a 32-byte input, e.g. the SHA256 of Hash160, padded in place into one block. */
+void RIPEMD160_32(unsigned char out[CRIPEMD160::OUTPUT_SIZE], const unsigned char in[32]);
+
 #endif // BITCOIN_CRYPTO_RIPEMD160_H
@@ -20,7 +20,7 @@
 bool CAccount::GetBalance(const TokenSymbol &tokenSymbol, const BalanceType balanceType, uint64_t &value) {
     auto iter = tokens.find(tokenSymbol);
     if (iter != tokens.end()) {
-        auto accountToken = iter->second;
+        const auto &accountToken = iter->second;
         switch (balanceType) {
             case FREE_VALUE:    value = accountToken.free_amount;   return true;
             case STAKED_VALUE:  value = accountToken.staked_amount; return true;
@@ -33,78 +33,63 @@ bool CAccount::GetBalance(const TokenSymbol &tokenSymbol, const BalanceType bala
     return false;
 }
 
+namespace {
+
+// the amount an op takes from and the one it adds to, nullptr if none, by BalanceOpType
+struct CBalanceOpFields {
+    uint64_t CAccountToken::*pFrom;
+    uint64_t CAccountToken::*pTo;
+    const char *fromName;
+};
+
+const CBalanceOpFields kBalanceOpFields[] = {
+    /* NULL_OP  */ {nullptr,                       nullptr,                       nullptr},
+    /* ADD_FREE */ {nullptr,                       &CAccountToken::free_amount,   nullptr},
+    /* SUB_FREE */ {&CAccountToken::free_amount,   nullptr,                       "free_amount"},
+    /* STAKE    */ {&CAccountToken::free_amount,   &CAccountToken::staked_amount, "free_amount"},
+    /* UNSTAKE  */ {&CAccountToken::staked_amount, &CAccountToken::free_amount,   "staked_amount"},
+    /* FREEZE   */ {&CAccountToken::free_amount,   &CAccountToken::frozen_amount, "free_amount"},
+    /* UNFREEZE */ {&CAccountToken::frozen_amount, &CAccountToken::free_amount,   "frozen_amount"},
+    /* VOTE     */ {&CAccountToken::free_amount,   &CAccountToken::voted_amount,  "free_amount"},
+    /* UNVOTE   */ {&CAccountToken::voted_amount,  &CAccountToken::free_amount,   "voted_amount"},
+};
+
+bool ApplyBalanceOp(CAccountToken &accountToken, const TokenSymbol &tokenSymbol, const BalanceOpType opType,
+                    const uint64_t value) {
+    if (opType == NULL_OP || opType >= sizeof(kBalanceOpFields) / sizeof(kBalanceOpFields[0]))
+        return false;
+
+    const CBalanceOpFields &fields = kBalanceOpFields[opType];
+    if (fields.pFrom != nullptr) {
+        uint64_t &fromAmount = accountToken.*fields.pFrom;
+        if (fromAmount < value)
+            return ERRORMSG("CAccount::OperateBalance, %s insufficient(%llu vs %llu) of %s", fields.fromName,
+                            fromAmount, value, tokenSymbol);
+        fromAmount -= value;
+    }
+    if (fields.pTo != nullptr)
+        accountToken.*fields.pTo += value;
+    return true;
+}
+
+}  // namespace
+
 bool CAccount::OperateBalance(const TokenSymbol &tokenSymbol, const BalanceOpType opType, const uint64_t &value) {
+    return ApplyBalanceOp(tokens[tokenSymbol], tokenSymbol, opType, value);
+}
 
+bool CAccount::OperateBalances(const TokenSymbol &tokenSymbol, std::initializer_list<CBalanceOp> ops,
+                               size_t &failedIndex) {
     CAccountToken &accountToken = tokens[tokenSymbol];
-    switch (opType) {
-        case ADD_FREE: {
-            accountToken.free_amount += value;
-            return true;
-        }
-        case SUB_FREE: {
-            if (accountToken.free_amount < value)
-                return ERRORMSG("CAccount::OperateBalance, free_amount insufficient(%llu vs %llu) of %s",
-                                accountToken.free_amount, value, tokenSymbol);
-
-            accountToken.free_amount -= value;
-            return true;
-        }
-        case STAKE: {
-            if (accountToken.free_amount < value)
-                return ERRORMSG("CAccount::OperateBalance, free_amount insufficient(%llu vs %llu) of %s",
-                                accountToken.free_amount, value, tokenSymbol);
-
-            accountToken.free_amount -= value;
-            accountToken.staked_amount += value;
-            return true;
-        }
-        case UNSTAKE: {
-            if (accountToken.staked_amount < value)
-                return ERRORMSG("CAccount::OperateBalance, staked_amount insufficient(%llu vs %llu) of %s",
-                                accountToken.staked_amount, value, tokenSymbol);
-
-            accountToken.free_amount += value;
-            accountToken.staked_amount -= value;
-            return true;
-        }
-        case FREEZE: {
-            if (accountToken.free_amount < value)
-                return ERRORMSG("CAccount::OperateBalance, free_amount insufficient(%llu vs %llu) of %s",
-                                accountToken.free_amount, value, tokenSymbol);
-
-            accountToken.free_amount -= value;
-            accountToken.frozen_amount += value;
-            return true;
-        }
-        case UNFREEZE: {
-            if (accountToken.frozen_amount < value)
-                return ERRORMSG("CAccount::OperateBalance, frozen_amount insufficient(%llu vs %llu) of %s",
-                                accountToken.frozen_amount, value, tokenSymbol);
-
-            accountToken.free_amount += value;
-            accountToken.frozen_amount -= value;
-            return true;
-        }
-        case VOTE: {
-            if (accountToken.free_amount < value)
-                return ERRORMSG("CAccount::OperateBalance, free_amount insufficient(%llu vs %llu) of %s",
-                                accountToken.free_amount, value, tokenSymbol);
-
-            accountToken.free_amount -= value;
-            accountToken.voted_amount += value;
-            return true;
-        }
-        case UNVOTE: {
-            if (accountToken.voted_amount < value)
-                return ERRORMSG("CAccount::OperateBalance, voted_amount insufficient(%llu vs %llu) of %s",
-                                accountToken.voted_amount, value, tokenSymbol);
-
-            accountToken.free_amount += value;
-            accountToken.voted_amount -= value;
-            return true;
-        }
-        default: return false;
+    CAccountToken newToken      = accountToken;
+    failedIndex                 = 0;
+    for (const auto &op : ops) {
+        if (!ApplyBalanceOp(newToken, tokenSymbol, op.op_type, op.value))
+            return false;
+        failedIndex++;
     }
+    accountToken = newToken;
+    return true;
 }
 
 uint64_t CAccount::ComputeVoteBcoinInterest(const uint64_t lastVotedBcoins, const uint32_t currHeight) {
@@ -221,8 +206,12 @@ bool CAccount::SetToken(const TokenSymbol &tokenSymbol, const CAccountToken &acc
 }
 
 Object CAccount::ToJsonObj() const {
+    return ToJsonObj(*pCdMan->pDelegateCache, chainActive.Height());
+}
+
+Object CAccount::ToJsonObj(CDelegateDBCache &delegateCache, int32_t height) const {
     vector<CCandidateReceivedVote> candidateVotes;
-    pCdMan->pDelegateCache->GetCandidateVotes(regid, candidateVotes);
+    delegateCache.GetCandidateVotes(regid, candidateVotes);
 
     Array candidateVoteArray;
     for (auto &vote : candidateVotes) {
@@ -230,7 +219,7 @@ Object CAccount::ToJsonObj() const {
     }
 
     Object tokenMapObj;
-    for (auto tokenPair : tokens) {
+    for (const auto &tokenPair : tokens) {
         Object tokenObj;
         const CAccountToken &token = tokenPair.second;
         tokenObj.push_back(Pair("free_amount",      token.free_amount));
@@ -245,9 +234,9 @@ Object CAccount::ToJsonObj() const {
     obj.push_back(Pair("address",           keyid.ToAddress()));
     obj.push_back(Pair("keyid",             keyid.ToString()));
     obj.push_back(Pair("nickid",            nickid.ToString()));
-    obj.push_back(Pair("nickid_mature",     nickid.IsMature(chainActive.Height())));
+    obj.push_back(Pair("nickid_mature",     nickid.IsMature(height)));
     obj.push_back(Pair("regid",             regid.ToString()));
-    obj.push_back(Pair("regid_mature",      regid.IsMature(chainActive.Height())));
+    obj.push_back(Pair("regid_mature",      regid.IsMature(height)));
     obj.push_back(Pair("owner_pubkey",      owner_pubkey.ToString()));
     obj.push_back(Pair("miner_pubkey",      miner_pubkey.ToString()));
     obj.push_back(Pair("tokens",            tokenMapObj));
@@ -260,8 +249,8 @@ Object CAccount::ToJsonObj() const {
 string CAccount::ToString() const {
     string str;
     string  strTokens = "";
-    for (auto pair : tokens) {
-        CAccountToken &token = pair.second;
+    for (const auto &pair : tokens) {
+        const CAccountToken &token = pair.second;
         strTokens += strprintf ("\n %s: {free=%llu, staked=%llu, frozen=%llu}\n",
                     pair.first, token.free_amount, token.staked_amount, token.frozen_amount);
     }
@@ -7,7 +7,9 @@
 #ifndef ENTITIES_ACCOUNT_H
 #define ENTITIES_ACCOUNT_H
 
+#include <algorithm>
 #include <functional>
+#include <initializer_list>
 #include <map>
 #include <memory>
 #include <string>
@@ -25,6 +27,7 @@
 using namespace json_spirit;
 
 class CAccountDBCache;
+class CDelegateDBCache;
 
 enum BalanceType : uint8_t {
     NULL_TYPE    = 0,  //!< invalid type
@@ -46,26 +49,23 @@ enum BalanceOpType : uint8_t {
     UNVOTE   = 8   //!< voted -> free
 };
 
-struct BalanceOpTypeHash {
-    size_t operator()(const BalanceOpType& type) const noexcept { return std::hash<uint8_t>{}(type); }
-};
-
-static const unordered_map<BalanceOpType, string, BalanceOpTypeHash> kBalanceOpTypeTable = {
-    { NULL_OP,  "NULL_OP"   },
-    { ADD_FREE, "ADD_FREE"  },
-    { SUB_FREE, "SUB_FREE"  },
-    { STAKE,    "STAKE"     },
-    { UNSTAKE,  "UNSTAKE"   },
-    { FREEZE,   "FREEZE"    },
-    { UNFREEZE, "UNFREEZE"  },
-    { VOTE,     "VOTE"      },
-    { UNVOTE,   "UNVOTE"    }
+// by BalanceOpType
+static const char *const kBalanceOpTypeNames[] = {
+    "NULL_OP", "ADD_FREE", "SUB_FREE", "STAKE", "UNSTAKE", "FREEZE", "UNFREEZE", "VOTE", "UNVOTE"
 };
 
 inline string GetBalanceOpTypeName(const BalanceOpType opType) {
-    return kBalanceOpTypeTable.at(opType);
+    if (opType >= sizeof(kBalanceOpTypeNames) / sizeof(kBalanceOpTypeNames[0]))
+        return strprintf("UNKNOWN_OP(%u)", opType);
+    return kBalanceOpTypeNames[opType];
 }
 
+// A balance op of CAccount::OperateBalances(), the ops of a tx on one token of an account applied at once
+struct CBalanceOp {
+    BalanceOpType op_type;
+    uint64_t value;
+};
+
 class CAccountToken {
 public:
     uint64_t free_amount;
@@ -99,7 +99,88 @@ public:
     )
 };
 
-typedef map<TokenSymbol, CAccountToken> AccountTokenMap;
+/**
+ * The tokens of an account by symbol, kept as a vector sorted by symbol behind the map interface used
+ * by the account. An account holds a few tokens, so the binary search over the contiguous items beats
+ * the map nodes, and an account copy allocates once. It is serialized the same as
+ * map<TokenSymbol, CAccountToken>, so the accounts in db are unchanged.
+ */
+class CAccountTokenMap {
+public:
+    typedef pair<TokenSymbol, CAccountToken> value_type;
+    typedef vector<value_type>::iterator iterator;
+    typedef vector<value_type>::const_iterator const_iterator;
+
+    iterator begin() { return items.begin(); }
+    iterator end() { return items.end(); }
+    const_iterator begin() const { return items.begin(); }
+    const_iterator end() const { return items.end(); }
+
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    void clear() { items.clear(); }
+
+    iterator find(const TokenSymbol &symbol) {
+        auto it = LowerBound(symbol);
+        return (it != items.end() && it->first == symbol) ? it : items.end();
+    }
+
+    const_iterator find(const TokenSymbol &symbol) const {
+        return const_cast<CAccountTokenMap *>(this)->find(symbol);
+    }
+
+    size_t count(const TokenSymbol &symbol) const { return find(symbol) != end() ? 1 : 0; }
+
+    // insert an empty token if not found, like map
+    CAccountToken &operator[](const TokenSymbol &symbol) {
+        auto it = LowerBound(symbol);
+        if (it == items.end() || it->first != symbol)
+            it = items.emplace(it, symbol, CAccountToken());
+        return it->second;
+    }
+
+    size_t erase(const TokenSymbol &symbol) {
+        auto it = find(symbol);
+        if (it == items.end())
+            return 0;
+
+        items.erase(it);
+        return 1;
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        return ::GetSerializeSize(items, nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Serialize(Stream &s, int nType, int nVersion) const {
+        ::Serialize(s, items, nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersion) {
+        ::Unserialize(s, items, nType, nVersion);
+        // a serialized map is sorted and unique already, else keep the first item of a symbol as the map
+        auto keyLess  = [](const value_type &a, const value_type &b) { return a.first < b.first; };
+        auto keyEqual = [](const value_type &a, const value_type &b) { return a.first == b.first; };
+        if (std::adjacent_find(items.begin(), items.end(), [&](const value_type &a, const value_type &b) {
+                return !keyLess(a, b);
+            }) != items.end()) {
+            std::stable_sort(items.begin(), items.end(), keyLess);
+            items.erase(std::unique(items.begin(), items.end(), keyEqual), items.end());
+        }
+    }
+
+private:
+    iterator LowerBound(const TokenSymbol &symbol) {
+        return std::lower_bound(items.begin(), items.end(), symbol,
+                                [](const value_type &item, const TokenSymbol &key) { return item.first < key; });
+    }
+
+    vector<value_type> items;
+};
+
+typedef CAccountTokenMap AccountTokenMap;
 
 
 /**
@@ -175,6 +256,12 @@ public:
     uint64_t GetBalance(const TokenSymbol &tokenSymbol, const BalanceType balanceType);
     bool GetBalance(const TokenSymbol &tokenSymbol, const BalanceType balanceType, uint64_t &value);
     bool OperateBalance(const TokenSymbol &tokenSymbol, const BalanceOpType opType, const uint64_t &value);
+    /**
+     * Apply the ops to the token in order with one lookup of it, all or none of them. The index of the op
+     * failed is returned in failedIndex, for the callers to report it as the separate ops did.
+     */
+    bool OperateBalances(const TokenSymbol &tokenSymbol, std::initializer_list<CBalanceOp> ops,
+                         size_t &failedIndex);
 
     bool StakeVoteBcoins(VoteType type, const uint64_t votes);
     bool ProcessCandidateVotes(const vector<CCandidateVote>& candidateVotesIn,
@@ -194,6 +281,8 @@ public:
     void SetEmpty() { keyid.SetEmpty(); }  // TODO: need set other fields to empty()??
     string ToString() const;
     Object ToJsonObj() const;
+    // with the votes of the given cache and the maturity at the given height, for the reads off the tip
+    Object ToJsonObj(CDelegateDBCache &delegateCache, int32_t height) const;
 
     void SetRegId(CRegID & regIdIn) { regid = regIdIn; }
 
@@ -6,6 +6,73 @@
 #include "asset.h"
 #include "config/configuration.h"
 
+#include <deque>
+#include <mutex>
+
+///////////////////////////////////////////////////////////////////////////////
+// class CTokenSymbolTable
+
+static inline TokenSymbolId FindFixedSymbolId(const TokenSymbol &symbol) {
+    if (symbol == SYMB::WICC) return SYMB_ID::WICC;
+    if (symbol == SYMB::WGRT) return SYMB_ID::WGRT;
+    if (symbol == SYMB::WUSD) return SYMB_ID::WUSD;
+    return SYMB_ID::NONE;
+}
+
+struct CTokenSymbolTableData {
+    std::mutex mutex;
+    unordered_map<TokenSymbol, TokenSymbolId> ids;
+    deque<TokenSymbol> symbols;     // by id, the references stay valid on push_back
+
+    CTokenSymbolTableData() : symbols({"", SYMB::WICC, SYMB::WGRT, SYMB::WUSD}) {
+        for (TokenSymbolId id = 0; id < symbols.size(); id++)
+            ids[symbols[id]] = id;
+    }
+};
+
+static CTokenSymbolTableData& GetTokenSymbolTableData() {
+    static CTokenSymbolTableData data;
+    return data;
+}
+
+TokenSymbolId CTokenSymbolTable::Intern(const TokenSymbol &symbol) {
+    TokenSymbolId id = FindFixedSymbolId(symbol);
+    if (id != SYMB_ID::NONE || symbol.empty())
+        return id;
+
+    auto &data = GetTokenSymbolTableData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    auto it = data.ids.find(symbol);
+    if (it != data.ids.end())
+        return it->second;
+
+    id = data.symbols.size();
+    data.symbols.push_back(symbol);
+    data.ids.emplace(symbol, id);
+    return id;
+}
+
+TokenSymbolId CTokenSymbolTable::Find(const TokenSymbol &symbol) {
+    TokenSymbolId id = FindFixedSymbolId(symbol);
+    if (id != SYMB_ID::NONE || symbol.empty())
+        return id;
+
+    auto &data = GetTokenSymbolTableData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    auto it = data.ids.find(symbol);
+    return it != data.ids.end() ? it->second : SYMB_ID::NONE;
+}
+
+const TokenSymbol& CTokenSymbolTable::GetSymbol(TokenSymbolId id) {
+    auto &data = GetTokenSymbolTableData();
+    if (id <= SYMB_ID::WUSD)
+        return data.symbols[id];
+
+    std::lock_guard<std::mutex> lock(data.mutex);
+    assert(id < data.symbols.size() && "the token symbol id is not interned");
+    return data.symbols[id];
+}
+
 bool CheckCoinRange(const TokenSymbol &symbol, const int64_t amount) {
     if (symbol == SYMB::WICC) {
         return CheckBaseCoinRange(amount);
@@ -41,6 +41,32 @@ struct ComboMoney {
     }
 };
 
+// id of an interned token symbol, valid in the memory of the process only, so never persisted
+typedef uint32_t TokenSymbolId;
+typedef pair<TokenSymbolId, TokenSymbolId> TokenSymbolIdPair;
+
+namespace SYMB_ID {
+    static constexpr TokenSymbolId NONE = 0;   // the empty symbol, the id of the symbols not interned
+    static constexpr TokenSymbolId WICC = 1;
+    static constexpr TokenSymbolId WGRT = 2;
+    static constexpr TokenSymbolId WUSD = 3;
+}
+
+/**
+ * Process wide table of the interned token symbols, for the in-memory indexes keyed by symbols, which
+ * then compare and copy integers. The ids of the system coins are fixed and looked up without lock,
+ * the others are given in the order they are first interned. The db keys keep the symbol strings, the
+ * cache levels must iterate in the same order as the db keys.
+ */
+class CTokenSymbolTable {
+public:
+    // intern the symbol if it is new
+    static TokenSymbolId Intern(const TokenSymbol &symbol);
+    // return SYMB_ID::NONE if the symbol is not interned
+    static TokenSymbolId Find(const TokenSymbol &symbol);
+    static const TokenSymbol& GetSymbol(TokenSymbolId id);
+};
+
 static const unordered_set<string> kCoinTypeSet = {
     SYMB::WICC, SYMB::WGRT, SYMB::WUSD
 };
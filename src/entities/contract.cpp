@@ -5,6 +5,7 @@
 
 #include "contract.h"
 #include "config/const.h"
+#include "crypto/hash.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // class CLuaContract
@@ -38,4 +39,12 @@ bool CUniversalContract::IsValid() {
         return false;
 
     return true;
-}
\ No newline at end of file
+}
+
+const CContractCode &CUniversalContract::GetCodeHandle() const {
+    if (codeHandle.data == nullptr) {
+        codeHandle.data = std::make_shared<const vector<uint8_t>>(code.begin(), code.end());
+        codeHandle.hash = Hash(code.begin(), code.end());
+    }
+    return codeHandle;
+}
@@ -8,10 +8,13 @@
 #define ENTITIES_CONTRACT_H
 
 #include "commons/serialize.h"
+#include "commons/uint256.h"
 #include "config/version.h"
 #include "commons/util/util.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -70,6 +73,17 @@ enum VMType : uint8_t {
     EVM         = 3
 };
 
+/**
+ * The code of a contract in an immutable buffer with its hash, shared by the readers of the contract,
+ * e.g. the wasm module cache, instead of copying the code on each call.
+ */
+struct CContractCode {
+    uint256 hash;
+    std::shared_ptr<const std::vector<uint8_t>> data;
+
+    bool IsEmpty() const { return data == nullptr || data->empty(); }
+};
+
 /**
  * Used for both blockchain tx (new tx only) and levelDB Persistence (both old & new tx)
  *   serialization/deserialization purposes
@@ -108,9 +122,17 @@ public:
         code.clear();
         memo.clear();
         abi.clear();
+        codeHandle = CContractCode();
     }
 
+    // The code handle is made on the first call and shared by the copies of the contract, it must be
+    // reset once the code changes
+    const CContractCode &GetCodeHandle() const;
+    void ResetCodeHandle() { codeHandle = CContractCode(); }
+
     IMPLEMENT_SERIALIZE(
+        if (fRead)
+            codeHandle = CContractCode();
         READWRITE((uint8_t &) vm_type);
         READWRITE(upgradable);
         READWRITE(code);
@@ -127,6 +149,9 @@ public:
         strprintf("memo=%s", memo) + ", " +
         strprintf("abi=%d", abi);
     }
+
+private:
+    mutable CContractCode codeHandle;
 };
 
 #endif  // ENTITIES_CONTRACT_H
\ No newline at end of file
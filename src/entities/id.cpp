@@ -14,8 +14,7 @@ extern CCacheDBManager *pCdMan;
 CRegID::CRegID(const string &strRegID) { SetRegID(strRegID); }
 
 CRegID::CRegID(const vector<uint8_t> &vIn) {
-    assert(vIn.size() == 6);
-    vRegID = vIn;
+    assert(vIn.size() == RAW_SIZE);
     height = 0;
     index  = 0;
     CDataStream ds(vIn, SER_DISK, CLIENT_VERSION);
@@ -23,14 +22,6 @@ CRegID::CRegID(const vector<uint8_t> &vIn) {
     ds >> index;
 }
 
-CRegID::CRegID(const uint32_t heightIn, const uint16_t indexIn) {
-    height = heightIn;
-    index  = indexIn;
-    vRegID.clear();
-    vRegID.insert(vRegID.end(), BEGIN(heightIn), END(heightIn));
-    vRegID.insert(vRegID.end(), BEGIN(indexIn), END(indexIn));
-}
-
 bool IsDigitalString(const string str){
 
     if (str.length() > 10 || str.length() == 0) //int max is 4294967295 can not over 10
@@ -75,16 +66,13 @@ bool CRegID::IsRegIdStr(const string & str) {
 void CRegID::SetRegID(string strRegID) {
     height = 0;
     index  = 0;
-    vRegID.clear();
 
     if (IsSimpleRegIdStr(strRegID)) {
         auto pos = strRegID.find('-');
         height   = atoi(strRegID.substr(0, pos).c_str());
         index    = atoi(strRegID.substr(pos + 1).c_str());
-        vRegID.insert(vRegID.end(), BEGIN(height), END(height));
-        vRegID.insert(vRegID.end(), BEGIN(index), END(index));
     } else if (strRegID.length() == 12) {
-        vRegID = ::ParseHex(strRegID);
+        vector<uint8_t> vRegID = ::ParseHex(strRegID);
 
         if (vRegID.size() > sizeof(height) + sizeof(index)) {
             memcpy(&height, &vRegID[0], sizeof(height));
@@ -96,22 +84,23 @@ void CRegID::SetRegID(string strRegID) {
 }
 
 void CRegID::SetRegID(const vector<uint8_t> &vIn) {
-    assert(vIn.size() == 6);
-    vRegID = vIn;
+    assert(vIn.size() == RAW_SIZE);
     CDataStream ds(vIn, SER_DISK, CLIENT_VERSION);
     ds >> height;
     ds >> index;
 }
 
-const vector<uint8_t> &CRegID::GetRegIdRaw() const {
-    assert(vRegID.size() == 6);
+vector<uint8_t> CRegID::GetRegIdRaw() const {
+    vector<uint8_t> vRegID;
+    vRegID.reserve(RAW_SIZE);
+    vRegID.insert(vRegID.end(), BEGIN(height), END(height));
+    vRegID.insert(vRegID.end(), BEGIN(index), END(index));
     return vRegID;
 }
 
 bool CRegID::Clear() {
     height = 0;
     index  = 0;
-    vRegID.clear();
 
     return true;
 }
@@ -212,6 +201,10 @@ string CUserID::ToDebugString() const {
 }
 
 shared_ptr<CUserID> CUserID::ParseUserId(const string &idStr) {
+    return ParseUserId(idStr, *pCdMan->pAccountCache);
+}
+
+shared_ptr<CUserID> CUserID::ParseUserId(const string &idStr, const CAccountDBCache &accountCache) {
     CRegID regId(idStr);
     if (!regId.IsEmpty())
         return std::make_shared<CUserID>(regId);
@@ -228,7 +221,7 @@ shared_ptr<CUserID> CUserID::ParseUserId(const string &idStr) {
 
     CNickID nickId(idStr) ;
 
-    if( pCdMan->pAccountCache->GetKeyId(nickId, keyId)){
+    if( accountCache.GetKeyId(nickId, keyId)){
         return std::make_shared<CUserID>(keyId);
     }
 
@@ -43,13 +43,23 @@ public:
 
 class CRegIDKey;
 
+/**
+ * The regid is kept as its height and index only, 8 bytes without a heap member, so the ids in the receipts,
+ * the orders, the votes and the account lookups are copied and compared as two integers. The raw bytes of
+ * the contracts are built on request.
+ */
 class CRegID {
 public:
+    static constexpr uint32_t RAW_SIZE = sizeof(uint32_t) + sizeof(uint16_t);
+
     CRegID(const string &strRegID);
     CRegID(const vector<uint8_t> &vIn);
-    CRegID(const uint32_t height = 0, const uint16_t index = 0);
+    constexpr CRegID(const uint32_t heightIn = 0, const uint16_t indexIn = 0): height(heightIn), index(indexIn) {}
 
-    const vector<uint8_t> &GetRegIdRaw() const;
+    // the height and the index in the byte order of the host, as the contracts have the regid
+    vector<uint8_t> GetRegIdRaw() const;
+    // the height and the index in one integer of the same order as the regids
+    inline constexpr uint64_t GetIntValue() const { return ((uint64_t)height << 16) | index; }
 
     void SetRegID(const vector<uint8_t> &vIn);
     CKeyID GetKeyId(const CAccountDBCache &accountCache) const;
@@ -58,15 +68,9 @@ public:
 
     bool IsMature(uint32_t curHeight) const;
 
-    bool operator==(const CRegID &other) const { return (this->height == other.height && this->index == other.index); }
-    bool operator!=(const CRegID &other) const { return (this->height != other.height || this->index != other.index); }
-    bool operator<(const CRegID &other) const {
-        if (this->height == other.height) {
-            return this->index < other.index;
-        } else {
-            return this->height < other.height;
-        }
-    }
+    bool operator==(const CRegID &other) const { return GetIntValue() == other.GetIntValue(); }
+    bool operator!=(const CRegID &other) const { return GetIntValue() != other.GetIntValue(); }
+    bool operator<(const CRegID &other) const { return GetIntValue() < other.GetIntValue(); }
 
     static bool IsSimpleRegIdStr(const string &str);
     static bool IsRegIdStr(const string &str);
@@ -79,16 +83,10 @@ public:
     IMPLEMENT_SERIALIZE(
         READWRITE(VARINT(height));
         READWRITE(VARINT(index));
-        if (fRead) {
-            vRegID.clear();
-            vRegID.insert(vRegID.end(), BEGIN(height), END(height));
-            vRegID.insert(vRegID.end(), BEGIN(index), END(index));
-        }
     )
 private:
     uint32_t height;
     uint16_t index;
-    mutable vector<uint8_t> vRegID;
 
     void SetRegID(string strRegID);
     void SetRegIDByCompact(const vector<uint8_t> &vIn);
@@ -97,8 +95,14 @@ private:
     friend class CRegIDKey;
 };
 
+struct CRegIDHasher {
+    size_t operator()(const CRegID &regid) const noexcept { return std::hash<uint64_t>{}(regid.GetIntValue()); }
+};
+
 class CRegIDKey {
 public:
+    static constexpr uint32_t FIXED_SERIALIZE_SIZE = CFixedUInt32::SIZE + CFixedUInt16::SIZE;
+
     CRegID regid;
 
     CRegIDKey() {}
@@ -161,6 +165,8 @@ public:
 
 public:
     static std::shared_ptr<CUserID> ParseUserId(const string &idStr);
+    // the nickid is looked up in the given cache
+    static std::shared_ptr<CUserID> ParseUserId(const string &idStr, const CAccountDBCache &accountCache);
     static const CUserID NULL_ID;
     static const EnumTypeMap<VarIndex, string> ID_NAME_MAP;
 public:
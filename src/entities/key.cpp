@@ -18,6 +18,46 @@
 static secp256k1_context *secp256k1_context_verify = nullptr;
 static secp256k1_context *secp256k1_context_sign   = nullptr;
 
+/**
+ * The parsed compressed pubkeys of the last signers verified by the thread, the delegates and the
+ * exchange hot wallets sign most txs, so a repeat signer skips the decompression of its point.
+ * Direct mapped by the leading bytes of the x coordinate, the collisions just evict.
+ */
+class CPubKeyParseCache {
+private:
+    static const uint32_t SLOT_COUNT = 64;
+
+    struct CSlot {
+        uint8_t key[CPubKey::COMPRESSED_PUBLIC_KEY_SIZE] = {0};  // 0 marks the empty slot
+        secp256k1_pubkey pubkey;
+    };
+
+    CSlot slots[SLOT_COUNT];
+
+public:
+    bool Parse(const CPubKey &pubKey, secp256k1_pubkey &pubkey) {
+        if (!pubKey.IsCompressed())
+            return secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, pubKey.begin(), pubKey.size());
+
+        uint32_t index;
+        memcpy(&index, pubKey.begin() + 1, sizeof(index));
+        CSlot &slot = slots[index % SLOT_COUNT];
+        if (memcmp(slot.key, pubKey.begin(), sizeof(slot.key)) == 0) {
+            pubkey = slot.pubkey;
+            return true;
+        }
+
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, pubKey.begin(), pubKey.size()))
+            return false;
+
+        memcpy(slot.key, pubKey.begin(), sizeof(slot.key));
+        slot.pubkey = pubkey;
+        return true;
+    }
+};
+
+static thread_local CPubKeyParseCache pubKeyParseCache;
+
 // Check that the sig has a low R value and will be less than 71 bytes
 bool SigHasLowR(const secp256k1_ecdsa_signature *sig) {
     uint8_t compact_sig[64];
@@ -189,6 +229,21 @@ bool CKey::Derive(CKey &keyChild, uint8_t ccChild[32], uint32_t nChild, const ui
 
 CKeyID CPubKey::GetKeyId() const { return CKeyID(Hash160(vch, vch + size())); }
 
+vector<CKeyID> CPubKey::GetKeyIds(const vector<CPubKey> &pubKeys) {
+    vector<const uint8_t *> pin;
+    vector<size_t> len;
+    pin.reserve(pubKeys.size());
+    len.reserve(pubKeys.size());
+    for (const auto &pubKey : pubKeys) {
+        pin.push_back(pubKey.begin());
+        len.push_back(pubKey.size());
+    }
+
+    vector<uint160> hashes(pubKeys.size());
+    Hash160Batch(hashes.data(), pin.data(), len.data(), pubKeys.size());
+    return vector<CKeyID>(hashes.begin(), hashes.end());
+}
+
 uint256 CPubKey::GetHash() const { return Hash(vch, vch + size()); }
 
 bool CPubKey::Verify(const uint256 &hash, const vector<uint8_t> &vchSig) const {
@@ -197,7 +252,7 @@ bool CPubKey::Verify(const uint256 &hash, const vector<uint8_t> &vchSig) const {
 
     secp256k1_pubkey pubkey;
     secp256k1_ecdsa_signature sig;
-    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch, size())) {
+    if (!pubKeyParseCache.Parse(*this, pubkey)) {
         return false;
     }
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
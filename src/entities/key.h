@@ -183,6 +183,8 @@ public:
 
     // Get the KeyID of this public key (hash of its serialization)
     CKeyID GetKeyId() const;
+    // the KeyIDs of the keys in one batch of Hash160, e.g. for the signers of a multisig tx
+    static vector<CKeyID> GetKeyIds(const vector<CPubKey> &pubKeys);
 
     // Get the 256-bit hash of this public key.
     uint256 GetHash() const;
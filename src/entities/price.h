@@ -37,7 +37,7 @@ public:
     uint64_t GetPrice() const { return price; }
     CoinPricePair GetCoinPricePair() const { return coin_price_pair; }
 
-    string ToString() {
+    string ToString() const {
         return strprintf("coin_price_pair:%s:%s, price:%lld", coin_price_pair.first, coin_price_pair.second, price);
     }
 
@@ -66,6 +66,78 @@ public:
     }
 };
 
+/**
+ * The median prices of a block in the median price index, delta encoded against the block before it. A key
+ * record, written every MEDIAN_PRICE_KEY_INTERVAL heights and after a height not indexed, has all the prices,
+ * a delta record the zigzag varint deltas of the changed prices and the pairs dropped. The prices of a height
+ * are rebuilt by applying the records from the key record at or before it.
+ */
+class CMedianPriceRecord {
+public:
+    enum RecordKind : uint8_t { RECORD_NONE = 0, RECORD_KEY = 1, RECORD_DELTA = 2 };
+
+    RecordKind kind = RECORD_NONE;
+    vector<CPricePoint> changes;  // the prices of a key record, the zigzag deltas as the price otherwise
+    vector<CoinPricePair> removed;
+
+public:
+    CMedianPriceRecord() {}
+
+    CMedianPriceRecord(const PriceMap &prevPrices, const PriceMap &prices, bool isKey)
+        : kind(isKey ? RECORD_KEY : RECORD_DELTA) {
+        for (const auto &item : prices) {
+            if (isKey) {
+                changes.emplace_back(item.first, item.second);
+                continue;
+            }
+            auto it = prevPrices.find(item.first);
+            uint64_t prevPrice = (it == prevPrices.end()) ? 0 : it->second;
+            if (it == prevPrices.end() || prevPrice != item.second)
+                changes.emplace_back(item.first, EncodeDelta((int64_t)(item.second - prevPrice)));
+        }
+        if (!isKey) {
+            for (const auto &item : prevPrices) {
+                if (!prices.count(item.first))
+                    removed.push_back(item.first);
+            }
+        }
+    }
+
+    bool IsKey() const { return kind == RECORD_KEY; }
+
+    // turn the prices of the height before into the prices of the record
+    void Apply(PriceMap &prices) const {
+        if (IsKey())
+            prices.clear();
+        for (const auto &pricePair : removed)
+            prices.erase(pricePair);
+        for (const auto &item : changes)
+            prices[item.coin_price_pair] = IsKey() ? item.price
+                                                   : prices[item.coin_price_pair] + (uint64_t)DecodeDelta(item.price);
+    }
+
+    bool IsEmpty() const { return kind == RECORD_NONE; }
+    void SetEmpty() {
+        kind = RECORD_NONE;
+        changes.clear();
+        removed.clear();
+    }
+
+    string ToString() const {
+        return strprintf("kind=%d, changes=%u, removed=%u", kind, changes.size(), removed.size());
+    }
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE_CONVERT(uint8_t, kind);
+        READWRITE(changes);
+        READWRITE(removed);
+    )
+
+private:
+    static uint64_t EncodeDelta(int64_t delta) { return ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63); }
+    static int64_t DecodeDelta(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+};
+
 inline const string& GetPriceBaseSymbol(const CoinPricePair &pricePair) {
     return std::get<0>(pricePair);
 }
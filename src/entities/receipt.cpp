@@ -0,0 +1,70 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "receipt.h"
+
+#include "config/const.h"
+
+#include <memory>
+
+// the buffers kept by a thread for its next txs
+static const size_t MAX_POOLED_RECEIPT_BUFFERS = 4;
+// a buffer grown beyond it is freed instead of kept, e.g. after a dex settle of many deals
+static const size_t MAX_POOLED_RECEIPT_CAPACITY = 256;
+
+static vector<unique_ptr<vector<CReceipt>>> &GetThreadReceiptBuffers() {
+    thread_local vector<unique_ptr<vector<CReceipt>>> buffers;
+    return buffers;
+}
+
+const vector<TokenSymbol> &CTxReceipts::GetInternedSymbols() {
+    static const vector<TokenSymbol> symbols = {
+        SYMB::WICC, SYMB::WGRT, SYMB::WUSD, SYMB::WCNY, SYMB::WBTC, SYMB::WETH, SYMB::WEOS,
+        SYMB::USD,  SYMB::CNY,  SYMB::EUR,  SYMB::BTC,  SYMB::USDT, SYMB::GOLD, SYMB::KWH,
+    };
+    return symbols;
+}
+
+bool CTxReceipts::GetInternedSymbol(const TokenSymbol &symbol, uint8_t &index) {
+    const auto &symbols = GetInternedSymbols();
+    for (size_t i = 0; i < symbols.size(); i++) {
+        if (symbols[i] == symbol) {
+            index = (uint8_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+string CTxReceipts::ToString() const {
+    string str;
+    for (const auto &receipt : receipts)
+        str += (str.empty() ? "" : ", ") + strprintf("{%s}", receipt.ToString());
+    return str;
+}
+
+CReceiptBuffer::~CReceiptBuffer() {
+    if (pReceipts == nullptr)
+        return;
+
+    unique_ptr<vector<CReceipt>> spReceipts(pReceipts);
+    auto &buffers = GetThreadReceiptBuffers();
+    if (buffers.size() < MAX_POOLED_RECEIPT_BUFFERS && spReceipts->capacity() <= MAX_POOLED_RECEIPT_CAPACITY) {
+        spReceipts->clear();
+        buffers.push_back(std::move(spReceipts));
+    }
+}
+
+vector<CReceipt> &CReceiptBuffer::Get() {
+    if (pReceipts == nullptr) {
+        auto &buffers = GetThreadReceiptBuffers();
+        if (buffers.empty()) {
+            pReceipts = new vector<CReceipt>();
+        } else {
+            pReceipts = buffers.back().release();
+            buffers.pop_back();
+        }
+    }
+    return *pReceipts;
+}
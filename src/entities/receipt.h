@@ -123,4 +123,189 @@ public:
     }
 };
 
+/**
+ * The receipts of a tx as stored in the receipt db, in a compact encoding: the regids are written as their
+ * varints without the length of the uid, the pubkeys as their keyids, which give the same address, and the
+ * common symbols as their index in the interned symbols. A record starts with COMPACT_MARK, which is never
+ * the first byte of a vector, so the legacy records, a vector of CReceipt, are still read.
+ */
+class CTxReceipts {
+public:
+    vector<CReceipt> receipts;
+
+public:
+    CTxReceipts() {}
+    explicit CTxReceipts(const vector<CReceipt> &receiptsIn) : receipts(receiptsIn) {}
+
+    bool IsEmpty() const { return receipts.empty(); }
+    void SetEmpty() { receipts.clear(); }
+    string ToString() const;
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        unsigned int size = sizeof(uint8_t) + GetSizeOfCompactSize(receipts.size());
+        for (const auto &receipt : receipts) {
+            uint8_t symbolIndex;
+            size += sizeof(uint8_t) + GetUidSize(receipt.from_uid, nType, nVersion) +
+                    GetUidSize(receipt.to_uid, nType, nVersion);
+            size += GetInternedSymbol(receipt.coin_symbol, symbolIndex)
+                        ? sizeof(uint8_t)
+                        : ::GetSerializeSize(receipt.coin_symbol, nType, nVersion);
+            size += GetSizeOfVarInt(receipt.coin_amount) + GetSizeOfVarInt((uint16_t)receipt.code);
+        }
+        return size;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream &s, int nType, int nVersion) const {
+        s << COMPACT_MARK;
+        WriteCompactSize(s, receipts.size());
+        for (const auto &receipt : receipts) {
+            uint8_t symbolIndex;
+            bool fInterned = GetInternedSymbol(receipt.coin_symbol, symbolIndex);
+            uint8_t flags  = GetUidKind(receipt.from_uid) | (GetUidKind(receipt.to_uid) << 2) |
+                            (fInterned ? FLAG_INTERNED_SYMBOL : 0);
+            s << flags;
+            WriteUid(s, receipt.from_uid, nType, nVersion);
+            WriteUid(s, receipt.to_uid, nType, nVersion);
+            if (fInterned)
+                s << symbolIndex;
+            else
+                s << receipt.coin_symbol;
+            WriteVarInt(s, receipt.coin_amount);
+            WriteVarInt(s, (uint16_t)receipt.code);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersion) {
+        uint8_t mark;
+        s >> mark;
+        receipts.clear();
+        if (mark != COMPACT_MARK) {
+            // the compact size of the legacy vector, whose first byte is read
+            uint64_t count = mark;
+            if (mark == 253) {
+                uint16_t count16;
+                s >> count16;
+                count = count16;
+            } else if (mark == 254) {
+                uint32_t count32;
+                s >> count32;
+                count = count32;
+            }
+            receipts.resize(count);
+            for (auto &receipt : receipts)
+                s >> receipt;
+            return;
+        }
+
+        receipts.resize(ReadCompactSize(s));
+        for (auto &receipt : receipts) {
+            uint8_t flags;
+            s >> flags;
+            ReadUid(s, flags & UID_KIND_MASK, receipt.from_uid, nType, nVersion);
+            ReadUid(s, (flags >> 2) & UID_KIND_MASK, receipt.to_uid, nType, nVersion);
+            if (flags & FLAG_INTERNED_SYMBOL) {
+                uint8_t symbolIndex;
+                s >> symbolIndex;
+                if (symbolIndex >= GetInternedSymbols().size())
+                    throw ios_base::failure("CTxReceipts::Unserialize, invalid interned symbol");
+                receipt.coin_symbol = GetInternedSymbols()[symbolIndex];
+            } else {
+                s >> receipt.coin_symbol;
+            }
+            receipt.coin_amount = ReadVarInt<Stream, uint64_t>(s);
+            receipt.code        = (ReceiptCode)ReadVarInt<Stream, uint16_t>(s);
+        }
+    }
+
+private:
+    static const uint8_t COMPACT_MARK         = 0xFF;
+    static const uint8_t UID_KIND_MASK        = 0x03;
+    static const uint8_t FLAG_INTERNED_SYMBOL = 0x10;
+
+    enum UidKind : uint8_t { UID_NULL = 0, UID_REGID = 1, UID_KEYID = 2, UID_OTHER = 3 };
+
+    // the symbols written as their index, only appended to as the index is stored
+    static const vector<TokenSymbol> &GetInternedSymbols();
+    static bool GetInternedSymbol(const TokenSymbol &symbol, uint8_t &index);
+
+    static uint8_t GetUidKind(const CUserID &uid) {
+        if (uid.IsEmpty())
+            return UID_NULL;
+        if (uid.is<CRegID>())
+            return UID_REGID;
+        if (uid.is<CKeyID>() || uid.is<CPubKey>())
+            return UID_KEYID;
+        return UID_OTHER;
+    }
+
+    static unsigned int GetUidSize(const CUserID &uid, int nType, int nVersion) {
+        switch (GetUidKind(uid)) {
+            case UID_NULL:  return 0;
+            case UID_REGID: return GetSizeOfVarInt(uid.get<CRegID>().GetHeight()) +
+                                   GetSizeOfVarInt(uid.get<CRegID>().GetIndex());
+            case UID_KEYID: return CUserID::FlagKeyID;
+            default:        return ::GetSerializeSize(uid, nType, nVersion);
+        }
+    }
+
+    template <typename Stream>
+    static void WriteUid(Stream &s, const CUserID &uid, int nType, int nVersion) {
+        switch (GetUidKind(uid)) {
+            case UID_NULL:
+                break;
+            case UID_REGID:
+                WriteVarInt(s, uid.get<CRegID>().GetHeight());
+                WriteVarInt(s, uid.get<CRegID>().GetIndex());
+                break;
+            case UID_KEYID:
+                s << (uid.is<CKeyID>() ? uid.get<CKeyID>() : uid.get<CPubKey>().GetKeyId());
+                break;
+            default:
+                s << uid;
+        }
+    }
+
+    template <typename Stream>
+    static void ReadUid(Stream &s, uint8_t kind, CUserID &uid, int nType, int nVersion) {
+        switch (kind) {
+            case UID_NULL:
+                uid.SetEmpty();
+                break;
+            case UID_REGID: {
+                uint32_t height = ReadVarInt<Stream, uint32_t>(s);
+                uint16_t index  = ReadVarInt<Stream, uint16_t>(s);
+                uid = CRegID(height, index);
+                break;
+            }
+            case UID_KEYID: {
+                CKeyID keyId;
+                s >> keyId;
+                uid = keyId;
+                break;
+            }
+            default:
+                s >> uid;
+        }
+    }
+};
+
+/**
+ * A vector of receipts taken from the pool of the thread and given back cleared, so the txs executed by
+ * a thread reuse the capacity of the vectors instead of allocating one per tx. A copy starts empty.
+ */
+class CReceiptBuffer {
+public:
+    CReceiptBuffer() {}
+    CReceiptBuffer(const CReceiptBuffer &) {}
+    CReceiptBuffer &operator=(const CReceiptBuffer &) { return *this; }
+    ~CReceiptBuffer();
+
+    vector<CReceipt> &Get();
+
+private:
+    vector<CReceipt> *pReceipts = nullptr;
+};
+
 #endif  // ENTITIES_RECEIPT_H
\ No newline at end of file
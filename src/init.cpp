@@ -11,22 +11,47 @@
 #include "logging.h"
 #include "init.h"
 #include "config/configuration.h"
+#include "chain/blockreplay.h"
+#include "chain/blocktrace.h"
+#include "chain/txlatency.h"
+#include "chain/txexecstats.h"
 #include "p2p/addrman.h"
+#include "p2p/socketevents.h"
+#include "p2p/txadmission.h"
 
+#include "rpc/core/httpserver.h"
+#include "rpc/core/rpcevents.h"
+#include "rpc/core/rest.h"
 #include "rpc/core/rpcserver.h"
 #include "vm/luavm/lua/lua.h"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
+#include "wallet/walletkeypool.h"
+#include "wallet/walletnotify.h"
+#include "wallet/walletrescan.h"
 #include "main.h"
 #include "miner/miner.h"
+#include "miner/pbftmanager.h"
 #include "net.h"
+#include "taskscheduler.h"
 #include "persistence/blockdb.h"
 #include "persistence/accountdb.h"
 #include "persistence/txdb.h"
+#include "persistence/memcachesnapshot.h"
+#include "persistence/statesnapshot.h"
+#include "persistence/wasmcachesnapshot.h"
+#include "vm/wasm/wasm_profiler.hpp"
 #include "persistence/contractdb.h"
+#include "persistence/blockundo.h"
+#include "persistence/mempoolsnapshot.h"
+#include "persistence/statediff.h"
+#include "persistence/statedump.h"
+#include "persistence/stateverify.h"
 #include "tx/tx.h"
 #include "commons/util/util.h"
+#include "commons/util/threadaffinity.h"
 #include "commons/util/time.h"
+#include "crypto/sha256.h"
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -69,6 +94,7 @@ CWallet *pWalletMain;
 static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 extern void wasm_code_cache_free();
+extern void wasm_code_cache_set_capacity(size_t capacity);
 
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
@@ -148,10 +174,24 @@ void Shutdown() {
         if (pWalletMain) {
             pWalletMain->SetBestChain(chainActive.GetLocator());
             bitdb.Flush(true);
+            LOCK(pWalletMain->cs_wallet);
+            pWalletMain->txLog.Flush();
         }
 
+        if (SysCfg().GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL) && CMemPoolSnapshot::IsLoaded() &&
+            !CMemPoolSnapshot().Write(mempool))
+            LogPrint(BCLog::ERROR, "Shutdown() : failed to write the mempool\n");
+
+        CStateSnapshot::Release();
         if (pCdMan != nullptr) {
-            pCdMan->Flush();
+            // the block files are synced first, so the best block of the flush is on disk
+            GetDiskFileWriter().Close();
+            // the snapshot is bound to the tip, it is useless if the tip state is not flushed
+            if (pCdMan->Flush() && !CMemCacheSnapshot().Write(chainActive.Tip(), SysCfg().GetTxCacheHeight(),
+                                                              PRICE_POINT_CACHE_HEIGHT, *pCdMan->pTxCache,
+                                                              *pCdMan->pPpCache))
+                LogPrint(BCLog::ERROR, "Shutdown() : failed to write the memory cache snapshot\n");
+
             delete pCdMan;
             pCdMan = nullptr;
         }
@@ -167,9 +207,16 @@ void Shutdown() {
     globalVerifyHandle.reset();
     ECC_Stop();
 
+    if (!CWasmCacheSnapshot().Write())
+        LogPrint(BCLog::ERROR, "Shutdown() : failed to write the wasm cache snapshot\n");
+    if (wasm::wasm_profiler::instance().enabled() &&
+        !wasm::wasm_profiler::instance().dump((GetDataDir() / "wasmprofile.folded").string()))
+        LogPrint(BCLog::ERROR, "Shutdown() : failed to dump the wasm profile\n");
     wasm_code_cache_free();
+    GetTaskScheduler().Stop();
 
     LogPrint(BCLog::INFO, "Shutdown() : done\n");
+    LogInstance().StopAsync();
 }
 
 //
@@ -205,24 +252,65 @@ string HelpMessage() {
     string strUsage = _("Options:") + "\n";
     strUsage += "  -?                     " + _("This help message") + "\n";
     strUsage += "  -alertnotify=<cmd>     " + _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)") + "\n";
+    strUsage += "  -assumefinalized       " + strprintf(_("Skip the signatures of the blocks under a finality certificate of the delegates during the initial download (default: %u)"), DEFAULT_ASSUME_FINALIZED) + "\n";
     strUsage += "  -blocknotify=<cmd>     " + _("Execute command when the best block changes (%s in cmd is replaced by block hash)") + "\n";
     strUsage += "  -checkblocks=<n>       " + _("How many blocks to check at startup (default: 288, 0 = all)") + "\n";
     strUsage += "  -checklevel=<n>        " + _("How thorough the block verification of -checkblocks is (0-4, default: 3)") + "\n";
+    strUsage += "  -checkthreads=<n>      " + strprintf(_("Read and check the blocks of -checkblocks and the accounts of -checkstate on <n> threads (0 = all cores but one, max: %d, default: 0)"), MAX_CHECK_THREADS) + "\n";
+    strUsage += "  -checkstate            " + strprintf(_("Verify the balances and the indexes of the accounts in the background after startup (default: %u)"), DEFAULT_CHECK_STATE) + "\n";
     strUsage += "  -conf=<file>           " + _("Specify configuration file (default: ") + IniCfg().GetCoinName() + ".conf)" + "\n";
 #if !defined(WIN32)
     strUsage += "  -daemon                " + _("Run in the background as a daemon and accept commands") + "\n";
 #endif
     strUsage += "  -datadir=<dir>         " + _("Specify data directory") + "\n";
+    strUsage += "  -dbbackend=<name>      " + strprintf(_("Store the databases in leveldb, or in rocksdb as the column families of one db in blocks/rocksdb, when built with it (%s, %s, default: %s)"), DB_BACKEND_LEVELDB, DB_BACKEND_ROCKSDB, DB_BACKEND_LEVELDB) + "\n";
     strUsage += "  -dbcache=<n>           " + strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE, MAX_DB_CACHE, DEFAULT_DB_CACHE) + "\n";
+    strUsage += "  -<db>.cacheshare=<n>   " + _("Relative share of the -dbcache budget given to the block cache of database <db> (accounts, contracts, dexes, ...)") + "\n";
+    strUsage += "  -dbcompactionthreads=<n> " + strprintf(_("Compact the rocksdb of -dbbackend on <n> threads (0 = all cores, max: %d, default: 0)"), MAX_DB_COMPACTION_THREADS) + "\n";
+    strUsage += "  -singlestatedb         " + strprintf(_("Keep the chain state dbs in the one db of blocks/state, whose flushes are written atomically and which shares one block cache, tuned by -state.<option>, changing it needs -reindex (default: %u)"), DEFAULT_SINGLE_STATE_DB) + "\n";
+    strUsage += "  -dbreadcache=<n>       " + strprintf(_("Keep up to <n> MiB of the recently used db values in memory across the flushes, split by the cache shares, 0 to disable (default: %d)"), DEFAULT_DB_READ_CACHE) + "\n";
+    strUsage += "  -dbwarmup              " + strprintf(_("Read the hot keys of the dbs, e.g. the sysparams, the delegates and the active dex orders, into their block caches in the background at startup (default: %u)"), DEFAULT_DB_WARMUP) + "\n";
+    strUsage += "  -<db>.writebuffer=<n>  " + _("Set the write buffer size of database <db> in kilobytes") + "\n";
+    strUsage += "  -<db>.bloombits=<n>    " + strprintf(_("Set the bloom filter bits per key of database <db> (0 to %d, default: %d)"), MAX_DB_BLOOM_BITS, DEFAULT_DB_BLOOM_BITS) + "\n";
+    strUsage += "  -<db>.maxopenfiles=<n> " + strprintf(_("Set the max open files of database <db> (default: %d)"), DEFAULT_DB_MAX_OPEN_FILES) + "\n";
+    strUsage += "  -<db>.compression      " + _("Compress the tables of database <db> with snappy (default: 0)") + "\n";
+    strUsage += "  -<db>.restartinterval=<n> " + strprintf(_("Set the keys between the restart points of the table blocks of database <db>, which share their common prefix (1 to %d, default: %d, contracts: %d)"), MAX_DB_RESTART_INTERVAL, DEFAULT_DB_RESTART_INTERVAL, CONTRACT_DB_RESTART_INTERVAL) + "\n";
+    strUsage += "  -parallelconnect=<n>   " + strprintf(_("Execute block transactions speculatively on <n> threads (0 = all cores, max: %d, default: 1)"), MAX_PARALLEL_CONNECT_THREADS) + "\n";
+    strUsage += "  -prefetchthreads=<n>   " + strprintf(_("Read the accounts, CDPs and orders named by the transactions of a block on <n> threads before connecting it (0 = off, max: %d, default: %d)"), MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS) + "\n";
+    strUsage += "  -cpuaffinity=<pools>   " + _("Bind the threads of the pools to cpus, e.g. validation:0-15,net:16-19,rpc:node1, where a pool of validation, net, rpc, db or tasks takes a cpu, a range of cpus or the cpus of a NUMA node and is repeated for more (Linux only)") + "\n";
+    strUsage += "  -hugepages             " + strprintf(_("Back the wasm linear memories with transparent huge pages, the caches follow the allocator, e.g. MALLOC_CONF=thp:always with jemalloc (default: %u)"), DEFAULT_HUGE_PAGES) + "\n";
+    strUsage += "  -blockfilemaps=<n>     " + strprintf(_("Read blocks through memory mappings of up to <n> block and undo files (0 = disable, max: %d, default: %d)"), MAX_BLOCK_FILE_MAPPINGS, DEFAULT_BLOCK_FILE_MAPPINGS) + "\n";
+    strUsage += "  -iouring               " + strprintf(_("Write the block and undo files asynchronously through io_uring, completed before each flush of the chain state (Linux only, default: %u)"), DEFAULT_IO_URING) + "\n";
+    strUsage += "  -prune=<n>             " + strprintf(_("Remove the old block and undo files to keep them under <n> MiB, the blocks near the tip and above the global finality are kept, requires -disablewallet (0 = disable, min: %u, default: %u)"), MIN_PRUNE_TARGET_MB, DEFAULT_PRUNE_TARGET_MB) + "\n";
+    strUsage += "  -loadstate=<file>      " + _("Start from the chain state dumped by dumpstate on another node, into a data directory without blocks") + "\n";
+    strUsage += "  -loadstatehash=<hash>  " + _("The commitment the state of -loadstate must match, as returned by dumpstate on a trusted node") + "\n";
+    strUsage += "  -statediff=<file>      " + _("Append the state changes of the connected and disconnected blocks to <file>, which may be a fifo of an indexer") + "\n";
+    strUsage += "  -undocompress          " + strprintf(_("Compress the undo records with zlib (default: %u)"), DEFAULT_UNDO_COMPRESS) + "\n";
+    strUsage += "  -importthreads=<n>     " + strprintf(_("Deserialize and check the blocks imported by -reindex or -loadblock on <n> threads (0 = all cores but one, max: %d, default: 0)"), MAX_IMPORT_THREADS) + "\n";
+    strUsage += "  -par=<n>               " + strprintf(_("Set the number of signature verification threads (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), MAX_SIGCHECK_THREADS, DEFAULT_SIGCHECK_THREADS) + "\n";
+    strUsage += "  -schedulerthreads=<n>  " + strprintf(_("Run the parallel jobs of the node, e.g. the block prefetch, the block index loading and the db flush, on a shared pool of <n> threads (0 = all cores, max: %d, default: 0)"), MAX_SCHEDULER_THREADS) + "\n";
+    strUsage += "  -loadthreads=<n>       " + strprintf(_("Decode and link the block index on <n> threads at startup (0 = all cores but one, max: %d, default: 0)"), MAX_LOAD_THREADS) + "\n";
     strUsage += "  -loadblock=<file>      " + _("Imports blocks from external blk000??.dat file") + " " + _("on startup") + "\n";
+    strUsage += "  -replayblocks=<from>:<to> " + _("Connect the blocks <from> to <to> of -loadblock or -reindex without networking, write the time of each block and the time and db accesses by tx type, VM and key prefix to replay-<from>-<to>.json in the data directory and shut down") + "\n";
     strUsage += "  -pid=<file>            " + _("Specify pid file (default: coin.pid)") + "\n";
     strUsage += "  -reindex               " + _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup") + "\n";
+    strUsage += "  -maxmempool=<n>        " + strprintf(_("Keep the transaction memory pool below <n> megabytes, evicting the lowest priority transactions (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE) + "\n";
+    strUsage += "  -mempoolexpiry=<n>     " + strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY) + "\n";
+    strUsage += "  -persistmempool        " + strprintf(_("Save the mempool on shutdown and load it on startup (default: %u)"), DEFAULT_PERSIST_MEMPOOL) + "\n";
     strUsage += "  -txindex               " + _("Maintain a full transaction index (default: 0)") + "\n";
+    strUsage += "  -addressindex          " + _("Maintain an index of the txids by address, used by getaddresstxids (default: 0)") + "\n";
+    strUsage += "  -blockfilterindex      " + _("Maintain compact filters of the ids involved in each block, served to light wallets and by getblockfilter (default: 0)") + "\n";
+    strUsage += "  -medianpriceindex      " + _("Maintain an index of the median prices by height, used by getmedianpricehistory (default: 0)") + "\n";
     strUsage += "  -logfailures           " + _("Log failures into level db in detail (default: 0)") + "\n";
     strUsage += "  -genreceipt               " + _("Whether generate receipt(default: 0)") + "\n";
+    strUsage += "  -receiptretention=<n>  " + strprintf(_("Keep the receipts of the last <n> blocks with -genreceipt, older ones are erased as blocks connect (0 = all, default: %d)"), DEFAULT_RECEIPT_RETENTION) + "\n";
+    strUsage += "  -logfailuresretention=<n> " + strprintf(_("Keep the failures of the last <n> blocks with -logfailures (0 = all, default: %d)"), DEFAULT_LOG_FAILURES_RETENTION) + "\n";
+    strUsage += "  -wasmtraces            " + strprintf(_("Store the traces of the wasm transactions for gettxtrace, in the compressed traces database (default: %u)"), DEFAULT_WASM_TRACES) + "\n";
+    strUsage += "  -wasmtracesmaxsize=<n> " + strprintf(_("Erase the traces of the oldest blocks once the stored traces exceed <n> MiB (0 = unbounded, default: %d)"), DEFAULT_WASM_TRACES_MAX_SIZE) + "\n";
 
     strUsage += "\n" + _("Connection options:") + "\n";
     strUsage += "  -addnode=<ip>          " + _("Add a node to connect to and attempt to keep the connection open") + "\n";
+    strUsage += "  -prioritypeer=<ip>     " + _("Keep a dedicated low latency connection to a delegate node, its blocks and pbft messages go first") + "\n";
     strUsage += "  -banscore=<n>          " + _("Threshold for disconnecting misbehaving peers (default: 100)") + "\n";
     strUsage += "  -bantime=<n>           " + _("Number of seconds to keep misbehaving peers from reconnecting (default: 86400)") + "\n";
     strUsage += "  -bind=<addr>           " + _("Bind to given address and always listen on it. Use [host]:port notation for IPv6") + "\n";
@@ -243,6 +331,15 @@ string HelpMessage() {
     strUsage += "  -ipserver=<server>     " + _("IP Reporting Service") + "\n";
     strUsage += "  -seednode=<ip>         " + _("Connect to a node to retrieve peer addresses, and disconnect") + "\n";
     strUsage += "  -socks=<n>             " + _("Select SOCKS version for -proxy (4 or 5, default: 5)") + "\n";
+    strUsage += "  -luastepmetering       " + _("Check the Lua contract fuel on every instruction instead of on calls, loops and returns, to verify the two agree (default: 0)") + "\n";
+    strUsage += "  -wasmprofile           " + _("Profile the wasm contracts, see getwasmprofile, and dump the folded stacks to wasmprofile.folded on shutdown (default: 0)") + "\n";
+    strUsage += "  -wasmcachesize=<n>     " + strprintf(_("Keep <n> compiled wasm contracts in memory, they are saved to wasmcache.dat on shutdown (default: %d)"), DEFAULT_WASM_MODULE_CACHE_SIZE) + "\n";
+    strUsage += "  -txinvinterval=<n>     " + strprintf(_("Announce txs to a peer in batches every <n> milliseconds on average, twice it to inbound peers (default: %d)"), DEFAULT_TX_INV_INTERVAL) + "\n";
+    strUsage += "  -p2pcompress           " + strprintf(_("Exchange the block, tx and headers messages compressed with the peers supporting it (default: %u)"), DEFAULT_P2P_COMPRESS) + "\n";
+    strUsage += "  -prevalidationrelay    " + strprintf(_("Push a new block of the scheduled producer to the compact block and header peers before validating it (default: %u)"), DEFAULT_PREVALIDATION_RELAY) + "\n";
+    strUsage += "  -maxtxinvrate=<n>      " + strprintf(_("Announce at most <n> txs per second to a peer, the rest waits for the next batches (default: %d)"), DEFAULT_MAX_TX_INV_RATE) + "\n";
+    strUsage += "  -msghandlers=<n>       " + strprintf(_("Process peer messages on <n> threads, a peer is served by one of them (max: %d, default: %d or the number of cores if less)"), MAX_MESSAGE_HANDLER_THREADS, DEFAULT_MESSAGE_HANDLER_THREADS) + "\n";
+    strUsage += "  -socketevents=<mode>   " + _("Wait for peer socket events with <mode> (epoll or select, default: epoll on Linux, else select)") + "\n";
     strUsage += "  -timeout=<n>           " + _("Specify connection timeout in milliseconds (default: 5000)") + "\n";
 #ifdef USE_UPNP
 #if USE_UPNP
@@ -257,9 +354,10 @@ string HelpMessage() {
     strUsage += "  -disablewallet         " + _("Do not load the wallet and disable wallet RPC calls") + "\n";
     strUsage += "  -genblock              " + _("Generate blocks (default: 0)") + "\n";
     strUsage += "  -genblocklimit=<n>     " + _("Set the processor limit for when generation is on (-1 = unlimited, default: -1)") + "\n";
-    strUsage += "  -keypool=<n>           " + _("Set key pool size to <n> (default: 100)") + "\n";
+    strUsage += "  -keypool=<n>           " + strprintf(_("Set key pool size to <n> (default: %u)"), DEFAULT_KEYPOOL_SIZE) + "\n";
     strUsage += "  -paytxfee=<amt>        " + _("Fee per kB to add to transactions you send") + "\n";
     strUsage += "  -rescan                " + _("Rescan the block chain for missing wallet transactions") + " " + _("on startup") + "\n";
+    strUsage += "  -rescanthreads=<n>     " + strprintf(_("Rescan the blocks for the wallet on <n> threads (0 = all cores but one, max: %d, default: 0)"), MAX_RESCAN_THREADS) + "\n";
     strUsage += "  -salvagewallet         " + _("Attempt to recover private keys from a corrupt wallet.dat") + " " + _("on startup") + "\n";
     strUsage += "  -spendzeroconfchange   " + _("Spend unconfirmed change when sending transactions (default: 1)") + "\n";
     strUsage += "  -upgradewallet         " + _("Upgrade wallet to latest format") + " " + _("on startup") + "\n";
@@ -283,11 +381,17 @@ string HelpMessage() {
     strUsage += " addrman, alert, coindb, db, lock, rand, rpc, selectcoins, mempool, net";
     strUsage += "  -help-debug            " + _("Show all debugging options (usage: --help -help-debug)") + "\n";
     strUsage += "  -logtimestamps         " + _("Prepend debug output with timestamp (default: 1)") + "\n";
+    strUsage += "  -logasync              " + strprintf(_("Write the debug output on a background thread, the categories of -debug are formatted there (default: %u)"), DEFAULT_LOGASYNC) + "\n";
+    strUsage += "  -logasyncbuffer=<n>    " + strprintf(_("Queue up to <n> records per thread in the async mode, the -debug records beyond are dropped (default: %d)"), DEFAULT_LOGASYNC_BUFFER) + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
         strUsage += "  -limitfreerelay=<n>    " + _("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:15)") + "\n";
-        strUsage += "  -maxsigcachesize=<n>   " + _("Limit size of signature cache to <n> entries (default: 50000)") + "\n";
+        strUsage += "  -maxsigcachesize=<n>   " + strprintf(_("Limit size of signature cache to <n> MiB (default: %d)"), DEFAULT_MAX_SIG_CACHE_SIZE) + "\n";
     }
     strUsage += "  -logprinttoconsole     " + _("Send trace/debug info to console instead of debug.log file") + "\n";
+    strUsage += "  -lockprofile           " + strprintf(_("Record the wait and hold times of the LOCK sites, see getlockstats (default: %u)"), DEFAULT_LOCK_PROFILE) + "\n";
+    strUsage += "  -blocktraces=<n>       " + strprintf(_("Keep the time breakdown of the last <n> blocks connected, see getblocktraces, 0 to disable (default: %d)"), DEFAULT_BLOCK_TRACES) + "\n";
+    strUsage += "  -txlatencytraces=<n>   " + strprintf(_("Keep the time of each stage from the submission or the first receipt to the finality of the last <n> txs, see gettxlatency, 0 to disable (default: %d)"), DEFAULT_TX_LATENCY_TRACES) + "\n";
+    strUsage += "  -txstats=<n>           " + strprintf(_("Keep the execution time and db accesses of the last <n> txs connected, see gettxdetail verbose, 0 to disable (default: %d)"), DEFAULT_TX_STATS) + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
         strUsage += "  -printblock=<hash>     " + _("Print block on startup, if found in block index") + "\n";
         strUsage += "  -printblocktree        " + _("Print block tree on startup (default: 0)") + "\n";
@@ -301,6 +405,8 @@ string HelpMessage() {
     strUsage += "  -nettype=<network>     " + _("Specify network type: main/test/regtest (default: main)") + "\n";
 
     strUsage += "\n" + _("Block creation options:") + "\n";
+    strUsage += "  -adaptivepack          " + strprintf(_("Stop packing a block by the time of the recent blocks produced, instead of 1s before the end of the slot (default: %u)"), DEFAULT_ADAPTIVE_PACK) + "\n";
+    strUsage += "  -prepack               " + strprintf(_("Pack the block of the coming slot of the delegate on the tip before the slot starts (default: %u)"), DEFAULT_BLOCK_PREPACK) + "\n";
     strUsage += "  -blockmaxsize=<n>      " + strprintf(_("Set maximum block size in bytes (default: %d)"), DEFAULT_BLOCK_MAX_SIZE) + "\n";
 
     strUsage += "\n" + _("RPC server options:") + "\n";
@@ -310,6 +416,12 @@ string HelpMessage() {
     strUsage += "  -rpcport=<port>        " + _("Listen for JSON-RPC connections on <port> (default: 8332 or testnet: 18332)") + "\n";
     strUsage += "  -rpcallowip=<ip>       " + _("Allow JSON-RPC connections from specified IP address") + "\n";
     strUsage += "  -rpcthreads=<n>        " + _("Set the number of threads to service RPC calls (default: 4)") + "\n";
+    strUsage += "  -rpccompress=<n>       " + strprintf(_("Compress the RPC replies of at least <n> bytes with gzip or deflate when the client accepts it, 0 to disable (default: %d)"), DEFAULT_HTTP_COMPRESS_SIZE) + "\n";
+    strUsage += "  -rpccachesize=<n>      " + strprintf(_("Cache the results of the finalized block and tx queries in <n> MiB, 0 to disable (default: %d)"), DEFAULT_RPC_CACHE_SIZE) + "\n";
+    strUsage += "  -rpceventsubscribers=<n> " + strprintf(_("Max subscribers of the event stream at /events, 0 to disable (default: %d)"), DEFAULT_RPC_EVENT_SUBSCRIBERS) + "\n";
+    strUsage += "  -rpceventbacklog=<n>   " + strprintf(_("Disconnect an event subscriber falling behind by more than <n> bytes (default: %d)"), DEFAULT_RPC_EVENT_BACKLOG) + "\n";
+    strUsage += "  -rest                  " + strprintf(_("Accept the REST requests of the raw blocks, headers, txs and accounts at /rest/ (default: %u)"), DEFAULT_REST_ENABLE) + "\n";
+    strUsage += "  -metrics               " + strprintf(_("Serve the node metrics in the Prometheus text format at /metrics (default: %u)"), DEFAULT_METRICS_ENABLE) + "\n";
 
     strUsage += "\n" + _("RPC SSL options: (see the Coin Wiki for SSL setup instructions)") + "\n";
     strUsage += "  -rpcssl                                  " + _("Use OpenSSL (https) for JSON-RPC connections") + "\n";
@@ -334,6 +446,12 @@ struct CImportingNow {
     }
 };
 
+// whether the last block of -replayblocks is connected
+static bool IsReplayDone() {
+    LOCK(cs_main);
+    return blockReplay.IsActive() && chainActive.Height() >= blockReplay.GetTo();
+}
+
 void ThreadImport(vector<boost::filesystem::path> vImportFiles) {
     RenameThread("coin-loadblk");
 
@@ -341,7 +459,7 @@ void ThreadImport(vector<boost::filesystem::path> vImportFiles) {
     if (SysCfg().IsReindex()) {
         CImportingNow imp;
         int32_t nFile = 0;
-        while (true) {
+        while (!IsReplayDone()) {
             CDiskBlockPos pos(nFile, 0);
             FILE *file = OpenBlockFile(pos, true);
             if (!file)
@@ -351,11 +469,14 @@ void ThreadImport(vector<boost::filesystem::path> vImportFiles) {
             LoadExternalBlockFile(file, &pos);
             nFile++;
         }
-        pCdMan->pBlockCache->WriteReindexing(false);
-        SysCfg().SetReIndex(false);
-        LogPrint(BCLog::INFO, "Reindexing finished\n");
-        // To avoid ending up in a situation without genesis block, re-try initializing (no-op if reindexing worked):
-        InitBlockIndex();
+        // a replay which stops early leaves the rest of the files to the next reindex
+        if (!IsReplayDone()) {
+            pCdMan->pBlockCache->WriteReindexing(false);
+            SysCfg().SetReIndex(false);
+            LogPrint(BCLog::INFO, "Reindexing finished\n");
+            // To avoid ending up in a situation without genesis block, re-try initializing (no-op if reindexing worked):
+            InitBlockIndex();
+        }
     }
 
     // hardcoded $DATADIR/bootstrap.dat
@@ -375,6 +496,8 @@ void ThreadImport(vector<boost::filesystem::path> vImportFiles) {
 
     // -loadblock=
     for (const auto &path : vImportFiles) {
+        if (IsReplayDone())
+            break;
         FILE *file = fopen(path.string().c_str(), "rb");
         if (file) {
             CImportingNow imp;
@@ -384,6 +507,18 @@ void ThreadImport(vector<boost::filesystem::path> vImportFiles) {
             LogPrint(BCLog::INFO, "Warning: Could not open blocks file %s\n", path.string());
         }
     }
+
+    if (SysCfg().IsBenchmark())
+        LogTxExecTimes();
+
+    // -replayblocks, the report covers the blocks connected up to here
+    if (blockReplay.IsActive()) {
+        {
+            LOCK(cs_main);
+            blockReplay.Finish();
+        }
+        StartShutdown();
+    }
 }
 
 /** Initialize Coin.
@@ -466,6 +601,31 @@ bool AppInit(boost::thread_group &threadGroup) {
             LogPrint(BCLog::INFO, "AppInit : parameter interaction: -connect set -> setting -listen=0\n");
     }
 
+    if (!IsDbBackendAvailable(GetDbBackend()))
+        return InitError(strprintf(_("Unsupported -dbbackend=%s, the node is built with %s"), GetDbBackend(),
+                                   IsDbBackendAvailable(DB_BACKEND_ROCKSDB) ? "leveldb and rocksdb" : "leveldb only"));
+
+    string affinityError;
+    if (!InitThreadAffinity(SysCfg().GetArg("-cpuaffinity", ""), affinityError))
+        return InitError(affinityError);
+
+    int64_t schedulerThreads = SysCfg().GetArg("-schedulerthreads", 0);
+    if (schedulerThreads <= 0)
+        schedulerThreads = (int64_t)boost::thread::hardware_concurrency();
+    GetTaskScheduler().Start((uint32_t)max<int64_t>(1, min<int64_t>(schedulerThreads, MAX_SCHEDULER_THREADS)));
+
+    if (SysCfg().IsArgCount("-replayblocks")) {
+        if (!blockReplay.Init(SysCfg().GetArg("-replayblocks", "")))
+            return InitError(_("Invalid -replayblocks, expected <from>:<to> with 0 < from <= to"));
+
+        // the blocks come from the files only, the node neither connects to peers nor produces blocks
+        if (SysCfg().SoftSetBoolArg("-listen", false))
+            LogPrint(BCLog::INFO, "AppInit : parameter interaction: -replayblocks set -> setting -listen=0\n");
+
+        if (SysCfg().SoftSetBoolArg("-genblock", false))
+            LogPrint(BCLog::INFO, "AppInit : parameter interaction: -replayblocks set -> setting -genblock=0\n");
+    }
+
     if (SysCfg().IsArgCount("-proxy")) {
         // to protect privacy, do not listen by default if a default proxy server is specified
         if (SysCfg().SoftSetBoolArg("-listen", false))
@@ -496,7 +656,9 @@ bool AppInit(boost::thread_group &threadGroup) {
     // Make sure enough file descriptors are available
     int32_t nBind   = max((int32_t)SysCfg().IsArgCount("-bind"), 1);
     nMaxConnections = SysCfg().GetArg("-maxconnections", 125);
-    nMaxConnections = max(min(nMaxConnections, (int32_t)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    if (CSocketEvents::GetBackendName() == "select")
+        nMaxConnections = min(nMaxConnections, (int32_t)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS));
+    nMaxConnections = max(nMaxConnections, 0);
     int32_t nFD     = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -506,6 +668,21 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     SysCfg().SetBenchMark(SysCfg().GetBoolArg("-benchmark", false));
     mempool.SetSanityCheck(SysCfg().GetBoolArg("-checkmempool", RegTest()));
+    mempool.SetLimits(max<int64_t>(0, SysCfg().GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE)) * 1000000,
+                      max<int64_t>(0, SysCfg().GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY)) * 60 * 60);
+    fLockProfiling = SysCfg().GetBoolArg("-lockprofile", DEFAULT_LOCK_PROFILE);
+    blockTracer.SetCapacity(SysCfg().GetArg("-blocktraces", DEFAULT_BLOCK_TRACES));
+    txLatencyTracer.SetCapacity(SysCfg().GetArg("-txlatencytraces", DEFAULT_TX_LATENCY_TRACES));
+    txExecStats.SetCapacity(SysCfg().GetArg("-txstats", DEFAULT_TX_STATS));
+
+    // -par=0 means autodetect, the main thread is one of the signature verification threads
+    nSigCheckThreads = SysCfg().GetArg("-par", DEFAULT_SIGCHECK_THREADS);
+    if (nSigCheckThreads <= 0)
+        nSigCheckThreads += boost::thread::hardware_concurrency();
+    if (nSigCheckThreads <= 1)
+        nSigCheckThreads = 0;
+    else if (nSigCheckThreads > MAX_SIGCHECK_THREADS)
+        nSigCheckThreads = MAX_SIGCHECK_THREADS;
 
     setvbuf(stdout, nullptr, _IOLBF, 0);
 
@@ -526,6 +703,10 @@ bool AppInit(boost::thread_group &threadGroup) {
         return InitError(strprintf("Could not open debug log file %s",
                         LogInstance().m_file_path.string()));
     }
+    if (SysCfg().GetBoolArg("-logasync", DEFAULT_LOGASYNC)) {
+        int64_t buffer = SysCfg().GetArg("-logasyncbuffer", DEFAULT_LOGASYNC_BUFFER);
+        LogInstance().StartAsync((size_t)std::max<int64_t>(1, std::min(buffer, MAX_LOGASYNC_BUFFER)));
+    }
     // if (GetBoolArg("-shrinkdebugfile", !fDebug))
     //     ShrinkDebugFile();
 
@@ -546,6 +727,8 @@ bool AppInit(boost::thread_group &threadGroup) {
     string leveldb_version = strprintf("%d.%d", leveldb::kMajorVersion, leveldb::kMinorVersion);
     LogPrint(BCLog::INFO, "Using Level DB version %s\n", leveldb_version);
     LogPrint(BCLog::INFO, "Using Berkeley DB version %s\n", DB_VERSION_STRING);
+    // before any thread hashes, it switches the transforms to the kernels of the cpu
+    LogPrint(BCLog::INFO, "Using the '%s' SHA256 implementation\n", SHA256AutoDetect());
 
 #ifdef USE_UPNP
     LogPrint(BCLog::INFO, "Using miniupnpc version %s,API version %d\n", MINIUPNPC_VERSION, MINIUPNPC_API_VERSION);
@@ -555,6 +738,12 @@ bool AppInit(boost::thread_group &threadGroup) {
     LogPrint(BCLog::INFO, "Using data directory %s\n", strDataDir);
     LogPrint(BCLog::INFO, "Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
 
+    if (nSigCheckThreads) {
+        LogPrint(BCLog::INFO, "Using %u threads for signature verification\n", nSigCheckThreads);
+        for (int32_t i = 0; i < nSigCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadSigCheck);
+    }
+
     RegisterNodeSignals(GetNodeSignals());
 
     int32_t nSocksVersion = SysCfg().GetArg("-socks", 5);
@@ -664,6 +853,23 @@ bool AppInit(boost::thread_group &threadGroup) {
         }
     }
 
+    // -prune, a pruned node serves the recent blocks only
+    int64_t nPruneArg = SysCfg().GetArg("-prune", DEFAULT_PRUNE_TARGET_MB);
+    if (nPruneArg < 0)
+        return InitError(_("Prune cannot be configured with a negative value."));
+    if (nPruneArg > 0) {
+        if ((uint64_t)nPruneArg < MIN_PRUNE_TARGET_MB)
+            return InitError(strprintf(_("Prune configured below the minimum of %u MiB. Please use a higher number."),
+                                       MIN_PRUNE_TARGET_MB));
+        // the wallet reads the txs of its history from the block files
+        if (!SysCfg().GetBoolArg("-disablewallet", false))
+            return InitError(_("Prune mode is incompatible with the wallet, please also set -disablewallet."));
+        fPruneMode   = true;
+        nPruneTarget = (uint64_t)nPruneArg << 20;
+        nLocalServices &= ~NODE_NETWORK;
+        LogPrint(BCLog::INFO, "Prune configured to target %u MiB on disk for the block and undo files\n", nPruneArg);
+    }
+
     SysCfg().SetReIndex(SysCfg().GetBoolArg("-reindex", false));
 
     SysCfg().SetLogFailures(SysCfg().GetBoolArg("-logfailures", false));
@@ -675,12 +881,48 @@ bool AppInit(boost::thread_group &threadGroup) {
         filesystem::create_directories(blocksDir);
     }
 
-    try {
-        pWalletMain = CWallet::GetInstance();
-        RegisterWallet(pWalletMain);
-        pWalletMain->LoadWallet(false);
-    } catch (std::exception &e) {
-        std::cout << "load wallet failed: " << e.what() << std::endl;
+    if (SysCfg().GetBoolArg("-disablewallet", false)) {
+        pWalletMain = nullptr;
+        LogPrint(BCLog::INFO, "Wallet disabled!\n");
+    } else {
+        try {
+            pWalletMain = CWallet::GetInstance();
+            // the wallet is synced with the core on a thread of its own
+            walletNotifier.Start(pWalletMain);
+            threadGroup.create_thread(&ThreadWalletNotify);
+            pWalletMain->LoadWallet(false);
+        } catch (std::exception &e) {
+            std::cout << "load wallet failed: " << e.what() << std::endl;
+        }
+    }
+
+    // -loadstate, import the state of a finalized block instead of connecting the blocks up to it
+    if (SysCfg().IsArgCount("-loadstate")) {
+        if (SysCfg().IsReindex())
+            return InitError(_("-loadstate can not be used with -reindex"));
+        if (filesystem::exists(blocksDir / "blk00000.dat"))
+            return InitError(_("-loadstate requires a data directory without blocks"));
+
+        int64_t nLoadStart = GetTimeMillis();
+        CStateDump stateDump(SysCfg().GetArg("-loadstate", ""));
+        CStateDumpInfo info;
+        if (!stateDump.ReadInfo(info))
+            return InitError(_("Invalid state dump file of -loadstate"));
+
+        string strHash = SysCfg().GetArg("-loadstatehash", "");
+        if (!strHash.empty() && uint256S(strHash) != info.commitment)
+            return InitError(strprintf(_("The state dump has the commitment %s, not the one of -loadstatehash"),
+                                       info.commitment.GetHex()));
+
+        pCdMan = new CCacheDBManager(true, false);
+        bool fImported = stateDump.Read(pCdMan, info);
+        delete pCdMan;
+        pCdMan = nullptr;
+        if (!fImported)
+            return InitError(_("Failed to import the state dump of -loadstate"));
+
+        LogPrint(BCLog::INFO, "Loaded the state of block %d, commitment=%s (%dms)\n", info.height,
+                 info.commitment.GetHex(), GetTimeMillis() - nLoadStart);
     }
 
     int64_t nStart = GetTimeMillis();
@@ -692,6 +934,7 @@ bool AppInit(boost::thread_group &threadGroup) {
         do {
             try {
                 UnloadBlockIndex();
+                CStateSnapshot::Release();
                 delete pCdMan;
 
                 bool fReIndex = SysCfg().IsReindex();
@@ -699,6 +942,11 @@ bool AppInit(boost::thread_group &threadGroup) {
                 if (fReIndex)
                     pCdMan->pBlockCache->WriteReindexing(true);
 
+                if (!pCdMan->CheckFlushSequence()) {
+                    strLoadError = _("Interrupted database flush detected");
+                    break;
+                }
+
                 mempool.SetMemPoolCache();
 
                 if (!LoadBlockIndex()) {
@@ -723,6 +971,24 @@ bool AppInit(boost::thread_group &threadGroup) {
                     break;
                 }
 
+                // Check for changed -addressindex state
+                if (SysCfg().IsAddressIndex() != SysCfg().GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -addressindex");
+                    break;
+                }
+
+                // Check for changed -blockfilterindex state
+                if (SysCfg().IsBlockFilterIndex() != SysCfg().GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -blockfilterindex");
+                    break;
+                }
+
+                // Check for changed -medianpriceindex state
+                if (SysCfg().IsMedianPriceIndex() != SysCfg().GetBoolArg("-medianpriceindex", DEFAULT_MEDIANPRICEINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -medianpriceindex");
+                    break;
+                }
+
                 if (!VerifyDB(SysCfg().GetArg("-checklevel", 3), SysCfg().GetArg("-checkblocks", 288))) {
                     strLoadError = _("Corrupted block database detected");
                     break;
@@ -759,6 +1025,14 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     LogPrint(BCLog::INFO, "Build %lu block indexes into memory (%lldms)\n", mapBlockIndex.size(), GetTimeMillis() - nStart);
 
+    if (blockReplay.IsActive() && chainActive.Height() >= blockReplay.GetFrom())
+        return InitError(strprintf(_("The chain state is at block %d, -replayblocks must start after it"),
+                                   chainActive.Height()));
+
+    // Announce the compact block filters to the light wallets
+    if (SysCfg().IsBlockFilterIndex())
+        nLocalServices |= NODE_COMPACT_FILTERS;
+
     if (SysCfg().GetBoolArg("-printblockindex", false) || SysCfg().GetBoolArg("-printblocktree", false)) {
         PrintBlockTree();
         return false;
@@ -767,7 +1041,7 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (SysCfg().IsArgCount("-printblock")) {
         string strMatch = SysCfg().GetArg("-printblock", "");
         int32_t nFound      = 0;
-        for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+        for (BlockMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
             uint256 hash = (*mi).first;
             if (strncmp(hash.ToString().c_str(), strMatch.c_str(), strMatch.size()) == 0) {
                 CBlockIndex *pIndex = (*mi).second;
@@ -784,50 +1058,74 @@ bool AppInit(boost::thread_group &threadGroup) {
         return false;
     }
 
+    wasm::wasm_profiler::instance().set_enabled(SysCfg().GetBoolArg("-wasmprofile", false));
+
+    // warm the wasm module cache up before any contract runs
+    nStart = GetTimeMillis();
+    wasm_code_cache_set_capacity(max<int64_t>(1, SysCfg().GetArg("-wasmcachesize", DEFAULT_WASM_MODULE_CACHE_SIZE)));
+    uint32_t nWasmModules = 0;
+    if (CWasmCacheSnapshot().Read(nWasmModules))
+        LogPrint(BCLog::INFO, "Loaded %u wasm modules from wasm cache snapshot (%dms)\n", nWasmModules,
+                 GetTimeMillis() - nStart);
+
     // scan for better chains in the block chain database, that are not yet connected in the active best chain
     CValidationState state;
     if (!ActivateBestChain(state))
         return InitError("Failed to connect best block");
 
-    nStart                   = GetTimeMillis();
-    CBlockIndex *pBlockIndex = chainActive.Tip();
-    int32_t nCacheHeight     = SysCfg().GetTxCacheHeight();
-    int32_t nCount           = 0;
-    CBlock block;
-    while (pBlockIndex && nCacheHeight-- > 0) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
-            return InitError("Failed to read block from disk");
+    nStart = GetTimeMillis();
+    CMemCacheSnapshot memCacheSnapshot;
+    if (memCacheSnapshot.Read(chainActive.Tip(), SysCfg().GetTxCacheHeight(), PRICE_POINT_CACHE_HEIGHT,
+                              *pCdMan->pTxCache, *pCdMan->pPpCache)) {
+        LogPrint(BCLog::INFO, "Loaded %llu txids and price points from memory cache snapshot (%dms)\n",
+                 pCdMan->pTxCache->GetSize(), GetTimeMillis() - nStart);
+    } else {
+        CBlockIndex *pBlockIndex = chainActive.Tip();
+        int32_t nCacheHeight     = SysCfg().GetTxCacheHeight();
+        int32_t nCount           = 0;
+        CBlock block;
+        while (pBlockIndex && nCacheHeight-- > 0) {
+            if (!ReadBlockFromDisk(pBlockIndex, block))
+                return InitError("Failed to read block from disk");
+
+            if (!pCdMan->pTxCache->AddBlockTx(block))
+                return InitError("Failed to add block to transaction memory cache");
+
+            pBlockIndex = pBlockIndex->pprev;
+            ++nCount;
+        }
+        LogPrint(BCLog::INFO, "Added the latest %d blocks to transaction memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
 
-        if (!pCdMan->pTxCache->AddBlockTx(block))
-            return InitError("Failed to add block to transaction memory cache");
+        nStart       = GetTimeMillis();
+        pBlockIndex  = chainActive.Tip();
+        nCacheHeight = PRICE_POINT_CACHE_HEIGHT;
+        nCount       = 0;
 
-        pBlockIndex = pBlockIndex->pprev;
-        ++nCount;
-    }
-    LogPrint(BCLog::INFO, "Added the latest %d blocks to transaction memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
+        if (pBlockIndex) {
+            if (!ReadBlockFromDisk(pBlockIndex, block))
+                return InitError("Failed to read block from disk");
+        }
 
-    nStart       = GetTimeMillis();
-    pBlockIndex  = chainActive.Tip();
-    nCacheHeight = 11;  // TODO: parameterize 11.
-    nCount       = 0;
+        while (pBlockIndex && nCacheHeight-- > 0) {
+            if (!ReadBlockFromDisk(pBlockIndex, block))
+                return InitError("Failed to read block from disk");
 
+            if (!pCdMan->pPpCache->AddPriceByBlock(block))
+                return InitError("Failed to add block to price point memory cache");
 
-    if (pBlockIndex) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
-            return InitError("Failed to read block from disk");
+            pBlockIndex = pBlockIndex->pprev;
+            ++nCount;
+        }
+        LogPrint(BCLog::INFO, "Added the latest %d blocks to price point memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
     }
 
-    while (pBlockIndex && nCacheHeight-- > 0) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
-            return InitError("Failed to read block from disk");
-
-        if (!pCdMan->pPpCache->AddPriceByBlock(block))
-            return InitError("Failed to add block to price point memory cache");
-
-        pBlockIndex = pBlockIndex->pprev;
-        ++nCount;
+    // the state changes are published from the first block connected by the import
+    if (SysCfg().IsArgCount("-statediff")) {
+        pStateDiffPublisher.reset(new CStateDiffPublisher(SysCfg().GetArg("-statediff", "")));
+        if (!pStateDiffPublisher->Open())
+            return InitError(strprintf(_("Failed to open the -statediff file %s"), SysCfg().GetArg("-statediff", "")));
+        threadGroup.create_thread(&ThreadStateDiff);
     }
-    LogPrint(BCLog::INFO, "Added the latest %d blocks to price point memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
 
     vector<boost::filesystem::path> vImportFiles;
     if (SysCfg().IsArgCount("-loadblock")) {
@@ -853,9 +1151,35 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (!CheckDiskSpace())
         return false;
 
+    if (pWalletMain && SysCfg().GetBoolArg("-rescan", false)) {
+        nStart = GetTimeMillis();
+        CWalletRescan rescan(pWalletMain, 0, CWalletRescan::GetWorkerCount());
+        int32_t nFound = rescan.Run();
+        LogPrint(BCLog::INFO, "Rescanned the wallet txs, found %d (%dms)\n", nFound, GetTimeMillis() - nStart);
+    }
+
     RandAddSeedPerfmon();
 
-    StartNode(threadGroup);
+    // the block caches are warmed up while the node connects to its peers
+    if (SysCfg().GetBoolArg("-dbwarmup", DEFAULT_DB_WARMUP))
+        pCdMan->StartWarmup();
+
+    // the txs of the peers go to the mempool through the admission thread
+    threadGroup.create_thread(&ThreadTxAdmission);
+
+    if (!blockReplay.IsActive())
+        StartNode(threadGroup);
+    else
+        LogPrint(BCLog::INFO, "Replaying the blocks %d to %d without networking\n", blockReplay.GetFrom(),
+                 blockReplay.GetTo());
+
+    // the txs of the last run are admitted while the node already serves
+    if (SysCfg().GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL) && !SysCfg().IsReindex())
+        threadGroup.create_thread(&ThreadLoadMemPool);
+
+    // the invariants of the state are verified while the node already serves
+    if (SysCfg().GetBoolArg("-checkstate", DEFAULT_CHECK_STATE) && !SysCfg().IsReindex())
+        threadGroup.create_thread(&ThreadVerifyState);
 
     if (SysCfg().IsServer()) {
         if (!StartRPCServer()) {
@@ -868,6 +1192,8 @@ bool AppInit(boost::thread_group &threadGroup) {
         GenerateProduceBlockThread(SysCfg().GetBoolArg("-genblock", false), pWalletMain, SysCfg().GetArg("-genblocklimit", -1));
         pWalletMain->ResendWalletTransactions();
         threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pWalletMain->strWalletFile)));
+        walletKeyPool.Start(pWalletMain);
+        threadGroup.create_thread(&ThreadWalletKeyPool);
 
         //resend unconfirmed tx
         threadGroup.create_thread(boost::bind(&ThreadRelayTx, pWalletMain));
@@ -10,10 +10,15 @@
 #include "commons/util/util.h"
 #include "commons/types.h"
 
+#include <algorithm>
+#include <chrono>
 #include <mutex>
 
 const char * const DEFAULT_DEBUGLOGFILE = "debug.log";
 
+// the sleep of the writer thread of the async mode when no record is queued
+static const int64_t LOG_WRITER_INTERVAL_MILLIS = 10;
+
 BCLog::Logger& LogInstance()
 {
 /**
@@ -232,7 +237,7 @@ std::vector<CLogCategoryActive> ListActiveLogCategories()
     return ret;
 }
 
-std::string BCLog::Logger::LogTimestampStr(const std::string& str)
+std::string BCLog::Logger::LogTimestampStr(const std::string& str, int64_t time_micros)
 {
     std::string strStamped;
 
@@ -240,7 +245,7 @@ std::string BCLog::Logger::LogTimestampStr(const std::string& str)
         return str;
 
     if (m_started_new_line) {
-        int64_t nTimeMicros = GetTimeMicros();
+        int64_t nTimeMicros = time_micros;
         strStamped = FormatISO8601DateTime(nTimeMicros/1000000);
         if (m_log_time_micros) {
             strStamped.pop_back();
@@ -280,11 +285,68 @@ namespace BCLog {
 
 }
 
-void BCLog::Logger::LogPrintStr(const BCLog::LogFlags& category, const char* file, int line,
-    const std::string& str) {
+namespace BCLog {
+    struct LogRecord {
+        LogFlags category = NONE;
+        const char* file = nullptr;
+        int line = 0;
+        int64_t time_micros = 0;
+        std::string thread_name;
+        std::string str;
+        std::function<std::string()> formatter; // formats str on the writer thread if set
+    };
+
+    /** Lock-free ring of the records of a thread, the thread pushes and the writer thread pops */
+    class LogRing {
+    public:
+        explicit LogRing(size_t capacity) : m_records(capacity) {}
+
+        bool Push(LogRecord&& record) {
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail.load(std::memory_order_acquire) >= m_records.size())
+                return false;
+            m_records[head % m_records.size()] = std::move(record);
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
 
+        bool Pop(LogRecord& record) {
+            uint64_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire))
+                return false;
+            record = std::move(m_records[tail % m_records.size()]);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool Empty() const {
+            return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+        }
+
+        std::atomic<bool> m_closed{false}; // the thread exited, the ring is removed once written
+
+    private:
+        std::vector<LogRecord> m_records;
+        std::atomic<uint64_t> m_head{0};
+        std::atomic<uint64_t> m_tail{0};
+    };
+} // namespace BCLog
+
+namespace {
+    struct ThreadLogRing {
+        std::shared_ptr<BCLog::LogRing> ring;
+        ~ThreadLogRing() {
+            if (ring)
+                ring->m_closed = true;
+        }
+    };
+    thread_local ThreadLogRing t_log_ring;
+    const std::string EMPTY_THREAD_NAME;
+}
+
+std::string BCLog::Logger::FormatLogStr(const BCLog::LogFlags& category, const char* file, int line,
+    const std::string& str, int64_t time_micros, const std::string& thread_name) {
 
-    std::lock_guard<std::mutex> scoped_lock(m_cs);
     std::string str_prefixed = LogEscapeMessage(str);
 
     str_prefixed.insert(0, "[" + GetLogCategoryName(category) + "] ");
@@ -293,27 +355,21 @@ void BCLog::Logger::LogPrintStr(const BCLog::LogFlags& category, const char* fil
         str_prefixed.insert(0, tfm::format("[%s:%d] ", file, line));
 
     if (m_log_threadnames && m_started_new_line) {
-        str_prefixed.insert(0, "[" + util::ThreadGetInternalName() + "] ");
+        str_prefixed.insert(0, "[" + thread_name + "] ");
     }
 
-    str_prefixed = LogTimestampStr(str_prefixed);
+    str_prefixed = LogTimestampStr(str_prefixed, time_micros);
 
     m_started_new_line = !str.empty() && str[str.size()-1] == '\n';
+    return str_prefixed;
+}
 
-    if (m_buffering) {
-        // buffer if we haven't started logging yet
-        m_msgs_before_open.push_back(str_prefixed);
-        return;
-    }
-
+void BCLog::Logger::WriteLogStr(const std::string& str_prefixed) {
     if (m_print_to_console) {
         // print to console
         fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
         fflush(stdout);
     }
-    for (const auto& cb : m_print_callbacks) {
-        cb(str_prefixed);
-    }
     if (m_print_to_file) {
 
         assert(m_fileout != nullptr);
@@ -340,6 +396,149 @@ void BCLog::Logger::LogPrintStr(const BCLog::LogFlags& category, const char* fil
     }
 }
 
+void BCLog::Logger::LogPrintStr(const BCLog::LogFlags& category, const char* file, int line,
+    const std::string& str) {
+
+
+    std::lock_guard<std::mutex> scoped_lock(m_cs);
+    std::string str_prefixed = FormatLogStr(category, file, line, str, GetTimeMicros(),
+        m_log_threadnames ? util::ThreadGetInternalName() : EMPTY_THREAD_NAME);
+
+    if (m_buffering) {
+        // buffer if we haven't started logging yet
+        m_msgs_before_open.push_back(str_prefixed);
+        return;
+    }
+
+    for (const auto& cb : m_print_callbacks) {
+        cb(str_prefixed);
+    }
+    WriteLogStr(str_prefixed);
+}
+
+BCLog::LogRing& BCLog::Logger::GetThreadRing() {
+    if (!t_log_ring.ring) {
+        t_log_ring.ring = std::make_shared<LogRing>(m_async_buffer);
+        std::lock_guard<std::mutex> scoped_lock(m_rings_cs);
+        m_rings.push_back(t_log_ring.ring);
+    }
+    return *t_log_ring.ring;
+}
+
+void BCLog::Logger::LogPrintAsync(const BCLog::LogFlags& category, const char* file, int line,
+    std::string&& str, std::function<std::string()>&& formatter) {
+
+    LogRecord record;
+    record.category    = category;
+    record.file        = file;
+    record.line        = line;
+    record.time_micros = GetTimeMicros();
+    if (m_log_threadnames)
+        record.thread_name = util::ThreadGetInternalName();
+    record.str       = std::move(str);
+    record.formatter = std::move(formatter);
+    if (GetThreadRing().Push(std::move(record)))
+        return;
+
+    if ((category & LAZY_CATEGORIES) != 0) {
+        m_dropped++;
+        return;
+    }
+
+    // the ring is full, the default categories are written here rather than dropped
+    if (record.formatter)
+        record.str = record.formatter();
+    std::lock_guard<std::mutex> scoped_lock(m_cs);
+    std::string str_prefixed = FormatLogStr(category, file, line, record.str, record.time_micros, record.thread_name);
+    for (const auto& cb : m_print_callbacks) {
+        cb(str_prefixed);
+    }
+    WriteLogStr(str_prefixed);
+}
+
+bool BCLog::Logger::WriteRings() {
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> scoped_lock(m_rings_cs);
+        // the rings of the threads exited are dropped once written
+        for (auto it = m_rings.begin(); it != m_rings.end();) {
+            if ((*it)->m_closed && (*it)->Empty())
+                it = m_rings.erase(it);
+            else
+                rings.push_back(*it++);
+        }
+    }
+
+    std::vector<LogRecord> records;
+    LogRecord record;
+    for (auto& ring : rings) {
+        while (ring->Pop(record))
+            records.push_back(std::move(record));
+    }
+    static uint64_t reported_dropped = 0;
+    uint64_t dropped = m_dropped.load();
+    if (records.empty() && dropped == reported_dropped)
+        return false;
+
+    // the records of the threads are merged in time order, the formatting is out of m_cs
+    std::stable_sort(records.begin(), records.end(),
+        [](const LogRecord& a, const LogRecord& b) { return a.time_micros < b.time_micros; });
+    for (auto& rec : records) {
+        if (rec.formatter) {
+            rec.str = rec.formatter();
+            rec.formatter = nullptr;
+        }
+    }
+
+    std::lock_guard<std::mutex> scoped_lock(m_cs);
+    std::string batch;
+    for (const auto& rec : records) {
+        std::string str_prefixed = FormatLogStr(rec.category, rec.file, rec.line, rec.str, rec.time_micros,
+                                                rec.thread_name);
+        for (const auto& cb : m_print_callbacks) {
+            cb(str_prefixed);
+        }
+        batch += str_prefixed;
+    }
+    if (dropped != reported_dropped) {
+        std::string str = strprintf("%u log records dropped by the full async buffers\n", dropped - reported_dropped);
+        batch += FormatLogStr(BCLog::INFO, __FILE__, __LINE__, str, GetTimeMicros(), EMPTY_THREAD_NAME);
+        reported_dropped = dropped;
+    }
+    WriteLogStr(batch);
+    return true;
+}
+
+void BCLog::Logger::WriterThread() {
+    util::ThreadRename("coin-logwriter");
+    while (!m_writer_stop) {
+        if (!WriteRings())
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOG_WRITER_INTERVAL_MILLIS));
+    }
+    WriteRings();
+}
+
+void BCLog::Logger::StartAsync(size_t buffer) {
+    assert(!m_buffering);
+    if (m_async)
+        return;
+
+    m_async_buffer = std::max<size_t>(1, buffer);
+    m_writer_stop  = false;
+    m_writer       = std::thread(&BCLog::Logger::WriterThread, this);
+    m_async        = true;
+}
+
+void BCLog::Logger::StopAsync() {
+    if (!m_async)
+        return;
+
+    // the records queued by the calls in progress are written by the last round of the writer
+    m_async       = false;
+    m_writer_stop = true;
+    m_writer.join();
+}
+
 void BCLog::Logger::ShrinkDebugFile()
 {
     assert(!m_file_path.empty());
@@ -11,9 +11,14 @@
 #include <boost/filesystem.hpp>
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace fs = boost::filesystem;
@@ -22,6 +27,9 @@ static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
+static const bool DEFAULT_LOGASYNC = false;
+static const int64_t DEFAULT_LOGASYNC_BUFFER = 4096;  // the records queued per thread
+static const int64_t MAX_LOGASYNC_BUFFER = 1 << 20;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -60,6 +68,11 @@ namespace BCLog { //blockchain log
         ALL         = ~(uint32_t)0,
     };
 
+    /** The categories formatted by the writer thread in the async mode, those disabled by default */
+    static const uint32_t LAZY_CATEGORIES = ~(uint32_t)(INFO | ERROR);
+
+    class LogRing;
+
     class Logger
     {
     private:
@@ -78,11 +91,31 @@ namespace BCLog { //blockchain log
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
-        std::string LogTimestampStr(const std::string& str);
+        std::string LogTimestampStr(const std::string& str, int64_t time_micros);
 
         /** Slots that connect to the print signal */
         std::list<std::function<void(const std::string&)>> m_print_callbacks /* GUARDED_BY(m_cs) */ {};
 
+        /**
+         * The async mode: the records are pushed to a lock-free ring of the calling thread and
+         * written in batches by the writer thread. A full ring drops the records of the lazy
+         * categories, the others are written on the calling thread as in the sync mode.
+         */
+        std::atomic<bool> m_async{false};
+        size_t m_async_buffer = DEFAULT_LOGASYNC_BUFFER;
+        std::mutex m_rings_cs;
+        std::vector<std::shared_ptr<LogRing>> m_rings; // GUARDED_BY(m_rings_cs)
+        std::thread m_writer;
+        std::atomic<bool> m_writer_stop{false};
+        std::atomic<uint64_t> m_dropped{0};
+
+        std::string FormatLogStr(const BCLog::LogFlags& category, const char* file, int line,
+            const std::string& str, int64_t time_micros, const std::string& thread_name); // requires m_cs
+        void WriteLogStr(const std::string& str_prefixed); // requires m_cs
+        LogRing& GetThreadRing();
+        bool WriteRings();
+        void WriterThread();
+
     public:
 
         bool m_print_to_console = false;
@@ -102,6 +135,17 @@ namespace BCLog { //blockchain log
         void LogPrintStr(const BCLog::LogFlags& category, const char* file, int line,
             const std::string& str);
 
+        /** Queue a string, or its formatter, for the writer thread of the async mode */
+        void LogPrintAsync(const BCLog::LogFlags& category, const char* file, int line,
+            std::string&& str, std::function<std::string()>&& formatter);
+
+        bool IsAsync() const { return m_async.load(std::memory_order_relaxed); }
+        /** Start the writer thread after StartLogging, with rings of buffer records per thread */
+        void StartAsync(size_t buffer);
+        /** Write the records queued and stop the writer thread */
+        void StopAsync();
+        uint64_t GetDroppedCount() const { return m_dropped.load(); }
+
         /** Returns whether logs will be written to any output */
         bool Enabled() const
         {
@@ -164,6 +208,51 @@ std::vector<CLogCategoryActive> ListActiveLogCategories();
 /** Return true if str parses as a log category and set the flag */
 bool GetLogCategory(BCLog::LogFlags& flag, const std::string& str);
 
+namespace BCLog {
+    template <typename... Args>
+    std::string FormatLogMessage(const char* fmt, const Args&... args) {
+        try {
+            return tfm::format(fmt, args...);
+        } catch (tinyformat::format_error& fmterr) {
+            /* Original format string will have newline so don't add one here */
+            return "Error \"" + std::string(fmterr.what()) + "\" while formatting log message: " + fmt;
+        }
+    }
+
+    // The args captured for the lazy formatting, the C strings are copied since they may not outlive the call
+    inline std::string LogArgCopy(const char* str) { return str != nullptr ? str : ""; }
+    inline std::string LogArgCopy(char* str) { return str != nullptr ? str : ""; }
+    template <typename T>
+    const T& LogArgCopy(const T& arg) { return arg; }
+
+    /** An arg formatted only if the record is, for the dumps built by statements, see LogLazy */
+    template <typename F>
+    class LazyLogArg {
+    public:
+        explicit LazyLogArg(const F& f) : m_f(f) {}
+        std::string Get() const { return m_f(); }
+        friend std::ostream& operator<<(std::ostream& os, const LazyLogArg& arg) { return os << arg.m_f(); }
+
+    private:
+        F m_f;
+    };
+
+    // the functor may capture by reference, so it is called on the calling thread in the async mode too
+    template <typename F>
+    std::string LogArgCopy(const LazyLogArg<F>& arg) { return arg.Get(); }
+
+    template <typename... Args>
+    using LogArgsCopyable =
+        std::conjunction<std::is_copy_constructible<std::decay_t<decltype(LogArgCopy(std::declval<const Args&>()))>>...>;
+} // namespace BCLog
+
+/**
+ * Wrap the statements building an expensive arg of LogPrint, they are run only if the category
+ * is enabled, e.g. LogPrint(BCLog::DEBUG, "prices: %s\n", LogLazy([&]() { return JoinPrices(prices); }))
+ */
+template <typename F>
+BCLog::LazyLogArg<F> LogLazy(const F& f) { return BCLog::LazyLogArg<F>(f); }
+
 // Be conservative when using LogPrintf/error or other things which
 // unconditionally log to debug.log! It should not be the case that an inbound
 // peer can fill up a user's disk with debug.log entries.
@@ -172,20 +261,32 @@ template <typename... Args>
 static inline void LogPrintf(const BCLog::LogFlags& category, const char* file, int line,
     const char* fmt, const Args&... args) {
 
-    if (LogInstance().Enabled()) {
-        std::string log_msg;
-        try {
-            log_msg = tfm::format(fmt, args...);
-        } catch (tinyformat::format_error& fmterr) {
-            /* Original format string will have newline so don't add one here */
-            log_msg = "Error \"" + std::string(fmterr.what()) + "\" while formatting log message: " + fmt;
+    BCLog::Logger& logger = LogInstance();
+    if (logger.IsAsync()) {
+        // the format strings with args are literals, so only the args are captured
+        if constexpr (sizeof...(Args) > 0 && BCLog::LogArgsCopyable<Args...>::value) {
+            if ((category & BCLog::LAZY_CATEGORIES) != 0) {
+                logger.LogPrintAsync(category, file, line, std::string(),
+                    [fmt, captured = std::make_tuple(BCLog::LogArgCopy(args)...)]() {
+                        return std::apply([fmt](const auto&... a) { return BCLog::FormatLogMessage(fmt, a...); },
+                                          captured);
+                    });
+                return;
+            }
         }
-        LogInstance().LogPrintStr(category, file, line, log_msg);
+        logger.LogPrintAsync(category, file, line, BCLog::FormatLogMessage(fmt, args...), nullptr);
+        return;
+    }
+
+    if (logger.Enabled()) {
+        logger.LogPrintStr(category, file, line, BCLog::FormatLogMessage(fmt, args...));
     }
 }
 
 // Use a macro instead of a function for conditional logging to prevent
-// evaluating arguments when logging for the category is not enabled.
+// evaluating arguments when logging for the category is not enabled, so the
+// ToString() and GetHex() args cost nothing then, the dumps which need
+// statements go through LogLazy.
 #define LogPrint(category, ...)                                   \
     do {                                                          \
         if (LogAcceptCategory((category))) {                      \
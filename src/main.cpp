@@ -7,6 +7,7 @@
 #include "main.h"
 
 #include "logging.h"
+#include "metrics.h"
 #include "entities/id.h"
 #include "p2p/addrman.h"
 #include "alert.h"
@@ -26,8 +27,22 @@
 #include "p2p/processmessage.hpp"
 #include "p2p/sendmessage.hpp"
 #include "chain/blockdelegates.h"
+#include "chain/blockfilter.h"
+#include "chain/blockimport.h"
+#include "chain/blockprefetch.h"
+#include "chain/blockreplay.h"
+#include "chain/blocktrace.h"
+#include "chain/txlatency.h"
+#include "chain/txexecstats.h"
+#include "chain/txlookupcache.h"
+#include "chain/parallelexecutor.h"
 #include "persistence/blockundo.h"
+#include "persistence/diskmap.h"
+#include "persistence/statediff.h"
+#include "persistence/statesnapshot.h"
+#include "rpc/core/rpccache.h"
 #include "tx/txserializer.h"
+#include "checkqueue.h"
 
 #include <sstream>
 #include <algorithm>
@@ -53,20 +68,36 @@ using namespace boost;
 CCacheDBManager *pCdMan = nullptr;
 CCriticalSection cs_main;
 CTxMemPool mempool;
-map<uint256, CBlockIndex *> mapBlockIndex;
+BlockMap mapBlockIndex;
+std::shared_mutex cs_chainIndex;
+CBlockIndexPool blockIndexPool;
 int32_t nSyncTipHeight = 0;
 string publicIp;
-map<uint256/* blockhash */, std::shared_ptr<CCacheWrapper>> mapForkCache;
+// the state of a fork tip: the active chain disconnected down to the fork point, then the fork blocks connected
+struct CForkState {
+    std::shared_ptr<CCacheWrapper> spCw;
+    std::shared_ptr<CCacheWrapper> spBaseCw;  // the state of the fork point spCw is layered on, if any
+    uint256 activeTipHash;                    // the states are layered on the active tip, stale once it moves
+    int32_t baseHeight    = 0;                // height of the fork point
+    uint64_t lastUsedSeq  = 0;
+};
+map<uint256/* blockhash */, CForkState> mapForkCache;
+static uint64_t nForkStateSeq = 0;
 CSignatureCache signatureCache;
+bool fPruneMode       = false;
+uint64_t nPruneTarget = 0;
+int32_t nSigCheckThreads = 0;
+static CCheckQueue<CSignatureCheck> sigCheckQueue(128);
+// one master at a time, the blocks and the txs of the peers both verify on the sigcheck threads
+static CCriticalSection cs_sigCheckQueue;
 CChain chainActive;
+std::atomic<int64_t> nTipBlockTime(0);
 CChain chainMostWork;
 bool mining;        // could change from time to time due to vote change
 CKeyID minerKeyId;  // miner accout keyId
 CKeyID nodeKeyId;   // 1st keyId of the node
 extern CPBFTMan pbftMan;
 
-map<uint256/* blockhash */, COrphanBlock *> mapOrphanBlocks;
-multimap<uint256/* blockhash */, COrphanBlock *> mapOrphanBlocksByPrev;
 map<uint256/* blockhash */, std::shared_ptr<CBaseTx> > mapOrphanTransactions;
 extern CPBFTContext pbftContext ;
 const string strMessageMagic = "Coin Signed Message:\n";
@@ -96,6 +127,8 @@ namespace {
         for (const auto &hash : state->vBlocksToDownload)
             mapBlocksToDownload.erase(hash);
 
+        mapPartialBlocks.erase(nodeid);
+
         mapNodeState.erase(nodeid);
     }
 
@@ -124,22 +157,11 @@ CBlockIndex *pIndexBestInvalid;
 // failed
 set<CBlockIndex *, CBlockIndexWorkComparator> setBlockIndexValid;  //an ordered set sorted by height
 
-struct COrphanBlockComparator {
-    bool operator()(COrphanBlock *pa, COrphanBlock *pb) const{
-        if (pa->height > pb->height)
-            return false;
-
-        if (pa->height < pb->height)
-            return true;
-
-        return false;
-    }
-};
-set<COrphanBlock *, COrphanBlockComparator> setOrphanBlock;  //set of Orphan Blocks
-
 CCriticalSection cs_LastBlockFile;
 CBlockFileInfo infoLastBlockFile;
 int32_t nLastBlockFile = 0;
+// set when a block file is left, the pruning is checked by the next write of the chain state
+bool fCheckForPruning = true;
 
 // Every received block is assigned a unique and increasing identifier, so we
 // know which one to give priority in case of a fork.
@@ -219,8 +241,8 @@ void UnregisterNodeSignals(CNodeSignals &nodeSignals) {
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
 }
 
+// no chain state is read, the batch submission checks the txs without cs_main
 bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
-    AssertLockHeld(cs_main);
     if (pBaseTx->nVersion > CBaseTx::CURRENT_VERSION || pBaseTx->nVersion < 1) {
         reason = "version";
         return false;
@@ -230,7 +252,7 @@ bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
     // almost as much to process as they cost the sender in fees, because
     // computing signature hashes is O(ninputs*txsize). Limiting transactions
     // to MAX_STANDARD_TX_SIZE mitigates CPU exhaustion attacks.
-    uint32_t sz = ::GetSerializeSize(pBaseTx->GetNewInstance(), SER_NETWORK, CBaseTx::CURRENT_VERSION);
+    uint32_t sz = pBaseTx->GetTxSize() + 1;  // as serialized by pointer
     if (sz >= MAX_STANDARD_TX_SIZE) {
         reason = "tx-size";
         return false;
@@ -239,20 +261,73 @@ bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
     return true;
 }
 
-bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey) {
-    if (signatureCache.Get(sigHash, signature, pubKey))
+bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey,
+                     bool fEraseCache) {
+    if (signatureCache.Get(sigHash, signature, pubKey, fEraseCache))
         return true;
 
     if (!pubKey.Verify(sigHash, signature))
         return false;
 
-    signatureCache.Set(sigHash, signature, pubKey);
+    if (!fEraseCache)
+        signatureCache.Set(sigHash, signature, pubKey);
     return true;
 }
 
+void ThreadSigCheck() {
+    RenameThread("coin-sigcheck");
+    sigCheckQueue.Thread();
+}
+
+// Queue the tx, so that its hash and size are computed on the sigcheck threads once and the signatures
+// whose pubkey is known before execution are verified there, CheckTx then finds them in signatureCache,
+// the signatures of the signers of a multisig tx included. A failed or skipped check changes nothing,
+// CheckTx verifies the signature again and reports the error as usual.
+static void AddSignatureCheck(CBaseTx *pBaseTx, CCacheWrapper &cw, bool fCheckTx,
+                              vector<CSignatureCheck> &vChecks) {
+    CPubKey pubKey;
+    if (!fCheckTx || pBaseTx->IsBlockRewardTx() || pBaseTx->IsPriceMedianTx() || pBaseTx->signature.empty() ||
+        pBaseTx->signature.size() >= MAX_SIGNATURE_SIZE) {
+        // cache the hash and size only
+    } else if (pBaseTx->txUid.is<CPubKey>()) {
+        pubKey = pBaseTx->txUid.get<CPubKey>();
+    } else {
+        CAccount account;
+        if (cw.accountCache.GetAccount(pBaseTx->txUid, account) && account.HaveOwnerPubKey())
+            pubKey = account.owner_pubkey;
+    }
+    vChecks.emplace_back(pBaseTx, pubKey);
+
+    if (fCheckTx && pBaseTx->nTxType == UCOIN_TRANSFER_MTX) {
+        const CMulsigTx &mulsigTx = *(const CMulsigTx *)pBaseTx;
+        for (const auto &item : mulsigTx.signaturePairs) {
+            CAccount account;
+            if (!item.signature.empty() && item.signature.size() < MAX_SIGNATURE_SIZE &&
+                cw.accountCache.GetAccount(item.regid, account) && account.HaveOwnerPubKey())
+                vChecks.back().AddSigner(item.signature, account.owner_pubkey);
+        }
+    }
+}
+
+static void RunSignatureChecks(vector<CSignatureCheck> &vChecks) {
+    LOCK(cs_sigCheckQueue);
+    CCheckQueueControl<CSignatureCheck> control(&sigCheckQueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
+void PrepareTxSignatures(const vector<CBaseTx *> &txs, CCacheWrapper &cw) {
+    vector<CSignatureCheck> vChecks;
+    vChecks.reserve(txs.size());
+    for (const auto pBaseTx : txs)
+        AddSignatureCheck(pBaseTx, cw, true, vChecks);
+    RunSignatureChecks(vChecks);
+}
+
 bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee) {
+                        bool fLimitFree, bool fRejectInsaneFee, int64_t acceptTime) {
     AssertLockHeld(cs_main);
+    CMetricTimer metricTimer(metricAcceptToMemoryPool);
 
     // is it already in the memory pool?
     uint256 hash = pBaseTx->GetHash();
@@ -279,11 +354,15 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
     uint32_t blockTime = pTip->GetBlockTime();
     uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
 
+    // the signatures verified here are not verified again when the miner packs the tx
+    auto spPreCheckMemo = std::make_shared<CTxPreCheckMemo>();
     CTxExecuteContext context(chainActive.Height(), 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state);
+    context.pPreCheckMemo = spPreCheckMemo.get();
     if (!pBaseTx->CheckTx(context))
         return ERRORMSG("AcceptToMemoryPool() : CheckTx failed, txid: %s", hash.GetHex());
 
-    CTxMemPoolEntry entry(pBaseTx, GetTime(), chainActive.Height());
+    CTxMemPoolEntry entry(pBaseTx, acceptTime != 0 ? acceptTime : GetTime(), chainActive.Height());
+    entry.SetPreCheckMemo(spPreCheckMemo);
     auto nFees = std::get<1>(entry.GetFees());
     auto nSize = entry.GetTxSize();
     // Continuously rate-limit free transactions
@@ -312,17 +391,23 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
     if (fRejectInsaneFee && nFees > SysCfg().GetMaxFee())
         return ERRORMSG("AcceptToMemoryPool() : txid: %s pay insane fees, %d > %d", hash.GetHex(), nFees, SysCfg().GetMaxFee());
 
-    return pool.AddUnchecked(hash, entry, state);
+    if (!pool.AddUnchecked(hash, entry, fuelRate, state))
+        return false;
+    txLatencyTracer.Stamp(hash, TX_STAGE_MEMPOOL_ACCEPTED);
+
+    // notify the listeners of the accepted tx, the wallets only sync the txs of the blocks
+    SyncTransaction(hash, pBaseTx);
+    return true;
 }
 
 int32_t CMerkleTx::GetDepthInMainChainINTERNAL(CBlockIndex *&pindexRet) const {
     if (blockHash.IsNull() || index == -1)
         return 0;
 
-    AssertLockHeld(cs_main);
+    std::shared_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
 
     // Find the block it claims to be in
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(blockHash);
+    BlockMap::iterator mi = mapBlockIndex.find(blockHash);
     if (mi == mapBlockIndex.end())
         return 0;
 
@@ -343,7 +428,6 @@ int32_t CMerkleTx::GetDepthInMainChainINTERNAL(CBlockIndex *&pindexRet) const {
 }
 
 int32_t CMerkleTx::GetDepthInMainChain(CBlockIndex *&pindexRet) const {
-    AssertLockHeld(cs_main);
     int32_t nResult = GetDepthInMainChainINTERNAL(pindexRet);
     if (nResult == 0 && !mempool.Exists(pTx->GetHash()))
         return -1;  // Not in chain, not in mempool
@@ -358,23 +442,54 @@ int32_t CMerkleTx::GetBlocksToMaturity() const {
     return max(0, (BLOCK_REWARD_MATURITY + 1) - GetDepthInMainChain());
 }
 
-int32_t GetTxConfirmHeight(const uint256 &hash, CBlockDBCache &blockCache) {
-    if (SysCfg().IsTxIndex()) {
-        CDiskTxPos diskTxPos;
-        if (blockCache.ReadTxIndex(hash, diskTxPos)) {
-            CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
-            CBlockHeader header;
-            try {
-                file >> header;
-            } catch (std::exception &e) {
-                ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
-                return -1;
-            }
-            return header.GetHeight();
-        }
+static bool IsConfirmedInActiveChain(const CConfirmedTx &confirmedTx) {
+    AssertLockHeld(cs_main);
+    CBlockIndex *pIndex = chainActive[confirmedTx.height];
+    return pIndex && pIndex->GetBlockHash() == confirmedTx.blockHash;
+}
+
+bool GetConfirmedTx(const uint256 &hash, CBlockDBCache &blockCache, CConfirmedTx &confirmedTx) {
+    if (!SysCfg().IsTxIndex())
+        return false;
+
+    LOCK(cs_main);
+    if (txLookupCache.Get(hash, confirmedTx)) {
+        if (IsConfirmedInActiveChain(confirmedTx))
+            return true;
+
+        txLookupCache.Remove(hash);
+    }
+
+    CDiskTxPos diskTxPos;
+    if (!blockCache.ReadTxIndex(hash, diskTxPos))
+        return false;
+
+    CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
+    CBlockHeader header;
+    try {
+        file >> header;
+        fseek(file, diskTxPos.nTxOffset, SEEK_CUR);
+        file >> confirmedTx.pBaseTx;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
+    confirmedTx.height    = header.GetHeight();
+    confirmedTx.time      = header.GetTime();
+    confirmedTx.blockHash = header.GetHash();
+
+    // the txs of a block being connected are indexed by the cache wrapper of the block before it is the tip
+    if (IsConfirmedInActiveChain(confirmedTx))
+        txLookupCache.Add(hash, confirmedTx);
+
+    return true;
+}
+
+int32_t GetTxConfirmHeight(const uint256 &hash, CBlockDBCache &blockCache) {
+    CConfirmedTx confirmedTx;
+    if (!GetConfirmedTx(hash, blockCache, confirmedTx))
+        return -1;
 
-    return -1;
+    return confirmedTx.height;
 }
 
 // Return transaction in tx, and if it was found inside a block, its hash is placed in blockHash
@@ -390,66 +505,15 @@ bool GetTransaction(std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &hash, CBlo
             }
         }
 
-        if (SysCfg().IsTxIndex()) {
-            CDiskTxPos diskTxPos;
-            if (blockCache.ReadTxIndex(hash, diskTxPos)) {
-                CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
-                CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file, diskTxPos.nTxOffset, SEEK_CUR);
-                    file >> pBaseTx;
-                } catch (std::exception &e) {
-                    return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
-                }
-                return true;
-            }
+        CConfirmedTx confirmedTx;
+        if (GetConfirmedTx(hash, blockCache, confirmedTx)) {
+            pBaseTx = confirmedTx.pBaseTx;
+            return true;
         }
     }
     return false;
 }
 
-uint256 GetOrphanRoot(const uint256 &hash) {
-    map<uint256, COrphanBlock *>::iterator it = mapOrphanBlocks.find(hash);
-    if (it == mapOrphanBlocks.end())
-        return hash;
-
-    // Work back to the first block in the orphan chain
-    do {
-        map<uint256, COrphanBlock *>::iterator it2 = mapOrphanBlocks.find(it->second->prevBlockHash);
-        if (it2 == mapOrphanBlocks.end())
-            return it->first;
-        it = it2;
-    } while (true);
-}
-
-// Remove a random orphan block (which does not have any dependent orphans).
-bool static PruneOrphanBlocks(int32_t height) {
-    if (mapOrphanBlocksByPrev.size() <= MAX_ORPHAN_BLOCKS) {
-        return true;
-    }
-
-    COrphanBlock *pOrphanBlock = *setOrphanBlock.rbegin();
-    if (pOrphanBlock->height <= height) {
-        return false;
-    }
-    uint256 hash     = pOrphanBlock->blockHash;
-    uint256 prevHash = pOrphanBlock->prevBlockHash;
-    setOrphanBlock.erase(pOrphanBlock);
-    multimap<uint256, COrphanBlock *>::iterator beg = mapOrphanBlocksByPrev.lower_bound(prevHash);
-    multimap<uint256, COrphanBlock *>::iterator end = mapOrphanBlocksByPrev.upper_bound(prevHash);
-    while (beg != end) {
-        if (beg->second->blockHash == hash) {
-            mapOrphanBlocksByPrev.erase(beg);
-            break;
-        }
-        ++beg;
-    }
-    mapOrphanBlocks.erase(hash);
-    delete pOrphanBlock;
-    return true;
-}
-
 arith_uint256 GetBlockProof(const CBlockIndex &block) {
     arith_uint256 bnTarget;
     bool fNegative;
@@ -644,8 +708,8 @@ bool ReconsiderBlock(CValidationState &state, CBlockIndex *pIndex) {
     AssertLockHeld(cs_main);
 
     // Remove the invalidity flag from this block and all its descendants.
-    map<uint256, CBlockIndex *>::const_iterator it = mapBlockIndex.begin();
-    int32_t height                                    = pIndex->height;
+    BlockMap::const_iterator it = mapBlockIndex.begin();
+    int32_t height              = pIndex->height;
     while (it != mapBlockIndex.end()) {
         if (it->second->nStatus & BLOCK_FAILED_MASK && it->second->GetAncestor(height) == pIndex) {
             it->second->nStatus &= ~BLOCK_FAILED_MASK;
@@ -676,15 +740,7 @@ void UpdateTime(CBlockHeader &block, const CBlockIndex *pIndexPrev) {
     block.SetTime(max(pIndexPrev->GetMedianTimePast() + 1, GetAdjustedTime()));
 }
 
-bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool *pfClean) {
-    assert(pIndex->GetBlockHash() == cw.blockCache.GetBestBlockHash());
-
-    if (pfClean)
-        *pfClean = false;
-
-    bool fClean = true;
-
-    CBlockUndo blockUndo;
+static bool ReadBlockUndo(const CBlock &block, CBlockIndex *pIndex, CBlockUndo &blockUndo) {
     CDiskBlockPos pos = pIndex->GetUndoPos();
     if (pos.IsNull())
         return ERRORMSG("DisconnectBlock() : no undo data available");
@@ -694,14 +750,11 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
 
     if ((blockUndo.vtxundo.size() != block.vptx.size()) && (blockUndo.vtxundo.size() != (block.vptx.size() + 1)))
         return ERRORMSG("DisconnectBlock() : block and undo data inconsistent");
-    CBlockUndoExecutor undoExecutor(cw, blockUndo);
-    if (!undoExecutor.Execute()) {
-        return ERRORMSG("DisconnectBlock() : Undo all data in block failed");
-    }
-
-    // Set previous block as the best block
-    cw.blockCache.SetBestBlock(pIndex->pprev->GetBlockHash());
+    return true;
+}
 
+// the memory caches of the disconnected block, independent of the db caches undone
+static bool DisconnectBlockMemCaches(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state) {
     // Delete the disconnected block's transactions from transaction memory cache.
     if (!cw.txCache.RemoveBlockTx(block)) {
         return state.Abort(_("DisconnectBlock() : failed to delete block from transaction memory cache"));
@@ -749,6 +802,32 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
         }
     }
 
+    return true;
+}
+
+bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool *pfClean) {
+    assert(pIndex->GetBlockHash() == cw.blockCache.GetBestBlockHash());
+
+    if (pfClean)
+        *pfClean = false;
+
+    bool fClean = true;
+
+    CBlockUndo blockUndo;
+    if (!ReadBlockUndo(block, pIndex, blockUndo))
+        return false;
+
+    CBlockUndoExecutor undoExecutor(cw, blockUndo);
+    if (!undoExecutor.Execute()) {
+        return ERRORMSG("DisconnectBlock() : Undo all data in block failed");
+    }
+
+    // Set previous block as the best block
+    cw.blockCache.SetBestBlock(pIndex->pprev->GetBlockHash());
+
+    if (!DisconnectBlockMemCaches(block, cw, pIndex, state))
+        return false;
+
     if (pfClean) {
         *pfClean = fClean;
         return true;
@@ -757,26 +836,50 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
     }
 }
 
-void static FlushBlockFile(bool fFinalize = false) {
-    LOCK(cs_LastBlockFile);
+bool DisconnectBlocks(CCacheWrapper &cw, CBlockIndex *pIndexTip, CBlockIndex *pIndexFork, CValidationState &state) {
+    assert(pIndexTip->GetBlockHash() == cw.blockCache.GetBestBlockHash());
+
+    CBlockUndoComposer composer;
+    for (CBlockIndex *pIndex = pIndexTip; pIndex != pIndexFork; pIndex = pIndex->pprev) {
+        if (pIndex == nullptr || pIndex->pprev == nullptr)
+            return ERRORMSG("DisconnectBlocks() : the fork block %s is not an ancestor of the tip",
+                            pIndexFork->GetBlockHash().ToString());
+
+        LogPrint(BCLog::INFO, "DisconnectBlocks() : disconnect block [%d]: %s\n", pIndex->height,
+                 pIndex->GetBlockHash().GetHex());
+
+        CBlock block;
+        if (!ReadBlockFromDisk(pIndex, block))
+            return state.Abort(_("Failed to read block"));
 
-    CDiskBlockPos posOld(nLastBlockFile, 0);
+        CBlockUndo blockUndo;
+        if (!ReadBlockUndo(block, pIndex, blockUndo))
+            return ERRORMSG("DisconnectBlocks() : failed to read the undo of block [%d]: %s", pIndex->height,
+                            pIndex->GetBlockHash().ToString());
+        composer.Add(std::move(blockUndo));
 
-    FILE *fileOld = OpenBlockFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            TruncateFile(fileOld, infoLastBlockFile.nSize);
-        FileCommit(fileOld);
-        fclose(fileOld);
+        if (!DisconnectBlockMemCaches(block, cw, pIndex, state))
+            return false;
     }
 
-    fileOld = OpenUndoFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            TruncateFile(fileOld, infoLastBlockFile.nUndoSize);
-        FileCommit(fileOld);
-        fclose(fileOld);
+    LogPrint(BCLog::INFO, "DisconnectBlocks() : undo %u keys of %d blocks\n", composer.GetKeyCount(),
+             pIndexTip->height - pIndexFork->height);
+    if (!composer.Apply(cw))
+        return ERRORMSG("DisconnectBlocks() : Undo all data in blocks failed");
+
+    cw.blockCache.SetBestBlock(pIndexFork->GetBlockHash());
+    return true;
+}
+
+bool static FlushBlockFile(bool fFinalize = false) {
+    LOCK(cs_LastBlockFile);
+
+    if (fFinalize) {
+        GetDiskFileMapCache().Invalidate(nLastBlockFile);  // the files are truncated below
+        GetDiskFileWriter().Finalize(nLastBlockFile, infoLastBlockFile.nSize, infoLastBlockFile.nUndoSize);
     }
+    // the writes in flight complete before the sync, a failed one fails it
+    return GetDiskFileWriter().Sync();
 }
 
 static bool FindUndoPos(CValidationState &state, int32_t nFile, CDiskBlockPos &pos, uint32_t nAddSize) {
@@ -803,14 +906,9 @@ static bool FindUndoPos(CValidationState &state, int32_t nFile, CDiskBlockPos &p
     uint32_t nOldChunks = (pos.nPos + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     uint32_t nNewChunks = (nNewSize + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     if (nNewChunks > nOldChunks) {
-        if (CheckDiskSpace(nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos)) {
-            FILE *file = OpenUndoFile(pos);
-            if (file) {
-                LogPrint(BCLog::INFO, "Pre-allocating up to position 0x%x in rev%05u.dat\n", nNewChunks * UNDOFILE_CHUNK_SIZE, pos.nFile);
-                AllocateFileRange(file, pos.nPos, nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos);
-                fclose(file);
-            }
-        } else
+        if (CheckDiskSpace(nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos))
+            GetDiskFileWriter().Allocate(pos, "rev", nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos);
+        else
             return state.Error("out of disk space");
     }
 
@@ -909,97 +1007,168 @@ bool SaveTxIndex(const uint256 &txid, CCacheWrapper &cw, CValidationState &state
     return true;
 }
 
-// compute vote staking interest && revoke votes
-static bool ComputeVoteStakingInterestAndRevokeVotes(const int32_t currHeight, const uint32_t currBlockTime,
-                                                    CCacheWrapper &cw, CValidationState &state) {
-    // acquire votes list
-    map<CRegIDKey, vector<CCandidateReceivedVote>> regId2ReceivedVotes;
-    if (!cw.delegateCache.GetVoterList(regId2ReceivedVotes)) {
-        return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : failed to get vote list"),
-                         REJECT_INVALID, "bad-get-vote-list");
-    }
-
-    // revoke votes if necessary
-    map<CRegID, vector<CCandidateVote>> regId2CandidateVotes;
-    for (auto &item : regId2ReceivedVotes) {
-        const CRegID &regId = item.first.regid;
-        auto &candidateReceivedVotes = item.second;
-        vector<CCandidateVote> candidateVotes;
-        assert(!candidateReceivedVotes.empty());
-        // If the voter only votes to one candidate, not bother to revoke votes.
-        if (candidateReceivedVotes.size() == 1) {
-            regId2CandidateVotes.emplace(regId, candidateVotes /* empty */);
-            continue;
+// the keyids involved in the tx, the senders, the recipients and the accounts of its receipts
+static void GetTxInvolvedKeyIds(const CBaseTx &tx, const uint256 &txid, CCacheWrapper &cw, set<CKeyID> &keyIds) {
+    if (!tx.GetInvolvedKeyIds(cw, keyIds))
+        LogPrint(BCLog::INFO, "GetTxInvolvedKeyIds() : get the involved keyids of tx %s failed\n", txid.GetHex());
+
+    vector<CReceipt> receipts;
+    if (cw.txReceiptCache.GetTxReceipts(txid, receipts)) {
+        for (const auto &receipt : receipts) {
+            CKeyID keyId;
+            if (!receipt.from_uid.IsEmpty() && cw.accountCache.GetKeyId(receipt.from_uid, keyId))
+                keyIds.insert(keyId);
+            if (!receipt.to_uid.IsEmpty() && cw.accountCache.GetKeyId(receipt.to_uid, keyId))
+                keyIds.insert(keyId);
         }
+    }
+}
 
-        // If the voter votes to more than one candidates, need to revoke votes from the second
-        // candidates.
-        auto it = candidateReceivedVotes.begin();
-        ++it;  // skip the first item
-        for (; it < candidateReceivedVotes.end(); ++it) {
-            const auto &uid  = it->GetCandidateUid();
-            const auto votes = it->GetVotedBcoins();
-            candidateVotes.emplace_back(VoteType::MINUS_BCOIN, uid, votes);  // revoke votes
+// index the txids of the keyids involved in the txs of the block, written with the undo of the reward tx
+// and so erased by DisconnectBlock
+static bool SaveAddressIndex(const CBlock &block, CCacheWrapper &cw, CValidationState &state) {
+    for (uint32_t index = 0; index < block.vptx.size(); index++) {
+        const auto &pBaseTx = block.vptx[index];
+        uint256 txid        = pBaseTx->GetHash();
+
+        set<CKeyID> keyIds;
+        GetTxInvolvedKeyIds(*pBaseTx, txid, cw, keyIds);
+        for (const auto &keyId : keyIds) {
+            if (!cw.blockCache.SetAddressTxid(keyId, block.GetHeight(), index, txid))
+                return state.Abort(_("Failed to write address index"));
         }
+    }
+    return true;
+}
+
+// the compact filter of the keyids and regids involved in the txs of the block, chained to the filter of the
+// previous block, written with the undo of the reward tx as the address index
+static bool SaveBlockFilter(const CBlock &block, CCacheWrapper &cw, CValidationState &state) {
+    set<CKeyID> keyIds;
+    for (const auto &pBaseTx : block.vptx)
+        GetTxInvolvedKeyIds(*pBaseTx, pBaseTx->GetHash(), cw, keyIds);
 
-        regId2CandidateVotes.emplace(regId, candidateVotes);
+    vector<BlockFilterElement> elements;
+    for (const auto &keyId : keyIds) {
+        elements.push_back(CBlockFilter::GetElement(keyId));
+        CRegID regId;
+        if (cw.accountCache.GetRegId(keyId, regId))
+            elements.push_back(CBlockFilter::GetElement(regId.GetRegIdRaw()));
     }
 
-    // compute vote staking interest
-    for (const auto &item : regId2CandidateVotes) {
-        const auto &regId          = item.first;
-        const auto &candidateVotes = item.second;
+    // the txs of the genesis block are not connected, the chain of the headers starts from the next one
+    CBlockFilter prevFilter;
+    if (block.GetHeight() > 1 && !cw.blockCache.GetBlockFilter(block.GetPrevBlockHash(), prevFilter))
+        return state.Abort(_("Failed to read the filter of the previous block"));
 
-        vector<CCandidateReceivedVote> candidateVotesInOut;
-        cw.delegateCache.GetCandidateVotes(regId, candidateVotesInOut);
-        CAccount account;
-        cw.accountCache.GetAccount(regId, account);
-        vector<CReceipt> receipts;
-        if (!account.ProcessCandidateVotes(candidateVotes, candidateVotesInOut, currHeight, currBlockTime,
-                                           cw.accountCache, receipts)) {
-            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : operate candidate votes failed, regId=%s",
-                            regId.ToString()), UPDATE_ACCOUNT_FAIL, "operate-candidate-votes-failed");
+    if (!cw.blockCache.SetBlockFilter(CBlockFilter(block.GetHash(), elements, prevFilter.GetHeader())))
+        return state.Abort(_("Failed to write block filter"));
+
+    return true;
+}
+
+// the voters read from the vote index at a time by ComputeVoteStakingInterestAndRevokeVotes()
+static const size_t VOTE_INTEREST_CHUNK_SIZE = 1024;
+
+// revoke the votes of the voter but the first ones and collect the interest of its votes
+static bool ProcessVoterVotes(const CRegID &regId, const vector<CCandidateVote> &candidateVotes,
+                              const int32_t currHeight, const uint32_t currBlockTime, CCacheWrapper &cw,
+                              CValidationState &state) {
+    vector<CCandidateReceivedVote> candidateVotesInOut;
+    cw.delegateCache.GetCandidateVotes(regId, candidateVotesInOut);
+    CAccount account;
+    cw.accountCache.GetAccount(regId, account);
+    vector<CReceipt> receipts;
+    if (!account.ProcessCandidateVotes(candidateVotes, candidateVotesInOut, currHeight, currBlockTime,
+                                       cw.accountCache, receipts)) {
+        return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : operate candidate votes failed, regId=%s",
+                        regId.ToString()), UPDATE_ACCOUNT_FAIL, "operate-candidate-votes-failed");
+    }
+    if (!cw.delegateCache.SetCandidateVotes(regId, candidateVotesInOut)) {
+        return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : write candidate votes failed, regId=%s",
+                        regId.ToString()), OPERATE_CANDIDATE_VOTES_FAIL, "write-candidate-votes-failed");
+    }
+
+    if (!cw.accountCache.SaveAccount(account)) {
+        return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s info error",
+                        account.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-accountdb");
+    }
+
+    for (const auto &vote : candidateVotes) {
+        CAccount delegate;
+        const CUserID &delegateUId = vote.GetCandidateUid();
+        if (!cw.accountCache.GetAccount(delegateUId, delegate)) {
+            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : read KeyId(%s) account info error",
+                            delegateUId.ToString()), UPDATE_ACCOUNT_FAIL, "bad-read-accountdb");
+        }
+        uint64_t oldVotes = delegate.received_votes;
+        if (!delegate.StakeVoteBcoins(VoteType(vote.GetCandidateVoteType()), vote.GetVotedBcoins())) {
+            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : operate delegate address %s vote fund error",
+                            delegateUId.ToString()), UPDATE_ACCOUNT_FAIL, "operate-vote-error");
         }
-        if (!cw.delegateCache.SetCandidateVotes(regId, candidateVotesInOut)) {
-            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : write candidate votes failed, regId=%s",
-                            regId.ToString()), OPERATE_CANDIDATE_VOTES_FAIL, "write-candidate-votes-failed");
+
+        // Votes: set the new value and erase the old value
+        if (!cw.delegateCache.SetDelegateVotes(delegate.regid, delegate.received_votes)) {
+            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s vote info error",
+                            delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
         }
 
-        if (!cw.accountCache.SaveAccount(account)) {
+        if (!cw.delegateCache.EraseDelegateVotes(delegate.regid, oldVotes)) {
+            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : erase account id %s vote info error",
+                            delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
+        }
+
+        if (!cw.accountCache.SaveAccount(delegate)) {
             return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s info error",
                             account.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-accountdb");
         }
+    }
+    return true;
+}
 
-        for (const auto &vote : candidateVotes) {
-            CAccount delegate;
-            const CUserID &delegateUId = vote.GetCandidateUid();
-            if (!cw.accountCache.GetAccount(delegateUId, delegate)) {
-                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : read KeyId(%s) account info error",
-                                delegateUId.ToString()), UPDATE_ACCOUNT_FAIL, "bad-read-accountdb");
-            }
-            uint64_t oldVotes = delegate.received_votes;
-            if (!delegate.StakeVoteBcoins(VoteType(vote.GetCandidateVoteType()), vote.GetVotedBcoins())) {
-                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : operate delegate address %s vote fund error",
-                                delegateUId.ToString()), UPDATE_ACCOUNT_FAIL, "operate-vote-error");
-            }
-
-            // Votes: set the new value and erase the old value
-            if (!cw.delegateCache.SetDelegateVotes(delegate.regid, delegate.received_votes)) {
-                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s vote info error",
-                                delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
+/**
+ * Compute the vote staking interest and revoke the votes of the voters but the first ones at the fork
+ * height. The voters are streamed from the vote index in chunks in the order of their regids, so the
+ * memory is bounded by a chunk instead of all the voters. The accounts of a chunk are read in parallel
+ * by the block prefetcher, the voters are then processed one by one on this thread.
+ */
+static bool ComputeVoteStakingInterestAndRevokeVotes(const int32_t currHeight, const uint32_t currBlockTime,
+                                                    CCacheWrapper &cw, CValidationState &state) {
+    uint32_t prefetchThreads = CBlockPrefetcher::GetThreadCount();
+    auto &voteCache = cw.delegateCache.regId2VoteCache;
+    vector<pair<CRegIDKey, vector<CCandidateVote>>> voters;
+    CRegIDKey lastKey;
+    do {
+        // the chunk is read before it is processed, as the votes of its voters are written meanwhile
+        voters.clear();
+        vector<CUserID> uids;
+        CDBIterator<decltype(cw.delegateCache.regId2VoteCache)> it(voteCache);
+        for (it.SeekUpper(&lastKey); it.IsValid() && voters.size() < VOTE_INTEREST_CHUNK_SIZE; it.Next()) {
+            const auto &candidateReceivedVotes = it.GetValue();
+            assert(!candidateReceivedVotes.empty());
+            // If the voter votes to more than one candidates, need to revoke votes from the second
+            // candidates.
+            vector<CCandidateVote> candidateVotes;
+            for (auto voteIt = candidateReceivedVotes.begin() + 1; voteIt < candidateReceivedVotes.end(); ++voteIt) {
+                candidateVotes.emplace_back(VoteType::MINUS_BCOIN, voteIt->GetCandidateUid(),
+                                            voteIt->GetVotedBcoins());  // revoke votes
+                uids.push_back(voteIt->GetCandidateUid());
             }
+            uids.push_back(it.GetKey().regid);
+            voters.emplace_back(it.GetKey(), std::move(candidateVotes));
+        }
+        if (voters.empty())
+            break;
+        lastKey = voters.back().first;
 
-            if (!cw.delegateCache.EraseDelegateVotes(delegate.regid, oldVotes)) {
-                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : erase account id %s vote info error",
-                                delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
-            }
+        if (prefetchThreads > 0)
+            CBlockPrefetcher(*pCdMan, prefetchThreads).PrefetchAccounts(uids);
 
-            if (!cw.accountCache.SaveAccount(delegate)) {
-                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s info error",
-                                account.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-accountdb");
-            }
+        for (const auto &item : voters) {
+            if (!ProcessVoterVotes(item.first.regid, item.second, currHeight, currBlockTime, cw, state))
+                return false;
         }
-    }
+    } while (voters.size() == VOTE_INTEREST_CHUNK_SIZE);
 
     if (!cw.delegateCache.SetLastVoteHeight(currHeight)) {
         return state.DoS(100, ERRORMSG("%s(), save last vote height error", __FUNCTION__),
@@ -1009,14 +1178,60 @@ static bool ComputeVoteStakingInterestAndRevokeVotes(const int32_t currHeight, c
     return true;
 }
 
-bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck) {
+// count and micros of the serially executed txs by type, guarded by cs_main
+static map<TxType, pair<uint64_t, int64_t>> mapTxExecTimes;
+
+void LogTxExecTimes() {
+    LOCK(cs_main);
+    uint64_t totalCount = 0;
+    int64_t totalTime   = 0;
+    for (const auto &item : mapTxExecTimes) {
+        LogPrint(BCLog::INFO, "- Execute %s: %llu txs, %.2fms (%.3fms/tx)\n", GetTxTypeName(item.first),
+                 item.second.first, 0.001 * item.second.second, 0.001 * item.second.second / item.second.first);
+        totalCount += item.second.first;
+        totalTime += item.second.second;
+    }
+    if (totalCount > 0)
+        LogPrint(BCLog::INFO, "- Execute all: %llu txs, %.2fms (%.3fms/tx)\n", totalCount, 0.001 * totalTime,
+                 0.001 * totalTime / totalCount);
+}
+
+static std::shared_ptr<CMinedBlockExecution> spMinedBlockExecution;
+
+void SetMinedBlockExecution(const std::shared_ptr<CMinedBlockExecution> &spExecution) {
+    AssertLockHeld(cs_main);
+    spMinedBlockExecution = spExecution;
+}
+
+// the execution of the miner if it is the one of the block on the state of cw
+static std::shared_ptr<CMinedBlockExecution> TakeMinedBlockExecution(const CBlock &block, CCacheWrapper &cw) {
+    std::shared_ptr<CMinedBlockExecution> spExecution;
+    spExecution.swap(spMinedBlockExecution);
+    if (spExecution == nullptr || spExecution->blockHash != block.GetHash() ||
+        spExecution->prevBlockHash != block.GetPrevBlockHash() ||
+        spExecution->prevBlockHash != cw.blockCache.GetBestBlockHash() ||
+        spExecution->txUndo.vtxundo.size() + 1 != block.vptx.size())
+        return nullptr;
+    return spExecution;
+}
+
+bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck,
+                  CBlockUndo *pBlockUndoOut) {
     AssertLockHeld(cs_main);
+    CMetricTimer metricTimer(metricConnectBlock);
+    CBlockTracer::CSpanScope traceSpan("ConnectBlock");
 
     bool isGensisBlock = block.GetHeight() == 0 && block.GetHash() == SysCfg().GetGenesisBlockHash();
 
+    // the blocks under a finality certificate are executed without checking their signatures during the download
+    bool fAssumeFinalized = !fJustCheck && !isGensisBlock && pbftMan.IsAssumedFinalized(pIndex);
+
     // Check it again in case a previous version let a bad block in
-    if (!isGensisBlock && !CheckBlock(block, state, cw, !fJustCheck, !fJustCheck))
-        return state.DoS(100, ERRORMSG("ConnectBlock() : check block error"), REJECT_INVALID, "check-block-error");
+    if (!isGensisBlock) {
+        CBlockTracer::CSpanScope checkSpan("CheckBlock");
+        if (!CheckBlock(block, state, cw, !fJustCheck, !fJustCheck, !fAssumeFinalized))
+            return state.DoS(100, ERRORMSG("ConnectBlock() : check block error"), REJECT_INVALID, "check-block-error");
+    }
 
     if (!fJustCheck) {
         // Verify that the cache's current state corresponds to the previous block
@@ -1056,11 +1271,23 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     }
 
     VoteDelegate curDelegate;
-    if (!VerifyRewardTx(&block, cw, false, curDelegate))
-        return state.DoS(100, ERRORMSG("ConnectBlock() : verify reward tx error"), REJECT_INVALID, "bad-reward-tx");
+    if (fAssumeFinalized) {
+        VoteDelegateVector delegates;
+        if (!GetBlockDelegate(&block, cw, delegates, curDelegate))
+            return state.DoS(100, ERRORMSG("ConnectBlock() : get the delegate of the block error"), REJECT_INVALID,
+                             "bad-reward-tx");
+    } else {
+        CBlockTracer::CSpanScope verifySpan("VerifyRewardTx");
+        if (!VerifyRewardTx(&block, cw, false, curDelegate))
+            return state.DoS(100, ERRORMSG("ConnectBlock() : verify reward tx error"), REJECT_INVALID, "bad-reward-tx");
+    }
 
     CBlockUndo blockUndo;
     int64_t nStart = GetTimeMicros();
+    // the median prices of the block before, the base of the delta record of the median price index
+    PriceMap prevMedianPrices;
+    if (SysCfg().IsMedianPriceIndex())
+        prevMedianPrices = cw.blockCache.GetMedianPrices();
     std::vector<pair<uint256, CDiskTxPos> > vPos;
     vPos.reserve(block.vptx.size());
 
@@ -1078,6 +1305,23 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         int32_t validHeight   = SysCfg().GetTxCacheHeight();
         uint32_t fuelRate     = block.GetFuelRate();
         uint64_t totalRunStep = 0;
+        bool fReplay          = !fJustCheck && blockReplay.IsInRange(pIndex->height);
+        bool fTxStats         = !fJustCheck && (txExecStats.IsEnabled() || fReplay);
+
+        // the txs of a block of this node were executed by the miner on the same state, their writes are
+        // flushed at once and the undo logs taken as they are
+        std::shared_ptr<CMinedBlockExecution> spMined;
+        if (!fJustCheck && (spMined = TakeMinedBlockExecution(block, cw)) != nullptr) {
+            spMined->spCw->SetBaseViewPtr(&cw);
+            spMined->spCw->Flush();
+        }
+
+        std::unique_ptr<CParallelTxExecutor> pExecutor;
+        if (spMined == nullptr && CParallelTxExecutor::GetThreadCount() > 1 && block.vptx.size() > 2) {
+            pExecutor.reset(new CParallelTxExecutor(block, pIndex, cw, CParallelTxExecutor::GetThreadCount()));
+            CBlockTracer::CSpanScope speculateSpan("Speculate");
+            pExecutor->Speculate();
+        }
 
         for (int32_t index = 1; index < (int32_t)block.vptx.size(); ++index) {
             std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[index];
@@ -1090,15 +1334,49 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
                                  pBaseTx->GetHash().GetHex()), REJECT_INVALID, "tx-invalid-height");
 
             pBaseTx->nFuelRate = fuelRate;
-            CTxUndoOpLogger opLogger(cw, pBaseTx->GetHash(), blockUndo);
+            CBlockTracer::CSpanScope txSpan("ExecuteTx", index, pBaseTx->GetTxTypeName().c_str());
+            CTxExecStats txStats;
+            if (spMined != nullptr) {
+                blockUndo.vtxundo.push_back(std::move(spMined->txUndo.vtxundo[index - 1]));
+            } else if (pExecutor == nullptr || !pExecutor->MergeResult(index, blockUndo, fTxStats ? &txStats : nullptr)) {
+                CTxUndoOpLogger opLogger(cw, pBaseTx->GetHash(), blockUndo);
+                CDBAccessTracker serialTracker;
+                CDBAccessTracker::CScope trackerScope(pExecutor != nullptr ? &serialTracker : nullptr);
+                CDBAccessStats::CScope statsScope(fTxStats ? &txStats.dbStats : nullptr);
+
+                uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
+                CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, &cw, &state);
+                int64_t nTxStart = (SysCfg().IsBenchmark() || fTxStats) ? GetTimeMicros() : 0;
+                bool executed;
+                {
+                    CMetricTimer metricTimer(metricExecuteTx.Get(pBaseTx->GetTxTypeName()));
+                    executed = pBaseTx->ExecuteTx(context);
+                }
+                txStats.wallMicros = fTxStats ? GetTimeMicros() - nTxStart : 0;
+                if (!executed) {
+                    pCdMan->pLogCache->SetExecuteFail(pIndex->height, pBaseTx->GetHash(), state.GetRejectCode(),
+                                                      state.GetRejectReason());
+                    return state.DoS(100, ERRORMSG("ConnectBlock() : txid=%s execute failed, in detail: %s",
+                                     pBaseTx->GetHash().GetHex(), pBaseTx->ToString(cw.accountCache)), REJECT_INVALID, "tx-execute-failed");
+                }
+                if (SysCfg().IsBenchmark() && !fJustCheck) {
+                    auto &txExecTime = mapTxExecTimes[pBaseTx->nTxType];
+                    txExecTime.first++;
+                    txExecTime.second += GetTimeMicros() - nTxStart;
+                }
 
-            uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
-            CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, &cw, &state);
-            if (!pBaseTx->ExecuteTx(context)) {
-                pCdMan->pLogCache->SetExecuteFail(pIndex->height, pBaseTx->GetHash(), state.GetRejectCode(),
-                                                  state.GetRejectReason());
-                return state.DoS(100, ERRORMSG("ConnectBlock() : txid=%s execute failed, in detail: %s",
-                                 pBaseTx->GetHash().GetHex(), pBaseTx->ToString(cw.accountCache)), REJECT_INVALID, "tx-execute-failed");
+                if (pExecutor != nullptr)
+                    pExecutor->AddSerialWrites(serialTracker);
+            }
+
+            if (fTxStats) {
+                txStats.height   = pIndex->height;
+                txStats.index    = index;
+                txStats.txType   = pBaseTx->nTxType;
+                txStats.runSteps = pBaseTx->nRunStep;
+                txExecStats.Add(pBaseTx->GetHash(), txStats);
+                if (fReplay)
+                    blockReplay.AddTx(txStats);
             }
 
             vPos.push_back(make_pair(pBaseTx->GetHash(), pos));
@@ -1122,6 +1400,13 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
             LogPrint(BCLog::DEBUG, "total fuel fee:%d, tx fuel fee:%d runStep:%d fuelRate:%d txid:%s\n", totalFuel,
                      fuel, pBaseTx->nRunStep, fuelRate, pBaseTx->GetHash().GetHex());
         }
+
+        if (pExecutor != nullptr && SysCfg().IsBenchmark())
+            LogPrint(BCLog::INFO, "- Parallel connect merged %u of %u transactions\n", pExecutor->GetMergedCount(),
+                     (uint32_t)block.vptx.size() - 1);
+        if (spMined != nullptr)
+            LogPrint(BCLog::DEBUG, "ConnectBlock() : reused the execution of the %u transactions by the miner\n",
+                     (uint32_t)block.vptx.size() - 1);
     }
 
     // Verify total fuel
@@ -1164,6 +1449,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
 
     {
         // Execute block reward transaction
+        CBlockTracer::CSpanScope rewardSpan("ExecuteRewardTx", 0, block.vptx[0]->GetTxTypeName().c_str());
         uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
         CTxExecuteContext context(pIndex->height, 0, pIndex->nFuelRate, pIndex->nTime, prevBlockTime, &cw, &state);
         CTxUndoOpLogger rewardOpLogger(cw, block.vptx[0]->GetHash(), blockUndo);
@@ -1172,12 +1458,14 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
                                             state.GetRejectReason());
             return state.DoS(100, ERRORMSG("ConnectBlock() : failed to execute reward transaction"));
         }
+        rewardSpan.End();
 
         if (pIndex->height + 1 == (int32_t)SysCfg().GetFeatureForkHeight() &&
             !ComputeVoteStakingInterestAndRevokeVotes(pIndex->height, pIndex->nTime, cw, state)) {
             return state.Abort(_("ConnectBlock() : failed to compute vote staking interest"));
         }
 
+        CBlockTracer::CSpanScope indexSpan("SaveTxIndex");
         if (!SaveTxIndex(block.vptx[0]->GetHash(), cw, state, rewardPos)) {
             return state.Abort(_("ConnectBlock() : failed to save tx index"));
         }
@@ -1188,6 +1476,29 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
             }
         }
 
+        if (SysCfg().IsAddressIndex() && !SaveAddressIndex(block, cw, state)) {
+            return state.Abort(_("ConnectBlock() : failed to save address index"));
+        }
+
+        if (SysCfg().IsBlockFilterIndex() && !SaveBlockFilter(block, cw, state)) {
+            return state.Abort(_("ConnectBlock() : failed to save block filter"));
+        }
+
+        if (SysCfg().IsMedianPriceIndex() && GetFeatureForkVersion(block.GetHeight()) != MAJOR_VER_R1 &&
+            !cw.blockCache.SetMedianPriceRecord(block.GetHeight(), prevMedianPrices, block.GetBlockMedianPrice())) {
+            return state.Abort(_("ConnectBlock() : failed to save median price index"));
+        }
+
+        if (CTraceDBCache::IsEnabled() && CTraceDBCache::GetMaxSize() > 0) {
+            vector<uint256> txids;
+            for (const auto &pTx : block.vptx) {
+                if (pTx->nTxType == WASM_CONTRACT_TX)
+                    txids.push_back(pTx->GetHash());
+            }
+            cw.traceCache.OnBlockConnected(pIndex->height, txids);
+        }
+        indexSpan.End();
+
         // TODO: move the block delegates undo to block_undo
         if (!chain::ProcessBlockDelegates(block, cw, state)) {
             return state.DoS(100, ERRORMSG("ConnectBlock() : failed to process block delegates! block=%d:%s",
@@ -1197,6 +1508,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
 
     if (pIndex->height - BLOCK_REWARD_MATURITY > 0) {
         // Deal mature block reward transaction
+        CBlockTracer::CSpanScope matureSpan("ExecuteMatureRewardTx");
         CBlockIndex *pMatureIndex = pIndex;
         for (int32_t i = 0; i < BLOCK_REWARD_MATURITY; ++i) {
             pMatureIndex = pMatureIndex->pprev;
@@ -1233,6 +1545,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
             if (!FindUndoPos(state, pIndex->nFile, pos, ::GetSerializeSize(blockUndo, SER_DISK, CLIENT_VERSION) + 40))
                 return state.Abort(_("ConnectBlock() : failed to find undo data's position"));
 
+            CBlockTracer::CSpanScope undoSpan("WriteUndo");
             if (!blockUndo.WriteToDisk(pos, pIndex->pprev->GetBlockHash()))
                 return state.Abort(_("ConnectBlock() : failed to write undo data"));
 
@@ -1293,24 +1606,111 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     // Set best block to current account cache.
     cw.blockCache.SetBestBlock(pIndex->GetBlockHash());
 
+    if (pBlockUndoOut != nullptr)
+        *pBlockUndoOut = std::move(blockUndo);
+    return true;
+}
+
+// The block files, oldest first, to remove for the block and undo files to fit in -prune. A file is
+// kept if it has a block the node may still read: the blocks above the global finality or near the
+// tip, the blocks below them reloaded into the tx and price caches when disconnecting down to them,
+// and the txs of the unspent UTXOs read by GetUtxoTxFromChain.
+static void FindFilesToPrune(set<int32_t> &setFilesToPrune) {
+    CBlockIndex *pTip = chainActive.Tip();
+    if (pTip == nullptr || nPruneTarget == 0)
+        return;
+
+    int32_t keepHeight     = pTip->height - MIN_BLOCKS_TO_KEEP;
+    CBlockIndex *pFinIndex = pbftMan.GetGlobalFinIndex();
+    if (pFinIndex != nullptr)
+        keepHeight = min(keepHeight, pFinIndex->height);
+    // the 11 blocks of the price points, see DisconnectBlock
+    keepHeight -= max<int32_t>(SysCfg().GetTxCacheHeight(), 11);
+    if (keepHeight <= 0)
+        return;
+
+    set<int32_t> setUtxoFiles;
+    if (SysCfg().IsTxIndex()) {
+        map<pair<TxID, uint16_t>, uint8_t> utxos;
+        pCdMan->pUtxoCache->txUtxoCache.GetAllElements(utxos);
+        for (const auto &item : utxos) {
+            CDiskTxPos txPos;
+            if (pCdMan->pBlockCache->ReadTxIndex(item.first.first, txPos))
+                setUtxoFiles.insert(txPos.nFile);
+        }
+    }
+
+    LOCK(cs_LastBlockFile);
+    vector<pair<int32_t, CBlockFileInfo>> files;
+    uint64_t usage = 0;
+    for (int32_t nFile = 0; nFile < nLastBlockFile; ++nFile) {
+        CBlockFileInfo info;
+        if (!pCdMan->pBlockIndexDb->ReadBlockFileInfo(nFile, info) || info.IsEmpty())
+            continue;
+        usage += info.nSize + info.nUndoSize;
+        files.emplace_back(nFile, info);
+    }
+    usage += infoLastBlockFile.nSize + infoLastBlockFile.nUndoSize;
+
+    for (const auto &file : files) {
+        if (usage <= nPruneTarget)
+            break;
+        // the heights of a file are not ordered, a fork block may come late
+        if ((int32_t)file.second.nHeightLast >= keepHeight || setUtxoFiles.count(file.first))
+            continue;
+
+        setFilesToPrune.insert(file.first);
+        usage -= file.second.nSize + file.second.nUndoSize;
+    }
+
+    LogPrint(BCLog::INFO, "FindFilesToPrune() : prune %u files below height %d, %u MiB left of the target %u MiB\n",
+             setFilesToPrune.size(), keepHeight, usage >> 20, nPruneTarget >> 20);
+}
+
+// Remove the block and undo files. The block index is synced first, a crash before the files are
+// removed leaves them unreferenced only.
+static bool PruneBlockFiles(const set<int32_t> &setFilesToPrune) {
+    {
+        std::unique_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+        for (const auto &item : mapBlockIndex) {
+            CBlockIndex *pIndex = item.second;
+            if ((pIndex->nStatus & BLOCK_HAVE_MASK) && setFilesToPrune.count(pIndex->nFile)) {
+                pIndex->nStatus &= ~BLOCK_HAVE_MASK;
+                pIndex->nFile    = 0;
+                pIndex->nDataPos = 0;
+                pIndex->nUndoPos = 0;
+                if (!pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(pIndex)))
+                    return ERRORMSG("PruneBlockFiles() : failed to write the block index");
+            }
+        }
+    }
+
+    for (int32_t nFile : setFilesToPrune) {
+        if (!pCdMan->pBlockIndexDb->WriteBlockFileInfo(nFile, CBlockFileInfo()))
+            return ERRORMSG("PruneBlockFiles() : failed to write the block file info");
+    }
+    if (!pCdMan->pBlockIndexDb->Sync())
+        return ERRORMSG("PruneBlockFiles() : failed to sync the block index");
+
+    for (int32_t nFile : setFilesToPrune) {
+        GetDiskFileMapCache().Invalidate(nFile);
+        GetDiskFileWriter().Close(nFile);
+        boost::system::error_code ec;
+        boost::filesystem::remove(GetDataDir() / "blocks" / strprintf("blk%05u.dat", nFile), ec);
+        boost::filesystem::remove(GetDataDir() / "blocks" / strprintf("rev%05u.dat", nFile), ec);
+        LogPrint(BCLog::INFO, "PruneBlockFiles() : removed blk%05u.dat and rev%05u.dat\n", nFile, nFile);
+    }
     return true;
 }
 
 // Update the on-disk chain state.
 bool static WriteChainState(CValidationState &state) {
     static int64_t nLastWrite = 0;
-    uint32_t cacheSize        =
-        pCdMan->pSysParamCache->GetCacheSize() +
-        pCdMan->pAccountCache->GetCacheSize() +
-        pCdMan->pAssetCache->GetCacheSize() +
-        pCdMan->pContractCache->GetCacheSize() +
-        pCdMan->pDelegateCache->GetCacheSize() +
-        pCdMan->pCdpCache->GetCacheSize() +
-        pCdMan->pClosedCdpCache->GetCacheSize() +
-        pCdMan->pDexCache->GetCacheSize() +
-        pCdMan->pBlockCache->GetCacheSize() +
-        pCdMan->pLogCache->GetCacheSize() +
-        pCdMan->pReceiptCache->GetCacheSize();
+    uint32_t cacheSize = 0;
+    for (const auto &item : pCdMan->GetCacheSizes()) {
+        metricDbCacheBytes.Get(item.first).Set(item.second);
+        cacheSize += item.second;
+    }
 
     if (!IsInitialBlockDownload() || cacheSize > SysCfg().GetCacheSize() ||
         GetTimeMicros() > nLastWrite + 60 * 1000000) {
@@ -1322,9 +1722,19 @@ bool static WriteChainState(CValidationState &state) {
         if (!CheckDiskSpace(cacheSize))
             return state.Error("out of disk space");
 
-        FlushBlockFile();
+        // the block files are synced first, so the best block of every persisted flush is on disk
+        if (!FlushBlockFile())
+            return state.Abort(_("Failed to write the block files"));
+        if (fPruneMode && fCheckForPruning) {
+            fCheckForPruning = false;
+            set<int32_t> setFilesToPrune;
+            FindFilesToPrune(setFilesToPrune);
+            if (!setFilesToPrune.empty() && !PruneBlockFiles(setFilesToPrune))
+                return state.Error("failed to prune the block files");
+        }
         // pCdMan->pBlockCache->Sync();
-        pCdMan->Flush();
+        if (!pCdMan->FlushAsync())
+            return state.Error("failed to flush the db caches");
         mapForkCache.clear();
         nLastWrite = GetTimeMicros();
     }
@@ -1333,7 +1743,13 @@ bool static WriteChainState(CValidationState &state) {
 
 // Update chainActive and related internal data structures.
 void static UpdateTip(CBlockIndex *pIndexNew, const CBlock &block) {
-    chainActive.SetTip(pIndexNew);
+    {
+        std::unique_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+        chainActive.SetTip(pIndexNew);
+    }
+    CStateSnapshot::OnTipChanged();
+    rpcResultCache.SetChainHeights(pIndexNew->height, pbftMan.GetGlobalFinIndex()->height);
+    nTipBlockTime = pIndexNew->GetBlockTime();
 
     SyncTransaction(uint256(), nullptr, &block);
 
@@ -1377,7 +1793,7 @@ bool static DisconnectTip(CValidationState &state) {
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
     {
-        auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
+        auto spCW = std::make_shared<CCacheWrapper>(pCdMan, true);
 
         if (!DisconnectBlock(block, *spCW, pIndexDelete, state))
             return ERRORMSG("DisconnectTip() : DisconnectBlock %s failed", pIndexDelete->GetBlockHash().ToString());
@@ -1393,6 +1809,10 @@ bool static DisconnectTip(CValidationState &state) {
                 return ERRORMSG("DisconnectTip() : failed to read block [%d]: %s", pPreBlockIndex->height,
                                 pPreBlockIndex->GetBlockHash().ToString());
         }
+
+        if (pStateDiffPublisher)
+            pStateDiffPublisher->PublishDisconnect(pIndexDelete);
+        mempool.SetFullRescan();
     }
     if (SysCfg().IsBenchmark())
         LogPrint(BCLog::INFO, "- Disconnect: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
@@ -1401,6 +1821,7 @@ bool static DisconnectTip(CValidationState &state) {
         return false;
     // Update chainActive and related variables.
     UpdateTip(pIndexDelete->pprev, block);
+    txLatencyTracer.OnBlockDisconnected(pIndexDelete->height);
     // Resurrect mempool transactions from the disconnected block.
     for (const auto &pTx : block.vptx) {
         list<std::shared_ptr<CBaseTx> > removed;
@@ -1420,18 +1841,35 @@ bool static DisconnectTip(CValidationState &state) {
 // Connect a new block to chainActive.
 bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     assert(pIndexNew->pprev == chainActive.Tip());
+    CBlockTracer::CBlockScope blockTrace(pIndexNew->height, pIndexNew->GetBlockHash());
+    bool fReplay = blockReplay.IsInRange(pIndexNew->height);
+    CDBPrefixStats::CScope prefixStatsScope(fReplay ? blockReplay.GetPrefixStats() : nullptr);
+    CBlockReplay::CBlockTimes replayTimes;
+    int64_t nReadStart = GetTimeMicros();
     // Read block from disk.
     CBlock block;
-    if (!ReadBlockFromDisk(pIndexNew, block))
-        return state.Abort(strprintf("Failed to read block hash: %s", pIndexNew->GetBlockHash().GetHex()));
+    {
+        CBlockTracer::CSpanScope readSpan("ReadBlockFromDisk");
+        if (!ReadBlockFromDisk(pIndexNew, block))
+            return state.Abort(strprintf("Failed to read block hash: %s", pIndexNew->GetBlockHash().GetHex()));
+    }
 
     // Apply the block automatically to the chain state.
-    int64_t nStart = GetTimeMicros();
+    int64_t nStart   = GetTimeMicros();
+    replayTimes.read = nStart - nReadStart;
     {
         CInv inv(MSG_BLOCK, pIndexNew->GetBlockHash());
 
-        auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
-        if (!ConnectBlock(block, *spCW, pIndexNew, state)) {
+        // read the state known from the txs ahead of their execution, a missing key is read by the tx itself
+        uint32_t prefetchThreads = CBlockPrefetcher::GetThreadCount();
+        if (prefetchThreads > 0 && block.vptx.size() > 1) {
+            CBlockTracer::CSpanScope prefetchSpan("Prefetch");
+            CBlockPrefetcher(*pCdMan, prefetchThreads).Prefetch(block);
+        }
+
+        auto spCW = std::make_shared<CCacheWrapper>(pCdMan, true);
+        CBlockUndo blockUndo;
+        if (!ConnectBlock(block, *spCW, pIndexNew, state, false, &blockUndo)) {
             if (state.IsInvalid()) {
                 InvalidBlockFound(pIndexNew, state);
             }
@@ -1444,22 +1882,54 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
         }
 
         // Need to re-sync all to global cache layer.
+        int64_t nFlushStart = GetTimeMicros();
+        replayTimes.connect = nFlushStart - nStart;
+        CBlockTracer::CSpanScope flushSpan("Flush");
         spCW->Flush();
+        if (SysCfg().IsGenReceipt() && CTxReceiptDBCache::GetRetention() > 0) {
+            vector<TxID> txids;
+            for (const auto &pTx : block.vptx)
+                txids.push_back(pTx->GetHash());
+            pCdMan->pReceiptCache->OnBlockConnected(pIndexNew->height, txids);
+        }
+        pCdMan->pLogCache->OnBlockConnected(pIndexNew->height);
+        replayTimes.flush = GetTimeMicros() - nFlushStart;
+
+        mempool.AddBlockChanges(blockUndo);
+        if (pStateDiffPublisher)
+            pStateDiffPublisher->PublishConnect(pIndexNew, blockUndo, *spCW);
     }
 
     if (SysCfg().IsBenchmark())
         LogPrint(BCLog::INFO, "- Connect: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
+    int64_t nWriteStart = GetTimeMicros();
 
     // Write the chain state to disk, if necessary.
-    if (!WriteChainState(state))
-        return false;
+    {
+        CBlockTracer::CSpanScope writeSpan("WriteChainState");
+        if (!WriteChainState(state))
+            return false;
+    }
 
     // Update chainActive & related variables.
-    UpdateTip(pIndexNew, block);
+    {
+        CBlockTracer::CSpanScope tipSpan("UpdateTip");
+        UpdateTip(pIndexNew, block);
+    }
+    txLatencyTracer.OnBlockConnected(pIndexNew->height, block.vptx);
+
+    if (fReplay) {
+        replayTimes.height = pIndexNew->height;
+        replayTimes.txs    = block.vptx.size();
+        replayTimes.write  = GetTimeMicros() - nWriteStart;
+        blockReplay.AddBlock(replayTimes);
+    }
 
+    mempool.AddBlockFees(pIndexNew->height, block.vptx);
     for (auto &pTxItem : block.vptx) {
-        mempool.memPoolTxs.erase(pTxItem->GetHash());
+        mempool.Erase(pTxItem->GetHash());
     }
+    blockTrace.SetConnected();
     return true;
 }
 
@@ -1533,7 +2003,7 @@ bool connectBlockOnFinChain(CBlockIndex* pNewIndex, CValidationState& state){
             }
         }
 
-        mempool.ReScanMemPoolTx();
+        mempool.ReScanMemPoolTx(GetElementForBurn(chainActive.Tip()));
     }
     return true ;
 
@@ -1586,7 +2056,7 @@ bool ActivateBestChain(CValidationState &state, CBlockIndex* pNewIndex) {
                 return false;
 
             if (chainActive.Tip() && chainMostWork.Contains(chainActive.Tip())){
-                mempool.ReScanMemPoolTx();
+                mempool.ReScanMemPoolTx(GetElementForBurn(chainActive.Tip()));
             }
         }
 
@@ -1608,7 +2078,7 @@ bool ActivateBestChain(CValidationState &state, CBlockIndex* pNewIndex) {
             }
 
             if (chainActive.Contains(chainMostWork.Tip())) {
-                mempool.ReScanMemPoolTx();
+                mempool.ReScanMemPoolTx(GetElementForBurn(chainActive.Tip()));
             }
         }
     }
@@ -1633,17 +2103,16 @@ bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos
         return state.Invalid(ERRORMSG("AddToBlockIndex() : %s already exists", hash.ToString()), 0, "duplicate");
 
     // Construct new block index object
-    CBlockIndex *pIndexNew = new CBlockIndex(block);
-
-    assert(pIndexNew);
+    CBlockIndex *pIndexNew = blockIndexPool.Create(block);
     {
         LOCK(cs_nBlockSequenceId);
         pIndexNew->nSequenceId = nBlockSequenceId++;
     }
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
+    std::unique_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+    BlockMap::iterator mi     = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
     // LogPrint(BCLog::INFO, "in map hash:%s map size:%d\n", hash.GetHex(), mapBlockIndex.size());
-    pIndexNew->pBlockHash                        = &((*mi).first);
-    map<uint256, CBlockIndex *>::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
+    pIndexNew->pBlockHash     = &((*mi).first);
+    BlockMap::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
     if (miPrev != mapBlockIndex.end()) {
         pIndexNew->pprev  = (*miPrev).second;
         pIndexNew->height = pIndexNew->pprev->height + 1;
@@ -1661,6 +2130,7 @@ bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos
     pIndexNew->nDataPos   = pos.nPos;
     pIndexNew->nUndoPos   = 0;
     pIndexNew->nStatus    = BLOCK_VALID_TRANSACTIONS | BLOCK_HAVE_DATA;
+    chainIndexLock.unlock();
     setBlockIndexValid.insert(pIndexNew);
 
     if (!pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(pIndexNew)))
@@ -1704,7 +2174,9 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, uint32_t nAddSize
     } else {
         while (infoLastBlockFile.nSize + nAddSize >= MAX_BLOCKFILE_SIZE) {
             LogPrint(BCLog::INFO, "Leaving block file %d: %s\n", nLastBlockFile, infoLastBlockFile.ToString());
-            FlushBlockFile(true);
+            if (!FlushBlockFile(true))
+                return state.Abort(_("Failed to write the block files"));
+            fCheckForPruning = true;
             nLastBlockFile++;
             infoLastBlockFile.SetNull();
             pCdMan->pBlockIndexDb->ReadBlockFileInfo(nLastBlockFile, infoLastBlockFile);  // check whether data for the new file somehow already exist; can fail just fine
@@ -1721,14 +2193,9 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, uint32_t nAddSize
         uint32_t nOldChunks = (pos.nPos + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
         uint32_t nNewChunks = (infoLastBlockFile.nSize + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
         if (nNewChunks > nOldChunks) {
-            if (CheckDiskSpace(nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos)) {
-                FILE *file = OpenBlockFile(pos);
-                if (file) {
-                    LogPrint(BCLog::INFO, "Pre-allocating up to position 0x%x in blk%05u.dat\n", nNewChunks * BLOCKFILE_CHUNK_SIZE, pos.nFile);
-                    AllocateFileRange(file, pos.nPos, nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos);
-                    fclose(file);
-                }
-            } else
+            if (CheckDiskSpace(nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos))
+                GetDiskFileWriter().Allocate(pos, "blk", nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos);
+            else
                 return state.Error("out of disk space");
         }
     }
@@ -1742,12 +2209,35 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, uint32_t nAddSize
     return true;
 }
 
+// Drop the fork states made on another active tip or forking under the global finality block, which can not be
+// the best chain any more, then the least recently used ones over MAX_FORK_STATES.
+static void PruneForkStates() {
+    uint256 tipHash   = chainActive.Tip()->GetBlockHash();
+    int32_t finHeight = pbftMan.GetGlobalFinIndex()->height;
+    for (auto it = mapForkCache.begin(); it != mapForkCache.end();) {
+        if (it->second.activeTipHash != tipHash || it->second.baseHeight < finHeight)
+            it = mapForkCache.erase(it);
+        else
+            ++it;
+    }
+
+    while (mapForkCache.size() > MAX_FORK_STATES) {
+        auto itOldest = std::min_element(mapForkCache.begin(), mapForkCache.end(),
+            [](const pair<const uint256, CForkState> &a, const pair<const uint256, CForkState> &b) {
+                return a.second.lastUsedSeq < b.second.lastUsedSeq;
+            });
+        mapForkCache.erase(itOldest);
+    }
+}
+
 bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValidationState &state) {
     bool forkChainTipFound = false;
     uint256 forkChainTipBlockHash;
     vector<CBlock> vPreBlocks;
     std::shared_ptr<CCacheWrapper> spCW = nullptr;
 
+    PruneForkStates();
+
     // If the block's previous block is not the active chain's tip, find the forked point.
     while (!chainActive.Contains(pPreBlockIndex)) {
         if (!forkChainTipFound) {
@@ -1784,54 +2274,30 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
                 "ProcessForkedChain() : block at fork chain too earlier than tip block hash=%s block height=%d\n",
                 block.GetHash().GetHex(), block.GetHeight()));
 
+    // a fork tip is extended in place, a fork point is kept for the other forks from it and layered on
+    bool fForkTip = forkChainTipFound;
     if (forkChainTipFound) {
-        spCW = mapForkCache[forkChainTipBlockHash];
+        spCW = mapForkCache[forkChainTipBlockHash].spCw;
     } else if (mapForkCache.count(pPreBlockIndex->GetBlockHash())) {
         forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
-        spCW                  = mapForkCache[forkChainTipBlockHash];
+        spCW                  = mapForkCache[forkChainTipBlockHash].spCw;
         forkChainTipFound     = true;
         LogPrint(BCLog::INFO, "ProcessForkedChain() : found [%d]: %s in cache\n",
             pPreBlockIndex->height, forkChainTipBlockHash.GetHex());
     } else {
         spCW                     = CCacheWrapper::NewCopyFrom(pCdMan);
         int64_t beginTime        = GetTimeMillis();
-        CBlockIndex *pBlockIndex = chainActive.Tip();
 
-        while (pPreBlockIndex != pBlockIndex) {
-            LogPrint(BCLog::INFO, "ProcessForkedChain() : disconnect block [%d]: %s\n", pBlockIndex->height,
-                     pBlockIndex->GetBlockHash().GetHex());
-
-            CBlock block;
-            if (!ReadBlockFromDisk(pBlockIndex, block))
-                return state.Abort(_("Failed to read block"));
-
-            bool bfClean = true;
-            if (!DisconnectBlock(block, *spCW, pBlockIndex, state, &bfClean)) {
-                return ERRORMSG("ProcessForkedChain() : failed to disconnect block [%d]: %s", pBlockIndex->height,
-                                pBlockIndex->GetBlockHash().ToString());
-            }
-
-            pBlockIndex = pBlockIndex->pprev;
-        }  // Rollback the active chain to the forked point.
-
-        mapForkCache[pPreBlockIndex->GetBlockHash()] = spCW;
-        forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
-        forkChainTipFound     = true;
-        LogPrint(BCLog::INFO, "ProcessForkedChain() : add [%d]: %s to cache\n", pPreBlockIndex->height,
-                 pPreBlockIndex->GetBlockHash().GetHex());
+        // Rollback the active chain to the forked point, by the undo logs of the blocks composed
+        if (!DisconnectBlocks(*spCW, chainActive.Tip(), pPreBlockIndex, state)) {
+            return ERRORMSG("ProcessForkedChain() : failed to disconnect blocks to [%d]: %s", pPreBlockIndex->height,
+                            pPreBlockIndex->GetBlockHash().ToString());
+        }
 
         LogPrint(BCLog::INFO, "ProcessForkedChain() : disconnect blocks elapse: %lld ms\n", GetTimeMillis() - beginTime);
-    }
-
-
-    uint256 forkChainBestBlockHash   = spCW->blockCache.GetBestBlockHash();
-    int32_t forkChainBestBlockHeight = mapBlockIndex[forkChainBestBlockHash]->height;
-    LogPrint(BCLog::INFO, "ProcessForkedChain() : fork chain's best block [%d]: %s\n", forkChainBestBlockHeight,
-             forkChainBestBlockHash.GetHex());
 
-    {
-        // Set base to null and rebuild memory cache.
-        CBlockIndex *pBlockIndex = mapBlockIndex[forkChainBestBlockHash];
+        // Rebuild the price point memory cache of the fork point, the connected blocks maintain it since
+        CBlockIndex *pBlockIndex = pPreBlockIndex;
         CBlock block;
 
         // TODO: parameterize 11
@@ -1847,10 +2313,26 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
 
             pBlockIndex = pBlockIndex->pprev;
         }
+
+        CForkState &baseState   = mapForkCache[pPreBlockIndex->GetBlockHash()];
+        baseState.spCw          = spCW;
+        baseState.activeTipHash = chainActive.Tip()->GetBlockHash();
+        baseState.baseHeight    = pPreBlockIndex->height;
+        forkChainTipBlockHash   = pPreBlockIndex->GetBlockHash();
+        forkChainTipFound       = true;
+        LogPrint(BCLog::INFO, "ProcessForkedChain() : add [%d]: %s to cache\n", pPreBlockIndex->height,
+                 pPreBlockIndex->GetBlockHash().GetHex());
     }
+    mapForkCache[forkChainTipBlockHash].lastUsedSeq = ++nForkStateSeq;
+
+    uint256 forkChainBestBlockHash   = spCW->blockCache.GetBestBlockHash();
+    int32_t forkChainBestBlockHeight = mapBlockIndex[forkChainBestBlockHash]->height;
+    LogPrint(BCLog::INFO, "ProcessForkedChain() : fork chain's best block [%d]: %s\n", forkChainBestBlockHeight,
+             forkChainBestBlockHash.GetHex());
 
     if (!vPreBlocks.empty()) {
-        auto spNewForkCW = std::make_shared<CCacheWrapper>(spCW.get());
+        // kept in mapForkCache as the new fork tip
+        auto spNewForkCW = std::make_shared<CCacheWrapper>(spCW.get(), false);
         // Connect all of the forked chain's blocks.
         for (auto rIter = vPreBlocks.rbegin(); rIter != vPreBlocks.rend(); ++rIter) {
             LogPrint(BCLog::INFO, "ProcessForkedChain() : ConnectBlock block height=%d hash=%s\n", rIter->GetHeight(),
@@ -1866,14 +2348,16 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
             }
         }
 
-        spNewForkCW->Flush();  // flush to spNewForkCW
-
-        vector<CBlock>::iterator iterBlock = vPreBlocks.begin();
-        if (forkChainTipFound) {
+        CForkState forkState = mapForkCache[forkChainTipBlockHash];
+        if (fForkTip) {
+            spNewForkCW->Flush();  // flush to spCW
             mapForkCache.erase(forkChainTipBlockHash);
+        } else {
+            forkState.spBaseCw = spCW;
+            forkState.spCw     = spNewForkCW;
+            spCW               = spNewForkCW;
         }
-
-        mapForkCache[iterBlock->GetHash()] = spCW;
+        mapForkCache[vPreBlocks.begin()->GetHash()] = forkState;
     }
 
     VoteDelegate curDelegate;
@@ -1884,9 +2368,27 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
     return true;
 }
 
-bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw, bool fCheckTx, bool fCheckMerkleRoot) {
-    if (block.vptx.empty() || block.vptx.size() > MAX_BLOCK_SIZE ||
-        ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) > MAX_BLOCK_SIZE)
+bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw, bool fCheckTx, bool fCheckMerkleRoot,
+                bool fCheckSig) {
+    CMetricTimer metricTimer(metricCheckBlock);
+    if (block.vptx.empty() || block.vptx.size() > MAX_BLOCK_SIZE)
+        return state.DoS(100, ERRORMSG("CheckBlock() : size limits failed"), REJECT_INVALID, "bad-blk-length");
+
+    // Hash the txs and verify their signatures on the sigcheck threads before anything reads them.
+    // The block was deserialized from a message or a file already, so its size is bounded here.
+    if (nSigCheckThreads > 0) {
+        int64_t beginTime = GetTimeMicros();
+        vector<CSignatureCheck> vChecks;
+        vChecks.reserve(block.vptx.size());
+        for (const auto &pBaseTx : block.vptx)
+            AddSignatureCheck(pBaseTx.get(), cw, fCheckTx && fCheckSig, vChecks);
+        RunSignatureChecks(vChecks);
+        if (SysCfg().IsBenchmark())
+            LogPrint(BCLog::INFO, "- Prepare %u transactions: %.2fms\n", vChecks.size(),
+                     MILLI * (GetTimeMicros() - beginTime));
+    }
+
+    if (::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) > MAX_BLOCK_SIZE)
         return state.DoS(100, ERRORMSG("CheckBlock() : size limits failed"), REJECT_INVALID, "bad-blk-length");
 
     if ((block.GetHeight() != 0 || block.GetHash() != SysCfg().GetGenesisBlockHash()) &&
@@ -1918,6 +2420,8 @@ bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
 
         uint32_t prevBlockTime = block.GetTime(); // the prev block maybe unkown when checking block
         CTxExecuteContext context(block.GetHeight(), i + 1, block.GetFuelRate(), block.GetTime(), prevBlockTime, &cw, &state);
+        context.erase_sig_cache = true;
+        context.skip_sig_check  = !fCheckSig;
         if (fCheckTx && !block.vptx[i]->CheckTx(context))
             return ERRORMSG("CheckBlock() : CheckTx failed, txid: %s", block.vptx[i]->GetHash().GetHex());
 
@@ -1957,6 +2461,75 @@ bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
     return true;
 }
 
+static bool IsPreValidationRelayEnabled() {
+    static const bool fEnabled = SysCfg().GetBoolArg("-prevalidationrelay", DEFAULT_PREVALIDATION_RELAY);
+    return fEnabled;
+}
+
+// Relay a new tip to the peers. The peers in high bandwidth mode get the compact block at once, as the producers
+// ask for, the sendheaders peers get its header. A block not validated yet goes only to them, neither is punished
+// for relaying an invalid one; once it is validated the peers not knowing it yet get it as before.
+// The block messages are serialized once for all the peers and kept for their getdata.
+static void RelayBlock(const CBlock &block, bool mining, bool fValidated) {
+    uint256 blockHash = block.GetHash();
+    CInv inv(MSG_BLOCK, blockHash);
+    CSharedNetMsg spCmpctMsg, spBlockMsg, spHeadersMsg;
+    LOCK(cs_vNodes);
+    for (auto pNode : vNodes) {
+        // the peer it came from and the peers it went to before its validation
+        if (pNode->IsInventoryKnown(inv))
+            continue;
+
+        // the priority peers get the full block without any round trip
+        if (pNode->fPriority) {
+            if (!fValidated)
+                continue;
+
+            if (!spBlockMsg) {
+                spBlockMsg = MakeSharedNetMsg(NetMsgType::BLOCK, block);
+                AddBlockMessage(NetMsgType::BLOCK, blockHash, spBlockMsg);
+            }
+
+            pNode->AddInventoryKnown(inv);
+            pNode->PushSharedMessage(spBlockMsg);
+            continue;
+        }
+        if (pNode->fCompactHighBandwidth) {
+            if (!spCmpctMsg) {
+                spCmpctMsg = MakeSharedNetMsg(NetMsgType::CMPCTBLOCK, CBlockHeaderAndShortTxIDs(block));
+                AddBlockMessage(NetMsgType::CMPCTBLOCK, blockHash, spCmpctMsg);
+            }
+
+            pNode->AddInventoryKnown(inv);
+            pNode->PushSharedMessage(spCmpctMsg);
+            continue;
+        }
+        if (pNode->fPreferHeaders) {
+            // it is fetched along the header chain, from disk once validated
+            if (!spHeadersMsg)
+                spHeadersMsg = MakeSharedNetMsg(NetMsgType::HEADERS, vector<CBlock>(1, CBlock(block.GetBlockHeader())));
+
+            pNode->AddInventoryKnown(inv);
+            pNode->PushSharedMessage(spHeadersMsg);
+            continue;
+        }
+        if (!fValidated)
+            continue;
+
+        //p2p_xiaoyu_20191116
+        if (mining) {
+            if (!spBlockMsg) {
+                spBlockMsg = MakeSharedNetMsg(NetMsgType::BLOCK, block);
+                AddBlockMessage(NetMsgType::BLOCK, blockHash, spBlockMsg);
+            }
+            pNode->PushSharedMessage(spBlockMsg);
+            continue;
+        }
+        if (chainActive.Height() > (pNode->nStartingHeight != -1 ? pNode->nStartingHeight - 2000 : 0))
+            pNode->PushInventory(inv);
+    }
+}
+
 bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, bool mining) {
     AssertLockHeld(cs_main);
 
@@ -1978,7 +2551,7 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     CBlockIndex *pPrevBlockIndex = nullptr;
     int32_t height = 0;
     if (block.GetHeight() != 0 || blockHash != SysCfg().GetGenesisBlockHash()) {
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
+        BlockMap::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
         if (mi == mapBlockIndex.end())
             return state.DoS(10, ERRORMSG("AcceptBlock() : prev block not found"), 0, "bad-prevblk");
 
@@ -2036,22 +2609,11 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     // Relay inventory, but don't relay old inventory during initial block download
     CBlockIndex* pTip = chainActive.Tip() ;
     if (pTip->GetBlockHash() == blockHash) {
-        {
-            LOCK(cs_vNodes);
-            for (auto pNode : vNodes) {
-                //p2p_xiaoyu_20191116
-                if (mining) {
-                    pNode->PushMessage(NetMsgType::BLOCK, block);
-                    continue;
-                }
-                if (chainActive.Height() > (pNode->nStartingHeight != -1 ? pNode->nStartingHeight - 2000 : 0))
-                    pNode->PushInventory(CInv(MSG_BLOCK, blockHash));
-            }
-        }
+        RelayBlock(block, mining, true);
 
         VoteDelegateVector delegates;
         if (pCdMan->pDelegateCache->GetActiveDelegates(delegates)) {
-            pbftContext.SaveMinersByHash(blockHash, delegates);
+            pbftContext.SaveMinersByHash(blockHash, delegates, *pCdMan->pAccountCache);
         }
 
         BroadcastBlockConfirm(pTip) ;
@@ -2195,13 +2757,13 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
                              "duplicate");
 
 
-    if (mapOrphanBlocks.count(blockHash))
+    if (orphanBlocks.Have(blockHash))
         return state.Invalid(
             ERRORMSG("ProcessBlock() : block (orphan) [%u]: %s exists", blockHeight, blockHash.ToString()), 0,
             "duplicate");
 
     int64_t llBeginCheckBlockTime = GetTimeMillis();
-    auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
+    auto spCW = std::make_shared<CCacheWrapper>(pCdMan, true);
 
     // Preliminary checks
     if (!CheckBlock(*pBlock, state, *spCW, false)) {
@@ -2220,32 +2782,30 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
 
         // Accept orphans as long as there is a node to request its parents from
         if (pFrom) {
-            bool success = PruneOrphanBlocks(pBlock->GetHeight());
-            if (success) {
-                COrphanBlock *pblock2 = new COrphanBlock();
-                CDataStream ss(SER_DISK, CLIENT_VERSION);
-                ss << *pBlock;
-                pblock2->vchBlock      = vector<uint8_t>(ss.begin(), ss.end());
-                pblock2->blockHash     = blockHash;
-                pblock2->prevBlockHash = pBlock->GetPrevBlockHash();
-                pblock2->height        = pBlock->GetHeight();
-                mapOrphanBlocks.insert(make_pair(blockHash, pblock2));
-                mapOrphanBlocksByPrev.insert(make_pair(pblock2->prevBlockHash, pblock2));
-                setOrphanBlock.insert(pblock2);
-            }
+            bool success = orphanBlocks.Add(*pBlock, chainActive.Height());
 
             // Ask this guy to fill in what we're missing
             LogPrint(BCLog::NET,
                      "receive an orphan block height=%d hash=%s, %s it, leading to getblocks (current block height=%d, "
                      "current block hash=%s, orphan blocks=%d)\n",
                      pBlock->GetHeight(), pBlock->GetHash().GetHex(), success ? "keep" : "abandon",
-                     chainActive.Height(), chainActive.Tip()->GetBlockHash().GetHex(), mapOrphanBlocksByPrev.size());
+                     chainActive.Height(), chainActive.Tip()->GetBlockHash().GetHex(), orphanBlocks.Size());
 
-            PushGetBlocksOnCondition(pFrom, chainActive.Tip(), GetOrphanRoot(blockHash));
+            // the parents of an orphan on the best header chain are scheduled by the headers-first sync
+            if (!headerChain.Have(blockHash))
+                PushGetBlocksOnCondition(pFrom, chainActive.Tip(), orphanBlocks.GetRoot(blockHash));
         }
         return true;
     }
 
+    // A block of the scheduled producer on the tip is pushed out as soon as its header and signature check out,
+    // the peers receive it while it is validated below
+    if (pFrom && IsPreValidationRelayEnabled() && pBlock->GetPrevBlockHash() == chainActive.Tip()->GetBlockHash() &&
+        !IsInitialBlockDownload() && VerifyBlockProducer(pBlock, *spCW)) {
+        LogPrint(BCLog::NET, "relay block [%u]: %s before its validation\n", blockHeight, blockHash.ToString());
+        RelayBlock(*pBlock, false, false);
+    }
+
     int64_t llAcceptBlockTime = GetTimeMillis();
 
     bool mining = (pFrom)?false:true;
@@ -2260,14 +2820,9 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
     vector<uint256> vWorkQueue;
     vWorkQueue.push_back(blockHash);
     for (uint32_t i = 0; i < vWorkQueue.size(); i++) {
-        uint256 prevBlockHash = vWorkQueue[i];
-        for (multimap<uint256, COrphanBlock *>::iterator mi = mapOrphanBlocksByPrev.lower_bound(prevBlockHash);
-             mi != mapOrphanBlocksByPrev.upper_bound(prevBlockHash); ++mi) {
-            CBlock block;
-            {
-                CDataStream ss(mi->second->vchBlock, SER_DISK, CLIENT_VERSION);
-                ss >> block;
-            }
+        vector<CBlock> children;
+        orphanBlocks.TakeChildren(vWorkQueue[i], children);
+        for (auto &block : children) {
             block.BuildMerkleTree();
             /**
              * Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan resolution
@@ -2275,13 +2830,9 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
              */
             CValidationState stateDummy;
             if (AcceptBlock(block, stateDummy)) {
-                vWorkQueue.push_back(mi->second->blockHash);
+                vWorkQueue.push_back(block.GetHash());
             }
-            setOrphanBlock.erase(mi->second);
-            mapOrphanBlocks.erase(mi->second->blockHash);
-            delete mi->second;
         }
-        mapOrphanBlocksByPrev.erase(prevBlockHash);
     }
 
     LogPrint(BCLog::INFO, "ProcessBlock[%d] elapse time:%lld ms\n", pBlock->GetHeight(), GetTimeMillis() - llBeginTime);
@@ -2312,16 +2863,20 @@ bool static LoadBlockIndexDB() {
 
     boost::this_thread::interruption_point();
 
-    // Calculate nChainWork
-    vector<pair<int32_t, CBlockIndex *> > vSortedByHeight;
-    vSortedByHeight.reserve(mapBlockIndex.size());
-    for (const auto &item : mapBlockIndex) {
-        CBlockIndex *pIndex = item.second;
-        vSortedByHeight.push_back(make_pair(pIndex->height, pIndex));
-    }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    for (const auto &item : vSortedByHeight) {
-        CBlockIndex *pIndex = item.second;
+    // Calculate nChainWork, the indexes are bucketed by height instead of sorted
+    int32_t maxHeight = -1;
+    for (const auto &item : mapBlockIndex)
+        maxHeight = max(maxHeight, item.second->height);
+    vector<uint32_t> heightOffsets(maxHeight + 2, 0);
+    for (const auto &item : mapBlockIndex)
+        heightOffsets[item.second->height + 1]++;
+    for (int32_t h = 0; h <= maxHeight; h++)
+        heightOffsets[h + 1] += heightOffsets[h];
+    vector<CBlockIndex *> vSortedByHeight(mapBlockIndex.size());
+    for (const auto &item : mapBlockIndex)
+        vSortedByHeight[heightOffsets[item.second->height]++] = item.second;
+
+    for (CBlockIndex *pIndex : vSortedByHeight) {
         pIndex->nChainWork  = pIndex->height;
         pIndex->nChainTx    = (pIndex->pprev ? pIndex->pprev->nChainTx : 0) + pIndex->nTx;
         if ((pIndex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS && !(pIndex->nStatus & BLOCK_FAILED_MASK))
@@ -2329,7 +2884,36 @@ bool static LoadBlockIndexDB() {
         if (pIndex->nStatus & BLOCK_FAILED_MASK &&
             (!pIndexBestInvalid || pIndex->nChainWork > pIndexBestInvalid->nChainWork))
             pIndexBestInvalid = pIndex;
-        if (pIndex->pprev)
+    }
+
+    // The skip pointers of the highest chain are taken from its blocks by height on the threads, the few
+    // blocks of the forks then build theirs in height order on top of them.
+    vector<CBlockIndex *> vChain;
+    if (!vSortedByHeight.empty()) {
+        CBlockIndex *pIndex = vSortedByHeight.back();
+        vChain.resize(pIndex->height + 1);
+        for (; pIndex && (size_t)pIndex->height < vChain.size() && !vChain[pIndex->height]; pIndex = pIndex->pprev)
+            vChain[pIndex->height] = pIndex;
+        for (size_t h = 0; h < vChain.size(); h++) {
+            if (!vChain[h] || vChain[h]->pprev != (h > 0 ? vChain[h - 1] : nullptr)) {
+                vChain.clear();  // not linked down to the genesis block, build all of them in order
+                break;
+            }
+        }
+    }
+
+    std::atomic<size_t> next(1);
+    boost::thread_group threads;
+    for (uint32_t t = 0; t < min<size_t>(GetLoadThreadCount(), vChain.size()); t++) {
+        threads.create_thread([&]() {
+            for (size_t h = next++; h < vChain.size(); h = next++)
+                vChain[h]->pskip = vChain[GetSkipHeight(h)];
+        });
+    }
+    threads.join_all();
+
+    for (CBlockIndex *pIndex : vSortedByHeight) {
+        if (pIndex->pprev && ((size_t)pIndex->height >= vChain.size() || vChain[pIndex->height] != pIndex))
             pIndex->BuildSkip();
     }
 
@@ -2352,6 +2936,24 @@ bool static LoadBlockIndexDB() {
     SysCfg().SetTxIndex(bTxIndex);
     LogPrint(BCLog::INFO, "LoadBlockIndexDB(): transaction index %s\n", bTxIndex ? "enabled" : "disabled");
 
+    // Check whether we have an address index
+    bool bAddressIndex = SysCfg().IsAddressIndex();
+    pCdMan->pBlockCache->ReadFlag("addressindex", bAddressIndex);
+    SysCfg().SetAddressIndex(bAddressIndex);
+    LogPrint(BCLog::INFO, "LoadBlockIndexDB(): address index %s\n", bAddressIndex ? "enabled" : "disabled");
+
+    // Check whether we have a block filter index
+    bool bBlockFilterIndex = SysCfg().IsBlockFilterIndex();
+    pCdMan->pBlockCache->ReadFlag("blockfilterindex", bBlockFilterIndex);
+    SysCfg().SetBlockFilterIndex(bBlockFilterIndex);
+    LogPrint(BCLog::INFO, "LoadBlockIndexDB(): block filter index %s\n", bBlockFilterIndex ? "enabled" : "disabled");
+
+    // Check whether we have a median price index
+    bool bMedianPriceIndex = SysCfg().IsMedianPriceIndex();
+    pCdMan->pBlockCache->ReadFlag("medianpriceindex", bMedianPriceIndex);
+    SysCfg().SetMedianPriceIndex(bMedianPriceIndex);
+    LogPrint(BCLog::INFO, "LoadBlockIndexDB(): median price index %s\n", bMedianPriceIndex ? "enabled" : "disabled");
+
     // Load pointer to end of best chain
     uint256 bestBlockHash = pCdMan->pBlockCache->GetBestBlockHash();
     const auto &it = mapBlockIndex.find(bestBlockHash);
@@ -2360,7 +2962,11 @@ bool static LoadBlockIndexDB() {
             __FUNCTION__, bestBlockHash.ToString());
     }
 
-    chainActive.SetTip(it->second);
+    {
+        std::unique_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+        chainActive.SetTip(it->second);
+    }
+    nTipBlockTime = it->second->GetBlockTime();
   //  chainActive.UpdateFinalityBlock();
     LogPrint(BCLog::INFO, "LoadBlockIndexDB(): hashBestChain=%s height=%d date=%s\n",
              chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(),
@@ -2369,6 +2975,20 @@ bool static LoadBlockIndexDB() {
     return true;
 }
 
+uint32_t GetCheckThreadCount() {
+    int64_t count = SysCfg().GetArg("-checkthreads", 0);
+    if (count <= 0)
+        count = (int64_t)boost::thread::hardware_concurrency() - 1;
+    return (uint32_t)max<int64_t>(1, min<int64_t>(count, MAX_CHECK_THREADS));
+}
+
+uint32_t GetLoadThreadCount() {
+    int64_t count = SysCfg().GetArg("-loadthreads", 0);
+    if (count <= 0)
+        count = (int64_t)boost::thread::hardware_concurrency() - 1;
+    return (uint32_t)max<int64_t>(1, min<int64_t>(count, MAX_LOAD_THREADS));
+}
+
 bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth) {
     LOCK(cs_main);
     if (chainActive.Tip() == nullptr || chainActive.Tip()->pprev == nullptr)
@@ -2382,7 +3002,20 @@ bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth) {
         nCheckDepth = chainActive.Height();
 
     nCheckLevel = max(0, min(4, nCheckLevel));
-    LogPrint(BCLog::INFO, "Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+    uint32_t nThreads = GetCheckThreadCount();
+    LogPrint(BCLog::INFO, "Verifying last %i blocks at level %i on %u threads\n", nCheckDepth, nCheckLevel, nThreads);
+
+    vector<CBlockIndex *> vIndexes;
+    for (CBlockIndex *pIndex = chainActive.Tip(); pIndex && pIndex->pprev; pIndex = pIndex->pprev) {
+        if (pIndex->height < chainActive.Height() - nCheckDepth)
+            break;
+
+        // the blocks pruned or below the state of -loadstate are not on disk
+        if (!(pIndex->nStatus & BLOCK_HAVE_DATA))
+            break;
+
+        vIndexes.push_back(pIndex);
+    }
 
     auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
 
@@ -2391,45 +3024,69 @@ bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth) {
     int32_t nGoodTransactions  = 0;
     CValidationState state;
 
-    for (CBlockIndex *pIndex = chainActive.Tip(); pIndex && pIndex->pprev; pIndex = pIndex->pprev) {
+    // The blocks are read, their merkle roots checked and their undos read on the threads, a batch at a
+    // time from the tip down, so memory stays bounded. The checks on the caches run in order on this thread.
+    const size_t nBatchSize = nThreads * 8;
+    for (size_t begin = 0; begin < vIndexes.size(); begin += nBatchSize) {
         boost::this_thread::interruption_point();
-        if (pIndex->height < chainActive.Height() - nCheckDepth)
-            break;
-
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(pIndex, block))
-            return ERRORMSG("VerifyDB() : *** ReadBlockFromDisk failed at %d, hash=%s",
-                            pIndex->height, pIndex->GetBlockHash().ToString());
-
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, *spCW, false))
-            return ERRORMSG("VerifyDB() : *** found bad block at %d, hash=%s\n",
-                            pIndex->height, pIndex->GetBlockHash().ToString());
-
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pIndex) {
-            CBlockUndo undo;
-            CDiskBlockPos pos = pIndex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!undo.ReadFromDisk(pos, pIndex->pprev->GetBlockHash()))
-                    return ERRORMSG("VerifyDB() : *** found bad undo data at %d, hash=%s\n",
-                                    pIndex->height, pIndex->GetBlockHash().ToString());
-            }
+        size_t end = min(vIndexes.size(), begin + nBatchSize);
+        vector<CBlock> blocks(end - begin);
+        vector<string> errors(end - begin);
+        std::atomic<size_t> next(begin);
+        boost::thread_group threads;
+        for (uint32_t t = 0; t < min<size_t>(nThreads, end - begin); t++) {
+            threads.create_thread([&]() {
+                for (size_t i = next++; i < end; i = next++) {
+                    CBlockIndex *pIndex = vIndexes[i];
+                    CBlock &block       = blocks[i - begin];
+                    // check level 0: read from disk
+                    if (!ReadBlockFromDisk(pIndex, block)) {
+                        errors[i - begin] = "ReadBlockFromDisk failed";
+                        continue;
+                    }
+                    // check level 1: the merkle root, the rest of CheckBlock() reads the caches
+                    if (nCheckLevel >= 1 && block.GetMerkleRootHash() != block.BuildMerkleTree()) {
+                        errors[i - begin] = "found bad merkle root";
+                        continue;
+                    }
+                    // check level 2: verify undo validity
+                    if (nCheckLevel >= 2) {
+                        CBlockUndo undo;
+                        CDiskBlockPos pos = pIndex->GetUndoPos();
+                        if (!pos.IsNull() && !undo.ReadFromDisk(pos, pIndex->pprev->GetBlockHash()))
+                            errors[i - begin] = "found bad undo data";
+                    }
+                }
+            });
         }
-        // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pIndex == pIndexState) {
-            bool fClean = true;
-            if (!DisconnectBlock(block, *spCW, pIndex, state, &fClean))
-                return ERRORMSG("VerifyDB() : *** irrecoverable inconsistency in block data at %d, hash=%s",
+        threads.join_all();
+
+        for (size_t i = begin; i < end; i++) {
+            CBlockIndex *pIndex = vIndexes[i];
+            CBlock &block       = blocks[i - begin];
+            if (!errors[i - begin].empty())
+                return ERRORMSG("VerifyDB() : *** %s at %d, hash=%s", errors[i - begin], pIndex->height,
+                                pIndex->GetBlockHash().ToString());
+
+            // check level 1: verify block validity
+            if (nCheckLevel >= 1 && !CheckBlock(block, state, *spCW, false))
+                return ERRORMSG("VerifyDB() : *** found bad block at %d, hash=%s\n",
                                 pIndex->height, pIndex->GetBlockHash().ToString());
 
-            pIndexState = pIndex->pprev;
-            if (!fClean) {
-                nGoodTransactions = 0;
-                pIndexFailure     = pIndex;
-            } else {
-                nGoodTransactions += block.vptx.size();
+            // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
+            if (nCheckLevel >= 3 && pIndex == pIndexState) {
+                bool fClean = true;
+                if (!DisconnectBlock(block, *spCW, pIndex, state, &fClean))
+                    return ERRORMSG("VerifyDB() : *** irrecoverable inconsistency in block data at %d, hash=%s",
+                                    pIndex->height, pIndex->GetBlockHash().ToString());
+
+                pIndexState = pIndex->pprev;
+                if (!fClean) {
+                    nGoodTransactions = 0;
+                    pIndexFailure     = pIndex;
+                } else {
+                    nGoodTransactions += block.vptx.size();
+                }
             }
         }
     }
@@ -2461,9 +3118,13 @@ bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth) {
 }
 
 void UnloadBlockIndex() {
-    mapBlockIndex.clear();
+    {
+        std::unique_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+        mapBlockIndex.clear();
+        chainActive.SetTip(nullptr);
+    }
     setBlockIndexValid.clear();
-    chainActive.SetTip(nullptr);
+    nTipBlockTime = 0;
     pIndexBestInvalid = nullptr;
 }
 
@@ -2484,6 +3145,15 @@ bool InitBlockIndex() {
     // Use the provided setting for -txindex in the new database
     SysCfg().SetTxIndex(SysCfg().GetBoolArg("-txindex", true));
     pCdMan->pBlockCache->WriteFlag("txindex", SysCfg().IsTxIndex());
+    // Use the provided setting for -addressindex in the new database
+    SysCfg().SetAddressIndex(SysCfg().GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX));
+    pCdMan->pBlockCache->WriteFlag("addressindex", SysCfg().IsAddressIndex());
+    // Use the provided setting for -blockfilterindex in the new database
+    SysCfg().SetBlockFilterIndex(SysCfg().GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX));
+    pCdMan->pBlockCache->WriteFlag("blockfilterindex", SysCfg().IsBlockFilterIndex());
+    // Use the provided setting for -medianpriceindex in the new database
+    SysCfg().SetMedianPriceIndex(SysCfg().GetBoolArg("-medianpriceindex", DEFAULT_MEDIANPRICEINDEX));
+    pCdMan->pBlockCache->WriteFlag("medianpriceindex", SysCfg().IsMedianPriceIndex());
     LogPrint(BCLog::INFO, "Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -2515,7 +3185,7 @@ void PrintBlockTree() {
     AssertLockHeld(cs_main);
     // pre-compute tree structure
     map<CBlockIndex *, vector<CBlockIndex *> > mapNext;
-    for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+    for (BlockMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
         CBlockIndex *pIndex = (*mi).second;
         mapNext[pIndex->pprev].push_back(pIndex);
     }
@@ -2573,63 +3243,8 @@ bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
     int64_t nStart = GetTimeMillis();
     int32_t nLoaded    = 0;
     try {
-        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE, MAX_BLOCK_SIZE + 8, SER_DISK, CLIENT_VERSION);
-        uint64_t nStartByte = 0;
-        if (dbp) {
-            // (try to) skip already indexed part
-            CBlockFileInfo info;
-            if (pCdMan->pBlockIndexDb->ReadBlockFileInfo(dbp->nFile, info)) {
-                nStartByte = info.nSize;
-                blkdat.Seek(info.nSize);
-            }
-        }
-        uint64_t nRewind = blkdat.GetPos();
-        while (blkdat.good() && !blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++;          // start one byte further next time, in case of failure
-            blkdat.SetLimit();  // remove former limit
-            uint32_t nSize = 0;
-            try {
-                // locate a header
-                uint8_t buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(SysCfg().MessageStart()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, SysCfg().MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
-                    continue;
-            } catch (std::exception &e) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                blkdat.SetLimit(nBlockPos + nSize);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // process block
-                if (nBlockPos >= nStartByte) {
-                    LOCK(cs_main);
-                    if (dbp)
-                        dbp->nPos = nBlockPos;
-                    CValidationState state;
-                    if (ProcessBlock(state, nullptr, &block, dbp))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                }
-            } catch (std::exception &e) {
-                LogPrint(BCLog::INFO, "%s : Deserialize or I/O error - %s\n", __func__, e.what());
-            }
-        }
+        CBlockImportPipeline pipeline(fileIn, dbp, CBlockImportPipeline::GetWorkerCount());
+        nLoaded = pipeline.Run();
         fclose(fileIn);
     } catch (runtime_error &e) {
         AbortNode(_("Error: system error: ") + e.what());
@@ -2695,18 +3310,11 @@ class CMainCleanup {
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        map<uint256, CBlockIndex *>::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexPool.Clear();
 
         // orphan blocks
-        map<uint256, COrphanBlock *>::iterator it2 = mapOrphanBlocks.begin();
-        for (; it2 != mapOrphanBlocks.end(); it2++)
-            delete (*it2).second;
-        mapOrphanBlocks.clear();
-        mapOrphanBlocksByPrev.clear();
-        setOrphanBlock.clear();
+        orphanBlocks.Clear();
     }
 } instance_of_cmaincleanup;
 
@@ -12,9 +12,11 @@
 
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
 #include <exception>
 #include <map>
 #include <set>
+#include <shared_mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -29,6 +31,7 @@
 #include "chain/merkletree.h"
 #include "net.h"
 #include "p2p/node.h"
+#include "persistence/blockundo.h"
 #include "persistence/cachewrapper.h"
 #include "sigcache.h"
 #include "tx/tx.h"
@@ -36,16 +39,31 @@
 //#include "tx/txserializer.h"
 
 class CBloomFilter;
+struct CConfirmedTx;
+class CStateSnapshot;
 class CChain;
 class CInv;
 
 extern CCriticalSection cs_main;
 /** The currently-connected chain of blocks. */
 extern CChain chainActive;
+/** Block time of chainActive.Tip(), read without cs_main by the cheap p2p messages */
+extern std::atomic<int64_t> nTipBlockTime;
 extern CSignatureCache signatureCache;
+extern bool fPruneMode;
+extern uint64_t nPruneTarget;
+extern int32_t nSigCheckThreads;
 
 extern CTxMemPool mempool;
-extern map<uint256, CBlockIndex *> mapBlockIndex;
+extern BlockMap mapBlockIndex;
+/**
+ * Guards chainActive and mapBlockIndex for the readers not holding cs_main, e.g. getblock, the
+ * confirmations of the wallet txs and the getheaders of the peers, which take it shared.
+ * The writers hold cs_main and take it unique around SetTip and the inserts and erases of the index
+ * only, so the readers under cs_main need not take it. It is not recursive and is taken after cs_main.
+ */
+extern std::shared_mutex cs_chainIndex;
+extern CBlockIndexPool blockIndexPool;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
 extern const string strMessageMagic;
@@ -95,14 +113,22 @@ bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
 
 /** Verify consistency of the block and coin databases */
 bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth);
+/** Number of the threads of VerifyDB and of the state verifier configured by -checkthreads */
+uint32_t GetCheckThreadCount();
+/** The number of threads loading the block index */
+uint32_t GetLoadThreadCount();
 
-/** Run an instance of the script checking thread */
-void ThreadScriptCheck();
+/** Run an instance of the signature checking thread */
+void ThreadSigCheck();
+/** Verify the signatures of the txs on the sigcheck threads with the pubkeys found in cw, for signatureCache */
+void PrepareTxSignatures(const vector<CBaseTx *> &txs, CCacheWrapper &cw);
 
 /** Format a string that describes several potential problems detected by the core */
 string GetWarnings(string strFor);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &hash, CBlockDBCache &blockCache, bool bSearchMempool = true);
+/** Retrieve a confirmed transaction with its block through the tx index, cached by txLookupCache */
+bool GetConfirmedTx(const uint256 &hash, CBlockDBCache &blockCache, CConfirmedTx &confirmedTx);
 /** Retrieve a transaction height comfirmed in block*/
 int32_t GetTxConfirmHeight(const uint256 &hash, CBlockDBCache &blockCache);
 
@@ -113,11 +139,55 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int32_t howmuch);
 
-bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey);
+/** Verify the signature through signatureCache, fEraseCache removes the cache entry on hit */
+bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey,
+                     bool fEraseCache = false);
+
+/**
+ * Closure representing the preparation of one tx of a block on the sigcheck threads: its hash and
+ * its serialized size are cached, then its signature is verified if the pubkey is known, and so are
+ * the signatures of the signers of a multisig tx, as one unit since they sign the same hash.
+ * A successful check is remembered by signatureCache, so the following CheckTx calls of the
+ * same tx don't verify it again.
+ */
+class CSignatureCheck {
+private:
+    const CBaseTx *pBaseTx = nullptr;
+    CPubKey pubKey;  // not valid if only the hash and size are cached
+    // the signatures of a multisig tx with the owner pubkeys of their signers, empty otherwise
+    std::vector<std::pair<const std::vector<uint8_t> *, CPubKey>> signers;
+
+public:
+    CSignatureCheck() {}
+    CSignatureCheck(const CBaseTx *pBaseTxIn, const CPubKey &pubKeyIn) : pBaseTx(pBaseTxIn), pubKey(pubKeyIn) {}
+
+    void AddSigner(const std::vector<uint8_t> &signature, const CPubKey &signerPubKey) {
+        signers.emplace_back(&signature, signerPubKey);
+    }
+
+    bool operator()() const {
+        const uint256 sigHash = pBaseTx->GetHash();
+        pBaseTx->CacheTxSize();
+        if (pubKey.IsValid() && !VerifySignature(sigHash, pBaseTx->signature, pubKey))
+            return false;
 
-/** (try to) add transaction to memory pool **/
+        for (const auto &signer : signers) {
+            if (!VerifySignature(sigHash, *signer.first, signer.second))
+                return false;
+        }
+        return true;
+    }
+
+    void swap(CSignatureCheck &check) {
+        std::swap(pBaseTx, check.pBaseTx);
+        std::swap(pubKey, check.pubKey);
+        signers.swap(check.signers);
+    }
+};
+
+/** (try to) add transaction to memory pool, acceptTime is the time it entered the pool first, 0 for now **/
 bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee = false);
+                        bool fLimitFree, bool fRejectInsaneFee = false, int64_t acceptTime = 0);
 
 struct CNodeStateStats {
     int32_t nMisbehavior;
@@ -216,15 +286,39 @@ protected:
  *  will be true if no problems were found. Otherwise, the return value will be false in case
  *  of problems. Note that in any case, coins may be modified. */
 bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool *pfClean = nullptr);
-// Apply the effects of this block (with given index) on the UTXO set represented by coins
-bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false);
+/** Disconnect the blocks from pIndexTip down to pIndexFork excluded, their undo logs applied at once */
+bool DisconnectBlocks(CCacheWrapper &cw, CBlockIndex *pIndexTip, CBlockIndex *pIndexFork, CValidationState &state);
+// Apply the effects of this block (with given index) on the UTXO set represented by coins, pBlockUndoOut takes
+// the undo logs of the block
+bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false,
+                     CBlockUndo *pBlockUndoOut = nullptr);
+
+/**
+ * The txs of a block produced by this node as the miner executed them, on a cache layer over the state snapshot
+ * of its parent block. ConnectBlock flushes the layer and takes the undo logs instead of executing the txs again
+ * when it connects this very block on that parent.
+ */
+struct CMinedBlockExecution {
+    uint256 blockHash;
+    uint256 prevBlockHash;
+    std::shared_ptr<CStateSnapshot> spSnapshot;  // the base of spCw until ConnectBlock moves it
+    std::shared_ptr<CCacheWrapper> spCw;
+    CBlockUndo txUndo;                           // of the txs after the block reward tx, in block order
+};
+
+// requires cs_main, hand over the execution of the block about to be processed, null to drop it
+void SetMinedBlockExecution(const std::shared_ptr<CMinedBlockExecution> &spExecution);
+
+/** Log the serial execution times of the txs by type that ConnectBlock recorded with -benchmark, as
+ *  the profile of a -reindex or -loadblock replay of the chain */
+void LogTxExecTimes();
 
 // Add this block to the block index, and if necessary, switch the active block chain to this
 bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos &pos);
 
 // Context-independent validity checks
 bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
-                bool fCheckTx = true, bool fCheckMerkleRoot = true);
+                bool fCheckTx = true, bool fCheckMerkleRoot = true, bool fCheckSig = true);
 
 bool ProcessForkedChain(const CBlock &block, CValidationState &state);
 
@@ -0,0 +1,178 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics.h"
+
+#include "commons/tinyformat.h"
+
+#include <chrono>
+
+using namespace std;
+
+CMetricHistogram metricConnectBlock("coind_connect_block_seconds", "Time of ConnectBlock");
+CMetricHistogram metricBlockPrefetch("coind_block_prefetch_seconds", "Time of the prefetch of the state read by a block");
+CMetricCounterFamily metricPrefetchKeys("coind_block_prefetch_keys_total", "Keys read ahead of the blocks by whether the db has them", "result");
+CMetricHistogram metricCheckBlock("coind_check_block_seconds", "Time of CheckBlock");
+CMetricHistogramFamily metricExecuteTx("coind_execute_tx_seconds", "Time of ExecuteTx by tx type", "tx_type");
+CMetricHistogram metricAcceptToMemoryPool("coind_accept_to_mempool_seconds", "Time of AcceptToMemoryPool");
+CMetricGauge metricMempoolTxs("coind_mempool_txs", "Number of the txs in the mempool");
+CMetricGauge metricMempoolBytes("coind_mempool_bytes", "Estimated heap bytes of the mempool, limited by -maxmempool");
+CMetricGaugeFamily metricDbCacheBytes("coind_db_cache_bytes", "Size of the dirty db caches at the last block", "db");
+CMetricGaugeFamily metricDbReadCacheBytes("coind_db_read_cache_bytes", "Size of the clean values kept by the db caches after the last flush", "db");
+CMetricCounterFamily metricDbReadBytes("coind_leveldb_read_bytes_total", "Bytes of the values read from LevelDB", "db");
+CMetricCounterFamily metricDbWriteBytes("coind_leveldb_write_bytes_total", "Bytes of the batches written to LevelDB", "db");
+CMetricCounterFamily metricP2PRecvBytes("coind_p2p_recv_bytes_total", "Bytes of the P2P messages received by command", "command");
+CMetricCounterFamily metricP2PSendBytes("coind_p2p_send_bytes_total", "Bytes of the P2P messages sent by command", "command");
+CMetricCounterFamily metricThreadPoolCpu("coind_thread_pool_cpu_microseconds_total", "CPU time of the threads by pool, see -cpuaffinity", "pool");
+CMetricGaugeFamily metricThreadPoolThreads("coind_thread_pool_threads", "Number of the running threads by pool", "pool");
+CMetricHistogramFamily metricRPCRequest("coind_rpc_request_seconds", "Time of the RPC requests by method", "method");
+
+static int64_t GetSteadyMicros() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the seconds of the micros without the trailing zeros
+static string FormatSeconds(uint64_t micros) {
+    string str = strprintf("%d.%06d", micros / 1000000, micros % 1000000);
+    str.erase(str.find_last_not_of('0') + 1);
+    if (str.back() == '.')
+        str.pop_back();
+    return str;
+}
+
+static string JoinLabels(const string &labels, const string &label) {
+    return labels.empty() ? label : labels + "," + label;
+}
+
+static void RenderSample(string &out, const char *metricName, const char *suffix, const string &labels,
+                         const string &value) {
+    out += metricName;
+    out += suffix;
+    if (!labels.empty())
+        out += "{" + labels + "}";
+    out += " " + value + "\n";
+}
+
+string EscapeMetricLabel(const string &value) {
+    string ret;
+    ret.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"')
+            ret += '\\';
+        if (c == '\n')
+            ret += "\\n";
+        else
+            ret += c;
+    }
+    return ret;
+}
+
+CMetric::CMetric(const char *nameIn, const char *helpIn, const char *typeIn)
+    : name(nameIn), help(helpIn), type(typeIn) {
+    GetMetricsRegistry().Register(this);
+}
+
+void CMetricCounter::Render(string &out, const char *metricName, const string &labels) const {
+    RenderSample(out, metricName, "", labels, strprintf("%d", Get()));
+}
+
+void CMetricGauge::Render(string &out, const char *metricName, const string &labels) const {
+    RenderSample(out, metricName, "", labels, strprintf("%d", Get()));
+}
+
+uint32_t CMetricHistogram::GetBucketIndex(uint64_t micros) {
+    if (micros < 2)
+        return (uint32_t)micros;
+
+    uint32_t order    = 63 - __builtin_clzll(micros);
+    uint32_t subIndex = (micros >> (order - 1)) & 1;
+    return order * 2 + subIndex;
+}
+
+uint64_t CMetricHistogram::GetBucketBound(uint32_t index) {
+    if (index < 2)
+        return index;
+
+    uint32_t order    = index / 2;
+    uint32_t subIndex = index % 2;
+    return (1ULL << order) + (subIndex + 1) * (1ULL << (order - 1)) - 1;
+}
+
+void CMetricHistogram::Observe(uint64_t micros) {
+    uint32_t index = GetBucketIndex(micros);
+    if (index < BUCKET_COUNT) {
+        buckets[index].fetch_add(1, memory_order_relaxed);
+        uint32_t maxIdx = maxIndex.load(memory_order_relaxed);
+        while (index > maxIdx && !maxIndex.compare_exchange_weak(maxIdx, index, memory_order_relaxed)) {
+        }
+    }
+    // the overflow is counted in +Inf only
+    count.fetch_add(1, memory_order_relaxed);
+    sumMicros.fetch_add(micros, memory_order_relaxed);
+}
+
+uint64_t CMetricHistogram::GetQuantile(double quantile) const {
+    uint64_t total = GetCount();
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = max<uint64_t>(1, (uint64_t)(quantile * total + 0.5));
+    uint64_t cumulative = 0;
+    uint32_t maxIdx = maxIndex.load(memory_order_relaxed);
+    for (uint32_t i = 0; i <= maxIdx; ++i) {
+        cumulative += buckets[i].load(memory_order_relaxed);
+        if (cumulative >= rank)
+            return GetBucketBound(i);
+    }
+    // in the overflow
+    return GetBucketBound(BUCKET_COUNT - 1);
+}
+
+void CMetricHistogram::Render(string &out, const char *metricName, const string &labels) const {
+    // the buckets are read without a snapshot, a concurrent observation may be missed in count only
+    uint64_t total = GetCount();
+    uint64_t cumulative = 0;
+    uint32_t maxIdx = maxIndex.load(memory_order_relaxed);
+    for (uint32_t i = 0; i <= maxIdx; ++i) {
+        cumulative += buckets[i].load(memory_order_relaxed);
+        RenderSample(out, metricName, "_bucket", JoinLabels(labels, "le=\"" + FormatSeconds(GetBucketBound(i)) + "\""),
+                     strprintf("%d", cumulative));
+    }
+    RenderSample(out, metricName, "_bucket", JoinLabels(labels, "le=\"+Inf\""), strprintf("%d", max(cumulative, total)));
+    RenderSample(out, metricName, "_sum", labels, FormatSeconds(GetSumMicros()));
+    RenderSample(out, metricName, "_count", labels, strprintf("%d", max(cumulative, total)));
+}
+
+CMetricTimer::CMetricTimer(CMetricHistogram &histogramIn) : histogram(histogramIn), start(GetSteadyMicros()) {}
+
+CMetricTimer::~CMetricTimer() { histogram.Observe(max<int64_t>(0, GetSteadyMicros() - start)); }
+
+void CMetricsRegistry::Register(CMetric *pMetric) {
+    lock_guard<mutex> lock(mtx);
+    metrics.push_back(pMetric);
+}
+
+void CMetricsRegistry::AddCollector(const Collector &collector) {
+    lock_guard<mutex> lock(mtx);
+    collectors.push_back(collector);
+}
+
+string CMetricsRegistry::Render() {
+    lock_guard<mutex> lock(mtx);
+    for (const auto &collector : collectors)
+        collector();
+
+    string out;
+    for (const CMetric *pMetric : metrics) {
+        out += strprintf("# HELP %s %s\n", pMetric->name, pMetric->help);
+        out += strprintf("# TYPE %s %s\n", pMetric->name, pMetric->type);
+        pMetric->Render(out, pMetric->name, "");
+    }
+    return out;
+}
+
+CMetricsRegistry &GetMetricsRegistry() {
+    static CMetricsRegistry registry;
+    return registry;
+}
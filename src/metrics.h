@@ -0,0 +1,218 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_METRICS_H
+#define COIN_METRICS_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+static const bool DEFAULT_METRICS_ENABLE = false;
+
+/**
+ * Registry of the node metrics, rendered in the Prometheus text format by GET /metrics.
+ *
+ * The metrics are globals registering themselves on construction, the hot paths update them with
+ * relaxed atomics only. A family adds one label, its children are created on the first use of a
+ * label value and never removed, so the label values must come from a small fixed set, e.g. the tx
+ * types, the RPC methods or the P2P commands. The values computed at scrape time come from collectors.
+ */
+class CMetric {
+public:
+    CMetric(const char *nameIn, const char *helpIn, const char *typeIn);
+    virtual ~CMetric() {}
+
+    // append the samples of the metric, labels is empty or `label="value"`
+    virtual void Render(std::string &out, const char *metricName, const std::string &labels) const = 0;
+    // the empty children of a family are not rendered, e.g. the histograms of the LOCK sites never profiled
+    virtual bool IsEmpty() const { return false; }
+
+    const char *name;
+    const char *help;
+    const char *type;
+
+protected:
+    CMetric() : name(""), help(""), type("") {}  // a child of a family, not registered
+};
+
+class CMetricCounter : public CMetric {
+public:
+    CMetricCounter(const char *nameIn, const char *helpIn) : CMetric(nameIn, helpIn, "counter") {}
+
+    void Inc(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+    void Render(std::string &out, const char *metricName, const std::string &labels) const override;
+
+private:
+    template <typename T> friend class CMetricFamily;
+    CMetricCounter() {}
+
+    std::atomic<uint64_t> value{0};
+};
+
+class CMetricGauge : public CMetric {
+public:
+    CMetricGauge(const char *nameIn, const char *helpIn) : CMetric(nameIn, helpIn, "gauge") {}
+
+    void Set(int64_t v) { value.store(v, std::memory_order_relaxed); }
+    void Add(int64_t n) { value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Get() const { return value.load(std::memory_order_relaxed); }
+    void Render(std::string &out, const char *metricName, const std::string &labels) const override;
+
+private:
+    template <typename T> friend class CMetricFamily;
+    CMetricGauge() {}
+
+    std::atomic<int64_t> value{0};
+};
+
+/**
+ * Histogram of durations in microseconds, rendered in seconds.
+ * The buckets are log-linear as in HdrHistogram, two per power of two, i.e. a relative error under
+ * 50%, from 1us to 2^32us (71 minutes). Only the buckets up to the largest one hit are rendered.
+ */
+class CMetricHistogram : public CMetric {
+public:
+    static const uint32_t BUCKET_COUNT = 64;
+
+    CMetricHistogram(const char *nameIn, const char *helpIn) : CMetric(nameIn, helpIn, "histogram") {}
+
+    void Observe(uint64_t micros);
+    void Render(std::string &out, const char *metricName, const std::string &labels) const override;
+
+    uint64_t GetCount() const { return count.load(std::memory_order_relaxed); }
+    uint64_t GetSumMicros() const { return sumMicros.load(std::memory_order_relaxed); }
+    bool IsEmpty() const override { return GetCount() == 0; }
+    // the upper bound of the bucket of the quantile, e.g. 0.99, or 0 if empty
+    uint64_t GetQuantile(double quantile) const;
+
+    static uint32_t GetBucketIndex(uint64_t micros);
+    // the largest value of the bucket
+    static uint64_t GetBucketBound(uint32_t index);
+
+private:
+    template <typename T> friend class CMetricFamily;
+    CMetricHistogram() {}
+
+    std::atomic<uint64_t> buckets[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumMicros{0};
+    std::atomic<uint32_t> maxIndex{0};
+};
+
+std::string EscapeMetricLabel(const std::string &value);
+
+/** Metrics of the same name split by the values of one label */
+template <typename T>
+class CMetricFamily : public CMetric {
+public:
+    CMetricFamily(const char *nameIn, const char *helpIn, const char *labelIn, const char *typeIn)
+        : CMetric(nameIn, helpIn, typeIn), label(labelIn) {}
+
+    T &Get(const std::string &labelValue) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mtx);
+            auto it = children.find(labelValue);
+            if (it != children.end())
+                return *it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        auto &child = children[labelValue];
+        if (!child)
+            child.reset(new T());
+        return *child;
+    }
+
+    void Render(std::string &out, const char *metricName, const std::string &labels) const override {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        for (const auto &item : children) {
+            if (!item.second->IsEmpty())
+                item.second->Render(out, metricName, std::string(label) + "=\"" + EscapeMetricLabel(item.first) + "\"");
+        }
+    }
+
+private:
+
+    const char *label;
+    mutable std::shared_mutex mtx;
+    std::map<std::string, std::unique_ptr<T>> children;
+};
+
+class CMetricCounterFamily : public CMetricFamily<CMetricCounter> {
+public:
+    CMetricCounterFamily(const char *nameIn, const char *helpIn, const char *labelIn)
+        : CMetricFamily(nameIn, helpIn, labelIn, "counter") {}
+};
+
+class CMetricGaugeFamily : public CMetricFamily<CMetricGauge> {
+public:
+    CMetricGaugeFamily(const char *nameIn, const char *helpIn, const char *labelIn)
+        : CMetricFamily(nameIn, helpIn, labelIn, "gauge") {}
+};
+
+class CMetricHistogramFamily : public CMetricFamily<CMetricHistogram> {
+public:
+    CMetricHistogramFamily(const char *nameIn, const char *helpIn, const char *labelIn)
+        : CMetricFamily(nameIn, helpIn, labelIn, "histogram") {}
+};
+
+/** Observe the lifetime of the scope in a histogram */
+class CMetricTimer {
+public:
+    explicit CMetricTimer(CMetricHistogram &histogramIn);
+    ~CMetricTimer();
+
+private:
+    CMetricHistogram &histogram;
+    int64_t start;
+};
+
+class CMetricsRegistry {
+public:
+    typedef std::function<void()> Collector;
+
+    void Register(CMetric *pMetric);
+    // called before each rendering, e.g. to set the gauges read under a lock
+    void AddCollector(const Collector &collector);
+
+    // the text exposition format of Prometheus, version 0.0.4
+    std::string Render();
+
+private:
+    std::mutex mtx;
+    std::vector<CMetric *> metrics;
+    std::vector<Collector> collectors;
+};
+
+// constructed on first use, the metrics register from the static initializers of any translation unit
+CMetricsRegistry &GetMetricsRegistry();
+
+/** The metrics shared by several modules */
+extern CMetricHistogram metricConnectBlock;
+extern CMetricHistogram metricBlockPrefetch;
+extern CMetricCounterFamily metricPrefetchKeys;
+extern CMetricHistogram metricCheckBlock;
+extern CMetricHistogramFamily metricExecuteTx;
+extern CMetricHistogram metricAcceptToMemoryPool;
+extern CMetricGauge metricMempoolTxs;
+extern CMetricGauge metricMempoolBytes;
+extern CMetricGaugeFamily metricDbCacheBytes;
+extern CMetricGaugeFamily metricDbReadCacheBytes;
+extern CMetricCounterFamily metricDbReadBytes;
+extern CMetricCounterFamily metricDbWriteBytes;
+extern CMetricCounterFamily metricP2PRecvBytes;
+extern CMetricCounterFamily metricP2PSendBytes;
+extern CMetricCounterFamily metricThreadPoolCpu;
+extern CMetricGaugeFamily metricThreadPoolThreads;
+extern CMetricHistogramFamily metricRPCRequest;
+
+#endif  // COIN_METRICS_H
@@ -16,9 +16,15 @@
 #include "persistence/txdb.h"
 #include "persistence/contractdb.h"
 #include "persistence/cachewrapper.h"
+#include "persistence/statesnapshot.h"
+#include "chain/parallelexecutor.h"
+#include "chain/txlatency.h"
 #include "p2p/protocol.h"
 
 #include <algorithm>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
 #include <boost/circular_buffer.hpp>
 
 extern CWallet *pWalletMain;
@@ -34,6 +40,74 @@ boost::circular_buffer<MinedBlockInfo> minedBlocks(MAX_MINED_BLOCK_COUNT);
 CCriticalSection csMinedBlocks;
 
 
+// the part of the slot kept after the block is processed for its propagation, by the adaptive cutoff
+static const int64_t MINING_SLOT_MARGIN_MS = 500;
+// the weights of the latest sample in the EWMAs of the txs and of the blocks
+static const double MINING_TX_SAMPLE_WEIGHT    = 0.01;
+static const double MINING_BLOCK_SAMPLE_WEIGHT = 0.1;
+
+/**
+ * Predicts the time left to produce a block from the recent blocks produced, for the cutoff of the
+ * packing. The packing of a tx is an EWMA over the recent txs. The finishing of a block, i.e. the
+ * reward tx and CheckWork which connects the block again, grows with its tx count, it is a line
+ * fitted by exponentially weighted least squares over the recent blocks.
+ */
+class CMiningTimePredictor {
+public:
+    void AddTxSample(int64_t micros) {
+        std::lock_guard<std::mutex> lock(mtx);
+        txMicros = txSamples++ == 0 ? micros : txMicros + MINING_TX_SAMPLE_WEIGHT * (micros - txMicros);
+    }
+
+    void AddBlockSample(uint32_t txCount, int64_t finishMicros) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (blockSamples++ == 0) {
+            meanX = txCount;
+            meanY = finishMicros;
+            return;
+        }
+        const double a = MINING_BLOCK_SAMPLE_WEIGHT;
+        double dx = txCount - meanX, dy = finishMicros - meanY;
+        meanX += a * dx;
+        meanY += a * dy;
+        varX  = (1 - a) * (varX + a * dx * dx);
+        covXY = (1 - a) * (covXY + a * dx * dy);
+    }
+
+    bool HasHistory() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return blockSamples > 0;
+    }
+
+    int64_t PredictTx() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return (int64_t)txMicros;
+    }
+
+    int64_t PredictFinish(uint32_t txCount) const {
+        std::lock_guard<std::mutex> lock(mtx);
+        // the blocks of about the same size tell nothing of the slope, scale their mean instead
+        if (varX < 1)
+            return (int64_t)(meanY * (txCount + 1) / (meanX + 1));
+
+        double slope     = std::max(0.0, covXY / varX);
+        double intercept = std::max(0.0, meanY - slope * meanX);
+        return (int64_t)(intercept + slope * txCount);
+    }
+
+private:
+    mutable std::mutex mtx;
+    double txMicros       = 0;
+    uint64_t txSamples    = 0;
+    double meanX          = 0;
+    double meanY          = 0;
+    double varX           = 0;
+    double covXY          = 0;
+    uint64_t blockSamples = 0;
+};
+
+static CMiningTimePredictor miningTimePredictor;
+
 // check the time is not exceed the limit time (2s) for packing new block
 static bool CheckPackBlockTime(int64_t startMiningMs, int32_t blockHeight) {
     int64_t nowMs  = GetTimeMillis();
@@ -46,6 +120,25 @@ static bool CheckPackBlockTime(int64_t startMiningMs, int32_t blockHeight) {
     return true;
 }
 
+// check there is time left to pack one more tx into a block of txCount txs. The adaptive cutoff stops
+// when the predicted time of the tx and of the finishing of the block would pass the slot margin
+static bool CheckPackTxTime(int64_t startMiningMs, int32_t blockHeight, uint32_t txCount) {
+    static const bool fAdaptive = SysCfg().GetBoolArg("-adaptivepack", DEFAULT_ADAPTIVE_PACK);
+    if (!fAdaptive || !miningTimePredictor.HasHistory())
+        return CheckPackBlockTime(startMiningMs, blockHeight);
+
+    int64_t nowMs         = GetTimeMillis();
+    int64_t needMs        = (miningTimePredictor.PredictTx() + miningTimePredictor.PredictFinish(txCount + 1)) / 1000;
+    int64_t limitedTimeMs = (int64_t)GetBlockInterval(blockHeight) * 1000L - MINING_SLOT_MARGIN_MS - needMs;
+    if (nowMs - startMiningMs > limitedTimeMs) {
+        LogPrint(BCLog::MINER, "%s() : pack block time use up! height=%d, start_ms=%lld, now_ms=%lld, "
+            "predicted_need_ms=%lld, limited_time_ms=%lld\n", __FUNCTION__, blockHeight, startMiningMs, nowMs,
+            needMs, limitedTimeMs);
+        return false;
+    }
+    return true;
+}
+
 // base on the lastest 50 blocks
 uint32_t GetElementForBurn(CBlockIndex *pIndex) {
     if (!pIndex) {
@@ -82,27 +175,71 @@ uint32_t GetElementForBurn(CBlockIndex *pIndex) {
     return newFuelRate;
 }
 
-// Sort transactions by priority and fee to decide priority orders to process transactions.
-void GetPriorityTx(int32_t height, set<TxPriority> &txPriorities, const int32_t nFuelRate) {
-    static TokenSymbol feeSymbol;
-    static uint64_t fee    = 0;
-    static uint32_t txSize = 0;
-    static double feePerKb = 0;
-    static double priority = 0;
-
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.memPoolTxs.begin(); mi != mempool.memPoolTxs.end(); ++mi) {
-        CBaseTx *pBaseTx = mi->second.GetTransaction().get();
-        if (!pBaseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HaveTx(pBaseTx->GetHash())) {
-            feeSymbol = std::get<0>(mi->second.GetFees());
-            fee       = std::get<1>(mi->second.GetFees());
-            txSize    = mi->second.GetTxSize();
-            feePerKb  = double(fee - pBaseTx->GetFuel(height, nFuelRate)) / txSize * 1000.0;
-            priority  = mi->second.GetPriority();
-
-            txPriorities.emplace(TxPriority(priority, feePerKb, mi->second.GetTransaction()));
+// Walk the mempool priority index from the highest priority down, skipping the txs already confirmed in txCache.
+// The optional pExtraTx (the block price median tx) is returned at its place in that order. With pParents, the
+// ancestors of a tx from the same sender which were not returned yet are returned before it, the oldest first.
+class CPriorityTxIterator {
+public:
+    CPriorityTxIterator(const set<TxPriority> &txPrioritiesIn, CTxMemCache &txCacheIn,
+                        const TxPriority *pExtraTxIn = nullptr, const TxParentMap *pParentsIn = nullptr)
+        : txPriorities(txPrioritiesIn),
+          txCache(txCacheIn),
+          itor(txPrioritiesIn.rbegin()),
+          pExtraTx(pExtraTxIn),
+          pParents(pParentsIn) {
+        if (pParents != nullptr && !pParents->empty()) {
+            for (const auto &item : txPriorities)
+                priorityByTxid.emplace(item.txid, &item);
         }
     }
-}
+
+    const TxPriority *Next() {
+        while (itor != txPriorities.rend() && (txCache.HaveTx(itor->txid) || returnedTxids.count(itor->txid)))
+            ++itor;
+
+        if (pExtraTx != nullptr && (itor == txPriorities.rend() || *itor < *pExtraTx)) {
+            const TxPriority *pTx = pExtraTx;
+            pExtraTx              = nullptr;
+            return pTx;
+        }
+        if (itor == txPriorities.rend())
+            return nullptr;
+
+        // the tx itself is returned by a following call, once its ancestors are
+        const TxPriority *pTx = GetFirstPendingAncestor(&*itor);
+        if (pTx == &*itor)
+            ++itor;
+        if (!priorityByTxid.empty())
+            returnedTxids.insert(pTx->txid);
+        return pTx;
+    }
+
+private:
+    const TxPriority *GetFirstPendingAncestor(const TxPriority *pTx) const {
+        if (priorityByTxid.empty())
+            return pTx;
+
+        while (true) {
+            auto itParent = pParents->find(pTx->txid);
+            if (itParent == pParents->end() || returnedTxids.count(itParent->second) ||
+                txCache.HaveTx(itParent->second))
+                return pTx;
+
+            auto itPriority = priorityByTxid.find(itParent->second);
+            if (itPriority == priorityByTxid.end())
+                return pTx;
+            pTx = itPriority->second;
+        }
+    }
+
+    const set<TxPriority> &txPriorities;
+    CTxMemCache &txCache;
+    set<TxPriority>::const_reverse_iterator itor;
+    const TxPriority *pExtraTx;
+    const TxParentMap *pParents;
+    unordered_map<uint256, const TxPriority *, CSaltedUint256Hasher> priorityByTxid;
+    unordered_set<uint256, CSaltedUint256Hasher> returnedTxids;  // incl. the ancestors returned before their turn
+};
 
 
 bool GetCurrentDelegate(const int64_t currentTime, const int32_t currHeight, const VoteDelegateVector &delegates,
@@ -133,7 +270,7 @@ static bool CreateBlockRewardTx(Miner &miner, CBlock *pBlock) {
     }
 
     pBlock->SetNonce(GetRand(SysCfg().GetBlockMaxNonce()));
-    pBlock->SetMerkleRootHash(pBlock->BuildMerkleTree());
+    pBlock->SetMerkleRootHash(pBlock->ComputeMerkleRoot());
 
     vector<uint8_t> signature;
     if (miner.key.Sign(pBlock->GetHash(), signature)) {
@@ -153,12 +290,10 @@ inline int64_t GetShuffleOriginSeed(const int32_t curHeight, const int64_t block
     }
 }
 
-void ShuffleDelegates(const int32_t curHeight, const int64_t blockTime, VoteDelegateVector &delegates) {
+static void ShuffleDelegatesOfRound(const uint64_t round, VoteDelegateVector &delegates) {
 
     uint32_t totalDelegateNum = IniCfg().GetTotalDelegateNum();
-    int64_t oriSeed =GetShuffleOriginSeed( curHeight,blockTime );
-
-    string seedSource = strprintf("%u", oriSeed / totalDelegateNum + (oriSeed % totalDelegateNum > 0 ? 1 : 0));
+    string seedSource = strprintf("%u", round);
     CHashWriter ss(SER_GETHASH, 0);
     ss << seedSource;
     uint256 currentSeed  = ss.GetHash();
@@ -176,16 +311,87 @@ void ShuffleDelegates(const int32_t curHeight, const int64_t blockTime, VoteDele
     }
 }
 
-bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx, VoteDelegate &curDelegateOut) {
-    uint32_t maxNonce = SysCfg().GetBlockMaxNonce();
+// the shuffled delegates of the latest rounds, the most recent first. An entry is keyed by the round and the
+// active delegates it was shuffled from, so a change of the active delegates misses it
+struct CDelegateSchedule {
+    uint64_t round = 0;
+    VoteDelegateVector activeDelegates;
+    VoteDelegateVector shuffledDelegates;
+};
+static const uint32_t MAX_DELEGATE_SCHEDULE_COUNT = 4;
+static CCriticalSection cs_delegateSchedule;
+static vector<CDelegateSchedule> delegateSchedules;
 
-    VoteDelegateVector delegates;
+void ShuffleDelegates(const int32_t curHeight, const int64_t blockTime, VoteDelegateVector &delegates) {
+
+    uint32_t totalDelegateNum = IniCfg().GetTotalDelegateNum();
+    int64_t oriSeed =GetShuffleOriginSeed( curHeight,blockTime );
+    uint64_t round = oriSeed / totalDelegateNum + (oriSeed % totalDelegateNum > 0 ? 1 : 0);
+
+    LOCK(cs_delegateSchedule);
+    for (auto it = delegateSchedules.begin(); it != delegateSchedules.end(); it++) {
+        if (it->round == round && it->activeDelegates == delegates) {
+            delegates = it->shuffledDelegates;
+            if (it != delegateSchedules.begin())
+                std::rotate(delegateSchedules.begin(), it, it + 1);
+            return;
+        }
+    }
+
+    CDelegateSchedule schedule;
+    schedule.round           = round;
+    schedule.activeDelegates = delegates;
+    ShuffleDelegatesOfRound(round, delegates);
+    schedule.shuffledDelegates = delegates;
+
+    if (delegateSchedules.size() >= MAX_DELEGATE_SCHEDULE_COUNT)
+        delegateSchedules.pop_back();
+    delegateSchedules.insert(delegateSchedules.begin(), std::move(schedule));
+}
+
+bool GetBlockDelegate(const CBlock *pBlock, CCacheWrapper &cwIn, VoteDelegateVector &delegates,
+                      VoteDelegate &curDelegateOut) {
     if (!cwIn.delegateCache.GetActiveDelegates(delegates))
         return false;
 
     ShuffleDelegates(pBlock->GetHeight(),pBlock->GetTime(), delegates);
 
-    if (!GetCurrentDelegate(pBlock->GetTime(), pBlock->GetHeight(), delegates, curDelegateOut))
+    return GetCurrentDelegate(pBlock->GetTime(), pBlock->GetHeight(), delegates, curDelegateOut);
+}
+
+// the block is signed by the owner or the miner key of the account
+static bool VerifyBlockSignature(const CBlock *pBlock, const CAccount &account) {
+    const auto &blockHash      = pBlock->GetHash();
+    const auto &blockSignature = pBlock->GetSignature();
+
+    if (blockSignature.size() == 0 || blockSignature.size() > MAX_SIGNATURE_SIZE)
+        return false;
+
+    return VerifySignature(blockHash, blockSignature, account.owner_pubkey) ||
+           VerifySignature(blockHash, blockSignature, account.miner_pubkey);
+}
+
+bool VerifyBlockProducer(const CBlock *pBlock, CCacheWrapper &cwIn) {
+    if (pBlock->vptx.empty())
+        return false;
+
+    VoteDelegateVector delegates;
+    VoteDelegate curDelegate;
+    if (!GetBlockDelegate(pBlock, cwIn, delegates, curDelegate))
+        return false;
+
+    CAccount account;
+    if (!cwIn.accountCache.GetAccount(pBlock->vptx[0]->txUid, account) || account.regid != curDelegate.regid)
+        return false;
+
+    return VerifyBlockSignature(pBlock, account);
+}
+
+bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx, VoteDelegate &curDelegateOut) {
+    uint32_t maxNonce = SysCfg().GetBlockMaxNonce();
+
+    VoteDelegateVector delegates;
+    if (!GetBlockDelegate(pBlock, cwIn, delegates, curDelegateOut))
         return ERRORMSG("VerifyRewardTx() : failed to get current delegate");
 
     CAccount delegateAccount;
@@ -204,7 +410,7 @@ bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx,
     if (pBlock->GetNonce() > maxNonce)
         return ERRORMSG("VerifyRewardTx() : invalid nonce: %u", pBlock->GetNonce());
 
-    if (pBlock->GetMerkleRootHash() != pBlock->BuildMerkleTree())
+    if (pBlock->GetMerkleRootHash() != pBlock->ComputeMerkleRoot())
         return ERRORMSG("VerifyRewardTx() : wrong merkle root hash");
 
     auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
@@ -233,16 +439,8 @@ bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx,
                             delegateAccount.regid.ToString(), account.regid.ToString());
         }
 
-        const auto &blockHash      = pBlock->GetHash();
-        const auto &blockSignature = pBlock->GetSignature();
-
-        if (blockSignature.size() == 0 || blockSignature.size() > MAX_SIGNATURE_SIZE) {
-            return ERRORMSG("VerifyRewardTx() : invalid block signature size, hash=%s", blockHash.ToString());
-        }
-
-        if (!VerifySignature(blockHash, blockSignature, account.owner_pubkey))
-            if (!VerifySignature(blockHash, blockSignature, account.miner_pubkey))
-                return ERRORMSG("VerifyRewardTx() : verify signature error");
+        if (!VerifyBlockSignature(pBlock, account))
+            return ERRORMSG("VerifyRewardTx() : verify signature error, hash=%s", pBlock->GetHash().ToString());
     } else {
         return ERRORMSG("VerifyRewardTx() : failed to get account info, regId=%s", pBlock->vptx[0]->txUid.ToString());
     }
@@ -312,31 +510,36 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
         uint64_t totalFuel      = 0;
         uint64_t reward         = 0;
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(height, txPriorities, fuelRate);
+        // Transactions of memory pool sorted by priority rules.
+        CPriorityTxIterator txIterator(mempool.txPriorities, *pCdMan->pTxCache);
 
         LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+                 mempool.txPriorities.size());
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
-            CBaseTx *pBaseTx = itor->baseTx.get();
+        while (const TxPriority *pTxPriority = txIterator.Next()) {
+            CBaseTx *pBaseTx = pTxPriority->baseTx.get();
 
-            uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+            uint32_t txSize = pBaseTx->GetTxSize();
             if (totalBlockSize + txSize >= nBlockMaxSize) {
                 LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : exceed max block size, txid: %s\n",
                          pBaseTx->GetHash().GetHex());
                 continue;
             }
 
-            auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            // the memory-only price point cache can't be rolled back, price txs still run on a child layer
+            std::shared_ptr<CCacheWrapper> spCW;
+            if (pBaseTx->IsPriceFeedTx() || pBaseTx->IsPriceMedianTx())
+                spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            CCacheWrapper &txCw = spCW ? *spCW : cwIn;
+            CCacheWrapper::CSavepoint savepoint(cwIn);
 
             try {
                 CValidationState state;
                 pBaseTx->nFuelRate = fuelRate;
                 uint32_t prevBlockTime = pIndexPrev->GetBlockTime();
-                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::mining);
+                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, &txCw, &state, transaction_status_type::mining);
+                context.pPreCheckMemo = pTxPriority->spPreCheckMemo.get();
                 if (!pBaseTx->CheckTx(context) || !pBaseTx->ExecuteTx(context)) {
                     LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : failed to pack transaction, txid: %s\n",
                             pBaseTx->GetHash().GetHex());
@@ -357,7 +560,9 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
                 continue;
             }
 
-            spCW->Flush();
+            if (spCW)
+                spCW->Flush();
+            savepoint.Commit();
 
             auto fuel        = pBaseTx->GetFuel(height, fuelRate);
             auto fees_symbol = std::get<0>(pBaseTx->GetFees());
@@ -373,7 +578,7 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(pTxPriority->baseTx);
 
             LogPrint(BCLog::DEBUG, "miner total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n", totalFuel,
                      pBaseTx->GetFuel(height, fuelRate), pBaseTx->nRunStep, fuelRate, pBaseTx->GetHash().GetHex());
@@ -421,58 +626,186 @@ static bool CreateStableCoinGenesisBlock(std::unique_ptr<CBlock> &pBlock) {
     return true;
 }
 
-static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper &cwIn, std::unique_ptr<CBlock> &pBlock) {
-    pBlock->vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
+// A tx failed to pack without cs_main, written to the log cache when the block is submitted
+struct CPackTxFailure {
+    uint256 txid;
+    uint8_t code;
+    string reason;
+};
+
+// A block packed in steps on a cache layer over the state snapshot of pIndexPrev kept between them, from before
+// its slot when the delegate is next, so the slot only packs the txs arrived since and signs
+struct CBlockPackState {
+    CBlockIndex *pIndexPrev = nullptr;
+    std::shared_ptr<CStateSnapshot> spSnapshot;
+    std::unique_ptr<CCacheWrapper> spCw;                 // the writes of the txs packed
+    std::unique_ptr<CSysParamDBCache> spMinerFeeCache;  // the miner fees of the tip
+    std::unique_ptr<CBlock> pBlock;
+    vector<CPackTxFailure> failures;
+    CBlockUndo txUndo;                                   // of the txs packed, handed over to ConnectBlock
+    UnorderedHashSet triedTxids;                         // packed or failed, not tried again by a later step
+    bool fPriceMedianTried             = false;
+    uint32_t fuelRate                  = 0;
+    int32_t index                      = 0;  // 0: block reward tx
+    uint64_t totalBlockSize            = 0;
+    uint64_t totalRunStep              = 0;
+    uint64_t totalFees                 = 0;
+    uint64_t totalFuel                 = 0;
+    map<TokenSymbol, uint64_t> rewards = {{SYMB::WICC, 0}, {SYMB::WUSD, 0}};
+
+    bool IsFor(const CBlockIndex *pIndexPrevIn, uint32_t blockTime) const {
+        return pIndexPrev == pIndexPrevIn && pBlock && pBlock->GetTime() == blockTime;
+    }
+
+    // the cache layers go before the snapshot they are over
+    void Clear() {
+        spMinerFeeCache.reset();
+        spCw.reset();
+        *this = CBlockPackState();
+    }
+};
+
+static bool InitBlockPackState(CBlockIndex *pIndexPrev, uint32_t blockTime, CBlockPackState &packState) {
+    std::shared_ptr<CStateSnapshot> spSnapshot = CStateSnapshot::GetCurrent();
+    if (spSnapshot->tip_hash != pIndexPrev->GetBlockHash()) {
+        LogPrint(BCLog::MINER, "%s() : active chain tip changed when mining! pre_block=%d:%s, snapshot_block=%d:%s\n",
+            __FUNCTION__, pIndexPrev->height, pIndexPrev->GetBlockHash().ToString(), spSnapshot->height,
+            spSnapshot->tip_hash.ToString());
+        return false;
+    }
+
+    packState.pIndexPrev = pIndexPrev;
+    packState.spSnapshot = spSnapshot;
+    packState.spCw.reset(new CCacheWrapper(&spSnapshot->cw));
+    packState.spMinerFeeCache.reset(new CSysParamDBCache(&spSnapshot->cw.sysParamCache));
+    packState.pBlock.reset(new CBlock());
+    packState.pBlock->SetTime(blockTime);
+    packState.pBlock->vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
+    {
+        CStateSnapshot::CReadScope readScope(spSnapshot);
+        packState.fuelRate = GetElementForBurn(pIndexPrev);
+    }
+    packState.totalBlockSize = ::GetSerializeSize(*packState.pBlock, SER_NETWORK, PROTOCOL_VERSION);
+    return true;
+}
 
+// Pack the txs of the mempool not tried yet into the block of packState without holding cs_main: the txs run on
+// the cache layer of packState, the ones reading more than the db caches (VM contracts, prices, dex and cdp scans)
+// still take cs_main for their execution and abort the block if the tip moved. The packing before the slot stops
+// at stopMs, 0 for none.
+static bool PackBlockTxs(int64_t startMiningMs, int64_t stopMs, CBlockPackState &packState, MiningSlotTimes &times) {
     // Largest block you're willing to create:
     uint32_t nBlockMaxSize = SysCfg().GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
     // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
     nBlockMaxSize = std::max<uint32_t>(1000, std::min<uint32_t>((MAX_BLOCK_SIZE - 1000), nBlockMaxSize));
 
-    // Collect memory pool transactions into the block
+    // The priority index of the mempool and its sender links, its txs are copied under mempool.cs when they are packed
+    set<TxPriority> txPriorities;
+    TxParentMap txParents;
     {
-        LOCK2(cs_main, mempool.cs);
-
-        CBlockIndex *pIndexPrev            = chainActive.Tip();
-        uint32_t blockTime                 = pBlock->GetTime();
-        int32_t height                     = pIndexPrev->height + 1;
-        int32_t index                      = 0; // 0: block reward tx
-        uint32_t fuelRate                  = GetElementForBurn(pIndexPrev);
-        uint64_t totalBlockSize            = ::GetSerializeSize(*pBlock, SER_NETWORK, PROTOCOL_VERSION);
-        uint64_t totalRunStep              = 0;
-        uint64_t totalFees                 = 0;
-        uint64_t totalFuel                 = 0;
-        map<TokenSymbol, uint64_t> rewards = {{SYMB::WICC, 0}, {SYMB::WUSD, 0}};
-
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(height, txPriorities, fuelRate);
+        int64_t lockStart = GetTimeMicros();
+        LOCK(mempool.cs);
+        times.lockWait += GetTimeMicros() - lockStart;
+        txPriorities = mempool.txPriorities;
+        mempool.GetTxParents(txParents);
+    }
 
-        // Push block price median transaction into queue.
-        txPriorities.emplace(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height)));
+    CBlock *pBlock          = packState.pBlock.get();
+    CBlockIndex *pIndexPrev = packState.pIndexPrev;
 
-        LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+    // Collect memory pool transactions into the block
+    {
+        CStateSnapshot::CReadScope readScope(packState.spSnapshot);
+        CCacheWrapper &cwIn = *packState.spCw;
+        // the miner fees come from the tip as before, not from the writes of the txs packed before
+        CMinerFeeCacheScope minerFeeScope(packState.spMinerFeeCache.get());
+
+        uint32_t blockTime                  = pBlock->GetTime();
+        int32_t height                      = pIndexPrev->height + 1;
+        uint32_t fuelRate                   = packState.fuelRate;
+        int32_t &index                      = packState.index;
+        uint64_t &totalBlockSize            = packState.totalBlockSize;
+        uint64_t &totalRunStep              = packState.totalRunStep;
+        uint64_t &totalFees                 = packState.totalFees;
+        uint64_t &totalFuel                 = packState.totalFuel;
+        map<TokenSymbol, uint64_t> &rewards = packState.rewards;
+
+        // Transactions of memory pool sorted by priority rules, with the block price median transaction.
+        TxPriority priceMedianTx(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height));
+        CPriorityTxIterator txIterator(txPriorities, cwIn.txCache,
+                                       packState.fPriceMedianTried ? nullptr : &priceMedianTx, &txParents);
+
+        LogPrint(BCLog::MINER, "PackBlockTxs() : got %lu transaction(s) sorted by priority rules, %u tried before\n",
+                 txPriorities.size() + 1, packState.triedTxids.size());
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
+        int64_t txStart = 0;
+        while (true) {
+            // the time of the previous tx, whatever its outcome
+            int64_t nowMicros = GetTimeMicros();
+            if (txStart != 0)
+                miningTimePredictor.AddTxSample(nowMicros - txStart);
+            txStart = nowMicros;
+
+            if (stopMs != 0 && nowMicros / 1000 >= stopMs)
+                break;
 
-            if (!CheckPackBlockTime(startMiningMs, height)) {
+            if (!CheckPackTxTime(startMiningMs, height, pBlock->vptx.size())) {
                 LogPrint(BCLog::MINER, "%s() : no time left to pack more tx, ignore! height=%d, start_ms=%lld, tx_count=%u\n",
                     __FUNCTION__, height, startMiningMs, pBlock->vptx.size());
+                times.fCutoff = true;
                 break;
             }
 
-            CBaseTx *pBaseTx = itor->baseTx.get();
+            const TxPriority *pTxPriority = txIterator.Next();
+            while (pTxPriority != nullptr && pTxPriority != &priceMedianTx && packState.triedTxids.count(pTxPriority->txid))
+                pTxPriority = txIterator.Next();
+            times.select += GetTimeMicros() - nowMicros;
+            if (pTxPriority == nullptr)
+                break;
+
+            if (pTxPriority == &priceMedianTx)
+                packState.fPriceMedianTried = true;
+            else
+                packState.triedTxids.insert(pTxPriority->txid);
 
-            uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+            // ExecuteTx sets the fuel rate and run steps of the tx, the mempool rescans its own copy
+            std::shared_ptr<CBaseTx> spTx = pTxPriority->baseTx;
+            if (!spTx->IsPriceMedianTx()) {
+                LOCK(mempool.cs);
+                spTx = pTxPriority->baseTx->GetNewInstance();
+            }
+            CBaseTx *pBaseTx = spTx.get();
+
+            uint32_t txSize = pBaseTx->GetTxSize();
             if (totalBlockSize + txSize >= nBlockMaxSize) {
-                LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : exceed max block size, txid: %s\n",
+                LogPrint(BCLog::MINER, "PackBlockTxs() : exceed max block size, txid: %s\n",
                          pBaseTx->GetHash().GetHex());
                 continue;
             }
 
-            auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            // the memory-only price point cache can't be rolled back, price txs still run on a child layer
+            std::shared_ptr<CCacheWrapper> spCW;
+            if (pBaseTx->IsPriceFeedTx() || pBaseTx->IsPriceMedianTx())
+                spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            CCacheWrapper &txCw = spCW ? *spCW : cwIn;
+            // the savepoint of a tx run on cwIn journals into its undo log when it commits
+            CBlockUndo txUndo;
+            std::optional<CTxUndoOpLogger> opLogger;
+            opLogger.emplace(txCw, pBaseTx->GetHash(), txUndo);
+            CCacheWrapper::CSavepoint savepoint(cwIn);
+
+            std::optional<CCriticalBlock> mainLock;
+            if (!CParallelTxExecutor::IsParallelizable(*pBaseTx)) {
+                int64_t lockStart = GetTimeMicros();
+                mainLock.emplace(cs_main, "cs_main", __FILE__, __LINE__, false, LOCK_SITE(cs_main));
+                times.lockWait += GetTimeMicros() - lockStart;
+                if (chainActive.Tip() != pIndexPrev) {
+                    LogPrint(BCLog::MINER, "%s() : active chain tip changed when mining! pre_block=%d:%s\n",
+                        __FUNCTION__, pIndexPrev->height, pIndexPrev->GetBlockHash().ToString());
+                    return false;
+                }
+            }
 
             try {
                 CValidationState state;
@@ -481,42 +814,50 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
 
                 // Special case for price median tx,
                 if (pBaseTx->IsPriceMedianTx()) {
-                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)itor->baseTx.get();
+                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)pBaseTx;
 
                     PriceMap medianPrices;
-                    if (!spCW->ppCache.CalcBlockMedianPrices(*spCW, height, medianPrices))
+                    if (!txCw.ppCache.CalcBlockMedianPrices(txCw, height, medianPrices))
                         return ERRORMSG("%s(), calculate block median prices error", __func__);
 
                     pPriceMedianTx->SetMedianPrices(medianPrices);
                 }
 
-                LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : begin to pack transaction: %s\n",
-                         pBaseTx->ToString(spCW->accountCache));
+                LogPrint(BCLog::MINER, "PackBlockTxs() : begin to pack transaction: %s\n",
+                         pBaseTx->ToString(txCw.accountCache));
 
                 uint32_t prevBlockTime = pIndexPrev->GetBlockTime();
-                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::mining);
-                if (!pBaseTx->CheckTx(context) || !pBaseTx->ExecuteTx(context)) {
-                    LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : failed to pack transaction: %s\n",
-                             pBaseTx->ToString(spCW->accountCache));
-
-                    pCdMan->pLogCache->SetExecuteFail(height, pBaseTx->GetHash(), state.GetRejectCode(),
-                                                      state.GetRejectReason());
+                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, &txCw, &state, transaction_status_type::mining);
+                context.pPreCheckMemo = pTxPriority->spPreCheckMemo.get();
+                int64_t executeStart = GetTimeMicros();
+                bool executed        = pBaseTx->CheckTx(context) && pBaseTx->ExecuteTx(context);
+                times.execute += GetTimeMicros() - executeStart;
+                ++times.triedTxCount;
+                if (!executed) {
+                    LogPrint(BCLog::MINER, "PackBlockTxs() : failed to pack transaction: %s\n",
+                             pBaseTx->ToString(txCw.accountCache));
+
+                    packState.failures.push_back({pBaseTx->GetHash(), state.GetRejectCode(), state.GetRejectReason()});
                     continue;
                 }
 
                 // Run step limits
                 if (totalRunStep + pBaseTx->nRunStep >= MAX_BLOCK_RUN_STEP) {
-                    LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : exceed max block run steps, txid: %s\n",
+                    LogPrint(BCLog::MINER, "PackBlockTxs() : exceed max block run steps, txid: %s\n",
                             pBaseTx->GetHash().GetHex());
                     continue;
                 }
             } catch (std::exception &e) {
-                LogPrint(BCLog::ERROR, "CreateNewBlockStableCoinRelease() : unexpected exception: %s\n", e.what());
+                LogPrint(BCLog::ERROR, "PackBlockTxs() : unexpected exception: %s\n", e.what());
 
                 continue;
             }
 
-            spCW->Flush();
+            if (spCW)
+                spCW->Flush();
+            savepoint.Commit();
+            opLogger.reset();
+            packState.txUndo.vtxundo.push_back(std::move(txUndo.vtxundo.back()));
 
             auto fuel        = pBaseTx->GetFuel(height, fuelRate);
             auto fees_symbol = std::get<0>(pBaseTx->GetFees());
@@ -532,30 +873,90 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(spTx);
 
             LogPrint(BCLog::DEBUG, "miner total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n", totalFuel,
                      pBaseTx->GetFuel(height, fuelRate), pBaseTx->nRunStep, fuelRate, pBaseTx->GetHash().GetHex());
 
         }
+    }
 
-        nLastBlockTx                   = index + 1;
-        nLastBlockSize                 = totalBlockSize;
+    return true;
+}
 
-        ((CUCoinBlockRewardTx *)pBlock->vptx[0].get())->reward_fees = rewards;
+// Fill in the header and the reward fees of the packed block
+static void FinishBlockPack(CBlockPackState &packState) {
+    CBlock *pBlock          = packState.pBlock.get();
+    CBlockIndex *pIndexPrev = packState.pIndexPrev;
+    int32_t height          = pIndexPrev->height + 1;
 
-        // Fill in header
-        pBlock->SetPrevBlockHash(pIndexPrev->GetBlockHash());
-        pBlock->SetNonce(0);
-        pBlock->SetHeight(height);
-        pBlock->SetFuel(totalFuel);
-        pBlock->SetFuelRate(fuelRate);
+    nLastBlockTx   = packState.index + 1;
+    nLastBlockSize = packState.totalBlockSize;
 
-        LogPrint(BCLog::INFO, "CreateNewBlockStableCoinRelease() : height=%d, tx=%d, totalBlockSize=%llu\n", height, index + 1,
-                 totalBlockSize);
+    ((CUCoinBlockRewardTx *)pBlock->vptx[0].get())->reward_fees = packState.rewards;
+
+    pBlock->SetPrevBlockHash(pIndexPrev->GetBlockHash());
+    pBlock->SetNonce(0);
+    pBlock->SetHeight(height);
+    pBlock->SetFuel(packState.totalFuel);
+    pBlock->SetFuelRate(packState.fuelRate);
+
+    LogPrint(BCLog::INFO, "FinishBlockPack() : height=%d, tx=%d, totalBlockSize=%llu\n", height, packState.index + 1,
+             packState.totalBlockSize);
+}
+
+// Pack the block on pIndexPrev, continuing the pre-packed block of packState when it is the one of the slot
+static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CBlockIndex *pIndexPrev,
+                                            std::unique_ptr<CBlock> &pBlock, MiningSlotTimes &times,
+                                            vector<CPackTxFailure> &failures, CBlockPackState &packState,
+                                            std::shared_ptr<CMinedBlockExecution> &spExecution) {
+    if (packState.IsFor(pIndexPrev, pBlock->GetTime())) {
+        times.prepackedTxCount = packState.index;
+    } else {
+        packState.Clear();
+        if (!InitBlockPackState(pIndexPrev, pBlock->GetTime(), packState))
+            return false;
     }
 
-    return true;
+    bool success = PackBlockTxs(startMiningMs, 0, packState, times);
+    if (success) {
+        FinishBlockPack(packState);
+        pBlock = std::move(packState.pBlock);
+        failures = std::move(packState.failures);
+        if (txLatencyTracer.IsEnabled()) {
+            for (const auto &pTx : pBlock->vptx)
+                txLatencyTracer.Stamp(pTx->GetHash(), TX_STAGE_PACKED);
+        }
+
+        spExecution = std::make_shared<CMinedBlockExecution>();
+        spExecution->prevBlockHash = pIndexPrev->GetBlockHash();
+        spExecution->spSnapshot    = packState.spSnapshot;
+        spExecution->spCw          = std::move(packState.spCw);
+        spExecution->txUndo        = std::move(packState.txUndo);
+    }
+    packState.Clear();
+    return success;
+}
+
+// Pre-pack the block of the coming slot of the delegate on the tip, before the slot starts
+static void PrepackBlock(int64_t slotStartMs, CBlockIndex *pIndexPrev, CBlockPackState &packState) {
+    int32_t blockHeight = pIndexPrev->height + 1;
+    if (blockHeight == (int32_t)SysCfg().GetStableCoinGenesisHeight() ||
+        GetFeatureForkVersion(blockHeight) == MAJOR_VER_R1)
+        return;
+
+    uint32_t blockTime = MillisToSecond(slotStartMs);
+    if (!packState.IsFor(pIndexPrev, blockTime)) {
+        packState.Clear();
+        if (!InitBlockPackState(pIndexPrev, blockTime, packState)) {
+            packState.Clear();
+            return;
+        }
+    }
+
+    MiningSlotTimes times;
+    if (!PackBlockTxs(slotStartMs, slotStartMs, packState, times))
+        packState.Clear();
 }
 
 bool CheckWork(CBlock *pBlock) {
@@ -627,16 +1028,19 @@ static bool GetMiner(int64_t startMiningMs, const int32_t blockHeight, Miner &mi
 }
 
 
-static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &miner) {
+static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &miner, CBlockPackState &packState) {
     int64_t lastTime    = 0;
     bool success        = false;
     int32_t blockHeight = 0;
+    MiningSlotTimes times;
     std::unique_ptr<CBlock> pBlock(new CBlock());
     if (!pBlock.get())
         throw runtime_error("ProduceBlock() : failed to create new block");
 
     {
+        int64_t lockStart = GetTimeMicros();
         LOCK(cs_main);
+        times.lockWait = GetTimeMicros() - lockStart;
         CBlockIndex *pTipIndex = chainActive.Tip();
         if (pPrevIndex != pTipIndex) {
             LogPrint(BCLog::MINER, "%s() : active chain tip changed when mining! pre_block=%d:%s, tip_block=%d:%s\n",
@@ -652,44 +1056,79 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
                 __FUNCTION__, blockHeight, startMiningMs, miner.account.regid.ToString());
             return false;
         }
+    }
 
-        lastTime  = GetTimeMillis();
-        auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
+    // the stable coin release packs without cs_main, the older releases take it for the whole packing
+    lastTime  = GetTimeMillis();
+    int64_t packStart = GetTimeMicros();
+    vector<CPackTxFailure> failures;
+    std::shared_ptr<CMinedBlockExecution> spExecution;
 
-        pBlock->SetTime(MillisToSecond(startMiningMs));  // set block time first
+    pBlock->SetTime(MillisToSecond(startMiningMs));  // set block time first
 
-        if (blockHeight == (int32_t)SysCfg().GetStableCoinGenesisHeight()) {
-            success = CreateStableCoinGenesisBlock(pBlock);  // stable coin genesis
-        } else if (GetFeatureForkVersion(blockHeight) == MAJOR_VER_R1) {
-            success = CreateNewBlockPreStableCoinRelease(*spCW, pBlock); // pre-stable coin release
-        } else {
-            success = CreateNewBlockStableCoinRelease(startMiningMs, *spCW, pBlock);    // stable coin release
-        }
+    if (blockHeight == (int32_t)SysCfg().GetStableCoinGenesisHeight()) {
+        success = CreateStableCoinGenesisBlock(pBlock);  // stable coin genesis
+    } else if (GetFeatureForkVersion(blockHeight) == MAJOR_VER_R1) {
+        LOCK(cs_main);
+        CCacheWrapper cw(pCdMan);
+        success = CreateNewBlockPreStableCoinRelease(cw, pBlock); // pre-stable coin release
+    } else {
+        success = CreateNewBlockStableCoinRelease(startMiningMs, pPrevIndex, pBlock, times, failures, packState,
+                                                  spExecution);  // stable coin release
+    }
+    times.pack = GetTimeMicros() - packStart;
 
-        if (!success) {
-            LogPrint(BCLog::MINER, "ProduceBlock() : failed to add a new block: height=%d, regid=%s, "
-                "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(),
-                GetTimeMillis() - lastTime);
+    if (!success) {
+        LogPrint(BCLog::MINER, "ProduceBlock() : failed to add a new block: height=%d, regid=%s, "
+            "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(),
+            GetTimeMillis() - lastTime);
+        return false;
+    }
+    LogPrint(BCLog::MINER,
+             "ProduceBlock() : succeeded in adding a new block: height=%d, regid=%s, tx_count=%u, "
+             "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(),
+             pBlock->vptx.size(), GetTimeMillis() - lastTime);
+
+    lastTime = GetTimeMillis();
+    int64_t signStart = GetTimeMicros();
+    success  = CreateBlockRewardTx(miner, pBlock.get());
+    times.sign = GetTimeMicros() - signStart;
+    if (!success) {
+        LogPrint(BCLog::MINER, "ProduceBlock() : fail to create block reward tx! height=%d, regid=%s, "
+            "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(), GetTimeMillis() - lastTime);
+        return false;
+    }
+    LogPrint(BCLog::MINER, "ProduceBlock() : succeed to create block reward tx! height=%d, regid=%s, reward_txid=%s, "
+        "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(), pBlock->vptx[0]->GetHash().ToString(),
+        GetTimeMillis() - lastTime);
+
+    {
+        int64_t lockStart = GetTimeMicros();
+        LOCK(cs_main);
+        times.lockWait += GetTimeMicros() - lockStart;
+
+        for (const auto &failure : failures)
+            pCdMan->pLogCache->SetExecuteFail(blockHeight, failure.txid, failure.code, failure.reason);
+
+        CBlockIndex *pTipIndex = chainActive.Tip();
+        if (pPrevIndex != pTipIndex) {
+            LogPrint(BCLog::MINER, "%s() : active chain tip changed when packing! pre_block=%d:%s, tip_block=%d:%s\n",
+                __FUNCTION__, pPrevIndex->height, pPrevIndex->GetBlockHash().ToString(),
+                pTipIndex->height, pTipIndex->GetBlockHash().ToString());
             return false;
         }
-        LogPrint(BCLog::MINER,
-                 "ProduceBlock() : succeeded in adding a new block: height=%d, regid=%s, tx_count=%u, "
-                 "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(),
-                 pBlock->vptx.size(), GetTimeMillis() - lastTime);
 
-        lastTime = GetTimeMillis();
-        success  = CreateBlockRewardTx(miner, pBlock.get());
-        if (!success) {
-            LogPrint(BCLog::MINER, "ProduceBlock() : fail to create block reward tx! height=%d, regid=%s, "
-                "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(), GetTimeMillis() - lastTime);
-            return false;
+        // ConnectBlock takes the execution of the txs instead of running them again
+        if (spExecution != nullptr) {
+            spExecution->blockHash = pBlock->GetHash();
+            SetMinedBlockExecution(spExecution);
         }
-        LogPrint(BCLog::MINER, "ProduceBlock() : succeed to create block reward tx! height=%d, regid=%s, reward_txid=%s, "
-            "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(), pBlock->vptx[0]->GetHash().ToString(),
-            GetTimeMillis() - lastTime);
 
         lastTime = GetTimeMillis();
+        int64_t processStart = GetTimeMicros();
         success  = CheckWork(pBlock.get());
+        times.process = GetTimeMicros() - processStart;
+        SetMinedBlockExecution(nullptr);
         if (!success) {
             LogPrint(BCLog::MINER, "ProduceBlock(), fail to check work for new block, height=%d, regid=%s, "
                 "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(), GetTimeMillis() - lastTime);
@@ -698,12 +1137,19 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
         LogPrint(BCLog::MINER, "ProduceBlock(), succeed to check work of new block, height=%d, regid=%s, hash=%s, "
             "used_time_ms=%lld\n", blockHeight, miner.account.regid.ToString(), pBlock->GetHash().ToString(),
             GetTimeMillis() - lastTime);
-
     }
 
+    times.total = GetTimeMicros() - startMiningMs * 1000;
+    miningTimePredictor.AddBlockSample(pBlock->vptx.size(), times.sign + times.process);
+    LogPrint(BCLog::MINER, "%s(), time breakdown of block %d: lock_wait=%lldus, select=%lldus, execute=%lldus, "
+        "pack=%lldus, sign=%lldus, process=%lldus, total=%lldus, tried_txs=%u, prepacked_txs=%u, cutoff=%d\n",
+        __FUNCTION__, blockHeight, times.lockWait, times.select, times.execute, times.pack, times.sign, times.process,
+        times.total, times.triedTxCount, times.prepackedTxCount, times.fCutoff);
+
     {
         LOCK(csMinedBlocks);
         miningBlockInfo.Set(pBlock.get());
+        miningBlockInfo.times = times;
         minedBlocks.push_front(miningBlockInfo);
         miningBlockInfo.SetNull();
     }
@@ -742,6 +1188,13 @@ void static ThreadProduceBlocks(CWallet *pWallet, int32_t targetHeight) {
     bool needSleep = false;
     int64_t nextSlotTime = 0;
 
+    // the block of the coming slot when this delegate produces it, checked once per slot
+    static const bool fPrepack = SysCfg().GetBoolArg("-prepack", DEFAULT_BLOCK_PREPACK);
+    CBlockPackState packState;
+    CBlockIndex *pPrepackCheckedPrev = nullptr;
+    int64_t prepackCheckedSlotTime   = 0;
+    bool fPrepackMiner               = false;
+
     try {
         SetMinerStatus(true);
 
@@ -783,6 +1236,16 @@ void static ThreadProduceBlocks(CWallet *pWallet, int32_t targetHeight) {
             int64_t curSlotTime = std::max(nextSlotTime, pIndexPrev->GetBlockTime() + GetBlockInterval(blockHeight));
             if (curMiningTime < curSlotTime) {
                 needSleep = true;
+                if (fPrepack) {
+                    if (pPrepackCheckedPrev != pIndexPrev || prepackCheckedSlotTime != curSlotTime) {
+                        Miner slotMiner;
+                        pPrepackCheckedPrev    = pIndexPrev;
+                        prepackCheckedSlotTime = curSlotTime;
+                        fPrepackMiner          = GetMiner(curSlotTime * 1000, blockHeight, slotMiner);
+                    }
+                    if (fPrepackMiner)
+                        PrepackBlock(curSlotTime * 1000, pIndexPrev, packState);
+                }
                 continue;
             }
 
@@ -799,7 +1262,7 @@ void static ThreadProduceBlocks(CWallet *pWallet, int32_t targetHeight) {
 
             mining     = true;
 
-            if (!ProduceBlock(startMiningMs, pIndexPrev, *spMiner)) {
+            if (!ProduceBlock(startMiningMs, pIndexPrev, *spMiner, packState)) {
                 continue;
             }
 
@@ -845,6 +1308,7 @@ void MinedBlockInfo::SetNull() {
     totalBlockSize = 0;
     hash.SetNull();
     hashPrevBlock.SetNull();
+    times          = MiningSlotTimes();
 }
 
 void MinedBlockInfo::Set(const CBlock *pBlock) {
@@ -28,6 +28,9 @@ class CAccount;
 
 using namespace std;
 
+static const bool DEFAULT_ADAPTIVE_PACK = true;
+static const bool DEFAULT_BLOCK_PREPACK = true;
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // ThreadProduceBlocks
@@ -39,25 +42,18 @@ struct Miner {
     CKey key;
 };
 
-struct TxPriority {
-    double priority;
-    double feePerKb;
-    std::shared_ptr<CBaseTx> baseTx;
-
-    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
-        : priority(priorityIn), feePerKb(feePerKbIn), baseTx(baseTxIn) {}
-
-    bool operator<(const TxPriority &other) const {
-        if (fabs(this->priority - other.priority) <= 1000) {
-            if (fabs(this->feePerKb < other.feePerKb) <= 1e-8) {
-                return this->baseTx->GetHash() < other.baseTx->GetHash();
-            } else {
-                return this->feePerKb < other.feePerKb;
-            }
-        } else {
-            return this->priority < other.priority;
-        }
-    }
+// the time breakdown of the production of a block in microseconds
+struct MiningSlotTimes {
+    int64_t lockWait      = 0;      // waiting for cs_main and mempool.cs
+    int64_t select        = 0;      // taking the txs by priority from the mempool
+    int64_t execute       = 0;      // CheckTx and ExecuteTx of the txs tried
+    int64_t pack          = 0;      // the whole packing, incl. select and execute
+    int64_t sign          = 0;      // creating and signing the block reward tx
+    int64_t process       = 0;      // CheckWork, i.e. ProcessBlock connecting and relaying the block
+    int64_t total         = 0;      // from the start of the slot to the block processed
+    uint32_t triedTxCount = 0;      // incl. the txs failed or skipped after the execution
+    uint32_t prepackedTxCount = 0;  // the txs packed before the slot started
+    bool fCutoff          = false;  // the packing stopped for lack of time left in the slot
 };
 
 // mined block info
@@ -72,6 +68,7 @@ public:
     uint64_t totalBlockSize;  // block size(bytes)
     uint256 hash;             // block hash
     uint256 hashPrevBlock;    // prev block has
+    MiningSlotTimes times;
 
 public:
     MinedBlockInfo() { SetNull(); }
@@ -87,14 +84,19 @@ void GenerateProduceBlockThread(bool fGenerate, CWallet *pWallet, int32_t nThrea
 
 bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx, VoteDelegate &curDelegateOut);
 
+/** The delegate of the slot of the block, out of the shuffled active delegates of cwIn */
+bool GetBlockDelegate(const CBlock *pBlock, CCacheWrapper &cwIn, VoteDelegateVector &delegates,
+                      VoteDelegate &curDelegateOut);
+
+/** Whether the block is signed by the delegate of its slot, the cheap check of a block relayed before its validation */
+bool VerifyBlockProducer(const CBlock *pBlock, CCacheWrapper &cwIn);
+
 /** Check mined block */
 bool CheckWork(CBlock *pBlock);
 
 /** Get burn element */
 uint32_t GetElementForBurn(CBlockIndex *pIndex);
 
-void GetPriorityTx(vector<TxPriority> &vecPriority, int32_t nFuelRate);
-
 void ShuffleDelegates(const int32_t nCurHeight, const int64_t blockTime,VoteDelegateVector &delegates);
 
 bool GetCurrentDelegate(const int64_t currentTime, const int32_t currHeight,
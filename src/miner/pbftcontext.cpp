@@ -6,11 +6,13 @@
 
 #include "pbftcontext.h"
 #include "p2p/protocol.h"
+#include "persistence/accountdb.h"
 
 CPBFTContext pbftContext ;
 
 bool CPBFTContext::GetMinerListByBlockHash(const uint256 blockHash, set<CRegID>& miners) {
 
+    LOCK(cs_blockMinerList);
     auto it = blockMinerListMap.find(blockHash) ;
     if(it == blockMinerListMap.end())
         return false;
@@ -18,11 +20,41 @@ bool CPBFTContext::GetMinerListByBlockHash(const uint256 blockHash, set<CRegID>&
     return true ;
 }
 
-bool CPBFTContext::SaveMinersByHash(uint256 blockhash, VoteDelegateVector delegates) {
+PBFTDelegateKeysPtr CPBFTContext::GetDelegateKeysByHash(const uint256 &blockHash) {
+
+    LOCK(cs_blockMinerList);
+    auto it = blockDelegateKeysMap.find(blockHash) ;
+    if(it == blockDelegateKeysMap.end())
+        return nullptr;
+    return it->second ;
+}
+
+PBFTDelegateKeysPtr CPBFTContext::GetLastDelegateKeys() {
+
+    LOCK(cs_blockMinerList);
+    return spLastDelegateKeys ;
+}
+
+bool CPBFTContext::SaveMinersByHash(uint256 blockhash, VoteDelegateVector delegates,
+                                    const CAccountDBCache &accountCache) {
     set<CRegID> miners ;
+    auto spKeys = std::make_shared<PBFTDelegateKeyMap>() ;
     for(auto delegate: delegates){
         miners.insert(delegate.regid);
+
+        CAccount account ;
+        if(!accountCache.GetAccount(delegate.regid, account)){
+            LogPrint(BCLog::ERROR, "SaveMinersByHash() : the account of delegate %s is not found\n",
+                     delegate.regid.ToString());
+            continue ;
+        }
+        (*spKeys)[delegate.regid] = {account.keyid, account.owner_pubkey, account.miner_pubkey} ;
     }
+
+    LOCK(cs_blockMinerList);
     blockMinerListMap.insert(std::make_pair(blockhash, miners));
+    if(!spLastDelegateKeys || *spLastDelegateKeys != *spKeys)
+        spLastDelegateKeys = spKeys ;
+    blockDelegateKeysMap.insert(std::make_pair(blockhash, spLastDelegateKeys));
     return true ;
-}
\ No newline at end of file
+}
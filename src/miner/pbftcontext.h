@@ -8,16 +8,37 @@
 #define MINER_PBFTCONTEXT_H
 
 #include <map>
+#include <memory>
 #include <set>
 #include "sync.h"
 #include "commons/uint256.h"
 #include "commons/limitedmap.h"
 #include "commons/mruset.h"
+#include "entities/id.h"
 #include "entities/vote.h"
 
 class CRegID ;
 class CBlockConfirmMessage ;
 class CBlockFinalityMessage;
+class CAccountDBCache;
+
+// the keys of a delegate which sign its PBFT messages
+struct CPBFTDelegateKey {
+    CKeyID keyid;
+    CPubKey owner_pubkey;
+    CPubKey miner_pubkey;
+
+    bool operator==(const CPBFTDelegateKey &other) const {
+        return keyid == other.keyid && owner_pubkey == other.owner_pubkey && miner_pubkey == other.miner_pubkey;
+    }
+};
+
+/**
+ * The keys of the delegates after a block, published once per block under cs_main and never changed, so the
+ * PBFT messages are checked from a snapshot of it without cs_main. The blocks of a delegate set share one map.
+ */
+typedef std::map<CRegID, CPBFTDelegateKey> PBFTDelegateKeyMap;
+typedef std::shared_ptr<const PBFTDelegateKeyMap> PBFTDelegateKeysPtr;
 
 
 template <typename MsgType>
@@ -28,31 +49,48 @@ private:
     limitedmap<uint256, set<MsgType>> blockMessagesMap ;
     mruset<uint256> broadcastedBlockHashSet ;
     mruset<MsgType> messageKnown ;
+    mruset<uint256> certifiedBlockHashSet ;  // blocks of which a certificate was verified or relayed
 
 public:
     CPBFTMessageMan(){
             blockMessagesMap.max_size(500) ;
             broadcastedBlockHashSet.max_size(500) ;
             messageKnown.max_size(500) ;
+            certifiedBlockHashSet.max_size(500) ;
     }
 
     CPBFTMessageMan(const int maxSize) {
         blockMessagesMap.max_size(maxSize) ;
         broadcastedBlockHashSet.max_size(maxSize) ;
         messageKnown.max_size(maxSize) ;
+        certifiedBlockHashSet.max_size(maxSize) ;
     }
 
 public:
 
     bool IsBroadcastedBlock(uint256 blockHash) {
+        LOCK(cs_pbftmessage);
         return broadcastedBlockHashSet.count(blockHash) > 0;
     }
 
     bool SaveBroadcastedBlock(uint256 blockHash) {
+        LOCK(cs_pbftmessage);
         broadcastedBlockHashSet.insert(blockHash) ;
         return true ;
     }
+    bool IsCertifiedBlock(const uint256 &blockHash) {
+        LOCK(cs_pbftmessage);
+        return certifiedBlockHashSet.count(blockHash) > 0;
+    }
+
+    bool SaveCertifiedBlock(const uint256 &blockHash) {
+        LOCK(cs_pbftmessage);
+        certifiedBlockHashSet.insert(blockHash) ;
+        return true ;
+    }
+
     bool IsKnown(const MsgType msg) {
+        LOCK(cs_pbftmessage);
         return messageKnown.count(msg) != 0 ;
     }
 
@@ -80,6 +118,7 @@ public:
     }
 
     bool GetMessagesByBlockHash(const uint256 hash, set<MsgType>& msgs) {
+            LOCK(cs_pbftmessage);
             auto it = blockMessagesMap.find(hash) ;
             if(it == blockMessagesMap.end())
                 return false;
@@ -97,15 +136,25 @@ public:
     CPBFTMessageMan<CBlockConfirmMessage> confirmMessageMan ;
     CPBFTMessageMan<CBlockFinalityMessage> finalityMessageMan ;
     limitedmap<uint256, set<CRegID>> blockMinerListMap ;
+    limitedmap<uint256, PBFTDelegateKeysPtr> blockDelegateKeysMap ;
+    PBFTDelegateKeysPtr spLastDelegateKeys ;
+    CCriticalSection cs_blockMinerList;
 
     CPBFTContext(){
         blockMinerListMap.max_size(500) ;
-
+        blockDelegateKeysMap.max_size(500) ;
     }
 
     bool GetMinerListByBlockHash(const uint256 blockHash, set<CRegID>& delegates) ;
 
-    bool SaveMinersByHash(uint256 blockhash, VoteDelegateVector delegates) ;
+    // the keys of the delegates after the block, null if the block is not known yet
+    PBFTDelegateKeysPtr GetDelegateKeysByHash(const uint256 &blockHash) ;
+
+    // the keys of the delegates after the last saved block, null before the first one
+    PBFTDelegateKeysPtr GetLastDelegateKeys() ;
+
+    // requires cs_main, the keys of the delegates are read from accountCache
+    bool SaveMinersByHash(uint256 blockhash, VoteDelegateVector delegates, const CAccountDBCache &accountCache) ;
 
 
 };
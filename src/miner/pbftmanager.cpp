@@ -5,12 +5,19 @@
 
 
 #include "pbftmanager.h"
+#include "chain/txlatency.h"
 #include "miner/pbftcontext.h"
 #include "persistence/cachewrapper.h"
 #include "p2p/protocol.h"
+#include "p2p/headerchain.h"
 #include "miner/miner.h"
 #include "wallet/wallet.h"
 
+#include <deque>
+
+#include <boost/thread.hpp>
+#include <boost/variant.hpp>
+
 CPBFTMan pbftMan;
 extern CPBFTContext pbftContext;
 extern CWallet *pWalletMain;
@@ -99,6 +106,7 @@ bool CPBFTMan::UpdateGlobalFinBlock(const uint32_t height) {
         globalFinIndex = pTemp;
         globalFinHash = pTemp->GetBlockHash() ;
         pCdMan->pBlockCache->WriteGlobalFinBlock(pTemp->height, pTemp->GetBlockHash()) ;
+        txLatencyTracer.OnBlockFinalized(pTemp->height);
         return true ;
     }
 
@@ -213,6 +221,68 @@ int64_t  CPBFTMan::GetLocalFinLastUpdate() const {
     return localFinLastUpdate ;
 }
 
+bool CPBFTMan::UpdateAssumedFinBlock(const CPBFTCertificate& cert){
+
+    if(cert.msgType != PBFTMsgType::FINALITY_BLOCK)
+        return false ;
+    {
+        LOCK(cs_finblock);
+        if(cert.height <= (uint32_t)assumedFinHeight)
+            return false ;
+    }
+
+    PBFTDelegateKeysPtr spDelegateKeys = pbftContext.GetLastDelegateKeys();
+    if(!spDelegateKeys || cert.signerBitmap.size() != (spDelegateKeys->size() + 7) / 8 ||
+       cert.vSignatures.size() != cert.GetSignerCount())
+        return false ;
+
+    CBlockFinalityMessage msg(cert.height, cert.blockHash, cert.preBlockHash);
+    uint256 messageHash = msg.GetHash();
+    uint32_t index = 0, signerCount = 0 ;
+    for(const auto& delegate: *spDelegateKeys){
+        if(cert.IsSigner(index)){
+            const auto& vSignature = cert.vSignatures[signerCount++] ;
+            if(!VerifySignature(messageHash, vSignature, delegate.second.owner_pubkey) &&
+               !VerifySignature(messageHash, vSignature, delegate.second.miner_pubkey))
+                return ERRORMSG("UpdateAssumedFinBlock(), the signature of %s is invalid", delegate.first.ToString());
+        }
+        index++ ;
+    }
+    if(signerCount != cert.GetSignerCount() || signerCount < (uint32_t)FINALITY_BLOCK_CONFIRM_MINER_COUNT)
+        return false ;
+
+    LOCK(cs_finblock);
+    if(cert.height <= (uint32_t)assumedFinHeight)
+        return false ;
+    assumedFinHeight = cert.height ;
+    assumedFinHash = cert.blockHash ;
+    LogPrint(BCLog::INFO, "assume the blocks up to %d finalized, hash=%s\n", assumedFinHeight, assumedFinHash.GetHex());
+    return true ;
+}
+
+bool CPBFTMan::IsAssumedFinalized(const CBlockIndex* pIndex){
+
+    AssertLockHeld(cs_main);
+    if(pIndex == nullptr || !IsInitialBlockDownload() ||
+       !SysCfg().GetBoolArg("-assumefinalized", DEFAULT_ASSUME_FINALIZED))
+        return false ;
+
+    int32_t finHeight ;
+    uint256 finHash ;
+    {
+        LOCK(cs_finblock);
+        finHeight = assumedFinHeight ;
+        finHash = assumedFinHash ;
+    }
+    if(pIndex->height > finHeight)
+        return false ;
+
+    // both blocks on the best header chain, so the certified block descends from this one
+    uint256 hash ;
+    return headerChain.GetBestHash(finHeight, hash) && hash == finHash &&
+           headerChain.GetBestHash(pIndex->height, hash) && hash == pIndex->GetBlockHash() ;
+}
+
 bool CPBFTMan::UpdateGlobalFinBlock(const CBlockFinalityMessage& msg){
 
     CBlockIndex* fi = GetGlobalFinIndex();
@@ -247,23 +317,18 @@ bool CPBFTMan::UpdateGlobalFinBlock(const CBlockFinalityMessage& msg){
     return false;
 }
 
-static bool PbftFindMiner(CRegID delegate, Miner &miner){
-    {
-        LOCK(cs_main);
-        if (!pCdMan->pAccountCache->GetAccount(delegate, miner.account)) {
-            LogPrint(BCLog::MINER, "PbftFindMiner() : fail to get miner account! regid=%s\n",
-                     miner.delegate.regid.ToString());
-            return false;
-        }
-    }
+static bool PbftFindMiner(const CRegID &delegate, const CPBFTDelegateKey &delegateKey, Miner &miner){
 
-    {
-        LOCK(pWalletMain->cs_wallet);
-        if (miner.account.miner_pubkey.IsValid() && pWalletMain->GetKey(miner.account.keyid, miner.key, true)) {
-            return true;
-        } else if (!pWalletMain->GetKey(miner.account.keyid, miner.key)) {
-            return false;
-        }
+    miner.account.regid = delegate ;
+    miner.account.keyid = delegateKey.keyid ;
+    miner.account.owner_pubkey = delegateKey.owner_pubkey ;
+    miner.account.miner_pubkey = delegateKey.miner_pubkey ;
+
+    LOCK(pWalletMain->cs_wallet);
+    if (delegateKey.miner_pubkey.IsValid() && pWalletMain->GetKey(delegateKey.keyid, miner.key, true)) {
+        return true;
+    } else if (!pWalletMain->GetKey(delegateKey.keyid, miner.key)) {
+        return false;
     }
 
     return true;
@@ -284,11 +349,11 @@ bool BroadcastBlockFinality(const CBlockIndex* block){
         return true ;
 
     //查找上一个区块执行过后的矿工列表
-    set<CRegID> delegates;
-
     if(block->pprev == nullptr)
         return false ;
-    pbftContext.GetMinerListByBlockHash(block->pprev->GetBlockHash(), delegates);
+    PBFTDelegateKeysPtr spDelegateKeys = pbftContext.GetDelegateKeysByHash(block->pprev->GetBlockHash());
+    if(!spDelegateKeys)
+        return false ;
 
     uint256 preHash = block->pprev == nullptr? uint256(): block->pprev->GetBlockHash();
 
@@ -297,10 +362,10 @@ bool BroadcastBlockFinality(const CBlockIndex* block){
 
     {
 
-        for(auto delegate: delegates){
+        for(const auto& delegate: *spDelegateKeys){
 
             Miner miner ;
-            if(!PbftFindMiner(delegate, miner))
+            if(!PbftFindMiner(delegate.first, delegate.second, miner))
                 continue ;
             msg.miner = miner.account.regid ;
             vector<unsigned char > vSign ;
@@ -343,20 +408,20 @@ bool BroadcastBlockConfirm(const CBlockIndex* block) {
         return true ;
 
     //查找上一个区块执行过后的矿工列表
-    set<CRegID> delegates;
-
     if(block->pprev == nullptr)
         return false ;
-    pbftContext.GetMinerListByBlockHash(block->pprev->GetBlockHash(), delegates);
+    PBFTDelegateKeysPtr spDelegateKeys = pbftContext.GetDelegateKeysByHash(block->pprev->GetBlockHash());
+    if(!spDelegateKeys)
+        return false ;
 
     uint256 preHash = block->pprev == nullptr? uint256(): block->pprev->GetBlockHash();
     CBlockConfirmMessage msg(block->height, block->GetBlockHash(), preHash);
 
     {
 
-        for(auto delegate: delegates){
+        for(const auto& delegate: *spDelegateKeys){
             Miner miner ;
-            if(!PbftFindMiner(delegate, miner))
+            if(!PbftFindMiner(delegate.first, delegate.second, miner))
                 continue ;
             msg.miner = miner.account.regid ;
             vector<unsigned char > vSign ;
@@ -411,17 +476,26 @@ bool CheckPBFTMessage(const int32_t msgType ,const CPBFTMessage& msg){
         return ERRORMSG("checkPbftMessage(): block not on chainActive") ;
     }
 
-    //check signature
-    CAccount account ;
-    {
+    //check signature, with the keys of the delegates after the parent block or from the accounts when the
+    //message comes ahead of it
+    CPBFTDelegateKey delegateKey ;
+    PBFTDelegateKeysPtr spDelegateKeys = pbftContext.GetDelegateKeysByHash(msg.preBlockHash);
+    if(spDelegateKeys) {
+        auto it = spDelegateKeys->find(msg.miner);
+        if(it == spDelegateKeys->end())
+            return ERRORMSG("checkPBftMessage() : the signature creator is not a delegate!");
+        delegateKey = it->second ;
+    } else {
+        CAccount account ;
         LOCK(cs_main) ;
         if(!pCdMan->pAccountCache->GetAccount(msg.miner, account)) {
             return ERRORMSG("checkPBftMessage() : the signature creator is not found!");
         }
+        delegateKey = {account.keyid, account.owner_pubkey, account.miner_pubkey} ;
     }
     uint256 messageHash = msg.GetHash();
-    if (!VerifySignature(messageHash, msg.vSignature, account.owner_pubkey)) {
-        if (!VerifySignature(messageHash, msg.vSignature, account.miner_pubkey))
+    if (!VerifySignature(messageHash, msg.vSignature, delegateKey.owner_pubkey)) {
+        if (!VerifySignature(messageHash, msg.vSignature, delegateKey.miner_pubkey))
             return ERRORMSG("checkPBftMessage() : verify signature error");
     }
 
@@ -447,4 +521,269 @@ bool RelayBlockFinalityMessage(const CBlockFinalityMessage& msg){
     return true ;
 }
 
+template <typename MsgType>
+static bool MakePBFTCertificate(CPBFTMessageMan<MsgType>& msgMan, const uint256& blockHash, CPBFTCertificate& cert) {
+
+    set<MsgType> messageSet ;
+    if(!msgMan.GetMessagesByBlockHash(blockHash, messageSet) || messageSet.empty())
+        return false ;
+
+    const MsgType& first = *messageSet.begin() ;
+    set<CRegID> miners;
+    if(!pbftContext.GetMinerListByBlockHash(first.preBlockHash, miners))
+        return false ;
+
+    map<CRegID, const MsgType*> minerMessages ;
+    for(const auto& msg: messageSet){
+        if(msg.preBlockHash == first.preBlockHash && miners.count(msg.miner))
+            minerMessages.emplace(msg.miner, &msg) ;
+    }
+    if(minerMessages.size() < (size_t)FINALITY_BLOCK_CONFIRM_MINER_COUNT)
+        return false ;
+
+    cert.msgType = first.msgType ;
+    cert.height = first.height ;
+    cert.blockHash = blockHash ;
+    cert.preBlockHash = first.preBlockHash ;
+    cert.signerBitmap.assign((miners.size() + 7) / 8, 0) ;
+    cert.vSignatures.clear() ;
+
+    uint32_t index = 0 ;
+    for(const auto& miner: miners){
+        auto it = minerMessages.find(miner) ;
+        if(it != minerMessages.end()){
+            cert.SetSigner(index) ;
+            cert.vSignatures.push_back(it->second->vSignature) ;
+        }
+        index++ ;
+    }
+    return true ;
+}
+
+template <typename MsgType>
+static bool CheckPBFTCertificateMessages(const int32_t msgType, const CPBFTCertificate& cert, vector<MsgType>& messages) {
+
+    if(cert.msgType != msgType)
+        return ERRORMSG("CheckPBFTCertificate(), msgType is illegal") ;
+
+    set<CRegID> miners;
+    if(!pbftContext.GetMinerListByBlockHash(cert.preBlockHash, miners))
+        return ERRORMSG("CheckPBFTCertificate(), the delegates of the parent block %s are unknown",
+                        cert.preBlockHash.GetHex()) ;
+
+    uint32_t signerCount = cert.GetSignerCount() ;
+    if(cert.signerBitmap.size() != (miners.size() + 7) / 8 || cert.vSignatures.size() != signerCount)
+        return ERRORMSG("CheckPBFTCertificate(), the signers do not match the signatures") ;
+
+    if(signerCount < (uint32_t)FINALITY_BLOCK_CONFIRM_MINER_COUNT)
+        return ERRORMSG("CheckPBFTCertificate(), %u signers are below the quorum", signerCount) ;
+
+    messages.clear() ;
+    uint32_t index = 0 ;
+    for(const auto& miner: miners){
+        if(cert.IsSigner(index)){
+            MsgType msg(cert.height, cert.blockHash, cert.preBlockHash) ;
+            msg.miner = miner ;
+            msg.SetSignature(cert.vSignatures[messages.size()]) ;
+            if(!CheckPBFTMessage(msgType, msg))
+                return ERRORMSG("CheckPBFTCertificate(), the message of signer %s is invalid", miner.ToString()) ;
+            messages.push_back(msg) ;
+        }
+        index++ ;
+    }
+    // a signer bit past the last delegate
+    if(messages.size() != signerCount)
+        return ERRORMSG("CheckPBFTCertificate(), signers out of the delegates") ;
+
+    return true ;
+}
+
+bool CheckPBFTCertificate(const CPBFTCertificate& cert, vector<CBlockConfirmMessage>& messages) {
+    return CheckPBFTCertificateMessages(PBFTMsgType::CONFIRM_BLOCK, cert, messages) ;
+}
+
+bool CheckPBFTCertificate(const CPBFTCertificate& cert, vector<CBlockFinalityMessage>& messages) {
+    return CheckPBFTCertificateMessages(PBFTMsgType::FINALITY_BLOCK, cert, messages) ;
+}
+
+bool RelayPBFTCertificate(const int32_t msgType, const uint256& blockHash, const CPBFTCertificate* cert) {
+
+    bool certified = msgType == PBFTMsgType::CONFIRM_BLOCK ?
+                     pbftContext.confirmMessageMan.IsCertifiedBlock(blockHash) :
+                     pbftContext.finalityMessageMan.IsCertifiedBlock(blockHash) ;
+    if(certified)
+        return true ;
+
+    CPBFTCertificate localCert ;
+    if(cert == nullptr){
+        bool made = msgType == PBFTMsgType::CONFIRM_BLOCK ?
+                    MakePBFTCertificate(pbftContext.confirmMessageMan, blockHash, localCert) :
+                    MakePBFTCertificate(pbftContext.finalityMessageMan, blockHash, localCert) ;
+        if(!made)
+            return false ;
+        cert = &localCert ;
+    }
+
+    if(msgType == PBFTMsgType::CONFIRM_BLOCK)
+        pbftContext.confirmMessageMan.SaveCertifiedBlock(blockHash) ;
+    else
+        pbftContext.finalityMessageMan.SaveCertifiedBlock(blockHash) ;
+
+    LOCK(cs_vNodes);
+    for(auto node:vNodes){
+        node->PushPBFTCertificate(*cert);
+    }
+    return true ;
+}
+
+static bool HandleBlockConfirmMessage(const CBlockConfirmMessage& message) {
+
+    CPBFTMessageMan<CBlockConfirmMessage>& msgMan = pbftContext.confirmMessageMan ;
+    if(msgMan.IsKnown(message))
+        return false ;
+
+    if(!CheckPBFTMessage(PBFTMsgType::CONFIRM_BLOCK,message)){
+        LogPrint(BCLog::NET, "confirm message check failed,miner_id=%s, blockhash=%s \n",message.miner.ToString(), message.blockHash.GetHex());
+        return false ;
+    }
+
+    msgMan.AddMessageKnown(message);
+    int messageCount = msgMan.SaveMessageByBlock(message.blockHash, message);
+
+    bool updateFinalitySuccess = false ;
+    if(messageCount >= FINALITY_BLOCK_CONFIRM_MINER_COUNT){
+       updateFinalitySuccess = pbftMan.UpdateLocalFinBlock(message) ;
+    }
+
+    // once the quorum is reached, the certificate is relayed instead of the remaining messages
+    if(!RelayPBFTCertificate(PBFTMsgType::CONFIRM_BLOCK, message.blockHash) && CheckPBFTMessageSignaturer(message))
+        RelayBlockConfirmMessage(message) ;
+
+    if(updateFinalitySuccess){
+        BroadcastBlockFinality(pbftMan.GetLocalFinIndex());
+    }
+
+    return true ;
+}
+
+static bool HandleBlockFinalityMessage(const CBlockFinalityMessage& message) {
+
+    CPBFTMessageMan<CBlockFinalityMessage>& msgMan = pbftContext.finalityMessageMan ;
+    if(msgMan.IsKnown(message))
+        return false ;
+
+    if(!CheckPBFTMessage(PBFTMsgType::FINALITY_BLOCK,message)){
+        LogPrint(BCLog::NET, "finality block message check failed,miner_id=%s, blockhash=%s \n",message.miner.ToString(), message.blockHash.GetHex());
+        return false ;
+    }
+
+    msgMan.AddMessageKnown(message);
+    int messageCount = msgMan.SaveMessageByBlock(message.blockHash, message);
+    if(messageCount>= FINALITY_BLOCK_CONFIRM_MINER_COUNT){
+        pbftMan.UpdateGlobalFinBlock(message) ;
+    }
+    if(!RelayPBFTCertificate(PBFTMsgType::FINALITY_BLOCK, message.blockHash) && CheckPBFTMessageSignaturer(message))
+        RelayBlockFinalityMessage(message) ;
+
+    return true ;
+}
 
+template <typename MsgType>
+static bool SavePBFTCertificateMessages(CPBFTMessageMan<MsgType>& msgMan, const vector<MsgType>& messages) {
+    for(const auto& msg: messages){
+        if(msgMan.IsKnown(msg))
+            continue ;
+        msgMan.AddMessageKnown(msg);
+        msgMan.SaveMessageByBlock(msg.blockHash, msg);
+    }
+    return true ;
+}
+
+static bool HandlePBFTCertificate(const CPBFTCertificate& cert) {
+
+    if(cert.msgType == PBFTMsgType::CONFIRM_BLOCK){
+        if(pbftContext.confirmMessageMan.IsCertifiedBlock(cert.blockHash))
+            return false ;
+
+        vector<CBlockConfirmMessage> messages ;
+        if(!CheckPBFTCertificate(cert, messages)){
+            LogPrint(BCLog::NET, "confirm certificate check failed, blockhash=%s\n", cert.blockHash.GetHex());
+            return false ;
+        }
+        SavePBFTCertificateMessages(pbftContext.confirmMessageMan, messages) ;
+        bool updateFinalitySuccess = pbftMan.UpdateLocalFinBlock(messages.front()) ;
+        RelayPBFTCertificate(PBFTMsgType::CONFIRM_BLOCK, cert.blockHash, &cert) ;
+        if(updateFinalitySuccess)
+            BroadcastBlockFinality(pbftMan.GetLocalFinIndex());
+
+    } else if(cert.msgType == PBFTMsgType::FINALITY_BLOCK){
+        if(pbftContext.finalityMessageMan.IsCertifiedBlock(cert.blockHash))
+            return false ;
+
+        // the parent is not connected yet while we catch up, the certificate only lets the download skip checks
+        if(IsInitialBlockDownload() && !pbftContext.GetDelegateKeysByHash(cert.preBlockHash))
+            return pbftMan.UpdateAssumedFinBlock(cert) ;
+
+        vector<CBlockFinalityMessage> messages ;
+        if(!CheckPBFTCertificate(cert, messages)){
+            LogPrint(BCLog::NET, "finality certificate check failed, blockhash=%s\n", cert.blockHash.GetHex());
+            return false ;
+        }
+        SavePBFTCertificateMessages(pbftContext.finalityMessageMan, messages) ;
+        pbftMan.UpdateGlobalFinBlock(messages.front()) ;
+        RelayPBFTCertificate(PBFTMsgType::FINALITY_BLOCK, cert.blockHash, &cert) ;
+
+    } else {
+        LogPrint(BCLog::NET, "unknown PBFT certificate type %d\n", cert.msgType);
+        return false ;
+    }
+
+    return true ;
+}
+
+typedef boost::variant<CBlockConfirmMessage, CBlockFinalityMessage, CPBFTCertificate> PBFTQueueItem;
+
+static boost::mutex pbftQueueMutex;
+static boost::condition_variable pbftQueueCond;
+static std::deque<PBFTQueueItem> pbftQueue;
+
+static bool EnqueuePBFTItem(PBFTQueueItem &&item) {
+    {
+        boost::unique_lock<boost::mutex> lock(pbftQueueMutex);
+        if(pbftQueue.size() >= MAX_PBFT_MESSAGE_QUEUE_SIZE){
+            LogPrint(BCLog::NET, "the PBFT message queue is full, drop the message\n");
+            return false ;
+        }
+        pbftQueue.push_back(std::move(item));
+    }
+    pbftQueueCond.notify_one();
+    return true ;
+}
+
+bool EnqueuePBFTMessage(const CBlockConfirmMessage& msg) { return EnqueuePBFTItem(msg); }
+bool EnqueuePBFTMessage(const CBlockFinalityMessage& msg) { return EnqueuePBFTItem(msg); }
+bool EnqueuePBFTMessage(const CPBFTCertificate& cert) { return EnqueuePBFTItem(cert); }
+
+class CPBFTQueueItemHandler: public boost::static_visitor<bool> {
+public:
+    bool operator()(const CBlockConfirmMessage& msg) const { return HandleBlockConfirmMessage(msg); }
+    bool operator()(const CBlockFinalityMessage& msg) const { return HandleBlockFinalityMessage(msg); }
+    bool operator()(const CPBFTCertificate& cert) const { return HandlePBFTCertificate(cert); }
+};
+
+void ThreadPBFTMessageHandler() {
+    RenameThread("coin-pbft");
+
+    while (true) {
+        PBFTQueueItem item;
+        {
+            boost::unique_lock<boost::mutex> lock(pbftQueueMutex);
+            while (pbftQueue.empty())
+                pbftQueueCond.wait(lock);  // interruption point on shutdown
+            item = std::move(pbftQueue.front());
+            pbftQueue.pop_front();
+        }
+        boost::apply_visitor(CPBFTQueueItemHandler(), item);
+        boost::this_thread::interruption_point();
+    }
+}
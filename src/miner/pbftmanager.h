@@ -12,6 +12,13 @@
 class CBlockConfirmMessage ;
 class CBlockFinalityMessage ;
 class CPBFTMessage ;
+class CPBFTCertificate ;
+
+// the PBFT messages waiting for their check, the ones over it are dropped
+static const uint32_t MAX_PBFT_MESSAGE_QUEUE_SIZE = 10000;
+// skip the signatures of the blocks under a finality certificate during the initial download. The certificate is
+// checked against the delegates of the tip, not the ones of its block, so this trusts the current delegates
+static const bool DEFAULT_ASSUME_FINALIZED = false;
 
 class CPBFTMan {
 
@@ -20,6 +27,8 @@ private:
     int64_t localFinLastUpdate = 0 ;
     CBlockIndex* globalFinIndex = nullptr ;
     uint256 globalFinHash = uint256();
+    int32_t assumedFinHeight = 0 ;
+    uint256 assumedFinHash = uint256();
     CCriticalSection cs_finblock ;
     bool UpdateLocalFinBlock(const uint32_t height);
     bool UpdateGlobalFinBlock(const uint32_t height);
@@ -36,6 +45,13 @@ public:
     bool UpdateGlobalFinBlock(const CBlockIndex* pIndex);
     bool UpdateGlobalFinBlock(const CBlockFinalityMessage& msg);
     int64_t  GetLocalFinLastUpdate() const ;
+
+    // a finality certificate received during the initial download for a block we do not have yet, its signers
+    // are checked with the keys of the delegates after our tip since the ones after its parent are unknown
+    bool UpdateAssumedFinBlock(const CPBFTCertificate& cert);
+    // requires cs_main, whether the block is on the best header chain under the assumed finality block, so
+    // ConnectBlock skips the signatures of its txs and the check of its reward tx but still executes them
+    bool IsAssumedFinalized(const CBlockIndex* pIndex);
 };
 
 bool BroadcastBlockConfirm(const CBlockIndex* block) ;
@@ -48,4 +64,22 @@ bool CheckPBFTMessageSignaturer(const CPBFTMessage& msg) ;
 bool RelayBlockConfirmMessage(const CBlockConfirmMessage& msg) ;
 
 bool RelayBlockFinalityMessage(const CBlockFinalityMessage& msg) ;
+
+// check a certificate and return the messages of its signers
+bool CheckPBFTCertificate(const CPBFTCertificate& cert, vector<CBlockConfirmMessage>& messages) ;
+bool CheckPBFTCertificate(const CPBFTCertificate& cert, vector<CBlockFinalityMessage>& messages) ;
+
+// relay the certificate of the block once, made of its collected messages when cert is null
+bool RelayPBFTCertificate(const int32_t msgType, const uint256& blockHash, const CPBFTCertificate* cert = nullptr) ;
+// queue a message received for its check on the thread of ThreadPBFTMessageHandler
+bool EnqueuePBFTMessage(const CBlockConfirmMessage& msg) ;
+bool EnqueuePBFTMessage(const CBlockFinalityMessage& msg) ;
+bool EnqueuePBFTMessage(const CPBFTCertificate& cert) ;
+
+/**
+ * Check, save and relay the queued PBFT messages and update the finality blocks. The signers are checked with the
+ * keys published in pbftContext by block, so the thread does not wait for cs_main behind the blocks being validated.
+ */
+void ThreadPBFTMessageHandler() ;
+
 #endif //MINER_PBFTMANAGER_H
@@ -12,9 +12,11 @@
 #include "config/chainparams.h"
 #include "net.h"
 #include "nodeinfo.h"
+#include "miner/pbftmanager.h"
 #include "tx/tx.h"
 #include "commons/util/time.h"
 #include "p2p/node.h"
+#include "p2p/socketevents.h"
 
 #ifdef WIN32
 #include <string.h>
@@ -36,6 +38,7 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <thread>
 
 #include <boost/filesystem.hpp>
@@ -51,6 +54,8 @@ using namespace std;
 using namespace boost;
 
 static const int32_t MAX_OUTBOUND_CONNECTIONS = 8;
+// the seconds between the attempts to reconnect the -prioritypeer peers
+static const int32_t PRIORITY_PEER_RETRY_INTERVAL = 5;
 
 bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant* grantOutbound = nullptr,
                            const char* strDest = nullptr, bool fOneShot = false);
@@ -78,10 +83,14 @@ CNodeSignals& GetNodeSignals() { return g_node_signals; }
 
 vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
-map<CInv, CDataStream> mapRelay;
+map<CInv, CSharedNetMsg> mapRelay;
 deque<pair<int64_t, CInv> > vRelayExpiration;
 CCriticalSection cs_mapRelay;
 
+// the newest last, searched linearly as there are a few
+static deque<std::tuple<string, uint256, CSharedNetMsg>> vRelayBlockMsgs;
+static CCriticalSection cs_vRelayBlockMsgs;
+
 
 static deque<string> vOneShots;
 CCriticalSection cs_vOneShots;
@@ -92,6 +101,9 @@ CCriticalSection cs_setservAddNodeAddresses;
 vector<string> vAddedNodes;
 CCriticalSection cs_vAddedNodes;
 
+// the -prioritypeer addresses, set before the net threads start
+static vector<CService> vPriorityPeers;
+
 static CSemaphore* semOutbound = nullptr;
 
 void AddOneShot(string strDest) {
@@ -423,6 +435,22 @@ CNode* FindNode(const CService& addr) {
     return nullptr;
 }
 
+// the peers of the links between the delegates, they connect to us with any port
+static bool IsPriorityPeer(const CNetAddr& addr) {
+    for (const auto& peer : vPriorityPeers) {
+        if ((CNetAddr)peer == addr)
+            return true;
+    }
+    return false;
+}
+
+static void SetPriorityNode(CNode* pNode) {
+    pNode->fPriority = true;
+    if (!SetSocketNoDelay(pNode->hSocket))
+        LogPrint(BCLog::INFO, "%s : setting TCP_NODELAY for %s failed, error %s\n", __func__, pNode->addr.ToString(),
+                 NetworkErrorString(WSAGetLastError()));
+}
+
 CNode* ConnectNode(CAddress addrConnect, const char* pszDest) {
     if (pszDest == nullptr) {
         if (IsLocal(addrConnect))
@@ -462,6 +490,8 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest) {
         // Add node
         CNode* pNode = new CNode(hSocket, addrConnect, pszDest ? pszDest : "", false);
         pNode->AddRef();
+        if (IsPriorityPeer(addrConnect))
+            SetPriorityNode(pNode);
 
         {
             LOCK(cs_vNodes);
@@ -480,6 +510,8 @@ static list<CNode*> vNodesDisconnected;
 
 void ThreadSocketHandler() {
     uint32_t nPrevNodeCount = 0;
+    std::unique_ptr<CSocketEvents> pEvents = CSocketEvents::Create();
+    LogPrint(BCLog::NET, "socket handler waits for socket events with %s\n", CSocketEvents::GetBackendName());
     while (true) {
         //
         // Disconnect nodes
@@ -542,24 +574,11 @@ void ThreadSocketHandler() {
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000;  // frequency to poll pNode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds     = false;
-
-        for (auto hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket);
-            have_fds   = true;
-        }
+        static const int64_t nWaitTimeoutMs = 50;  // frequency to poll pNode->vSend
+
+        int64_t nListenOwner = -1;  // listen sockets own negative ids, the nodes their ids
+        for (auto hListenSocket : vhListenSocket)
+            pEvents->Add(hListenSocket, CSocketEvents::EVENT_RECV, nListenOwner--);
 
         {
             LOCK(cs_vNodes);
@@ -567,18 +586,14 @@ void ThreadSocketHandler() {
                 if (pNode->hSocket == INVALID_SOCKET)
                     continue;
 
-                FD_SET(pNode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pNode->hSocket);
-                have_fds   = true;
-
                 // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
+                // * If there is data to send, wait for sending data. As this only
                 //   happens when optimistic write failed, we choose to first drain the
                 //   write buffer in this case before receiving more. This avoids
                 //   needlessly queueing received data, if the remote peer is not themselves
                 //   receiving data. This means properly utilizing TCP flow control signalling.
                 // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
+                //   or there is space left in the buffer, wait for receiving data.
                 // * (if neither of the above applies, there is certainly one message
                 //   in the receiver buffer ready to be processed).
                 // Together, that means that at least one of the following is always possible,
@@ -586,42 +601,30 @@ void ThreadSocketHandler() {
                 // * We send some data.
                 // * We wait for data to be received (and disconnect after timeout).
                 // * We process a message in the buffer (message handler thread).
+                uint8_t events = CSocketEvents::EVENT_ERROR;
                 {
                     TRY_LOCK(pNode->cs_vSend, lockSend);
-                    if (lockSend && !pNode->vSendMsg.empty()) {
-                        FD_SET(pNode->hSocket, &fdsetSend);
-                        continue;
-                    }
+                    if (lockSend && !pNode->vSendMsg.empty())
+                        events |= CSocketEvents::EVENT_SEND;
                 }
-                {
+                if (!(events & CSocketEvents::EVENT_SEND)) {
                     TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
                     if (lockRecv && (pNode->vRecvMsg.empty() || !pNode->vRecvMsg.front().complete() ||
                                      pNode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pNode->hSocket, &fdsetRecv);
+                        events |= CSocketEvents::EVENT_RECV;
                 }
+                pEvents->Add(pNode->hSocket, events, pNode->GetId());
             }
         }
 
-        int32_t nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        pEvents->Wait(nWaitTimeoutMs);
         boost::this_thread::interruption_point();
 
-        if (nSelect == SOCKET_ERROR) {
-            if (have_fds) {
-                int32_t nErr = WSAGetLastError();
-                LogPrint(BCLog::INFO, "socket select error %s\n", NetworkErrorString(nErr));
-                for (uint32_t i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec / 1000);
-        }
-
         //
         // Accept new connections
         //
         for (auto hListenSocket : vhListenSocket)
-            if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv)) {
+            if (hListenSocket != INVALID_SOCKET && (pEvents->GetReady(hListenSocket) & CSocketEvents::EVENT_RECV)) {
                 struct sockaddr_storage sockaddr;
                 socklen_t len  = sizeof(sockaddr);
                 SOCKET hSocket = accept(hListenSocket, (struct sockaddr*)&sockaddr, &len);
@@ -643,7 +646,7 @@ void ThreadSocketHandler() {
                     int32_t nErr = WSAGetLastError();
                     if (nErr != WSAEWOULDBLOCK)
                         LogPrint(BCLog::INFO, "socket[%s] error accept failed: %s\n", addr.ToString(), NetworkErrorString(nErr));
-                } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
+                } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS && !IsPriorityPeer(addr)) {
                     closesocket(hSocket);
                 } else if (CNode::IsBanned(addr)) {
                     LogPrint(BCLog::INFO, "connection from %s dropped (banned)\n", addr.ToString());
@@ -652,6 +655,8 @@ void ThreadSocketHandler() {
                     LogPrint(BCLog::NET, "accepted connection %s\n", addr.ToString());
                     CNode* pNode = new CNode(hSocket, addr, "", true);
                     pNode->AddRef();
+                    if (IsPriorityPeer(addr))
+                        SetPriorityNode(pNode);
                     {
                         LOCK(cs_vNodes);
                         vNodes.push_back(pNode);
@@ -677,15 +682,26 @@ void ThreadSocketHandler() {
             //
             if (pNode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pNode->hSocket, &fdsetRecv) || FD_ISSET(pNode->hSocket, &fdsetError)) {
+            uint8_t ready = pEvents->GetReady(pNode->hSocket);
+            if (ready & (CSocketEvents::EVENT_RECV | CSocketEvents::EVENT_ERROR)) {
                 TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
                 if (lockRecv) {
                     {
-                        // typical socket buffer is 8K-64K
+                        // typical socket buffer is 8K-64K. The data of a message whose header is in goes straight
+                        // into the message buffer, the headers and the small messages through the stack buffer.
                         char pchBuf[0x10000];
-                        int32_t nBytes = recv(pNode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+                        uint32_t nSpace = 0;
+                        char* pchDest   = pNode->GetRecvDataSpace(4 * sizeof(pchBuf), nSpace);
+                        bool fDirect    = pchDest != nullptr && nSpace >= sizeof(pchBuf) / 4;
+                        if (!fDirect) {
+                            pchDest = pchBuf;
+                            nSpace  = sizeof(pchBuf);
+                        }
+                        int32_t nBytes = recv(pNode->hSocket, pchDest, nSpace, MSG_DONTWAIT);
                         if (nBytes > 0) {
-                            if (!pNode->ReceiveMsgBytes(pchBuf, nBytes))
+                            if (fDirect)
+                                pNode->ReceiveDataBytes(nBytes);
+                            else if (!pNode->ReceiveMsgBytes(pchBuf, nBytes))
                                 pNode->CloseSocketDisconnect();
                             pNode->nLastRecv = GetTime();
                             pNode->nRecvBytes += nBytes;
@@ -714,7 +730,7 @@ void ThreadSocketHandler() {
             //
             if (pNode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pNode->hSocket, &fdsetSend)) {
+            if (ready & CSocketEvents::EVENT_SEND) {
                 TRY_LOCK(pNode->cs_vSend, lockSend);
                 if (lockSend)
                     pNode->SocketSendData();
@@ -886,6 +902,44 @@ void MapPort(bool) {
 }
 #endif
 
+// the threads work on the stack of the caller, they are joined before an interruption leaves it
+static void JoinThreads(boost::thread_group& threads) {
+    try {
+        threads.join_all();
+    } catch (boost::thread_interrupted&) {
+        threads.interrupt_all();
+        threads.join_all();
+        throw;
+    }
+}
+
+// take one more of the free outbound slots, false if there is none
+static bool TryAcquireGrant(list<CSemaphoreGrant>& grants) {
+    grants.emplace_back(*semOutbound, true);
+    if (grants.back())
+        return true;
+
+    grants.pop_back();
+    return false;
+}
+
+// connect the addresses at once, each with the grant in the same place, so no slot waits out the connect
+// timeout of a dead address before the next one is tried
+static void OpenNetworkConnections(const vector<CAddress>& vAddrConnect, list<CSemaphoreGrant>& grants) {
+    if (vAddrConnect.size() == 1) {
+        OpenNetworkConnection(vAddrConnect[0], &grants.front());
+        return;
+    }
+
+    boost::thread_group connectThreads;
+    auto itGrant = grants.begin();
+    for (const auto& addrConnect : vAddrConnect) {
+        CSemaphoreGrant* pGrant = &*itGrant++;
+        connectThreads.create_thread([addrConnect, pGrant]() { OpenNetworkConnection(addrConnect, pGrant); });
+    }
+    JoinThreads(connectThreads);
+}
+
 void ThreadDNSAddressSeed() {
     // goal: only query DNS seeds if address need is acute
     if ((addrman.size() > 0) && (!SysCfg().GetBoolArg("-forcednsseed", false))) {
@@ -903,24 +957,33 @@ void ThreadDNSAddressSeed() {
 
     LogPrint(BCLog::INFO, "Loading addresses from DNS seeds (could take a while)\n");
 
-    for (const auto& seed : vSeeds) {
-        if (HaveNameProxy()) {
+    if (HaveNameProxy()) {
+        for (const auto& seed : vSeeds)
             AddOneShot(seed.host);
-        } else {
-            vector<CNetAddr> vIPs;
-            vector<CAddress> vAdd;
-            if (LookupHost(seed.host.c_str(), vIPs)) {
-                for (auto& ip : vIPs) {
-                    int32_t nOneDay   = 24 * 3600;
-                    CAddress addr = CAddress(CService(ip, SysCfg().GetDefaultPort()));
-                    addr.nTime =
-                        GetTime() - 3 * nOneDay - GetRand(4 * nOneDay);  // use a random age between 3 and 7 days old
-                    vAdd.push_back(addr);
-                    found++;
-                }
-            }
-            addrman.Add(vAdd, CNetAddr(seed.name, true));
+        return;
+    }
+
+    // the seeds are looked up at once, so the seeding takes the time of the slowest one rather than of all
+    vector<vector<CNetAddr> > vSeedIPs(vSeeds.size());
+    boost::thread_group lookupThreads;
+    for (size_t i = 0; i < vSeeds.size(); i++) {
+        const char* pszHost      = vSeeds[i].host.c_str();
+        vector<CNetAddr>* pvIPs = &vSeedIPs[i];
+        lookupThreads.create_thread([pszHost, pvIPs]() { LookupHost(pszHost, *pvIPs); });
+    }
+    JoinThreads(lookupThreads);
+
+    for (size_t i = 0; i < vSeeds.size(); i++) {
+        vector<CAddress> vAdd;
+        for (auto& ip : vSeedIPs[i]) {
+            int32_t nOneDay   = 24 * 3600;
+            CAddress addr = CAddress(CService(ip, SysCfg().GetDefaultPort()));
+            addr.nTime =
+                GetTime() - 3 * nOneDay - GetRand(4 * nOneDay);  // use a random age between 3 and 7 days old
+            vAdd.push_back(addr);
+            found++;
         }
+        addrman.Add(vAdd, CNetAddr(vSeeds[i].name, true));
     }
 
     LogPrint(BCLog::INFO, "%d addresses found from DNS seeds\n", found);
@@ -952,6 +1015,44 @@ void static ProcessOneShot() {
     }
 }
 
+static CAddress SelectAddressToConnect(const set<vector<uint8_t> >& setConnected, int32_t nOutbound) {
+    CAddress addrConnect;
+    int64_t nANow = GetAdjustedTime();
+
+    int32_t nTries = 0;
+    while (true) {
+        // use an nUnkBias between 10 (no outgoing connections) and 90 (8 outgoing connections)
+        CAddress addr = addrman.Select(10 + min(nOutbound, 8) * 10);
+
+        // if we selected an invalid address, restart
+        if (!addr.IsValid() || (setConnected.count(addr.GetGroup()) && !SysCfg().IsInFixedSeeds(addr)) ||
+            IsLocal(addr))
+            break;
+
+        // If we didn't find an appropriate destination after trying 100 addresses fetched from addrman,
+        // stop this loop, and let the outer loop run again (which sleeps, adds seed nodes, recalculates
+        // already-connected network ranges, ...) before trying new addrman addresses.
+        nTries++;
+        if (nTries > 100)
+            break;
+
+        if (IsLimited(addr))
+            continue;
+
+        // only consider very recently tried nodes after 30 failed attempts
+        if (nANow - addr.nLastTry < 600 && nTries < 30)
+            continue;
+
+        // do not allow non-default ports, unless after 50 invalid addresses selected already
+        if (addr.GetPort() != SysCfg().GetDefaultPort() && nTries < 50)
+            continue;
+
+        addrConnect = addr;
+        break;
+    }
+    return addrConnect;
+}
+
 void ThreadOpenConnections() {
     // Connect to specific addresses
     if (SysCfg().IsArgCount("-connect") && SysCfg().GetMultiArgs("-connect").size() > 0) {
@@ -976,7 +1077,8 @@ void ThreadOpenConnections() {
 
         MilliSleep(500);
 
-        CSemaphoreGrant grant(*semOutbound);
+        list<CSemaphoreGrant> grants;
+        grants.emplace_back(*semOutbound);
         boost::this_thread::interruption_point();
 
         // Add seed nodes if DNS seeds are all down (an infrastructure attack?).
@@ -989,11 +1091,6 @@ void ThreadOpenConnections() {
             }
         }
 
-        //
-        // Choose an address to connect to based on most recently seen
-        //
-        CAddress addrConnect;
-
         // Only connect out to one peer per network group (/16 for IPv4).
         // Do this here so we don't have to critsect vNodes inside mapAddresses critsect.
         int32_t nOutbound = 0;
@@ -1008,42 +1105,22 @@ void ThreadOpenConnections() {
             }
         }
 
-        int64_t nANow = GetAdjustedTime();
-
-        int32_t nTries = 0;
-        while (true) {
-            // use an nUnkBias between 10 (no outgoing connections) and 90 (8 outgoing connections)
-            CAddress addr = addrman.Select(10 + min(nOutbound, 8) * 10);
-
-            // if we selected an invalid address, restart
-            if (!addr.IsValid() || (setConnected.count(addr.GetGroup()) && !SysCfg().IsInFixedSeeds(addr)) ||
-                IsLocal(addr))
-                break;
-
-            // If we didn't find an appropriate destination after trying 100 addresses fetched from addrman,
-            // stop this loop, and let the outer loop run again (which sleeps, adds seed nodes, recalculates
-            // already-connected network ranges, ...) before trying new addrman addresses.
-            nTries++;
-            if (nTries > 100)
+        //
+        // Choose an address to connect to based on most recently seen, one for each free outbound slot
+        //
+        vector<CAddress> vAddrConnect;
+        do {
+            CAddress addrConnect = SelectAddressToConnect(setConnected, nOutbound + vAddrConnect.size());
+            if (!addrConnect.IsValid() ||
+                find(vAddrConnect.begin(), vAddrConnect.end(), addrConnect) != vAddrConnect.end())
                 break;
 
-            if (IsLimited(addr))
-                continue;
-
-            // only consider very recently tried nodes after 30 failed attempts
-            if (nANow - addr.nLastTry < 600 && nTries < 30)
-                continue;
-
-            // do not allow non-default ports, unless after 50 invalid addresses selected already
-            if (addr.GetPort() != SysCfg().GetDefaultPort() && nTries < 50)
-                continue;
-
-            addrConnect = addr;
-            break;
-        }
+            vAddrConnect.push_back(addrConnect);
+            setConnected.insert(addrConnect.GetGroup());
+        } while (TryAcquireGrant(grants));
 
-        if (addrConnect.IsValid())
-            OpenNetworkConnection(addrConnect, &grant);
+        if (!vAddrConnect.empty())
+            OpenNetworkConnections(vAddrConnect, grants);
     }
 }
 
@@ -1105,15 +1182,42 @@ void ThreadOpenAddedConnections() {
                             break;
                         }
         }
-        for (auto& vserv : lservAddressesToAdd) {
-            CSemaphoreGrant grant(*semOutbound);
-            OpenNetworkConnection(CAddress(vserv[i % vserv.size()]), &grant);
+        // the entries are connected at once, as many as the outbound slots free
+        auto it = lservAddressesToAdd.begin();
+        while (it != lservAddressesToAdd.end()) {
+            vector<CAddress> vAddrConnect;
+            list<CSemaphoreGrant> grants;
+            grants.emplace_back(*semOutbound);
+            do {
+                vAddrConnect.push_back(CAddress((*it)[i % it->size()]));
+                ++it;
+            } while (it != lservAddressesToAdd.end() && TryAcquireGrant(grants));
+
+            OpenNetworkConnections(vAddrConnect, grants);
             MilliSleep(500);
         }
         MilliSleep(120000);  // Retry every 2 minutes
     }
 }
 
+// keep a connection to each -prioritypeer, without taking the outbound slots
+void ThreadOpenPriorityConnections() {
+    while (true) {
+        vector<CAddress> vAddrConnect;
+        for (const auto& peer : vPriorityPeers) {
+            if (!FindNode((CNetAddr)peer))
+                vAddrConnect.push_back(CAddress(peer));
+        }
+
+        boost::thread_group connectThreads;
+        for (const auto& addrConnect : vAddrConnect)
+            connectThreads.create_thread([addrConnect]() { OpenNetworkConnection(addrConnect); });
+        JoinThreads(connectThreads);
+
+        MilliSleep(PRIORITY_PEER_RETRY_INTERVAL * 1000);
+    }
+}
+
 // if successful, this moves the passed grant to the constructed node
 bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant* grantOutbound, const char* strDest,
                            bool fOneShot) {
@@ -1171,7 +1275,9 @@ void static StartSync(const vector<CNode*>& vNodes) {
     }
 }
 
-void ThreadMessageHandler() {
+// Handler nIndex of nHandlers serves the nodes whose id is nIndex modulo nHandlers, so that the messages of
+// a node are processed in order on one thread while a node slow to serve holds up its share of nodes only.
+void ThreadMessageHandler(int32_t nIndex, int32_t nHandlers) {
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true) {
         bool fHaveSyncNode = false;
@@ -1187,17 +1293,26 @@ void ThreadMessageHandler() {
             }
         }
 
-        if (!fHaveSyncNode)
+        if (nIndex == 0 && !fHaveSyncNode)
             StartSync(vNodesCopy);
 
+        vector<CNode*> vNodesServed;
+        vNodesServed.reserve(vNodesCopy.size() / nHandlers + 1);
+        for (auto pNode : vNodesCopy) {
+            if (pNode->GetId() % nHandlers == nIndex)
+                vNodesServed.push_back(pNode);
+        }
+        // the block and pbft messages of the priority peers are handled before the relay of the others
+        stable_partition(vNodesServed.begin(), vNodesServed.end(), [](CNode* pNode) { return pNode->fPriority; });
+
         // Poll the connected nodes for messages
         CNode* pnodeTrickle = nullptr;
-        if (!vNodesCopy.empty())
-            pnodeTrickle = vNodesCopy[GetRand(vNodesCopy.size())];
+        if (!vNodesServed.empty())
+            pnodeTrickle = vNodesServed[GetRand(vNodesServed.size())];
 
         bool fSleep = true;
 
-        for (auto pNode : vNodesCopy) {
+        for (auto pNode : vNodesServed) {
             if (pNode->fDisconnect)
                 continue;
 
@@ -1239,6 +1354,11 @@ void ThreadMessageHandler() {
     }
 }
 
+int64_t PoissonNextSend(int64_t nNow, int64_t nAverageIntervalMicros) {
+    return nNow + (int64_t)(log1p(GetRand(1ULL << 48) * -0.0000000000000035527136788 /* -1/2^48 */) *
+                            nAverageIntervalMicros * -1.0 + 0.5);
+}
+
 bool BindListenPort(const CService& addrBind, string& strError) {
     strError = "";
     int32_t nOne = 1;
@@ -1410,6 +1530,18 @@ void StartNode(boost::thread_group& threadGroup) {
     // Send and receive from sockets, accept connections
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "net", &ThreadSocketHandler));
 
+    // Initiate outbound connections to -prioritypeer
+    for (const auto& strPeer : SysCfg().GetMultiArgs("-prioritypeer")) {
+        CService peer;
+        if (Lookup(strPeer.c_str(), peer, SysCfg().GetDefaultPort(), fNameLookup))
+            vPriorityPeers.push_back(peer);
+        else
+            LogPrint(BCLog::ERROR, "Cannot resolve -prioritypeer address: '%s'\n", strPeer);
+    }
+    if (!vPriorityPeers.empty())
+        threadGroup.create_thread(
+            boost::bind(&TraceThread<void (*)()>, "prioritycon", &ThreadOpenPriorityConnections));
+
     // Initiate outbound connections from -addnode
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "addcon", &ThreadOpenAddedConnections));
 
@@ -1417,7 +1549,15 @@ void StartNode(boost::thread_group& threadGroup) {
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
     // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    int32_t nHandlers = SysCfg().GetArg("-msghandlers", DEFAULT_MESSAGE_HANDLER_THREADS);
+    nHandlers = max(1, min(nHandlers, min<int32_t>(MAX_MESSAGE_HANDLER_THREADS, std::thread::hardware_concurrency())));
+    for (int32_t i = 0; i < nHandlers; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()>>, "msghand",
+                                              boost::function<void()>(boost::bind(&ThreadMessageHandler, i, nHandlers))));
+    LogPrint(BCLog::INFO, "started %d message handler threads\n", nHandlers);
+
+    // Check the PBFT messages apart from the blocks and txs
+    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "pbfthand", &ThreadPBFTMessageHandler));
 
     // Dump network addresses
     threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "dumpaddr", &DumpAddresses, DUMP_ADDRESSES_INTERVAL * 1000));
@@ -1472,28 +1612,22 @@ public:
 
 instance_of_cnetcleanup;
 
+static void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CSharedNetMsg& spMsg);
+
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash) {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(1000);
-    auto pTx = pBaseTx->GetNewInstance();
-    ss << pTx;
-    RelayTransaction(pBaseTx, hash, ss);
+    // serialized through a shared_ptr not owning the tx, rather than through a copy of it
+    RelayTransaction(pBaseTx, hash, MakeSharedNetMsg(NetMsgType::TX, std::shared_ptr<CBaseTx>(std::shared_ptr<CBaseTx>(), pBaseTx)));
 }
 
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss) {
+    // Save original serialized message so newer versions are preserved
+    RelayTransaction(pBaseTx, hash, MakeSharedNetMsg(NetMsgType::TX, ss));
+}
+
+static void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CSharedNetMsg& spMsg) {
     CInv inv(MSG_TX, hash);
-    {
-        LOCK(cs_mapRelay);
-        // Expire old relay messages
-        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime()) {
-            mapRelay.erase(vRelayExpiration.front().second);
-            vRelayExpiration.pop_front();
-        }
+    AddRelayMessage(inv, spMsg);
 
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(make_pair(inv, ss));
-        vRelayExpiration.push_back(make_pair(GetTime() + 15 * 60, inv));
-    }
     LOCK(cs_vNodes);
     for (auto pNode : vNodes) {
         if (!pNode->fRelayTxes)
@@ -1511,6 +1645,38 @@ void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream&
     }
 }
 
+void AddRelayMessage(const CInv& inv, const CSharedNetMsg& spMsg) {
+    LOCK(cs_mapRelay);
+    // Expire old relay messages
+    while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime()) {
+        mapRelay.erase(vRelayExpiration.front().second);
+        vRelayExpiration.pop_front();
+    }
+
+    if (mapRelay.insert(make_pair(inv, spMsg)).second)
+        vRelayExpiration.push_back(make_pair(GetTime() + 15 * 60, inv));
+}
+
+CSharedNetMsg FindBlockMessage(const string& command, const uint256& blockHash) {
+    LOCK(cs_vRelayBlockMsgs);
+    for (const auto& item : vRelayBlockMsgs) {
+        if (std::get<1>(item) == blockHash && std::get<0>(item) == command)
+            return std::get<2>(item);
+    }
+    return nullptr;
+}
+
+void AddBlockMessage(const string& command, const uint256& blockHash, const CSharedNetMsg& spMsg) {
+    LOCK(cs_vRelayBlockMsgs);
+    for (const auto& item : vRelayBlockMsgs) {
+        if (std::get<1>(item) == blockHash && std::get<0>(item) == command)
+            return;
+    }
+    vRelayBlockMsgs.emplace_back(command, blockHash, spMsg);
+    while (vRelayBlockMsgs.size() > MAX_RELAY_BLOCK_MESSAGES)
+        vRelayBlockMsgs.pop_front();
+}
+
 //
 // CAddrDB
 //
@@ -11,6 +11,7 @@
 #include "crypto/hash.h"
 #include "sync.h"
 #include "netbase.h"
+#include "p2p/netmessage.h"
 
 
 #include <stdint.h>
@@ -51,6 +52,8 @@ uint16_t GetListenPort();
 bool BindListenPort(const CService& bindAddr, string& strError = REF(string()));
 void StartNode(boost::thread_group& threadGroup);
 bool StopNode();
+// Time of the next event of a poisson process of average interval nAverageIntervalMicros
+int64_t PoissonNextSend(int64_t nNow, int64_t nAverageIntervalMicros);
 
 enum {
     LOCAL_NONE,    // unknown
@@ -80,7 +83,7 @@ extern CAddrMan addrman;
 extern int32_t nMaxConnections;
 extern vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
-extern map<CInv, CDataStream> mapRelay;
+extern map<CInv, CSharedNetMsg> mapRelay;
 extern deque<pair<int64_t, CInv> > vRelayExpiration;
 extern CCriticalSection cs_mapRelay;
 extern vector<string> vAddedNodes;
@@ -89,6 +92,14 @@ extern map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash);
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss);
+// keep the tx message for the getdata of the peers in mapRelay
+void AddRelayMessage(const CInv& inv, const CSharedNetMsg& spMsg);
+
+/** The BLOCK and CMPCTBLOCK messages of the last blocks relayed, shared by the peers asking for them */
+static const size_t MAX_RELAY_BLOCK_MESSAGES = 8;
+// null if not cached
+CSharedNetMsg FindBlockMessage(const string& command, const uint256& blockHash);
+void AddBlockMessage(const string& command, const uint256& blockHash, const CSharedNetMsg& spMsg);
 
 /** Access to the (IP) address database (peers.dat) */
 class CAddrDB {
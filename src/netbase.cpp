@@ -1148,6 +1148,15 @@ bool operator<(const CSubNet& a, const CSubNet& b) {
     return (a.network < b.network || (a.network == b.network && memcmp(a.netmask, b.netmask, 16) < 0));
 }
 
+bool SetSocketNoDelay(SOCKET hSocket) {
+    int32_t nOne = 1;
+#ifdef WIN32
+    return setsockopt(hSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&nOne, sizeof(nOne)) != SOCKET_ERROR;
+#else
+    return setsockopt(hSocket, IPPROTO_TCP, TCP_NODELAY, (void*)&nOne, sizeof(nOne)) != SOCKET_ERROR;
+#endif
+}
+
 #ifdef WIN32
 string NetworkErrorString(int32_t err) {
     char buf[256];
@@ -176,6 +176,8 @@ bool LookupSubNet(const char* pszName, CSubNet& subnet);
 bool ConnectSocket(const CService& addr, SOCKET& hSocketRet, int nTimeout = GetConnectTime());
 bool ConnectSocketByName(CService& addr, SOCKET& hSocketRet, const char* pszDest, int portDefault = 0,
                          int nTimeout = GetConnectTime());
+/** Send the small writes at once rather than coalescing them (Nagle), for the latency sensitive peers */
+bool SetSocketNoDelay(SOCKET hSocket);
 /** Return readable error string for a network error code */
 std::string NetworkErrorString(int err);
 
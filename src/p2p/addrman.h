@@ -9,15 +9,14 @@
 #include "netbase.h"
 #include "p2p/protocol.h"
 #include "sync.h"
+#include "commons/uint256.h"
 #include "commons/util/util.h"
 
 #include <map>
-#include <set>
 #include <stdint.h>
+#include <unordered_map>
 #include <vector>
 
-#include <openssl/rand.h>
-
 /** Extended statistics about a CAddress */
 class CAddrInfo : public CAddress
 {
@@ -76,17 +75,20 @@ public:
     }
 
     // Calculate in which "tried" bucket this entry belongs
-    int GetTriedBucket(const std::vector<unsigned char> &nKey) const;
+    int GetTriedBucket(const uint256 &nKey) const;
 
     // Calculate in which "new" bucket this entry belongs, given a certain source
-    int GetNewBucket(const std::vector<unsigned char> &nKey, const CNetAddr& src) const;
+    int GetNewBucket(const uint256 &nKey, const CNetAddr& src) const;
 
     // Calculate in which "new" bucket this entry belongs, using its default source
-    int GetNewBucket(const std::vector<unsigned char> &nKey) const
+    int GetNewBucket(const uint256 &nKey) const
     {
         return GetNewBucket(nKey, source);
     }
 
+    // Calculate in which position of a bucket to store this entry
+    int GetBucketPosition(const uint256 &nKey, bool fNew, int nBucket) const;
+
     // Determine whether the statistics about this entry are bad enough so that it can just be deleted
     bool IsTerrible(int64_t nNow = GetAdjustedTime()) const;
 
@@ -103,47 +105,41 @@ public:
 //  * Make sure no (localized) attacker can fill the entire table with his nodes/addresses.
 //
 // To that end:
-//  * Addresses are organized into buckets.
-//    * Address that have not yet been tried go into 256 "new" buckets.
-//      * Based on the address range (/16 for IPv4) of source of the information, 32 buckets are selected at random
+//  * Addresses are organized into buckets, flat arrays of ADDRMAN_BUCKET_SIZE positions.
+//    * Address that have not yet been tried go into 1024 "new" buckets.
+//      * Based on the address range (/16 for IPv4) of source of the information, 64 buckets are selected at random
 //      * The actual bucket is chosen from one of these, based on the range the address itself is located.
-//      * One single address can occur in up to 4 different buckets, to increase selection chances for addresses that
+//      * One single address can occur in up to 8 different buckets, to increase selection chances for addresses that
 //        are seen frequently. The chance for increasing this multiplicity decreases exponentially.
-//      * When adding a new address to a full bucket, a randomly chosen entry (with a bias favoring less recently seen
-//        ones) is removed from it first.
-//    * Addresses of nodes that are known to be accessible go into 64 "tried" buckets.
-//      * Each address range selects at random 4 of these buckets.
+//      * The position in the bucket is chosen based on the full address. When adding a new address to an occupied
+//        position, the entry there is only replaced if it is terrible or referenced from other buckets too.
+//    * Addresses of nodes that are known to be accessible go into 256 "tried" buckets.
+//      * Each address range selects at random 8 of these buckets.
 //      * The actual bucket is chosen from one of these, based on the full address.
-//      * When adding a new good address to a full bucket, a randomly chosen entry (with a bias favoring less recently
-//        tried ones) is evicted from it, back to the "new" buckets.
-//    * Bucket selection is based on cryptographic hashing, using a randomly-generated 256-bit key, which should not
-//      be observable by adversaries.
+//      * When adding a new good address to an occupied position, the entry there is evicted from it, back to the
+//        "new" buckets.
+//    * Bucket and position selection is based on cryptographic hashing, using a randomly-generated 256-bit key,
+//      which should not be observable by adversaries.
 //    * Several indexes are kept for high performance. Defining DEBUG_ADDRMAN will introduce frequent (and expensive)
 //      consistency checks for the entire data structure.
 
 // total number of buckets for tried addresses
-#define ADDRMAN_TRIED_BUCKET_COUNT 64
-
-// maximum allowed number of entries in buckets for tried addresses
-#define ADDRMAN_TRIED_BUCKET_SIZE 64
+#define ADDRMAN_TRIED_BUCKET_COUNT 256
 
 // total number of buckets for new addresses
-#define ADDRMAN_NEW_BUCKET_COUNT 256
+#define ADDRMAN_NEW_BUCKET_COUNT 1024
 
-// maximum allowed number of entries in buckets for new addresses
-#define ADDRMAN_NEW_BUCKET_SIZE 64
+// maximum allowed number of entries in buckets for new and tried addresses
+#define ADDRMAN_BUCKET_SIZE 64
 
 // over how many buckets entries with tried addresses from a single group (/16 for IPv4) are spread
-#define ADDRMAN_TRIED_BUCKETS_PER_GROUP 4
+#define ADDRMAN_TRIED_BUCKETS_PER_GROUP 8
 
 // over how many buckets entries with new addresses originating from a single group are spread
-#define ADDRMAN_NEW_BUCKETS_PER_SOURCE_GROUP 32
+#define ADDRMAN_NEW_BUCKETS_PER_SOURCE_GROUP 64
 
 // in how many buckets for entries with new addresses a single address may occur
-#define ADDRMAN_NEW_BUCKETS_PER_ADDRESS 4
-
-// how many entries in a bucket with tried addresses are inspected, when selecting one to replace
-#define ADDRMAN_TRIED_ENTRIES_INSPECT_ON_EVICT 4
+#define ADDRMAN_NEW_BUCKETS_PER_ADDRESS 8
 
 // how old addresses can maximally be
 #define ADDRMAN_HORIZON_DAYS 30
@@ -171,13 +167,13 @@ private:
     mutable CCriticalSection cs;
 
     // secret key to randomize bucket select with
-    std::vector<unsigned char> nKey;
+    uint256 nKey;
 
     // last used nId
     int nIdCount;
 
     // table with information about all nIds
-    std::map<int, CAddrInfo> mapInfo;
+    std::unordered_map<int, CAddrInfo> mapInfo;
 
     // find an nId based on its network address
     std::map<CNetAddr, int> mapAddr;
@@ -188,14 +184,14 @@ private:
     // number of "tried" entries
     int nTried;
 
-    // list of "tried" buckets
-    std::vector<std::vector<int> > vvTried;
+    // the "tried" buckets, -1 for an empty position
+    int vvTried[ADDRMAN_TRIED_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
 
     // number of (unique) "new" entries
     int nNew;
 
-    // list of "new" buckets
-    std::vector<std::set<int> > vvNew;
+    // the "new" buckets, -1 for an empty position
+    int vvNew[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
 
 protected:
 
@@ -209,17 +205,16 @@ protected:
     // Swap two elements in vRandom.
     void SwapRandom(unsigned int nRandomPos1, unsigned int nRandomPos2);
 
-    // Return position in given bucket to replace.
-    int SelectTried(int nKBucket);
-
-    // Remove an element from a "new" bucket.
+    // Delete an entry. It must not be in tried, and have refcount 0.
     // This is the only place where actual deletes occur.
     // They are never deleted while in the "tried" table, only possibly evicted back to the "new" table.
-    int ShrinkNew(int nUBucket);
+    void Delete(int nId);
+
+    // Clear a position in a "new" bucket, deleting the entry there if it is not referenced anymore.
+    void ClearNew(int nUBucket, int nUBucketPos);
 
     // Move an entry from the "new" table(s) to the "tried" table
-    // @pre vvUnkown[nOrigin].count(nId) != 0
-    void MakeTried(CAddrInfo& info, int nId, int nOrigin);
+    void MakeTried(CAddrInfo& info, int nId);
 
     // Mark an entry "good", possibly moving it from "new" to "tried".
     void Good_(const CService &addr, int64_t nTime);
@@ -247,148 +242,231 @@ protected:
 
 public:
 
-    IMPLEMENT_SERIALIZE
-    (({
-        // serialized format:
-        // * version byte (currently 0)
-        // * nKey
-        // * nNew
-        // * nTried
-        // * number of "new" buckets
-        // * all nNew addrinfos in vvNew
-        // * all nTried addrinfos in vvTried
-        // * for each bucket:
-        //   * number of elements
-        //   * for each element: index
-        //
-        // Notice that vvTried, mapAddr and vVector are never encoded explicitly;
-        // they are instead reconstructed from the other information.
-        //
-        // vvNew is serialized, but only used if ADDRMAN_UNKOWN_BUCKET_COUNT didn't change,
-        // otherwise it is reconstructed as well.
-        //
-        // This format is more complex, but significantly smaller (at most 1.5 MiB), and supports
-        // changes to the ADDRMAN_ parameters without breaking the on-disk structure.
+    // serialized format:
+    // * version byte (currently 1)
+    // * 0x20 + nKey (serialized as if it were a vector, for backward compatibility)
+    // * nNew
+    // * nTried
+    // * number of "new" buckets XOR 2**30
+    // * all nNew addrinfos in vvNew
+    // * all nTried addrinfos in vvTried
+    // * for each "new" bucket:
+    //   * number of elements
+    //   * for each element: index
+    //
+    // Notice that vvTried, mapAddr and vVector are never encoded explicitly;
+    // they are instead reconstructed from the other information.
+    //
+    // The positions in the buckets are never encoded either, they follow from nKey. vvNew is serialized,
+    // but only used if ADDRMAN_NEW_BUCKET_COUNT didn't change and the version is 1, otherwise each new
+    // address is placed in the bucket of its source again. This also reads the files of version 0,
+    // whose buckets were sets.
+    //
+    // This format is more complex, but significantly smaller (at most 1.5 MiB), and supports
+    // changes to the ADDRMAN_ parameters without breaking the on-disk structure.
+    template<typename Stream>
+    void Serialize(Stream &s, int nType, int nVersionDummy) const
+    {
+        LOCK(cs);
+
+        unsigned char nVersion = 1;
+        s << nVersion;
+        s << ((unsigned char)32);
+        s << nKey;
+        s << nNew;
+        s << nTried;
+
+        int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
+        s << nUBuckets;
+        std::unordered_map<int, int> mapUnkIds;
+        int nIds = 0;
+        for (const auto &item : mapInfo)
         {
-            LOCK(cs);
-            unsigned char nVersion = 0;
-            READWRITE(nVersion);
-            READWRITE(nKey);
-            READWRITE(nNew);
-            READWRITE(nTried);
-
-            CAddrMan *am = const_cast<CAddrMan*>(this);
-            if (fWrite)
+            const CAddrInfo &info = item.second;
+            if (info.nRefCount)
             {
-                int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT;
-                READWRITE(nUBuckets);
-                std::map<int, int> mapUnkIds;
-                int nIds = 0;
-                for (std::map<int, CAddrInfo>::iterator it = am->mapInfo.begin(); it != am->mapInfo.end(); it++)
-                {
-                    if (nIds == nNew) break; // this means nNew was wrong, oh ow
-                    mapUnkIds[(*it).first] = nIds;
-                    CAddrInfo &info = (*it).second;
-                    if (info.nRefCount)
-                    {
-                        READWRITE(info);
-                        nIds++;
-                    }
-                }
-                nIds = 0;
-                for (std::map<int, CAddrInfo>::iterator it = am->mapInfo.begin(); it != am->mapInfo.end(); it++)
+                assert(nIds != nNew); // this means nNew was wrong, oh ow
+                mapUnkIds[item.first] = nIds;
+                s << info;
+                nIds++;
+            }
+        }
+        nIds = 0;
+        for (const auto &item : mapInfo)
+        {
+            const CAddrInfo &info = item.second;
+            if (info.fInTried)
+            {
+                assert(nIds != nTried); // this means nTried was wrong, oh ow
+                s << info;
+                nIds++;
+            }
+        }
+        for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++)
+        {
+            int nSize = 0;
+            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++)
+            {
+                if (vvNew[bucket][i] != -1)
+                    nSize++;
+            }
+            s << nSize;
+            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++)
+            {
+                if (vvNew[bucket][i] != -1)
                 {
-                    if (nIds == nTried) break; // this means nTried was wrong, oh ow
-                    CAddrInfo &info = (*it).second;
-                    if (info.fInTried)
-                    {
-                        READWRITE(info);
-                        nIds++;
-                    }
+                    int nIndex = mapUnkIds[vvNew[bucket][i]];
+                    s << nIndex;
                 }
-                for (std::vector<std::set<int> >::iterator it = am->vvNew.begin(); it != am->vvNew.end(); it++)
+            }
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersionDummy)
+    {
+        LOCK(cs);
+
+        Clear();
+
+        unsigned char nVersion;
+        s >> nVersion;
+        unsigned char nKeySize;
+        s >> nKeySize;
+        if (nKeySize != 32)
+            throw std::ios_base::failure("Incorrect keysize in addrman deserialization");
+        s >> nKey;
+        s >> nNew;
+        s >> nTried;
+        int nUBuckets = 0;
+        s >> nUBuckets;
+        if (nVersion != 0)
+            nUBuckets ^= (1 << 30);
+        if (nNew < 0 || nTried < 0 || nUBuckets < 0)
+            throw std::ios_base::failure("Corrupt CAddrMan serialization, negative counts");
+
+        // the positions of vvNew are usable only in the same version and bucket count
+        bool fNewTable = nVersion == 1 && nUBuckets == ADDRMAN_NEW_BUCKET_COUNT;
+
+        // Deserialize entries from the new table.
+        for (int n = 0; n < nNew; n++)
+        {
+            CAddrInfo &info = mapInfo[n];
+            s >> info;
+            mapAddr[info] = n;
+            info.nRandomPos = vRandom.size();
+            vRandom.push_back(n);
+            if (!fNewTable)
+            {
+                // immediately try to give them a reference based on their primary source address.
+                int nUBucket = info.GetNewBucket(nKey);
+                int nUBucketPos = info.GetBucketPosition(nKey, true, nUBucket);
+                if (vvNew[nUBucket][nUBucketPos] == -1)
                 {
-                    const std::set<int> &vNew = (*it);
-                    int nSize = vNew.size();
-                    READWRITE(nSize);
-                    for (std::set<int>::iterator it2 = vNew.begin(); it2 != vNew.end(); it2++)
-                    {
-                        int index = mapUnkIds[*it2];
-                        READWRITE(index);
-                    }
+                    vvNew[nUBucket][nUBucketPos] = n;
+                    info.nRefCount++;
                 }
+            }
+        }
+        nIdCount = nNew;
+
+        // Deserialize entries from the tried table.
+        int nLost = 0;
+        for (int n = 0; n < nTried; n++)
+        {
+            CAddrInfo info;
+            s >> info;
+            int nKBucket = info.GetTriedBucket(nKey);
+            int nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
+            if (vvTried[nKBucket][nKBucketPos] == -1)
+            {
+                info.nRandomPos = vRandom.size();
+                info.fInTried = true;
+                vRandom.push_back(nIdCount);
+                mapInfo[nIdCount] = info;
+                mapAddr[info] = nIdCount;
+                vvTried[nKBucket][nKBucketPos] = nIdCount;
+                nIdCount++;
             } else {
-                int nUBuckets = 0;
-                READWRITE(nUBuckets);
-                am->nIdCount = 0;
-                am->mapInfo.clear();
-                am->mapAddr.clear();
-                am->vRandom.clear();
-                am->vvTried = std::vector<std::vector<int> >(ADDRMAN_TRIED_BUCKET_COUNT, std::vector<int>(0));
-                am->vvNew = std::vector<std::set<int> >(ADDRMAN_NEW_BUCKET_COUNT, std::set<int>());
-                for (int n = 0; n < am->nNew; n++)
+                nLost++;
+            }
+        }
+        nTried -= nLost;
+
+        // Deserialize positions in the new table (if possible).
+        for (int bucket = 0; bucket < nUBuckets; bucket++)
+        {
+            int nSize = 0;
+            s >> nSize;
+            for (int n = 0; n < nSize; n++)
+            {
+                int nIndex = 0;
+                s >> nIndex;
+                if (fNewTable && nIndex >= 0 && nIndex < nNew)
                 {
-                    CAddrInfo &info = am->mapInfo[n];
-                    READWRITE(info);
-                    am->mapAddr[info] = n;
-                    info.nRandomPos = vRandom.size();
-                    am->vRandom.push_back(n);
-                    if (nUBuckets != ADDRMAN_NEW_BUCKET_COUNT)
+                    CAddrInfo &info = mapInfo[nIndex];
+                    int nUBucketPos = info.GetBucketPosition(nKey, true, bucket);
+                    if (vvNew[bucket][nUBucketPos] == -1 && info.nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS)
                     {
-                        am->vvNew[info.GetNewBucket(am->nKey)].insert(n);
                         info.nRefCount++;
-                    }
-                }
-                am->nIdCount = am->nNew;
-                int nLost = 0;
-                for (int n = 0; n < am->nTried; n++)
-                {
-                    CAddrInfo info;
-                    READWRITE(info);
-                    std::vector<int> &vTried = am->vvTried[info.GetTriedBucket(am->nKey)];
-                    if (vTried.size() < ADDRMAN_TRIED_BUCKET_SIZE)
-                    {
-                        info.nRandomPos = vRandom.size();
-                        info.fInTried = true;
-                        am->vRandom.push_back(am->nIdCount);
-                        am->mapInfo[am->nIdCount] = info;
-                        am->mapAddr[info] = am->nIdCount;
-                        vTried.push_back(am->nIdCount);
-                        am->nIdCount++;
-                    } else {
-                        nLost++;
-                    }
-                }
-                am->nTried -= nLost;
-                for (int b = 0; b < nUBuckets; b++)
-                {
-                    std::set<int> &vNew = am->vvNew[b];
-                    int nSize = 0;
-                    READWRITE(nSize);
-                    for (int n = 0; n < nSize; n++)
-                    {
-                        int index = 0;
-                        READWRITE(index);
-                        CAddrInfo &info = am->mapInfo[index];
-                        if (nUBuckets == ADDRMAN_NEW_BUCKET_COUNT && info.nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS)
-                        {
-                            info.nRefCount++;
-                            vNew.insert(index);
-                        }
+                        vvNew[bucket][nUBucketPos] = nIndex;
                     }
                 }
             }
         }
-    });)
 
-    CAddrMan() : vRandom(0), vvTried(ADDRMAN_TRIED_BUCKET_COUNT, std::vector<int>(0)), vvNew(ADDRMAN_NEW_BUCKET_COUNT, std::set<int>())
+        // Prune new entries with refcount 0 (as a result of collisions).
+        int nLostUnk = 0;
+        for (auto it = mapInfo.begin(); it != mapInfo.end(); )
+        {
+            if (!it->second.fInTried && it->second.nRefCount == 0)
+            {
+                auto itDelete = it++;
+                Delete(itDelete->first);
+                nLostUnk++;
+            } else {
+                it++;
+            }
+        }
+        if (nLost + nLostUnk > 0)
+            LogPrint(BCLog::ADDRMAN, "addrman lost %i new and %i tried addresses due to collisions\n", nLostUnk, nLost);
+
+        Check();
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
     {
-         nKey.resize(32);
-         RAND_bytes(&nKey[0], 32);
+        CDataStream ss(nType, nVersion);
+        Serialize(ss, nType, nVersion);
+        return ss.size();
+    }
 
-         nIdCount = 0;
-         nTried = 0;
-         nNew = 0;
+    void Clear()
+    {
+        LOCK(cs);
+        std::vector<int>().swap(vRandom);
+        nKey = GetRandHash();
+        for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++)
+        {
+            for (int entry = 0; entry < ADDRMAN_BUCKET_SIZE; entry++)
+                vvNew[bucket][entry] = -1;
+        }
+        for (int bucket = 0; bucket < ADDRMAN_TRIED_BUCKET_COUNT; bucket++)
+        {
+            for (int entry = 0; entry < ADDRMAN_BUCKET_SIZE; entry++)
+                vvTried[bucket][entry] = -1;
+        }
+
+        nIdCount = 0;
+        nTried = 0;
+        nNew = 0;
+        mapInfo.clear();
+        mapAddr.clear();
+    }
+
+    CAddrMan()
+    {
+        Clear();
     }
 
     // Return the number of (unique) addresses in all tables.
@@ -11,12 +11,21 @@
 #include "commons/util/util.h"
 #include "main.h"
 #include "net.h"
+#include "chain/blockfilter.h"
+#include "chain/txlatency.h"
+#include "p2p/compactblock.h"
+#include "p2p/headerchain.h"
+#include "p2p/mempoolsketch.h"
+#include "p2p/orphanblocks.h"
+#include "p2p/txadmission.h"
+#include "miner/miner.h"
 #include "miner/pbftcontext.h"
 #include "miner/pbftmanager.h"
 #include "tx/einvalidtxtype.h"
 
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
@@ -27,16 +36,12 @@ static const int64_t WITNESS_NODE_BLOCKS_TO_DOWNLOAD_TIMEOUT = 20;  // 20 second
 static const int64_t WITNESS_NODE_BLOCKS_IN_FLIGHT_TIMEOUT   = 10;  // 10 seconds
 
 class CNode;
-class CDataStream;
 class CInv;
-class COrphanBlock;
 class CBlockConfirmMessage;
 
 extern CPBFTContext pbftContext ;
 extern CPBFTMan pbftMan ;
 extern CChain chainActive;
-extern uint256 GetOrphanRoot(const uint256 &hash);
-extern map<uint256, COrphanBlock *> mapOrphanBlocks;
 
 namespace {
 map<uint256, tuple<NodeId, list<QueuedBlock>::iterator, int64_t>> mapBlocksInFlight;  // downloading blocks
@@ -46,6 +51,9 @@ map<uint256, tuple<NodeId, list<uint256>::iterator, int64_t>> mapBlocksToDownloa
 // them, if processing happens afterwards. Protected by cs_main.
 map<uint256, NodeId> mapBlockSource;  // Remember who we got this block from.
 
+// Compact block of each peer waiting for the blocktxn with its missing txs. Protected by cs_mapNodeState.
+map<NodeId, pair<uint256, std::shared_ptr<CPartialBlock>>> mapPartialBlocks;
+
 
 // Requires cs_mapNodeState.
 void MarkBlockAsReceived(const uint256 &hash, NodeId nodeFrom = -1) {
@@ -62,10 +70,16 @@ void MarkBlockAsReceived(const uint256 &hash, NodeId nodeFrom = -1) {
     auto itInFlight = mapBlocksInFlight.find(hash);
     if (itInFlight != mapBlocksInFlight.end()) {
         CNodeState *state = State(std::get<0>(itInFlight->second));
+        int64_t nRequestTime = std::get<1>(itInFlight->second)->nTime;  // read before the entry is erased
         state->vBlocksInFlight.erase(std::get<1>(itInFlight->second));
         state->nBlocksInFlight--;
-        if (std::get<0>(itInFlight->second) == nodeFrom)
-            state->nLastBlockReceive = GetTimeMicros();
+        if (std::get<0>(itInFlight->second) == nodeFrom) {
+            // the interval since the previous block or since the request if the peer was idle meanwhile
+            int64_t nNow      = GetTimeMicros();
+            int64_t nInterval = std::max<int64_t>(nNow - std::max(state->nLastBlockReceive, nRequestTime), 1000);
+            state->dBlockRate        = state->dBlockRate * 0.9 + 1000000.0 / nInterval * 0.1;
+            state->nLastBlockReceive = nNow;
+        }
 
         mapBlocksInFlight.erase(itInFlight);
     }
@@ -73,13 +87,6 @@ void MarkBlockAsReceived(const uint256 &hash, NodeId nodeFrom = -1) {
 
 }  // namespace
 
-struct COrphanBlock {
-    uint256 blockHash;
-    uint256 prevBlockHash;
-    int32_t height;
-    vector<uint8_t> vchBlock;
-};
-
 static CMedianFilter<int32_t> cPeerBlockCounts(8, 0);
 
 inline void ProcessGetData(CNode *pFrom) {
@@ -101,23 +108,54 @@ inline void ProcessGetData(CNode *pFrom) {
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
-                bool send                                = false;
-                map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end()) {
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
+                bool send             = false;
+                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+                if (mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
                     send = true;
+                } else if (mi != mapBlockIndex.end()) {
+                    LogPrint(BCLog::NET, "block %s pruned\n", inv.hash.GetHex());
                 } else {
                     LogPrint(BCLog::NET, "block %s not exist\n", inv.hash.GetHex());
                 }
 
                 if (send) {
-                    // Send block from disk
+                    // a compact block of an old block would miss most txs in the mempool of the peer
+                    const char *pszCommand = nullptr;
+                    if (inv.type == MSG_BLOCK || (inv.type == MSG_CMPCT_BLOCK &&
+                                                  mi->second->height < chainActive.Height() - MAX_CMPCTBLOCK_DEPTH))
+                        pszCommand = NetMsgType::BLOCK;
+                    else if (inv.type == MSG_CMPCT_BLOCK)
+                        pszCommand = NetMsgType::CMPCTBLOCK;
+
+                    // the new blocks asked by many peers at once are read and serialized once
+                    CSharedNetMsg spMsg;
+                    if (pszCommand != nullptr)
+                        spMsg = FindBlockMessage(pszCommand, inv.hash);
+
+                    // Send block from disk, a full block is sent as its bytes on disk without decoding its txs
+                    CBlockView blockView;
                     CBlock block;
-                    ReadBlockFromDisk((*mi).second, block);
-                    if (inv.type == MSG_BLOCK) {
-                        LogPrint(BCLog::NET, "send block[%u]: %s to peer %s\n", block.GetHeight(), block.GetHash().GetHex(),
-                                 pFrom->addr.ToString());
-                        pFrom->PushMessage(NetMsgType::BLOCK, block);
+                    if (spMsg) {
+                        LogPrint(BCLog::NET, "send cached %s[%d]: %s to peer %s\n", pszCommand, mi->second->height,
+                                 inv.hash.GetHex(), pFrom->addr.ToString());
+                        pFrom->PushSharedMessage(spMsg);
+                    } else if (!ReadBlockViewFromDisk((*mi).second, blockView) ||
+                               (pszCommand != NetMsgType::BLOCK && !blockView.GetBlock(block))) {
+                        LogPrint(BCLog::ERROR, "read block %s from disk failed\n", inv.hash.GetHex());
+                    } else if (pszCommand == NetMsgType::BLOCK) {
+                        LogPrint(BCLog::NET, "send block[%u]: %s to peer %s\n", blockView.GetHeader().GetHeight(),
+                                 inv.hash.GetHex(), pFrom->addr.ToString());
+                        spMsg = MakeSharedNetMsg(NetMsgType::BLOCK, blockView.GetRawData());
+                        AddBlockMessage(NetMsgType::BLOCK, inv.hash, spMsg);
+                        pFrom->PushSharedMessage(spMsg);
+                    }
+                    else if (pszCommand == NetMsgType::CMPCTBLOCK) {
+                        LogPrint(BCLog::NET, "send cmpctblock[%u]: %s to peer %s\n", block.GetHeight(),
+                                 block.GetHash().GetHex(), pFrom->addr.ToString());
+                        spMsg = MakeSharedNetMsg(NetMsgType::CMPCTBLOCK, CBlockHeaderAndShortTxIDs(block));
+                        AddBlockMessage(NetMsgType::CMPCTBLOCK, inv.hash, spMsg);
+                        pFrom->PushSharedMessage(spMsg);
                     }
                     else  // MSG_FILTERED_BLOCK)
                     {
@@ -131,9 +169,15 @@ inline void ProcessGetData(CNode *pFrom) {
                             // send here - they must either disconnect and retry or request the full block. Thus, the
                             // protocol spec specified allows for us to provide duplicate txn here, however we MUST
                             // always provide at least what the remote peer needs
-                            for (auto &pair : merkleBlock.vMatchedTxn)
-                                if (!pFrom->setInventoryKnown.count(CInv(MSG_TX, pair.second)))
+                            for (auto &pair : merkleBlock.vMatchedTxn) {
+                                bool fKnown;
+                                {
+                                    LOCK(pFrom->cs_inventory);
+                                    fKnown = pFrom->filterInventoryKnown.contains(pair.second);
+                                }
+                                if (!fKnown)
                                     pFrom->PushMessage(NetMsgType::TX, block.vptx[pair.first]);
+                            }
                         }
                         // else
                         // no response
@@ -154,21 +198,24 @@ inline void ProcessGetData(CNode *pFrom) {
             } else if (inv.IsKnownType()) {
                 // Send stream from relay memory
                 bool pushed = false;
+                CSharedNetMsg spMsg;
                 {
                     LOCK(cs_mapRelay);
-                    map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
-                    if (mi != mapRelay.end()) {
-                        pFrom->PushMessage(inv.GetCommand(), (*mi).second);
-                        pushed = true;
-                    }
+                    map<CInv, CSharedNetMsg>::iterator mi = mapRelay.find(inv);
+                    if (mi != mapRelay.end())
+                        spMsg = mi->second;
+                }
+                if (spMsg) {
+                    pFrom->PushSharedMessage(spMsg);
+                    pushed = true;
                 }
                 if (!pushed && inv.type == MSG_TX) {
                     std::shared_ptr<CBaseTx> pBaseTx = mempool.Lookup(inv.hash);
                     if (pBaseTx.get() && !pBaseTx->IsBlockRewardTx() && !pBaseTx->IsPriceMedianTx()) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << pBaseTx;
-                        pFrom->PushMessage(NetMsgType::TX, ss);
+                        // kept for the next peers asking for it
+                        spMsg = MakeSharedNetMsg(NetMsgType::TX, pBaseTx);
+                        AddRelayMessage(inv, spMsg);
+                        pFrom->PushSharedMessage(spMsg);
                         pushed = true;
                     }
                 }
@@ -180,7 +227,7 @@ inline void ProcessGetData(CNode *pFrom) {
             // Track requests for our stuff.
             // g_signals.Inventory(inv.hash);
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -206,7 +253,7 @@ bool AlreadyHave(const CInv &inv) {
         }
 
         case MSG_BLOCK: {
-            return mapBlockIndex.count(inv.hash) || mapOrphanBlocks.count(inv.hash);
+            return mapBlockIndex.count(inv.hash) || orphanBlocks.Have(inv.hash);
         }
     }
 
@@ -320,6 +367,23 @@ inline int32_t ProcessVersionMessage(CNode *pFrom, string strCommand, CDataStrea
     pFrom->PushMessage(NetMsgType::VERACK);
     pFrom->ssSend.SetVersion(min(pFrom->nVersion, PROTOCOL_VERSION));
 
+    // Announce compact block relay, a block producer wants the new blocks pushed to it at once
+    pFrom->PushMessage(NetMsgType::SENDCMPCT, SysCfg().GetBoolArg("-genblock", false), COMPACT_BLOCKS_VERSION);
+
+    // Take the new blocks announced by headers, they are fetched along the header chain without a getheaders
+    pFrom->PushMessage(NetMsgType::SENDHEADERS);
+
+    // Accept the block, tx and headers payloads compressed
+    if (IsNetCompressEnabled())
+        pFrom->PushMessage(NetMsgType::SENDCOMPRESS, NET_COMPRESS_ZLIB_DICT);
+
+    // Reconcile the mempools, each side announces the txs the other one missed while apart
+    if (!IsInitialBlockDownload()) {
+        vector<uint256> vtxid;
+        mempool.QueryHash(vtxid);
+        pFrom->PushMessage(NetMsgType::MEMPOOLSKETCH, CMemPoolSketch(vtxid));
+    }
+
     if (!pFrom->fInbound) {
         // Advertise our address
         if (!fNoListen && !IsInitialBlockDownload()) {
@@ -443,7 +507,7 @@ inline bool ProcessAddrMessage(CNode *pFrom, CDataStream &vRecv) {
             {
                 LOCK(cs_vNodes);
                 // Use deterministic randomness to send to the same nodes for 24 hours
-                // at a time so the setAddrKnowns of the chosen nodes prevent repeats
+                // at a time so the addrKnown filters of the chosen nodes prevent repeats
                 static uint256 hashSalt;
                 if (hashSalt.IsNull()) hashSalt = GetRandHash();
                 uint64_t hashAddr = addr.GetHash();
@@ -480,6 +544,8 @@ inline bool ProcessAddrMessage(CNode *pFrom, CDataStream &vRecv) {
 }
 
 inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
+    // relay the tx as received rather than cloning and serializing it again
+    CDataStream vMsg(vRecv.begin(), vRecv.end(), vRecv.nType, vRecv.nVersion);
     std::shared_ptr<CBaseTx> pBaseTx;
     try {
         vRecv >> pBaseTx;
@@ -495,58 +561,51 @@ inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv
 
     CInv inv(MSG_TX, pBaseTx->GetHash());
     pFrom->AddInventoryKnown(inv);
+    txLatencyTracer.Stamp(inv.hash, TX_STAGE_P2P_RECEIVED);
 
     if(IsInitialBlockDownload()){
-        RelayTransaction(pBaseTx.get(), inv.hash);
+        RelayTransaction(pBaseTx.get(), inv.hash, vMsg);
         return true ;
     }
 
-
-
-    LOCK(cs_main);
-    CValidationState state;
-    if (AcceptToMemoryPool(mempool, state, pBaseTx.get(), true)) {
-        RelayTransaction(pBaseTx.get(), inv.hash);
-        mapAlreadyAskedFor.erase(inv);
-
-        LogPrint(BCLog::INFO, "AcceptToMemoryPool: %s %s : accepted %s (poolsz %u)\n", pFrom->addr.ToString(),
-                 pFrom->cleanSubVer, pBaseTx->GetHash().ToString(), mempool.memPoolTxs.size());
-    }
-
-    int32_t nDoS = 0;
-    if (state.IsInvalid(nDoS)) {
-        LogPrint(BCLog::INFO, "%s [%d] from %s %s was not accepted into the memory pool: %s\n",
-                pBaseTx->GetHash().ToString(), pBaseTx->valid_height,
-                pFrom->addr.ToString(), pFrom->cleanSubVer, state.GetRejectReason());
-
-        pFrom->PushMessage(NetMsgType::REJECT, strCommand, state.GetRejectCode(), state.GetRejectReason(), inv.hash);
-        // if (nDoS > 0) {
-        //     LogPrint(BCLog::INFO, "Misebehaving, add to tx hash %s mempool error, Misbehavior add %d",
-        //     pBaseTx->GetHash().GetHex(), nDoS); Misbehaving(pFrom->GetId(), nDoS);
-        // }
-    }
+    // admitted in a batch by the admission thread, which relays or rejects it then
+    txAdmissionQueue.Push(pFrom, pBaseTx, vMsg);
 
     return true;
 }
 
+// The last block of the locator in the active chain. The chain is the same as long as its tip is, a peer re-sending
+// its locator, e.g. while its blocks are in flight, gets the fork found for the previous one.
+inline CBlockIndex *FindLocatorFork(CNode *pFrom, const CBlockLocator &locator) {
+    CBlockIndex *pTip = chainActive.Tip();
+    if (pFrom->pLastLocatorTip == pTip && pFrom->vLastLocatorHave == locator.vHave)
+        return pFrom->pLastLocatorFork;
+
+    CBlockIndex *pFork      = chainActive.FindFork(mapBlockIndex, locator);
+    pFrom->vLastLocatorHave = locator.vHave;
+    pFrom->pLastLocatorTip  = pTip;
+    pFrom->pLastLocatorFork = pFork;
+    return pFork;
+}
+
 inline bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
     CBlockLocator locator;
     uint256 hashStop;
     vRecv >> locator >> hashStop;
 
-    LOCK(cs_main);
+    std::shared_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
 
     CBlockIndex *pIndex = nullptr;
     if (locator.IsNull()) {
         // If locator is null, return the hashStop block
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hashStop);
+        BlockMap::iterator mi = mapBlockIndex.find(hashStop);
         if (mi == mapBlockIndex.end())
             return true;
 
         pIndex = (*mi).second;
     } else {
         // Find the last block the caller has in the main chain
-        pIndex = chainActive.FindFork(mapBlockIndex, locator);
+        pIndex = FindLocatorFork(pFrom, locator);
         if (pIndex)
             pIndex = chainActive.Next(pIndex);
     }
@@ -566,6 +625,46 @@ inline bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
     return false;
 }
 
+inline void ProcessHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
+    vector<CBlock> vHeaders;
+    vRecv >> vHeaders;
+
+    LOCK(cs_main);
+
+    int32_t nDoS = 0;
+    string reason;
+    if (!headerChain.AcceptHeaders(vHeaders, chainActive.Tip(), nDoS, reason)) {
+        LogPrint(BCLog::NET, "reject %u headers from peer %s, reason=%s\n", vHeaders.size(), pFrom->addr.ToString(),
+                 reason);
+        if (nDoS > 0)
+            Misbehaving(pFrom->GetId(), nDoS);
+        return;
+    }
+    if (vHeaders.empty())
+        return;
+
+    int32_t nLastHeight = vHeaders.back().GetHeight();
+    {
+        LOCK(cs_mapNodeState);
+        CNodeState *state = State(pFrom->GetId());
+        if (state != nullptr)
+            state->nBestHeaderHeight = std::max(state->nBestHeaderHeight, nLastHeight);
+    }
+    LogPrint(BCLog::NET, "recv %u headers up to height=%d from peer %s, best header height=%d\n", vHeaders.size(),
+             nLastHeight, pFrom->addr.ToString(), headerChain.GetBestHeight());
+
+    if (headerChain.GetSyncPeer() == pFrom->GetId()) {
+        if (vHeaders.size() == MAX_HEADERS_RESULTS &&
+            headerChain.GetBestHeight() < chainActive.Height() + CHeaderChain::MAX_HEADERS_AHEAD_OF_TIP) {
+            // the peer has more, continue from the best header
+            headerChain.SetSyncPeer(pFrom->GetId(), GetTime());
+            pFrom->PushMessage(NetMsgType::GETHEADERS, headerChain.GetLocator(chainActive), uint256());
+        } else if (!headerChain.HasMoreHeaders()) {
+            headerChain.SetSyncPeer(-1, 0);
+        }
+    }
+}
+
 inline void ProcessGetBlocksMessage(CNode *pFrom, CDataStream &vRecv) {
     CBlockLocator locator;
     uint256 hashStop;
@@ -574,7 +673,7 @@ inline void ProcessGetBlocksMessage(CNode *pFrom, CDataStream &vRecv) {
     LOCK(cs_main);
 
     // Find the last block the caller has in the main chain
-    CBlockIndex *pStartIndex = chainActive.FindFork(mapBlockIndex, locator);
+    CBlockIndex *pStartIndex = FindLocatorFork(pFrom, locator);
 
     // Send the rest of the chain
     if (pStartIndex)
@@ -620,7 +719,8 @@ inline bool ProcessInvMessage(CNode *pFrom, CDataStream &vRecv) {
         return ERRORMSG("message inv size() = %u from peer %s", vInv.size(), pFrom->addrName);
     }
 
-    LOCK(cs_main);
+    // tx invs are looked up in the mempool only, block invs take cs_main for the block index
+    bool fTipStale = nTipBlockTime < GetTime() - 24 * 60 * 60;
 
     int i = 0;
     for (CInv &inv : vInv) {
@@ -636,12 +736,13 @@ inline bool ProcessInvMessage(CNode *pFrom, CDataStream &vRecv) {
                     GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName);
                 fAlreadyHave = true;
             }
-            if(chainActive.Tip()->GetBlockTime() < GetTime() - 24 * 60 * 60){
+            if (fTipStale) {
                 LogPrint(BCLog::NET, "recv tx inv data when initialBlockDownload,reject it! time_ms=%lld, i=%d, msg=%s, hash=%s, peer=%s\n",
                          GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName);
                 fAlreadyHave = true;
             }
         } else if (inv.type == MSG_BLOCK) {
+            LOCK(cs_main);
             msgName = "MSG_BLOCK";
             auto blockIndexIt = mapBlockIndex.find(inv.hash);
             if (blockIndexIt != mapBlockIndex.end()) {
@@ -649,17 +750,19 @@ inline bool ProcessInvMessage(CNode *pFrom, CDataStream &vRecv) {
                     GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName, "BlockIndex", blockIndexIt->second->height);
                 fAlreadyHave = true;
             } else {
-                auto orphanBlockIt = mapOrphanBlocks.find(inv.hash);
-                if (orphanBlockIt != mapOrphanBlocks.end()) {
+                int32_t orphanHeight = 0;
+                if (orphanBlocks.GetHeight(inv.hash, orphanHeight)) {
                     LogPrint(BCLog::NET, "recv inv old data! time_ms=%lld, i=%d, msg=%s, hash=%s, peer=%s, found_in=%s, height=%d\n",
-                        GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName, "OrphanBlock", orphanBlockIt->second->height);
+                        GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName, "OrphanBlock", orphanHeight);
                     fAlreadyHave = true;
 
                     LogPrint(BCLog::NET, "recv orphan block and lead to getblocks! height=%d, hash=%s, "
                              "tip_height=%d, tip_hash=%s, peer=%s\n",
-                             orphanBlockIt->second->height, inv.hash.GetHex(), chainActive.Height(),
+                             orphanHeight, inv.hash.GetHex(), chainActive.Height(),
                              chainActive.Tip()->GetBlockHash().GetHex(), pFrom->addrName);
-                    PushGetBlocksOnCondition(pFrom, chainActive.Tip(), GetOrphanRoot(inv.hash));
+                    // the parents of an orphan on the best header chain are scheduled already
+                    if (!headerChain.Have(inv.hash))
+                        PushGetBlocksOnCondition(pFrom, chainActive.Tip(), orphanBlocks.GetRoot(inv.hash));
                     // TODO: should get the headmost block of this fork from current peer
                 }
             }
@@ -669,10 +772,12 @@ inline bool ProcessInvMessage(CNode *pFrom, CDataStream &vRecv) {
             LogPrint(BCLog::NET, "recv inv new data! time_ms=%lld, i=%d, msg=%s, hash=%s, peer=%s\n",
                 GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName);
             if (!SysCfg().IsImporting() && !SysCfg().IsReindex()) {
-                if (inv.type == MSG_BLOCK)
+                if (inv.type == MSG_BLOCK) {
+                    LOCK(cs_main);
                     AddBlockToQueue(inv.hash, pFrom->GetId());
-                else
+                } else {
                     pFrom->AskFor(inv);  // MSG_TX
+                }
             }
         }
 
@@ -705,14 +810,9 @@ inline bool ProcessGetDataMessage(CNode *pFrom, CDataStream &vRecv) {
     return true;
 }
 
-inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
-    CBlock block;
-    vRecv >> block;
-
-    LogPrint(BCLog::NET, "recv block! time_ms=%lld, hash=%s, peer=%s\n", GetTimeMillis(),
-        block.GetHash().ToString(), pFrom->addr.ToString());
-    // block.Print();
-
+// Requires the block received from pFrom as block, cmpctblock or blocktxn message. A compact block of the scheduled
+// producer on the tip may be relayed before its validation (BIP152), its sender is not punished for an invalid one.
+inline void ProcessReceivedBlock(CNode *pFrom, CBlock &block, bool fCompact = false) {
     CInv inv(MSG_BLOCK, block.GetHash());
     pFrom->AddInventoryKnown(inv);
 
@@ -721,11 +821,23 @@ inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
         LOCK(cs_mapNodeState);
         mapBlockSource[inv.hash] = pFrom->GetId();
         MarkBlockAsReceived(inv.hash, pFrom->GetId());
+
+        auto it = mapPartialBlocks.find(pFrom->GetId());
+        if (it != mapPartialBlocks.end() && it->second.first == inv.hash)
+            mapPartialBlocks.erase(it);
     }
 
     LOCK(cs_main);
     CValidationState state;
 
+    if (fCompact && block.GetPrevBlockHash() == chainActive.Tip()->GetBlockHash()) {
+        CCacheWrapper cw(pCdMan);
+        if (VerifyBlockProducer(&block, cw)) {
+            LOCK(cs_mapNodeState);
+            mapBlockSource.erase(inv.hash);
+        }
+    }
+
     std::pair<int32_t ,uint256> globalfinblock = std::make_pair(0,uint256());
     pCdMan->pBlockCache->ReadGlobalFinBlock(globalfinblock);
     if (  block.GetHeight() < (uint32_t)globalfinblock.first){
@@ -733,20 +845,194 @@ inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
                                       block.GetHeight(), globalfinblock.first);
     } else {
         ProcessBlock(state, pFrom, &block);
+        headerChain.Prune(chainActive.Tip());
     }
 
 }
 
-inline void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
+inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlock block;
+    vRecv >> block;
+
+    LogPrint(BCLog::NET, "recv block! time_ms=%lld, hash=%s, peer=%s\n", GetTimeMillis(),
+        block.GetHash().ToString(), pFrom->addr.ToString());
+    // block.Print();
+
+    ProcessReceivedBlock(pFrom, block);
+}
+
+// Request the full block when a compact block can not be rebuilt
+inline void RequestFullBlock(CNode *pFrom, const uint256 &blockHash) {
+    LogPrint(BCLog::NET, "request full block %s from peer %s\n", blockHash.GetHex(), pFrom->addr.ToString());
+    pFrom->PushMessage(NetMsgType::GETDATA, vector<CInv>(1, CInv(MSG_BLOCK, blockHash)));
+}
+
+inline void ProcessSendCompactMessage(CNode *pFrom, CDataStream &vRecv) {
+    bool fHighBandwidth = false;
+    uint64_t version    = 0;
+    vRecv >> fHighBandwidth >> version;
+
+    if (version != COMPACT_BLOCKS_VERSION)
+        return;
+
+    pFrom->fSupportsCompactBlocks = true;
+    pFrom->fCompactHighBandwidth  = fHighBandwidth;
+    LogPrint(BCLog::NET, "peer %s relays compact blocks, high bandwidth=%d\n", pFrom->addr.ToString(), fHighBandwidth);
+}
+
+inline void ProcessSendHeadersMessage(CNode *pFrom) {
+    pFrom->fPreferHeaders = true;
+    LogPrint(BCLog::NET, "peer %s prefers headers announcements\n", pFrom->addr.ToString());
+}
+
+inline void ProcessSendCompressMessage(CNode *pFrom, CDataStream &vRecv) {
+    uint8_t codec = 0;
+    vRecv >> codec;
+
+    // a peer of another codec gets the messages uncompressed
+    if (codec != NET_COMPRESS_ZLIB_DICT)
+        return;
+
+    {
+        LOCK(pFrom->cs_vSend);
+        pFrom->fSendCompressed = true;
+    }
+    LogPrint(BCLog::NET, "peer %s accepts compressed messages, codec=%d\n", pFrom->addr.ToString(), codec);
+}
+
+inline void ProcessCompactBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockHeaderAndShortTxIDs cmpctBlock;
+    vRecv >> cmpctBlock;
+
+    uint256 blockHash = cmpctBlock.header.GetHash();
+    LogPrint(BCLog::NET, "recv cmpctblock! time_ms=%lld, height=%d, hash=%s, peer=%s\n", GetTimeMillis(),
+             cmpctBlock.header.GetHeight(), blockHash.ToString(), pFrom->addr.ToString());
+    pFrom->AddInventoryKnown(CInv(MSG_BLOCK, blockHash));
+
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(blockHash) || orphanBlocks.Have(blockHash))
+            return;
+
+        // the mempool holds the txs of the blocks on the tip only
+        if (!mapBlockIndex.count(cmpctBlock.header.GetPrevBlockHash())) {
+            RequestFullBlock(pFrom, blockHash);
+            return;
+        }
+    }
+
+    auto pPartialBlock               = std::make_shared<CPartialBlock>(mempool);
+    CPartialBlock::ReadStatus status = pPartialBlock->InitData(cmpctBlock);
+    if (status == CPartialBlock::READ_STATUS_INVALID) {
+        LogPrint(BCLog::INFO, "Misbehaving: invalid compact block %s, nMisbehavior add 100\n", blockHash.GetHex());
+        Misbehaving(pFrom->GetId(), 100);
+        return;
+    } else if (status == CPartialBlock::READ_STATUS_FAILED) {
+        RequestFullBlock(pFrom, blockHash);
+        return;
+    }
+
+    CBlockTransactionsRequest request;
+    request.blockHash = blockHash;
+    request.indexes   = pPartialBlock->GetMissingIndexes();
+    if (request.indexes.empty()) {
+        CBlock block;
+        if (pPartialBlock->FillBlock(block, vector<std::shared_ptr<CBaseTx>>()) != CPartialBlock::READ_STATUS_OK) {
+            RequestFullBlock(pFrom, blockHash);
+            return;
+        }
+
+        ProcessReceivedBlock(pFrom, block, true);
+        return;
+    }
+
+    {
+        LOCK(cs_mapNodeState);
+        mapPartialBlocks[pFrom->GetId()] = make_pair(blockHash, pPartialBlock);
+    }
+    LogPrint(BCLog::NET, "send getblocktxn for %u txs of block %s to peer %s\n", request.indexes.size(),
+             blockHash.GetHex(), pFrom->addr.ToString());
+    pFrom->PushMessage(NetMsgType::GETBLOCKTXN, request);
+}
+
+inline void ProcessGetBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTransactionsRequest request;
+    vRecv >> request;
+
+    LOCK(cs_main);
+    auto mi = mapBlockIndex.find(request.blockHash);
+    if (mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA)) {
+        LogPrint(BCLog::NET, "getblocktxn for unknown block %s from peer %s\n", request.blockHash.GetHex(),
+                 pFrom->addr.ToString());
+        return;
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(mi->second, block)) {
+        LogPrint(BCLog::ERROR, "read block %s from disk failed\n", request.blockHash.GetHex());
+        return;
+    }
+
+    // nobody rebuilds an old block, the request is odd but answered with the block itself
+    if (mi->second->height < chainActive.Height() - MAX_BLOCKTXN_DEPTH) {
+        pFrom->PushMessage(NetMsgType::BLOCK, block);
+        return;
+    }
+
+    CBlockTransactions response;
+    response.blockHash = request.blockHash;
+    response.txs.reserve(request.indexes.size());
+    for (uint32_t index : request.indexes) {
+        if (index >= block.vptx.size()) {
+            LogPrint(BCLog::INFO, "Misbehaving: getblocktxn index out of range, nMisbehavior add 100\n");
+            Misbehaving(pFrom->GetId(), 100);
+            return;
+        }
+        response.txs.push_back(block.vptx[index]);
+    }
+    pFrom->PushMessage(NetMsgType::BLOCKTXN, response);
+}
+
+inline void ProcessBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTransactions response;
+    vRecv >> response;
+
+    std::shared_ptr<CPartialBlock> pPartialBlock;
+    {
+        LOCK(cs_mapNodeState);
+        auto it = mapPartialBlocks.find(pFrom->GetId());
+        if (it == mapPartialBlocks.end() || it->second.first != response.blockHash) {
+            LogPrint(BCLog::NET, "ignore unrequested blocktxn for block %s from peer %s\n",
+                     response.blockHash.GetHex(), pFrom->addr.ToString());
+            return;
+        }
+        pPartialBlock = it->second.second;
+        mapPartialBlocks.erase(it);
+    }
+
+    CBlock block;
+    CPartialBlock::ReadStatus status = pPartialBlock->FillBlock(block, response.txs);
+    if (status == CPartialBlock::READ_STATUS_INVALID) {
+        LogPrint(BCLog::INFO, "Misbehaving: blocktxn does not match the request, nMisbehavior add 100\n");
+        Misbehaving(pFrom->GetId(), 100);
+        return;
+    } else if (status == CPartialBlock::READ_STATUS_FAILED) {
+        RequestFullBlock(pFrom, response.blockHash);
+        return;
+    }
+
+    ProcessReceivedBlock(pFrom, block, true);
+}
+
+// announce the txs of the mempool to the peer, the ones passing its filter if any
+inline void PushMempoolInv(CNode *pFrom, const vector<uint256> &vtxid) {
     LOCK2(cs_main, pFrom->cs_filter);
 
-    vector<uint256> vtxid;
-    mempool.QueryHash(vtxid);
     vector<CInv> vInv;
     for (auto &hash : vtxid) {
         CInv inv(MSG_TX, hash);
         std::shared_ptr<CBaseTx> pBaseTx = mempool.Lookup(hash);
-        if (pBaseTx.get())
+        if (!pBaseTx.get())
             continue;  // another thread removed since queryHashes, maybe...
 
         if ((pFrom->pFilter && pFrom->pFilter->contains(hash)) ||  // other type transaction
@@ -761,6 +1047,56 @@ inline void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
     if (vInv.size() > 0) pFrom->PushMessage(NetMsgType::INV, vInv);
 }
 
+inline void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
+    vector<uint256> vtxid;
+    mempool.QueryHash(vtxid);
+    PushMempoolInv(pFrom, vtxid);
+}
+
+inline void ProcessMempoolSketchMessage(CNode *pFrom, CDataStream &vRecv) {
+    CMemPoolSketch sketch;
+    vRecv >> sketch;
+    if (!sketch.IsValid()) {
+        LogPrint(BCLog::INFO, "Misbehaving: invalid mempoolsketch from peer %s, nMisbehavior add 10\n",
+                 pFrom->addr.ToString());
+        Misbehaving(pFrom->GetId(), 10);
+        return;
+    }
+
+    vector<uint256> vtxid;
+    mempool.QueryHash(vtxid);
+    CMemPoolSketch diff(sketch, vtxid);
+    diff.Subtract(sketch);
+
+    vector<uint64_t> ours, theirs;
+    bool fMalformed = false;
+    if (!diff.Decode(ours, theirs, fMalformed)) {
+        if (fMalformed) {
+            LogPrint(BCLog::INFO, "Misbehaving: malformed mempoolsketch from peer %s, nMisbehavior add 20\n",
+                     pFrom->addr.ToString());
+            Misbehaving(pFrom->GetId(), 20);
+        }
+        LogPrint(BCLog::NET, "mempoolsketch of peer %s too far from the %u txs of the mempool, announce all of them\n",
+                 pFrom->addr.ToString(), vtxid.size());
+        PushMempoolInv(pFrom, vtxid);
+        return;
+    }
+
+    unordered_map<uint64_t, uint256> txidsByShortId;
+    for (const auto &txid : vtxid)
+        txidsByShortId.emplace(diff.GetShortId(txid), txid);
+
+    vector<uint256> vMissing;
+    for (uint64_t shortId : ours) {
+        auto it = txidsByShortId.find(shortId);
+        if (it != txidsByShortId.end())
+            vMissing.push_back(it->second);
+    }
+    LogPrint(BCLog::NET, "reconciled the mempool with peer %s: %u txs to announce, %u to be announced\n",
+             pFrom->addr.ToString(), vMissing.size(), theirs.size());
+    PushMempoolInv(pFrom, vMissing);
+}
+
 inline void ProcessAlertMessage(CNode *pFrom, CDataStream &vRecv) {
     CAlert alert;
     vRecv >> alert;
@@ -824,6 +1160,97 @@ inline void ProcessFilterAddMessage(CNode *pFrom, CDataStream &vRecv) {
     }
 }
 
+// the blocks of the active chain from the start height to the stop block for a getcfilters or getcfheaders
+// request, false if the request is not served
+inline bool GetBlockFilterRange(CNode *pFrom, uint8_t filterType, uint32_t startHeight, const uint256 &stopHash,
+                                uint32_t maxSize, vector<CBlockIndex *> &vIndex) {
+    if (!SysCfg().IsBlockFilterIndex()) {
+        LogPrint(BCLog::NET, "block filter request from peer %s ignored, the index is disabled\n", pFrom->addr.ToString());
+        return false;
+    }
+    if (filterType != BLOCK_FILTER_BASIC) {
+        LogPrint(BCLog::INFO, "Misbehaving: unknown block filter type %d from peer %s, nMisbehavior add 10\n",
+                 filterType, pFrom->addr.ToString());
+        Misbehaving(pFrom->GetId(), 10);
+        return false;
+    }
+
+    auto it = mapBlockIndex.find(stopHash);
+    if (it == mapBlockIndex.end() || !chainActive.Contains(it->second)) {
+        LogPrint(BCLog::NET, "block filter request from peer %s for the unknown block %s\n", pFrom->addr.ToString(),
+                 stopHash.GetHex());
+        return false;
+    }
+
+    CBlockIndex *pStopIndex = it->second;
+    // the genesis block has no filter
+    if (startHeight == 0 || startHeight > (uint32_t)pStopIndex->height ||
+        pStopIndex->height - startHeight >= maxSize) {
+        LogPrint(BCLog::INFO, "Misbehaving: invalid block filter range %u-%d from peer %s, nMisbehavior add 10\n",
+                 startHeight, pStopIndex->height, pFrom->addr.ToString());
+        Misbehaving(pFrom->GetId(), 10);
+        return false;
+    }
+
+    vIndex.resize(pStopIndex->height - startHeight + 1);
+    for (CBlockIndex *pIndex = pStopIndex; pIndex != nullptr && pIndex->height >= (int32_t)startHeight;
+         pIndex = pIndex->pprev)
+        vIndex[pIndex->height - startHeight] = pIndex;
+    return true;
+}
+
+inline void ProcessGetCFiltersMessage(CNode *pFrom, CDataStream &vRecv) {
+    uint8_t filterType;
+    uint32_t startHeight;
+    uint256 stopHash;
+    vRecv >> filterType >> startHeight >> stopHash;
+
+    LOCK(cs_main);
+    vector<CBlockIndex *> vIndex;
+    if (!GetBlockFilterRange(pFrom, filterType, startHeight, stopHash, MAX_GETCFILTERS_SIZE, vIndex))
+        return;
+
+    for (const auto pIndex : vIndex) {
+        CBlockFilter filter;
+        if (!pCdMan->pBlockCache->GetBlockFilter(pIndex->GetBlockHash(), filter)) {
+            LogPrint(BCLog::ERROR, "the filter of block %s not found\n", pIndex->GetBlockHash().GetHex());
+            return;
+        }
+        pFrom->PushMessage(NetMsgType::CFILTER, filterType, filter.GetBlockHash(), filter.GetEncoded());
+    }
+}
+
+inline void ProcessGetCFHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
+    uint8_t filterType;
+    uint32_t startHeight;
+    uint256 stopHash;
+    vRecv >> filterType >> startHeight >> stopHash;
+
+    LOCK(cs_main);
+    vector<CBlockIndex *> vIndex;
+    if (!GetBlockFilterRange(pFrom, filterType, startHeight, stopHash, MAX_GETCFHEADERS_SIZE, vIndex))
+        return;
+
+    // the header before the first filter, from which the peer chains the filter hashes
+    uint256 prevHeader;
+    CBlockFilter filter;
+    if (startHeight > 1 && pCdMan->pBlockCache->GetBlockFilter(vIndex.front()->pprev->GetBlockHash(), filter))
+        prevHeader = filter.GetHeader();
+
+    vector<uint256> vFilterHash;
+    vFilterHash.reserve(vIndex.size());
+    for (const auto pIndex : vIndex) {
+        if (!pCdMan->pBlockCache->GetBlockFilter(pIndex->GetBlockHash(), filter)) {
+            LogPrint(BCLog::ERROR, "the filter of block %s not found\n", pIndex->GetBlockHash().GetHex());
+            return;
+        }
+        vFilterHash.push_back(filter.GetFilterHash());
+    }
+    pFrom->PushMessage(NetMsgType::CFHEADERS, filterType, stopHash, prevHeader, vFilterHash);
+}
+
+// The PBFT messages are checked on the thread of ThreadPBFTMessageHandler, without cs_main, so they do not queue
+// behind the blocks and txs of the message handlers.
 bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv) {
 
     if(SysCfg().IsReindex()|| GetTime()-chainActive.Tip()->GetBlockTime()>600){
@@ -845,27 +1272,7 @@ bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv) {
         return false ;
     }
 
-    if(!CheckPBFTMessage(PBFTMsgType::CONFIRM_BLOCK,message)){
-        LogPrint(BCLog::NET, "confirm message check failed,miner_id=%s, blockhash=%s \n",message.miner.ToString(), message.blockHash.GetHex());
-        return false ;
-    }
-
-    msgMan.AddMessageKnown(message);
-    int messageCount = msgMan.SaveMessageByBlock(message.blockHash, message);
-
-    bool updateFinalitySuccess = false ;
-    if(messageCount >= FINALITY_BLOCK_CONFIRM_MINER_COUNT){
-       updateFinalitySuccess = pbftMan.UpdateLocalFinBlock(message) ;
-    }
-
-    if(CheckPBFTMessageSignaturer(message))
-        RelayBlockConfirmMessage(message) ;
-
-    if(updateFinalitySuccess){
-        BroadcastBlockFinality(pbftMan.GetLocalFinIndex());
-    }
-
-    return true ;
+    return EnqueuePBFTMessage(message) ;
 }
 
 
@@ -889,21 +1296,37 @@ bool ProcessBlockFinalityMessage(CNode *pFrom, CDataStream &vRecv) {
         return false ;
     }
 
-    if(!CheckPBFTMessage(PBFTMsgType::FINALITY_BLOCK,message)){
-        LogPrint(BCLog::NET, "finality block message check failed,miner_id=%s, blockhash=%s \n",message.miner.ToString(), message.blockHash.GetHex());
+    return EnqueuePBFTMessage(message) ;
+}
+
+bool ProcessPBFTCertificateMessage(CNode *pFrom, CDataStream &vRecv) {
+
+    if(SysCfg().IsReindex())
         return false ;
-    }
 
-    msgMan.AddMessageKnown(message);
-    int messageCount = msgMan.SaveMessageByBlock(message.blockHash, message);
-    if(messageCount>= FINALITY_BLOCK_CONFIRM_MINER_COUNT){
-        pbftMan.UpdateGlobalFinBlock(message) ;
-    }
-    if(CheckPBFTMessageSignaturer(message))
-        RelayBlockFinalityMessage(message) ;
+    CPBFTCertificate cert ;
+    vRecv >> cert;
+
+    // the finality certificates are kept while catching up with -assumefinalized, for the blocks to be downloaded
+    if (GetTime() - chainActive.Tip()->GetBlockTime() > 600 &&
+        (cert.msgType != PBFTMsgType::FINALITY_BLOCK ||
+         !SysCfg().GetBoolArg("-assumefinalized", DEFAULT_ASSUME_FINALIZED)))
+        return false ;
 
-    return true ;
+    LogPrint(BCLog::NET, "received PBFT certificate: msgType=%d, blockHeight=%d, blockHash=%s, signers=%u\n",
+             cert.msgType, cert.height, cert.blockHash.GetHex(), cert.GetSignerCount());
+
+    pFrom->AddPBFTCertificateKnown(cert) ;
+
+    bool certified = cert.msgType == PBFTMsgType::CONFIRM_BLOCK ?
+                     pbftContext.confirmMessageMan.IsCertifiedBlock(cert.blockHash) :
+                     pbftContext.finalityMessageMan.IsCertifiedBlock(cert.blockHash) ;
+    if(certified)
+        return false ;
+
+    return EnqueuePBFTMessage(cert) ;
 }
+
 inline void ProcessRejectMessage(CNode *pFrom, CDataStream &vRecv) {
     if (SysCfg().IsDebug()) {
         string message;
@@ -0,0 +1,142 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "compactblock.h"
+
+#include "config/const.h"
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+#include "logging.h"
+#include "tx/tx.h"
+#include "tx/txmempool.h"
+
+#include <openssl/rand.h>
+
+#include <unordered_map>
+
+using namespace std;
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock &block) : header(block.GetBlockHeader()) {
+    RAND_bytes((uint8_t *)&nonce, sizeof(nonce));
+
+    // the reward and price median txs are made by the producer, they are never in a mempool
+    for (uint32_t i = 0; i < block.vptx.size(); ++i) {
+        const auto &pBaseTx = block.vptx[i];
+        if (pBaseTx->IsBlockRewardTx() || pBaseTx->IsPriceMedianTx())
+            prefilledTxs.push_back({i, pBaseTx});
+        else
+            shortTxids.push_back(GetShortId(pBaseTx->GetHash()));
+    }
+}
+
+void CBlockHeaderAndShortTxIDs::FillShortIdKeys() const {
+    uint256 blockHash = header.GetHash();
+    uint256 key       = Hash(BEGIN(blockHash), END(blockHash), BEGIN(nonce), END(nonce));
+    shortIdKey0       = key.GetUint64(0);
+    shortIdKey1       = key.GetUint64(1);
+    fHaveKeys         = true;
+}
+
+uint64_t CBlockHeaderAndShortTxIDs::GetShortId(const uint256 &txid) const {
+    if (!fHaveKeys)
+        FillShortIdKeys();
+
+    return SipHashUint256(shortIdKey0, shortIdKey1, txid) & 0xffffffffffffL;
+}
+
+CPartialBlock::ReadStatus CPartialBlock::InitData(const CBlockHeaderAndShortTxIDs &cmpctBlock) {
+    // a block has the reward tx at least, and any serialized tx takes more than 10 bytes
+    if (cmpctBlock.BlockTxCount() == 0 || cmpctBlock.BlockTxCount() > MAX_BLOCK_SIZE / 10)
+        return READ_STATUS_INVALID;
+
+    header = cmpctBlock.header;
+    vptx.assign(cmpctBlock.BlockTxCount(), nullptr);
+
+    int32_t lastIndex = -1;
+    for (const auto &prefilled : cmpctBlock.prefilledTxs) {
+        if (prefilled.tx == nullptr || (int32_t)prefilled.index <= lastIndex || prefilled.index >= vptx.size())
+            return READ_STATUS_INVALID;
+
+        vptx[prefilled.index] = prefilled.tx;
+        lastIndex             = prefilled.index;
+    }
+
+    // short id -> position in the block of the txs left
+    unordered_map<uint64_t, uint32_t> shortIdIndex;
+    shortIdIndex.reserve(cmpctBlock.shortTxids.size());
+    uint32_t index = 0;
+    for (uint64_t shortId : cmpctBlock.shortTxids) {
+        while (vptx[index] != nullptr)
+            ++index;
+
+        // two txs of the block with the same short id can not be told apart, fetch the full block
+        if (!shortIdIndex.emplace(shortId, index++).second)
+            return READ_STATUS_FAILED;
+    }
+
+    // a short id matching several mempool txs is left empty and requested with the missing txs
+    vector<bool> vCollided(vptx.size(), false);
+    {
+        LOCK(pool.cs);
+        for (const auto &item : pool.memPoolTxs) {
+            auto it = shortIdIndex.find(cmpctBlock.GetShortId(item.first));
+            if (it == shortIdIndex.end() || vCollided[it->second])
+                continue;
+
+            // copy the tx, the block must not share objects with the mempool
+            auto &pBaseTx = vptx[it->second];
+            if (pBaseTx == nullptr) {
+                pBaseTx = item.second.GetTransaction()->GetNewInstance();
+            } else {
+                pBaseTx               = nullptr;
+                vCollided[it->second] = true;
+            }
+        }
+    }
+
+    LogPrint(BCLog::NET, "init compact block %s height=%d, txs=%u, prefilled=%u, from mempool=%u\n",
+             header.GetHash().GetHex(), header.GetHeight(), vptx.size(), cmpctBlock.prefilledTxs.size(),
+             vptx.size() - cmpctBlock.prefilledTxs.size() - GetMissingIndexes().size());
+
+    return READ_STATUS_OK;
+}
+
+vector<uint32_t> CPartialBlock::GetMissingIndexes() const {
+    vector<uint32_t> indexes;
+    for (uint32_t i = 0; i < vptx.size(); ++i) {
+        if (vptx[i] == nullptr)
+            indexes.push_back(i);
+    }
+    return indexes;
+}
+
+CPartialBlock::ReadStatus CPartialBlock::FillBlock(CBlock &block,
+                                                   const vector<shared_ptr<CBaseTx>> &vMissingTx) const {
+    if (vptx.empty())
+        return READ_STATUS_INVALID;
+
+    block.SetNull();
+    *(CBlockHeader *)&block = header;
+    block.vptx.reserve(vptx.size());
+
+    size_t missingIndex = 0;
+    for (const auto &pBaseTx : vptx) {
+        if (pBaseTx != nullptr) {
+            block.vptx.push_back(pBaseTx);
+        } else {
+            if (missingIndex >= vMissingTx.size() || vMissingTx[missingIndex] == nullptr)
+                return READ_STATUS_INVALID;
+
+            block.vptx.push_back(vMissingTx[missingIndex++]);
+        }
+    }
+    if (missingIndex != vMissingTx.size())
+        return READ_STATUS_INVALID;
+
+    // a merkle mismatch is a short id collision with a mempool tx as likely as a bad block, get the full block
+    if (block.ComputeMerkleRoot() != header.GetMerkleRootHash())
+        return READ_STATUS_FAILED;
+
+    return READ_STATUS_OK;
+}
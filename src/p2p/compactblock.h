@@ -0,0 +1,153 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_COMPACTBLOCK_H
+#define P2P_COMPACTBLOCK_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+#include "persistence/block.h"
+
+#include <memory>
+#include <vector>
+
+class CBaseTx;
+class CTxMemPool;
+
+/** A transaction sent along with a compact block, in general a tx the receiver cannot have in its mempool */
+struct CPrefilledTx {
+    uint32_t index;  // position in the block
+    std::shared_ptr<CBaseTx> tx;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(VARINT(index));
+        READWRITE(tx);
+    )
+};
+
+/**
+ * The short ids of a compact block, serialized in SHORTTXIDS_LENGTH bytes each. They are SipHash-2-4
+ * of the txid keyed by the block hash and a nonce of the sender, so that a peer can not craft txs
+ * colliding in all compact blocks.
+ */
+class CShortTxIds {
+public:
+    static const int32_t SHORTTXIDS_LENGTH = 6;
+
+    std::vector<uint64_t> &ids;
+
+    explicit CShortTxIds(std::vector<uint64_t> &idsIn) : ids(idsIn) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        return GetSizeOfCompactSize(ids.size()) + ids.size() * SHORTTXIDS_LENGTH;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream &s, int nType, int nVersion) const {
+        WriteCompactSize(s, ids.size());
+        for (uint64_t id : ids) {
+            uint8_t bytes[SHORTTXIDS_LENGTH];
+            for (int32_t i = 0; i < SHORTTXIDS_LENGTH; ++i)
+                bytes[i] = (id >> (8 * i)) & 0xff;
+            s.write((char *)bytes, SHORTTXIDS_LENGTH);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersion) {
+        uint64_t count = ReadCompactSize(s);
+        ids.clear();
+        while (ids.size() < count) {
+            // grow in steps, the count is not trusted
+            ids.reserve(std::min<uint64_t>(count, ids.size() + 4096));
+            uint8_t bytes[SHORTTXIDS_LENGTH];
+            s.read((char *)bytes, SHORTTXIDS_LENGTH);
+            uint64_t id = 0;
+            for (int32_t i = 0; i < SHORTTXIDS_LENGTH; ++i)
+                id |= (uint64_t)bytes[i] << (8 * i);
+            ids.push_back(id);
+        }
+    }
+};
+
+/** The cmpctblock message: the header, short ids of the txs and the txs the receiver is not expected to have */
+class CBlockHeaderAndShortTxIDs {
+public:
+    CBlockHeader header;
+    uint64_t nonce;
+    std::vector<uint64_t> shortTxids;
+    std::vector<CPrefilledTx> prefilledTxs;
+
+public:
+    CBlockHeaderAndShortTxIDs() : nonce(0) {}
+    explicit CBlockHeaderAndShortTxIDs(const CBlock &block);
+
+    uint64_t GetShortId(const uint256 &txid) const;
+    size_t BlockTxCount() const { return shortTxids.size() + prefilledTxs.size(); }
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(header);
+        READWRITE(nonce);
+        READWRITE(REF(CShortTxIds(REF(shortTxids))));
+        READWRITE(prefilledTxs);
+    )
+
+private:
+    void FillShortIdKeys() const;
+
+    mutable uint64_t shortIdKey0;
+    mutable uint64_t shortIdKey1;
+    mutable bool fHaveKeys = false;
+};
+
+/** The getblocktxn message: the positions in a block of the txs missing to rebuild it */
+class CBlockTransactionsRequest {
+public:
+    uint256 blockHash;
+    std::vector<uint32_t> indexes;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(indexes);
+    )
+};
+
+/** The blocktxn message: the txs of a block requested by getblocktxn, in the requested order */
+class CBlockTransactions {
+public:
+    uint256 blockHash;
+    std::vector<std::shared_ptr<CBaseTx>> txs;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(txs);
+    )
+};
+
+/** A compact block being rebuilt from the mempool, until the missing txs arrive */
+class CPartialBlock {
+public:
+    enum ReadStatus {
+        READ_STATUS_OK,
+        READ_STATUS_INVALID,  // the message is invalid, the peer misbehaves
+        READ_STATUS_FAILED,   // the block can not be rebuilt, e.g. short id collisions, get the full block
+    };
+
+    explicit CPartialBlock(const CTxMemPool &poolIn) : pool(poolIn) {}
+
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs &cmpctBlock);
+    bool IsTxAvailable(size_t index) const { return index < vptx.size() && vptx[index] != nullptr; }
+    // positions of the txs still missing
+    std::vector<uint32_t> GetMissingIndexes() const;
+    ReadStatus FillBlock(CBlock &block, const std::vector<std::shared_ptr<CBaseTx>> &vMissingTx) const;
+
+    const CBlockHeader &GetHeader() const { return header; }
+
+private:
+    const CTxMemPool &pool;
+    CBlockHeader header;
+    std::vector<std::shared_ptr<CBaseTx>> vptx;
+};
+
+#endif  // P2P_COMPACTBLOCK_H
@@ -0,0 +1,172 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "headerchain.h"
+
+#include "main.h"
+#include "logging.h"
+
+using namespace std;
+
+CHeaderChain headerChain;
+
+bool CHeaderChain::AcceptHeaders(const vector<CBlock> &vHeaders, const CBlockIndex *pTip, int32_t &nDoS,
+                                 string &reason) {
+    nDoS = 0;
+    if (vHeaders.size() > MAX_HEADERS_RESULTS) {
+        nDoS   = 20;
+        reason = "too-many-headers";
+        return false;
+    }
+    if (vHeaders.empty())
+        return true;
+
+    uint256 prevHash = vHeaders.front().GetPrevBlockHash();
+    int32_t prevHeight;
+    if (!FindHeight(prevHash, prevHeight)) {
+        reason = "headers-not-connected";
+        return false;
+    }
+
+    int32_t maxHeight = (pTip ? pTip->height : 0) + MAX_HEADERS_AHEAD_OF_TIP;
+    fMoreHeaders      = false;
+    for (const auto &header : vHeaders) {
+        if (header.GetPrevBlockHash() != prevHash) {
+            nDoS   = 20;
+            reason = "non-continuous-headers";
+            return false;
+        }
+        if ((int32_t)header.GetHeight() != prevHeight + 1) {
+            nDoS   = 20;
+            reason = "bad-header-height";
+            return false;
+        }
+        if (header.GetBlockTime() > GetAdjustedTime() + ::GetBlockInterval(header.GetHeight()) + 2) {
+            reason = "header-time-too-new";
+            return false;
+        }
+        if (prevHeight + 1 > maxHeight) {
+            fMoreHeaders = true;
+            break;
+        }
+
+        uint256 hash = header.GetHash();
+        if (!mapBlockIndex.count(hash))
+            headers.emplace(hash, CHeaderEntry{prevHash, prevHeight + 1});
+
+        prevHash = hash;
+        ++prevHeight;
+    }
+    if (vHeaders.size() == MAX_HEADERS_RESULTS)
+        fMoreHeaders = true;
+
+    if (prevHeight > nBestHeight && headers.count(prevHash))
+        SetBest(prevHash, prevHeight);
+
+    return true;
+}
+
+bool CHeaderChain::FindHeight(const uint256 &hash, int32_t &height) const {
+    auto it = headers.find(hash);
+    if (it != headers.end()) {
+        height = it->second.height;
+        return true;
+    }
+
+    auto mi = mapBlockIndex.find(hash);
+    if (mi != mapBlockIndex.end()) {
+        height = mi->second->height;
+        return true;
+    }
+    return false;
+}
+
+void CHeaderChain::SetBest(const uint256 &hash, int32_t height) {
+    // walk back from the new best header until joining the current best chain or the block index
+    vector<uint256> vNew;
+    uint256 curHash    = hash;
+    int32_t curHeight  = height;
+    bool fJoined       = false;
+    while (true) {
+        int32_t index = curHeight - nBaseHeight - 1;
+        if (index >= 0 && index < (int32_t)vBestChain.size() && vBestChain[index] == curHash) {
+            fJoined = true;
+            break;
+        }
+        auto it = headers.find(curHash);
+        if (it == headers.end())
+            break;
+
+        vNew.push_back(curHash);
+        curHash = it->second.prevHash;
+        --curHeight;
+    }
+
+    if (fJoined) {
+        vBestChain.resize(curHeight - nBaseHeight);
+    } else {
+        nBaseHeight = curHeight;
+        vBestChain.clear();
+    }
+    vBestChain.insert(vBestChain.end(), vNew.rbegin(), vNew.rend());
+    nBestHeight = height;
+}
+
+CBlockLocator CHeaderChain::GetLocator(const CChain &chain) const {
+    CBlockLocator locator = chain.GetLocator();
+    if (!vBestChain.empty())
+        locator.vHave.insert(locator.vHave.begin(), vBestChain.back());
+    return locator;
+}
+
+void CHeaderChain::GetHashes(int32_t fromHeight, int32_t toHeight, vector<pair<int32_t, uint256>> &hashes) const {
+    int32_t begin = max(fromHeight, nBaseHeight) + 1;
+    int32_t end   = min(toHeight, nBaseHeight + (int32_t)vBestChain.size());
+    for (int32_t height = begin; height <= end; ++height)
+        hashes.emplace_back(height, vBestChain[height - nBaseHeight - 1]);
+}
+
+bool CHeaderChain::GetBestHash(int32_t height, uint256 &hash) const {
+    if (height <= nBaseHeight || height > nBaseHeight + (int32_t)vBestChain.size())
+        return false;
+    hash = vBestChain[height - nBaseHeight - 1];
+    return true;
+}
+
+void CHeaderChain::Prune(const CBlockIndex *pTip) {
+    if (pTip == nullptr || pTip->height <= nBaseHeight)
+        return;
+
+    int32_t index = pTip->height - nBaseHeight - 1;
+    if (index >= (int32_t)vBestChain.size() || vBestChain[index] != pTip->GetBlockHash())
+        return;  // the tip is not on the best header chain (yet)
+
+    vBestChain.erase(vBestChain.begin(), vBestChain.begin() + index + 1);
+    nBaseHeight = pTip->height;
+
+    if (vBestChain.empty()) {
+        LogPrint(BCLog::NET, "headers sync reached the best header, height=%d\n", nBestHeight);
+        headers.clear();
+        return;
+    }
+
+    // forget the connected headers and the side branches below the tip now and then
+    if (headers.size() > vBestChain.size() + MAX_HEADERS_RESULTS) {
+        for (auto it = headers.begin(); it != headers.end();) {
+            if (it->second.height <= nBaseHeight)
+                it = headers.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+void CHeaderChain::Clear() {
+    headers.clear();
+    vBestChain.clear();
+    nBaseHeight  = -1;
+    nBestHeight  = -1;
+    syncPeer     = -1;
+    fMoreHeaders = false;
+}
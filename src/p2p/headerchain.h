@@ -0,0 +1,92 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_HEADERCHAIN_H
+#define P2P_HEADERCHAIN_H
+
+#include "chain/chain.h"
+#include "commons/uint256.h"
+#include "persistence/block.h"
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Block headers received by headers-first sync whose blocks are not connected yet.
+ *
+ * The headers are checked for linkage, height and time only. The signature of a header needs the
+ * delegates of its height, which are known once the chain state reaches it, so it is verified when
+ * the block itself connects. To bound the memory a peer can make us spend on headers, the chain is
+ * never extended more than MAX_HEADERS_AHEAD_OF_TIP blocks beyond the active tip.
+ *
+ * Protected by cs_main.
+ */
+class CHeaderChain {
+public:
+    static const int32_t MAX_HEADERS_AHEAD_OF_TIP = 50000;
+
+    CHeaderChain() : nBaseHeight(-1), nBestHeight(-1), syncPeer(-1), nLastRequestTime(0), fMoreHeaders(false) {}
+
+    // Add the headers of a headers message. Return false if they are rejected, with nDoS set for a
+    // misbehaving peer. Headers beyond the allowed lead are dropped, see HasMoreHeaders.
+    bool AcceptHeaders(const std::vector<CBlock> &vHeaders, const CBlockIndex *pTip, int32_t &nDoS,
+                       std::string &reason);
+
+    bool Have(const uint256 &hash) const { return headers.count(hash) > 0; }
+
+    // Height of the best header, -1 if there is none
+    int32_t GetBestHeight() const { return nBestHeight; }
+    bool IsSyncing(const CBlockIndex *pTip) const { return pTip != nullptr && nBestHeight > pTip->height; }
+
+    // Locator of the best header, for the getheaders continuing the sync
+    CBlockLocator GetLocator(const CChain &chain) const;
+
+    // Append the (height, hash) pairs of the best header chain in (fromHeight, toHeight] to hashes
+    void GetHashes(int32_t fromHeight, int32_t toHeight, std::vector<std::pair<int32_t, uint256>> &hashes) const;
+
+    // Hash of the best header chain at the height, false if it is at or below the pruned base or above the best
+    bool GetBestHash(int32_t height, uint256 &hash) const;
+
+    // Forget the headers up to the tip once the tip has joined the best header chain
+    void Prune(const CBlockIndex *pTip);
+
+    void Clear();
+
+    // Peer syncing the headers, -1 if none
+    int32_t GetSyncPeer() const { return syncPeer; }
+    void SetSyncPeer(int32_t peer, int64_t nNow) {
+        syncPeer         = peer;
+        nLastRequestTime = nNow;
+    }
+    int64_t GetLastRequestTime() const { return nLastRequestTime; }
+
+    // Whether the last full headers message was cut short, more headers are requested once the tip approaches
+    bool HasMoreHeaders() const { return fMoreHeaders; }
+
+private:
+    struct CHeaderEntry {
+        uint256 prevHash;
+        int32_t height;
+    };
+
+    bool FindHeight(const uint256 &hash, int32_t &height) const;
+    void SetBest(const uint256 &hash, int32_t height);
+
+    std::unordered_map<uint256, CHeaderEntry, CSaltedUint256Hasher> headers;
+    // best header chain, the element i is the hash at height nBaseHeight + 1 + i
+    std::deque<uint256> vBestChain;
+    int32_t nBaseHeight;
+    int32_t nBestHeight;
+
+    int32_t syncPeer;
+    int64_t nLastRequestTime;
+    bool fMoreHeaders;
+};
+
+extern CHeaderChain headerChain;
+
+#endif  // P2P_HEADERCHAIN_H
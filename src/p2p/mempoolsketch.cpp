@@ -0,0 +1,132 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "mempoolsketch.h"
+
+#include "crypto/siphash.h"
+
+#include <openssl/rand.h>
+
+#include <cassert>
+#include <deque>
+#include <unordered_set>
+
+using namespace std;
+
+// the finalizer of splitmix64, the ids are keyed by the sketch already
+static uint64_t MixShortId(uint64_t shortId, uint64_t seed) {
+    uint64_t x = shortId + (seed + 1) * 0x9e3779b97f4a7c15ULL;
+    x          = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x          = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+CMemPoolSketch::CMemPoolSketch(const vector<uint256> &txids) {
+    RAND_bytes((uint8_t *)&shortIdKey0, sizeof(shortIdKey0));
+    RAND_bytes((uint8_t *)&shortIdKey1, sizeof(shortIdKey1));
+
+    Init(min<uint64_t>(MIN_MEMPOOL_SKETCH_CELLS + txids.size() / 2, MAX_MEMPOOL_SKETCH_CELLS));
+    for (const auto &txid : txids)
+        Insert(GetShortId(txid));
+}
+
+CMemPoolSketch::CMemPoolSketch(const CMemPoolSketch &other, const vector<uint256> &txids)
+    : shortIdKey0(other.shortIdKey0), shortIdKey1(other.shortIdKey1) {
+    Init(other.cells.size());
+    for (const auto &txid : txids)
+        Insert(GetShortId(txid));
+}
+
+void CMemPoolSketch::Init(uint32_t cellCount) {
+    cellCount = (cellCount + MEMPOOL_SKETCH_HASH_COUNT - 1) / MEMPOOL_SKETCH_HASH_COUNT * MEMPOOL_SKETCH_HASH_COUNT;
+    cells.assign(cellCount, CCell());
+}
+
+bool CMemPoolSketch::IsValid() const {
+    return cells.size() >= MIN_MEMPOOL_SKETCH_CELLS && cells.size() % MEMPOOL_SKETCH_HASH_COUNT == 0 &&
+           cells.size() <= MAX_MEMPOOL_SKETCH_CELLS + MEMPOOL_SKETCH_HASH_COUNT;
+}
+
+uint64_t CMemPoolSketch::GetShortId(const uint256 &txid) const {
+    return SipHashUint256(shortIdKey0, shortIdKey1, txid);
+}
+
+uint32_t CMemPoolSketch::GetCell(uint64_t shortId, uint32_t i) const {
+    uint32_t partSize = cells.size() / MEMPOOL_SKETCH_HASH_COUNT;
+    return i * partSize + MixShortId(shortId, i) % partSize;
+}
+
+void CMemPoolSketch::Toggle(CCell &cell, uint64_t shortId, int32_t count) {
+    cell.count += count;
+    cell.idSum ^= shortId;
+    cell.hashSum ^= MixShortId(shortId, MEMPOOL_SKETCH_HASH_COUNT);
+}
+
+void CMemPoolSketch::Insert(uint64_t shortId) {
+    for (uint32_t i = 0; i < MEMPOOL_SKETCH_HASH_COUNT; i++)
+        Toggle(cells[GetCell(shortId, i)], shortId, 1);
+}
+
+void CMemPoolSketch::Subtract(const CMemPoolSketch &other) {
+    assert(cells.size() == other.cells.size());
+    for (size_t i = 0; i < cells.size(); i++) {
+        cells[i].count -= other.cells[i].count;
+        cells[i].idSum ^= other.cells[i].idSum;
+        cells[i].hashSum ^= other.cells[i].hashSum;
+    }
+}
+
+bool CMemPoolSketch::Decode(vector<uint64_t> &ours, vector<uint64_t> &theirs, bool &fMalformed) const {
+    fMalformed = false;
+    CMemPoolSketch diff(*this);
+    // the keys are chosen by the peer, a cell is only taken as single if it is one of the cells of its id
+    auto IsPure = [&diff](uint32_t index) {
+        const CCell &cell = diff.cells[index];
+        if ((cell.count != 1 && cell.count != -1) ||
+            cell.hashSum != MixShortId(cell.idSum, MEMPOOL_SKETCH_HASH_COUNT))
+            return false;
+
+        for (uint32_t i = 0; i < MEMPOOL_SKETCH_HASH_COUNT; i++) {
+            if (diff.GetCell(cell.idSum, i) == index)
+                return true;
+        }
+        return false;
+    };
+
+    deque<uint32_t> pureCells;
+    for (uint32_t index = 0; index < diff.cells.size(); index++) {
+        if (IsPure(index))
+            pureCells.push_back(index);
+    }
+
+    // peel the cells of a single id, removing it from its other cells may leave them single. Each id of the
+    // difference is peeled once and clears at least one cell, a sketch peeling more ids is crafted.
+    unordered_set<uint64_t> peeled;
+    while (!pureCells.empty()) {
+        uint32_t index = pureCells.front();
+        pureCells.pop_front();
+        if (!IsPure(index))
+            continue;
+
+        uint64_t shortId = diff.cells[index].idSum;
+        int32_t count    = diff.cells[index].count;
+        if (peeled.size() >= diff.cells.size() || !peeled.insert(shortId).second) {
+            fMalformed = true;
+            return false;
+        }
+        (count > 0 ? ours : theirs).push_back(shortId);
+        for (uint32_t i = 0; i < MEMPOOL_SKETCH_HASH_COUNT; i++) {
+            uint32_t cell = diff.GetCell(shortId, i);
+            Toggle(diff.cells[cell], shortId, -count);
+            if (IsPure(cell))
+                pureCells.push_back(cell);
+        }
+    }
+
+    for (const auto &cell : diff.cells) {
+        if (!cell.IsEmpty())
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_MEMPOOLSKETCH_H
+#define P2P_MEMPOOLSKETCH_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+
+#include <vector>
+
+// the cells each short id is added to, one in each third of the sketch
+static const uint32_t MEMPOOL_SKETCH_HASH_COUNT = 3;
+static const uint32_t MIN_MEMPOOL_SKETCH_CELLS  = 60;
+static const uint32_t MAX_MEMPOOL_SKETCH_CELLS  = 30000;  // 600KB
+
+/**
+ * The mempoolsketch message: an invertible bloom lookup table of the short ids of the txs of a mempool.
+ * The peers exchange their sketches once connected, each side subtracts the sketch of the other from its
+ * own with the same keys and peels the difference: the ids left with a count of 1 are the txs the other
+ * side misses and are announced by inv, the ones with -1 are announced by the other side. The sketch has a
+ * cell for every two txs, a larger difference fails to decode and the whole mempool is announced instead.
+ */
+class CMemPoolSketch {
+public:
+    CMemPoolSketch() : shortIdKey0(0), shortIdKey1(0) {}
+    // the sketch of the txids, with new keys
+    explicit CMemPoolSketch(const std::vector<uint256> &txids);
+    // the sketch of the txids with the keys and the size of the other, to be compared with it
+    CMemPoolSketch(const CMemPoolSketch &other, const std::vector<uint256> &txids);
+
+    bool IsValid() const;
+    uint64_t GetShortId(const uint256 &txid) const;
+    void Insert(uint64_t shortId);
+    // remove the ids of the other sketch of the same keys and size
+    void Subtract(const CMemPoolSketch &other);
+    // the ids of the difference, false if it is too large to decode or if the sketch of the other is malformed,
+    // i.e. a cell claims an id it is not a cell of or an id is peeled twice
+    bool Decode(std::vector<uint64_t> &ours, std::vector<uint64_t> &theirs, bool &fMalformed) const;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(shortIdKey0);
+        READWRITE(shortIdKey1);
+        READWRITE(cells);
+    )
+
+private:
+    struct CCell {
+        int32_t count;
+        uint64_t idSum;    // xor of the ids
+        uint64_t hashSum;  // xor of the hashes of the ids, tells the cells of a single id
+
+        CCell() : count(0), idSum(0), hashSum(0) {}
+
+        bool IsEmpty() const { return count == 0 && idSum == 0 && hashSum == 0; }
+
+        IMPLEMENT_SERIALIZE(
+            READWRITE(count);
+            READWRITE(idSum);
+            READWRITE(hashSum);
+        )
+    };
+
+    void Init(uint32_t cellCount);
+    uint32_t GetCell(uint64_t shortId, uint32_t i) const;
+    static void Toggle(CCell &cell, uint64_t shortId, int32_t count);
+
+    uint64_t shortIdKey0;
+    uint64_t shortIdKey1;
+    std::vector<CCell> cells;
+};
+
+#endif  // P2P_MEMPOOLSKETCH_H
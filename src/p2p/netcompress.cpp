@@ -0,0 +1,217 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netcompress.h"
+
+#include "commons/util/util.h"
+#include "config/configuration.h"
+#include "config/const.h"
+#include "p2p/node.h"
+
+#include <deque>
+#include <mutex>
+
+#include <zlib.h>
+
+using namespace std;
+
+namespace {
+
+// the wrappers of the recent messages, a block relayed to all the peers is compressed once
+const size_t MAX_CACHED_COMPRESSIONS = 16;
+
+struct CCachedCompression {
+    weak_ptr<const CSerializeData> wpMsg;
+    CSharedNetMsg spResult;  // the wrapper, or the message itself if it does not shrink
+};
+
+std::mutex cacheMutex;
+deque<CCachedCompression> cachedCompressions;
+
+std::mutex totalsMutex;
+CNetCompressStats totalSent;
+CNetCompressStats totalReceived;
+
+// The preset dictionary of NET_COMPRESS_ZLIB_DICT. zlib looks the matches up from the end of it, the
+// most common strings come last: the serialized token symbols and the runs of zero bytes of the
+// amounts, the hashes of the empty fields and the padding.
+const string &GetDictionary() {
+    static const string dictionary = []() {
+        string dict;
+        for (const char *symbol : {"EUR", "GOLD", "KWH", "USDT", "BTC", "CNY", "USD", "WEOS", "WETH", "WBTC",
+                                   "WCNY", "WGRT", "WUSD", "WICC"}) {
+            dict += (char)strlen(symbol);
+            dict += symbol;
+        }
+        dict += string(64, '\0');
+        return dict;
+    }();
+    return dictionary;
+}
+
+bool Deflate(const char *data, size_t size, vector<char> &out) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, Z_BEST_SPEED, Z_DEFLATED, MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    const string &dict = GetDictionary();
+    bool fOk = deflateSetDictionary(&strm, (const Bytef *)dict.data(), dict.size()) == Z_OK;
+    if (fOk) {
+        out.resize(deflateBound(&strm, size));
+        strm.next_in   = (Bytef *)data;
+        strm.avail_in  = size;
+        strm.next_out  = (Bytef *)out.data();
+        strm.avail_out = out.size();
+        fOk = deflate(&strm, Z_FINISH) == Z_STREAM_END;
+        out.resize(strm.total_out);
+    }
+    deflateEnd(&strm);
+    return fOk;
+}
+
+bool Inflate(const char *data, size_t size, CSerializeData &out) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, MAX_WBITS) != Z_OK)
+        return false;
+
+    // the output is sized by the sender, a longer stream fails with Z_BUF_ERROR
+    strm.next_in   = (Bytef *)data;
+    strm.avail_in  = size;
+    strm.next_out  = (Bytef *)out.data();
+    strm.avail_out = out.size();
+    int ret = inflate(&strm, Z_FINISH);
+    if (ret == Z_NEED_DICT) {
+        const string &dict = GetDictionary();
+        if (inflateSetDictionary(&strm, (const Bytef *)dict.data(), dict.size()) == Z_OK)
+            ret = inflate(&strm, Z_FINISH);
+    }
+    bool fOk = ret == Z_STREAM_END && strm.total_out == out.size() && strm.avail_in == 0;
+    inflateEnd(&strm);
+    return fOk;
+}
+
+CSharedNetMsg WrapNetMsg(const CSharedNetMsg &spMsg, const string &command) {
+    const char *pPayload = spMsg->data() + CMessageHeader::HEADER_SIZE;
+    uint32_t payloadSize = spMsg->size() - CMessageHeader::HEADER_SIZE;
+    vector<char> compressed;
+    if (!Deflate(pPayload, payloadSize, compressed))
+        return spMsg;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss.reserve(CMessageHeader::HEADER_SIZE + command.size() + 6 + compressed.size());
+    ss << CMessageHeader(NetMsgType::COMPRESSED, 0) << command << NET_COMPRESS_ZLIB_DICT << payloadSize;
+    ss.write(compressed.data(), compressed.size());
+    if (ss.size() >= spMsg->size())
+        return spMsg;
+
+    SetNetMsgHeader(ss);
+    auto spWrapper = std::make_shared<CSerializeData>();
+    ss.swap(*spWrapper);
+    return spWrapper;
+}
+
+}  // namespace
+
+bool IsNetCompressEnabled() {
+    static const bool fEnabled = SysCfg().GetBoolArg("-p2pcompress", DEFAULT_P2P_COMPRESS);
+    return fEnabled;
+}
+
+bool IsCompressibleCommand(const string &command) {
+    return GetMaxUncompressedSize(command) > 0;
+}
+
+uint32_t GetMaxUncompressedSize(const string &command) {
+    if (command == NetMsgType::BLOCK || command == NetMsgType::CMPCTBLOCK || command == NetMsgType::BLOCKTXN)
+        return MAX_BLOCK_SIZE;
+    if (command == NetMsgType::TX)
+        return MAX_STANDARD_TX_SIZE;
+    if (command == NetMsgType::HEADERS)
+        return 9 + MAX_HEADERS_RESULTS * MAX_NET_HEADER_SIZE;
+    return 0;
+}
+
+uint32_t GetUncompressedSize(const CNetMessage &msg) {
+    uint32_t size = msg.vRecv.size();
+    if (!msg.complete() || msg.hdr.GetCommand() != NetMsgType::COMPRESSED)
+        return size;
+
+    // the inner command is a short string, then come the codec and the inner payload size
+    const CDataStream &vRecv = msg.vRecv;
+    uint32_t commandSize     = size > 0 ? (uint8_t)vRecv[0] : 0;
+    if (commandSize >= 253 || size < 1 + commandSize + 1 + 4)
+        return size;
+
+    uint32_t payloadSize = 0;
+    memcpy(&payloadSize, &vRecv[1 + commandSize + 1], sizeof(payloadSize));
+    payloadSize = le32toh(payloadSize);
+    return std::max(size, std::min(payloadSize, MAX_BLOCK_SIZE));
+}
+
+CSharedNetMsg CompressNetMsg(const CSharedNetMsg &spMsg, CNetCompressStats &stats) {
+    uint32_t payloadSize = spMsg->size() - CMessageHeader::HEADER_SIZE;
+    if (payloadSize < MIN_NET_COMPRESS_SIZE)
+        return spMsg;
+
+    CSharedNetMsg spResult;
+    uint64_t micros = 0;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        for (const auto &entry : cachedCompressions) {
+            if (entry.wpMsg.lock() == spMsg) {
+                spResult = entry.spResult;
+                break;
+            }
+        }
+    }
+    if (!spResult) {
+        int64_t beginTime = GetTimeMicros();
+        string command = CNode::GetCommand(*spMsg);
+        // the receivers refuse to unwrap a larger payload
+        spResult = payloadSize <= GetMaxUncompressedSize(command) ? WrapNetMsg(spMsg, command) : spMsg;
+        micros   = GetTimeMicros() - beginTime;
+
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        cachedCompressions.push_back({spMsg, spResult});
+        if (cachedCompressions.size() > MAX_CACHED_COMPRESSIONS)
+            cachedCompressions.pop_front();
+    }
+    if (spResult == spMsg)
+        return spMsg;
+
+    uint64_t wireSize = spResult->size() - CMessageHeader::HEADER_SIZE;
+    stats.Add(payloadSize, wireSize, micros);
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    totalSent.Add(payloadSize, wireSize, micros);
+    return spResult;
+}
+
+bool UncompressNetMsg(CDataStream &vRecv, string &command, CDataStream &vPayload, CNetCompressStats &stats) {
+    uint8_t codec        = 0;
+    uint32_t payloadSize = 0;
+    vRecv >> command >> codec >> payloadSize;
+    if (codec != NET_COMPRESS_ZLIB_DICT || payloadSize == 0 || payloadSize > GetMaxUncompressedSize(command))
+        return false;
+
+    int64_t beginTime = GetTimeMicros();
+    uint64_t wireSize = vRecv.size();
+    CSerializeData payload(payloadSize);
+    if (!Inflate(vRecv.empty() ? nullptr : &vRecv[0], wireSize, payload))
+        return false;
+    vPayload.swap(payload);
+    uint64_t micros = GetTimeMicros() - beginTime;
+
+    stats.Add(payloadSize, wireSize, micros);
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    totalReceived.Add(payloadSize, wireSize, micros);
+    return true;
+}
+
+void GetNetCompressTotals(CNetCompressStats &sent, CNetCompressStats &received) {
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    sent     = totalSent;
+    received = totalReceived;
+}
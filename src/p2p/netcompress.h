@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_NETCOMPRESS_H
+#define P2P_NETCOMPRESS_H
+
+#include "commons/serialize.h"
+#include "p2p/netmessage.h"
+
+#include <stdint.h>
+
+#include <string>
+
+/**
+ * Compression of the block, tx and headers payloads, negotiated per connection. A node accepting
+ * compressed messages says so with sendcompress and the codec version after verack. The messages to it
+ * may then be wrapped in a compressed message, whose payload is the inner command, the codec, the size
+ * of the inner payload and the compressed inner payload, all under the checksum of the wrapper. The
+ * receiver unwraps it and processes the inner message as if it came uncompressed, the peers not sending
+ * sendcompress never see a compressed message.
+ *
+ * The codec is zlib deflate with a preset dictionary of the byte strings common in the payloads, e.g.
+ * the token symbols, so even a small tx shrinks. A block relayed to many peers is compressed once, the
+ * wrappers of the recent shared messages are reused.
+ */
+
+/** codec of sendcompress and of the compressed messages, a new dictionary is a new version */
+static const uint8_t NET_COMPRESS_ZLIB_DICT = 1;
+/** payloads below it are sent as they are */
+static const uint32_t MIN_NET_COMPRESS_SIZE = 256;
+/** bound of a header of a headers message, i.e. the block header with its signature and the empty tx count */
+static const uint32_t MAX_NET_HEADER_SIZE = 256;
+
+struct CNetCompressStats {
+    uint64_t messages  = 0;  // the messages compressed or uncompressed
+    uint64_t rawBytes  = 0;  // the sizes of their inner payloads
+    uint64_t wireBytes = 0;  // the sizes of their compressed payloads
+    uint64_t micros    = 0;  // the cpu time of the compression or the uncompression
+
+    void Add(uint64_t raw, uint64_t wire, uint64_t us) {
+        messages++;
+        rawBytes += raw;
+        wireBytes += wire;
+        micros += us;
+    }
+};
+
+// Whether -p2pcompress is set to accept compressed messages and to announce it
+bool IsNetCompressEnabled();
+
+// The commands whose payloads are compressed to the peers that accept them
+bool IsCompressibleCommand(const std::string &command);
+
+// The largest payload of the command a compressed message may unwrap into, 0 for the commands never compressed.
+// The larger payloads are sent as they are.
+uint32_t GetMaxUncompressedSize(const std::string &command);
+
+// The size of the received message once unwrapped, the declared size of the inner payload for a compressed
+// message and the size of its payload for the others. The receive flood limit counts it.
+uint32_t GetUncompressedSize(const CNetMessage &msg);
+
+// The compressed message wrapping the message, or the message itself if its payload is small or does not
+// shrink. The compression of a message wrapped recently is reused.
+CSharedNetMsg CompressNetMsg(const CSharedNetMsg &spMsg, CNetCompressStats &stats);
+
+// Unwrap the payload of a compressed message into the inner command and its payload, false if it is
+// malformed, of another codec or of a command that is never compressed
+bool UncompressNetMsg(CDataStream &vRecv, std::string &command, CDataStream &vPayload, CNetCompressStats &stats);
+
+// The totals of all peers since the start
+void GetNetCompressTotals(CNetCompressStats &sent, CNetCompressStats &received);
+
+#endif  // P2P_NETCOMPRESS_H
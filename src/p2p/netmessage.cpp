@@ -5,6 +5,10 @@
 
 #include "netmessage.h"
 
+#include "config/const.h"
+
+#include <algorithm>
+
 int32_t CNetMessage::readHeader(const char* pch, uint32_t nBytes) {
     // copy data to temporary parsing buffer
     uint32_t nRemaining = 24 - nHdrPos;
@@ -28,9 +32,12 @@ int32_t CNetMessage::readHeader(const char* pch, uint32_t nBytes) {
     if (hdr.nMessageSize > MAX_SIZE)
         return -1;
 
-    // switch state to reading message data
+    // switch state to reading message data, into a pooled buffer sized by the header. The buffer
+    // grows as the data arrives, a header lying about the size costs a block sized buffer at most.
     in_data = true;
-    vRecv.resize(hdr.nMessageSize);
+    CSerializeData vch;
+    GetRecvBufferPool().Get(min<uint32_t>(hdr.nMessageSize, MAX_BLOCK_SIZE), vch);
+    vRecv.swap(vch);
 
     return nCopy;
 }
@@ -39,8 +46,57 @@ int32_t CNetMessage::readData(const char* pch, uint32_t nBytes) {
     uint32_t nRemaining = hdr.nMessageSize - nDataPos;
     uint32_t nCopy      = min(nRemaining, nBytes);
 
+    if (vRecv.size() < nDataPos + nCopy)
+        vRecv.resize(nDataPos + nCopy);
+
     memcpy(&vRecv[nDataPos], pch, nCopy);
     nDataPos += nCopy;
 
     return nCopy;
 }
+
+char* CNetMessage::GetDataSpace(uint32_t nMaxSize, uint32_t& nSize) {
+    nSize = min(hdr.nMessageSize - nDataPos, nMaxSize);
+    if (vRecv.size() < nDataPos + nSize)
+        vRecv.resize(nDataPos + nSize);
+
+    return nSize > 0 ? &vRecv[nDataPos] : nullptr;
+}
+
+void CRecvBufferPool::Get(size_t nCapacity, CSerializeData& vch) {
+    vch.clear();
+    if (nCapacity >= MIN_POOLED_BUFFER_SIZE) {
+        LOCK(cs);
+        // the smallest free buffer large enough
+        auto best = vFree.end();
+        for (auto it = vFree.begin(); it != vFree.end(); ++it) {
+            if (it->capacity() >= nCapacity && (best == vFree.end() || it->capacity() < best->capacity()))
+                best = it;
+        }
+        if (best != vFree.end()) {
+            vch.swap(*best);
+            vFree.erase(best);
+            return;
+        }
+    }
+    vch.reserve(nCapacity);
+}
+
+void CRecvBufferPool::Put(CSerializeData& vch) {
+    if (vch.capacity() >= MIN_POOLED_BUFFER_SIZE && vch.capacity() <= MAX_POOLED_BUFFER_SIZE) {
+        LOCK(cs);
+        if (vFree.size() < MAX_FREE_BUFFERS) {
+            vch.clear();
+            vFree.emplace_back();
+            vFree.back().swap(vch);
+            return;
+        }
+    }
+    CSerializeData().swap(vch);
+}
+
+CRecvBufferPool& GetRecvBufferPool() {
+    // never destroyed, the messages of the nodes still release their buffers at exit
+    static CRecvBufferPool* pPool = new CRecvBufferPool();
+    return *pPool;
+}
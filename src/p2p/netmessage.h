@@ -8,6 +8,35 @@
 
 #include "commons/serialize.h"
 #include "p2p/protocol.h"
+#include "sync.h"
+
+#include <memory>
+#include <vector>
+
+/** A complete wire message, header included, shared by the send queues of all the peers it goes to */
+typedef std::shared_ptr<const CSerializeData> CSharedNetMsg;
+
+/**
+ * Free list of the message receive buffers, so that the buffers of large messages as blocks are
+ * reused rather than allocated and released for every message.
+ */
+class CRecvBufferPool {
+public:
+    static const size_t MAX_FREE_BUFFERS       = 32;
+    static const size_t MIN_POOLED_BUFFER_SIZE = 4096;          // smaller buffers are cheap to allocate
+    static const size_t MAX_POOLED_BUFFER_SIZE = 8 * 1000000;   // twice a block at most
+
+    // Set vch to an empty buffer with a capacity of nCapacity bytes at least
+    void Get(size_t nCapacity, CSerializeData &vch);
+    // Take the buffer of vch back, vch is left empty
+    void Put(CSerializeData &vch);
+
+private:
+    CCriticalSection cs;
+    std::vector<CSerializeData> vFree;
+};
+
+CRecvBufferPool &GetRecvBufferPool();
 
 class CNetMessage {
 public:
@@ -20,11 +49,20 @@ public:
     CDataStream vRecv;  // received message data
     uint32_t nDataPos;
 
+    bool fProcessed;  // processed ahead of the messages queued before it
+
     CNetMessage(int32_t nTypeIn, int32_t nVersionIn) : hdrbuf(nTypeIn, nVersionIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
-        in_data  = false;
-        nHdrPos  = 0;
-        nDataPos = 0;
+        in_data    = false;
+        nHdrPos    = 0;
+        nDataPos   = 0;
+        fProcessed = false;
+    }
+
+    ~CNetMessage() {
+        CSerializeData vch;
+        vRecv.swap(vch);
+        GetRecvBufferPool().Put(vch);
     }
 
     bool complete() const {
@@ -40,6 +78,11 @@ public:
 
     int32_t readHeader(const char* pch, uint32_t nBytes);
     int32_t readData(const char* pch, uint32_t nBytes);
+
+    // Space for the next data bytes of at most nMaxSize, to receive them into the buffer without a copy.
+    // Commit the bytes received there with CommitData.
+    char* GetDataSpace(uint32_t nMaxSize, uint32_t& nSize);
+    void CommitData(uint32_t nBytes) { nDataPos += nBytes; }
 };
 
 
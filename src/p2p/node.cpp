@@ -22,6 +22,7 @@ CCriticalSection cs_mapNodeState;
 
 NodeId nLastNodeId = 0;
 limitedmap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
+CCriticalSection cs_mapAlreadyAskedFor;
 CNode* pnodeSync = nullptr;
 
 
@@ -36,12 +37,25 @@ CNodeState *State(NodeId pNode) {
     return &it->second;
 }
 
+void SetNetMsgHeader(CDataStream &ss) {
+    // Set the size
+    uint32_t nSize = ss.size() - CMessageHeader::HEADER_SIZE;
+    memcpy((char*)&ss[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
+
+    // Set the checksum
+    uint256 hash       = Hash(ss.begin() + CMessageHeader::HEADER_SIZE, ss.end());
+    uint32_t nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    assert(ss.size() >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
+    memcpy((char*)&ss[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+}
+
 // requires LOCK(cs_vSend)
 void CNode::SocketSendData() {
-    deque<CSerializeData>::iterator it = vSendMsg.begin();
+    deque<CSharedNetMsg>::iterator it = vSendMsg.begin();
 
     while (it != vSendMsg.end()) {
-        const CSerializeData& data = *it;
+        const CSerializeData& data = **it;
         assert(data.size() > nSendOffset);
         int32_t nBytes = send(hSocket, &data[nSendOffset], data.size() - nSendOffset,
                               MSG_NOSIGNAL | MSG_DONTWAIT);
@@ -76,9 +90,16 @@ void CNode::SocketSendData() {
         assert(nSendOffset == 0);
         assert(nSendSize == 0);
     }
+    nPrioritySendMsgs -= min<size_t>(nPrioritySendMsgs, it - vSendMsg.begin());
     vSendMsg.erase(vSendMsg.begin(), it);
 }
 
+bool CNode::IsPriorityCommand(const std::string& command) {
+    return command == NetMsgType::BLOCK || command == NetMsgType::CMPCTBLOCK || command == NetMsgType::BLOCKTXN ||
+           command == NetMsgType::CONFIRMBLOCK || command == NetMsgType::FINALITYBLOCK ||
+           command == NetMsgType::PBFTCERT;
+}
+
 
 
 // find 'best' local address for a particular peer
@@ -197,10 +218,30 @@ void CNode::copyStats(CNodeStats& stats) {
     X(nVersion);
     X(cleanSubVer);
     X(fInbound);
+    X(fPriority);
     X(nStartingHeight);
     X(nSendBytes);
     X(nRecvBytes);
     stats.fSyncNode = (this == pnodeSync);
+    X(nInvSent);
+    X(nTxInvBatches);
+    X(nTxInvShaped);
+    {
+        LOCK(cs_inventory);
+        stats.nTxInvQueued = vInventoryToSend.size();
+    }
+    X(fSendCompressed);
+    {
+        // not waited for, the locks are held while sending and processing the messages
+        TRY_LOCK(cs_vSend, lockSend);
+        if (lockSend)
+            X(compressSent);
+    }
+    {
+        TRY_LOCK(cs_vRecvMsg, lockRecv);
+        if (lockRecv)
+            X(compressRecv);
+    }
 
     // It is common for nodes with good ping times to suddenly become lagged,
     // due to a new block arriving or other large transfer.
@@ -227,7 +268,7 @@ void CNode::copyStats(CNodeStats& stats) {
 bool CNode::ReceiveMsgBytes(const char* pch, uint32_t nBytes) {
     while (nBytes > 0) {
         // get current incomplete message, or create a new one
-        if (vRecvMsg.empty() || vRecvMsg.back().complete()) vRecvMsg.push_back(CNetMessage(SER_NETWORK, nRecvVersion));
+        if (vRecvMsg.empty() || vRecvMsg.back().complete()) vRecvMsg.emplace_back(SER_NETWORK, nRecvVersion);
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -248,6 +289,19 @@ bool CNode::ReceiveMsgBytes(const char* pch, uint32_t nBytes) {
     return true;
 }
 
+char* CNode::GetRecvDataSpace(uint32_t nMaxSize, uint32_t& nSize) {
+    nSize = 0;
+    if (vRecvMsg.empty() || !vRecvMsg.back().in_data || vRecvMsg.back().complete())
+        return nullptr;
+
+    return vRecvMsg.back().GetDataSpace(nMaxSize, nSize);
+}
+
+void CNode::ReceiveDataBytes(uint32_t nBytes) {
+    assert(!vRecvMsg.empty() && vRecvMsg.back().in_data);
+    vRecvMsg.back().CommitData(nBytes);
+}
+
 
 void CNode::RecordBytesRecv(uint64_t bytes) {
     LOCK(cs_totalBytesRecv);
@@ -10,6 +10,7 @@
 #include <boost/signals2/signal.hpp>
 #include "commons/serialize.h"
 #include "sync.h"
+#include "metrics.h"
 #include "commons/compat/compat.h"
 #include "p2p/protocol.h"
 #include "commons/limitedmap.h"
@@ -17,6 +18,7 @@
 #include "commons/mruset.h"
 #include "commons/random.h"
 #include "p2p/netmessage.h"
+#include "p2p/netcompress.h"
 
 class CNode ;
 struct CNodeSignals;
@@ -40,6 +42,7 @@ static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 static const uint32_t MAX_ADDR_TO_SEND = 1000;
 
 extern limitedmap<CInv, int64_t> mapAlreadyAskedFor;
+extern CCriticalSection cs_mapAlreadyAskedFor;
 
 struct LocalServiceInfo {
     int32_t nScore;
@@ -73,6 +76,7 @@ public:
     int32_t nVersion;
     string cleanSubVer;
     bool fInbound;
+    bool fPriority;
     int32_t nStartingHeight;
     uint64_t nSendBytes;
     uint64_t nRecvBytes;
@@ -80,6 +84,13 @@ public:
     double dPingTime;
     double dPingWait;
     string addrLocal;
+    uint64_t nInvSent;
+    uint64_t nTxInvBatches;
+    uint64_t nTxInvShaped;
+    uint64_t nTxInvQueued;
+    bool fSendCompressed;
+    CNetCompressStats compressSent;
+    CNetCompressStats compressRecv;
 };
 
 struct CBlockReject {
@@ -115,6 +126,8 @@ struct CNodeState {
     int32_t nBlocksToDownload;        // blocks number to be downloaded
     int64_t nLastBlockReceive;        // the latest receiving blocks time
     int64_t nLastBlockProcess;        // the latest processing blocks time
+    int32_t nBestHeaderHeight;        // height of the best header announced by this peer
+    double dBlockRate;                // smoothed blocks per second received from this peer
 
     CNodeState() {
         nMisbehavior      = 0;
@@ -123,12 +136,30 @@ struct CNodeState {
         nBlocksInFlight   = 0;
         nLastBlockReceive = 0;
         nLastBlockProcess = 0;
+        nBestHeaderHeight = -1;
+        dBlockRate        = 0;
     }
 };
 
 // Requires cs_mapNodeState.
 CNodeState *State(NodeId pNode) ;
 
+/** Set the payload size and the checksum in the header the message serialized in ss starts with */
+void SetNetMsgHeader(CDataStream &ss);
+
+/** Serialize the message once for any number of peers, e.g. a block or a tx relayed to each of them */
+template <typename T>
+CSharedNetMsg MakeSharedNetMsg(const char *pszCommand, const T &obj) {
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss.reserve(CMessageHeader::HEADER_SIZE + ::GetSerializeSize(obj, SER_NETWORK, PROTOCOL_VERSION));
+    ss << CMessageHeader(pszCommand, 0) << obj;
+    SetNetMsgHeader(ss);
+
+    auto spMsg = std::make_shared<CSerializeData>();
+    ss.swap(*spMsg);
+    return spMsg;
+}
+
 /** Information about a peer */
 class CNode {
 public:
@@ -139,7 +170,8 @@ public:
     size_t nSendSize;    // total size of all vSendMsg entries
     size_t nSendOffset;  // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    deque<CSerializeData> vSendMsg;
+    deque<CSharedNetMsg> vSendMsg;
+    size_t nPrioritySendMsgs;  // the first vSendMsg entries sent before the rest, see EnqueueMessage
     CCriticalSection cs_vSend;
 
     deque<CInv> vRecvGetData;  // strCommand == "getdata 保存的inv
@@ -167,6 +199,7 @@ public:
     bool fNetworkNode;
     bool fSuccessfullyConnected;
     bool fDisconnect;
+    bool fPriority;  // a -prioritypeer, its own connection out of the outbound slots and the inbound limit
     // We use fRelayTxes for two purposes -
     // a) it allows us to not relay tx invs before receiving the peer's version message
     // b) the peer may tell us in their version message that we should not relay tx invs
@@ -190,20 +223,33 @@ protected:
 public:
     uint256 hashContinue;                   // getblocks the next batch of inventory下一次 盘点的块
     CBlockIndex* pIndexLastGetBlocksBegin;  //上次开始的块  本地节点有的块chainActive.Tip()
-    uint256 hashLastGetBlocksEnd;           // 本地节点保存的孤儿块的根块 hash GetOrphanRoot(hash)
+    uint256 hashLastGetBlocksEnd;           // 本地节点保存的孤儿块的根块 hash orphanBlocks.GetRoot(hash)
     int32_t nStartingHeight;                // Start block sync, current height
     bool fStartSync;
+    bool fSupportsCompactBlocks;            // the peer sent sendcmpct, request new blocks as cmpctblock
+    bool fCompactHighBandwidth;             // the peer wants new blocks pushed as cmpctblock without inv
+    bool fSendCompressed;                   // the peer sent sendcompress, its block, tx and headers are compressed
+    bool fPreferHeaders;                    // the peer sent sendheaders, new blocks are announced by headers not inv
+    vector<uint256> vLastLocatorHave;       // the last locator of the peer's getblocks or getheaders
+    CBlockIndex* pLastLocatorTip;           // the tip it was answered at, the fork found is valid while it stays
+    CBlockIndex* pLastLocatorFork;
+    CNetCompressStats compressSent;         // under cs_vSend
+    CNetCompressStats compressRecv;         // under cs_vRecvMsg
 
     // flood relay
     vector<CAddress> vAddrToSend;
-    mruset<CAddress> setAddrKnown;
+    CRollingBloomFilter addrKnown;  // keys of the addresses the peer knows
     bool fGetAddr;
     set<uint256> setKnown;  // alertHash
 
     // inventory based relay
-    mruset<CInv> setInventoryKnown;  //存放已收到的inv
-    vector<CInv> vInventoryToSend;   //待发送的inv
-    std::set<CInv> setForceToSend;   //强制发送的inv
+    CRollingBloomFilter filterInventoryKnown;  // hashes of the invs the peer knows
+    vector<CInv> vInventoryToSend;             //待发送的inv
+    std::set<CInv> setForceToSend;             //强制发送的inv
+    int64_t nNextTxInvSend;                    // time in microseconds to announce the next batch of tx invs
+    uint64_t nInvSent;                         // invs announced, with the number of batches of tx invs
+    uint64_t nTxInvBatches;
+    uint64_t nTxInvShaped;                     // tx invs held back over the rate limit or by a full send buffer
 
     CCriticalSection cs_inventory;
     multimap<int64_t, CInv> mapAskFor;  //向网络请求交易的时间, a priority queue
@@ -215,6 +261,9 @@ public:
     mruset<CBlockFinalityMessage> setBlockFinalityMsgKnown ;
     CCriticalSection cs_blockFinality ;
 
+    mruset<pair<int32_t, uint256>> setPBFTCertKnown ;  // msg type and block hash of the certificates
+    CCriticalSection cs_pbftCert ;
+
     // Ping time measurement
     uint64_t nPingNonceSent;
     int64_t nPingUsecStart;
@@ -222,7 +271,7 @@ public:
     bool fPingQueued;
 
     CNode(SOCKET hSocketIn, CAddress addrIn, string addrNameIn = "", bool fInboundIn = false)
-            : ssSend(SER_NETWORK, INIT_PROTO_VERSION), setAddrKnown(5000) {
+            : ssSend(SER_NETWORK, INIT_PROTO_VERSION), addrKnown(5000, 0.001), filterInventoryKnown(50000, 0.000001) {
         nServices                = 0;
         hSocket                  = hSocketIn;
         nRecvVersion             = INIT_PROTO_VERSION;
@@ -245,15 +294,27 @@ public:
         nRefCount                = 0;
         nSendSize                = 0;
         nSendOffset              = 0;
+        nPrioritySendMsgs        = 0;
+        fPriority                = false;
         hashContinue             = uint256();
         pIndexLastGetBlocksBegin = 0;
         hashLastGetBlocksEnd     = uint256();
         nStartingHeight          = -1;
         fStartSync               = false;
+        fSupportsCompactBlocks   = false;
+        fCompactHighBandwidth    = false;
+        fSendCompressed          = false;
+        fPreferHeaders           = false;
+        pLastLocatorTip          = nullptr;
+        pLastLocatorFork         = nullptr;
         fGetAddr                 = false;
         fRelayTxes               = false;
-        setInventoryKnown.max_size(SendBufferSize() / 1000);
+        nNextTxInvSend           = 0;
+        nInvSent                 = 0;
+        nTxInvBatches            = 0;
+        nTxInvShaped             = 0;
         setBlockConfirmMsgKnown.max_size(200);
+        setPBFTCertKnown.max_size(200);
         pFilter        = new CBloomFilter();
         nPingNonceSent = 0;
         nPingUsecStart = 0;
@@ -311,13 +372,19 @@ public:
     uint32_t GetTotalRecvSize() {
         uint32_t total = 0;
         for (const auto& msg : vRecvMsg)
-            total += msg.vRecv.size() + 24;
+            total += GetUncompressedSize(msg) + 24;
         return total;
     }
 
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char* pch, uint32_t nBytes);
 
+    // requires LOCK(cs_vRecvMsg). Space of at most nMaxSize in the buffer of the message whose data is being
+    // received, to recv() the data there without a copy, nullptr if no message data is pending.
+    char* GetRecvDataSpace(uint32_t nMaxSize, uint32_t& nSize);
+    // requires LOCK(cs_vRecvMsg). Commit the nBytes received into the space of GetRecvDataSpace.
+    void ReceiveDataBytes(uint32_t nBytes);
+
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int32_t nVersionIn) {
         nRecvVersion = nVersionIn;
@@ -332,16 +399,20 @@ public:
 
     void Release() { nRefCount--; }
 
-    void AddAddressKnown(const CAddress& addr) { setAddrKnown.insert(addr); }
+    void AddAddressKnown(const CAddress& addr) { addrKnown.insert(addr.GetKey()); }
 
     void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg){ setBlockConfirmMsgKnown.insert(msg); }
     void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg){ setBlockFinalityMsgKnown.insert(msg); }
+    void AddPBFTCertificateKnown(const CPBFTCertificate& cert) {
+        LOCK(cs_pbftCert);
+        setPBFTCertKnown.insert(make_pair(cert.msgType, cert.blockHash));
+    }
 
     void PushAddress(const CAddress& addr) {
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
-        if (addr.IsValid() && !setAddrKnown.count(addr)) {
+        if (addr.IsValid() && !addrKnown.contains(addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand() % vAddrToSend.size()] = addr;
             } else {
@@ -353,10 +424,15 @@ public:
     void AddInventoryKnown(const CInv& inv) {
         {
             LOCK(cs_inventory);
-            setInventoryKnown.insert(inv);
+            filterInventoryKnown.insert(inv.hash);
         }
     }
 
+    bool IsInventoryKnown(const CInv& inv) {
+        LOCK(cs_inventory);
+        return filterInventoryKnown.contains(inv.hash);
+    }
+
     void PushInventory(const CInv& inv, bool forced = false) {
         {
             LOCK(cs_inventory);
@@ -365,7 +441,7 @@ public:
                 setForceToSend.insert(inv);
             }
 
-            if (forced || !setInventoryKnown.count(inv))
+            if (forced || !filterInventoryKnown.contains(inv.hash))
                 vInventoryToSend.push_back(inv);
 
         }
@@ -387,11 +463,19 @@ public:
         }
     }
 
-    void AskFor(const CInv& inv) {
+    void PushPBFTCertificate(const CPBFTCertificate& cert) {
+        LOCK(cs_pbftCert);
+        if (setPBFTCertKnown.insert(make_pair(cert.msgType, cert.blockHash)).second)
+            PushMessage(NetMsgType::PBFTCERT, cert);
+    }
+
+        void AskFor(const CInv& inv) {
         if (mapAskFor.size() > MAPASKFOR_MAX_SZ) {
             return;
         }
 
+        LOCK(cs_mapAlreadyAskedFor);
+
         // We're using mapAskFor as a priority queue,
         // the key is the earliest time the request can be sent
         int64_t nRequestTime;
@@ -452,27 +536,52 @@ public:
             if (ssSend.size() == 0)
             return;
 
-            // Set the size
-            uint32_t nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
-            memcpy((char*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
+            SetNetMsgHeader(ssSend);
+            LogPrint(BCLog::NET, "(%d bytes)\n", ssSend.size() - CMessageHeader::HEADER_SIZE);
 
-            // Set the checksum
-            uint256 hash           = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
-            uint32_t nChecksum = 0;
-            memcpy(&nChecksum, &hash, sizeof(nChecksum));
-            assert(ssSend.size() >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
-            memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+            auto spMsg = std::make_shared<CSerializeData>();
+            ssSend.swap(*spMsg);
+            EnqueueMessage(spMsg);
 
-            LogPrint(BCLog::NET, "(%d bytes)\n", nSize);
+            LEAVE_CRITICAL_SECTION(cs_vSend);
+    }
 
-            deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-            ssSend.GetAndClear(*it);
-            nSendSize += (*it).size();
+    // Queue a message made by MakeSharedNetMsg, its bytes are not copied
+    void PushSharedMessage(const CSharedNetMsg &spMsg) {
+        LOCK(cs_vSend);
+        LogPrint(BCLog::NET, "sending: %s (%d bytes, shared)\n", GetCommand(*spMsg),
+                 spMsg->size() - CMessageHeader::HEADER_SIZE);
+        EnqueueMessage(spMsg);
+    }
 
-            // If write queue empty, attempt "optimistic write"
-            if (it == vSendMsg.begin()) SocketSendData();
+    static std::string GetCommand(const CSerializeData &msg) {
+        const char* pchCommand = &msg[MESSAGE_START_SIZE];
+        return std::string(pchCommand, strnlen(pchCommand, CMessageHeader::COMMAND_SIZE));
+    }
 
-            LEAVE_CRITICAL_SECTION(cs_vSend);
+    // the block and pbft messages to a priority peer go ahead of its queued relay
+    static bool IsPriorityCommand(const std::string &command);
+
+    // requires LOCK(cs_vSend)
+    void EnqueueMessage(const CSharedNetMsg &spMsgIn) {
+        std::string command = GetCommand(*spMsgIn);
+        // counted by the inner command, a compressed message counts its wire size
+        CSharedNetMsg spMsg = (fSendCompressed && IsCompressibleCommand(command))
+                                  ? CompressNetMsg(spMsgIn, compressSent) : spMsgIn;
+        metricP2PSendBytes.Get(command).Inc(spMsg->size());
+
+        if (fPriority && IsPriorityCommand(command)) {
+            // after the queued priority messages, and after the message being sent
+            size_t nPos = max<size_t>(nPrioritySendMsgs, nSendOffset > 0 ? 1 : 0);
+            vSendMsg.insert(vSendMsg.begin() + nPos, spMsg);
+            nPrioritySendMsgs = nPos + 1;
+        } else {
+            vSendMsg.push_back(spMsg);
+        }
+        nSendSize += spMsg->size();
+
+        // If write queue empty, attempt "optimistic write"
+        if (vSendMsg.size() == 1) SocketSendData();
     }
 
     void PushVersion();
@@ -491,6 +600,8 @@ public:
     void PushMessage(const char* pszCommand, const T1& a1) {
         try {
             BeginMessage(pszCommand);
+            // the buffer of ssSend goes to the send queue, so it is allocated for each message
+            ssSend.reserve(CMessageHeader::HEADER_SIZE + ::GetSerializeSize(a1, SER_NETWORK, PROTOCOL_VERSION));
             ssSend << a1;
             EndMessage();
         } catch (...) {
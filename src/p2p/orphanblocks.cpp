@@ -0,0 +1,111 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "orphanblocks.h"
+
+#include "config/const.h"
+#include "persistence/block.h"
+#include "logging.h"
+
+#include <algorithm>
+
+using namespace std;
+
+COrphanBlockPool orphanBlocks;
+
+bool COrphanBlockPool::GetHeight(const uint256 &hash, int32_t &height) const {
+    auto it = orphans.find(hash);
+    if (it == orphans.end())
+        return false;
+    height = it->second.height;
+    return true;
+}
+
+uint256 COrphanBlockPool::GetRoot(const uint256 &hash) const {
+    uint256 root = hash;
+    auto it      = orphans.find(root);
+    while (it != orphans.end()) {
+        auto itPrev = orphans.find(it->second.prevHash);
+        if (itPrev == orphans.end())
+            break;
+        root = it->second.prevHash;
+        it   = itPrev;
+    }
+    return root;
+}
+
+bool COrphanBlockPool::Add(const CBlock &block, int32_t tipHeight) {
+    uint256 hash = block.GetHash();
+    if (orphans.count(hash))
+        return true;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+
+    COrphanEntry &entry = orphans[hash];
+    entry.prevHash      = block.GetPrevBlockHash();
+    entry.height        = block.GetHeight();
+    entry.vchBlock.assign(ss.begin(), ss.end());
+    nBytes += entry.vchBlock.size();
+    childrenByPrev[entry.prevHash].push_back(hash);
+    heightIndex.emplace(entry.height, hash);
+
+    bool fKept = true;
+    while (!heightIndex.empty() && (orphans.size() > MAX_ORPHAN_BLOCKS || nBytes > MAX_ORPHAN_BLOCKS_SIZE)) {
+        // the lowest orphan is on a stale fork when it is further below the tip than the highest one is above it
+        const auto &lowest  = *heightIndex.begin();
+        const auto &highest = *heightIndex.rbegin();
+        uint256 evictHash   = tipHeight - lowest.first > highest.first - tipHeight ? lowest.second : highest.second;
+        if (evictHash == hash)
+            fKept = false;
+
+        LogPrint(BCLog::NET, "evict the orphan block %s at height %d, orphans=%u, bytes=%llu\n", evictHash.GetHex(),
+                 orphans[evictHash].height, orphans.size(), nBytes);
+        Erase(evictHash);
+    }
+    return fKept;
+}
+
+void COrphanBlockPool::TakeChildren(const uint256 &prevHash, vector<CBlock> &blocks) {
+    auto itChildren = childrenByPrev.find(prevHash);
+    if (itChildren == childrenByPrev.end())
+        return;
+
+    vector<uint256> children = std::move(itChildren->second);
+    for (const auto &hash : children) {
+        auto it = orphans.find(hash);
+        if (it == orphans.end())
+            continue;
+
+        blocks.emplace_back();
+        CDataStream ss(it->second.vchBlock, SER_DISK, CLIENT_VERSION);
+        ss >> blocks.back();
+        Erase(hash);
+    }
+    childrenByPrev.erase(prevHash);
+}
+
+void COrphanBlockPool::Erase(const uint256 &hash) {
+    auto it = orphans.find(hash);
+    if (it == orphans.end())
+        return;
+
+    auto itChildren = childrenByPrev.find(it->second.prevHash);
+    if (itChildren != childrenByPrev.end()) {
+        auto &siblings = itChildren->second;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), hash), siblings.end());
+        if (siblings.empty())
+            childrenByPrev.erase(itChildren);
+    }
+    heightIndex.erase(make_pair(it->second.height, hash));
+    nBytes -= it->second.vchBlock.size();
+    orphans.erase(it);
+}
+
+void COrphanBlockPool::Clear() {
+    orphans.clear();
+    childrenByPrev.clear();
+    heightIndex.clear();
+    nBytes = 0;
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_ORPHANBLOCKS_H
+#define P2P_ORPHANBLOCKS_H
+
+#include <stdint.h>
+
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "commons/uint256.h"
+
+class CBlock;
+
+/**
+ * The blocks received before their parent, kept serialized until the parent is accepted. The pool is bounded by
+ * MAX_ORPHAN_BLOCKS and MAX_ORPHAN_BLOCKS_SIZE bytes: over either, the orphans farthest from the tip in height
+ * are evicted first, those are the last ones the download would connect.
+ *
+ * Protected by cs_main.
+ */
+class COrphanBlockPool {
+public:
+    COrphanBlockPool() : nBytes(0) {}
+
+    bool Have(const uint256 &hash) const { return orphans.count(hash) > 0; }
+
+    // Height of the orphan, false if it is not in the pool
+    bool GetHeight(const uint256 &hash, int32_t &height) const;
+
+    // First block of the orphan chain of the hash, the hash itself if it is not an orphan
+    uint256 GetRoot(const uint256 &hash) const;
+
+    // Add the block, then evict over the bounds. Return false if the block was evicted itself
+    bool Add(const CBlock &block, int32_t tipHeight);
+
+    // Remove the orphans whose parent is prevHash and append them to blocks
+    void TakeChildren(const uint256 &prevHash, std::vector<CBlock> &blocks);
+
+    size_t Size() const { return orphans.size(); }
+    uint64_t GetBytes() const { return nBytes; }
+
+    void Clear();
+
+private:
+    struct COrphanEntry {
+        uint256 prevHash;
+        int32_t height;
+        std::vector<uint8_t> vchBlock;
+    };
+
+    void Erase(const uint256 &hash);
+
+    std::unordered_map<uint256, COrphanEntry, CSaltedUint256Hasher> orphans;
+    std::unordered_map<uint256, std::vector<uint256>, CSaltedUint256Hasher> childrenByPrev;
+    std::set<std::pair<int32_t, uint256>> heightIndex;  // eviction order, from both ends
+    uint64_t nBytes;
+};
+
+extern COrphanBlockPool orphanBlocks;
+
+#endif  // P2P_ORPHANBLOCKS_H
@@ -61,6 +61,10 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
             return true;
     }
 
+    else if (strCommand == NetMsgType::HEADERS && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        ProcessHeadersMessage(pFrom, vRecv);
+    }
+
     else if (strCommand == NetMsgType::TX) {
         if (!ProcessTxMessage(pFrom, strCommand, vRecv))
             return false;
@@ -72,6 +76,30 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
         ProcessBlockMessage(pFrom, vRecv);
     }
 
+    else if (strCommand == NetMsgType::SENDCMPCT) {
+        ProcessSendCompactMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::SENDHEADERS) {
+        ProcessSendHeadersMessage(pFrom);
+    }
+
+    else if (strCommand == NetMsgType::SENDCOMPRESS) {
+        ProcessSendCompressMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::CMPCTBLOCK && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        ProcessCompactBlockMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::GETBLOCKTXN) {
+        ProcessGetBlockTxnMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::BLOCKTXN && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        ProcessBlockTxnMessage(pFrom, vRecv);
+    }
+
     else if (strCommand == NetMsgType::GETADDR) {
         pFrom->vAddrToSend.clear();
         vector<CAddress> vAddr = addrman.GetAddr();
@@ -83,6 +111,10 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
         ProcessMempoolMessage(pFrom, vRecv);
     }
 
+    else if (strCommand == NetMsgType::MEMPOOLSKETCH) {
+        ProcessMempoolSketchMessage(pFrom, vRecv);
+    }
+
     else if (strCommand == NetMsgType::PING) {
         // Echo the message back with the nonce. This allows for two useful features:
         //
@@ -126,6 +158,14 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
         pFrom->fRelayTxes = true;
     }
 
+    else if (strCommand == NetMsgType::GETCFILTERS) {
+        ProcessGetCFiltersMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::GETCFHEADERS) {
+        ProcessGetCFHeadersMessage(pFrom, vRecv);
+    }
+
     else if (strCommand == NetMsgType::REJECT) {
         ProcessRejectMessage(pFrom, vRecv);
     }
@@ -133,6 +173,8 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
         ProcessBlockConfirmMessage(pFrom, vRecv) ;
     } else if (strCommand == NetMsgType::FINALITYBLOCK) {
         ProcessBlockFinalityMessage(pFrom, vRecv);
+    } else if (strCommand == NetMsgType::PBFTCERT) {
+        ProcessPBFTCertificateMessage(pFrom, vRecv);
     }
     else {
         // Ignore unknown commands for extensibility
@@ -150,6 +192,96 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
     return true;
 }
 
+// Cheap messages independent of the order of the others, they skip the queue of the blocks and txs before them
+inline bool IsPriorityCommand(const string &strCommand) {
+    return strCommand == NetMsgType::PING || strCommand == NetMsgType::PONG || strCommand == NetMsgType::ADDR ||
+           strCommand == NetMsgType::INV || strCommand == NetMsgType::CONFIRMBLOCK ||
+           strCommand == NetMsgType::FINALITYBLOCK || strCommand == NetMsgType::PBFTCERT;
+}
+
+inline uint32_t GetMessageChecksum(CNetMessage &msg) {
+    uint256 hash       = Hash(msg.vRecv.begin(), msg.vRecv.begin() + msg.hdr.nMessageSize);
+    uint32_t nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    return nChecksum;
+}
+
+bool static ProcessNetMessage(CNode *pFrom, const string &strCommand, CNetMessage &msg) {
+    uint32_t nMessageSize = msg.hdr.nMessageSize;
+    CDataStream &vRecv    = msg.vRecv;
+    // the commands of the peers are not trusted as labels
+    metricP2PRecvBytes.Get(IsKnownNetMessageType(strCommand) ? strCommand : "other")
+        .Inc(CMessageHeader::HEADER_SIZE + nMessageSize);
+
+    bool fRet = false;
+    try {
+        if (strCommand == NetMsgType::COMPRESSED) {
+            // processed as the inner message, only the nodes announcing sendcompress receive them
+            string strInnerCommand;
+            CDataStream vPayload(vRecv.GetType(), vRecv.GetVersion());
+            if (!IsNetCompressEnabled() || !UncompressNetMsg(vRecv, strInnerCommand, vPayload, pFrom->compressRecv)) {
+                LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : invalid compressed message from peer %s\n",
+                         strCommand, nMessageSize, pFrom->addr.ToString());
+                Misbehaving(pFrom->GetId(), 20);
+                return false;
+            }
+            fRet = ProcessMessage(pFrom, strInnerCommand, vPayload);
+        } else {
+            fRet = ProcessMessage(pFrom, strCommand, vRecv);
+        }
+        boost::this_thread::interruption_point();
+    } catch (std::ios_base::failure &e) {
+        pFrom->PushMessage(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, string("error parsing message"));
+        if (strstr(e.what(), "end of data")) {
+            // Allow exceptions from under-length message on vRecv
+            LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : Exception '%s' caught, normally caused by a message being shorter than its stated length\n", strCommand, nMessageSize, e.what());
+            LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : %s\n", strCommand, nMessageSize, HexStr(vRecv.begin(), vRecv.end()).c_str());
+        } else if (strstr(e.what(), "size too large")) {
+            // Allow exceptions from over-long size
+            LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : Exception '%s' caught\n", strCommand, nMessageSize, e.what());
+        } else {
+            PrintExceptionContinue(&e, "ProcessMessages()");
+        }
+    } catch (boost::thread_interrupted) {
+        throw;
+    } catch (std::exception &e) {
+        PrintExceptionContinue(&e, "ProcessMessages()");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "ProcessMessages()");
+    }
+
+    if (!fRet)
+        LogPrint(BCLog::INFO, "ProcessMessage(%s, %u bytes) FAILED\n", strCommand, nMessageSize);
+
+    return fRet;
+}
+
+// Process the cheap messages queued behind the next message at once, the others are left in order.
+// requires LOCK(cs_vRecvMsg)
+void static ProcessPriorityMessages(CNode *pFrom) {
+    if (pFrom->vRecvMsg.size() < 2)
+        return;
+
+    for (auto it = pFrom->vRecvMsg.begin() + 1; it != pFrom->vRecvMsg.end() && it->complete(); ++it) {
+        if (pFrom->fDisconnect || pFrom->nSendSize >= SendBufferSize())
+            break;
+
+        // the peer is disconnected once the invalid message is reached in order
+        if (memcmp(it->hdr.pchMessageStart, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0)
+            break;
+
+        if (it->fProcessed || !it->hdr.IsValid())
+            continue;
+
+        string strCommand = it->hdr.GetCommand();
+        if (!IsPriorityCommand(strCommand) || GetMessageChecksum(*it) != it->hdr.nChecksum)
+            continue;
+
+        ProcessNetMessage(pFrom, strCommand, *it);
+        it->fProcessed = true;
+    }
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessMessages(CNode *pFrom) {
     //if (fDebug)
@@ -172,8 +304,18 @@ bool ProcessMessages(CNode *pFrom) {
     if (!pFrom->vRecvGetData.empty())
         return fOk;
 
+    // the handshake is processed in order
+    if (pFrom->fSuccessfullyConnected)
+        ProcessPriorityMessages(pFrom);
+
     deque<CNetMessage>::iterator it = pFrom->vRecvMsg.begin();
     while (!pFrom->fDisconnect && it != pFrom->vRecvMsg.end()) {
+        // skip the messages processed ahead
+        if (it->fProcessed) {
+            it++;
+            continue;
+        }
+
         // Don't bother if send buffer is too full to respond anyway
         if (pFrom->nSendSize >= SendBufferSize()) {
             LogPrint(BCLog::NET, "send buffer size: %d full for peer: %s\n", pFrom->nSendSize, pFrom->addr.ToString());
@@ -210,51 +352,24 @@ bool ProcessMessages(CNode *pFrom) {
         }
         string strCommand = hdr.GetCommand();
 
-        // Message size
-        uint32_t nMessageSize = hdr.nMessageSize;
-
         // Checksum
-        CDataStream &vRecv = msg.vRecv;
-        uint256 hash       = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
-        uint32_t nChecksum = 0;
-        memcpy(&nChecksum, &hash, sizeof(nChecksum));
+        uint32_t nChecksum = GetMessageChecksum(msg);
         if (nChecksum != hdr.nChecksum) {
             LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : CHECKSUM ERROR nChecksum=%08x hdr.nChecksum=%08x\n",
-                     strCommand, nMessageSize, nChecksum, hdr.nChecksum);
+                     strCommand, hdr.nMessageSize, nChecksum, hdr.nChecksum);
             continue;
         }
 
         // Process message
-        bool fRet = false;
-        try {
-            fRet = ProcessMessage(pFrom, strCommand, vRecv);
-            boost::this_thread::interruption_point();
-        } catch (std::ios_base::failure &e) {
-            pFrom->PushMessage(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, string("error parsing message"));
-            if (strstr(e.what(), "end of data")) {
-                // Allow exceptions from under-length message on vRecv
-                LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : Exception '%s' caught, normally caused by a message being shorter than its stated length\n", strCommand, nMessageSize, e.what());
-                LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : %s\n", strCommand, nMessageSize, HexStr(vRecv.begin(), vRecv.end()).c_str());
-            } else if (strstr(e.what(), "size too large")) {
-                // Allow exceptions from over-long size
-                LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : Exception '%s' caught\n", strCommand, nMessageSize, e.what());
-            } else {
-                PrintExceptionContinue(&e, "ProcessMessages()");
-            }
-        } catch (boost::thread_interrupted) {
-            throw;
-        } catch (std::exception &e) {
-            PrintExceptionContinue(&e, "ProcessMessages()");
-        } catch (...) {
-            PrintExceptionContinue(nullptr, "ProcessMessages()");
-        }
-
-        if (!fRet)
-            LogPrint(BCLog::INFO, "ProcessMessage(%s, %u bytes) FAILED\n", strCommand, nMessageSize);
+        ProcessNetMessage(pFrom, strCommand, msg);
 
         break;
     }
 
+    // the messages processed ahead right after the one processed now go with it
+    while (!pFrom->fDisconnect && it != pFrom->vRecvMsg.end() && it->fProcessed)
+        it++;
+
     // In case the connection got shut down, its receive buffer was wiped
     if (!pFrom->fDisconnect)
         pFrom->vRecvMsg.erase(pFrom->vRecvMsg.begin(), it);
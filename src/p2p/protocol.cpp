@@ -22,7 +22,7 @@ namespace NetMsgType {
     const char *GETBLOCKS="getblocks";
     const char *GETHEADERS="getheaders";
     const char *TX="tx";
-    // const char *HEADERS="headers";
+    const char *HEADERS="headers";
     const char *BLOCK="block";
     const char *GETADDR="getaddr";
     const char *MEMPOOL="mempool";
@@ -36,20 +36,50 @@ namespace NetMsgType {
     const char *REJECT="reject";
     const char *CONFIRMBLOCK = "confirmblock";
     const char *FINALITYBLOCK = "finblock" ;
-    // const char *SENDHEADERS="sendheaders";
+    const char *PBFTCERT = "pbftcert";
+    const char *SENDHEADERS="sendheaders";
     // const char *FEEFILTER="feefilter";
-    // const char *SENDCMPCT="sendcmpct";
-    // const char *CMPCTBLOCK="cmpctblock";
-    // const char *GETBLOCKTXN="getblocktxn";
-    // const char *BLOCKTXN="blocktxn";
+    const char *SENDCMPCT="sendcmpct";
+    const char *CMPCTBLOCK="cmpctblock";
+    const char *GETBLOCKTXN="getblocktxn";
+    const char *BLOCKTXN="blocktxn";
+    const char *MEMPOOLSKETCH="mempoolsketch";
+    const char *GETCFILTERS="getcfilters";
+    const char *CFILTER="cfilter";
+    const char *GETCFHEADERS="getcfheaders";
+    const char *CFHEADERS="cfheaders";
+    const char *SENDCOMPRESS="sendcompress";
+    const char *COMPRESSED="compressed";
 } // namespace NetMsgType
 
+static const char *allNetMessageTypes[] = {
+    NetMsgType::VERSION,     NetMsgType::VERACK,      NetMsgType::ADDR,        NetMsgType::INV,
+    NetMsgType::GETDATA,     NetMsgType::GETBLOCKS,   NetMsgType::GETHEADERS,  NetMsgType::TX,
+    NetMsgType::HEADERS,     NetMsgType::BLOCK,       NetMsgType::GETADDR,     NetMsgType::MEMPOOL,
+    NetMsgType::PING,        NetMsgType::PONG,        NetMsgType::ALERT,       NetMsgType::FILTERLOAD,
+    NetMsgType::FILTERADD,   NetMsgType::FILTERCLEAR, NetMsgType::REJECT,      NetMsgType::CONFIRMBLOCK,
+    NetMsgType::FINALITYBLOCK, NetMsgType::SENDCMPCT, NetMsgType::CMPCTBLOCK,  NetMsgType::GETBLOCKTXN,
+    NetMsgType::BLOCKTXN,    NetMsgType::PBFTCERT,    NetMsgType::MEMPOOLSKETCH, NetMsgType::GETCFILTERS,
+    NetMsgType::CFILTER,     NetMsgType::GETCFHEADERS, NetMsgType::CFHEADERS, NetMsgType::SENDCOMPRESS,
+    NetMsgType::COMPRESSED,  NetMsgType::SENDHEADERS,
+};
+
+bool IsKnownNetMessageType(const std::string &command)
+{
+    for (const char *type : allNetMessageTypes) {
+        if (command == type)
+            return true;
+    }
+    return false;
+}
+
 static const char* ppszTypeName[] =
 {
     "ERROR",
     "tx",
     "block",
-    "filtered block"
+    "filtered block",
+    "compact block"
 };
 
 CMessageHeader::CMessageHeader()
@@ -193,4 +223,11 @@ uint256 CPBFTMessage::GetHash() const {
     CHashWriter ss(SER_GETHASH, CLIENT_VERSION);
     ss << msgType << blockHash << height<< miner << preBlockHash;
     return ss.GetHash();
-}
\ No newline at end of file
+}
+
+uint32_t CPBFTCertificate::GetSignerCount() const {
+    uint32_t count = 0;
+    for (uint8_t bits : signerBitmap)
+        count += __builtin_popcount(bits);
+    return count;
+}
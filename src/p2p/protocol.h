@@ -62,6 +62,8 @@ class CMessageHeader
 enum
 {
     NODE_NETWORK = (1 << 0),
+    // serves the compact block filters of -blockfilterindex
+    NODE_COMPACT_FILTERS = (1 << 6),
 };
 
 
@@ -131,7 +133,7 @@ extern const char *TX;
  * @since protocol version 31800.
  * @see https://bitcoin.org/en/developer-reference#headers
  */
-// extern const char *HEADERS;
+extern const char *HEADERS;
 /**
  * The block message transmits a single serialized block.
  * @see https://bitcoin.org/en/developer-reference#block
@@ -244,6 +246,40 @@ extern const char *GETBLOCKTXN;
  * @since protocol version 70014 as described by BIP 152
  */
 extern const char *BLOCKTXN;
+/**
+ * Contains a CMemPoolSketch of the mempool of the sender, sent once connected.
+ * The receiver announces by inv the txs of its mempool the sketch misses.
+ */
+extern const char *MEMPOOLSKETCH;
+/**
+ * Requests the compact filters of the blocks from a start height to a stop hash of the active chain, one
+ * cfilter message each, as in BIP157. Served with NODE_COMPACT_FILTERS.
+ */
+extern const char *GETCFILTERS;
+/**
+ * Contains the filter type, the block hash and the encoded CBlockFilter of a block.
+ */
+extern const char *CFILTER;
+/**
+ * Requests the filter hashes of the blocks from a start height to a stop hash, to verify the filters
+ * against the chain of the filter headers.
+ */
+extern const char *GETCFHEADERS;
+/**
+ * Contains the filter type, the stop hash, the filter header before the start height and the filter hashes.
+ */
+extern const char *CFHEADERS;
+/**
+ * Contains the 1-byte codec version, see p2p/netcompress.h.
+ * Indicates that a node accepts its block, tx and headers messages wrapped in
+ * "compressed" messages of the codec.
+ */
+extern const char *SENDCOMPRESS;
+/**
+ * Contains the inner command, the codec, the size of the inner payload and the
+ * compressed inner payload. Only sent to the nodes that sent "sendcompress".
+ */
+extern const char *COMPRESSED;
 
 /**
  * the message must be send by miner,means the the
@@ -253,8 +289,18 @@ extern const char *BLOCKTXN;
 extern const char *CONFIRMBLOCK ;
 
 extern const char *FINALITYBLOCK ;
+
+/**
+ * Contains a CPBFTCertificate, the signatures of a quorum of delegates over
+ * the confirm or finality message of a block, relayed once per block instead
+ * of the messages of each delegate.
+ */
+extern const char *PBFTCERT;
 };
 
+/* Whether the command is one of the NetMsgType, e.g. to bound the labels of the metrics of the commands received */
+bool IsKnownNetMessageType(const std::string &command);
+
 enum PBFTMsgType {
 
     CONFIRM_BLOCK =1 ,
@@ -376,6 +422,44 @@ public:
     }
 };
 
+/**
+ * The confirm or finality messages of a quorum of delegates of a block in one object. The signers are a bitmap over
+ * the delegates of the block in regid order, which are known from the parent block, and the signatures follow in the
+ * order of the bitmap. The signatures are the ones of the messages of each delegate, so a certificate is verified as
+ * the messages it carries and interoperates with the nodes relaying the messages one by one.
+ */
+class CPBFTCertificate {
+public:
+    int32_t msgType = 0;
+    uint32_t height = 0;
+    uint256 blockHash;
+    uint256 preBlockHash;
+    vector<uint8_t> signerBitmap;
+    vector<vector<unsigned char>> vSignatures;
+
+    IMPLEMENT_SERIALIZE
+    (
+            READWRITE(msgType);
+            READWRITE(height);
+            READWRITE(blockHash);
+            READWRITE(preBlockHash);
+            READWRITE(signerBitmap);
+            READWRITE(vSignatures);
+    )
+
+    bool IsSigner(const uint32_t index) const {
+        return index / 8 < signerBitmap.size() && (signerBitmap[index / 8] & (1 << (index % 8))) != 0;
+    }
+
+    void SetSigner(const uint32_t index) {
+        if (index / 8 >= signerBitmap.size())
+            signerBitmap.resize(index / 8 + 1, 0);
+        signerBitmap[index / 8] |= (1 << (index % 8));
+    }
+
+    uint32_t GetSignerCount() const;
+};
+
 enum
 {
     MSG_TX = 1,
@@ -383,6 +467,8 @@ enum
     // Nodes may always request a MSG_FILTERED_BLOCK in a getdata, however,
     // MSG_FILTERED_BLOCK should not appear in any invs except as a part of getdata.
     MSG_FILTERED_BLOCK,
+    // Requests a block as a "cmpctblock" message in a getdata, not announced in invs, see BIP 152.
+    MSG_CMPCT_BLOCK,
 };
 
 #endif // __INCLUDED_PROTOCOL_H__
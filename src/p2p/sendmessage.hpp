@@ -7,6 +7,9 @@
 #define SENDMESSAGE_HPP
 
 #include "main.h"
+#include "chain/txlatency.h"
+#include "p2p/headerchain.h"
+#include "p2p/orphanblocks.h"
 
 // Requires cs_mapNodeState.
 void MarkBlockAsInFlight(const uint256 &hash, NodeId nodeId) {
@@ -68,6 +71,10 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
             //LogPrint(BCLog::NET, "send ping: %s\n", DateTimeStrFormat("YYYY-MM-DDTHH-MM-SS", pTo->nPingUsecStart).c_str());
         }
 
+        // blocks of the best header chain missing in the download window, lowest first
+        vector<pair<int32_t, uint256>> vWindow;
+        // blocks announced near the tip are requested as compact blocks
+        bool fCompactFetch = false;
         {
             TRY_LOCK(cs_main, lockMain);  // Acquire cs_main for IsInitialBlockDownload() and CNodeState()
             if (!lockMain)
@@ -79,9 +86,9 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                 {
                     LOCK(cs_vNodes);
                     for (auto pNode : vNodes) {
-                        // Periodically clear setAddrKnown to allow refresh broadcasts
+                        // Periodically clear addrKnown to allow refresh broadcasts
                         if (nLastRebroadcast)
-                            pNode->setAddrKnown.clear();
+                            pNode->addrKnown.reset();
 
                         // Rebroadcast our address
                         if (!fNoListen) {
@@ -101,8 +108,9 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                 vector<CAddress> vAddr;
                 vAddr.reserve(pTo->vAddrToSend.size());
                 for (const auto &addr : pTo->vAddrToSend) {
-                    // returns true if wasn't already contained in the set
-                    if (pTo->setAddrKnown.insert(addr).second) {
+                    vector<uint8_t> key = addr.GetKey();
+                    if (!pTo->addrKnown.contains(key)) {
+                        pTo->addrKnown.insert(key);
                         vAddr.push_back(addr);
                         // receiver rejects addr messages larger than 1000
                         if (vAddr.size() >= 1000) {
@@ -120,8 +128,43 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
             if (pTo->fStartSync && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
                 pTo->fStartSync = false;
                 nSyncTipHeight  = pTo->nStartingHeight;
-                LogPrint(BCLog::NET, "start block sync lead to getblocks\n");
-                PushGetBlocks(pTo, chainActive.Tip(), uint256());
+                if (pTo->nStartingHeight > chainActive.Height() + HEADERS_SYNC_MIN_GAP && headerChain.GetSyncPeer() < 0) {
+                    LogPrint(BCLog::NET, "start block sync lead to getheaders, peer height=%d\n", pTo->nStartingHeight);
+                    headerChain.SetSyncPeer(pTo->GetId(), GetTime());
+                    pTo->PushMessage(NetMsgType::GETHEADERS, headerChain.GetLocator(chainActive), uint256());
+                } else {
+                    LogPrint(BCLog::NET, "start block sync lead to getblocks\n");
+                    PushGetBlocks(pTo, chainActive.Tip(), uint256());
+                }
+            }
+
+            // Hand the headers sync over to this peer if the sync peer times out, or resume a sync that stopped
+            // at the allowed lead over the tip once the tip has caught up
+            if (!SysCfg().IsImporting() && !SysCfg().IsReindex() && pTo->nStartingHeight > headerChain.GetBestHeight() &&
+                headerChain.GetSyncPeer() != pTo->GetId()) {
+                bool fTimeout = headerChain.GetSyncPeer() >= 0 &&
+                                GetTime() - headerChain.GetLastRequestTime() > HEADERS_RESPONSE_TIMEOUT;
+                bool fResume  = headerChain.GetSyncPeer() < 0 && headerChain.HasMoreHeaders() &&
+                               headerChain.GetBestHeight() + (int32_t)MAX_HEADERS_RESULTS <
+                                   chainActive.Height() + CHeaderChain::MAX_HEADERS_AHEAD_OF_TIP;
+                if (fTimeout || fResume) {
+                    LogPrint(BCLog::NET, "%s headers sync from peer %s, best header height=%d\n",
+                             fTimeout ? "timeout of peer, restart" : "resume", pTo->addr.ToString(),
+                             headerChain.GetBestHeight());
+                    headerChain.SetSyncPeer(pTo->GetId(), GetTime());
+                    pTo->PushMessage(NetMsgType::GETHEADERS, headerChain.GetLocator(chainActive), uint256());
+                }
+            }
+
+            fCompactFetch = pTo->fSupportsCompactBlocks && !IsInitialBlockDownload();
+
+            if (headerChain.IsSyncing(chainActive.Tip())) {
+                vector<pair<int32_t, uint256>> vHashes;
+                headerChain.GetHashes(chainActive.Height(), chainActive.Height() + BLOCK_DOWNLOAD_WINDOW, vHashes);
+                for (const auto &item : vHashes) {
+                    if (!mapBlockIndex.count(item.second) && !orphanBlocks.Have(item.second))
+                        vWindow.push_back(item);
+                }
             }
 
             // Resend wallet transactions that haven't gotten in a block yet
@@ -153,53 +196,74 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
         //
         // Message: inventory
         //
+        // Block invs go out at once. Tx invs are announced in batches at random intervals of -txinvinterval
+        // on average, so that a burst of txs costs a peer a few inv messages, at most -maxtxinvrate per
+        // second, and a peer slow to drain its send buffer gets them in a later batch.
+        static const int64_t nTxInvInterval = SysCfg().GetArg("-txinvinterval", DEFAULT_TX_INV_INTERVAL) * 1000;
+        static const int64_t nMaxTxInvRate  = max<int64_t>(1, SysCfg().GetArg("-maxtxinvrate", DEFAULT_MAX_TX_INV_RATE));
+        int64_t nNowMicros = GetTimeMicros();
+
         vector<CInv> vInv;
         vector<CInv> vInvWait;
         {
             LOCK(pTo->cs_inventory);
+            bool fTxBatch        = false;
+            int64_t nTxInvBudget = 0;
+            if (nNowMicros >= pTo->nNextTxInvSend) {
+                int64_t nInterval    = pTo->fInbound ? 2 * nTxInvInterval : nTxInvInterval;
+                pTo->nNextTxInvSend  = PoissonNextSend(nNowMicros, nInterval);
+                fTxBatch             = true;
+                if (pTo->nSendSize < SendBufferSize() / 2)
+                    nTxInvBudget = min<int64_t>(max<int64_t>(1, nMaxTxInvRate * nInterval / 1000000), MAX_INV_SZ);
+            }
+
             vInv.reserve(pTo->vInventoryToSend.size());
-            vInvWait.reserve(pTo->vInventoryToSend.size());
             for (const auto &inv : pTo->vInventoryToSend) {
 
                 if(pTo->setForceToSend.count(inv)){
-                    pTo->setInventoryKnown.insert(inv);
+                    pTo->filterInventoryKnown.insert(inv.hash);
                     vInv.push_back(inv);
                     pTo->setForceToSend.erase(inv);
                     continue;
                 }
 
-                if (pTo->setInventoryKnown.count(inv))
+                if (pTo->filterInventoryKnown.contains(inv.hash))
                     continue;
 
-                // trickle out tx inv to protect privacy
-                if (inv.type == MSG_TX && !fSendTrickle) {
-                    // 1/4 of tx invs blast to all immediately
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
-                    uint256 hashRand  = ArithToUint256(UintToArith256(inv.hash) ^ UintToArith256(hashSalt));
-                    hashRand          = Hash(BEGIN(hashRand), END(hashRand));
-                    bool fTrickleWait = ((UintToArith256(hashRand) & 3) != 0);
-
-                    if (fTrickleWait) {
+                if (inv.type == MSG_TX) {
+                    if (nTxInvBudget == 0) {
                         vInvWait.push_back(inv);
                         continue;
                     }
+                    nTxInvBudget--;
                 }
 
-                // returns true if wasn't already contained in the set
-                if (pTo->setInventoryKnown.insert(inv).second) {
-                    vInv.push_back(inv);
-                    if (vInv.size() >= 1000) {
-                        pTo->PushMessage(NetMsgType::INV, vInv);
-                        vInv.clear();
-                    }
-                }
+                pTo->filterInventoryKnown.insert(inv.hash);
+                vInv.push_back(inv);
             }
             pTo->vInventoryToSend = vInvWait;
+
+            if (fTxBatch) {
+                pTo->nTxInvBatches++;
+                pTo->nTxInvShaped += vInvWait.size();
+            }
+        }
+
+        // the txs of the batch mined or evicted meanwhile need no announcement
+        vInv.erase(std::remove_if(vInv.begin(), vInv.end(),
+                                  [](const CInv &inv) { return inv.type == MSG_TX && !mempool.Exists(inv.hash); }),
+                   vInv.end());
+        pTo->nInvSent += vInv.size();
+        if (txLatencyTracer.IsEnabled()) {
+            for (const auto &inv : vInv) {
+                if (inv.type == MSG_TX)
+                    txLatencyTracer.Stamp(inv.hash, TX_STAGE_RELAYED);
+            }
+        }
+        for (size_t nBegin = 0; nBegin < vInv.size(); nBegin += 1000) {
+            size_t nEnd = min(nBegin + 1000, vInv.size());
+            pTo->PushMessage(NetMsgType::INV, vector<CInv>(vInv.begin() + nBegin, vInv.begin() + nEnd));
         }
-        if (!vInv.empty())
-            pTo->PushMessage(NetMsgType::INV, vInv);
 
         // Detect stalled peers. Require that blocks are in flight, we haven't
         // received a (requested) block in one minute, and that all blocks are
@@ -218,9 +282,41 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
         //
         vector<CInv> vGetData;
         int32_t index = 0;
+
+        // Spread the download window of headers-first sync over the peers having the blocks, each peer gets
+        // as many blocks in flight as it delivers in BLOCK_FETCH_TARGET_TIME. The lowest missing block holds
+        // back the whole window, request it from this peer if its peer stalls.
+        if (!pTo->fDisconnect && !vWindow.empty()) {
+            int32_t nPeerHeight = std::max(state.nBestHeaderHeight, pTo->nStartingHeight);
+            int32_t nBudget     = std::min(std::max((int32_t)(state.dBlockRate * BLOCK_FETCH_TARGET_TIME),
+                                                    MIN_BLOCKS_IN_TRANSIT_PER_PEER), MAX_BLOCKS_IN_TRANSIT_PER_PEER);
+            for (const auto &item : vWindow) {
+                if (state.nBlocksInFlight >= nBudget || item.first > nPeerHeight)
+                    break;
+
+                const uint256 &hash = item.second;
+                auto itInFlight     = mapBlocksInFlight.find(hash);
+                if (itInFlight != mapBlocksInFlight.end()) {
+                    if (&item != &vWindow.front() || std::get<0>(itInFlight->second) == pTo->GetId() ||
+                        nNow - std::get<2>(itInFlight->second) < BLOCK_STALLING_TIMEOUT * 1000000)
+                        continue;
+
+                    LogPrint(BCLog::NET, "block %d stalls the download window, request it from peer %s instead\n",
+                             item.first, state.name);
+                } else if (mapBlocksToDownload.count(hash)) {
+                    continue;
+                }
+
+                vGetData.push_back(CInv(MSG_BLOCK, hash));
+                MarkBlockAsInFlight(hash, pTo->GetId());
+                LogPrint(BCLog::NET, "send MSG_BLOCK msg! time_ms=%lld, height=%d, hash=%s, peer=%s, FlightBlocks=%d\n",
+                         GetTimeMillis(), item.first, hash.ToString(), state.name, state.nBlocksInFlight);
+            }
+        }
+
         while (!pTo->fDisconnect && state.nBlocksToDownload && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
             uint256 hash = state.vBlocksToDownload.front();
-            vGetData.push_back(CInv(MSG_BLOCK, hash));
+            vGetData.push_back(CInv(fCompactFetch ? MSG_CMPCT_BLOCK : MSG_BLOCK, hash));
             MarkBlockAsInFlight(hash, pTo->GetId());
             LogPrint(BCLog::NET, "send MSG_BLOCK msg! time_ms=%lld, hash=%s, peer=%s, FlightBlocks=%d, index=%d\n",
                 GetTimeMillis(), hash.ToString(), state.name, state.nBlocksInFlight, index++);
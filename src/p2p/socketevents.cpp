@@ -0,0 +1,206 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "commons/util/util.h"
+#include "config/configuration.h"
+#include "logging.h"
+#include "netbase.h"
+
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+class CSelectEvents : public CSocketEvents {
+public:
+    CSelectEvents() : hSocketMax(0), fHaveFds(false) { Clear(); }
+
+    void Add(SOCKET hSocket, uint8_t events, int64_t nOwner) override {
+        if (hSocket >= FD_SETSIZE) {
+            LogPrint(BCLog::ERROR, "socket %d is beyond FD_SETSIZE, ignored by select\n", hSocket);
+            return;
+        }
+
+        if (events & EVENT_RECV)
+            FD_SET(hSocket, &fdsetRecv);
+        if (events & EVENT_SEND)
+            FD_SET(hSocket, &fdsetSend);
+        if (events & EVENT_ERROR)
+            FD_SET(hSocket, &fdsetError);
+        hSocketMax = max(hSocketMax, hSocket);
+        fHaveFds   = true;
+    }
+
+    bool Wait(int64_t nTimeoutMs) override {
+        fdsetReadyRecv  = fdsetRecv;
+        fdsetReadySend  = fdsetSend;
+        fdsetReadyError = fdsetError;
+
+        struct timeval timeout;
+        timeout.tv_sec  = nTimeoutMs / 1000;
+        timeout.tv_usec = (nTimeoutMs % 1000) * 1000;
+        int32_t nSelect = select(fHaveFds ? hSocketMax + 1 : 0, &fdsetReadyRecv, &fdsetReadySend, &fdsetReadyError,
+                                 &timeout);
+        bool fHadFds      = fHaveFds;
+        SOCKET hSocketEnd = hSocketMax;
+        Clear();
+
+        if (nSelect == SOCKET_ERROR) {
+            if (fHadFds) {
+                int32_t nErr = WSAGetLastError();
+                LogPrint(BCLog::INFO, "socket select error %s\n", NetworkErrorString(nErr));
+                for (uint32_t i = 0; i <= hSocketEnd; i++)
+                    FD_SET(i, &fdsetReadyRecv);
+            }
+            FD_ZERO(&fdsetReadySend);
+            FD_ZERO(&fdsetReadyError);
+            MilliSleep(nTimeoutMs);
+            return false;
+        }
+        return true;
+    }
+
+    uint8_t GetReady(SOCKET hSocket) const override {
+        if (hSocket >= FD_SETSIZE)
+            return 0;
+
+        return (FD_ISSET(hSocket, &fdsetReadyRecv) ? EVENT_RECV : 0) |
+               (FD_ISSET(hSocket, &fdsetReadySend) ? EVENT_SEND : 0) |
+               (FD_ISSET(hSocket, &fdsetReadyError) ? EVENT_ERROR : 0);
+    }
+
+private:
+    void Clear() {
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        hSocketMax = 0;
+        fHaveFds   = false;
+    }
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    fd_set fdsetReadyRecv;
+    fd_set fdsetReadySend;
+    fd_set fdsetReadyError;
+    SOCKET hSocketMax;
+    bool fHaveFds;
+};
+
+#ifdef __linux__
+class CEpollEvents : public CSocketEvents {
+public:
+    explicit CEpollEvents(int32_t epollFdIn) : epollFd(epollFdIn) {}
+    ~CEpollEvents() override { close(epollFd); }
+
+    void Add(SOCKET hSocket, uint8_t events, int64_t nOwner) override {
+        mapWanted[hSocket] = CRegistration{events, nOwner};
+    }
+
+    bool Wait(int64_t nTimeoutMs) override {
+        mapReady.clear();
+
+        // sync the registrations with the events wanted, a closed socket left the epoll set by itself
+        for (auto it = mapRegistered.begin(); it != mapRegistered.end();) {
+            if (!mapWanted.count(it->first)) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, it->first, nullptr);
+                it = mapRegistered.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (const auto &item : mapWanted) {
+            auto it = mapRegistered.find(item.first);
+            if (it != mapRegistered.end() && it->second.nOwner == item.second.nOwner &&
+                it->second.events == item.second.events)
+                continue;
+
+            struct epoll_event event;
+            event.events = ((item.second.events & EVENT_RECV) ? EPOLLIN : 0) |
+                           ((item.second.events & EVENT_SEND) ? EPOLLOUT : 0);
+            event.data.fd = item.first;
+            // a new socket reusing the number of a closed one is unknown to the epoll set
+            bool fKnown = it != mapRegistered.end() && it->second.nOwner == item.second.nOwner;
+            int32_t ret = epoll_ctl(epollFd, fKnown ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, item.first, &event);
+            if (ret != 0 && errno == ENOENT)
+                ret = epoll_ctl(epollFd, EPOLL_CTL_ADD, item.first, &event);
+            else if (ret != 0 && errno == EEXIST)
+                ret = epoll_ctl(epollFd, EPOLL_CTL_MOD, item.first, &event);
+
+            if (ret != 0) {
+                LogPrint(BCLog::ERROR, "epoll_ctl of socket %d failed: %s\n", item.first, NetworkErrorString(errno));
+                mapRegistered.erase(item.first);
+                continue;
+            }
+            mapRegistered[item.first] = item.second;
+        }
+        mapWanted.clear();
+
+        vEvents.resize(max<size_t>(mapRegistered.size(), 1));
+        int32_t nReady = epoll_wait(epollFd, vEvents.data(), vEvents.size(), nTimeoutMs);
+        if (nReady < 0) {
+            if (errno != EINTR)
+                LogPrint(BCLog::INFO, "socket epoll_wait error %s\n", NetworkErrorString(errno));
+            return false;
+        }
+
+        for (int32_t i = 0; i < nReady; ++i) {
+            uint32_t events = vEvents[i].events;
+            mapReady[vEvents[i].data.fd] = ((events & EPOLLIN) ? EVENT_RECV : 0) |
+                                           ((events & EPOLLOUT) ? EVENT_SEND : 0) |
+                                           ((events & (EPOLLERR | EPOLLHUP)) ? EVENT_ERROR : 0);
+        }
+        return true;
+    }
+
+    uint8_t GetReady(SOCKET hSocket) const override {
+        auto it = mapReady.find(hSocket);
+        return it != mapReady.end() ? it->second : 0;
+    }
+
+private:
+    struct CRegistration {
+        uint8_t events;
+        int64_t nOwner;
+    };
+
+    int32_t epollFd;
+    unordered_map<SOCKET, CRegistration> mapWanted;
+    unordered_map<SOCKET, CRegistration> mapRegistered;
+    unordered_map<SOCKET, uint8_t> mapReady;
+    vector<struct epoll_event> vEvents;
+};
+#endif
+
+}  // namespace
+
+string CSocketEvents::GetBackendName() {
+#ifdef __linux__
+    return SysCfg().GetArg("-socketevents", "epoll") == "select" ? "select" : "epoll";
+#else
+    return "select";
+#endif
+}
+
+unique_ptr<CSocketEvents> CSocketEvents::Create() {
+#ifdef __linux__
+    if (GetBackendName() == "epoll") {
+        int32_t epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd >= 0)
+            return unique_ptr<CSocketEvents>(new CEpollEvents(epollFd));
+
+        LogPrint(BCLog::ERROR, "epoll_create1 failed: %s, fall back to select\n", NetworkErrorString(errno));
+    }
+#endif
+    return unique_ptr<CSocketEvents>(new CSelectEvents());
+}
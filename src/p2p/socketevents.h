@@ -0,0 +1,44 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_SOCKETEVENTS_H
+#define P2P_SOCKETEVENTS_H
+
+#include "commons/compat/compat.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+/**
+ * Readiness of the sockets served by ThreadSocketHandler. The events wanted for every socket are
+ * added before each Wait, the events ready are queried after it.
+ *
+ * The epoll backend keeps the sockets registered across the waits and only updates the ones whose
+ * events changed, so a wakeup costs the sockets ready instead of all sockets, and the number of
+ * sockets is not bounded by FD_SETSIZE. select is the fallback off Linux or with -socketevents=select.
+ */
+class CSocketEvents {
+public:
+    enum : uint8_t {
+        EVENT_RECV  = 1,
+        EVENT_SEND  = 2,
+        EVENT_ERROR = 4,
+    };
+
+    virtual ~CSocketEvents() {}
+
+    // The backend chosen by -socketevents: "epoll" if available, else "select"
+    static std::string GetBackendName();
+    static std::unique_ptr<CSocketEvents> Create();
+
+    // nOwner tells the sockets apart that reuse the number of a closed one, e.g. the id of the node
+    virtual void Add(SOCKET hSocket, uint8_t events, int64_t nOwner) = 0;
+    // Wait at most nTimeoutMs for the sockets added since the last wait, false on a failed wait
+    virtual bool Wait(int64_t nTimeoutMs) = 0;
+    virtual uint8_t GetReady(SOCKET hSocket) const = 0;
+};
+
+#endif  // P2P_SOCKETEVENTS_H
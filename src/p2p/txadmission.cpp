@@ -0,0 +1,157 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txadmission.h"
+
+#include "main.h"
+#include "logging.h"
+#include "net.h"
+#include "persistence/statesnapshot.h"
+#include "commons/util/util.h"
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+CTxAdmissionQueue txAdmissionQueue;
+
+bool CTxAdmissionQueue::Push(CNode *pFrom, const std::shared_ptr<CBaseTx> &pBaseTx, const CDataStream &vMsg) {
+    {
+        boost::unique_lock<boost::mutex> lock(queueMutex);
+        auto &peerQueue = peerQueues[pFrom->GetId()];
+        if (peerQueue.size() >= MAX_PEER_TX_ADMISSION_QUEUE) {
+            LogPrint(BCLog::NET, "%s : %u txs of peer %s waiting for admission, drop tx %s\n", __func__,
+                     peerQueue.size(), pFrom->addr.ToString(), pBaseTx->GetHash().GetHex());
+            return false;
+        }
+
+        {
+            LOCK(cs_vNodes);
+            pFrom->AddRef();
+        }
+        peerQueue.emplace_back(pFrom, pBaseTx, vMsg);
+    }
+    queueCond.notify_one();
+    return true;
+}
+
+void CTxAdmissionQueue::TakeBatch(vector<CTxAdmissionItem> &batch) {
+    boost::unique_lock<boost::mutex> lock(queueMutex);
+    try {
+        while (peerQueues.empty())
+            queueCond.wait(lock);
+    } catch (boost::thread_interrupted &) {
+        for (auto &item : peerQueues) {
+            vector<CTxAdmissionItem> items(item.second.begin(), item.second.end());
+            ReleaseNodes(items);
+        }
+        peerQueues.clear();
+        throw;
+    }
+
+    // one tx of each peer in turn, starting after the peer that came first in the last batch
+    auto it = peerQueues.lower_bound(nextPeer);
+    while (batch.size() < TX_ADMISSION_BATCH_SIZE && !peerQueues.empty()) {
+        if (it == peerQueues.end())
+            it = peerQueues.begin();
+
+        batch.push_back(std::move(it->second.front()));
+        it->second.pop_front();
+        if (it->second.empty())
+            it = peerQueues.erase(it);
+        else
+            ++it;
+    }
+    nextPeer = batch.front().pFrom->GetId() + 1;
+}
+
+void CTxAdmissionQueue::PreCheck(vector<CTxAdmissionItem> &batch) {
+    vector<CBaseTx *> txs;
+    txs.reserve(batch.size());
+    for (auto &item : batch) {
+        // rather not work on nonstandard transactions (unless -testnet/-regtest)
+        string reason;
+        if (SysCfg().NetworkID() == MAIN_NET && !IsStandardTx(item.pBaseTx.get(), reason)) {
+            item.fPreChecked  = false;
+            item.rejectCode   = REJECT_NONSTANDARD;
+            item.rejectReason = reason;
+            continue;
+        }
+        txs.push_back(item.pBaseTx.get());
+    }
+
+    // the pubkeys of the accounts registered by the txs in the mempool are not known at the tip yet,
+    // AcceptToMemoryPool verifies those signatures itself
+    CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
+    PrepareTxSignatures(txs, view.cw);
+}
+
+void CTxAdmissionQueue::Admit(vector<CTxAdmissionItem> &batch) {
+    vector<CValidationState> states(batch.size());
+    vector<bool> accepted(batch.size(), false);
+    uint32_t poolSize;
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (batch[i].fPreChecked)
+                accepted[i] = AcceptToMemoryPool(mempool, states[i], batch[i].pBaseTx.get(), true);
+        }
+        poolSize = mempool.memPoolTxs.size();
+    }
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        CTxAdmissionItem &item = batch[i];
+        CValidationState &state = states[i];
+        CInv inv(MSG_TX, item.pBaseTx->GetHash());
+        if (accepted[i]) {
+            RelayTransaction(item.pBaseTx.get(), inv.hash, item.vMsg);
+            {
+                LOCK(cs_mapAlreadyAskedFor);
+                mapAlreadyAskedFor.erase(inv);
+            }
+
+            LogPrint(BCLog::INFO, "AcceptToMemoryPool: %s %s : accepted %s (poolsz %u)\n", item.pFrom->addr.ToString(),
+                     item.pFrom->cleanSubVer, inv.hash.ToString(), poolSize);
+        }
+
+        if (!item.fPreChecked)
+            state.DoS(0, ERRORMSG("%s : txid: %s is nonstandard transaction due to %s", __func__, inv.hash.GetHex(),
+                      item.rejectReason), item.rejectCode, item.rejectReason);
+
+        int32_t nDoS = 0;
+        if (state.IsInvalid(nDoS)) {
+            LogPrint(BCLog::INFO, "%s [%d] from %s %s was not accepted into the memory pool: %s\n",
+                     inv.hash.ToString(), item.pBaseTx->valid_height, item.pFrom->addr.ToString(),
+                     item.pFrom->cleanSubVer, state.GetRejectReason());
+
+            item.pFrom->PushMessage(NetMsgType::REJECT, string(NetMsgType::TX), state.GetRejectCode(),
+                                    state.GetRejectReason(), inv.hash);
+        }
+    }
+}
+
+void CTxAdmissionQueue::ReleaseNodes(vector<CTxAdmissionItem> &batch) {
+    LOCK(cs_vNodes);
+    for (auto &item : batch)
+        item.pFrom->Release();
+}
+
+void CTxAdmissionQueue::Run() {
+    while (true) {
+        vector<CTxAdmissionItem> batch;
+        TakeBatch(batch);
+
+        int64_t beginTime = GetTimeMillis();
+        PreCheck(batch);
+        Admit(batch);
+        ReleaseNodes(batch);
+        LogPrint(BCLog::DEBUG, "%s : admitted a batch of %u txs (%dms)\n", __func__, batch.size(),
+                 GetTimeMillis() - beginTime);
+    }
+}
+
+void ThreadTxAdmission() {
+    RenameThread("coin-txadmission");
+    txAdmissionQueue.Run();
+}
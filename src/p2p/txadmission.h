@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_TXADMISSION_H
+#define P2P_TXADMISSION_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "commons/serialize.h"
+#include "p2p/node.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CBaseTx;
+
+// the txs of a peer waiting for admission, the ones over it are dropped
+static const uint32_t MAX_PEER_TX_ADMISSION_QUEUE = 1000;
+// the txs pre-checked together and admitted under one hold of cs_main
+static const uint32_t TX_ADMISSION_BATCH_SIZE = 100;
+
+/**
+ * The txs received from the peers on their way to the mempool. The message handler only deserializes a tx
+ * and queues it here, a thread of its own admits them in batches: the batches take the txs of the peers in
+ * turn so a flooding peer only delays its own txs, then the stateless checks run without cs_main, the
+ * standardness and the signatures on the sigcheck threads with the pubkeys of the tip, and last the batch
+ * is executed by AcceptToMemoryPool in order under one hold of cs_main. The relay and the reject messages
+ * are sent once cs_main is released.
+ */
+class CTxAdmissionQueue {
+public:
+    CTxAdmissionQueue() : nextPeer(0) {}
+
+    // hold a reference of the peer until its tx is admitted, false if the queue of the peer is full
+    bool Push(CNode *pFrom, const std::shared_ptr<CBaseTx> &pBaseTx, const CDataStream &vMsg);
+
+    // admit the queued txs until shutdown
+    void Run();
+
+private:
+    struct CTxAdmissionItem {
+        CNode *pFrom;
+        std::shared_ptr<CBaseTx> pBaseTx;
+        CDataStream vMsg;  // the tx as received, for the relay
+        bool fPreChecked;  // false if rejected before the execution
+        int32_t rejectCode;
+        std::string rejectReason;
+
+        CTxAdmissionItem(CNode *pFromIn, const std::shared_ptr<CBaseTx> &pBaseTxIn, const CDataStream &vMsgIn)
+            : pFrom(pFromIn), pBaseTx(pBaseTxIn), vMsg(vMsgIn), fPreChecked(true), rejectCode(0) {}
+    };
+
+    // wait for the queued txs and take a batch of them, in turn from the peers
+    void TakeBatch(std::vector<CTxAdmissionItem> &batch);
+    void PreCheck(std::vector<CTxAdmissionItem> &batch);
+    void Admit(std::vector<CTxAdmissionItem> &batch);
+    void ReleaseNodes(std::vector<CTxAdmissionItem> &batch);
+
+    boost::mutex queueMutex;
+    boost::condition_variable queueCond;
+    std::map<NodeId, std::deque<CTxAdmissionItem>> peerQueues;
+    NodeId nextPeer;  // the peer whose tx comes first in the next batch
+};
+
+extern CTxAdmissionQueue txAdmissionQueue;
+
+void ThreadTxAdmission();
+
+#endif  // P2P_TXADMISSION_H
@@ -107,15 +107,21 @@ public:
         nickId2KeyIdCache.RegisterUndoFunc(undoDataFuncMap);
         accountCache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        regId2KeyIdCache.RegisterReadFunc(readDataFuncMap);
+        nickId2KeyIdCache.RegisterReadFunc(readDataFuncMap);
+        accountCache.RegisterReadFunc(readDataFuncMap);
+    }
 public:
 /*  CCompositeKVCache     prefixType            key              value           variable           */
 /*  -------------------- --------------------   --------------  -------------   --------------------- */
     // <prefix$RegID -> KeyID>
-    CCompositeKVCache< dbk::REGID_KEYID,          CRegIDKey,       CKeyID >         regId2KeyIdCache;
+    CCompositeKVCache< dbk::REGID_KEYID,          CRegIDKey,       CKeyID,  CHashMapPolicy >         regId2KeyIdCache;
     // <prefix$NickID -> KeyID>
     CCompositeKVCache< dbk::NICKID_KEYID,         CVarIntValue<uint64_t>,      std::pair<CVarIntValue<uint32_t>,CKeyID>>   nickId2KeyIdCache;
     // <prefix$KeyID -> Account>
-    CCompositeKVCache< dbk::KEYID_ACCOUNT,        CKeyID,       CAccount>        accountCache;
+    CCompositeKVCache< dbk::KEYID_ACCOUNT,        CKeyID,       CAccount,  CHashMapPolicy>        accountCache;
 
 };
 
@@ -13,18 +13,35 @@
 using namespace std;
 
 bool CAssetDBCache::GetAsset(const TokenSymbol &tokenSymbol, CAsset &asset) {
-    return assetCache.GetData(tokenSymbol, asset);
+    auto spRegistryIn = GetRegistry();
+    if (!spRegistryIn)
+        return assetCache.GetData(tokenSymbol, asset);
+
+    if (CDBAccessTracker::GetCurrent() != nullptr)
+        CDBAccessTracker::GetCurrent()->OnRead(dbk::ASSET, tokenSymbol);
+    auto it = spRegistryIn->find(tokenSymbol);
+    if (it == spRegistryIn->end())
+        return false;
+    asset = *it->second;
+    return true;
 }
 
 bool CAssetDBCache::HaveAsset(const TokenSymbol &tokenSymbol) {
-    return assetCache.HaveData(tokenSymbol);
+    auto spRegistryIn = GetRegistry();
+    if (!spRegistryIn)
+        return assetCache.HaveData(tokenSymbol);
+
+    if (CDBAccessTracker::GetCurrent() != nullptr)
+        CDBAccessTracker::GetCurrent()->OnRead(dbk::ASSET, tokenSymbol);
+    return spRegistryIn->count(tokenSymbol) > 0;
 }
 
 bool CAssetDBCache::SaveAsset(const CAsset &asset) {
+    OnAssetsChanged();
     return assetCache.SetData(asset.symbol, asset);
 }
 bool CAssetDBCache::ExistAssetSymbol(const TokenSymbol &tokenSymbol) {
-    return assetCache.HaveData(tokenSymbol);
+    return HaveAsset(tokenSymbol);
 }
 
 shared_ptr<string> CAssetDBCache::CheckTransferCoinSymbol(const TokenSymbol &symbol) {
@@ -53,5 +70,45 @@ bool CAssetDBCache::ExistAssetTradingPair(const CAssetTradingPair &assetTradingP
 bool CAssetDBCache::Flush() {
     assetCache.Flush();
     assetTradingPairCache.Flush();
+
+    // the assets changed by this level are of the base now
+    if (fAssetsChanged && pBase != nullptr)
+        pBase->OnAssetsChanged();
+    fAssetsChanged = false;
     return true;
+}
+
+void CAssetDBCache::RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
+    assetCache.RegisterUndoFunc(undoDataFuncMap);
+    assetTradingPairCache.RegisterUndoFunc(undoDataFuncMap);
+
+    // the undo writes the assets directly
+    auto undoAssets = undoDataFuncMap[dbk::ASSET];
+    undoDataFuncMap[dbk::ASSET] = [this, undoAssets](const CDbOpLogs &dbOpLogs) {
+        undoAssets(dbOpLogs);
+        OnAssetsChanged();
+    };
+}
+
+shared_ptr<const CAssetRegistry> CAssetDBCache::GetRegistry() {
+    if (pBase != nullptr) {
+        if (fAssetsChanged)
+            return nullptr;
+        auto baseLock = CDBAccessTracker::LockBase();
+        return pBase->GetRegistry();
+    }
+
+    if (!spRegistry) {
+        auto spNewRegistry = make_shared<CAssetRegistry>();
+        CUserAssetsIterator it(assetCache);
+        for (it.First(); it.IsValid(); it.Next())
+            spNewRegistry->emplace(it.GetKey(), make_shared<const CAsset>(it.GetAsset()));
+        spRegistry = spNewRegistry;
+    }
+    return spRegistry;
+}
+
+void CAssetDBCache::OnAssetsChanged() {
+    fAssetsChanged = true;
+    spRegistry = nullptr;
 }
\ No newline at end of file
@@ -16,7 +16,9 @@
 #include "dbiterator.h"
 
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -36,6 +38,9 @@ public:
     }
 };
 
+// The assets by symbol, read by the token checks of the txs without copying the assets from the caches
+typedef std::unordered_map<TokenSymbol, std::shared_ptr<const CAsset>> CAssetRegistry;
+
 class CAssetDBCache {
 public:
     CAssetDBCache() {}
@@ -68,6 +73,9 @@ public:
     void SetBaseViewPtr(CAssetDBCache *pBaseIn) {
         assetCache.SetBase(&pBaseIn->assetCache);
         assetTradingPairCache.SetBase(&pBaseIn->assetTradingPairCache);
+        pBase = pBaseIn;
+        fAssetsChanged = false;
+        spRegistry = nullptr;
     }
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
@@ -75,14 +83,31 @@ public:
         assetTradingPairCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
-    void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
-        assetCache.RegisterUndoFunc(undoDataFuncMap);
-        assetTradingPairCache.RegisterUndoFunc(undoDataFuncMap);
+    void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap);
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        assetCache.RegisterReadFunc(readDataFuncMap);
+        assetTradingPairCache.RegisterReadFunc(readDataFuncMap);
     }
 
     shared_ptr<CUserAssetsIterator> CreateUserAssetsIterator() {
         return make_shared<CUserAssetsIterator>(assetCache);
     }
+
+private:
+    /**
+     * The registry of the assets seen by this level, nullptr if the level has changed an asset, whose reads
+     * go to the caches then. The levels above the db read the registry of the db level, built on its first
+     * read by iterating the assets and built again after a flush or an undo has changed an asset of it, as
+     * the assets are issued and updated rarely.
+     */
+    std::shared_ptr<const CAssetRegistry> GetRegistry();
+    void OnAssetsChanged();
+
+    CAssetDBCache *pBase = nullptr;
+    bool fAssetsChanged  = false;  // an asset of this level is not the one of its base
+    std::shared_ptr<const CAssetRegistry> spRegistry;
+
 public:
 /*  CCompositeKVCache     prefixType            key              value           variable           */
 /*  -------------------- --------------------   --------------  -------------   --------------------- */
@@ -4,11 +4,51 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "block.h"
+#include "diskmap.h"
 
 #include "entities/account.h"
 #include "tx/blockpricemediantx.h"
 #include "main.h"
 #include "net.h"
+#include "crypto/sha256.h"
+
+static_assert(sizeof(uint256) == CSHA256::OUTPUT_SIZE, "the merkle levels are hashed as arrays of uint256");
+
+void ComputeMerkleTree(vector<uint256> &tree) {
+    size_t leafCount = tree.size();
+    if (leafCount <= 1)
+        return;
+
+    size_t total = 1;  // the root
+    for (size_t size = leafCount; size > 1; size = (size + 1) / 2)
+        total += size;
+    tree.resize(total);
+
+    size_t j = 0;
+    for (size_t size = leafCount; size > 1; size = (size + 1) / 2) {
+        size_t pairCount = size / 2;
+        SHA256D64(tree[j + size].begin(), tree[j].begin(), pairCount);
+        if (size & 1) {
+            uint256 last[2] = {tree[j + size - 1], tree[j + size - 1]};
+            SHA256D64(tree[j + size + pairCount].begin(), last[0].begin(), 1);
+        }
+        j += size;
+    }
+}
+
+uint256 ComputeMerkleRoot(vector<uint256> hashes) {
+    if (hashes.empty())
+        return uint256();
+
+    // the outputs of a level overwrite the front of its inputs, SHA256D64 reads each batch before writing it
+    while (hashes.size() > 1) {
+        if (hashes.size() & 1)
+            hashes.push_back(hashes.back());
+        SHA256D64(hashes[0].begin(), hashes[0].begin(), hashes.size() / 2);
+        hashes.resize(hashes.size() / 2);
+    }
+    return hashes[0];
+}
 
 uint256 CBlockHeader::GetHash() const {
     return ComputeSignatureHash();
@@ -26,21 +66,23 @@ uint256 CBlockHeader::ComputeSignatureHash() const {
 
 uint256 CBlock::BuildMerkleTree() const {
     vMerkleTree.clear();
+    vMerkleTree.reserve(vptx.size() * 2);
     for (const auto& ptx : vptx) {
         vMerkleTree.push_back(ptx->GetHash());
     }
-    int32_t j = 0;
-    for (int32_t nSize = vptx.size(); nSize > 1; nSize = (nSize + 1) / 2) {
-        for (int32_t i = 0; i < nSize; i += 2) {
-            int32_t i2 = min(i + 1, nSize - 1);
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j + i]), END(vMerkleTree[j + i]),
-                                       BEGIN(vMerkleTree[j + i2]), END(vMerkleTree[j + i2])));
-        }
-        j += nSize;
-    }
+    ::ComputeMerkleTree(vMerkleTree);
     return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
 }
 
+uint256 CBlock::ComputeMerkleRoot() const {
+    vector<uint256> hashes;
+    hashes.reserve(vptx.size() + 1);
+    for (const auto& ptx : vptx) {
+        hashes.push_back(ptx->GetHash());
+    }
+    return ::ComputeMerkleRoot(std::move(hashes));
+}
+
 vector<uint256> CBlock::GetMerkleBranch(int32_t index) const {
     if (vMerkleTree.empty())
         BuildMerkleTree();
@@ -108,10 +150,13 @@ CUserID CBlock::GetMinerUserID() const {
 }
 
 void CBlock::Print() const {
-    string medianPrices;
-    for (const auto &item : GetBlockMedianPrice()) {
-        medianPrices += strprintf("{%s/%s -> %llu}", std::get<0>(item.first), std::get<1>(item.first), item.second);
-    }
+    auto medianPrices = LogLazy([this]() {
+        string prices;
+        for (const auto &item : GetBlockMedianPrice()) {
+            prices += strprintf("{%s/%s -> %llu}", std::get<0>(item.first), std::get<1>(item.first), item.second);
+        }
+        return prices;
+    });
 
     LogPrint(BCLog::DEBUG, "block height=%d, hash=%s, ver=%d, hashPrevBlock=%s, merkleRootHash=%s, nTime=%u, nNonce=%u, vtx=%u, nFuel=%d, "
              "nFuelRate=%d, median prices: %s\n",
@@ -133,26 +178,18 @@ std::tuple<bool, int> CBlock::GetTxIndex(const uint256& txid) const {
 // global functions
 
 bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos) {
-    // Open history file to append
-    CAutoFile fileout = CAutoFile(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (!fileout)
-        return ERRORMSG("WriteBlockToDisk : OpenBlockFile failed");
-
-    // Write index header
-    uint32_t nSize = fileout.GetSerializeSize(block);
-    fileout << FLATDATA(SysCfg().MessageStart()) << nSize;
-
-    // Write block
-    int32_t fileOutPos = ftell(fileout);
-    if (fileOutPos < 0)
-        return ERRORMSG("WriteBlockToDisk : ftell failed");
-    pos.nPos = (uint32_t)fileOutPos;
-    fileout << block;
-
-    // Flush stdio buffers and commit to disk before returning
-    fflush(fileout);
-    if (!IsInitialBlockDownload())
-        FileCommit(fileout);
+    // the record is serialized first and appended by the writer, which keeps the file open
+    uint32_t nSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+    ssRecord.reserve(nSize + 8);
+    ssRecord << FLATDATA(SysCfg().MessageStart()) << nSize;
+    uint32_t headerSize = ssRecord.size();
+    ssRecord << block;
+
+    // the records are synced together by FlushBlockFile() at the flush of the chain state
+    if (!GetDiskFileWriter().Write(pos, "blk", &ssRecord[0], ssRecord.size()))
+        return ERRORMSG("WriteBlockToDisk : write failed");
+    pos.nPos += headerSize;
 
     return true;
 }
@@ -160,6 +197,18 @@ bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos) {
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block) {
     block.SetNull();
 
+    // Deserialize from the mapped file if possible
+    auto pMapped = OpenMappedDiskRecord(pos, "blk");
+    if (pMapped) {
+        try {
+            *pMapped >> block;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : Deserialize error - %s", __func__, e.what());
+        }
+
+        return true;
+    }
+
     // Open history file to read
     CAutoFile filein = CAutoFile(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (!filein)
@@ -185,18 +234,188 @@ bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block) {
     return true;
 }
 
+/** Read-only stream over the raw data of a block view */
+class CRawBlockStream {
+public:
+    int nType;
+    int nVersion;
+
+    CRawBlockStream(const CDataStream &rawData, uint32_t posIn)
+        : nType(SER_DISK), nVersion(CLIENT_VERSION), pData(rawData.empty() ? nullptr : &rawData[0]), pos(posIn),
+          end(rawData.size()) {}
+
+    CRawBlockStream &read(char *pch, size_t nSize) {
+        if (nSize > end - pos)
+            throw std::ios_base::failure("CRawBlockStream::read : end of data");
+        memcpy(pch, pData + pos, nSize);
+        pos += nSize;
+        return (*this);
+    }
+
+    uint32_t GetPos() const { return pos; }
+
+    template <typename T>
+    CRawBlockStream &operator>>(T &obj) {
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+
+private:
+    const char *pData;
+    uint32_t pos;
+    uint32_t end;
+};
+
+void CBlockView::SetNull() {
+    header.SetNull();
+    rawData.clear();
+    txCount    = 0;
+    headerSize = 0;
+    txOffsets.clear();
+    vptx.clear();
+}
+
+bool CBlockView::SetRawData(CSerializeData &data) {
+    SetNull();
+    rawData.swap(data);
+    try {
+        CRawBlockStream stream(rawData, 0);
+        stream >> header;
+        headerSize = stream.GetPos();
+        uint64_t count = ReadCompactSize(stream);
+        // each tx takes a byte at least
+        if (count > rawData.size() - stream.GetPos())
+            return ERRORMSG("%s : tx count %llu of block %s beyond its size", __func__, count,
+                            header.GetHash().GetHex());
+
+        txCount = count;
+        txOffsets.push_back(stream.GetPos());
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+bool CBlockView::DecodeTxs(uint32_t endIndex) {
+    if (endIndex > txCount)
+        return false;
+
+    try {
+        CRawBlockStream stream(rawData, txOffsets.back());
+        while (vptx.size() < endIndex) {
+            std::shared_ptr<CBaseTx> pBaseTx;
+            stream >> pBaseTx;
+            vptx.push_back(std::move(pBaseTx));
+            txOffsets.push_back(stream.GetPos());
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize error of tx %u of block %s - %s", __func__, vptx.size(),
+                        header.GetHash().GetHex(), e.what());
+    }
+    return true;
+}
+
+std::shared_ptr<CBaseTx> CBlockView::GetTx(uint32_t index) {
+    if (!DecodeTxs(index + 1))
+        return nullptr;
+
+    return vptx[index];
+}
+
+std::shared_ptr<CBaseTx> CBlockView::GetTxAtOffset(uint32_t txOffset) const {
+    std::shared_ptr<CBaseTx> pBaseTx;
+    if (txOffset >= rawData.size() - headerSize)
+        return nullptr;
+
+    try {
+        CRawBlockStream stream(rawData, headerSize + txOffset);
+        stream >> pBaseTx;
+    } catch (std::exception &e) {
+        LogPrint(BCLog::ERROR, "%s : Deserialize error of the tx at offset %u of block %s - %s\n", __func__,
+                 txOffset, header.GetHash().GetHex(), e.what());
+        return nullptr;
+    }
+    return pBaseTx;
+}
+
+bool CBlockView::GetTxRange(uint32_t index, uint32_t &begin, uint32_t &end) {
+    if (!DecodeTxs(index + 1))
+        return false;
+
+    begin = txOffsets[index];
+    end   = txOffsets[index + 1];
+    return true;
+}
+
+bool CBlockView::GetBlock(CBlock &block) {
+    if (!DecodeTxs(txCount))
+        return false;
+
+    block.SetNull();
+    *((CBlockHeader *)&block) = header;
+    block.vptx               = vptx;
+    return true;
+}
+
+bool ReadBlockViewFromDisk(const CDiskBlockPos &pos, CBlockView &view) {
+    view.SetNull();
+    CSerializeData data;
+
+    // Copy the record from the mapped file if possible
+    auto pMapped = OpenMappedDiskRecord(pos, "blk");
+    if (pMapped) {
+        data.assign(pMapped->data(), pMapped->data() + pMapped->size());
+        return view.SetRawData(data);
+    }
+
+    // Open history file to read, from the size in the index header
+    CAutoFile filein = CAutoFile(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("%s : OpenBlockFile failed", __func__);
+
+    try {
+        uint32_t nSize;
+        if (pos.nPos < sizeof(nSize) || fseek(filein, pos.nPos - sizeof(nSize), SEEK_SET) != 0)
+            return ERRORMSG("%s : seek to the index header failed", __func__);
+        filein >> nSize;
+        if (nSize > MAX_BLOCK_SIZE)
+            return ERRORMSG("%s : block size %u too large", __func__, nSize);
+
+        data.resize(nSize);
+        filein.read(data.data(), nSize);
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : I/O error - %s", __func__, e.what());
+    }
+    return view.SetRawData(data);
+}
+
+bool ReadBlockViewFromDisk(const CBlockIndex *pIndex, CBlockView &view) {
+    if (!ReadBlockViewFromDisk(pIndex->GetBlockPos(), view))
+        return false;
+
+    if (view.GetHeader().GetHash() != pIndex->GetBlockHash())
+        return ERRORMSG("%s : GetHash() doesn't match", __func__);
+
+    return true;
+}
+
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx) {
-    auto pBlock = std::make_shared<CBlock>();
     const CBlockIndex* pBlockIndex = chainActive[ txCord.GetHeight() ];
     if (pBlockIndex == nullptr) {
         return ERRORMSG("ReadBaseTxFromDisk error, the height(%d) is exceed current best block height", txCord.GetHeight());
     }
-    if (!ReadBlockFromDisk(pBlockIndex, *pBlock)) {
+    // only the txs up to the one of the cord are decoded
+    CBlockView view;
+    if (!ReadBlockViewFromDisk(pBlockIndex, view)) {
         return ERRORMSG("ReadBaseTxFromDisk error, read the block at height(%d) failed!", txCord.GetHeight());
     }
-    if (txCord.GetIndex() >= pBlock->vptx.size()) {
+    if (txCord.GetIndex() >= view.GetTxCount()) {
         return ERRORMSG("ReadBaseTxFromDisk error, the tx(%s) index exceed the tx count of block", txCord.ToString());
     }
-    pTx = pBlock->vptx.at(txCord.GetIndex())->GetNewInstance();
+    auto pBaseTx = view.GetTx(txCord.GetIndex());
+    if (!pBaseTx) {
+        return ERRORMSG("ReadBaseTxFromDisk error, decode the tx(%s) failed!", txCord.ToString());
+    }
+    pTx = pBaseTx->GetNewInstance();
     return true;
 }
@@ -22,11 +22,21 @@
 
 #include <stdint.h>
 #include <memory>
+#include <type_traits>
+#include <unordered_map>
 
 class CBlockDBCache;
 class CDiskBlockPos;
 class CNode;
 
+/**
+ * Extend the leaf hashes of tree with the upper levels of their merkle tree up to the root, the last
+ * node of an odd level being paired with itself. Each level is hashed by the batched SHA256D64.
+ */
+void ComputeMerkleTree(vector<uint256> &tree);
+/** The merkle root of the hashes, computed in place level by level without keeping the tree */
+uint256 ComputeMerkleRoot(vector<uint256> hashes);
+
 enum BlockStatus {
     BLOCK_VALID_UNKNOWN         = 0,
     BLOCK_VALID_HEADER          = 1,  // parsed, version ok, hash satisfies claimed PoW, 1 <= vtx count <= max, timestamp not in future
@@ -163,7 +173,10 @@ public:
         return block;
     }
 
+    // build vMerkleTree, needed by GetTxid, GetTxIndex and GetMerkleBranch, and return the root
     uint256 BuildMerkleTree() const;
+    // the merkle root without building vMerkleTree
+    uint256 ComputeMerkleRoot() const;
 
     std::tuple<bool, int32_t> GetTxIndex(const uint256 &txid) const;
 
@@ -445,6 +458,58 @@ public:
     }
 };
 
+/** Hash index of all the known block headers */
+typedef std::unordered_map<uint256, CBlockIndex *, CUint256Hasher> BlockMap;
+
+/**
+ * Storage of the CBlockIndex records. They are constructed in large contiguous chunks instead of
+ * one heap object each, which saves the allocation overhead of every header and keeps the headers
+ * loaded together close in memory. The records live as long as the pool, their addresses are
+ * stable because a chunk is never moved.
+ */
+class CBlockIndexPool {
+public:
+    static const size_t CHUNK_SIZE = 4096;
+
+    CBlockIndexPool() : count(0) {}
+    CBlockIndexPool(const CBlockIndexPool &) = delete;
+    CBlockIndexPool &operator=(const CBlockIndexPool &) = delete;
+    ~CBlockIndexPool() { Clear(); }
+
+    template <typename... Args>
+    CBlockIndex *Create(Args &&... args) {
+        if (count == chunks.size() * CHUNK_SIZE)
+            chunks.emplace_back(new Slot[CHUNK_SIZE]);
+
+        void *pSlot = &chunks[count / CHUNK_SIZE][count % CHUNK_SIZE];
+        CBlockIndex *pIndex = new (pSlot) CBlockIndex(std::forward<Args>(args)...);
+        ++count;
+        return pIndex;
+    }
+
+    size_t Size() const { return count; }
+
+    // allocate the chunks for n records at once, so a bulk load does not grow the pool while filling it
+    void Reserve(size_t n) {
+        while (chunks.size() * CHUNK_SIZE < n)
+            chunks.emplace_back(new Slot[CHUNK_SIZE]);
+    }
+
+    // destroy all the records, no pointer to them may be used afterwards
+    void Clear() {
+        for (size_t i = 0; i < count; ++i)
+            reinterpret_cast<CBlockIndex *>(&chunks[i / CHUNK_SIZE][i % CHUNK_SIZE])->~CBlockIndex();
+        chunks.clear();
+        count = 0;
+    }
+
+private:
+    typedef std::aligned_storage<sizeof(CBlockIndex), alignof(CBlockIndex)>::type Slot;
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    size_t count;
+};
+
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
  * The further back it is, the further before the fork it may be.
@@ -465,10 +530,50 @@ struct CBlockLocator {
     bool IsNull() { return vHave.empty(); }
 };
 
+/**
+ * A block read from disk with its txs decoded on demand, for the readers needing only its header, its bytes or
+ * a few of its txs. The txs are not length prefixed, so the range of a tx is known once the txs before it are
+ * decoded, the decoded txs are kept for the later reads. Not thread safe.
+ */
+class CBlockView {
+public:
+    CBlockView() : rawData(SER_DISK, CLIENT_VERSION), txCount(0), headerSize(0) {}
+
+    const CBlockHeader &GetHeader() const { return header; }
+    uint32_t GetTxCount() const { return txCount; }
+    // the block as serialized on disk, the same bytes as on the network
+    const CDataStream &GetRawData() const { return rawData; }
+
+    // the tx at the index, null if out of range or not decodable
+    std::shared_ptr<CBaseTx> GetTx(uint32_t index);
+    // the tx at the offset of its CDiskTxPos, i.e. from the end of the header, without the txs before it
+    std::shared_ptr<CBaseTx> GetTxAtOffset(uint32_t txOffset) const;
+    // the range [begin, end) of the tx at the index in the raw data
+    bool GetTxRange(uint32_t index, uint32_t &begin, uint32_t &end);
+    // decode all the txs
+    bool GetBlock(CBlock &block);
+
+    // take the serialized block and decode its header
+    bool SetRawData(CSerializeData &data);
+    void SetNull();
+
+private:
+    bool DecodeTxs(uint32_t endIndex);
+
+    CBlockHeader header;
+    CDataStream rawData;
+    uint32_t txCount;
+    uint32_t headerSize;
+    std::vector<uint32_t> txOffsets;  // the begin of each decoded tx and the end of the last one
+    std::vector<std::shared_ptr<CBaseTx>> vptx;  // the txs decoded so far
+};
+
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos);
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block);
 bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block);
+bool ReadBlockViewFromDisk(const CDiskBlockPos &pos, CBlockView &view);
+bool ReadBlockViewFromDisk(const CBlockIndex *pIndex, CBlockView &view);
 
 
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx);
@@ -8,9 +8,15 @@
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 #include "main.h"
+#include "taskscheduler.h"
 
 #include <stdint.h>
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <boost/thread.hpp>
+
 using namespace std;
 
 
@@ -23,55 +29,101 @@ bool CBlockIndexDB::EraseBlockIndex(const uint256 &blockHash) {
 }
 
 bool CBlockIndexDB::LoadBlockIndexes() {
-    leveldb::Iterator *pCursor = NewIterator();
+    int64_t beginTime = GetTimeMillis();
+    uint32_t nThreads = GetLoadThreadCount();
     const std::string &prefix = dbk::GetKeyPrefix(dbk::BLOCK_INDEX);
 
-    pCursor->Seek(prefix);
-
-    // Load mapBlockIndex
-    while (pCursor->Valid()) {
-        boost::this_thread::interruption_point();
+    // the cursor is walked on this thread, the records are decoded and hashed on the workers
+    vector<string> values;
+    {
+        unique_ptr<leveldb::Iterator> pCursor(NewIterator());
+        for (pCursor->Seek(prefix); pCursor->Valid() && pCursor->key().starts_with(prefix); pCursor->Next()) {
+            boost::this_thread::interruption_point();
+            values.emplace_back(pCursor->value().data(), pCursor->value().size());
+        }
+        if (!pCursor->status().ok())
+            return ERRORMSG("%s : I/O error - %s", __func__, pCursor->status().ToString());
+    }
+    int64_t readTime = GetTimeMillis();
+
+    // the records are decoded in place into the index pool, allocated up front
+    size_t count = values.size();
+    vector<CBlockIndex *> vIndex(count);
+    blockIndexPool.Reserve(blockIndexPool.Size() + count);
+    for (size_t i = 0; i < count; i++)
+        vIndex[i] = blockIndexPool.Create();
+
+    vector<uint256> hashes(count), prevHashes(count);
+    std::atomic<bool> fError(false);
+    ParallelFor(TASK_PRIORITY_CONSENSUS, count, nThreads, [&](size_t i) {
         try {
-            leveldb::Slice slKey = pCursor->key();
-            if (slKey.starts_with(prefix)) {
-                leveldb::Slice slValue = pCursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CDiskBlockIndex diskIndex;
-                ssValue >> diskIndex;
-
-                // Construct block index object
-                CBlockIndex *pIndexNew    = InsertBlockIndex(diskIndex.GetBlockHash());
-                pIndexNew->pprev          = InsertBlockIndex(diskIndex.hashPrev);
-                pIndexNew->height         = diskIndex.height;
-                pIndexNew->nFile          = diskIndex.nFile;
-                pIndexNew->nDataPos       = diskIndex.nDataPos;
-                pIndexNew->nUndoPos       = diskIndex.nUndoPos;
-                pIndexNew->nVersion       = diskIndex.nVersion;
-                pIndexNew->merkleRootHash = diskIndex.merkleRootHash;
-                pIndexNew->hashPos        = diskIndex.hashPos;
-                pIndexNew->nTime          = diskIndex.nTime;
-                pIndexNew->nBits          = diskIndex.nBits;
-                pIndexNew->nNonce         = diskIndex.nNonce;
-                pIndexNew->nStatus        = diskIndex.nStatus;
-                pIndexNew->nTx            = diskIndex.nTx;
-                pIndexNew->nFuel          = diskIndex.nFuel;
-                pIndexNew->nFuelRate      = diskIndex.nFuelRate;
-                pIndexNew->vSignature     = diskIndex.vSignature;
-                pIndexNew->miner          = diskIndex.miner ;
-
-                if (!pIndexNew->CheckIndex())
-                    return ERRORMSG("LoadBlockIndex() : CheckIndex failed: %s", pIndexNew->ToString());
-
-                pCursor->Next();
-            } else {
-                break;  // if shutdown requested or finished loading block index
+            CDataStream ssValue(values[i].data(), values[i].data() + values[i].size(), SER_DISK, CLIENT_VERSION);
+            CDiskBlockIndex diskIndex;
+            ssValue >> diskIndex;
+
+            CBlockIndex *pIndexNew    = vIndex[i];
+            pIndexNew->height         = diskIndex.height;
+            pIndexNew->nFile          = diskIndex.nFile;
+            pIndexNew->nDataPos       = diskIndex.nDataPos;
+            pIndexNew->nUndoPos       = diskIndex.nUndoPos;
+            pIndexNew->nVersion       = diskIndex.nVersion;
+            pIndexNew->merkleRootHash = diskIndex.merkleRootHash;
+            pIndexNew->hashPos        = diskIndex.hashPos;
+            pIndexNew->nTime          = diskIndex.nTime;
+            pIndexNew->nBits          = diskIndex.nBits;
+            pIndexNew->nNonce         = diskIndex.nNonce;
+            pIndexNew->nStatus        = diskIndex.nStatus;
+            pIndexNew->nTx            = diskIndex.nTx;
+            pIndexNew->nFuel          = diskIndex.nFuel;
+            pIndexNew->nFuelRate      = diskIndex.nFuelRate;
+            pIndexNew->vSignature     = std::move(diskIndex.vSignature);
+            pIndexNew->miner          = diskIndex.miner;
+            hashes[i]                 = diskIndex.GetBlockHash();
+            prevHashes[i]             = diskIndex.hashPrev;
+
+            if (!pIndexNew->CheckIndex()) {
+                fError = true;
+                LogPrint(BCLog::ERROR, "LoadBlockIndex() : CheckIndex failed: %s\n", pIndexNew->ToString());
             }
         } catch (std::exception &e) {
-            return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+            fError = true;
+            LogPrint(BCLog::ERROR, "LoadBlockIndex() : Deserialize or I/O error - %s\n", e.what());
+        }
+    });
+    vector<string>().swap(values);
+    if (fError)
+        return ERRORMSG("%s : decode the block indexes failed", __func__);
+
+    {
+        std::unique_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+        mapBlockIndex.reserve(mapBlockIndex.size() + count);
+        for (size_t i = 0; i < count; i++) {
+            auto ret = mapBlockIndex.emplace(hashes[i], vIndex[i]);
+            if (!ret.second)
+                return ERRORMSG("%s : duplicate block index %s", __func__, hashes[i].GetHex());
+            vIndex[i]->pBlockHash = &ret.first->first;
         }
     }
-    delete pCursor;
 
+    // the map is only read while linking, the parents missing from the db are added afterwards as before
+    vector<size_t> vOrphan;
+    std::mutex orphanMutex;
+    ParallelFor(TASK_PRIORITY_CONSENSUS, count, nThreads, [&](size_t i) {
+        if (prevHashes[i].IsNull())
+            return;
+        auto it = mapBlockIndex.find(prevHashes[i]);
+        if (it != mapBlockIndex.end()) {
+            vIndex[i]->pprev = it->second;
+        } else {
+            std::lock_guard<std::mutex> lock(orphanMutex);
+            vOrphan.push_back(i);
+        }
+    });
+    for (size_t i : vOrphan)
+        vIndex[i]->pprev = InsertBlockIndex(prevHashes[i]);
+
+    LogPrint(BCLog::INFO, "%s : loaded %u block indexes on %u threads, read %dms, decode and link %dms\n", __func__,
+             count, nThreads, readTime - beginTime, GetTimeMillis() - readTime);
     return true;
 }
 
@@ -82,20 +134,32 @@ bool CBlockIndexDB::ReadBlockFileInfo(int32_t nFile, CBlockFileInfo &info) {
     return Read(dbk::GenDbKey(dbk::BLOCKFILE_NUM_INFO, nFile), info);
 }
 
+bool CBlockIndexDB::ReadSingleStateDb(bool &fSingleStateDb) {
+    return Read(dbk::GetKeyPrefix(dbk::SINGLE_STATE_DB), fSingleStateDb);
+}
+bool CBlockIndexDB::WriteSingleStateDb(bool fSingleStateDb) {
+    return Write(dbk::GetKeyPrefix(dbk::SINGLE_STATE_DB), fSingleStateDb, true);
+}
+
+bool CBlockIndexDB::IsEmpty() {
+    unique_ptr<leveldb::Iterator> pCursor(NewIterator());
+    pCursor->SeekToFirst();
+    return !pCursor->Valid();
+}
+
 CBlockIndex *InsertBlockIndex(uint256 hash) {
     if (hash.IsNull())
         return nullptr;
 
     // Return existing
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hash);
+    BlockMap::iterator mi = mapBlockIndex.find(hash);
     if (mi != mapBlockIndex.end())
         return (*mi).second;
 
     // Create new
-    CBlockIndex *pIndexNew = new CBlockIndex();
-    if (!pIndexNew)
-        throw runtime_error("LoadBlockIndex() : new CBlockIndex failed");
-    mi                    = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
+    CBlockIndex *pIndexNew = blockIndexPool.Create();
+    std::unique_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+    mi                     = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
     pIndexNew->pBlockHash = &((*mi).first);
 
     return pIndexNew;
@@ -111,7 +175,10 @@ uint32_t CBlockDBCache::GetCacheSize() const {
         lastBlockFileCache.GetCacheSize() +
         medianPricesCache.GetCacheSize() +
         reindexCache.GetCacheSize() +
-        finalityBlockCache.GetCacheSize() ;
+        finalityBlockCache.GetCacheSize() +
+        keyIdTxidCache.GetCacheSize() +
+        blockFilterCache.GetCacheSize() +
+        medianPriceIndexCache.GetCacheSize();
 }
 
 bool CBlockDBCache::Flush() {
@@ -122,6 +189,9 @@ bool CBlockDBCache::Flush() {
     medianPricesCache.Flush();
     reindexCache.Flush();
     finalityBlockCache.Flush();
+    keyIdTxidCache.Flush();
+    blockFilterCache.Flush();
+    medianPriceIndexCache.Flush();
     return true;
 }
 
@@ -183,6 +253,52 @@ bool CBlockDBCache::WriteTxIndexes(const vector<pair<uint256, CDiskTxPos> > &lis
     return true;
 }
 
+bool CBlockDBCache::SetAddressTxid(const CKeyID &keyId, uint32_t height, uint32_t index, const uint256 &txid) {
+    return keyIdTxidCache.SetData(make_tuple(keyId, CFixedUInt32(height), CFixedUInt32(index)), txid);
+}
+
+bool CBlockDBCache::GetBlockFilter(const uint256 &blockHash, CBlockFilter &filter) const {
+    return blockFilterCache.GetData(blockHash, filter);
+}
+
+bool CBlockDBCache::SetBlockFilter(const CBlockFilter &filter) {
+    return blockFilterCache.SetData(filter.GetBlockHash(), filter);
+}
+
+bool CBlockDBCache::SetMedianPriceRecord(uint32_t height, const PriceMap &prevPrices, const PriceMap &prices) {
+    // a delta record needs the one of the height before, so a record after a height not indexed is a key one
+    bool isKey = height % MEDIAN_PRICE_KEY_INTERVAL == 0 || height == 0 ||
+                 !medianPriceIndexCache.HaveData(CFixedUInt32(height - 1));
+    return medianPriceIndexCache.SetData(CFixedUInt32(height), CMedianPriceRecord(prevPrices, prices, isKey));
+}
+
+bool CBlockDBCache::GetMedianPriceHistory(uint32_t beginHeight, uint32_t endHeight,
+                                          vector<pair<uint32_t, PriceMap>> &history) {
+    if (endHeight < beginHeight)
+        return true;
+
+    // the first record at or after the key height is a key record, see SetMedianPriceRecord()
+    uint32_t keyHeight = beginHeight - beginHeight % MEDIAN_PRICE_KEY_INTERVAL;
+    CDBRangeIterator<decltype(medianPriceIndexCache)> it(medianPriceIndexCache, CFixedUInt32(keyHeight),
+                                                         CFixedUInt32(endHeight + 1));
+    PriceMap prices;
+    bool fHavePrices = false;
+    uint32_t lastHeight = 0;
+    for (it.First(); it.IsValid(); it.Next()) {
+        uint32_t height = it.GetKey().value;
+        const CMedianPriceRecord &record = it.GetValue();
+        if (!record.IsKey() && (!fHavePrices || height != lastHeight + 1))
+            return ERRORMSG("%s, the median price record of height %u has no record before it", __func__, height);
+
+        record.Apply(prices);
+        fHavePrices = true;
+        lastHeight  = height;
+        if (height >= beginHeight)
+            history.emplace_back(height, prices);
+    }
+    return true;
+}
+
 bool CBlockDBCache::WriteReindexing(bool fReindexing) {
     if (fReindexing)
         return reindexCache.SetData(true);
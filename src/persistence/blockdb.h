@@ -10,12 +10,42 @@
 #include <utility>
 #include <vector>
 #include "commons/arith_uint256.h"
+#include "commons/leb128.h"
 #include "leveldbwrapper.h"
 #include "dbaccess.h"
+#include "dbiterator.h"
 #include "persistence/block.h"
+#include "chain/blockfilter.h"
 
 #include <map>
 
+/*  CCompositeKVCache     prefixType            key                                           value         variable           */
+/*  -------------------- --------------------  -------------------------------------------  -----------   --------------------- */
+    // {keyId, height, index} -> txid
+typedef CCompositeKVCache< dbk::KEYID_TXID,    tuple<CKeyID, CFixedUInt32, CFixedUInt32>,   uint256>      DBKeyIdTxidCache;
+
+/** The txids of a keyid in the order of the chain, by -addressindex */
+class CDBKeyIdTxidIterator: public CDBPrefixIterator<DBKeyIdTxidCache, CKeyID> {
+private:
+    typedef typename DBKeyIdTxidCache::KeyType KeyType;
+    typedef CDBPrefixIterator<DBKeyIdTxidCache, CKeyID> Base;
+public:
+    CDBKeyIdTxidIterator(DBKeyIdTxidCache &dbCache, const CKeyID &keyId): Base(dbCache, keyId) {}
+
+    // seek to the first tx at or after the {height, index}
+    bool Seek(uint32_t height, uint32_t index) {
+        if (height == 0 && index == 0)
+            return First();
+        KeyType lastKey = (index > 0) ?
+            KeyType(GetPrefixElement(), CFixedUInt32(height), CFixedUInt32(index - 1)) :
+            KeyType(GetPrefixElement(), CFixedUInt32(height - 1), CFixedUInt32(UINT32_MAX));
+        return sp_it_Impl->SeekUpper(&lastKey);
+    }
+
+    uint32_t GetHeight() const { return std::get<1>(GetKey()).value; }
+    uint32_t GetIndex() const { return std::get<2>(GetKey()).value; }
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockIndexDB : public CLevelDBWrapper {
 private:
@@ -24,7 +54,7 @@ private:
 
 public:
     CBlockIndexDB(bool fMemory = false, bool fWipe = false) :
-        CLevelDBWrapper(GetDataDir() / "blocks" / "index", 2 << 20 /* 2MB */, fMemory, fWipe) {}
+        CLevelDBWrapper(GetDataDir() / "blocks" / "index", BLOCK_INDEX_DB_CACHE, fMemory, fWipe) {}
 
     // CBlockIndexDB(const std::string &name, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
@@ -35,6 +65,11 @@ public:
 
     bool ReadBlockFileInfo(int32_t nFile, CBlockFileInfo &fileinfo);
     bool WriteBlockFileInfo(int32_t nFile, const CBlockFileInfo &fileinfo);
+
+    // whether the chain state of the index is kept in the one db of -singlestatedb, false if not written
+    bool ReadSingleStateDb(bool &fSingleStateDb);
+    bool WriteSingleStateDb(bool fSingleStateDb);
+    bool IsEmpty();
 };
 
 
@@ -46,6 +81,9 @@ public:
     CBlockDBCache(CDBAccess *pDbAccess):
         txDiskPosCache(pDbAccess),
         flagCache(pDbAccess),
+        keyIdTxidCache(pDbAccess),
+        blockFilterCache(pDbAccess),
+        medianPriceIndexCache(pDbAccess),
         bestBlockHashCache(pDbAccess),
         lastBlockFileCache(pDbAccess),
         medianPricesCache(pDbAccess),
@@ -57,18 +95,32 @@ public:
     CBlockDBCache(CBlockDBCache *pBaseIn):
         txDiskPosCache(pBaseIn->txDiskPosCache),
         flagCache(pBaseIn->flagCache),
+        keyIdTxidCache(pBaseIn->keyIdTxidCache),
+        blockFilterCache(pBaseIn->blockFilterCache),
+        medianPriceIndexCache(pBaseIn->medianPriceIndexCache),
         bestBlockHashCache(pBaseIn->bestBlockHashCache),
         lastBlockFileCache(pBaseIn->lastBlockFileCache),
         medianPricesCache(pBaseIn->medianPricesCache),
         reindexCache(pBaseIn->reindexCache),
-        finalityBlockCache(pBaseIn->finalityBlockCache){};
+        finalityBlockCache(pBaseIn->finalityBlockCache) {};
 
 public:
     bool Flush();
     uint32_t GetCacheSize() const;
 
-    bool GetTxHashByAddress(const CKeyID &keyId, uint32_t height, map<string, string > &mapTxHash);
-    bool SetTxHashByAddress(const CKeyID &keyId, uint32_t height, uint32_t index, const uint256 &txid);
+    bool SetAddressTxid(const CKeyID &keyId, uint32_t height, uint32_t index, const uint256 &txid);
+    shared_ptr<CDBKeyIdTxidIterator> CreateAddressTxidIterator(const CKeyID &keyId) {
+        return make_shared<CDBKeyIdTxidIterator>(keyIdTxidCache, keyId);
+    }
+
+    bool GetBlockFilter(const uint256 &blockHash, CBlockFilter &filter) const;
+    bool SetBlockFilter(const CBlockFilter &filter);
+
+    // Index the median prices of the block of the height, delta encoded against the prices of the block
+    // before it, by -medianpriceindex
+    bool SetMedianPriceRecord(uint32_t height, const PriceMap &prevPrices, const PriceMap &prices);
+    // The median prices of the indexed heights in [beginHeight, endHeight], in the order of the heights
+    bool GetMedianPriceHistory(uint32_t beginHeight, uint32_t endHeight, vector<pair<uint32_t, PriceMap>> &history);
 
     void SetBaseViewPtr(CBlockDBCache *pBaseIn) {
         txDiskPosCache.SetBase(&pBaseIn->txDiskPosCache);
@@ -78,7 +130,9 @@ public:
         medianPricesCache.SetBase(&pBaseIn->medianPricesCache);
         reindexCache.SetBase(&pBaseIn->reindexCache);
         finalityBlockCache.SetBase(&pBaseIn->finalityBlockCache);
-
+        keyIdTxidCache.SetBase(&pBaseIn->keyIdTxidCache);
+        blockFilterCache.SetBase(&pBaseIn->blockFilterCache);
+        medianPriceIndexCache.SetBase(&pBaseIn->medianPriceIndexCache);
     };
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
@@ -89,6 +143,9 @@ public:
         medianPricesCache.SetDbOpLogMap(pDbOpLogMapIn);
         reindexCache.SetDbOpLogMap(pDbOpLogMapIn);
         finalityBlockCache.SetDbOpLogMap(pDbOpLogMapIn);
+        keyIdTxidCache.SetDbOpLogMap(pDbOpLogMapIn);
+        blockFilterCache.SetDbOpLogMap(pDbOpLogMapIn);
+        medianPriceIndexCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
@@ -99,6 +156,22 @@ public:
         medianPricesCache.RegisterUndoFunc(undoDataFuncMap);
         reindexCache.RegisterUndoFunc(undoDataFuncMap);
         finalityBlockCache.RegisterUndoFunc(undoDataFuncMap);
+        keyIdTxidCache.RegisterUndoFunc(undoDataFuncMap);
+        blockFilterCache.RegisterUndoFunc(undoDataFuncMap);
+        medianPriceIndexCache.RegisterUndoFunc(undoDataFuncMap);
+    }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        txDiskPosCache.RegisterReadFunc(readDataFuncMap);
+        flagCache.RegisterReadFunc(readDataFuncMap);
+        bestBlockHashCache.RegisterReadFunc(readDataFuncMap);
+        lastBlockFileCache.RegisterReadFunc(readDataFuncMap);
+        medianPricesCache.RegisterReadFunc(readDataFuncMap);
+        reindexCache.RegisterReadFunc(readDataFuncMap);
+        finalityBlockCache.RegisterReadFunc(readDataFuncMap);
+        keyIdTxidCache.RegisterReadFunc(readDataFuncMap);
+        blockFilterCache.RegisterReadFunc(readDataFuncMap);
+        medianPriceIndexCache.RegisterReadFunc(readDataFuncMap);
     }
 
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
@@ -131,6 +204,12 @@ public:
     CCompositeKVCache< dbk::TXID_DISKINDEX,         uint256,                  CDiskTxPos >          txDiskPosCache;
     // flag$name -> bool
     CCompositeKVCache< dbk::FLAG,                   string,                   bool>                 flagCache;
+    // {keyId, height, index} -> txid
+    DBKeyIdTxidCache                                                                                     keyIdTxidCache;
+    // blockHash -> BlockFilter, by -blockfilterindex
+    CCompositeKVCache< dbk::BLOCK_FILTER,           uint256,                  CBlockFilter>         blockFilterCache;
+    // height -> median prices of the block, by -medianpriceindex
+    CCompositeKVCache< dbk::MEDIAN_PRICE_INDEX,     CFixedUInt32,             CMedianPriceRecord>   medianPriceIndexCache;
 
 
 /*  CSimpleKVCache          prefixType             value           variable           */
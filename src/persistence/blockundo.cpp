@@ -4,8 +4,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "blockundo.h"
+#include "diskmap.h"
 #include "main.h"
 
+#include <zlib.h>
+
 /** Open an undo file (rev?????.dat) */
 FILE *OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly) {
     return OpenDiskFile(pos, "rev", fReadOnly);
@@ -24,60 +27,293 @@ string CTxUndo::ToString() const {
 ////////////////////////////////////////////////////////////////////////////////
 // class CBlockUndo
 
+// the index of each prefix in the table of the record, in the order of the first appearance
+static void GetPrefixTable(const vector<CTxUndo> &vtxundo, vector<dbk::PrefixType> &prefixes,
+                           vector<int32_t> &indexes) {
+    indexes.assign(dbk::PREFIX_COUNT, -1);
+    for (const auto &txUndo : vtxundo) {
+        for (const auto &opLogPair : txUndo.dbOpLogMap.GetMap()) {
+            int32_t &index = indexes[opLogPair.first];
+            if (index < 0) {
+                index = prefixes.size();
+                prefixes.push_back(opLogPair.first);
+            }
+        }
+    }
+}
+
+unsigned int CBlockUndo::GetSerializeSize(int nType, int nVersion) const {
+    vector<dbk::PrefixType> prefixes;
+    vector<int32_t> indexes;
+    GetPrefixTable(vtxundo, prefixes, indexes);
+
+    uint64_t nSize = 2 + GetSizeOfCompactSize(prefixes.size());
+    for (auto prefixType : prefixes)
+        nSize += ::GetSerializeSize(dbk::GetKeyPrefix(prefixType), nType, nVersion);
+
+    uint64_t blobSize = 0;
+    nSize += GetSizeOfCompactSize(vtxundo.size());
+    for (const auto &txUndo : vtxundo) {
+        const auto &opLogMap = txUndo.dbOpLogMap.GetMap();
+        nSize += txUndo.txid.size() + GetSizeOfCompactSize(opLogMap.size());
+        for (const auto &opLogPair : opLogMap) {
+            nSize += GetSizeOfCompactSize(indexes[opLogPair.first]) + GetSizeOfCompactSize(opLogPair.second.size());
+            for (const auto &opLog : opLogPair.second) {
+                nSize += GetSizeOfCompactSize(opLog.GetKey().size()) + GetSizeOfCompactSize(opLog.GetValue().size());
+                blobSize += opLog.GetKey().size() + opLog.GetValue().size();
+            }
+        }
+    }
+    return nSize + GetSizeOfCompactSize(blobSize) + blobSize;
+}
+
+void CBlockUndo::SerializeRecord(CDataStream &ss) const {
+    vector<dbk::PrefixType> prefixes;
+    vector<int32_t> indexes;
+    GetPrefixTable(vtxundo, prefixes, indexes);
+
+    ss << FORMAT_MARKER << FORMAT_COMPACT;
+    WriteCompactSize(ss, prefixes.size());
+    for (auto prefixType : prefixes)
+        ss << dbk::GetKeyPrefix(prefixType);
+
+    uint64_t blobSize = 0;
+    WriteCompactSize(ss, vtxundo.size());
+    for (const auto &txUndo : vtxundo) {
+        const auto &opLogMap = txUndo.dbOpLogMap.GetMap();
+        ss << txUndo.txid;
+        WriteCompactSize(ss, opLogMap.size());
+        for (const auto &opLogPair : opLogMap) {
+            WriteCompactSize(ss, indexes[opLogPair.first]);
+            WriteCompactSize(ss, opLogPair.second.size());
+            for (const auto &opLog : opLogPair.second) {
+                WriteCompactSize(ss, opLog.GetKey().size());
+                WriteCompactSize(ss, opLog.GetValue().size());
+                blobSize += opLog.GetKey().size() + opLog.GetValue().size();
+            }
+        }
+    }
+
+    WriteCompactSize(ss, blobSize);
+    ss.reserve(ss.size() + blobSize);
+    for (const auto &txUndo : vtxundo) {
+        for (const auto &opLogPair : txUndo.dbOpLogMap.GetMap()) {
+            for (const auto &opLog : opLogPair.second) {
+                ss.write(opLog.GetKey().data(), opLog.GetKey().size());
+                ss.write(opLog.GetValue().data(), opLog.GetValue().size());
+            }
+        }
+    }
+}
+
+static void UnserializeCompact(CSpanReader &s, vector<CTxUndo> &vtxundo) {
+    vector<dbk::PrefixType> prefixes(ReadCompactSize(s));
+    for (auto &prefixType : prefixes) {
+        string prefix;
+        s >> prefix;
+        prefixType = dbk::ParseKeyPrefixType(prefix);
+        if (prefixType == dbk::EMPTY)
+            throw ios_base::failure("CBlockUndo::UnserializeRecord : unknown prefix " + prefix);
+    }
+
+    // the logs are sized by the headers, then filled from the blob in the order of the headers
+    struct COpLogSizes {
+        CDbOpLog *pOpLog;
+        uint64_t keySize;
+        uint64_t valueSize;
+    };
+    vector<COpLogSizes> opLogSizes;
+    uint64_t totalSize = 0;
+
+    // reserved for all the txs, the pointers of opLogSizes must not move
+    uint64_t txCount = ReadCompactSize(s);
+    if (txCount > s.size() / sizeof(uint256))
+        throw ios_base::failure("CBlockUndo::UnserializeRecord : tx count out of range");
+    vtxundo.clear();
+    vtxundo.reserve(txCount);
+    for (uint64_t i = 0; i < txCount; ++i) {
+        vtxundo.emplace_back();
+        CTxUndo &txUndo = vtxundo.back();
+        s >> txUndo.txid;
+
+        auto &opLogMap = txUndo.dbOpLogMap.GetMap();
+        uint64_t groupCount = ReadCompactSize(s);
+        for (uint64_t j = 0; j < groupCount; ++j) {
+            uint64_t index = ReadCompactSize(s);
+            if (index >= prefixes.size())
+                throw ios_base::failure("CBlockUndo::UnserializeRecord : prefix index out of range");
+            // each log has two sizes at least in the headers
+            uint64_t opCount = ReadCompactSize(s);
+            if (opCount > s.size() / 2)
+                throw ios_base::failure("CBlockUndo::UnserializeRecord : log count out of range");
+            if (!opLogMap.emplace(prefixes[index], CDbOpLogs(opCount)).second)
+                throw ios_base::failure("CBlockUndo::UnserializeRecord : duplicated prefix in tx");
+
+            for (auto &opLog : opLogMap[prefixes[index]]) {
+                uint64_t keySize   = ReadCompactSize(s);
+                uint64_t valueSize = ReadCompactSize(s);
+                totalSize += keySize + valueSize;
+                opLogSizes.push_back({&opLog, keySize, valueSize});
+            }
+        }
+    }
+
+    uint64_t blobSize = ReadCompactSize(s);
+    if (blobSize != totalSize || blobSize > s.size())
+        throw ios_base::failure("CBlockUndo::UnserializeRecord : blob size mismatch");
+
+    for (const auto &sizes : opLogSizes) {
+        string key(sizes.keySize, '\0');
+        string value(sizes.valueSize, '\0');
+        s.read(&key[0], key.size());
+        s.read(&value[0], value.size());
+        sizes.pOpLog->SetRaw(std::move(key), std::move(value));
+    }
+}
+
+void CBlockUndo::UnserializeRecord(CSpanReader &s) {
+    uint8_t marker;
+    s >> marker;
+    if (marker != FORMAT_MARKER) {
+        // the legacy record, the marker is the first byte of the compact size of vtxundo
+        uint64_t txCount = marker;
+        if (marker == 253) {
+            uint16_t xSize;
+            s >> xSize;
+            txCount = xSize;
+        } else if (marker == 254) {
+            uint32_t xSize;
+            s >> xSize;
+            txCount = xSize;
+        }
+        vtxundo.clear();
+        vtxundo.reserve(min<uint64_t>(txCount, s.size() / sizeof(uint256)));
+        for (uint64_t i = 0; i < txCount; ++i) {
+            vtxundo.emplace_back();
+            s >> vtxundo.back().txid;
+            vtxundo.back().dbOpLogMap.UnserializeLegacy(s, s.nType, s.nVersion);
+        }
+        return;
+    }
+
+    uint8_t format;
+    s >> format;
+    if (format == FORMAT_ZLIB) {
+        uint64_t rawSize = ReadCompactSize(s);
+        string raw(rawSize, '\0');
+        uLongf destLen = rawSize;
+        if (uncompress((Bytef *)&raw[0], &destLen, (const Bytef *)s.data(), s.size()) != Z_OK || destLen != rawSize)
+            throw ios_base::failure("CBlockUndo::UnserializeRecord : uncompress failed");
+        s.ignore(s.size());
+
+        CSpanReader rawReader(raw.data(), raw.data() + raw.size(), s.nType, s.nVersion);
+        rawReader >> marker >> format;
+        if (marker != FORMAT_MARKER || format != FORMAT_COMPACT)
+            throw ios_base::failure("CBlockUndo::UnserializeRecord : bad compressed format");
+        UnserializeCompact(rawReader, vtxundo);
+        return;
+    }
+
+    if (format != FORMAT_COMPACT)
+        throw ios_base::failure(strprintf("CBlockUndo::UnserializeRecord : unknown format %d", format));
+    UnserializeCompact(s, vtxundo);
+}
+
+static bool IsUndoCompressEnabled() {
+    static bool fCompress = SysCfg().GetBoolArg("-undocompress", DEFAULT_UNDO_COMPRESS);
+    return fCompress;
+}
+
 bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
-    // Open history file to append
-    CAutoFile fileout = CAutoFile(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
-    if (!fileout)
-        return ERRORMSG("CBlockUndo::WriteToDisk : OpenUndoFile failed");
-
-    // Write index header
-    uint32_t nSize = fileout.GetSerializeSize(*this);
-    fileout << FLATDATA(SysCfg().MessageStart()) << nSize;
-
-    // Write undo data
-    long fileOutPos = ftell(fileout);
-    if (fileOutPos < 0)
-        return ERRORMSG("CBlockUndo::WriteToDisk : ftell failed");
-    pos.nPos = (uint32_t)fileOutPos;
-    fileout << *this;
-
-    // calculate & write checksum
+    CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+    SerializeRecord(ssRecord);
+
+    if (IsUndoCompressEnabled()) {
+        uLongf compressedSize = compressBound(ssRecord.size());
+        vector<char> compressed(compressedSize);
+        if (compress2((Bytef *)&compressed[0], &compressedSize, (const Bytef *)&ssRecord[0], ssRecord.size(),
+                      Z_BEST_SPEED) == Z_OK) {
+            CDataStream ssCompressed(SER_DISK, CLIENT_VERSION);
+            ssCompressed << FORMAT_MARKER << FORMAT_ZLIB;
+            WriteCompactSize(ssCompressed, ssRecord.size());
+            ssCompressed.write(&compressed[0], compressedSize);
+            if (ssCompressed.size() < ssRecord.size())
+                std::swap(ssRecord, ssCompressed);
+        }
+    }
+
+    // Write index header, the undo data and its checksum, of the record bytes as in the legacy records
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << blockHash;
-    hasher << *this;
+    hasher.write(&ssRecord[0], ssRecord.size());
 
-    fileout << hasher.GetHash();
+    CDataStream ssFile(SER_DISK, CLIENT_VERSION);
+    ssFile.reserve(ssRecord.size() + 40);
+    ssFile << FLATDATA(SysCfg().MessageStart()) << (uint32_t)ssRecord.size();
+    uint32_t headerSize = ssFile.size();
+    ssFile.write(&ssRecord[0], ssRecord.size());
+    ssFile << hasher.GetHash();
 
-    // Flush stdio buffers and commit to disk before returning
-    fflush(fileout);
-    if (!IsInitialBlockDownload())
-        FileCommit(fileout);
+    // the records are synced together by FlushBlockFile() at the flush of the chain state
+    if (!GetDiskFileWriter().Write(pos, "rev", &ssFile[0], ssFile.size()))
+        return ERRORMSG("CBlockUndo::WriteToDisk : write failed");
+    pos.nPos += headerSize;
 
     return true;
 }
 
 bool CBlockUndo::ReadFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash) {
-    // Open history file to read
-    CAutoFile filein = CAutoFile(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (!filein)
-        return ERRORMSG("CBlockUndo::ReadFromDisk : OpenBlockFile failed");
-
-    // Read block
     uint256 hashChecksum;
-    try {
-        filein >> *this;
-        filein >> hashChecksum;
-    } catch (std::exception &e) {
-        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    vector<char> record;
+    const char *pRecord;
+    size_t recordSize;
+    // Read from the mapped file if possible, the record is followed by its checksum
+    auto pMapped = OpenMappedDiskRecord(pos, "rev", sizeof(hashChecksum));
+    if (pMapped) {
+        if (pMapped->size() < sizeof(hashChecksum))
+            return ERRORMSG("%s : record truncated", __func__);
+        pRecord    = pMapped->data();
+        recordSize = pMapped->size() - sizeof(hashChecksum);
+        memcpy(hashChecksum.begin(), pRecord + recordSize, sizeof(hashChecksum));
+    } else {
+        // Open history file to read, from the size in the index header
+        CAutoFile filein = CAutoFile(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (!filein)
+            return ERRORMSG("CBlockUndo::ReadFromDisk : OpenBlockFile failed");
+
+        try {
+            uint32_t nSize;
+            if (pos.nPos < sizeof(nSize) || fseek(filein, pos.nPos - sizeof(nSize), SEEK_SET) != 0)
+                return ERRORMSG("%s : seek to the index header failed", __func__);
+            filein >> nSize;
+            if (fseek(filein, 0, SEEK_END) != 0 || ftell(filein) < (long)pos.nPos + (long)nSize ||
+                fseek(filein, pos.nPos, SEEK_SET) != 0)
+                return ERRORMSG("%s : record beyond the end of file", __func__);
+
+            record.resize(nSize);
+            filein.read(record.data(), record.size());
+            filein >> hashChecksum;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : I/O error - %s", __func__, e.what());
+        }
+        pRecord    = record.data();
+        recordSize = record.size();
     }
 
     // Verify checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << blockHash;
-    hasher << *this;
+    hasher.write(pRecord, recordSize);
 
     if (hashChecksum != hasher.GetHash())
         return ERRORMSG("CBlockUndo::ReadFromDisk : Checksum mismatch");
+
+    try {
+        CSpanReader reader(pRecord, pRecord + recordSize, SER_DISK, CLIENT_VERSION);
+        UnserializeRecord(reader);
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize error - %s", __func__, e.what());
+    }
     return true;
 }
 
@@ -95,23 +331,54 @@ string CBlockUndo::ToString() const {
 // class CBlockUndoExecutor
 
 bool CBlockUndoExecutor::Execute() {
-    // undoFuncMap
-    // RegisterUndoFunc();
-    const UndoDataFuncMap &undoDataFuncMap = cw.GetUndoDataFuncMap();
-
-    for (auto it = block_undo.vtxundo.rbegin(); it != block_undo.vtxundo.rend(); it++) {
-        for (const auto &opLogPair : it->dbOpLogMap.GetMap()) {
-            dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(opLogPair.first);
-            if (prefixType == dbk::EMPTY)
-                return ERRORMSG("%s(), unkown prefix! prefix_type=%s", __FUNCTION__,
-                                opLogPair.first);
-            auto funcMapIt = undoDataFuncMap.find(prefixType);
-            if (funcMapIt == undoDataFuncMap.end()) {
-                return ERRORMSG("%s(), unfound prefix in db! prefix_type=%s", __FUNCTION__,
-                                opLogPair.first);
+    CBlockUndoComposer composer;
+    composer.Add(std::move(block_undo));
+    return composer.Apply(cw);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class CBlockUndoComposer
+
+void CBlockUndoComposer::Add(CBlockUndo &&blockUndo) {
+    // the logs from the newest to the oldest, an older value of a key replaces the newer one
+    for (auto txIt = blockUndo.vtxundo.rbegin(); txIt != blockUndo.vtxundo.rend(); ++txIt) {
+        for (auto &opLogPair : txIt->dbOpLogMap.GetMap()) {
+            auto &logs = composedLogs[opLogPair.first];
+            for (auto it = opLogPair.second.rbegin(); it != opLogPair.second.rend(); ++it) {
+                string key = it->GetKey();
+                logs[std::move(key)] = std::move(*it);
             }
-            funcMapIt->second(opLogPair.second);
         }
     }
+    blockUndo.vtxundo.clear();
+}
+
+bool CBlockUndoComposer::Apply(CCacheWrapper &cw) {
+    return Apply(cw.GetUndoDataFuncMap());
+}
+
+bool CBlockUndoComposer::Apply(const UndoDataFuncMap &undoDataFuncMap) {
+    for (auto &item : composedLogs) {
+        auto funcMapIt = undoDataFuncMap.find(item.first);
+        if (funcMapIt == undoDataFuncMap.end()) {
+            return ERRORMSG("%s(), unfound prefix in db! prefix_type=%s", __FUNCTION__,
+                            dbk::GetKeyPrefix(item.first));
+        }
+
+        // one log per key, so the order of the list does not matter
+        CDbOpLogs opLogs;
+        opLogs.reserve(item.second.size());
+        for (auto &logItem : item.second)
+            opLogs.push_back(std::move(logItem.second));
+        funcMapIt->second(opLogs);
+    }
+    composedLogs.clear();
     return true;
-}
\ No newline at end of file
+}
+
+size_t CBlockUndoComposer::GetKeyCount() const {
+    size_t count = 0;
+    for (const auto &item : composedLogs)
+        count += item.second.size();
+    return count;
+}
@@ -14,17 +14,13 @@
 
 #include <stdint.h>
 #include <memory>
+#include <unordered_map>
 
 class CTxUndo {
 public:
     uint256 txid;
     CDBOpLogMap dbOpLogMap; // dbPrefix -> dbOpLogs
 
-    IMPLEMENT_SERIALIZE(
-        READWRITE(txid);
-        READWRITE(dbOpLogMap);
-	)
-
 public:
     CTxUndo() {}
 
@@ -40,14 +36,31 @@ public:
     string ToString() const;
 };
 
-/** Undo information for a CBlock */
+static const bool DEFAULT_UNDO_COMPRESS = false;
+
+/**
+ * Undo information for a CBlock
+ *
+ * The record in the undo file starts with a marker the legacy records, a vector of CTxUndo, never
+ * start with, then the format. The compact format has the table of the prefixes of the record, then
+ * per tx its txid and the sizes of its logs grouped by the index of their prefix, then the blob of
+ * all the keys and values, so that each of them is allocated once when read. The zlib format is the
+ * compact one compressed, written by -undocompress. The legacy records are still read.
+ */
 class CBlockUndo {
 public:
+    static const uint8_t FORMAT_MARKER  = 0xFF;
+    static const uint8_t FORMAT_COMPACT = 1;
+    static const uint8_t FORMAT_ZLIB    = 2;
+
     vector<CTxUndo> vtxundo;
 
-    IMPLEMENT_SERIALIZE(
-        READWRITE(vtxundo);
-    )
+    // the size of the uncompressed record
+    unsigned int GetSerializeSize(int nType, int nVersion) const;
+
+    void SerializeRecord(CDataStream &ss) const;
+    // throws ios_base::failure on a malformed record
+    void UnserializeRecord(CSpanReader &s);
 
     bool WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash);
 
@@ -69,11 +82,30 @@ public:
         cw.SetDbOpLogMap(&tx_undo.dbOpLogMap);
     }
     ~CTxUndoOpLogger() {
-        block_undo.vtxundo.push_back(tx_undo);
         cw.SetDbOpLogMap(nullptr);
+        block_undo.vtxundo.push_back(std::move(tx_undo));
     }
 };
 
+/**
+ * The undo logs of a run of blocks composed per prefix. Only the oldest logged value of each key is
+ * kept, i.e. its value before the run, so that a key written by many txs or blocks is deserialized
+ * and restored once by the bulk undo of its cache. The blocks are added from the tip down and their
+ * logs are moved in.
+ */
+class CBlockUndoComposer {
+public:
+    void Add(CBlockUndo &&blockUndo);
+    // apply the composed logs to the caches of cw and clear them
+    bool Apply(CCacheWrapper &cw);
+    bool Apply(const UndoDataFuncMap &undoDataFuncMap);
+
+    size_t GetKeyCount() const;
+
+private:
+    map<dbk::PrefixType, unordered_map<string, CDbOpLog>> composedLogs;
+};
+
 class CBlockUndoExecutor {
 public:
     CCacheWrapper &cw;
@@ -6,6 +6,17 @@
 #include "cachewrapper.h"
 #include "main.h"
 #include "logging.h"
+#include "taskscheduler.h"
+
+#include <boost/thread.hpp>
+
+// Run the tasks on the task scheduler and rethrow the first exception once all of them have finished
+static void RunInParallel(const vector<std::function<void()>> &tasks) {
+    CTaskGroup group(TASK_PRIORITY_CONSENSUS);
+    for (const auto &task : tasks)
+        group.Run(task);
+    group.Wait();
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // class CCacheWrapper
@@ -16,9 +27,14 @@ std::shared_ptr<CCacheWrapper>CCacheWrapper::NewCopyFrom(CCacheDBManager* pCdMan
     return pNewCopy;
 }
 
-CCacheWrapper::CCacheWrapper() {}
+CCacheWrapper::CCacheWrapper() : CCacheLayerArena(false) { EndCacheConstruction(); }
+
+CCacheWrapper::CCacheWrapper(CCacheWrapper *cwIn, bool fShortLived) : CCacheLayerArena(fShortLived) {
+    EndCacheConstruction();
+    SetBaseViewPtr(cwIn);
+}
 
-CCacheWrapper::CCacheWrapper(CCacheWrapper *cwIn) {
+void CCacheWrapper::SetBaseViewPtr(CCacheWrapper *cwIn) {
     sysParamCache.SetBaseViewPtr(&cwIn->sysParamCache);
     blockCache.SetBaseViewPtr(&cwIn->blockCache);
     accountCache.SetBaseViewPtr(&cwIn->accountCache);
@@ -29,6 +45,7 @@ CCacheWrapper::CCacheWrapper(CCacheWrapper *cwIn) {
     closedCdpCache.SetBaseViewPtr(&cwIn->closedCdpCache);
     dexCache.SetBaseViewPtr(&cwIn->dexCache);
     txReceiptCache.SetBaseViewPtr(&cwIn->txReceiptCache);
+    traceCache.SetBaseViewPtr(&cwIn->traceCache);
     txUtxoCache.SetBaseViewPtr(&cwIn->txUtxoCache);
 
     txCache.SetBaseViewPtr(&cwIn->txCache);
@@ -36,7 +53,9 @@ CCacheWrapper::CCacheWrapper(CCacheWrapper *cwIn) {
     sysGovernCache.SetBaseViewPtr(&cwIn->sysGovernCache);
 }
 
-CCacheWrapper::CCacheWrapper(CCacheDBManager* pCdMan) {
+CCacheWrapper::CCacheWrapper(CCacheDBManager* pCdMan, bool fShortLived) : CCacheLayerArena(fShortLived) {
+    EndCacheConstruction();
+
     sysParamCache.SetBaseViewPtr(pCdMan->pSysParamCache);
     blockCache.SetBaseViewPtr(pCdMan->pBlockCache);
     accountCache.SetBaseViewPtr(pCdMan->pAccountCache);
@@ -47,6 +66,7 @@ CCacheWrapper::CCacheWrapper(CCacheDBManager* pCdMan) {
     closedCdpCache.SetBaseViewPtr(pCdMan->pClosedCdpCache);
     dexCache.SetBaseViewPtr(pCdMan->pDexCache);
     txReceiptCache.SetBaseViewPtr(pCdMan->pReceiptCache);
+    traceCache.SetBaseViewPtr(pCdMan->pTraceCache);
     txUtxoCache.SetBaseViewPtr(pCdMan->pUtxoCache);
 
     txCache.SetBaseViewPtr(pCdMan->pTxCache);
@@ -65,6 +85,7 @@ void CCacheWrapper::CopyFrom(CCacheDBManager* pCdMan){
     closedCdpCache = *pCdMan->pClosedCdpCache;
     dexCache       = *pCdMan->pDexCache;
     txReceiptCache = *pCdMan->pReceiptCache;
+    traceCache     = *pCdMan->pTraceCache;
     txUtxoCache    = *pCdMan->pUtxoCache;
 
     txCache = *pCdMan->pTxCache;
@@ -86,6 +107,7 @@ CCacheWrapper& CCacheWrapper::operator=(CCacheWrapper& other) {
     this->closedCdpCache = other.closedCdpCache;
     this->dexCache       = other.dexCache;
     this->txReceiptCache = other.txReceiptCache;
+    this->traceCache     = other.traceCache;
     this->txUtxoCache    = other.txUtxoCache;
     this->txCache        = other.txCache;
     this->ppCache        = other.ppCache;
@@ -105,6 +127,7 @@ void CCacheWrapper::Flush() {
     closedCdpCache.Flush();
     dexCache.Flush();
     txReceiptCache.Flush();
+    traceCache.Flush();
     txUtxoCache.Flush();
 
     txCache.Flush();
@@ -112,7 +135,8 @@ void CCacheWrapper::Flush() {
     sysGovernCache.Flush();
 }
 
-void CCacheWrapper::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap) {
+void CCacheWrapper::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
+    pDbOpLogMap = pDbOpLogMapIn;
     sysParamCache.SetDbOpLogMap(pDbOpLogMap);
     blockCache.SetDbOpLogMap(pDbOpLogMap);
     accountCache.SetDbOpLogMap(pDbOpLogMap);
@@ -123,6 +147,7 @@ void CCacheWrapper::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap) {
     closedCdpCache.SetDbOpLogMap(pDbOpLogMap);
     dexCache.SetDbOpLogMap(pDbOpLogMap);
     txReceiptCache.SetDbOpLogMap(pDbOpLogMap);
+    traceCache.SetDbOpLogMap(pDbOpLogMap);
     txUtxoCache.SetDbOpLogMap(pDbOpLogMap);
     sysGovernCache.SetDbOpLogMap(pDbOpLogMap) ;
 }
@@ -139,63 +164,164 @@ UndoDataFuncMap CCacheWrapper::GetUndoDataFuncMap() {
     closedCdpCache.RegisterUndoFunc(undoDataFuncMap);
     dexCache.RegisterUndoFunc(undoDataFuncMap);
     txReceiptCache.RegisterUndoFunc(undoDataFuncMap);
+    traceCache.RegisterUndoFunc(undoDataFuncMap);
     txUtxoCache.RegisterUndoFunc(undoDataFuncMap);
     sysGovernCache.RegisterUndoFunc(undoDataFuncMap);
     return undoDataFuncMap;
 }
 
+ReadDataFuncMap CCacheWrapper::GetReadDataFuncMap() {
+    ReadDataFuncMap readDataFuncMap;
+    sysParamCache.RegisterReadFunc(readDataFuncMap);
+    blockCache.RegisterReadFunc(readDataFuncMap);
+    accountCache.RegisterReadFunc(readDataFuncMap);
+    assetCache.RegisterReadFunc(readDataFuncMap);
+    contractCache.RegisterReadFunc(readDataFuncMap);
+    delegateCache.RegisterReadFunc(readDataFuncMap);
+    cdpCache.RegisterReadFunc(readDataFuncMap);
+    closedCdpCache.RegisterReadFunc(readDataFuncMap);
+    dexCache.RegisterReadFunc(readDataFuncMap);
+    txReceiptCache.RegisterReadFunc(readDataFuncMap);
+    traceCache.RegisterReadFunc(readDataFuncMap);
+    txUtxoCache.RegisterReadFunc(readDataFuncMap);
+    sysGovernCache.RegisterReadFunc(readDataFuncMap);
+    return readDataFuncMap;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class CCacheWrapper::CSavepoint
+
+CCacheWrapper::CSavepoint::CSavepoint(CCacheWrapper &cwIn)
+    : cw(cwIn), pPrevDbOpLogMap(cwIn.pDbOpLogMap), done(false) {
+    cw.SetDbOpLogMap(&journal);
+}
+
+CCacheWrapper::CSavepoint::~CSavepoint() {
+    if (!done)
+        Rollback();
+}
+
+void CCacheWrapper::CSavepoint::Commit() {
+    assert(!done);
+    // the journaled writes belong to the outer op log, if any
+    if (pPrevDbOpLogMap != nullptr) {
+        for (const auto &opLogPair : journal.GetMap()) {
+            auto &prevOpLogs = pPrevDbOpLogMap->GetMap()[opLogPair.first];
+            prevOpLogs.insert(prevOpLogs.end(), opLogPair.second.begin(), opLogPair.second.end());
+        }
+    }
+    cw.SetDbOpLogMap(pPrevDbOpLogMap);
+    done = true;
+}
+
+void CCacheWrapper::CSavepoint::Rollback() {
+    assert(!done);
+    cw.SetDbOpLogMap(nullptr);
+
+    const UndoDataFuncMap &undoDataFuncMap = cw.GetUndoDataFuncMap();
+    for (const auto &opLogPair : journal.GetMap()) {
+        auto funcMapIt = undoDataFuncMap.find(opLogPair.first);
+        // every journaled prefix belongs to one of the caches of cw
+        assert(funcMapIt != undoDataFuncMap.end());
+        funcMapIt->second(opLogPair.second);
+    }
+
+    cw.SetDbOpLogMap(pPrevDbOpLogMap);
+    done = true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // class CCacheDBManager
 
 CCacheDBManager::CCacheDBManager(bool fReIndex, bool fMemory) {
     const boost::filesystem::path& dbDir = GetDataDir() / "blocks";
-    pSysParamDb     = new CDBAccess(dbDir, DBNameType::SYSPARAM, false, fReIndex);
-    pSysParamCache  = new CSysParamDBCache(pSysParamDb);
 
-    pAccountDb      = new CDBAccess(dbDir, DBNameType::ACCOUNT, false, fReIndex);
-    pAccountCache   = new CAccountDBCache(pAccountDb);
+    // the chain state keeps the layout it was built with, only a reindex switches it
+    pBlockIndexDb   = new CBlockIndexDB(false, fReIndex);
+    const bool fSingleStateDb = SysCfg().GetBoolArg("-singlestatedb", DEFAULT_SINGLE_STATE_DB);
+    bool fBuiltSingleStateDb  = fSingleStateDb;
+    if (!pBlockIndexDb->ReadSingleStateDb(fBuiltSingleStateDb) && !pBlockIndexDb->IsEmpty())
+        fBuiltSingleStateDb = false;  // built before the option
+    if (fBuiltSingleStateDb != fSingleStateDb) {
+        delete pBlockIndexDb;
+        pBlockIndexDb = nullptr;
+        throw leveldb_error(strprintf("The chain state was built with -singlestatedb=%d, restart with it or "
+                                      "with -reindex", fBuiltSingleStateDb));
+    }
+    pBlockIndexDb->WriteSingleStateDb(fSingleStateDb);
+
+    if (fReIndex)
+        RemoveUnusedDbs(dbDir, fSingleStateDb);
+    if (fSingleStateDb)
+        pStateDb = std::make_shared<CLevelDBWrapper>(dbDir / STATE_DB_NAME, GetStateDbOptions(), false, fReIndex);
+
+    // each db replays its log and loads its table metadata on open, after an unclean shutdown that takes
+    // long, so the dbs are opened on parallel tasks
+    const vector<std::pair<CDBAccess **, DBNameType>> dbs = {
+        {&pSysParamDb,  DBNameType::SYSPARAM},  {&pAccountDb, DBNameType::ACCOUNT}, {&pAssetDb, DBNameType::ASSET},
+        {&pContractDb,  DBNameType::CONTRACT},  {&pDelegateDb, DBNameType::DELEGATE}, {&pCdpDb, DBNameType::CDP},
+        {&pClosedCdpDb, DBNameType::CLOSEDCDP}, {&pDexDb, DBNameType::DEX}, {&pBlockDb, DBNameType::BLOCK},
+        {&pLogDb,       DBNameType::LOG}, {&pReceiptDb, DBNameType::RECEIPT}, {&pTraceDb, DBNameType::TRACE},
+        {&pUtxoDb,      DBNameType::UTXO}, {&pSysGovernDb, DBNameType::SYSGOVERN}};
+    for (const auto &db : dbs)
+        *db.first = nullptr;
+    int64_t nOpenStart = GetTimeMillis();
+    try {
+        ParallelFor(TASK_PRIORITY_CONSENSUS, dbs.size(), dbs.size(), [&](size_t i) {
+            *dbs[i].first = OpenDb(dbDir, dbs[i].second, fReIndex);
+        });
+    } catch (...) {
+        for (const auto &db : dbs) {
+            delete *db.first;
+            *db.first = nullptr;
+        }
+        delete pBlockIndexDb;
+        pBlockIndexDb = nullptr;
+        throw;
+    }
+    LogPrint(BCLog::INFO, "Opened %u dbs (%dms)\n", dbs.size(), GetTimeMillis() - nOpenStart);
 
-    pAssetDb        = new CDBAccess(dbDir, DBNameType::ASSET, false, fReIndex);
+    pSysParamCache  = new CSysParamDBCache(pSysParamDb);
+    pSysParamCache->EnableParamSnapshot();
+    pAccountCache   = new CAccountDBCache(pAccountDb);
     pAssetCache     = new CAssetDBCache(pAssetDb);
-
-    pContractDb     = new CDBAccess(dbDir, DBNameType::CONTRACT, false, fReIndex);
     pContractCache  = new CContractDBCache(pContractDb);
-
-    pDelegateDb     = new CDBAccess(dbDir, DBNameType::DELEGATE, false, fReIndex);
     pDelegateCache  = new CDelegateDBCache(pDelegateDb);
-
-    pCdpDb          = new CDBAccess(dbDir, DBNameType::CDP, false, fReIndex);
     pCdpCache       = new CCdpDBCache(pCdpDb);
-
-    pClosedCdpDb    = new CDBAccess(dbDir, DBNameType::CLOSEDCDP, false, fReIndex);
     pClosedCdpCache = new CClosedCdpDBCache(pClosedCdpDb);
-
-    pDexDb          = new CDBAccess(dbDir, DBNameType::DEX, false, fReIndex);
     pDexCache       = new CDexDBCache(pDexDb);
-
-    pBlockIndexDb   = new CBlockIndexDB(false, fReIndex);
-
-    pBlockDb        = new CDBAccess(dbDir, DBNameType::BLOCK, false, fReIndex);
     pBlockCache     = new CBlockDBCache(pBlockDb);
-
-    pLogDb          = new CDBAccess(dbDir, DBNameType::LOG, false, fReIndex);
     pLogCache       = new CLogDBCache(pLogDb);
-
-    pReceiptDb      = new CDBAccess(dbDir, DBNameType::RECEIPT, false, fReIndex);
     pReceiptCache   = new CTxReceiptDBCache(pReceiptDb);
-
-    pUtxoDb         = new CDBAccess(dbDir, DBNameType::UTXO, false, fReIndex);
+    pTraceCache     = new CTraceDBCache(pTraceDb);
     pUtxoCache      = new CTxUTXODBCache(pUtxoDb);
-
-    pSysGovernDb    = new CDBAccess(dbDir, DBNameType::SYSGOVERN, false, fReIndex);
     pSysGovernCache = new CSysGovernDBCache(pSysGovernDb);
 
     // memory-only cache
     pTxCache        = new CTxMemCache();
     pPpCache        = new CPricePointMemCache();
+
+    for (auto pDbAccess : GetDbAccesses())
+        flushSequence = std::max(flushSequence, pDbAccess->GetFlushSequence());
+    PublishFlushedSnapshots();
+
+    flushThread = boost::thread(&CCacheDBManager::FlushThread, this);
 }
 
 CCacheDBManager::~CCacheDBManager() {
+    // the warmup reads the dbs, it is stopped before they are closed
+    fStopWarmup = true;
+    if (warmupThread.joinable())
+        warmupThread.join();
+
+    // the flush in flight is written before the thread exits
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        fStopFlushing = true;
+    }
+    flushCond.notify_all();
+    flushThread.join();
+
     delete pSysParamCache;  pSysParamCache = nullptr;
     delete pAccountCache;   pAccountCache = nullptr;
     delete pAssetCache;     pAssetCache = nullptr;
@@ -207,6 +333,7 @@ CCacheDBManager::~CCacheDBManager() {
     delete pBlockCache;     pBlockCache = nullptr;
     delete pLogCache;       pLogCache = nullptr;
     delete pReceiptCache;   pReceiptCache = nullptr;
+    delete pTraceCache;     pTraceCache = nullptr;
     delete pSysGovernCache; pSysGovernCache = nullptr;
     delete pUtxoCache;      pUtxoCache = nullptr;
 
@@ -222,42 +349,300 @@ CCacheDBManager::~CCacheDBManager() {
     delete pBlockDb;        pBlockDb = nullptr;
     delete pLogDb;          pLogDb = nullptr;
     delete pReceiptDb;      pReceiptDb = nullptr;
+    delete pTraceDb;        pTraceDb = nullptr;
     delete pSysGovernDb;    pSysGovernDb = nullptr;
     delete pUtxoDb;         pUtxoDb = nullptr;
+    pStateDb = nullptr;
 
     // memory-only cache
     delete pTxCache;        pTxCache = nullptr;
     delete pPpCache;        pPpCache = nullptr;
 }
 
-bool CCacheDBManager::Flush() {
-    if (pSysParamCache) pSysParamCache->Flush();
+void CCacheDBManager::StartWarmup() {
+    if (!warmupThread.joinable())
+        warmupThread = boost::thread(&CCacheDBManager::WarmupThread, this);
+}
 
-    if (pAccountCache) pAccountCache->Flush();
+void CCacheDBManager::WarmupThread() {
+    RenameThread("coin-dbwarmup");
+
+    // the prefixes of each db in the order they are read, the state read by every block first
+    const vector<std::pair<CDBAccess *, vector<dbk::PrefixType>>> warmups = {
+        {pSysParamDb,  {dbk::SYS_PARAM, dbk::MINER_FEE, dbk::CDP_PARAM, dbk::CDP_INTEREST_PARAMS, dbk::BP_COUNT}},
+        {pSysGovernDb, {dbk::SYS_GOVERN}},
+        {pDelegateDb,  {dbk::ACTIVE_DELEGATES, dbk::PENDING_DELEGATES, dbk::LAST_VOTE_HEIGHT, dbk::VOTE, dbk::REGID_VOTE}},
+        {pAssetDb,     {dbk::ASSET, dbk::ASSET_TRADING_PAIR}},
+        {pBlockDb,     {dbk::MEDIAN_PRICES, dbk::MEDIAN_PRICE_INDEX}},
+        {pCdpDb,       {dbk::CDP_GLOBAL_DATA, dbk::CDP_COIN_PAIRS, dbk::CDP_GLOBAL_HALT, dbk::CDP_RATIO}},
+        {pDexDb,       {dbk::DEX_OPERATOR_DETAIL, dbk::DEX_OPERATOR_TRADE_PAIR, dbk::DEX_ACTIVE_ORDER}},
+        {pAccountDb,   {dbk::REGID_KEYID, dbk::KEYID_ACCOUNT}}};
+
+    int64_t nStart      = GetTimeMillis();
+    uint64_t totalBytes = 0;
+    // the dbs are read one after another on this thread, the long reads stay off the workers of the scheduler
+    for (const auto &warmup : warmups) {
+        CDBAccess *pDbAccess = warmup.first;
+        uint64_t budget      = GetDbOptions(pDbAccess->GetDbNameType()).blockCacheSize;
+        // with -singlestatedb the dbs share the block cache of the state db, and so its size
+        if (pStateDb) {
+            uint64_t stateBudget = GetStateDbOptions().blockCacheSize;
+            budget               = stateBudget > totalBytes ? stateBudget - totalBytes : 0;
+        }
+        uint64_t bytes = 0;
+        for (dbk::PrefixType prefixType : warmup.second) {
+            if (bytes >= budget || fStopWarmup)
+                break;
+            bytes += pDbAccess->Warmup(prefixType, budget - bytes, fStopWarmup);
+        }
+        totalBytes += bytes;
+        if (fStopWarmup)
+            break;
+    }
+    LogPrint(BCLog::INFO, "Warmed up the db block caches with %u KiB%s (%dms)\n", totalBytes >> 10,
+             fStopWarmup ? ", stopped" : "", GetTimeMillis() - nStart);
+}
 
-    if (pAssetCache) pAssetCache->Flush();
+CDBAccess *CCacheDBManager::OpenDb(const boost::filesystem::path &dbDir, DBNameType dbNameType, bool fReIndex) {
+    if (pStateDb)
+        return new CDBAccess(dbNameType, pStateDb);
+    return new CDBAccess(dbDir, dbNameType, false, fReIndex);
+}
 
-    if (pContractCache) pContractCache->Flush();
+void CCacheDBManager::RemoveUnusedDbs(const boost::filesystem::path &dbDir, bool fSingleStateDb) {
+    // the rocksdb column families of the other layout stay, they are dropped with the rocksdb directory
+    if (GetDbBackend() != DB_BACKEND_LEVELDB)
+        return;
+
+    vector<boost::filesystem::path> paths;
+    if (fSingleStateDb) {
+        for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++)
+            paths.push_back(dbDir / GetDbName((DBNameType)i));
+    } else {
+        paths.push_back(dbDir / STATE_DB_NAME);
+    }
+
+    for (const auto &path : paths) {
+        if (boost::filesystem::exists(path / "CURRENT")) {
+            LogPrint(BCLog::INFO, "Removing the database %s of the other -singlestatedb layout\n", path.string());
+            boost::filesystem::remove_all(path);
+        }
+    }
+}
 
-    if (pDelegateCache) pDelegateCache->Flush();
+vector<CDBAccess *> CCacheDBManager::GetDbAccesses() const {
+    vector<CDBAccess *> dbAccesses;
+    for (CDBAccess *pDbAccess : {pSysParamDb, pAccountDb, pAssetDb, pContractDb, pDelegateDb, pCdpDb, pClosedCdpDb,
+                                 pDexDb, pBlockDb, pLogDb, pReceiptDb, pTraceDb, pUtxoDb, pSysGovernDb}) {
+        if (pDbAccess != nullptr)
+            dbAccesses.push_back(pDbAccess);
+    }
+    return dbAccesses;
+}
 
-    if (pCdpCache) pCdpCache->Flush();
+vector<std::pair<const char *, uint32_t>> CCacheDBManager::GetCacheSizes() const {
+    return {
+        {"sysparam",  pSysParamCache->GetCacheSize()},
+        {"account",   pAccountCache->GetCacheSize()},
+        {"asset",     pAssetCache->GetCacheSize()},
+        {"contract",  pContractCache->GetCacheSize()},
+        {"delegate",  pDelegateCache->GetCacheSize()},
+        {"cdp",       pCdpCache->GetCacheSize()},
+        {"closedcdp", pClosedCdpCache->GetCacheSize()},
+        {"dex",       pDexCache->GetCacheSize()},
+        {"block",     pBlockCache->GetCacheSize()},
+        {"log",       pLogCache->GetCacheSize()},
+        {"receipt",   pReceiptCache->GetCacheSize()},
+        {"trace",     pTraceCache->GetCacheSize()},
+        {"utxo",      pUtxoCache->GetCacheSize()},
+        {"sysgovern", pSysGovernCache->GetCacheSize()},
+    };
+}
 
-    if (pClosedCdpCache) pClosedCdpCache->Flush();
+CDBReadSnapshotMap CCacheDBManager::NewReadSnapshots(CCacheWrapper &cw) {
+    // no batch is frozen under cs_main, the frozen writes of each db match its leveldb snapshot
+    const vector<CDBAccess *> dbAccesses = GetDbAccesses();
+    CDBReadSnapshotMap snapshots;
+    for (auto pDbAccess : dbAccesses)
+        snapshots.emplace(pDbAccess, pDbAccess->NewReadSnapshot());
+
+    // the writes of cw are taken from the pending batches instead of being frozen
+    for (auto pDbAccess : dbAccesses)
+        pDbAccess->BeginBatch();
+    try {
+        cw.sysParamCache.Flush();
+        cw.blockCache.Flush();
+        cw.accountCache.Flush();
+        cw.assetCache.Flush();
+        cw.contractCache.Flush();
+        cw.delegateCache.Flush();
+        cw.cdpCache.Flush();
+        cw.closedCdpCache.Flush();
+        cw.dexCache.Flush();
+        cw.txReceiptCache.Flush();
+        cw.traceCache.Flush();
+        cw.txUtxoCache.Flush();
+        cw.sysGovernCache.Flush();
+    } catch (...) {
+        for (auto pDbAccess : dbAccesses)
+            pDbAccess->AbortBatch();
+        throw;
+    }
+
+    for (auto pDbAccess : dbAccesses) {
+        std::unique_ptr<CDBWriteMap> pWrites = pDbAccess->TakeBatch();
+        if (pWrites->empty())
+            continue;
+
+        CDBReadSnapshot &snapshot = snapshots[pDbAccess];
+        if (snapshot.pWrites) {
+            auto pMerged = std::make_shared<CDBWriteMap>(*snapshot.pWrites);
+            for (auto &item : *pWrites)
+                (*pMerged)[item.first] = std::move(item.second);
+            snapshot.pWrites = pMerged;
+        } else {
+            snapshot.pWrites = std::shared_ptr<const CDBWriteMap>(std::move(pWrites));
+        }
+    }
+    return snapshots;
+}
 
-    if (pDexCache) pDexCache->Flush();
+void CCacheDBManager::PublishFlushedSnapshots() {
+    // the batches of all the dbs are frozen, each snapshot sees its db with the writes of the flush
+    auto pSnapshots = std::make_shared<CDBReadSnapshotMap>();
+    for (auto pDbAccess : GetDbAccesses())
+        pSnapshots->emplace(pDbAccess, pDbAccess->NewReadSnapshot());
 
-    if (pBlockIndexDb) pBlockIndexDb->Flush();
+    std::lock_guard<std::mutex> lock(flushedSnapshotsMutex);
+    pFlushedSnapshots = pSnapshots;
+}
 
-    if (pBlockCache) pBlockCache->Flush();
+std::shared_ptr<const CDBReadSnapshotMap> CCacheDBManager::GetFlushedSnapshots() const {
+    std::lock_guard<std::mutex> lock(flushedSnapshotsMutex);
+    return pFlushedSnapshots;
+}
 
-    if (pLogCache) pLogCache->Flush();
+bool CCacheDBManager::CheckFlushSequence() const {
+    for (auto pDbAccess : GetDbAccesses()) {
+        uint64_t dbFlushSequence = pDbAccess->GetFlushSequence();
+        if (dbFlushSequence != flushSequence) {
+            LogPrint(BCLog::INFO, "%s(), db %s is at flush sequence %llu, expected %llu\n", __FUNCTION__,
+                     GetDbName(pDbAccess->GetDbNameType()), dbFlushSequence, flushSequence);
+            return false;
+        }
+    }
+    return true;
+}
 
-    if (pReceiptCache) pReceiptCache->Flush();
+void CCacheDBManager::FlushThread() {
+    RenameThread("coin-dbflush");
+
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while (true) {
+        flushCond.wait(lock, [this]() { return fFlushInFlight || fStopFlushing; });
+        if (!fFlushInFlight)
+            return;
+
+        uint64_t sequence = flushSequence;
+        lock.unlock();
+
+        bool success = true;
+        try {
+            if (pStateDb) {
+                // the batches of all the dbs and the commit marker in one synced write, which commits
+                // the flush atomically
+                CLevelDBBatch batch;
+                vector<std::pair<CDBAccess *, std::shared_ptr<const CDBWriteMap>>> written;
+                for (auto pDbAccess : GetDbAccesses())
+                    written.emplace_back(pDbAccess, pDbAccess->AddFrozenBatch(batch));
+                batch.Write(dbk::GetKeyPrefix(dbk::FLUSH_SEQUENCE), sequence);
+                pStateDb->WriteBatch(batch, true);
+
+                for (const auto &item : written)
+                    item.first->OnFrozenBatchWritten(item.second);
+            } else {
+                vector<std::function<void()>> writes;
+                for (auto pDbAccess : GetDbAccesses())
+                    writes.push_back([pDbAccess, sequence]() { pDbAccess->WriteFrozenBatch(sequence); });
+
+                RunInParallel(writes);
+            }
+        } catch (std::exception &e) {
+            LogPrint(BCLog::ERROR, "%s(), write flush sequence %llu failed: %s\n", __FUNCTION__, sequence, e.what());
+            success = false;
+        }
+
+        lock.lock();
+        fFlushInFlight = false;
+        fFlushFailed   = !success;
+        flushCond.notify_all();
+    }
+}
 
-    if (pSysGovernCache) pSysGovernCache->Flush();
+bool CCacheDBManager::WaitForFlush() {
+    std::unique_lock<std::mutex> lock(flushMutex);
+    flushCond.wait(lock, [this]() { return !fFlushInFlight; });
+    return !fFlushFailed;
+}
+
+bool CCacheDBManager::Flush() {
+    if (!FlushAsync())
+        return false;
+
+    return WaitForFlush();
+}
+
+bool CCacheDBManager::FlushAsync() {
+    // backpressure: the caches never run more than one flush ahead of the disk. A failed flush
+    // stays frozen in its dbs and is written again with this one.
+    if (!WaitForFlush())
+        LogPrint(BCLog::ERROR, "%s(), retry the writes of the failed flush\n", __FUNCTION__);
+
+    const vector<CDBAccess *> dbAccesses = GetDbAccesses();
+    for (auto pDbAccess : dbAccesses)
+        pDbAccess->BeginBatch();
+
+    // each db cache only writes the pending batch of its own db
+    try {
+        RunInParallel({
+            [&]() { if (pSysParamCache) pSysParamCache->Flush(); },
+            [&]() { if (pAccountCache) pAccountCache->Flush(); },
+            [&]() { if (pAssetCache) pAssetCache->Flush(); },
+            [&]() { if (pContractCache) pContractCache->Flush(); },
+            [&]() { if (pDelegateCache) pDelegateCache->Flush(); },
+            [&]() { if (pCdpCache) pCdpCache->Flush(); },
+            [&]() { if (pClosedCdpCache) pClosedCdpCache->Flush(); },
+            [&]() { if (pDexCache) pDexCache->Flush(); },
+            [&]() { if (pBlockCache) pBlockCache->Flush(); },
+            [&]() { if (pLogCache) pLogCache->Flush(); },
+            [&]() { if (pReceiptCache) pReceiptCache->Flush(); },
+            [&]() { if (pTraceCache) pTraceCache->Flush(); },
+            [&]() { if (pSysGovernCache) pSysGovernCache->Flush(); },
+            [&]() { if (pUtxoCache) pUtxoCache->Flush(); }
+        });
+    } catch (...) {
+        for (auto pDbAccess : dbAccesses) {
+            pDbAccess->AbortBatch();
+            pDbAccess->ClearReadCaches();
+        }
+        throw;
+    }
+
+    if (pBlockIndexDb) pBlockIndexDb->Flush();
 
-    if (pUtxoCache) pUtxoCache->Flush();
+    for (auto pDbAccess : dbAccesses) {
+        pDbAccess->FreezeBatch();
+        metricDbReadCacheBytes.Get(GetDbName(pDbAccess->GetDbNameType())).Set(pDbAccess->EvictReadCaches());
+    }
+    PublishFlushedSnapshots();
+
+    // a crash between the writes of the separate dbs leaves different markers, CheckFlushSequence() finds them
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        ++flushSequence;
+        fFlushInFlight = true;
+    }
+    flushCond.notify_all();
 
     // Memory only cache, not bother to flush.
     // if (pTxCache)
@@ -18,13 +18,59 @@
 #include "sysparamdb.h"
 #include "txdb.h"
 #include "txreceiptdb.h"
+#include "tracedb.h"
 #include "txutxodb.h"
 #include "sysgoverndb.h"
 #include "logdb.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include <boost/thread.hpp>
+
 class CCacheDBManager;
 
-class CCacheWrapper {
+/**
+ * Arena of the ordered db caches of one short-lived CCacheWrapper layer, none for a long-lived one whose
+ * caches use the heap. It is a base class so that it is the current arena while the caches are constructed,
+ * the caches share its ownership.
+ */
+class CCacheLayerArena {
+protected:
+    CCacheLayerArena(bool fShortLived)
+        : spPrevArena(CMonotonicArena::SetCurrent(fShortLived ? std::make_shared<CMonotonicArena>() : nullptr)) {}
+
+    // called at the start of every constructor body, when all caches exist
+    void EndCacheConstruction() { CMonotonicArena::SetCurrent(std::move(spPrevArena)); }
+
+    std::shared_ptr<CMonotonicArena> spPrevArena;
+};
+
+class CCacheWrapper : private CCacheLayerArena {
+public:
+    /**
+     * Savepoint of the db caches of a cache wrapper, the writes after it are journaled with the same
+     * op logs as the block undo and Rollback() undoes them in place. It lets the miner try a tx on the
+     * wrapper itself instead of on a new child layer. The memory-only txCache and ppCache are not
+     * journaled, a tx writing them must still run on a child layer.
+     * The savepoint rolls back on destruction unless it was committed.
+     */
+    class CSavepoint {
+    public:
+        CSavepoint(CCacheWrapper &cwIn);
+        ~CSavepoint();
+
+        void Commit();
+        void Rollback();
+
+    private:
+        CCacheWrapper &cw;
+        CDBOpLogMap journal;
+        CDBOpLogMap *pPrevDbOpLogMap;
+        bool done;
+    };
+
 public:
     CSysParamDBCache    sysParamCache;
     CBlockDBCache       blockCache;
@@ -36,6 +82,7 @@ public:
     CClosedCdpDBCache   closedCdpCache;
     CDexDBCache         dexCache;
     CTxReceiptDBCache   txReceiptCache;
+    CTraceDBCache       traceCache;
     CTxUTXODBCache      txUtxoCache;
     CSysGovernDBCache   sysGovernCache;
 
@@ -46,22 +93,29 @@ public:
 public:
     CCacheWrapper();
 
-    CCacheWrapper(CCacheWrapper* cwIn);
-    CCacheWrapper(CCacheDBManager* pCdMan);
+    // fShortLived for the layers dropped or flushed after a block or a tx, their caches use an arena
+    CCacheWrapper(CCacheWrapper* cwIn, bool fShortLived = true);
+    CCacheWrapper(CCacheDBManager* pCdMan, bool fShortLived = false);
 
     CCacheWrapper& operator=(CCacheWrapper& other);
 
     void CopyFrom(CCacheDBManager* pCdMan);
 
+    // move the layer over cwIn, e.g. to flush the writes made over a copy of its state into it
+    void SetBaseViewPtr(CCacheWrapper *cwIn);
+
     void Flush();
 
     UndoDataFuncMap GetUndoDataFuncMap();
+    ReadDataFuncMap GetReadDataFuncMap();
 
-    void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap);
+    void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn);
 private:
     CCacheWrapper(const CCacheWrapper&) = delete;
     CCacheWrapper& operator=(const CCacheWrapper&) = delete;
 
+    CDBOpLogMap *pDbOpLogMap = nullptr;
+
 };
 
 class CCacheDBManager {
@@ -101,6 +155,9 @@ public:
     CDBAccess           *pReceiptDb;
     CTxReceiptDBCache   *pReceiptCache;
 
+    CDBAccess           *pTraceDb;
+    CTraceDBCache       *pTraceCache;
+
     CDBAccess           *pUtxoDb;
     CTxUTXODBCache      *pUtxoCache;
 
@@ -116,7 +173,75 @@ public:
 
     ~CCacheDBManager();
 
+    /**
+     * Flush all db caches. Every db collects its writes into one batch, the batches are built
+     * concurrently and frozen, then the flush thread writes them concurrently, each with the flush
+     * sequence as commit marker and one sync. With -singlestatedb, where all the dbs are kept in one,
+     * the batches and the marker are written together, so a flush is committed atomically. Reads see
+     * the frozen batches until they are on disk.
+     * FlushAsync() returns once the batches are frozen, after waiting for the previous flush to be
+     * written, so at most one flush is in flight. Flush() also waits for the write.
+     */
     bool Flush();
+    bool FlushAsync();
+
+    // Wait for the flush in flight to be persisted, return false if writing it failed
+    bool WaitForFlush();
+
+    // Return false if the commit markers differ, i.e. a flush was interrupted halfway
+    bool CheckFlushSequence() const;
+
+    vector<CDBAccess *> GetDbAccesses() const;
+
+    // The bytes held by the top level caches by db, for the flush decision and the memory report
+    vector<std::pair<const char *, uint32_t>> GetCacheSizes() const;
+
+    /**
+     * Read snapshots of the dbs with the writes of the top level caches of cw on top, e.g. of a copy of
+     * the caches with the latest blocks undone. The caches of cw are flushed into the snapshots, which are
+     * never written. It must be called under cs_main, where no flush is being built.
+     */
+    CDBReadSnapshotMap NewReadSnapshots(CCacheWrapper &cw);
+
+    /**
+     * Read snapshots of all the dbs at the last flush, taken together when its batches were frozen. A reader
+     * creates its own db caches under a CDBAccess::CSnapshotScope of them and reads the state of the last
+     * flushed block on any thread, without cs_main and while the next blocks are connected.
+     */
+    std::shared_ptr<const CDBReadSnapshotMap> GetFlushedSnapshots() const;
+
+    /**
+     * Read the hot prefixes of the dbs, e.g. the sysparams, the active delegates and the active dex orders,
+     * into their block caches on a thread of its own, each db up to its block cache size, or all of them up to
+     * the block cache size of the state db with -singlestatedb. It is stopped by the destructor.
+     */
+    void StartWarmup();
+
+private:
+    // the db of the type, a view of the keys of the type in pStateDb with -singlestatedb
+    CDBAccess *OpenDb(const boost::filesystem::path &dbDir, DBNameType dbNameType, bool fReIndex);
+    // remove the dbs of the layout not used, which a reindex would leave behind
+    void RemoveUnusedDbs(const boost::filesystem::path &dbDir, bool fSingleStateDb);
+    void FlushThread();
+    void WarmupThread();
+    void PublishFlushedSnapshots();
+
+    std::shared_ptr<CLevelDBWrapper> pStateDb;  // all the chain state dbs with -singlestatedb, null otherwise
+
+    uint64_t flushSequence = 0;
+
+    boost::thread flushThread;
+    std::mutex flushMutex;
+    std::condition_variable flushCond;
+    bool fFlushInFlight  = false;
+    bool fFlushFailed    = false;
+    bool fStopFlushing   = false;
+
+    boost::thread warmupThread;
+    std::atomic<bool> fStopWarmup{false};
+
+    mutable std::mutex flushedSnapshotsMutex;
+    std::shared_ptr<const CDBReadSnapshotMap> pFlushedSnapshots;
 };  // CCacheDBManager
 
 #endif //PERSIST_CACHEWRAPPER_H
\ No newline at end of file
@@ -38,7 +38,26 @@ bool CCdpDBCache::EraseCDP(const CUserCDP &oldCDP, const CUserCDP &cdp) {
 // Need to delete the old cdp(before updating cdp), then save the new cdp if necessary.
 bool CCdpDBCache::UpdateCDP(const CUserCDP &oldCDP, const CUserCDP &newCDP) {
     assert(!newCDP.IsEmpty());
-    return cdpCache.SetData(newCDP.cdpid, newCDP) && EraseCDPFromRatioDB(oldCDP) && SaveCDPToRatioDB(newCDP);
+    if (!cdpCache.SetData(newCDP.cdpid, newCDP))
+        return false;
+
+    CCdpCoinPair cdpCoinPair = newCDP.GetCoinPair();
+    if (!(oldCDP.GetCoinPair() == cdpCoinPair))
+        return EraseCDPFromRatioDB(oldCDP) && SaveCDPToRatioDB(newCDP);
+
+    // the global data of the coin pair takes the difference of the cdp in one write, with the same
+    // wrapping arithmetic as erasing the old cdp and saving the new one
+    CCdpGlobalData cdpGlobalData = GetCdpGlobalData(cdpCoinPair);
+    cdpGlobalData.total_staked_assets += newCDP.total_staked_bcoins - oldCDP.total_staked_bcoins;
+    cdpGlobalData.total_owed_scoins += newCDP.total_owed_scoins - oldCDP.total_owed_scoins;
+    if (!cdpGlobalDataCache.SetData(cdpCoinPair, cdpGlobalData))
+        return false;
+
+    CdpRatioSortedCache::KeyType oldKey = MakeCdpRatioSortedKey(oldCDP);
+    CdpRatioSortedCache::KeyType newKey = MakeCdpRatioSortedKey(newCDP);
+    if (oldKey != newKey && !cdpRatioSortedCache.EraseData(oldKey))
+        return false;
+    return cdpRatioSortedCache.SetData(newKey, newCDP);
 }
 
 bool CCdpDBCache::UserHaveCdp(const CRegID &regid, const TokenSymbol &assetSymbol, const TokenSymbol &scoinSymbol) {
@@ -101,15 +120,58 @@ bool CCdpDBCache::EraseCDPFromRatioDB(const CUserCDP &userCdp) {
 
 // global collateral ratio floor check
 
-bool CCdpDBCache::GetCdpListByCollateralRatio(const CCdpCoinPair &cdpCoinPair,
-        const uint64_t collateralRatio, const uint64_t bcoinMedianPrice,
-        CdpRatioSortedCache::Map &userCdps) {
+CdpRatioSortedCache::KeyType CCdpDBCache::MakeCdpRatioEndKey(const CCdpCoinPair &cdpCoinPair,
+        const uint64_t collateralRatio, const uint64_t bcoinMedianPrice) {
     double ratio = (double(collateralRatio) / RATIO_BOOST) / (double(bcoinMedianPrice) / PRICE_BOOST);
     assert(uint64_t(ratio * CDP_BASE_RATIO_BOOST) < UINT64_MAX);
     uint64_t ratioBoost = uint64_t(ratio * CDP_BASE_RATIO_BOOST) + 1;
-    CdpRatioSortedCache::KeyType endKey(cdpCoinPair, ratioBoost, 0, uint256());
+    return CdpRatioSortedCache::KeyType(cdpCoinPair, ratioBoost, 0, uint256());
+}
 
-    return cdpRatioSortedCache.GetAllElements(endKey, userCdps);
+bool CCdpDBCache::GetCdpListByCollateralRatio(const CCdpCoinPair &cdpCoinPair,
+        const uint64_t collateralRatio, const uint64_t bcoinMedianPrice,
+        CdpRatioSortedCache::Map &userCdps) {
+    return cdpRatioSortedCache.GetAllElements(MakeCdpRatioEndKey(cdpCoinPair, collateralRatio, bcoinMedianPrice),
+                                              userCdps);
+}
+
+shared_ptr<CCdpRatioSortedIterator> CCdpDBCache::CreateCdpRatioIterator(const CCdpCoinPair &cdpCoinPair,
+        const uint64_t collateralRatio, const uint64_t bcoinMedianPrice) {
+    // a range read depends on any write to the ratio index
+    if (CDBAccessTracker::GetCurrent() != nullptr)
+        CDBAccessTracker::GetCurrent()->OnReadPrefix(CdpRatioSortedCache::PREFIX_TYPE);
+
+    return make_shared<CCdpRatioSortedIterator>(cdpRatioSortedCache,
+        MakeCdpRatioEndKey(cdpCoinPair, collateralRatio, bcoinMedianPrice));
+}
+
+shared_ptr<CCdpRatioBuckets> CCdpDBCache::GetRatioBuckets() {
+    assert(cdpRatioSortedCache.GetBasePtr() == nullptr && "only support top level cache");
+    if (!spRatioBuckets)
+        spRatioBuckets = make_shared<CCdpRatioBuckets>(this);
+    return spRatioBuckets;
+}
+
+uint64_t CCdpDBCache::GetCdpCountByCollateralRatio(const CCdpCoinPair &cdpCoinPair,
+        const uint64_t collateralRatio, const uint64_t bcoinMedianPrice) {
+    auto spBuckets = GetRatioBuckets();
+    spBuckets->LoadIfNeeded();
+
+    CdpRatioSortedCache::KeyType endKey = MakeCdpRatioEndKey(cdpCoinPair, collateralRatio, bcoinMedianPrice);
+    uint64_t endBucket = std::get<1>(endKey).value / CDP_RATIO_BUCKET_WIDTH;
+    uint64_t count = 0;
+    for (const auto &item : spBuckets->GetBuckets(cdpCoinPair)) {
+        if (item.first >= endBucket)
+            break;
+        count += item.second.cdp_count;
+    }
+
+    CdpRatioSortedCache::KeyType bucketBeginKey(cdpCoinPair, endBucket * CDP_RATIO_BUCKET_WIDTH, 0, uint256());
+    CCdpRatioSortedIterator dbIt(cdpRatioSortedCache, endKey);
+    for (dbIt.SeekUpper(&bucketBeginKey); dbIt.IsValid(); dbIt.Next()) {
+        count++;
+    }
+    return count;
 }
 
 CCdpGlobalData CCdpDBCache::GetCdpGlobalData(const CCdpCoinPair &cdpCoinPair) const {
@@ -149,6 +211,7 @@ bool CCdpDBCache::SetCdpCoinPairStatus(const CCdpCoinPair &cdpCoinPair, const Cd
 }
 
 void CCdpDBCache::SetBaseViewPtr(CCdpDBCache *pBaseIn) {
+    pBaseCache = pBaseIn;
     cdpGlobalDataCache.SetBase(&pBaseIn->cdpGlobalDataCache);
     cdpCache.SetBase(&pBaseIn->cdpCache);
     userCdpCache.SetBase(&pBaseIn->userCdpCache);
@@ -171,6 +234,17 @@ uint32_t CCdpDBCache::GetCacheSize() const {
 }
 
 bool CCdpDBCache::Flush() {
+    if (pBaseCache != nullptr && pBaseCache->spRatioBuckets && pBaseCache->spRatioBuckets->IsOwner(pBaseCache) &&
+        pBaseCache->spRatioBuckets->IsLoaded()) {
+        auto &spBuckets = pBaseCache->spRatioBuckets;
+        for (const auto &item : cdpRatioSortedCache.GetMapData()) {
+            CUserCDP oldCdp;
+            if (pBaseCache->cdpRatioSortedCache.GetData(item.first, oldCdp))
+                spBuckets->Sub(item.first, oldCdp);
+            if (!item.second.IsEmpty())
+                spBuckets->Add(item.first, item.second);
+        }
+    }
     cdpGlobalDataCache.Flush();
     cdpCache.Flush();
     userCdpCache.Flush();
@@ -190,6 +264,85 @@ CdpRatioSortedCache::KeyType CCdpDBCache::MakeCdpRatioSortedKey(const CUserCDP &
     return key;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// class CCdpRatioBuckets
+
+static inline TokenSymbolIdPair InternCoinPair(const CCdpCoinPair &cdpCoinPair) {
+    return make_pair(CTokenSymbolTable::Intern(cdpCoinPair.bcoin_symbol),
+                     CTokenSymbolTable::Intern(cdpCoinPair.scoin_symbol));
+}
+
+// the coin pairs without cdps might not be interned, they have no buckets
+static inline TokenSymbolIdPair FindCoinPair(const CCdpCoinPair &cdpCoinPair) {
+    return make_pair(CTokenSymbolTable::Find(cdpCoinPair.bcoin_symbol),
+                     CTokenSymbolTable::Find(cdpCoinPair.scoin_symbol));
+}
+
+void CCdpRatioBuckets::LoadIfNeeded() {
+    LOCK(cs_buckets);
+    if (loaded)
+        return;
+
+    int64_t beginTime = GetTimeMillis();
+    CDBIterator<CdpRatioSortedCache> dbIt(pCache->cdpRatioSortedCache);
+    for (dbIt.First(); dbIt.IsValid(); dbIt.Next()) {
+        Add(dbIt.GetKey(), dbIt.GetValue());
+    }
+    loaded = true;
+    LogPrint(BCLog::CDP, "loaded the cdp ratio buckets, coin_pair_count=%llu, cost %d ms\n",
+        buckets.size(), GetTimeMillis() - beginTime);
+}
+
+bool CCdpRatioBuckets::IsLoaded() const {
+    LOCK(cs_buckets);
+    return loaded;
+}
+
+void CCdpRatioBuckets::Add(const CdpRatioSortedCache::KeyType &key, const CUserCDP &cdp) {
+    LOCK(cs_buckets);
+    TokenSymbolIdPair coinPair = InternCoinPair(std::get<0>(key));
+    for (auto *pBucket : {&buckets[coinPair][std::get<1>(key).value / CDP_RATIO_BUCKET_WIDTH], &totals[coinPair]}) {
+        pBucket->cdp_count++;
+        pBucket->total_staked_bcoins += cdp.total_staked_bcoins;
+        pBucket->total_owed_scoins += cdp.total_owed_scoins;
+    }
+}
+
+void CCdpRatioBuckets::Sub(const CdpRatioSortedCache::KeyType &key, const CUserCDP &cdp) {
+    LOCK(cs_buckets);
+    auto pairIt = buckets.find(FindCoinPair(std::get<0>(key)));
+    if (pairIt == buckets.end())
+        return;
+    auto bucketIt = pairIt->second.find(std::get<1>(key).value / CDP_RATIO_BUCKET_WIDTH);
+    if (bucketIt == pairIt->second.end())
+        return;
+
+    auto &total = totals[pairIt->first];
+    for (auto *pBucket : {&bucketIt->second, &total}) {
+        pBucket->cdp_count           = pBucket->cdp_count > 1 ? pBucket->cdp_count - 1 : 0;
+        pBucket->total_staked_bcoins -= std::min(pBucket->total_staked_bcoins, cdp.total_staked_bcoins);
+        pBucket->total_owed_scoins   -= std::min(pBucket->total_owed_scoins, cdp.total_owed_scoins);
+    }
+    if (bucketIt->second.cdp_count == 0)
+        pairIt->second.erase(bucketIt);
+    if (pairIt->second.empty()) {
+        totals.erase(pairIt->first);
+        buckets.erase(pairIt);
+    }
+}
+
+CCdpRatioBuckets::BucketMap CCdpRatioBuckets::GetBuckets(const CCdpCoinPair &cdpCoinPair) const {
+    LOCK(cs_buckets);
+    auto pairIt = buckets.find(FindCoinPair(cdpCoinPair));
+    return pairIt != buckets.end() ? pairIt->second : BucketMap();
+}
+
+CCdpRatioBucket CCdpRatioBuckets::GetTotal(const CCdpCoinPair &cdpCoinPair) const {
+    LOCK(cs_buckets);
+    auto totalIt = totals.find(FindCoinPair(cdpCoinPair));
+    return totalIt != totals.end() ? totalIt->second : CCdpRatioBucket();
+}
+
 string GetCdpCloseTypeName(const CDPCloseType type) {
     switch (type) {
         case CDPCloseType:: BY_REDEEM:
@@ -11,6 +11,7 @@
 #include "entities/cdp.h"
 #include "dbaccess.h"
 #include "dbiterator.h"
+#include "sync.h"
 
 #include <map>
 #include <set>
@@ -25,6 +26,60 @@ using namespace std;
 // height: allows data of the same ratio to be sorted by height
 typedef CCompositeKVCache<dbk::CDP_RATIO, tuple<CCdpCoinPair, CFixedUInt64, CFixedUInt64, uint256>, CUserCDP>      CdpRatioSortedCache;
 
+// streams the cdps of the ratio sorted index with keys below the end key, in key order
+class CCdpRatioSortedIterator: public CDBIterator<CdpRatioSortedCache> {
+private:
+    typedef CDBIterator<CdpRatioSortedCache> Base;
+    CdpRatioSortedCache::KeyType end_key;
+public:
+    CCdpRatioSortedIterator(CdpRatioSortedCache &dbCache, const CdpRatioSortedCache::KeyType &endKeyIn)
+        : Base(dbCache), end_key(endKeyIn) {}
+
+    virtual bool IsValid() const {
+        return Base::IsValid() && GetKey() < end_key;
+    }
+};
+
+// count and debts of the cdps of a coin pair in a band of ratios
+struct CCdpRatioBucket {
+    uint64_t cdp_count           = 0;
+    uint64_t total_staked_bcoins = 0;
+    uint64_t total_owed_scoins   = 0;
+};
+
+class CCdpDBCache;
+
+/**
+ * The cdps of the top level cdp cache by coin pair, in buckets of CDP_RATIO_BUCKET_WIDTH of the sorted ratio.
+ * It is loaded from the db at the first query, then kept current by the child caches flushing their ratio
+ * index into the top level cache, so the cdps at risk at a price are counted without scanning the index.
+ */
+class CCdpRatioBuckets {
+public:
+    // bucket index (sorted ratio / CDP_RATIO_BUCKET_WIDTH) -> bucket
+    typedef map<uint64_t, CCdpRatioBucket> BucketMap;
+
+    CCdpRatioBuckets(CCdpDBCache *pCacheIn) : pCache(pCacheIn) {}
+
+    bool IsOwner(const CCdpDBCache *pCacheIn) const { return pCache == pCacheIn; }
+    // must be called under cs_main, the lock of the cache flushes
+    void LoadIfNeeded();
+    bool IsLoaded() const;
+    void Add(const CdpRatioSortedCache::KeyType &key, const CUserCDP &cdp);
+    void Sub(const CdpRatioSortedCache::KeyType &key, const CUserCDP &cdp);
+
+    BucketMap GetBuckets(const CCdpCoinPair &cdpCoinPair) const;
+    // the sum of the buckets of the coin pair, kept by Add() and Sub()
+    CCdpRatioBucket GetTotal(const CCdpCoinPair &cdpCoinPair) const;
+
+private:
+    CCdpDBCache *pCache;
+    mutable CCriticalSection cs_buckets;
+    bool loaded = false;
+    map<TokenSymbolIdPair, BucketMap> buckets;  // by interned coin pair
+    map<TokenSymbolIdPair, CCdpRatioBucket> totals;
+};
+
 class CCdpDBCache {
 public:
     CCdpDBCache() {}
@@ -41,6 +96,16 @@ public:
 
     bool GetCdpListByCollateralRatio(const CCdpCoinPair &cdpCoinPair, const uint64_t collateralRatio,
             const uint64_t bcoinMedianPrice, CdpRatioSortedCache::Map &userCdps);
+    // the same cdps as GetCdpListByCollateralRatio, streamed instead of copied out
+    shared_ptr<CCdpRatioSortedIterator> CreateCdpRatioIterator(const CCdpCoinPair &cdpCoinPair,
+            const uint64_t collateralRatio, const uint64_t bcoinMedianPrice);
+
+    // the copies of the top level cache share its buckets but do not own them, so never update them
+    shared_ptr<CCdpRatioBuckets> GetRatioBuckets();
+    // the count of the cdps of the coin pair below the collateral ratio at the price, from the ratio buckets,
+    // only the cdps of the bucket of the end ratio are iterated. Only for the top level cache
+    uint64_t GetCdpCountByCollateralRatio(const CCdpCoinPair &cdpCoinPair, const uint64_t collateralRatio,
+            const uint64_t bcoinMedianPrice);
 
     inline uint64_t GetGlobalStakedBcoins() const;
     inline uint64_t GetGlobalOwedScoins() const;
@@ -62,6 +127,14 @@ public:
         cdpRatioSortedCache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        cdpGlobalDataCache.RegisterReadFunc(readDataFuncMap);
+        cdpCache.RegisterReadFunc(readDataFuncMap);
+        userCdpCache.RegisterReadFunc(readDataFuncMap);
+        cdpCoinPairsCache.RegisterReadFunc(readDataFuncMap);
+        cdpRatioSortedCache.RegisterReadFunc(readDataFuncMap);
+    }
+
     uint32_t GetCacheSize() const;
     bool Flush();
 private:
@@ -73,6 +146,11 @@ private:
     bool EraseCDPFromRatioDB(const CUserCDP &userCdp);
 
     CdpRatioSortedCache::KeyType MakeCdpRatioSortedKey(const CUserCDP &cdp);
+    CdpRatioSortedCache::KeyType MakeCdpRatioEndKey(const CCdpCoinPair &cdpCoinPair, const uint64_t collateralRatio,
+            const uint64_t bcoinMedianPrice);
+
+    CCdpDBCache *pBaseCache = nullptr;
+    shared_ptr<CCdpRatioBuckets> spRatioBuckets = nullptr;
 public:
     /*  CCompositeKVCache  prefixType       key                            value             variable  */
     /*  ---------------- --------------   ------------                --------------    ----- --------*/
@@ -143,6 +221,11 @@ public:
         closedCdpTxCache.RegisterUndoFunc(undoDataFuncMap);
         closedTxCdpCache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        closedCdpTxCache.RegisterReadFunc(readDataFuncMap);
+        closedTxCdpCache.RegisterReadFunc(readDataFuncMap);
+    }
 private:
     CdpRatioSortedCache::KeyType MakeCdpRatioSortedKey(const CUserCDP &cdp);
 public:
@@ -42,8 +42,20 @@ bool CContractDBCache::GetContracts(map<CRegIDKey, CUniversalContract> &contract
     return contractCache.GetAllElements(contracts);
 }
 
+bool CContractDBCache::GetContractCode(const CRegID &contractRegId, CContractCode &code) {
+    const CUniversalContract *pContract = contractCache.GetDataPtr(contractRegId);
+    if (pContract == nullptr)
+        return false;
+
+    code = pContract->GetCodeHandle();
+    return true;
+}
+
 bool CContractDBCache::SaveContract(const CRegID &contractRegId, const CUniversalContract &contract) {
-    return contractCache.SetData(contractRegId, contract);
+    // the handle of a contract read before may hold the replaced code
+    CUniversalContract contractToSave = contract;
+    contractToSave.ResetCodeHandle();
+    return contractCache.SetData(contractRegId, contractToSave);
 }
 
 bool CContractDBCache::HaveContract(const CRegID &contractRegId) {
@@ -76,27 +88,17 @@ bool CContractDBCache::EraseContractData(const CRegID &contractRegId, const stri
     return contractDataCache.EraseData(key);
 }
 
-bool CContractDBCache::GetContractTraces(const uint256 &txid, string &contractTraces) {
-    return contractTracesCache.GetData(txid, contractTraces);
-}
-
-bool CContractDBCache::SetContractTraces(const uint256 &txid, const string &contractTraces) {
-    return contractTracesCache.SetData(txid, contractTraces);
-}
-
 bool CContractDBCache::Flush() {
     contractCache.Flush();
     contractDataCache.Flush();
     contractAccountCache.Flush();
-    contractTracesCache.Flush();
 
     return true;
 }
 
 uint32_t CContractDBCache::GetCacheSize() const {
     return contractCache.GetCacheSize() +
-        contractDataCache.GetCacheSize() +
-        contractTracesCache.GetCacheSize();
+        contractDataCache.GetCacheSize();
 }
 
 
@@ -108,5 +110,9 @@ shared_ptr<CDBContractDataIterator> CContractDBCache::CreateContractDataIterator
                  "exceeded the max size=%u", contractKeyPrefix.size(), CDBContractKey::MAX_KEY_SIZE);
         return nullptr;
     }
+    // a range read depends on any write to the contract data
+    if (CDBAccessTracker::GetCurrent() != nullptr)
+        CDBAccessTracker::GetCurrent()->OnReadPrefix(dbk::CONTRACT_DATA);
+
     return make_shared<CDBContractDataIterator>(contractDataCache, contractRegid, contractKeyPrefix);
 }
\ No newline at end of file
@@ -67,21 +67,21 @@ public:
     CContractDBCache(CDBAccess *pDbAccess):
         contractCache(pDbAccess),
         contractDataCache(pDbAccess),
-        contractAccountCache(pDbAccess),
-        contractTracesCache(pDbAccess) {
+        contractAccountCache(pDbAccess) {
         assert(pDbAccess->GetDbNameType() == DBNameType::CONTRACT);
     };
 
     CContractDBCache(CContractDBCache *pBaseIn):
         contractCache(pBaseIn->contractCache),
         contractDataCache(pBaseIn->contractDataCache),
-        contractAccountCache(pBaseIn->contractAccountCache),
-        contractTracesCache(pBaseIn->contractTracesCache) {};
+        contractAccountCache(pBaseIn->contractAccountCache) {};
 
     bool GetContractAccount(const CRegID &contractRegId, const string &accountKey, CAppUserAccount &appAccOut);
     bool SetContractAccount(const CRegID &contractRegId, const CAppUserAccount &appAccIn);
 
     bool GetContract(const CRegID &contractRegId, CUniversalContract &contract);
+    // The code of the contract without copying it, shared with the cached contract
+    bool GetContractCode(const CRegID &contractRegId, CContractCode &code);
     bool GetContracts(map<CRegIDKey, CUniversalContract> &contracts);
     bool SaveContract(const CRegID &contractRegId, const CUniversalContract &contract);
     bool HaveContract(const CRegID &contractRegId);
@@ -92,9 +92,6 @@ public:
     bool HaveContractData(const CRegID &contractRegId, const string &contractKey);
     bool EraseContractData(const CRegID &contractRegId, const string &contractKey);
 
-    bool GetContractTraces(const uint256 &txid, string &contractTraces);
-    bool SetContractTraces(const uint256 &txid, const string &contractTraces);
-
     bool Flush();
     uint32_t GetCacheSize() const;
 
@@ -102,21 +99,24 @@ public:
         contractCache.SetBase(&pBaseIn->contractCache);
         contractDataCache.SetBase(&pBaseIn->contractDataCache);
         contractAccountCache.SetBase(&pBaseIn->contractAccountCache);
-        contractTracesCache.SetBase(&pBaseIn->contractTracesCache);
     };
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
         contractCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractDataCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractAccountCache.SetDbOpLogMap(pDbOpLogMapIn);
-        contractTracesCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         contractCache.RegisterUndoFunc(undoDataFuncMap);
         contractDataCache.RegisterUndoFunc(undoDataFuncMap);
         contractAccountCache.RegisterUndoFunc(undoDataFuncMap);
-        contractTracesCache.RegisterUndoFunc(undoDataFuncMap);
+    }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        contractCache.RegisterReadFunc(readDataFuncMap);
+        contractDataCache.RegisterReadFunc(readDataFuncMap);
+        contractAccountCache.RegisterReadFunc(readDataFuncMap);
     }
 
     shared_ptr<CDBContractDataIterator> CreateContractDataIterator(const CRegID &contractRegid,
@@ -132,9 +132,7 @@ public:
     // pair<contractRegId, contractKey> -> contractData
     DBContractDataCache contractDataCache;
     // pair<contractRegId, accountKey> -> appUserAccount
-    CCompositeKVCache< dbk::CONTRACT_ACCOUNT,     pair<CRegIDKey, string>,     CAppUserAccount >      contractAccountCache;
-    // txid -> contract_traces
-    CCompositeKVCache< dbk::CONTRACT_TRACES,     uint256,                  string >      contractTracesCache;
+    CCompositeKVCache< dbk::CONTRACT_ACCOUNT,     pair<CRegIDKey, string>,     CAppUserAccount, CHashMapPolicy >      contractAccountCache;
 };
 
 #endif  // PERSIST_CONTRACTDB_H
\ No newline at end of file
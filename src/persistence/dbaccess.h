@@ -6,14 +6,21 @@
 #ifndef PERSIST_DB_ACCESS_H
 #define PERSIST_DB_ACCESS_H
 
+#include "commons/arena.h"
+#include "commons/flathashmap.h"
 #include "commons/uint256.h"
 #include "dbconf.h"
 #include "leveldbwrapper.h"
 
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <string>
 #include <tuple>
 #include <vector>
-#include <optional>
 
 using namespace std;
 
@@ -263,66 +270,248 @@ namespace db_util {
 
 typedef void(UndoDataFunc)(const CDbOpLogs &pDbOpLogs);
 typedef std::map<dbk::PrefixType, std::function<UndoDataFunc>> UndoDataFuncMap;
+// read the serialized value of a serialized key of the prefix, the empty value of its type if it is not set, as
+// the undo logs have it
+typedef void(ReadDataFunc)(const string &rawKey, string &rawValue);
+typedef std::map<dbk::PrefixType, std::function<ReadDataFunc>> ReadDataFuncMap;
 
-class CDBAccess {
+/**
+ * Records the db keys touched by the current thread while one transaction is executing.
+ * The parallel block connector installs a tracker on each worker thread to detect read/write
+ * conflicts between speculatively executed transactions. When no tracker is installed, the
+ * caches skip all of the bookkeeping.
+ */
+class CDBAccessTracker {
 public:
-    CDBAccess(const boost::filesystem::path& dir, DBNameType dbNameTypeIn, bool fMemory, bool fWipe) :
-              dbNameType(dbNameTypeIn),
-              db( dir / ::GetDbName(dbNameTypeIn), DBCacheSize[dbNameTypeIn], fMemory, fWipe ) {}
+    set<string> readKeys;                   // full db keys read, writes imply a read of the old value
+    set<string> writeKeys;                  // full db keys written or erased
+    set<dbk::PrefixType> readPrefixes;      // prefixes traversed by range reads
+    set<dbk::PrefixType> writePrefixes;     // prefixes of all written keys
+    bool fMergeUnsafe = false;              // result depends on the cache layer it was executed on
+    std::recursive_mutex *pBaseMutex = nullptr; // guards the shared base cache, null if not shared
+    bool fRecordKeys = true;                // false for a tracker which only locks the shared base
+
+    class CScope {
+    public:
+        CScope(CDBAccessTracker *pTracker): pPrev(pCurrent) { pCurrent = pTracker; }
+        ~CScope() { pCurrent = pPrev; }
+    private:
+        CDBAccessTracker *pPrev;
+    };
 
-    int64_t GetDbCount() const { return db.GetDbCount(); }
-    template<typename KeyType, typename ValueType>
-    bool GetData(const dbk::PrefixType prefixType, const KeyType &key, ValueType &value) const {
+    static CDBAccessTracker* GetCurrent() { return pCurrent; }
+
+    static std::unique_lock<std::recursive_mutex> LockBase() {
+        if (pCurrent != nullptr && pCurrent->pBaseMutex != nullptr)
+            return std::unique_lock<std::recursive_mutex>(*pCurrent->pBaseMutex);
+        return std::unique_lock<std::recursive_mutex>();
+    }
+
+    template<typename KeyType>
+    void OnRead(dbk::PrefixType prefixType, const KeyType &key) {
+        if (!fRecordKeys) return;
+        readKeys.insert(dbk::GenDbKey(prefixType, key));
+    }
+
+    template<typename KeyType>
+    void OnWrite(dbk::PrefixType prefixType, const KeyType &key) {
+        if (!fRecordKeys) return;
         string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Read(keyStr, value);
+        readKeys.insert(keyStr);
+        writeKeys.insert(keyStr);
+        writePrefixes.insert(prefixType);
     }
 
-    template<typename ValueType>
-    bool GetData(const dbk::PrefixType prefixType, ValueType &value) const {
-        const string prefix = dbk::GetKeyPrefix(prefixType);
-        return db.Read(prefix, value);
+    void OnReadPrefix(dbk::PrefixType prefixType) {
+        if (fRecordKeys) readPrefixes.insert(prefixType);
     }
 
-    template <typename KeyType>
-    bool GetTopNElements(const uint32_t maxNum, const dbk::PrefixType prefixType, set<KeyType> &expiredKeys,
-                         set<KeyType> &keys) {
-        KeyType key;
-        uint32_t count             = 0;
-        shared_ptr<leveldb::Iterator> pCursor = NewIterator();
+    void OnReadSingle(dbk::PrefixType prefixType) {
+        if (fRecordKeys) readKeys.insert(dbk::GetKeyPrefix(prefixType));
+    }
 
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        const string &prefix = dbk::GetKeyPrefix(prefixType);
-        ssKey.write(prefix.c_str(), prefix.size());
-        pCursor->Seek(ssKey.str());
+    void OnWriteSingle(dbk::PrefixType prefixType) {
+        if (!fRecordKeys) return;
+        const string &keyStr = dbk::GetKeyPrefix(prefixType);
+        readKeys.insert(keyStr);
+        writeKeys.insert(keyStr);
+        writePrefixes.insert(prefixType);
+        // the old value of a single-value cache is only logged if it was loaded on this layer
+        fMergeUnsafe = true;
+    }
 
-        for (; (count < maxNum) && pCursor->Valid(); pCursor->Next()) {
-            boost::this_thread::interruption_point();
+    // whether anything read by this tracker was written by the prior ones
+    bool IsConflict(const CDBAccessTracker &prior) const {
+        for (auto prefixType : readPrefixes) {
+            if (prior.writePrefixes.count(prefixType))
+                return true;
+        }
+        for (const auto &key : readKeys) {
+            if (prior.writeKeys.count(key))
+                return true;
+        }
+        return false;
+    }
 
-            try {
-                leveldb::Slice slKey = pCursor->key();
-                if (!dbk::ParseDbKey(slKey, prefixType, key)) {
-                    break;
-                }
+    void MergeWrites(const CDBAccessTracker &other) {
+        writeKeys.insert(other.writeKeys.begin(), other.writeKeys.end());
+        writePrefixes.insert(other.writePrefixes.begin(), other.writePrefixes.end());
+    }
 
-                if (expiredKeys.count(key)) {
-                    continue;
-                } else if (keys.count(key)) {
-                    // skip it if the element existed in memory cache(upper level cache)
-                    continue;
-                } else {
-                    // Got an valid element.
-                    auto ret = keys.emplace(key);
-                    if (!ret.second)
-                        throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
+private:
+    inline static thread_local CDBAccessTracker *pCurrent = nullptr;
+};
 
-                    ++count;
-                }
-            } catch (std::exception &e) {
-                return ERRORMSG("%s : Deserialize or I/O error - %s", __FUNCTION__, e.what());
-            }
+/**
+ * Counts the db accesses of the current thread per key prefix, for the report of -replayblocks. The
+ * misses are the lookups which went down to leveldb.
+ */
+class CDBPrefixStats {
+public:
+    struct CPrefixCounts {
+        uint64_t reads  = 0;
+        uint64_t writes = 0;
+        uint64_t hits   = 0;
+        uint64_t misses = 0;
+
+        bool IsEmpty() const { return reads == 0 && writes == 0 && hits == 0 && misses == 0; }
+    };
+
+    CPrefixCounts counts[dbk::PREFIX_COUNT];
+
+    class CScope {
+    public:
+        CScope(CDBPrefixStats *pStats): pPrev(pCurrent) { pCurrent = pStats; }
+        ~CScope() { pCurrent = pPrev; }
+    private:
+        CDBPrefixStats *pPrev;
+    };
+
+    static void OnRead(dbk::PrefixType prefixType) {
+        if (pCurrent != nullptr) ++pCurrent->counts[prefixType].reads;
+    }
+
+    static void OnWrite(dbk::PrefixType prefixType) {
+        if (pCurrent != nullptr) ++pCurrent->counts[prefixType].writes;
+    }
+
+    static void OnLookup(dbk::PrefixType prefixType, bool fHit) {
+        if (pCurrent != nullptr) ++(fHit ? pCurrent->counts[prefixType].hits : pCurrent->counts[prefixType].misses);
+    }
+
+private:
+    inline static thread_local CDBPrefixStats *pCurrent = nullptr;
+};
+
+/**
+ * Counts the db accesses of the current thread while one transaction is executing, per db, for the
+ * execution stats of -txstats. It keeps no keys, so an access costs a few increments. A lookup is
+ * a hit when the value is found in a cache level, a miss when it goes to leveldb.
+ */
+class CDBAccessStats {
+public:
+    struct CDbCounts {
+        uint32_t reads  = 0;  // the reads of a key, incl. the range reads
+        uint32_t writes = 0;  // the writes and erases of a key
+        uint32_t hits   = 0;
+        uint32_t misses = 0;
+
+        bool IsEmpty() const { return reads == 0 && writes == 0 && hits == 0 && misses == 0; }
+    };
+
+    CDbCounts counts[DBNameType::DB_NAME_COUNT];
+
+    class CScope {
+    public:
+        CScope(CDBAccessStats *pStats): pPrev(pCurrent) { pCurrent = pStats; }
+        ~CScope() { pCurrent = pPrev; }
+    private:
+        CDBAccessStats *pPrev;
+    };
+
+    static void OnRead(dbk::PrefixType prefixType) {
+        CDBPrefixStats::OnRead(prefixType);
+        if (pCurrent != nullptr) ++pCurrent->counts[dbk::GetDbNameEnumByPrefix(prefixType)].reads;
+    }
+
+    static void OnWrite(dbk::PrefixType prefixType) {
+        CDBPrefixStats::OnWrite(prefixType);
+        if (pCurrent != nullptr) ++pCurrent->counts[dbk::GetDbNameEnumByPrefix(prefixType)].writes;
+    }
+
+    static void OnLookup(dbk::PrefixType prefixType, bool fHit) {
+        CDBPrefixStats::OnLookup(prefixType, fHit);
+        if (pCurrent == nullptr) return;
+        CDbCounts &dbCounts = pCurrent->counts[dbk::GetDbNameEnumByPrefix(prefixType)];
+        ++(fHit ? dbCounts.hits : dbCounts.misses);
+    }
+
+private:
+    inline static thread_local CDBAccessStats *pCurrent = nullptr;
+};
+
+class CDBAccess;
+
+// the frozen writes and the leveldb snapshot of a db taken at the same moment
+struct CDBReadSnapshot {
+    std::shared_ptr<const CDBWriteMap> pWrites;
+    std::shared_ptr<const leveldb::Snapshot> pSnapshot;
+};
+
+typedef std::map<const CDBAccess *, CDBReadSnapshot> CDBReadSnapshotMap;
+
+// the clean values kept by a top-level cache across its flushes, evicted together with the others of its db
+class CDBReadCacheBase {
+public:
+    virtual ~CDBReadCacheBase() {}
+    virtual uint64_t GetReadCacheSize() const = 0;
+    virtual void EvictReadCache(uint64_t targetSize) = 0;
+};
+
+class CDBAccess {
+public:
+    /**
+     * While a scope is active, the reads and iterators of the current thread on the dbs of the snapshot
+     * map see them as they were when the snapshots were taken, not the later flushes.
+     */
+    class CSnapshotScope {
+    public:
+        CSnapshotScope(const CDBReadSnapshotMap *pSnapshots): pPrev(pCurrentSnapshots) {
+            pCurrentSnapshots = pSnapshots;
         }
+        ~CSnapshotScope() { pCurrentSnapshots = pPrev; }
+    private:
+        const CDBReadSnapshotMap *pPrev;
+    };
 
-        return true;
+    // whether the current thread reads snapshots
+    static bool HasCurrentSnapshots() { return pCurrentSnapshots != nullptr; }
+
+    CDBAccess(const boost::filesystem::path& dir, DBNameType dbNameTypeIn, bool fMemory, bool fWipe) :
+              dbNameType(dbNameTypeIn),
+              pDb(std::make_shared<CLevelDBWrapper>(dir / ::GetDbName(dbNameTypeIn), GetDbOptions(dbNameTypeIn),
+                                                    fMemory, fWipe)),
+              fSharedDb(false),
+              readCacheBudget(GetDbReadCacheSize(dbNameTypeIn)) {}
+
+    // the keys of the db type in the db of -singlestatedb, which holds all the types under their prefixes
+    CDBAccess(DBNameType dbNameTypeIn, std::shared_ptr<CLevelDBWrapper> pSharedDb) :
+              dbNameType(dbNameTypeIn),
+              pDb(pSharedDb),
+              fSharedDb(true),
+              readCacheBudget(GetDbReadCacheSize(dbNameTypeIn)) {}
+
+    int64_t GetDbCount() const { return pDb->GetDbCount(); }
+    template<typename KeyType, typename ValueType>
+    bool GetData(const dbk::PrefixType prefixType, const KeyType &key, ValueType &value) const {
+        string keyStr = dbk::GenDbKey(prefixType, key);
+        return ReadKey(keyStr, value);
+    }
+
+    template<typename ValueType>
+    bool GetData(const dbk::PrefixType prefixType, ValueType &value) const {
+        const string prefix = dbk::GetKeyPrefix(prefixType);
+        return ReadKey(prefix, value);
     }
 
     template <typename KeyType, typename ValueType>
@@ -447,55 +636,424 @@ public:
     template<typename KeyType, typename ValueType>
     bool HaveData(const dbk::PrefixType prefixType, const KeyType &key) const {
         string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Exists(keyStr);
+        const CDBReadSnapshot *pSnapshot = GetCurrentSnapshot();
+        auto pWrites  = pSnapshot != nullptr ? pSnapshot->pWrites : GetFrozenWrites();
+        if (pWrites) {
+            auto it = pWrites->find(keyStr);
+            if (it != pWrites->end())
+                return it->second.has_value();
+        }
+        return pDb->Exists(keyStr, pSnapshot != nullptr ? pSnapshot->pSnapshot.get() : nullptr);
+    }
+
+    // The serialized values of the db keys in one call to the storage, nullopt for the missing ones. The
+    // frozen writes are taken before the db is read, like a ReadKey() of each, so it may run on any thread.
+    void MultiGetRaw(const std::vector<std::string> &keys, std::vector<std::optional<std::string>> &values) const {
+        const CDBReadSnapshot *pSnapshot = GetCurrentSnapshot();
+        auto pWrites = pSnapshot != nullptr ? pSnapshot->pWrites : GetFrozenWrites();
+        pDb->MultiReadRaw(keys, values, pSnapshot != nullptr ? pSnapshot->pSnapshot.get() : nullptr);
+        if (pWrites) {
+            for (size_t i = 0; i < keys.size(); i++) {
+                auto it = pWrites->find(keys[i]);
+                if (it != pWrites->end())
+                    values[i] = it->second;
+            }
+        }
     }
 
-    template<typename KeyType, typename ValueType>
-    void BatchWrite(const dbk::PrefixType prefixType, const map<KeyType, ValueType> &mapData) {
+    template<typename KeyType, typename ValueType, typename MapType = map<KeyType, ValueType>>
+    void BatchWrite(const dbk::PrefixType prefixType, const MapType &mapData) {
         CLevelDBBatch batch;
         for (auto item : mapData) {
             string key = dbk::GenDbKey(prefixType, item.first);
-            if (db_util::IsEmpty(item.second)) {
+            if (pPendingWrites) {
+                AddPendingWrite(key, item.second);
+            } else if (db_util::IsEmpty(item.second)) {
                 batch.Erase(key);
             } else {
                 batch.Write(key, item.second);
             }
         }
-        db.WriteBatch(batch, true);
+        if (!pPendingWrites)
+            pDb->WriteBatch(batch, true);
     }
 
     template<typename ValueType>
     void BatchWrite(const dbk::PrefixType prefixType, ValueType &value) {
-        CLevelDBBatch batch;
         const string prefix = dbk::GetKeyPrefix(prefixType);
+        if (pPendingWrites) {
+            AddPendingWrite(prefix, value);
+            return;
+        }
 
+        CLevelDBBatch batch;
         if (db_util::IsEmpty(value)) {
             batch.Erase(prefix);
         } else {
             batch.Write(prefix, value);
         }
-        db.WriteBatch(batch, true);
+        pDb->WriteBatch(batch, true);
+    }
+
+    uint64_t GetReadCacheBudget() const { return readCacheBudget; }
+
+    void RegisterReadCache(CDBReadCacheBase *pReadCache) { readCaches.push_back(pReadCache); }
+
+    void UnregisterReadCache(CDBReadCacheBase *pReadCache) {
+        readCaches.erase(std::remove(readCaches.begin(), readCaches.end(), pReadCache), readCaches.end());
+    }
+
+    // Shrink the read caches of the db to its budget, each one in proportion to its size, after a flush.
+    // Return the bytes they keep.
+    uint64_t EvictReadCaches() {
+        uint64_t totalSize = 0;
+        for (auto pReadCache : readCaches)
+            totalSize += pReadCache->GetReadCacheSize();
+        if (totalSize <= readCacheBudget)
+            return totalSize;
+
+        uint64_t keptSize = 0;
+        for (auto pReadCache : readCaches) {
+            pReadCache->EvictReadCache((uint64_t)((double)pReadCache->GetReadCacheSize() * readCacheBudget / totalSize));
+            keptSize += pReadCache->GetReadCacheSize();
+        }
+        return keptSize;
+    }
+
+    // drop the read caches, e.g. when the flush which put values in them is aborted
+    void ClearReadCaches() {
+        for (auto pReadCache : readCaches)
+            pReadCache->EvictReadCache(0);
+    }
+
+    // Collect the writes of all BatchWrite() calls as pending writes until FreezeBatch()
+    void BeginBatch() {
+        assert(!pPendingWrites);
+        pPendingWrites = std::make_unique<CDBWriteMap>();
+    }
+
+    void AbortBatch() { pPendingWrites.reset(); }
+
+    // Take the pending writes out instead of freezing them, e.g. to read the db with writes never persisted
+    std::unique_ptr<CDBWriteMap> TakeBatch() {
+        assert(pPendingWrites);
+        return std::move(pPendingWrites);
+    }
+
+    // write the serialized values as they are, e.g. the ones imported from a state dump
+    bool WriteRawBatch(CLevelDBBatch &batch) { return pDb->WriteBatch(batch, true); }
+
+    // Turn the pending writes into the frozen batch. Until WriteFrozenBatch() has persisted it, reads
+    // and iterators see the db with the frozen batch applied. The writes of a frozen batch whose
+    // write failed are kept and written again with the next one.
+    void FreezeBatch() {
+        assert(pPendingWrites);
+        std::lock_guard<std::mutex> lock(frozenMutex);
+        if (pFrozenWrites) {
+            auto pMerged = std::make_shared<CDBWriteMap>(*pFrozenWrites);
+            for (auto &item : *pPendingWrites)
+                (*pMerged)[item.first] = std::move(item.second);
+            pFrozenWrites = pMerged;
+        } else {
+            pFrozenWrites = std::shared_ptr<const CDBWriteMap>(std::move(pPendingWrites));
+        }
+        pPendingWrites.reset();
+    }
+
+    // Write the frozen batch with the flush sequence as its commit marker, in one synced write.
+    // It may run on another thread than the one using the db.
+    bool WriteFrozenBatch(uint64_t flushSequence) {
+        CLevelDBBatch batch;
+        auto pWrites = AddFrozenBatch(batch);
+        batch.Write(dbk::GetKeyPrefix(dbk::FLUSH_SEQUENCE), flushSequence);
+        pDb->WriteBatch(batch, true);
+        OnFrozenBatchWritten(pWrites);
+        return true;
+    }
+
+    // Add the frozen batch to the batch of a write to the db, e.g. the one of all the types sharing it.
+    // Return the writes added, for OnFrozenBatchWritten() once the batch is persisted.
+    std::shared_ptr<const CDBWriteMap> AddFrozenBatch(CLevelDBBatch &batch) const {
+        auto pWrites = GetFrozenWrites();
+        if (pWrites) {
+            for (const auto &item : *pWrites) {
+                if (item.second)
+                    batch.WriteRaw(item.first, *item.second);
+                else
+                    batch.Erase(item.first);
+            }
+        }
+        return pWrites;
+    }
+
+    void OnFrozenBatchWritten(const std::shared_ptr<const CDBWriteMap> &pWrites) {
+        std::lock_guard<std::mutex> lock(frozenMutex);
+        if (pFrozenWrites == pWrites)
+            pFrozenWrites = nullptr;
+    }
+
+    uint64_t GetFlushSequence() const {
+        uint64_t flushSequence = 0;
+        ReadKey(dbk::GetKeyPrefix(dbk::FLUSH_SEQUENCE), flushSequence);
+        return flushSequence;
     }
 
     DBNameType GetDbNameType() const { return dbNameType; }
 
+    // whether the db is the one of -singlestatedb, whose iterators also see the keys of the other types
+    bool IsSharedDb() const { return fSharedDb; }
+
+    // whether the key is one of the db type rather than of the others sharing the db
+    bool IsOwnKey(const leveldb::Slice &key) const {
+        return !fSharedDb || dbk::GetDbNameEnumByKey(key) == dbNameType;
+    }
+
+    // read the keys of the prefix into the block cache of the db, see CCacheDBManager::StartWarmup()
+    uint64_t Warmup(dbk::PrefixType prefixType, uint64_t maxBytes, const std::atomic<bool> &fStop) {
+        return pDb->WarmupPrefix(dbk::GetKeyPrefix(prefixType), maxBytes, fStop);
+    }
+
     std::shared_ptr<leveldb::Iterator> NewIterator() {
-        return std::shared_ptr<leveldb::Iterator>(db.NewIterator());
+        const CDBReadSnapshot *pSnapshot = GetCurrentSnapshot();
+        if (pSnapshot != nullptr) {
+            if (pSnapshot->pWrites)
+                return std::make_shared<CDBWriteMapIterator>(pDb->NewIterator(pSnapshot->pSnapshot.get()),
+                                                             pSnapshot->pWrites);
+            return std::shared_ptr<leveldb::Iterator>(pDb->NewIterator(pSnapshot->pSnapshot.get()));
+        }
+
+        auto pWrites = GetFrozenWrites();
+        if (pWrites)
+            return std::make_shared<CDBWriteMapIterator>(pDb->NewIterator(), pWrites);
+
+        return std::shared_ptr<leveldb::Iterator>(pDb->NewIterator());
+    }
+
+    // Iterator over the db as it is now, unaffected by the later writes. The frozen writes are taken
+    // before the snapshot, so a frozen batch written in between is seen the same from both.
+    std::shared_ptr<leveldb::Iterator> NewSnapshotIterator() {
+        auto pWrites = GetFrozenWrites();
+        if (pWrites)
+            return std::make_shared<CDBWriteMapIterator>(pDb->NewSnapshotIterator(), pWrites);
+
+        return std::shared_ptr<leveldb::Iterator>(pDb->NewSnapshotIterator());
+    }
+
+    // must be called under the lock of the cache flushes, so that no batch is frozen meanwhile
+    CDBReadSnapshot NewReadSnapshot() const {
+        CDBReadSnapshot snapshot;
+        snapshot.pWrites   = GetFrozenWrites();
+        snapshot.pSnapshot = pDb->GetSnapshot();
+        return snapshot;
     }
 private:
+    std::shared_ptr<const CDBWriteMap> GetFrozenWrites() const {
+        std::lock_guard<std::mutex> lock(frozenMutex);
+        return pFrozenWrites;
+    }
+
+    const CDBReadSnapshot *GetCurrentSnapshot() const {
+        if (pCurrentSnapshots == nullptr)
+            return nullptr;
+        auto it = pCurrentSnapshots->find(this);
+        return it != pCurrentSnapshots->end() ? &it->second : nullptr;
+    }
+
+    template<typename ValueType>
+    bool ReadKey(const string &keyStr, ValueType &value) const {
+        const CDBReadSnapshot *pSnapshot = GetCurrentSnapshot();
+        auto pWrites = pSnapshot != nullptr ? pSnapshot->pWrites : GetFrozenWrites();
+        if (pWrites) {
+            auto it = pWrites->find(keyStr);
+            if (it != pWrites->end()) {
+                if (!it->second)
+                    return false;
+
+                try {
+                    CDBStreamScope streamScope;
+                    CDataStream &ssValue = streamScope.Get();
+                    ssValue.write(it->second->data(), it->second->size());
+                    ssValue >> value;
+                } catch (std::exception &e) {
+                    return false;
+                }
+                return true;
+            }
+        }
+        return pDb->Read(keyStr, value, pSnapshot != nullptr ? pSnapshot->pSnapshot.get() : nullptr);
+    }
+
+    template<typename ValueType>
+    void AddPendingWrite(const string &key, const ValueType &value) {
+        if (db_util::IsEmpty(value)) {
+            (*pPendingWrites)[key] = std::nullopt;
+        } else {
+            CDBStreamScope streamScope;
+            CDataStream &ssValue = streamScope.Get();
+            ssValue << value;
+            (*pPendingWrites)[key] = ssValue.str();
+        }
+    }
+
     DBNameType dbNameType;
-    mutable CLevelDBWrapper db; // // TODO: remove the mutable declare
+    std::shared_ptr<CLevelDBWrapper> pDb;              // shared by all the types with -singlestatedb
+    bool fSharedDb;
+    std::unique_ptr<CDBWriteMap> pPendingWrites;       // writes of the flush being built
+    std::shared_ptr<const CDBWriteMap> pFrozenWrites;  // writes of the flush being persisted
+    mutable std::mutex frozenMutex;                    // guards pFrozenWrites
+    uint64_t readCacheBudget;                          // bytes of the read caches, 0 to keep none
+    std::vector<CDBReadCacheBase *> readCaches;
+
+    inline static thread_local const CDBReadSnapshotMap *pCurrentSnapshots = nullptr;
 };
 
-template<int32_t PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType>
+/**
+ * Storage policies of the in-memory data of CCompositeKVCache. The ordered one keeps a std::map,
+ * which the iterator family and the range scans rely on, with its nodes in the arena of the
+ * CCacheWrapper layer owning the cache. The hash one keeps a CFlatHashMap for
+ * caches accessed by key only, their ordered scans fall back to sorting the keys first.
+ */
+struct COrderedMapPolicy {
+    static const bool IS_ORDERED = true;
+    template<typename KeyType, typename ValueType>
+    using MapType = std::map<KeyType, ValueType, std::less<KeyType>,
+                             CArenaAllocator<std::pair<const KeyType, ValueType>>>;
+};
+
+struct CHashMapPolicy {
+    static const bool IS_ORDERED = false;
+    template<typename KeyType, typename ValueType>
+    using MapType = CFlatHashMap<KeyType, ValueType, CSerializeHasher<KeyType>>;
+};
+
+/**
+ * The clean values of a top-level CCompositeKVCache: the values it flushed or read from the db, kept over
+ * the flushes within the read cache budget of the db. A hit moves the value back to the data map of the
+ * cache and the next flush returns it, so the values are in the order of their last use and the eviction
+ * drops the least recently used ones first. The keys missing in the db are kept with the empty value, a
+ * hit on them stays in the read cache. A copy starts empty and unregistered, the values are the ones of
+ * the db anyway.
+ */
+template<typename KeyType, typename ValueType>
+class CDBReadCache : public CDBReadCacheBase {
+public:
+    CDBReadCache() {}
+    CDBReadCache(const CDBReadCache &other) {}
+    CDBReadCache &operator=(const CDBReadCache &other) {
+        Clear();
+        return *this;
+    }
+    ~CDBReadCache() {
+        if (pDbAccess != nullptr)
+            pDbAccess->UnregisterReadCache(this);
+    }
+
+    void Enable(CDBAccess *pDbAccessIn) {
+        assert(pDbAccess == nullptr);
+        pDbAccess = pDbAccessIn;
+        pDbAccess->RegisterReadCache(this);
+    }
+
+    bool IsEnabled() const { return pDbAccess != nullptr; }
+
+    bool Contains(const KeyType &key) const { return entries.count(key) > 0; }
+
+    // move the value of key out of the read cache, the empty value of a missing key is copied
+    bool Take(const KeyType &key, ValueType &value) {
+        auto it = entries.find(key);
+        if (it == entries.end())
+            return false;
+
+        if (db_util::IsEmpty(it->second.value)) {
+            value = it->second.value;
+            it->second.sequence = ++sequence;
+            order.emplace_back(key, sequence);
+            return true;
+        }
+
+        value = std::move(it->second.value);
+        size -= it->second.size;
+        entries.erase(it);
+        return true;
+    }
+
+    void Put(const KeyType &key, ValueType &&value, uint32_t itemSize) {
+        Erase(key);
+        entries.emplace(key, CEntry{std::move(value), itemSize, ++sequence});
+        order.emplace_back(key, sequence);
+        size += itemSize;
+
+        // the misses are put between the flushes too, keep them within the budget of the whole db
+        if (pDbAccess != nullptr && size > pDbAccess->GetReadCacheBudget())
+            EvictReadCache(pDbAccess->GetReadCacheBudget());
+
+        // the order keeps the keys taken or put again until their turn comes, rebuild it before it grows too long
+        if (order.size() > 2 * entries.size() + 1024)
+            CompactOrder();
+    }
+
+    void Erase(const KeyType &key) {
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            size -= it->second.size;
+            entries.erase(it);
+        }
+    }
+
+    void Clear() {
+        entries.clear();
+        order.clear();
+        size = 0;
+    }
+
+    uint64_t GetReadCacheSize() const override { return size; }
+
+    void EvictReadCache(uint64_t targetSize) override {
+        while (size > targetSize && !order.empty()) {
+            auto it = entries.find(order.front().first);
+            if (it != entries.end() && it->second.sequence == order.front().second) {
+                size -= it->second.size;
+                entries.erase(it);
+            }
+            order.pop_front();
+        }
+    }
+
+private:
+    struct CEntry {
+        ValueType value;
+        uint32_t size;      // serialized size of the key and the value
+        uint64_t sequence;  // of its last put, the entries of the order with older ones are stale
+    };
+
+    void CompactOrder() {
+        std::deque<std::pair<KeyType, uint64_t>> liveOrder;
+        for (auto &item : order) {
+            auto it = entries.find(item.first);
+            if (it != entries.end() && it->second.sequence == item.second)
+                liveOrder.push_back(std::move(item));
+        }
+        order.swap(liveOrder);
+    }
+
+    CDBAccess *pDbAccess = nullptr;
+    std::map<KeyType, CEntry> entries;  // ordered like the data maps, the keys may have no operator==
+    std::deque<std::pair<KeyType, uint64_t>> order;  // the keys by the sequence of their puts
+    uint64_t sequence = 0;
+    uint64_t size     = 0;
+};
+
+template<int32_t PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType, typename __MapPolicy = COrderedMapPolicy>
 class CCompositeKVCache {
 public:
     static const dbk::PrefixType PREFIX_TYPE = (dbk::PrefixType)PREFIX_TYPE_VALUE;
 public:
     typedef __KeyType   KeyType;
     typedef __ValueType ValueType;
+    typedef __MapPolicy MapPolicy;
     typedef typename std::map<KeyType, ValueType> Map;
-    typedef typename std::map<KeyType, ValueType>::iterator Iterator;
+    typedef typename MapPolicy::template MapType<KeyType, ValueType> DataMap;
+    typedef typename DataMap::iterator Iterator;
 
 public:
     /**
@@ -512,6 +1070,9 @@ public:
         pDbAccess(pDbAccessIn), is_calc_size(true) {
         assert(pDbAccessIn != nullptr);
         assert(pDbAccess->GetDbNameType() == GetDbNameEnumByPrefix(PREFIX_TYPE));
+        // a cache reading snapshots keeps no clean values, they are not the ones of the db
+        if (pDbAccess->GetReadCacheBudget() > 0 && !CDBAccess::HasCurrentSnapshots())
+            readCache.Enable(pDbAccess);
     };
 
     void SetBase(CCompositeKVCache *pBaseIn) {
@@ -526,33 +1087,17 @@ public:
 
     bool IsCalcSize() const { return is_calc_size; }
 
+    // the bytes of the data map, the read cache of a top-level cache is not counted
     uint32_t GetCacheSize() const {
         return size;
     }
 
-    bool GetTopNElements(const uint32_t maxNum, set<KeyType> &keys) {
-        // 1. Get all candidate elements.
-        set<KeyType> expiredKeys;
-        set<KeyType> candidateKeys;
-        if (!GetTopNElements(maxNum, expiredKeys, candidateKeys)) {
-            // TODO: log
-            return false;
-        }
-
-        // 2. Get the top N elements.
-        uint32_t count  = 0;
-        for (const auto item : candidateKeys) {
-            if (count ++ == maxNum) {
-                break;
-            }
-            keys.emplace(item);
-        }
-
-        return keys.size() == maxNum;
-    }
-
     // map<string, ValueType>
     bool GetAllElements(const KeyType &endKey, Map &elements) {
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnReadPrefix(PREFIX_TYPE);
+        CDBAccessStats::OnRead(PREFIX_TYPE);
+
         set<KeyType> expiredKeys;
         if (!GetAllElements(endKey, elements, expiredKeys)) {
             // TODO: log
@@ -563,6 +1108,10 @@ public:
     }
 
     bool GetAllElements(map<KeyType, ValueType> &elements) {
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnReadPrefix(PREFIX_TYPE);
+        CDBAccessStats::OnRead(PREFIX_TYPE);
+
         set<KeyType> expiredKeys;
         if (!GetAllElements(expiredKeys, elements)) {
             // TODO: log
@@ -576,6 +1125,10 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnRead(PREFIX_TYPE, key);
+        CDBAccessStats::OnRead(PREFIX_TYPE);
+
         auto it = GetDataIt(key);
         if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
             value = it->second;
@@ -584,10 +1137,30 @@ public:
         return false;
     }
 
+    // The value of key in the cache, not copied out, nullptr if none. Valid until the cache is changed
+    const ValueType *GetDataPtr(const KeyType &key) const {
+        if (db_util::IsEmpty(key)) {
+            return nullptr;
+        }
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnRead(PREFIX_TYPE, key);
+        CDBAccessStats::OnRead(PREFIX_TYPE);
+
+        auto it = GetDataIt(key);
+        if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
+            return &it->second;
+        }
+        return nullptr;
+    }
+
     bool SetData(const KeyType &key, const ValueType &value) {
         if (db_util::IsEmpty(key)) {
             return false;
         }
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnWrite(PREFIX_TYPE, key);
+        CDBAccessStats::OnWrite(PREFIX_TYPE);
+
         auto it = GetDataIt(key);
         if (it == mapData.end()) {
             auto pEmptyValue = db_util::MakeEmptyValue<ValueType>();
@@ -605,6 +1178,10 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnRead(PREFIX_TYPE, key);
+        CDBAccessStats::OnRead(PREFIX_TYPE);
+
         auto it = GetDataIt(key);
         return it != mapData.end() && !db_util::IsEmpty(it->second);
     }
@@ -613,6 +1190,10 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnWrite(PREFIX_TYPE, key);
+        CDBAccessStats::OnWrite(PREFIX_TYPE);
+
         Iterator it = GetDataIt(key);
         if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
             DecDataSize(it->second);
@@ -623,6 +1204,39 @@ public:
         return true;
     }
 
+    // whether a read of the key in the top level cache finds it in memory, i.e. without reading the db
+    bool IsCached(const KeyType &key) const {
+        assert(pDbAccess != nullptr);
+        return mapData.find(key) != mapData.end() || readCache.Contains(key);
+    }
+
+    // Put the serialized value of the key, read from the db ahead of its use, into the top level cache, nullopt
+    // if the db has none. It goes to the read cache as a clean value, or to the data map without one.
+    void AddPrefetched(const KeyType &key, const std::optional<std::string> &rawValue) {
+        assert(pDbAccess != nullptr);
+        if (IsCached(key))
+            return;
+
+        auto pValue = db_util::MakeEmptyValue<ValueType>();
+        if (rawValue) {
+            try {
+                CDBStreamScope streamScope;
+                CDataStream &ssValue = streamScope.Get();
+                ssValue.write(rawValue->data(), rawValue->size());
+                ssValue >> *pValue;
+            } catch (std::exception &e) {
+                return;  // left to the read, which fails the same way
+            }
+        }
+
+        if (readCache.IsEnabled()) {
+            uint32_t itemSize = CalcDataSize(key) + CalcDataSize(*pValue);
+            readCache.Put(key, std::move(*pValue), itemSize);
+        } else if (!db_util::IsEmpty(*pValue)) {
+            AddDataToMap(key, *pValue);
+        }
+    }
+
     void Clear() {
         mapData.clear();
         size = 0;
@@ -638,6 +1252,13 @@ public:
         } else if (pDbAccess != nullptr) {
             assert(pBase == nullptr);
             pDbAccess->BatchWrite<KeyType, ValueType>(PREFIX_TYPE, mapData);
+            // the flushed values equal the db now, keep them for the next blocks until the db evicts them
+            if (readCache.IsEnabled()) {
+                for (auto &item : mapData) {
+                    uint32_t itemSize = CalcDataSize(item.first) + CalcDataSize(item.second);
+                    readCache.Put(item.first, std::move(item.second), itemSize);
+                }
+            }
         }
 
         Clear();
@@ -666,6 +1287,25 @@ public:
         undoDataFuncMap[GetPrefixType()] = std::bind(&CCompositeKVCache::UndoDataList, this, std::placeholders::_1);
     }
 
+    void ReadRawData(const string &rawKey, string &rawValue) const {
+        KeyType key;
+        CDataStream ssKey(rawKey, SER_DISK, CLIENT_VERSION);
+        ssKey >> key;
+
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        auto it = GetDataIt(key);
+        if (it != mapData.end())
+            ssValue << it->second;
+        else
+            ssValue << *db_util::MakeEmptyValue<ValueType>();
+        rawValue.assign(ssValue.begin(), ssValue.end());
+    }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        readDataFuncMap[GetPrefixType()] = std::bind(&CCompositeKVCache::ReadRawData, this, std::placeholders::_1,
+                                                     std::placeholders::_2);
+    }
+
     dbk::PrefixType GetPrefixType() const { return PREFIX_TYPE; }
 
     CDBAccess* GetDbAccessPtr() {
@@ -676,15 +1316,19 @@ public:
         return pRet;
     }
 
-    CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType>* GetBasePtr() { return pBase; }
+    CCompositeKVCache* GetBasePtr() { return pBase; }
 
-    map<KeyType, ValueType>& GetMapData() { return mapData; };
+    DataMap& GetMapData() { return mapData; };
 private:
     Iterator GetDataIt(const KeyType &key) const {
         Iterator it = mapData.find(key);
         if (it != mapData.end()) {
+            CDBAccessStats::OnLookup(PREFIX_TYPE, true);
             return it;
-        } else if (pBase != nullptr) {
+        }
+
+        auto baseLock = CDBAccessTracker::LockBase();
+        if (pBase != nullptr) {
             // find key-value at base cache
             auto baseIt = pBase->GetDataIt(key);
             if (baseIt != pBase->mapData.end()) {
@@ -692,11 +1336,23 @@ private:
                 return AddDataToMap(key, baseIt->second);
             }
         } else if (pDbAccess != NULL) {
-            // TODO: need to save the empty value to mapData for search performance?
             auto pDbValue = db_util::MakeEmptyValue<ValueType>();
+            if (readCache.Take(key, *pDbValue)) {
+                CDBAccessStats::OnLookup(PREFIX_TYPE, true);
+                return db_util::IsEmpty(*pDbValue) ? mapData.end() : AddDataToMap(key, *pDbValue);
+            }
+
+            CDBAccessStats::OnLookup(PREFIX_TYPE, false);
             if (pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue)) {
                 return AddDataToMap(key, *pDbValue);
             }
+
+            // known absent until a flush writes the key, the repeated misses do not read the db again
+            if (readCache.IsEnabled()) {
+                auto pEmptyValue = db_util::MakeEmptyValue<ValueType>();
+                uint32_t itemSize = CalcDataSize(key) + CalcDataSize(*pEmptyValue);
+                readCache.Put(key, std::move(*pEmptyValue), itemSize);
+            }
         }
 
         return mapData.end();
@@ -742,49 +1398,48 @@ private:
         return ::GetSerializeSize(d, SER_DISK, CLIENT_VERSION);
     }
 
-    bool GetTopNElements(const uint32_t maxNum, set<KeyType> &expiredKeys, set<KeyType> &keys) {
-        if (!mapData.empty()) {
-            uint32_t count = 0;
-            auto iter      = mapData.begin();
-
-            for (; (count < maxNum) && iter != mapData.end(); ++iter) {
-                if (db_util::IsEmpty(iter->second)) {
-                    expiredKeys.insert(iter->first);
-                } else if (expiredKeys.count(iter->first) || keys.count(iter->first)) {
-                    // TODO: log
-                    continue;
-                } else {
-                    // Got a valid element.
-                    keys.insert(iter->first);
-
-                    ++count;
-                }
+    // Visit the cached items in key order until func returns false. The items of a hash data map
+    // are sorted first.
+    template <typename Func>
+    void ForEachInOrder(Func func) const {
+        if constexpr (MapPolicy::IS_ORDERED) {
+            for (const auto &item : mapData) {
+                if (!func(item))
+                    return;
+            }
+        } else {
+            vector<const typename DataMap::value_type *> items;
+            items.reserve(mapData.size());
+            for (const auto &item : mapData)
+                items.push_back(&item);
+
+            sort(items.begin(), items.end(), [](const auto *a, const auto *b) { return a->first < b->first; });
+            for (const auto *pItem : items) {
+                if (!func(*pItem))
+                    return;
             }
         }
-
-        if (pBase != nullptr) {
-            return pBase->GetTopNElements(maxNum, expiredKeys, keys);
-        } else if (pDbAccess != nullptr) {
-            return pDbAccess->GetTopNElements(maxNum, PREFIX_TYPE, expiredKeys, keys);
-        }
-
-        return true;
     }
 
     // map<string, ValueType>
     bool GetAllElements(const KeyType &endKey, Map &mapDataOut, set<KeyType> &expiredKeys) {
         if (!mapData.empty()) {
-            for (auto iter = mapData.begin(); iter != mapData.end() && iter->first < endKey; iter++) {
-                if (!expiredKeys.count(iter->first) && !mapDataOut.count(iter->first)) { // check not got
-                    if (db_util::IsEmpty(iter->second)) { // empty, will be deleted
-                        expiredKeys.insert(iter->first);
+            ForEachInOrder([&](const auto &item) {
+                if (!(item.first < endKey))
+                    return false;
+
+                if (!expiredKeys.count(item.first) && !mapDataOut.count(item.first)) { // check not got
+                    if (db_util::IsEmpty(item.second)) { // empty, will be deleted
+                        expiredKeys.insert(item.first);
                     } else { // Got a valid element.
-                        mapDataOut.emplace(iter->first, iter->second);
+                        mapDataOut.emplace(item.first, item.second);
                     }
                 }
-            }
+                return true;
+            });
         }
 
+        auto baseLock = CDBAccessTracker::LockBase();
         if (pBase != nullptr) {
             return pBase->GetAllElements(endKey, mapDataOut, expiredKeys);
         } else if (pDbAccess != nullptr) {
@@ -809,6 +1464,7 @@ private:
             }
         }
 
+        auto baseLock = CDBAccessTracker::LockBase();
         if (pBase != nullptr) {
             return pBase->GetAllElements(expiredKeys, elements);
         } else if (pDbAccess != nullptr) {
@@ -829,14 +1485,15 @@ private:
             #else
                 dbOpLog.Set(key, oldValue);
             #endif
-            pDbOpLogMap->AddOpLog(PREFIX_TYPE, dbOpLog);
+            pDbOpLogMap->AddOpLog(PREFIX_TYPE, std::move(dbOpLog));
         }
 
     }
 private:
-    mutable CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> *pBase = nullptr;
+    mutable CCompositeKVCache *pBase = nullptr;
     CDBAccess *pDbAccess = nullptr;
-    mutable map<KeyType, ValueType> mapData;
+    mutable DataMap mapData;
+    mutable CDBReadCache<KeyType, ValueType> readCache;  // top level only
     CDBOpLogMap *pDbOpLogMap = nullptr;
     bool is_calc_size = false;
     mutable uint32_t size = 0;
@@ -900,6 +1557,10 @@ public:
     }
 
     bool GetData(ValueType &value) const {
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnReadSingle(PREFIX_TYPE);
+        CDBAccessStats::OnRead(PREFIX_TYPE);
+
         auto ptr = GetDataPtr();
         if (ptr && !db_util::IsEmpty(*ptr)) {
             value = *ptr;
@@ -908,7 +1569,24 @@ public:
         return false;
     }
 
+    // the value in place of the nearest level holding it, nullptr if none, to read a part of a large value
+    // without copying it. It is not to be kept, the later writes of the cache change it.
+    std::shared_ptr<const ValueType> GetConstDataPtr() const {
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnReadSingle(PREFIX_TYPE);
+        CDBAccessStats::OnRead(PREFIX_TYPE);
+
+        auto ptr = GetDataPtr();
+        if (ptr && !db_util::IsEmpty(*ptr))
+            return ptr;
+        return nullptr;
+    }
+
     bool SetData(const ValueType &value) {
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnWriteSingle(PREFIX_TYPE);
+        CDBAccessStats::OnWrite(PREFIX_TYPE);
+
         if (!ptrData) {
             ptrData = db_util::MakeEmptyValue<ValueType>();
         }
@@ -918,11 +1596,19 @@ public:
     }
 
     bool HaveData() const {
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnReadSingle(PREFIX_TYPE);
+        CDBAccessStats::OnRead(PREFIX_TYPE);
+
         auto ptr = GetDataPtr();
         return ptr && !db_util::IsEmpty(*ptr);
     }
 
     bool EraseData() {
+        if (CDBAccessTracker::GetCurrent() != nullptr)
+            CDBAccessTracker::GetCurrent()->OnWriteSingle(PREFIX_TYPE);
+        CDBAccessStats::OnWrite(PREFIX_TYPE);
+
         auto ptr = GetDataPtr();
         if (ptr && !db_util::IsEmpty(*ptr)) {
             AddOpLog(*ptr);
@@ -966,19 +1652,39 @@ public:
         undoDataFuncMap[GetPrefixType()] = std::bind(&CSimpleKVCache::UndoDataList, this, std::placeholders::_1);
     }
 
+    void ReadRawData(const string &, string &rawValue) const {
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        auto ptr = GetDataPtr();
+        if (ptr)
+            ssValue << *ptr;
+        else
+            ssValue << *db_util::MakeEmptyValue<ValueType>();
+        rawValue.assign(ssValue.begin(), ssValue.end());
+    }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        readDataFuncMap[GetPrefixType()] = std::bind(&CSimpleKVCache::ReadRawData, this, std::placeholders::_1,
+                                                     std::placeholders::_2);
+    }
+
     dbk::PrefixType GetPrefixType() const { return PREFIX_TYPE; }
 
     std::shared_ptr<ValueType> GetDataPtr() const {
 
         if (ptrData) {
+            CDBAccessStats::OnLookup(PREFIX_TYPE, true);
             return ptrData;
-        } else if (pBase != nullptr){
+        }
+
+        auto baseLock = CDBAccessTracker::LockBase();
+        if (pBase != nullptr){
             auto ptr = pBase->GetDataPtr();
             if (ptr) {
                 ptrData = std::make_shared<ValueType>(*ptr);
                 return ptrData;
             }
         } else if (pDbAccess != NULL) {
+            CDBAccessStats::OnLookup(PREFIX_TYPE, false);
             auto ptrDbData = db_util::MakeEmptyValue<ValueType>();
 
             if (pDbAccess->GetData(PREFIX_TYPE, *ptrDbData)) {
@@ -995,7 +1701,7 @@ private:
         if (pDbOpLogMap != nullptr) {
             CDbOpLog dbOpLog;
             dbOpLog.Set(oldValue);
-            pDbOpLogMap->AddOpLog(PREFIX_TYPE, dbOpLog);
+            pDbOpLogMap->AddOpLog(PREFIX_TYPE, std::move(dbOpLog));
         }
 
     }
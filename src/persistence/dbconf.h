@@ -34,6 +34,7 @@ typedef leveldb::Slice Slice;
     DEFINE( RECEIPT,            "receipts",       (100 << 10) )     /* tx receipt */ \
     DEFINE( UTXO,               "utxo",           (50  << 20) )     /* tx receipt */ \
     DEFINE( SYSGOVERN,          "governs",        (100 << 10) )           \
+    DEFINE( TRACE,              "traces",         (1   << 20) )      /* wasm tx traces */ \
     /*                                                                  */  \
     /* Add new Enum elements above, DB_NAME_COUNT Must be the last one */ \
     DEFINE( DB_NAME_COUNT,        "",               0)                  /* enum count, must be the last one */
@@ -45,6 +46,9 @@ enum DBNameType {
 
 #define DB_NAME_NONE DB_NAME_COUNT
 
+// the directory of the db holding all the others with -singlestatedb
+static const std::string STATE_DB_NAME = "state";
+
 static const int32_t DBCacheSize[DBNameType::DB_NAME_COUNT + 1] {
     DB_NAME_LIST(DEF_CACHE_SIZE_ARRAY)
 };
@@ -88,6 +92,9 @@ namespace dbk {
         DEFINE( FLAG,                 "flag",   BLOCK )         /* [prefix] --> $Flag = 1 | 0 */ \
         DEFINE( BEST_BLOCKHASH,       "bbkh",   BLOCK )         /* [prefix] --> $BestBlockHash */ \
         DEFINE( TXID_DISKINDEX,       "tidx",   BLOCK )         /* tidx{$txid} --> $DiskTxPos */ \
+        DEFINE( KEYID_TXID,           "ktxs",   BLOCK )         /* ktxs{$KeyId}{$height}{$index} --> $txid */ \
+        DEFINE( BLOCK_FILTER,         "bfil",   BLOCK )         /* bfil{$blockHash} --> $BlockFilter */ \
+        DEFINE( MEDIAN_PRICE_INDEX,   "mdpi",   BLOCK )         /* mdpi{$height} --> $MedianPriceRecord */ \
         /**** account db                                                                      */ \
         DEFINE( REGID_KEYID,          "rkey",   ACCOUNT )       /* rkey{$RegID} --> $KeyId */ \
         DEFINE( NICKID_KEYID,         "nkey",   ACCOUNT )       /* nkey{$NickID} --> $KeyId */ \
@@ -96,7 +103,10 @@ namespace dbk {
         DEFINE( CONTRACT_DEF,         "cdef",   CONTRACT )      /* cdef{$ContractRegId} --> $ContractContent */ \
         DEFINE( CONTRACT_DATA,        "cdat",   CONTRACT )      /* cdat{$RegId}{$DataKey} --> $Data */ \
         DEFINE( CONTRACT_ACCOUNT,     "cacc",   CONTRACT )      /* cacc{$ContractRegId}{$AccUserId} --> appUserAccount */ \
-        DEFINE( CONTRACT_TRACES,      "ctrs",   CONTRACT )      /* [prefix]{$txid} --> contract_traces */ \
+        /**** trace db                                                                         */ \
+        DEFINE( CONTRACT_TRACES,      "ctrs",   TRACE )         /* [prefix]{$txid} --> contract_traces */ \
+        DEFINE( CONTRACT_TRACES_HEIGHT, "ctrh", TRACE )         /* [prefix]{height} --> {txids of the traces}, by -wasmtracesmaxsize */ \
+        DEFINE( CONTRACT_TRACES_SIZE, "ctrz",   TRACE )         /* [prefix] --> bytes of the indexed traces */ \
         /**** delegate db                                                                      */ \
         DEFINE( VOTE,                 "vote",   DELEGATE )      /* "vote{(uint64t)MAX - $votedBcoins}{$RegId} --> 1 */ \
         DEFINE( LAST_VOTE_HEIGHT,     "lvht",   DELEGATE )      /* "[prefix] --> last_vote_height */ \
@@ -124,8 +134,13 @@ namespace dbk {
         DEFINE( TX_EXECUTE_FAIL,      "txef",   LOG )           /* [prefix]{height}{txid} --> {error code, error message} */ \
         /**** tx receipt db                                                                    */ \
         DEFINE( TX_RECEIPT,           "txrc",   RECEIPT )       /* [prefix]{txid} --> {receipts} */ \
+        DEFINE( TX_RECEIPT_HEIGHT,    "txrh",   RECEIPT )       /* [prefix]{height} --> {txids of the receipts}, by -receiptretention */ \
         /**** tx coinutxo db                                                                    */ \
         DEFINE( TX_UTXO,              "utxo",   UTXO )          /* [prefix]{txid} --> {receipts} */ \
+        /**** commit marker written to every db by CCacheDBManager::Flush                 */ \
+        DEFINE( FLUSH_SEQUENCE,       "fseq",   DB_NAME_NONE )  /* [prefix] --> $flushSequence */ \
+        /**** layout of the chain state dbs, written to the block index db             */ \
+        DEFINE( SINGLE_STATE_DB,      "ssdb",   DB_NAME_NONE )  /* [prefix] --> 1 if all in blocks/state */ \
         /*                                                                             */ \
         /* Add new Enum elements above, PREFIX_COUNT Must be the last one              */ \
         DEFINE( PREFIX_COUNT,         "",       DB_NAME_NONE)   /* enum count, must be the last one */
@@ -179,14 +194,36 @@ namespace dbk {
         return EMPTY;
     };
 
+    // The db of the prefix the key starts with, DB_NAME_NONE if none. No prefix is the start of another, so
+    // the one of the key is the greatest prefix not after it.
+    inline DBNameType GetDbNameEnumByKey(const Slice &key) {
+        auto it = gPrefixNameMap.upper_bound(key.ToString());
+        if (it == gPrefixNameMap.begin())
+            return DB_NAME_NONE;
+        --it;
+        if (it->first.empty() || !key.starts_with(Slice(it->first)))
+            return DB_NAME_NONE;
+        return kDbPrefix2DbName[it->second];
+    };
+
+    // A key of a fixed layout, e.g. tuple<CFixedUInt32, uint8_t, uint256>, is written straight into
+    // the key string of its exact size, only the others go through a CDataStream
     template<typename KeyElement>
     std::string GenDbKey(PrefixType keyPrefixType, const KeyElement &keyElement) {
-        CDataStream ssKeyTemp(SER_DISK, CLIENT_VERSION);
         assert(keyPrefixType != EMPTY);
         const string &prefix = GetKeyPrefix(keyPrefixType);
-        ssKeyTemp.write(prefix.c_str(), prefix.size()); // write buffer only, exclude size prefix
-        ssKeyTemp << keyElement;
-        return std::string(ssKeyTemp.begin(), ssKeyTemp.end());
+        if constexpr (CFixedSerializeSize<KeyElement>::value > 0) {
+            std::string key;
+            key.reserve(prefix.size() + CFixedSerializeSize<KeyElement>::value);
+            key.append(prefix);  // write buffer only, exclude size prefix
+            CStringWriter(key, SER_DISK, CLIENT_VERSION) << keyElement;
+            return key;
+        } else {
+            CDataStream ssKeyTemp(SER_DISK, CLIENT_VERSION);
+            ssKeyTemp.write(prefix.c_str(), prefix.size()); // write buffer only, exclude size prefix
+            ssKeyTemp << keyElement;
+            return std::string(ssKeyTemp.begin(), ssKeyTemp.end());
+        }
     }
 
     template<typename KeyElement>
@@ -197,9 +234,14 @@ namespace dbk {
             return false;
         }
 
-        CDataStream ssKeyTemp(slice.data(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
-        ssKeyTemp.ignore(prefix.size());
-        ssKeyTemp >> keyElement;
+        if constexpr (CFixedSerializeSize<KeyElement>::value > 0) {
+            CSpanReader reader(slice.data() + prefix.size(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
+            reader >> keyElement;
+        } else {
+            CDataStream ssKeyTemp(slice.data(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
+            ssKeyTemp.ignore(prefix.size());
+            ssKeyTemp >> keyElement;
+        }
 
         return true;
     }
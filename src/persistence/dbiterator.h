@@ -28,6 +28,9 @@ public:
 
     virtual bool First() = 0;
 
+    // position at the first key not less than key
+    virtual bool Seek(const KeyType &key) = 0;
+
     virtual bool SeekUpper(const KeyType *pKey) = 0;
 
     virtual bool Next() = 0;
@@ -67,6 +70,11 @@ public:
         return ProcessData();
     }
 
+    bool Seek(const KeyType &key) {
+        p_db_it->Seek(dbk::GenDbKey(CacheType::PREFIX_TYPE, key));
+        return ProcessData();
+    }
+
     bool SeekUpper(const KeyType *pKey) {
         if (pKey == nullptr || db_util::IsEmpty(*pKey))
             return First();
@@ -123,6 +131,11 @@ public:
         return ProcessData();
     }
 
+    bool Seek(const KeyType &key) {
+        map_it = this->db_cache.GetMapData().lower_bound(key);
+        return ProcessData();
+    }
+
     bool SeekUpper(const KeyType *pKey) {
         if (pKey == nullptr || db_util::IsEmpty(*pKey))
             return First();
@@ -177,6 +190,12 @@ public:
         return ProcessData();
     }
 
+    bool Seek(const KeyType &key) {
+        sp_map_it->Seek(key);
+        sp_base_it->Seek(key);
+        return ProcessData();
+    }
+
     bool SeekUpper(const KeyType *pKey) {
         if (pKey == nullptr || db_util::IsEmpty(*pKey))
             return First();
@@ -281,6 +300,10 @@ public:
         return sp_it_Impl->First();
     }
 
+    virtual bool Seek(const KeyType &key) {
+        return sp_it_Impl->Seek(key);
+    }
+
     virtual bool SeekUpper(const KeyType *pKey) {
         return sp_it_Impl->SeekUpper(pKey);
     }
@@ -308,6 +331,32 @@ protected:
     shared_ptr<IteratorImpl> sp_it_Impl;
 };
 
+/**
+ * The keys in [begin_key, end_key) of a cache merged with all its base caches and the db, in key order.
+ * Only the keys visited are read, a scan of the first k keys of the range costs O(k) whatever the size
+ * of the prefix. The erased keys of any layer are skipped.
+ */
+template<typename CacheType>
+class CDBRangeIterator: public CDBIterator<CacheType> {
+private:
+    typedef CDBIterator<CacheType> Base;
+    typedef typename CacheType::KeyType KeyType;
+    KeyType begin_key;
+    KeyType end_key;
+public:
+    CDBRangeIterator(CacheType &dbCache, const KeyType &beginKeyIn, const KeyType &endKeyIn)
+        : Base(dbCache), begin_key(beginKeyIn), end_key(endKeyIn) {}
+
+    virtual bool First() {
+        Base::Seek(begin_key);
+        return IsValid();
+    }
+
+    virtual bool IsValid() const {
+        return Base::IsValid() && this->GetKey() < end_key;
+    }
+};
+
 struct CommonPrefixMatcher {
     // empty prefix, will match all keys
     template<typename KeyType>
@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_DBSTORAGE_H
+#define PERSIST_DBSTORAGE_H
+
+#include <boost/filesystem/path.hpp>
+#include <leveldb/db.h>
+#include <leveldb/iterator.h>
+#include <leveldb/write_batch.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+struct CLevelDBOptions;
+
+/**
+ * The storage engine under a CLevelDBWrapper, selected by -dbbackend. The slices, batches, iterators and
+ * snapshots keep the leveldb types the callers are written against, another engine adapts its own to them.
+ */
+class CDBStorage {
+public:
+    virtual ~CDBStorage() {}
+
+    // NotFound if the key is missing, the db as of the snapshot if one is given
+    virtual leveldb::Status Get(const leveldb::Slice &key, std::string *pValue,
+                                const leveldb::Snapshot *pSnapshot) = 0;
+    // the values of the keys, nullopt for the missing ones, one lookup after the other unless the engine
+    // batches them
+    virtual leveldb::Status MultiGet(const std::vector<leveldb::Slice> &keys,
+                                     std::vector<std::optional<std::string>> &values,
+                                     const leveldb::Snapshot *pSnapshot);
+    virtual leveldb::Status Write(leveldb::WriteBatch *pBatch, bool fSync) = 0;
+    // an iterator which does not fill the block cache
+    virtual leveldb::Iterator *NewIterator(const leveldb::Snapshot *pSnapshot) = 0;
+    // an iterator which fills the block cache, to warm it up
+    virtual leveldb::Iterator *NewFillCacheIterator() = 0;
+    virtual const leveldb::Snapshot *GetSnapshot() = 0;
+    virtual void ReleaseSnapshot(const leveldb::Snapshot *pSnapshot) = 0;
+};
+
+static const char *const DB_BACKEND_LEVELDB = "leveldb";
+static const char *const DB_BACKEND_ROCKSDB = "rocksdb";
+
+// the -dbbackend of the node, leveldb by default
+const std::string &GetDbBackend();
+// whether the backend is known and built in, rocksdb only with --with-rocksdb
+bool IsDbBackendAvailable(const std::string &backend);
+
+CDBStorage *NewLevelDBStorage(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fMemory,
+                              bool fWipe);
+// the database is the column family named after the last part of the path, in the rocksdb shared by the
+// databases of the parent directory
+CDBStorage *NewRocksDBStorage(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fWipe);
+
+#endif  // PERSIST_DBSTORAGE_H
@@ -6,12 +6,43 @@
 #include "delegatedb.h"
 
 #include "config/configuration.h"
+#include "persistence/dbiterator.h"
 
 bool CDelegateDBCache::GetTopVoteDelegates(VoteDelegateVector &topVotedDelegates) {
 
     // votes{(uint64t)MAX - $votedBcoins}{$RegId} --> 1
-    set<decltype(voteRegIdCache)::KeyType> topKeys;
-    voteRegIdCache.GetTopNElements(IniCfg().GetTotalDelegateNum(), topKeys);
+    // a range read depends on any write to the vote index
+    if (CDBAccessTracker::GetCurrent() != nullptr)
+        CDBAccessTracker::GetCurrent()->OnReadPrefix(DBVoteRegIdCache::PREFIX_TYPE);
+    CDBAccessStats::OnRead(DBVoteRegIdCache::PREFIX_TYPE);
+
+    const uint32_t delegateNum = IniCfg().GetTotalDelegateNum();
+    vector<DBVoteRegIdCache::KeyType> topKeys;
+
+    CDelegateDBCache *pTopCache = this;
+    vector<CDelegateDBCache *> childCaches;
+    while (pTopCache->pBaseCache != nullptr) {
+        childCaches.push_back(pTopCache);
+        pTopCache = pTopCache->pBaseCache;
+    }
+
+    auto spRanking = pTopCache->GetRanking();
+    if (spRanking) {
+        // the lower child caches override the upper ones
+        CDelegateRanking::ChangeMap changes;
+        for (auto it = childCaches.rbegin(); it != childCaches.rend(); it++) {
+            for (const auto &item : (*it)->voteRegIdCache.GetMapData())
+                changes[item.first] = !db_util::IsEmpty(item.second);
+        }
+
+        spRanking->LoadIfNeeded();
+        spRanking->GetTop(delegateNum, changes, topKeys);
+    } else {
+        // the caches on a copy of the top level cache read the merged layers up to the last delegate only
+        CDBIterator<DBVoteRegIdCache> dbIt(voteRegIdCache);
+        for (dbIt.First(); dbIt.IsValid() && topKeys.size() < delegateNum; dbIt.Next())
+            topKeys.push_back(dbIt.GetKey());
+    }
 
     // assert(regIds.size() == IniCfg().GetTotalDelegateNum());
 
@@ -86,15 +117,16 @@ bool CDelegateDBCache::IsActiveDelegate(const CRegID &regid) {
     return GetActiveDelegate(regid, delegate);
 }
 
+// searched in place, every price feed tx of a block checks its sender against the same delegates
 bool CDelegateDBCache::GetActiveDelegate(const CRegID &regid, VoteDelegate &voteDelegate) {
-    VoteDelegateVector delegates;
-    if (!GetActiveDelegates(delegates))
+    auto spDelegates = active_delegates_cache.GetConstDataPtr();
+    if (!spDelegates)
         return false;
 
-    auto it = std::find_if(delegates.begin(), delegates.end(), [&regid](const VoteDelegate &item){
+    auto it = std::find_if(spDelegates->begin(), spDelegates->end(), [&regid](const VoteDelegate &item){
         return item.regid == regid;
     });
-    if (it == delegates.end()) {
+    if (it == spDelegates->end()) {
         return false;
     }
     voteDelegate = *it;
@@ -122,7 +154,16 @@ bool CDelegateDBCache::GetVoterList(map<CRegIDKey, vector<CCandidateReceivedVote
     return regId2VoteCache.GetAllElements(regId2Vote);
 }
 
+shared_ptr<CDelegateRanking> CDelegateDBCache::GetRanking() {
+    return spRanking && spRanking->IsOwner(this) ? spRanking : nullptr;
+}
+
 bool CDelegateDBCache::Flush() {
+    if (pBaseCache != nullptr && pBaseCache->spRanking && pBaseCache->spRanking->IsOwner(pBaseCache) &&
+        pBaseCache->spRanking->IsLoaded()) {
+        for (const auto &item : voteRegIdCache.GetMapData())
+            pBaseCache->spRanking->Update(item.first, !db_util::IsEmpty(item.second));
+    }
     voteRegIdCache.Flush();
     regId2VoteCache.Flush();
     last_vote_height_cache.Flush();
@@ -146,4 +187,52 @@ void CDelegateDBCache::Clear() {
     last_vote_height_cache.Clear();
     pending_delegates_cache.Clear();
     active_delegates_cache.Clear();
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class CDelegateRanking
+
+void CDelegateRanking::LoadIfNeeded() {
+    LOCK(cs_ranking);
+    if (loaded)
+        return;
+
+    int64_t beginTime = GetTimeMillis();
+    CDBIterator<DBVoteRegIdCache> dbIt(pCache->voteRegIdCache);
+    for (dbIt.First(); dbIt.IsValid(); dbIt.Next())
+        ranking.insert(dbIt.GetKey());
+    loaded = true;
+    LogPrint(BCLog::INFO, "loaded the delegate ranking, candidate_count=%llu, cost %d ms\n", ranking.size(),
+             GetTimeMillis() - beginTime);
+}
+
+bool CDelegateRanking::IsLoaded() const {
+    LOCK(cs_ranking);
+    return loaded;
+}
+
+void CDelegateRanking::Update(const KeyType &key, bool isVoted) {
+    LOCK(cs_ranking);
+    if (isVoted)
+        ranking.insert(key);
+    else
+        ranking.erase(key);
+}
+
+void CDelegateRanking::GetTop(uint32_t count, const ChangeMap &changes, vector<KeyType> &topKeys) const {
+    LOCK(cs_ranking);
+    auto rankIt   = ranking.begin();
+    auto changeIt = changes.begin();
+    while (topKeys.size() < count && (rankIt != ranking.end() || changeIt != changes.end())) {
+        if (changeIt == changes.end() || (rankIt != ranking.end() && *rankIt < changeIt->first)) {
+            topKeys.push_back(*rankIt++);
+            continue;
+        }
+
+        if (rankIt != ranking.end() && *rankIt == changeIt->first)
+            rankIt++;
+        if (changeIt->second)
+            topKeys.push_back(changeIt->first);
+        changeIt++;
+    }
+}
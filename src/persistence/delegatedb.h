@@ -12,6 +12,7 @@
 #include "commons/serialize.h"
 #include "dbaccess.h"
 #include "dbconf.h"
+#include "sync.h"
 
 #include <map>
 #include <set>
@@ -19,6 +20,41 @@
 
 using namespace std;
 
+// vote{(uint64t)MAX - $votedBcoins}{$RegId} -> 1
+typedef CCompositeKVCache<dbk::VOTE, std::pair<string, CRegIDKey>, uint8_t> DBVoteRegIdCache;
+
+class CDelegateDBCache;
+
+/**
+ * The candidates of the top level delegate cache ranked by their votes: the keys of its vote index, which
+ * sort by the votes descending then the regid, in an ordered set. It is loaded at the first election, then
+ * kept current by the child caches flushing their vote index into the top level cache, like the cdp ratio
+ * buckets. An election reads the first delegates of the set merged with the vote changes of the child
+ * caches above it, instead of seeking the vote index of the db.
+ */
+class CDelegateRanking {
+public:
+    typedef DBVoteRegIdCache::KeyType KeyType;
+    // the vote keys written by the child caches, false for the erased ones
+    typedef map<KeyType, bool> ChangeMap;
+
+    CDelegateRanking(CDelegateDBCache *pCacheIn) : pCache(pCacheIn) {}
+
+    bool IsOwner(const CDelegateDBCache *pCacheIn) const { return pCache == pCacheIn; }
+    // must be called under cs_main, the lock of the cache flushes
+    void LoadIfNeeded();
+    bool IsLoaded() const;
+    void Update(const KeyType &key, bool isVoted);
+    // the first count keys of the ranking with the changes applied
+    void GetTop(uint32_t count, const ChangeMap &changes, vector<KeyType> &topKeys) const;
+
+private:
+    CDelegateDBCache *pCache;
+    mutable CCriticalSection cs_ranking;
+    bool loaded = false;
+    set<KeyType> ranking;
+};
+
 class CDelegateDBCache {
 public:
     CDelegateDBCache() {}
@@ -27,7 +63,8 @@ public:
           regId2VoteCache(pDbAccess),
           last_vote_height_cache(pDbAccess),
           pending_delegates_cache(pDbAccess),
-          active_delegates_cache(pDbAccess) {}
+          active_delegates_cache(pDbAccess),
+          spRanking(make_shared<CDelegateRanking>(this)) {}
 
     CDelegateDBCache(CDelegateDBCache *pBaseIn)
         : voteRegIdCache(pBaseIn->voteRegIdCache),
@@ -63,6 +100,7 @@ public:
     void Clear();
 
     void SetBaseViewPtr(CDelegateDBCache *pBaseIn) {
+        pBaseCache = pBaseIn;
         voteRegIdCache.SetBase(&pBaseIn->voteRegIdCache);
         regId2VoteCache.SetBase(&pBaseIn->regId2VoteCache);
         last_vote_height_cache.SetBase(&pBaseIn->last_vote_height_cache);
@@ -85,11 +123,18 @@ public:
         pending_delegates_cache.RegisterUndoFunc(undoDataFuncMap);
         active_delegates_cache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        voteRegIdCache.RegisterReadFunc(readDataFuncMap);
+        regId2VoteCache.RegisterReadFunc(readDataFuncMap);
+        last_vote_height_cache.RegisterReadFunc(readDataFuncMap);
+        pending_delegates_cache.RegisterReadFunc(readDataFuncMap);
+        active_delegates_cache.RegisterReadFunc(readDataFuncMap);
+    }
 public:
 /*  CCompositeKVCache  prefixType     key                              value                   variable       */
 /*  -------------------- -------------- --------------------------  ----------------------- -------------- */
-    // vote{(uint64t)MAX - $votedBcoins}{$RegId} -> 1
-    CCompositeKVCache<dbk::VOTE,       std::pair<string, CRegIDKey>,  uint8_t>                voteRegIdCache;
+    DBVoteRegIdCache                                                                          voteRegIdCache;
     CCompositeKVCache<dbk::REGID_VOTE, CRegIDKey,         vector<CCandidateReceivedVote>> regId2VoteCache;
 
     CSimpleKVCache<dbk::LAST_VOTE_HEIGHT, CVarIntValue<uint32_t>> last_vote_height_cache;
@@ -97,6 +142,13 @@ public:
     CSimpleKVCache<dbk::ACTIVE_DELEGATES, VoteDelegateVector> active_delegates_cache;
 
     vector<CRegID> delegateRegIds;
+
+private:
+    // the ranking owned by the cache on the db, nullptr for the copies sharing it and the child caches
+    shared_ptr<CDelegateRanking> GetRanking();
+
+    CDelegateDBCache *pBaseCache = nullptr;
+    shared_ptr<CDelegateRanking> spRanking = nullptr;
 };
 
 #endif // PERSIST_DELEGATEDB_H
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include "entities/account.h"
 #include "entities/asset.h"
 #include "main.h"
+#include "commons/random.h"
+#include "persistence/dbiterator.h"
 #include <optional>
 #include <functional>
 
@@ -66,168 +68,27 @@ shared_ptr<string> DEX_DB::MakeLastPos(const DEXBlockOrdersCache::KeyType &lastK
 ///////////////////////////////////////////////////////////////////////////////
 // class CDEXOrdersGetter
 
-class CDexOrderIt {
-public:
-    DEXBlockOrdersCache::KeyType key;
-    DEXBlockOrdersCache::ValueType value;
-    bool is_valid;
-protected:
-    DEXBlockOrdersCache &db_cache;
-    CFixedUInt32 begin_height;
-    CFixedUInt32 end_height;
-public:
-    CDexOrderIt(DEXBlockOrdersCache &dbCache, const CFixedUInt32 &beginHeight, const CFixedUInt32 &endHeight)
-        : key(),
-          value(),
-          is_valid(false),
-          db_cache(dbCache),
-          begin_height(beginHeight),
-          end_height(endHeight){}
-};
-
-class CDBDexOrderIt: public CDexOrderIt {
-private:
-    shared_ptr<leveldb::Iterator> p_db_it;
-    string last_pos_key;
-    string prefix;
-public:
-    using CDexOrderIt::CDexOrderIt;
-
-    bool First(DEXBlockOrdersCache::KeyType lastPosKey) {
-        p_db_it = db_cache.GetDbAccessPtr()->NewIterator();
-        prefix = dbk::GetKeyPrefix(DEXBlockOrdersCache::PREFIX_TYPE);
-        last_pos_key = dbk::GenDbKey(DEXBlockOrdersCache::PREFIX_TYPE, lastPosKey);
-        p_db_it->Seek(last_pos_key);
-        if (p_db_it->Valid() && p_db_it->key() == last_pos_key) {
-            p_db_it->Next();
-        }
-        return Parse();
-    }
-
-    bool First() {
-        return First(make_tuple(begin_height, 0, uint256()));
-    }
-
-    bool Next() {
-        p_db_it->Next();
-        return Parse();
-    }
-
-    bool IsValid() {return is_valid;}
-private:
-    inline bool Parse() {
-        is_valid = false;
-        if (!p_db_it->Valid() || !p_db_it->key().starts_with(prefix)) return false;
-
-        const leveldb::Slice &slKey = p_db_it->key();
-        const leveldb::Slice &slValue = p_db_it->value();
-        if (!ParseDbKey(slKey, DEXBlockOrdersCache::PREFIX_TYPE, key)) {
-            throw runtime_error(strprintf("CDBDexOrderIt::Parse db key error! key=%s", HexStr(slKey.ToString())));
-        }
-
-        const CFixedUInt32 &curHeight = std::get<0>(key);
-        if ( curHeight < begin_height || curHeight > end_height)
-            return false;
-
-        try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue >> value;
-        } catch(std::exception &e) {
-            throw runtime_error(strprintf("CDBDexOrderIt::Parse db value error! %s", HexStr(slValue.ToString())));
-        }
-        is_valid = true;
-        return true;
-    }
-};
-
-class CMapDexOrderIt: public CDexOrderIt {
-private:
-    DEXBlockOrdersCache::Iterator map_it;
-public:
-    using CDexOrderIt::CDexOrderIt;
-
-    bool First(DEXBlockOrdersCache::KeyType lastPosKey) {
-        map_it = db_cache.GetMapData().upper_bound(lastPosKey);
-        return Parse();
-    }
-
-    bool First() {
-        return First(make_tuple(begin_height, 0, uint256()));
-    }
-
-    bool Next() {
-        map_it++;
-        return Parse();
-    }
-
-    bool IsValid() {return is_valid;}
-private:
-    inline bool Parse() {
-        is_valid = false;
-        if (map_it == db_cache.GetMapData().end())  return false;
-        key = map_it->first;
-        const CFixedUInt32 &curHeight = std::get<0>(key);
-        if ( curHeight < begin_height || curHeight > end_height)
-            return false;
-        value = map_it->second;
-        return true;
-    }
-};
-
 bool CDEXOrdersGetter::Execute(uint32_t beginHeightIn, uint32_t endHeightIn, uint32_t maxCount, const DEXBlockOrdersCache::KeyType &lastKey) {
 
     assert(orders.size() == 0 && "Can only execute 1 times");
     CFixedUInt32 beginHeight(beginHeightIn);
     CFixedUInt32 endHeight(endHeightIn);
-    CMapDexOrderIt mapIt(db_cache, beginHeight, endHeight);
-    CDBDexOrderIt dbIt(db_cache, beginHeight, endHeight);
-
-    if (!db_util::IsEmpty(lastKey)) {
-        mapIt.First(lastKey);
-        dbIt.First(lastKey);
-    } else {
-        mapIt.First();
-        dbIt.First();
-    }
-    //auto mapIt = mapRangePair.first;
-    while(mapIt.IsValid() || dbIt.IsValid()) {
-        bool isMapData = true, isSameKey = false;
-        if (mapIt.IsValid() && dbIt.IsValid()) {
-            if (dbIt.key < mapIt.key) {
-                isMapData = false;
-            } else if (dbIt.key > mapIt.key) { // dbIt.key >= mapIt.key
-                isMapData = true;
-            } else {// dbIt.key == mapIt.key
-                isMapData = true;
-                isSameKey = true;
-            }
-        } else if (mapIt.IsValid()) {
-            isMapData = true;
-        } else { // dbIt.IsValid())
-            isMapData = false;
-        }
-
-        shared_ptr<DEX_DB::BlockOrdersItem> pItem = nullptr;
-        if (isMapData) {
-            if (!mapIt.value.IsEmpty()) {
-                pItem = make_shared<DEX_DB::BlockOrdersItem>(mapIt.key, mapIt.value);
-            } // else ignore
-            mapIt.Next();
-            if (isSameKey) {
-                assert(dbIt.IsValid());
-                dbIt.Next();
-            }
-        } else { // use db
-            pItem = make_shared<DEX_DB::BlockOrdersItem>(dbIt.key, dbIt.value);
-            dbIt.Next();
-        }
-        if (pItem != nullptr) {
-            if (maxCount != 0 && orders.size() >= maxCount) {
-                has_more = true;
-                break;
-            }
-            orders.push_back(*pItem);
+    DEXBlockOrdersCache::KeyType startKey = lastKey;
+    if (db_util::IsEmpty(lastKey))
+        startKey = make_tuple(beginHeight, (uint8_t)0, uint256());
+
+    // the orders of all the cache layers and the db merged, only the page and the next order are read
+    CDBIterator<DEXBlockOrdersCache> dbIt(db_cache);
+    for (dbIt.SeekUpper(&startKey); dbIt.IsValid(); dbIt.Next()) {
+        const CFixedUInt32 &curHeight = std::get<0>(dbIt.GetKey());
+        if (curHeight < beginHeight || curHeight > endHeight)
+            break;
+
+        if (maxCount != 0 && orders.size() >= maxCount) {
+            has_more = true;
+            break;
         }
+        orders.emplace_back(dbIt.GetKey(), dbIt.GetValue());
     }
     if (!orders.empty()) {
         begin_height = DEX_DB::GetHeight(orders.front().first);
@@ -244,137 +105,220 @@ void CDEXOrdersGetter::ToJson(Object &obj) {
 ///////////////////////////////////////////////////////////////////////////////
 // class CDEXSysOrdersGetter
 
-//CDBDexSysOrderIt
-class CDBDexSysOrderIt {
-public:
-    DEXBlockOrdersCache::KeyType key;
-    DEXBlockOrdersCache::ValueType value;
-private:
-    shared_ptr<leveldb::Iterator> p_db_it;
-    CFixedUInt32 height;
-    bool is_valid;
-    string prefix;
-public:
-    CDBDexSysOrderIt(CDBAccess &dbAccess, const CFixedUInt32 &heightIn)
-        : key(), value(), height(heightIn), is_valid(false) {
-
-        p_db_it = dbAccess.NewIterator();
-        prefix = dbk::GenDbKey(DEXBlockOrdersCache::PREFIX_TYPE, make_pair(height, (uint8_t)SYSTEM_GEN_ORDER));
-    }
+bool CDEXSysOrdersGetter::Execute(uint32_t heightIn) {
 
-    bool First() {
-        p_db_it->Seek(prefix);
-        return Parse();
+    CFixedUInt32 height(heightIn);
+    DEXBlockOrdersCache::KeyType startKey = make_tuple(height, (uint8_t)SYSTEM_GEN_ORDER, uint256());
+    CDBIterator<DEXBlockOrdersCache> dbIt(db_cache);
+    for (dbIt.SeekUpper(&startKey); dbIt.IsValid(); dbIt.Next()) {
+        const auto &key = dbIt.GetKey();
+        if (std::get<0>(key) != height || DEX_DB::GetGenerateType(key) != SYSTEM_GEN_ORDER)
+            break;
+        orders.emplace_back(key, dbIt.GetValue());
     }
 
-    bool Next() {
-        p_db_it->Next();
-        return Parse();
-    }
+    return true;
+}
 
-    bool IsValid() {return is_valid;}
-private:
-    inline bool Parse() {
-        is_valid = false;
-        if (!p_db_it->Valid() || !p_db_it->key().starts_with(prefix)) return false;
+void CDEXSysOrdersGetter::ToJson(Object &obj) {
+    DEX_DB::BlockOrdersToJson(orders, obj);
+}
 
-        const leveldb::Slice &slKey = p_db_it->key();
-        const leveldb::Slice &slValue = p_db_it->value();
-        if (!ParseDbKey(slKey, DEXBlockOrdersCache::PREFIX_TYPE, key)) {
-            throw runtime_error(strprintf("CDBDexSysOrderIt::Parse db key error! key=%s", HexStr(slKey.ToString())));
-        }
-        assert(std::get<0>(key) == height || DEX_DB::GetGenerateType(key) == (uint8_t)SYSTEM_GEN_ORDER);
+///////////////////////////////////////////////////////////////////////////////
+// class CDEXOrdersCursor
+
+CDEXOrdersCursor::CDEXOrdersCursor(DEXBlockOrdersCache &dbCache, uint32_t beginHeightIn, uint32_t endHeightIn)
+    : begin_height(beginHeightIn), end_height(endHeightIn) {
+    AssertLockHeld(cs_main);
+
+    DEXBlockOrdersCache::KeyType beginKey = make_tuple(CFixedUInt32(begin_height), 0, uint256());
+    auto &mapData = dbCache.GetMapData();
+    for (auto it = mapData.lower_bound(beginKey); it != mapData.end() && DEX_DB::GetHeight(it->first) <= end_height; it++)
+        map_orders.insert(*it);
+    map_it = map_orders.begin();
+
+    prefix  = dbk::GetKeyPrefix(DEXBlockOrdersCache::PREFIX_TYPE);
+    p_db_it = dbCache.GetDbAccessPtr()->NewSnapshotIterator();
+    p_db_it->Seek(dbk::GenDbKey(DEXBlockOrdersCache::PREFIX_TYPE, beginKey));
+    ParseDb();
+}
 
-        try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue >> value;
-        } catch(std::exception &e) {
-            throw runtime_error(strprintf("CDBDexSysOrderIt::Parse db value error! %s", HexStr(slValue.ToString())));
+bool CDEXOrdersCursor::Read(uint32_t maxCount, DEX_DB::BlockOrders &orders) {
+    LOCK(cs_cursor);
+    while (map_it != map_orders.end() || db_valid) {
+        bool isMapData = !db_valid || (map_it != map_orders.end() && !(db_item.first < map_it->first));
+        if (isMapData) {
+            if (!map_it->second.IsEmpty()) {
+                if (orders.size() >= maxCount)
+                    return true;
+                orders.emplace_back(map_it->first, map_it->second);
+            } // else the order is erased, ignore it
+            if (db_valid && db_item.first == map_it->first) {
+                p_db_it->Next();
+                ParseDb();
+            }
+            map_it++;
+        } else {
+            if (orders.size() >= maxCount)
+                return true;
+            orders.push_back(db_item);
+            p_db_it->Next();
+            ParseDb();
         }
-        is_valid = true;
-        return true;
-    }
-};
-
-class CMapDexSysOrderIt {
-public:
-    DEXBlockOrdersCache::KeyType key;
-    DEXBlockOrdersCache::ValueType value;
-private:
-    DEXBlockOrdersCache::Map &data_map;
-    DEXBlockOrdersCache::Iterator map_it;
-    CFixedUInt32 height;
-    bool is_valid;
-public:
-    CMapDexSysOrderIt(DEXBlockOrdersCache &dbCache, const CFixedUInt32 &heightIn)
-        : key(), value(), data_map(dbCache.GetMapData()), map_it(data_map.end()), height(heightIn), is_valid(false) {}
-
-    bool First() {
-        map_it = data_map.upper_bound(make_tuple(height, (uint8_t)SYSTEM_GEN_ORDER, uint256()));
-        return Parse();
     }
-    bool Next() {
-        map_it++;
-        return Parse();
+    return false;
+}
+
+void CDEXOrdersCursor::ParseDb() {
+    db_valid = false;
+    if (!p_db_it->Valid() || !p_db_it->key().starts_with(prefix))
+        return;
+
+    const leveldb::Slice &slKey   = p_db_it->key();
+    const leveldb::Slice &slValue = p_db_it->value();
+    if (!dbk::ParseDbKey(slKey, DEXBlockOrdersCache::PREFIX_TYPE, db_item.first))
+        throw runtime_error(strprintf("CDEXOrdersCursor::ParseDb db key error! key=%s", HexStr(slKey.ToString())));
+
+    if (DEX_DB::GetHeight(db_item.first) > end_height)
+        return;
+
+    try {
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> db_item.second;
+    } catch (std::exception &e) {
+        throw runtime_error(strprintf("CDEXOrdersCursor::ParseDb db value error! %s", HexStr(slValue.ToString())));
     }
+    db_valid = true;
+}
 
-    bool IsValid() {return is_valid;}
-private:
-    inline bool Parse() {
-        is_valid = false;
-        if (map_it == data_map.end())  return false;
-        key = map_it->first;
-        if (std::get<0>(key) != height || DEX_DB::GetGenerateType(key) != SYSTEM_GEN_ORDER)
-            return false;
-        value = map_it->second;
-        return true;
+///////////////////////////////////////////////////////////////////////////////
+// class CDEXOrdersCursors
+
+string CDEXOrdersCursors::Open(shared_ptr<CDEXOrdersCursor> spCursor) {
+    LOCK(cs_cursors);
+    int64_t now = GetTime();
+    EraseExpired(now);
+    if (cursors.size() >= MAX_CURSORS) {
+        auto lruIt = std::min_element(cursors.begin(), cursors.end(), [](const auto &a, const auto &b) {
+            return a.second.second < b.second.second;
+        });
+        LogPrint(BCLog::DEX, "close the least recently used orders cursor %s\n", lruIt->first);
+        cursors.erase(lruIt);
     }
-};
 
-bool CDEXSysOrdersGetter::Execute(uint32_t heightIn) {
+    string cursorId = GetRandHash().GetHex();
+    cursors[cursorId] = make_pair(spCursor, now);
+    return cursorId;
+}
 
-    CFixedUInt32 height(heightIn);
-    CMapDexSysOrderIt mapIt(db_cache, height);
-    CDBDexSysOrderIt dbIt(db_access, height);
-    mapIt.First();
-    dbIt.First();
-    //auto mapIt = mapRangePair.first;
-    while(mapIt.IsValid() || dbIt.IsValid()) {
-        bool isMapData = true, isSameKey = false;
-        if (mapIt.IsValid() && dbIt.IsValid()) {
-            if (dbIt.key < mapIt.key) {
-                isMapData = false;
-            } else if (dbIt.key > mapIt.key) { // dbIt.key >= mapIt.key
-                isMapData = true;
-            } else {// dbIt.key == mapIt.key
-                isMapData = true;
-                isSameKey = true;
-            }
-        } else if (mapIt.IsValid()) {
-            isMapData = true;
-        } else { // dbIt.IsValid())
-            isMapData = false;
-        }
+shared_ptr<CDEXOrdersCursor> CDEXOrdersCursors::Get(const string &cursorId) {
+    LOCK(cs_cursors);
+    int64_t now = GetTime();
+    EraseExpired(now);
+    auto it = cursors.find(cursorId);
+    if (it == cursors.end())
+        return nullptr;
 
-        if (isMapData) {
-            if (!mapIt.value.IsEmpty()) {
-                orders.push_back(make_pair(mapIt.key, mapIt.value));
-            } // else ignore
-            mapIt.Next();
-            if (isSameKey) {
-                dbIt.Next();
-            }
-        } else { // use db
-            orders.push_back(make_pair(dbIt.key, dbIt.value));
-            dbIt.Next();
+    it->second.second = now;
+    return it->second.first;
+}
+
+bool CDEXOrdersCursors::Close(const string &cursorId) {
+    LOCK(cs_cursors);
+    return cursors.erase(cursorId) > 0;
+}
+
+void CDEXOrdersCursors::EraseExpired(int64_t now) {
+    for (auto it = cursors.begin(); it != cursors.end();) {
+        if (now - it->second.second > CURSOR_TIMEOUT) {
+            LogPrint(BCLog::DEX, "close the expired orders cursor %s\n", it->first);
+            it = cursors.erase(it);
+        } else {
+            it++;
         }
     }
+}
 
-    return true;
+///////////////////////////////////////////////////////////////////////////////
+// class CDEXOrderBook
+
+static inline uint64_t GetResidualAssetAmount(const CDEXOrderDetail &order) {
+    return order.asset_amount > order.total_deal_asset_amount ? order.asset_amount - order.total_deal_asset_amount : 0;
 }
 
-void CDEXSysOrdersGetter::ToJson(Object &obj) {
-    DEX_DB::BlockOrdersToJson(orders, obj);
+void CDEXOrderBook::LoadIfNeeded() {
+    LOCK(cs_book);
+    if (loaded)
+        return;
+
+    int64_t beginTime = GetTimeMillis();
+    CDBIterator<decltype(pCache->activeOrderCache)> dbIt(pCache->activeOrderCache);
+    for (dbIt.First(); dbIt.IsValid(); dbIt.Next()) {
+        Update(dbIt.GetKey(), dbIt.GetValue());
+    }
+    loaded = true;
+    LogPrint(BCLog::DEX, "loaded the dex order book, order_count=%llu, book_count=%llu, cost %d ms\n",
+        orderPositions.size(), books.size(), GetTimeMillis() - beginTime);
+}
+
+void CDEXOrderBook::Update(const uint256 &orderId, const CDEXOrderDetail &order) {
+    LOCK(cs_book);
+    Erase(orderId);
+    if (order.IsEmpty() || order.order_type != ORDER_LIMIT_PRICE)
+        return;
+
+    BookKey bookKey = make_tuple(order.dex_id, CTokenSymbolTable::Intern(order.coin_symbol),
+                                 CTokenSymbolTable::Intern(order.asset_symbol), (uint8_t)order.order_side);
+    uint64_t sortPrice = order.order_side == ORDER_BUY ? std::numeric_limits<uint64_t>::max() - order.price : order.price;
+    OrderKey orderKey = make_tuple(sortPrice, order.tx_cord.GetHeight(), order.tx_cord.GetIndex(), orderId);
+    books[bookKey][orderKey] = order;
+    orderPositions[orderId] = make_pair(bookKey, orderKey);
+}
+
+void CDEXOrderBook::Erase(const uint256 &orderId) {
+    auto posIt = orderPositions.find(orderId);
+    if (posIt == orderPositions.end())
+        return;
+
+    auto bookIt = books.find(posIt->second.first);
+    if (bookIt != books.end()) {
+        bookIt->second.erase(posIt->second.second);
+        if (bookIt->second.empty())
+            books.erase(bookIt);
+    }
+    orderPositions.erase(posIt);
+}
+
+void CDEXOrderBook::GetOrders(const BookKey &bookKey, uint32_t maxCount, vector<OrderItem> &orders) const {
+    LOCK(cs_book);
+    auto bookIt = books.find(bookKey);
+    if (bookIt == books.end())
+        return;
+
+    for (const auto &item : bookIt->second) {
+        if (maxCount != 0 && orders.size() >= maxCount)
+            break;
+        orders.emplace_back(std::get<3>(item.first), item.second);
+    }
+}
+
+void CDEXOrderBook::GetDepth(const BookKey &bookKey, uint32_t maxLevels, vector<PriceLevel> &levels) const {
+    LOCK(cs_book);
+    auto bookIt = books.find(bookKey);
+    if (bookIt == books.end())
+        return;
+
+    for (const auto &item : bookIt->second) {
+        const CDEXOrderDetail &order = item.second;
+        if (levels.empty() || levels.back().price != order.price) {
+            if (maxLevels != 0 && levels.size() >= maxLevels)
+                break;
+            levels.emplace_back();
+            levels.back().price = order.price;
+        }
+        levels.back().asset_amount += GetResidualAssetAmount(order);
+        levels.back().count++;
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -13,6 +13,7 @@
 #include "commons/serialize.h"
 #include "commons/leb128.h"
 #include "persistence/dbaccess.h"
+#include "sync.h"
 #include "entities/account.h"
 #include "entities/dexorder.h"
 #include <optional>
@@ -62,11 +63,8 @@ public:
     DEX_DB::BlockOrders orders;             // the returned orders
 private:
     DEXBlockOrdersCache &db_cache;
-    CDBAccess &db_access;
 public:
-    CDEXOrdersGetter(DEXBlockOrdersCache &dbCache)
-        : db_cache(dbCache), db_access(*dbCache.GetDbAccessPtr()) {
-    }
+    CDEXOrdersGetter(DEXBlockOrdersCache &dbCache) : db_cache(dbCache) {}
 
     bool Execute(uint32_t fromHeight, uint32_t toHeight, uint32_t maxCount, const DEXBlockOrdersCache::KeyType &lastPosInfo);
     void ToJson(Object &obj);
@@ -78,21 +76,113 @@ public:
     DEX_DB::BlockOrders orders; // exec result
 private:
     DEXBlockOrdersCache &db_cache;
-    CDBAccess &db_access;
 public:
-    CDEXSysOrdersGetter(DEXBlockOrdersCache &dbCache)
-        : db_cache(dbCache), db_access(*dbCache.GetDbAccessPtr()) {
-    }
+    CDEXSysOrdersGetter(DEXBlockOrdersCache &dbCache) : db_cache(dbCache) {}
     bool Execute(uint32_t height);
 
     void ToJson(Object &obj);
 };
 
+/**
+ * Server side cursor over the block orders of a height range, for the indexers walking all the orders
+ * page by page. It reads a copy of the range in the top level cache and a snapshot of the db, both
+ * taken at its creation, so the pages are consistent with each other and are read without cs_main.
+ */
+class CDEXOrdersCursor {
+public:
+    const uint32_t begin_height;
+    const uint32_t end_height;
+public:
+    // must be called under cs_main, the lock of the cache flushes
+    CDEXOrdersCursor(DEXBlockOrdersCache &dbCache, uint32_t beginHeightIn, uint32_t endHeightIn);
+
+    // read at most maxCount orders after the last read ones, return true if there are more orders
+    bool Read(uint32_t maxCount, DEX_DB::BlockOrders &orders);
+
+private:
+    void ParseDb();
+
+    CCriticalSection cs_cursor;
+    DEXBlockOrdersCache::Map map_orders;  // the erased orders are kept to hide them in the db snapshot
+    DEXBlockOrdersCache::Map::const_iterator map_it;
+    shared_ptr<leveldb::Iterator> p_db_it;
+    string prefix;
+    bool db_valid = false;
+    DEX_DB::BlockOrdersItem db_item;
+};
+
+/**
+ * The open orders cursors of the top level dex cache, by cursor id. The cursors idle for more than
+ * CURSOR_TIMEOUT seconds are closed, and the least recently used one when MAX_CURSORS are open.
+ */
+class CDEXOrdersCursors {
+public:
+    static const uint32_t MAX_CURSORS   = 16;
+    static const int64_t CURSOR_TIMEOUT = 600;
+
+    string Open(shared_ptr<CDEXOrdersCursor> spCursor);
+    // return nullptr if the cursor is closed or expired
+    shared_ptr<CDEXOrdersCursor> Get(const string &cursorId);
+    bool Close(const string &cursorId);
+
+private:
+    // cursor, last access time
+    typedef pair<shared_ptr<CDEXOrdersCursor>, int64_t> CursorItem;
+
+    void EraseExpired(int64_t now);
+
+    CCriticalSection cs_cursors;
+    map<string, CursorItem> cursors;
+};
+
+class CDexDBCache;
+
+/**
+ * Price-time priority index of the active limit orders of the top level dex cache, by dex operator,
+ * trading pair and side. It is loaded from the db at the first query, then kept current by the child
+ * caches flushing into the top level cache, so the order book queries never read leveldb.
+ */
+class CDEXOrderBook {
+public:
+    // dex_id, interned coin_symbol, interned asset_symbol, order_side
+    typedef tuple<DexID, TokenSymbolId, TokenSymbolId, uint8_t> BookKey;
+    // sort price(ascending price of sell orders, descending price of buy orders), height, index, order id
+    typedef tuple<uint64_t, uint32_t, uint16_t, uint256> OrderKey;
+    typedef pair<uint256, dex::CDEXOrderDetail> OrderItem;
+
+    struct PriceLevel {
+        uint64_t price        = 0;
+        uint64_t asset_amount = 0;  // residual asset amount of the orders at the price
+        uint32_t count        = 0;
+    };
+
+    CDEXOrderBook(CDexDBCache *pCacheIn) : pCache(pCacheIn) {}
+
+    bool IsOwner(const CDexDBCache *pCacheIn) const { return pCache == pCacheIn; }
+    // must be called under cs_main, the lock of the cache flushes
+    void LoadIfNeeded();
+    // erase the order from the book if it is empty or no longer a limit order
+    void Update(const uint256 &orderId, const dex::CDEXOrderDetail &order);
+
+    void GetOrders(const BookKey &bookKey, uint32_t maxCount, vector<OrderItem> &orders) const;
+    void GetDepth(const BookKey &bookKey, uint32_t maxLevels, vector<PriceLevel> &levels) const;
+
+private:
+    void Erase(const uint256 &orderId);
+
+    CDexDBCache *pCache;
+    mutable CCriticalSection cs_book;
+    bool loaded = false;
+    map<BookKey, map<OrderKey, dex::CDEXOrderDetail>> books;
+    map<uint256, pair<BookKey, OrderKey>> orderPositions;
+};
+
 class CDexDBCache {
 public:
     CDexDBCache() {}
     CDexDBCache(CDBAccess *pDbAccess)
-        : activeOrderCache(pDbAccess),
+        : spOrdersCursors(make_shared<CDEXOrdersCursors>()),
+          activeOrderCache(pDbAccess),
           blockOrdersCache(pDbAccess),
           operator_detail_cache(pDbAccess),
           operator_owner_map_cache(pDbAccess),
@@ -117,6 +207,10 @@ public:
         const DexOperatorDetail& detail);
 
     bool Flush() {
+        if (pBaseCache != nullptr && pBaseCache->spOrderBook && pBaseCache->spOrderBook->IsOwner(pBaseCache)) {
+            for (const auto &item : activeOrderCache.GetMapData())
+                pBaseCache->spOrderBook->Update(item.first, item.second);
+        }
         activeOrderCache.Flush();
         blockOrdersCache.Flush();
         operator_detail_cache.Flush(),
@@ -135,6 +229,7 @@ public:
             operator_trade_pair_cache.GetCacheSize();
     }
     void SetBaseViewPtr(CDexDBCache *pBaseIn) {
+        pBaseCache = pBaseIn;
         activeOrderCache.SetBase(&pBaseIn->activeOrderCache);
         blockOrdersCache.SetBase(&pBaseIn->blockOrdersCache);
         operator_detail_cache.SetBase(&pBaseIn->operator_detail_cache);
@@ -161,6 +256,15 @@ public:
         operator_trade_pair_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        activeOrderCache.RegisterReadFunc(readDataFuncMap);
+        blockOrdersCache.RegisterReadFunc(readDataFuncMap);
+        operator_detail_cache.RegisterReadFunc(readDataFuncMap);
+        operator_owner_map_cache.RegisterReadFunc(readDataFuncMap);
+        operator_last_id_cache.RegisterReadFunc(readDataFuncMap);
+        operator_trade_pair_cache.RegisterReadFunc(readDataFuncMap);
+    }
+
     shared_ptr<CDEXOrdersGetter> CreateOrdersGetter() {
         assert(blockOrdersCache.GetBasePtr() == nullptr && "only support top level cache");
         return make_shared<CDEXOrdersGetter>(blockOrdersCache);
@@ -170,7 +274,30 @@ public:
         assert(blockOrdersCache.GetBasePtr() == nullptr && "only support top level cache");
         return make_shared<CDEXSysOrdersGetter>(blockOrdersCache);
     }
+
+    // the copies of the top level cache share its order book but do not own it, so never update it
+    shared_ptr<CDEXOrderBook> GetOrderBook() {
+        assert(activeOrderCache.GetBasePtr() == nullptr && "only support top level cache");
+        if (!spOrderBook)
+            spOrderBook = make_shared<CDEXOrderBook>(this);
+        return spOrderBook;
+    }
+
+    shared_ptr<CDEXOrdersCursor> CreateOrdersCursor(uint32_t beginHeight, uint32_t endHeight) {
+        assert(blockOrdersCache.GetBasePtr() == nullptr && "only support top level cache");
+        return make_shared<CDEXOrdersCursor>(blockOrdersCache, beginHeight, endHeight);
+    }
+
+    // created with the top level cache, not at the first use, because the cursors are used without cs_main
+    shared_ptr<CDEXOrdersCursors> GetOrdersCursors() {
+        assert(spOrdersCursors && "only support top level cache");
+        return spOrdersCursors;
+    }
 private:
+    CDexDBCache *pBaseCache = nullptr;
+    shared_ptr<CDEXOrderBook> spOrderBook = nullptr;
+    shared_ptr<CDEXOrdersCursors> spOrdersCursors = nullptr;
+
     DEXBlockOrdersCache::KeyType MakeBlockOrderKey(const uint256 &orderid, const dex::CDEXOrderDetail &activeOrder) {
         return make_tuple(CFixedUInt32(activeOrder.tx_cord.GetHeight()), (uint8_t)activeOrder.generate_type, orderid);
     }
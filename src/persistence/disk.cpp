@@ -4,9 +4,17 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "disk.h"
+#include "config/configuration.h"
+#include "config/const.h"
 #include "logging.h"
 #include "boost/filesystem.hpp"
 
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
 ////////////////////////////////////////////////////////////////////////////////
 // class CBlockFileInfo
 
@@ -41,6 +49,8 @@ FILE *OpenDiskFile(const CDiskBlockPos &pos, const char *prefix, bool fReadOnly)
         return nullptr;
     boost::filesystem::path path = GetDataDir() / "blocks" / strprintf("%s%05u.dat", prefix, pos.nFile);
     boost::filesystem::create_directories(path.parent_path());
+    if (fReadOnly)
+        GetDiskFileWriter().WaitWritten();  // the records in flight are read from the file
     FILE *file = fopen(path.string().c_str(), "rb+");
     if (!file && !fReadOnly)
         file = fopen(path.string().c_str(), "wb+");
@@ -62,3 +72,199 @@ FILE *OpenDiskFile(const CDiskBlockPos &pos, const char *prefix, bool fReadOnly)
 FILE *OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly) {
     return OpenDiskFile(pos, "blk", fReadOnly);
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// class CDiskFileWriter
+
+bool CDiskFileWriter::Write(const CDiskBlockPos &pos, const char *prefix, const char *data, size_t size) {
+    std::lock_guard<std::mutex> lock(mtx);
+    CFile &file = GetFile(pos, prefix);
+    if (file.file == nullptr)
+        return false;
+
+    if (!fRingInitialized) {
+        fRingInitialized = true;
+        if (IsIoUringEnabled()) {
+            pRing.reset(new CIoUring());
+            if (!pRing->Init(IO_URING_ENTRIES)) {
+                LogPrint(BCLog::ERROR, "CDiskFileWriter::Write() : io_uring is not available, errno=%d, the block "
+                         "files are written synchronously\n", errno);
+                pRing.reset();
+            }
+        }
+    }
+
+    if (pRing) {
+        if (!SubmitWrite(file, pos, data, size))
+            return false;
+    } else if (fseek(file.file, pos.nPos, SEEK_SET) != 0 || fwrite(data, 1, size, file.file) != size ||
+               fflush(file.file) != 0) {
+        LogPrint(BCLog::ERROR, "CDiskFileWriter::Write() : failed to write %u bytes at %u of %s%05u.dat\n", size,
+                 pos.nPos, prefix, pos.nFile);
+        return false;
+    }
+
+    if (file.unsyncedBytes == 0)
+        file.unsyncedTime = GetTime();
+    file.fDirty = true;
+    file.unsyncedBytes += size;
+    if (file.unsyncedBytes >= BLOCK_FILE_SYNC_BYTES || GetTime() - file.unsyncedTime >= BLOCK_FILE_SYNC_INTERVAL)
+        SyncFile(file);
+
+    return !fWriteFailed;
+}
+
+bool CDiskFileWriter::SubmitWrite(const CFile &file, const CDiskBlockPos &pos, const char *data, size_t size) {
+    // the caller goes on with its buffer, the record is copied until the kernel has written it
+    while (pendingBytes >= MAX_IO_URING_PENDING_BYTES)
+        WaitPending(1);
+
+    uint64_t id = nextWriteId++;
+    CPendingWrite &write = pendingWrites[id];
+    write.data.assign(data, data + size);
+    write.fd     = fileno(file.file);
+    write.offset = pos.nPos;
+    while (!pRing->SubmitWrite(write.fd, write.data.data(), (uint32_t)size, write.offset, id)) {
+        if (pRing->GetInFlight() == 0) {
+            LogPrint(BCLog::ERROR, "CDiskFileWriter::SubmitWrite() : io_uring submission failed, errno=%d\n", errno);
+            pendingWrites.erase(id);
+            return false;
+        }
+        WaitPending(1);
+    }
+    pendingBytes += size;
+    pendingCount.store((uint32_t)pendingWrites.size(), std::memory_order_release);
+    return true;
+}
+
+void CDiskFileWriter::WaitPending(uint32_t minComplete) {
+    if (!pRing)
+        return;
+
+    uint32_t count = std::min(minComplete, pRing->GetInFlight());
+    while (count > 0) {
+        uint32_t reaped = pRing->Reap(count, [this](uint64_t id, int32_t res) { OnWriteComplete(id, res); });
+        if (reaped == 0)
+            break;
+        count -= std::min(count, reaped);
+    }
+    pendingCount.store((uint32_t)pendingWrites.size(), std::memory_order_release);
+}
+
+void CDiskFileWriter::OnWriteComplete(uint64_t id, int32_t res) {
+    auto it = pendingWrites.find(id);
+    if (it == pendingWrites.end())
+        return;
+
+    CPendingWrite &write = it->second;
+    size_t written = res > 0 ? (size_t)res : 0;
+    // a short write is finished synchronously, they are rare on the regular files
+    while (res >= 0 && written < write.data.size()) {
+        ssize_t ret = pwrite(write.fd, write.data.data() + written, write.data.size() - written, write.offset + written);
+        if (ret <= 0) {
+            res = ret < 0 ? -errno : -EIO;
+            break;
+        }
+        written += (size_t)ret;
+    }
+    if (res < 0) {
+        LogPrint(BCLog::ERROR, "CDiskFileWriter::OnWriteComplete() : failed to write %u bytes at %u, error=%d\n",
+                 write.data.size(), write.offset, -res);
+        fWriteFailed = true;
+    }
+    pendingBytes -= write.data.size();
+    pendingWrites.erase(it);
+}
+
+void CDiskFileWriter::WaitWritten() {
+    if (pendingCount.load(std::memory_order_acquire) == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    WaitPending();
+}
+
+void CDiskFileWriter::Allocate(const CDiskBlockPos &pos, const char *prefix, uint32_t length) {
+    std::lock_guard<std::mutex> lock(mtx);
+    CFile &file = GetFile(pos, prefix);
+    if (file.file == nullptr)
+        return;
+
+    LogPrint(BCLog::INFO, "Pre-allocating up to position 0x%x in %s%05u.dat\n", pos.nPos + length, prefix, pos.nFile);
+    AllocateFileRange(file.file, pos.nPos, length);
+    file.fDirty = true;
+}
+
+bool CDiskFileWriter::Sync() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto &file : files)
+        SyncFile(file);
+    return !fWriteFailed;
+}
+
+void CDiskFileWriter::Finalize(int32_t nFile, uint32_t blockSize, uint32_t undoSize) {
+    std::lock_guard<std::mutex> lock(mtx);
+    const char *prefixes[] = {"blk", "rev"};
+    const uint32_t sizes[] = {blockSize, undoSize};
+    for (size_t i = 0; i < 2; i++) {
+        CFile &file = GetFile(CDiskBlockPos(nFile, 0), prefixes[i]);
+        if (file.file == nullptr)
+            continue;
+        WaitPending();
+        TruncateFile(file.file, sizes[i]);
+        file.fDirty = true;
+        CloseFile(file);
+    }
+}
+
+void CDiskFileWriter::Close(int32_t nFile) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto &file : files) {
+        if (nFile == -1 || file.nFile == nFile)
+            CloseFile(file);
+    }
+}
+
+CDiskFileWriter::CFile &CDiskFileWriter::GetFile(const CDiskBlockPos &pos, const char *prefix) {
+    CFile &file = files[strcmp(prefix, "rev") == 0 ? 1 : 0];
+    if (file.file != nullptr && file.nFile == pos.nFile)
+        return file;
+
+    // the undo of a block lands in the file of the block, which is an older one after a reorg
+    CloseFile(file);
+    file.file  = OpenDiskFile(CDiskBlockPos(pos.nFile, 0), prefix, false);
+    file.nFile = file.file != nullptr ? pos.nFile : -1;
+    return file;
+}
+
+void CDiskFileWriter::SyncFile(CFile &file) {
+    if (file.file == nullptr || !file.fDirty)
+        return;
+
+    // the writes in flight may be to the file, they complete before it is synced
+    WaitPending();
+    FileCommit(file.file);
+    file.fDirty        = false;
+    file.unsyncedBytes = 0;
+    file.unsyncedTime  = 0;
+}
+
+void CDiskFileWriter::CloseFile(CFile &file) {
+    if (file.file == nullptr)
+        return;
+
+    SyncFile(file);
+    fclose(file.file);
+    file.file  = nullptr;
+    file.nFile = -1;
+}
+
+CDiskFileWriter &GetDiskFileWriter() {
+    static CDiskFileWriter writer;
+    return writer;
+}
+
+bool IsIoUringEnabled() {
+    static const bool fEnabled = SysCfg().GetBoolArg("-iouring", DEFAULT_IO_URING);
+    return fEnabled;
+}
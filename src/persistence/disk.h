@@ -7,8 +7,15 @@
 #define PERSIST_DISK_H
 
 #include "commons/util/util.h"
+#include "commons/util/iouring.h"
 #include "commons/serialize.h"
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 struct CDiskBlockPos {
     int32_t nFile;
     uint32_t nPos;
@@ -124,4 +131,75 @@ FILE *OpenDiskFile(const CDiskBlockPos &pos, const char *prefix, bool fReadOnly)
 /** Open a block file (blk?????.dat) */
 FILE *OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 
+/**
+ * The writer of the blk and rev files. The file of each prefix being appended to stays open, so a record
+ * costs one write instead of an open, a seek and a close, and the records are synced together: at the
+ * flush of the chain state by FlushBlockFile(), or earlier once BLOCK_FILE_SYNC_BYTES are unsynced or
+ * the oldest unsynced write is BLOCK_FILE_SYNC_INTERVAL seconds old. Every record is handed to the OS
+ * when written, the readers of the files and their mappings see it at once.
+ *
+ * With -iouring the records are submitted to an io_uring instead and the caller goes on while the kernel
+ * writes them. The writes are completed before the files are synced, i.e. before the chain state is
+ * flushed, and before a reader opens or maps a file, see WaitWritten(). A failed write fails the next
+ * sync.
+ */
+class CDiskFileWriter {
+public:
+    CDiskFileWriter() {}
+    ~CDiskFileWriter() { Close(); }
+
+    // Write the record at pos of the file of prefix
+    bool Write(const CDiskBlockPos &pos, const char *prefix, const char *data, size_t size);
+    // Preallocate the file of prefix from pos.nPos on, the range holds no records yet
+    void Allocate(const CDiskBlockPos &pos, const char *prefix, uint32_t length);
+    // Complete the writes and commit the records of the open files to disk, false if a write failed
+    bool Sync();
+    // Truncate the blk and rev files of nFile to their used sizes, sync and close them when the node
+    // leaves the file
+    void Finalize(int32_t nFile, uint32_t blockSize, uint32_t undoSize);
+    // Sync and close the files of nFile, or all of them if it is -1, e.g. before they are removed
+    void Close(int32_t nFile = -1);
+    // Complete the writes in flight, called by the readers before they open or map a file
+    void WaitWritten();
+
+private:
+    struct CPendingWrite {
+        std::vector<char> data;
+        int fd;
+        uint64_t offset;
+    };
+
+    struct CFile {
+        int32_t nFile = -1;
+        FILE *file    = nullptr;
+        bool fDirty   = false;  // written or allocated since the last sync
+        uint64_t unsyncedBytes = 0;
+        int64_t unsyncedTime   = 0;  // the time of the oldest unsynced write
+    };
+
+    CFile &GetFile(const CDiskBlockPos &pos, const char *prefix);
+    void SyncFile(CFile &file);
+    void CloseFile(CFile &file);
+    bool SubmitWrite(const CFile &file, const CDiskBlockPos &pos, const char *data, size_t size);
+    void WaitPending(uint32_t minComplete = UINT32_MAX);
+    void OnWriteComplete(uint64_t id, int32_t res);
+
+    std::mutex mtx;
+    CFile files[2];  // blk, rev
+
+    std::unique_ptr<CIoUring> pRing;  // null until the first write, or without -iouring
+    bool fRingInitialized = false;
+    std::map<uint64_t, CPendingWrite> pendingWrites;
+    uint64_t nextWriteId  = 0;
+    uint64_t pendingBytes = 0;
+    std::atomic<uint32_t> pendingCount{0};
+    bool fWriteFailed = false;
+};
+
+/** Whether -iouring is set to write the blk and rev files asynchronously */
+bool IsIoUringEnabled();
+
+/** The process wide writer of the blk and rev files */
+CDiskFileWriter &GetDiskFileWriter();
+
 #endif //PERSIST_DISK_H
\ No newline at end of file
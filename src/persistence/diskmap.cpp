@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "diskmap.h"
+
+#include "disk.h"
+#include "logging.h"
+#include "config/configuration.h"
+#include "config/const.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+// class CMappedDiskFile
+
+CMappedDiskFile::~CMappedDiskFile() {
+#ifndef WIN32
+    munmap((void *)pData, size);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class CDiskFileMapCache
+
+shared_ptr<const CMappedDiskFile> CDiskFileMapCache::Get(const CDiskBlockPos &pos, const char *prefix,
+                                                         uint64_t endPos) {
+    if (maxMappings == 0 || pos.IsNull())
+        return nullptr;
+    GetDiskFileWriter().WaitWritten();  // the records in flight are read through the mapping
+
+    lock_guard<std::mutex> lock(mutex);
+    ++useCounter;
+
+    auto it = find_if(entries.begin(), entries.end(),
+                      [&](const CEntry &entry) { return entry.nFile == pos.nFile && entry.prefix == prefix; });
+    if (it != entries.end()) {
+        if (it->pFile->GetSize() >= endPos) {
+            it->lastUse = useCounter;
+            return it->pFile;
+        }
+        // the file has grown since it was mapped
+        entries.erase(it);
+    }
+
+    auto pFile = MapFile(pos, prefix);
+    if (!pFile || pFile->GetSize() < endPos)
+        return nullptr;
+
+    if (entries.size() >= maxMappings) {
+        auto lruIt = min_element(entries.begin(), entries.end(),
+                                 [](const CEntry &a, const CEntry &b) { return a.lastUse < b.lastUse; });
+        entries.erase(lruIt);
+    }
+    entries.push_back({prefix, pos.nFile, useCounter, pFile});
+    return pFile;
+}
+
+void CDiskFileMapCache::Invalidate(int32_t nFile) {
+    lock_guard<std::mutex> lock(mutex);
+    entries.erase(remove_if(entries.begin(), entries.end(), [&](const CEntry &entry) { return entry.nFile == nFile; }),
+                  entries.end());
+}
+
+shared_ptr<const CMappedDiskFile> CDiskFileMapCache::MapFile(const CDiskBlockPos &pos, const char *prefix) {
+    return MapDiskFile(GetDataDir() / "blocks" / strprintf("%s%05u.dat", prefix, pos.nFile));
+}
+
+shared_ptr<const CMappedDiskFile> MapDiskFile(const boost::filesystem::path &path) {
+#ifdef WIN32
+    return nullptr;
+#else
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *pData = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping stays valid without the descriptor
+    if (pData == MAP_FAILED) {
+        LogPrint(BCLog::INFO, "%s : unable to map %s, errno=%d\n", __func__, path.string(), errno);
+        return nullptr;
+    }
+
+    return make_shared<const CMappedDiskFile>((const char *)pData, (uint64_t)st.st_size);
+#endif
+}
+
+CDiskFileMapCache &GetDiskFileMapCache() {
+    static CDiskFileMapCache cache(
+        (uint32_t)max<int64_t>(0, min<int64_t>(SysCfg().GetArg("-blockfilemaps", DEFAULT_BLOCK_FILE_MAPPINGS),
+                                               MAX_BLOCK_FILE_MAPPINGS)));
+    return cache;
+}
+
+unique_ptr<CMappedDataStream> OpenMappedDiskRecord(const CDiskBlockPos &pos, const char *prefix,
+                                                   uint32_t trailerSize) {
+    static const uint32_t HEADER_SIZE = MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.nPos < HEADER_SIZE)
+        return nullptr;
+
+    CDiskFileMapCache &cache = GetDiskFileMapCache();
+    auto pFile = cache.Get(pos, prefix, pos.nPos);
+    if (!pFile)
+        return nullptr;
+
+    const char *pHeader = pFile->GetData() + pos.nPos - HEADER_SIZE;
+    if (memcmp(pHeader, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return nullptr;
+
+    uint32_t nSize;
+    memcpy(&nSize, pHeader + MESSAGE_START_SIZE, sizeof(nSize));
+    nSize = le32toh(nSize);
+
+    uint64_t endPos = (uint64_t)pos.nPos + nSize + trailerSize;
+    if (endPos > pFile->GetSize()) {
+        pFile = cache.Get(pos, prefix, endPos);
+        if (!pFile)
+            return nullptr;
+    }
+
+    return unique_ptr<CMappedDataStream>(
+        new CMappedDataStream(pFile, pos.nPos, endPos, SER_DISK, CLIENT_VERSION));
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_DISKMAP_H
+#define PERSIST_DISKMAP_H
+
+#include "commons/serialize.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+struct CDiskBlockPos;
+
+/** Read-only memory mapping of a whole blk/rev file */
+class CMappedDiskFile {
+public:
+    CMappedDiskFile(const char *pDataIn, uint64_t sizeIn) : pData(pDataIn), size(sizeIn) {}
+    CMappedDiskFile(const CMappedDiskFile &) = delete;
+    CMappedDiskFile &operator=(const CMappedDiskFile &) = delete;
+    ~CMappedDiskFile();
+
+    const char *GetData() const { return pData; }
+    uint64_t GetSize() const { return size; }
+
+private:
+    const char *pData;
+    uint64_t size;
+};
+
+/**
+ * Stream subset deserializing straight from a memory range, bound to the mapping it reads so the
+ * range stays valid even if the cache drops the mapping meanwhile.
+ */
+class CMappedDataStream {
+public:
+    int nType;
+    int nVersion;
+
+    CMappedDataStream(std::shared_ptr<const CMappedDiskFile> pFileIn, uint64_t beginIn, uint64_t endIn, int nTypeIn,
+                      int nVersionIn)
+        : nType(nTypeIn), nVersion(nVersionIn), pFile(std::move(pFileIn)), pos(beginIn), end(endIn) {}
+
+    CMappedDataStream &read(char *pch, size_t nSize) {
+        if (nSize > end - pos)
+            throw std::ios_base::failure("CMappedDataStream::read : end of data");
+        memcpy(pch, pFile->GetData() + pos, nSize);
+        pos += nSize;
+        return (*this);
+    }
+
+    // the unread bytes of the record
+    const char *data() const { return pFile->GetData() + pos; }
+    size_t size() const { return end - pos; }
+
+    template <typename T>
+    CMappedDataStream &operator>>(T &obj) {
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+
+private:
+    std::shared_ptr<const CMappedDiskFile> pFile;
+    uint64_t pos;
+    uint64_t end;
+};
+
+/**
+ * Small LRU cache of the mappings of the blk/rev files, shared by the block and undo readers.
+ * A mapping that is too short for a read is replaced by a mapping of the current file size, the
+ * files only grow while the node appends to them. Every failure returns null and the callers fall
+ * back to reading the file with stdio.
+ */
+class CDiskFileMapCache {
+public:
+    explicit CDiskFileMapCache(uint32_t maxMappingsIn) : maxMappings(maxMappingsIn), useCounter(0) {}
+
+    // return a mapping of the file covering [0, endPos), or null
+    std::shared_ptr<const CMappedDiskFile> Get(const CDiskBlockPos &pos, const char *prefix, uint64_t endPos);
+
+    // drop the mappings of the blk and rev files of nFile, must be called before they are truncated
+    void Invalidate(int32_t nFile);
+
+private:
+    struct CEntry {
+        std::string prefix;
+        int32_t nFile;
+        uint64_t lastUse;
+        std::shared_ptr<const CMappedDiskFile> pFile;
+    };
+
+    static std::shared_ptr<const CMappedDiskFile> MapFile(const CDiskBlockPos &pos, const char *prefix);
+
+    std::mutex mutex;
+    uint32_t maxMappings;
+    uint64_t useCounter;
+    std::vector<CEntry> entries;
+};
+
+/** Map the whole file read-only, null if it is empty or can not be mapped */
+std::shared_ptr<const CMappedDiskFile> MapDiskFile(const boost::filesystem::path &path);
+
+/** The process wide mapping cache, sized by -blockfilemaps */
+CDiskFileMapCache &GetDiskFileMapCache();
+
+/**
+ * Open a stream over the record written at pos by WriteBlockToDisk or CBlockUndo::WriteToDisk,
+ * i.e. the nSize bytes following the message start and size header plus trailerSize bytes.
+ * Return null if the file can not be mapped or the header does not match.
+ */
+std::unique_ptr<CMappedDataStream> OpenMappedDiskRecord(const CDiskBlockPos &pos, const char *prefix,
+                                                        uint32_t trailerSize = 0);
+
+#endif  // PERSIST_DISKMAP_H
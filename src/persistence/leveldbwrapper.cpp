@@ -3,9 +3,14 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/coin-config.h"
+#endif
+
 #include "leveldbwrapper.h"
 
 #include "commons/util/util.h"
+#include "config/chainparams.h"
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -29,9 +34,9 @@ void ThrowError(const leveldb::Status &status) {
 
 std::string CDBOpLogMap::ToString() const {
     std::string str = "";
-    for (auto itemOpLogs : mapDbOpLogs) {
-        str += strprintf("type:%s {", itemOpLogs.first);
-        for (auto iterDbLog : itemOpLogs.second) {
+    for (const auto &itemOpLogs : mapDbOpLogs) {
+        str += strprintf("type:%s {", dbk::GetKeyPrefix(itemOpLogs.first));
+        for (const auto &iterDbLog : itemOpLogs.second) {
             str += iterDbLog.ToString();
             str += ";";
         }
@@ -40,57 +45,368 @@ std::string CDBOpLogMap::ToString() const {
     return str;
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize) {
+// the -<dbname>.cacheshare weight of the database over the sum of all, the DBCacheSize table by default
+static double GetDbCacheShare(DBNameType dbNameType) {
+    int64_t totalCacheSize = 0;
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++)
+        totalCacheSize += DBCacheSize[i];
+
+    double totalShare = 0;
+    double share      = 0;
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++) {
+        const string shareArg = "-" + GetDbName((DBNameType)i) + ".cacheshare";
+        double dbShare        = 100.0 * DBCacheSize[i] / totalCacheSize;
+        if (SysCfg().IsArgCount(shareArg))
+            dbShare = std::max<int64_t>(0, SysCfg().GetArg(shareArg, 0));
+
+        totalShare += dbShare;
+        if (i == dbNameType)
+            share = dbShare;
+    }
+    return totalShare > 0 ? share / totalShare : 0;
+}
+
+// the -<prefix>.<option> arguments of a database over the options given
+static void ApplyDbArgs(const string &argPrefix, CLevelDBOptions &dbOptions) {
+    int64_t writeBuffer = SysCfg().GetArg(argPrefix + "writebuffer", dbOptions.writeBufferSize >> 10);
+    if (writeBuffer > 0)
+        dbOptions.writeBufferSize = (size_t)writeBuffer << 10;
+
+    dbOptions.bloomBits    = std::max<int64_t>(0, std::min<int64_t>(MAX_DB_BLOOM_BITS,
+                                SysCfg().GetArg(argPrefix + "bloombits", dbOptions.bloomBits)));
+    dbOptions.maxOpenFiles = std::max<int64_t>(MIN_DB_MAX_OPEN_FILES,
+                                SysCfg().GetArg(argPrefix + "maxopenfiles", dbOptions.maxOpenFiles));
+    dbOptions.compression  = SysCfg().GetBoolArg(argPrefix + "compression", dbOptions.compression);
+    dbOptions.restartInterval = std::max<int64_t>(1, std::min<int64_t>(MAX_DB_RESTART_INTERVAL,
+                                SysCfg().GetArg(argPrefix + "restartinterval", dbOptions.restartInterval)));
+}
+
+CLevelDBOptions GetDbOptions(DBNameType dbNameType) {
+    assert(dbNameType >= 0 && dbNameType < DBNameType::DB_NAME_COUNT);
+    CLevelDBOptions dbOptions(DBCacheSize[dbNameType]);
+
+    // the default shares are the DBCacheSize table in percent, without -dbcache every database
+    // keeps the block cache of half its DBCacheSize
+    if (SysCfg().IsArgCount("-dbcache")) {
+        int64_t budget = std::max(MIN_DB_CACHE, std::min(MAX_DB_CACHE, SysCfg().GetArg("-dbcache", DEFAULT_DB_CACHE)));
+        dbOptions.blockCacheSize = (size_t)((budget << 20) * GetDbCacheShare(dbNameType));
+    }
+
+    // the data keys of a contract differ only after the contract regid, longer runs between the restart
+    // points store that prefix once for more keys, a lookup scans at most one run of a block
+    if (dbNameType == DBNameType::CONTRACT)
+        dbOptions.restartInterval = CONTRACT_DB_RESTART_INTERVAL;
+    // the traces are written once and read rarely, they compress well
+    if (dbNameType == DBNameType::TRACE)
+        dbOptions.compression = true;
+
+    ApplyDbArgs("-" + GetDbName(dbNameType) + ".", dbOptions);
+    return dbOptions;
+}
+
+CLevelDBOptions GetStateDbOptions() {
+    // the block cache and the memtable budgets of the dbs add up into the shared ones, the filters and
+    // the open files take the largest settings of them
+    CLevelDBOptions dbOptions(0);
+    dbOptions.bloomBits    = 0;
+    dbOptions.maxOpenFiles = 0;
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++) {
+        CLevelDBOptions options = GetDbOptions((DBNameType)i);
+        dbOptions.blockCacheSize += options.blockCacheSize;
+        dbOptions.writeBufferSize += options.writeBufferSize;
+        dbOptions.bloomBits    = std::max(dbOptions.bloomBits, options.bloomBits);
+        dbOptions.maxOpenFiles = std::max(dbOptions.maxOpenFiles, options.maxOpenFiles);
+        dbOptions.compression  = dbOptions.compression || options.compression;
+    }
+
+    ApplyDbArgs("-" + STATE_DB_NAME + ".", dbOptions);
+    return dbOptions;
+}
+
+uint64_t GetDbReadCacheSize(DBNameType dbNameType) {
+    assert(dbNameType >= 0 && dbNameType < DBNameType::DB_NAME_COUNT);
+    int64_t budget = std::max<int64_t>(0, std::min(MAX_DB_READ_CACHE, SysCfg().GetArg("-dbreadcache", DEFAULT_DB_READ_CACHE)));
+    return (uint64_t)((budget << 20) * GetDbCacheShare(dbNameType));
+}
+
+static leveldb::Options GetOptions(const CLevelDBOptions &dbOptions) {
     leveldb::Options options;
-    options.block_cache       = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4;  // up to two write buffers may be held in memory simultaneously
-    options.filter_policy     = leveldb::NewBloomFilterPolicy(10);
-    options.compression       = leveldb::kNoCompression;
-    options.max_open_files    = 64;
+    options.block_cache       = leveldb::NewLRUCache(dbOptions.blockCacheSize);
+    options.write_buffer_size = dbOptions.writeBufferSize;
+    options.filter_policy     = dbOptions.bloomBits > 0 ? leveldb::NewBloomFilterPolicy(dbOptions.bloomBits) : nullptr;
+    options.compression       = dbOptions.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files    = dbOptions.maxOpenFiles;
+    options.block_restart_interval = dbOptions.restartInterval;
     return options;
 }
 
-CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory, bool fWipe) {
-    penv                         = nullptr;
-    readoptions.verify_checksums = true;
-    iteroptions.verify_checksums = true;
-    iteroptions.fill_cache       = false;
-    syncoptions.sync             = true;
-    options                      = GetOptions(nCacheSize);
-    options.create_if_missing    = true;
-    if (fMemory) {
-        penv        = leveldb::NewMemEnv(leveldb::Env::Default());
-        options.env = penv;
+leveldb::Status CDBStorage::MultiGet(const vector<leveldb::Slice> &keys, vector<std::optional<string>> &values,
+                                     const leveldb::Snapshot *pSnapshot) {
+    values.assign(keys.size(), std::nullopt);
+    for (size_t i = 0; i < keys.size(); i++) {
+        string value;
+        leveldb::Status status = Get(keys[i], &value, pSnapshot);
+        if (status.ok())
+            values[i] = std::move(value);
+        else if (!status.IsNotFound())
+            return status;
+    }
+    return leveldb::Status::OK();
+}
+
+const string &GetDbBackend() {
+    static const string backend = SysCfg().GetArg("-dbbackend", DB_BACKEND_LEVELDB);
+    return backend;
+}
+
+bool IsDbBackendAvailable(const string &backend) {
+#ifdef USE_ROCKSDB
+    if (backend == DB_BACKEND_ROCKSDB)
+        return true;
+#endif
+    return backend == DB_BACKEND_LEVELDB;
+}
+
+namespace {
+
+class CLevelDBStorage : public CDBStorage {
+public:
+    CLevelDBStorage(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fMemory,
+                    bool fWipe) {
+        readoptions.verify_checksums = true;
+        iteroptions.verify_checksums = true;
+        iteroptions.fill_cache       = false;
+        syncoptions.sync             = true;
+        options                      = GetOptions(dbOptions);
+        options.create_if_missing    = true;
+        if (fMemory) {
+            penv        = leveldb::NewMemEnv(leveldb::Env::Default());
+            options.env = penv;
+        } else {
+            if (fWipe) {
+                LogPrint(BCLog::INFO, "Wiping LevelDB in %s\n", path.string());
+                leveldb::DestroyDB(path.string(), options);
+            }
+            TryCreateDirectory(path);
+            LogPrint(BCLog::INFO, "Opening LevelDB in %s (cache=%uKiB, write buffer=%uKiB, bloom bits=%d, "
+                     "max open files=%d, compression=%d, restart interval=%d)\n", path.string(),
+                     dbOptions.blockCacheSize >> 10, dbOptions.writeBufferSize >> 10, dbOptions.bloomBits,
+                     dbOptions.maxOpenFiles, dbOptions.compression, dbOptions.restartInterval);
+        }
+        leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
+        ThrowError(status);
+        LogPrint(BCLog::INFO, "Opened LevelDB successfully\n");
+    }
+
+    ~CLevelDBStorage() override {
+        delete pdb;
+        pdb = nullptr;
+        delete options.filter_policy;
+        options.filter_policy = nullptr;
+        delete options.block_cache;
+        options.block_cache = nullptr;
+        delete penv;
+        options.env = nullptr;
+    }
+
+    leveldb::Status Get(const leveldb::Slice &key, string *pValue, const leveldb::Snapshot *pSnapshot) override {
+        leveldb::ReadOptions snapshotOptions = readoptions;
+        snapshotOptions.snapshot             = pSnapshot;
+        return pdb->Get(snapshotOptions, key, pValue);
+    }
+
+    leveldb::Status Write(leveldb::WriteBatch *pBatch, bool fSync) override {
+        return pdb->Write(fSync ? syncoptions : writeoptions, pBatch);
+    }
+
+    leveldb::Iterator *NewIterator(const leveldb::Snapshot *pSnapshot) override {
+        leveldb::ReadOptions snapshotOptions = iteroptions;
+        snapshotOptions.snapshot             = pSnapshot;
+        return pdb->NewIterator(snapshotOptions);
+    }
+
+    leveldb::Iterator *NewFillCacheIterator() override {
+        leveldb::ReadOptions fillOptions = iteroptions;
+        fillOptions.fill_cache           = true;
+        return pdb->NewIterator(fillOptions);
+    }
+
+    const leveldb::Snapshot *GetSnapshot() override { return pdb->GetSnapshot(); }
+    void ReleaseSnapshot(const leveldb::Snapshot *pSnapshot) override { pdb->ReleaseSnapshot(pSnapshot); }
+
+private:
+    // custom environment this database is using (may be NULL in case of default environment)
+    leveldb::Env *penv = nullptr;
+
+    // database options used
+    leveldb::Options options;
+
+    // options used when reading from the database
+    leveldb::ReadOptions readoptions;
+
+    // options used when iterating over values of the database
+    leveldb::ReadOptions iteroptions;
+
+    // options used when writing to the database
+    leveldb::WriteOptions writeoptions;
+
+    // options used when sync writing to the database
+    leveldb::WriteOptions syncoptions;
+
+    // the database itself
+    leveldb::DB *pdb = nullptr;
+};
+
+}  // namespace
+
+CDBStorage *NewLevelDBStorage(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fMemory,
+                              bool fWipe) {
+    return new CLevelDBStorage(path, dbOptions, fMemory, fWipe);
+}
+
+#ifndef USE_ROCKSDB
+CDBStorage *NewRocksDBStorage(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fWipe) {
+    throw leveldb_error("RocksDB support not compiled in, rebuild with --with-rocksdb");
+}
+#endif
+
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory, bool fWipe)
+    : CLevelDBWrapper(path, CLevelDBOptions(nCacheSize), fMemory, fWipe) {}
+
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fMemory,
+                                 bool fWipe) {
+    pReadBytesMetric  = &metricDbReadBytes.Get(path.filename().string());
+    pWriteBytesMetric = &metricDbWriteBytes.Get(path.filename().string());
+
+    // the in-memory databases of the tests always use leveldb
+    if (fMemory || GetDbBackend() != DB_BACKEND_ROCKSDB) {
+        // a database of the other backend would look empty
+        if (!fMemory && !fWipe && !boost::filesystem::exists(path / "CURRENT") &&
+            boost::filesystem::exists(path.parent_path() / DB_BACKEND_ROCKSDB))
+            throw leveldb_error(strprintf("The database %s is in rocksdb, start with -dbbackend=rocksdb or "
+                                          "-reindex", path.filename().string()));
+        pStorage.reset(NewLevelDBStorage(path, dbOptions, fMemory, fWipe));
     } else {
-        if (fWipe) {
-            LogPrint(BCLog::INFO, "Wiping LevelDB in %s\n", path.string());
-            leveldb::DestroyDB(path.string(), options);
+        if (!fWipe && boost::filesystem::exists(path / "CURRENT"))
+            throw leveldb_error(strprintf("The database %s is in leveldb, start with -dbbackend=leveldb or "
+                                          "-reindex", path.filename().string()));
+        pStorage.reset(NewRocksDBStorage(path, dbOptions, fWipe));
+    }
+}
+
+CLevelDBWrapper::~CLevelDBWrapper() {}
+
+void CDBWriteMapIterator::SeekToFirst() {
+    pDbIt->SeekToFirst();
+    writeIt = pWrites->begin();
+    FindNext();
+}
+
+void CDBWriteMapIterator::SeekToLast() {
+    assert(false && "CDBWriteMapIterator only iterates forward");
+}
+
+void CDBWriteMapIterator::Seek(const leveldb::Slice &target) {
+    pDbIt->Seek(target);
+    writeIt = pWrites->lower_bound(target.ToString());
+    FindNext();
+}
+
+void CDBWriteMapIterator::Next() {
+    assert(Valid());
+    if (fFromWrites)
+        ++writeIt;
+    else
+        pDbIt->Next();
+    FindNext();
+}
+
+void CDBWriteMapIterator::Prev() {
+    assert(false && "CDBWriteMapIterator only iterates forward");
+}
+
+leveldb::Slice CDBWriteMapIterator::key() const {
+    return fFromWrites ? leveldb::Slice(writeIt->first) : pDbIt->key();
+}
+
+leveldb::Slice CDBWriteMapIterator::value() const {
+    return fFromWrites ? leveldb::Slice(*writeIt->second) : pDbIt->value();
+}
+
+void CDBWriteMapIterator::FindNext() {
+    while (true) {
+        fFromWrites = false;
+        if (writeIt == pWrites->end())
+            return;
+
+        // std::string and the default leveldb comparator both order by unsigned bytes
+        int32_t cmp = pDbIt->Valid() ? leveldb::Slice(writeIt->first).compare(pDbIt->key()) : -1;
+        if (cmp == 0) {
+            // the db entry is overwritten or erased
+            pDbIt->Next();
+        } else if (cmp > 0) {
+            return;
+        } else if (!writeIt->second) {
+            ++writeIt;
+        } else {
+            fFromWrites = true;
+            return;
         }
-        TryCreateDirectory(path);
-        LogPrint(BCLog::INFO, "Opening LevelDB in %s\n", path.string());
     }
-    leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
-    ThrowError(status);
-    LogPrint(BCLog::INFO, "Opened LevelDB successfully\n");
 }
 
-CLevelDBWrapper::~CLevelDBWrapper() {
-    delete pdb;
-    pdb = nullptr;
-    delete options.filter_policy;
-    options.filter_policy = nullptr;
-    delete options.block_cache;
-    options.block_cache = nullptr;
-    delete penv;
-    options.env = nullptr;
+void CLevelDBWrapper::MultiReadRaw(const vector<string> &keys, vector<std::optional<string>> &values,
+                                   const leveldb::Snapshot *pSnapshot) {
+    vector<leveldb::Slice> slKeys(keys.begin(), keys.end());
+    leveldb::Status status = pStorage->MultiGet(slKeys, values, pSnapshot);
+    if (!status.ok()) {
+        LogPrint(BCLog::INFO, "LevelDB read failure: %s\n", status.ToString());
+        ThrowError(status);
+    }
+    for (const auto &value : values) {
+        if (value)
+            pReadBytesMetric->Inc(value->size());
+    }
 }
 
 bool CLevelDBWrapper::WriteBatch(CLevelDBBatch &batch, bool fSync) {
-    leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    leveldb::Status status = pStorage->Write(&batch.batch, fSync);
     ThrowError(status);
+    pWriteBytesMetric->Inc(batch.nBytes);
     return true;
 }
 
+static void ReleaseDbSnapshot(void *pStorage, void *pSnapshot) {
+    ((CDBStorage *)pStorage)->ReleaseSnapshot((const leveldb::Snapshot *)pSnapshot);
+}
+
+leveldb::Iterator *CLevelDBWrapper::NewSnapshotIterator() {
+    const leveldb::Snapshot *pSnapshot = pStorage->GetSnapshot();
+    leveldb::Iterator *pIt             = pStorage->NewIterator(pSnapshot);
+    pIt->RegisterCleanup(ReleaseDbSnapshot, pStorage.get(), (void *)pSnapshot);
+    return pIt;
+}
+
+std::shared_ptr<const leveldb::Snapshot> CLevelDBWrapper::GetSnapshot() {
+    CDBStorage *pDbStorage = pStorage.get();
+    return std::shared_ptr<const leveldb::Snapshot>(pStorage->GetSnapshot(),
+                                                    [pDbStorage](const leveldb::Snapshot *pSnapshot) {
+        pDbStorage->ReleaseSnapshot(pSnapshot);
+    });
+}
+
+uint64_t CLevelDBWrapper::WarmupPrefix(const string &prefix, uint64_t maxBytes, const std::atomic<bool> &fStop) {
+    std::unique_ptr<leveldb::Iterator> pCursor(pStorage->NewFillCacheIterator());
+    uint64_t bytes = 0;
+    for (pCursor->Seek(prefix); pCursor->Valid() && bytes < maxBytes && !fStop; pCursor->Next()) {
+        leveldb::Slice key = pCursor->key();
+        if (!key.starts_with(prefix))
+            break;
+        bytes += key.size() + pCursor->value().size();
+    }
+    return bytes;
+}
+
 int64_t CLevelDBWrapper::GetDbCount() {
     leveldb::Iterator *pCursor = NewIterator();
     int64_t ret                = 0;
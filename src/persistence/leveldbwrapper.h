@@ -9,15 +9,62 @@
 #include "commons/json/json_spirit_value.h"
 #include "commons/serialize.h"
 #include "commons/util/util.h"
+#include "config/const.h"
 #include "config/version.h"
 #include "dbconf.h"
+#include "dbstorage.h"
+#include "metrics.h"
 
 #include <boost/filesystem/path.hpp>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <map>
+#include <memory>
+#include <optional>
+
 using namespace json_spirit;
 
+/**
+ * A SER_DISK stream for the db values on the buffer of the calling thread, which is kept between the
+ * uses so that the reads and writes of the values don't allocate. A nested use gets its own stream.
+ */
+class CDBStreamScope {
+public:
+    static const size_t MAX_KEPT_BUFFER_SIZE = 1024 * 1024;  // the larger ones are released after use
+
+    CDBStreamScope() {
+        if (tInUse) {
+            localStream.emplace(SER_DISK, CLIENT_VERSION);
+            pStream = &*localStream;
+            return;
+        }
+        tInUse  = true;
+        pStream = &tStream;
+        pStream->clear();
+        pStream->Init(SER_DISK, CLIENT_VERSION);
+    }
+
+    ~CDBStreamScope() {
+        if (pStream != &tStream)
+            return;
+        if (tStream.capacity() > MAX_KEPT_BUFFER_SIZE) {
+            CSerializeData empty;
+            tStream.swap(empty);
+        }
+        tInUse = false;
+    }
+
+    CDataStream &Get() { return *pStream; }
+
+private:
+    CDataStream *pStream;
+    std::optional<CDataStream> localStream;
+
+    inline static thread_local CDataStream tStream{SER_DISK, CLIENT_VERSION};
+    inline static thread_local bool tInUse = false;
+};
+
 class CDbOpLog {
 private:
     string key;
@@ -28,22 +75,32 @@ public:
     // for key-value
     template<typename K, typename V>
     void Set(const K& keyIn, const V& valueIn){
-
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey << keyIn;
-        key = ssKey.str();
-
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue << valueIn;
-        value = ssValue.str();
+        if constexpr (CFixedSerializeSize<K>::value > 0) {
+            key.clear();
+            key.reserve(CFixedSerializeSize<K>::value);
+            CStringWriter(key, SER_DISK, CLIENT_VERSION) << keyIn;
+        } else {
+            CDBStreamScope streamScope;
+            CDataStream &ssKey = streamScope.Get();
+            ssKey << keyIn;
+            key.assign(ssKey.begin(), ssKey.end());
+        }
+        Set(valueIn);
     }
 
     // for single value
     template<typename V>
     void Set(const V& valueIn){
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        CDBStreamScope streamScope;
+        CDataStream &ssValue = streamScope.Get();
         ssValue << valueIn;
-        value = ssValue.str();
+        value.assign(ssValue.begin(), ssValue.end());
+    }
+
+    // the key and value serialized already, e.g. read from an undo record
+    void SetRaw(string &&keyIn, string &&valueIn) {
+        key   = std::move(keyIn);
+        value = std::move(valueIn);
     }
 
     // for key-value
@@ -86,33 +143,45 @@ typedef vector<CDbOpLog> CDbOpLogs;
 
 class CDBOpLogMap {
 public:
-    map<string, CDbOpLogs>& GetMap() { return mapDbOpLogs; }
+    typedef map<dbk::PrefixType, CDbOpLogs> MapType;
+
+    MapType& GetMap() { return mapDbOpLogs; }
+    const MapType& GetMap() const { return mapDbOpLogs; }
 
     const CDbOpLogs* GetDbOpLogsPtr(dbk::PrefixType prefixType) const {
         assert(prefixType != dbk::EMPTY);
-        const string& prefix = dbk::GetKeyPrefix(prefixType);
-        auto it = mapDbOpLogs.find(prefix);
+        auto it = mapDbOpLogs.find(prefixType);
         if (it != mapDbOpLogs.end()) {
             return &it->second;
         }
         return nullptr;
     }
 
-    void AddOpLog(dbk::PrefixType prefixType, const CDbOpLog& dbOpLogIn) {
+    void AddOpLog(dbk::PrefixType prefixType, CDbOpLog &&dbOpLogIn) {
         assert(prefixType != dbk::EMPTY);
-        const string& prefix = dbk::GetKeyPrefix(prefixType);
-        mapDbOpLogs[prefix].push_back(dbOpLogIn);
+        mapDbOpLogs[prefixType].push_back(std::move(dbOpLogIn));
     }
 
     void Clear() { mapDbOpLogs.clear(); }
 
     std::string ToString() const;
-public:
-    IMPLEMENT_SERIALIZE(
-        READWRITE(mapDbOpLogs);
-	)
+
+    // the format of the undo records before the compact one, the logs under their prefix strings
+    template<typename Stream>
+    void UnserializeLegacy(Stream &s, int nType, int nVersion) {
+        map<string, CDbOpLogs> legacyMap;
+        ::Unserialize(s, legacyMap, nType, nVersion);
+        mapDbOpLogs.clear();
+        for (auto &item : legacyMap) {
+            dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(item.first);
+            if (prefixType == dbk::EMPTY)
+                throw ios_base::failure("CDBOpLogMap::UnserializeLegacy : unknown prefix " + item.first);
+            mapDbOpLogs[prefixType] = std::move(item.second);
+        }
+    }
+
 private:
-    mutable map<string, CDbOpLogs> mapDbOpLogs; // dbName -> dbOpLogs
+    MapType mapDbOpLogs; // prefixType -> dbOpLogs
 };
 
 class leveldb_error : public runtime_error
@@ -129,65 +198,131 @@ class CLevelDBBatch {
 
 private:
     leveldb::WriteBatch batch;
+    size_t nBytes = 0;  // the keys and values put
 
 public:
     template<typename V>
     void Write(const std::string &key, const V& value) {
     	leveldb::Slice slKey(key);
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue.reserve(ssValue.GetSerializeSize(value));
+        CDBStreamScope streamScope;
+        CDataStream &ssValue = streamScope.Get();
         ssValue << value;
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
         batch.Put(slKey, slValue);
+        nBytes += key.size() + ssValue.size();
     }
 
     void Erase(const std::string &key) {
         batch.Delete(key);
+        nBytes += key.size();
+    }
+
+    // write a value which is serialized already
+    void WriteRaw(const std::string &key, const std::string &value) {
+        batch.Put(key, value);
+        nBytes += key.size() + value.size();
     }
 
  };
 
-class CLevelDBWrapper {
-private:
-    // custom environment this database is using (may be NULL in case of default environment)
-    leveldb::Env *penv;
+/** Writes to a db not persisted yet: full key -> serialized value, or nullopt for an erase */
+typedef std::map<std::string, std::optional<std::string>> CDBWriteMap;
 
-    // database options used
-    leveldb::Options options;
+/**
+ * Iterator over a db with the writes of a CDBWriteMap applied on top of it. Only forward
+ * iteration is supported, which is all the db iterators of the caches use.
+ */
+class CDBWriteMapIterator : public leveldb::Iterator {
+public:
+    CDBWriteMapIterator(leveldb::Iterator *pDbItIn, std::shared_ptr<const CDBWriteMap> pWritesIn)
+        : pDbIt(pDbItIn), pWrites(pWritesIn), writeIt(pWritesIn->end()), fFromWrites(false) {}
+
+    bool Valid() const override { return fFromWrites || pDbIt->Valid(); }
+    void SeekToFirst() override;
+    void SeekToLast() override;
+    void Seek(const leveldb::Slice &target) override;
+    void Next() override;
+    void Prev() override;
+    leveldb::Slice key() const override;
+    leveldb::Slice value() const override;
+    leveldb::Status status() const override { return pDbIt->status(); }
 
-    // options used when reading from the database
-    leveldb::ReadOptions readoptions;
+private:
+    // move to the first visible entry at or after the current positions
+    void FindNext();
+
+    std::unique_ptr<leveldb::Iterator> pDbIt;
+    std::shared_ptr<const CDBWriteMap> pWrites;
+    CDBWriteMap::const_iterator writeIt;
+    bool fFromWrites;  // the current entry comes from writeIt, else from pDbIt
+};
 
-    // options used when iterating over values of the database
-    leveldb::ReadOptions iteroptions;
+/** LevelDB tuning of one database */
+struct CLevelDBOptions {
+    size_t blockCacheSize;   // bytes of the LRU block cache
+    size_t writeBufferSize;  // bytes of one memtable, up to two may be held in memory simultaneously
+    int32_t bloomBits;       // bloom filter bits per key, 0 for no filter
+    int32_t maxOpenFiles;
+    bool compression;         // snappy compression, ignored when leveldb is built without snappy
+    int32_t restartInterval;  // keys between the restart points of the blocks, which store the whole key
+
+    explicit CLevelDBOptions(size_t nCacheSize)
+        : blockCacheSize(nCacheSize / 2),
+          writeBufferSize(nCacheSize / 4),
+          bloomBits(DEFAULT_DB_BLOOM_BITS),
+          maxOpenFiles(DEFAULT_DB_MAX_OPEN_FILES),
+          compression(false),
+          restartInterval(DEFAULT_DB_RESTART_INTERVAL) {}
+};
 
-    // options used when writing to the database
-    leveldb::WriteOptions writeoptions;
+/**
+ * Options of the database dbNameType. -dbcache is the block cache budget of all databases, split by
+ * the -<dbname>.cacheshare weights, the other options are read from -<dbname>.<option>, which can
+ * be written as a [<dbname>] section of the config file.
+ */
+CLevelDBOptions GetDbOptions(DBNameType dbNameType);
+/**
+ * Options of the db of -singlestatedb holding all the others, the sums of their cache budgets and the
+ * largest of their other options, each of which -state.<option> overrides.
+ */
+CLevelDBOptions GetStateDbOptions();
+
+/** Bytes of the clean values kept by the top-level caches of the database, -dbreadcache split by the same weights */
+uint64_t GetDbReadCacheSize(DBNameType dbNameType);
 
-    // options used when sync writing to the database
-    leveldb::WriteOptions syncoptions;
+class CLevelDBWrapper {
+private:
+    // the database itself, in the engine of -dbbackend
+    std::unique_ptr<CDBStorage> pStorage;
 
-    // the database itself
-    leveldb::DB *pdb;
+    // the bytes read and written, labelled by the directory name of the database
+    CMetricCounter *pReadBytesMetric;
+    CMetricCounter *pWriteBytesMetric;
 
 public:
     CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CLevelDBWrapper(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fMemory = false,
+                    bool fWipe = false);
     ~CLevelDBWrapper();
 
+    // reads the db as it was when the snapshot was taken if one is given
     template<typename V>
-    bool Read(std::string key, V &value) {
+    bool Read(std::string key, V &value, const leveldb::Snapshot *pSnapshot = nullptr) {
     	leveldb::Slice slKey(key);
 
         string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pStorage->Get(slKey, &strValue, pSnapshot);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrint(BCLog::INFO,"LevelDB read failure: %s\n", status.ToString().c_str());
             ThrowError(status);
         }
+        pReadBytesMetric->Inc(strValue.size());
         try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            CDBStreamScope streamScope;
+            CDataStream &ssValue = streamScope.Get();
+            ssValue.write(strValue.data(), strValue.size());
             ssValue >> value;
         } catch(std::exception &e) {
             return false;
@@ -202,16 +337,17 @@ public:
         return WriteBatch(batch, fSync);
     }
 
-    bool Exists(const std::string &key) {
+    bool Exists(const std::string &key, const leveldb::Snapshot *pSnapshot = nullptr) {
     	leveldb::Slice slKey(key);
         string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pStorage->Get(slKey, &strValue, pSnapshot);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrint(BCLog::INFO,"LevelDB read failure: %s\n", status.ToString().c_str());
             ThrowError(status);
         }
+        pReadBytesMetric->Inc(strValue.size());
         return true;
     }
 
@@ -221,6 +357,10 @@ public:
         return WriteBatch(batch, fSync);
     }
 
+    // the serialized values of the keys in one call to the storage, nullopt for the missing ones
+    void MultiReadRaw(const std::vector<std::string> &keys, std::vector<std::optional<std::string>> &values,
+                      const leveldb::Snapshot *pSnapshot = nullptr);
+
     bool WriteBatch(CLevelDBBatch &batch, bool fSync = false);
 
     // not available for LevelDB; provide for compatibility with BDB
@@ -235,8 +375,19 @@ public:
 
     // not exactly clean encapsulation, but it's easiest for now
     leveldb::Iterator *NewIterator() {
-        return pdb->NewIterator(iteroptions);
+        return pStorage->NewIterator(nullptr);
+    }
+    // iterator over a snapshot of the database taken now, the snapshot is released with the iterator
+    leveldb::Iterator *NewSnapshotIterator();
+    // iterator over the given snapshot, which must outlive the iterator
+    leveldb::Iterator *NewIterator(const leveldb::Snapshot *pSnapshot) {
+        return pStorage->NewIterator(pSnapshot);
     }
+    // snapshot of the database taken now, released when the last reference is dropped
+    std::shared_ptr<const leveldb::Snapshot> GetSnapshot();
+    // read the keys of the prefix into the block cache until maxBytes are read or fStop is set, return
+    // the bytes read
+    uint64_t WarmupPrefix(const std::string &prefix, uint64_t maxBytes, const std::atomic<bool> &fStop);
     int64_t GetDbCount();
    // Object ToJsonObj();
 };
@@ -33,4 +33,25 @@ bool CLogDBCache::GetExecuteFail(const int32_t blockHeight, vector<std::tuple<ui
     return true;
 }
 
+int32_t CLogDBCache::GetRetention() {
+    static const int32_t retention =
+        max<int64_t>(0, SysCfg().GetArg("-logfailuresretention", DEFAULT_LOG_FAILURES_RETENTION));
+    return retention;
+}
+
+void CLogDBCache::OnBlockConnected(int32_t height) {
+    int32_t retention = GetRetention();
+    // the failures of the mempool are logged at the height of the tip, the current one is still open
+    int32_t pruneHeight = height - retention;
+    if (!SysCfg().IsLogFailures() || retention <= 0 || pruneHeight < 0)
+        return;
+
+    map<string, std::pair<uint8_t, string> > elements;
+    if (!executeFailCache.GetAllElements(std::to_string(pruneHeight) + "_", elements))
+        return;
+
+    for (const auto &item : elements)
+        executeFailCache.EraseData(item.first);
+}
+
 void CLogDBCache::Flush() { executeFailCache.Flush(); }
@@ -19,7 +19,6 @@
 
 using namespace std;
 
-// TODO: should erase history log?
 class CLogDBCache {
 public:
     CLogDBCache() {}
@@ -30,6 +29,12 @@ public:
                         const string &errorMessage);
     bool GetExecuteFail(const int32_t blockHeight, vector<std::tuple<uint256, uint8_t, string> > &result);
 
+    // The blocks of failures kept by -logfailuresretention, 0 for all
+    static int32_t GetRetention();
+    // Called on the top level cache once the block of the height is connected, erase the failures of the
+    // height falling out of the retention window
+    void OnBlockConnected(int32_t height);
+
     void Flush();
 
     uint32_t GetCacheSize() const { return executeFailCache.GetCacheSize(); }
@@ -41,6 +46,10 @@ public:
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         executeFailCache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        executeFailCache.RegisterReadFunc(readDataFuncMap);
+    }
 public:
 /*  CCompositeKVCache    prefixType             key                 value                        variable      */
 /*  -------------------- --------------------- ------------------  ---------------------------  -------------- */
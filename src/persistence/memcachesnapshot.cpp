@@ -0,0 +1,130 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "memcachesnapshot.h"
+
+#include "main.h"
+#include "logging.h"
+#include "persistence/pricefeeddb.h"
+#include "persistence/txdb.h"
+
+#include <boost/filesystem.hpp>
+
+#include <openssl/rand.h>
+
+using namespace std;
+
+CMemCacheSnapshot::CMemCacheSnapshot() { pathSnapshot = GetDataDir() / "memcache.dat"; }
+
+bool CMemCacheSnapshot::Write(const CBlockIndex *pTip, uint32_t txCacheHeight, uint32_t priceCacheHeight,
+                              const CTxMemCache &txCache, const CPricePointMemCache &ppCache) {
+    if (pTip == nullptr)
+        return false;
+
+    return Write(pTip->GetBlockHash(), txCacheHeight, priceCacheHeight, txCache, ppCache);
+}
+
+bool CMemCacheSnapshot::Write(const uint256 &tipHash, uint32_t txCacheHeight, uint32_t priceCacheHeight,
+                              const CTxMemCache &txCache, const CPricePointMemCache &ppCache) {
+    // Generate random temporary filename
+    uint16_t randv = 0;
+    RAND_bytes((uint8_t *)&randv, sizeof(randv));
+    string tmpfn = strprintf("memcache.dat.%04x", randv);
+
+    // serialize the caches, checksum data up to that point, then append csum
+    CDataStream ssCache(SER_DISK, CLIENT_VERSION);
+    ssCache << FLATDATA(SysCfg().MessageStart());
+    ssCache << CURRENT_VERSION << tipHash << txCacheHeight << priceCacheHeight;
+    ssCache << txCache.GetBlocks() << ppCache;
+    uint256 hash = Hash(ssCache.begin(), ssCache.end());
+    ssCache << hash;
+
+    // open temp output file, and associate with CAutoFile
+    boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+    FILE *file                      = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout               = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    // Write and commit header, data
+    try {
+        fileout << ssCache;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout);
+    fileout.fclose();
+
+    // replace existing memcache.dat, if any, with new memcache.dat.XXXX
+    if (!RenameOver(pathTmp, pathSnapshot))
+        return ERRORMSG("%s : Rename-into-place failed", __func__);
+
+    return true;
+}
+
+bool CMemCacheSnapshot::Read(const CBlockIndex *pTip, uint32_t txCacheHeight, uint32_t priceCacheHeight,
+                             CTxMemCache &txCache, CPricePointMemCache &ppCache) {
+    if (pTip == nullptr || !boost::filesystem::exists(pathSnapshot))
+        return false;
+
+    // open input file, and associate with CAutoFile
+    FILE *file       = fopen(pathSnapshot.string().c_str(), "rb");
+    CAutoFile filein = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathSnapshot.string());
+
+    // use file size to size memory buffer
+    int64_t dataSize = (int64_t)boost::filesystem::file_size(pathSnapshot) - sizeof(uint256);
+    if (dataSize < 0)
+        dataSize = 0;
+    vector<uint8_t> vchData(dataSize);
+    uint256 hashIn;
+
+    // read data and checksum from file
+    try {
+        filein.read((char *)vchData.data(), dataSize);
+        filein >> hashIn;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssCache(vchData, SER_DISK, CLIENT_VERSION);
+
+    // verify stored checksum matches input data
+    if (hashIn != Hash(ssCache.begin(), ssCache.end()))
+        return ERRORMSG("%s : Checksum mismatch, data corrupted", __func__);
+
+    uint8_t pchMsgTmp[4];
+    int32_t version;
+    uint256 tipHash;
+    uint32_t txCacheHeightIn;
+    uint32_t priceCacheHeightIn;
+    map<int32_t, CBlockTxids> txBlocks;
+    CPricePointMemCache ppCacheIn;
+    try {
+        ssCache >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, SysCfg().MessageStart(), sizeof(pchMsgTmp)))
+            return ERRORMSG("%s : Invalid network magic number", __func__);
+
+        ssCache >> version >> tipHash >> txCacheHeightIn >> priceCacheHeightIn;
+        if (version != CURRENT_VERSION) {
+            LogPrint(BCLog::INFO, "%s : Ignore snapshot of version %d\n", __func__, version);
+            return false;
+        }
+        if (tipHash != pTip->GetBlockHash() || txCacheHeightIn != txCacheHeight ||
+            priceCacheHeightIn != priceCacheHeight) {
+            LogPrint(BCLog::INFO, "%s : Ignore stale snapshot taken at tip %s\n", __func__, tipHash.GetHex());
+            return false;
+        }
+
+        ssCache >> txBlocks >> ppCacheIn;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    txCache.SetBlocks(std::move(txBlocks));
+    ppCache = std::move(ppCacheIn);
+    return true;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_MEMCACHESNAPSHOT_H
+#define PERSIST_MEMCACHESNAPSHOT_H
+
+#include <stdint.h>
+
+#include <boost/filesystem/path.hpp>
+
+#include "commons/uint256.h"
+
+class CBlockIndex;
+class CTxMemCache;
+class CPricePointMemCache;
+
+/**
+ * Snapshot of the memory caches rebuilt from the latest blocks at startup (memcache.dat).
+ * It is written on a graceful shutdown and only loaded if it was taken at the current tip with
+ * the same cache heights, any other file is ignored and the caches are replayed from the blocks.
+ */
+class CMemCacheSnapshot {
+public:
+    static const int32_t CURRENT_VERSION = 2;
+
+    CMemCacheSnapshot();
+
+    bool Write(const CBlockIndex *pTip, uint32_t txCacheHeight, uint32_t priceCacheHeight,
+               const CTxMemCache &txCache, const CPricePointMemCache &ppCache);
+    // the caches at the block of the hash, e.g. the finalized block of a state dump, which is the tip next
+    bool Write(const uint256 &tipHash, uint32_t txCacheHeight, uint32_t priceCacheHeight,
+               const CTxMemCache &txCache, const CPricePointMemCache &ppCache);
+
+    // return false if the file is missing, corrupted or stale; the caches are untouched then
+    bool Read(const CBlockIndex *pTip, uint32_t txCacheHeight, uint32_t priceCacheHeight, CTxMemCache &txCache,
+              CPricePointMemCache &ppCache);
+
+private:
+    boost::filesystem::path pathSnapshot;
+};
+
+#endif  // PERSIST_MEMCACHESNAPSHOT_H
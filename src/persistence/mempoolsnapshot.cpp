@@ -0,0 +1,171 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "mempoolsnapshot.h"
+
+#include "main.h"
+#include "init.h"
+#include "logging.h"
+#include "tx/txmempool.h"
+#include "tx/txserializer.h"
+
+#include <atomic>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include <openssl/rand.h>
+
+using namespace std;
+
+static std::atomic<bool> fMemPoolLoaded(false);
+
+CMemPoolSnapshot::CMemPoolSnapshot() { pathSnapshot = GetDataDir() / "mempool.dat"; }
+
+bool CMemPoolSnapshot::IsLoaded() { return fMemPoolLoaded; }
+
+bool CMemPoolSnapshot::Write(CTxMemPool &pool) {
+    int64_t beginTime = GetTimeMillis();
+    vector<CTxMemPoolEntry> entries;
+    pool.GetEntries(entries);
+
+    // Generate random temporary filename
+    uint16_t randv = 0;
+    RAND_bytes((uint8_t *)&randv, sizeof(randv));
+    string tmpfn = strprintf("mempool.dat.%04x", randv);
+
+    // serialize the txs, checksum data up to that point, then append csum
+    CDataStream ssPool(SER_DISK, CLIENT_VERSION);
+    ssPool << FLATDATA(SysCfg().MessageStart());
+    ssPool << CURRENT_VERSION << (uint32_t)entries.size();
+    for (const auto &entry : entries) {
+        ssPool << entry.GetTime();
+        CBaseTx::SerializePtr(ssPool, entry.GetTransaction(), SER_DISK, CLIENT_VERSION);
+    }
+    uint256 hash = Hash(ssPool.begin(), ssPool.end());
+    ssPool << hash;
+
+    // open temp output file, and associate with CAutoFile
+    boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+    FILE *file                      = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout               = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    // Write and commit header, data
+    try {
+        fileout << ssPool;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout);
+    fileout.fclose();
+
+    // replace existing mempool.dat, if any, with new mempool.dat.XXXX
+    if (!RenameOver(pathTmp, pathSnapshot))
+        return ERRORMSG("%s : Rename-into-place failed", __func__);
+
+    LogPrint(BCLog::INFO, "%s : wrote %u txs of the mempool (%dms)\n", __func__, entries.size(),
+             GetTimeMillis() - beginTime);
+    return true;
+}
+
+bool CMemPoolSnapshot::Read(TxList &txs) {
+    if (!boost::filesystem::exists(pathSnapshot))
+        return false;
+
+    // open input file, and associate with CAutoFile
+    FILE *file       = fopen(pathSnapshot.string().c_str(), "rb");
+    CAutoFile filein = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathSnapshot.string());
+
+    // use file size to size memory buffer
+    int64_t dataSize = (int64_t)boost::filesystem::file_size(pathSnapshot) - sizeof(uint256);
+    if (dataSize < 0)
+        dataSize = 0;
+    vector<uint8_t> vchData(dataSize);
+    uint256 hashIn;
+
+    // read data and checksum from file
+    try {
+        filein.read((char *)vchData.data(), dataSize);
+        filein >> hashIn;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssPool(vchData, SER_DISK, CLIENT_VERSION);
+
+    // verify stored checksum matches input data
+    if (hashIn != Hash(ssPool.begin(), ssPool.end()))
+        return ERRORMSG("%s : Checksum mismatch, data corrupted", __func__);
+
+    uint8_t pchMsgTmp[4];
+    int32_t version;
+    uint32_t count;
+    try {
+        ssPool >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, SysCfg().MessageStart(), sizeof(pchMsgTmp)))
+            return ERRORMSG("%s : Invalid network magic number", __func__);
+
+        ssPool >> version;
+        if (version != CURRENT_VERSION) {
+            LogPrint(BCLog::INFO, "%s : Ignore mempool of version %d\n", __func__, version);
+            return false;
+        }
+
+        ssPool >> count;
+        txs.clear();
+        txs.reserve(min<uint32_t>(count, ssPool.size()));
+        for (uint32_t i = 0; i < count; i++) {
+            int64_t time;
+            std::shared_ptr<CBaseTx> pBaseTx;
+            ssPool >> time;
+            CBaseTx::UnserializePtr(ssPool, pBaseTx, SER_DISK, CLIENT_VERSION);
+            txs.emplace_back(std::move(pBaseTx), time);
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+void ThreadLoadMemPool() {
+    RenameThread("coin-loadmempool");
+
+    int64_t beginTime = GetTimeMillis();
+    CMemPoolSnapshot::TxList txs;
+    if (!CMemPoolSnapshot().Read(txs)) {
+        fMemPoolLoaded = true;
+        return;
+    }
+
+    // the expired txs would be dropped by the next rescan
+    int64_t expiryTime     = GetTime() - mempool.GetExpiry();
+    uint32_t acceptedCount = 0;
+    uint32_t expiredCount  = 0;
+    for (size_t begin = 0; begin < txs.size(); begin += MEMPOOL_LOAD_BATCH_SIZE) {
+        // the blocks are connected between the batches
+        boost::this_thread::interruption_point();
+
+        LOCK(cs_main);
+        size_t end = min<size_t>(begin + MEMPOOL_LOAD_BATCH_SIZE, txs.size());
+        for (size_t i = begin; i < end; i++) {
+            if (txs[i].second < expiryTime) {
+                ++expiredCount;
+                continue;
+            }
+
+            CValidationState state;
+            if (AcceptToMemoryPool(mempool, state, txs[i].first.get(), false, false, txs[i].second))
+                ++acceptedCount;
+        }
+    }
+    fMemPoolLoaded = true;
+
+    LogPrint(BCLog::INFO, "%s : accepted %u of the %u txs of mempool.dat, %u expired (%dms)\n", __func__,
+             acceptedCount, txs.size(), expiredCount, GetTimeMillis() - beginTime);
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_MEMPOOLSNAPSHOT_H
+#define PERSIST_MEMPOOLSNAPSHOT_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+class CBaseTx;
+class CTxMemPool;
+
+// the loaded txs admitted under one hold of cs_main
+static const uint32_t MEMPOOL_LOAD_BATCH_SIZE = 200;
+
+/**
+ * The txs of the mempool kept across a restart (mempool.dat). They are written on a graceful shutdown in the
+ * order they were executed, so the txs of a sender keep their order, with the time they entered the pool for
+ * the expiry. At startup the txs are admitted again by AcceptToMemoryPool in the background.
+ */
+class CMemPoolSnapshot {
+public:
+    static const int32_t CURRENT_VERSION = 1;
+
+    typedef std::vector<std::pair<std::shared_ptr<CBaseTx>, int64_t>> TxList;  // tx, time entering the pool
+
+    CMemPoolSnapshot();
+
+    bool Write(CTxMemPool &pool);
+    // return false if the file is missing or corrupted
+    bool Read(TxList &txs);
+
+    // mempool.dat is written only once it was loaded, the txs not admitted yet would be lost otherwise
+    static bool IsLoaded();
+
+private:
+    boost::filesystem::path pathSnapshot;
+};
+
+// admit the txs of mempool.dat into the mempool
+void ThreadLoadMemPool();
+
+#endif  // PERSIST_MEMPOOLSNAPSHOT_H
@@ -19,15 +19,16 @@ void CConsecutiveBlockPrice::DeleteUserPrice(const int32_t blockHeight) {
 }
 
 bool CConsecutiveBlockPrice::ExistBlockUserPrice(const int32_t blockHeight, const CRegID &regId) {
-    if (mapBlockUserPrices.count(blockHeight) == 0)
+    auto it = mapBlockUserPrices.find(blockHeight);
+    if (it == mapBlockUserPrices.end())
         return false;
 
-    return mapBlockUserPrices[blockHeight].count(regId);
+    return it->second.count(regId);
 }
 
 bool CPricePointMemCache::AddPrice(const int32_t blockHeight, const CRegID &regId,
                                                     const vector<CPricePoint> &pps) {
-    for (CPricePoint pp : pps) {
+    for (const CPricePoint &pp : pps) {
         if (ExistBlockUserPrice(blockHeight, regId, pp.GetCoinPricePair())) {
             LogPrint(BCLog::PRICEFEED,
                      "CPricePointMemCache::AddPrice, existed block user price, "
@@ -49,8 +50,8 @@ bool CPricePointMemCache::AddPrice(const int32_t blockHeight, const CRegID &regI
 
 bool CPricePointMemCache::ExistBlockUserPrice(const int32_t blockHeight, const CRegID &regId,
                                               const CoinPricePair &coinPricePair) {
-    if (mapCoinPricePointCache.count(coinPricePair) &&
-        mapCoinPricePointCache[coinPricePair].ExistBlockUserPrice(blockHeight, regId))
+    auto it = mapCoinPricePointCache.find(coinPricePair);
+    if (it != mapCoinPricePointCache.end() && it->second.ExistBlockUserPrice(blockHeight, regId))
         return true;
 
     if (pBase)
@@ -127,80 +128,35 @@ void CPricePointMemCache::Flush() {
     mapCoinPricePointCache.clear();
 }
 
-bool CPricePointMemCache::GetBlockUserPrices(const CoinPricePair &coinPricePair, set<int32_t> &expired,
-                                             BlockUserPriceMap &blockUserPrices) {
+const map<CRegID, uint64_t> *CPricePointMemCache::FindBlockUserPrices(const CoinPricePair &coinPricePair,
+                                                                      const int32_t blockHeight) const {
     const auto &iter = mapCoinPricePointCache.find(coinPricePair);
     if (iter != mapCoinPricePointCache.end()) {
         const auto &mapBlockUserPrices = iter->second.mapBlockUserPrices;
-        for (const auto &item : mapBlockUserPrices) {
-            if (item.second.empty()) {
-                expired.insert(item.first);
-            } else if (expired.count(item.first) || blockUserPrices.count(item.first)) {
-                // TODO: log
-                continue;
-            } else {
-                // Got a valid item.
-                blockUserPrices[item.first] = item.second;
-            }
+        const auto &heightIter         = mapBlockUserPrices.find(blockHeight);
+        if (heightIter != mapBlockUserPrices.end()) {
+            // an empty item marks the block deleted from the base caches
+            return heightIter->second.empty() ? nullptr : &heightIter->second;
         }
     }
 
-    if (pBase != nullptr) {
-        return pBase->GetBlockUserPrices(coinPricePair, expired, blockUserPrices);
-    }
-
-    return true;
-}
-
-bool CPricePointMemCache::GetBlockUserPrices(const CoinPricePair &coinPricePair, BlockUserPriceMap &blockUserPrices) {
-    set<int32_t /* block height */> expired;
-    if (!GetBlockUserPrices(coinPricePair, expired, blockUserPrices)) {
-        // TODO: log
-        return false;
-    }
-
-    return true;
+    return pBase != nullptr ? pBase->FindBlockUserPrices(coinPricePair, blockHeight) : nullptr;
 }
 
 uint64_t CPricePointMemCache::ComputeBlockMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
                                                       const CoinPricePair &coinPricePair) {
-    // 1. merge block user prices with base cache.
-    BlockUserPriceMap blockUserPrices;
-    if (!GetBlockUserPrices(coinPricePair, blockUserPrices) || blockUserPrices.empty()) {
-        return 0;
-    }
-
-    // 2. compute block median price.
-    return ComputeBlockMedianPrice(blockHeight, slideWindow, blockUserPrices);
-}
-
-uint64_t CPricePointMemCache::ComputeBlockMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
-                                                      const BlockUserPriceMap &blockUserPrices) {
-    // for (const auto &item : blockUserPrices) {
-    //     string price;
-    //     for (const auto &userPrice : item.second) {
-    //         price += strprintf("{user:%s, price:%lld}", userPrice.first.ToString(), userPrice.second);
-    //     }
-
-    //     LogPrint(BCLog::PRICEFEED, "CPricePointMemCache::ComputeBlockMedianPrice, height: %d, userPrice: %s\n",
-    //              item.first, price);
-    // }
-
+    // only the blocks in the slide window are looked up in the cache levels, not all the cached blocks merged
     vector<uint64_t> prices;
     int32_t beginBlockHeight = std::max<int32_t>((blockHeight - slideWindow), 0);
     for (int32_t height = blockHeight; height > beginBlockHeight; --height) {
-        const auto &iter = blockUserPrices.find(height);
-        if (iter != blockUserPrices.end()) {
-            for (const auto &userPrice : iter->second) {
+        const auto *pUserPrices = FindBlockUserPrices(coinPricePair, height);
+        if (pUserPrices != nullptr) {
+            for (const auto &userPrice : *pUserPrices) {
                 prices.push_back(userPrice.second);
             }
         }
     }
 
-    // for (const auto &item : prices) {
-    //     LogPrint(BCLog::PRICEFEED, "CPricePointMemCache::ComputeBlockMedianPrice, found a candidate price: %llu\n", item);
-    // }
-
     uint64_t medianPrice = ComputeMedianNumber(prices);
     LogPrint(BCLog::PRICEFEED,
              "CPricePointMemCache::ComputeBlockMedianPrice, blockHeight: %d, computed median number: %llu\n",
@@ -209,13 +165,20 @@ uint64_t CPricePointMemCache::ComputeBlockMedianPrice(const int32_t blockHeight,
     return medianPrice;
 }
 
+// selects the middle numbers in linear time instead of sorting all the numbers
 uint64_t CPricePointMemCache::ComputeMedianNumber(vector<uint64_t> &numbers) {
     int32_t size = numbers.size();
     if (size < 2) {
         return size == 0 ? 0 : numbers[0];
     }
-    sort(numbers.begin(), numbers.end());
-    return (size % 2 == 0) ? (numbers[size / 2 - 1] + numbers[size / 2]) / 2 : numbers[size / 2];
+    auto middle = numbers.begin() + size / 2;
+    std::nth_element(numbers.begin(), middle, numbers.end());
+    if (size % 2 != 0)
+        return *middle;
+
+    // the lower middle number is the max of the numbers before the middle one
+    uint64_t lowerMiddle = *std::max_element(numbers.begin(), middle);
+    return (lowerMiddle + *middle) / 2;
 }
 
 uint64_t CPricePointMemCache::GetMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
@@ -33,6 +33,10 @@ public:
     void DeleteUserPrice(const int32_t blockHeight);
     bool ExistBlockUserPrice(const int32_t blockHeight, const CRegID &regId);
 
+    IMPLEMENT_SERIALIZE(
+        READWRITE(mapBlockUserPrices);
+    )
+
 public:
     BlockUserPriceMap mapBlockUserPrices;
 };
@@ -54,6 +58,11 @@ public:
     void SetBaseViewPtr(CPricePointMemCache *pBaseIn);
     void Flush();
 
+    // only the price points are kept, the latest median prices are reloaded by every calculation
+    IMPLEMENT_SERIALIZE(
+        READWRITE(mapCoinPricePointCache);
+    )
+
 private:
     uint64_t GetMedianPrice(const int32_t blockHeight, const uint64_t slideWindow, const CoinPricePair &coinPricePair);
 
@@ -63,13 +72,11 @@ private:
 
     void BatchWrite(const CoinPricePointMap &mapCoinPricePointCacheIn);
 
-    bool GetBlockUserPrices(const CoinPricePair &coinPricePair, set<int32_t> &expired, BlockUserPriceMap &blockUserPrices);
-    bool GetBlockUserPrices(const CoinPricePair &coinPricePair, BlockUserPriceMap &blockUserPrices);
+    // the user prices of the block from the nearest cache level holding it, nullptr if none or deleted
+    const map<CRegID, uint64_t> *FindBlockUserPrices(const CoinPricePair &coinPricePair, const int32_t blockHeight) const;
 
     uint64_t ComputeBlockMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
                                      const CoinPricePair &coinPricePair);
-    uint64_t ComputeBlockMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
-                                     const BlockUserPriceMap &blockUserPrices);
     static uint64_t ComputeMedianNumber(vector<uint64_t> &numbers);
 
 private:
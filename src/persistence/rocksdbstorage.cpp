@@ -0,0 +1,312 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/coin-config.h"
+#endif
+
+#ifdef USE_ROCKSDB
+
+#include "dbstorage.h"
+#include "leveldbwrapper.h"
+
+#include "commons/util/util.h"
+#include "config/configuration.h"
+
+#include <rocksdb/cache.h>
+#include <rocksdb/db.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/table.h>
+#include <rocksdb/write_batch.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+
+leveldb::Status ToLevelDBStatus(const rocksdb::Status &status) {
+    if (status.ok())
+        return leveldb::Status::OK();
+    if (status.IsNotFound())
+        return leveldb::Status::NotFound(status.ToString());
+    if (status.IsCorruption())
+        return leveldb::Status::Corruption(status.ToString());
+    if (status.IsIOError())
+        return leveldb::Status::IOError(status.ToString());
+    if (status.IsNotSupported())
+        return leveldb::Status::NotSupported(status.ToString());
+    return leveldb::Status::InvalidArgument(status.ToString());
+}
+
+rocksdb::Slice ToRocksDBSlice(const leveldb::Slice &slice) { return rocksdb::Slice(slice.data(), slice.size()); }
+
+leveldb::Slice ToLevelDBSlice(const rocksdb::Slice &slice) { return leveldb::Slice(slice.data(), slice.size()); }
+
+class CRocksDBSnapshot : public leveldb::Snapshot {
+public:
+    explicit CRocksDBSnapshot(const rocksdb::Snapshot *pSnapshotIn) : pSnapshot(pSnapshotIn) {}
+    ~CRocksDBSnapshot() override {}
+
+    const rocksdb::Snapshot *pSnapshot;
+};
+
+const rocksdb::Snapshot *ToRocksDBSnapshot(const leveldb::Snapshot *pSnapshot) {
+    return pSnapshot != nullptr ? static_cast<const CRocksDBSnapshot *>(pSnapshot)->pSnapshot : nullptr;
+}
+
+class CRocksDBIterator : public leveldb::Iterator {
+public:
+    explicit CRocksDBIterator(rocksdb::Iterator *pItIn) : pIt(pItIn) {}
+
+    bool Valid() const override { return pIt->Valid(); }
+    void SeekToFirst() override { pIt->SeekToFirst(); }
+    void SeekToLast() override { pIt->SeekToLast(); }
+    void Seek(const leveldb::Slice &target) override { pIt->Seek(ToRocksDBSlice(target)); }
+    void Next() override { pIt->Next(); }
+    void Prev() override { pIt->Prev(); }
+    leveldb::Slice key() const override { return ToLevelDBSlice(pIt->key()); }
+    leveldb::Slice value() const override { return ToLevelDBSlice(pIt->value()); }
+    leveldb::Status status() const override { return ToLevelDBStatus(pIt->status()); }
+
+private:
+    std::unique_ptr<rocksdb::Iterator> pIt;
+};
+
+// the puts and deletes of a leveldb batch into a rocksdb batch of the column family
+class CBatchConverter : public leveldb::WriteBatch::Handler {
+public:
+    CBatchConverter(rocksdb::WriteBatch &batchIn, rocksdb::ColumnFamilyHandle *pColumnFamilyIn)
+        : batch(batchIn), pColumnFamily(pColumnFamilyIn) {}
+
+    void Put(const leveldb::Slice &key, const leveldb::Slice &value) override {
+        batch.Put(pColumnFamily, ToRocksDBSlice(key), ToRocksDBSlice(value));
+    }
+
+    void Delete(const leveldb::Slice &key) override { batch.Delete(pColumnFamily, ToRocksDBSlice(key)); }
+
+private:
+    rocksdb::WriteBatch &batch;
+    rocksdb::ColumnFamilyHandle *pColumnFamily;
+};
+
+// the options of the database named so, which the column families opened with the db must be given
+CLevelDBOptions GetNamedDbOptions(const string &name) {
+    if (name == STATE_DB_NAME)
+        return GetStateDbOptions();
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++) {
+        if (GetDbName((DBNameType)i) == name)
+            return GetDbOptions((DBNameType)i);
+    }
+    return CLevelDBOptions(BLOCK_INDEX_DB_CACHE);
+}
+
+uint32_t GetCompactionThreadCount() {
+    int64_t count = SysCfg().GetArg("-dbcompactionthreads", 0);
+    if (count <= 0)
+        count = boost::thread::hardware_concurrency();
+    return (uint32_t)max<int64_t>(1, min<int64_t>(count, MAX_DB_COMPACTION_THREADS));
+}
+
+/**
+ * The rocksdb of a directory, with one column family per database. The block cache is shared by all the
+ * column families and sized by the sum of their budgets, the compactions run on -dbcompactionthreads and
+ * the bloom filters are partitioned with the index, so only their top level stays in memory.
+ */
+class CRocksDBInstance {
+public:
+    static shared_ptr<CRocksDBInstance> Get(const boost::filesystem::path &dir) {
+        lock_guard<mutex> lock(instancesMutex);
+        weak_ptr<CRocksDBInstance> &wpInstance = instances[dir.string()];
+        shared_ptr<CRocksDBInstance> spInstance = wpInstance.lock();
+        if (!spInstance) {
+            spInstance.reset(new CRocksDBInstance(dir));
+            wpInstance = spInstance;
+        }
+        return spInstance;
+    }
+
+    ~CRocksDBInstance() {
+        for (auto &item : columnFamilies)
+            pDb->DestroyColumnFamilyHandle(item.second);
+        columnFamilies.clear();
+        pDb->Close();
+    }
+
+    rocksdb::DB *GetDb() { return pDb.get(); }
+
+    rocksdb::ColumnFamilyHandle *GetColumnFamily(const string &name, const CLevelDBOptions &dbOptions, bool fWipe) {
+        lock_guard<mutex> lock(familiesMutex);
+        auto it = columnFamilies.find(name);
+        if (it != columnFamilies.end()) {
+            if (!fWipe)
+                return it->second;
+            LogPrint(BCLog::INFO, "Wiping the column family %s of RocksDB\n", name);
+            ThrowError(ToLevelDBStatus(pDb->DropColumnFamily(it->second)));
+            pDb->DestroyColumnFamilyHandle(it->second);
+            columnFamilies.erase(it);
+        }
+
+        rocksdb::ColumnFamilyHandle *pColumnFamily = nullptr;
+        ThrowError(ToLevelDBStatus(pDb->CreateColumnFamily(GetColumnFamilyOptions(dbOptions), name, &pColumnFamily)));
+        columnFamilies[name] = pColumnFamily;
+        return pColumnFamily;
+    }
+
+private:
+    explicit CRocksDBInstance(const boost::filesystem::path &dir) {
+        size_t cacheSize = BLOCK_INDEX_DB_CACHE / 2;
+        for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++)
+            cacheSize += GetDbOptions((DBNameType)i).blockCacheSize;
+        pBlockCache = rocksdb::NewLRUCache(cacheSize);
+
+        uint32_t threads = GetCompactionThreadCount();
+        rocksdb::DBOptions options;
+        options.create_if_missing = true;
+        options.max_open_files    = -1;
+        options.IncreaseParallelism(threads);
+        options.max_subcompactions = threads;
+
+        // all the column families of the db must be opened with it
+        vector<string> names;
+        if (!rocksdb::DB::ListColumnFamilies(options, dir.string(), &names).ok())
+            names = {rocksdb::kDefaultColumnFamilyName};
+        vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+        for (const auto &name : names)
+            descriptors.emplace_back(name, GetColumnFamilyOptions(GetNamedDbOptions(name)));
+
+        TryCreateDirectory(dir);
+        LogPrint(BCLog::INFO, "Opening RocksDB in %s (shared cache=%uKiB, compaction threads=%u, column families=%u)\n",
+                 dir.string(), cacheSize >> 10, threads, names.size());
+        vector<rocksdb::ColumnFamilyHandle *> handles;
+        rocksdb::DB *pDbOpened = nullptr;
+        ThrowError(ToLevelDBStatus(rocksdb::DB::Open(options, dir.string(), descriptors, &handles, &pDbOpened)));
+        pDb.reset(pDbOpened);
+        for (size_t i = 0; i < names.size(); i++)
+            columnFamilies[names[i]] = handles[i];
+    }
+
+    rocksdb::ColumnFamilyOptions GetColumnFamilyOptions(const CLevelDBOptions &dbOptions) {
+        rocksdb::ColumnFamilyOptions options;
+        options.write_buffer_size = dbOptions.writeBufferSize;
+        options.compression       = dbOptions.compression ? rocksdb::kSnappyCompression : rocksdb::kNoCompression;
+        options.level_compaction_dynamic_level_bytes = true;
+
+        rocksdb::BlockBasedTableOptions tableOptions;
+        tableOptions.block_cache            = pBlockCache;
+        tableOptions.block_restart_interval = dbOptions.restartInterval;
+        if (dbOptions.bloomBits > 0) {
+            tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(dbOptions.bloomBits));
+            tableOptions.partition_filters               = true;
+            tableOptions.index_type                      = rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
+            tableOptions.cache_index_and_filter_blocks   = true;
+            tableOptions.pin_top_level_index_and_filter  = true;
+        }
+        options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
+        return options;
+    }
+
+    static mutex instancesMutex;
+    static map<string, weak_ptr<CRocksDBInstance>> instances;
+
+    shared_ptr<rocksdb::Cache> pBlockCache;
+    unique_ptr<rocksdb::DB> pDb;
+    mutex familiesMutex;
+    map<string, rocksdb::ColumnFamilyHandle *> columnFamilies;
+};
+
+mutex CRocksDBInstance::instancesMutex;
+map<string, weak_ptr<CRocksDBInstance>> CRocksDBInstance::instances;
+
+class CRocksDBStorage : public CDBStorage {
+public:
+    CRocksDBStorage(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fWipe)
+        : spInstance(CRocksDBInstance::Get(path.parent_path() / DB_BACKEND_ROCKSDB)) {
+        pDb           = spInstance->GetDb();
+        pColumnFamily = spInstance->GetColumnFamily(path.filename().string(), dbOptions, fWipe);
+        readOptions.verify_checksums = true;
+        iterOptions.verify_checksums = true;
+        iterOptions.fill_cache       = false;
+        syncOptions.sync             = true;
+    }
+
+    leveldb::Status Get(const leveldb::Slice &key, string *pValue, const leveldb::Snapshot *pSnapshot) override {
+        rocksdb::ReadOptions options = readOptions;
+        options.snapshot             = ToRocksDBSnapshot(pSnapshot);
+        return ToLevelDBStatus(pDb->Get(options, pColumnFamily, ToRocksDBSlice(key), pValue));
+    }
+
+    leveldb::Status MultiGet(const vector<leveldb::Slice> &keys, vector<std::optional<string>> &values,
+                             const leveldb::Snapshot *pSnapshot) override {
+        rocksdb::ReadOptions options = readOptions;
+        options.snapshot             = ToRocksDBSnapshot(pSnapshot);
+        vector<rocksdb::Slice> rocksKeys;
+        rocksKeys.reserve(keys.size());
+        for (const auto &key : keys)
+            rocksKeys.push_back(ToRocksDBSlice(key));
+
+        vector<string> rocksValues;
+        vector<rocksdb::ColumnFamilyHandle *> columnFamilies(keys.size(), pColumnFamily);
+        vector<rocksdb::Status> statuses = pDb->MultiGet(options, columnFamilies, rocksKeys, &rocksValues);
+
+        values.assign(keys.size(), std::nullopt);
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (statuses[i].ok())
+                values[i] = std::move(rocksValues[i]);
+            else if (!statuses[i].IsNotFound())
+                return ToLevelDBStatus(statuses[i]);
+        }
+        return leveldb::Status::OK();
+    }
+
+    leveldb::Status Write(leveldb::WriteBatch *pBatch, bool fSync) override {
+        rocksdb::WriteBatch batch;
+        CBatchConverter converter(batch, pColumnFamily);
+        leveldb::Status status = pBatch->Iterate(&converter);
+        if (!status.ok())
+            return status;
+        return ToLevelDBStatus(pDb->Write(fSync ? syncOptions : writeOptions, &batch));
+    }
+
+    leveldb::Iterator *NewIterator(const leveldb::Snapshot *pSnapshot) override {
+        rocksdb::ReadOptions options = iterOptions;
+        options.snapshot             = ToRocksDBSnapshot(pSnapshot);
+        return new CRocksDBIterator(pDb->NewIterator(options, pColumnFamily));
+    }
+
+    leveldb::Iterator *NewFillCacheIterator() override {
+        rocksdb::ReadOptions options = iterOptions;
+        options.fill_cache           = true;
+        return new CRocksDBIterator(pDb->NewIterator(options, pColumnFamily));
+    }
+
+    const leveldb::Snapshot *GetSnapshot() override { return new CRocksDBSnapshot(pDb->GetSnapshot()); }
+
+    void ReleaseSnapshot(const leveldb::Snapshot *pSnapshot) override {
+        const CRocksDBSnapshot *pRocksDBSnapshot = static_cast<const CRocksDBSnapshot *>(pSnapshot);
+        pDb->ReleaseSnapshot(pRocksDBSnapshot->pSnapshot);
+        delete pRocksDBSnapshot;
+    }
+
+private:
+    shared_ptr<CRocksDBInstance> spInstance;  // closed with its last database
+    rocksdb::DB *pDb;
+    rocksdb::ColumnFamilyHandle *pColumnFamily;
+    rocksdb::ReadOptions readOptions;
+    rocksdb::ReadOptions iterOptions;
+    rocksdb::WriteOptions writeOptions;
+    rocksdb::WriteOptions syncOptions;
+};
+
+}  // namespace
+
+CDBStorage *NewRocksDBStorage(const boost::filesystem::path &path, const CLevelDBOptions &dbOptions, bool fWipe) {
+    return new CRocksDBStorage(path, dbOptions, fWipe);
+}
+
+#endif  // USE_ROCKSDB
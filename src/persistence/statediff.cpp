@@ -0,0 +1,137 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "statediff.h"
+
+#include "main.h"
+#include "logging.h"
+#include "persistence/blockundo.h"
+#include "persistence/cachewrapper.h"
+#include "commons/util/util.h"
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+std::unique_ptr<CStateDiffPublisher> pStateDiffPublisher;
+
+CStateDiffPublisher::~CStateDiffPublisher() {
+    if (file != nullptr)
+        fclose(file);
+}
+
+bool CStateDiffPublisher::Open() {
+    file = fopen(path.string().c_str(), "ab");
+    if (file == nullptr)
+        return ERRORMSG("%s : Failed to open file %s", __func__, path.string());
+
+    LogPrint(BCLog::INFO, "%s : publish the state changes of the blocks to %s\n", __func__, path.string());
+    return true;
+}
+
+void GetStateDiffEntries(const CBlockUndo &blockUndo, CCacheWrapper &cw, vector<CStateDiffEntry> &entries) {
+    // the first log of a key in the block has its value before the block
+    map<dbk::PrefixType, map<string, const string *>> oldValues;
+    for (const auto &txUndo : blockUndo.vtxundo) {
+        for (const auto &opLogPair : txUndo.dbOpLogMap.GetMap()) {
+            auto &values = oldValues[opLogPair.first];
+            for (const auto &opLog : opLogPair.second)
+                values.emplace(opLog.GetKey(), &opLog.GetValue());
+        }
+    }
+
+    ReadDataFuncMap readDataFuncMap = cw.GetReadDataFuncMap();
+    for (const auto &item : oldValues) {
+        auto funcMapIt = readDataFuncMap.find(item.first);
+        if (funcMapIt == readDataFuncMap.end()) {
+            LogPrint(BCLog::ERROR, "%s : unfound prefix in db! prefix_type=%s\n", __func__,
+                     dbk::GetKeyPrefix(item.first));
+            continue;
+        }
+
+        for (const auto &valueItem : item.second) {
+            string newValue;
+            funcMapIt->second(valueItem.first, newValue);
+            if (newValue == *valueItem.second)
+                continue;
+
+            entries.emplace_back();
+            CStateDiffEntry &entry = entries.back();
+            entry.prefix           = dbk::GetKeyPrefix(item.first);
+            entry.key              = valueItem.first;
+            entry.oldValue         = *valueItem.second;
+            entry.newValue         = std::move(newValue);
+        }
+    }
+}
+
+void CStateDiffPublisher::PublishConnect(const CBlockIndex *pIndex, const CBlockUndo &blockUndo, CCacheWrapper &cw) {
+    CStateDiffRecord record;
+    record.type          = CStateDiffRecord::CONNECT;
+    record.height        = pIndex->height;
+    record.blockHash     = pIndex->GetBlockHash();
+    record.prevBlockHash = pIndex->pprev ? pIndex->pprev->GetBlockHash() : uint256();
+    GetStateDiffEntries(blockUndo, cw, record.entries);
+    Enqueue(std::move(record));
+}
+
+void CStateDiffPublisher::PublishDisconnect(const CBlockIndex *pIndex) {
+    CStateDiffRecord record;
+    record.type          = CStateDiffRecord::DISCONNECT;
+    record.height        = pIndex->height;
+    record.blockHash     = pIndex->GetBlockHash();
+    record.prevBlockHash = pIndex->pprev ? pIndex->pprev->GetBlockHash() : uint256();
+    Enqueue(std::move(record));
+}
+
+void CStateDiffPublisher::Enqueue(CStateDiffRecord &&record) {
+    {
+        boost::unique_lock<boost::mutex> lock(queueMutex);
+        if (queue.size() >= MAX_STATE_DIFF_QUEUE_SIZE) {
+            LogPrint(BCLog::ERROR, "%s : the writer is %u blocks behind, drop the state changes of block %d %s\n",
+                     __func__, queue.size(), record.height, record.blockHash.GetHex());
+            return;
+        }
+        queue.push_back(std::move(record));
+    }
+    queueCond.notify_one();
+}
+
+bool CStateDiffPublisher::Write(const CStateDiffRecord &record) {
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << MAGIC << (uint32_t)::GetSerializeSize(record, SER_DISK, CLIENT_VERSION) << record;
+    if (fwrite(&ss[0], 1, ss.size(), file) != ss.size() || fflush(file) != 0)
+        return ERRORMSG("%s : Failed to write the state changes of block %d to %s", __func__, record.height,
+                        path.string());
+    return true;
+}
+
+void CStateDiffPublisher::Run() {
+    while (true) {
+        CStateDiffRecord record;
+        {
+            boost::unique_lock<boost::mutex> lock(queueMutex);
+            try {
+                while (queue.empty())
+                    queueCond.wait(lock);
+            } catch (boost::thread_interrupted &) {
+                // write the blocks connected before the shutdown
+                boost::this_thread::disable_interruption noInterruption;
+                for (const auto &item : queue)
+                    Write(item);
+                queue.clear();
+                throw;
+            }
+            record = std::move(queue.front());
+            queue.pop_front();
+        }
+        Write(record);
+    }
+}
+
+void ThreadStateDiff() {
+    RenameThread("coin-statediff");
+    if (pStateDiffPublisher)
+        pStateDiffPublisher->Run();
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_STATEDIFF_H
+#define PERSIST_STATEDIFF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CBlockIndex;
+class CBlockUndo;
+class CCacheWrapper;
+
+// the blocks waiting for the writer, the ones over it are dropped
+static const uint32_t MAX_STATE_DIFF_QUEUE_SIZE = 1000;
+
+struct CStateDiffEntry {
+    std::string prefix;    // the db key prefix
+    std::string key;       // serialized, empty for the single value of the prefix
+    std::string oldValue;  // serialized value before the block, the empty value of its type if it was not set
+    std::string newValue;  // serialized value after the block, likewise
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(prefix);
+        READWRITE(key);
+        READWRITE(oldValue);
+        READWRITE(newValue);)
+};
+
+struct CStateDiffRecord {
+    enum Type : uint8_t {
+        CONNECT    = 1,
+        DISCONNECT = 2,  // no entries, the consumer restores the old values of the connection of the block
+    };
+
+    uint8_t type = CONNECT;
+    int32_t height = 0;
+    uint256 blockHash;
+    uint256 prevBlockHash;
+    std::vector<CStateDiffEntry> entries;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(type);
+        READWRITE(height);
+        READWRITE(blockHash);
+        READWRITE(prevBlockHash);
+        READWRITE(entries);)
+};
+
+// the keys changed by the undo logs of blockUndo with their values before it and their new values read from cw
+void GetStateDiffEntries(const CBlockUndo &blockUndo, CCacheWrapper &cw, std::vector<CStateDiffEntry> &entries);
+
+/**
+ * Publisher of the changes of the chain state per block (-statediff=<file>), so an indexer follows the
+ * accounts, the dex and the other dbs without executing the blocks or querying the rpc. The changed keys
+ * come from the undo logs of the block, the new values are read from the caches once the block is on the
+ * tip, a key written many times in the block is one entry.
+ *
+ * The records are appended to the file in the order of the tip changes, each as MAGIC, its size as a
+ * uint32 and the serialized CStateDiffRecord. The file may be a fifo of a reading process. The records
+ * are written by a thread of their own, if it falls MAX_STATE_DIFF_QUEUE_SIZE blocks behind the next ones
+ * are dropped with an error in the log, the consumer sees the gap in the prevBlockHash.
+ */
+class CStateDiffPublisher {
+public:
+    static const uint32_t MAGIC = 0x66696473;  // "sdif"
+
+    explicit CStateDiffPublisher(const boost::filesystem::path &pathIn) : path(pathIn), file(nullptr) {}
+    ~CStateDiffPublisher();
+
+    bool Open();
+
+    // requires cs_main, once the block is connected to the tip, the new values are read from cw
+    void PublishConnect(const CBlockIndex *pIndex, const CBlockUndo &blockUndo, CCacheWrapper &cw);
+    void PublishDisconnect(const CBlockIndex *pIndex);
+
+    // write the queued records until shutdown
+    void Run();
+
+private:
+    void Enqueue(CStateDiffRecord &&record);
+    bool Write(const CStateDiffRecord &record);
+
+    boost::filesystem::path path;
+    FILE *file;
+
+    boost::mutex queueMutex;
+    boost::condition_variable queueCond;
+    std::deque<CStateDiffRecord> queue;
+};
+
+// null unless -statediff is set
+extern std::unique_ptr<CStateDiffPublisher> pStateDiffPublisher;
+
+void ThreadStateDiff();
+
+#endif  // PERSIST_STATEDIFF_H
@@ -0,0 +1,424 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "statedump.h"
+
+#include "main.h"
+#include "logging.h"
+#include "crypto/hash.h"
+#include "miner/pbftmanager.h"
+#include "persistence/cachewrapper.h"
+#include "persistence/memcachesnapshot.h"
+#include "persistence/pricefeeddb.h"
+#include "persistence/txdb.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+using namespace std;
+
+extern CPBFTMan pbftMan;
+
+static const char *SECTION_BLOCK_INDEX = "blockindex";
+static const char *SECTION_MEM_CACHE   = "memcache";
+
+// the dbs of the indexes of the block files and of the execution results are not part of the state
+static bool IsDumpedDb(DBNameType dbNameType) {
+    return dbNameType != DBNameType::LOG && dbNameType != DBNameType::RECEIPT;
+}
+
+// the keys pointing into the block files of the dumping node, or only meaningful to it
+static bool IsDumpedKey(const string &key) {
+    for (dbk::PrefixType prefixType : {dbk::TXID_DISKINDEX, dbk::LAST_BLOCKFILE, dbk::REINDEX, dbk::FLUSH_SEQUENCE}) {
+        const string &prefix = dbk::GetKeyPrefix(prefixType);
+        if (key.compare(0, prefix.size(), prefix) == 0)
+            return false;
+    }
+    return true;
+}
+
+uint64_t CStateDumpInfo::GetKeyCount() const {
+    uint64_t keyCount = 0;
+    for (const auto &section : sections)
+        keyCount += section.keyCount;
+    return keyCount;
+}
+
+uint256 CStateDumpInfo::ComputeCommitment() const {
+    CHashWriter hasher(SER_GETHASH, 0);
+    hasher << height << blockHash;
+    for (const auto &section : sections)
+        hasher << section.name << section.keyCount << section.hash;
+    return hasher.GetHash();
+}
+
+// Write the entries of a section in chunks: [size][entries][checksum], an entry is a compact size
+// prefixed key and value
+class CStateDumpSectionWriter {
+public:
+    CStateDumpSectionWriter(CAutoFile &fileIn, uint64_t &offsetIn, const string &name)
+        : file(fileIn), offset(offsetIn), ssChunk(SER_DISK, CLIENT_VERSION), hasher(SER_GETHASH, 0) {
+        section.name   = name;
+        section.offset = offset;
+    }
+
+    void Add(const char *pKey, size_t keySize, const char *pValue, size_t valueSize) {
+        size_t begin = ssChunk.size();
+        WriteCompactSize(ssChunk, keySize);
+        ssChunk.write(pKey, keySize);
+        WriteCompactSize(ssChunk, valueSize);
+        ssChunk.write(pValue, valueSize);
+        hasher.write(&ssChunk[begin], ssChunk.size() - begin);
+        ++section.keyCount;
+
+        if (ssChunk.size() >= CStateDump::CHUNK_SIZE)
+            WriteChunk();
+    }
+
+    void Add(const string &key, const string &value) { Add(key.data(), key.size(), value.data(), value.size()); }
+
+    CStateDumpSection Finish() {
+        if (!ssChunk.empty())
+            WriteChunk();
+        section.size = offset - section.offset;
+        section.hash = hasher.GetHash();
+        return section;
+    }
+
+private:
+    void WriteChunk() {
+        uint32_t size = ssChunk.size();
+        file << size;
+        file.write(&ssChunk[0], size);
+        file << Hash(ssChunk.begin(), ssChunk.end());
+        offset += sizeof(size) + size + sizeof(uint256);
+        ssChunk.clear();
+    }
+
+    CAutoFile &file;
+    uint64_t &offset;
+    CDataStream ssChunk;
+    CHashWriter hasher;
+    CStateDumpSection section;
+};
+
+typedef vector<pair<string, string>> CStateDumpEntries;
+typedef std::function<bool(const CStateDumpEntries &entries)> CStateDumpChunkHandler;
+
+// Read the chunks of a section on its own file handle, the entries are handled chunk by chunk
+static bool ReadStateDumpSection(const boost::filesystem::path &pathDump, const CStateDumpSection &section,
+                                 const CStateDumpChunkHandler &handleChunk) {
+    FILE *pFile = fopen(pathDump.string().c_str(), "rb");
+    if (pFile == nullptr || fseek(pFile, section.offset, SEEK_SET) != 0) {
+        if (pFile != nullptr)
+            fclose(pFile);
+        return ERRORMSG("%s : Failed to open section %s of %s", __func__, section.name, pathDump.string());
+    }
+    CAutoFile filein = CAutoFile(pFile, SER_DISK, CLIENT_VERSION);
+
+    CHashWriter hasher(SER_GETHASH, 0);
+    uint64_t keyCount = 0;
+    uint64_t readSize = 0;
+    vector<char> chunk;
+    CStateDumpEntries entries;
+    try {
+        while (readSize < section.size) {
+            boost::this_thread::interruption_point();
+
+            uint32_t size;
+            uint256 hashIn;
+            filein >> size;
+            if (size > MAX_SIZE || readSize + sizeof(size) + size + sizeof(uint256) > section.size)
+                return ERRORMSG("%s : Invalid chunk size %u in section %s", __func__, size, section.name);
+
+            chunk.resize(size);
+            filein.read(chunk.data(), size);
+            filein >> hashIn;
+            if (hashIn != Hash(chunk.begin(), chunk.end()))
+                return ERRORMSG("%s : Checksum mismatch in section %s at offset %llu", __func__, section.name,
+                                section.offset + readSize);
+            readSize += sizeof(size) + size + sizeof(uint256);
+
+            hasher.write(chunk.data(), size);
+            CSpanReader reader(chunk.data(), chunk.data() + size, SER_DISK, CLIENT_VERSION);
+            entries.clear();
+            while (!reader.empty()) {
+                entries.emplace_back();
+                string &key   = entries.back().first;
+                string &value = entries.back().second;
+                key.resize(ReadCompactSize(reader));
+                reader.read(&key[0], key.size());
+                value.resize(ReadCompactSize(reader));
+                reader.read(&value[0], value.size());
+            }
+            keyCount += entries.size();
+            if (!handleChunk(entries))
+                return ERRORMSG("%s : Failed to handle the keys of section %s", __func__, section.name);
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error in section %s - %s", __func__, section.name, e.what());
+    }
+
+    if (keyCount != section.keyCount || hasher.GetHash() != section.hash)
+        return ERRORMSG("%s : Section %s does not match the footer, %llu keys read", __func__, section.name,
+                        keyCount);
+
+    return true;
+}
+
+bool CStateDump::Write(CStateDumpInfo &info) {
+    vector<pair<CDBAccess *, CDBReadSnapshot>> dbSnapshots;
+    vector<CDiskBlockIndex> blockIndexes;
+    CDataStream ssMemCache(SER_DISK, CLIENT_VERSION);
+    {
+        LOCK(cs_main);
+        int64_t beginTime = GetTimeMicros();
+        CBlockIndex *pTip = chainActive.Tip();
+        CBlockIndex *pFin = pbftMan.GetGlobalFinIndex();
+        if (pTip == nullptr || pFin == nullptr || !chainActive.Contains(pFin))
+            return ERRORMSG("%s : No finalized block in the active chain", __func__);
+
+        auto spCW = CCacheWrapper::NewCopyFrom(pCdMan);
+        CValidationState state;
+        if (pFin != pTip && !DisconnectBlocks(*spCW, pTip, pFin, state))
+            return ERRORMSG("%s : Failed to undo the blocks above the finalized block %d", __func__, pFin->height);
+
+        ssMemCache << (uint32_t)SysCfg().GetTxCacheHeight() << (uint32_t)PRICE_POINT_CACHE_HEIGHT
+                   << spCW->txCache.GetBlocks() << spCW->ppCache;
+
+        // in the order of GetDbAccesses(), the same on every node
+        CDBReadSnapshotMap snapshots = pCdMan->NewReadSnapshots(*spCW);
+        for (auto pDbAccess : pCdMan->GetDbAccesses()) {
+            if (IsDumpedDb(pDbAccess->GetDbNameType()))
+                dbSnapshots.emplace_back(pDbAccess, snapshots[pDbAccess]);
+        }
+
+        // the block files are not dumped, the index of the importing node has the headers only
+        for (CBlockIndex *pIndex = pFin; pIndex != nullptr; pIndex = pIndex->pprev) {
+            blockIndexes.emplace_back(pIndex);
+            blockIndexes.back().nStatus &= ~(BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO);
+        }
+        std::reverse(blockIndexes.begin(), blockIndexes.end());
+
+        info.height    = pFin->height;
+        info.blockHash = pFin->GetBlockHash();
+        info.tipHeight = pTip->height;
+        LogPrint(BCLog::INFO, "%s : took the state of the finalized block %d at the tip %d in %.2fms\n", __func__,
+                 info.height, info.tipHeight, 0.001 * (GetTimeMicros() - beginTime));
+    }
+
+    boost::filesystem::path pathTmp = pathDump.string() + ".tmp";
+    FILE *file                      = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout               = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    try {
+        fileout << FLATDATA(SysCfg().MessageStart()) << CURRENT_VERSION;
+        uint64_t offset = sizeof(SysCfg().MessageStart()) + sizeof(CURRENT_VERSION);
+
+        for (auto &item : dbSnapshots) {
+            CStateDumpSectionWriter writer(fileout, offset, GetDbName(item.first->GetDbNameType()));
+            CDBReadSnapshotMap snapshots = {{item.first, item.second}};
+            CDBAccess::CSnapshotScope snapshotScope(&snapshots);
+            auto pCursor = item.first->NewIterator();
+            for (pCursor->SeekToFirst(); pCursor->Valid(); pCursor->Next()) {
+                boost::this_thread::interruption_point();
+                leveldb::Slice slKey = pCursor->key();
+                // the section of a db shared by -singlestatedb has the keys of its own type only
+                if (!IsDumpedKey(slKey.ToString()) || !item.first->IsOwnKey(slKey))
+                    continue;
+
+                leveldb::Slice slValue = pCursor->value();
+                writer.Add(slKey.data(), slKey.size(), slValue.data(), slValue.size());
+            }
+            if (!pCursor->status().ok())
+                return ERRORMSG("%s : Failed to iterate the db %s", __func__, GetDbName(item.first->GetDbNameType()));
+            info.sections.push_back(writer.Finish());
+        }
+
+        CStateDumpSectionWriter indexWriter(fileout, offset, SECTION_BLOCK_INDEX);
+        for (const auto &diskIndex : blockIndexes) {
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            ssValue << diskIndex;
+            indexWriter.Add(dbk::GenDbKey(dbk::BLOCK_INDEX, diskIndex.GetBlockHash()), ssValue.str());
+        }
+        info.sections.push_back(indexWriter.Finish());
+
+        CStateDumpSectionWriter memCacheWriter(fileout, offset, SECTION_MEM_CACHE);
+        memCacheWriter.Add(SECTION_MEM_CACHE, ssMemCache.str());
+        info.sections.push_back(memCacheWriter.Finish());
+
+        // the footer locates the sections, its offset is the last 8 bytes of the file
+        info.commitment = info.ComputeCommitment();
+        CDataStream ssFooter(SER_DISK, CLIENT_VERSION);
+        ssFooter << FLATDATA(SysCfg().MessageStart()) << CURRENT_VERSION << info;
+        fileout.write(&ssFooter[0], ssFooter.size());
+        fileout << Hash(ssFooter.begin(), ssFooter.end()) << offset;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout);
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, pathDump))
+        return ERRORMSG("%s : Rename-into-place failed", __func__);
+
+    LogPrint(BCLog::INFO, "%s : dumped %llu keys of the state at block %d to %s, commitment=%s\n", __func__,
+             info.GetKeyCount(), info.height, pathDump.string(), info.commitment.GetHex());
+    return true;
+}
+
+bool CStateDump::ReadInfo(CStateDumpInfo &info) {
+    if (!boost::filesystem::exists(pathDump))
+        return ERRORMSG("%s : Missing file %s", __func__, pathDump.string());
+
+    FILE *file       = fopen(pathDump.string().c_str(), "rb");
+    CAutoFile filein = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathDump.string());
+
+    uint64_t fileSize = boost::filesystem::file_size(pathDump);
+    uint64_t footerOffset;
+    uint256 hashIn;
+    vector<char> vchFooter;
+    try {
+        if (fileSize < sizeof(footerOffset) + sizeof(uint256) || fseek(filein, -8, SEEK_END) != 0)
+            return ERRORMSG("%s : Truncated file %s", __func__, pathDump.string());
+        filein >> footerOffset;
+        if (footerOffset > fileSize - sizeof(footerOffset) - sizeof(uint256) ||
+            fseek(filein, footerOffset, SEEK_SET) != 0)
+            return ERRORMSG("%s : Invalid footer offset %llu", __func__, footerOffset);
+
+        vchFooter.resize(fileSize - sizeof(footerOffset) - sizeof(uint256) - footerOffset);
+        filein.read(vchFooter.data(), vchFooter.size());
+        filein >> hashIn;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    if (hashIn != Hash(vchFooter.begin(), vchFooter.end()))
+        return ERRORMSG("%s : Checksum mismatch, footer corrupted", __func__);
+
+    CDataStream ssFooter(vchFooter.begin(), vchFooter.end(), SER_DISK, CLIENT_VERSION);
+    uint8_t pchMsgTmp[4];
+    int32_t version;
+    try {
+        ssFooter >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, SysCfg().MessageStart(), sizeof(pchMsgTmp)))
+            return ERRORMSG("%s : Invalid network magic number", __func__);
+
+        ssFooter >> version;
+        if (version != CURRENT_VERSION)
+            return ERRORMSG("%s : Unsupported dump version %d", __func__, version);
+
+        ssFooter >> info;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    if (info.commitment != info.ComputeCommitment())
+        return ERRORMSG("%s : The commitment does not match the sections", __func__);
+
+    for (const auto &section : info.sections) {
+        if (section.offset + section.size > footerOffset)
+            return ERRORMSG("%s : Section %s beyond the footer", __func__, section.name);
+    }
+    return true;
+}
+
+bool CStateDump::Read(CCacheDBManager *pCdManIn, const CStateDumpInfo &info) {
+    int64_t beginTime = GetTimeMillis();
+
+    // the memory caches are small and checked first, their heights decide whether memcache.dat is loaded
+    const CStateDumpSection *pMemCacheSection = nullptr;
+    for (const auto &section : info.sections) {
+        if (section.name == SECTION_MEM_CACHE)
+            pMemCacheSection = &section;
+    }
+    if (pMemCacheSection == nullptr)
+        return ERRORMSG("%s : Missing section %s", __func__, SECTION_MEM_CACHE);
+
+    uint32_t txCacheHeight    = 0;
+    uint32_t priceCacheHeight = 0;
+    map<int32_t, CBlockTxids> txBlocks;
+    CPricePointMemCache ppCache;
+    bool fMemCacheRead = ReadStateDumpSection(pathDump, *pMemCacheSection, [&](const CStateDumpEntries &entries) {
+        for (const auto &entry : entries) {
+            if (entry.first != SECTION_MEM_CACHE)
+                continue;
+
+            CDataStream ssValue(entry.second.data(), entry.second.data() + entry.second.size(), SER_DISK,
+                                CLIENT_VERSION);
+            ssValue >> txCacheHeight >> priceCacheHeight >> txBlocks >> ppCache;
+        }
+        return true;
+    });
+    if (!fMemCacheRead)
+        return false;
+
+    // the caches are only loaded at the same heights, the blocks to replay them from are not imported
+    if (txCacheHeight != (uint32_t)SysCfg().GetTxCacheHeight() || priceCacheHeight != PRICE_POINT_CACHE_HEIGHT)
+        return ERRORMSG("%s : The dump has the memory caches of %u blocks of txs and %u of prices, expected %u and %u",
+                        __func__, txCacheHeight, priceCacheHeight, SysCfg().GetTxCacheHeight(),
+                        PRICE_POINT_CACHE_HEIGHT);
+
+    // tasks of the sections, all of the dumped dbs and the block index must be in the file
+    auto writeEntries = [](const CStateDumpEntries &entries, const std::function<bool(CLevelDBBatch &batch)> &write) {
+        CLevelDBBatch batch;
+        for (const auto &entry : entries)
+            batch.WriteRaw(entry.first, entry.second);
+        return write(batch);
+    };
+    vector<pair<const CStateDumpSection *, CStateDumpChunkHandler>> tasks;
+    auto findSection = [&](const string &name) -> const CStateDumpSection * {
+        for (const auto &section : info.sections) {
+            if (section.name == name)
+                return &section;
+        }
+        return nullptr;
+    };
+    for (auto pDbAccess : pCdManIn->GetDbAccesses()) {
+        if (!IsDumpedDb(pDbAccess->GetDbNameType()))
+            continue;
+
+        const CStateDumpSection *pSection = findSection(GetDbName(pDbAccess->GetDbNameType()));
+        if (pSection == nullptr)
+            return ERRORMSG("%s : Missing section %s", __func__, GetDbName(pDbAccess->GetDbNameType()));
+        tasks.emplace_back(pSection, [pDbAccess, writeEntries](const CStateDumpEntries &entries) {
+            return writeEntries(entries, [pDbAccess](CLevelDBBatch &batch) { return pDbAccess->WriteRawBatch(batch); });
+        });
+    }
+    const CStateDumpSection *pIndexSection = findSection(SECTION_BLOCK_INDEX);
+    if (pIndexSection == nullptr)
+        return ERRORMSG("%s : Missing section %s", __func__, SECTION_BLOCK_INDEX);
+    CBlockIndexDB *pBlockIndexDb = pCdManIn->pBlockIndexDb;
+    tasks.emplace_back(pIndexSection, [pBlockIndexDb, writeEntries](const CStateDumpEntries &entries) {
+        return writeEntries(entries, [pBlockIndexDb](CLevelDBBatch &batch) { return pBlockIndexDb->WriteBatch(batch, true); });
+    });
+
+    // one thread per section, the dbs don't share any lock on the write path
+    vector<char> results(tasks.size(), false);
+    boost::thread_group threads;
+    for (size_t i = 0; i < tasks.size(); i++) {
+        threads.create_thread([this, &tasks, &results, i]() {
+            results[i] = ReadStateDumpSection(pathDump, *tasks[i].first, tasks[i].second);
+        });
+    }
+    threads.join_all();
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (!results[i])
+            return ERRORMSG("%s : Failed to import section %s", __func__, tasks[i].first->name);
+    }
+
+    CTxMemCache txCache;
+    txCache.SetBlocks(std::move(txBlocks));
+    if (!CMemCacheSnapshot().Write(info.blockHash, txCacheHeight, priceCacheHeight, txCache, ppCache))
+        return ERRORMSG("%s : Failed to write the memory caches of the finalized block", __func__);
+
+    LogPrint(BCLog::INFO, "%s : imported %llu keys of the state at block %d in %dms\n", __func__,
+             info.GetKeyCount(), info.height, GetTimeMillis() - beginTime);
+    return true;
+}
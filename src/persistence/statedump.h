@@ -0,0 +1,87 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_STATEDUMP_H
+#define PERSIST_STATEDUMP_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+
+#include <boost/filesystem/path.hpp>
+
+class CCacheDBManager;
+
+struct CStateDumpSection {
+    std::string name;  // the db name, or blockindex and memcache
+    uint64_t offset   = 0;
+    uint64_t size     = 0;  // bytes of the chunks
+    uint64_t keyCount = 0;
+    uint256 hash;           // hash of the keys and values in order, whatever the chunks
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(name);
+        READWRITE(VARINT(offset));
+        READWRITE(VARINT(size));
+        READWRITE(VARINT(keyCount));
+        READWRITE(hash);)
+};
+
+struct CStateDumpInfo {
+    int32_t height = 0;      // the finalized block of the state
+    uint256 blockHash;
+    int32_t tipHeight = 0;   // the tip of the dumping node, undone down to the finalized block
+    uint256 commitment;
+    std::vector<CStateDumpSection> sections;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(height);
+        READWRITE(blockHash);
+        READWRITE(tipHeight);
+        READWRITE(commitment);
+        READWRITE(sections);)
+
+    uint64_t GetKeyCount() const;
+    uint256 ComputeCommitment() const;
+};
+
+/**
+ * Dump of the chain state at the global finalized block (dumpstate), imported by a new node with
+ * -loadstate instead of replaying the chain from the genesis block.
+ *
+ * The file has a section per db with its raw keys and values in key order, one with the block index of
+ * the active chain up to the finalized block, without the positions in the block files, and one with
+ * the memory caches at it. A section is a run of chunks of about CHUNK_SIZE bytes with a checksum each,
+ * the footer at the end of the file locates the sections, so the import writes the dbs in parallel.
+ * The commitment is the hash of the section hashes: it does not depend on the chunking and two nodes
+ * dumping the same finalized block get the same one.
+ *
+ * The state is the one of the tip with the blocks above the finalized block undone in a copy of the
+ * caches. The tx disk index, the logs and the receipts refer to the block files and are left out.
+ */
+class CStateDump {
+public:
+    static const int32_t CURRENT_VERSION = 2;
+    static const uint32_t CHUNK_SIZE     = 1 << 20;
+
+    CStateDump(const boost::filesystem::path &pathIn): pathDump(pathIn) {}
+
+    // holds cs_main to take the db snapshots and undo the blocks only, the sections are written without it
+    bool Write(CStateDumpInfo &info);
+
+    // read the footer and check that the commitment matches its sections
+    bool ReadInfo(CStateDumpInfo &info);
+
+    // import the sections into the empty dbs of pCdManIn in parallel, the memory caches go to memcache.dat
+    bool Read(CCacheDBManager *pCdManIn, const CStateDumpInfo &info);
+
+private:
+    boost::filesystem::path pathDump;
+};
+
+#endif  // PERSIST_STATEDUMP_H
@@ -0,0 +1,78 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "statesnapshot.h"
+
+#include "main.h"
+
+std::atomic<uint64_t> CStateSnapshot::tipSequence(0);
+std::mutex CStateSnapshot::cs_current;
+std::shared_ptr<CStateSnapshot> CStateSnapshot::spCurrent;
+
+static CDBAccessTracker MakeReadTracker(std::recursive_mutex &baseMutex) {
+    CDBAccessTracker tracker;
+    tracker.pBaseMutex  = &baseMutex;
+    tracker.fRecordKeys = false;
+    return tracker;
+}
+
+CStateSnapshot::CReadScope::CReadScope(const std::shared_ptr<CStateSnapshot> &spSnapshotIn)
+    : spSnapshot(spSnapshotIn),
+      tracker(MakeReadTracker(spSnapshotIn->cs_base)),
+      trackerScope(&tracker),
+      dbScope(&spSnapshotIn->dbSnapshots) {}
+
+CStateSnapshot::CReadView::CReadView(const std::shared_ptr<CStateSnapshot> &spSnapshotIn)
+    : CReadScope(spSnapshotIn), cw(&spSnapshotIn->cw) {}
+
+std::shared_ptr<CStateSnapshot> CStateSnapshot::GetCurrent() {
+    uint64_t sequence = tipSequence;
+    {
+        std::lock_guard<std::mutex> lock(cs_current);
+        if (spCurrent && spCurrent->tip_sequence == sequence)
+            return spCurrent;
+    }
+
+    LOCK(cs_main);
+    if (pCdMan == nullptr)
+        throw runtime_error("the chain state is not loaded");
+
+    // the tip can not change under cs_main
+    sequence = tipSequence;
+    {
+        std::lock_guard<std::mutex> lock(cs_current);
+        if (spCurrent && spCurrent->tip_sequence == sequence)
+            return spCurrent;
+    }
+
+    int64_t beginTime = GetTimeMicros();
+    std::shared_ptr<CStateSnapshot> spSnapshot(new CStateSnapshot());
+    spSnapshot->cw.CopyFrom(pCdMan);
+    // no batch is frozen under cs_main, the frozen writes of each db match its leveldb snapshot
+    for (auto pDbAccess : pCdMan->GetDbAccesses())
+        spSnapshot->dbSnapshots.emplace(pDbAccess, pDbAccess->NewReadSnapshot());
+
+    spSnapshot->tip_sequence = sequence;
+    if (chainActive.Tip() != nullptr) {
+        spSnapshot->height   = chainActive.Height();
+        spSnapshot->tip_hash = chainActive.Tip()->GetBlockHash();
+        spSnapshot->pTip     = chainActive.Tip();
+    }
+    LogPrint(BCLog::RPC, "CStateSnapshot::GetCurrent, took the snapshot of height=%d in %.2fms\n",
+             spSnapshot->height, 0.001 * (GetTimeMicros() - beginTime));
+
+    std::lock_guard<std::mutex> lock(cs_current);
+    spCurrent = spSnapshot;
+    return spSnapshot;
+}
+
+void CStateSnapshot::OnTipChanged() {
+    ++tipSequence;
+}
+
+void CStateSnapshot::Release() {
+    ++tipSequence;
+    std::lock_guard<std::mutex> lock(cs_current);
+    spCurrent = nullptr;
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_STATESNAPSHOT_H
+#define PERSIST_STATESNAPSHOT_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "cachewrapper.h"
+#include "commons/uint256.h"
+#include "dbaccess.h"
+
+class CBlockIndex;
+
+/**
+ * Immutable view of the committed chain state for the read-only RPCs, which read it without cs_main.
+ * It is a copy of the top level caches of pCdMan with the leveldb snapshots of their dbs, taken by the
+ * first read after a tip change and shared by the reads until the next one.
+ * Every read goes through a CReadView, a cache layer of its own over the copy, so the copy only changes
+ * when a miss fills it from the db snapshots, and the fills are serialized by the lock of the copy.
+ * The cache iterators walk the shared copy, so a scan on a view must hold LockBase() while it iterates.
+ */
+class CStateSnapshot {
+public:
+    CCacheWrapper cw;
+    int32_t height = 0;
+    uint256 tip_hash;
+    CBlockIndex *pTip = nullptr;  // the block indexes are never freed while the node runs
+
+    // the reads of the thread go to the snapshot while it lives, for a cache layer over cw kept across the scopes
+    class CReadScope {
+    public:
+        CReadScope(const std::shared_ptr<CStateSnapshot> &spSnapshotIn);
+
+    protected:
+        std::shared_ptr<CStateSnapshot> spSnapshot;
+
+    private:
+        CDBAccessTracker tracker;
+        CDBAccessTracker::CScope trackerScope;
+        CDBAccess::CSnapshotScope dbScope;
+
+    public:
+        int32_t GetHeight() const { return spSnapshot->height; }
+        const uint256 &GetTipHash() const { return spSnapshot->tip_hash; }
+        // held by the scans of the cache iterators, the point reads take it by themselves on a miss
+        std::unique_lock<std::recursive_mutex> LockBase() {
+            return std::unique_lock<std::recursive_mutex>(spSnapshot->cs_base);
+        }
+    };
+
+    class CReadView : public CReadScope {
+    public:
+        CReadView(const std::shared_ptr<CStateSnapshot> &spSnapshotIn);
+
+        CCacheWrapper cw;
+    };
+
+    // the snapshot of the current tip, taken under cs_main if the tip changed since the last one
+    static std::shared_ptr<CStateSnapshot> GetCurrent();
+    // called under cs_main when the tip changes
+    static void OnTipChanged();
+    // drop the current snapshot before the dbs are closed
+    static void Release();
+
+private:
+    CStateSnapshot() {}
+
+    std::recursive_mutex cs_base;         // serializes the fills of cw by the read views
+    CDBReadSnapshotMap dbSnapshots;
+    uint64_t tip_sequence = 0;           // the value of tipSequence it was taken at
+
+    static std::atomic<uint64_t> tipSequence;
+    static std::mutex cs_current;
+    static std::shared_ptr<CStateSnapshot> spCurrent;
+};
+
+#endif  // PERSIST_STATESNAPSHOT_H
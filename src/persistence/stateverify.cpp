@@ -0,0 +1,172 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stateverify.h"
+
+#include "main.h"
+#include "logging.h"
+#include "entities/account.h"
+#include "entities/asset.h"
+#include "persistence/cachewrapper.h"
+#include "commons/util/util.h"
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+CStateVerifier::CStateVerifier(uint32_t threadsIn) : threads(max<uint32_t>(1, threadsIn)), fStop(false), errorCount(0) {}
+
+void CStateVerifier::AddError(CPartition &partition, const string &error) {
+    if (errorCount++ < MAX_LOGGED_ERRORS)
+        LogPrint(BCLog::ERROR, "CStateVerifier : %s\n", error);
+    partition.errors.push_back(error);
+}
+
+void CStateVerifier::VerifyAccounts(CPartition &partition) {
+    CDBAccess *pAccountDb = pCdMan->pAccountDb;
+    CDBAccess::CSnapshotScope snapshotScope(&snapshots);
+    const string &prefix = dbk::GetKeyPrefix(dbk::KEYID_ACCOUNT);
+
+    auto pCursor = pAccountDb->NewIterator();
+    for (pCursor->Seek(partition.beginKey); pCursor->Valid() && !fStop; pCursor->Next()) {
+        leveldb::Slice slKey = pCursor->key();
+        if (!slKey.starts_with(prefix) || (!partition.endKey.empty() && slKey.compare(partition.endKey) >= 0))
+            break;
+
+        CKeyID keyid;
+        CAccount account;
+        try {
+            if (!dbk::ParseDbKey(slKey, dbk::KEYID_ACCOUNT, keyid))
+                throw ios_base::failure("invalid key");
+            leveldb::Slice slValue = pCursor->value();
+            CSpanReader reader(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            reader >> account;
+        } catch (std::exception &e) {
+            AddError(partition, strprintf("can not read the account of key %s - %s", HexStr(slKey.ToString()), e.what()));
+            continue;
+        }
+        ++partition.accountCount;
+
+        if (account.keyid != keyid)
+            AddError(partition, strprintf("the account of key id %s has the key id %s", keyid.ToString(),
+                                          account.keyid.ToString()));
+
+        if (!account.regid.IsEmpty()) {
+            CKeyID regKeyid;
+            if (!pAccountDb->GetData(dbk::REGID_KEYID, CRegIDKey(account.regid), regKeyid) || regKeyid != keyid)
+                AddError(partition, strprintf("the regid %s of the account %s maps to the key id %s",
+                                              account.regid.ToString(), keyid.ToString(), regKeyid.ToString()));
+        }
+
+        for (const auto &item : account.tokens) {
+            const CAccountToken &token = item.second;
+            uint64_t amount = 0;
+            bool fOverflow  = __builtin_add_overflow(token.free_amount, token.frozen_amount, &amount) ||
+                             __builtin_add_overflow(amount, token.staked_amount, &amount) ||
+                             __builtin_add_overflow(amount, token.voted_amount, &amount);
+            if (fOverflow || !CheckCoinRange(item.first, amount)) {
+                AddError(partition, strprintf("the %s amounts of the account %s are out of range", item.first,
+                                              keyid.ToString()));
+                continue;
+            }
+
+            uint64_t &sum = partition.tokenSums[item.first];
+            if (__builtin_add_overflow(sum, amount, &sum))
+                sum = UINT64_MAX;
+        }
+    }
+    if (!pCursor->status().ok())
+        AddError(partition, strprintf("failed to iterate the accounts from %s", HexStr(partition.beginKey)));
+}
+
+bool CStateVerifier::Run() {
+    int64_t beginTime = GetTimeMillis();
+    int32_t height    = 0;
+    {
+        LOCK(cs_main);
+        if (pCdMan == nullptr || chainActive.Tip() == nullptr)
+            return true;
+
+        auto spCW = CCacheWrapper::NewCopyFrom(pCdMan);
+        snapshots = pCdMan->NewReadSnapshots(*spCW);
+        height    = chainActive.Height();
+    }
+    LogPrint(BCLog::INFO, "CStateVerifier : verify the state of block %d on %u threads\n", height, threads);
+
+    // the key ids are hashes, so the ranges of their first byte split the accounts evenly
+    const string &prefix = dbk::GetKeyPrefix(dbk::KEYID_ACCOUNT);
+    uint32_t partitionCount = min<uint32_t>(256, threads * 4);
+    vector<CPartition> partitions(partitionCount);
+    for (uint32_t i = 0; i < partitionCount; i++) {
+        partitions[i].beginKey = prefix + (char)(i * 256 / partitionCount);
+        if (i + 1 < partitionCount)
+            partitions[i].endKey = prefix + (char)((i + 1) * 256 / partitionCount);
+    }
+    partitions[0].beginKey = prefix;
+
+    std::atomic<uint32_t> next(0);
+    boost::thread_group workers;
+    for (uint32_t t = 0; t < threads; t++) {
+        workers.create_thread([this, &partitions, &next]() {
+            for (uint32_t i = next++; i < partitions.size() && !fStop; i = next++)
+                VerifyAccounts(partitions[i]);
+        });
+    }
+    try {
+        workers.join_all();
+    } catch (boost::thread_interrupted &) {
+        fStop = true;
+        boost::this_thread::disable_interruption noInterruption;
+        workers.join_all();
+        throw;
+    }
+
+    CPartition total;
+    for (auto &partition : partitions) {
+        total.accountCount += partition.accountCount;
+        total.errors.insert(total.errors.end(), partition.errors.begin(), partition.errors.end());
+        for (const auto &item : partition.tokenSums) {
+            uint64_t &sum = total.tokenSums[item.first];
+            if (__builtin_add_overflow(sum, item.second, &sum))
+                sum = UINT64_MAX;
+        }
+    }
+
+    // the supplies of the assets, the system coins have their ranges only
+    {
+        CDBAccess::CSnapshotScope snapshotScope(&snapshots);
+        for (const auto &item : total.tokenSums) {
+            if (!CheckCoinRange(item.first, item.second) || item.second == UINT64_MAX) {
+                AddError(total, strprintf("the sum of the %s amounts %llu is out of range", item.first, item.second));
+                continue;
+            }
+
+            CAsset asset;
+            if (kCoinTypeSet.count(item.first) || !pCdMan->pAssetDb->GetData(dbk::ASSET, item.first, asset) ||
+                asset.mintable)
+                continue;
+
+            if (item.second > asset.total_supply)
+                AddError(total, strprintf("the sum of the %s amounts %llu is above the total supply %llu", item.first,
+                                          item.second, asset.total_supply));
+        }
+    }
+
+    if (!total.errors.empty()) {
+        strMiscWarning = strprintf(_("Warning: The verification of the chain state at block %d found %u errors, "
+                                     "see the log!"), height, total.errors.size());
+        LogPrint(BCLog::ERROR, "CStateVerifier : %u errors in the state of block %d (%dms)\n", total.errors.size(),
+                 height, GetTimeMillis() - beginTime);
+        return false;
+    }
+
+    LogPrint(BCLog::INFO, "CStateVerifier : verified %llu accounts and %u tokens of block %d (%dms)\n",
+             total.accountCount, total.tokenSums.size(), height, GetTimeMillis() - beginTime);
+    return true;
+}
+
+void ThreadVerifyState() {
+    RenameThread("coin-checkstate");
+    CStateVerifier(GetCheckThreadCount()).Run();
+}
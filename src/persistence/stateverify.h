@@ -0,0 +1,59 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_STATEVERIFY_H
+#define PERSIST_STATEVERIFY_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "persistence/dbaccess.h"
+
+static const bool DEFAULT_CHECK_STATE = true;
+
+/**
+ * Verification of the invariants of the chain state in the background after startup (-checkstate),
+ * so the node serves meanwhile. It reads snapshots of the dbs taken at the tip, the accounts are split
+ * into partitions by the first byte of their key id and iterated on -checkthreads threads:
+ *  - the amounts of each token of an account add up within the range of the coin
+ *  - the regid of an account maps back to its key id
+ *  - the sums of each token over all the accounts are in its range, and under the total supply of the
+ *    assets which are not mintable
+ * A failure is logged and raised as the warning of getinfo, the state is not changed.
+ */
+class CStateVerifier {
+public:
+    static const uint32_t MAX_LOGGED_ERRORS = 100;
+
+    explicit CStateVerifier(uint32_t threadsIn);
+
+    // return false if an invariant does not hold, throws boost::thread_interrupted on shutdown
+    bool Run();
+
+private:
+    struct CPartition {
+        std::string beginKey;
+        std::string endKey;  // excluded, empty for the end of the prefix
+        uint64_t accountCount = 0;
+        std::map<std::string, uint64_t> tokenSums;
+        std::vector<std::string> errors;
+    };
+
+    void VerifyAccounts(CPartition &partition);
+    void AddError(CPartition &partition, const std::string &error);
+
+    uint32_t threads;
+    CDBReadSnapshotMap snapshots;
+    std::atomic<bool> fStop;
+    std::atomic<uint32_t> errorCount;
+};
+
+/** Run the state verifier once, on a thread of the node */
+void ThreadVerifyState();
+
+#endif  // PERSIST_STATEVERIFY_H
@@ -4,6 +4,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
 #include <unordered_set>
 #include <string>
 #include <cstdint>
@@ -31,6 +34,23 @@ public:
         governersCache.Flush();
         proposalsCache.Flush();
         secondsCache.Flush();
+
+        // the base holds the changes of this level now
+        if (pBase != nullptr) {
+            if (fGovernersChanged)
+                pBase->OnGovernersChanged();
+            if (fAssentersUndone) {
+                pBase->assentersMap.clear();
+                pBase->fAssentersUndone = true;
+            }
+            for (const auto &proposalId : assentedProposals)
+                pBase->OnAssentersChanged(proposalId, std::move(assentersMap[proposalId]));
+            assentersMap.clear();
+            spGoverners = nullptr;
+        }
+        fGovernersChanged = false;
+        fAssentersUndone  = false;
+        assentedProposals.clear();
         return true;
     }
 
@@ -44,6 +64,12 @@ public:
         governersCache.SetBase(&pBaseIn->governersCache);
         proposalsCache.SetBase(&pBaseIn->proposalsCache);
         secondsCache.SetBase(&pBaseIn->secondsCache);
+        pBase = pBaseIn;
+        spGoverners = nullptr;
+        fGovernersChanged = false;
+        fAssentersUndone  = false;
+        assentersMap.clear();
+        assentedProposals.clear();
     }
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) { 
@@ -54,31 +80,21 @@ public:
 
 
     bool CheckIsGoverner(const CRegID &candidateRegId) {
-        if (!governersCache.HaveData()) {
+        auto spGovernersIn = GetGovernerSet();
+        if (!spGovernersIn->fHaveData)
             return candidateRegId == CRegID(SysCfg().GetStableCoinGenesisHeight(), 2);
-        } else {
-            vector<CRegID> regids;
-            if(governersCache.GetData(regids)){
-                auto itr = find(regids.begin(), regids.end(), candidateRegId);
-                return ( itr != regids.end());
-            }
-            else
-                return false ;
-        }
+
+        return spGovernersIn->regids.count(candidateRegId) > 0;
     }
 
 
     uint8_t GetNeedGovernerCount(){
-        if (!governersCache.HaveData()) {
-            return 1 ;
-        } else {
-            vector<CRegID> regids;
-            if(governersCache.GetData(regids)){
-                uint8_t cnt = (regids.size()/3)*2 +2 ;
-                return cnt>regids.size()?regids.size():cnt;
-            } else
-                return 1 ;
-        }
+        auto spGovernersIn = GetGovernerSet();
+        if (!spGovernersIn->fHaveData)
+            return 1;
+
+        uint8_t cnt = (spGovernersIn->count/3)*2 +2 ;
+        return cnt>spGovernersIn->count?spGovernersIn->count:cnt;
     }
 
     bool SetProposal(const uint256& txid,  shared_ptr<CProposal>& proposal ){
@@ -97,23 +113,29 @@ public:
     }
 
     int GetAssentionCount(const uint256& proposalId){
-        vector<CRegID> v ;
-        secondsCache.GetData(proposalId, v) ;
-        return  v.size();
+        return GetAssenters(proposalId).size();
     }
     bool SetAssention(const uint256 &proposalId, const CRegID &governer){
 
-        vector<CRegID> v  ;
-        if(secondsCache.GetData(proposalId, v)){
-            if(find(v.begin(),v.end(),governer) != v.end()){
-                return ERRORMSG("governer(regid= %s) had assented this proposal(proposalid=%s)", governer.ToString(), proposalId.ToString());
-            }
+        set<CRegID> &assenters = GetAssenters(proposalId);
+        if (assenters.count(governer)) {
+            return ERRORMSG("governer(regid= %s) had assented this proposal(proposalid=%s)", governer.ToString(), proposalId.ToString());
         }
+
+        // the record keeps its layout of the assenters in order of assention
+        vector<CRegID> v  ;
+        secondsCache.GetData(proposalId, v);
         v.push_back(governer) ;
-        return secondsCache.SetData(proposalId,v) ;
+        if (!secondsCache.SetData(proposalId, v))
+            return false;
+
+        assenters.insert(governer);
+        assentedProposals.insert(proposalId);
+        return true;
     }
 
     bool SetGoverners(const vector<CRegID> &governers){
+        OnGovernersChanged();
         return governersCache.SetData(governers) ;
     }
     bool GetGoverners(vector<CRegID>& governers){
@@ -124,8 +146,82 @@ public:
         governersCache.RegisterUndoFunc(undoDataFuncMap);
         proposalsCache.RegisterUndoFunc(undoDataFuncMap);
         secondsCache.RegisterUndoFunc(undoDataFuncMap);
+
+        // the undo writes the caches directly, the governers and the assenters derived from them are read again
+        auto undoGoverners = undoDataFuncMap[dbk::SYS_GOVERN];
+        undoDataFuncMap[dbk::SYS_GOVERN] = [this, undoGoverners](const CDbOpLogs &dbOpLogs) {
+            undoGoverners(dbOpLogs);
+            OnGovernersChanged();
+        };
+        auto undoSeconds = undoDataFuncMap[dbk::GOVN_SECOND];
+        undoDataFuncMap[dbk::GOVN_SECOND] = [this, undoSeconds](const CDbOpLogs &dbOpLogs) {
+            undoSeconds(dbOpLogs);
+            assentersMap.clear();
+            assentedProposals.clear();
+            fAssentersUndone = true;
+        };
     }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        governersCache.RegisterReadFunc(readDataFuncMap);
+        proposalsCache.RegisterReadFunc(readDataFuncMap);
+        secondsCache.RegisterReadFunc(readDataFuncMap);
+    }
+
 private:
+    // the governers as a set for the assention txs of a block, each of which checks its sender is one
+    struct CGovernerSet {
+        bool fHaveData = false;
+        uint32_t count = 0;  // the size of the governers list
+        set<CRegID> regids;
+    };
+
+    // A level which has not changed the governers reads the set of its base, shared by the txs of a block
+    // executed on their own levels. The set of a level is built on its first read and dropped when the level
+    // or a level flushed to it changes the governers.
+    shared_ptr<const CGovernerSet> GetGovernerSet() {
+        if (pBase != nullptr && !fGovernersChanged) {
+            if (CDBAccessTracker::GetCurrent() != nullptr)
+                CDBAccessTracker::GetCurrent()->OnReadSingle(dbk::SYS_GOVERN);
+            auto baseLock = CDBAccessTracker::LockBase();
+            return pBase->GetGovernerSet();
+        }
+
+        if (!spGoverners) {
+            auto spNewGoverners = make_shared<CGovernerSet>();
+            vector<CRegID> regids;
+            if (governersCache.GetData(regids)) {
+                spNewGoverners->fHaveData = true;
+                spNewGoverners->count     = regids.size();
+                spNewGoverners->regids.insert(regids.begin(), regids.end());
+            }
+            spGoverners = spNewGoverners;
+        }
+        return spGoverners;
+    }
+
+    void OnGovernersChanged() {
+        fGovernersChanged = true;
+        spGoverners = nullptr;
+    }
+
+    // The assenters of the proposal seen by this level, read from secondsCache once and kept along with the
+    // writes of it, so an assention is counted without reading and searching the list of the record
+    set<CRegID> &GetAssenters(const uint256 &proposalId) {
+        auto it = assentersMap.find(proposalId);
+        if (it == assentersMap.end()) {
+            vector<CRegID> v;
+            secondsCache.GetData(proposalId, v);
+            it = assentersMap.emplace(proposalId, set<CRegID>(v.begin(), v.end())).first;
+        }
+        return it->second;
+    }
+
+    void OnAssentersChanged(const uint256 &proposalId, set<CRegID> &&assenters) {
+        assentersMap[proposalId] = std::move(assenters);
+        assentedProposals.insert(proposalId);
+    }
+
 /*  CSimpleKVCache          prefixType             value           variable           */
 /*  -------------------- --------------------   -------------   --------------------- */
     CSimpleKVCache< dbk::SYS_GOVERN,            vector<CRegID>>        governersCache;    // list of governers
@@ -137,4 +233,11 @@ private:
     CCompositeKVCache< dbk::GOVN_PROP,             uint256,                    CProposalStorageBean>          proposalsCache;
     // sgvn{txid}{regid} -> 1
     CCompositeKVCache< dbk::GOVN_SECOND,           uint256,     vector<CRegID> >            secondsCache;
+
+    CSysGovernDBCache *pBase = nullptr;
+    shared_ptr<const CGovernerSet> spGoverners;
+    bool fGovernersChanged = false;  // the governers of this level are not the ones of its base
+    map<uint256, set<CRegID>> assentersMap;
+    set<uint256> assentedProposals;  // the proposals of assentersMap assented on this level, given to the base
+    bool fAssentersUndone = false;   // the assenters of the base are not known after an undo of this level
 };
\ No newline at end of file
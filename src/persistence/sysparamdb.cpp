@@ -0,0 +1,82 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// sysparamdb.h has no include guard and depends on the headers before it in cachewrapper.h
+#include "cachewrapper.h"
+
+#include "config/txbase.h"
+#include "logging.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// the root whose snapshot is published, its snapshots are only built under cs_main
+static std::atomic<const CSysParamDBCache *> pSnapshotRoot(nullptr);
+static std::atomic<const CSysParamSnapshot *> pCurrentSnapshot(nullptr);
+
+// a reader may still hold a replaced snapshot, they are kept until shutdown, one per governance change
+static std::mutex csSnapshots;
+static std::vector<std::unique_ptr<const CSysParamSnapshot>> snapshots;
+
+CSysParamDBCache::~CSysParamDBCache() {
+    if (pSnapshotRoot.load() != this)
+        return;
+
+    pSnapshotRoot    = nullptr;
+    pCurrentSnapshot = nullptr;
+    std::lock_guard<std::mutex> lock(csSnapshots);
+    snapshots.clear();
+}
+
+void CSysParamDBCache::EnableParamSnapshot() {
+    assert(pBaseCache == nullptr);
+    pSnapshotRoot = this;
+    RefreshParamSnapshot();
+}
+
+void CSysParamDBCache::RefreshParamSnapshot() {
+    if (pSnapshotRoot.load() != this)
+        return;
+
+    hasParamWrites = false;
+    std::unique_ptr<CSysParamSnapshot> spSnapshot(new CSysParamSnapshot());
+    spSnapshot->pRoot = this;
+    spSnapshot->params.fill(0);
+    for (const auto &item : SysParamTable) {
+        if (ReadParam(item.first, spSnapshot->params[item.first]))
+            spSnapshot->hasParams.set(item.first);
+    }
+
+    for (const auto &item : kTxFeeTable) {
+        for (const auto &feeSymbol : kFeeSymbolSet) {
+            auto key = std::make_pair((uint8_t)item.first, feeSymbol);
+            uint64_t fee;
+            auto &minerFee = spSnapshot->minerFees[key];
+            if (ReadMinerFee(key, fee))
+                minerFee = fee;
+        }
+    }
+
+    pCurrentSnapshot = spSnapshot.get();
+    std::lock_guard<std::mutex> lock(csSnapshots);
+    snapshots.push_back(std::move(spSnapshot));
+    LogPrint(BCLog::DEBUG, "%s(), published the sys param snapshot %u\n", __func__, snapshots.size());
+}
+
+const CSysParamSnapshot *CSysParamDBCache::GetParamSnapshot() const {
+    const CSysParamSnapshot *pSnapshot = pCurrentSnapshot.load(std::memory_order_acquire);
+    if (pSnapshot == nullptr)
+        return nullptr;
+
+    // the shared base of the parallel executor may be written by the merges meanwhile
+    auto baseLock = CDBAccessTracker::LockBase();
+    const CSysParamDBCache *pCache = this;
+    for (; pCache->pBaseCache != nullptr; pCache = pCache->pBaseCache) {
+        if (pCache->hasParamWrites)
+            return nullptr;
+    }
+    return (pCache == pSnapshot->pRoot && !pCache->hasParamWrites) ? pSnapshot : nullptr;
+}
@@ -7,7 +7,10 @@
 #include "persistence/dbaccess.h"
 #include "persistence/dbconf.h"
 
+#include <array>
+#include <bitset>
 #include <cstdint>
+#include <optional>
 #include <unordered_map>
 #include <string>
 #include <cstdint>
@@ -40,6 +43,20 @@ struct CCdpInterestParamChange {
     uint64_t param_b = 0;
 };
 
+class CSysParamDBCache;
+
+/**
+ * The sys params and the miner fees of the root cache of the node, immutable once published. The
+ * miner fees are kept for the tx types of kTxFeeTable and the symbols of kFeeSymbolSet, with or
+ * without a value set by a proposal.
+ */
+struct CSysParamSnapshot {
+    const CSysParamDBCache *pRoot = nullptr;
+    std::array<uint64_t, 256> params;
+    std::bitset<256> hasParams;  // the types of SysParamTable
+    std::map<pair<uint8_t, string>, std::optional<uint64_t>> minerFees;
+};
+
 class CSysParamDBCache {
 public:
     CSysParamDBCache() {}
@@ -50,9 +67,34 @@ public:
     CSysParamDBCache(CSysParamDBCache *pBaseIn) : sysParamCache(pBaseIn->sysParamCache),
                                                   minerFeeCache(pBaseIn->minerFeeCache),
                                                   cdpParamCache(pBaseIn->cdpParamCache),
-                                                  cdpInterestParamChangesCache(){}
+                                                  cdpInterestParamChangesCache(),
+                                                  pBaseCache(pBaseIn){}
+    ~CSysParamDBCache();
+
+    /**
+     * The sys params and miner fees are read from the published snapshot while neither this cache nor
+     * its bases have written them. The snapshot is rebuilt only when the writes of a proposal or of
+     * its undo are flushed into the root, i.e. the top-level cache of pCdMan.
+     */
+    void EnableParamSnapshot();
+    void RefreshParamSnapshot();
 
     bool GetParam(const SysParamType &paramType, uint64_t& paramValue) {
+        const CSysParamSnapshot *pSnapshot = GetParamSnapshot();
+        if (pSnapshot != nullptr) {
+            if (!pSnapshot->hasParams[paramType])
+                return false;
+
+            if (CDBAccessTracker::GetCurrent() != nullptr)
+                CDBAccessTracker::GetCurrent()->OnRead(dbk::SYS_PARAM, (uint8_t)paramType);
+            paramValue = pSnapshot->params[paramType];
+            return true;
+        }
+        return ReadParam(paramType, paramValue);
+    }
+
+private:
+    bool ReadParam(const SysParamType &paramType, uint64_t& paramValue) {
         if (SysParamTable.count(paramType) == 0)
             return false;
 
@@ -68,6 +110,19 @@ public:
         return true;
     }
 
+    bool ReadMinerFee(const pair<uint8_t, string> &key, uint64_t& feeSawiAmount) {
+        CVarIntValue<uint64_t > value ;
+        bool result =  minerFeeCache.GetData(key , value) ;
+
+        if(result)
+            feeSawiAmount = value.get();
+        return result ;
+    }
+
+    // the snapshot if this cache and its bases up to its root have no param writes
+    const CSysParamSnapshot *GetParamSnapshot() const;
+
+public:
     bool GetCdpParam(const CCdpCoinPair& coinPair, const CdpParamType &paramType, uint64_t& paramValue) {
         if (CdpParamTable.count(paramType) == 0)
             return false;
@@ -87,12 +142,22 @@ public:
     bool Flush() {
         sysParamCache.Flush();
         minerFeeCache.Flush();
+        if (hasParamWrites) {
+            hasParamWrites = false;
+            if (pBaseCache == nullptr)
+                RefreshParamSnapshot();
+            else if (pBaseCache->pBaseCache == nullptr)
+                pBaseCache->RefreshParamSnapshot();
+            else
+                pBaseCache->hasParamWrites = true;
+        }
         return true;
     }
 
     uint32_t GetCacheSize() const { return sysParamCache.GetCacheSize() + minerFeeCache.GetCacheSize(); }
 
     void SetBaseViewPtr(CSysParamDBCache *pBaseIn) {
+        pBaseCache = pBaseIn;
         sysParamCache.SetBase(&pBaseIn->sysParamCache);
         minerFeeCache.SetBase(&pBaseIn->minerFeeCache);
         cdpParamCache.SetBase(&pBaseIn->cdpParamCache);
@@ -111,8 +176,25 @@ public:
         minerFeeCache.RegisterUndoFunc(undoDataFuncMap);
         cdpParamCache.RegisterUndoFunc(undoDataFuncMap);
         cdpInterestParamChangesCache.RegisterUndoFunc(undoDataFuncMap);
+
+        // the undone params differ from the snapshot as the written ones do
+        for (auto prefixType : {sysParamCache.GetPrefixType(), minerFeeCache.GetPrefixType()}) {
+            auto undoFunc = undoDataFuncMap[prefixType];
+            undoDataFuncMap[prefixType] = [this, undoFunc](const CDbOpLogs &dbOpLogs) {
+                hasParamWrites = true;
+                undoFunc(dbOpLogs);
+            };
+        }
+    }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        sysParamCache.RegisterReadFunc(readDataFuncMap);
+        minerFeeCache.RegisterReadFunc(readDataFuncMap);
+        cdpParamCache.RegisterReadFunc(readDataFuncMap);
+        cdpInterestParamChangesCache.RegisterReadFunc(readDataFuncMap);
     }
     bool SetParam(const SysParamType& key, const uint64_t& value){
+        hasParamWrites = true;
         return sysParamCache.SetData(key, CVarIntValue(value)) ;
     }
 
@@ -123,6 +205,7 @@ public:
     bool SetMinerFee( const TxType txType, const string feeSymbol, const uint64_t feeSawiAmount) {
 
         auto pa = std::make_pair(txType, feeSymbol) ;
+        hasParamWrites = true;
         return minerFeeCache.SetData(pa , CVarIntValue(feeSawiAmount)) ;
 
     }
@@ -195,12 +278,18 @@ public:
     bool GetMinerFee( const uint8_t txType, const string feeSymbol, uint64_t& feeSawiAmount) {
 
         auto pa = std::make_pair(txType, feeSymbol) ;
-        CVarIntValue<uint64_t > value ;
-        bool result =  minerFeeCache.GetData(pa , value) ;
-
-        if(result)
-            feeSawiAmount = value.get();
-        return result ;
+        const CSysParamSnapshot *pSnapshot = GetParamSnapshot();
+        if (pSnapshot != nullptr) {
+            auto it = pSnapshot->minerFees.find(pa);
+            if (it != pSnapshot->minerFees.end()) {
+                if (CDBAccessTracker::GetCurrent() != nullptr)
+                    CDBAccessTracker::GetCurrent()->OnRead(dbk::MINER_FEE, pa);
+                if (it->second)
+                    feeSawiAmount = *it->second;
+                return it->second.has_value();
+            }
+        }
+        return ReadMinerFee(pa, feeSawiAmount);
     }
 
 
@@ -217,4 +306,8 @@ public:
     // [prefix]cdp_coin_pair -> cdp_interest_param_changes (contain all changes)
     CCompositeKVCache< dbk::CDP_INTEREST_PARAMS, CCdpCoinPair, CCdpInterestParamChangeMap> cdpInterestParamChangesCache;
 
+private:
+    CSysParamDBCache *pBaseCache = nullptr;  // null for the root
+    bool hasParamWrites = false;             // the sys params or miner fees written or undone, not yet flushed
+
 };
\ No newline at end of file
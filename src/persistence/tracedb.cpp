@@ -0,0 +1,78 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "tracedb.h"
+
+#include "config/chainparams.h"
+#include "dbiterator.h"
+
+bool CTraceDBCache::IsEnabled() {
+    static const bool fEnabled = SysCfg().GetBoolArg("-wasmtraces", DEFAULT_WASM_TRACES);
+    return fEnabled;
+}
+
+uint64_t CTraceDBCache::GetMaxSize() {
+    static const uint64_t maxSize =
+        (uint64_t)max<int64_t>(0, SysCfg().GetArg("-wasmtracesmaxsize", DEFAULT_WASM_TRACES_MAX_SIZE)) << 20;
+    return maxSize;
+}
+
+bool CTraceDBCache::GetContractTraces(const uint256 &txid, string &contractTraces) {
+    return traceCache.GetData(txid, contractTraces);
+}
+
+bool CTraceDBCache::SetContractTraces(const uint256 &txid, const string &contractTraces) {
+    if (!IsEnabled())
+        return true;
+
+    return traceCache.SetData(txid, contractTraces);
+}
+
+void CTraceDBCache::OnBlockConnected(int32_t height, const vector<uint256> &txids) {
+    uint64_t maxSize = GetMaxSize();
+    if (!IsEnabled() || maxSize == 0)
+        return;
+
+    uint64_t totalSize = 0;
+    sizeCache.GetData(totalSize);
+
+    vector<uint256> tracedTxids;
+    for (const auto &txid : txids) {
+        string trace;
+        if (traceCache.GetData(txid, trace)) {
+            tracedTxids.push_back(txid);
+            totalSize += trace.size();
+        }
+    }
+    if (!tracedTxids.empty())
+        blockTxidsCache.SetData(CFixedUInt32(height), tracedTxids);
+
+    // the oldest indexed blocks go first, the traces written before the max size was set have no index
+    // and are kept
+    if (totalSize > maxSize) {
+        vector<std::pair<CFixedUInt32, vector<uint256>>> erasedBlocks;
+        CDBIterator<decltype(blockTxidsCache)> it(blockTxidsCache);
+        for (it.First(); it.IsValid() && totalSize > maxSize && it.GetKey() < CFixedUInt32(height); it.Next()) {
+            erasedBlocks.emplace_back(it.GetKey(), it.GetValue());
+            for (const auto &txid : it.GetValue()) {
+                string trace;
+                if (traceCache.GetData(txid, trace))
+                    totalSize -= min<uint64_t>(totalSize, trace.size());
+            }
+        }
+
+        for (const auto &item : erasedBlocks) {
+            for (const auto &txid : item.second)
+                traceCache.EraseData(txid);
+            blockTxidsCache.EraseData(item.first);
+        }
+    }
+    sizeCache.SetData(totalSize);
+}
+
+void CTraceDBCache::Flush() {
+    traceCache.Flush();
+    blockTxidsCache.Flush();
+    sizeCache.Flush();
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_TRACEDB_H
+#define PERSIST_TRACEDB_H
+
+#include "commons/leb128.h"
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+#include "dbaccess.h"
+#include "dbconf.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * The traces of the wasm txs, packed by wasm::pack, in the traces db of their own so they stay out of the
+ * compactions of the contract state. The db is compressed by default, see -traces.compression.
+ */
+class CTraceDBCache {
+public:
+    CTraceDBCache() {}
+    CTraceDBCache(CDBAccess *pDbAccess) : traceCache(pDbAccess), blockTxidsCache(pDbAccess), sizeCache(pDbAccess) {}
+
+public:
+    // Whether the traces are stored, by -wasmtraces
+    static bool IsEnabled();
+    // The bytes of the traces kept by -wasmtracesmaxsize, 0 for all
+    static uint64_t GetMaxSize();
+
+    bool GetContractTraces(const uint256 &txid, string &contractTraces);
+    bool SetContractTraces(const uint256 &txid, const string &contractTraces);
+
+    // Called by ConnectBlock() with the txids of the wasm txs of the block: index the traces of the block by
+    // the height and erase the traces of the oldest blocks until the traces fit in the max size. The writes
+    // are logged in the undo of the block, so the index and the size follow the chain on a reorg
+    void OnBlockConnected(int32_t height, const vector<uint256> &txids);
+
+    void Flush();
+
+    uint32_t GetCacheSize() const {
+        return traceCache.GetCacheSize() + blockTxidsCache.GetCacheSize() + sizeCache.GetCacheSize();
+    }
+
+    void SetBaseViewPtr(CTraceDBCache *pBaseIn) {
+        traceCache.SetBase(&pBaseIn->traceCache);
+        blockTxidsCache.SetBase(&pBaseIn->blockTxidsCache);
+        sizeCache.SetBase(&pBaseIn->sizeCache);
+    }
+
+    void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
+        traceCache.SetDbOpLogMap(pDbOpLogMapIn);
+        blockTxidsCache.SetDbOpLogMap(pDbOpLogMapIn);
+        sizeCache.SetDbOpLogMap(pDbOpLogMapIn);
+    }
+
+    void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
+        traceCache.RegisterUndoFunc(undoDataFuncMap);
+        blockTxidsCache.RegisterUndoFunc(undoDataFuncMap);
+        sizeCache.RegisterUndoFunc(undoDataFuncMap);
+    }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        traceCache.RegisterReadFunc(readDataFuncMap);
+        blockTxidsCache.RegisterReadFunc(readDataFuncMap);
+        sizeCache.RegisterReadFunc(readDataFuncMap);
+    }
+
+public:
+/*       type               prefixType                  key                value                 variable          */
+/*  ----------------   ----------------------------   ---------------   ------------------   ------------------- */
+    // txid -> contract_traces
+    CCompositeKVCache< dbk::CONTRACT_TRACES,          uint256,          string >             traceCache;
+    // height -> txids of the traces of the block, written with a max size only
+    CCompositeKVCache< dbk::CONTRACT_TRACES_HEIGHT,   CFixedUInt32,     vector<uint256> >    blockTxidsCache;
+    // bytes of the traces of the indexed blocks
+    CSimpleKVCache< dbk::CONTRACT_TRACES_SIZE,        uint64_t >                             sizeCache;
+};
+
+#endif  // PERSIST_TRACEDB_H
@@ -14,53 +14,168 @@
 
 #include <algorithm>
 
+void CTxidWindowIndex::Insert(const uint256 &txid, int32_t height) {
+    if ((count + 1) * 2 > slots.size())
+        Resize(max<size_t>(64, slots.size() * 2));
+
+    uint64_t shortId = hasher(txid);
+    size_t i         = shortId & (slots.size() - 1);
+    while (slots[i].height != EMPTY_HEIGHT)
+        i = (i + 1) & (slots.size() - 1);
+    slots[i] = {shortId, height};
+    ++count;
+}
+
+void CTxidWindowIndex::Erase(const uint256 &txid, int32_t height) {
+    if (slots.empty())
+        return;
+
+    size_t mask      = slots.size() - 1;
+    uint64_t shortId = hasher(txid);
+    size_t i         = shortId & mask;
+    for (; slots[i].height != EMPTY_HEIGHT; i = (i + 1) & mask) {
+        if (slots[i].shortId == shortId && slots[i].height == height)
+            break;
+    }
+    if (slots[i].height == EMPTY_HEIGHT)
+        return;
+
+    // shift the following slots of the probe sequence back into the hole, no tombstone is left
+    for (size_t j = (i + 1) & mask; slots[j].height != EMPTY_HEIGHT; j = (j + 1) & mask) {
+        size_t home = slots[j].shortId & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            slots[i] = slots[j];
+            i        = j;
+        }
+    }
+    slots[i].height = EMPTY_HEIGHT;
+    --count;
+}
+
+void CTxidWindowIndex::Clear() {
+    vector<Slot>().swap(slots);
+    count = 0;
+}
+
+void CTxidWindowIndex::Resize(size_t size) {
+    vector<Slot> oldSlots(size, Slot{0, EMPTY_HEIGHT});
+    oldSlots.swap(slots);
+    for (const auto &slot : oldSlots) {
+        if (slot.height == EMPTY_HEIGHT)
+            continue;
+
+        size_t i = slot.shortId & (slots.size() - 1);
+        while (slots[i].height != EMPTY_HEIGHT)
+            i = (i + 1) & (slots.size() - 1);
+        slots[i] = slot;
+    }
+}
+
 bool CTxMemCache::AddBlockTx(const CBlock &block) {
+    auto pBlockTxids       = std::make_shared<CBlockTxids>();
+    pBlockTxids->blockHash = block.GetHash();
+    pBlockTxids->txids.reserve(block.vptx.size());
     for (auto &ptx : block.vptx) {
-        txids.insert(ptx->GetHash());
+        pBlockTxids->txids.push_back(ptx->GetHash());
     }
+    sort(pBlockTxids->txids.begin(), pBlockTxids->txids.end());
+
+    SetBlock(block.GetHeight(), pBlockTxids);
     return true;
 }
 
 bool CTxMemCache::RemoveBlockTx(const CBlock &block) {
-    for (auto &ptx : block.vptx) {
-        txids.erase(ptx->GetHash());
-    }
+    SetBlock(block.GetHeight(), nullptr);
     return true;
 }
 
-bool CTxMemCache::HaveTx(const uint256 &txid) {
-    bool found = txids.count(txid) > 0;
-    if (found)
+void CTxMemCache::SetBlock(int32_t height, const BlockTxidsPtr &pBlockTxids) {
+    auto it = blocks.find(height);
+    if (it != blocks.end() && it->second) {
+        for (const auto &txid : it->second->txids)
+            index.Erase(txid, height);
+    }
+
+    // the bottom layer has no block to hide
+    if (pBlockTxids == nullptr && pBase == nullptr) {
+        if (it != blocks.end())
+            blocks.erase(it);
+        return;
+    }
+
+    blocks[height] = pBlockTxids;
+    if (pBlockTxids) {
+        for (const auto &txid : pBlockTxids->txids)
+            index.Insert(txid, height);
+    }
+}
+
+int32_t CTxMemCache::FindTx(const uint256 &txid) const {
+    int32_t found = -1;
+    index.ForEachCandidate(txid, [&](int32_t height) {
+        auto it = blocks.find(height);
+        if (it == blocks.end() || !it->second ||
+            !binary_search(it->second->txids.begin(), it->second->txids.end(), txid))
+            return false;
+
+        found = height;
         return true;
-    else if (pBase == nullptr) {
-        return false;
-    } else
-        return pBase->HaveTx(txid);
+    });
+    if (found >= 0 || pBase == nullptr)
+        return found;
+
+    // the block of the base may be disconnected or replaced in this layer
+    int32_t height = pBase->FindTx(txid);
+    return (height >= 0 && blocks.count(height) == 0) ? height : -1;
 }
 
-void CTxMemCache::BatchWrite(const UnorderedHashSet &txidsIn) {
-    txids.clear();
+bool CTxMemCache::HaveTx(const uint256 &txid) {
+    return FindTx(txid) >= 0;
+}
 
-    for (const auto &txid : txidsIn) {
-        txids.insert(txid);
-    }
+void CTxMemCache::BatchWrite(const map<int32_t, BlockTxidsPtr> &blocksIn) {
+    for (const auto &item : blocksIn)
+        SetBlock(item.first, item.second);
 }
 
 void CTxMemCache::Flush() {
     assert(pBase);
 
-    pBase->BatchWrite(txids);
-    txids.clear();
+    pBase->BatchWrite(blocks);
+    Clear();
 }
 
-void CTxMemCache::Clear() { txids.clear(); }
+void CTxMemCache::Clear() {
+    blocks.clear();
+    index.Clear();
+}
 
-uint64_t CTxMemCache::GetSize() { return txids.size(); }
+uint64_t CTxMemCache::GetSize() { return index.Size(); }
+
+map<int32_t, CBlockTxids> CTxMemCache::GetBlocks() const {
+    map<int32_t, CBlockTxids> blocksOut;
+    for (const auto &item : blocks) {
+        if (item.second)
+            blocksOut.emplace(item.first, *item.second);
+    }
+    return blocksOut;
+}
+
+void CTxMemCache::SetBlocks(map<int32_t, CBlockTxids> &&blocksIn) {
+    Clear();
+    for (auto &item : blocksIn) {
+        sort(item.second.txids.begin(), item.second.txids.end());
+        SetBlock(item.first, std::make_shared<const CBlockTxids>(std::move(item.second)));
+    }
+}
 
 Object CTxMemCache::ToJsonObj() const {
     Array txArray;
-    for (auto &txid : txids) {
-        txArray.push_back(txid.ToString());
+    for (const auto &item : blocks) {
+        if (!item.second)
+            continue;
+        for (const auto &txid : item.second->txids)
+            txArray.push_back(txid.ToString());
     }
 
     Object txCacheObj;
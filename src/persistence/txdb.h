@@ -15,11 +15,71 @@
 #include "block.h"
 
 #include <map>
+#include <memory>
 #include <vector>
 
 using namespace std;
 using namespace json_spirit;
 
+/** The txids of one block of the tx cache, sorted in a flat array */
+struct CBlockTxids {
+    uint256 blockHash;
+    vector<uint256> txids;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(txids);
+    )
+};
+
+/**
+ * Open addressing index of the txids of a tx cache layer. A slot holds the salted 64 bit hash of a txid and the
+ * height of its block, so there is no allocation per tx and a lookup allocates nothing. The hashes may collide,
+ * a match is only a candidate to be confirmed in the txids of the block.
+ */
+class CTxidWindowIndex {
+public:
+    CTxidWindowIndex() : count(0) {}
+
+    void Insert(const uint256 &txid, int32_t height);
+    void Erase(const uint256 &txid, int32_t height);
+    void Clear();
+    size_t Size() const { return count; }
+
+    // call fn(height) for the heights of the candidates of the txid until it returns true
+    template <typename Fn>
+    bool ForEachCandidate(const uint256 &txid, Fn fn) const {
+        if (slots.empty())
+            return false;
+
+        uint64_t shortId = hasher(txid);
+        for (size_t i = shortId & (slots.size() - 1); slots[i].height != EMPTY_HEIGHT; i = (i + 1) & (slots.size() - 1)) {
+            if (slots[i].shortId == shortId && fn(slots[i].height))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    static const int32_t EMPTY_HEIGHT = -1;
+
+    struct Slot {
+        uint64_t shortId;
+        int32_t height;
+    };
+
+    void Resize(size_t size);
+
+    vector<Slot> slots;  // a power of 2 in size, at most half full
+    size_t count;
+    CSaltedUint256Hasher hasher;
+};
+
+/**
+ * The txids of the latest blocks for the duplicate-tx check. They are bucketed by the height of their block, so a
+ * block leaving the window is dropped with its array. A child layer holds the blocks connected over its base and
+ * an empty bucket for each block of the base it disconnected, the buckets replace those of the base on Flush().
+ */
 class CTxMemCache {
 public:
     CTxMemCache() : pBase(nullptr) {}
@@ -38,13 +98,22 @@ public:
     Object ToJsonObj() const;
     uint64_t GetSize();
 
+    // the blocks of this layer by height, to snapshot the cache
+    map<int32_t, CBlockTxids> GetBlocks() const;
+    void SetBlocks(map<int32_t, CBlockTxids> &&blocksIn);
+
 private:
-    bool HaveBlock(const uint256 &blockHash) const;
-    bool HaveBlock(const CBlock &block);
-    void BatchWrite(const UnorderedHashSet &mapBlockTxHashSetIn);
+    typedef std::shared_ptr<const CBlockTxids> BlockTxidsPtr;
+
+    // the height of the block of the txid, -1 if not in the cache
+    int32_t FindTx(const uint256 &txid) const;
+    void SetBlock(int32_t height, const BlockTxidsPtr &pBlockTxids);
+    void BatchWrite(const map<int32_t, BlockTxidsPtr> &blocksIn);
 
 private:
-    UnorderedHashSet txids;
+    // a null bucket hides the block of the base at the height
+    map<int32_t, BlockTxidsPtr> blocks;
+    CTxidWindowIndex index;
     CTxMemCache *pBase;
 };
 
@@ -10,14 +10,51 @@ bool CTxReceiptDBCache::SetTxReceipts(const TxID &txid, const vector<CReceipt> &
     if (!SysCfg().IsGenReceipt())
         return true;
 
-    return txReceiptCache.SetData(txid, receipts);
+    return txReceiptCache.SetData(txid, CTxReceipts(receipts));
 }
 
 bool CTxReceiptDBCache::GetTxReceipts(const TxID &txid, vector<CReceipt> &receipts) {
     if (!SysCfg().IsGenReceipt())
         return false;
 
-    return txReceiptCache.GetData(txid, receipts);
+    CTxReceipts txReceipts;
+    if (!txReceiptCache.GetData(txid, txReceipts))
+        return false;
+
+    receipts = std::move(txReceipts.receipts);
+    return true;
+}
+
+int32_t CTxReceiptDBCache::GetRetention() {
+    static const int32_t retention = max<int64_t>(0, SysCfg().GetArg("-receiptretention", DEFAULT_RECEIPT_RETENTION));
+    return retention;
+}
+
+void CTxReceiptDBCache::OnBlockConnected(int32_t height, const vector<TxID> &txids) {
+    int32_t retention = GetRetention();
+    if (!SysCfg().IsGenReceipt() || retention <= 0)
+        return;
+
+    vector<TxID> receiptTxids;
+    for (const auto &txid : txids) {
+        if (txReceiptCache.HaveData(txid))
+            receiptTxids.push_back(txid);
+    }
+    if (!receiptTxids.empty())
+        blockTxidsCache.SetData(CFixedUInt32(height), receiptTxids);
+
+    // the receipts of a block written before the window was set are kept, they have no index
+    int32_t pruneHeight = height - retention;
+    vector<TxID> prunedTxids;
+    if (pruneHeight <= 0 || !blockTxidsCache.GetData(CFixedUInt32(pruneHeight), prunedTxids))
+        return;
+
+    for (const auto &txid : prunedTxids)
+        txReceiptCache.EraseData(txid);
+    blockTxidsCache.EraseData(CFixedUInt32(pruneHeight));
 }
 
-void CTxReceiptDBCache::Flush() { txReceiptCache.Flush(); }
+void CTxReceiptDBCache::Flush() {
+    txReceiptCache.Flush();
+    blockTxidsCache.Flush();
+}
@@ -20,30 +20,50 @@ using namespace std;
 class CTxReceiptDBCache {
 public:
     CTxReceiptDBCache() {}
-    CTxReceiptDBCache(CDBAccess *pDbAccess) : txReceiptCache(pDbAccess) {}
+    CTxReceiptDBCache(CDBAccess *pDbAccess) : txReceiptCache(pDbAccess), blockTxidsCache(pDbAccess) {}
 
 public:
     bool SetTxReceipts(const TxID &txid, const vector<CReceipt> &receipts);
 
     bool GetTxReceipts(const TxID &txid, vector<CReceipt> &receipts);
 
+    // The blocks of receipts kept by -receiptretention, 0 for all
+    static int32_t GetRetention();
+    // Called on the top level cache once the block of the height is connected: index the txids of its
+    // receipts by the height and erase the receipts of the block falling out of the retention window
+    void OnBlockConnected(int32_t height, const vector<TxID> &txids);
+
     void Flush();
 
-    uint32_t GetCacheSize() const { return txReceiptCache.GetCacheSize(); }
+    uint32_t GetCacheSize() const { return txReceiptCache.GetCacheSize() + blockTxidsCache.GetCacheSize(); }
 
-    void SetBaseViewPtr(CTxReceiptDBCache *pBaseIn) { txReceiptCache.SetBase(&pBaseIn->txReceiptCache); }
+    void SetBaseViewPtr(CTxReceiptDBCache *pBaseIn) {
+        txReceiptCache.SetBase(&pBaseIn->txReceiptCache);
+        blockTxidsCache.SetBase(&pBaseIn->blockTxidsCache);
+    }
 
-    void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) { txReceiptCache.SetDbOpLogMap(pDbOpLogMapIn); }
+    void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
+        txReceiptCache.SetDbOpLogMap(pDbOpLogMapIn);
+        blockTxidsCache.SetDbOpLogMap(pDbOpLogMapIn);
+    }
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         txReceiptCache.RegisterUndoFunc(undoDataFuncMap);
+        blockTxidsCache.RegisterUndoFunc(undoDataFuncMap);
+    }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        txReceiptCache.RegisterReadFunc(readDataFuncMap);
+        blockTxidsCache.RegisterReadFunc(readDataFuncMap);
     }
 public:
 /*       type               prefixType               key                     value                 variable               */
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
     /////////// SysParamDB
-    // txid -> vector<CReceipt>
-    CCompositeKVCache< dbk::TX_RECEIPT,            TxID,                   vector<CReceipt> >     txReceiptCache;
+    // txid -> receipts, in the compact encoding of CTxReceipts
+    CCompositeKVCache< dbk::TX_RECEIPT,            TxID,                   CTxReceipts >          txReceiptCache;
+    // height -> txids of the receipts of the block, written with a retention window only
+    CCompositeKVCache< dbk::TX_RECEIPT_HEIGHT,     CFixedUInt32,           vector<TxID> >         blockTxidsCache;
 };
 
 #endif // PERSIST_RECEIPTDB_H
\ No newline at end of file
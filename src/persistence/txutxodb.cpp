@@ -15,7 +15,24 @@ bool CTxUTXODBCache::GetUtxoTx(const pair<TxID, uint16_t> &utxoIndex) {
     bool result = txUtxoCache.GetData(utxoIndex, data);
     if (!result)
         return false;
-    
+
+    return true;
+}
+
+bool CTxUTXODBCache::GetUtxoTxs(const vector<pair<TxID, uint16_t>> &utxoIndexes, vector<bool> &unspent) {
+    vector<size_t> order(utxoIndexes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&utxoIndexes](size_t a, size_t b) {
+        return utxoIndexes[a] < utxoIndexes[b];
+    });
+
+    unspent.assign(utxoIndexes.size(), false);
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i > 0 && utxoIndexes[order[i]] == utxoIndexes[order[i - 1]])
+            return false;
+
+        unspent[order[i]] = txUtxoCache.HaveData(utxoIndexes[order[i]]);
+    }
     return true;
 }
 
@@ -9,6 +9,7 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <numeric>
 
 #include "commons/serialize.h"
 #include "dbaccess.h"
@@ -26,6 +27,9 @@ public:
 public:
     bool SetUtxoTx(const pair<TxID, uint16_t> &utoxIndex);
     bool GetUtxoTx(const pair<TxID, uint16_t> &utoxIndex);
+    // the unspent state of each output in unspent, looked up in key order so the outputs of a tx are read
+    // together. Return false if an output is listed twice
+    bool GetUtxoTxs(const vector<pair<TxID, uint16_t>> &utxoIndexes, vector<bool> &unspent);
     bool DelUtoxTx(const pair<TxID, uint16_t> &utoxIndex);
 
     void Flush();
@@ -39,6 +43,10 @@ public:
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         txUtxoCache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterReadFunc(ReadDataFuncMap &readDataFuncMap) {
+        txUtxoCache.RegisterReadFunc(readDataFuncMap);
+    }
 public:
 /*       type               prefixType               key                     value                 variable               */
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
@@ -0,0 +1,137 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wasmcachesnapshot.h"
+
+#include "config/configuration.h"
+#include "crypto/hash.h"
+#include "logging.h"
+#include "commons/util/util.h"
+
+#include <boost/filesystem.hpp>
+
+#include <openssl/rand.h>
+
+using namespace std;
+
+extern void wasm_code_cache_get_codes(vector<pair<uint256, shared_ptr<const vector<uint8_t>>>> &codes);
+extern bool wasm_code_cache_preload(const uint256 &code_hash, const vector<uint8_t> &code);
+
+CWasmCacheSnapshot::CWasmCacheSnapshot() { pathSnapshot = GetDataDir() / "wasmcache.dat"; }
+
+bool CWasmCacheSnapshot::Write() {
+    vector<pair<uint256, shared_ptr<const vector<uint8_t>>>> codes;
+    wasm_code_cache_get_codes(codes);
+    // keep the last snapshot of a node stopped before running any contract
+    if (codes.empty())
+        return true;
+
+    // Generate random temporary filename
+    uint16_t randv = 0;
+    RAND_bytes((uint8_t *)&randv, sizeof(randv));
+    string tmpfn = strprintf("wasmcache.dat.%04x", randv);
+
+    // serialize the codes, checksum data up to that point, then append csum
+    CDataStream ssCache(SER_DISK, CLIENT_VERSION);
+    ssCache << FLATDATA(SysCfg().MessageStart());
+    ssCache << CURRENT_VERSION;
+    WriteCompactSize(ssCache, codes.size());
+    for (const auto &item : codes)
+        ssCache << item.first << *item.second;
+    uint256 hash = Hash(ssCache.begin(), ssCache.end());
+    ssCache << hash;
+
+    // open temp output file, and associate with CAutoFile
+    boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+    FILE *file                      = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout               = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    // Write and commit header, data
+    try {
+        fileout << ssCache;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout);
+    fileout.fclose();
+
+    // replace existing wasmcache.dat, if any, with new wasmcache.dat.XXXX
+    if (!RenameOver(pathTmp, pathSnapshot))
+        return ERRORMSG("%s : Rename-into-place failed", __func__);
+
+    return true;
+}
+
+bool CWasmCacheSnapshot::Read(uint32_t &nModules) {
+    nModules = 0;
+    if (!boost::filesystem::exists(pathSnapshot))
+        return false;
+
+    // open input file, and associate with CAutoFile
+    FILE *file       = fopen(pathSnapshot.string().c_str(), "rb");
+    CAutoFile filein = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathSnapshot.string());
+
+    // use file size to size memory buffer
+    int64_t dataSize = (int64_t)boost::filesystem::file_size(pathSnapshot) - sizeof(uint256);
+    if (dataSize < 0)
+        dataSize = 0;
+    vector<uint8_t> vchData(dataSize);
+    uint256 hashIn;
+
+    // read data and checksum from file
+    try {
+        filein.read((char *)vchData.data(), dataSize);
+        filein >> hashIn;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssCache(vchData, SER_DISK, CLIENT_VERSION);
+
+    // verify stored checksum matches input data
+    if (hashIn != Hash(ssCache.begin(), ssCache.end()))
+        return ERRORMSG("%s : Checksum mismatch, data corrupted", __func__);
+
+    uint8_t pchMsgTmp[4];
+    int32_t version;
+    vector<pair<uint256, vector<uint8_t>>> codes;
+    try {
+        ssCache >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, SysCfg().MessageStart(), sizeof(pchMsgTmp)))
+            return ERRORMSG("%s : Invalid network magic number", __func__);
+
+        ssCache >> version;
+        if (version != CURRENT_VERSION) {
+            LogPrint(BCLog::INFO, "%s : Ignore snapshot of version %d\n", __func__, version);
+            return false;
+        }
+
+        uint64_t count = ReadCompactSize(ssCache);
+        while (codes.size() < count) {
+            codes.emplace_back();
+            ssCache >> codes.back().first >> codes.back().second;
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    // the least recently used first, so that the cache ends up in the same order
+    for (auto it = codes.rbegin(); it != codes.rend(); ++it) {
+        if (it->first != Hash(it->second.begin(), it->second.end())) {
+            LogPrint(BCLog::ERROR, "%s : Skip wasm code not matching its hash %s\n", __func__, it->first.GetHex());
+            continue;
+        }
+        if (!wasm_code_cache_preload(it->first, it->second)) {
+            LogPrint(BCLog::ERROR, "%s : Skip invalid wasm code %s\n", __func__, it->first.GetHex());
+            continue;
+        }
+        ++nModules;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_WASMCACHESNAPSHOT_H
+#define PERSIST_WASMCACHESNAPSHOT_H
+
+#include <stdint.h>
+
+#include <boost/filesystem/path.hpp>
+
+/**
+ * Codes of the wasm modules cached at shutdown (wasmcache.dat), most recently used first.
+ * They are instantiated into the module cache at startup, so the first calls of the hot contracts
+ * after a restart don't pay for parsing and compiling their code.
+ */
+class CWasmCacheSnapshot {
+public:
+    static const int32_t CURRENT_VERSION = 1;
+
+    CWasmCacheSnapshot();
+
+    bool Write();
+
+    // return false if the file is missing or corrupted, nModules is the number of modules instantiated
+    bool Read(uint32_t &nModules);
+
+private:
+    boost::filesystem::path pathSnapshot;
+};
+
+#endif  // PERSIST_WASMCACHESNAPSHOT_H
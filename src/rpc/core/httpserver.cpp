@@ -13,11 +13,14 @@
 #include <init.h>
 #include <sync.h>
 
+#include <atomic>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <set>
 #include <thread>
+#include <unistd.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -34,6 +37,8 @@
 
 #include "commons/support/events.h"
 
+#include <zlib.h>
+
 #ifdef EVENT__HAVE_NETINET_IN_H
 #include <netinet/in.h>
 #ifdef _XOPEN_SOURCE_EXTENDED
@@ -71,19 +76,59 @@ std::string SanitizeString(const std::string& str, SafeCharsRule rule) {
     return strResult;
 }
 
+/** Counters of a registered HTTP path, updated by the event thread and the workers */
+struct HTTPPathCounters {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> queued{0};
+    std::atomic<uint64_t> maxQueued{0};
+    std::atomic<uint64_t> queueMicros{0};
+    std::atomic<uint64_t> handleMicros{0};
+    std::atomic<uint64_t> maxLatencyMicros{0};
+
+    static void UpdateMax(std::atomic<uint64_t>& max, uint64_t value) {
+        uint64_t cur = max;
+        while (value > cur && !max.compare_exchange_weak(cur, value)) {
+        }
+    }
+};
+
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure {
 public:
     HTTPWorkItem(std::unique_ptr<HTTPRequest> _req, const std::string& _path,
-                 const HTTPRequestHandler& _func)
-        : req(std::move(_req)), path(_path), func(_func) {}
-    void operator()() override { func(req.get(), path); }
+                 const HTTPRequestHandler& _func, const std::shared_ptr<HTTPPathCounters>& _counters)
+        : req(std::move(_req)), path(_path), func(_func), counters(_counters), nQueuedTime(GetTimeMicros()) {}
+    void operator()() override {
+        int64_t nStartTime  = GetTimeMicros();
+        uint64_t queueMicros = std::max<int64_t>(nStartTime - nQueuedTime, 0);
+        --counters->queued;
+        counters->queueMicros += queueMicros;
+
+        func(req.get(), path);
+
+        uint64_t handleMicros = std::max<int64_t>(GetTimeMicros() - nStartTime, 0);
+        counters->handleMicros += handleMicros;
+        HTTPPathCounters::UpdateMax(counters->maxLatencyMicros, queueMicros + handleMicros);
+    }
 
     std::unique_ptr<HTTPRequest> req;
 
 private:
     std::string path;
     HTTPRequestHandler func;
+    std::shared_ptr<HTTPPathCounters> counters;
+    int64_t nQueuedTime;
+};
+
+/** Task run by the HTTP workers for a request in progress */
+class HTTPTaskItem final : public HTTPClosure {
+public:
+    explicit HTTPTaskItem(const std::function<void()>& _task) : task(_task) {}
+    void operator()() override { task(); }
+
+private:
+    std::function<void()> task;
 };
 
 /** Simple work queue for distributing work over multiple threads.
@@ -128,6 +173,12 @@ public:
             (*i)();
         }
     }
+    /** Number of the items waiting in the queue */
+    size_t Depth() {
+        STD_LOCK(cs);
+        return queue.size();
+    }
+    size_t MaxDepth() const { return maxDepth; }
     /** Interrupt and exit loops */
     void Interrupt() {
         STD_LOCK(cs);
@@ -138,10 +189,13 @@ public:
 
 struct HTTPPathHandler {
     HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler)
-        : prefix(_prefix), exactMatch(_exactMatch), handler(_handler) {}
+        : prefix(_prefix), exactMatch(_exactMatch), handler(_handler),
+          counters(std::make_shared<HTTPPathCounters>()) {}
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    // shared with the work items, which may outlive the handler being unregistered
+    std::shared_ptr<HTTPPathCounters> counters;
 };
 
 /** HTTP module state */
@@ -165,6 +219,16 @@ std::thread threadHTTP;
 //! thead workers
 static std::vector<std::thread> g_thread_http_workers;
 
+//! Minimum size of the compressed replies, 0 disables the compression
+static size_t nCompressSize = DEFAULT_HTTP_COMPRESS_SIZE;
+static std::atomic<uint64_t> nCompressedReplies{0};
+static std::atomic<uint64_t> nCompressedBytesIn{0};
+static std::atomic<uint64_t> nCompressedBytesOut{0};
+
+//! Chunked replies in progress, ended when the server is interrupted
+static std::mutex csStreams;
+static std::set<std::shared_ptr<HTTPStream>> setStreams;
+
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr) {
     if (!netaddr.IsValid()) return false;
@@ -277,15 +341,23 @@ static void http_request_cb(struct evhttp_request* req, void* arg) {
 
     // Dispatch to worker thread
     if (i != iend) {
-        std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
+        std::shared_ptr<HTTPPathCounters> counters = i->counters;
+        std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler, counters));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        // counted before the enqueue, a worker may run the item at once
+        HTTPPathCounters::UpdateMax(counters->maxQueued, ++counters->queued);
+        if (workQueue->Enqueue(item.get())) {
             item.release(); /* if true, queue took ownership */
-        else {
+            ++counters->requests;
+        } else {
+            --counters->queued;
+            ++counters->rejected;
             LogPrint(BCLog::ERROR,
-                     "WARNING: request rejected because http work queue depth exceeded, it can be "
-                     "increased with the -rpcworkqueue= setting\n");
-            item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
+                     "WARNING: request for %s rejected because http work queue depth exceeded, it can be "
+                     "increased with the -rpcworkqueue= setting\n", i->prefix);
+            // the connection is kept, the client retries on it
+            item->req->WriteHeader("Retry-After", "1");
+            item->req->WriteReply(HTTP_SERVUNAVAIL, "Work queue depth exceeded");
         }
     } else {
         hreq->WriteReply(HTTP_NOTFOUND);
@@ -415,6 +487,9 @@ bool InitHTTPServer() {
     int32_t workQueueDepth = std::max<int32_t>(SysCfg().GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
     LogPrint(BCLog::RPC, "HTTP: creating work queue of depth %d\n", workQueueDepth);
 
+    nCompressSize = std::max<int64_t>(SysCfg().GetArg("-rpccompress", DEFAULT_HTTP_COMPRESS_SIZE), 0);
+    LogPrint(BCLog::RPC, "HTTP: compressing the replies of at least %u bytes\n", nCompressSize);
+
     workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
@@ -454,6 +529,14 @@ void InterruptHTTPServer() {
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
     }
     if (workQueue) workQueue->Interrupt();
+
+    std::set<std::shared_ptr<HTTPStream>> streams;
+    {
+        std::lock_guard<std::mutex> lock(csStreams);
+        streams = setStreams;
+    }
+    for (const auto& stream : streams)
+        stream->Close();
 }
 
 void StopHTTPServer() {
@@ -492,6 +575,52 @@ struct event_base* EventBase() {
     return eventBase;
 }
 
+bool EnqueueHTTPTask(const std::function<void()>& task) {
+    if (!workQueue)
+        return false;
+
+    std::unique_ptr<HTTPTaskItem> item(new HTTPTaskItem(task));
+    if (!workQueue->Enqueue(item.get()))
+        return false;
+
+    item.release(); /* the queue took ownership */
+    return true;
+}
+
+size_t GetHTTPWorkerCount() {
+    return g_thread_http_workers.size();
+}
+
+HTTPServerStats GetHTTPServerStats() {
+    HTTPServerStats stats;
+    if (workQueue) {
+        stats.workQueueDepth    = workQueue->Depth();
+        stats.maxWorkQueueDepth = workQueue->MaxDepth();
+    }
+    stats.workers            = g_thread_http_workers.size();
+    stats.compressedReplies  = nCompressedReplies;
+    stats.compressedBytesIn  = nCompressedBytesIn;
+    stats.compressedBytesOut = nCompressedBytesOut;
+    {
+        std::lock_guard<std::mutex> lock(csStreams);
+        stats.streams = setStreams.size();
+    }
+
+    for (const HTTPPathHandler& handler : pathHandlers) {
+        HTTPPathStats pathStats;
+        pathStats.prefix           = handler.prefix;
+        pathStats.requests         = handler.counters->requests;
+        pathStats.rejected         = handler.counters->rejected;
+        pathStats.queued           = handler.counters->queued;
+        pathStats.maxQueued        = handler.counters->maxQueued;
+        pathStats.queueMicros      = handler.counters->queueMicros;
+        pathStats.handleMicros     = handler.counters->handleMicros;
+        pathStats.maxLatencyMicros = handler.counters->maxLatencyMicros;
+        stats.paths.push_back(pathStats);
+    }
+    return stats;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data) {
     // Static handler: simply call inner handler
     HTTPEvent* self = static_cast<HTTPEvent*>(data);
@@ -564,6 +693,68 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+enum HTTPContentCoding {
+    CODING_IDENTITY,
+    CODING_GZIP,
+    CODING_DEFLATE,
+};
+
+static std::string TrimSpaces(const std::string& str) {
+    size_t begin = str.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        return "";
+    size_t end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+/** The coding of the reply from the Accept-Encoding header of the request, gzip is preferred */
+static HTTPContentCoding ParseAcceptEncoding(const std::string& accept) {
+    bool gzip = false, deflate = false;
+    size_t pos = 0;
+    while (pos <= accept.size()) {
+        size_t end = accept.find(',', pos);
+        if (end == std::string::npos)
+            end = accept.size();
+        std::string item = accept.substr(pos, end - pos);
+        pos              = end + 1;
+
+        // a coding with q=0 is refused
+        size_t semicolon = item.find(';');
+        std::string name = StrToLower(TrimSpaces(item.substr(0, semicolon)));
+        if (semicolon != std::string::npos) {
+            std::string param = TrimSpaces(item.substr(semicolon + 1));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=' &&
+                atof(param.c_str() + 2) <= 0)
+                continue;
+        }
+        if (name == "gzip" || name == "x-gzip")
+            gzip = true;
+        else if (name == "deflate")
+            deflate = true;
+    }
+    return gzip ? CODING_GZIP : (deflate ? CODING_DEFLATE : CODING_IDENTITY);
+}
+
+/** Compress the reply in one pass, deflate is the zlib format as RFC 7230 defines it */
+static bool CompressReply(const std::string& in, HTTPContentCoding coding, std::string& out) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // the fastest level, the replies are compressed on the request path
+    int windowBits = (coding == CODING_GZIP) ? MAX_WBITS + 16 : MAX_WBITS;
+    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    out.resize(deflateBound(&stream, in.size()));
+    stream.next_in   = (Bytef*)in.data();
+    stream.avail_in  = in.size();
+    stream.next_out  = (Bytef*)&out[0];
+    stream.avail_out = out.size();
+    int ret          = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ret == Z_STREAM_END;
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -574,10 +765,56 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply) {
     if (ShutdownRequested()) {
         WriteHeader("Connection", "close");
     }
+
+    // compressed on the worker thread, the event thread only sends the reply
+    std::string strCompressed;
+    const std::string* pReply = &strReply;
+    if (nCompressSize > 0 && strReply.size() >= nCompressSize) {
+        std::pair<bool, std::string> accept = GetHeader("accept-encoding");
+        HTTPContentCoding coding = accept.first ? ParseAcceptEncoding(accept.second) : CODING_IDENTITY;
+        if (coding != CODING_IDENTITY && CompressReply(strReply, coding, strCompressed) &&
+            strCompressed.size() < strReply.size()) {
+            WriteHeader("Content-Encoding", coding == CODING_GZIP ? "gzip" : "deflate");
+            WriteHeader("Vary", "Accept-Encoding");
+            ++nCompressedReplies;
+            nCompressedBytesIn += strReply.size();
+            nCompressedBytesOut += strCompressed.size();
+            pReply = &strCompressed;
+        }
+    }
+
     // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
-    evbuffer_add(evb, strReply.data(), strReply.size());
+    evbuffer_add(evb, pReply->data(), pReply->size());
+    SendReply(nStatus);
+}
+
+void HTTPRequest::WriteReplyFile(int nStatus, int fd, int64_t offset, int64_t length) {
+    assert(!replySent && req);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    // the segment owns the fd from here, it is closed when the buffer is drained
+    struct evbuffer_file_segment* seg = evbuffer_file_segment_new(fd, offset, length, EVBUF_FS_CLOSE_ON_FREE);
+    if (!seg) {
+        close(fd);
+        WriteReply(HTTP_INTERNAL, "Read the file failed");
+        return;
+    }
+    bool added = evbuffer_add_file_segment(evb, seg, 0, length) == 0;
+    evbuffer_file_segment_free(seg);
+    if (!added) {
+        WriteReply(HTTP_INTERNAL, "Read the file failed");
+        return;
+    }
+    SendReply(nStatus);
+}
+
+void HTTPRequest::SendReply(int nStatus) {
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus] {
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
@@ -598,6 +835,131 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply) {
     req       = nullptr;  // transferred back to main thread
 }
 
+std::shared_ptr<HTTPStream> HTTPRequest::StartStream(int nStatus, size_t maxBacklog) {
+    assert(!replySent && req);
+    // a stream takes the connection until its end, which is closed then
+    WriteHeader("Connection", "close");
+    std::shared_ptr<HTTPStream> stream(new HTTPStream(req, maxBacklog));
+    {
+        std::lock_guard<std::mutex> lock(csStreams);
+        setStreams.insert(stream);
+    }
+
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [stream, nStatus] { stream->Start(nStatus); });
+    ev->trigger(nullptr);
+    replySent = true;
+    req       = nullptr;  // transferred to the stream
+    return stream;
+}
+
+HTTPStream::HTTPStream(struct evhttp_request* _req, size_t _maxBacklog) : req(_req), maxBacklog(_maxBacklog) {}
+
+bool HTTPStream::Write(const std::string& chunk) {
+    if (closed)
+        return false;
+
+    bool queueFlush = false;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (pending.size() + chunk.size() + nOutputBytes <= maxBacklog) {
+            pending += chunk;
+            queueFlush  = !flushQueued;
+            flushQueued = true;
+        } else {
+            LogPrint(BCLog::RPC, "HTTP stream closed, the client is more than %u bytes behind\n", maxBacklog);
+            Close();
+            return false;
+        }
+    }
+
+    if (queueFlush) {
+        std::shared_ptr<HTTPStream> self = shared_from_this();
+        HTTPEvent* ev = new HTTPEvent(eventBase, true, [self] { self->Flush(); });
+        ev->trigger(nullptr);
+    }
+    return true;
+}
+
+void HTTPStream::Close() {
+    if (closed.exchange(true))
+        return;
+
+    std::shared_ptr<HTTPStream> self = shared_from_this();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [self] { self->End(); });
+    ev->trigger(nullptr);
+}
+
+void HTTPStream::Start(int nStatus) {
+    started = true;
+    if (req == nullptr)
+        return;
+
+    // Reading stays disabled, see the libevent workaround in http_request_cb, a client which
+    // went away is noticed by the failed writes and the connection close callback.
+    evhttp_send_reply_start(req, nStatus, nullptr);
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    if (conn)
+        evhttp_connection_set_closecb(conn, &HTTPStream::ConnectionClosed, this);
+    Flush();
+    if (closed)
+        End();
+}
+
+void HTTPStream::Flush() {
+    if (!started || req == nullptr)
+        return;
+
+    std::string chunks;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        chunks.swap(pending);
+        flushQueued = false;
+    }
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    if (chunks.empty() || conn == nullptr)
+        return;
+
+    struct evbuffer* evb = evbuffer_new();
+    evbuffer_add(evb, chunks.data(), chunks.size());
+    evhttp_send_reply_chunk(req, evb);
+    evbuffer_free(evb);
+
+    bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+    if (bev)
+        nOutputBytes = evbuffer_get_length(bufferevent_get_output(bev));
+}
+
+void HTTPStream::End() {
+    closed = true;
+    if (!started || req == nullptr)  // Start() ends the stream itself
+        return;
+
+    Flush();
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    if (conn)
+        evhttp_connection_set_closecb(conn, nullptr, nullptr);
+    evhttp_send_reply_end(req);
+    req = nullptr;
+
+    std::shared_ptr<HTTPStream> self = shared_from_this();
+    std::lock_guard<std::mutex> lock(csStreams);
+    setStreams.erase(self);
+}
+
+void HTTPStream::ConnectionClosed(struct evhttp_connection* conn, void* arg) {
+    HTTPStream* stream = static_cast<HTTPStream*>(arg);
+    std::shared_ptr<HTTPStream> self = stream->shared_from_this();
+    stream->closed = true;
+    if (stream->req) {
+        // the request is detached from the closing connection, ending it frees it
+        evhttp_send_reply_end(stream->req);
+        stream->req = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(csStreams);
+    setStreams.erase(self);
+}
+
 CService HTTPRequest::GetPeer() const {
     evhttp_connection* con = evhttp_request_get_connection(req);
     CService peer;
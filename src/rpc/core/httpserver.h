@@ -7,16 +7,23 @@
 
 #include <string>
 #include <stdint.h>
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 static const int32_t DEFAULT_HTTP_THREADS        = 4;
 static const int32_t DEFAULT_HTTP_WORKQUEUE      = 16;
 static const int32_t DEFAULT_HTTP_SERVER_TIMEOUT = 30;
+//! the replies of at least this size are compressed when the client accepts gzip or deflate
+static const int32_t DEFAULT_HTTP_COMPRESS_SIZE  = 8192;
 
 struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+class HTTPStream;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -51,6 +58,38 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Run a task on the HTTP worker threads, e.g. a part of a request running in parallel.
+ * Return false if the work queue is full, the caller must be able to run the task itself.
+ */
+bool EnqueueHTTPTask(const std::function<void()>& task);
+/** Number of the HTTP worker threads */
+size_t GetHTTPWorkerCount();
+
+/** Counters of the requests of a registered HTTP path */
+struct HTTPPathStats {
+    std::string prefix;
+    uint64_t requests         = 0;  //!< dispatched to the work queue
+    uint64_t rejected         = 0;  //!< rejected because the work queue was full
+    uint64_t queued           = 0;  //!< waiting in the work queue now
+    uint64_t maxQueued        = 0;
+    uint64_t queueMicros      = 0;  //!< total time waiting in the work queue
+    uint64_t handleMicros     = 0;  //!< total time in the handler
+    uint64_t maxLatencyMicros = 0;  //!< max time from the dispatch to the end of the handler
+};
+
+struct HTTPServerStats {
+    uint64_t workQueueDepth    = 0;
+    uint64_t maxWorkQueueDepth = 0;
+    uint64_t workers           = 0;
+    uint64_t compressedReplies = 0;
+    uint64_t compressedBytesIn = 0;
+    uint64_t compressedBytesOut = 0;
+    uint64_t streams           = 0;  //!< chunked replies in progress
+    std::vector<HTTPPathStats> paths;
+};
+
+HTTPServerStats GetHTTPServerStats();
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -60,6 +99,9 @@ private:
     struct evhttp_request* req;
     bool replySent;
 
+    /** Send the output buffer from the event thread */
+    void SendReply(int nStatus);
+
 public:
     explicit HTTPRequest(struct evhttp_request* req);
     ~HTTPRequest();
@@ -109,11 +151,68 @@ public:
      * Write HTTP reply.
      * nStatus is the HTTP status code to send.
      * strReply is the body of the reply. Keep it empty to send a standard message.
+     * A body of at least -rpccompress bytes is compressed with gzip or deflate when the client
+     * accepts one of them.
      *
      * @note Can be called only once. As this will give the request back to the
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write HTTP reply whose body is the length bytes of the file fd at offset, which libevent
+     * sends with sendfile where the platform supports it. The fd is closed after the reply.
+     *
+     * @note Can be called only once, as WriteReply.
+     */
+    void WriteReplyFile(int nStatus, int fd, int64_t offset, int64_t length);
+
+    /**
+     * Start a reply whose body is written in chunks by the returned stream, e.g. the events
+     * pushed to a subscriber. The client is disconnected when it falls behind by more than
+     * maxBacklog bytes.
+     *
+     * @note Replaces WriteReply, do not call any other HTTPRequest methods after calling this.
+     */
+    std::shared_ptr<HTTPStream> StartStream(int nStatus, size_t maxBacklog);
+};
+
+/** Chunked reply in progress, which can be written from any thread.
+ * The chunks are buffered until the event thread sends them to the connection.
+ */
+class HTTPStream : public std::enable_shared_from_this<HTTPStream>
+{
+public:
+    /** Queue a chunk. Return false if the stream is closed, or closed now because the
+     * client is too far behind.
+     */
+    bool Write(const std::string& chunk);
+    /** End the reply after the queued chunks */
+    void Close();
+    /** Closed by Close(), the backlog or the client */
+    bool IsClosed() const { return closed; }
+
+private:
+    friend class HTTPRequest;
+    friend void InterruptHTTPServer();
+
+    HTTPStream(struct evhttp_request* req, size_t maxBacklog);
+
+    // run on the event thread
+    void Start(int nStatus);
+    void Flush();
+    void End();
+    static void ConnectionClosed(struct evhttp_connection* conn, void* arg);
+
+    struct evhttp_request* req;  //!< owned by the event thread, nullptr once the reply is ended
+    size_t maxBacklog;
+    bool started = false;
+
+    std::mutex cs;
+    std::string pending;         //!< the chunks not sent to the connection yet
+    bool flushQueued = false;
+    std::atomic<bool> closed{false};
+    std::atomic<size_t> nOutputBytes{0};  //!< sent to the connection, not written to the socket yet
 };
 
 /** Event handler closure.
@@ -0,0 +1,294 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rest.h"
+
+#include "commons/json/jsonwriter.h"
+#include "commons/util/util.h"
+#include "main.h"
+#include "persistence/cachewrapper.h"
+#include "persistence/disk.h"
+#include "persistence/statesnapshot.h"
+#include "rpc/core/httpserver.h"
+#include "rpc/core/rpcprotocol.h"
+#include "tx/txmempool.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace json_spirit;
+
+enum RetFormat {
+    RF_UNDEF,
+    RF_BINARY,
+    RF_HEX,
+    RF_JSON,
+};
+
+static const struct {
+    enum RetFormat rf;
+    const char* name;
+} rf_names[] = {
+    {RF_UNDEF,  ""},
+    {RF_BINARY, "bin"},
+    {RF_HEX,    "hex"},
+    {RF_JSON,   "json"},
+};
+
+static bool RESTERR(HTTPRequest* req, int status, const std::string& message) {
+    req->WriteHeader("Content-Type", "text/plain");
+    req->WriteReply(status, message + "\r\n");
+    return false;
+}
+
+/** Split the param and the format of "<param>.<format>", the query string is ignored */
+static RetFormat ParseDataFormat(std::string& param, const std::string& strReq) {
+    const std::string str = strReq.substr(0, strReq.find('?'));
+    size_t pos            = str.rfind('.');
+    if (pos == std::string::npos) {
+        param = str;
+        return rf_names[0].rf;
+    }
+
+    param = str.substr(0, pos);
+    const std::string suffix(str, pos + 1);
+    for (unsigned int i = 0; i < ARRAYLEN(rf_names); i++) {
+        if (suffix == rf_names[i].name)
+            return rf_names[i].rf;
+    }
+    return rf_names[0].rf;
+}
+
+static std::string AvailableDataFormatsString(const std::vector<RetFormat>& formats) {
+    std::string strFormats;
+    for (RetFormat rf : formats) {
+        if (!strFormats.empty())
+            strFormats += ", ";
+        strFormats += std::string(".") + rf_names[rf].name;
+    }
+    return strFormats;
+}
+
+static bool CheckFormat(HTTPRequest* req, RetFormat rf, const std::vector<RetFormat>& formats) {
+    if (std::find(formats.begin(), formats.end(), rf) != formats.end())
+        return true;
+
+    return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " +
+                                            AvailableDataFormatsString(formats) + ")");
+}
+
+static void WriteBinaryReply(HTTPRequest* req, const CDataStream& ds, RetFormat rf) {
+    if (rf == RF_BINARY) {
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, std::string(ds.begin(), ds.end()));
+    } else {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(ds.begin(), ds.end()) + "\n");
+    }
+}
+
+/** The block index of a hash or a height on the active chain, with cs_main or cs_chainIndex held */
+static CBlockIndex* LookupBlockIndex(const std::string& hashOrHeight) {
+    if (!hashOrHeight.empty() && hashOrHeight.size() < 10 &&
+        hashOrHeight.find_first_not_of("0123456789") == std::string::npos) {
+        int32_t height = atoi(hashOrHeight);
+        return (height <= chainActive.Height()) ? chainActive[height] : nullptr;
+    }
+
+    if (!IsHex(hashOrHeight) || hashOrHeight.size() != 64)
+        return nullptr;
+    auto it = mapBlockIndex.find(uint256S(hashOrHeight));
+    return (it != mapBlockIndex.end()) ? it->second : nullptr;
+}
+
+/** Open the block file at the record written by WriteBlockToDisk, the fd is owned by the caller */
+static bool OpenBlockRecord(const CDiskBlockPos& pos, int& fd, uint32_t& nSize) {
+    static const uint32_t HEADER_SIZE = MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.nPos < HEADER_SIZE)
+        return false;
+
+    FILE* file = OpenBlockFile(pos, true);
+    if (file == nullptr)
+        return false;
+    fd = dup(fileno(file));
+    fclose(file);
+    if (fd < 0)
+        return false;
+
+    char header[HEADER_SIZE];
+    if (pread(fd, header, HEADER_SIZE, pos.nPos - HEADER_SIZE) != (ssize_t)HEADER_SIZE ||
+        memcmp(header, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0) {
+        close(fd);
+        return ERRORMSG("%s : invalid block record at %s", __func__, pos.ToString());
+    }
+    memcpy(&nSize, header + MESSAGE_START_SIZE, sizeof(nSize));
+    nSize = le32toh(nSize);
+    return true;
+}
+
+/** GET /rest/block/<hash|height>.<bin|hex>, the block as stored, i.e. the hex of getblock verbose=false */
+static bool rest_block(HTTPRequest* req, const std::string& strURIPart) {
+    std::string param;
+    RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (!CheckFormat(req, rf, {RF_BINARY, RF_HEX}))
+        return false;
+
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        CBlockIndex* pIndex = LookupBlockIndex(param);
+        if (pIndex == nullptr || !(pIndex->nStatus & BLOCK_HAVE_DATA))
+            return RESTERR(req, HTTP_NOT_FOUND, param + " not found");
+        pos = pIndex->GetBlockPos();
+    }
+
+    int fd;
+    uint32_t nSize;
+    if (!OpenBlockRecord(pos, fd, nSize))
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, param + " read failed");
+
+    if (rf == RF_BINARY) {
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReplyFile(HTTP_OK, fd, pos.nPos, nSize);
+        return true;
+    }
+
+    std::string data(nSize, '\0');
+    bool fRead = pread(fd, &data[0], nSize, pos.nPos) == (ssize_t)nSize;
+    close(fd);
+    if (!fRead)
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, param + " read failed");
+
+    req->WriteHeader("Content-Type", "text/plain");
+    req->WriteReply(HTTP_OK, HexStr(data.begin(), data.end()) + "\n");
+    return true;
+}
+
+/** GET /rest/headers/<count>/<hash|height>.<bin|hex>, the headers of the active chain from the block */
+static bool rest_headers(HTTPRequest* req, const std::string& strURIPart) {
+    std::string param;
+    RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (!CheckFormat(req, rf, {RF_BINARY, RF_HEX}))
+        return false;
+
+    size_t slash = param.find('/');
+    if (slash == std::string::npos)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No header count specified. Use /rest/headers/<count>/<hash|height>.<ext>.");
+
+    int32_t count = atoi(param.substr(0, slash));
+    if (count < 1 || count > MAX_REST_HEADERS_COUNT)
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Header count out of range: %d", count));
+
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    {
+        std::shared_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+        const CBlockIndex* pIndex = LookupBlockIndex(param.substr(slash + 1));
+        if (pIndex == nullptr)
+            return RESTERR(req, HTTP_NOT_FOUND, param.substr(slash + 1) + " not found");
+
+        for (; pIndex != nullptr && count > 0; --count) {
+            ds << pIndex->GetBlockHeader();
+            pIndex = chainActive.Next(pIndex);
+        }
+    }
+    WriteBinaryReply(req, ds, rf);
+    return true;
+}
+
+/** The tx of the mempool or, with -txindex, of the blocks */
+static bool ReadTx(const uint256& txid, std::shared_ptr<CBaseTx>& pBaseTx) {
+    pBaseTx = mempool.Lookup(txid);
+    if (pBaseTx)
+        return true;
+
+    CDiskTxPos postx;
+    {
+        LOCK(cs_main);
+        if (!SysCfg().IsTxIndex() || !pCdMan->pBlockCache->ReadTxIndex(txid, postx))
+            return false;
+    }
+
+    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    if (!file)
+        return false;
+    try {
+        CBlockHeader header;
+        file >> header;
+        fseek(file, postx.nTxOffset, SEEK_CUR);
+        file >> pBaseTx;
+    } catch (std::exception& e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+/** GET /rest/tx/<txid>.<bin|hex>, the rawtx of gettxdetail */
+static bool rest_tx(HTTPRequest* req, const std::string& strURIPart) {
+    std::string param;
+    RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (!CheckFormat(req, rf, {RF_BINARY, RF_HEX}))
+        return false;
+    if (!IsHex(param) || param.size() != 64)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + param);
+
+    std::shared_ptr<CBaseTx> pBaseTx;
+    if (!ReadTx(uint256S(param), pBaseTx))
+        return RESTERR(req, HTTP_NOT_FOUND, param + " not found");
+
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    ds << pBaseTx;
+    WriteBinaryReply(req, ds, rf);
+    return true;
+}
+
+/** GET /rest/account/<address|regid>.<bin|hex|json>, the account in the state of the tip */
+static bool rest_account(HTTPRequest* req, const std::string& strURIPart) {
+    std::string param;
+    RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (!CheckFormat(req, rf, {RF_BINARY, RF_HEX, RF_JSON}))
+        return false;
+
+    CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
+    auto pUserId = CUserID::ParseUserId(param, view.cw.accountCache);
+    if (!pUserId)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + param);
+
+    CAccount account;
+    if (!view.cw.accountCache.GetAccount(*pUserId, account))
+        return RESTERR(req, HTTP_NOT_FOUND, param + " not found");
+
+    if (rf == RF_JSON) {
+        CJsonWriter writer;
+        writer.WriteValue(account.ToJsonObj(view.cw.delegateCache, view.GetHeight()));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, writer.GetString() + "\n");
+        return true;
+    }
+
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    ds << account;
+    WriteBinaryReply(req, ds, rf);
+    return true;
+}
+
+static const struct {
+    const char* prefix;
+    bool (*handler)(HTTPRequest* req, const std::string& strReq);
+} uri_prefixes[] = {
+    {"/rest/block/",    rest_block},
+    {"/rest/headers/",  rest_headers},
+    {"/rest/tx/",       rest_tx},
+    {"/rest/account/",  rest_account},
+};
+
+void StartREST() {
+    for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
+        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler);
+}
+
+void StopREST() {
+    for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
+        UnregisterHTTPHandler(uri_prefixes[i].prefix, false);
+}
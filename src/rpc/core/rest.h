@@ -0,0 +1,21 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RPC_CORE_REST_H
+#define RPC_CORE_REST_H
+
+#include <stdint.h>
+
+static const bool DEFAULT_REST_ENABLE      = false;
+static const int32_t MAX_REST_HEADERS_COUNT = 2000;
+
+/** Register the REST handlers of /rest/ on the HTTP server, enabled by -rest.
+ * They serve the raw serialized blocks, headers, txs and accounts without the hex and JSON
+ * encoding of the RPCs, and the block files are sent with sendfile.
+ */
+void StartREST();
+/** Unregister the REST handlers */
+void StopREST();
+
+#endif  // RPC_CORE_REST_H
@@ -0,0 +1,124 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpccache.h"
+
+using namespace json_spirit;
+
+CRPCResultCache rpcResultCache;
+
+void CRPCCachedResult::WriteObject(const Object& obj, int32_t base) {
+    writer.BeginObject();
+    for (const auto& member : obj) {
+        writer.Key(member.name_);
+        if (member.name_ == "confirmations" && member.value_.type() == int_type && !HasConfirmations())
+            SetConfirmations(writer.GetSize(), base);
+        writer.WriteValue(member.value_);
+    }
+    writer.EndObject();
+}
+
+void CRPCCachedResult::SetConfirmations(size_t pos, int32_t base) {
+    confirmationsPos  = pos;
+    confirmationsBase = base;
+}
+
+void CRPCResultCache::SetMaxBytes(size_t maxBytesIn) {
+    std::lock_guard<std::mutex> lock(mtx);
+    maxBytes = maxBytesIn;
+    EvictEntries();
+}
+
+std::string CRPCResultCache::MakeKey(const std::string& method, const Array& params) {
+    CJsonWriter writer;
+    writer.String(method);
+    writer.WriteValue(params);
+    return writer.GetString();
+}
+
+bool CRPCResultCache::Get(const std::string& key, CJsonWriter& writer) {
+    std::string reply;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = mapEntries.find(key);
+        if (it == mapEntries.end()) {
+            ++misses;
+            return false;
+        }
+
+        CEntry& entry = it->second;
+        lruKeys.splice(lruKeys.begin(), lruKeys, entry.lruIt);
+        ++hits;
+        if (entry.confirmationsPos == std::string::npos) {
+            writer.Raw(entry.json);
+            return true;
+        }
+
+        int32_t confirmations = tipHeight - entry.height + entry.confirmationsBase;
+        reply.reserve(entry.json.size() + 8);
+        reply.append(entry.json, 0, entry.confirmationsPos);
+        reply += std::to_string(confirmations);
+        reply.append(entry.json, entry.confirmationsPos + entry.confirmationsLen, std::string::npos);
+    }
+    writer.Raw(reply);
+    return true;
+}
+
+void CRPCResultCache::Put(const std::string& key, const CRPCCachedResult& result) {
+    if (!IsEnabled() || result.height < 0 || result.height >= finHeight)
+        return;
+
+    CEntry entry;
+    entry.json              = result.writer.GetString();
+    entry.height            = result.height;
+    entry.confirmationsPos  = result.confirmationsPos;
+    entry.confirmationsLen  = 0;
+    entry.confirmationsBase = result.confirmationsBase;
+    if (entry.confirmationsPos != std::string::npos) {
+        size_t end = entry.confirmationsPos;
+        if (end < entry.json.size() && entry.json[end] == '-')
+            ++end;
+        while (end < entry.json.size() && entry.json[end] >= '0' && entry.json[end] <= '9')
+            ++end;
+        entry.confirmationsLen = end - entry.confirmationsPos;
+    }
+
+    // a result taking the most of the cache would evict all the others
+    size_t entryBytes = GetEntryBytes(key, entry);
+    if (entryBytes > maxBytes / 4)
+        return;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto ret = mapEntries.emplace(key, std::move(entry));
+    if (!ret.second)  // stored by a concurrent call already
+        return;
+
+    lruKeys.push_front(&ret.first->first);
+    ret.first->second.lruIt = lruKeys.begin();
+    bytes += entryBytes;
+    ++stores;
+    EvictEntries();
+}
+
+void CRPCResultCache::EvictEntries() {
+    while (bytes > maxBytes && !lruKeys.empty()) {
+        auto it = mapEntries.find(*lruKeys.back());
+        bytes -= GetEntryBytes(it->first, it->second);
+        lruKeys.pop_back();
+        mapEntries.erase(it);
+    }
+}
+
+CRPCResultCache::CStats CRPCResultCache::GetStats() {
+    CStats stats;
+    stats.hits     = hits;
+    stats.misses   = misses;
+    stats.stores   = stores;
+    stats.maxBytes = maxBytes;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    stats.entries = mapEntries.size();
+    stats.bytes   = bytes;
+    return stats;
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RPC_CORE_RPCCACHE_H
+#define RPC_CORE_RPCCACHE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "commons/json/json_spirit_value.h"
+#include "commons/json/jsonwriter.h"
+
+static const int64_t DEFAULT_RPC_CACHE_SIZE = 64;   // MiB
+static const int64_t MAX_RPC_CACHE_SIZE     = 4096; // MiB
+
+/**
+ * The result of a call of a cached RPC, written by the cache function of the RPC. Besides the
+ * confirmations, which are rewritten at each hit, the result must only depend on the block at
+ * height, so that it never changes once the block is below the global finalized block.
+ */
+class CRPCCachedResult {
+public:
+    CJsonWriter writer;
+    // the height of the block the result is read from, -1 if it is not on the active chain
+    int32_t height = -1;
+
+    // the result as an object, its top level confirmations member is computed at each hit as
+    // the tip height - height + base
+    void WriteObject(const json_spirit::Object& obj, int32_t base);
+    // the confirmations number starting at pos of the written result
+    void SetConfirmations(size_t pos, int32_t base);
+
+    bool HasConfirmations() const { return confirmationsPos != std::string::npos; }
+
+private:
+    friend class CRPCResultCache;
+
+    size_t confirmationsPos   = std::string::npos;
+    int32_t confirmationsBase = 0;
+};
+
+/**
+ * Bounded LRU cache of the results of the RPCs reading immutable data, e.g. blocks and tx details,
+ * keyed by the method and its params. The results are stored only when their block is below the
+ * global finalized block, which can not be reorganized, so the entries are never invalidated.
+ */
+class CRPCResultCache {
+public:
+    struct CStats {
+        uint64_t hits     = 0;
+        uint64_t misses   = 0;
+        uint64_t stores   = 0;
+        uint64_t entries  = 0;
+        uint64_t bytes    = 0;
+        uint64_t maxBytes = 0;
+    };
+
+    // 0 disables the cache
+    void SetMaxBytes(size_t maxBytesIn);
+    bool IsEnabled() const { return maxBytes > 0; }
+
+    // called on each tip change, the confirmations of the hits and the stores are computed from them
+    void SetChainHeights(int32_t tipHeightIn, int32_t finHeightIn) {
+        tipHeight = tipHeightIn;
+        finHeight = finHeightIn;
+    }
+
+    static std::string MakeKey(const std::string& method, const json_spirit::Array& params);
+
+    // write the cached result of key, false if it is not cached
+    bool Get(const std::string& key, CJsonWriter& writer);
+    // store the result if its block is finalized
+    void Put(const std::string& key, const CRPCCachedResult& result);
+
+    CStats GetStats();
+
+private:
+    // approx. heap cost of an entry besides its strings: the list and hash map nodes
+    static const size_t ENTRY_BYTES = 128;
+
+    struct CEntry {
+        std::string json;
+        int32_t height;
+        size_t confirmationsPos;
+        size_t confirmationsLen;
+        int32_t confirmationsBase;
+        std::list<const std::string*>::iterator lruIt;
+    };
+
+    static size_t GetEntryBytes(const std::string& key, const CEntry& entry) {
+        return key.size() + entry.json.size() + ENTRY_BYTES;
+    }
+    void EvictEntries();
+
+    std::mutex mtx;
+    std::unordered_map<std::string, CEntry> mapEntries;
+    std::list<const std::string*> lruKeys;  // the keys of mapEntries, the most recently used first
+    size_t bytes = 0;
+
+    std::atomic<size_t> maxBytes{0};
+    std::atomic<int32_t> tipHeight{-1};
+    std::atomic<int32_t> finHeight{-1};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> stores{0};
+};
+
+extern CRPCResultCache rpcResultCache;
+
+#endif  // RPC_CORE_RPCCACHE_H
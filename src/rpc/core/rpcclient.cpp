@@ -21,26 +21,59 @@
 #include <boost/iostreams/concepts.hpp>
 #include <boost/iostreams/stream.hpp>
 
+#include <fstream>
+#include <memory>
+#include <mutex>
+
 using namespace std;
 using namespace boost;
 using namespace boost::asio;
 using namespace json_spirit;
 
-Object CallRPC(const string& strMethod, const Array& params) {
+static void CheckRPCCredentials() {
     if (SysCfg().GetArg("-rpcuser", "") == "" && SysCfg().GetArg("-rpcpassword", "") == "")
         throw runtime_error(strprintf(
             _("You must set rpcpassword=<password> in the configuration file:\n%s\n"
               "If the file does not exist, create it with owner-readable-only file permissions."),
                 GetConfigFile().string().c_str()));
+}
+
+/**
+ * The connection to the RPC server, kept open over the calls of the process by HTTP/1.1 keep-alive.
+ * It is opened again once the server closed it, e.g. after its idle timeout, which is checked before a
+ * request is sent on it. A request is sent once again on a new connection only when it could not be
+ * written, a request written but not replied may have been executed and is not submitted twice.
+ */
+class CRPCConnection {
+public:
+    CRPCConnection() : fUseSSL(SysCfg().GetBoolArg("-rpcssl", false)), context(io_service, ssl::context::sslv23) {
+        context.set_options(ssl::context::no_sslv2);
+    }
+
+    // Post the JSON-RPC request, a call or a batch of calls, and return the parsed reply
+    Value Post(const string& strRequest);
+
+private:
+    typedef SSLIOStreamDevice<asio::ip::tcp> Device;
+
+    void Connect();
+    // whether the idle connection was closed or is unusable, e.g. by the idle timeout of the server
+    bool IsClosedByServer();
+    void Disconnect() {
+        pStream.reset();
+        pSslStream.reset();
+    }
 
-    // Connect to localhost
-    bool fUseSSL = SysCfg().GetBoolArg("-rpcssl", false);
+    bool fUseSSL;
     asio::io_service io_service;
-    ssl::context context(io_service, ssl::context::sslv23);
-    context.set_options(ssl::context::no_sslv2);
-    asio::ssl::stream<asio::ip::tcp::socket> sslStream(io_service, context);
-    SSLIOStreamDevice<asio::ip::tcp> d(sslStream, fUseSSL);
-    iostreams::stream< SSLIOStreamDevice<asio::ip::tcp> > stream(d);
+    ssl::context context;
+    std::unique_ptr<asio::ssl::stream<asio::ip::tcp::socket>> pSslStream;
+    std::unique_ptr<iostreams::stream<Device>> pStream;
+};
+
+void CRPCConnection::Connect() {
+    pSslStream.reset(new asio::ssl::stream<asio::ip::tcp::socket>(io_service, context));
+    Device d(*pSslStream, fUseSSL);
 
     bool fWait = SysCfg().GetBoolArg("-rpcwait", false); // -rpcwait means try until server has started
     do {
@@ -49,29 +82,69 @@ Object CallRPC(const string& strMethod, const Array& params) {
         if (fConnected) break;
         if (fWait)
             MilliSleep(1000);
-        else
+        else {
+            pSslStream.reset();
             throw runtime_error("couldn't connect to server... pls wait for a while or check \"rpcserver=1\" setting.");
+        }
     } while (fWait);
 
+    pStream.reset(new iostreams::stream<Device>(d));
+}
+
+bool CRPCConnection::IsClosedByServer() {
+    // nothing is to be read on an idle connection but its close, peek at it without blocking
+    asio::ip::tcp::socket &socket = pSslStream->next_layer();
+    boost::system::error_code ec;
+    char c;
+    socket.non_blocking(true, ec);
+    if (ec)
+        return true;
+    socket.receive(asio::buffer(&c, 1), asio::socket_base::message_peek, ec);
+    bool fClosed = ec != asio::error::would_block;
+    socket.non_blocking(false, ec);
+    return fClosed || ec;
+}
+
+Value CRPCConnection::Post(const string& strRequest) {
     // HTTP basic authentication
     string strUserPass64 = EncodeBase64(SysCfg().GetArg("-rpcuser", "") + ":"
         + SysCfg().GetArg("-rpcpassword", ""));
     map<string, string> mapRequestHeaders;
     mapRequestHeaders["Authorization"] = string("Basic ") + strUserPass64;
+    string strPost = HTTPPost(strRequest, mapRequestHeaders, true);
 
-    // Send request
-    string strRequest = JSONRPCRequest(strMethod, params, 1);
-    string strPost    = HTTPPost(strRequest, mapRequestHeaders);
-    stream << strPost << flush;
+    int nProto  = 0;
+    int nStatus = 0;
+    if (pStream != nullptr && IsClosedByServer())
+        Disconnect();
+    for (bool fRetry = true; ; fRetry = false) {
+        bool fReused = pStream != nullptr;
+        if (!fReused)
+            Connect();
+
+        // Send request, only a request not written is sent again
+        *pStream << strPost << flush;
+        if (pStream->good())
+            break;
+
+        Disconnect();
+        if (!fReused || !fRetry)
+            throw runtime_error("couldn't send request to server");
+    }
 
     // Receive HTTP reply status
-    int nProto  = 0;
-    int nStatus = ReadHTTPStatus(stream, nProto);
+    nStatus = ReadHTTPStatus(*pStream, nProto);
+    if (!pStream->good()) {
+        Disconnect();
+        throw runtime_error("no response from server");
+    }
 
     // Receive HTTP reply message headers and body
     map<string, string> mapHeaders;
     string strReply;
-    ReadHTTPMessage(stream, mapHeaders, strReply, nProto);
+    ReadHTTPMessage(*pStream, mapHeaders, strReply, nProto);
+    if (!pStream->good() || mapHeaders["connection"] == "close")
+        Disconnect();
 
     if (nStatus == HTTP_UNAUTHORIZED)
         throw runtime_error("incorrect rpcuser or rpcpassword (authorization failed)");
@@ -85,11 +158,58 @@ Object CallRPC(const string& strMethod, const Array& params) {
     if (!read_string(strReply, valReply))
         throw runtime_error("couldn't parse reply from server");
 
-    const Object& reply = valReply.get_obj();
-    if (reply.empty())
+    return valReply;
+}
+
+// the connection of the process, the calls are serialized over it
+static std::mutex csRPCConnection;
+
+static Value PostRPC(const string& strRequest) {
+    static CRPCConnection connection;
+    std::lock_guard<std::mutex> lock(csRPCConnection);
+    return connection.Post(strRequest);
+}
+
+Object CallRPC(const string& strMethod, const Array& params) {
+    CheckRPCCredentials();
+
+    Value valReply = PostRPC(JSONRPCRequest(strMethod, params, 1));
+    if (valReply.type() != obj_type || valReply.get_obj().empty())
         throw runtime_error("expected reply to have result, error and id properties");
 
-    return reply;
+    return valReply.get_obj();
+}
+
+Array CallRPCBatch(const vector<pair<string, Array>>& calls) {
+    CheckRPCCredentials();
+
+    Array batch;
+    for (size_t i = 0; i < calls.size(); i++) {
+        Object request;
+        request.push_back(Pair("method", calls[i].first));
+        request.push_back(Pair("params", calls[i].second));
+        request.push_back(Pair("id", (int64_t)i));
+        batch.push_back(request);
+    }
+    Value valReply = PostRPC(write_string(Value(batch), false) + "\n");
+    if (valReply.type() != array_type)
+        throw runtime_error("expected reply to be an array of replies");
+
+    // the replies are put in the order of the calls by their ids
+    Array replies(calls.size());
+    for (const Value& reply : valReply.get_array()) {
+        if (reply.type() != obj_type)
+            throw runtime_error("expected reply to have result, error and id properties");
+        const Value& id = find_value(reply.get_obj(), "id");
+        if (id.type() != int_type || id.get_int64() < 0 || id.get_int64() >= (int64_t)calls.size())
+            throw runtime_error("reply of an unknown id from server");
+        replies[id.get_int64()] = reply;
+    }
+    for (const Value& reply : replies) {
+        if (reply.type() != obj_type)
+            throw runtime_error("no reply from server to a call of the batch");
+    }
+    return replies;
 }
 
 template <typename T>
@@ -132,6 +252,11 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "createmulsig"           && n > 0) ConvertTo<int64_t>(params[0]);
     if (strMethod == "createmulsig"           && n > 1) ConvertTo<Array>(params[1]);
     if (strMethod == "signtxraw"              && n > 1) ConvertTo<Array>(params[1]);
+    if (strMethod == "signtxrawbatch"         && n > 0) ConvertTo<Array>(params[0]);
+    if (strMethod == "submittxrawbatch"       && n > 0) ConvertTo<Array>(params[0]);
+    if (strMethod == "getaccountsinfo"        && n > 0) ConvertTo<Array>(params[0]);
+    if (strMethod == "simulatetx"             && n > 0) ConvertTo<Array>(params[0]);
+    if (strMethod == "simulatetx"             && n > 1) ConvertTo<bool>(params[1]);
 
     if (strMethod == "getblock"               && n > 1) ConvertTo<bool>(params[1]);
     if (strMethod == "getchaininfo"           && n > 0) ConvertTo<int32_t>(params[0]);
@@ -139,7 +264,10 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "verifychain"            && n > 0) ConvertTo<int64_t>(params[0]);
     if (strMethod == "verifychain"            && n > 1) ConvertTo<int64_t>(params[1]);
     if (strMethod == "getrawmempool"          && n > 0) ConvertTo<bool>(params[0]);
+    if (strMethod == "getmempooldiff"         && n > 0) ConvertTo<int64_t>(params[0]);
+    if (strMethod == "estimatefee"            && n > 0) ConvertTo<int32_t>(params[0]);
     if (strMethod == "getnewaddr"             && n > 0) ConvertTo<bool>(params[0]);
+    if (strMethod == "getnewaddrs"            && n > 0) ConvertTo<int64_t>(params[0]);
 
 
     if (strMethod == "submitdelegatevotetx"         && n > 1) ConvertTo<Array>(params[1]);
@@ -160,12 +288,26 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "listcontracts"          && n > 0) ConvertTo<bool>(params[0]);
     if (strMethod == "getblock"               && n > 0) { if (params[0].get_str().size() < 32) ConvertTo<int32_t>(params[0]); }
     if (strMethod == "getblockundo"           && n > 0) { if (params[0].get_str().size() < 32) ConvertTo<int32_t>(params[0]); }
+    if (strMethod == "getblocktraces"         && n > 0) ConvertTo<int32_t>(params[0]);
+    if (strMethod == "getblockfilter"         && n > 0) { if (params[0].get_str().size() < 32) ConvertTo<int32_t>(params[0]); }
+    if (strMethod == "getblockfilter"         && n > 1) ConvertTo<Array>(params[1]);
+    if (strMethod == "getmedianpricehistory"  && n > 0) ConvertTo<int32_t>(params[0]);
+    if (strMethod == "getmedianpricehistory"  && n > 1) ConvertTo<int32_t>(params[1]);
+    if (strMethod == "gettxdetail"            && n > 1) ConvertTo<bool>(params[1]);
 
     /********************************************************************************************************************/
     if (strMethod == "getcontractdata"        && n > 2) ConvertTo<bool>(params[2]);
 
+    if (strMethod == "rescanwallet"           && n > 0) ConvertTo<int32_t>(params[0]);
+    if (strMethod == "getlockstats"           && n > 1) ConvertTo<int32_t>(params[1]);
+    if (strMethod == "getmemoryinfo"          && n > 0) ConvertTo<bool>(params[0]);
+    if (strMethod == "setlockprofiling"       && n > 0) ConvertTo<bool>(params[0]);
+    if (strMethod == "getaddresstxids"        && n > 1) ConvertTo<int32_t>(params[1]);
+    if (strMethod == "getaddresstxids"        && n > 2) ConvertTo<int32_t>(params[2]);
+    if (strMethod == "getaddresstxids"        && n > 3) ConvertTo<int32_t>(params[3]);
     if (strMethod == "listtx"                 && n > 0) ConvertTo<int32_t>(params[0]);
     if (strMethod == "listtx"                 && n > 1) ConvertTo<int32_t>(params[1]);
+    if (strMethod == "listtx"                 && n > 2) ConvertTo<bool>(params[2]);
     if (strMethod == "listdelegates"          && n > 0) ConvertTo<int32_t>(params[0]);
 
     if (strMethod == "invalidateblock"        && n > 0) { if (params[0].get_str().size() < 32) ConvertTo<int32_t>(params[0]); }
@@ -202,6 +344,13 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "getdexorders"              && n > 0) ConvertTo<int64_t>(params[0]);
     if (strMethod == "getdexorders"              && n > 1) ConvertTo<int64_t>(params[1]);
     if (strMethod == "getdexorders"              && n > 2) ConvertTo<int64_t>(params[2]);
+    if (strMethod == "opendexorderscursor"       && n > 0) ConvertTo<int64_t>(params[0]);
+    if (strMethod == "opendexorderscursor"       && n > 1) ConvertTo<int64_t>(params[1]);
+    if (strMethod == "readdexorderscursor"       && n > 1) ConvertTo<int64_t>(params[1]);
+    if (strMethod == "getdexorderbook"           && n > 0) ConvertTo<int64_t>(params[0]);
+    if (strMethod == "getdexorderbook"           && n > 3) ConvertTo<int64_t>(params[3]);
+    if (strMethod == "getdexorderbookdepth"      && n > 0) ConvertTo<int64_t>(params[0]);
+    if (strMethod == "getdexorderbookdepth"      && n > 3) ConvertTo<int64_t>(params[3]);
     if (strMethod == "getdexoperator"            && n > 0) ConvertTo<int64_t>(params[0]);
 
     if (strMethod == "startcommontpstest"       && n > 0)    ConvertTo<int64_t>(params[0]);
@@ -217,6 +366,7 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "submitcdpredeemtx"        && n > 3) ConvertTo<int64_t>(params[3]);
 
     if (strMethod == "submitcdpliquidatetx"     && n > 2) ConvertTo<int64_t>(params[2]);
+    if (strMethod == "getcdpstats"              && n > 0) ConvertTo<bool>(params[0]);
 
     if (strMethod == "submitassetissuetx"       && n > 4) ConvertTo<int64_t>(params[4]);
     if (strMethod == "submitassetissuetx"       && n > 5) ConvertTo<bool>(params[5]);
@@ -260,12 +410,149 @@ inline string&   recover_enter(string& str, const string& old_value, const strin
 }
 
 
+// The text of the result of a reply, or of its error with the exit code of it
+static int FormatReply(const Object& reply, string& strPrint, bool fPretty) {
+    const Value& result = find_value(reply, "result");
+    const Value& error  = find_value(reply, "error");
+
+    if (error.type() != null_type)
+    {
+        // Error
+        strPrint = "error: " + write_string(error, false);
+        const Value& code = error.type() == obj_type ? find_value(error.get_obj(), "code") : Value::null;
+        return code.type() == int_type ? abs(code.get_int()) : abs(RPC_MISC_ERROR);
+    }
+
+    // Result
+    if (result.type() == null_type)
+        strPrint = "";
+    else if (result.type() == str_type)
+        strPrint = result.get_str();
+    else
+        strPrint = write_string(result, fPretty);
+    return 0;
+}
+
+// Split a line of the batch input into the method and its params as a shell does: the words are
+// separated by blanks, '...' is kept as is and "..." is kept with its backslash escapes resolved.
+static vector<string> SplitCommandLine(const string& line) {
+    vector<string> words;
+    string word;
+    bool fInWord = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            if (fInWord)
+                words.push_back(word);
+            word.clear();
+            fInWord = false;
+            continue;
+        }
+        fInWord = true;
+        if (c == '\'') {
+            size_t end = line.find('\'', i + 1);
+            if (end == string::npos)
+                throw runtime_error("unterminated quote");
+            word.append(line, i + 1, end - i - 1);
+            i = end;
+        } else if (c == '"') {
+            for (i++; i < line.size() && line[i] != '"'; i++) {
+                if (line[i] == '\\' && i + 1 < line.size())
+                    i++;
+                word += line[i];
+            }
+            if (i == line.size())
+                throw runtime_error("unterminated quote");
+        } else if (c == '\\' && i + 1 < line.size()) {
+            word += line[++i];
+        } else {
+            word += c;
+        }
+    }
+    if (fInWord)
+        words.push_back(word);
+    return words;
+}
+
+/**
+ * Run the commands of the input, one per line as on the command line, over one connection in JSON-RPC
+ * batches of batchSize. The results are printed in the order of the commands, one line each, an error
+ * prefixed by "error: ". The blank lines and the lines starting with # are skipped.
+ */
+static int BatchCommandLineRPC(istream& input, size_t batchSize) {
+    int nRet = 0;
+    string line;
+    bool fEnd = false;
+    while (!fEnd) {
+        // the calls of the batch, and the errors of the commands not sent in place of their replies
+        vector<pair<string, Array>> calls;
+        vector<string> lineErrors;
+        while (calls.size() < batchSize) {
+            if (!getline(input, line)) {
+                fEnd = true;
+                break;
+            }
+            try {
+                vector<string> words = SplitCommandLine(line);
+                if (words.empty() || words[0][0] == '#')
+                    continue;
+                vector<string> strParams(words.begin() + 1, words.end());
+                calls.emplace_back(words[0], RPCConvertValues(words[0], strParams));
+                lineErrors.emplace_back();
+            } catch (std::exception& e) {
+                calls.emplace_back();
+                lineErrors.emplace_back(string("error: ") + e.what());
+            }
+        }
+
+        vector<pair<string, Array>> sentCalls;
+        for (size_t i = 0; i < calls.size(); i++) {
+            if (lineErrors[i].empty())
+                sentCalls.push_back(calls[i]);
+        }
+        Array replies;
+        if (!sentCalls.empty())
+            replies = CallRPCBatch(sentCalls);
+
+        string strOutput;
+        for (size_t i = 0, next = 0; i < calls.size(); i++) {
+            string strPrint = lineErrors[i];
+            if (strPrint.empty()) {
+                int nCode = FormatReply(replies[next++].get_obj(), strPrint, false);
+                if (nCode != 0)
+                    nRet = nCode;
+            } else {
+                nRet = abs(RPC_MISC_ERROR);
+            }
+            strOutput += strPrint + "\n";
+        }
+        // the results of each batch as soon as it returns, e.g. to a script reading them as a coprocess
+        std::cout << strOutput << flush;
+    }
+    return nRet;
+}
+
 int CommandLineRPC(int argc, char *argv[])
 {
     string strPrint;
     int nRet = 0;
     try
     {
+        // -batch runs the commands of a file or of stdin over one connection, -cliserver runs each
+        // command of stdin as it comes
+        if (SysCfg().GetBoolArg("-cliserver", false))
+            return BatchCommandLineRPC(std::cin, 1);
+        if (SysCfg().IsArgCount("-batch")) {
+            size_t batchSize = max<int64_t>(1, SysCfg().GetArg("-batchsize", DEFAULT_RPC_BATCH_SIZE));
+            string strFile   = SysCfg().GetArg("-batch", "");
+            if (strFile.empty() || strFile == "-")
+                return BatchCommandLineRPC(std::cin, batchSize);
+            std::ifstream file(strFile);
+            if (!file)
+                throw runtime_error(strprintf("couldn't open the batch file %s", strFile));
+            return BatchCommandLineRPC(file, batchSize);
+        }
+
         // Skip switches
         while (argc > 1 && IsSwitchChar(argv[1][0]))
         {
@@ -287,26 +574,7 @@ int CommandLineRPC(int argc, char *argv[])
         Object reply = CallRPC(strMethod, params);
 
         // Parse reply
-        const Value& result = find_value(reply, "result");
-        const Value& error  = find_value(reply, "error");
-
-        if (error.type() != null_type)
-        {
-            // Error
-            strPrint = "error: " + write_string(error, false);
-            int code = find_value(error.get_obj(), "code").get_int();
-            nRet = abs(code);
-        }
-        else
-        {
-            // Result
-            if (result.type() == null_type)
-                strPrint = "";
-            else if (result.type() == str_type)
-                strPrint = result.get_str();
-            else
-                strPrint = write_string(result, true);
-        }
+        nRet = FormatReply(reply, strPrint, true);
     }
     catch (boost::thread_interrupted) {
         throw;
@@ -350,6 +618,9 @@ string HelpMessageCli(bool mainProgram)
     strUsage += "  -rpcconnect=<ip>       " + _("Send commands to node running on <ip> (default: 127.0.0.1)") + "\n";
     strUsage += "  -rpcport=<port>        " + _("Connect to JSON-RPC on <port> (default: 8332 or testnet: 18332)") + "\n";
     strUsage += "  -rpcwait               " + _("Wait for RPC server to start") + "\n";
+    strUsage += "  -batch[=<file>]        " + _("Send the commands of the file or of stdin, one per line, in batches over one connection and print their results one per line") + "\n";
+    strUsage += "  -batchsize=<n>         " + strprintf(_("Commands per batch of -batch (default: %d)"), DEFAULT_RPC_BATCH_SIZE) + "\n";
+    strUsage += "  -cliserver             " + _("Keep the connection open and send each command read from stdin as it comes, e.g. as a coprocess of a script") + "\n";
 
     if (mainProgram) {
         strUsage += "  -rpcuser=<user>        " + _("Username for JSON-RPC connections") + "\n";
@@ -11,10 +11,17 @@
 #include "commons/json/json_spirit_utils.h"
 #include "commons/json/json_spirit_writer_template.h"
 
+/** Commands sent in one JSON-RPC batch by -batch */
+static const int64_t DEFAULT_RPC_BATCH_SIZE = 100;
+
 int CommandLineRPC(int argc, char *argv[]);
 
+/** Call the method on the RPC server, over the connection kept open by the process */
 json_spirit::Object CallRPC(const std::string& strMethod, const json_spirit::Array& params);
 
+/** Send the calls, each of a method and its params, in one JSON-RPC batch and return their replies in order */
+json_spirit::Array CallRPCBatch(const std::vector<std::pair<std::string, json_spirit::Array>>& calls);
+
 json_spirit::Array RPCConvertValues(const std::string &strMethod, const std::vector<std::string> &strParams);
 
 /** Show help message for coin-cli.
@@ -7,6 +7,8 @@
 #include "entities/key.h"
 #include "init.h"
 #include "main.h"
+#include "chain/txlatency.h"
+#include "chain/txlookupcache.h"
 #include "rpcserver.h"
 #include "vm/luavm/luavmrunenv.h"
 #include "wallet/wallet.h"
@@ -224,6 +226,8 @@ bool ParseRpcInputMoney(const string &comboMoneyStr, ComboMoney &comboMoney, con
 
 
 Object SubmitTx(const CKeyID &keyid, CBaseTx &tx) {
+    if (!pWalletMain)
+        throw JSONRPCError(RPC_WALLET_ERROR, "The wallet is disabled");
     if (!pWalletMain->HaveKey(keyid)) {
         throw JSONRPCError(RPC_WALLET_ERROR, "Sender address not found in wallet");
     }
@@ -232,6 +236,7 @@ Object SubmitTx(const CKeyID &keyid, CBaseTx &tx) {
         throw JSONRPCError(RPC_WALLET_ERROR, "Sign failed");
     }
 
+    txLatencyTracer.Stamp(tx.GetHash(), TX_STAGE_RPC_RECEIVED);
     std::tuple<bool, string> ret = pWalletMain->CommitTx((CBaseTx *)&tx);
     if (!std::get<0>(ret)) {
         throw JSONRPCError(RPC_WALLET_ERROR,
@@ -244,6 +249,31 @@ Object SubmitTx(const CKeyID &keyid, CBaseTx &tx) {
     return obj;
 }
 
+Object GetRPCCacheStatsJSON() {
+    CRPCResultCache::CStats stats = rpcResultCache.GetStats();
+
+    Object obj;
+    obj.push_back(Pair("hits",      stats.hits));
+    obj.push_back(Pair("misses",    stats.misses));
+    obj.push_back(Pair("stores",    stats.stores));
+    obj.push_back(Pair("entries",   stats.entries));
+    obj.push_back(Pair("bytes",     stats.bytes));
+    obj.push_back(Pair("max_bytes", stats.maxBytes));
+    return obj;
+}
+
+Object GetSigCacheStatsJSON() {
+    CSignatureCache::CStats stats = signatureCache.GetStats();
+
+    Object obj;
+    obj.push_back(Pair("hits",      stats.hits));
+    obj.push_back(Pair("misses",    stats.misses));
+    obj.push_back(Pair("entries",   stats.entries));
+    obj.push_back(Pair("bytes",     stats.bytes));
+    obj.push_back(Pair("max_bytes", stats.maxBytes));
+    return obj;
+}
+
 string RegIDToAddress(CUserID &userId) {
     CKeyID keyId;
     if (pCdMan->pAccountCache->GetKeyId(userId, keyId))
@@ -252,58 +282,62 @@ string RegIDToAddress(CUserID &userId) {
     return "cannot get address from given RegId";
 }
 
+bool GetTxConfirmedHeight(const uint256& txid, int32_t& height) {
+    CConfirmedTx confirmedTx;
+    if (!GetConfirmedTx(txid, *pCdMan->pBlockCache, confirmedTx))
+        return false;
+
+    height = confirmedTx.height;
+    return true;
+}
+
 Object GetTxDetailJSON(const uint256& txid) {
     Object obj;
     {
         std::shared_ptr<CBaseTx> pBaseTx;
 
         LOCK(cs_main);
-        if (SysCfg().IsTxIndex()) {
-            CDiskTxPos postx;
-            if (pCdMan->pBlockCache->ReadTxIndex(txid, postx)) {
-                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                CBlockHeader header;
-
-                try {
-                    file >> header;
-                    fseek(file, postx.nTxOffset, SEEK_CUR);
-                    file >> pBaseTx;
-                    //obj = pBaseTx->IsMultiSignSupport()?pBaseTx->ToJsonMultiSign(*database):pBaseTx->ToJson(*pCdMan->pAccountCache);
-                    obj = pBaseTx->ToJson(*pCdMan->pAccountCache);
-
-                    obj.push_back(Pair("confirmations",     chainActive.Height() - (int32_t)header.GetHeight()));
-                    obj.push_back(Pair("confirmed_height",  (int32_t)header.GetHeight()));
-                    obj.push_back(Pair("confirmed_time",    (int32_t)header.GetTime()));
-                    obj.push_back(Pair("block_hash",        header.GetHash().GetHex()));
-
-                    if (SysCfg().IsGenReceipt()) {
-                        vector<CReceipt> receipts;
-                        pCdMan->pReceiptCache->GetTxReceipts(txid, receipts);
-                        obj.push_back(Pair("receipts", JSON::ToJson(*pCdMan->pAccountCache, receipts)));
-                    }
-
-                    CDataStream ds(SER_DISK, CLIENT_VERSION);
-                    ds << pBaseTx;
-                    obj.push_back(Pair("rawtx", HexStr(ds.begin(), ds.end())));
-
-                    string trace;
-                    auto database = std::make_shared<CCacheWrapper>(pCdMan);
-                    auto resolver = make_resolver(database);
-                    if(database->contractCache.GetContractTraces(txid, trace)){
-
-                        json_spirit::Value value_json;
-                        std::vector<char>  trace_bytes = std::vector<char>(trace.begin(), trace.end());
-                        transaction_trace  trace       = wasm::unpack<transaction_trace>(trace_bytes);
-                        to_variant(trace, value_json, resolver);
-                        obj.push_back(Pair("tx_trace", value_json));
-                     }
-
-                } catch (std::exception &e) {
-                    throw runtime_error(tfm::format("%s : Deserialize or I/O error - %s", __func__, e.what()).c_str());
+        CConfirmedTx confirmedTx;
+        // the wallet txs are found in the block files without the tx index
+        if (GetConfirmedTx(txid, *pCdMan->pBlockCache, confirmedTx) ||
+            (pWalletMain != nullptr && pWalletMain->GetConfirmedTx(txid, confirmedTx))) {
+            pBaseTx = confirmedTx.pBaseTx;
+            try {
+                //obj = pBaseTx->IsMultiSignSupport()?pBaseTx->ToJsonMultiSign(*database):pBaseTx->ToJson(*pCdMan->pAccountCache);
+                obj = pBaseTx->ToJson(*pCdMan->pAccountCache);
+
+                obj.push_back(Pair("confirmations",     chainActive.Height() - confirmedTx.height));
+                obj.push_back(Pair("confirmed_height",  confirmedTx.height));
+                obj.push_back(Pair("confirmed_time",    (int32_t)confirmedTx.time));
+                obj.push_back(Pair("block_hash",        confirmedTx.blockHash.GetHex()));
+
+                if (SysCfg().IsGenReceipt()) {
+                    vector<CReceipt> receipts;
+                    pCdMan->pReceiptCache->GetTxReceipts(txid, receipts);
+                    obj.push_back(Pair("receipts", JSON::ToJson(*pCdMan->pAccountCache, receipts)));
                 }
 
-                return obj;
+                CDataStream ds(SER_DISK, CLIENT_VERSION);
+                ds << pBaseTx;
+                obj.push_back(Pair("rawtx", HexStr(ds.begin(), ds.end())));
+
+                string trace;
+                auto database = std::make_shared<CCacheWrapper>(pCdMan);
+                auto resolver = make_resolver(database);
+                if(database->traceCache.GetContractTraces(txid, trace)){
+
+                    json_spirit::Value value_json;
+                    std::vector<char>  trace_bytes = std::vector<char>(trace.begin(), trace.end());
+                    transaction_trace  trace       = wasm::unpack<transaction_trace>(trace_bytes);
+                    to_variant(trace, value_json, resolver);
+                    obj.push_back(Pair("tx_trace", value_json));
+                 }
+
+            } catch (std::exception &e) {
+                throw runtime_error(tfm::format("%s : Deserialize or I/O error - %s", __func__, e.what()).c_str());
             }
+
+            return obj;
         }
 
         {
@@ -321,7 +355,7 @@ Object GetTxDetailJSON(const uint256& txid) {
         CBlock genesisblock;
         CBlockIndex* pGenesisBlockIndex = mapBlockIndex[SysCfg().GetGenesisBlockHash()];
         ReadBlockFromDisk(pGenesisBlockIndex, genesisblock);
-        assert(genesisblock.GetMerkleRootHash() == genesisblock.BuildMerkleTree());
+        assert(genesisblock.GetMerkleRootHash() == genesisblock.ComputeMerkleRoot());
         for (uint32_t i = 0; i < genesisblock.vptx.size(); ++i) {
             if (txid == genesisblock.GetTxid(i)) {
                 obj = genesisblock.vptx[i]->ToJson(*pCdMan->pAccountCache);
@@ -374,6 +408,14 @@ const char* JSON::GetValueTypeName(const Value_type &valueType) {
     return "unknown";
 }
 
+Value JSON::FromWriter(const CJsonWriter &writer) {
+    Value value;
+    if (!read_string(writer.GetString(), value))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Parse the written json failed");
+
+    return value;
+}
+
 
 Object JSON::ToJson(const CAccountDBCache &accountCache, const CReceipt &receipt) {
     CKeyID fromKeyId, toKeyId;
@@ -531,7 +573,8 @@ CUserID RPC_PARAM::GetUserId(const Value &jsonValue, const bool senderUid ) {
         } else {
             if (senderUid && pUserId->is<CKeyID>()) {
                 CPubKey sendPubKey;
-                if (!pWalletMain->GetPubKey(pUserId->get<CKeyID>(), sendPubKey) || !sendPubKey.IsFullyValid())
+                if (!pWalletMain || !pWalletMain->GetPubKey(pUserId->get<CKeyID>(), sendPubKey) ||
+                    !sendPubKey.IsFullyValid())
                     throw JSONRPCError(RPC_WALLET_ERROR, "Key not found in the local wallet");
 
                 return CUserID(sendPubKey);
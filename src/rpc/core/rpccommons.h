@@ -11,6 +11,7 @@
 
 #include "entities/id.h"
 #include "commons/json/json_spirit.h"
+#include "commons/json/jsonwriter.h"
 #include "entities/asset.h"
 #include "entities/account.h"
 #include "tx/tx.h"
@@ -21,14 +22,20 @@ using namespace json_spirit;
 
 string RegIDToAddress(CUserID &userId);
 Object GetTxDetailJSON(const uint256& txid);
+// the height of the block of a confirmed tx, from the tx index
+bool GetTxConfirmedHeight(const uint256& txid, int32_t& height);
 Array GetTxAddressDetail(std::shared_ptr<CBaseTx> pBaseTx);
 
 Object SubmitTx(const CKeyID &keyid, CBaseTx &tx);
+Object GetSigCacheStatsJSON();
+Object GetRPCCacheStatsJSON();
 
 namespace JSON {
     const Value& GetObjectFieldValue(const Value &jsonObj, const string &fieldName);
     bool  GetObjectFieldValue(const Value &jsonObj, const string &fieldName,Value& returnValue);
     const char* GetValueTypeName(const Value_type &valueType);
+    // the value written by a streaming RPC, for the callers of the Value actors
+    Value FromWriter(const CJsonWriter &writer);
 
     Object ToJson(const CAccountDBCache &accountCache, const CReceipt &receipt);
     Array ToJson(const CAccountDBCache &accountCache, const vector<CReceipt> &receipts);
@@ -0,0 +1,264 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpcevents.h"
+
+#include "commons/json/jsonwriter.h"
+#include "commons/util/util.h"
+#include "persistence/cachewrapper.h"
+#include "rpc/core/httpserver.h"
+#include "rpc/core/rpccommons.h"
+#include "rpc/core/rpcprotocol.h"
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
+using namespace json_spirit;
+
+CRPCEventPublisher rpcEventPublisher;
+
+static const char* GetDexEventName(TxType txType) {
+    switch (txType) {
+        case DEX_LIMIT_BUY_ORDER_TX:
+        case DEX_LIMIT_SELL_ORDER_TX:
+        case DEX_MARKET_BUY_ORDER_TX:
+        case DEX_MARKET_SELL_ORDER_TX:
+        case DEX_ORDER_TX:
+        case DEX_OPERATOR_ORDER_TX:
+            return "dex_order";
+        case DEX_CANCEL_ORDER_TX:
+            return "dex_cancel";
+        case DEX_TRADE_SETTLE_TX:
+            return "dex_settle";
+        default:
+            return nullptr;
+    }
+}
+
+void CRPCEventPublisher::Start() {
+    maxBacklog     = std::max<int64_t>(SysCfg().GetArg("-rpceventbacklog", DEFAULT_RPC_EVENT_BACKLOG), 1024);
+    maxSubscribers = std::max<int64_t>(SysCfg().GetArg("-rpceventsubscribers", DEFAULT_RPC_EVENT_SUBSCRIBERS), 0);
+    // the idle streams are written before the -rpcservertimeout, which closes a stuck client
+    heartbeatSeconds = std::max<int64_t>(SysCfg().GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT) / 2, 1);
+
+    struct event_base* eventBase = EventBase();
+    assert(eventBase);
+    heartbeat = new HTTPEvent(eventBase, false, [this] { Heartbeat(); });
+    struct timeval tv = {heartbeatSeconds, 0};
+    heartbeat->trigger(&tv);
+
+    RegisterWallet(this);
+    started = true;
+    LogPrint(BCLog::RPC, "Started the event publisher, max %u subscribers with a backlog of %u bytes\n",
+             maxSubscribers, maxBacklog);
+}
+
+void CRPCEventPublisher::Stop() {
+    if (!started)
+        return;
+
+    UnregisterWallet(this);
+    // deleted before the event loop exits, a pending timer keeps it running
+    delete heartbeat;
+    heartbeat = nullptr;
+
+    std::lock_guard<std::mutex> lock(cs);
+    for (const auto& subscriber : subscribers)
+        subscriber.stream->Close();
+    subscribers.clear();
+    UpdateTopics();
+    started = false;
+}
+
+bool CRPCEventPublisher::ParseTopics(const std::string& path, uint32_t& topics) {
+    topics = TOPIC_ALL;
+    if (path.empty())
+        return true;
+    if (path[0] != '?')
+        return false;
+
+    std::vector<std::string> params;
+    boost::split(params, path.substr(1), boost::is_any_of("&"));
+    for (const auto& param : params) {
+        if (param.compare(0, 7, "topics=") != 0)
+            continue;
+
+        std::vector<std::string> names;
+        boost::split(names, urlDecode(param.substr(7)), boost::is_any_of(","));
+        topics = 0;
+        for (const auto& name : names) {
+            if (name == "block")
+                topics |= TOPIC_BLOCK;
+            else if (name == "tx")
+                topics |= TOPIC_TX;
+            else if (name == "receipt")
+                topics |= TOPIC_RECEIPT;
+            else if (name == "dex")
+                topics |= TOPIC_DEX;
+            else
+                return false;
+        }
+    }
+    return true;
+}
+
+bool CRPCEventPublisher::Subscribe(HTTPRequest* req, const std::string& path) {
+    uint32_t topics;
+    if (!ParseTopics(path, topics)) {
+        req->WriteReply(HTTP_BAD_REQUEST, "Invalid topics, expected a list of block, tx, receipt and dex");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(cs);
+    if (!started || subscribers.size() >= maxSubscribers) {
+        req->WriteHeader("Retry-After", "10");
+        req->WriteReply(HTTP_SERVICE_UNAVAILABLE, "Too many event subscribers");
+        return false;
+    }
+
+    req->WriteHeader("Content-Type", "text/event-stream");
+    req->WriteHeader("Cache-Control", "no-cache");
+    std::shared_ptr<HTTPStream> stream = req->StartStream(HTTP_OK, maxBacklog);
+    stream->Write(": subscribed\n\n");
+    subscribers.push_back({stream, topics});
+    UpdateTopics();
+
+    LogPrint(BCLog::RPC, "New event subscriber, topics=%x subscribers=%u\n", topics, subscribers.size());
+    return true;
+}
+
+void CRPCEventPublisher::SyncTransaction(const uint256& hash, CBaseTx* pBaseTx, const CBlock* pBlock) {
+    if (pBlock != nullptr) {
+        PublishBlock(*pBlock);
+        return;
+    }
+
+    // a tx accepted to the mempool
+    if (pBaseTx == nullptr || !HasSubscribers(TOPIC_TX))
+        return;
+
+    Object obj;
+    obj.push_back(Pair("txid",          hash.GetHex()));
+    obj.push_back(Pair("tx_type",       pBaseTx->GetTxTypeName()));
+    obj.push_back(Pair("tx_uid",        pBaseTx->txUid.ToString()));
+    obj.push_back(Pair("valid_height",  pBaseTx->valid_height));
+    obj.push_back(Pair("fee_symbol",    pBaseTx->fee_symbol));
+    obj.push_back(Pair("fees",          pBaseTx->llFees));
+    Publish(TOPIC_TX, "tx_accepted", obj);
+}
+
+void CRPCEventPublisher::EraseTransaction(const uint256& hash) {
+    if (!HasSubscribers(TOPIC_TX))
+        return;
+
+    Object obj;
+    obj.push_back(Pair("txid", hash.GetHex()));
+    Publish(TOPIC_TX, "tx_removed", obj);
+}
+
+// called by UpdateTip() with cs_main held, the block is connected when it is the new tip
+void CRPCEventPublisher::PublishBlock(const CBlock& block) {
+    if (!HasSubscribers(TOPIC_ALL))
+        return;
+
+    uint256 blockHash = block.GetHash();
+    bool connected    = chainActive.Tip() != nullptr && chainActive.Tip()->GetBlockHash() == blockHash;
+    if (HasSubscribers(TOPIC_BLOCK)) {
+        Object obj;
+        obj.push_back(Pair("block_hash",    blockHash.GetHex()));
+        obj.push_back(Pair("height",        (int32_t)block.GetHeight()));
+        obj.push_back(Pair("prev_hash",     block.GetPrevBlockHash().GetHex()));
+        obj.push_back(Pair("time",          block.GetBlockTime()));
+        obj.push_back(Pair("tx_count",      (int32_t)block.vptx.size()));
+        Publish(TOPIC_BLOCK, connected ? "block_connected" : "block_disconnected", obj);
+    }
+
+    // the receipts and the DEX txs of a disconnected block are undone by its block_disconnected
+    if (!connected || !HasSubscribers(TOPIC_RECEIPT | TOPIC_DEX))
+        return;
+
+    for (const auto& pTx : block.vptx) {
+        uint256 txid = pTx->GetHash();
+        if (HasSubscribers(TOPIC_RECEIPT)) {
+            vector<CReceipt> receipts;
+            if (pCdMan->pReceiptCache->GetTxReceipts(txid, receipts) && !receipts.empty()) {
+                Object obj;
+                obj.push_back(Pair("txid",          txid.GetHex()));
+                obj.push_back(Pair("block_hash",    blockHash.GetHex()));
+                obj.push_back(Pair("height",        (int32_t)block.GetHeight()));
+                obj.push_back(Pair("receipts",      JSON::ToJson(*pCdMan->pAccountCache, receipts)));
+                Publish(TOPIC_RECEIPT, "receipts", obj);
+            }
+        }
+
+        const char* dexEvent = GetDexEventName(pTx->nTxType);
+        if (dexEvent != nullptr && HasSubscribers(TOPIC_DEX)) {
+            Object obj;
+            obj.push_back(Pair("block_hash",    blockHash.GetHex()));
+            obj.push_back(Pair("height",        (int32_t)block.GetHeight()));
+            obj.push_back(Pair("tx",            pTx->ToJson(*pCdMan->pAccountCache)));
+            Publish(TOPIC_DEX, dexEvent, obj);
+        }
+    }
+}
+
+void CRPCEventPublisher::Publish(uint32_t topic, const char* event, const Object& data) {
+    CJsonWriter writer;
+    writer.WriteValue(data);
+    std::string chunk = strprintf("id: %d\nevent: %s\ndata: %s\n\n", ++events, event, writer.GetString());
+
+    std::lock_guard<std::mutex> lock(cs);
+    size_t count = subscribers.size();
+    for (auto it = subscribers.begin(); it != subscribers.end();) {
+        if (it->stream->IsClosed()) {  // by the client or the shutdown
+            it = subscribers.erase(it);
+            continue;
+        }
+        if ((it->topics & topic) && !it->stream->Write(chunk)) {  // closed for its backlog
+            ++dropped;
+            it = subscribers.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    if (subscribers.size() != count)
+        UpdateTopics();
+}
+
+// on the event thread, the comment lines keep the idle streams alive and detect the gone clients
+void CRPCEventPublisher::Heartbeat() {
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        size_t count = subscribers.size();
+        for (auto it = subscribers.begin(); it != subscribers.end();) {
+            if (!it->stream->Write(":\n\n")) {
+                it = subscribers.erase(it);
+                continue;
+            }
+            ++it;
+        }
+        if (subscribers.size() != count)
+            UpdateTopics();
+    }
+
+    struct timeval tv = {heartbeatSeconds, 0};
+    heartbeat->trigger(&tv);
+}
+
+void CRPCEventPublisher::UpdateTopics() {
+    uint32_t topics = 0;
+    for (const auto& subscriber : subscribers)
+        topics |= subscriber.topics;
+    activeTopics = topics;
+}
+
+CRPCEventPublisher::CStats CRPCEventPublisher::GetStats() {
+    CStats stats;
+    stats.events  = events;
+    stats.dropped = dropped;
+
+    std::lock_guard<std::mutex> lock(cs);
+    stats.subscribers = subscribers.size();
+    return stats;
+}
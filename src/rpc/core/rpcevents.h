@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RPC_CORE_RPCEVENTS_H
+#define RPC_CORE_RPCEVENTS_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "commons/json/json_spirit_value.h"
+#include "main.h"
+
+class HTTPEvent;
+class HTTPRequest;
+class HTTPStream;
+
+static const int64_t DEFAULT_RPC_EVENT_BACKLOG     = 4 << 20;  // bytes per subscriber
+static const int32_t DEFAULT_RPC_EVENT_SUBSCRIBERS = 16;
+
+/**
+ * Pushes the chain events to the subscribers of GET /events, as Server-Sent Events over a chunked
+ * reply of the RPC server, so that the block explorers and the DEX frontends do not poll getinfo
+ * and getblock. The events come from the core signals, the blocks connected and disconnected by
+ * UpdateTip() and the txs accepted to and removed from the mempool, and are written in the format
+ *
+ *     id: <sequence>
+ *     event: <block_connected|block_disconnected|tx_accepted|tx_removed|receipts|dex_order|...>
+ *     data: <json>
+ *
+ * A subscriber falling behind by more than -rpceventbacklog bytes is disconnected, it resyncs
+ * with the RPCs and subscribes again.
+ */
+class CRPCEventPublisher : public CWalletInterface {
+public:
+    enum Topic : uint32_t {
+        TOPIC_BLOCK   = 1 << 0,
+        TOPIC_TX      = 1 << 1,
+        TOPIC_RECEIPT = 1 << 2,
+        TOPIC_DEX     = 1 << 3,
+        TOPIC_ALL     = TOPIC_BLOCK | TOPIC_TX | TOPIC_RECEIPT | TOPIC_DEX,
+    };
+
+    struct CStats {
+        uint64_t subscribers = 0;
+        uint64_t events      = 0;
+        uint64_t dropped     = 0;  // the subscribers disconnected for their backlog
+    };
+
+    // read the -rpcevent* args and register with the core signals, the HTTP server must be initialized
+    void Start();
+    void Stop();
+
+    // the handler of GET /events?topics=block,tx,receipt,dex, all the topics by default
+    bool Subscribe(HTTPRequest* req, const std::string& path);
+
+    CStats GetStats();
+
+protected:
+    void SyncTransaction(const uint256& hash, CBaseTx* pBaseTx, const CBlock* pBlock) override;
+    void EraseTransaction(const uint256& hash) override;
+    void SetBestChain(const CBlockLocator& locator) override {}
+    void ResendWalletTransactions() override {}
+
+private:
+    struct CSubscriber {
+        std::shared_ptr<HTTPStream> stream;
+        uint32_t topics;
+    };
+
+    static bool ParseTopics(const std::string& path, uint32_t& topics);
+
+    bool HasSubscribers(uint32_t topic) const { return (activeTopics & topic) != 0; }
+    void PublishBlock(const CBlock& block);
+    void Publish(uint32_t topic, const char* event, const json_spirit::Object& data);
+    void Heartbeat();
+    void UpdateTopics();  // with cs held
+
+    std::mutex cs;
+    std::vector<CSubscriber> subscribers;
+    std::atomic<uint32_t> activeTopics{0};
+
+    size_t maxBacklog        = DEFAULT_RPC_EVENT_BACKLOG;
+    size_t maxSubscribers    = DEFAULT_RPC_EVENT_SUBSCRIBERS;
+    int64_t heartbeatSeconds = 1;
+    HTTPEvent* heartbeat     = nullptr;
+    bool started             = false;
+
+    std::atomic<uint64_t> events{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+extern CRPCEventPublisher rpcEventPublisher;
+
+#endif  // RPC_CORE_RPCEVENTS_H
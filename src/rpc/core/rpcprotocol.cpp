@@ -30,14 +30,14 @@ using namespace json_spirit;
 // and to be compatible with other JSON-RPC implementations.
 //
 
-string HTTPPost(const string& strMsg, const map<string, string>& mapRequestHeaders) {
+string HTTPPost(const string& strMsg, const map<string, string>& mapRequestHeaders, bool keepalive) {
     ostringstream s;
     s << "POST / HTTP/1.1\r\n"
       << "User-Agent: Coin-json-rpc/" << FormatFullVersion() << "\r\n"
       << "Host: 127.0.0.1\r\n"
       << "Content-Type: application/json\r\n"
       << "Content-Length: " << strMsg.size() << "\r\n"
-      << "Connection: close\r\n"
+      << "Connection: " << (keepalive ? "keep-alive" : "close") << "\r\n"
       << "Access-Control-Allow-Origin: *"
       << "\r\n"
       << "Access-Control-Allow-Methods: POST, GET, PUT, OPTIONS, DELETE, PATCH"
@@ -234,8 +234,24 @@ Object JSONRPCReplyObj(const Value& result, const Value& error, const Value& id)
 }
 
 string JSONRPCReply(const Value& result, const Value& error, const Value& id) {
-    Object reply = JSONRPCReplyObj(result, error, id);
-    return write_string(Value(reply), false) + "\n";
+    CJsonWriter writer;
+    JSONRPCWriteReply(writer, result, error, id);
+    return writer.GetString() + "\n";
+}
+
+// the same object as JSONRPCReplyObj() without copying the result into it
+void JSONRPCWriteReply(CJsonWriter& writer, const Value& result, const Value& error, const Value& id) {
+    writer.BeginObject();
+    writer.Key("result");
+    if (error.type() != null_type)
+        writer.Null();
+    else
+        writer.WriteValue(result);
+    writer.Key("error");
+    writer.WriteValue(error);
+    writer.Key("id");
+    writer.WriteValue(id);
+    writer.EndObject();
 }
 
 Object JSONRPCError(int code, const string& message) {
@@ -19,6 +19,7 @@
 #include "commons/json/json_spirit_reader_template.h"
 #include "commons/json/json_spirit_utils.h"
 #include "commons/json/json_spirit_writer_template.h"
+#include "commons/json/jsonwriter.h"
 using namespace std;
 // HTTP status codes
 enum HTTPStatusCode
@@ -144,7 +145,7 @@ private:
     boost::asio::ssl::stream<typename Protocol::socket>& stream;
 };
 
-string HTTPPost(const string& strMsg, const map<string,string>& mapRequestHeaders);
+string HTTPPost(const string& strMsg, const map<string,string>& mapRequestHeaders, bool keepalive = false);
 string HTTPReply(int nStatus, const string& strMsg, bool keepalive);
 bool ReadHTTPRequestLine(basic_istream<char>& stream, int &proto,
                          string& http_method, string& http_uri);
@@ -155,6 +156,8 @@ int ReadHTTPMessage(basic_istream<char>& stream, map<string, string>& mapHeaders
 string JSONRPCRequest(const string& strMethod, const json_spirit::Array& params, const json_spirit::Value& id);
 json_spirit::Object JSONRPCReplyObj(const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
 string JSONRPCReply(const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
+void JSONRPCWriteReply(CJsonWriter& writer, const json_spirit::Value& result, const json_spirit::Value& error,
+                       const json_spirit::Value& id);
 json_spirit::Object JSONRPCError(int code, const string& message);
 json_spirit::Object JSONRPCError2(int code, const json_spirit::Value& value);
 
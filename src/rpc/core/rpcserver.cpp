@@ -7,20 +7,32 @@
 #include "rpc/rpcapiconf.h"
 
 #include "logging.h"
+#include "metrics.h"
 #include "commons/base58.h"
 #include "commons/util/util.h"
+#include "commons/util/threadaffinity.h"
 #include "init.h"
 #include "main.h"
 
 #include <boost/algorithm/string.hpp>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include "wallet/wallet.h"
+#include "wallet/walletnotify.h"
 #include "commons/json/json_spirit_writer_template.h"
+#include "commons/json/jsonreader.h"
 #include "httpserver.h"
+#include "rpcevents.h"
+#include "rest.h"
+#include "miner/pbftmanager.h"
 
 using namespace std;
 using namespace json_spirit;
 
+extern CPBFTMan pbftMan;
+
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
  */
@@ -70,6 +82,8 @@ std::unique_ptr<T> MakeUnique(Args&&... args) {
 }
 
 static bool JsonRPCHandler(HTTPRequest* req, const std::string&);
+static bool EventsHandler(HTTPRequest* req, const std::string& path);
+static bool MetricsHandler(HTTPRequest* req, const std::string&);
 
 void RPCTypeCheck(const Array& params, const list<Value_type>& typesExpected, bool fAllowNull) {
     unsigned int i = 0;
@@ -234,6 +248,18 @@ CRPCTable::CRPCTable() {
         pCMD                    = &vRPCCommands[index];
         mapCommands[pCMD->name] = pCMD;
     }
+    for (const auto& command : vRPCStreamCommands) {
+        assert(mapCommands.count(command.name));
+        mapStreamActors[command.name] = command.actor;
+    }
+    for (const auto& command : vRPCCachedCommands) {
+        assert(mapCommands.count(command.name));
+        mapCachedActors[command.name] = command.actor;
+    }
+    for (const char* name : vRPCReadOnlyCommands) {
+        assert(mapCommands.count(name));
+        setReadOnlyCommands.insert(name);
+    }
 }
 
 const CRPCCommand* CRPCTable::operator[](string name) const {
@@ -325,12 +351,42 @@ bool StartRPCServer() {
         return false;
     }
 
+    int64_t nCacheSize = SysCfg().GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE);
+    nCacheSize         = std::max<int64_t>(0, std::min(nCacheSize, MAX_RPC_CACHE_SIZE));
+    rpcResultCache.SetMaxBytes((size_t)(nCacheSize << 20));
+    {
+        LOCK(cs_main);
+        rpcResultCache.SetChainHeights(chainActive.Height(), pbftMan.GetGlobalFinIndex()->height);
+    }
+
     RegisterHTTPHandler("/", true, JsonRPCHandler);
+    RegisterHTTPHandler("/events", false, EventsHandler);
+    if (SysCfg().GetBoolArg("-rest", DEFAULT_REST_ENABLE))
+        StartREST();
+    if (SysCfg().GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE)) {
+        GetMetricsRegistry().AddCollector([]() {
+            metricMempoolTxs.Set(mempool.Size());
+            metricMempoolBytes.Set(mempool.GetUsageSize());
+
+            // the counters take the cpu time added since the last render, the collectors run one at a time
+            static uint64_t lastCpuMicros[THREAD_POOL_COUNT] = {};
+            for (uint8_t pool = THREAD_POOL_NONE + 1; pool < THREAD_POOL_COUNT; pool++) {
+                CThreadPoolStats stats = GetThreadPoolStats((ThreadPoolType)pool);
+                const char *name       = GetThreadPoolName((ThreadPoolType)pool);
+                metricThreadPoolThreads.Get(name).Set(stats.threads);
+                if (stats.cpuMicros > lastCpuMicros[pool])
+                    metricThreadPoolCpu.Get(name).Inc(stats.cpuMicros - lastCpuMicros[pool]);
+                lastCpuMicros[pool] = stats.cpuMicros;
+            }
+        });
+        RegisterHTTPHandler("/metrics", true, MetricsHandler);
+    }
 
     struct event_base* eventBase = EventBase();
     assert(eventBase);
     httpRPCTimerInterface = MakeUnique<HTTPRPCTimerInterface>(eventBase);
     RPCSetTimerInterface(httpRPCTimerInterface.get());
+    rpcEventPublisher.Start();
     StartHTTPServer();
 
     return true;
@@ -344,6 +400,10 @@ void InterruptRPCServer() {
 void StopRPCServer() {
     LogPrint(BCLog::INFO, "Stopping HTTP RPC server\n");
     UnregisterHTTPHandler("/", true);
+    UnregisterHTTPHandler("/events", false);
+    UnregisterHTTPHandler("/metrics", true);
+    StopREST();
+    rpcEventPublisher.Stop();
 
     if (httpRPCTimerInterface) {
         RPCUnsetTimerInterface(httpRPCTimerInterface.get());
@@ -372,6 +432,12 @@ public:
 
     JSONRequest() { id = Value::null; }
     void parse(const Value& valRequest);
+    // parse the request at the position of the reader, the whole request is read even if invalid
+    void parse(CJsonReader& reader);
+
+private:
+    // the members of the request object, null if missing
+    void parse(const Value& valId, const Value& valMethod, const Value& valParams);
 };
 
 void JSONRequest::parse(const Value& valRequest) {
@@ -380,12 +446,42 @@ void JSONRequest::parse(const Value& valRequest) {
         throw JSONRPCError(RPC_INVALID_REQUEST, "Invalid Request object");
 
     const Object& request = valRequest.get_obj();
+    parse(find_value(request, "id"), find_value(request, "method"), find_value(request, "params"));
+}
+
+void JSONRequest::parse(CJsonReader& reader) {
+    if (reader.PeekValue() != '{') {
+        reader.SkipValue();
+        throw JSONRPCError(RPC_INVALID_REQUEST, "Invalid Request object");
+    }
 
+    // only the members of the envelope are built, the first of each as find_value() does
+    Value valId, valMethod, valParams;
+    bool hasId = false, hasMethod = false, hasParams = false;
+    string name;
+    reader.BeginObject();
+    while (reader.NextMember(name)) {
+        if (name == "id" && !hasId) {
+            reader.ReadValue(valId);
+            hasId = true;
+        } else if (name == "method" && !hasMethod) {
+            reader.ReadValue(valMethod);
+            hasMethod = true;
+        } else if (name == "params" && !hasParams) {
+            reader.ReadValue(valParams);
+            hasParams = true;
+        } else {
+            reader.SkipValue();
+        }
+    }
+    parse(valId, valMethod, valParams);
+}
+
+void JSONRequest::parse(const Value& valId, const Value& valMethod, const Value& valParams) {
     // Parse id now so errors from here on will have the id
-    id = find_value(request, "id");
+    id = valId;
 
     // Parse method
-    Value valMethod = find_value(request, "method");
     if (valMethod.type() == null_type)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Missing method");
 
@@ -396,7 +492,6 @@ void JSONRequest::parse(const Value& valRequest) {
     LogPrint(BCLog::RPC, "ThreadRPCServer method=%s\n", strMethod);
 
     // Parse params
-    Value valParams = find_value(request, "params");
     if (valParams.type() == array_type)
         params = valParams.get_array();
     else if (valParams.type() == null_type)
@@ -405,34 +500,157 @@ void JSONRequest::parse(const Value& valRequest) {
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array");
 }
 
-Object JSONRPCExecOne(const Value& req) {
-    Object rpc_result;
+// write the reply of a parsed request, a result written partially is dropped when the call fails
+static void ExecRequest(const JSONRequest& jreq, CJsonWriter& writer) {
+    CJsonWriter::Mark mark = writer.GetMark();
+    try {
+        writer.BeginObject();
+        writer.Key("result");
+        tableRPC.execute(jreq.strMethod, jreq.params, writer);
+        writer.Key("error");
+        writer.Null();
+        writer.Key("id");
+        writer.WriteValue(jreq.id);
+        writer.EndObject();
+    } catch (Object& objError) {
+        writer.Rewind(mark);
+        JSONRPCWriteReply(writer, Value::null, objError, jreq.id);
+    } catch (std::exception& e) {
+        writer.Rewind(mark);
+        JSONRPCWriteReply(writer, Value::null, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+    }
+}
 
+void JSONRPCExecOne(const Value& req, CJsonWriter& writer) {
     JSONRequest jreq;
     try {
         jreq.parse(req);
-
-        Value result = tableRPC.execute(jreq.strMethod, jreq.params);
-        rpc_result   = JSONRPCReplyObj(result, Value::null, jreq.id);
     } catch (Object& objError) {
-        rpc_result = JSONRPCReplyObj(Value::null, objError, jreq.id);
-    } catch (std::exception& e) {
-        rpc_result = JSONRPCReplyObj(Value::null, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        JSONRPCWriteReply(writer, Value::null, objError, jreq.id);
+        return;
     }
+    ExecRequest(jreq, writer);
+}
+
+/** A call of a batch request, with the error of parsing it if it is invalid */
+struct JSONBatchCall {
+    JSONRequest jreq;
+    Value error;
+};
 
-    return rpc_result;
+static void ExecBatchCall(const JSONBatchCall& call, CJsonWriter& writer) {
+    if (call.error.type() != null_type)
+        JSONRPCWriteReply(writer, Value::null, call.error, call.jreq.id);
+    else
+        ExecRequest(call.jreq, writer);
 }
 
-string JSONRPCExecBatch(const Array& vReq) {
-    Array ret;
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+/**
+ * A run of read-only calls of a batch executed in parallel. The worker of the batch runs them with
+ * the HTTP workers which take the task, each call is taken by exactly one of them and has its
+ * own reply buffer, the replies are written in order once all are done. The helpers finding
+ * no call left return at once, so the worker of the batch never depends on them.
+ */
+class CParallelCalls {
+public:
+    CParallelCalls(const vector<JSONBatchCall>& callsIn, size_t beginIn, size_t endIn)
+        : calls(callsIn), begin(beginIn), end(endIn), next(beginIn), replies(endIn - beginIn),
+          pending(endIn - beginIn) {}
+
+    void Run() {
+        size_t index;
+        while ((index = next++) < end) {
+            CJsonWriter writer;
+            ExecBatchCall(calls[index], writer);
+            replies[index - begin] = writer.GetString();
+
+            std::lock_guard<std::mutex> lock(cs);
+            if (--pending == 0)
+                cond.notify_all();
+        }
+    }
+
+    void WaitReplies(CJsonWriter& writer) {
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            cond.wait(lock, [this]() { return pending == 0; });
+        }
+        for (const auto& reply : replies)
+            writer.Raw(reply);
+    }
+
+private:
+    const vector<JSONBatchCall>& calls;
+    const size_t begin;
+    const size_t end;
+    std::atomic<size_t> next;
+    vector<string> replies;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    size_t pending;
+};
 
-    return write_string(Value(ret), false) + "\n";
+static bool IsParallelCall(const JSONBatchCall& call) {
+    return call.error.type() != null_type || tableRPC.IsReadOnly(call.jreq.strMethod);
 }
 
-json_spirit::Value CRPCTable::execute(const string& strMethod,
-                                      const json_spirit::Array& params) const {
+// the runs of read-only calls are executed in parallel, the other calls in order between them
+static void ExecBatchCalls(const vector<JSONBatchCall>& calls, CJsonWriter& writer) {
+    writer.BeginArray();
+    size_t index = 0;
+    while (index < calls.size()) {
+        size_t runEnd = index;
+        while (runEnd < calls.size() && IsParallelCall(calls[runEnd]))
+            ++runEnd;
+
+        size_t helperCount = std::min(runEnd - index, GetHTTPWorkerCount()) - 1;
+        if (runEnd - index < 2 || helperCount == 0) {
+            ExecBatchCall(calls[index], writer);
+            ++index;
+            continue;
+        }
+
+        // the calls outlive the batch in the helpers which are still queued
+        auto spCalls = std::make_shared<CParallelCalls>(calls, index, runEnd);
+        size_t enqueued = 0;
+        while (enqueued < helperCount && EnqueueHTTPTask([spCalls]() { spCalls->Run(); }))
+            ++enqueued;
+        LogPrint(BCLog::RPC, "ExecBatchCalls, run %u calls in parallel with %u helpers\n", runEnd - index, enqueued);
+
+        spCalls->Run();
+        spCalls->WaitReplies(writer);
+        index = runEnd;
+    }
+    writer.EndArray();
+}
+
+void JSONRPCExecBatch(const Array& vReq, CJsonWriter& writer) {
+    vector<JSONBatchCall> calls(vReq.size());
+    for (size_t index = 0; index < vReq.size(); index++) {
+        try {
+            calls[index].jreq.parse(vReq[index]);
+        } catch (Object& objError) {
+            calls[index].error = objError;
+        }
+    }
+    ExecBatchCalls(calls, writer);
+}
+
+// the calls of a batch request at the position of the reader
+static void ReadBatchCalls(CJsonReader& reader, vector<JSONBatchCall>& calls) {
+    reader.BeginArray();
+    while (reader.NextItem()) {
+        calls.emplace_back();
+        try {
+            calls.back().jreq.parse(reader);
+        } catch (Object& objError) {
+            calls.back().error = objError;
+        }
+    }
+}
+
+const CRPCCommand* CRPCTable::GetAllowedCommand(const string& strMethod) const {
     // Find method
     const CRPCCommand* pcmd = tableRPC[strMethod];
     if (!pcmd)
@@ -466,20 +684,35 @@ json_spirit::Value CRPCTable::execute(const string& strMethod,
         }
     }
 
+    return pcmd;
+}
+
+// call the actor with the locks of the command
+template <typename Actor>
+static void CallActor(const CRPCCommand* pcmd, Actor actor) {
+    if (pcmd->threadSafe)
+        actor();
+    else if (!pWalletMain) {
+        LOCK(cs_main);
+        actor();
+    } else {
+        // the wallet commands see the blocks connected before them
+        if (pcmd->reqWallet)
+            walletNotifier.SyncWithWallet();
+        LOCK2(cs_main, pWalletMain->cs_wallet);
+        actor();
+    }
+}
+
+json_spirit::Value CRPCTable::execute(const string& strMethod,
+                                      const json_spirit::Array& params) const {
+    const CRPCCommand* pcmd = GetAllowedCommand(strMethod);
+    CMetricTimer metricTimer(metricRPCRequest.Get(pcmd->name));
+
     try {
         // Execute
         Value result;
-        {
-            if (pcmd->threadSafe)
-                result = pcmd->actor(params, false);
-            else if (!pWalletMain) {
-                LOCK(cs_main);
-                result = pcmd->actor(params, false);
-            } else {
-                LOCK2(cs_main, pWalletMain->cs_wallet);
-                result = pcmd->actor(params, false);
-            }
-        }
+        CallActor(pcmd, [&]() { result = pcmd->actor(params, false); });
 
         return result;
     } catch (std::exception& e) {
@@ -487,6 +720,42 @@ json_spirit::Value CRPCTable::execute(const string& strMethod,
     }
 }
 
+void CRPCTable::execute(const string& strMethod, const json_spirit::Array& params,
+                        CJsonWriter& writer) const {
+    const CRPCCommand* pcmd = GetAllowedCommand(strMethod);
+    CMetricTimer metricTimer(metricRPCRequest.Get(pcmd->name));
+    auto it                 = mapStreamActors.find(strMethod);
+    auto itCached           = mapCachedActors.find(strMethod);
+
+    string cacheKey;
+    if (itCached != mapCachedActors.end() && rpcResultCache.IsEnabled()) {
+        cacheKey = CRPCResultCache::MakeKey(strMethod, params);
+        if (rpcResultCache.Get(cacheKey, writer))
+            return;
+    }
+
+    try {
+        // the result of the actor is written out of the locks
+        Value result;
+        CRPCCachedResult cachedResult;
+        bool streamed = false, cached = false;
+        CallActor(pcmd, [&]() {
+            cached = !cacheKey.empty() && itCached->second(params, cachedResult);
+            if (!cached)
+                streamed = it != mapStreamActors.end() && it->second(params, writer);
+            if (!cached && !streamed)
+                result = pcmd->actor(params, false);
+        });
+        if (cached) {
+            writer.Raw(cachedResult.writer.GetString());
+            rpcResultCache.Put(cacheKey, cachedResult);
+        } else if (!streamed)
+            writer.WriteValue(result);
+    } catch (std::exception& e) {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+}
+
 string HelpExampleCli(string methodname, string args) {
     return "> ./coind " + methodname + " " + args + "\n";
 }
@@ -500,15 +769,8 @@ string HelpExampleRpc(string methodname, string args) {
 
 const CRPCTable tableRPC;
 
-/** json rpc handler registered to http server */
-static bool JsonRPCHandler(HTTPRequest* req, const std::string&) {
-    // JSONRPC handles only POST or GET
-    auto reqMethod = req->GetRequestMethod();
-    if (reqMethod != HTTPRequest::POST && reqMethod != HTTPRequest::GET) {
-        req->WriteReply(HTTP_BAD_METHOD, "RPC server handles only POST or GET requests");
-        return false;
-    }
-    // Check authorization
+/** Check the basic auth of a request, reply 401 when it is missing or wrong */
+static bool CheckAuthorization(HTTPRequest* req) {
     std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
     if (!authHeader.first) {
         req->WriteHeader("WWW-Authenticate", WWW_AUTH_HEADER_DATA);
@@ -516,8 +778,6 @@ static bool JsonRPCHandler(HTTPRequest* req, const std::string&) {
         return false;
     }
 
-    JSONRequest jreq;
-
     if (!HTTPAuthorized(authHeader.second)) {
         LogPrint(BCLog::RPC, "RPCServer incorrect password attempt from %s\n",
                  req->GetPeer().ToString());
@@ -531,32 +791,92 @@ static bool JsonRPCHandler(HTTPRequest* req, const std::string&) {
         req->WriteReply(HTTP_UNAUTHORIZED);
         return false;
     }
+    return true;
+}
 
-    try {
-        // Parse request
-        json_spirit::Value valRequest;
+/** event stream handler registered to http server, the chain events pushed to the subscriber */
+static bool EventsHandler(HTTPRequest* req, const std::string& path) {
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "The event stream handles only GET requests");
+        return false;
+    }
+    if (!CheckAuthorization(req))
+        return false;
 
-        if (!read_string(req->ReadBody(), valRequest))
-            throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
+    return rpcEventPublisher.Subscribe(req, path);
+}
+
+/** metrics handler registered to http server, the registry in the text format of Prometheus */
+static bool MetricsHandler(HTTPRequest* req, const std::string&) {
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "The metrics handle only GET requests");
+        return false;
+    }
+    if (!CheckAuthorization(req))
+        return false;
 
-        string strReply;
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, GetMetricsRegistry().Render());
+    return true;
+}
 
-        // singleton request
-        if (valRequest.type() == obj_type) {
-            jreq.parse(valRequest);
-            Value result = tableRPC.execute(jreq.strMethod, jreq.params);
+/** json rpc handler registered to http server */
+static bool JsonRPCHandler(HTTPRequest* req, const std::string&) {
+    // JSONRPC handles only POST or GET
+    auto reqMethod = req->GetRequestMethod();
+    if (reqMethod != HTTPRequest::POST && reqMethod != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "RPC server handles only POST or GET requests");
+        return false;
+    }
+    if (!CheckAuthorization(req))
+        return false;
+
+    JSONRequest jreq;
 
-            // Send reply
-            strReply = JSONRPCReply(result, Value::null, jreq.id);
+    try {
+        // the reply is written into the buffer reused by the requests of this worker
+        CJsonWriter& writer = CJsonWriter::ThreadLocal();
+        writer.Clear();
+
+        // Parse request, only the envelopes are parsed into values besides the params
+        string body = req->ReadBody();
+        CJsonReader reader(body);
+        bool isBatch = false;
+        vector<JSONBatchCall> calls;
+        try {
+            char first = reader.PeekValue();
+            if (first == '{') {
+                jreq.parse(reader);
+            } else if (first == '[') {
+                isBatch = true;
+                ReadBatchCalls(reader, calls);
+            } else {
+                reader.SkipValue();
+                throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+            }
+        } catch (const CJsonReader::Error& e) {
+            LogPrint(BCLog::RPC, "JsonRPCHandler, parse the request failed: %s\n", e.what());
+            throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
+        }
+
+        // singleton request
+        if (!isBatch) {
+            writer.BeginObject();
+            writer.Key("result");
+            tableRPC.execute(jreq.strMethod, jreq.params, writer);
+            writer.Key("error");
+            writer.Null();
+            writer.Key("id");
+            writer.WriteValue(jreq.id);
+            writer.EndObject();
 
             // array of requests
-        } else if (valRequest.type() == array_type)
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
-            throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+        } else
+            ExecBatchCalls(calls, writer);
 
+        writer.EndLine();
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        req->WriteReply(HTTP_OK, writer.GetString());
     } catch (Object& objError) {
         ErrorReply(req, objError, jreq.id);
         return false;
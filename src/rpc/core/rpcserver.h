@@ -7,12 +7,14 @@
 #define _COINRPC_SERVER_H_
 
 #include "rpcprotocol.h"
+#include "rpccache.h"
 #include "commons/uint256.h"
 #include "rpc/rpcapi.h"
 
 #include <stdint.h>
 #include <list>
 #include <map>
+#include <set>
 #include <string>
 
 #include "commons/json/json_spirit_reader_template.h"
@@ -67,17 +69,50 @@ public:
     bool reqWallet;
 };
 
+/**
+ * Streaming variant of a command writing its result into the reply directly. It returns false
+ * without writing anything when it does not handle the params, e.g. for the help, and the result
+ * of the actor of the command is written instead.
+ */
+typedef bool (*rpcstreamfn_type)(const json_spirit::Array& params, CJsonWriter& writer);
+
+class CRPCStreamCommand {
+public:
+    string name;
+    rpcstreamfn_type actor;
+};
+
+/**
+ * Variant of a command writing its result for the RPC result cache, with the height of the block
+ * the result is read from. It returns false without writing anything when it does not handle the
+ * params, and the command is executed as if it was not cached.
+ */
+typedef bool (*rpccachefn_type)(const json_spirit::Array& params, CRPCCachedResult& result);
+
+class CRPCCachedCommand {
+public:
+    string name;
+    rpccachefn_type actor;
+};
+
 /**
  * Coin RPC command dispatcher.
  */
 class CRPCTable {
 private:
     map<string, const CRPCCommand*> mapCommands;
+    map<string, rpcstreamfn_type> mapStreamActors;
+    map<string, rpccachefn_type> mapCachedActors;
+    set<string> setReadOnlyCommands;
+
+    const CRPCCommand* GetAllowedCommand(const string& method) const;
 
 public:
     CRPCTable();
     const CRPCCommand* operator[](string name) const;
     string help(string name) const;
+    // whether the method has no side effects, see vRPCReadOnlyCommands
+    bool IsReadOnly(const string& method) const { return setReadOnlyCommands.count(method) > 0; }
 
     /**
      * Execute a method.
@@ -87,6 +122,13 @@ public:
      * @throws an exception (json_spirit::Value) when an error happens.
      */
     json_spirit::Value execute(const string& method, const json_spirit::Array& params) const;
+
+    /**
+     * Execute a method and write its result, with the streaming variant of the method if any.
+     * The results of the cached methods are written from rpcResultCache when they are cached.
+     * The result may be written partially when an exception is thrown.
+     */
+    void execute(const string& method, const json_spirit::Array& params, CJsonWriter& writer) const;
 };
 
 extern const CRPCTable tableRPC;
@@ -108,9 +150,9 @@ extern string HelpRequiringPassphrase();
 extern string HelpExampleCli(string methodname, string args);
 extern string HelpExampleRpc(string methodname, string args);
 
-json_spirit::Object JSONRPCExecOne(const json_spirit::Value& req);
+void JSONRPCExecOne(const json_spirit::Value& req, CJsonWriter& writer);
 
-std::string JSONRPCExecBatch(const json_spirit::Array& vReq);
+void JSONRPCExecBatch(const json_spirit::Array& vReq, CJsonWriter& writer);
 
 /** Opaque base class for timers returned by NewTimerFunc.
  * This provides no methods at the moment, but makes sure that delete
@@ -29,6 +29,8 @@ extern Value gettxdetail(const Array& params, bool fHelp);
 extern Value getclosedcdp(const Array& params, bool fHelp);
 extern Value sign(const Array& params, bool fHelp);
 extern Value getaccountinfo(const Array& params, bool fHelp);
+extern Value getaccountsinfo(const Array& params, bool fHelp);
+extern Value getaddresstxids(const Array& params, bool fHelp);
 extern Value disconnectblock(const Array& params, bool fHelp);
 extern Value reloadtxcache(const Array& params, bool fHelp);
 
@@ -74,6 +76,7 @@ extern Value getasset(const Array& params, bool fHelp);
 extern Value getassets(const Array& params, bool fHelp);
 
 extern Value getcdpcoinpairs(const Array& params, bool fHelp);
+extern Value getcdpstats(const Array& params, bool fHelp);
 
 /******************************* DEX *******************************************/
 extern Value submitdexbuylimitordertx(const Array& params, bool fHelp);
@@ -90,6 +93,11 @@ extern Value submitdexsettletx(const Array& params, bool fHelp);
 
 extern Value getdexorder(const Array& params, bool fHelp);
 extern Value getdexorders(const Array& params, bool fHelp);
+extern Value opendexorderscursor(const Array& params, bool fHelp);
+extern Value readdexorderscursor(const Array& params, bool fHelp);
+extern Value closedexorderscursor(const Array& params, bool fHelp);
+extern Value getdexorderbook(const Array& params, bool fHelp);
+extern Value getdexorderbookdepth(const Array& params, bool fHelp);
 extern Value getdexsysorders(const Array& params, bool fHelp);
 extern Value getdexoperator(const Array& params, bool fHelp);
 extern Value getdexoperatorbyowner(const Array& params, bool fHelp);
@@ -129,6 +137,7 @@ extern Value getchaininfo(const json_spirit::Array& params, bool fHelp);
 
 extern Value dumpprivkey(const json_spirit::Array& params, bool fHelp); // in rpcdump.cpp
 extern Value importprivkey(const json_spirit::Array& params, bool fHelp);
+extern Value rescanwallet(const json_spirit::Array& params, bool fHelp);
 extern Value dumpwallet(const json_spirit::Array& params, bool fHelp);
 extern Value importwallet(const json_spirit::Array& params, bool fHelp);
 extern Value dropminermainkeys(const json_spirit::Array& params, bool fHelp);
@@ -143,6 +152,7 @@ extern Value getminedblocks(const json_spirit::Array& params, bool fHelp);
 extern Value getminerbyblocktime(const json_spirit::Array& params, bool fHelp);
 
 extern Value getnewaddr(const json_spirit::Array& params, bool fHelp); // in rpcwallet.cpp
+extern Value getnewaddrs(const json_spirit::Array& params, bool fHelp);
 extern Value getaccount(const json_spirit::Array& params, bool fHelp);
 extern Value verifymessage(const json_spirit::Array& params, bool fHelp);
 extern Value getcoinunitinfo(const json_spirit::Array& params, bool fHelp);
@@ -155,6 +165,10 @@ extern Value walletpassphrasechange(const json_spirit::Array& params, bool fHelp
 extern Value walletlock(const json_spirit::Array& params, bool fHelp);
 extern Value encryptwallet(const json_spirit::Array& params, bool fHelp);
 extern Value getinfo(const json_spirit::Array& params, bool fHelp);
+extern Value getrpcinfo(const json_spirit::Array& params, bool fHelp);
+extern Value getlockstats(const json_spirit::Array& params, bool fHelp);
+extern Value setlockprofiling(const json_spirit::Array& params, bool fHelp);
+extern Value getmemoryinfo(const json_spirit::Array& params, bool fHelp);
 extern Value getwalletinfo(const json_spirit::Array& params, bool fHelp);
 extern Value getnetworkinfo(const json_spirit::Array& params, bool fHelp);
 
@@ -166,8 +180,11 @@ extern Value submitutxospendtx(const Array& params, bool fHelp) ;
 extern Value genmulsigtx(const json_spirit::Array& params, bool fHelp);
 
 extern Value submittxraw(const json_spirit::Array& params, bool fHelp);
+extern Value submittxrawbatch(const json_spirit::Array& params, bool fHelp);
+extern Value simulatetx(const json_spirit::Array& params, bool fHelp);
 
 extern Value signtxraw(const json_spirit::Array& params, bool fHelp);
+extern Value signtxrawbatch(const json_spirit::Array& params, bool fHelp);
 extern Value decodetxraw(const json_spirit::Array& params, bool fHelp);
 extern Value decodemulsigscript(const json_spirit::Array& params, bool fHelp);
 
@@ -175,6 +192,8 @@ extern Value getfcoingenesistxinfo(const json_spirit::Array& params, bool fHelp)
 extern Value getblockcount(const json_spirit::Array& params, bool fHelp);
 extern Value getdifficulty(const json_spirit::Array& params, bool fHelp);
 extern Value getrawmempool(const json_spirit::Array& params, bool fHelp);
+extern Value getmempooldiff(const json_spirit::Array& params, bool fHelp);
+extern Value estimatefee(const json_spirit::Array& params, bool fHelp);
 extern Value getblock(const json_spirit::Array& params, bool fHelp);
 extern Value verifychain(const json_spirit::Array& params, bool fHelp);
 extern Value getcontractregid(const json_spirit::Array& params, bool fHelp);
@@ -184,6 +203,10 @@ extern Value startcommontpstest(const json_spirit::Array& params, bool fHelp);
 extern Value startcontracttpstest(const json_spirit::Array& params, bool fHelp);
 extern Value getblockfailures(const json_spirit::Array& params, bool fHelp);
 extern Value getblockundo(const json_spirit::Array& params, bool fHelp);
+extern Value getblocktraces(const json_spirit::Array& params, bool fHelp);
+extern Value gettxlatency(const json_spirit::Array& params, bool fHelp);
+extern Value getblockfilter(const json_spirit::Array& params, bool fHelp);
+extern Value getmedianpricehistory(const json_spirit::Array& params, bool fHelp);
 
 extern Value submitpricefeedtx(const json_spirit::Array& params, bool fHelp);
 extern Value submitcoinstaketx(const json_spirit::Array& params, bool fHelp);
@@ -223,6 +246,7 @@ extern Value bintojsonwasm(const json_spirit::Array& params, bool fHelp);
 extern Value getcodewasm(const json_spirit::Array& params, bool fHelp);
 extern Value getabiwasm(const json_spirit::Array& params, bool fHelp);
 extern Value gettxtrace(const json_spirit::Array& params, bool fHelp);
+extern Value getwasmprofile(const json_spirit::Array& params, bool fHelp);
 extern Value abidefjsontobinwasm(const json_spirit::Array& params, bool fHelp);
 
 extern Value submitgovernerupdateproposal(const Array& params, bool fHelp) ;
@@ -236,5 +260,19 @@ extern Value getminminerfee(const Array& params, bool fHelp) ;
 
 // debug
 Value dumpdb(const Array& params, bool fHelp);
+Value dumpstate(const Array& params, bool fHelp);
+
+/***************************** Streaming ****************************************/
+
+extern bool streamgetblock(const json_spirit::Array& params, CJsonWriter& writer);
+extern bool streamgetrawmempool(const json_spirit::Array& params, CJsonWriter& writer);
+extern bool streamgetdexorders(const json_spirit::Array& params, CJsonWriter& writer);
+
+/***************************** Cached *******************************************/
+
+extern bool cachegetblock(const json_spirit::Array& params, CRPCCachedResult& result);
+extern bool cachegetblockundo(const json_spirit::Array& params, CRPCCachedResult& result);
+extern bool cachegettxdetail(const json_spirit::Array& params, CRPCCachedResult& result);
+extern bool cachegettxtrace(const json_spirit::Array& params, CRPCCachedResult& result);
 
 #endif /* RPC_API_H_ */
@@ -18,6 +18,10 @@ static const CRPCCommand vRPCCommands[] =
     /* Overall control/query calls */
     { "help",                           &help,                              true,      true,        false   },
     { "getinfo",                        &getinfo,                           true,      false,       false   }, /* uses wallet if enabled */
+    { "getrpcinfo",                     &getrpcinfo,                        true,      true,        false   },
+    { "getlockstats",                   &getlockstats,                      true,      true,        false   },
+    { "setlockprofiling",               &setlockprofiling,                  true,      true,        false   },
+    { "getmemoryinfo",                  &getmemoryinfo,                     true,      true,        false   },
     { "stop",                           &stop,                              true,      true,        false   },
     { "validateaddr",                   &validateaddr,                      true,      true,        false   },
     { "createmulsig",                   &createmulsig,                      true,      true ,       false   },
@@ -35,10 +39,16 @@ static const CRPCCommand vRPCCommands[] =
     /* Block chain and UTXO */
     { "getfcoingenesistxinfo",          &getfcoingenesistxinfo,             true,      true,        false   },
     { "getblockcount",                  &getblockcount,                     true,      true,        false   },
-    { "getblock",                       &getblock,                          true,      false,       false   },
+    { "getblock",                       &getblock,                          true,      true,        false   },
     { "getrawmempool",                  &getrawmempool,                     true,      false,       false   },
+    { "getmempooldiff",                 &getmempooldiff,                    true,      false,       false   },
+    { "estimatefee",                    &estimatefee,                       true,      true,        false   },
     { "verifychain",                    &verifychain,                       true,      false,       false   },
     { "getblockundo",                   &getblockundo,                      true,      false,       false   },
+    { "getblocktraces",                 &getblocktraces,                    true,      true,        false   },
+    { "gettxlatency",                   &gettxlatency,                      true,      true,        false   },
+    { "getblockfilter",                 &getblockfilter,                    true,      true,        false   },
+    { "getmedianpricehistory",          &getmedianpricehistory,             true,      true,        false   },
 
     { "gettotalcoins",                  &gettotalcoins,                     true,      false,       false   },
     { "invalidateblock",                &invalidateblock,                   true,      true,        false   },
@@ -52,14 +62,18 @@ static const CRPCCommand vRPCCommands[] =
     { "genmulsigtx",                    &genmulsigtx,                       true,      false,       false   },
     /* uses wallet if enabled */
     { "addmulsigaddr",                  &addmulsigaddr,                     false,     false,       true    },
-    { "getaccountinfo",                 &getaccountinfo,                    true,      false,       true    },
+    { "getaccountinfo",                 &getaccountinfo,                    true,      true,        true    },
+    { "getaccountsinfo",                &getaccountsinfo,                   true,      true,        false   },
+    { "getaddresstxids",                &getaddresstxids,                   true,      true,        false   },
     { "getnewaddr",                     &getnewaddr,                        false,     false,       true    },
+    { "getnewaddrs",                    &getnewaddrs,                       false,     true,        true    },
     { "gettxdetail",                    &gettxdetail,                       true,      false,       true    },
     { "getclosedcdp",                   &getclosedcdp,                      true,      false,       true    },
     { "getwalletinfo",                  &getwalletinfo,                     true,      false,       true    },
 
     { "dumpprivkey",                    &dumpprivkey,                       false,     false,       true    },
     { "importprivkey",                  &importprivkey,                     false,     false,       true    },
+    { "rescanwallet",                   &rescanwallet,                      false,     true,        true    },
     { "dropminermainkeys",                  &dropminermainkeys,                     false,     false,       true    },
     { "dropprivkey",                    &dropprivkey,                       false,     false,       true    },
     { "backupwallet",                   &backupwallet,                      false,     false,       true    },
@@ -76,13 +90,14 @@ static const CRPCCommand vRPCCommands[] =
     { "listcontracts",                  &listcontracts,                     true,      false,       true    },
     { "getcontractinfo",                &getcontractinfo,                   true,      false,       true    },
     { "listtxcache",                    &listtxcache,                       true,      false,       true    },
-    { "getcontractdata",                &getcontractdata,                   true,      false,       true    },
+    { "getcontractdata",                &getcontractdata,                   true,      true,        true    },
     { "signmessage",                    &signmessage,                       false,     false,       true    },
     { "verifymessage",                  &verifymessage,                     true,      false,       false   },
     { "getcoinunitinfo",                &getcoinunitinfo,                   true,      false,       false   },
     { "getcontractassets",              &getcontractassets,                 true,      false,       true    },
     { "listcontractassets",             &listcontractassets,                true,      false,       true    },
     { "signtxraw",                      &signtxraw,                         true,      false,       true    },
+    { "signtxrawbatch",                 &signtxrawbatch,                    true,      true,        true    },
     { "getcontractaccountinfo",         &getcontractaccountinfo,            true,      false,       true    },
     { "getsignature",                   &getsignature,                      true,      false,       true    },
     { "listdelegates",                  &listdelegates,                     true,      false,       true    },
@@ -90,6 +105,8 @@ static const CRPCCommand vRPCCommands[] =
     { "decodemulsigscript",             &decodemulsigscript,                true,       false,      false   },
     /* submit raw tx */
     { "submittxraw",                    &submittxraw,                       true,       false,      false   },
+    { "submittxrawbatch",               &submittxrawbatch,                  true,       true,       false   },
+    { "simulatetx",                     &simulatetx,                        true,       true,       false   },
     /* basic tx */
     { "submitsendtx",                   &submitsendtx,                      false,      false,      true    },
     { "submitcreateutxotx",             &submitcreateutxotx,                false,      false,      true    },
@@ -121,6 +138,7 @@ static const CRPCCommand vRPCCommands[] =
     { "getcdp",                         &getcdp,                            true,       false,      false   },
     { "getusercdp",                     &getusercdp,                        true,       false,      false   },
     { "getcdpcoinpairs",                &getcdpcoinpairs,                   true,       false,      false   },
+    { "getcdpstats",                    &getcdpstats,                       true,       false,      false   },
 
     { "getsysparam",                    &getsysparam,                       true,       false,      false   },
     { "getcdpparam",                    &getcdpparam,                       true,       false,      false   },
@@ -136,9 +154,14 @@ static const CRPCCommand vRPCCommands[] =
     { "submitdexcancelordertx",         &submitdexcancelordertx,            false,      false,      false   },
     { "submitdexoperatorregtx",         &submitdexoperatorregtx,            false,      false,      false   },
     { "submitdexoperatorupdatetx",      &submitdexoperatorupdatetx,         false,      false,      false   },
-    { "getdexorder",                    &getdexorder,                       true,       false,      false   },
+    { "getdexorder",                    &getdexorder,                       true,       true,       false   },
     { "getdexsysorders",                &getdexsysorders,                   true,       false,      false   },
     { "getdexorders",                   &getdexorders,                      true,       false,      false   },
+    { "opendexorderscursor",            &opendexorderscursor,               true,       false,      false   },
+    { "readdexorderscursor",            &readdexorderscursor,               true,       true,       false   },
+    { "closedexorderscursor",           &closedexorderscursor,              true,       true,       false   },
+    { "getdexorderbook",                &getdexorderbook,                   true,       false,      false   },
+    { "getdexorderbookdepth",           &getdexorderbookdepth,              true,       false,      false   },
     { "getdexoperator",                 &getdexoperator,                    true,       false,      false   },
     { "getdexoperatorbyowner",          &getdexoperatorbyowner,             true,       false,      false   },
     { "getdexorderfee",                 &getdexorderfee,                    true,       false,      false   },
@@ -156,6 +179,7 @@ static const CRPCCommand vRPCCommands[] =
     { "getcodewasm",                    &getcodewasm,                       true,       false,      true    },
     { "getabiwasm",                     &getabiwasm,                        true,       false,      true    },
     { "gettxtrace",                     &gettxtrace,                        true,       false,      true    },
+    { "getwasmprofile",                 &getwasmprofile,                    true,       false,      true    },
     { "abidefjsontobinwasm",            &abidefjsontobinwasm,               true,       false,      true    },
     /* for test code */
     { "disconnectblock",                &disconnectblock,                   true,       false,      true    },
@@ -171,6 +195,50 @@ static const CRPCCommand vRPCCommands[] =
 
     /* debug */
     { "dumpdb",                         &dumpdb,                            true,       true,       true    },
+    { "dumpstate",                      &dumpstate,                         true,       true,       false   },
+};
+
+// the commands with a streaming variant writing large results into the reply directly
+static const CRPCStreamCommand vRPCStreamCommands[] =
+{ //  name                              actor (function)
+  //  --------------------------------  -----------------------
+    { "getblock",                       &streamgetblock                     },
+    { "getrawmempool",                  &streamgetrawmempool                },
+    { "getdexorders",                   &streamgetdexorders                 },
+};
+
+/**
+ * The queries of immutable data served from rpcResultCache once their block is finalized. getcodewasm
+ * is not one of them, the code of a contract can be replaced by setcode.
+ */
+static const CRPCCachedCommand vRPCCachedCommands[] =
+{ //  name                              actor (function)
+  //  --------------------------------  -----------------------
+    { "getblock",                       &cachegetblock                      },
+    { "getblockundo",                   &cachegetblockundo                  },
+    { "gettxdetail",                    &cachegettxdetail                   },
+    { "gettxtrace",                     &cachegettxtrace                    },
+};
+
+/**
+ * The queries without side effects, the runs of them in a batch request are executed in parallel.
+ * The ones running under cs_main still serialize on it.
+ */
+static const char* const vRPCReadOnlyCommands[] =
+{
+    "validateaddr",         "verifymessage",        "decodetxraw",          "gethash",
+    "getblockcount",        "getblock",             "getrawmempool",        "getblockundo",
+    "estimatefee",          "getscoininfo",         "getmempooldiff",
+    "getaccountinfo",       "getaccountsinfo",      "gettxdetail",          "getcoinunitinfo",
+    "getcontractinfo",      "getcontractdata",      "getcontractaccountinfo",
+    "getcdp",               "getusercdp",           "getcdpstats",          "getcdpcoinpairs",
+    "getsysparam",          "getcdpparam",          "getproposal",          "getminminerfee",
+    "getdexorder",          "getdexsysorders",      "getdexorders",         "getdexorderbook",
+    "getdexorderbookdepth", "getdexoperator",       "getdexoperatorbyowner","getdexorderfee",
+    "getasset",             "getassets",            "getaddresstxids",      "getblocktraces",
+    "gettablewasm",         "getcodewasm",          "getabiwasm",           "gettxtrace",
+    "jsontobinwasm",        "bintojsonwasm",        "abidefjsontobinwasm",  "getblockfilter",
+    "getmedianpricehistory","gettxlatency",
 };
 
 #endif //RPC_APICONF_H_
\ No newline at end of file
@@ -7,12 +7,16 @@
 #include <stdint.h>
 #include <boost/assign/list_of.hpp>
 
+#include "chain/blockfilter.h"
+#include "chain/blocktrace.h"
+#include "chain/txlatency.h"
 #include "commons/messagequeue.h"
 #include "commons/uint256.h"
 #include "config/configuration.h"
 #include "init.h"
 #include "commons/json/json_spirit_value.h"
 #include "main.h"
+#include "rpc/core/rpccommons.h"
 #include "rpc/core/rpcserver.h"
 #include "sync.h"
 #include "tx/merkletx.h"
@@ -20,53 +24,58 @@
 #include "tx/coinrewardtx.h"
 #include "wallet/wallet.h"
 #include "persistence/blockundo.h"
+#include "persistence/statesnapshot.h"
 
 using namespace json_spirit;
 using namespace std;
 
 class CBaseCoinTransferTx;
 
-Object BlockToJSON(const CBlock& block, const CBlockIndex* pBlockIndex) {
-    Object result;
-    result.push_back(Pair("block_hash",     block.GetHash().GetHex()));
-    result.push_back(Pair("block_miner",    block.vptx[0]->txUid.ToString()));
-
-    CMerkleTx txGen(block.vptx[0]);
-    txGen.SetMerkleBranch(&block);
-    result.push_back(Pair("confirmations",  (int32_t)txGen.GetDepthInMainChain()));
-    result.push_back(Pair("size",           (int32_t)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
-    result.push_back(Pair("height",         (int32_t)block.GetHeight()));
-    result.push_back(Pair("version",        block.GetVersion()));
-    result.push_back(Pair("merkle_root",    block.GetMerkleRootHash().GetHex()));
-    result.push_back(Pair("tx_count",       (int32_t)block.vptx.size()));
-    Array txs;
+// the confirmations and the next block hash are resolved under cs_main by the caller
+// pConfirmationsPos receives the position of the confirmations number for the result cache
+static void WriteBlockJSON(CJsonWriter &writer, const CBlock& block, int32_t confirmations,
+                           const uint256 &nextBlockHash, size_t *pConfirmationsPos = nullptr) {
+    writer.BeginObject();
+    writer.Field("block_hash",      block.GetHash().GetHex());
+    writer.Field("block_miner",     block.vptx[0]->txUid.ToString());
+    writer.Key("confirmations");
+    if (pConfirmationsPos)
+        *pConfirmationsPos = writer.GetSize();
+    writer.Int(confirmations);
+    writer.Field("size",            (int32_t)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    writer.Field("height",          (int32_t)block.GetHeight());
+    writer.Field("version",         (int32_t)block.GetVersion());
+    writer.Field("merkle_root",     block.GetMerkleRootHash().GetHex());
+    writer.Field("tx_count",        (int32_t)block.vptx.size());
+    writer.Key("tx");
+    writer.BeginArray();
     for (const auto& ptx : block.vptx)
-        txs.push_back(ptx->GetHash().GetHex());
-    result.push_back(Pair("tx",             txs));
-    result.push_back(Pair("time",           block.GetBlockTime()));
-    result.push_back(Pair("nonce",          (uint64_t)block.GetNonce()));
-
-    if (pBlockIndex->pprev)
-        result.push_back(Pair("previous_block_hash", pBlockIndex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex* pNext = chainActive.Next(pBlockIndex);
-    if (pNext)
-        result.push_back(Pair("next_block_hash", pNext->GetBlockHash().GetHex()));
-
-    Array prices;
+        writer.String(ptx->GetHash().GetHex());
+    writer.EndArray();
+    writer.Field("time",            (int64_t)block.GetBlockTime());
+    writer.Field("nonce",           (uint64_t)block.GetNonce());
+
+    if (!block.GetPrevBlockHash().IsNull())
+        writer.Field("previous_block_hash", block.GetPrevBlockHash().GetHex());
+    if (!nextBlockHash.IsNull())
+        writer.Field("next_block_hash", nextBlockHash.GetHex());
+
+    writer.Key("median_price");
+    writer.BeginArray();
     for (auto &item : block.GetBlockMedianPrice()) {
         if (item.second == 0) {
             continue;
         }
 
-        Object price;
-        price.push_back(Pair("coin_symbol",   item.first.first));
-        price.push_back(Pair("price_symbol",  item.first.second));
-        price.push_back(Pair("price",         (double) item.second / PRICE_BOOST));
-        prices.push_back(price);
+        writer.BeginObject();
+        writer.Field("coin_symbol",   item.first.first);
+        writer.Field("price_symbol",  item.first.second);
+        writer.Field("price",         (double) item.second / PRICE_BOOST);
+        writer.EndObject();
     }
-    result.push_back(Pair("median_price", prices));
+    writer.EndArray();
 
-    return result;
+    writer.EndObject();
 }
 
 Value getblockcount(const Array& params, bool fHelp) {
@@ -79,6 +88,7 @@ Value getblockcount(const Array& params, bool fHelp) {
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + "\nAs json rpc\n" + HelpExampleRpc("getblockcount", ""));
 
+    std::shared_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
     return chainActive.Height();
 }
 
@@ -108,6 +118,36 @@ Value getfcoingenesistxinfo(const Array& params, bool fHelp) {
     return output;
 }
 
+static void WriteMempoolJSON(CJsonWriter& writer, bool fVerbose) {
+    if (fVerbose) {
+        LOCK(mempool.cs);
+        writer.BeginObject();
+        for (const auto& entry : mempool.memPoolTxs) {
+            const uint256& hash      = entry.first;
+            const CTxMemPoolEntry& e = entry.second;
+            writer.Key(hash.ToString());
+            writer.BeginObject();
+            writer.Field("size",        (int32_t)e.GetTxSize());
+            writer.Field("fees_type",   std::get<0>(e.GetFees()));
+            writer.Field("fees",        (double)std::get<1>(e.GetFees()) / (double)COIN);
+            writer.Field("time",        e.GetTime());
+            writer.Field("height",      (int32_t)e.GetHeight());
+            writer.Field("priority",    e.GetPriority());
+            writer.EndObject();
+        }
+        writer.EndObject();
+    } else {
+        vector<uint256> txids;
+        mempool.QueryHash(txids);
+
+        writer.BeginArray();
+        for (const auto& hash : txids) {
+            writer.String(hash.ToString());
+        }
+        writer.EndArray();
+    }
+}
+
 Value getrawmempool(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -136,38 +176,168 @@ Value getrawmempool(const Array& params, bool fHelp)
             "\nExamples\n" +
             HelpExampleCli("getrawmempool", "true") + "\nAs json rpc\n" + HelpExampleRpc("getrawmempool", "true"));
 
-    bool fVerbose = false;
-    if (params.size() > 0)
-        fVerbose = params[0].get_bool();
+    bool fVerbose = params.size() > 0 ? params[0].get_bool() : false;
 
-    if (fVerbose) {
-        LOCK(mempool.cs);
-        Object obj;
-        for (const auto& entry : mempool.memPoolTxs) {
-            const uint256& hash      = entry.first;
-            const CTxMemPoolEntry& e = entry.second;
-            Object info;
-            info.push_back(Pair("size",         (int)e.GetTxSize()));
-            info.push_back(Pair("fees_type",    std::get<0>(e.GetFees())));
-            info.push_back(Pair("fees",         ValueFromAmount(std::get<1>(e.GetFees()))));
-            info.push_back(Pair("time",         e.GetTime()));
-            info.push_back(Pair("height",       (int)e.GetHeight()));
-            info.push_back(Pair("priority",     e.GetPriority()));
-
-            obj.push_back(Pair(hash.ToString(), info));
-        }
+    CJsonWriter writer;
+    WriteMempoolJSON(writer, fVerbose);
+    return JSON::FromWriter(writer);
+}
+
+Value getmempooldiff(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getmempooldiff since_sequence\n"
+            "\nReturns the transaction ids added to and removed from the memory pool since a change of it, for the\n"
+            "clients following the pool without listing all of it each time.\n"
+            "\nArguments:\n"
+            "1. since_sequence    (numeric, required) the sequence returned by the previous call, 0 for the first\n"
+            "\nResult: (when the changes since since_sequence are known)\n"
+            "{\n"
+            "  \"sequence\" : n,     (numeric) the sequence of the last change, since_sequence of the next call\n"
+            "  \"added\" : [...],    (array of string) the txids entered since since_sequence and still in the pool\n"
+            "  \"removed\" : [...]   (array of string) the txids in the pool at since_sequence and left since\n"
+            "}\n"
+            "\nResult: (when they are not, the latest " + std::to_string(MEMPOOL_CHANGE_LOG_SIZE) +
+            " changes are kept)\n"
+            "{\n"
+            "  \"sequence\" : n,     (numeric) the sequence of the last change\n"
+            "  \"full\" : true,\n"
+            "  \"txids\" : [...]     (array of string) all the txids in the pool\n"
+            "}\n"
+            "\nExamples\n" +
+            HelpExampleCli("getmempooldiff", "1024") + "\nAs json rpc\n" + HelpExampleRpc("getmempooldiff", "1024"));
+
+    int64_t sinceSequence = params[0].get_int64();
+    if (sinceSequence < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "since_sequence must not be negative");
+
+    vector<uint256> added, removed;
+    uint64_t currSequence = 0;
+    Object obj;
+    if (mempool.GetChangesSince(sinceSequence, added, removed, currSequence)) {
+        Array addedArray, removedArray;
+        for (const auto& txid : added)
+            addedArray.push_back(txid.ToString());
+        for (const auto& txid : removed)
+            removedArray.push_back(txid.ToString());
+        obj.push_back(Pair("sequence", currSequence));
+        obj.push_back(Pair("added",    addedArray));
+        obj.push_back(Pair("removed",  removedArray));
         return obj;
-    } else {
-        vector<uint256> txids;
-        mempool.QueryHash(txids);
+    }
+    if ((uint64_t)sinceSequence > currSequence)
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           strprintf("since_sequence is beyond the last change %llu", currSequence));
+
+    vector<uint256> txids;
+    mempool.QueryHash(txids, currSequence);
+    Array txidArray;
+    for (const auto& txid : txids)
+        txidArray.push_back(txid.ToString());
+    obj.push_back(Pair("sequence", currSequence));
+    obj.push_back(Pair("full",     true));
+    obj.push_back(Pair("txids",    txidArray));
+    return obj;
+}
 
-        Array arr;
-        for (const auto& hash : txids) {
-            arr.push_back(hash.ToString());
+bool streamgetrawmempool(const Array& params, CJsonWriter& writer) {
+    if (params.size() > 1)
+        return false;
+
+    bool fVerbose = params.size() > 0 ? params[0].get_bool() : false;
+    WriteMempoolJSON(writer, fVerbose);
+    return true;
+}
+
+Value estimatefee(const Array& params, bool fHelp) {
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "estimatefee target_blocks (\"fee_symbol\")\n"
+            "\nEstimates the fee per kb a tx pays to be packed within target_blocks, from the delays of the txs\n"
+            "packed by the recent blocks and of the txs waiting in the memory pool.\n"
+            "\nArguments:\n"
+            "1.\"target_blocks\"  (numeric, required) the most blocks the tx may wait, 1 to " +
+            std::to_string(MAX_FEE_ESTIMATE_TARGET) + "\n"
+            "2.\"fee_symbol\"     (string, optional) the fee symbol, " + GetFeeSymbolSetStr() + ", default is WICC\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"fee_symbol\" : \"symbol\", (string) the fee symbol\n"
+            "  \"target_blocks\" : n,       (numeric) the target blocks\n"
+            "  \"fee_per_kb\" : n,          (numeric) the fee per kb in sawi, excluding the fuel, -1 if not\n"
+            "                               enough txs were seen\n"
+            "}\n"
+            "\nExamples\n" +
+            HelpExampleCli("estimatefee", "6 WUSD") + "\nAs json rpc\n" + HelpExampleRpc("estimatefee", "6, \"WUSD\""));
+
+    int32_t targetBlocks = params[0].get_int();
+    if (targetBlocks < 1 || targetBlocks > (int32_t)MAX_FEE_ESTIMATE_TARGET)
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           strprintf("target_blocks must be in range [1, %u]", MAX_FEE_ESTIMATE_TARGET));
+
+    TokenSymbol feeSymbol = params.size() > 1 ? params[1].get_str() : SYMB::WICC;
+    if (!kFeeSymbolSet.count(feeSymbol))
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           strprintf("fee_symbol must be one of %s", GetFeeSymbolSetStr()));
+
+    double feePerKb = mempool.EstimateFee(targetBlocks, feeSymbol);
+
+    Object obj;
+    obj.push_back(Pair("fee_symbol", feeSymbol));
+    obj.push_back(Pair("target_blocks", targetBlocks));
+    obj.push_back(Pair("fee_per_kb", feePerKb < 0 ? -1 : (int64_t)ceil(feePerKb)));
+    return obj;
+}
+
+// the block of the hash or height param, only its index is looked up under cs_chainIndex, its txs are decoded
+// by the verbose readers only
+static void ReadBlockParam(const Value& hashOrHeight, CBlockView& blockView, int32_t& confirmations,
+                           uint256& nextBlockHash) {
+    uint256 hash;
+    CDiskBlockPos blockPos;
+    confirmations = -1;
+    nextBlockHash.SetNull();
+    {
+        std::shared_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
+        if (int_type == hashOrHeight.type()) {
+            int height = hashOrHeight.get_int();
+            if (height < 0 || height > chainActive.Height())
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range.");
+
+            hash = chainActive[height]->GetBlockHash();
+        } else {
+            hash = uint256S(hashOrHeight.get_str());
         }
 
-        return arr;
+        auto it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+        CBlockIndex* pBlockIndex = it->second;
+        blockPos                 = pBlockIndex->GetBlockPos();
+        if (chainActive.Contains(pBlockIndex))
+            confirmations = chainActive.Height() - pBlockIndex->height + 1;
+        CBlockIndex* pNext = chainActive.Next(pBlockIndex);
+        if (pNext)
+            nextBlockHash = pNext->GetBlockHash();
     }
+
+    if (blockPos.IsNull() && fPruneMode)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+
+    if (!ReadBlockViewFromDisk(blockPos, blockView) || blockView.GetHeader().GetHash() != hash) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    }
+}
+
+static void DecodeBlock(CBlockView& blockView, CBlock& block) {
+    if (!blockView.GetBlock(block))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't decode block from disk");
+}
+
+// the bytes on disk are the serialized block of the network
+static string BlockToHex(const CBlockView& blockView) {
+    const CDataStream& rawData = blockView.GetRawData();
+    return HexStr(rawData.begin(), rawData.end());
 }
 
 Value getblock(const Array& params, bool fHelp) {
@@ -209,40 +379,64 @@ Value getblock(const Array& params, bool fHelp) {
 
     // RPCTypeCheck(params, boost::assign::list_of(str_type)(bool_type)); disable this to allow either string or int argument
 
-    std::string strHash;
-    if (int_type == params[0].type()) {
-        int height = params[0].get_int();
-        if (height < 0 || height > chainActive.Height())
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range.");
+    bool fVerbose = params.size() > 1 ? params[1].get_bool() : true;
+    int32_t confirmations;
+    uint256 nextBlockHash;
+    CBlockView blockView;
+    ReadBlockParam(params[0], blockView, confirmations, nextBlockHash);
 
-        CBlockIndex* pBlockIndex = chainActive[height];
-        strHash                  = pBlockIndex->GetBlockHash().GetHex();
-    } else {
-        strHash = params[0].get_str();
-    }
-    uint256 hash(uint256S(strHash));
+    if (!fVerbose)
+        return BlockToHex(blockView);
 
-    bool fVerbose = true;
-    if (params.size() > 1)
-        fVerbose = params[1].get_bool();
+    CBlock block;
+    DecodeBlock(blockView, block);
+    CJsonWriter writer;
+    WriteBlockJSON(writer, block, confirmations, nextBlockHash);
+    return JSON::FromWriter(writer);
+}
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+bool streamgetblock(const Array& params, CJsonWriter& writer) {
+    if (params.size() < 1 || params.size() > 2)
+        return false;
 
-    CBlock block;
-    CBlockIndex* pBlockIndex = mapBlockIndex[hash];
-    if (!ReadBlockFromDisk(pBlockIndex, block)) {
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
-    }
+    bool fVerbose = params.size() > 1 ? params[1].get_bool() : true;
+    int32_t confirmations;
+    uint256 nextBlockHash;
+    CBlockView blockView;
+    ReadBlockParam(params[0], blockView, confirmations, nextBlockHash);
 
     if (!fVerbose) {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        writer.String(BlockToHex(blockView));
+    } else {
+        CBlock block;
+        DecodeBlock(blockView, block);
+        WriteBlockJSON(writer, block, confirmations, nextBlockHash);
     }
+    return true;
+}
+
+bool cachegetblock(const Array& params, CRPCCachedResult& result) {
+    if (params.size() < 1 || params.size() > 2)
+        return false;
+
+    bool fVerbose = params.size() > 1 ? params[1].get_bool() : true;
+    int32_t confirmations;
+    uint256 nextBlockHash;
+    CBlockView blockView;
+    ReadBlockParam(params[0], blockView, confirmations, nextBlockHash);
 
-    return BlockToJSON(block, pBlockIndex);
+    // the next block hash is finalized as well when the block is below the finalized one
+    result.height = confirmations < 0 ? -1 : (int32_t)blockView.GetHeader().GetHeight();
+    if (!fVerbose) {
+        result.writer.String(BlockToHex(blockView));
+    } else {
+        CBlock block;
+        DecodeBlock(blockView, block);
+        size_t confirmationsPos;
+        WriteBlockJSON(result.writer, block, confirmations, nextBlockHash, &confirmationsPos);
+        result.SetConfirmations(confirmationsPos, 1);
+    }
+    return true;
 }
 
 Value verifychain(const Array& params, bool fHelp) {
@@ -714,35 +908,18 @@ Value getblockfailures(const Array& params, bool fHelp) {
 }
 
 
-Value getblockundo(const Array& params, bool fHelp) {
-    if (fHelp || params.size() < 1 || params.size() > 2) {
-        throw runtime_error(
-            "getblockundo \"hash or height\"\n"
-            "\nIf verbose is false, returns a string that is serialized, hex-encoded data for block 'hash'.\n"
-            "If verbose is true, returns an Object with information about block <hash>.\n"
-            "\nArguments:\n"
-            "1.\"hash or height\"   (string or numeric, required) string for the block hash, or numeric for the block "
-                                                                  "height\n"
-
-            "\nResult: block undo object\n"
-            "\nExamples:\n" +
-            HelpExampleCli("getblockundo", "\"d640d051704155b1fd3ec8d0331497448c259b0ab0499e109da7ae2bc7423bc2\"") +
-            "\nAs json rpc\n" +
-            HelpExampleRpc("getblockundo", "\"d640d051704155b1fd3ec8d0331497448c259b0ab0499e109da7ae2bc7423bc2\""));
-    }
-
-    // RPCTypeCheck(params, boost::assign::list_of(str_type)(bool_type)); disable this to allow either string or int argument
-
+// the undo data of the block, blockHeight is its height if it is on the active chain, -1 otherwise
+static Object GetBlockUndoJSON(const Value& hashOrHeight, int32_t& blockHeight) {
     std::string strHash;
-    if (int_type == params[0].type()) {
-        int height = params[0].get_int();
+    if (int_type == hashOrHeight.type()) {
+        int height = hashOrHeight.get_int();
         if (height < 0 || height > chainActive.Height())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range.");
 
         CBlockIndex* pBlockIndex = chainActive[height];
         strHash                  = pBlockIndex->GetBlockHash().GetHex();
     } else {
-        strHash = params[0].get_str();
+        strHash = hashOrHeight.get_str();
     }
     uint256 hash(uint256S(strHash));
 
@@ -751,6 +928,7 @@ Value getblockundo(const Array& params, bool fHelp) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
     CBlockIndex* pBlockIndex = mapIt->second;
+    blockHeight              = chainActive.Contains(pBlockIndex) ? pBlockIndex->height : -1;
 
     CBlockUndo blockUndo;
     CDiskBlockPos pos = pBlockIndex->GetUndoPos();
@@ -768,16 +946,16 @@ Value getblockundo(const Array& params, bool fHelp) {
     obj.push_back(Pair("count", (int64_t)blockUndo.vtxundo.size()));
     Array txArray;
     for (size_t i = 0; i < blockUndo.vtxundo.size(); i++) {
-        CTxUndo txUndo = blockUndo.vtxundo[i];
+        const CTxUndo &txUndo = blockUndo.vtxundo[i];
         Object txObj;
         txObj.push_back(Pair("index", (int64_t)i));
         txObj.push_back(Pair("tx_hash",  txUndo.txid.ToString()));
         Array categoryArray;
-        for (auto opLogPair : txUndo.dbOpLogMap.GetMap()) {
+        for (const auto &opLogPair : txUndo.dbOpLogMap.GetMap()) {
             const CDbOpLogs &opLogs = opLogPair.second;
             Object categoryObj;
-            auto prefixType = dbk::ParseKeyPrefixType(opLogPair.first);
-            categoryObj.push_back(Pair("db_prefix", opLogPair.first));
+            auto prefixType = opLogPair.first;
+            categoryObj.push_back(Pair("db_prefix", dbk::GetKeyPrefix(prefixType)));
             categoryObj.push_back(Pair("db_prefix_memo", dbk::GetKeyPrefixMemo(prefixType)));
             categoryObj.push_back(Pair("log_count", (int64_t)opLogs.size()));
             Array dbLogArray;
@@ -796,4 +974,348 @@ Value getblockundo(const Array& params, bool fHelp) {
     obj.push_back(Pair("tx_undos", txArray));
 
     return obj;
-}
\ No newline at end of file
+}
+
+Value getblockundo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() < 1 || params.size() > 2) {
+        throw runtime_error(
+            "getblockundo \"hash or height\"\n"
+            "\nIf verbose is false, returns a string that is serialized, hex-encoded data for block 'hash'.\n"
+            "If verbose is true, returns an Object with information about block <hash>.\n"
+            "\nArguments:\n"
+            "1.\"hash or height\"   (string or numeric, required) string for the block hash, or numeric for the block "
+                                                                  "height\n"
+
+            "\nResult: block undo object\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getblockundo", "\"d640d051704155b1fd3ec8d0331497448c259b0ab0499e109da7ae2bc7423bc2\"") +
+            "\nAs json rpc\n" +
+            HelpExampleRpc("getblockundo", "\"d640d051704155b1fd3ec8d0331497448c259b0ab0499e109da7ae2bc7423bc2\""));
+    }
+
+    int32_t blockHeight;
+    return GetBlockUndoJSON(params[0], blockHeight);
+}
+
+bool cachegetblockundo(const Array& params, CRPCCachedResult& result) {
+    if (params.size() < 1 || params.size() > 2)
+        return false;
+
+    result.WriteObject(GetBlockUndoJSON(params[0], result.height), 0);
+    return true;
+}
+
+Value getblockfilter(const Array& params, bool fHelp) {
+    if (fHelp || params.size() < 1 || params.size() > 2) {
+        throw runtime_error(
+            "getblockfilter \"hash or height\" [\"addr\",...]\n"
+            "\nGet the compact filter of the ids involved in the txs of a block, requires -blockfilterindex\n"
+            "\nArguments:\n"
+            "1.\"hash or height\"   (string or numeric, required) string for the block hash, or numeric for the block "
+                                                                  "height\n"
+            "2.\"addrs\"            (array, optional) the addresses or regids to test against the filter\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"block_hash\": \"xxx\",    (string) the block hash\n"
+            "  \"elements\": n,          (numeric) the number of the keyids and regids in the filter\n"
+            "  \"filter\": \"xxx\",        (string) the hex of the encoded filter, as in the cfilter message\n"
+            "  \"header\": \"xxx\",        (string) the filter header, chained to the one of the previous block\n"
+            "  \"match\": true|false     (boolean, optional) whether any of the addrs may be involved in the block\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getblockfilter", "100 '[\"WT52jPi8DhHUC85MPYK8y8Ajs8J7CshgaB\"]'") +
+            "\nAs json rpc\n" +
+            HelpExampleRpc("getblockfilter", "100, [\"WT52jPi8DhHUC85MPYK8y8Ajs8J7CshgaB\"]"));
+    }
+
+    if (!SysCfg().IsBlockFilterIndex())
+        throw JSONRPCError(RPC_MISC_ERROR, "The block filter index is disabled, restart with -blockfilterindex -reindex");
+
+    LOCK(cs_main);
+    uint256 hash;
+    if (int_type == params[0].type()) {
+        int32_t height = params[0].get_int();
+        if (height < 0 || height > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range.");
+        hash = chainActive[height]->GetBlockHash();
+    } else {
+        hash = uint256S(params[0].get_str());
+    }
+
+    CBlockFilter filter;
+    if (!pCdMan->pBlockCache->GetBlockFilter(hash, filter))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block filter not found");
+
+    Object obj;
+    obj.push_back(Pair("block_hash",    filter.GetBlockHash().GetHex()));
+    obj.push_back(Pair("elements",      (int64_t)filter.GetElementCount()));
+    obj.push_back(Pair("filter",        HexStr(filter.GetEncoded())));
+    obj.push_back(Pair("header",        filter.GetHeader().GetHex()));
+
+    if (params.size() > 1) {
+        vector<BlockFilterElement> elements;
+        for (const auto &addr : params[1].get_array()) {
+            auto pUserId = CUserID::ParseUserId(addr.get_str(), *pCdMan->pAccountCache);
+            CKeyID keyId;
+            if (pUserId && pUserId->is<CRegID>())
+                elements.push_back(CBlockFilter::GetElement(pUserId->get<CRegID>().GetRegIdRaw()));
+            else if (pUserId && pCdMan->pAccountCache->GetKeyId(*pUserId, keyId))
+                elements.push_back(CBlockFilter::GetElement(keyId));
+            else
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Invalid address %s", addr.get_str()));
+        }
+        obj.push_back(Pair("match",     filter.MatchAny(elements)));
+    }
+    return obj;
+}
+
+Value getmedianpricehistory(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 2) {
+        throw runtime_error(
+            "getmedianpricehistory begin_height end_height\n"
+            "\nGet the median prices of the blocks in a range of heights, requires -medianpriceindex\n"
+            "\nArguments:\n"
+            "1.\"begin_height\"   (numeric, required) the height of the first block\n"
+            "2.\"end_height\"     (numeric, required) the height of the last block, at most " +
+            std::to_string(MAX_MEDIAN_PRICE_HISTORY_COUNT) + " heights after begin_height\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"history\": [                 (array) the blocks with median prices, in the order of the heights\n"
+            "    {\n"
+            "      \"height\": n,             (numeric) the height of the block\n"
+            "      \"median_prices\": [       (array) the median prices of the block\n"
+            "        {\n"
+            "          \"coin_symbol\": \"xxx\",   (string) the base symbol\n"
+            "          \"price_symbol\": \"xxx\",  (string) the quote symbol\n"
+            "          \"price\": n              (numeric) the price, boosted by 10^8\n"
+            "        }, ...\n"
+            "      ]\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getmedianpricehistory", "1000 2000") +
+            "\nAs json rpc\n" +
+            HelpExampleRpc("getmedianpricehistory", "1000, 2000"));
+    }
+
+    if (!SysCfg().IsMedianPriceIndex())
+        throw JSONRPCError(RPC_MISC_ERROR, "The median price index is disabled, restart with -medianpriceindex -reindex");
+
+    RPCTypeCheck(params, boost::assign::list_of(int_type)(int_type));
+    int32_t beginHeight = params[0].get_int();
+    int32_t endHeight   = params[1].get_int();
+    if (beginHeight < 0 || endHeight < beginHeight)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "begin_height must be >= 0 and <= end_height");
+    if (endHeight - beginHeight >= MAX_MEDIAN_PRICE_HISTORY_COUNT)
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           strprintf("the range must not be over %d heights", MAX_MEDIAN_PRICE_HISTORY_COUNT));
+
+    vector<pair<uint32_t, PriceMap>> history;
+    {
+        CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
+        auto baseLock = view.LockBase();
+        if (!view.cw.blockCache.GetMedianPriceHistory(beginHeight, endHeight, history))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the median price index");
+    }
+
+    Array historyArray;
+    for (const auto &item : history) {
+        Array prices;
+        for (const auto &price : item.second)
+            prices.push_back(CPricePoint(price.first, price.second).ToJson());
+
+        Object obj;
+        obj.push_back(Pair("height",        (int64_t)item.first));
+        obj.push_back(Pair("median_prices", prices));
+        historyArray.push_back(obj);
+    }
+    Object obj;
+    obj.push_back(Pair("history", historyArray));
+    return obj;
+}
+
+static Object GetBlockTraceJSON(const CBlockTrace &trace) {
+    Array spans;
+    for (const auto &span : trace.spans) {
+        Object obj;
+        obj.push_back(Pair("name",          span.name));
+        obj.push_back(Pair("depth",         (int32_t)span.depth));
+        obj.push_back(Pair("start_us",      span.startMicros));
+        obj.push_back(Pair("duration_us",   span.durationMicros));
+        if (span.txIndex >= 0)
+            obj.push_back(Pair("tx_index",  span.txIndex));
+        if (span.detail != nullptr)
+            obj.push_back(Pair("tx_type",   span.detail));
+        spans.push_back(obj);
+    }
+
+    Object obj;
+    obj.push_back(Pair("height",        trace.height));
+    obj.push_back(Pair("hash",          trace.hash.GetHex()));
+    obj.push_back(Pair("time_us",       trace.startTime));
+    obj.push_back(Pair("duration_us",   trace.durationMicros));
+    obj.push_back(Pair("connected",     trace.fConnected));
+    obj.push_back(Pair("spans",         spans));
+    return obj;
+}
+
+// the complete events of the trace event format, the phases of a block nest on one track
+static void AppendBlockTraceEvents(const CBlockTrace &trace, Array &events) {
+    Object blockArgs;
+    blockArgs.push_back(Pair("height",      trace.height));
+    blockArgs.push_back(Pair("hash",        trace.hash.GetHex()));
+    blockArgs.push_back(Pair("connected",   trace.fConnected));
+
+    Object blockEvent;
+    blockEvent.push_back(Pair("name",   strprintf("ConnectTip %d", trace.height)));
+    blockEvent.push_back(Pair("cat",    "block"));
+    blockEvent.push_back(Pair("ph",     "X"));
+    blockEvent.push_back(Pair("ts",     trace.startTime));
+    blockEvent.push_back(Pair("dur",    trace.durationMicros));
+    blockEvent.push_back(Pair("pid",    1));
+    blockEvent.push_back(Pair("tid",    1));
+    blockEvent.push_back(Pair("args",   blockArgs));
+    events.push_back(blockEvent);
+
+    for (const auto &span : trace.spans) {
+        Object args;
+        args.push_back(Pair("height",       trace.height));
+        if (span.txIndex >= 0)
+            args.push_back(Pair("tx_index", span.txIndex));
+        if (span.detail != nullptr)
+            args.push_back(Pair("tx_type",  span.detail));
+
+        Object event;
+        event.push_back(Pair("name",    span.name));
+        event.push_back(Pair("cat",     "block"));
+        event.push_back(Pair("ph",      "X"));
+        event.push_back(Pair("ts",      trace.startTime + span.startMicros));
+        event.push_back(Pair("dur",     max<int64_t>(0, span.durationMicros)));
+        event.push_back(Pair("pid",     1));
+        event.push_back(Pair("tid",     1));
+        event.push_back(Pair("args",    args));
+        events.push_back(event);
+    }
+}
+
+Value getblocktraces(const Array& params, bool fHelp) {
+    if (fHelp || params.size() > 2) {
+        throw runtime_error(
+            "getblocktraces [count] [\"format\"]\n"
+            "\nGet the time breakdown of the last blocks connected, kept for the last -blocktraces blocks.\n"
+            "\nArguments:\n"
+            "1.\"count\":   (numeric, optional) the max number of blocks, default is 10\n"
+            "2.\"format\":  (string, optional) \"json\" or \"chrome\", default is \"json\". The chrome format is the\n"
+            "             trace event JSON loaded by chrome://tracing and Perfetto\n"
+            "\nResult (json):\n"
+            "[\n"
+            "  {\n"
+            "    \"height\": n,               (numeric) the block height\n"
+            "    \"hash\": \"xxx\",             (string) the block hash\n"
+            "    \"time_us\": n,              (numeric) the unix time of the start of ConnectTip in microseconds\n"
+            "    \"duration_us\": n,          (numeric) the time of ConnectTip\n"
+            "    \"connected\": true|false,   (boolean) whether the block was connected\n"
+            "    \"spans\": [                 (array) the phases in the order they started\n"
+            "      {\n"
+            "        \"name\": \"xxx\",         (string) the phase, e.g. CheckBlock, ExecuteTx, WriteUndo or Flush\n"
+            "        \"depth\": n,            (numeric) the number of the phases enclosing it\n"
+            "        \"start_us\": n,         (numeric) the offset from the start of ConnectTip\n"
+            "        \"duration_us\": n,      (numeric) the time of the phase, -1 if it failed\n"
+            "        \"tx_index\": n,         (numeric, optional) the index of the tx in the block\n"
+            "        \"tx_type\": \"xxx\"       (string, optional) the type of the tx\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getblocktraces", "5") + HelpExampleCli("getblocktraces", "100 \"chrome\"") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("getblocktraces", "5"));
+    }
+
+    int32_t count = params.size() > 0 ? params[0].get_int() : 10;
+    string format = params.size() > 1 ? params[1].get_str() : "json";
+    if (count <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be positive");
+    if (format != "json" && format != "chrome")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "format must be json or chrome");
+    if (blockTracer.GetCapacity() <= 0)
+        throw JSONRPCError(RPC_MISC_ERROR, "block tracing is disabled by -blocktraces=0");
+
+    auto traces = blockTracer.GetTraces(count);
+    if (format == "chrome") {
+        Array events;
+        for (const auto &pTrace : traces)
+            AppendBlockTraceEvents(*pTrace, events);
+
+        Object obj;
+        obj.push_back(Pair("traceEvents",       events));
+        obj.push_back(Pair("displayTimeUnit",   "ms"));
+        return obj;
+    }
+
+    Array arr;
+    for (const auto &pTrace : traces)
+        arr.push_back(GetBlockTraceJSON(*pTrace));
+    return arr;
+}
+
+Value gettxlatency(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1) {
+        throw runtime_error(
+            "gettxlatency \"txid\"\n"
+            "\nGet the time of each stage of the tx from its submission or first receipt to its finality, kept for the\n"
+            "last -txlatencytraces txs seen by this node.\n"
+            "\nArguments:\n"
+            "1.\"txid\":     (string, required) the txid\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\": \"xxx\",             (string) the txid\n"
+            "  \"time_us\": n,              (numeric) the unix time of its first stage in microseconds\n"
+            "  \"block_height\": n,         (numeric, optional) the height of its block while connected\n"
+            "  \"stages\": [                (array) the stages reached, in the order of the path of a tx\n"
+            "    {\n"
+            "      \"stage\": \"xxx\",         (string) rpc_received, p2p_received, mempool_accepted, relayed, packed,\n"
+            "                               connected or finalized\n"
+            "      \"time_us\": n,          (numeric) the unix time of the stage in microseconds\n"
+            "      \"elapsed_us\": n        (numeric) the offset from the first stage\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("gettxlatency", "\"c5287324b89793fdf7fa97b6203dfd814b8358cfa31114078ea5981916d7a8ac\"") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("gettxlatency", "\"c5287324b89793fdf7fa97b6203dfd814b8358cfa31114078ea5981916d7a8ac\""));
+    }
+
+    if (!txLatencyTracer.IsEnabled())
+        throw JSONRPCError(RPC_MISC_ERROR, "tx latency tracing is disabled by -txlatencytraces=0");
+
+    uint256 txid = uint256S(params[0].get_str());
+    CTxLatencyTrace trace;
+    if (!txLatencyTracer.GetTrace(txid, trace))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "The tx is not traced");
+
+    int64_t start = trace.GetStartTime();
+    Array stages;
+    for (uint8_t stage = 0; stage < TX_STAGE_COUNT; stage++) {
+        int64_t time = trace.stageTimes[stage];
+        if (time == 0)
+            continue;
+
+        Object obj;
+        obj.push_back(Pair("stage",         GetTxLatencyStageName((TxLatencyStage)stage)));
+        obj.push_back(Pair("time_us",       time));
+        obj.push_back(Pair("elapsed_us",    time - start));
+        stages.push_back(obj);
+    }
+
+    Object obj;
+    obj.push_back(Pair("txid",      trace.txid.GetHex()));
+    obj.push_back(Pair("time_us",   start));
+    if (trace.blockHeight >= 0)
+        obj.push_back(Pair("block_height", trace.blockHeight));
+    obj.push_back(Pair("stages",    stages));
+    return obj;
+}
@@ -3,6 +3,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chain/txlatency.h"
 #include "commons/base58.h"
 #include "config/const.h"
 #include "rpc/core/rpccommons.h"
@@ -10,6 +11,7 @@
 #include "init.h"
 #include "net.h"
 #include "commons/util/util.h"
+#include "persistence/statesnapshot.h"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "tx/dextx.h"
@@ -41,7 +43,7 @@ namespace RPC_PARAM {
 
     OrderType GetOrderType(const Value &jsonValue) {
         OrderType ret;
-        if (kOrderTypeHelper.Parse(jsonValue.get_str(), ret))
+        if (!kOrderTypeHelper.Parse(jsonValue.get_str(), ret))
             throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("order_type=%s is invalid",
                 jsonValue.get_str()));
         return ret;
@@ -49,7 +51,7 @@ namespace RPC_PARAM {
 
     OrderSide GetOrderSide(const Value &jsonValue) {
         OrderSide ret;
-        if (kOrderSideHelper.Parse(jsonValue.get_str(), ret))
+        if (!kOrderSideHelper.Parse(jsonValue.get_str(), ret))
             throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("order_side=%s is invalid",
                 jsonValue.get_str()));
         return ret;
@@ -133,6 +135,8 @@ namespace RPC_PARAM {
 Object SubmitOrderTx(const CKeyID &txKeyid, const DexOperatorDetail &operatorDetail,
     shared_ptr<CDEXOrderBaseTx> &pOrderBaseTx) {
 
+    if (!pWalletMain)
+        throw JSONRPCError(RPC_WALLET_ERROR, "The wallet is disabled");
     if (!pWalletMain->HaveKey(txKeyid)) {
         throw JSONRPCError(RPC_WALLET_ERROR, "tx user address not found in wallet");
     }
@@ -156,6 +160,7 @@ Object SubmitOrderTx(const CKeyID &txKeyid, const DexOperatorDetail &operatorDet
         }
     }
 
+    txLatencyTracer.Stamp(pBaseTx->GetHash(), TX_STAGE_RPC_RECEIVED);
     std::tuple<bool, string> ret = pWalletMain->CommitTx(pBaseTx.get());
     if (!std::get<0>(ret)) {
         throw JSONRPCError(RPC_WALLET_ERROR,
@@ -667,9 +672,9 @@ Value getdexorder(const Array& params, bool fHelp) {
     }
     const uint256 &orderId = RPC_PARAM::GetTxid(params[0], "order_id");
 
-    auto pDexCache = pCdMan->pDexCache;
+    CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
     CDEXOrderDetail orderDetail;
-    if (!pDexCache->GetActiveOrder(orderId, orderDetail))
+    if (!view.cw.dexCache.GetActiveOrder(orderId, orderDetail))
         throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("The order not exists or inactive! order_id=%s", orderId.ToString()));
 
     Object obj;
@@ -715,30 +720,8 @@ extern Value getdexsysorders(const Array& params, bool fHelp) {
     return obj;
 }
 
-extern Value getdexorders(const Array& params, bool fHelp) {
-     if (fHelp || params.size() > 4) {
-        throw runtime_error(
-            "getdexorders [\"begin_height\"] [\"end_height\"] [\"max_count\"] [\"last_pos_info\"]\n"
-            "\nget dex all active orders by block height range.\n"
-            "\nArguments:\n"
-            "1.\"begin_height\":    (numeric, optional) the begin block height, default is 0\n"
-            "2.\"end_height\":      (numeric, optional) the end block height, default is current tip block height\n"
-            "3.\"max_count\":       (numeric, optional) the max order count to get, default is 500\n"
-            "4.\"last_pos_info\":   (string, optional) the last position info to get more orders, default is empty\n"
-            "\nResult:\n"
-            "\"begin_height\"       (numeric) the begin block height of returned orders.\n"
-            "\"end_height\"         (numeric) the end block height of returned orders.\n"
-            "\"has_more\"           (bool) has more orders in db.\n"
-            "\"last_pos_info\"      (string) the last position info to get more orders.\n"
-            "\"count\"              (numeric) the count of returned orders.\n"
-            "\"orders\"             (string) a list of system-generated DEX orders.\n"
-            "\nExamples:\n"
-            + HelpExampleCli("getdexorders", "0 100 500")
-            + "\nAs json rpc call\n"
-            + HelpExampleRpc("getdexorders", "0, 100, 500")
-        );
-    }
-
+// the active orders of the params of getdexorders and the position info to get more
+static shared_ptr<CDEXOrdersGetter> GetDexOrders(const Array& params, string &newLastPosInfo) {
     int64_t tipHeight = chainActive.Height();
     int64_t beginHeight = 0;
     if (params.size() > 0)
@@ -783,18 +766,281 @@ extern Value getdexorders(const Array& params, bool fHelp) {
             beginHeight, endHeight));
     }
 
-    string newLastPosInfo;
     if (pGetter->has_more) {
         auto err = DEX_DB::MakeLastPos(pGetter->last_key, newLastPosInfo);
         if (err)
             throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("Make new last_pos_info error! %s", *err));
     }
+    return pGetter;
+}
+
+static void WriteDexOrdersJSON(CJsonWriter& writer, const CDEXOrdersGetter &getter, const string &newLastPosInfo) {
+    writer.BeginObject();
+    writer.Field("begin_height",    (int64_t)getter.begin_height);
+    writer.Field("end_height",      (int64_t)getter.end_height);
+    writer.Field("has_more",        getter.has_more);
+    writer.Field("last_pos_info",   HexStr(newLastPosInfo));
+    writer.Field("count",           (int64_t)getter.orders.size());
+    writer.Key("orders");
+    writer.BeginArray();
+    for (auto &item : getter.orders) {
+        Object objItem;
+        DEX_DB::OrderToJson(DEX_DB::GetOrderId(item.first), item.second, objItem);
+        writer.WriteValue(objItem);
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
+
+extern Value getdexorders(const Array& params, bool fHelp) {
+     if (fHelp || params.size() > 4) {
+        throw runtime_error(
+            "getdexorders [\"begin_height\"] [\"end_height\"] [\"max_count\"] [\"last_pos_info\"]\n"
+            "\nget dex all active orders by block height range.\n"
+            "\nArguments:\n"
+            "1.\"begin_height\":    (numeric, optional) the begin block height, default is 0\n"
+            "2.\"end_height\":      (numeric, optional) the end block height, default is current tip block height\n"
+            "3.\"max_count\":       (numeric, optional) the max order count to get, default is 500\n"
+            "4.\"last_pos_info\":   (string, optional) the last position info to get more orders, default is empty\n"
+            "\nResult:\n"
+            "\"begin_height\"       (numeric) the begin block height of returned orders.\n"
+            "\"end_height\"         (numeric) the end block height of returned orders.\n"
+            "\"has_more\"           (bool) has more orders in db.\n"
+            "\"last_pos_info\"      (string) the last position info to get more orders.\n"
+            "\"count\"              (numeric) the count of returned orders.\n"
+            "\"orders\"             (string) a list of system-generated DEX orders.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdexorders", "0 100 500")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("getdexorders", "0, 100, 500")
+        );
+    }
+
+    string newLastPosInfo;
+    auto pGetter = GetDexOrders(params, newLastPosInfo);
+
+    CJsonWriter writer;
+    WriteDexOrdersJSON(writer, *pGetter, newLastPosInfo);
+    return JSON::FromWriter(writer);
+}
+
+bool streamgetdexorders(const Array& params, CJsonWriter& writer) {
+    if (params.size() > 4)
+        return false;
+
+    string newLastPosInfo;
+    auto pGetter = GetDexOrders(params, newLastPosInfo);
+    WriteDexOrdersJSON(writer, *pGetter, newLastPosInfo);
+    return true;
+}
+
+extern Value opendexorderscursor(const Array& params, bool fHelp) {
+     if (fHelp || params.size() > 2) {
+        throw runtime_error(
+            "opendexorderscursor [\"begin_height\"] [\"end_height\"]\n"
+            "\nopen a cursor over all active dex orders by block height range, to be read by readdexorderscursor.\n"
+            "The cursor reads the orders as they are at its opening, it is closed after idle for "
+                + strprintf("%d", CDEXOrdersCursors::CURSOR_TIMEOUT) + " seconds.\n"
+            "\nArguments:\n"
+            "1.\"begin_height\":    (numeric, optional) the begin block height, default is 0\n"
+            "2.\"end_height\":      (numeric, optional) the end block height, default is current tip block height\n"
+            "\nResult:\n"
+            "\"cursor_id\"          (string) the id of the cursor.\n"
+            "\"begin_height\"       (numeric) the begin block height of the cursor.\n"
+            "\"end_height\"         (numeric) the end block height of the cursor.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("opendexorderscursor", "0 100")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("opendexorderscursor", "0, 100")
+        );
+    }
+
+    int64_t tipHeight = chainActive.Height();
+    int64_t beginHeight = 0;
+    if (params.size() > 0)
+        beginHeight = params[0].get_int64();
+    if (beginHeight < 0 || beginHeight > tipHeight) {
+        throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("begin_height=%d must >= 0 and <= tip_height=%d", beginHeight, tipHeight));
+    }
+
+    int64_t endHeight = tipHeight;
+    if (params.size() > 1)
+        endHeight = params[1].get_int64();
+    if (endHeight < beginHeight || endHeight > tipHeight) {
+        throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("end_height=%d must >= begin_height=%d and <= tip_height=%d",
+            endHeight, beginHeight, tipHeight));
+    }
+
+    auto spCursor = pCdMan->pDexCache->CreateOrdersCursor(beginHeight, endHeight);
+    string cursorId = pCdMan->pDexCache->GetOrdersCursors()->Open(spCursor);
+
     Object obj;
-    obj.push_back(Pair("begin_height", (int64_t)pGetter->begin_height));
-    obj.push_back(Pair("end_height", (int64_t)pGetter->end_height));
-    obj.push_back(Pair("has_more", pGetter->has_more));
-    obj.push_back(Pair("last_pos_info", HexStr(newLastPosInfo)));
-    pGetter->ToJson(obj);
+    obj.push_back(Pair("cursor_id", cursorId));
+    obj.push_back(Pair("begin_height", beginHeight));
+    obj.push_back(Pair("end_height", endHeight));
+    return obj;
+}
+
+// thread safe, does not hold cs_main
+extern Value readdexorderscursor(const Array& params, bool fHelp) {
+     if (fHelp || params.size() < 1 || params.size() > 2) {
+        throw runtime_error(
+            "readdexorderscursor \"cursor_id\" [\"max_count\"]\n"
+            "\nread the next orders of the cursor opened by opendexorderscursor, the cursor is closed after the last orders.\n"
+            "\nArguments:\n"
+            "1.\"cursor_id\":       (string, required) the id of the cursor\n"
+            "2.\"max_count\":       (numeric, optional) the max order count to read, default is 500\n"
+            "\nResult:\n"
+            "\"has_more\"           (bool) has more orders in the cursor.\n"
+            "\"count\"              (numeric) the count of returned orders.\n"
+            "\"orders\"             (string) a list of DEX orders.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("readdexorderscursor", "\"cursor_id\" 500")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("readdexorderscursor", "\"cursor_id\", 500")
+        );
+    }
+
+    string cursorId = params[0].get_str();
+    int64_t maxCount = 500;
+    if (params.size() > 1) {
+        maxCount = params[1].get_int64();
+        if (maxCount <= 0)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("max_count=%d must > 0", maxCount));
+    }
+
+    auto spCursors = pCdMan->pDexCache->GetOrdersCursors();
+    auto spCursor = spCursors->Get(cursorId);
+    if (!spCursor)
+        throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("The cursor is closed or expired! cursor_id=%s", cursorId));
+
+    DEX_DB::BlockOrders orders;
+    bool hasMore = spCursor->Read(maxCount, orders);
+    if (!hasMore)
+        spCursors->Close(cursorId);
+
+    Object obj;
+    obj.push_back(Pair("has_more", hasMore));
+    DEX_DB::BlockOrdersToJson(orders, obj);
+    return obj;
+}
+
+// thread safe, does not hold cs_main
+extern Value closedexorderscursor(const Array& params, bool fHelp) {
+     if (fHelp || params.size() != 1) {
+        throw runtime_error(
+            "closedexorderscursor \"cursor_id\"\n"
+            "\nclose the cursor opened by opendexorderscursor.\n"
+            "\nArguments:\n"
+            "1.\"cursor_id\":       (string, required) the id of the cursor\n"
+            "\nResult:\n"
+            "\"closed\"             (bool) false if the cursor is already closed or expired.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("closedexorderscursor", "\"cursor_id\"")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("closedexorderscursor", "\"cursor_id\"")
+        );
+    }
+
+    Object obj;
+    obj.push_back(Pair("closed", pCdMan->pDexCache->GetOrdersCursors()->Close(params[0].get_str())));
+    return obj;
+}
+
+static shared_ptr<CDEXOrderBook> GetDexOrderBook() {
+    auto spOrderBook = pCdMan->pDexCache->GetOrderBook();
+    spOrderBook->LoadIfNeeded();
+    return spOrderBook;
+}
+
+static CDEXOrderBook::BookKey GetDexBookKey(const Array& params, OrderSide orderSide) {
+    DexID dexId               = RPC_PARAM::GetDexId(params[0]);
+    TokenSymbol coinSymbol    = RPC_PARAM::GetOrderCoinSymbol(params[1]);
+    TokenSymbol assetSymbol   = RPC_PARAM::GetOrderAssetSymbol(params[2]);
+    // the symbols without orders are not interned, their books are empty
+    return make_tuple(dexId, CTokenSymbolTable::Find(coinSymbol), CTokenSymbolTable::Find(assetSymbol),
+                      (uint8_t)orderSide);
+}
+
+extern Value getdexorderbook(const Array& params, bool fHelp) {
+     if (fHelp || params.size() < 3 || params.size() > 4) {
+        throw runtime_error(
+            "getdexorderbook \"dex_id\" \"coin_symbol\" \"asset_symbol\" [\"max_count\"]\n"
+            "\nget the top active limit orders of both sides of a trading pair, by price-time priority.\n"
+            "\nArguments:\n"
+            "1.\"dex_id\":        (numeric, required) dex id\n"
+            "2.\"coin_symbol\":   (string, required) coin type to pay or get\n"
+            "3.\"asset_symbol\":  (string, required) asset type to buy or sell\n"
+            "4.\"max_count\":     (numeric, optional) the max order count of each side, default is 20, 0 for all\n"
+            "\nResult:\n"
+            "\"buy_orders\"       (array) the buy orders, the highest price first.\n"
+            "\"sell_orders\"      (array) the sell orders, the lowest price first.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdexorderbook", "0 \"WUSD\" \"WICC\" 20")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("getdexorderbook", "0, \"WUSD\", \"WICC\", 20")
+        );
+    }
+
+    uint32_t maxCount = params.size() > 3 ? RPC_PARAM::GetUint32(params[3]) : 20;
+
+    LOCK(cs_main);
+    auto spOrderBook = GetDexOrderBook();
+
+    Object obj;
+    for (auto orderSide : {ORDER_BUY, ORDER_SELL}) {
+        vector<CDEXOrderBook::OrderItem> orders;
+        spOrderBook->GetOrders(GetDexBookKey(params, orderSide), maxCount, orders);
+        Array array;
+        for (const auto &item : orders) {
+            Object objItem;
+            DEX_DB::OrderToJson(item.first, item.second, objItem);
+            array.push_back(objItem);
+        }
+        obj.push_back(Pair(orderSide == ORDER_BUY ? "buy_orders" : "sell_orders", array));
+    }
+    return obj;
+}
+
+extern Value getdexorderbookdepth(const Array& params, bool fHelp) {
+     if (fHelp || params.size() < 3 || params.size() > 4) {
+        throw runtime_error(
+            "getdexorderbookdepth \"dex_id\" \"coin_symbol\" \"asset_symbol\" [\"max_levels\"]\n"
+            "\nget the price levels of the active limit orders of both sides of a trading pair.\n"
+            "\nArguments:\n"
+            "1.\"dex_id\":        (numeric, required) dex id\n"
+            "2.\"coin_symbol\":   (string, required) coin type to pay or get\n"
+            "3.\"asset_symbol\":  (string, required) asset type to buy or sell\n"
+            "4.\"max_levels\":    (numeric, optional) the max price level count of each side, default is 20, 0 for all\n"
+            "\nResult:\n"
+            "\"buy_levels\"       (array) the {price, asset_amount, count} of buy orders, the highest price first.\n"
+            "\"sell_levels\"      (array) the {price, asset_amount, count} of sell orders, the lowest price first.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdexorderbookdepth", "0 \"WUSD\" \"WICC\" 20")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("getdexorderbookdepth", "0, \"WUSD\", \"WICC\", 20")
+        );
+    }
+
+    uint32_t maxLevels = params.size() > 3 ? RPC_PARAM::GetUint32(params[3]) : 20;
+
+    LOCK(cs_main);
+    auto spOrderBook = GetDexOrderBook();
+
+    Object obj;
+    for (auto orderSide : {ORDER_BUY, ORDER_SELL}) {
+        vector<CDEXOrderBook::PriceLevel> levels;
+        spOrderBook->GetDepth(GetDexBookKey(params, orderSide), maxLevels, levels);
+        Array array;
+        for (const auto &level : levels) {
+            Object objItem;
+            objItem.push_back(Pair("price", level.price));
+            objItem.push_back(Pair("asset_amount", level.asset_amount));
+            objItem.push_back(Pair("count", (uint64_t)level.count));
+            array.push_back(objItem);
+        }
+        obj.push_back(Pair(orderSide == ORDER_BUY ? "buy_levels" : "sell_levels", array));
+    }
     return obj;
 }
 
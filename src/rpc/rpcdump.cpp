@@ -10,6 +10,7 @@
 #include "main.h"
 #include "sync.h"
 #include "wallet/wallet.h"
+#include "wallet/walletrescan.h"
 
 #include <fstream>
 #include <cstdint>
@@ -169,7 +170,6 @@ Value dumpprivkey(const Array& params, bool fHelp) {
     return reply;
 }
 
-// TODO: enable rescan wallet.
 Value importprivkey(const Array& params, bool fHelp) {
     if (fHelp || (params.size() != 1 && params.size() != 2))
         throw runtime_error(
@@ -178,6 +178,7 @@ Value importprivkey(const Array& params, bool fHelp) {
             "\nArguments:\n"
             "1.\"privkey\"      (string, required) The private key, which can be the mining key when address is supplied (also refer to dumpprivkey)\n"
             "2.\"address\"      (string, optional) Set the miner's saving account address when importing the mining privkey in front\n"
+            "\nNote: the txs of the key in the blocks are not imported, call rescanwallet for them\n"
             "\nExamples:\n"
             "\nDump privkey first\n" +
             HelpExampleCli("dumpprivkey", "\"address\"") + "\nImport privkey\n" +
@@ -222,6 +223,41 @@ Value importprivkey(const Array& params, bool fHelp) {
     return ret;
 }
 
+Value rescanwallet(const Array& params, bool fHelp) {
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "rescanwallet [start_height]\n"
+            "\nRescan the block chain for the txs of the wallet keys, e.g. after importprivkey.\n"
+            "\nArguments:\n"
+            "1.\"start_height\"  (numeric, optional) the height to rescan from, default is 0\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"start_height\": n,     (numeric) the height rescanned from\n"
+            "  \"tip_height\": n,       (numeric) the height of the tip when the rescan ended\n"
+            "  \"found_tx_count\": n    (numeric) the number of the wallet txs found\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("rescanwallet", "") + "\nRescan from the block 3000000\n" +
+            HelpExampleCli("rescanwallet", "3000000") + "\nAs a json rpc call\n" +
+            HelpExampleRpc("rescanwallet", "3000000"));
+
+    int32_t startHeight = params.size() > 0 ? params[0].get_int() : 0;
+    if (startHeight < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "start_height must be >= 0");
+
+    // without cs_main, the blocks are scanned in parallel and merged under the locks at the end
+    CWalletRescan rescan(pWalletMain, startHeight, CWalletRescan::GetWorkerCount());
+    int32_t nFound = rescan.Run();
+    if (ShutdownRequested())
+        throw JSONRPCError(RPC_MISC_ERROR, "Rescan aborted by shutdown");
+
+    Object ret;
+    ret.push_back(Pair("start_height",      startHeight));
+    ret.push_back(Pair("tip_height",        chainActive.Height()));
+    ret.push_back(Pair("found_tx_count",    nFound));
+    return ret;
+}
+
 Value dropminermainkeys(const Array& params, bool fHelp) {
     if (fHelp || params.size() != 0) {
         throw runtime_error(
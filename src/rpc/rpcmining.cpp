@@ -13,6 +13,7 @@
 #include "init.h"
 #include "main.h"
 #include "miner/miner.h"
+#include "rpc/core/rpccommons.h"
 #include "rpc/core/rpcprotocol.h"
 #include "rpc/core/rpcserver.h"
 #include "sync.h"
@@ -109,6 +110,7 @@ Value getmininginfo(const Array& params, bool fHelp) {
             "  \"generate\": true|false     (boolean) If the generation is on or off (see getgenerate or setgenerate "
             "calls)\n"
             "  \"pooledtx\": n              (numeric) The size of the mem pool\n"
+            "  \"sigcache\": {...}          (object) The signature cache hits, misses, entries, bytes and max_bytes\n"
             "  \"testnet\": true|false      (boolean) If using testnet or not\n"
             "}\n"
             "\nExamples:\n" +
@@ -125,6 +127,7 @@ Value getmininginfo(const Array& params, bool fHelp) {
     obj.push_back(Pair("nettype",          NetTypeNames[SysCfg().NetworkID()]));
     obj.push_back(Pair("posmaxnonce",      (int32_t)SysCfg().GetBlockMaxNonce()));
     obj.push_back(Pair("generate",         GetMiningInfo()));
+    obj.push_back(Pair("sigcache",         GetSigCacheStatsJSON()));
     return obj;
 }
 
@@ -196,6 +199,18 @@ Value getminedblocks(const Array& params, bool fHelp) {
             "    \"blocksize\": n          (numeric) block size (bytes)\n"
             "    \"hash\": xxx             (string) block hash\n"
             "    \"preblockhash\": xxx     (string) pre block hash\n"
+            "    \"times\": {              (object) the time breakdown of the production in microseconds\n"
+            "      \"lock_wait_us\": n     (numeric) waiting for cs_main and mempool.cs\n"
+            "      \"select_us\": n        (numeric) taking the txs by priority from the mempool\n"
+            "      \"execute_us\": n       (numeric) checking and executing the txs tried\n"
+            "      \"pack_us\": n          (numeric) the whole packing, incl. select and execute\n"
+            "      \"sign_us\": n          (numeric) creating and signing the block reward tx\n"
+            "      \"process_us\": n       (numeric) processing the block, i.e. connecting and relaying it\n"
+            "      \"total_us\": n         (numeric) from the start of the slot to the block processed\n"
+            "      \"tried_tx_count\": n   (numeric) the txs executed, incl. the failed ones\n"
+            "      \"prepacked_tx_count\": n (numeric) the txs packed before the slot started\n"
+            "      \"cutoff\": true|false  (boolean) whether the packing stopped for lack of time\n"
+            "    }\n"
             "  }\n"
             "]\n"
             "\nExamples:\n" +
@@ -221,6 +236,20 @@ Value getminedblocks(const Array& params, bool fHelp) {
         obj.push_back(Pair("block_size",    blockInfo.totalBlockSize));
         obj.push_back(Pair("txid",          blockInfo.hash.ToString()));
         obj.push_back(Pair("preblockhash",  blockInfo.hashPrevBlock.ToString()));
+
+        const MiningSlotTimes &times = blockInfo.times;
+        Object timesObj;
+        timesObj.push_back(Pair("lock_wait_us",     times.lockWait));
+        timesObj.push_back(Pair("select_us",        times.select));
+        timesObj.push_back(Pair("execute_us",       times.execute));
+        timesObj.push_back(Pair("pack_us",          times.pack));
+        timesObj.push_back(Pair("sign_us",          times.sign));
+        timesObj.push_back(Pair("process_us",       times.process));
+        timesObj.push_back(Pair("total_us",         times.total));
+        timesObj.push_back(Pair("tried_tx_count",   (int64_t)times.triedTxCount));
+        timesObj.push_back(Pair("prepacked_tx_count", (int64_t)times.prepackedTxCount));
+        timesObj.push_back(Pair("cutoff",           times.fCutoff));
+        obj.push_back(Pair("times",         timesObj));
         ret.push_back(obj);
     }
 
@@ -9,9 +9,13 @@
 #include "net.h"
 #include "netbase.h"
 #include "miner/pbftmanager.h"
+#include "persistence/statedump.h"
+#include "rpc/core/httpserver.h"
 #include "rpc/core/rpccommons.h"
+#include "rpc/core/rpcevents.h"
 #include "rpc/core/rpcserver.h"
 #include "commons/util/util.h"
+#include "commons/util/allocator.h"
 
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
@@ -21,6 +25,7 @@
 #include <boost/assign/list_of.hpp>
 #include "commons/json/json_spirit_utils.h"
 #include "commons/json/json_spirit_value.h"
+#include "wasm/wasm_runtime.hpp"
 
 
 using namespace std;
@@ -94,6 +99,8 @@ Value getinfo(const Array& params, bool fHelp) {
             "  \"tipblock_height\": xxxxx ,     (numeric) the number of blocks contained the most work in the network\n"
             "  \"synblock_height\": xxxxx ,     (numeric) the block height of the loggest chain found in the network\n"
             "  \"connections\": xxxxx,          (numeric) the number of connections\n"
+            "  \"sig_cache\": {...},            (object) signature cache hits, misses, entries, bytes and max_bytes\n"
+            "  \"rpc_cache\": {...},            (object) rpc result cache hits, misses, stores, entries, bytes and max_bytes\n"
             "  \"errors\": \"xxxxx\"            (string) any error messages\n"
             "}\n"
             "\nExamples:\n" +
@@ -142,11 +149,230 @@ Value getinfo(const Array& params, bool fHelp) {
     obj.push_back(Pair("local_finblock_hash",    localFinIndex->GetBlockHash().GetHex())) ;
 
     obj.push_back(Pair("connections",           (int32_t)vNodes.size()));
+    obj.push_back(Pair("sig_cache",             GetSigCacheStatsJSON()));
+    obj.push_back(Pair("rpc_cache",             GetRPCCacheStatsJSON()));
     obj.push_back(Pair("errors",                GetWarnings("statusbar")));
 
     return obj;
 }
 
+Value getrpcinfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcinfo\n"
+            "\nget the work queue, compression and per endpoint latency stats of the RPC server.\n"
+            "\nArguments:\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"work_queue_depth\": n,        (numeric) the requests waiting in the work queue\n"
+            "  \"max_work_queue_depth\": n,    (numeric) the work queue depth, set by -rpcworkqueue\n"
+            "  \"workers\": n,                 (numeric) the worker threads, set by -rpcthreads\n"
+            "  \"compressed_replies\": n,      (numeric) the replies compressed with gzip or deflate\n"
+            "  \"compressed_bytes_in\": n,     (numeric) the size of the compressed replies before the compression\n"
+            "  \"compressed_bytes_out\": n,    (numeric) the size of the compressed replies sent\n"
+            "  \"streams\": n,                 (numeric) the chunked replies in progress\n"
+            "  \"event_subscribers\": n,       (numeric) the subscribers of /events\n"
+            "  \"events\": n,                  (numeric) the events published\n"
+            "  \"event_dropped\": n,           (numeric) the subscribers disconnected for their backlog\n"
+            "  \"endpoints\": [                (array) the registered paths\n"
+            "    {\n"
+            "      \"path\": \"xxx\",           (string) the path prefix\n"
+            "      \"requests\": n,            (numeric) the requests dispatched to the work queue\n"
+            "      \"rejected\": n,            (numeric) the requests rejected with the work queue full\n"
+            "      \"queued\": n,              (numeric) the requests waiting in the work queue\n"
+            "      \"max_queued\": n,          (numeric) the max of queued\n"
+            "      \"avg_queue_us\": n,        (numeric) the average wait in the work queue\n"
+            "      \"avg_handle_us\": n,       (numeric) the average time in the handler\n"
+            "      \"max_latency_us\": n       (numeric) the max of the wait and the time in the handler\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrpcinfo", "") + "\nAs json rpc\n" + HelpExampleRpc("getrpcinfo", ""));
+
+    HTTPServerStats stats = GetHTTPServerStats();
+
+    Object obj;
+    obj.push_back(Pair("work_queue_depth",      stats.workQueueDepth));
+    obj.push_back(Pair("max_work_queue_depth",  stats.maxWorkQueueDepth));
+    obj.push_back(Pair("workers",               stats.workers));
+    obj.push_back(Pair("compressed_replies",    stats.compressedReplies));
+    obj.push_back(Pair("compressed_bytes_in",   stats.compressedBytesIn));
+    obj.push_back(Pair("compressed_bytes_out",  stats.compressedBytesOut));
+    obj.push_back(Pair("streams",               stats.streams));
+
+    CRPCEventPublisher::CStats eventStats = rpcEventPublisher.GetStats();
+    obj.push_back(Pair("event_subscribers",     eventStats.subscribers));
+    obj.push_back(Pair("events",                eventStats.events));
+    obj.push_back(Pair("event_dropped",         eventStats.dropped));
+
+    Array endpoints;
+    for (const HTTPPathStats& path : stats.paths) {
+        // the requests still queued have no handle time yet
+        uint64_t started = path.requests - std::min(path.queued, path.requests);
+        Object endpoint;
+        endpoint.push_back(Pair("path",             path.prefix));
+        endpoint.push_back(Pair("requests",         path.requests));
+        endpoint.push_back(Pair("rejected",         path.rejected));
+        endpoint.push_back(Pair("queued",           path.queued));
+        endpoint.push_back(Pair("max_queued",       path.maxQueued));
+        endpoint.push_back(Pair("avg_queue_us",     started > 0 ? path.queueMicros / started : 0));
+        endpoint.push_back(Pair("avg_handle_us",    started > 0 ? path.handleMicros / started : 0));
+        endpoint.push_back(Pair("max_latency_us",   path.maxLatencyMicros));
+        endpoints.push_back(endpoint);
+    }
+    obj.push_back(Pair("endpoints", endpoints));
+
+    return obj;
+}
+
+Value getlockstats(const Array& params, bool fHelp) {
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "getlockstats [\"lock\"] [count]\n"
+            "\nget the wait and hold times of the LOCK sites profiled, by the total wait descending.\n"
+            "\nArguments:\n"
+            "1.\"lock\":    (string, optional) only the sites of the lock, e.g. cs_main, mempool.cs or cs_vNodes\n"
+            "2.\"count\":   (numeric, optional) the max number of sites, default is 20\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\": true|false,    (boolean) whether the profiling is on, set by -lockprofile or setlockprofiling\n"
+            "  \"sites\": [\n"
+            "    {\n"
+            "      \"lock\": \"xxx\",           (string) the lock\n"
+            "      \"site\": \"xxx\",           (string) the file:line of the LOCK\n"
+            "      \"acquisitions\": n,       (numeric) the acquisitions released\n"
+            "      \"contentions\": n,        (numeric) the acquisitions which waited for the lock\n"
+            "      \"wait_us\": n,            (numeric) the total wait of the contentions\n"
+            "      \"wait_p99_us\": n,        (numeric) the 99th percentile of the wait of the contentions\n"
+            "      \"hold_us\": n,            (numeric) the total hold time\n"
+            "      \"hold_p50_us\": n,        (numeric) the median hold time\n"
+            "      \"hold_p99_us\": n         (numeric) the 99th percentile of the hold time\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getlockstats", "\"cs_main\" 10") + "\nAs json rpc\n" + HelpExampleRpc("getlockstats", "\"cs_main\", 10"));
+
+    string lockName = params.size() > 0 ? params[0].get_str() : "";
+    int32_t count   = params.size() > 1 ? params[1].get_int() : 20;
+    if (count <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be positive");
+
+    vector<const CLockSite*> sites;
+    for (const CLockSite* pSite : GetLockSites()) {
+        if ((lockName.empty() || lockName == pSite->pszName) && pSite->holdTime.GetCount() > 0)
+            sites.push_back(pSite);
+    }
+    sort(sites.begin(), sites.end(), [](const CLockSite* a, const CLockSite* b) {
+        return a->waitTime.GetSumMicros() > b->waitTime.GetSumMicros();
+    });
+    if (sites.size() > (size_t)count)
+        sites.resize(count);
+
+    Array siteArray;
+    for (const CLockSite* pSite : sites) {
+        Object site;
+        site.push_back(Pair("lock",            pSite->pszName));
+        site.push_back(Pair("site",            strprintf("%s:%d", pSite->pszFile, pSite->nLine)));
+        site.push_back(Pair("acquisitions",    pSite->holdTime.GetCount()));
+        site.push_back(Pair("contentions",     pSite->waitTime.GetCount()));
+        site.push_back(Pair("wait_us",         pSite->waitTime.GetSumMicros()));
+        site.push_back(Pair("wait_p99_us",     pSite->waitTime.GetQuantile(0.99)));
+        site.push_back(Pair("hold_us",         pSite->holdTime.GetSumMicros()));
+        site.push_back(Pair("hold_p50_us",     pSite->holdTime.GetQuantile(0.5)));
+        site.push_back(Pair("hold_p99_us",     pSite->holdTime.GetQuantile(0.99)));
+        siteArray.push_back(site);
+    }
+
+    Object obj;
+    obj.push_back(Pair("enabled", fLockProfiling.load()));
+    obj.push_back(Pair("sites",   siteArray));
+    return obj;
+}
+
+Value setlockprofiling(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "setlockprofiling enable\n"
+            "\nturn the profiling of the LOCK sites on or off, the stats recorded are kept.\n"
+            "\nArguments:\n"
+            "1.\"enable\":  (boolean, required) whether to profile the locks\n"
+            "\nResult:\n"
+            "true|false     (boolean) whether the profiling was on before\n"
+            "\nExamples:\n" +
+            HelpExampleCli("setlockprofiling", "true") + "\nAs json rpc\n" + HelpExampleRpc("setlockprofiling", "true"));
+
+    return fLockProfiling.exchange(params[0].get_bool());
+}
+
+Value getmemoryinfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getmemoryinfo [release]\n"
+            "\nget the memory of the node by subsystem and the stats of its allocator.\n"
+            "\nArguments:\n"
+            "1.\"release\":   (boolean, optional) give the free pages of the allocator back to the OS first, default is false\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"allocator\": \"xxx\",          (string) the malloc the node is built with, system, jemalloc or tcmalloc\n"
+            "  \"huge_pages\": true|false,    (boolean) whether the wasm memories use huge pages, set by -hugepages\n"
+            "  \"resident_bytes\": n,         (numeric) the resident set size of the process\n"
+            "  \"allocator_stats\": {         (object) the bytes by stat of the allocator\n"
+            "    \"xxx\": n, ...\n"
+            "  },\n"
+            "  \"subsystems\": {\n"
+            "    \"db_caches\": {             (object) the bytes held by the db caches by db and their total\n"
+            "      \"xxx\": n, ...\n"
+            "    },\n"
+            "    \"mempool\": n,              (numeric) the bytes of the txs in the mempool\n"
+            "    \"block_index\": n,          (numeric) the approx. bytes of the block index entries\n"
+            "    \"rpc_cache\": n,            (numeric) the bytes of the RPC result cache\n"
+            "    \"sig_cache\": n,            (numeric) the bytes of the signature cache\n"
+            "    \"wasm_memories\": n         (numeric) the wasm linear memories mapped, pooled or in use\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getmemoryinfo", "true") + "\nAs json rpc\n" + HelpExampleRpc("getmemoryinfo", "true"));
+
+    if (params.size() > 0 && params[0].get_bool() && !ReleaseFreeMemory())
+        throw JSONRPCError(RPC_MISC_ERROR, "the allocator can not release its free memory");
+
+    Object dbCaches;
+    uint64_t dbCacheBytes = 0;
+    uint64_t blockIndexBytes;
+    {
+        LOCK(cs_main);
+        for (const auto &item : pCdMan->GetCacheSizes()) {
+            dbCaches.push_back(Pair(item.first, (uint64_t)item.second));
+            dbCacheBytes += item.second;
+        }
+        // the entries and the hash map nodes of mapBlockIndex
+        blockIndexBytes = mapBlockIndex.size() * (sizeof(CBlockIndex) + sizeof(uint256) + 2 * sizeof(void *));
+    }
+    dbCaches.push_back(Pair("total", dbCacheBytes));
+
+    Object subsystems;
+    subsystems.push_back(Pair("db_caches",      dbCaches));
+    subsystems.push_back(Pair("mempool",        mempool.GetUsageSize()));
+    subsystems.push_back(Pair("block_index",    blockIndexBytes));
+    subsystems.push_back(Pair("rpc_cache",      rpcResultCache.GetStats().bytes));
+    subsystems.push_back(Pair("sig_cache",      (uint64_t)signatureCache.GetStats().bytes));
+    subsystems.push_back(Pair("wasm_memories",  (uint64_t)wasm::wasm_allocator_pool::mapped_count()));
+
+    Object allocatorStats;
+    for (const auto &stat : GetAllocatorStats())
+        allocatorStats.push_back(Pair(stat.first, stat.second));
+
+    Object obj;
+    obj.push_back(Pair("allocator",         GetAllocatorName()));
+    obj.push_back(Pair("huge_pages",        IsHugePagesEnabled()));
+    obj.push_back(Pair("resident_bytes",    GetResidentBytes()));
+    obj.push_back(Pair("allocator_stats",   allocatorStats));
+    obj.push_back(Pair("subsystems",        subsystems));
+    return obj;
+}
+
 Value verifymessage(const Array& params, bool fHelp) {
     if (fHelp || params.size() != 3)
         throw runtime_error(
@@ -217,6 +443,9 @@ Value verifymessage(const Array& params, bool fHelp) {
     DEFINE( FLAG,                 pBlockCache, flagCache) \
     DEFINE( BEST_BLOCKHASH,       pBlockCache, bestBlockHashCache) \
     DEFINE( TXID_DISKINDEX,       pBlockCache, txDiskPosCache) \
+    DEFINE( KEYID_TXID,           pBlockCache, keyIdTxidCache) \
+    DEFINE( BLOCK_FILTER,         pBlockCache, blockFilterCache) \
+    DEFINE( MEDIAN_PRICE_INDEX,   pBlockCache, medianPriceIndexCache) \
     /**** account db                                                                      */ \
     DEFINE( REGID_KEYID,          pAccountCache,  regId2KeyIdCache)\
     DEFINE( NICKID_KEYID,         pAccountCache,  nickId2KeyIdCache) \
@@ -225,7 +454,6 @@ Value verifymessage(const Array& params, bool fHelp) {
     DEFINE( CONTRACT_DEF,         pContractCache,  contractCache ) \
     DEFINE( CONTRACT_DATA,        pContractCache,  contractDataCache) \
     DEFINE( CONTRACT_ACCOUNT,     pContractCache,  contractAccountCache) \
-    DEFINE( CONTRACT_TRACES,      pContractCache,  contractTracesCache) \
     /**** delegate db                                                                      */ \
     DEFINE( VOTE,                 pDelegateCache,  voteRegIdCache) \
     DEFINE( LAST_VOTE_HEIGHT,     pDelegateCache,  last_vote_height_cache) \
@@ -253,16 +481,30 @@ Value verifymessage(const Array& params, bool fHelp) {
     DEFINE( TX_EXECUTE_FAIL,      pLogCache,  executeFailCache ) \
     /**** tx receipt db                                                                    */ \
     DEFINE( TX_RECEIPT,           pReceiptCache,   txReceiptCache ) \
+    DEFINE( TX_RECEIPT_HEIGHT,    pReceiptCache,   blockTxidsCache ) \
+    /**** trace db                                                                    */ \
+    DEFINE( CONTRACT_TRACES,      pTraceCache,     traceCache ) \
+    DEFINE( CONTRACT_TRACES_HEIGHT, pTraceCache,   blockTxidsCache ) \
+    DEFINE( CONTRACT_TRACES_SIZE, pTraceCache,     sizeCache ) \
     /**** tx coinutxo db                                                                    */ \
     DEFINE( TX_UTXO,              pUtxoCache,   txUtxoCache)
 
 
-template<int32_t PREFIX_TYPE, typename KeyType, typename ValueType>
-string DbCacheToString(CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> &cache) {
+template<int32_t PREFIX_TYPE, typename KeyType, typename ValueType, typename MapPolicy>
+string DbCacheToString(CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType, MapPolicy> &cache) {
     string str;
-    CDBIterator< CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> > it(cache);
-    for(it.First(); it.IsValid(); it.Next()) {
-        str += strprintf("%s={%s},\n", db_util::ToString(it.GetKey()), db_util::ToString(it.GetValue()));
+    if constexpr (MapPolicy::IS_ORDERED) {
+        CDBIterator< CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType, MapPolicy> > it(cache);
+        for(it.First(); it.IsValid(); it.Next()) {
+            str += strprintf("%s={%s},\n", db_util::ToString(it.GetKey()), db_util::ToString(it.GetValue()));
+        }
+    } else {
+        // hash caches can not be iterated in key order, collect and sort all elements instead
+        map<KeyType, ValueType> elements;
+        cache.GetAllElements(elements);
+        for (const auto &item : elements) {
+            str += strprintf("%s={%s},\n", db_util::ToString(item.first), db_util::ToString(item.second));
+        }
     }
     return strprintf("-->%s, data={%s}\n", GetKeyPrefix(cache.PREFIX_TYPE), str);
 }
@@ -276,13 +518,30 @@ string DbCacheToString(CSimpleKVCache<PREFIX_TYPE, ValueType> &cache) {
     return "";
 }
 
+// the db caches of the dumped dbs, created over the flushed snapshots instead of the caches of the connected blocks
+struct CSnapshotDbCaches {
+    std::unique_ptr<CSysParamDBCache> pSysParamCache{new CSysParamDBCache(pCdMan->pSysParamDb)};
+    std::unique_ptr<CAssetDBCache> pAssetCache{new CAssetDBCache(pCdMan->pAssetDb)};
+    std::unique_ptr<CBlockDBCache> pBlockCache{new CBlockDBCache(pCdMan->pBlockDb)};
+    std::unique_ptr<CAccountDBCache> pAccountCache{new CAccountDBCache(pCdMan->pAccountDb)};
+    std::unique_ptr<CContractDBCache> pContractCache{new CContractDBCache(pCdMan->pContractDb)};
+    std::unique_ptr<CDelegateDBCache> pDelegateCache{new CDelegateDBCache(pCdMan->pDelegateDb)};
+    std::unique_ptr<CCdpDBCache> pCdpCache{new CCdpDBCache(pCdMan->pCdpDb)};
+    std::unique_ptr<CClosedCdpDBCache> pClosedCdpCache{new CClosedCdpDBCache(pCdMan->pClosedCdpDb)};
+    std::unique_ptr<CDexDBCache> pDexCache{new CDexDBCache(pCdMan->pDexDb)};
+    std::unique_ptr<CLogDBCache> pLogCache{new CLogDBCache(pCdMan->pLogDb)};
+    std::unique_ptr<CTxReceiptDBCache> pReceiptCache{new CTxReceiptDBCache(pCdMan->pReceiptDb)};
+    std::unique_ptr<CTraceDBCache> pTraceCache{new CTraceDBCache(pCdMan->pTraceDb)};
+    std::unique_ptr<CTxUTXODBCache> pUtxoCache{new CTxUTXODBCache(pCdMan->pUtxoDb)};
+};
+
 #define DUMP_DB_ONE(prefixType, db, cache) \
-    case dbk::prefixType: { str = DbCacheToString(pCdMan->db->cache); break;}
+    case dbk::prefixType: { str = DbCacheToString(caches.db->cache); break;}
 #define DUMP_DB_ALL(prefixType, db, cache) \
-    str = DbCacheToString(pCdMan->db->cache) + "\n"; \
+    str = DbCacheToString(caches.db->cache) + "\n"; \
     fwrite(str.data(), 1, str.size(), f);
 
-static void DumpDbOne(FILE *f, dbk::PrefixType prefixType, const string &prefixTypeStr) {
+static void DumpDbOne(CSnapshotDbCaches &caches, FILE *f, dbk::PrefixType prefixType, const string &prefixTypeStr) {
     string str = "";
     switch (prefixType) {
         DBK_PREFIX_CACHE_LIST(DUMP_DB_ONE);
@@ -294,7 +553,7 @@ static void DumpDbOne(FILE *f, dbk::PrefixType prefixType, const string &prefixT
     fwrite(str.data(), 1, str.size(), f);
 }
 
-static void DumpDbAll(FILE *f) {
+static void DumpDbAll(CSnapshotDbCaches &caches, FILE *f) {
     string str = "";
     DBK_PREFIX_CACHE_LIST(DUMP_DB_ALL);
 }
@@ -304,7 +563,7 @@ Value dumpdb(const Array& params, bool fHelp) {
     if (fHelp || params.size() > 2)
         throw runtime_error(
             "dumpdb \"[key_prefix_type]\" \"[file_path]\"\n"
-            "\ndump db data to file\n"
+            "\ndump db data to file, as of the last flush of the caches\n"
             "\nArguments:\n"
             "1. \"key_prefix_type\"   (string, optional) the data key prefix type, * is all data, default is *\n"
             "2. \"file_path\"       (string, optional) the output file path, if empty output to stdout, default is empty.\n"
@@ -343,15 +602,68 @@ Value dumpdb(const Array& params, bool fHelp) {
         file = stdout;
     }
 
+    // read the state of the last flush, the blocks are connected meanwhile
+    auto pSnapshots = pCdMan->GetFlushedSnapshots();
+    CDBAccess::CSnapshotScope snapshotScope(pSnapshots.get());
+    CSnapshotDbCaches caches;
     if (!prefixTypeStr.empty() && prefixTypeStr != "*") {
         dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(prefixTypeStr);
         if (prefixType == dbk::EMPTY)
             throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("unsupported db data key prefix type=%s",
                 prefixTypeStr));
-        DumpDbOne(file, prefixType, prefixTypeStr);
+        DumpDbOne(caches, file, prefixType, prefixTypeStr);
     } else {
-        DumpDbAll(file);
+        DumpDbAll(caches, file);
     }
 
     return Object();
 }
+
+Value dumpstate(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumpstate \"file_path\"\n"
+            "\ndump the chain state at the global finalized block to a file, which a new node imports with -loadstate\n"
+            "\nArguments:\n"
+            "1. \"file_path\"       (string, required) the output file path\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"height\": n,          (numeric) the height of the finalized block of the state\n"
+            "  \"block_hash\": \"hash\", (string) the hash of the finalized block\n"
+            "  \"tip_height\": n,      (numeric) the height of the tip, whose blocks above were undone\n"
+            "  \"commitment\": \"hash\", (string) the hash of the sections, the same on any node at the block\n"
+            "  \"keys\": n,            (numeric) the number of the keys\n"
+            "  \"sections\": [...]     (array) the name, keys, bytes and hash of each section\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumpstate", "\"/tmp/state.dat\"") + "\nAs json rpc\n"
+            + HelpExampleRpc("dumpstate", "\"/tmp/state.dat\"")
+        );
+
+    string filePath = params[0].get_str();
+    if (filePath.empty())
+        throw JSONRPCError(RPC_INVALID_PARAMS, "empty file path");
+
+    CStateDumpInfo info;
+    if (!CStateDump(filePath).Write(info))
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf("dump the state to file %s failed", filePath));
+
+    Array sections;
+    for (const auto &section : info.sections) {
+        Object obj;
+        obj.push_back(Pair("name",  section.name));
+        obj.push_back(Pair("keys",  section.keyCount));
+        obj.push_back(Pair("bytes", section.size));
+        obj.push_back(Pair("hash",  section.hash.GetHex()));
+        sections.push_back(obj);
+    }
+
+    Object obj;
+    obj.push_back(Pair("height",     info.height));
+    obj.push_back(Pair("block_hash", info.blockHash.GetHex()));
+    obj.push_back(Pair("tip_height", info.tipHeight));
+    obj.push_back(Pair("commitment", info.commitment.GetHex()));
+    obj.push_back(Pair("keys",       info.GetKeyCount()));
+    obj.push_back(Pair("sections",   sections));
+    return obj;
+}
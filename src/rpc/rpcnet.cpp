@@ -90,9 +90,21 @@ Value getpeerinfo(const Array& params, bool fHelp) {
             "    \"version\": v,              (numeric) The peer version, such as 7001\n"
             "    \"subver\": \"/Satoshi:0.8.5/\",  (string) The string version\n"
             "    \"inbound\": true|false,     (boolean) Inbound (true) or Outbound (false)\n"
+            "    \"priority\": true|false,    (boolean) A -prioritypeer, its blocks are pushed at once\n"
             "    \"startingheight\": n,       (numeric) The starting height (block) of the peer\n"
             "    \"banscore\": n,             (numeric) The ban score (stats.nMisbehavior)\n"
             "    \"syncnode\" : true|false    (boolean) if sync node\n"
+            "    \"invsent\": n,              (numeric) The invs announced to the peer\n"
+            "    \"txinvbatches\": n,         (numeric) The batches of tx invs announced to the peer\n"
+            "    \"txinvshaped\": n,          (numeric) The tx invs held back to a later batch by the rate limit or a full send buffer\n"
+            "    \"txinvqueued\": n,          (numeric) The tx invs waiting for the next batch\n"
+            "    \"sendcompressed\": true|false, (boolean) Whether the peer accepts compressed messages\n"
+            "    \"compressedsent\": n,       (numeric) The messages sent compressed to the peer\n"
+            "    \"compressedsentbytes\": n,  (numeric) The payload bytes of them on the wire\n"
+            "    \"compressedsentraw\": n,    (numeric) The payload bytes of them before the compression\n"
+            "    \"compressedrecv\": n,       (numeric) The compressed messages received from the peer\n"
+            "    \"compressedrecvbytes\": n,  (numeric) The payload bytes of them on the wire\n"
+            "    \"compressedrecvraw\": n,    (numeric) The payload bytes of them after the uncompression\n"
             "  }\n"
             "  ,...\n"
             "}\n"
@@ -132,6 +144,7 @@ Value getpeerinfo(const Array& params, bool fHelp) {
         // their ver message.
         obj.push_back(Pair("subver",        stats.cleanSubVer));
         obj.push_back(Pair("inbound",       stats.fInbound));
+        obj.push_back(Pair("priority",      stats.fPriority));
         obj.push_back(Pair("startingheight",stats.nStartingHeight));
 
         if (fStateStats) {
@@ -139,6 +152,17 @@ Value getpeerinfo(const Array& params, bool fHelp) {
         }
 
         obj.push_back(Pair("syncnode",      stats.fSyncNode));
+        obj.push_back(Pair("invsent",       stats.nInvSent));
+        obj.push_back(Pair("txinvbatches",  stats.nTxInvBatches));
+        obj.push_back(Pair("txinvshaped",   stats.nTxInvShaped));
+        obj.push_back(Pair("txinvqueued",   stats.nTxInvQueued));
+        obj.push_back(Pair("sendcompressed",        stats.fSendCompressed));
+        obj.push_back(Pair("compressedsent",        stats.compressSent.messages));
+        obj.push_back(Pair("compressedsentbytes",   stats.compressSent.wireBytes));
+        obj.push_back(Pair("compressedsentraw",     stats.compressSent.rawBytes));
+        obj.push_back(Pair("compressedrecv",        stats.compressRecv.messages));
+        obj.push_back(Pair("compressedrecvbytes",   stats.compressRecv.wireBytes));
+        obj.push_back(Pair("compressedrecvraw",     stats.compressRecv.rawBytes));
 
         ret.push_back(obj);
     }
@@ -311,6 +335,18 @@ Value getnettotals(const Array& params, bool fHelp) {
             "  \"totalbytesrecv\": n,   (numeric) Total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) Total bytes sent\n"
             "  \"timemillis\": t        (numeric) Total cpu time\n"
+            "  \"compression\": {       (json object) The block, tx and headers messages exchanged compressed\n"
+            "    \"sent\": n,             (numeric) The messages sent compressed\n"
+            "    \"sentrawbytes\": n,     (numeric) Their payload bytes before the compression\n"
+            "    \"sentwirebytes\": n,    (numeric) Their payload bytes after the compression\n"
+            "    \"sentratio\": x.xx,     (numeric) The wire bytes over the raw bytes sent\n"
+            "    \"compressusec\": n,     (numeric) The cpu microseconds of the compression\n"
+            "    \"recv\": n,             (numeric) The compressed messages received\n"
+            "    \"recvrawbytes\": n,     (numeric) Their payload bytes after the uncompression\n"
+            "    \"recvwirebytes\": n,    (numeric) Their payload bytes received\n"
+            "    \"recvratio\": x.xx,     (numeric) The wire bytes over the raw bytes received\n"
+            "    \"uncompressusec\": n    (numeric) The cpu microseconds of the uncompression\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getnettotals", "") + "\nAs json rpc\n" + HelpExampleRpc("getnettotals", ""));
@@ -319,6 +355,21 @@ Value getnettotals(const Array& params, bool fHelp) {
     obj.push_back(Pair("totalbytesrecv",    CNode::GetTotalBytesRecv()));
     obj.push_back(Pair("totalbytessent",    CNode::GetTotalBytesSent()));
     obj.push_back(Pair("timemillis",        GetTimeMillis()));
+
+    CNetCompressStats sent, received;
+    GetNetCompressTotals(sent, received);
+    Object compression;
+    compression.push_back(Pair("sent",           sent.messages));
+    compression.push_back(Pair("sentrawbytes",   sent.rawBytes));
+    compression.push_back(Pair("sentwirebytes",  sent.wireBytes));
+    compression.push_back(Pair("sentratio",      sent.rawBytes > 0 ? (double)sent.wireBytes / sent.rawBytes : 1.0));
+    compression.push_back(Pair("compressusec",   sent.micros));
+    compression.push_back(Pair("recv",           received.messages));
+    compression.push_back(Pair("recvrawbytes",   received.rawBytes));
+    compression.push_back(Pair("recvwirebytes",  received.wireBytes));
+    compression.push_back(Pair("recvratio",      received.rawBytes > 0 ? (double)received.wireBytes / received.rawBytes : 1.0));
+    compression.push_back(Pair("uncompressusec", received.micros));
+    obj.push_back(Pair("compression", compression));
     return obj;
 }
 
@@ -409,7 +460,6 @@ Value getchaininfo(const Array& params, bool fHelp) {
 
     CBlockIndex* pBlockIndex = chainActive[height];
     Array array;
-    CBlock block;
 
     for (int32_t i = 0; (i < count) && (pBlockIndex != nullptr); i++) {
         Object object;
@@ -419,9 +469,11 @@ Value getchaininfo(const Array& params, bool fHelp) {
         object.push_back(Pair("fuel",       (int64_t)pBlockIndex->nFuel));
         object.push_back(Pair("fuel_rate",  (int32_t)pBlockIndex->nFuelRate));
 
-        block.SetNull();
-        if (ReadBlockFromDisk(pBlockIndex, block)) {
-            object.push_back(Pair("miner",  block.vptx[0]->txUid.ToString()));
+        // only the reward tx is decoded
+        CBlockView blockView;
+        std::shared_ptr<CBaseTx> pRewardTx;
+        if (ReadBlockViewFromDisk(pBlockIndex, blockView) && (pRewardTx = blockView.GetTx(0))) {
+            object.push_back(Pair("miner",  pRewardTx->txUid.ToString()));
         }
 
         array.push_back(object);
@@ -314,13 +314,18 @@ Object GetCdpInfoJson(const CCdpCoinPair &cdpCoinPair, PriceMap &medianPricePoin
 
     bool global_collateral_ceiling_reached = cdpGlobalData.total_staked_assets >= globalCollateralCeiling * COIN;
 
-    CdpRatioSortedCache::Map forceLiquidateCdps;
     uint64_t forceLiquidateRatio = 0;
     if (!pCdMan->pSysParamCache->GetCdpParam(cdpCoinPair, CdpParamType::CDP_FORCE_LIQUIDATE_RATIO, forceLiquidateRatio)) {
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Acquire cdp force liquidate ratio error");
     }
 
-    pCdMan->pCdpCache->GetCdpListByCollateralRatio(cdpCoinPair, forceLiquidateRatio, assetPrice, forceLiquidateCdps);
+    uint64_t forceLiquidateCdpCount = 0;
+    {
+        LOCK(cs_main);
+        forceLiquidateCdpCount = pCdMan->pCdpCache->GetCdpCountByCollateralRatio(cdpCoinPair, forceLiquidateRatio, assetPrice);
+    }
+    // loaded by the count above
+    uint64_t cdpCount = pCdMan->pCdpCache->GetRatioBuckets()->GetTotal(cdpCoinPair).cdp_count;
 
     Object obj;
 
@@ -328,6 +333,7 @@ Object GetCdpInfoJson(const CCdpCoinPair &cdpCoinPair, PriceMap &medianPricePoin
     obj.push_back(Pair("scoin_symbol",                          cdpCoinPair.scoin_symbol));
     obj.push_back(Pair("global_staked_assets",                  cdpGlobalData.total_staked_assets));
     obj.push_back(Pair("global_owed_scoins",                    cdpGlobalData.total_owed_scoins));
+    obj.push_back(Pair("global_cdp_count",                      cdpCount));
     obj.push_back(Pair("global_collateral_ceiling",             globalCollateralCeiling * COIN));
     obj.push_back(Pair("global_collateral_ceiling_reached",     global_collateral_ceiling_reached));
 
@@ -337,7 +343,7 @@ Object GetCdpInfoJson(const CCdpCoinPair &cdpCoinPair, PriceMap &medianPricePoin
     obj.push_back(Pair("global_collateral_ratio_floor_reached", globalCollateralRatioFloorReached));
 
     obj.push_back(Pair("force_liquidate_ratio",                 strprintf("%.2f%%", (double)forceLiquidateRatio / RATIO_BOOST * 100)));
-    obj.push_back(Pair("force_liquidate_cdp_amount",            forceLiquidateCdps.size()));
+    obj.push_back(Pair("force_liquidate_cdp_amount",            forceLiquidateCdpCount));
     return obj;
 }
 
@@ -771,3 +777,67 @@ extern Value getcdpcoinpairs(const Array& params, bool fHelp) {
     obj.push_back(Pair("cdp_coin_pairs",    coinPairArray));
     return obj;
 }
+
+static Object CdpRatioBucketToJson(const CCdpRatioBucket &bucket) {
+    Object obj;
+    obj.push_back(Pair("cdp_count",             bucket.cdp_count));
+    obj.push_back(Pair("total_staked_assets",   bucket.total_staked_bcoins));
+    obj.push_back(Pair("total_owed_scoins",     bucket.total_owed_scoins));
+    return obj;
+}
+
+extern Value getcdpstats(const Array& params, bool fHelp) {
+     if (fHelp || params.size() > 1) {
+        throw runtime_error(
+            "getcdpstats [\"with_ratio_bands\"]\n"
+            "\nget the cdp count and debts of each cdp coin pair, from the in-memory ratio buckets.\n"
+            "\nArguments:\n"
+            "1.\"with_ratio_bands\":  (bool, optional) include the histogram of the collateral ratio bands,"
+            " default is false\n"
+            "\nResult: a list of cdp coin pair stats, the bands are ratio_width wide in staked assets per owed scoin,"
+            " collateral_ratio is the collateral ratio of ratio_from at the current median price\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcdpstats", "true")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("getcdpstats", "true")
+        );
+    }
+
+    bool withRatioBands = params.size() > 0 ? params[0].get_bool() : false;
+
+    auto spBuckets = pCdMan->pCdpCache->GetRatioBuckets();
+    if (!spBuckets->IsLoaded()) {
+        LOCK(cs_main);
+        spBuckets->LoadIfNeeded();
+    }
+
+    Array coinPairArray;
+    for (const auto &item : pCdMan->pCdpCache->GetCdpCoinPairMap()) {
+        const CCdpCoinPair &cdpCoinPair = item.first;
+        Object coinPairObj = CdpRatioBucketToJson(spBuckets->GetTotal(cdpCoinPair));
+        coinPairObj.insert(coinPairObj.begin(), Pair("scoin_symbol", cdpCoinPair.scoin_symbol));
+        coinPairObj.insert(coinPairObj.begin(), Pair("asset_symbol", cdpCoinPair.bcoin_symbol));
+
+        if (withRatioBands) {
+            uint64_t bcoinMedianPrice =
+                pCdMan->pBlockCache->GetMedianPrice(CoinPricePair(cdpCoinPair.bcoin_symbol, SYMB::USD));
+            Array bandArray;
+            for (const auto &bucketItem : spBuckets->GetBuckets(cdpCoinPair)) {
+                double ratioFrom = double(bucketItem.first * CDP_RATIO_BUCKET_WIDTH) / CDP_BASE_RATIO_BOOST;
+                Object bandObj = CdpRatioBucketToJson(bucketItem.second);
+                bandObj.insert(bandObj.begin(), Pair("collateral_ratio",
+                    strprintf("%.2f%%", ratioFrom * bcoinMedianPrice / PRICE_BOOST * 100)));
+                bandObj.insert(bandObj.begin(), Pair("ratio_from", ratioFrom));
+                bandArray.push_back(bandObj);
+            }
+            coinPairObj.push_back(Pair("ratio_width", double(CDP_RATIO_BUCKET_WIDTH) / CDP_BASE_RATIO_BOOST));
+            coinPairObj.push_back(Pair("ratio_bands", bandArray));
+        }
+        coinPairArray.push_back(coinPairObj);
+    }
+
+    Object obj;
+    obj.push_back(Pair("count",     coinPairArray.size()));
+    obj.push_back(Pair("cdp_stats", coinPairArray));
+    return obj;
+}
@@ -3,7 +3,11 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chain/parallelexecutor.h"
+#include "chain/txexecstats.h"
+#include "chain/txlatency.h"
 #include "commons/base58.h"
+#include "rpc/core/httpserver.h"
 #include "rpc/core/rpcserver.h"
 #include "rpc/core/rpccommons.h"
 #include "init.h"
@@ -13,6 +17,9 @@
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "persistence/blockdb.h"
+#include "persistence/blockundo.h"
+#include "persistence/statediff.h"
+#include "persistence/statesnapshot.h"
 #include "persistence/txdb.h"
 #include "config/configuration.h"
 #include "miner/miner.h"
@@ -25,6 +32,9 @@
 #include "tx/txserializer.h"
 #include "config/scoin.h"
 #include <boost/assign/list_of.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include "commons/json/json_spirit_utils.h"
 #include "commons/json/json_spirit_value.h"
 #include "commons/json/json_spirit_reader.h"
@@ -37,21 +47,82 @@ using namespace boost;
 using namespace boost::assign;
 using namespace json_spirit;
 
+static Object GetTxExecStatsJSON(const CTxExecStats &stats) {
+    Array dbs;
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; ++i) {
+        const auto &counts = stats.dbStats.counts[i];
+        if (counts.IsEmpty())
+            continue;
+
+        Object db;
+        db.push_back(Pair("db",         GetDbName((DBNameType)i)));
+        db.push_back(Pair("reads",      (int64_t)counts.reads));
+        db.push_back(Pair("writes",     (int64_t)counts.writes));
+        db.push_back(Pair("hits",       (int64_t)counts.hits));
+        db.push_back(Pair("misses",     (int64_t)counts.misses));
+        dbs.push_back(db);
+    }
+
+    Object obj;
+    obj.push_back(Pair("height",        stats.height));
+    obj.push_back(Pair("index",         stats.index));
+    obj.push_back(Pair("tx_type",       GetTxTypeName((TxType)stats.txType)));
+    obj.push_back(Pair("parallel",      stats.fParallel));
+    obj.push_back(Pair("wall_us",       stats.wallMicros));
+    obj.push_back(Pair("run_steps",     stats.runSteps));
+    obj.push_back(Pair("dbs",           dbs));
+    return obj;
+}
+
 Value gettxdetail(const Array& params, bool fHelp) {
-    if (fHelp || params.size() != 1)
+    if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
-            "gettxdetail \"txid\"\n"
+            "gettxdetail \"txid\" [verbose]\n"
             "\nget the transaction detail by given transaction hash.\n"
             "\nArguments:\n"
             "1.\"txid\":    (string, required) The hash of transaction.\n"
+            "2.\"verbose\": (boolean, optional) add the execution stats of the tx kept by -txstats, default is false\n"
             "\nResult an object of the transaction detail\n"
             "\nResult:\n"
             "\n\"txid\"\n"
+            "\nResult of verbose, in addition:\n"
+            "  \"exec_stats\": {        (object) the cost of the last execution of the tx in a block connected, if kept\n"
+            "    \"height\": n,         (numeric) the block height\n"
+            "    \"index\": n,          (numeric) the index of the tx in the block\n"
+            "    \"tx_type\": \"xxx\",    (string) the tx type\n"
+            "    \"parallel\": true|false, (boolean) executed by the parallel executor\n"
+            "    \"wall_us\": n,        (numeric) the time of the execution in microseconds\n"
+            "    \"run_steps\": n,      (numeric) the VM steps\n"
+            "    \"dbs\": [             (array) the accesses of the dbs touched\n"
+            "      {\"db\": \"xxx\", \"reads\": n, \"writes\": n, \"hits\": n, \"misses\": n}, ...\n"
+            "    ]\n"
+            "  }\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxdetail","\"c5287324b89793fdf7fa97b6203dfd814b8358cfa31114078ea5981916d7a8ac\"")
+            + HelpExampleCli("gettxdetail","\"c5287324b89793fdf7fa97b6203dfd814b8358cfa31114078ea5981916d7a8ac\" true")
             + "\nAs json rpc call\n"
             + HelpExampleRpc("gettxdetail","\"c5287324b89793fdf7fa97b6203dfd814b8358cfa31114078ea5981916d7a8ac\""));
-    return GetTxDetailJSON(uint256S(params[0].get_str()));
+
+    uint256 txid = uint256S(params[0].get_str());
+    Object obj   = GetTxDetailJSON(txid);
+    if (params.size() > 1 && params[1].get_bool()) {
+        CTxExecStats stats;
+        if (txExecStats.Get(txid, stats))
+            obj.push_back(Pair("exec_stats", GetTxExecStatsJSON(stats)));
+    }
+    return obj;
+}
+
+bool cachegettxdetail(const Array& params, CRPCCachedResult& result) {
+    if (params.size() != 1)
+        return false;
+
+    // the txs of the mempool have no confirmed height and are not stored
+    Object obj           = GetTxDetailJSON(uint256S(params[0].get_str()));
+    const Value& height  = find_value(obj, "confirmed_height");
+    result.height        = height.type() == int_type ? height.get_int() : -1;
+    result.WriteObject(obj, 0);
+    return true;
 }
 
 Value submitaccountregistertx(const Array& params, bool fHelp) {
@@ -673,6 +744,10 @@ Value listaddr(const Array& params, bool fHelp) {
         }
 
         for (const auto &keyid : setKeyId) {
+            // the keys not served yet by getnewaddr
+            if (pWalletMain->IsInKeyPool(keyid))
+                continue;
+
             CUserID userId(keyid);
             CAccount account;
             pCdMan->pAccountCache->GetAccount(userId, account);
@@ -686,7 +761,7 @@ Value listaddr(const Array& params, bool fHelp) {
             obj.push_back(Pair("received_votes",account.received_votes));
 
             Object tokenMapObj;
-            for (auto tokenPair : account.tokens) {
+            for (const auto &tokenPair : account.tokens) {
                 Object tokenObj;
                 const CAccountToken& token = tokenPair.second;
                 tokenObj.push_back(Pair("free_amount",      token.free_amount));
@@ -708,12 +783,13 @@ Value listaddr(const Array& params, bool fHelp) {
 }
 
 Value listtx(const Array& params, bool fHelp) {
-if (fHelp || params.size() > 2) {
+if (fHelp || params.size() > 3) {
         throw runtime_error("listtx\n"
                 "\nget all confirmed transactions and all unconfirmed transactions from wallet.\n"
                 "\nArguments:\n"
                 "1. count          (numeric, optional, default=10) The number of transactions to return\n"
                 "2. from           (numeric, optional, default=0) The number of transactions to skip\n"
+                "3. verbose        (bool, optional, default=false) Return the confirmed transactions read from the block files instead of their txids\n"
                 "\nResult:\n"
                 "\nExamples:\n"
                 "\nList the most recent 10 transactions in the system\n"
@@ -733,6 +809,7 @@ if (fHelp || params.size() > 2) {
     if (params.size() > 1) {
         nFrom = params[1].get_int();
     }
+    bool fVerbose = params.size() > 2 && params[2].get_bool();
     assert(pWalletMain != nullptr);
 
     Array confirmedTxArray;
@@ -745,7 +822,7 @@ if (fHelp || params.size() > 2) {
     }
     bool bUpLimited = false;
     for (auto const &blockInfo : blockInfoMap) {
-        CAccountTx accountTx = pWalletMain->mapInBlockTx[blockInfo.second];
+        const CAccountTx &accountTx = pWalletMain->mapInBlockTx[blockInfo.second];
         for (auto const & item : accountTx.mapAccountTx) {
             if (nFrom-- > 0)
                 continue;
@@ -753,7 +830,16 @@ if (fHelp || params.size() > 2) {
                 bUpLimited = true;
                 break;
             }
-            confirmedTxArray.push_back(item.first.GetHex());
+            // only the txs listed are read from the block files
+            std::shared_ptr<CBaseTx> pBaseTx;
+            if (fVerbose && accountTx.GetTx(item.first, pBaseTx)) {
+                Object obj = pBaseTx->ToJson(*pCdMan->pAccountCache);
+                obj.push_back(Pair("confirmed_height",  accountTx.blockHeight));
+                obj.push_back(Pair("block_hash",        accountTx.blockHash.GetHex()));
+                confirmedTxArray.push_back(obj);
+            } else {
+                confirmedTxArray.push_back(item.first.GetHex());
+            }
         }
         if (bUpLimited) {
             break;
@@ -771,6 +857,77 @@ if (fHelp || params.size() > 2) {
     return retObj;
 }
 
+Value getaddresstxids(const Array& params, bool fHelp) {
+    if (fHelp || params.size() < 1 || params.size() > 4) {
+        throw runtime_error(
+            "getaddresstxids \"addr\" [start_height] [start_index] [count]\n"
+            "\nget the confirmed txids of an address in the order of the chain, requires -addressindex\n"
+            "\nArguments:\n"
+            "1.\"addr\":         (string, required) account address or regid\n"
+            "2.\"start_height\": (numeric, optional) the height of the first tx, default is 0\n"
+            "3.\"start_index\":  (numeric, optional) the index in the block of the first tx, default is 0\n"
+            "4.\"count\":        (numeric, optional) the max number of txids, default is 100, max is 1000\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"address\": \"xxxxx\",       (string) the address\n"
+            "  \"txs\": [                  (array) the txs of the address\n"
+            "    {\n"
+            "      \"txid\": \"xxxxx\",      (string) the txid\n"
+            "      \"height\": n,          (numeric) the height of the block\n"
+            "      \"index\": n            (numeric) the index of the tx in the block\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"next_height\": n,         (numeric) the start_height of the next page, absent on the last page\n"
+            "  \"next_index\": n           (numeric) the start_index of the next page, absent on the last page\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getaddresstxids", "\"WT52jPi8DhHUC85MPYK8y8Ajs8J7CshgaB\" 0 0 100") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("getaddresstxids", "\"WT52jPi8DhHUC85MPYK8y8Ajs8J7CshgaB\", 0, 0, 100"));
+    }
+
+    if (!SysCfg().IsAddressIndex())
+        throw JSONRPCError(RPC_MISC_ERROR, "The address index is disabled, restart with -addressindex -reindex");
+
+    RPCTypeCheck(params, list_of(str_type)(int_type)(int_type)(int_type));
+    int32_t startHeight = params.size() > 1 ? params[1].get_int() : 0;
+    int32_t startIndex  = params.size() > 2 ? params[2].get_int() : 0;
+    int32_t count       = params.size() > 3 ? params[3].get_int() : 100;
+    if (startHeight < 0 || startIndex < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "start_height and start_index must be >= 0");
+    if (count <= 0 || count > MAX_ADDRESS_TXIDS_COUNT)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be in range [1, %d]", MAX_ADDRESS_TXIDS_COUNT));
+
+    CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
+    auto pUserId = CUserID::ParseUserId(params[0].get_str(), view.cw.accountCache);
+    CKeyID keyid;
+    if (!pUserId || !view.cw.accountCache.GetKeyId(*pUserId, keyid))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+    Array txs;
+    Object obj;
+    obj.push_back(Pair("address", keyid.ToAddress()));
+
+    auto baseLock = view.LockBase();
+    auto pTxidIt  = view.cw.blockCache.CreateAddressTxidIterator(keyid);
+    for (pTxidIt->Seek(startHeight, startIndex); pTxidIt->IsValid(); pTxidIt->Next()) {
+        if ((int32_t)txs.size() == count) {
+            obj.push_back(Pair("txs",         txs));
+            obj.push_back(Pair("next_height", (int64_t)pTxidIt->GetHeight()));
+            obj.push_back(Pair("next_index",  (int64_t)pTxidIt->GetIndex()));
+            return obj;
+        }
+
+        Object tx;
+        tx.push_back(Pair("txid",   pTxidIt->GetValue().GetHex()));
+        tx.push_back(Pair("height", (int64_t)pTxidIt->GetHeight()));
+        tx.push_back(Pair("index",  (int64_t)pTxidIt->GetIndex()));
+        txs.push_back(tx);
+    }
+    obj.push_back(Pair("txs", txs));
+    return obj;
+}
+
 Value getaccountinfo(const Array& params, bool fHelp) {
     if (fHelp || params.size() != 1) {
         throw runtime_error(
@@ -802,16 +959,28 @@ Value getaccountinfo(const Array& params, bool fHelp) {
     }
 
     RPCTypeCheck(params, list_of(str_type));
-    CKeyID keyid = RPC_PARAM::GetKeyId(params[0]);
-    CUserID userId;
+    // no cs_main here, the regid of the address is resolved in the snapshot as well
+    CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
+    auto pUserId = CUserID::ParseUserId(params[0].get_str(), view.cw.accountCache);
+    if (!pUserId)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
 
-
-    userId = keyid;
+    CKeyID keyid;
+    if (pUserId->is<CKeyID>())
+        keyid = pUserId->get<CKeyID>();
+    else if (pUserId->is<CPubKey>())
+        keyid = pUserId->get<CPubKey>().GetKeyId();
+    else if (pUserId->is<CRegID>())
+        keyid = pUserId->get<CRegID>().GetKeyId(view.cw.accountCache);
+    if (keyid.IsEmpty())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+    CUserID userId = keyid;
     Object obj;
     bool found = false;
 
     CAccount account;
-    if (pCdMan->pAccountCache->GetAccount(userId, account)) {
+    if (view.cw.accountCache.GetAccount(userId, account)) {
         if (!account.owner_pubkey.IsValid()) {
             CPubKey pubKey;
             CPubKey minerPubKey;
@@ -824,7 +993,7 @@ Value getaccountinfo(const Array& params, bool fHelp) {
                 }
             }
         }
-        obj = account.ToJsonObj();
+        obj = account.ToJsonObj(view.cw.delegateCache, view.GetHeight());
         obj.push_back(Pair("position", "inblock"));
 
         found = true;
@@ -838,7 +1007,7 @@ Value getaccountinfo(const Array& params, bool fHelp) {
             if (minerPubKey != pubKey) {
                 account.miner_pubkey = minerPubKey;
             }
-            obj = account.ToJsonObj();
+            obj = account.ToJsonObj(view.cw.delegateCache, view.GetHeight());
             obj.push_back(Pair("position", "inwallet"));
 
             found = true;
@@ -848,10 +1017,11 @@ Value getaccountinfo(const Array& params, bool fHelp) {
     if (found) {
         // TODO: multi stable coin
         uint64_t bcoinMedianPrice =
-            pCdMan->pBlockCache->GetMedianPrice(CoinPricePair(SYMB::WICC, SYMB::USD));
+            view.cw.blockCache.GetMedianPrice(CoinPricePair(SYMB::WICC, SYMB::USD));
         Array cdps;
         vector<CUserCDP> userCdps;
-        if (pCdMan->pCdpCache->GetCDPList(account.regid, userCdps)) {
+        auto baseLock = view.LockBase();
+        if (view.cw.cdpCache.GetCDPList(account.regid, userCdps)) {
             for (auto& cdp : userCdps) {
                 cdps.push_back(cdp.ToJson(bcoinMedianPrice));
             }
@@ -863,6 +1033,170 @@ Value getaccountinfo(const Array& params, bool fHelp) {
     return obj;
 }
 
+static const uint32_t MAX_ACCOUNTS_INFO_BATCH = 1000;
+
+/**
+ * Resolve and read the accounts of getaccountsinfo in parallel on the HTTP workers, each on a read view of
+ * its own over the same state snapshot, so the results are of one height whichever worker reads them. The
+ * json of an account is built by the worker reading it.
+ */
+class CParallelAccountsInfo {
+public:
+    CParallelAccountsInfo(vector<string>&& addrsIn, bool fBalancesOnlyIn,
+                          const std::shared_ptr<CStateSnapshot>& spSnapshotIn)
+        : addrs(std::move(addrsIn)), fBalancesOnly(fBalancesOnlyIn), spSnapshot(spSnapshotIn), next(0),
+          results(addrs.size()), pending(addrs.size()) {}
+
+    void Run() {
+        std::unique_ptr<CStateSnapshot::CReadView> pView;
+        size_t index;
+        while ((index = next++) < addrs.size()) {
+            if (!pView)
+                pView.reset(new CStateSnapshot::CReadView(spSnapshot));
+            results[index] = GetAccountInfo(addrs[index], *pView);
+
+            std::lock_guard<std::mutex> lock(cs);
+            if (--pending == 0)
+                cond.notify_all();
+        }
+    }
+
+    vector<Object>& WaitResults() {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [this]() { return pending == 0; });
+        return results;
+    }
+
+    int32_t GetHeight() const { return spSnapshot->height; }
+
+private:
+    Object GetAccountInfo(const string& addr, CStateSnapshot::CReadView& view) const {
+        Object obj;
+        auto pUserId = CUserID::ParseUserId(addr, view.cw.accountCache);
+        CKeyID keyid;
+        if (!pUserId || !view.cw.accountCache.GetKeyId(*pUserId, keyid)) {
+            obj.push_back(Pair("addr",  addr));
+            obj.push_back(Pair("error", "Invalid address"));
+            return obj;
+        }
+
+        CAccount account;
+        if (!view.cw.accountCache.GetAccount(CUserID(keyid), account)) {
+            obj.push_back(Pair("addr",    addr));
+            obj.push_back(Pair("address", keyid.ToAddress()));
+            obj.push_back(Pair("error",   "Account not found"));
+            return obj;
+        }
+
+        if (fBalancesOnly) {
+            Object tokenMapObj;
+            for (const auto& tokenPair : account.tokens) {
+                Object tokenObj;
+                tokenObj.push_back(Pair("free_amount",   tokenPair.second.free_amount));
+                tokenObj.push_back(Pair("staked_amount", tokenPair.second.staked_amount));
+                tokenObj.push_back(Pair("frozen_amount", tokenPair.second.frozen_amount));
+                tokenObj.push_back(Pair("voted_amount",  tokenPair.second.voted_amount));
+                tokenMapObj.push_back(Pair(tokenPair.first, tokenObj));
+            }
+            obj.push_back(Pair("addr",    addr));
+            obj.push_back(Pair("address", keyid.ToAddress()));
+            obj.push_back(Pair("regid",   account.regid.ToString()));
+            obj.push_back(Pair("tokens",  tokenMapObj));
+            return obj;
+        }
+
+        obj = account.ToJsonObj(view.cw.delegateCache, view.GetHeight());
+        obj.insert(obj.begin(), Pair("addr", addr));
+
+        // TODO: multi stable coin
+        uint64_t bcoinMedianPrice = view.cw.blockCache.GetMedianPrice(CoinPricePair(SYMB::WICC, SYMB::USD));
+        Array cdps;
+        vector<CUserCDP> userCdps;
+        auto baseLock = view.LockBase();
+        if (view.cw.cdpCache.GetCDPList(account.regid, userCdps)) {
+            for (auto& cdp : userCdps)
+                cdps.push_back(cdp.ToJson(bcoinMedianPrice));
+        }
+        obj.push_back(Pair("cdp_list", cdps));
+        return obj;
+    }
+
+    const vector<string> addrs;
+    const bool fBalancesOnly;
+    std::shared_ptr<CStateSnapshot> spSnapshot;
+    std::atomic<size_t> next;
+    vector<Object> results;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    size_t pending;
+};
+
+Value getaccountsinfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() < 1 || params.size() > 2) {
+        throw runtime_error(
+            "getaccountsinfo [\"addr\",...] (\"fields\")\n"
+            "\nget the information of the accounts of a batch, read in parallel at the same height\n"
+            "\nArguments:\n"
+            "1.[\"addr\",...]:   (array of string, required) The addresses or regids, at most " +
+            std::to_string(MAX_ACCOUNTS_INFO_BATCH) + "\n"
+            "2.\"fields\":       (string, optional) \"all\" for the fields of getaccountinfo, \"balances\" for the\n"
+            "                   address, the regid and the tokens only, default is \"all\"\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"height\": n,            (numeric) the height the accounts are read at\n"
+            "  \"accounts\": [           (array) in the order of the addrs\n"
+            "    {\n"
+            "      \"addr\": \"xxx\",      (string) the addr as given\n"
+            "      \"error\": \"xxx\",     (string) the reason when the account can not be read\n"
+            "      ...                 the fields of getaccountinfo, without the wallet keys and the position\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getaccountsinfo", "'[\"WT52jPi8DhHUC85MPYK8y8Ajs8J7CshgaB\", \"0-1\"]' \"balances\"") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("getaccountsinfo", "[\"WT52jPi8DhHUC85MPYK8y8Ajs8J7CshgaB\", \"0-1\"], \"balances\""));
+    }
+
+    RPCTypeCheck(params, list_of(array_type)(str_type));
+    const Array& addrArray = params[0].get_array();
+    if (addrArray.empty() || addrArray.size() > MAX_ACCOUNTS_INFO_BATCH)
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           strprintf("The count of the addrs must be in [1, %u]", MAX_ACCOUNTS_INFO_BATCH));
+
+    vector<string> addrs;
+    addrs.reserve(addrArray.size());
+    for (const auto& addr : addrArray) {
+        if (addr.type() != str_type)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "The addrs must be strings");
+        addrs.push_back(addr.get_str());
+    }
+
+    string fields = params.size() > 1 ? params[1].get_str() : "all";
+    if (fields != "all" && fields != "balances")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "The fields must be \"all\" or \"balances\"");
+
+    // no cs_main here, the helpers outlive the call when they are still queued
+    auto spAccountsInfo = std::make_shared<CParallelAccountsInfo>(std::move(addrs), fields == "balances",
+                                                                  CStateSnapshot::GetCurrent());
+    size_t helperCount = std::min((size_t)addrArray.size(), GetHTTPWorkerCount()) - 1;
+    for (size_t enqueued = 0; enqueued < helperCount; ++enqueued) {
+        if (!EnqueueHTTPTask([spAccountsInfo]() { spAccountsInfo->Run(); }))
+            break;
+    }
+    spAccountsInfo->Run();
+
+    Array accounts;
+    for (Object& result : spAccountsInfo->WaitResults())
+        accounts.push_back(std::move(result));
+
+    Object obj;
+    obj.push_back(Pair("height",   spAccountsInfo->GetHeight()));
+    obj.push_back(Pair("accounts", accounts));
+    return obj;
+}
+
 static Value TestDisconnectBlock(int32_t number) {
     CBlock block;
     Object obj;
@@ -881,6 +1215,7 @@ static Value TestDisconnectBlock(int32_t number) {
                 return false;
             if (!pCdMan->pBlockIndexDb->EraseBlockIndex(pTipIndex->GetBlockHash()))
                 return false;
+            std::unique_lock<std::shared_mutex> chainIndexLock(cs_chainIndex);
             mapBlockIndex.erase(pTipIndex->GetBlockHash());
         } while (--number);
     }
@@ -1063,7 +1398,8 @@ Value getcontractdata(const Array& params, bool fHelp) {
         key = params[1].get_str();
     }
     string value;
-    if (!pCdMan->pContractCache->GetContractData(regId, key, value)) {
+    CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
+    if (!view.cw.contractCache.GetContractData(regId, key, value)) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Failed to acquire contract data");
     }
 
@@ -1145,6 +1481,7 @@ Value submittxraw(const Array& params, bool fHelp) {
 
     std::shared_ptr<CBaseTx> tx;
     stream >> tx;
+    txLatencyTracer.Stamp(tx->GetHash(), TX_STAGE_RPC_RECEIVED);
     std::tuple<bool, string> ret;
     ret = pWalletMain->CommitTx((CBaseTx *) tx.get());
     if (!std::get<0>(ret))
@@ -1155,6 +1492,376 @@ Value submittxraw(const Array& params, bool fHelp) {
     return obj;
 }
 
+static const uint32_t MAX_SUBMIT_TX_BATCH = 1000;
+
+// decode the hex of a raw tx of a batch, the error is set if it fails
+static bool DecodeBatchRawTx(const Value& rawTx, std::shared_ptr<CBaseTx>& pBaseTx, string& error) {
+    if (rawTx.type() != str_type) {
+        error = "The rawtx is not a string";
+        return false;
+    }
+    vector<uint8_t> vch(ParseHex(rawTx.get_str()));
+    if (vch.empty() || vch.size() > MAX_RPC_SIG_STR_LEN) {
+        error = "The rawtx is empty or too long";
+        return false;
+    }
+    try {
+        CDataStream stream(vch, SER_DISK, CLIENT_VERSION);
+        stream >> pBaseTx;
+    } catch (std::exception&) {
+        pBaseTx = nullptr;
+    }
+    if (!pBaseTx) {
+        error = "Decode the rawtx failed";
+        return false;
+    }
+    return true;
+}
+
+/** A raw tx of submittxrawbatch after the checks which need no chain lock */
+struct CTxPrecheck {
+    std::shared_ptr<CBaseTx> pBaseTx;
+    string error;
+};
+
+/**
+ * Decode and check the raw txs of a batch in parallel on the HTTP workers, as the read-only
+ * batch calls are run. The signatures are verified against the accounts of the state snapshot
+ * and remembered by signatureCache, so the mempool admission under cs_main finds them there.
+ * A signature whose pubkey is not known yet, e.g. of a tx registering its account, is left to
+ * the admission.
+ */
+class CParallelTxPrecheck {
+public:
+    // the raw txs are copied, the helpers still queued when the call returns outlive its params
+    CParallelTxPrecheck(const Array& rawTxsIn, const std::shared_ptr<CStateSnapshot>& spSnapshotIn)
+        : rawTxs(rawTxsIn), spSnapshot(spSnapshotIn), next(0), results(rawTxsIn.size()),
+          pending(rawTxsIn.size()) {}
+
+    void Run() {
+        // the helpers finding no tx left return before touching the snapshot
+        std::unique_ptr<CStateSnapshot::CReadView> pView;
+        size_t index;
+        while ((index = next++) < rawTxs.size()) {
+            if (!pView)
+                pView.reset(new CStateSnapshot::CReadView(spSnapshot));
+            Precheck(rawTxs[index], *pView, results[index]);
+
+            std::lock_guard<std::mutex> lock(cs);
+            if (--pending == 0)
+                cond.notify_all();
+        }
+    }
+
+    vector<CTxPrecheck>& WaitResults() {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [this]() { return pending == 0; });
+        return results;
+    }
+
+private:
+    static void Precheck(const Value& rawTx, CStateSnapshot::CReadView& view, CTxPrecheck& result) {
+        if (!DecodeBatchRawTx(rawTx, result.pBaseTx, result.error))
+            return;
+
+        CBaseTx* pBaseTx = result.pBaseTx.get();
+        string reason;
+        if (!IsStandardTx(pBaseTx, reason)) {
+            result.error = "non-standard tx: " + reason;
+            return;
+        }
+        if (pBaseTx->signature.empty() || pBaseTx->signature.size() >= MAX_SIGNATURE_SIZE)
+            return;
+
+        CPubKey pubKey;
+        if (pBaseTx->txUid.is<CPubKey>()) {
+            pubKey = pBaseTx->txUid.get<CPubKey>();
+        } else {
+            CAccount account;
+            if (!view.cw.accountCache.GetAccount(pBaseTx->txUid, account) || !account.HaveOwnerPubKey())
+                return;
+            pubKey = account.owner_pubkey;
+        }
+        if (!VerifySignature(pBaseTx->GetHash(), pBaseTx->signature, pubKey))
+            result.error = "bad-tx-signature";
+    }
+
+    const Array rawTxs;
+    std::shared_ptr<CStateSnapshot> spSnapshot;
+    std::atomic<size_t> next;
+    vector<CTxPrecheck> results;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    size_t pending;
+};
+
+// accept the tx to the mempool under cs_main and relay it, through the wallet if there is one
+static bool SubmitTx(CBaseTx* pBaseTx, string& message) {
+    txLatencyTracer.Stamp(pBaseTx->GetHash(), TX_STAGE_RPC_RECEIVED);
+    if (pWalletMain) {
+        std::tuple<bool, string> ret = pWalletMain->CommitTx(pBaseTx);
+        message = std::get<1>(ret);
+        return std::get<0>(ret);
+    }
+
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        if (!AcceptToMemoryPool(mempool, state, pBaseTx, true)) {
+            message = state.GetRejectReason();
+            return false;
+        }
+    }
+    RelayTransaction(pBaseTx, pBaseTx->GetHash());
+    message = pBaseTx->GetHash().GetHex();
+    return true;
+}
+
+Value submittxrawbatch(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1) {
+        throw runtime_error(
+            "submittxrawbatch [\"rawtx\",...]\n"
+            "\nsubmit raw transactions (hex format) in a batch, they are decoded and their signatures verified in\n"
+            "parallel before they are accepted to the mempool in order\n"
+            "\nArguments:\n"
+            "1.[\"rawtx\",...]:   (array of string, required) The raw transactions, at most " +
+            std::to_string(MAX_SUBMIT_TX_BATCH) + "\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"xxx\",      (string) the txid, absent when the rawtx can not be decoded\n"
+            "    \"error\": \"xxx\"      (string) the reason when the tx is rejected\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n" +
+            HelpExampleCli("submittxrawbatch", "'[\"0b01848908020001145e3550cfae2422dce90a778b09...\"]'") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("submittxrawbatch", "[\"0b01848908020001145e3550cfae2422dce90a778b09...\"]"));
+    }
+
+    RPCTypeCheck(params, list_of(array_type));
+    const Array& rawTxs = params[0].get_array();
+    if (rawTxs.empty() || rawTxs.size() > MAX_SUBMIT_TX_BATCH)
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           strprintf("The count of the rawtxs must be in [1, %u]", MAX_SUBMIT_TX_BATCH));
+
+    // no cs_main in the checks, the helpers outlive the call when they are still queued
+    auto spPrecheck = std::make_shared<CParallelTxPrecheck>(rawTxs, CStateSnapshot::GetCurrent());
+    size_t helperCount = std::min(rawTxs.size(), GetHTTPWorkerCount()) - 1;
+    for (size_t enqueued = 0; enqueued < helperCount; ++enqueued) {
+        if (!EnqueueHTTPTask([spPrecheck]() { spPrecheck->Run(); }))
+            break;
+    }
+    spPrecheck->Run();
+    vector<CTxPrecheck>& results = spPrecheck->WaitResults();
+
+    Array arr;
+    for (CTxPrecheck& result : results) {
+        Object obj;
+        if (result.pBaseTx)
+            obj.push_back(Pair("txid", result.pBaseTx->GetHash().GetHex()));
+
+        string message;
+        if (result.error.empty() && !SubmitTx(result.pBaseTx.get(), message))
+            result.error = message;
+        if (!result.error.empty())
+            obj.push_back(Pair("error", result.error));
+        arr.push_back(obj);
+    }
+    return arr;
+}
+
+static const uint32_t MAX_SIMULATE_TX_BATCH = 100;
+
+/** The outcome of a raw tx of simulatetx */
+struct CTxSimulation {
+    std::shared_ptr<CBaseTx> pBaseTx;
+    bool fExecuted = false;
+    string error;
+    uint64_t fuel = 0;
+    vector<CReceipt> receipts;
+    vector<CStateDiffEntry> diffs;
+    std::unique_ptr<CCacheWrapper> spCw;  // the writes of the tx, for the json of the receipts
+};
+
+/**
+ * Execute the raw txs of simulatetx each on a throwaway cache layer over the same state snapshot, in parallel
+ * on the HTTP workers as the txs of submittxrawbatch are checked. The txs run as the next block on the tip of
+ * the snapshot, those reading more than the db caches (VM contracts, prices, dex and cdp scans) take cs_main
+ * for their execution as the miner does and fail if the tip moved since the snapshot.
+ */
+class CParallelTxSimulator {
+public:
+    // the raw txs are copied, the helpers still queued when the call returns outlive its params
+    CParallelTxSimulator(const Array& rawTxsIn, bool fCheckSigIn, const std::shared_ptr<CStateSnapshot>& spSnapshotIn)
+        : rawTxs(rawTxsIn), fCheckSig(fCheckSigIn), spSnapshot(spSnapshotIn), next(0), results(rawTxsIn.size()),
+          pending(rawTxsIn.size()) {}
+
+    void Run() {
+        size_t index;
+        while ((index = next++) < rawTxs.size()) {
+            {
+                CStateSnapshot::CReadView view(spSnapshot);
+                Simulate(rawTxs[index], view, results[index]);
+            }
+
+            std::lock_guard<std::mutex> lock(cs);
+            if (--pending == 0)
+                cond.notify_all();
+        }
+    }
+
+    vector<CTxSimulation>& WaitResults() {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [this]() { return pending == 0; });
+        return results;
+    }
+
+private:
+    void Simulate(const Value& rawTx, CStateSnapshot::CReadView& view, CTxSimulation& result) {
+        if (!DecodeBatchRawTx(rawTx, result.pBaseTx, result.error))
+            return;
+
+        CBlockIndex* pTip = spSnapshot->pTip;
+        if (pTip == nullptr) {
+            result.error = "The chain has no tip";
+            return;
+        }
+
+        CBaseTx* pBaseTx       = result.pBaseTx.get();
+        int32_t height         = pTip->height + 1;
+        uint32_t fuelRate      = GetElementForBurn(pTip);
+        uint32_t blockTime     = pTip->GetBlockTime();
+        uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
+
+        // the layer is dropped with its writes, the memory-only price point cache included
+        result.spCw.reset(new CCacheWrapper(&view.cw));
+        CCacheWrapper& txCw = *result.spCw;
+        CBlockUndo txUndo;
+        {
+            CTxUndoOpLogger opLogger(txCw, pBaseTx->GetHash(), txUndo);
+            std::optional<CCriticalBlock> mainLock;
+            if (!CParallelTxExecutor::IsParallelizable(*pBaseTx)) {
+                mainLock.emplace(cs_main, "cs_main", __FILE__, __LINE__, false, LOCK_SITE(cs_main));
+                if (chainActive.Tip() != pTip) {
+                    result.error = "The tip changed during the simulation, retry";
+                    return;
+                }
+            }
+
+            CValidationState state;
+            CTxExecuteContext context(height, 1, fuelRate, blockTime, prevBlockTime, &txCw, &state);
+            context.skip_sig_check = !fCheckSig;
+            pBaseTx->nFuelRate     = fuelRate;
+            try {
+                result.fExecuted = pBaseTx->CheckTx(context) && pBaseTx->ExecuteTx(context);
+            } catch (std::exception& e) {
+                state.DoS(100, ERRORMSG("%s : %s", __func__, e.what()), REJECT_INVALID, e.what());
+            }
+            if (!result.fExecuted) {
+                result.error = state.GetRejectReason();
+                return;
+            }
+        }
+
+        result.fuel = pBaseTx->GetFuel(height, fuelRate);
+        txCw.txReceiptCache.GetTxReceipts(pBaseTx->GetHash(), result.receipts);
+        GetStateDiffEntries(txUndo, txCw, result.diffs);
+    }
+
+    const Array rawTxs;
+    bool fCheckSig;
+    std::shared_ptr<CStateSnapshot> spSnapshot;
+    std::atomic<size_t> next;
+    vector<CTxSimulation> results;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    size_t pending;
+};
+
+Value simulatetx(const Array& params, bool fHelp) {
+    if (fHelp || params.size() < 1 || params.size() > 2) {
+        throw runtime_error(
+            "simulatetx [\"rawtx\",...] [checksig]\n"
+            "\nexecute raw transactions (hex format) on the state of the tip as the txs of the next block without\n"
+            "changing the state, each of them on its own, e.g. to estimate their fuels\n"
+            "\nArguments:\n"
+            "1.[\"rawtx\",...]:   (array of string, required) The raw transactions, at most " +
+            std::to_string(MAX_SIMULATE_TX_BATCH) + "\n"
+            "2.\"checksig\":      (bool, optional) verify the signatures of the txs, default: true\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"xxx\",        (string) the txid, absent when the rawtx can not be decoded\n"
+            "    \"executed\": true|false, (bool) whether the tx would be executed\n"
+            "    \"error\": \"xxx\",       (string) the reason when it would be rejected\n"
+            "    \"run_step\": n,          (numeric) the run steps of the execution\n"
+            "    \"fuel\": n,              (numeric) the fuel of the run steps at the fuel rate\n"
+            "    \"fuel_rate\": n,         (numeric) the fuel rate of the next block\n"
+            "    \"receipts\": [...],      (array) the receipts, when the node generates them\n"
+            "    \"state_diffs\": [        (array) the db keys the tx would change\n"
+            "      {\"prefix\": \"xxx\", \"key\": \"hex\", \"old_value\": \"hex\", \"new_value\": \"hex\"}, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n" +
+            HelpExampleCli("simulatetx", "'[\"0b01848908020001145e3550cfae2422dce90a778b09...\"]' false") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("simulatetx", "[\"0b01848908020001145e3550cfae2422dce90a778b09...\"], false"));
+    }
+
+    RPCTypeCheck(params, list_of(array_type)(bool_type));
+    const Array& rawTxs = params[0].get_array();
+    if (rawTxs.empty() || rawTxs.size() > MAX_SIMULATE_TX_BATCH)
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           strprintf("The count of the rawtxs must be in [1, %u]", MAX_SIMULATE_TX_BATCH));
+    bool fCheckSig = params.size() > 1 ? params[1].get_bool() : true;
+
+    // no cs_main but for the VM txs, the helpers outlive the call when they are still queued
+    auto spSimulator = std::make_shared<CParallelTxSimulator>(rawTxs, fCheckSig, CStateSnapshot::GetCurrent());
+    size_t helperCount = std::min(rawTxs.size(), GetHTTPWorkerCount()) - 1;
+    for (size_t enqueued = 0; enqueued < helperCount; ++enqueued) {
+        if (!EnqueueHTTPTask([spSimulator]() { spSimulator->Run(); }))
+            break;
+    }
+    spSimulator->Run();
+    vector<CTxSimulation>& results = spSimulator->WaitResults();
+
+    Array arr;
+    for (CTxSimulation& result : results) {
+        Object obj;
+        if (result.pBaseTx)
+            obj.push_back(Pair("txid", result.pBaseTx->GetHash().GetHex()));
+        obj.push_back(Pair("executed", result.fExecuted));
+        if (!result.fExecuted) {
+            obj.push_back(Pair("error", result.error));
+            arr.push_back(obj);
+            continue;
+        }
+
+        obj.push_back(Pair("run_step",  (uint64_t)result.pBaseTx->nRunStep));
+        obj.push_back(Pair("fuel",      result.fuel));
+        obj.push_back(Pair("fuel_rate", (uint64_t)result.pBaseTx->nFuelRate));
+        if (SysCfg().IsGenReceipt())
+            obj.push_back(Pair("receipts", JSON::ToJson(result.spCw->accountCache, result.receipts)));
+
+        Array diffs;
+        for (const auto& entry : result.diffs) {
+            Object diff;
+            diff.push_back(Pair("prefix",    entry.prefix));
+            diff.push_back(Pair("key",       HexStr(entry.key)));
+            diff.push_back(Pair("old_value", HexStr(entry.oldValue)));
+            diff.push_back(Pair("new_value", HexStr(entry.newValue)));
+            diffs.push_back(diff);
+        }
+        obj.push_back(Pair("state_diffs", diffs));
+        arr.push_back(obj);
+    }
+    return arr;
+}
+
 class CTxMultiSigner {
 public:
     struct SigningItem {
@@ -1312,6 +2019,176 @@ Value signtxraw(const Array& params, bool fHelp) {
     return obj;
 }
 
+static const uint32_t MAX_SIGN_TX_BATCH = 1000;
+
+/** A raw tx of signtxrawbatch with the signatures it needs from the wallet keys */
+struct CTxSigning {
+    std::shared_ptr<CBaseTx> pBaseTx;
+    vector<std::pair<CKeyID, UnsignedCharArray*>> signingList;
+    string error;
+};
+
+/**
+ * Sign the txs of a batch in parallel on the HTTP workers with the wallet keys decrypted once for
+ * the batch. The signing context of secp256k1 is only read by the signatures, so the workers share it.
+ */
+class CParallelTxSigner {
+public:
+    // the job owns the txs and the keys, the helpers still queued when the call returns find no tx left
+    CParallelTxSigner(vector<CTxSigning>&& txsIn, map<CKeyID, CKey>&& keysIn)
+        : txs(std::move(txsIn)), keys(std::move(keysIn)), next(0), pending(txs.size()) {}
+
+    void Run() {
+        size_t index;
+        while ((index = next++) < txs.size()) {
+            Sign(txs[index]);
+
+            std::lock_guard<std::mutex> lock(cs);
+            if (--pending == 0)
+                cond.notify_all();
+        }
+    }
+
+    // the signed txs, the keys are dropped once all are signed
+    vector<CTxSigning>& WaitResults() {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [this]() { return pending == 0; });
+        keys.clear();
+        return txs;
+    }
+
+private:
+    void Sign(CTxSigning& tx) {
+        if (!tx.error.empty())
+            return;
+
+        const uint256& txHash = tx.pBaseTx->GetHash();
+        for (auto& item : tx.signingList) {
+            if (!keys.at(item.first).Sign(txHash, *item.second)) {
+                tx.error = strprintf("Sign failed! addr=%s", item.first.ToAddress());
+                return;
+            }
+        }
+    }
+
+    vector<CTxSigning> txs;
+    map<CKeyID, CKey> keys;
+    std::atomic<size_t> next;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    size_t pending;
+};
+
+// the signatures of the tx which the wallet keys can give, the keyids of the regids are read on the view
+static void GetWalletSigningList(CStateSnapshot::CReadView& view, CTxSigning& tx) {
+    CBaseTx* pBaseTx = tx.pBaseTx.get();
+    vector<std::pair<CUserID, UnsignedCharArray*>> signers;
+    switch (pBaseTx->nTxType) {
+        case BLOCK_REWARD_TX:
+        case UCOIN_REWARD_TX:
+        case UCOIN_BLOCK_REWARD_TX:
+        case PRICE_MEDIAN_TX:
+            tx.error = "Reward transation is forbidden";
+            return;
+        case UCOIN_TRANSFER_MTX: {
+            CMulsigTx* pTx = dynamic_cast<CMulsigTx*>(pBaseTx);
+            for (auto& item : pTx->signaturePairs)
+                signers.emplace_back(CUserID(item.regid), &item.signature);
+            break;
+        }
+        case DEX_OPERATOR_ORDER_TX: {
+            dex::CDEXOperatorOrderTx* pTx = dynamic_cast<dex::CDEXOperatorOrderTx*>(pBaseTx);
+            signers.emplace_back(pTx->txUid, &pTx->signature);
+            signers.emplace_back(pTx->operator_uid, &pTx->operator_signature);
+            break;
+        }
+        default:
+            signers.emplace_back(pBaseTx->txUid, &pBaseTx->signature);
+    }
+
+    for (auto& signer : signers) {
+        CKeyID keyId;
+        if (view.cw.accountCache.GetKeyId(signer.first, keyId) && pWalletMain->HaveKey(keyId))
+            tx.signingList.emplace_back(keyId, signer.second);
+    }
+    if (tx.signingList.empty())
+        tx.error = "No signer of the tx in the wallet";
+}
+
+Value signtxrawbatch(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1) {
+        throw runtime_error(
+            "signtxrawbatch [\"rawtx\",...]\n"
+            "\nsign raw transactions (hex format) in a batch with the wallet keys, each tx is signed by all of\n"
+            "its signers whose keys are in the wallet, the txs are signed in parallel\n"
+            "\nArguments:\n"
+            "1.[\"rawtx\",...]:   (array of string, required) The unsigned raw transactions, at most " +
+            std::to_string(MAX_SIGN_TX_BATCH) + "\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"xxx\",      (string) the txid, absent when the rawtx can not be decoded\n"
+            "    \"rawtx\": \"xxx\",     (string) the signed raw transaction\n"
+            "    \"error\": \"xxx\"      (string) the reason when the tx is not signed\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n" +
+            HelpExampleCli("signtxrawbatch", "'[\"0701ed7f0300030000010000020002000bcd10858c200200\"]'") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("signtxrawbatch", "[\"0701ed7f0300030000010000020002000bcd10858c200200\"]"));
+    }
+
+    RPCTypeCheck(params, list_of(array_type));
+    const Array& rawTxs = params[0].get_array();
+    if (rawTxs.empty() || rawTxs.size() > MAX_SIGN_TX_BATCH)
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           strprintf("The count of the rawtxs must be in [1, %u]", MAX_SIGN_TX_BATCH));
+    EnsureWalletIsUnlocked();
+
+    vector<CTxSigning> txs(rawTxs.size());
+    set<CKeyID> keyIds;
+    {
+        CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
+        for (size_t i = 0; i < rawTxs.size(); ++i) {
+            if (!DecodeBatchRawTx(rawTxs[i], txs[i].pBaseTx, txs[i].error))
+                continue;
+
+            GetWalletSigningList(view, txs[i]);
+            for (const auto& item : txs[i].signingList)
+                keyIds.insert(item.first);
+        }
+    }
+
+    map<CKeyID, CKey> keys;
+    if (!pWalletMain->GetKeys(keyIds, keys))
+        throw JSONRPCError(RPC_WALLET_ERROR, "Get the keys of the signers failed");
+
+    size_t helperCount = std::min(txs.size(), GetHTTPWorkerCount()) - 1;
+    auto spSigner = std::make_shared<CParallelTxSigner>(std::move(txs), std::move(keys));
+    for (size_t enqueued = 0; enqueued < helperCount; ++enqueued) {
+        if (!EnqueueHTTPTask([spSigner]() { spSigner->Run(); }))
+            break;
+    }
+    spSigner->Run();
+
+    Array arr;
+    for (const CTxSigning& tx : spSigner->WaitResults()) {
+        Object obj;
+        if (tx.pBaseTx)
+            obj.push_back(Pair("txid", tx.pBaseTx->GetHash().GetHex()));
+        if (tx.error.empty()) {
+            CDataStream ds(SER_DISK, CLIENT_VERSION);
+            ds << tx.pBaseTx;
+            obj.push_back(Pair("rawtx", HexStr(ds.begin(), ds.end())));
+        } else {
+            obj.push_back(Pair("error", tx.error));
+        }
+        arr.push_back(obj);
+    }
+    return arr;
+}
+
 Value decodemulsigscript(const Array& params, bool fHelp) {
     if (fHelp || params.size() != 1)
         throw runtime_error(
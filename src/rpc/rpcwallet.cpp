@@ -17,6 +17,7 @@
 #include "vm/luavm/appaccount.h"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
+#include "wallet/walletkeypool.h"
 #include "tx/mulsigtx.h"
 
 #include <stdint.h>
@@ -31,6 +32,9 @@ using namespace json_spirit;
 int64_t nWalletUnlockTime;
 static CCriticalSection cs_nWalletUnlockTime;
 
+// the addresses of a getnewaddrs call at most
+static const int64_t MAX_NEW_ADDRS = 10000;
+
 
 string HelpRequiringPassphrase() {
     return pWalletMain && pWalletMain->IsEncrypted()
@@ -39,6 +43,8 @@ string HelpRequiringPassphrase() {
 }
 
 void EnsureWalletIsUnlocked() {
+    if (!pWalletMain)
+        throw JSONRPCError(RPC_WALLET_ERROR, "The wallet is disabled");
     if (pWalletMain->IsLocked())
         throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Please enter the wallet passphrase with walletpassphrase first.");
 }
@@ -56,33 +62,38 @@ Value getnewaddr(const Array& params, bool fHelp) {
             HelpExampleCli("getnewaddr", "") + "\nAs json rpc\n" +
             HelpExampleRpc("getnewaddr", ""));
 
-    EnsureWalletIsUnlocked();
-
     bool isForMiner = false;
     if (params.size() == 1) {
         RPCTypeCheck(params, list_of(bool_type));
         isForMiner = params[0].get_bool();
     }
 
-    CKey userkey;
-    userkey.MakeNewKey();
-
-    CKey minerKey;
     string minerPubKey = "null";
-
-    if (isForMiner) {
-        minerKey.MakeNewKey();
-        if (!pWalletMain->AddKey(userkey, minerKey)) {
-            throw runtime_error("add miner key failed ");
+    CKeyID userKeyID;
+    vector<CKeyID> poolKeyIds;
+    // the user keys are served from the key pool, a locked wallet included
+    if (!isForMiner && pWalletMain->TakeKeysFromPool(1, poolKeyIds) == 1) {
+        userKeyID = poolKeyIds[0];
+        walletKeyPool.Notify();
+    } else {
+        EnsureWalletIsUnlocked();
+
+        CKey userkey;
+        userkey.MakeNewKey();
+
+        CKey minerKey;
+        if (isForMiner) {
+            minerKey.MakeNewKey();
+            if (!pWalletMain->AddKey(userkey, minerKey)) {
+                throw runtime_error("add miner key failed ");
+            }
+            minerPubKey = minerKey.GetPubKey().ToString();
+        } else if (!pWalletMain->AddKey(userkey)) {
+            throw runtime_error("add user key failed ");
         }
-        minerPubKey = minerKey.GetPubKey().ToString();
-    } else if (!pWalletMain->AddKey(userkey)) {
-        throw runtime_error("add user key failed ");
+        userKeyID = userkey.GetPubKey().GetKeyId();
     }
 
-    CPubKey userPubKey = userkey.GetPubKey();
-    CKeyID userKeyID   = userPubKey.GetKeyId();
-
     Object obj;
     obj.push_back(Pair("addr",          userKeyID.ToAddress()));
     obj.push_back(Pair("minerpubkey",   minerPubKey));  // "null" for non-miner address
@@ -90,6 +101,52 @@ Value getnewaddr(const Array& params, bool fHelp) {
     return obj;
 }
 
+Value getnewaddrs(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getnewaddrs count\n"
+            "\nget the new addresses, served from the key pool first\n"
+            "\nArguments:\n"
+            "1.\"count\" (numeric, required) the number of the new addresses, 1 to " +
+            std::to_string(MAX_NEW_ADDRS) + "\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"addr\"       (string) the new address\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getnewaddrs", "100") + "\nAs json rpc\n" +
+            HelpExampleRpc("getnewaddrs", "100"));
+
+    RPCTypeCheck(params, list_of(int_type));
+    int64_t count = params[0].get_int64();
+    if (count < 1 || count > MAX_NEW_ADDRS)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be 1 to %d", MAX_NEW_ADDRS));
+
+    // the keys short of the pool are generated here, the wallet must be unlocked for them
+    if (pWalletMain->GetKeyPoolSize() < (size_t)count)
+        EnsureWalletIsUnlocked();
+
+    // thread safe, the keys are generated without a lock and only their adding takes cs_wallet
+    vector<CKeyID> keyIds;
+    pWalletMain->TakeKeysFromPool(count, keyIds);
+    if (keyIds.size() < (size_t)count) {
+        vector<CKey> keys;
+        CWalletKeyPool::GenerateKeys(count - keyIds.size(), keys);
+        if (!pWalletMain->AddKeys(keys, false))
+            throw JSONRPCError(RPC_WALLET_ERROR, "add the new keys failed");
+
+        for (const auto &key : keys)
+            keyIds.push_back(key.GetPubKey().GetKeyId());
+    }
+    walletKeyPool.Notify();
+
+    Array addrs;
+    for (const auto &keyId : keyIds)
+        addrs.push_back(keyId.ToAddress());
+    return addrs;
+}
+
 Value addmulsigaddr(const Array& params, bool fHelp) {
     if (fHelp || params.size() != 2)
         throw runtime_error(
@@ -573,6 +630,8 @@ Value walletpassphrase(const Array& params, bool fHelp) {
     LOCK(cs_nWalletUnlockTime);
     nWalletUnlockTime = GetTime() + nSleepTime;
     RPCRunLater("lockwallet", LockWallet, nSleepTime);
+    // the key pool is refilled while the wallet is unlocked
+    walletKeyPool.Notify();
 
     Object retObj;
     retObj.push_back( Pair("wallet_unlocked", true) );
@@ -732,6 +791,7 @@ Value getwalletinfo(const Array& params, bool fHelp) {
             "  \"unlocked_until\": xxxxx,        (numeric) the timestamp in seconds since epoch (midnight Jan 1 1970 GMT) that the wallet is unlocked for transfers, or 0 if the wallet is locked\n"
             "  \"coinfirmed_tx_num\": xxxxxxx,   (numeric) the number of confirmed tx in the wallet\n"
             "  \"unconfirmed_tx_num\": xxxxxx,   (numeric) the number of unconfirmed tx in the wallet\n"
+            "  \"keypool_size\": xxxxxx,         (numeric) the number of keys ready in the key pool\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getwalletinfo", "")
@@ -750,6 +810,7 @@ Value getwalletinfo(const Array& params, bool fHelp) {
     obj.push_back(Pair("unlocked_until",    nWalletUnlockTime));
     obj.push_back(Pair("coinfirmed_tx_num", (int32_t)pWalletMain->mapInBlockTx.size()));
     obj.push_back(Pair("unconfirmed_tx_num",(int32_t)pWalletMain->unconfirmedTx.size()));
+    obj.push_back(Pair("keypool_size",      (int64_t)pWalletMain->GetKeyPoolSize()));
 
     return obj;
 }
@@ -3,6 +3,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php
 
+#include "chain/txlatency.h"
 #include "commons/base58.h"
 #include "rpc/core/rpcserver.h"
 #include "rpc/core/rpccommons.h"
@@ -200,6 +201,7 @@ Value submitwasmcontractdeploytx( const Array &params, bool fHelp ) {
             tx.set_signature({authorizer_name.value, tx.signature});
         }
 
+        txLatencyTracer.Stamp(tx.GetHash(), TX_STAGE_RPC_RECEIVED);
         std::tuple<bool, string> ret = wallet->CommitTx((CBaseTx * ) & tx);
         JSON_RPC_ASSERT(std::get<0>(ret), RPC_WALLET_ERROR, std::get<1>(ret))
 
@@ -284,6 +286,7 @@ Value submitwasmcontractcalltx( const Array &params, bool fHelp ) {
             tx.set_signature({authorizer_name.value, tx.signature});
         }
 
+        txLatencyTracer.Stamp(tx.GetHash(), TX_STAGE_RPC_RECEIVED);
         std::tuple<bool, string> ret = wallet->CommitTx((CBaseTx * ) & tx);
         JSON_RPC_ASSERT(std::get<0>(ret), RPC_WALLET_ERROR, std::get<1>(ret))//fixme: should get exception from committx
 
@@ -492,30 +495,106 @@ Value getabiwasm( const Array &params, bool fHelp ) {
 
 }
 
+static json_spirit::Object get_tx_trace( const uint256 &trx_id ) {
+
+    auto database  = std::make_shared<CCacheWrapper>(pCdMan);
+    auto resolver  = make_resolver(database);
+
+    CHAIN_ASSERT( CTraceDBCache::IsEnabled(),
+                  wasm_chain::transaction_trace_access_exception,
+                  "the tx traces are not stored, see -wasmtraces")
+
+    string  trace_string;
+    CHAIN_ASSERT( database->traceCache.GetContractTraces(trx_id, trace_string),
+                  wasm_chain::transaction_trace_access_exception,
+                  "get tx '%s' trace failed",
+                  trx_id.ToString())
+
+    json_spirit::Object object_return;
+    json_spirit::Value  value_json;
+    std::vector<char>   trace_bytes = std::vector<char>(trace_string.begin(), trace_string.end());
+    transaction_trace   trace       = wasm::unpack<transaction_trace>(trace_bytes);
+
+    to_variant(trace, value_json, resolver);
+    object_return.push_back(Pair("tx_trace", value_json));
+
+    return object_return;
+}
+
 Value gettxtrace( const Array &params, bool fHelp ) {
 
     RESPONSE_RPC_HELP( fHelp || params.size() != 1 , wasm::rpc::get_tx_trace_rpc_help_message)
     RPCTypeCheck(params, list_of(str_type));
 
     try{
-        auto database  = std::make_shared<CCacheWrapper>(pCdMan);
-        auto resolver  = make_resolver(database);
-        auto trx_id    = uint256S(params[0].get_str());
+        return get_tx_trace(uint256S(params[0].get_str()));
 
-        string  trace_string;
-        CHAIN_ASSERT( database->contractCache.GetContractTraces(trx_id, trace_string),
-                      wasm_chain::transaction_trace_access_exception,
-                      "get tx '%s' trace failed",
-                      trx_id.ToString())
+    } JSON_RPC_CAPTURE_AND_RETHROW;
 
-        json_spirit::Object object_return;
-        json_spirit::Value  value_json;
-        std::vector<char>   trace_bytes = std::vector<char>(trace_string.begin(), trace_string.end());
-        transaction_trace   trace       = wasm::unpack<transaction_trace>(trace_bytes);
+}
+
+bool cachegettxtrace( const Array &params, CRPCCachedResult &result ) {
 
-        to_variant(trace, value_json, resolver);
-        object_return.push_back(Pair("tx_trace", value_json));
+    if (params.size() != 1) return false;
+    RPCTypeCheck(params, list_of(str_type));
+
+    try{
+        auto trx_id = uint256S(params[0].get_str());
+        result.WriteObject(get_tx_trace(trx_id), 0);
+        if (!GetTxConfirmedHeight(trx_id, result.height))
+            result.height = -1;
+        return true;
 
+    } JSON_RPC_CAPTURE_AND_RETHROW;
+
+}
+
+Value getwasmprofile( const Array &params, bool fHelp ) {
+
+    RESPONSE_RPC_HELP( fHelp || params.size() > 1 , wasm::rpc::get_wasm_profile_rpc_help_message)
+    RPCTypeCheck(params, list_of(bool_type));
+
+    try{
+        auto &profiler = wasm::wasm_profiler::instance();
+        CHAIN_ASSERT( profiler.enabled(),
+                      wasm_chain::chain_exception,
+                      "wasm profiler is disabled, restart with -wasmprofile")
+
+        json_spirit::Array profiles_json;
+        for (const auto &item : profiler.get_profiles()) {
+            const auto &profile = item.second;
+
+            json_spirit::Array host_calls_json;
+            for (const auto &call : profile.host_calls) {
+                json_spirit::Object call_json;
+                call_json.push_back(Pair("function", wasm::wasm_profiler::get_host_function_name(call.first)));
+                call_json.push_back(Pair("calls",    call.second.calls));
+                call_json.push_back(Pair("time_us",  call.second.nanos / 1000));
+                host_calls_json.push_back(call_json);
+            }
+
+            json_spirit::Object profile_json;
+            profile_json.push_back(Pair("contract",    wasm::name(item.first.first).to_string()));
+            profile_json.push_back(Pair("action",      wasm::name(item.first.second).to_string()));
+            profile_json.push_back(Pair("executions",  profile.executions));
+            profile_json.push_back(Pair("time_us",     profile.nanos / 1000));
+            profile_json.push_back(Pair("max_time_us", profile.max_nanos / 1000));
+            profile_json.push_back(Pair("avg_pages",   profile.pages / std::max<uint64_t>(profile.executions, 1)));
+            profile_json.push_back(Pair("max_pages",   (uint64_t)profile.max_pages));
+            profile_json.push_back(Pair("host_calls",  host_calls_json));
+            profiles_json.push_back(profile_json);
+        }
+
+        json_spirit::Array stacks_json;
+        for (const auto &stack : profiler.get_folded_stacks())
+            stacks_json.push_back(stack);
+
+        if (params.size() > 0 && params[0].get_bool())
+            profiler.reset();
+
+        json_spirit::Object object_return;
+        object_return.push_back(Pair("profiles",      profiles_json));
+        object_return.push_back(Pair("folded_stacks", stacks_json));
         return object_return;
 
     } JSON_RPC_CAPTURE_AND_RETHROW;
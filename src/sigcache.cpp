@@ -16,35 +16,62 @@ void CSignatureCache::ComputeEntry(uint256& entry, const uint256& sigHash,
         .Finalize(entry.begin());
 }
 
+size_t CSignatureCache::GetMaxShardEntries() {
+    int64_t nMaxCacheSize = SysCfg().GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE);
+    nMaxCacheSize         = std::max<int64_t>(0, std::min(nMaxCacheSize, MAX_MAX_SIG_CACHE_SIZE));
+    return (size_t)(nMaxCacheSize << 20) / (ENTRY_BYTES * SHARD_COUNT);
+}
+
 bool CSignatureCache::Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
-                          const CPubKey& pubKey) {
+                          const CPubKey& pubKey, bool fErase) {
     uint256 entry;
     ComputeEntry(entry, sigHash, vchSig, pubKey);
-    std::unique_lock<std::mutex> lock(mtx);
-    return setValid.count(entry);
+    CShard& shard = GetShard(entry);
+
+    bool found;
+    {
+        std::unique_lock<std::mutex> lock(shard.mtx);
+        found = fErase ? shard.setValid.erase(entry) > 0 : shard.setValid.count(entry) > 0;
+    }
+    ++(found ? hits : misses);
+    return found;
 }
 
 void CSignatureCache::Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
                           const CPubKey& pubKey) {
-    static int64_t nMaxCacheSize = SysCfg().GetArg("-maxsigcachesize", 50000);
-    if (nMaxCacheSize <= 0) return;
+    static const size_t nMaxShardEntries = GetMaxShardEntries();
+    if (nMaxShardEntries == 0) return;
 
     uint256 entry;
     ComputeEntry(entry, sigHash, vchSig, pubKey);
+    CShard& shard = GetShard(entry);
 
-    std::unique_lock<std::mutex> lock(mtx);
+    std::unique_lock<std::mutex> lock(shard.mtx);
 
-    while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize) {
+    while (shard.setValid.size() >= nMaxShardEntries) {
         // Evict a random entry. Random because that helps
         // foil would-be DoS attackers who might try to pre-generate
         // and re-use a set of valid signatures just-slightly-greater
         // than our cache size.
-        UnorderedHashSet::size_type s       = GetRand(setValid.bucket_count());
-        UnorderedHashSet::local_iterator it = setValid.begin(s);
-        if (it != setValid.end(s)) {
-            setValid.erase(*it);
+        UnorderedHashSet::size_type s       = GetRand(shard.setValid.bucket_count());
+        UnorderedHashSet::local_iterator it = shard.setValid.begin(s);
+        if (it != shard.setValid.end(s)) {
+            shard.setValid.erase(*it);
         }
     }
 
-    setValid.insert(entry);
+    shard.setValid.insert(entry);
+}
+
+CSignatureCache::CStats CSignatureCache::GetStats() {
+    CStats stats;
+    for (auto& shard : shards) {
+        std::unique_lock<std::mutex> lock(shard.mtx);
+        stats.entries += shard.setValid.size();
+    }
+    stats.hits      = hits;
+    stats.misses    = misses;
+    stats.bytes     = stats.entries * ENTRY_BYTES;
+    stats.maxBytes  = GetMaxShardEntries() * SHARD_COUNT * ENTRY_BYTES;
+    return stats;
 }
@@ -7,6 +7,7 @@
 #ifndef COIN_SIGCACHE_H
 #define COIN_SIGCACHE_H
 
+#include <atomic>
 #include <mutex>
 #include <vector>
 
@@ -17,28 +18,65 @@
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 
+/** default -maxsigcachesize in MiB */
+static const int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+/** max. -maxsigcachesize in MiB */
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * The entries are spread over SHARD_COUNT independently locked shards, so the
+ * signature check threads rarely wait on each other. The size is bounded by
+ * -maxsigcachesize (MiB), split evenly among the shards.
  */
 class CSignatureCache {
+public:
+    struct CStats {
+        uint64_t hits     = 0;
+        uint64_t misses   = 0;
+        uint64_t entries  = 0;
+        uint64_t bytes    = 0;
+        uint64_t maxBytes = 0;
+    };
+
 private:
-    //! Entries are SHA256(signature hash || public key || signature):
-    UnorderedHashSet setValid;
-    std::mutex mtx;
+    static const uint32_t SHARD_COUNT = 16;
+    // approx. heap cost of one entry: the node with its next pointer, malloc overhead and a bucket slot
+    static const size_t ENTRY_BYTES = sizeof(uint256) + 4 * sizeof(void *);
+
+    struct CShard {
+        //! Entries are SHA256(signature hash || public key || signature):
+        UnorderedHashSet setValid;
+        std::mutex mtx;
+    };
+
+    CShard shards[SHARD_COUNT];
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
 
 public:
-    CSignatureCache() {}
+    CSignatureCache() : hits(0), misses(0) {}
     ~CSignatureCache() {}
+    /**
+     * Return whether the signature is known to be valid. With fErase the entry is removed on a
+     * hit, block validation uses it because a signature included in a block won't be checked again.
+     */
     bool Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
-             const CPubKey& pubKey);
+             const CPubKey& pubKey, bool fErase = false);
     void Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
              const CPubKey& pubKey);
 
+    CStats GetStats();
+
 private:
     void ComputeEntry(uint256& entry, const uint256& sigHash,
                       const std::vector<unsigned char>& vchSig, const CPubKey& pubKey);
+    // UnorderedHashSet is salted, the entry is a SHA256 so its last byte picks the shard evenly
+    CShard& GetShard(const uint256& entry) { return shards[*(entry.end() - 1) % SHARD_COUNT]; }
+    static size_t GetMaxShardEntries();
 };
 
-#endif  // COIN_SIGCACHE_H
\ No newline at end of file
+#endif  // COIN_SIGCACHE_H
@@ -7,6 +7,57 @@
 #include "commons/util/util.h"
 #include "logging.h"
 
+#include <chrono>
+
+std::atomic<bool> fLockProfiling(false);
+
+static std::mutex csLockSites;
+
+static std::vector<const CLockSite*>& LockSites()
+{
+    static std::vector<const CLockSite*> sites;
+    return sites;
+}
+
+// constructed on first use, the LOCKs may run from the static initializers
+static CMetricHistogramFamily& LockWaitMetric()
+{
+    static CMetricHistogramFamily metric("coind_lock_wait_seconds", "Wait of the contended LOCKs by site", "site");
+    return metric;
+}
+
+static CMetricHistogramFamily& LockHoldMetric()
+{
+    static CMetricHistogramFamily metric("coind_lock_hold_seconds", "Hold time of the LOCKs by site", "site");
+    return metric;
+}
+
+static std::string GetLockSiteLabel(const char* pszName, const char* pszFile, int nLine)
+{
+    return strprintf("%s@%s:%d", pszName, pszFile, nLine);
+}
+
+CLockSite::CLockSite(const char* pszNameIn, const char* pszFileIn, int nLineIn)
+    : pszName(pszNameIn), pszFile(pszFileIn), nLine(nLineIn),
+      waitTime(LockWaitMetric().Get(GetLockSiteLabel(pszNameIn, pszFileIn, nLineIn))),
+      holdTime(LockHoldMetric().Get(GetLockSiteLabel(pszNameIn, pszFileIn, nLineIn)))
+{
+    std::lock_guard<std::mutex> lock(csLockSites);
+    LockSites().push_back(this);
+}
+
+std::vector<const CLockSite*> GetLockSites()
+{
+    std::lock_guard<std::mutex> lock(csLockSites);
+    return LockSites();
+}
+
+int64_t GetLockProfileMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 #ifdef DEBUG_LOCKCONTENTION
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 {
@@ -6,8 +6,11 @@
 #ifndef COIN_SYNC_H
 #define COIN_SYNC_H
 
+#include "metrics.h"
 #include "threadsafety.h"
+#include <atomic>
 #include <mutex>
+#include <vector>
 
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
@@ -61,16 +64,64 @@ void static inline DeleteLock(void* cs) {}
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * The wait and hold times of a LOCK site, recorded while the lock profiling is enabled by
+ * -lockprofile or setlockprofiling. Only the contended acquisitions are timed in the wait histogram,
+ * every acquisition is timed in the hold histogram. Both are exported with the site label.
+ */
+class CLockSite
+{
+public:
+    CLockSite(const char* pszNameIn, const char* pszFileIn, int nLineIn);
+
+    const char* pszName;
+    const char* pszFile;
+    int nLine;
+    CMetricHistogram& waitTime;
+    CMetricHistogram& holdTime;
+};
+
+static const bool DEFAULT_LOCK_PROFILE = false;
+extern std::atomic<bool> fLockProfiling;
+
+// the sites of the LOCKs run at least once
+std::vector<const CLockSite*> GetLockSites();
+int64_t GetLockProfileMicros();
+
+// the site of the LOCK at this line, constructed on the first run of the line
+#define LOCK_SITE(cs) ([]() -> CLockSite* { static CLockSite site(#cs, __FILE__, __LINE__); return &site; }())
+
 /** Wrapper around boost::unique_lock<Mutex> */
 template<typename Mutex>
 class CMutexLock
 {
 private:
     boost::unique_lock<Mutex> lock;
+    CLockSite* pSite;
+    int64_t nLockedMicros; // 0 if not profiled
+
+    void EnterProfiled(const char* pszName, const char* pszFile, int nLine)
+    {
+        if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
+            PrintLockContention(pszName, pszFile, nLine);
+#endif
+            int64_t nWaitStart = GetLockProfileMicros();
+            lock.lock();
+            nLockedMicros = GetLockProfileMicros();
+            pSite->waitTime.Observe(nLockedMicros - nWaitStart);
+        } else {
+            nLockedMicros = GetLockProfileMicros();
+        }
+    }
 
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
+        if (pSite != nullptr && fLockProfiling.load(std::memory_order_relaxed)) {
+            EnterProfiled(pszName, pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock())
         {
@@ -88,11 +139,14 @@ private:
         lock.try_lock();
         if (!lock.owns_lock())
             LeaveCritical();
+        else if (pSite != nullptr && fLockProfiling.load(std::memory_order_relaxed))
+            nLockedMicros = GetLockProfileMicros();
         return lock.owns_lock();
     }
 
 public:
-    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) : lock(mutexIn, boost::defer_lock)
+    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false,
+               CLockSite* pSiteIn = nullptr) : lock(mutexIn, boost::defer_lock), pSite(pSiteIn), nLockedMicros(0)
     {
         if (fTry)
             TryEnter(pszName, pszFile, nLine);
@@ -102,6 +156,8 @@ public:
 
     ~CMutexLock()
     {
+        if (nLockedMicros != 0)
+            pSite->holdTime.Observe(GetLockProfileMicros() - nLockedMicros);
         if (lock.owns_lock())
             LeaveCritical();
     }
@@ -114,9 +170,9 @@ public:
 
 typedef CMutexLock<CCriticalSection> CCriticalBlock;
 
-#define LOCK(cs) CCriticalBlock criticalblock(cs, #cs, __FILE__, __LINE__)
-#define LOCK2(cs1,cs2) CCriticalBlock criticalblock1(cs1, #cs1, __FILE__, __LINE__),criticalblock2(cs2, #cs2, __FILE__, __LINE__)
-#define TRY_LOCK(cs,name) CCriticalBlock name(cs, #cs, __FILE__, __LINE__, true)
+#define LOCK(cs) CCriticalBlock criticalblock(cs, #cs, __FILE__, __LINE__, false, LOCK_SITE(cs))
+#define LOCK2(cs1,cs2) CCriticalBlock criticalblock1(cs1, #cs1, __FILE__, __LINE__, false, LOCK_SITE(cs1)),criticalblock2(cs2, #cs2, __FILE__, __LINE__, false, LOCK_SITE(cs2))
+#define TRY_LOCK(cs,name) CCriticalBlock name(cs, #cs, __FILE__, __LINE__, true, LOCK_SITE(cs))
 
 #define ENTER_CRITICAL_SECTION(cs) \
     { \
@@ -0,0 +1,257 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "taskscheduler.h"
+
+#include "commons/util/util.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+struct CTaskScheduler::CTask {
+    std::function<void()> func;
+    CTaskGroup *pGroup = nullptr;
+    TaskPriority priority = TASK_PRIORITY_CONSENSUS;
+    int64_t queuedMicros = 0;
+    std::atomic<bool> fTaken{false};  // set by the thread running the task, a worker or the waiter
+};
+
+namespace {
+
+const char *const kTaskPriorityNames[TASK_PRIORITY_COUNT] = {"consensus", "net", "rpc"};
+
+// the scheduler and the index of the worker running on this thread, if it is one
+thread_local CTaskScheduler *tlsScheduler = nullptr;
+thread_local uint32_t tlsWorkerIndex = 0;
+
+// the metrics are only used here, constructed on first use as the LOCK profiles of sync.cpp
+CMetricCounterFamily &TasksMetric() {
+    static CMetricCounterFamily metric("coind_scheduler_tasks_total", "Tasks run by the shared task scheduler by priority", "priority");
+    return metric;
+}
+
+CMetricCounterFamily &StealsMetric() {
+    static CMetricCounterFamily metric("coind_scheduler_steals_total", "Tasks taken by a worker from the deques of another by priority", "priority");
+    return metric;
+}
+
+CMetricHistogramFamily &QueueWaitMetric() {
+    static CMetricHistogramFamily metric("coind_scheduler_queue_wait_seconds", "Time of the tasks in the deques of the scheduler by priority", "priority");
+    return metric;
+}
+
+}  // namespace
+
+const char *GetTaskPriorityName(TaskPriority priority) {
+    assert(priority < TASK_PRIORITY_COUNT);
+    return kTaskPriorityNames[priority];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class CTaskScheduler
+
+void CTaskScheduler::Start(uint32_t threadCountIn) {
+    if (threadCountIn == 0 || !threads.empty())
+        return;
+
+    for (uint32_t i = 0; i < threadCountIn; i++)
+        workers.emplace_back(new CWorker());
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        fStopping = false;
+    }
+    for (uint32_t i = 0; i < threadCountIn; i++)
+        threads.emplace_back([this, i]() {
+            RenameThread("coin-tasks");
+            WorkerThread(i);
+        });
+    threadCount.store(threadCountIn, memory_order_release);
+}
+
+void CTaskScheduler::Stop() {
+    if (threads.empty())
+        return;
+
+    // the tasks submitted from now on run on their groups, the queued ones are run before the workers exit
+    threadCount.store(0, memory_order_release);
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        fStopping = true;
+    }
+    sleepCond.notify_all();
+    for (auto &thread : threads)
+        thread.join();
+    threads.clear();
+}
+
+void CTaskScheduler::Submit(const CTaskPtr &pTask) {
+    uint32_t count = GetThreadCount();
+    assert(count > 0);
+    uint32_t index = tlsScheduler == this ? tlsWorkerIndex : nextWorker.fetch_add(1, memory_order_relaxed) % count;
+    {
+        CWorker &worker = *workers[index];
+        lock_guard<mutex> lock(worker.mtx);
+        worker.tasks[pTask->priority].push_back(pTask);
+    }
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        queuedCount++;
+    }
+    sleepCond.notify_one();
+}
+
+bool CTaskScheduler::TakeTask(uint32_t index, CTaskPtr &pTask, bool &fStolen) {
+    for (uint8_t priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        {
+            // the own tasks are taken newest first, their data is likely still in the cache
+            CWorker &worker = *workers[index];
+            lock_guard<mutex> lock(worker.mtx);
+            auto &tasks = worker.tasks[priority];
+            if (!tasks.empty()) {
+                pTask = std::move(tasks.back());
+                tasks.pop_back();
+                fStolen = false;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < workers.size(); i++) {
+            CWorker &victim = *workers[(index + i) % workers.size()];
+            lock_guard<mutex> lock(victim.mtx);
+            auto &tasks = victim.tasks[priority];
+            if (!tasks.empty()) {
+                pTask = std::move(tasks.front());
+                tasks.pop_front();
+                fStolen = true;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CTaskScheduler::WorkerThread(uint32_t index) {
+    tlsScheduler   = this;
+    tlsWorkerIndex = index;
+
+    while (true) {
+        {
+            // a worker woken by a task reserves it, the deques hold at least the tasks reserved
+            unique_lock<mutex> lock(sleepMutex);
+            sleepCond.wait(lock, [this]() { return queuedCount > 0 || fStopping; });
+            if (queuedCount == 0)
+                break;
+            queuedCount--;
+        }
+
+        CTaskPtr pTask;
+        bool fStolen = false;
+        if (TakeTask(index, pTask, fStolen))
+            CTaskGroup::TryRun(pTask, fStolen);
+    }
+
+    tlsScheduler = nullptr;
+}
+
+CTaskScheduler &GetTaskScheduler() {
+    static CTaskScheduler scheduler;
+    return scheduler;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class CTaskGroup
+
+CTaskGroup::~CTaskGroup() {
+    // the tasks refer to the group and to the data of the job, they must be done before both go away
+    WaitAll();
+}
+
+void CTaskGroup::Run(std::function<void()> func) {
+    auto pTask          = make_shared<CTaskScheduler::CTask>();
+    pTask->func         = std::move(func);
+    pTask->pGroup       = this;
+    pTask->priority     = priority;
+    pTask->queuedMicros = GetTimeMicros();
+    {
+        lock_guard<mutex> lock(mtx);
+        pendingCount++;
+    }
+    tasks.push_back(pTask);
+
+    if (scheduler.GetThreadCount() == 0)
+        TryRun(pTask, false);
+    else
+        scheduler.Submit(pTask);
+}
+
+void CTaskGroup::Wait() {
+    WaitAll();
+    tasks.clear();
+
+    std::exception_ptr error;
+    {
+        lock_guard<mutex> lock(mtx);
+        std::swap(error, firstError);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void CTaskGroup::WaitAll() {
+    // the tasks still queued are run here, the ones taken by the workers are waited for
+    for (const auto &pTask : tasks)
+        TryRun(pTask, false);
+
+    unique_lock<mutex> lock(mtx);
+    doneCond.wait(lock, [this]() { return pendingCount == 0; });
+}
+
+bool CTaskGroup::TryRun(const CTaskScheduler::CTaskPtr &pTask, bool fStolen) {
+    if (pTask->fTaken.exchange(true, memory_order_acq_rel))
+        return false;
+
+    const char *priorityName = GetTaskPriorityName(pTask->priority);
+    QueueWaitMetric().Get(priorityName).Observe(max<int64_t>(0, GetTimeMicros() - pTask->queuedMicros));
+    TasksMetric().Get(priorityName).Inc();
+    if (fStolen)
+        StealsMetric().Get(priorityName).Inc();
+
+    std::exception_ptr error;
+    try {
+        pTask->func();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // the captures of the task may refer to the job, they are released before the group is told
+    pTask->func = nullptr;
+    pTask->pGroup->OnDone(error);
+    return true;
+}
+
+void CTaskGroup::OnDone(std::exception_ptr error) {
+    // notified under the lock, the waiter may destroy the group as soon as it is released
+    lock_guard<mutex> lock(mtx);
+    if (error && !firstError)
+        firstError = error;
+    if (--pendingCount == 0)
+        doneCond.notify_all();
+}
+
+void ParallelFor(TaskPriority priority, size_t count, uint32_t maxTasks, const std::function<void(size_t)> &fn) {
+    if (count == 0)
+        return;
+
+    atomic<size_t> next(0);
+    CTaskGroup group(priority);
+    size_t taskCount = max<size_t>(1, min<size_t>(maxTasks, count));
+    for (size_t t = 0; t < taskCount; t++) {
+        group.Run([&]() {
+            for (size_t i = next++; i < count; i = next++)
+                fn(i);
+        });
+    }
+    group.Wait();
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_TASKSCHEDULER_H
+#define COIN_TASKSCHEDULER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * The work stealing pool shared by the short parallel jobs of the node, e.g. the block prefetch, the
+ * decoding of the block index and the writes of the db flush, instead of a thread group spawned by each.
+ *
+ * Every worker has a deque by priority. A worker pushes the tasks it submits to the back of its own deques
+ * and takes them back from there, the tasks of the other threads are spread over the workers. An idle
+ * worker steals from the front of the deques of the others. The tasks of a higher priority are taken
+ * first from any deque, so the consensus work is never queued behind the networking or the RPC work.
+ */
+enum TaskPriority : uint8_t {
+    TASK_PRIORITY_CONSENSUS = 0,
+    TASK_PRIORITY_NET,
+    TASK_PRIORITY_RPC,
+    TASK_PRIORITY_COUNT
+};
+
+const char *GetTaskPriorityName(TaskPriority priority);
+
+class CTaskGroup;
+
+class CTaskScheduler {
+public:
+    struct CTask;
+    typedef std::shared_ptr<CTask> CTaskPtr;
+
+    CTaskScheduler() {}
+    ~CTaskScheduler() { Stop(); }
+
+    // Start the workers, called once at startup. Without workers the tasks run on the submitting thread.
+    void Start(uint32_t threadCount);
+    // Run the queued tasks and join the workers
+    void Stop();
+
+    uint32_t GetThreadCount() const { return threadCount.load(std::memory_order_acquire); }
+
+    // Queue the task, the caller sets the group and the priority of it
+    void Submit(const CTaskPtr &pTask);
+
+private:
+    struct CWorker {
+        std::mutex mtx;
+        std::deque<CTaskPtr> tasks[TASK_PRIORITY_COUNT];
+    };
+
+    void WorkerThread(uint32_t index);
+    // Take the next task for the worker, its own deques first by priority, false if all are empty
+    bool TakeTask(uint32_t index, CTaskPtr &pTask, bool &fStolen);
+
+    std::vector<std::unique_ptr<CWorker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> threadCount{0};
+    std::atomic<uint32_t> nextWorker{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCond;
+    uint64_t queuedCount = 0;  // the tasks queued and not yet taken, guarded by sleepMutex
+    bool fStopping = false;
+};
+
+// The scheduler of the node, started by AppInit() with -schedulerthreads workers
+CTaskScheduler &GetTaskScheduler();
+
+/**
+ * The tasks of one parallel job. Wait() returns when all of them are done and throws the first exception
+ * thrown by any. The waiting thread runs the tasks of the group not yet taken by a worker, so a job does
+ * not wait for a busy pool and the waiter never runs the tasks of another job under its locks.
+ */
+class CTaskGroup {
+public:
+    explicit CTaskGroup(TaskPriority priorityIn, CTaskScheduler &schedulerIn = GetTaskScheduler())
+        : priority(priorityIn), scheduler(schedulerIn) {}
+    // waits for the tasks still running, their exceptions are dropped
+    ~CTaskGroup();
+
+    CTaskGroup(const CTaskGroup &) = delete;
+    CTaskGroup &operator=(const CTaskGroup &) = delete;
+
+    // Called by the owner of the group only
+    void Run(std::function<void()> func);
+    void Wait();
+
+private:
+    friend class CTaskScheduler;
+
+    void WaitAll();
+    // Run the task if no other thread took it, false if one did
+    static bool TryRun(const CTaskScheduler::CTaskPtr &pTask, bool fStolen);
+    void OnDone(std::exception_ptr error);
+
+    TaskPriority priority;
+    CTaskScheduler &scheduler;
+    std::vector<CTaskScheduler::CTaskPtr> tasks;
+
+    std::mutex mtx;
+    std::condition_variable doneCond;
+    size_t pendingCount = 0;  // guarded by mtx
+    std::exception_ptr firstError;
+};
+
+// Run fn(i) for i in [0, count) as the tasks of a group, at most maxTasks of which take the indexes one
+// after the other, and throw the first exception of fn
+void ParallelFor(TaskPriority priority, size_t count, uint32_t maxTasks, const std::function<void(size_t)> &fn);
+
+#endif  // COIN_TASKSCHEDULER_H
@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain/blockfilter.h"
+
+#include "commons/serialize.h"
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(blockfilter_tests)
+
+static BlockFilterElement GetTestElement(uint32_t n) {
+    uint160 keyId;
+    for (uint32_t i = 0; i < keyId.size(); i++)
+        *(keyId.begin() + i) = (n * 131 + i * 17) & 0xff;
+    *(uint32_t *)keyId.begin() = n;
+    return CBlockFilter::GetElement(keyId);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_match) {
+    uint256 blockHash = uint256S("d640d051704155b1fd3ec8d0331497448c259b0ab0499e109da7ae2bc7423bc2");
+    vector<BlockFilterElement> elements;
+    for (uint32_t n = 0; n < 200; n++)
+        elements.push_back(GetTestElement(n));
+    elements.push_back(GetTestElement(0));  // counted once
+
+    CBlockFilter filter(blockHash, elements, uint256());
+    BOOST_CHECK_EQUAL(filter.GetElementCount(), 200U);
+    for (const auto &element : elements)
+        BOOST_CHECK(filter.Match(element));
+
+    // the false positive rate is 1/M per element
+    uint32_t falsePositives = 0;
+    for (uint32_t n = 200; n < 20200; n++)
+        falsePositives += filter.Match(GetTestElement(n));
+    BOOST_CHECK(falsePositives <= 2);
+
+    BOOST_CHECK(filter.MatchAny({GetTestElement(100000), GetTestElement(7)}));
+    BOOST_CHECK(!CBlockFilter(blockHash, {}, uint256()).Match(GetTestElement(0)));
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_serialize) {
+    uint256 blockHash = uint256S("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+    vector<BlockFilterElement> elements = {GetTestElement(1), GetTestElement(2), BlockFilterElement(6, 0x01)};
+    CBlockFilter filter(blockHash, elements, uint256S("01"));
+
+    CDataStream ds(SER_DISK, 1);
+    ds << filter;
+    CBlockFilter filter2;
+    ds >> filter2;
+    BOOST_CHECK(filter2.GetBlockHash() == blockHash);
+    BOOST_CHECK(filter2.GetEncoded() == filter.GetEncoded());
+    BOOST_CHECK(filter2.GetHeader() == filter.GetHeader());
+    BOOST_CHECK_EQUAL(filter2.GetElementCount(), 3U);
+    for (const auto &element : elements)
+        BOOST_CHECK(filter2.Match(element));
+
+    // the header chains the previous one
+    BOOST_CHECK(CBlockFilter(blockHash, elements, uint256S("02")).GetHeader() != filter.GetHeader());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
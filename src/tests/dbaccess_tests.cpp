@@ -9,6 +9,8 @@
 #include <map>
 #include <boost/test/unit_test.hpp>
 #include "persistence/dbaccess.h"
+#include "persistence/dbiterator.h"
+#include "persistence/blockundo.h"
 
 using namespace std;
 
@@ -157,6 +159,49 @@ static uint32_t GetCacheSerializeSize(CacheType &cache) {
     return ret;
 }
 
+BOOST_AUTO_TEST_CASE(dbcache_undo_composer_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache1 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    pDBCache1->SetData("regid-3", "keyid-3");
+    pDBCache1->Flush();
+
+    // two blocks writing the same keys, the undo must restore the values before the first one
+    auto pDBCache2 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    CBlockUndo blockUndo1, blockUndo2;
+    blockUndo1.vtxundo.resize(1);
+    pDBCache2->SetDbOpLogMap(&blockUndo1.vtxundo[0].dbOpLogMap);
+    pDBCache2->SetData("regid-1", "keyid-1");
+    pDBCache2->SetData("regid-3", "keyid-3a");
+    blockUndo2.vtxundo.resize(2);
+    pDBCache2->SetDbOpLogMap(&blockUndo2.vtxundo[0].dbOpLogMap);
+    pDBCache2->SetData("regid-1", "keyid-1a");
+    pDBCache2->SetDbOpLogMap(&blockUndo2.vtxundo[1].dbOpLogMap);
+    pDBCache2->SetData("regid-1", "keyid-1b");
+    pDBCache2->SetData("regid-2", "keyid-2");
+    pDBCache2->SetData("regid-3", "keyid-3b");
+    pDBCache2->SetDbOpLogMap(nullptr);
+
+    UndoDataFuncMap undoDataFuncMap;
+    pDBCache2->RegisterUndoFunc(undoDataFuncMap);
+    CBlockUndoComposer composer;
+    composer.Add(std::move(blockUndo2));
+    composer.Add(std::move(blockUndo1));
+    BOOST_CHECK(composer.GetKeyCount() == 3);
+    BOOST_CHECK(composer.Apply(undoDataFuncMap));
+    BOOST_CHECK(composer.GetKeyCount() == 0);
+
+    string value;
+    BOOST_CHECK(!pDBCache2->GetData(string("regid-1"), value));
+    BOOST_CHECK(!pDBCache2->GetData(string("regid-2"), value));
+    BOOST_CHECK(pDBCache2->GetData(string("regid-3"), value));
+    BOOST_CHECK( value == "keyid-3" );
+}
+
 BOOST_AUTO_TEST_CASE(dbcache_cache_size_test)
 {
     const bool isWipe = true;
@@ -181,4 +226,83 @@ BOOST_AUTO_TEST_CASE(dbcache_cache_size_test)
     BOOST_CHECK(!pDBCache2->IsCalcSize() && pDBCache2->GetCacheSize() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(dbcache_read_cache_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    pDBCache->SetData("regid-1", "keyid-1");
+    pDBCache->SetData("regid-2", "keyid-2");
+    pDBCache->Flush();
+    uint64_t itemSize = GetSerSize(make_pair<string, string>("regid-1", "keyid-1"));
+    BOOST_CHECK(pDBCache->GetCacheSize() == 0);
+    BOOST_CHECK(pDBAccess->EvictReadCaches() == 2 * itemSize);
+
+    // a hit moves the value back to the data map, the erased key stays as a known absent one
+    string value;
+    BOOST_CHECK(pDBCache->GetData(string("regid-1"), value) && value == "keyid-1");
+    BOOST_CHECK(pDBCache->GetCacheSize() == itemSize);
+    BOOST_CHECK(pDBAccess->EvictReadCaches() == itemSize);
+    pDBCache->EraseData("regid-2");
+    pDBCache->Flush();
+    uint64_t absentSize = GetSerSize(make_pair<string, string>("regid-2", ""));
+    BOOST_CHECK(pDBAccess->EvictReadCaches() == itemSize + absentSize);
+    BOOST_CHECK(!pDBCache->GetData(string("regid-2"), value));
+    BOOST_CHECK(pDBCache->GetCacheSize() == 0);
+
+    // a miss of the db is cached too, until a flush writes the key
+    BOOST_CHECK(!pDBCache->HaveData(string("regid-3")));
+    BOOST_CHECK(pDBAccess->EvictReadCaches() == itemSize + 2 * absentSize);
+    pDBCache->SetData("regid-3", "keyid-3");
+    pDBCache->Flush();
+    BOOST_CHECK(pDBCache->GetData(string("regid-3"), value) && value == "keyid-3");
+
+    // the least recently flushed values are evicted first
+    CDBReadCache<string, string> readCache;
+    readCache.Put("key-1", "value-1", 10);
+    readCache.Put("key-2", "value-2", 10);
+    readCache.Put("key-3", "value-3", 10);
+    BOOST_CHECK(readCache.Take("key-1", value) && value == "value-1");
+    readCache.Put("key-1", "value-1", 10);
+    readCache.EvictReadCache(20);
+    BOOST_CHECK(readCache.GetReadCacheSize() == 20);
+    BOOST_CHECK(!readCache.Take("key-2", value));
+    BOOST_CHECK(readCache.Take("key-1", value) && readCache.Take("key-3", value));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_range_iterator_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    typedef CCompositeKVCache<prefix, string, string> StringCache;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache1 = make_shared<StringCache>(pDBAccess.get());
+    pDBCache1->SetData("regid-1", "keyid-1");
+    pDBCache1->SetData("regid-3", "keyid-3");
+    pDBCache1->SetData("regid-5", "keyid-5");
+    pDBCache1->Flush();
+    pDBCache1->SetData("regid-4", "keyid-4");
+
+    // the child erases a key of the db and sets one of its own
+    auto pDBCache2 = make_shared<StringCache>(pDBCache1.get());
+    pDBCache2->EraseData("regid-3");
+    pDBCache2->SetData("regid-2", "keyid-2");
+
+    vector<string> keys;
+    CDBRangeIterator<StringCache> it(*pDBCache2, "regid-2", "regid-5");
+    for (it.First(); it.IsValid(); it.Next())
+        keys.push_back(it.GetKey());
+    BOOST_CHECK(keys == vector<string>({"regid-2", "regid-4"}));
+
+    CDBIterator<StringCache> allIt(*pDBCache2);
+    BOOST_CHECK(allIt.Seek("regid-3") && allIt.GetKey() == "regid-4" && allIt.GetValue() == "keyid-4");
+    BOOST_CHECK(allIt.Next() && allIt.GetKey() == "regid-5");
+    BOOST_CHECK(!allIt.Next());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
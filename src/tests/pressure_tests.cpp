@@ -64,7 +64,8 @@ public:
 
 			uint64_t llmoney = GetRandomMoney() * COIN;
 			CRegID reg(addr.first);
-			arguments.insert(arguments.end(), reg.GetRegIdRaw().begin(), reg.GetRegIdRaw().end());
+			vector<unsigned char> vRegId = reg.GetRegIdRaw();
+			arguments.insert(arguments.end(), vRegId.begin(), vRegId.end());
 			CDataStream ds(SER_DISK, CLIENT_VERSION);
 			ds << llmoney;
 			vector<unsigned char> temp(ds.begin(), ds.end());
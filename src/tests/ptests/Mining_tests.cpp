@@ -132,7 +132,8 @@ public:
 	void GetContranctData(vector<unsigned char> &vContranct ) {
 		//vector<unsigned char> temp = ParseHex(m_strRegId);
 		CRegID reg(m_strRegId);
-		vContranct.insert(vContranct.end(), reg.GetRegIdRaw().begin(), reg.GetRegIdRaw().end());
+		vector<unsigned char> vRegId = reg.GetRegIdRaw();
+		vContranct.insert(vContranct.end(), vRegId.begin(), vRegId.end());
 		//temp.clear();
 		CDataStream ds(SER_DISK, CLIENT_VERSION);
 		ds << m_llSendValue;
@@ -0,0 +1,60 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "tx/txmempool.h"
+#include "tx/cointransfertx.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(txpriority_tests)
+
+// the txs ordered by txid
+static vector<std::shared_ptr<CBaseTx>> GetTestTxs(uint32_t count) {
+    vector<std::shared_ptr<CBaseTx>> txs;
+    for (uint32_t n = 0; n < count; n++)
+        txs.push_back(std::make_shared<CCoinTransferTx>(CUserID(), CUserID(), 100, SYMB::WICC, 1, SYMB::WICC,
+                                                        10000, strprintf("tx%u", n)));
+    std::sort(txs.begin(), txs.end(), [](const std::shared_ptr<CBaseTx> &a, const std::shared_ptr<CBaseTx> &b) {
+        return a->GetHash() < b->GetHash();
+    });
+    return txs;
+}
+
+BOOST_AUTO_TEST_CASE(txpriority_order) {
+    vector<std::shared_ptr<CBaseTx>> txs = GetTestTxs(5);
+
+    // the fees cross the txids, and the priorities are close to each other
+    vector<TxPriority> expected = {
+        TxPriority(1, 1, txs[1]),
+        TxPriority(1, 1, txs[2]),
+        TxPriority(1, 2, txs[0]),
+        TxPriority(500, 0, txs[3]),
+        TxPriority(2000, 0, txs[4])};
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        BOOST_CHECK(!(expected[i] < expected[i]));
+        for (size_t j = i + 1; j < expected.size(); j++) {
+            BOOST_CHECK(expected[i] < expected[j]);
+            BOOST_CHECK(!(expected[j] < expected[i]));
+        }
+    }
+
+    set<TxPriority> txPriorities;
+    for (auto it = expected.rbegin(); it != expected.rend(); ++it)
+        BOOST_CHECK(txPriorities.insert(*it).second);
+    BOOST_CHECK_EQUAL(txPriorities.size(), expected.size());
+
+    size_t index = 0;
+    for (const auto &item : txPriorities) {
+        BOOST_CHECK(item.txid == expected[index].txid);
+        index++;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -157,7 +157,7 @@ bool CAssetIssueTx::CheckTx(CTxExecuteContext &context) {
 
 bool CAssetIssueTx::ExecuteTx(CTxExecuteContext &context) {
     CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
     shared_ptr<CAccount> pTxAccount = make_shared<CAccount>();
     if (pTxAccount == nullptr || !cw.accountCache.GetAccount(txUid, *pTxAccount))
         return state.DoS(100, ERRORMSG("CAssetIssueTx::ExecuteTx, read source txUid %s account info error",
@@ -382,7 +382,7 @@ bool CAssetUpdateTx::CheckTx(CTxExecuteContext &context) {
 
 bool CAssetUpdateTx::ExecuteTx(CTxExecuteContext &context) {
     CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
     CAccount account;
     if (!cw.accountCache.GetAccount(txUid, account))
         return state.DoS(100, ERRORMSG("CAssetUpdateTx::ExecuteTx, read source txUid %s account info error",
@@ -91,7 +91,7 @@ bool CBlockPriceMedianTx::ExecuteTx(CTxExecuteContext &context) {
                          "save-median-prices-failed");
     }
 
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
     CAccount fcoinGenesisAccount;
     if (!cw.accountCache.GetFcoinGenesisAccount(fcoinGenesisAccount)) {
         return state.DoS(100, ERRORMSG("%s(), get fcoin genesis account failed", __func__), REJECT_INVALID,
@@ -193,8 +193,7 @@ bool CCdpForcedLiquidater::Execute() {
         return true;
     }
 
-    // 2. get all CDPs to be force settled
-    CdpRatioSortedCache::Map cdpMap;
+    // 2. stream the CDPs to be force settled, in the order of the ratio index
     uint64_t forceLiquidateRatio = 0;
     // TODO: get cdp CDP_FORCE_LIQUIDATE_RATIO
     if (!cw.sysParamCache.GetCdpParam(cdpCoinPair, CdpParamType::CDP_FORCE_LIQUIDATE_RATIO, forceLiquidateRatio)) {
@@ -203,31 +202,24 @@ bool CCdpForcedLiquidater::Execute() {
                 READ_SYS_PARAM_FAIL, "read-force-liquidate-ratio-error");
     }
 
-    // TODO: get liquidating cdp map
-    cw.cdpCache.GetCdpListByCollateralRatio(cdpCoinPair, forceLiquidateRatio, bcoinMedianPrice, cdpMap);
+    auto spCdpIt = cw.cdpCache.CreateCdpRatioIterator(cdpCoinPair, forceLiquidateRatio, bcoinMedianPrice);
+    spCdpIt->First();
 
     LogPrint(BCLog::CDP, "%s(), tx_cord=%d-%d, globalCollateralRatioFloor: %llu, bcoinMedianPrice: %llu, "
-            "forceLiquidateRatio: %llu, cdpMap: %llu\n", __func__, context.height, context.index,
-            globalCollateralRatioFloor, bcoinMedianPrice, forceLiquidateRatio, cdpMap.size());
+            "forceLiquidateRatio: %llu, has cdps: %d\n", __func__, context.height, context.index,
+            globalCollateralRatioFloor, bcoinMedianPrice, forceLiquidateRatio, spCdpIt->IsValid());
 
     // 3. force settle each cdp
-    if (cdpMap.size() == 0) {
+    if (!spCdpIt->IsValid()) {
         return true;
     }
 
-    {
-        // TODO: remove me.
-        LogPrint(BCLog::CDP, "%s(), have %llu cdps to force settle, in detail:\n",
-                    __func__, cdpMap.size());
-        for (const auto &cdpKey : cdpMap) {
-            LogPrint(BCLog::CDP, "%s\n", cdpKey.second.ToString());
-        }
-    }
-
     NET_TYPE netType = SysCfg().NetworkID();
     if (netType == TEST_NET && context.height < 1800000  && assetSymbol == SYMB::WICC && scoinSymbol == SYMB::WUSD) {
         // soft fork to compat old data of testnet
         // TODO: remove me if reset testnet.
+        CdpRatioSortedCache::Map cdpMap;
+        cw.cdpCache.GetCdpListByCollateralRatio(cdpCoinPair, forceLiquidateRatio, bcoinMedianPrice, cdpMap);
         return ForceLiquidateCDPCompat(bcoinMedianPrice, fcoinMedianPrice, cdpMap);
     }
 
@@ -235,8 +227,9 @@ bool CCdpForcedLiquidater::Execute() {
     uint64_t totalCloseoutScoins = 0;
     uint64_t totalSelloutBcoins  = 0;
     uint64_t totalInflateFcoins  = 0;
-    for (auto &cdpPair : cdpMap) {
-        auto &cdp = cdpPair.second;
+    // the cdp is copied out, closing it below changes the index under the iterator
+    for (; spCdpIt->IsValid(); spCdpIt->Next()) {
+        CUserCDP cdp = spCdpIt->GetValue();
         if (count + 1 > FORCE_SETTLE_CDP_MAX_COUNT_PER_BLOCK)
             break;
 
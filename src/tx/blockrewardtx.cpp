@@ -91,7 +91,7 @@ bool CUCoinBlockRewardTx::ExecuteTx(CTxExecuteContext &context) {
     } else if (-1 == index) {
         // When the reward transaction is mature, update account's balances, i.e, assgin the reward values to
         // the target account.
-        vector<CReceipt> receipts;
+        vector<CReceipt> &receipts = context.GetReceipts();
         for (const auto &item : reward_fees) {
             uint64_t rewardAmount  = item.second;
             TokenSymbol coinSymbol = item.first;
@@ -205,7 +205,7 @@ bool CCDPStakeTx::ExecuteTx(CTxExecuteContext &context) {
         return state.DoS(100, ERRORMSG("CCDPStakeTx::ExecuteTx, read CDP_START_COLLATERAL_RATIO error!!"),
                         READ_SYS_PARAM_FAIL, "read-sysparamdb-error");
 
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
     uint64_t mintScoinForInterest = 0;
 
     if (cdp_txid.IsEmpty()) { // 1st-time CDP creation
@@ -376,15 +376,13 @@ bool CCDPStakeTx::SellInterestForFcoins(const CTxCord &txCord, const CUserCDP &c
 
     CAccount fcoinGenesisAccount;
     cw.accountCache.GetFcoinGenesisAccount(fcoinGenesisAccount);
-    // send interest to fcoin genesis account
-    if (!fcoinGenesisAccount.OperateBalance(SYMB::WUSD, BalanceOpType::ADD_FREE, scoinsInterestToRepay)) {
-        return state.DoS(100, ERRORMSG("CCDPStakeTx::SellInterestForFcoins, operate balance failed"),
-                        UPDATE_ACCOUNT_FAIL, "operate-fcoin-genesis-account-failed");
-    }
-
-    // should freeze user's coin for buying the asset
-    if (!fcoinGenesisAccount.OperateBalance(SYMB::WUSD, BalanceOpType::FREEZE, scoinsInterestToRepay)) {
-        return state.DoS(100, ERRORMSG("CCDPStakeTx::SellInterestForFcoins, account has insufficient funds"),
+    // send interest to fcoin genesis account and freeze it for buying the asset
+    size_t failedIndex = 0;
+    if (!fcoinGenesisAccount.OperateBalances(SYMB::WUSD, {{BalanceOpType::ADD_FREE, scoinsInterestToRepay},
+                                                          {BalanceOpType::FREEZE, scoinsInterestToRepay}},
+                                             failedIndex)) {
+        return state.DoS(100, ERRORMSG("CCDPStakeTx::SellInterestForFcoins, %s", failedIndex == 0 ?
+                        "operate balance failed" : "account has insufficient funds"),
                         UPDATE_ACCOUNT_FAIL, "operate-fcoin-genesis-account-failed");
     }
 
@@ -506,7 +504,7 @@ bool CCDPRedeemTx::ExecuteTx(CTxExecuteContext &context) {
                          REJECT_INVALID, "deduct-interest-error");
     }
 
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
     if (!SellInterestForFcoins(CTxCord(context.height, context.index), cdp, scoinsInterestToRepay, cw, state, receipts)) {
         return state.DoS(100, ERRORMSG("CCDPRedeemTx::ExecuteTx, SellInterestForFcoins error!"),
                             REJECT_INVALID, "sell-interest-for-fcoins-error");
@@ -636,15 +634,13 @@ bool CCDPRedeemTx::SellInterestForFcoins(const CTxCord &txCord, const CUserCDP &
 
     CAccount fcoinGenesisAccount;
     cw.accountCache.GetFcoinGenesisAccount(fcoinGenesisAccount);
-    // send interest to fcoin genesis account
-    if (!fcoinGenesisAccount.OperateBalance(SYMB::WUSD, BalanceOpType::ADD_FREE, scoinsInterestToRepay)) {
-        return state.DoS(100, ERRORMSG("CCDPRedeemTx::SellInterestForFcoins, operate balance failed"),
-                        UPDATE_ACCOUNT_FAIL, "operate-fcoin-genesis-account-failed");
-    }
-
-    // should freeze user's coin for buying the asset
-    if (!fcoinGenesisAccount.OperateBalance(SYMB::WUSD, BalanceOpType::FREEZE, scoinsInterestToRepay)) {
-        return state.DoS(100, ERRORMSG("CCDPRedeemTx::SellInterestForFcoins, account has insufficient funds"),
+    // send interest to fcoin genesis account and freeze it for buying the asset
+    size_t failedIndex = 0;
+    if (!fcoinGenesisAccount.OperateBalances(SYMB::WUSD, {{BalanceOpType::ADD_FREE, scoinsInterestToRepay},
+                                                          {BalanceOpType::FREEZE, scoinsInterestToRepay}},
+                                             failedIndex)) {
+        return state.DoS(100, ERRORMSG("CCDPRedeemTx::SellInterestForFcoins, %s", failedIndex == 0 ?
+                        "operate balance failed" : "account has insufficient funds"),
                         UPDATE_ACCOUNT_FAIL, "operate-fcoin-genesis-account-failed");
     }
 
@@ -831,7 +827,7 @@ bool CCDPLiquidateTx::ExecuteTx(CTxExecuteContext &context) {
         totalScoinsToReturnSysFund    = 0;
     }
 
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
 
     if (scoins_to_liquidate >= totalScoinsToLiquidate) {
         if (!account.OperateBalance(cdp.scoin_symbol, SUB_FREE, totalScoinsToLiquidate)) {
@@ -63,6 +63,11 @@ public:
     }
 
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CCDPStakeTx>(*this); }
+    virtual void GetPrefetchKeys(CTxPrefetchKeys &keys) const {
+        CBaseTx::GetPrefetchKeys(keys);
+        if (!cdp_txid.IsNull())
+            keys.cdpIds.push_back(cdp_txid);
+    }
 
     virtual string ToString(CAccountDBCache &accountCache);
     virtual Object ToJson(const CAccountDBCache &accountCache) const;
@@ -120,6 +125,11 @@ public:
     }
 
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CCDPRedeemTx>(*this); }
+    virtual void GetPrefetchKeys(CTxPrefetchKeys &keys) const {
+        CBaseTx::GetPrefetchKeys(keys);
+        if (!cdp_txid.IsNull())
+            keys.cdpIds.push_back(cdp_txid);
+    }
 
     virtual string ToString(CAccountDBCache &accountCache);
     virtual Object ToJson(const CAccountDBCache &accountCache) const;
@@ -174,6 +184,11 @@ public:
     }
 
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CCDPLiquidateTx>(*this); }
+    virtual void GetPrefetchKeys(CTxPrefetchKeys &keys) const {
+        CBaseTx::GetPrefetchKeys(keys);
+        if (!cdp_txid.IsNull())
+            keys.cdpIds.push_back(cdp_txid);
+    }
 
     virtual string ToString(CAccountDBCache &accountCache);
     virtual Object ToJson(const CAccountDBCache &accountCache) const;
@@ -53,12 +53,23 @@ bool CCoinStakeTx::ExecuteTx(CTxExecuteContext &context) {
         return false;
     }
 
-    if (!account.OperateBalance(fee_symbol, BalanceOpType::SUB_FREE, llFees)) {
+    // the fees and the stake of the same token are applied with one lookup of it
+    size_t failedIndex = 0;
+    bool feesPaid = false, staked = false;
+    if (fee_symbol == coin_symbol) {
+        staked   = account.OperateBalances(coin_symbol, {{SUB_FREE, llFees}, {stake_type, coin_amount}}, failedIndex);
+        feesPaid = staked || failedIndex > 0;
+    } else {
+        feesPaid = account.OperateBalance(fee_symbol, BalanceOpType::SUB_FREE, llFees);
+        staked   = feesPaid && account.OperateBalance(coin_symbol, stake_type, coin_amount);
+    }
+
+    if (!feesPaid) {
         return state.DoS(100, ERRORMSG("CCoinStakeTx::ExecuteTx, insufficient coins in txUid %s account",
                         txUid.ToString()), UPDATE_ACCOUNT_FAIL, "insufficient-coins");
     }
 
-    if (!account.OperateBalance(coin_symbol, stake_type, coin_amount)) {
+    if (!staked) {
         return state.DoS(100, ERRORMSG("CCoinStakeTx::ExecuteTx, insufficient coins to stake in txUid(%s)",
                         txUid.ToString()), UPDATE_ACCOUNT_FAIL, "insufficient-coin-amount");
     }
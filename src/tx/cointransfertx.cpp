@@ -74,7 +74,8 @@ bool CBaseCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
                          UPDATE_ACCOUNT_FAIL, "operate-add-account-failed");
     }
 
-    if (!cw.accountCache.SetAccount(toUid, desAccount))
+    // the keyid of the account read, the regid of toUid is not looked up again
+    if (!cw.accountCache.SetAccount(desAccount.keyid, desAccount))
         return state.DoS(100, ERRORMSG("CBaseCoinTransferTx::ExecuteTx, save account error, kyeId=%s",
                          desAccount.keyid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-account");
 
@@ -105,7 +106,14 @@ bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
     IMPLEMENT_DISABLE_TX_PRE_STABLE_COIN_RELEASE;
     IMPLEMENT_CHECK_TX_MEMO;
     IMPLEMENT_CHECK_TX_REGID_OR_PUBKEY(txUid);
-    if (!CheckFee(context)) return false;
+
+    // the min fee of the fee check is kept for the check of the fee per transfer
+    uint64_t minFee = 0;
+    if (!CheckFee(context, [&](CTxExecuteContext &feeContext, uint64_t minFeeIn) {
+            minFee = minFeeIn;
+            return CheckMinFee(feeContext, minFeeIn);
+        }))
+        return false;
 
     if (transfers.empty() || transfers.size() > MAX_TRANSFER_SIZE) {
         return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, transfers is empty or too large count=%d than %d",
@@ -132,9 +140,6 @@ bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
                          i, transfers[i].coin_symbol, transfers[i].coin_amount), REJECT_DUST, "invalid-coin-amount");
     }
 
-    uint64_t minFee;
-    if (!GetTxMinFee(nTxType, context.height, fee_symbol, minFee)) { assert(false); /* has been check before */ }
-
     if (llFees < transfers.size() * minFee) {
         return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, tx fee too small (height: %d, fee symbol: %s, fee: %llu)",
                          context.height, fee_symbol, llFees), REJECT_INVALID, "bad-tx-fee-toosmall");
@@ -173,7 +178,13 @@ bool CCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
                         txUid.ToString()), UPDATE_ACCOUNT_FAIL, "insufficient-coin_amount");
     }
 
-    vector<CReceipt> receipts;
+    if (transfers.size() == 1 && transfers[0].coin_symbol != SYMB::WUSD && !srcAccount.IsMyUid(transfers[0].to_uid))
+        return ExecuteSingleTransfer(context, srcAccount);
+
+    vector<CReceipt> &receipts = context.GetReceipts();
+    // read once for all the WUSD transfers
+    uint64_t riskReserveFeeRatio = 0;
+    bool hasRiskReserveFeeRatio  = false;
 
     for (size_t i = 0; i < transfers.size(); i++) {
         const auto &transfer = transfers[i];
@@ -185,11 +196,13 @@ bool CCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
 
         uint64_t actualCoinsToSend = transfer.coin_amount;
         if (transfer.coin_symbol == SYMB::WUSD) {  // if transferring WUSD, must pay friction fees to the risk reserve
-            uint64_t riskReserveFeeRatio;
-            CCdpCoinPair cdpCoinPair();
-            if (!cw.sysParamCache.GetParam(TRANSFER_SCOIN_RESERVE_FEE_RATIO, riskReserveFeeRatio)) {
-                return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, transfers[%d], read TRANSFER_SCOIN_RESERVE_FEE_RATIO error", i),
-                                READ_SYS_PARAM_FAIL, "bad-read-sysparamdb");
+            if (!hasRiskReserveFeeRatio) {
+                if (!cw.sysParamCache.GetParam(TRANSFER_SCOIN_RESERVE_FEE_RATIO, riskReserveFeeRatio)) {
+                    return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, transfers[%d], read TRANSFER_SCOIN_RESERVE_FEE_RATIO error", i),
+                                    READ_SYS_PARAM_FAIL, "bad-read-sysparamdb");
+                }
+                hasRiskReserveFeeRatio = true;
+                receipts.reserve(2 * transfers.size());
             }
             uint64_t reserveFeeScoins = transfer.coin_amount * riskReserveFeeRatio / RATIO_BOOST;
             if (reserveFeeScoins > 0) {
@@ -255,6 +268,46 @@ bool CCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
     return true;
 }
 
+bool CCoinTransferTx::ExecuteSingleTransfer(CTxExecuteContext &context, CAccount &srcAccount) {
+    CCacheWrapper &cw       = *context.pCw;
+    CValidationState &state = *context.pState;
+    const auto &transfer    = transfers[0];
+
+    if (!srcAccount.OperateBalance(transfer.coin_symbol, SUB_FREE, transfer.coin_amount)) {
+        return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, transfers[0], insufficient coins in txUid %s account",
+                        txUid.ToString()), UPDATE_ACCOUNT_FAIL, "insufficient-coins");
+    }
+
+    CAccount desAccount;
+    bool isNewAccount = false;
+    if (!cw.accountCache.GetAccount(transfer.to_uid, desAccount)) { // first involved in transacion
+        if (!transfer.to_uid.is<CKeyID>())
+            return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, get account info failed"),
+                            READ_ACCOUNT_FAIL, "bad-read-accountdb");
+
+        desAccount   = CAccount(transfer.to_uid.get<CKeyID>());
+        isNewAccount = true;
+    }
+
+    if (!desAccount.OperateBalance(transfer.coin_symbol, ADD_FREE, transfer.coin_amount)) {
+        return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, transfers[0], failed to add coins in toUid %s account",
+            transfer.to_uid.ToDebugString()), UPDATE_ACCOUNT_FAIL, "failed-add-coins");
+    }
+
+    // the regids of the accounts read are mapped already, GenerateRegID mapped the one of a new sender
+    bool saved = (isNewAccount || desAccount.regid.IsEmpty()) ? cw.accountCache.SaveAccount(desAccount)
+                                                              : cw.accountCache.SetAccount(desAccount.keyid, desAccount);
+    if (!saved)
+        return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, write dest addr %s account info error",
+            transfer.to_uid.ToDebugString()), UPDATE_ACCOUNT_FAIL, "bad-read-accountdb");
+
+    if (!cw.accountCache.SetAccount(srcAccount.keyid, srcAccount))
+        return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, write source addr %s account info error",
+                        txUid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-read-accountdb");
+
+    return true;
+}
+
 string CCoinTransferTx::ToString(CAccountDBCache &accountCache) {
     string transferStr = "";
     for (const auto &transfer : transfers) {
@@ -44,6 +44,10 @@ public:
     }
 
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CBaseCoinTransferTx>(*this); }
+    virtual void GetPrefetchKeys(CTxPrefetchKeys &keys) const {
+        CBaseTx::GetPrefetchKeys(keys);
+        keys.uids.push_back(toUid);
+    }
     virtual string ToString(CAccountDBCache &accountCache);
     virtual Object ToJson(const CAccountDBCache &accountCache) const;
 
@@ -91,11 +95,20 @@ public:
     }
 
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CCoinTransferTx>(*this); }
+    virtual void GetPrefetchKeys(CTxPrefetchKeys &keys) const {
+        CBaseTx::GetPrefetchKeys(keys);
+        for (const auto &transfer : transfers)
+            keys.uids.push_back(transfer.to_uid);
+    }
     virtual string ToString(CAccountDBCache &accountCache);
     virtual Object ToJson(const CAccountDBCache &accountCache) const;
 
     virtual bool CheckTx(CTxExecuteContext &context);
     virtual bool ExecuteTx(CTxExecuteContext &context);
+
+private:
+    // one transfer of a token other than WUSD to another account, without receipts, the fees are paid
+    bool ExecuteSingleTransfer(CTxExecuteContext &context, CAccount &srcAccount);
 };
 
 #endif // TX_COIN_TRANSFER_H
\ No newline at end of file
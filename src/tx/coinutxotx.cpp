@@ -237,15 +237,29 @@ bool CCoinUtxoTx::ExecuteTx(CTxExecuteContext &context) {
         return false;
     }
 
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
+
+    // the spent state of all the inputs at once, before any is spent
+    vector<pair<TxID, uint16_t>> utxoIndexes;
+    utxoIndexes.reserve(vins.size());
+    for (const auto &input : vins)
+        utxoIndexes.emplace_back(input.prev_utxo_txid, input.prev_utxo_out_index);
+
+    vector<bool> unspent;
+    if (!cw.txUtxoCache.GetUtxoTxs(utxoIndexes, unspent))
+        return state.DoS(100, ERRORMSG("CCoinUtxoTx::ExecuteTx, prev utxo spent twice error!"), REJECT_INVALID,
+                        "double-spend-prev-utxo-err");
+
+    for (size_t i = 0; i < unspent.size(); i++) {
+        if (!unspent[i])
+            return state.DoS(100, ERRORMSG("CCoinUtxoTx::ExecuteTx, prev utxo %s:%u already spent error!",
+                            utxoIndexes[i].first.ToString(), utxoIndexes[i].second), REJECT_INVALID,
+                            "double-spend-prev-utxo-err");
+    }
 
     uint64_t totalInAmount = 0;
     uint64_t totalOutAmount = 0;
     for (auto input : vins) {
-        if (!context.pCw->txUtxoCache.GetUtxoTx(std::make_pair(input.prev_utxo_txid, input.prev_utxo_out_index)))
-            return state.DoS(100, ERRORMSG("CCoinUtxoTx::CheckTx, prev utxo already spent error!"), REJECT_INVALID, 
-                            "double-spend-prev-utxo-err");
-
         //load prevUtxoTx from blockchain
         std::shared_ptr<CCoinUtxoTx> pPrevUtxoTx;
         if (!GetUtxoTxFromChain(input.prev_utxo_txid, pPrevUtxoTx))
@@ -485,7 +485,7 @@ bool CUniversalContractInvokeTx::ExecuteTx(CTxExecuteContext &context) {
     if (!GetFuelLimit(*this, context, fuelLimit))
         return false;
 
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
 
     CAccount srcAccount;
     if (!cw.accountCache.GetAccount(txUid, srcAccount)) {
@@ -85,7 +85,7 @@ bool CDelegateVoteTx::ExecuteTx(CTxExecuteContext &context) {
     CRegID &regId = srcAccount.regid;
     cw.delegateCache.GetCandidateVotes(regId, candidateVotesInOut);
 
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
     if (!srcAccount.ProcessCandidateVotes(candidateVotes, candidateVotesInOut, context.height, context.block_time,
                                           cw.accountCache, receipts)) {
         return state.DoS(
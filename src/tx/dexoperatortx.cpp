@@ -160,7 +160,7 @@ bool CDEXOperatorRegisterTx::CheckTx(CTxExecuteContext &context) {
 }
 bool CDEXOperatorRegisterTx::ExecuteTx(CTxExecuteContext &context) {
     CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
     shared_ptr<CAccount> pTxAccount = make_shared<CAccount>();
     if (pTxAccount == nullptr || !cw.accountCache.GetAccount(txUid, *pTxAccount))
         return state.DoS(100, ERRORMSG("CDEXOperatorRegisterTx::ExecuteTx, read tx account by txUid=%s error",
@@ -382,7 +382,7 @@ bool CDEXOperatorUpdateTx::CheckTx(CTxExecuteContext &context) {
 
 bool CDEXOperatorUpdateTx::ExecuteTx(CTxExecuteContext &context) {
     CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
     shared_ptr<CAccount> pTxAccount = make_shared<CAccount>();
     if (pTxAccount == nullptr || !cw.accountCache.GetAccount(txUid, *pTxAccount))
         return state.DoS(100, ERRORMSG("CDEXOperatorUpdateTx::ExecuteTx, read tx account by txUid=%s error",
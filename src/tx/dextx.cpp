@@ -39,7 +39,7 @@ namespace dex {
     bool CheckOrderFee(CBaseTx &baseTx, CTxExecuteContext &context, const CAccount &txAccount) {
 
         return baseTx.CheckFee(context, [&](CTxExecuteContext &context, uint64_t minFee) -> bool {
-            if (GetFeatureForkVersion(context.height) > MAJOR_VER_R3 && baseTx.txUid.is<CPubKey>()) {
+            if (GetFeatureForkVersion(context.height) > MAJOR_VER_R4 && baseTx.txUid.is<CPubKey>()) {
                 auto token = txAccount.GetToken(SYMB::WICC);
 
                 if (token.staked_amount > 0) {
@@ -335,8 +335,7 @@ namespace dex {
                 return context.pState->DoS(100, ERRORMSG("%s, operator signature size=%d invalid",
                     TX_ERR_TITLE, operator_signature.size()), REJECT_INVALID, "bad-operator-sig-size");
             }
-            uint256 sighash = GetHash();
-            if (!::VerifySignature(sighash, operator_signature, operatorAccount.owner_pubkey)) {
+            if (!context.VerifySignature(GetHash(), operator_signature, operatorAccount.owner_pubkey)) {
                 return context.pState->DoS(100, ERRORMSG("%s, check operator signature error",
                     TX_ERR_TITLE), REJECT_INVALID, "bad-operator-signature");
             }
@@ -469,7 +468,7 @@ namespace dex {
         }
 
         // get frozen money
-        vector<CReceipt> receipts;
+        vector<CReceipt> &receipts = context.GetReceipts();
         TokenSymbol frozenSymbol;
         uint64_t frozenAmount = 0;
         if (activeOrder.order_side == ORDER_BUY) {
@@ -511,6 +510,13 @@ namespace dex {
 
     #define DEAL_ITEM_TITLE ERROR_TITLE(tx.GetTxTypeName() + strprintf(", i[%d]", i))
 
+    // the active order dealt by the deal items of a settle tx, written back to the dex db once after all
+    // the deal items
+    struct CDealOrder {
+        CDEXOrderDetail order;
+        bool fulfilled = false; // erase the active order, no later deal item may deal it
+    };
+
     class CDealItemExecuter {
     public:
         typedef CDEXSettleTx::DealItem DealItem;
@@ -522,6 +528,8 @@ namespace dex {
         CTxExecuteContext &context;
         shared_ptr<CAccount> &pTxAccount;
         map<CRegID, shared_ptr<CAccount>> &accountMap;
+        map<uint256, CDealOrder> &orderMap;
+        map<DexID, shared_ptr<DexOperatorDetail>> &operatorMap;
         vector<CReceipt> &receipts;
 
         // found data
@@ -538,9 +546,12 @@ namespace dex {
         CDealItemExecuter(DealItem &dealItemIn, uint32_t index, CDEXSettleTx &txIn,
                           CTxExecuteContext &contextIn, shared_ptr<CAccount> &pTxAccountIn,
                           map<CRegID, shared_ptr<CAccount>> &accountMapIn,
+                          map<uint256, CDealOrder> &orderMapIn,
+                          map<DexID, shared_ptr<DexOperatorDetail>> &operatorMapIn,
                           vector<CReceipt> &receiptsIn)
             : dealItem(dealItemIn), i(index), tx(txIn), context(contextIn),
-              pTxAccount(pTxAccountIn), accountMap(accountMapIn), receipts(receiptsIn) {}
+              pTxAccount(pTxAccountIn), accountMap(accountMapIn), orderMap(orderMapIn),
+              operatorMap(operatorMapIn), receipts(receiptsIn) {}
 
         /* process flow for settle tx
         1. get and check buyDealOrder and sellDealOrder
@@ -630,7 +641,7 @@ namespace dex {
                 }
         */
         bool Execute() {
-            CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
+            CValidationState &state = *context.pState;
 
                 //1.1 get and check buyDealOrder and sellDealOrder
             if (!GetDealOrder(dealItem.buyOrderId, ORDER_BUY, buyOrder)) return false;
@@ -642,10 +653,10 @@ namespace dex {
             if (!GetAccount(sellOrder.user_regid, pSellOrderAccount)) return false;
 
             // 1.3 get operator info
-            if (!GetDexOperator(context, buyOrder.dex_id, pBuyOperatorDetail, DEAL_ITEM_TITLE)) return false;
+            if (!GetOperator(buyOrder.dex_id, pBuyOperatorDetail)) return false;
             if (!GetAccount(pBuyOperatorDetail->fee_receiver_regid, pBuyMatchAccount)) return false;
 
-            if (!GetDexOperator(context, sellOrder.dex_id, pSellOperatorDetail, DEAL_ITEM_TITLE)) return false;
+            if (!GetOperator(sellOrder.dex_id, pSellOperatorDetail)) return false;
             if (!GetAccount(pSellOperatorDetail->fee_receiver_regid, pSellMatchAccount)) return false;
 
             // 1.4 get taker side
@@ -849,34 +860,10 @@ namespace dex {
                         assert(buyOrder.coin_amount == buyOrder.total_deal_coin_amount);
                     }
                 }
-                // erase active order
-                if (!cw.dexCache.EraseActiveOrder(dealItem.buyOrderId, buyOrder)) {
-                    return state.DoS(100, ERRORMSG("%s, finish the active buy order failed! deal_info={%s}",
-                        DEAL_ITEM_TITLE, dealItem.ToString()),
-                        REJECT_INVALID, "write-dexdb-failed");
-                }
-            } else {
-                if (!cw.dexCache.UpdateActiveOrder(dealItem.buyOrderId, buyOrder)) {
-                    return state.DoS(100, ERRORMSG("%s, update active buy order failed! deal_info={%s}",
-                        DEAL_ITEM_TITLE, dealItem.ToString()),
-                        REJECT_INVALID, "write-dexdb-failed");
-                }
-            }
-
-            if (sellResidualAmount == 0) { // sell order fulfilled
-                // erase active order
-                if (!cw.dexCache.EraseActiveOrder(dealItem.sellOrderId, sellOrder)) {
-                    return state.DoS(100, ERRORMSG("%s, finish active sell order failed! deal_info={%s}",
-                        DEAL_ITEM_TITLE, dealItem.ToString()),
-                        REJECT_INVALID, "write-dexdb-failed");
-                }
-            } else {
-                if (!cw.dexCache.UpdateActiveOrder(dealItem.sellOrderId, sellOrder)) {
-                    return state.DoS(100, ERRORMSG("%s, update active sell order failed! deal_info={%s}",
-                        DEAL_ITEM_TITLE, dealItem.ToString()),
-                        REJECT_INVALID, "write-dexdb-failed");
-                }
             }
+            // the orders are saved to the dex db by the settle tx after all deal items
+            orderMap[dealItem.buyOrderId] = {buyOrder, buyResidualAmount == 0};
+            orderMap[dealItem.sellOrderId] = {sellOrder, sellResidualAmount == 0};
             return true;
         }
 
@@ -902,7 +889,15 @@ namespace dex {
 
         bool GetDealOrder(const uint256 &orderId, const OrderSide orderSide,
                           CDEXOrderDetail &dealOrder) {
-            if (!context.pCw->dexCache.GetActiveOrder(orderId, dealOrder))
+            auto orderIt = orderMap.find(orderId);
+            bool found = false;
+            if (orderIt != orderMap.end()) {
+                found = !orderIt->second.fulfilled;
+                if (found) dealOrder = orderIt->second.order;
+            } else {
+                found = context.pCw->dexCache.GetActiveOrder(orderId, dealOrder);
+            }
+            if (!found)
                 return context.pState->DoS(100, ERRORMSG("%s, get active order failed! i=%d, orderId=%s", DEAL_ITEM_TITLE,
                     orderId.ToString()), REJECT_INVALID,
                     strprintf("get-active-order-failed, i=%d, order_id=%s", i, orderId.ToString()));
@@ -958,6 +953,18 @@ namespace dex {
             return ratio;
         }
 
+        bool GetOperator(const DexID &dexId, shared_ptr<DexOperatorDetail> &pOperatorDetail) {
+
+            auto operatorIt = operatorMap.find(dexId);
+            if (operatorIt != operatorMap.end()) {
+                pOperatorDetail = operatorIt->second;
+            } else {
+                if (!GetDexOperator(context, dexId, pOperatorDetail, DEAL_ITEM_TITLE)) return false;
+                operatorMap[dexId] = pOperatorDetail;
+            }
+            return true;
+        }
+
         bool GetAccount(const CRegID &regid, shared_ptr<CAccount> &pAccount) {
 
             auto accountIt = accountMap.find(regid);
@@ -1071,7 +1078,7 @@ namespace dex {
     bool CDEXSettleTx::ExecuteTx(CTxExecuteContext &context) {
 
         CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
-        vector<CReceipt> receipts;
+        vector<CReceipt> &receipts = context.GetReceipts();
 
         shared_ptr<CAccount> pTxAccount = make_shared<CAccount>();
         if (!cw.accountCache.GetAccount(txUid, *pTxAccount)) {
@@ -1084,17 +1091,36 @@ namespace dex {
                             UPDATE_ACCOUNT_FAIL, "operate-minus-account-failed");
         }
 
+        // the accounts, orders and operators are loaded once and the accounts and orders are saved once,
+        // however many deal items of the tx touch them
         map<CRegID, shared_ptr<CAccount>> accountMap = {
             {pTxAccount->regid, pTxAccount}
         };
+        map<uint256, CDealOrder> orderMap;
+        map<DexID, shared_ptr<DexOperatorDetail>> operatorMap;
         for (size_t i = 0; i < dealItems.size(); i++) {
             auto &dealItem = dealItems[i];
-            CDealItemExecuter dealItemExec(dealItem, i, *this, context, pTxAccount, accountMap, receipts);
+            CDealItemExecuter dealItemExec(dealItem, i, *this, context, pTxAccount, accountMap, orderMap,
+                                           operatorMap, receipts);
             if (!dealItemExec.Execute()) {
                 return false;
             }
         }
 
+        // save orders, erase the fulfilled ones
+        for (const auto &orderItem : orderMap) {
+            const CDealOrder &dealOrder = orderItem.second;
+            if (dealOrder.fulfilled) {
+                if (!cw.dexCache.EraseActiveOrder(orderItem.first, dealOrder.order))
+                    return state.DoS(100, ERRORMSG("%s, finish the active order failed! order_id=%s",
+                        TX_ERR_TITLE, orderItem.first.ToString()), REJECT_INVALID, "write-dexdb-failed");
+            } else {
+                if (!cw.dexCache.UpdateActiveOrder(orderItem.first, dealOrder.order))
+                    return state.DoS(100, ERRORMSG("%s, update the active order failed! order_id=%s",
+                        TX_ERR_TITLE, orderItem.first.ToString()), REJECT_INVALID, "write-dexdb-failed");
+            }
+        }
+
         // save accounts, include tx account
         for (auto accountItem : accountMap) {
             auto pAccount = accountItem.second;
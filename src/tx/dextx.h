@@ -473,6 +473,10 @@ namespace dex {
         }
 
         virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CDEXCancelOrderTx>(*this); }
+        virtual void GetPrefetchKeys(CTxPrefetchKeys &keys) const {
+            CBaseTx::GetPrefetchKeys(keys);
+            keys.orderIds.push_back(order_id);
+        }
         virtual string ToString(CAccountDBCache &accountCache); //logging usage
         virtual Object ToJson(const CAccountDBCache &accountCache) const; //json-rpc usage
 
@@ -532,6 +536,13 @@ namespace dex {
         }
 
         virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CDEXSettleTx>(*this); }
+        virtual void GetPrefetchKeys(CTxPrefetchKeys &keys) const {
+            CBaseTx::GetPrefetchKeys(keys);
+            for (const auto &item : dealItems) {
+                keys.orderIds.push_back(item.buyOrderId);
+                keys.orderIds.push_back(item.sellOrderId);
+            }
+        }
 
         virtual string ToString(CAccountDBCache &accountCache); //logging usage
         virtual Object ToJson(const CAccountDBCache &accountCache) const; //json-rpc usage
@@ -0,0 +1,96 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "feeestimator.h"
+
+#include "config/const.h"
+#include "config/txbase.h"
+
+#include <algorithm>
+
+using namespace std;
+
+CFeeEstimator::CFeeEstimator() : bestHeight(0) {
+    for (double bound = MIN_RELAY_TX_FEE; bound <= MAX_FEE_ESTIMATE_RATE; bound *= FEE_ESTIMATE_BUCKET_SPACING)
+        bucketBounds.push_back(bound);
+}
+
+uint32_t CFeeEstimator::GetBucket(double feePerKb) const {
+    // the fee rates below the first bound are in the first bucket
+    auto it = upper_bound(bucketBounds.begin(), bucketBounds.end(), feePerKb);
+    return it == bucketBounds.begin() ? 0 : it - bucketBounds.begin() - 1;
+}
+
+void CFeeEstimator::AddTx(const uint256 &txid, const TokenSymbol &feeSymbol, double feePerKb, int32_t height) {
+    if (!kFeeSymbolSet.count(feeSymbol))
+        return;
+
+    // the stats of a symbol are made by its first tx, the mempool is constructed before kFeeSymbolSet
+    auto it = stats.find(feeSymbol);
+    if (it == stats.end()) {
+        it = stats.emplace(feeSymbol, CBucketStats()).first;
+        it->second.packed.assign(MAX_FEE_ESTIMATE_TARGET, vector<double>(bucketBounds.size(), 0));
+        it->second.total.assign(bucketBounds.size(), 0);
+    }
+    trackedTxs[txid] = {&it->second, GetBucket(feePerKb), height};
+}
+
+void CFeeEstimator::RemoveTx(const uint256 &txid) { trackedTxs.erase(txid); }
+
+void CFeeEstimator::ProcessBlock(int32_t height, const vector<uint256> &txids) {
+    if (height <= bestHeight)
+        return;
+    bestHeight = height;
+
+    for (auto &item : stats) {
+        for (auto &packed : item.second.packed) {
+            for (auto &count : packed)
+                count *= FEE_ESTIMATE_DECAY;
+        }
+        for (auto &count : item.second.total)
+            count *= FEE_ESTIMATE_DECAY;
+    }
+
+    for (const auto &txid : txids) {
+        auto it = trackedTxs.find(txid);
+        if (it == trackedTxs.end())
+            continue;
+
+        const CTrackedTx &tx = it->second;
+        uint32_t delay       = max<int32_t>(height - tx.height, 1);
+        for (uint32_t target = delay; target <= MAX_FEE_ESTIMATE_TARGET; target++)
+            tx.pStats->packed[target - 1][tx.bucket] += 1;
+        tx.pStats->total[tx.bucket] += 1;
+        trackedTxs.erase(it);
+    }
+}
+
+double CFeeEstimator::Estimate(uint32_t targetBlocks, const TokenSymbol &feeSymbol) const {
+    auto itStats = stats.find(feeSymbol);
+    if (targetBlocks == 0 || targetBlocks > MAX_FEE_ESTIMATE_TARGET || itStats == stats.end())
+        return -1;
+
+    const CBucketStats &bucketStats = itStats->second;
+    vector<double> failed(bucketBounds.size(), 0);
+    for (const auto &item : trackedTxs) {
+        if (item.second.pStats == &bucketStats && bestHeight - item.second.height >= (int32_t)targetBlocks)
+            failed[item.second.bucket] += 1;
+    }
+
+    double packed = 0, total = 0;
+    int32_t passedBucket = -1;
+    for (int32_t bucket = bucketBounds.size() - 1; bucket >= 0; bucket--) {
+        packed += bucketStats.packed[targetBlocks - 1][bucket];
+        total += bucketStats.total[bucket] + failed[bucket];
+        if (total < FEE_ESTIMATE_SUFFICIENT_TXS)
+            continue;
+
+        if (packed / total < FEE_ESTIMATE_SUCCESS_PCT)
+            break;
+
+        passedBucket = bucket;
+        packed = total = 0;
+    }
+    return passedBucket < 0 ? -1 : bucketBounds[passedBucket];
+}
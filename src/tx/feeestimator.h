@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TX_FEEESTIMATOR_H
+#define TX_FEEESTIMATOR_H
+
+#include <stdint.h>
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "commons/types.h"
+#include "commons/uint256.h"
+
+// the fee rate buckets start at MIN_RELAY_TX_FEE per kb, each one FEE_ESTIMATE_BUCKET_SPACING times the last
+static const double FEE_ESTIMATE_BUCKET_SPACING = 1.1;
+static const double MAX_FEE_ESTIMATE_RATE       = 1e9;  // per kb, 10 coins
+// the most blocks a tx may wait in an estimate
+static const uint32_t MAX_FEE_ESTIMATE_TARGET = 100;
+// the weight of the history kept by each block, so the estimates follow the last few hundred blocks
+static const double FEE_ESTIMATE_DECAY = 0.998;
+// the share of the txs of a fee rate packed within the target for the fee rate to pass
+static const double FEE_ESTIMATE_SUCCESS_PCT = 0.85;
+// the decayed count of the txs a fee rate range needs for an estimate
+static const double FEE_ESTIMATE_SUFFICIENT_TXS = 10;
+
+/**
+ * Estimator of the fee per kb with which a tx is packed within a number of blocks, for each of the fee
+ * symbols of kFeeSymbolSet. The txs are tracked from entering the mempool, at the fee per kb of their
+ * TxPriority, until a block packs them: the block counts each of them in the bucket of its fee rate as
+ * packed within its delay and all the later targets. The txs waiting in the mempool longer than a target
+ * count as failed for it.
+ *
+ * An estimate takes the ranges of buckets from the highest fee rate down, each range just large enough to
+ * have FEE_ESTIMATE_SUFFICIENT_TXS, and stops at the first range whose txs were not packed in time.
+ *
+ * Protected by the cs of the mempool.
+ */
+class CFeeEstimator {
+public:
+    CFeeEstimator();
+
+    // the tx entered the mempool on the tip of the height
+    void AddTx(const uint256 &txid, const TokenSymbol &feeSymbol, double feePerKb, int32_t height);
+    // the tx left the mempool without a block, it is not counted
+    void RemoveTx(const uint256 &txid);
+    void ClearTxs() { trackedTxs.clear(); }
+    // the block connected at the height packed the txs, once per height, a block of a fork is skipped
+    void ProcessBlock(int32_t height, const std::vector<uint256> &txids);
+
+    // the lowest fee per kb packed within targetBlocks, -1 without enough txs
+    double Estimate(uint32_t targetBlocks, const TokenSymbol &feeSymbol) const;
+
+private:
+    struct CBucketStats {
+        std::vector<std::vector<double>> packed;  // [target - 1][bucket], the txs packed within the target
+        std::vector<double> total;                // [bucket], all the txs packed
+    };
+
+    struct CTrackedTx {
+        CBucketStats *pStats;
+        uint32_t bucket;
+        int32_t height;
+    };
+
+    uint32_t GetBucket(double feePerKb) const;
+
+    std::vector<double> bucketBounds;  // the lowest fee per kb of each bucket
+    std::map<TokenSymbol, CBucketStats> stats;
+    std::unordered_map<uint256, CTrackedTx, CSaltedUint256Hasher> trackedTxs;
+    int32_t bestHeight;
+};
+
+#endif  // TX_FEEESTIMATOR_H
@@ -61,11 +61,14 @@ bool CMulsigTx::CheckTx(CTxExecuteContext &context) {
                          "signature-number-out-of-range");
     }
 
-    CAccount account;
+    // resolve all the signers first, so that a duplicated account or too few signatures is
+    // rejected before any verification, then verify the signatures against the cached sighash
     set<CPubKey> pubKeys;
-    uint256 sighash = GetHash();
-    uint8_t valid   = 0;
+    vector<CPubKey> signerPubKeys;
+    signerPubKeys.reserve(signaturePairs.size());
+    uint8_t signedCount = 0;
     for (const auto &item : signaturePairs) {
+        CAccount account;
         if (!cw.accountCache.GetAccount(item.regid, account))
             return state.DoS(100,
                              ERRORMSG("CMulsigTx::CheckTx, account: %s, read account failed", item.regid.ToString()),
@@ -77,28 +80,32 @@ bool CMulsigTx::CheckTx(CTxExecuteContext &context) {
                     100, ERRORMSG("CMulsigTx::CheckTx, account: %s, signature size invalid", item.regid.ToString()),
                     REJECT_INVALID, "bad-tx-sig-size");
             }
-
-            if (!::VerifySignature(sighash, item.signature, account.owner_pubkey)) {
-                return state.DoS(
-                    100, ERRORMSG("CMulsigTx::CheckTx, account: %s, VerifySignature failed", item.regid.ToString()),
-                    REJECT_INVALID, "bad-signscript-check");
-            } else {
-                ++valid;
-            }
+            ++signedCount;
         }
 
         pubKeys.insert(account.owner_pubkey);
+        signerPubKeys.push_back(account.owner_pubkey);
     }
 
     if (pubKeys.size() != signaturePairs.size()) {
         return state.DoS(100, ERRORMSG("CMulsigTx::CheckTx, duplicated account"), REJECT_INVALID, "duplicated-account");
     }
 
-    if (valid < required) {
-        return state.DoS(100, ERRORMSG("CMulsigTx::CheckTx, not enough valid signatures, %u vs %u", valid, required),
+    if (signedCount < required) {
+        return state.DoS(100, ERRORMSG("CMulsigTx::CheckTx, not enough valid signatures, %u vs %u", signedCount, required),
                          REJECT_INVALID, "not-enough-valid-signatures");
     }
 
+    uint256 sighash = GetHash();
+    for (size_t i = 0; i < signaturePairs.size(); i++) {
+        const auto &item = signaturePairs[i];
+        if (!item.signature.empty() && !context.VerifySignature(sighash, item.signature, signerPubKeys[i])) {
+            return state.DoS(
+                100, ERRORMSG("CMulsigTx::CheckTx, account: %s, VerifySignature failed", item.regid.ToString()),
+                REJECT_INVALID, "bad-signscript-check");
+        }
+    }
+
     CMulsigScript script;
     script.SetMultisig(required, pubKeys);
     keyId = script.GetID();
@@ -130,7 +137,7 @@ bool CMulsigTx::ExecuteTx(CTxExecuteContext &context) {
                         keyId.ToAddress()), UPDATE_ACCOUNT_FAIL, "insufficient-coin_amount");
     }
 
-    vector<CReceipt> receipts;
+    vector<CReceipt> &receipts = context.GetReceipts();
 
     for (size_t i = 0; i < transfers.size(); i++) {
         const auto &transfer = transfers[i];
@@ -298,13 +305,7 @@ Object CMulsigTx::ToJson(const CAccountDBCache &accountCache) const {
     return result;
 }
 
-bool CMulsigTx::GetInvolvedKeyIds(CCacheWrapper &cw, set<CKeyID> &keyIds) {
-    CKeyID keyId;
-    for (const auto &item : signaturePairs) {
-        if (!cw.accountCache.GetKeyId(CUserID(item.regid), keyId))
-            return false;
-        keyIds.insert(keyId);
-    }
-
-    return true;
+void CMulsigTx::GetInvolvedUids(vector<CUserID> &uids) const {
+    for (const auto &item : signaturePairs)
+        uids.push_back(CUserID(item.regid));
 }
\ No newline at end of file
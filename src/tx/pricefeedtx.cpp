@@ -61,7 +61,7 @@ bool CPriceFeedTx::ExecuteTx(CTxExecuteContext &context) {
                         txUid.ToString()), PRICE_FEED_FAIL, "bad-read-accountdb");
 
     CRegID sendRegId = txUid.get<CRegID>();
-    if (!cw.delegateCache.IsActiveDelegate(sendRegId.ToString())) { // must be a delegate
+    if (!cw.delegateCache.IsActiveDelegate(sendRegId)) { // must be a delegate
         return state.DoS(100, ERRORMSG("CPriceFeedTx::ExecuteTx, txUid %s account is not a delegate error",
                         txUid.ToString()), PRICE_FEED_FAIL, "account-isn't-delegate");
     }
@@ -88,7 +88,7 @@ bool CPriceFeedTx::ExecuteTx(CTxExecuteContext &context) {
     }
 
     // update the price feed cache accordingly
-    if (!cw.ppCache.AddPrice(context.height, txUid.get<CRegID>(), price_points)) {
+    if (!cw.ppCache.AddPrice(context.height, sendRegId, price_points)) {
         return state.DoS(100, ERRORMSG("CPriceFeedTx::ExecuteTx, txUid %s account duplicated price feed exits",
                         txUid.ToString()), PRICE_FEED_FAIL, "duplicated-pricefeed");
     }
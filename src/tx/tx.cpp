@@ -39,8 +39,17 @@ string GetTxType(const TxType txType) {
         return "";
 }
 
+static thread_local CSysParamDBCache *t_pMinerFeeCache = nullptr;
+
+CMinerFeeCacheScope::CMinerFeeCacheScope(CSysParamDBCache *pCache) : pPrevCache(t_pMinerFeeCache) {
+    t_pMinerFeeCache = pCache;
+}
+
+CMinerFeeCacheScope::~CMinerFeeCacheScope() { t_pMinerFeeCache = pPrevCache; }
+
 bool GetTxMinFee(const TxType nTxType, int height, const TokenSymbol &symbol, uint64_t &feeOut) {
-    if (pCdMan->pSysParamCache->GetMinerFee(nTxType, symbol, feeOut))
+    CSysParamDBCache *pSysParamCache = t_pMinerFeeCache != nullptr ? t_pMinerFeeCache : pCdMan->pSysParamCache;
+    if (pSysParamCache->GetMinerFee(nTxType, symbol, feeOut))
         return true ;
 
     const auto &iter = kTxFeeTable.find(nTxType);
@@ -140,12 +149,14 @@ string CBaseTx::ToString(CAccountDBCache &accountCache) {
                      txUid.get<CPubKey>().GetKeyId().ToAddress(), valid_height);
 }
 
-bool CBaseTx::GetInvolvedKeyIds(CCacheWrapper &cw, set<CKeyID> &keyIds) {
-    return AddInvolvedKeyIds({txUid}, cw, keyIds);
+bool CBaseTx::GetInvolvedKeyIds(CCacheWrapper &cw, set<CKeyID> &keyIds) const {
+    vector<CUserID> uids;
+    GetInvolvedUids(uids);
+    return AddInvolvedKeyIds(uids, cw, keyIds);
 }
 
-bool CBaseTx::AddInvolvedKeyIds(vector<CUserID> uids, CCacheWrapper &cw, set<CKeyID> &keyIds) {
-    for (auto uid : uids) {
+bool CBaseTx::AddInvolvedKeyIds(const vector<CUserID> &uids, CCacheWrapper &cw, set<CKeyID> &keyIds) {
+    for (const auto &uid : uids) {
         CKeyID keyId;
         if (!cw.accountCache.GetKeyId(uid, keyId))
             return false;
@@ -194,7 +205,7 @@ bool CBaseTx::CheckFee(CTxExecuteContext &context, function<bool(CTxExecuteConte
 }
 
 bool CBaseTx::CheckMinFee(CTxExecuteContext &context, uint64_t minFee) const {
-    if (GetFeatureForkVersion(context.height) > MAJOR_VER_R3 && txUid.is<CPubKey>()) {
+    if (GetFeatureForkVersion(context.height) > MAJOR_VER_R4 && txUid.is<CPubKey>()) {
         minFee = 2 * minFee;
     }
     if (llFees < minFee){
@@ -206,13 +217,25 @@ bool CBaseTx::CheckMinFee(CTxExecuteContext &context, uint64_t minFee) const {
 }
 
 
+bool CTxExecuteContext::VerifySignature(const uint256 &sigHash, const vector<uint8_t> &signature,
+                                        const CPubKey &pubKey) {
+    if (skip_sig_check || (pPreCheckMemo != nullptr && pPreCheckMemo->HaveVerifiedSig(signature, pubKey)))
+        return true;
+
+    if (!::VerifySignature(sigHash, signature, pubKey, erase_sig_cache))
+        return false;
+
+    if (pPreCheckMemo != nullptr)
+        pPreCheckMemo->AddVerifiedSig(signature, pubKey);
+    return true;
+}
+
 bool CBaseTx::VerifySignature(CTxExecuteContext &context, const CPubKey &pubkey) {
     if (!CheckSignatureSize(signature)) {
         return context.pState->DoS(100, ERRORMSG("%s, tx signature size invalid", BASE_TX_TITLE), REJECT_INVALID,
                          "bad-tx-sig-size");
     }
-    uint256 sighash = GetHash();
-    if (!::VerifySignature(sighash, signature, pubkey)) {
+    if (!context.VerifySignature(GetHash(), signature, pubkey)) {
         return context.pState->DoS(100, ERRORMSG("%s, tx signature error", BASE_TX_TITLE),
             REJECT_INVALID, "bad-tx-signature");
     }
@@ -11,6 +11,7 @@
 #include "entities/account.h"
 #include "entities/asset.h"
 #include "entities/id.h"
+#include "entities/receipt.h"
 #include "config/configuration.h"
 #include "config/txbase.h"
 #include "config/scoin.h"
@@ -52,10 +53,22 @@ inline string to_string(transaction_status_type type){
 
 class CCacheWrapper;
 class CValidationState;
+class CSysParamDBCache;
 
 string GetTxType(const TxType txType);
 bool GetTxMinFee(const TxType nTxType, int height, const TokenSymbol &symbol, uint64_t &feeOut);
 
+/** Let GetTxMinFee read the miner fees of the calling thread from pCache instead of pCdMan for the scope,
+ *  e.g. the miner packing without cs_main reads them from the tip snapshot */
+class CMinerFeeCacheScope {
+public:
+    explicit CMinerFeeCacheScope(CSysParamDBCache *pCache);
+    ~CMinerFeeCacheScope();
+
+private:
+    CSysParamDBCache *pPrevCache;
+};
+
 inline const string& GetTxTypeName(TxType txType) {
     auto it = kTxFeeTable.find(txType);
     if (it != kTxFeeTable.end())
@@ -63,6 +76,38 @@ inline const string& GetTxTypeName(TxType txType) {
     return EMPTY_STRING;
 }
 
+/** The signatures of a mempool tx verified when it was accepted, shared by its mempool entry with the CheckTx
+ *  calls of the miner packing it. The signature cache is bounded and a big mempool evicts its own txs from it,
+ *  the memo is kept with the tx. It is sealed before the tx enters the pool and is read-only afterwards. */
+class CTxPreCheckMemo {
+public:
+    bool HaveVerifiedSig(const vector<uint8_t> &signature, const CPubKey &pubKey) const {
+        for (const auto &item : verifiedSigs) {
+            if (item.first == signature && item.second == pubKey)
+                return true;
+        }
+        return false;
+    }
+
+    void AddVerifiedSig(const vector<uint8_t> &signature, const CPubKey &pubKey) {
+        if (!fSealed)
+            verifiedSigs.emplace_back(signature, pubKey);
+    }
+
+    void Seal() { fSealed = true; }
+
+    size_t GetUsageSize() const {
+        size_t usage = sizeof(CTxPreCheckMemo) + verifiedSigs.capacity() * sizeof(verifiedSigs[0]);
+        for (const auto &item : verifiedSigs)
+            usage += item.first.capacity();
+        return usage;
+    }
+
+private:
+    bool fSealed = false;
+    vector<pair<vector<uint8_t>, CPubKey>> verifiedSigs;  // the signatures and the keys they were verified with
+};
+
 class CTxExecuteContext {
 public:
     int32_t                       height;
@@ -73,6 +118,9 @@ public:
     CCacheWrapper*                pCw;
     CValidationState*             pState;
     transaction_status_type       transaction_status;
+    bool                          erase_sig_cache;  // consume the signature cache entries on hit, set by CheckBlock
+    bool                          skip_sig_check;   // the block is under a finality certificate, set by CheckBlock
+    CTxPreCheckMemo*              pPreCheckMemo;    // the signatures verified before, the tx comes from the mempool
 
     CTxExecuteContext()
         : height(0),
@@ -82,7 +130,10 @@ public:
           prev_block_time(0),
           pCw(nullptr),
           pState(nullptr),
-          transaction_status(transaction_status_type::syncing){}
+          transaction_status(transaction_status_type::syncing),
+          erase_sig_cache(false),
+          skip_sig_check(false),
+          pPreCheckMemo(nullptr){}
 
     CTxExecuteContext(const int32_t heightIn, const int32_t indexIn, const uint32_t fuelRateIn,
                       const uint32_t blockTimeIn, const uint32_t preBlockTimeIn,
@@ -94,7 +145,26 @@ public:
           prev_block_time(preBlockTimeIn),
           pCw(pCwIn),
           pState(pStateIn),
-          transaction_status(trx_status){}
+          transaction_status(trx_status),
+          erase_sig_cache(false),
+          skip_sig_check(false),
+          pPreCheckMemo(nullptr){}
+
+    // verify a signature of the tx, through the memo first, then the signature cache
+    bool VerifySignature(const uint256 &sigHash, const vector<uint8_t> &signature, const CPubKey &pubKey);
+
+    // the receipts of the tx, in a vector reused from the previous txs of the thread
+    vector<CReceipt> &GetReceipts() { return receiptBuffer.Get(); }
+
+private:
+    CReceiptBuffer receiptBuffer;
+};
+
+// the keys of the state read by a tx which are known from its fields, read ahead by CBlockPrefetcher
+struct CTxPrefetchKeys {
+    vector<CUserID> uids;      // accounts
+    vector<uint256> cdpIds;
+    vector<uint256> orderIds;  // active dex orders
 };
 
 class CBaseTx {
@@ -112,6 +182,7 @@ public:
     uint64_t nRunStep;     //!< only in memory
     int32_t nFuelRate;     //!< only in memory
     mutable TxID sigHash;  //!< only in memory
+    mutable uint32_t nSerializeSize = 0;  //!< only in memory, 0 until cached by CacheTxSize
 
 public:
     CBaseTx(int32_t nVersionIn, TxType nTxTypeIn, CUserID txUidIn, int32_t nValidHeightIn, uint64_t llFeesIn) :
@@ -149,16 +220,28 @@ public:
 
     virtual uint32_t GetSerializeSize(int32_t nType, int32_t nVersion) const { return 0; }
 
+    // The serialized size, the same for every stream type and version as no tx serializes by them.
+    // It is cached by CacheTxSize only, i.e. for the txs of the mempool and of the checked blocks
+    // which are never changed again, and computed on each call otherwise.
+    uint32_t GetTxSize() const {
+        return nSerializeSize != 0 ? nSerializeSize : GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+    }
+    void CacheTxSize() const { nSerializeSize = GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION); }
+
     virtual uint64_t GetFuel(int32_t height, uint32_t nFuelRate);
     virtual double GetPriority() const {
-        return TRANSACTION_PRIORITY_CEILING / GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+        return TRANSACTION_PRIORITY_CEILING / GetTxSize();
     }
     virtual void SerializeForHash(CHashWriter &hw) const = 0;
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const           = 0;
     virtual string ToString(CAccountDBCache &accountCache)            = 0;
     virtual Object ToJson(const CAccountDBCache &accountCache) const;
 
-    virtual bool GetInvolvedKeyIds(CCacheWrapper &cw, set<CKeyID> &keyIds);
+    // the uids of the accounts involved in the tx, the sender by default
+    virtual void GetInvolvedUids(vector<CUserID> &uids) const { uids.push_back(txUid); }
+    bool GetInvolvedKeyIds(CCacheWrapper &cw, set<CKeyID> &keyIds) const;
+    // the involved accounts by default, the txs naming other accounts, CDPs or orders add them
+    virtual void GetPrefetchKeys(CTxPrefetchKeys &keys) const { GetInvolvedUids(keys.uids); }
 
     virtual bool CheckTx(CTxExecuteContext &context)   = 0;
     virtual bool ExecuteTx(CTxExecuteContext &context) = 0;
@@ -176,7 +259,7 @@ public:
     const string& GetTxTypeName() const { return ::GetTxTypeName(nTxType); }
 public:
     static unsigned int GetSerializePtrSize(const std::shared_ptr<CBaseTx> &pBaseTx, int nType, int nVersion){
-        return pBaseTx->GetSerializeSize(nType, nVersion) + 1;
+        return pBaseTx->GetTxSize() + 1;
     }
 
     template<typename Stream>
@@ -194,7 +277,7 @@ protected:
     bool CheckSignatureSize(const vector<unsigned char> &signature) const;
     bool CheckCoinRange(const TokenSymbol &symbol, const int64_t amount) const;
 
-    static bool AddInvolvedKeyIds(vector<CUserID> uids, CCacheWrapper &cw, set<CKeyID> &keyIds);
+    static bool AddInvolvedKeyIds(const vector<CUserID> &uids, CCacheWrapper &cw, set<CKeyID> &keyIds);
 };
 
 /**################################ Universal Coin Transfer ########################################**/
@@ -8,13 +8,62 @@
 #include "main.h"
 #include "persistence/txdb.h"
 #include "tx/tx.h"
-#include "miner/miner.h"
+#include "chain/parallelexecutor.h"
+#include "persistence/blockundo.h"
+
+#include <algorithm>
+#include <optional>
 
 using namespace std;
 
+// the heap bytes of a node of a map or set holding T, i.e. the color, parent and children before the value
+template <typename T>
+static constexpr size_t GetTreeNodeUsage() {
+    return sizeof(T) + 4 * sizeof(void *);
+}
+
+// the heap bytes of a node of an unordered map holding T, i.e. the next pointer, the cached hash and a bucket slot
+template <typename T>
+static constexpr size_t GetHashNodeUsage() {
+    return sizeof(T) + 4 * sizeof(void *);
+}
+
+// the shared tx with its control block, its vectors and strings estimated by their serialized size,
+// and the nodes of the entry in memPoolTxs, txPriorities, priorityIters and senderTxs
+static size_t GetEntryUsage(uint32_t txSize) {
+    return sizeof(CBaseTx) + 2 * sizeof(void *) + txSize + GetTreeNodeUsage<pair<const uint256, CTxMemPoolEntry>>() +
+           GetTreeNodeUsage<TxPriority>() + GetHashNodeUsage<pair<const uint256, set<TxPriority>::iterator>>() +
+           GetTreeNodeUsage<pair<const uint64_t, uint256>>();
+}
+
+size_t CMemPoolTxAccess::GetUsageSize() const {
+    size_t usage = sizeof(CMemPoolTxAccess);
+    for (const auto &key : tracker.readKeys)
+        usage += GetTreeNodeUsage<string>() + key.capacity();
+    for (const auto &key : tracker.writeKeys)
+        usage += GetTreeNodeUsage<string>() + key.capacity();
+    usage += (tracker.readPrefixes.size() + tracker.writePrefixes.size()) * GetTreeNodeUsage<dbk::PrefixType>();
+    for (const auto &item : writes.GetMap()) {
+        usage += GetTreeNodeUsage<CDbOpLogs>() + item.second.capacity() * sizeof(CDbOpLog);
+        for (const auto &opLog : item.second)
+            usage += opLog.GetKey().capacity() + opLog.GetValue().capacity();
+    }
+    return usage;
+}
+
+TxPriority::TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn,
+                       const std::shared_ptr<CTxPreCheckMemo> &spPreCheckMemoIn)
+    : priority(priorityIn),
+      feePerKb(feePerKbIn),
+      baseTx(baseTxIn),
+      txid(baseTxIn->GetHash()),
+      spPreCheckMemo(spPreCheckMemoIn) {}
+
 CTxMemPoolEntry::CTxMemPoolEntry() {
-    nTxSize   = 0;
-    dPriority = 0.0;
+    nTxSize    = 0;
+    dPriority  = 0.0;
+    nUsageSize = 0;
+    nSequence  = 0;
 
     nTime   = 0;
     height = 0;
@@ -23,20 +72,46 @@ CTxMemPoolEntry::CTxMemPoolEntry() {
 CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height) : nTime(time), height(height) {
     pTx       = pBaseTx->GetNewInstance();
     nFees     = pTx->GetFees();
-    nTxSize   = ::GetSerializeSize(*pTx, SER_NETWORK, PROTOCOL_VERSION);
-    dPriority = pTx->GetPriority();
+    pTx->CacheTxSize();  // the copies taken by the miner keep it
+    nTxSize    = pTx->GetTxSize();
+    dPriority  = pTx->GetPriority();
+    nUsageSize = GetEntryUsage(nTxSize);
+    nSequence  = 0;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry &other) {
-    this->pTx       = other.pTx->GetNewInstance();
-    this->nFees     = other.nFees;
-    this->nTxSize   = other.nTxSize;
-    this->dPriority = other.dPriority;
+    this->pTx        = other.pTx;
+    this->nFees      = other.nFees;
+    this->nTxSize    = other.nTxSize;
+    this->dPriority  = other.dPriority;
+    this->nUsageSize = other.nUsageSize;
+    this->spPreCheckMemo = other.spPreCheckMemo;
+    this->spAccess       = other.spAccess;
+    this->nSequence      = other.nSequence;
+    this->senderKeyId    = other.senderKeyId;
 
     this->nTime  = other.nTime;
     this->height = other.height;
 }
 
+void CTxMemPoolEntry::SetPreCheckMemo(const std::shared_ptr<CTxPreCheckMemo> &spMemo) {
+    if (spPreCheckMemo)
+        nUsageSize -= spPreCheckMemo->GetUsageSize();
+    spPreCheckMemo = spMemo;
+    if (spPreCheckMemo) {
+        spPreCheckMemo->Seal();
+        nUsageSize += spPreCheckMemo->GetUsageSize();
+    }
+}
+
+void CTxMemPoolEntry::SetAccess(const std::shared_ptr<CMemPoolTxAccess> &spAccessIn) {
+    if (spAccess)
+        nUsageSize -= spAccess->GetUsageSize();
+    spAccess = spAccessIn;
+    if (spAccess)
+        nUsageSize += spAccess->GetUsageSize();
+}
+
 CTxMemPool::CTxMemPool() {
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
@@ -44,27 +119,175 @@ CTxMemPool::CTxMemPool() {
     fSanityCheck         = false;
 }
 
+void CTxMemPool::SetLimits(uint64_t maxUsageIn, int64_t expiryIn) {
+    LOCK(cs);
+    nMaxUsage = maxUsageIn;
+    nExpiry   = expiryIn;
+    TrimToSize(rescanFuelRate);
+}
+
 void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive) {
     // Remove transaction from memory pool
     LOCK(cs);
     uint256 txid = pBaseTx->GetHash();
-    if (memPoolTxs.count(txid)) {
-        removed.push_front(std::shared_ptr<CBaseTx>(memPoolTxs[txid].GetTransaction()));
-        memPoolTxs.erase(txid);
+    auto it      = memPoolTxs.find(txid);
+    if (it != memPoolTxs.end()) {
+        removed.push_front(std::shared_ptr<CBaseTx>(it->second.GetTransaction()));
+        EraseEntry(it);
         EraseTransaction(txid);
     }
 }
 
-bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state) {
+void CTxMemPool::Erase(const uint256 &txid) {
+    LOCK(cs);
+    auto it = memPoolTxs.find(txid);
+    if (it != memPoolTxs.end())
+        EraseEntry(it);
+}
+
+void CTxMemPool::EraseEntry(map<uint256, CTxMemPoolEntry>::iterator it) {
+    auto iterPriority = priorityIters.find(it->first);
+    if (iterPriority != priorityIters.end()) {
+        txPriorities.erase(iterPriority->second);
+        priorityIters.erase(iterPriority);
+    }
+    auto itSender = senderTxs.find(it->second.GetSenderKeyId());
+    if (itSender != senderTxs.end()) {
+        itSender->second.erase(it->second.GetSequence());
+        if (itSender->second.empty())
+            senderTxs.erase(itSender);
+    }
+    // the txs executed after it may have read its writes
+    if (it->second.GetAccess())
+        changedKeys.MergeWrites(it->second.GetAccess()->tracker);
+    feeEstimator.RemoveTx(it->first);
+    nTotalUsage -= it->second.GetUsageSize();
+    AddChange(it->first, false);
+    memPoolTxs.erase(it);
+}
+
+void CTxMemPool::AddChange(const uint256 &txid, bool fAdded) {
+    changeLog.push_back({++nChangeSequence, txid, fAdded});
+    if (changeLog.size() > MEMPOOL_CHANGE_LOG_SIZE)
+        changeLog.pop_front();
+}
+
+void CTxMemPool::TrimToSize(uint32_t fuelRate) {
+    if (nTotalUsage <= nMaxUsage)
+        return;
+
+    // the rescan below replays the whole pool, a batch of txs is evicted for it
+    uint64_t targetUsage = nMaxUsage / 100 * MEMPOOL_TRIM_PERCENT;
+    bool fEvicted        = false;
+    while (nTotalUsage > targetUsage && !txPriorities.empty()) {
+        uint256 txid = txPriorities.begin()->txid;
+        auto it      = memPoolTxs.find(txid);
+        if (it == memPoolTxs.end()) {
+            LogPrint(BCLog::ERROR, "CTxMemPool::TrimToSize, drop the priority of txid=%s not in the pool\n",
+                     txid.GetHex());
+            txPriorities.erase(txPriorities.begin());
+            priorityIters.erase(txid);
+            continue;
+        }
+
+        // the later txs of the sender may depend on it
+        CKeyID senderKeyId = it->second.GetSenderKeyId();
+        vector<std::pair<uint64_t, uint256>> evictedTxs = {{it->second.GetSequence(), txid}};
+        auto itSender = senderTxs.find(senderKeyId);
+        if (itSender != senderTxs.end()) {
+            const auto &txs = itSender->second;
+            for (auto itTx = txs.upper_bound(it->second.GetSequence()); itTx != txs.end(); ++itTx)
+                evictedTxs.emplace_back(itTx->first, itTx->second);
+        }
+
+        for (const auto &evictedTx : evictedTxs) {
+            const uint256 &evictedTxid = evictedTx.second;
+            auto itEvicted             = memPoolTxs.find(evictedTxid);
+            if (itEvicted == memPoolTxs.end()) {
+                LogPrint(BCLog::ERROR, "CTxMemPool::TrimToSize, drop the sender tx of txid=%s not in the pool\n",
+                         evictedTxid.GetHex());
+                itSender = senderTxs.find(senderKeyId);
+                if (itSender != senderTxs.end()) {
+                    itSender->second.erase(evictedTx.first);
+                    if (itSender->second.empty())
+                        senderTxs.erase(itSender);
+                }
+                continue;
+            }
+
+            LogPrint(BCLog::DEBUG, "CTxMemPool::TrimToSize, evict txid=%s, usage=%llu, max_usage=%llu\n",
+                     evictedTxid.GetHex(), nTotalUsage, nMaxUsage);
+            EraseEntry(itEvicted);
+            EraseTransaction(evictedTxid);
+        }
+        fEvicted = true;
+    }
+
+    // the writes of the evicted txs are still in the mempool cache, it is built again without them
+    if (fEvicted)
+        ReScanMemPoolTx(fuelRate);
+}
+
+bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, uint32_t fuelRate,
+                              CValidationState &state) {
     // Add to memory pool without checking anything.
     // Used by main.cpp AcceptToMemoryPool(), which DOES
     // all the appropriate checks.
     LOCK(cs);
     {
-        if (!CheckTxInMemPool(txid, entry, state))
+        if (memPoolTxs.count(txid))
+            return true;
+
+        // the position of the tx in txPriorities is taken before its execution, it is not added on a conflict
+        std::shared_ptr<CBaseTx> spTx = entry.GetTransaction();
+        double feePerKb               = 0;
+        auto itPriority               = txPriorities.end();
+        if (!spTx->IsBlockRewardTx()) {
+            uint64_t fee = std::get<1>(entry.GetFees());
+            feePerKb = double(fee - spTx->GetFuel(chainActive.Height() + 1, fuelRate)) / entry.GetTxSize() * 1000.0;
+            TxPriority txPriority(entry.GetPriority(), feePerKb, spTx, entry.GetPreCheckMemo());
+
+            // a tx evicted as soon as added would have left its writes in the mempool cache, refuse it unexecuted
+            if (nTotalUsage + entry.GetUsageSize() > nMaxUsage && !txPriorities.empty() &&
+                !(*txPriorities.begin() < txPriority))
+                return state.DoS(0, ERRORMSG("AddUnchecked() : txid: %s of too low priority, mempool full",
+                                 txid.GetHex()), REJECT_INSUFFICIENTFEE, "mempool-full");
+
+            auto retPriority = txPriorities.insert(std::move(txPriority));
+            if (!retPriority.second)
+                return state.Invalid(ERRORMSG("AddUnchecked() : txid: %s conflicts with txid: %s in the priorities",
+                                     txid.GetHex(), retPriority.first->txid.GetHex()), REJECT_INVALID,
+                                     "tx-priority-conflict");
+            itPriority = retPriority.first;
+        }
+
+        auto spAccess = std::make_shared<CMemPoolTxAccess>();
+        if (!CheckTxInMemPool(txid, entry, fuelRate, state, true, spAccess.get())) {
+            if (itPriority != txPriorities.end())
+                txPriorities.erase(itPriority);
             return false;
+        }
+
+        CTxMemPoolEntry &newEntry = memPoolTxs.emplace(txid, entry).first->second;
+        newEntry.SetAccess(spAccess);
+        newEntry.SetSequence(++nLastSequence);
+
+        CKeyID senderKeyId;
+        if (cw->accountCache.GetKeyId(newEntry.GetTransaction()->txUid, senderKeyId)) {
+            newEntry.SetSenderKeyId(senderKeyId);
+            senderTxs[senderKeyId].emplace(newEntry.GetSequence(), txid);
+        }
+        nTotalUsage += newEntry.GetUsageSize();
+        AddChange(txid, true);
+        if (itPriority != txPriorities.end()) {
+            priorityIters[txid] = itPriority;
+            feeEstimator.AddTx(txid, std::get<0>(newEntry.GetFees()), feePerKb, chainActive.Height());
+        }
 
-        memPoolTxs.insert(make_pair(txid, entry));
+        TrimToSize(fuelRate);
+        if (memPoolTxs.count(txid) == 0)
+            return state.DoS(0, ERRORMSG("AddUnchecked() : txid: %s evicted, mempool full", txid.GetHex()),
+                             REJECT_INSUFFICIENTFEE, "mempool-full");
     }
     return true;
 }
@@ -79,8 +302,54 @@ void CTxMemPool::QueryHash(vector<uint256> &txids) {
     }
 }
 
-bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state,
-                                  bool bExecute) {
+void CTxMemPool::QueryHash(vector<uint256> &txids, uint64_t &currSequence) {
+    LOCK(cs);
+    QueryHash(txids);
+    currSequence = nChangeSequence;
+}
+
+bool CTxMemPool::GetChangesSince(uint64_t sinceSequence, vector<uint256> &added, vector<uint256> &removed,
+                                 uint64_t &currSequence) {
+    LOCK(cs);
+    currSequence = nChangeSequence;
+    if (sinceSequence >= nChangeSequence)
+        return sinceSequence == nChangeSequence;
+    if (changeLog.empty() || changeLog.front().sequence > sinceSequence + 1)
+        return false;
+
+    // whether the tx was in the pool at sinceSequence and is in it now, by its first and last change
+    unordered_map<uint256, pair<bool, bool>, CSaltedUint256Hasher> txStates;
+    vector<uint256> txids;
+    for (auto it = changeLog.begin() + (sinceSequence + 1 - changeLog.front().sequence); it != changeLog.end(); ++it) {
+        auto ret = txStates.emplace(it->txid, make_pair(!it->fAdded, it->fAdded));
+        if (ret.second)
+            txids.push_back(it->txid);
+        else
+            ret.first->second.second = it->fAdded;
+    }
+    for (const auto &txid : txids) {
+        const auto &state = txStates[txid];
+        if (!state.first && state.second)
+            added.push_back(txid);
+        else if (state.first && !state.second)
+            removed.push_back(txid);
+    }
+    return true;
+}
+
+void CTxMemPool::GetEntries(vector<CTxMemPoolEntry> &entries) {
+    LOCK(cs);
+
+    entries.clear();
+    entries.reserve(memPoolTxs.size());
+    for (const auto &item : memPoolTxs)
+        entries.push_back(item.second);
+    sort(entries.begin(), entries.end(),
+         [](const CTxMemPoolEntry &a, const CTxMemPoolEntry &b) { return a.GetSequence() < b.GetSequence(); });
+}
+
+bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, uint32_t fuelRate,
+                                  CValidationState &state, bool bExecute, CMemPoolTxAccess *pAccess) {
     // is it within valid height
     static int validHeight = SysCfg().GetTxCacheHeight();
     if (!memPoolEntry.GetTransaction()->IsValidHeight(chainActive.Height(), validHeight))
@@ -96,15 +365,51 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
 
     if (bExecute) {
         CBlockIndex *pTip =  chainActive.Tip();
-        uint32_t fuelRate  = GetElementForBurn(pTip);
         uint32_t blockTime = pTip->GetBlockTime();
         uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
         CTxExecuteContext context(chainActive.Height(), 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::validating);
-        if (!memPoolEntry.GetTransaction()->ExecuteTx(context)) {
+
+        CBlockUndo txUndo;
+        std::optional<CDBAccessTracker::CScope> trackerScope;
+        std::optional<CTxUndoOpLogger> opLogger;
+        if (pAccess != nullptr) {
+            trackerScope.emplace(&pAccess->tracker);
+            opLogger.emplace(*spCW, txid, txUndo);
+        }
+        bool fExecuted = memPoolEntry.GetTransaction()->ExecuteTx(context);
+        opLogger.reset();
+        trackerScope.reset();
+        if (!fExecuted) {
             pCdMan->pLogCache->SetExecuteFail(chainActive.Height(), memPoolEntry.GetTransaction()->GetHash(),
                                               state.GetRejectCode(), state.GetRejectReason());
             return false;
         }
+
+        if (pAccess != nullptr) {
+            // the new values of the written keys, once each
+            pAccess->fReplayable = CParallelTxExecutor::IsParallelizable(*memPoolEntry.GetTransaction());
+            ReadDataFuncMap readDataFuncMap = spCW->GetReadDataFuncMap();
+            for (const auto &opLogPair : txUndo.vtxundo.back().dbOpLogMap.GetMap()) {
+                auto funcMapIt = readDataFuncMap.find(opLogPair.first);
+                if (funcMapIt == readDataFuncMap.end()) {
+                    pAccess->fReplayable = false;
+                    continue;
+                }
+
+                set<string> keys;
+                for (const auto &opLog : opLogPair.second) {
+                    if (!keys.insert(opLog.GetKey()).second)
+                        continue;
+
+                    string key = opLog.GetKey();
+                    string value;
+                    funcMapIt->second(key, value);
+                    CDbOpLog newLog;
+                    newLog.SetRaw(std::move(key), std::move(value));
+                    pAccess->writes.AddOpLog(opLogPair.first, std::move(newLog));
+                }
+            }
+        }
     }
 
     spCW->Flush();
@@ -116,34 +421,145 @@ void CTxMemPool::SetMemPoolCache() {
     cw.reset(new CCacheWrapper(pCdMan));
 }
 
-void CTxMemPool::ReScanMemPoolTx() {
+void CTxMemPool::GetTxParents(TxParentMap &parents) {
+    LOCK(cs);
+    parents.clear();
+    for (const auto &item : senderTxs) {
+        const uint256 *pPrevTxid = nullptr;
+        for (const auto &txItem : item.second) {
+            if (pPrevTxid != nullptr)
+                parents.emplace(txItem.second, *pPrevTxid);
+            pPrevTxid = &txItem.second;
+        }
+    }
+}
+
+void CTxMemPool::AddBlockChanges(const CBlockUndo &blockUndo) {
+    LOCK(cs);
+    for (const auto &txUndo : blockUndo.vtxundo) {
+        for (const auto &opLogPair : txUndo.dbOpLogMap.GetMap()) {
+            const string &prefix = dbk::GetKeyPrefix(opLogPair.first);
+            changedKeys.writePrefixes.insert(opLogPair.first);
+            for (const auto &opLog : opLogPair.second)
+                changedKeys.writeKeys.insert(prefix + opLog.GetKey());
+        }
+    }
+}
+
+void CTxMemPool::ReScanMemPoolTx(uint32_t fuelRate) {
     cw.reset(new CCacheWrapper(pCdMan));
 
     LOCK(cs);
+    int64_t beginTime = GetTimeMicros();
     CValidationState state;
-    for (map<uint256, CTxMemPoolEntry>::iterator iterTx = memPoolTxs.begin(); iterTx != memPoolTxs.end();) {
-        if (!CheckTxInMemPool(iterTx->first, iterTx->second, state, true)) {
+    int64_t expiryTime = GetTime() - nExpiry;
+
+    FeatureForkVersionEnum forkVersion = GetFeatureForkVersion(chainActive.Height());
+    bool fIncremental = !fFullRescan && fuelRate == rescanFuelRate && forkVersion == rescanForkVersion;
+    fFullRescan       = false;
+    rescanFuelRate    = fuelRate;
+    rescanForkVersion = forkVersion;
+
+    // the keys changed under the txs, a tx which read one of them is executed again and its writes are changed
+    CDBAccessTracker dirtyKeys = std::move(changedKeys);
+    changedKeys                = CDBAccessTracker();
+
+    vector<map<uint256, CTxMemPoolEntry>::iterator> iterTxs;
+    iterTxs.reserve(memPoolTxs.size());
+    for (auto iterTx = memPoolTxs.begin(); iterTx != memPoolTxs.end(); ++iterTx)
+        iterTxs.push_back(iterTx);
+    sort(iterTxs.begin(), iterTxs.end(),
+         [](const auto &a, const auto &b) { return a->second.GetSequence() < b->second.GetSequence(); });
+
+    UndoDataFuncMap undoDataFuncMap = cw->GetUndoDataFuncMap();
+    uint32_t replayedCount = 0;
+    for (auto iterTx : iterTxs) {
+        CTxMemPoolEntry &entry                      = iterTx->second;
+        std::shared_ptr<CMemPoolTxAccess> spAccess = entry.GetAccess();
+        bool fReplay = fIncremental && spAccess && spAccess->fReplayable && !spAccess->tracker.IsConflict(dirtyKeys);
+
+        bool fValid = entry.GetTime() >= expiryTime;
+        if (fValid && fReplay) {
+            fValid = CheckTxInMemPool(iterTx->first, entry, fuelRate, state, false);
+            if (fValid) {
+                for (const auto &opLogPair : spAccess->writes.GetMap())
+                    undoDataFuncMap.at(opLogPair.first)(opLogPair.second);
+                ++replayedCount;
+                continue;
+            }
+        }
+
+        // the txs after it read its old writes or its new ones
+        if (spAccess)
+            dirtyKeys.MergeWrites(spAccess->tracker);
+
+        std::shared_ptr<CMemPoolTxAccess> spNewAccess;
+        if (fValid) {
+            spNewAccess = std::make_shared<CMemPoolTxAccess>();
+            fValid      = CheckTxInMemPool(iterTx->first, entry, fuelRate, state, true, spNewAccess.get());
+        }
+        if (!fValid) {
             uint256 txid = iterTx->first;
-            iterTx       = memPoolTxs.erase(iterTx++);
+            EraseEntry(iterTx);
             EraseTransaction(txid);
             continue;
         }
-        ++iterTx;
+
+        dirtyKeys.MergeWrites(spNewAccess->tracker);
+        nTotalUsage -= entry.GetUsageSize();
+        entry.SetAccess(spNewAccess);
+        nTotalUsage += entry.GetUsageSize();
     }
+    // the writes of the txs erased above are not in the new cache
+    changedKeys = CDBAccessTracker();
+
+    LogPrint(BCLog::DEBUG, "CTxMemPool::ReScanMemPoolTx, %s rescan of %u txs, %u replayed, %u kept (%.2fms)\n",
+             fIncremental ? "incremental" : "full", iterTxs.size(), replayedCount, memPoolTxs.size(),
+             0.001 * (GetTimeMicros() - beginTime));
 }
 
 void CTxMemPool::Clear() {
     LOCK(cs);
 
     memPoolTxs.clear();
+    txPriorities.clear();
+    priorityIters.clear();
+    senderTxs.clear();
+    feeEstimator.ClearTxs();
+    nTotalUsage = 0;
+    // the txids cleared are not logged, the clients following the changes start again
+    changeLog.clear();
+    nChangeSequence++;
+    changedKeys = CDBAccessTracker();
+    fFullRescan = true;
     cw.reset(new CCacheWrapper(pCdMan));
 }
 
+void CTxMemPool::AddBlockFees(int32_t height, const vector<std::shared_ptr<CBaseTx>> &vptx) {
+    LOCK(cs);
+
+    vector<uint256> txids;
+    txids.reserve(vptx.size());
+    for (const auto &pBaseTx : vptx)
+        txids.push_back(pBaseTx->GetHash());
+    feeEstimator.ProcessBlock(height, txids);
+}
+
+double CTxMemPool::EstimateFee(uint32_t targetBlocks, const TokenSymbol &feeSymbol) const {
+    LOCK(cs);
+    return feeEstimator.Estimate(targetBlocks, feeSymbol);
+}
+
 uint64_t CTxMemPool::Size() {
     LOCK(cs);
     return memPoolTxs.size();
 }
 
+uint64_t CTxMemPool::GetUsageSize() {
+    LOCK(cs);
+    return nTotalUsage;
+}
+
 bool CTxMemPool::Exists(const uint256 txid) {
     LOCK(cs);
     return ((memPoolTxs.count(txid) != 0));
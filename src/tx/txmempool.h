@@ -10,19 +10,78 @@
 #include "entities/account.h"
 #include "persistence/cachewrapper.h"
 #include "sync.h"
+#include "tx/feeestimator.h"
 
+#include <cmath>
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
+#include <set>
+#include <unordered_map>
 
 using namespace std;
 
+static const uint32_t DEFAULT_MAX_MEMPOOL_SIZE = 300;  // in megabytes
+static const uint32_t DEFAULT_MEMPOOL_EXPIRY   = 72;   // in hours
+static const bool DEFAULT_PERSIST_MEMPOOL      = true;
+static const uint32_t MEMPOOL_CHANGE_LOG_SIZE  = 100000;  // the latest adds and removes kept for getmempooldiff
+static const uint32_t MEMPOOL_TRIM_PERCENT     = 90;   // a full pool is trimmed to the percent of its max usage
+
 class CValidationState;
 class CBaseTx;
+class CBlockUndo;
+class CTxPreCheckMemo;
 class uint256;
 
+/**
+ * The db keys a mempool tx read and wrote when it was executed on the mempool cache, with the values it wrote.
+ * ReScanMemPoolTx replays the writes of a tx instead of executing it again when nothing it read was changed
+ * by the new blocks or by the txs before it.
+ */
+struct CMemPoolTxAccess {
+    CDBAccessTracker tracker;
+    CDBOpLogMap writes;  // the keys written and their new values
+    bool fReplayable;    // all its reads are tracked, i.e. it reads no memory-only cache
+
+    CMemPoolTxAccess() : fReplayable(false) {}
+
+    size_t GetUsageSize() const;
+};
+
+struct TxPriority {
+    double priority;
+    double feePerKb;
+    std::shared_ptr<CBaseTx> baseTx;
+    uint256 txid;  // cached, the comparisons would hash the tx otherwise
+    std::shared_ptr<CTxPreCheckMemo> spPreCheckMemo;  // of the mempool entry, null for the txs made by the miner
+
+    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn,
+               const std::shared_ptr<CTxPreCheckMemo> &spPreCheckMemoIn = nullptr);
+
+    // by priority, then by fee per kb, then by txid, a strict weak ordering for the sets of the pool
+    bool operator<(const TxPriority &other) const {
+        if (this->priority != other.priority)
+            return this->priority < other.priority;
+        if (this->feePerKb != other.feePerKb)
+            return this->feePerKb < other.feePerKb;
+        return this->txid < other.txid;
+    }
+};
+
+// A tx entering or leaving the pool, numbered by the changes of the pool
+struct CMemPoolChange {
+    uint64_t sequence;
+    uint256 txid;
+    bool fAdded;
+};
+
+// txid -> the tx of the same sender before it in the mempool
+typedef unordered_map<uint256, uint256, CSaltedUint256Hasher> TxParentMap;
+
 /*
  * CTxMemPool stores these:
+ * The tx is copied once from the caller, the copies of the entry share it.
  */
 class CTxMemPoolEntry {
 private:
@@ -30,6 +89,11 @@ private:
     std::pair<TokenSymbol, uint64_t> nFees;  // Cached to avoid expensive parent-transaction lookups
     uint32_t nTxSize;                     // Cached to avoid recomputing tx size
     double dPriority;                     // Cached to avoid recomputing priority
+    size_t nUsageSize;                    // Cached heap bytes of the entry in the pool
+    std::shared_ptr<CTxPreCheckMemo> spPreCheckMemo;  // the signatures verified by AcceptToMemoryPool
+    std::shared_ptr<CMemPoolTxAccess> spAccess;       // of the last execution on the mempool cache
+    uint64_t nSequence;                               // the order of the execution on the mempool cache
+    CKeyID senderKeyId;                               // of txUid, empty if it was not found
 
     int64_t nTime;     // Local time when entering the mempool
     uint32_t height;  // Chain height when entering the mempool
@@ -40,10 +104,20 @@ public:
     CTxMemPoolEntry(const CTxMemPoolEntry &other);
 
     std::shared_ptr<CBaseTx> GetTransaction() const { return pTx; }
+    std::shared_ptr<CTxPreCheckMemo> GetPreCheckMemo() const { return spPreCheckMemo; }
+    // seal the memo of the checks of the tx, before the entry is added to the pool
+    void SetPreCheckMemo(const std::shared_ptr<CTxPreCheckMemo> &spMemo);
+    std::shared_ptr<CMemPoolTxAccess> GetAccess() const { return spAccess; }
+    void SetAccess(const std::shared_ptr<CMemPoolTxAccess> &spAccessIn);
+    inline uint64_t GetSequence() const { return nSequence; }
+    void SetSequence(uint64_t sequence) { nSequence = sequence; }
+    inline const CKeyID &GetSenderKeyId() const { return senderKeyId; }
+    void SetSenderKeyId(const CKeyID &keyId) { senderKeyId = keyId; }
 
     inline std::pair<TokenSymbol, uint64_t> GetFees() const { return nFees; }
     inline uint32_t GetTxSize() const { return nTxSize; }
     inline double GetPriority() const { return dPriority; }
+    inline size_t GetUsageSize() const { return nUsageSize; }
 
     inline int64_t GetTime() const { return nTime; }
     inline uint32_t GetHeight() const { return height; }
@@ -62,7 +136,11 @@ public:
 class CTxMemPool {
 public:
     mutable CCriticalSection cs;
+    // The pool holds the txs and not const ones, ReScanMemPoolTx executes them again on each new tip.
     map<uint256, CTxMemPoolEntry > memPoolTxs;
+    // memPoolTxs ordered by TxPriority for block assembly, kept in step by AddUnchecked and the erasing methods.
+    // The fee per kb is taken with the fuel rate of the tip when the tx entered the pool.
+    set<TxPriority> txPriorities;
     std::shared_ptr<CCacheWrapper> cw;
 
 public:
@@ -70,21 +148,73 @@ public:
 
 public:
     void SetSanityCheck(bool fSanityCheckIn) { fSanityCheck = fSanityCheckIn; }
-    bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state);
+    // Beyond maxUsageIn heap bytes the txs of the lowest priority are evicted, the txs older
+    // than expiryIn seconds are dropped by ReScanMemPoolTx.
+    void SetLimits(uint64_t maxUsageIn, int64_t expiryIn);
+    int64_t GetExpiry() const { return nExpiry; }
+    // fuelRate is the one of the next block, i.e. GetElementForBurn of the tip
+    bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, uint32_t fuelRate, CValidationState &state);
     void Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive = false);
+    void Erase(const uint256 &txid);
     void QueryHash(vector<uint256> &txids);
-    bool CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state,
-                          bool bExecute = true);
+    // all the txids with the sequence of the last change, for a client to follow the changes after it
+    void QueryHash(vector<uint256> &txids, uint64_t &currSequence);
+    /**
+     * The txs added and removed since the change sinceSequence, netted per txid: a tx added and removed since
+     * then is in neither. False if the changes since then are no longer all in the log, the client starts
+     * again from QueryHash then. currSequence is the sequence of the last change.
+     */
+    bool GetChangesSince(uint64_t sinceSequence, vector<uint256> &added, vector<uint256> &removed,
+                         uint64_t &currSequence);
+    // the entries in the order they were executed on the mempool cache
+    void GetEntries(vector<CTxMemPoolEntry> &entries);
+    bool CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, uint32_t fuelRate, CValidationState &state,
+                          bool bExecute = true, CMemPoolTxAccess *pAccess = nullptr);
     void SetMemPoolCache();
-    void ReScanMemPoolTx();
+    // The txs of each sender link to the one before them, the miner packs a tx after its ancestors
+    void GetTxParents(TxParentMap &parents);
+    // The keys written by a block connected to the tip, for the next ReScanMemPoolTx
+    void AddBlockChanges(const CBlockUndo &blockUndo);
+    // The next ReScanMemPoolTx executes all the txs again, e.g. after a block was disconnected
+    void SetFullRescan() { fFullRescan = true; }
+    // Check the txs on the new tip, in the order they were executed. Only the txs which read a key changed
+    // since the last rescan are executed again, the writes of the others are replayed.
+    void ReScanMemPoolTx(uint32_t fuelRate);
     void Clear();
 
+    // The txs of the block connected on the tip leave the pool, for the fee estimates
+    void AddBlockFees(int32_t height, const vector<std::shared_ptr<CBaseTx>> &vptx);
+    // The lowest fee per kb of feeSymbol a tx pays to be packed within targetBlocks, -1 without enough data
+    double EstimateFee(uint32_t targetBlocks, const TokenSymbol &feeSymbol) const;
+
     uint64_t Size();
+    uint64_t GetUsageSize();
     bool Exists(const uint256 txid);
     std::shared_ptr<CBaseTx> Lookup(const uint256 txid) const;
 
 private:
+    void EraseEntry(map<uint256, CTxMemPoolEntry>::iterator it);
+    void AddChange(const uint256 &txid, bool fAdded);
+    // once the pool exceeds nMaxUsage, evict the txs of the lowest priority with the later txs of their sender
+    // down to MEMPOOL_TRIM_PERCENT of it, then rebuild the mempool cache without their writes once for the batch
+    void TrimToSize(uint32_t fuelRate);
+
+    unordered_map<uint256, set<TxPriority>::iterator, CSaltedUint256Hasher> priorityIters;  // txid -> position in txPriorities
+    map<CKeyID, map<uint64_t, uint256>> senderTxs;  // sender -> its txs in the order they were executed
     bool fSanityCheck; // Normally false, true if -checkmempool or -regtest
+    // the keys written by the blocks and the removed txs since the last rescan
+    CDBAccessTracker changedKeys;
+    // the rescan executes all the txs again after a disconnection or when the fuel rate or the fork version changes
+    bool fFullRescan                         = true;
+    uint32_t rescanFuelRate                  = 0;
+    FeatureForkVersionEnum rescanForkVersion = MAJOR_VER_R1;
+    uint64_t nLastSequence                   = 0;  // of the last tx executed on the mempool cache
+    CFeeEstimator feeEstimator;
+    uint64_t nTotalUsage = 0;                                 // sum of the usage of the entries
+    deque<CMemPoolChange> changeLog;                          // the latest changes in the order of their sequence
+    uint64_t nChangeSequence = 0;                             // of the last change
+    uint64_t nMaxUsage   = DEFAULT_MAX_MEMPOOL_SIZE * 1000000ULL;
+    int64_t nExpiry      = DEFAULT_MEMPOOL_EXPIRY * 60 * 60;
 };
 
 
@@ -296,6 +296,12 @@ bool CWasmContractTx::ExecuteTx(CTxExecuteContext &context) {
                       txUid.ToString())
         sub_balance(payer, wasm::asset(llFees, wasm::symbol(SYMB::WICC, 8)), database.accountCache);
 
+        //the fuel limit bounds the execution steps of the contracts since MAJOR_VER_R4
+        auto fuel_fee_to_miner = get_fuel_fee_to_miner(*this, context) ;
+        auto fuel_fee          = get_fuel_fee_limit(*this, context);
+        fuel_limit             = fuel_fee;
+        steps_metered          = GetFeatureForkVersion(context.height) >= MAJOR_VER_R4;
+
         recipients_size        = 0;
         pseudo_start           = system_clock::now();//pseudo start for reduce code loading duration
         run_cost               = GetSerializeSize(SER_DISK, CLIENT_VERSION) * store_fuel_fee_per_byte;
@@ -304,11 +310,12 @@ bool CWasmContractTx::ExecuteTx(CTxExecuteContext &context) {
         wasm::transaction_trace trx_trace;
         trx_trace.trx_id = GetHash();
 
+        wasm_context wasm_execute_context(*this, database, receipts, mining);
         for (auto& trx: inline_transactions) {
             trx_current_for_exception = &trx;
 
             trx_trace.traces.emplace_back();
-            execute_inline_transaction(trx_trace.traces.back(), trx, trx.contract, database, receipts, 0);
+            wasm_execute_context.execute(trx, trx_trace.traces.back());
 
             trx_current_for_exception = nullptr;
         }
@@ -319,9 +326,7 @@ bool CWasmContractTx::ExecuteTx(CTxExecuteContext &context) {
                       "Tx execution time must be in '%d' microseconds, but get '%d' microseconds",
                       max_transaction_duration * 1000, trx_trace.elapsed.count())                   
 
-        //check storage usage with the limited fuel
-        auto fuel_fee_to_miner = get_fuel_fee_to_miner(*this, context) ;
-        auto fuel_fee          = get_fuel_fee_limit(*this, context);
+        //check storage usage and execution steps with the limited fuel
         run_cost               = run_cost + recipients_size * notice_fuel_fee_per_recipient;
 
         CHAIN_ASSERT( fuel_fee > run_cost, wasm_chain::fee_exhausted_exception, 
@@ -338,12 +343,14 @@ bool CWasmContractTx::ExecuteTx(CTxExecuteContext &context) {
         //               (fuel_fee == MAX_BLOCK_RUN_STEP)?run_cost: run_cost + fuel_fee_to_miner);    
 
         //save trx trace
-        std::vector<char> trace_bytes = wasm::pack<transaction_trace>(trx_trace);
-        CHAIN_ASSERT( database.contractCache.SetContractTraces(GetHash(),
-                                                             std::string(trace_bytes.begin(), trace_bytes.end())),
-                      wasm_chain::account_access_exception,
-                      "set tx '%s' trace failed",
-                      GetHash().ToString())
+        if (CTraceDBCache::IsEnabled()) {
+            std::vector<char> trace_bytes = wasm::pack<transaction_trace>(trx_trace);
+            CHAIN_ASSERT( database.traceCache.SetContractTraces(GetHash(),
+                                                              std::string(trace_bytes.begin(), trace_bytes.end())),
+                          wasm_chain::account_access_exception,
+                          "set tx '%s' trace failed",
+                          GetHash().ToString())
+        }
 
         //save trx receipts
         trace_to_receipts(trx_trace, receipts);
@@ -380,36 +387,6 @@ bool CWasmContractTx::ExecuteTx(CTxExecuteContext &context) {
     return true;
 }
 
-void CWasmContractTx::execute_inline_transaction(wasm::inline_transaction_trace& trace,
-                                                 wasm::inline_transaction&       trx,
-                                                 uint64_t                        receiver,
-                                                 CCacheWrapper&                  database,
-                                                 vector <CReceipt>&              receipts,
-                                                 uint32_t                        recurse_depth) {
-
-    wasm_context wasm_execute_context(*this, trx, database, receipts, mining, recurse_depth);
-
-    //check timeout
-    CHAIN_ASSERT( std::chrono::duration_cast<std::chrono::microseconds>(system_clock::now() - pseudo_start) <
-                  get_max_transaction_duration() * 1000,
-                  wasm_chain::wasm_timeout_exception, "%s", "timeout");
-
-    wasm_execute_context._receiver = receiver;
-    wasm_execute_context.execute(trace);
-
-}
-
-
-bool CWasmContractTx::GetInvolvedKeyIds(CCacheWrapper &cw, set <CKeyID> &keyIds) {
-
-    CKeyID senderKeyId;
-    if (!cw.accountCache.GetKeyId(txUid, senderKeyId))
-        return false;
-
-    keyIds.insert(senderKeyId);
-    return true;
-}
-
 uint64_t CWasmContractTx::GetFuel(int32_t height, uint32_t nFuelRate) {
 
     uint64_t minFee = 0;
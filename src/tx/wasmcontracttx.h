@@ -17,6 +17,8 @@ public:
 
 public:
     uint64_t                      run_cost;
+    uint64_t                      fuel_limit               = MAX_BLOCK_RUN_STEP; // run_cost may not reach it
+    bool                          steps_metered            = false;              // since MAJOR_VER_R4
     uint64_t                      pending_block_time;
     // uint64_t                      fuel;
     uint64_t                      recipients_size;
@@ -64,7 +66,6 @@ public:
     virtual std::shared_ptr<CBaseTx>   GetNewInstance() const { return std::make_shared<CWasmContractTx>(*this); }
     virtual map<TokenSymbol, uint64_t> GetValues()      const { return map<TokenSymbol, uint64_t>{{SYMB::WICC, 0}}; }
     virtual uint64_t                   GetFuel(int32_t height, uint32_t fuelRate);
-    virtual bool                       GetInvolvedKeyIds(CCacheWrapper &cw, set<CKeyID> &keyIds);
     virtual string ToString(CAccountDBCache &accountCache);
     virtual Object ToJson(const CAccountDBCache &accountCache) const;
 
@@ -78,13 +79,6 @@ public:
     void validate_authorization(const std::vector<uint64_t> &authorization_accounts);
     void get_accounts_from_signatures(CCacheWrapper &database,
                                           std::vector<uint64_t> &authorization_accounts);
-    void execute_inline_transaction( wasm::inline_transaction_trace &trace,
-                                      wasm::inline_transaction &trx,
-                                      uint64_t receiver,
-                                      CCacheWrapper &database,
-                                      vector<CReceipt> &receipts,
-                                      //CValidationState &state,
-                                      uint32_t recurse_depth);
 
 };
 
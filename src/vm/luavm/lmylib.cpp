@@ -14,6 +14,7 @@
 #include "tx/cointransfertx.h"
 
 #define LUA_C_BUFFER_SIZE  500  //传递值，最大字节防止栈溢出
+#define LUA_C_BATCH_SIZE   100  // keys or rows of a batched contract data function
 
 ///////////////////////////////////////////////////////////////////////////////
 // local static functions
@@ -674,6 +675,177 @@ int32_t ExInt64DivFunc(lua_State *L) {
     return 1;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Int64 userdata, the checked arithmetic of Int64Add and the others by the operators of lua:
+//   local a = mylib.Int64(100)         -- of an integer, an Int64, or the 8 bytes of IntegerToByte8 as a string
+//   local b = a * 3 + mylib.Int64(7)   -- the operands are Int64 or integers, an overflow raises an error
+//   local n = b:ToInteger()
+//   local bytes = {b:ToBytes()}        -- as IntegerToByte8
+// Each operation burns the fuel of its extern.
+
+static const char *INT64_METATABLE = "mylib.Int64";
+
+static void PushInt64(lua_State *L, int64_t value) {
+    int64_t *pValue = (int64_t *)lua_newuserdata(L, sizeof(int64_t));
+    *pValue         = value;
+    luaL_setmetatable(L, INT64_METATABLE);
+}
+
+// an Int64 or an integer
+static bool GetInt64(lua_State *L, int32_t index, int64_t &value) {
+    if (lua_isinteger(L, index)) {
+        value = lua_tointeger(L, index);
+        return true;
+    }
+
+    int64_t *pValue = (int64_t *)luaL_testudata(L, index, INT64_METATABLE);
+    if (pValue == nullptr)
+        return false;
+
+    value = *pValue;
+    return true;
+}
+
+enum Int64Operator { INT64_ADD, INT64_SUB, INT64_MUL, INT64_DIV };
+
+static int32_t Int64Arith(lua_State *L, Int64Operator op) {
+    int64_t a = 0, b = 0, c = 0;
+    if (!GetInt64(L, 1, a) || !GetInt64(L, 2, b))
+        return luaL_error(L, "Int64 operand is not an Int64 or an integer");
+
+    bool fOk = false;
+    switch (op) {
+        case INT64_ADD:
+            lua_BurnFuncCall(L, "Int64Add", FUEL_CALL_Int64Add, BURN_VER_R2);
+            fOk = SafeAdd(a, b, c);
+            break;
+        case INT64_SUB:
+            lua_BurnFuncCall(L, "Int64Sub", FUEL_CALL_Int64Sub, BURN_VER_R2);
+            fOk = SafeSubtract(a, b, c);
+            break;
+        case INT64_MUL:
+            lua_BurnFuncCall(L, "Int64Mul", FUEL_CALL_Int64Mul, BURN_VER_R2);
+            fOk = SafeMultiply(a, b, c);
+            break;
+        case INT64_DIV:
+            lua_BurnFuncCall(L, "Int64Div", FUEL_CALL_Int64Div, BURN_VER_R2);
+            fOk = SafeDivide(a, b, c);
+            break;
+    }
+    if (!fOk)
+        return luaL_error(L, "Int64 operate overflow");
+
+    PushInt64(L, c);
+    return 1;
+}
+
+static int32_t Int64AddMeta(lua_State *L) { return Int64Arith(L, INT64_ADD); }
+static int32_t Int64SubMeta(lua_State *L) { return Int64Arith(L, INT64_SUB); }
+static int32_t Int64MulMeta(lua_State *L) { return Int64Arith(L, INT64_MUL); }
+// both / and // truncate toward zero as Int64Div
+static int32_t Int64DivMeta(lua_State *L) { return Int64Arith(L, INT64_DIV); }
+
+static int32_t Int64UnmMeta(lua_State *L) {
+    int64_t a = 0, c = 0;
+    GetInt64(L, 1, a);
+    lua_BurnFuncCall(L, "Int64Sub", FUEL_CALL_Int64Sub, BURN_VER_R2);
+    if (!SafeSubtract((int64_t)0, a, c))
+        return luaL_error(L, "Int64 operate overflow");
+
+    PushInt64(L, c);
+    return 1;
+}
+
+static int32_t Int64Compare(lua_State *L, int32_t op) {
+    int64_t a = 0, b = 0;
+    if (!GetInt64(L, 1, a) || !GetInt64(L, 2, b))
+        return luaL_error(L, "Int64 operand is not an Int64 or an integer");
+
+    lua_pushboolean(L, op == LUA_OPEQ ? a == b : (op == LUA_OPLT ? a < b : a <= b));
+    return 1;
+}
+
+static int32_t Int64EqMeta(lua_State *L) { return Int64Compare(L, LUA_OPEQ); }
+static int32_t Int64LtMeta(lua_State *L) { return Int64Compare(L, LUA_OPLT); }
+static int32_t Int64LeMeta(lua_State *L) { return Int64Compare(L, LUA_OPLE); }
+
+static int32_t Int64ToStringMeta(lua_State *L) {
+    int64_t a = *(int64_t *)luaL_checkudata(L, 1, INT64_METATABLE);
+    lua_pushstring(L, strprintf("%d", a).c_str());
+    return 1;
+}
+
+static int32_t Int64ToInteger(lua_State *L) {
+    lua_pushinteger(L, *(int64_t *)luaL_checkudata(L, 1, INT64_METATABLE));
+    return 1;
+}
+
+static int32_t Int64ToBytes(lua_State *L) {
+    int64_t a = *(int64_t *)luaL_checkudata(L, 1, INT64_METATABLE);
+    lua_BurnFuncCall(L, "IntegerToByte8", FUEL_CALL_IntegerToByte8, BURN_VER_R2);
+    if (!lua_checkstack(L, sizeof(a)))
+        return luaL_error(L, "Int64 ToBytes stack overflow");
+
+    // the serialization of IntegerToByte8, little endian
+    for (uint32_t i = 0; i < sizeof(a); i++)
+        lua_pushinteger(L, ((uint64_t)a >> (8 * i)) & 0xff);
+    return sizeof(a);
+}
+
+/**
+ * Int64 - lua api
+ * Int64 Int64(value)
+ * 1. value: an integer, an Int64 or a string of the 8 bytes of IntegerToByte8
+ */
+int32_t ExInt64Func(lua_State *L) {
+    int64_t value = 0;
+    size_t len    = 0;
+    if (lua_type(L, 1) == LUA_TSTRING) {
+        const char *pData = lua_tolstring(L, 1, &len);
+        if (len != sizeof(value))
+            return RetFalse("ExInt64Func para err, the string is not 8 bytes");
+
+        LUA_BurnFuncCall(L, FUEL_CALL_ByteToInteger, BURN_VER_R2);
+        for (uint32_t i = 0; i < sizeof(value); i++)
+            value |= (int64_t)((uint64_t)(uint8_t)pData[i] << (8 * i));
+    } else if (!GetInt64(L, 1, value)) {
+        return RetFalse("ExInt64Func para err");
+    }
+
+    PushInt64(L, value);
+    return 1;
+}
+
+static const luaL_Reg int64Metas[] = {
+    {"__add",       Int64AddMeta},
+    {"__sub",       Int64SubMeta},
+    {"__mul",       Int64MulMeta},
+    {"__div",       Int64DivMeta},
+    {"__idiv",      Int64DivMeta},
+    {"__unm",       Int64UnmMeta},
+    {"__eq",        Int64EqMeta},
+    {"__lt",        Int64LtMeta},
+    {"__le",        Int64LeMeta},
+    {"__tostring",  Int64ToStringMeta},
+
+    {nullptr, nullptr}
+};
+
+static const luaL_Reg int64Methods[] = {
+    {"ToInteger",   Int64ToInteger},
+    {"ToBytes",     Int64ToBytes},
+
+    {nullptr, nullptr}
+};
+
+static void RegisterInt64(lua_State *L) {
+    luaL_newmetatable(L, INT64_METATABLE);
+    luaL_setfuncs(L, int64Metas, 0);
+    luaL_newlib(L, int64Methods);
+    lua_setfield(L, -2, "__index");
+    lua_pop(L, 1);  // pop the metatable
+}
+
 /**
  *bool SHA256(void const* pfrist, const uint16_t len, void * const pout)
  * This function receives an input param from a middle layer:
@@ -1438,6 +1610,189 @@ int32_t ExModifyDataDBFunc(lua_State *L) {
 }
 
 
+// get the array of binary strings at index of the stack, at most LUA_C_BATCH_SIZE
+static bool GetStringArray(lua_State *L, int32_t index, vector<string> &ret) {
+    if (!lua_istable(L, index)) {
+        LogPrint(BCLog::LUAVM, "GetStringArray(), param must be table\n");
+        return false;
+    }
+
+    size_t count = lua_rawlen(L, index);
+    if (count == 0 || count > LUA_C_BATCH_SIZE) {
+        LogPrint(BCLog::LUAVM, "GetStringArray(), array size=%u out of range\n", count);
+        return false;
+    }
+
+    for (size_t i = 1; i <= count; i++) {
+        lua_rawgeti(L, index, i);
+        size_t len       = 0;
+        const char *pStr = lua_type(L, -1) == LUA_TSTRING ? lua_tolstring(L, -1, &len) : nullptr;
+        if (pStr == nullptr || len > LUA_C_BUFFER_SIZE) {
+            lua_pop(L, 1);
+            LogPrint(BCLog::LUAVM, "GetStringArray(), element %u is not a string of at most %d bytes\n", i,
+                     LUA_C_BUFFER_SIZE);
+            return false;
+        }
+        ret.emplace_back(pStr, len);
+        lua_pop(L, 1);
+    }
+    return true;
+}
+
+/**
+ * ReadDataBatch - lua api
+ * table ReadDataBatch(keys)
+ * 1. keys: array of the keys as strings, at most LUA_C_BATCH_SIZE
+ * returns the array of the values as strings, false for a key without value
+ */
+int32_t ExReadDataBatchFunc(lua_State *L) {
+    vector<string> keys;
+    if (!GetStringArray(L, 1, keys))
+        return RetFalse("ExReadDataBatchFunc keys err");
+
+    CLuaVMRunEnv* pVmRunEnv = GetVmRunEnv(L);
+    if (nullptr == pVmRunEnv)
+        return RetFalse("pVmRunEnv is nullptr");
+
+    const CRegID &contractRegId = pVmRunEnv->GetContractRegID();
+    CContractDBCache* scriptDB  = pVmRunEnv->GetScriptDB();
+    if (!lua_checkstack(L, 2))
+        return RetFalse("ExReadDataBatchFunc stack overflow");
+
+    lua_createtable(L, keys.size(), 0);
+    for (size_t i = 0; i < keys.size(); i++) {
+        string value;
+        if (scriptDB->GetContractData(contractRegId, keys[i], value)) {
+            lua_BurnStoreGet(L, keys[i].size(), value.size(), BURN_VER_R2);
+            lua_pushlstring(L, value.data(), value.size());
+        } else {
+            lua_BurnStoreUnchanged(L, keys[i].size(), 0, BURN_VER_R2);
+            lua_pushboolean(L, false);
+        }
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
+/**
+ * WriteDataBatch - lua api
+ * bool WriteDataBatch(keys, values)
+ * 1. keys: array of the keys as strings, at most LUA_C_BATCH_SIZE
+ * 2. values: array of the values as strings, the i-th value is written to the i-th key
+ * nothing is written if a param is invalid
+ */
+int32_t ExWriteDataBatchFunc(lua_State *L) {
+    vector<string> keys;
+    vector<string> values;
+    if (!GetStringArray(L, 1, keys) || !GetStringArray(L, 2, values) || keys.size() != values.size())
+        return RetFalse("ExWriteDataBatchFunc keys or values err");
+
+    CLuaVMRunEnv* pVmRunEnv = GetVmRunEnv(L);
+    if (nullptr == pVmRunEnv)
+        return RetFalse("pVmRunEnv is nullptr");
+
+    const CRegID &contractRegId = pVmRunEnv->GetContractRegID();
+    CContractDBCache* scriptDB  = pVmRunEnv->GetScriptDB();
+    bool flag = true;
+    for (size_t i = 0; i < keys.size(); i++) {
+        string oldValue;
+        scriptDB->GetContractData(contractRegId, keys[i], oldValue);
+        if (!scriptDB->SetContractData(contractRegId, keys[i], values[i])) {
+            LogPrint(BCLog::LUAVM, "ExWriteDataBatchFunc SetContractData failed, key:%s!\n", HexStr(keys[i]));
+            lua_BurnStoreUnchanged(L, keys[i].size(), values[i].size(), BURN_VER_R2);
+            flag = false;
+        } else {
+            lua_BurnStoreSet(L, keys[i].size(), oldValue.size(), values[i].size(), BURN_VER_R2);
+        }
+    }
+    return RetRstBooleanToLua(L, flag);
+}
+
+/**
+ * DeleteDataBatch - lua api
+ * bool DeleteDataBatch(keys)
+ * 1. keys: array of the keys as strings, at most LUA_C_BATCH_SIZE
+ */
+int32_t ExDeleteDataBatchFunc(lua_State *L) {
+    vector<string> keys;
+    if (!GetStringArray(L, 1, keys))
+        return RetFalse("ExDeleteDataBatchFunc keys err");
+
+    CLuaVMRunEnv* pVmRunEnv = GetVmRunEnv(L);
+    if (nullptr == pVmRunEnv)
+        return RetFalse("pVmRunEnv is nullptr");
+
+    const CRegID &contractRegId = pVmRunEnv->GetContractRegID();
+    CContractDBCache* scriptDB  = pVmRunEnv->GetScriptDB();
+    bool flag = true;
+    for (const auto &key : keys) {
+        string oldValue;
+        scriptDB->GetContractData(contractRegId, key, oldValue);
+        if (!scriptDB->EraseContractData(contractRegId, key)) {
+            LogPrint(BCLog::LUAVM, "ExDeleteDataBatchFunc EraseContractData failed, key:%s!\n", HexStr(key));
+            lua_BurnStoreUnchanged(L, key.size(), oldValue.size(), BURN_VER_R2);
+            flag = false;
+        } else {
+            lua_BurnStoreSet(L, key.size(), oldValue.size(), 0, BURN_VER_R2);
+        }
+    }
+    return RetRstBooleanToLua(L, flag);
+}
+
+/**
+ * ScanData - lua api
+ * table, bool ScanData(prefix, lastKey, maxRows)
+ * 1. prefix: string, the keys scanned start with it
+ * 2. lastKey: string, the scan starts after it, "" to start from the first key
+ * 3. maxRows: integer, at most LUA_C_BATCH_SIZE
+ * returns the array of the rows {key=, value=} in key order, and true if more rows follow
+ */
+int32_t ExScanDataFunc(lua_State *L) {
+    size_t prefixLen = 0, lastKeyLen = 0;
+    const char *pPrefix  = lua_type(L, 1) == LUA_TSTRING ? lua_tolstring(L, 1, &prefixLen) : nullptr;
+    const char *pLastKey = lua_type(L, 2) == LUA_TSTRING ? lua_tolstring(L, 2, &lastKeyLen) : nullptr;
+    if (pPrefix == nullptr || pLastKey == nullptr || prefixLen > LUA_C_BUFFER_SIZE || lastKeyLen > LUA_C_BUFFER_SIZE ||
+        !lua_isinteger(L, 3))
+        return RetFalse("ExScanDataFunc para err");
+
+    lua_Integer maxRows = lua_tointeger(L, 3);
+    if (maxRows <= 0 || maxRows > LUA_C_BATCH_SIZE)
+        return RetFalse("ExScanDataFunc maxRows out of range");
+
+    CLuaVMRunEnv* pVmRunEnv = GetVmRunEnv(L);
+    if (nullptr == pVmRunEnv)
+        return RetFalse("pVmRunEnv is nullptr");
+
+    string prefix(pPrefix, prefixLen);
+    string lastKey(pLastKey, lastKeyLen);
+    auto pContractDataIt = pVmRunEnv->GetScriptDB()->CreateContractDataIterator(pVmRunEnv->GetContractRegID(), prefix);
+    if (!pContractDataIt)
+        return RetFalse("ExScanDataFunc prefix err");
+    if (!lua_checkstack(L, 4))
+        return RetFalse("ExScanDataFunc stack overflow");
+
+    bool hasMore = false;
+    lua_createtable(L, maxRows, 0);
+    for (pContractDataIt->SeekUpper(&lastKey); pContractDataIt->IsValid(); pContractDataIt->Next()) {
+        if (pContractDataIt->GotCount() > maxRows) {
+            hasMore = true;
+            break;
+        }
+        const string &key   = pContractDataIt->GetContractKey();
+        const string &value = pContractDataIt->GetValue();
+        lua_BurnStoreGet(L, key.size(), value.size(), BURN_VER_R2);
+
+        lua_createtable(L, 0, 2);
+        lua_pushlstring(L, key.data(), key.size());
+        lua_setfield(L, -2, "key");
+        lua_pushlstring(L, value.data(), value.size());
+        lua_setfield(L, -2, "value");
+        lua_rawseti(L, -2, pContractDataIt->GotCount());
+    }
+    lua_pushboolean(L, hasMore);
+    return 2;
+}
+
 static bool GetDataTableWriteOutput(lua_State *L, CVmOperate &operate) {
     if (!lua_istable(L,-1)) {
         LogPrint(BCLog::LUAVM,"WriteOutput(), param 1 must be table\n");
@@ -2503,6 +2858,7 @@ static const luaL_Reg mylib[] = {
     {"Int64Add",                    ExInt64AddFunc},
     {"Int64Sub",                    ExInt64SubFunc},
     {"Int64Div",                    ExInt64DivFunc},
+    {"Int64",                       ExInt64Func},
     {"Sha256",                      ExSha256Func},
     {"Sha256Once",                  ExSha256OnceFunc},
     {"Des",                         ExDesFunc},
@@ -2557,6 +2913,13 @@ static const luaL_Reg mylib[] = {
 // new function added in MAJOR_VER_R3
     {"GetAssetPrice",               ExGetAssetPriceFunc},
 
+///////////////////////////////////////////////////////////////////////////////
+// batched contract data functions
+    {"ReadDataBatch",               ExReadDataBatchFunc},
+    {"WriteDataBatch",              ExWriteDataBatchFunc},
+    {"DeleteDataBatch",             ExDeleteDataBatchFunc},
+    {"ScanData",                    ExScanDataFunc},
+
     {nullptr, nullptr}
 
 };
@@ -2578,6 +2941,7 @@ static const luaL_Reg baseLibsEx[] = {
 #endif
 
 {
+    RegisterInt64(L);
     luaL_newlib(L, mylib); //生成一个table,把mylibs所有函数填充进去
     return 1;
 }
@@ -298,4 +298,43 @@ int32_t ExGetAccountAssetFunc(lua_State *L);
  */
 int32_t ExGetAssetPriceFunc(lua_State *L);
 
+/**
+ * ReadDataBatch - lua api
+ * table ReadDataBatch( keys )
+ * read the contract data of the keys in one call
+ * @param keys: (array of string, required)    at most LUA_C_BATCH_SIZE keys
+ * @return values (array), the value of each key, false if the key does not exist
+ */
+int32_t ExReadDataBatchFunc(lua_State *L);
+
+/**
+ * WriteDataBatch - lua api
+ * bool WriteDataBatch( keys, values )
+ * write the contract data of the keys in one call
+ * @param keys: (array of string, required)    at most LUA_C_BATCH_SIZE keys
+ * @param values: (array of string, required)  the values of the keys, in order
+ * @return true if all written
+ */
+int32_t ExWriteDataBatchFunc(lua_State *L);
+
+/**
+ * DeleteDataBatch - lua api
+ * bool DeleteDataBatch( keys )
+ * delete the contract data of the keys in one call
+ * @param keys: (array of string, required)    at most LUA_C_BATCH_SIZE keys
+ * @return true if all deleted
+ */
+int32_t ExDeleteDataBatchFunc(lua_State *L);
+
+/**
+ * ScanData - lua api
+ * table, bool ScanData( prefix, lastKey, maxRows )
+ * scan the contract data ordered by key
+ * @param prefix: (string, required)   the prefix of the keys, empty for all keys
+ * @param lastKey: (string, required)  the last key of the previous page, empty for the first page
+ * @param maxRows: (int, required)     at most LUA_C_BATCH_SIZE rows
+ * @return rows (array of {key, value}), hasMore (bool)
+ */
+int32_t ExScanDataFunc(lua_State *L);
+
 #endif //VM_LUA_LMYLIB_H
\ No newline at end of file
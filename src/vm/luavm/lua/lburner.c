@@ -152,6 +152,7 @@ LUA_API int lua_StartBurner(lua_State *L, void* pContext, unsigned long long fue
     L->burnerState.fuelStore        = 0;
     L->burnerState.fuelAccount      = 0;
     L->burnerState.fuelFunction     = 0;
+    L->burnerState.checkEveryStep   = 0;
     L->burnerState.tracer           = NULL;
     return 1;
 }
@@ -203,6 +204,32 @@ LUA_API int lua_BurnOperator(lua_State *L, int op, int version) {
     return 1;
 }
 
+LUA_API void lua_BurnInstruction(lua_State *L, int op, int stepVersion) {
+    if (IsBurnerRuning(L)) {
+        if (stepVersion <= L->burnerState.version) {
+            L->burnerState.fuel += 1;
+            L->burnerState.fuelStep += 1;
+        }
+        if (BURN_VER_R2 <= L->burnerState.version && op >= 0 && op <= OP_TOTAL_COUNT - 1) {
+            unsigned long long fuel = g_opFuelList[op].fuel;
+            L->burnerState.fuel += fuel;
+            L->burnerState.fuelOperator += fuel;
+        }
+        TraceBurning(L, "lua_BurnInstruction", "version=%d, op=%d\n", stepVersion, op);
+    }
+}
+
+LUA_API int lua_CheckBurnedOut(lua_State *L) {
+    if (IsBurnerRuning(L)) {
+        return CheckBurnedOk(L, "Burned-out lua_CheckBurnedOut");
+    }
+    return 1;
+}
+
+LUA_API void lua_SetBurnerCheckEveryStep(lua_State *L, int checkEveryStep) {
+    L->burnerState.checkEveryStep = checkEveryStep;
+}
+
 LUA_API int lua_BurnStoreSet(lua_State *L, size_t keySize, size_t oldDataSize, size_t newDataSize, int version) {
     if (IsBurnerRuning(L) && version <= L->burnerState.version) {
         unsigned long long fuel = 0;
@@ -27,6 +27,9 @@ struct lua_burner_state {
     unsigned long long  fuelFunction;       /** total fuel of extended functions except store operation
                                                 and account operation(transfer output) functions */
 
+    int                 checkEveryStep;     /** 0 checks burned-out on calls, jumps and returns only,
+                                                otherwise on every instruction as the verification mode */
+
     lua_burner_trace_cb tracer;             /** trace the burning */
 };
 
@@ -56,6 +59,23 @@ LUA_API int lua_BurnStep(lua_State *L, unsigned long long step, int version);
 
 LUA_API int lua_BurnOperator(lua_State *L, int op, int version);
 
+/**
+ * burn the step and the operator of an instruction without checking burned-out.
+ * the burned fuel is the same as lua_BurnStep() and lua_BurnOperator(), the interpreter checks
+ * the burned-out by lua_CheckBurnedOut() before any call, backward jump or return, so only
+ * straight-line code without side effects can run between burning out and the check.
+ */
+LUA_API void lua_BurnInstruction(lua_State *L, int op, int stepVersion);
+
+/**
+ * check burned-out
+ * burned out if return 0, otherwise is burned ok.
+ */
+LUA_API int lua_CheckBurnedOut(lua_State *L);
+
+/** check burned-out on every instruction instead of on calls, jumps and returns only */
+LUA_API void lua_SetBurnerCheckEveryStep(lua_State *L, int checkEveryStep);
+
 LUA_API int lua_BurnStoreSet(lua_State *L, size_t keySize, size_t oldDataSize, size_t newDataSize, int version);
 
 LUA_API int lua_BurnStoreUnchanged(lua_State *L, size_t keySize, size_t dataSize, int version);
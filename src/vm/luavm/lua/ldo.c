@@ -316,6 +316,7 @@ int luaD_precall (lua_State *L, StkId func, int nresults) {
   CallInfo *ci;
   int n;  /* number of arguments (Lua) or returns (C) */
   ptrdiff_t funcr = savestack(L, func);
+  lua_CheckBurnedOut(L);  /* throws once burned out, no call may run after */
   switch (ttype(func)) {
     case LUA_TLCF:  /* light C function */
       f = fvalue(func);
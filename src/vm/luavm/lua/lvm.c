@@ -740,6 +740,10 @@ void luaV_finishOp (lua_State *L) {
 #define vmcase(l)	case l:
 #define vmbreak		break
 
+/* the instructions checking burned-out before they run, unless checking every step */
+#define BURNCHECKMASK	((1ULL << OP_JMP) | (1ULL << OP_FORLOOP) | \
+			 (1ULL << OP_TFORLOOP) | (1ULL << OP_RETURN))
+
 void luaV_execute (lua_State *L, lua_burner_version stepVersion) {
   CallInfo *ci = L->ci;
   LClosure *cl;
@@ -762,10 +766,19 @@ void luaV_execute (lua_State *L, lua_burner_version stepVersion) {
     ra = RA(i);
     lua_assert(base == ci->u.l.base);
     lua_assert(base <= L->top && L->top < L->stack + L->stacksize);
-    if (!lua_BurnStep(L, 1, stepVersion)){
-      return ;
+    if (L->burnerState.checkEveryStep) {
+      if (!lua_BurnStep(L, 1, stepVersion)){
+        return ;
+      }
+      lua_BurnOperator(L, GET_OPCODE(i), BURN_VER_R2);
+    }
+    else {
+      /* calls are checked by luaD_precall, loops and returns here */
+      lua_BurnInstruction(L, GET_OPCODE(i), stepVersion);
+      if ((BURNCHECKMASK & (1ULL << GET_OPCODE(i))) && !lua_CheckBurnedOut(L)) {
+        return ;
+      }
     }
-    lua_BurnOperator(L, GET_OPCODE(i), BURN_VER_R2);
     vmdispatch (GET_OPCODE(i)) {
       vmcase(OP_MOVE) {
         setobjs2s(L, ra, RB(i));
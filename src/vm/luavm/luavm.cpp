@@ -224,6 +224,72 @@ static void ReportBurnState(lua_State *L, CLuaVMRunEnv *pVmRunEnv) {
     );
 }
 
+/**
+ * The compiled chunks of the contract scripts by script hash, bounded by the total size of the chunks.
+ * Loading a chunk skips the parser but allocates other blocks than parsing the script does, so the
+ * cache only serves the burner versions not burning memory.
+ */
+class CLuaChunkCache {
+public:
+    static CLuaChunkCache &Instance() {
+        static CLuaChunkCache cache;
+        return cache;
+    }
+
+    bool Get(const uint256 &hash, string &chunk) {
+        LOCK(cs);
+        auto it = mapChunks.find(hash);
+        if (it == mapChunks.end())
+            return false;
+
+        chunk = it->second;
+        return true;
+    }
+
+    void Put(const uint256 &hash, const string &chunk) {
+        if (chunk.size() > MAX_CACHE_SIZE)
+            return;
+
+        LOCK(cs);
+        while (nTotalSize + chunk.size() > MAX_CACHE_SIZE && !mapChunks.empty()) {
+            nTotalSize -= mapChunks.begin()->second.size();
+            mapChunks.erase(mapChunks.begin());
+        }
+        if (mapChunks.emplace(hash, chunk).second)
+            nTotalSize += chunk.size();
+    }
+
+private:
+    static const size_t MAX_CACHE_SIZE = 32 * 1024 * 1024;
+
+    CLuaChunkCache() : nTotalSize(0) {}
+
+    CCriticalSection cs;
+    map<uint256, string> mapChunks;
+    size_t nTotalSize;
+};
+
+static int WriteChunk(lua_State *L, const void *p, size_t sz, void *ud) {
+    ((string *)ud)->append((const char *)p, sz);
+    return 0;
+}
+
+static int LoadScript(lua_State *L, const string &code, int burnVersion) {
+    if (burnVersion >= BURN_VER_R2)
+        return luaL_loadbuffer(L, code.c_str(), code.size(), "line");
+
+    uint256 hash = Hash(code.begin(), code.end());
+    string chunk;
+    if (CLuaChunkCache::Instance().Get(hash, chunk))
+        return luaL_loadbufferx(L, chunk.data(), chunk.size(), "line", "b");
+
+    int luaStatus = luaL_loadbuffer(L, code.c_str(), code.size(), "line");
+    if (luaStatus == LUA_OK && lua_dump(L, WriteChunk, &chunk, 0) == 0)
+        CLuaChunkCache::Instance().Put(hash, chunk);
+
+    return luaStatus;
+}
+
 static std::string GetLuaError(lua_State *L, int status, std::string prefix) {
     std::string ret;
     if (status != LUA_OK) {
@@ -257,6 +323,8 @@ tuple<uint64_t, string> CLuaVM::Run(uint64_t fuelLimit, CLuaVMRunEnv *pVmRunEnv)
         LogPrint(BCLog::LUAVM, "CLuaVM::Run lua_StartBurner() failed\n");
         return std::make_tuple(-1, string("CLuaVM::Run lua_StartBurner() failed\n"));
     }
+    // the verification mode checks burned-out on every instruction, the burned fuel is the same
+    lua_SetBurnerCheckEveryStep(lua_state, SysCfg().GetBoolArg("-luastepmetering", false));
 
     //打开需要的库
     vm_openlibs(lua_state);
@@ -287,7 +355,7 @@ tuple<uint64_t, string> CLuaVM::Run(uint64_t fuelLimit, CLuaVMRunEnv *pVmRunEnv)
 
     // 5. Load the contract script
     std::string strError;
-    int luaStatus = luaL_loadbuffer(lua_state, code.c_str(), code.size(), "line");
+    int luaStatus = LoadScript(lua_state, code, pVmRunEnv->GetBurnVersion());
     if (luaStatus == LUA_OK) {
         luaStatus = lua_pcallk(lua_state, 0, 0, 0, 0, NULL, BURN_VER_STEP_V1);
         if (luaStatus != LUA_OK) {
@@ -81,7 +81,7 @@ UnsignedCharArray CLuaVMRunEnv::GetAccountID(const CVmOperate& value) {
         CKeyID keyid = CKeyID(addr);
         CRegID regid;
         if (p_context->p_cw->accountCache.GetRegId(CUserID(keyid), regid)) {
-            accountId.assign(regid.GetRegIdRaw().begin(), regid.GetRegIdRaw().end());
+            accountId = regid.GetRegIdRaw();
         } else {
             accountId.assign(value.accountId, value.accountId + 34);
         }
@@ -251,31 +251,45 @@ bool CLuaVMRunEnv::CheckAppAcctOperate() {
 }
 
 bool CLuaVMRunEnv::OperateAccount(const vector<CVmOperate>& operates) {
-
+    // the operates of an account apply to one copy of it, read at its first operate and saved once at the end,
+    // the receipts keep the order of the operates. The copies are keyed by the resolved keyid so that a regid
+    // and a keyid of the same account share one copy
+    map<CKeyID, shared_ptr<CAccount>> accounts;
+    vector<pair<CUserID, shared_ptr<CAccount>>> touchedAccounts;
     for (auto& operate : operates) {
         uint64_t value;
         memcpy(&value, operate.money, sizeof(operate.money));
 
-        auto pAccount = std::make_shared<CAccount>();
         UnsignedCharArray accountId = GetAccountID(operate);
         CUserID uid;
-
         if (accountId.size() == 6) {
             CRegID regid;
             regid.SetRegID(accountId);
-            if (!p_context->p_cw->accountCache.GetAccount(CUserID(regid), *pAccount)) {
-                LogPrint(BCLog::LUAVM, "[ERR]CLuaVMRunEnv::OperateAccount(), account not exist! regid=%s\n", regid.ToString());
-                return false;
-            }
             uid = regid;
         } else {
-            CKeyID keyid;
-            keyid = CKeyID(string(accountId.begin(), accountId.end()));
+            uid = CKeyID(string(accountId.begin(), accountId.end()));
+        }
+
+        CKeyID keyid;
+        if (!p_context->p_cw->accountCache.GetKeyId(uid, keyid)) {
+            LogPrint(BCLog::LUAVM, "[ERR]CLuaVMRunEnv::OperateAccount(), account not exist! regid=%s\n",
+                     uid.ToString());
+            return false;
+        }
+
+        shared_ptr<CAccount>& pAccount = accounts[keyid];
+        if (!pAccount) {
+            pAccount = make_shared<CAccount>();
             if (!p_context->p_cw->accountCache.GetAccount(keyid, *pAccount)) {
+                if (uid.is<CRegID>()) {
+                    LogPrint(BCLog::LUAVM, "[ERR]CLuaVMRunEnv::OperateAccount(), account not exist! regid=%s\n",
+                             uid.ToString());
+                    return false;
+                }
                 pAccount = make_shared<CAccount>(keyid);
                 // TODO: new account fuel
             }
-            uid = keyid;
+            touchedAccounts.emplace_back(uid, pAccount);
         }
 
         LogPrint(BCLog::LUAVM, "uid=%s\nbefore account: %s\n", uid.ToString(),
@@ -293,13 +307,15 @@ bool CLuaVMRunEnv::OperateAccount(const vector<CVmOperate>& operates) {
             receipts.emplace_back(uid, nullId, SYMB::WICC, value, ReceiptCode::CONTRACT_ACCOUNT_OPERATE_SUB);
         }
 
-        if (!p_context->p_cw->accountCache.SetAccount(pAccount->keyid, *pAccount)) {
+        LogPrint(BCLog::LUAVM, "after account:%s\n", pAccount->ToString());
+    }
+
+    for (const auto& item : touchedAccounts) {
+        if (!p_context->p_cw->accountCache.SetAccount(item.second->keyid, *item.second)) {
             LogPrint(BCLog::LUAVM,
-                     "[ERR]CLuaVMRunEnv::OperateAccount(), save account failed, uid=%s\n", uid.ToString());
+                     "[ERR]CLuaVMRunEnv::OperateAccount(), save account failed, uid=%s\n", item.first.ToString());
             return false;
         }
-
-        LogPrint(BCLog::LUAVM, "after account:%s\n", pAccount->ToString());
     }
 
     return true;
@@ -426,13 +442,7 @@ CAccountDBCache* CLuaVMRunEnv::GetCatchView() { return &p_context->p_cw->account
 
 void CLuaVMRunEnv::InsertOutAPPOperte(const vector<uint8_t>& userId,
                                    const CAppFundOperate& source) {
-    if (mapAppFundOperate.count(userId)) {
-        mapAppFundOperate[userId].push_back(source);
-    } else {
-        vector<CAppFundOperate> it;
-        it.push_back(source);
-        mapAppFundOperate[userId] = it;
-    }
+    mapAppFundOperate[userId].push_back(source);
 }
 
 
@@ -479,11 +489,12 @@ bool CLuaVMRunEnv::GetAppUserAccount(const vector<uint8_t>& vAppUserId, shared_p
     return true;
 }
 
-bool CLuaVMRunEnv::OperateAppAccount(const map<vector<uint8_t>, vector<CAppFundOperate>> opMap) {
+bool CLuaVMRunEnv::OperateAppAccount(const map<vector<uint8_t>, vector<CAppFundOperate>>& opMap) {
     newAppUserAccount.clear();
 
     if (!mapAppFundOperate.empty()) {
-        for (auto const tem : opMap) {
+        // the operates are collected per app user, each of them is read, merged and saved once
+        for (auto const& tem : opMap) {
             shared_ptr<CAppUserAccount> pAppUserAccount;
             if (!GetAppUserAccount(tem.first, pAppUserAccount)) {
                 LogPrint(BCLog::LUAVM, "GetAppUserAccount(tem.first, pAppUserAccount, true) failed \n appuserid :%s\n",
@@ -491,11 +502,6 @@ bool CLuaVMRunEnv::OperateAppAccount(const map<vector<uint8_t>, vector<CAppFundO
                 return false;
             }
 
-            if (!pAppUserAccount.get()->AutoMergeFreezeToFree(p_context->height)) {
-                LogPrint(BCLog::LUAVM, "AutoMergeFreezeToFree failed\nappuser :%s\n", pAppUserAccount.get()->ToString());
-                return false;
-            }
-
             shared_ptr<CAppUserAccount> vmAppAccount = GetAppAccount(pAppUserAccount);
             if (vmAppAccount.get() == nullptr) {
                 rawAppUserAccount.push_back(pAppUserAccount);
@@ -506,7 +512,7 @@ bool CLuaVMRunEnv::OperateAppAccount(const map<vector<uint8_t>, vector<CAppFundO
             vector<CReceipt> appOperateReceipts;
             if (!pAppUserAccount.get()->Operate(tem.second, appOperateReceipts)) {
                 int32_t i = 0;
-                for (auto const appFundOperate : tem.second) {
+                for (auto const& appFundOperate : tem.second) {
                     LogPrint(BCLog::LUAVM, "Operate failed\nOperate %d: %s\n", i++, appFundOperate.ToString());
                 }
                 LogPrint(BCLog::LUAVM, "GetAppUserAccount(tem.first, pAppUserAccount, true) failed\nappuserid: %s\n",
@@ -91,7 +91,7 @@ private:
      */
     UnsignedCharArray GetAccountID(const CVmOperate& value);
 
-    bool OperateAppAccount(const map<vector<uint8_t>, vector<CAppFundOperate>> opMap);
+    bool OperateAppAccount(const map<vector<uint8_t>, vector<CAppFundOperate>>& opMap);
 
     std::shared_ptr<CAppUserAccount> GetAppAccount(std::shared_ptr<CAppUserAccount>& appAccount);
 
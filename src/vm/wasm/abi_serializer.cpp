@@ -70,6 +70,30 @@ namespace wasm {
         set_abi(abi, max_serialization_time);
     }
 
+    std::shared_ptr<const abi_serializer>
+    abi_serializer::get_cached( const std::vector<char> &abi, microseconds max_serialization_time ) {
+
+        // the abis of the native contracts and of the contracts in use, by packed abi
+        static const size_t max_cached_abis = 256;
+        static std::mutex mutex;
+        static map<std::vector<char>, std::shared_ptr<const abi_serializer>> cache;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto itr = cache.find(abi);
+            if (itr != cache.end())
+                return itr->second;
+        }
+
+        auto abis = std::make_shared<const abi_serializer>(wasm::unpack<wasm::abi_def>(abi), max_serialization_time);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache.size() >= max_cached_abis)
+            cache.erase(cache.begin());
+        cache.emplace(abi, abis);
+        return abis;
+    }
+
     void abi_serializer::add_specialized_unpack_pack( const string &name,
                                                       std::pair <abi_serializer::unpack_function, abi_serializer::pack_function> unpack_pack ) {
         built_in_types[name] = std::move(unpack_pack);
@@ -5,6 +5,8 @@
 #include <functional>
 #include <utility>
 #include <chrono>
+#include <memory>
+#include <mutex>
 
 #include "commons/json/json_spirit.h"
 #include "commons/json/json_spirit_reader_template.h"
@@ -69,23 +71,26 @@ namespace wasm {
         json_spirit::Value get_field_variant( const type_name &s, const json_spirit::Value &v, field_name field, bool is_optional ) const;
         json_spirit::Value get_field_variant( const type_name &s, const json_spirit::Value &v, uint32_t index ) const;
 
+        // the serializer of the packed abi, parsed and validated on the first use and shared after
+        static std::shared_ptr<const abi_serializer>
+        get_cached( const std::vector<char> &abi, microseconds max_serialization_time );
+
         static std::vector<char>
         pack( const std::vector<char> &abi, const string &action, const string &params, microseconds max_serialization_time ) {
 
             vector<char> data;
             try {
 
-                wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi);
-                wasm::abi_serializer abis(def, max_serialization_time);
+                auto abis = get_cached(abi, max_serialization_time);
 
                 json_spirit::Value data_v;
                 json_spirit::read_string(params, data_v);
 
-                string action_type = abis.get_action_type(action);
+                string action_type = abis->get_action_type(action);
                 if(action_type == string()){
                     action_type = action;
                 }
-                data = abis.variant_to_binary(action_type, data_v, max_serialization_time);
+                data = abis->variant_to_binary(action_type, data_v, max_serialization_time);
 
             }
             CHAIN_CAPTURE_AND_RETHROW("abi_serializer pack error in action '%s' from params '%s'", action, params)
@@ -99,14 +104,13 @@ namespace wasm {
 
             json_spirit::Value data_v;
             try {
-                wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi);
-                wasm::abi_serializer abis(def, max_serialization_time);
+                auto abis = get_cached(abi, max_serialization_time);
 
-                string action_type = abis.get_action_type(action);
+                string action_type = abis->get_action_type(action);
                 if(action_type == string()){
                     action_type = action;
                 }
-                data_v = abis.binary_to_variant(action_type, data, max_serialization_time);
+                data_v = abis->binary_to_variant(action_type, data, max_serialization_time);
 
             }
             CHAIN_CAPTURE_AND_RETHROW("abi_serializer unpack error in action '%s' params '%s'", action, ToHex(data))
@@ -121,15 +125,14 @@ namespace wasm {
             type_name name;
             try {
 
-                wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi);
-                wasm::abi_serializer abis(def, max_serialization_time);
+                auto abis = get_cached(abi, max_serialization_time);
 
                 string t = wasm::name(table).to_string();
-                name = abis.get_table_type(t);
+                name = abis->get_table_type(t);
 
                 CHAIN_ASSERT(name.size() > 0, wasm_chain::abi_parse_exception, "can not get table %s's type from abi", t.data());
 
-                data_v = abis.binary_to_variant(name, data, max_serialization_time);
+                data_v = abis->binary_to_variant(name, data, max_serialization_time);
             }
             CHAIN_CAPTURE_AND_RETHROW("abi_serializer unpack error in table %s from '%s'", name, ToHex(data))
 
@@ -428,6 +428,17 @@ namespace eosio { namespace vm {
          }
          page = 0;
       }
+      // Return the pages in use to the OS instead of zeroing them, the mapping is kept for the next use
+      // and the pages read as zero once allocated again
+      void discard() {
+         if (page > 0) {
+            int err = madvise(raw, page_size * page, MADV_DONTNEED);
+            EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "madvise failed");
+            err = mprotect(raw, page_size * page, PROT_NONE);
+            EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
+            page = 0;
+         }
+      }
       // Signal no memory defined
       void reset() {
          if (page != -1) {
@@ -47,6 +47,11 @@ namespace eosio { namespace vm {
       }
 
       inline int32_t current_linear_memory() const { return _wasm_alloc->get_current_page(); }
+
+      // one step is a function entry or a loop iteration, the JIT code throws steps_exhausted_exception
+      // on the step beyond the limit
+      inline void     set_remaining_steps(uint64_t steps) { _remaining_steps = steps; }
+      inline uint64_t get_remaining_steps() const { return _remaining_steps; }
       inline void     exit(std::error_code err = std::error_code()) {
          // FIXME: system_error?
          _error_code = err;
@@ -111,6 +116,8 @@ namespace eosio { namespace vm {
          throw wasm_memory_exception{ "wasm memory out-of-bounds" };
       }
 
+      // the first member, the JIT code decrements it at offset 0 of the context
+      uint64_t                        _remaining_steps  = std::numeric_limits<uint64_t>::max();
       char*                           _linear_memory    = nullptr;
       module&                         _mod;
       wasm_allocator*                 _wasm_alloc;
@@ -130,6 +137,7 @@ namespace eosio { namespace vm {
       using base_type::_mod;
       using base_type::_rhf;
       using base_type::_error_code;
+      using base_type::_remaining_steps;
       using base_type::handle_signal;
 
       inline operand_stack& get_operand_stack() { return _os; }
@@ -195,11 +203,24 @@ namespace eosio { namespace vm {
                  sizeof...(Args) + 4 /* scratch space */;
                void* stack = nullptr;
                std::unique_ptr<native_value[]> alt_stack;
+               bool reuse_alt_stack = false;
                if (maximum_stack_usage > stack_cutoff/sizeof(native_value)) {
                   maximum_stack_usage += SIGSTKSZ/sizeof(native_value);
-                  alt_stack.reset(new native_value[maximum_stack_usage + 3]);
-                  stack = alt_stack.get() + maximum_stack_usage;
+                  // the stack is kept for the next calls of the module, a nested call gets its own
+                  if (!_alt_stack_in_use) {
+                     if (_alt_stack_size < maximum_stack_usage + 3) {
+                        _alt_stack.reset(new native_value[maximum_stack_usage + 3]);
+                        _alt_stack_size = maximum_stack_usage + 3;
+                     }
+                     reuse_alt_stack = _alt_stack_in_use = true;
+                     stack = _alt_stack.get() + maximum_stack_usage;
+                  } else {
+                     alt_stack.reset(new native_value[maximum_stack_usage + 3]);
+                     stack = alt_stack.get() + maximum_stack_usage;
+                  }
                }
+               auto release_alt_stack = scope_guard([&](){ if (reuse_alt_stack) _alt_stack_in_use = false; });
+               assert((void*)&_remaining_steps == (void*)this);
                auto fn = reinterpret_cast<native_value (*)(void*, void*)>(_mod.code[func_index - _mod.get_imported_functions_size()].jit_code_offset + _mod.allocator._code_base);
 
                vm::invoke_with_signal_handler([&]() {
@@ -288,6 +309,10 @@ namespace eosio { namespace vm {
 
       Host * _host = nullptr;
 
+      std::unique_ptr<native_value[]> _alt_stack;
+      std::size_t                     _alt_stack_size   = 0;
+      bool                            _alt_stack_in_use = false;
+
       // This is only needed because the host function api uses operand stack
       bounded_allocator _base_allocator = {
          constants::max_stack_size * sizeof(operand_stack_elem)
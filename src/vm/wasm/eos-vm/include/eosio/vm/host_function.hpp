@@ -5,6 +5,7 @@
 #include <eosio/vm/wasm_stack.hpp>
 #include <eosio/vm/utils.hpp>
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -558,6 +559,7 @@ namespace eosio { namespace vm {
          std::unordered_map<std::pair<std::string, std::string>, uint32_t, host_func_pair_hash> named_mapping;
          std::vector<host_function>                                                             host_functions;
          std::vector<std::function<void(Cls*, WAlloc*, operand_stack&)>>                        functions;
+         std::vector<std::string>                                                               names;
          size_t                                                                                 current_index = 0;
       };
 
@@ -575,6 +577,13 @@ namespace eosio { namespace vm {
          auto&                 current_mappings        = get_mappings<WAlloc>();
          current_mappings.named_mapping[{ mod, name }] = current_mappings.current_index++;
          current_mappings.functions.push_back(create_function<WAlloc, Cls, Cls2, Func, res_t, deduced_full_ts>(is));
+         current_mappings.names.push_back(name);
+      }
+
+      static const std::string& get_name(uint32_t index) {
+         static const std::string unknown = "unknown";
+         const auto& names = get_mappings<wasm_allocator>().names;
+         return index < names.size() ? names[index] : unknown;
       }
 
       template <typename Module>
@@ -594,7 +603,16 @@ namespace eosio { namespace vm {
       template <typename Execution_Context>
       void operator()(Cls* host, Execution_Context& ctx, uint32_t index) {
          const auto& _func = get_mappings<wasm_allocator>().functions[index];
-         std::invoke(_func, host, ctx.get_wasm_allocator(), ctx.get_operand_stack());
+         if (host->is_profiling()) {
+            auto start = std::chrono::steady_clock::now();
+            auto g     = scope_guard([&]() {
+               host->record_host_call(index, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                   std::chrono::steady_clock::now() - start).count());
+            });
+            std::invoke(_func, host, ctx.get_wasm_allocator(), ctx.get_operand_stack());
+         } else {
+            std::invoke(_func, host, ctx.get_wasm_allocator(), ctx.get_operand_stack());
+         }
       }
    };
 
@@ -34,7 +34,7 @@ namespace eosio { namespace vm {
     public:
       machine_code_writer(growable_allocator& alloc, std::size_t source_bytes, module& mod) :
          _mod(mod), _code_segment_base(alloc.start_code()) {
-         const std::size_t code_size = 4 * 16; // 4 error handlers, each is 16 bytes.
+         const std::size_t code_size = 5 * 16; // 5 error handlers, each is 16 bytes.
          _code_start = _mod.allocator.alloc<unsigned char>(code_size);
          _code_end = _code_start + code_size;
          code = _code_start;
@@ -44,6 +44,7 @@ namespace eosio { namespace vm {
          call_indirect_handler = emit_error_handler(&on_call_indirect_error);
          type_error_handler = emit_error_handler(&on_type_error);
          stack_overflow_handler = emit_error_handler(&on_stack_overflow);
+         steps_exhausted_handler = emit_error_handler(&on_steps_exhausted);
 
          assert(code == _code_end); // verify that the manual instruction count is correct
 
@@ -97,7 +98,7 @@ namespace eosio { namespace vm {
       }
       ~machine_code_writer() { _mod.allocator.end_code<true>(_code_segment_base); }
 
-      static constexpr std::size_t max_prologue_size = 21;
+      static constexpr std::size_t max_prologue_size = 31;
       static constexpr std::size_t max_epilogue_size = 10;
       void emit_prologue(const func_type& /*ft*/, const guarded_vector<local_entry>& locals, uint32_t funcnum) {
          _ft = &_mod.types[_mod.functions[funcnum]];
@@ -112,6 +113,7 @@ namespace eosio { namespace vm {
          emit_bytes(0x55);
          // movq RSP, RBP
          emit_bytes(0x48, 0x89, 0xe5);
+         emit_count_step();
          // No more than 2^32-1 locals.  Already validated by the parser.
          uint32_t count = 0;
          for(uint32_t i = 0; i < locals.size(); ++i) {
@@ -172,7 +174,12 @@ namespace eosio { namespace vm {
          return emit_br(depth_change);
       }
       void emit_block() {}
-      void* emit_loop() { return code; }
+      void* emit_loop() {
+         // the branches back to the loop count a step each
+         void* result = code;
+         emit_count_step();
+         return result;
+      }
       void* emit_if() {
          auto icount = fixed_size_instr(9);
          // pop RAX
@@ -2052,6 +2059,7 @@ namespace eosio { namespace vm {
       void* call_indirect_handler;
       void* type_error_handler;
       void* stack_overflow_handler;
+      void* steps_exhausted_handler;
       void* jmp_table;
       uint32_t _local_count;
       uint32_t _table_element_size;
@@ -2087,6 +2095,14 @@ namespace eosio { namespace vm {
          // incl %ebx
          emit_bytes(0xff, 0xc3);
       }
+      // the remaining steps are at offset 0 of the context in %rdi, see execution_context_base
+      void emit_count_step() {
+         // subq $1, (%rdi)
+         emit_bytes(0x48, 0x83, 0x2f, 0x01);
+         // jb steps_exhausted
+         emit_bytes(0x0f, 0x82);
+         fix_branch(emit_branch_target32(), steps_exhausted_handler);
+      }
 
       static void unimplemented() { EOS_VM_ASSERT(false, wasm_parse_exception, "Sorry, not implemented."); }
 
@@ -2552,6 +2568,7 @@ namespace eosio { namespace vm {
       static void on_fp_error() { vm::throw_<wasm_interpreter_exception>( "floating point error" ); }
       static void on_call_indirect_error() { vm::throw_<wasm_interpreter_exception>( "call_indirect out of range" ); }
       static void on_type_error() { vm::throw_<wasm_interpreter_exception>( "call_indirect incorrect function type" ); }
+      static void on_steps_exhausted() { vm::throw_<steps_exhausted_exception>( "execution steps exhausted" ); }
       static void on_stack_overflow() { vm::throw_<wasm_interpreter_exception>( "stack overflow" ); }
    };
    
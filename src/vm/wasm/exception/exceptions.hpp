@@ -296,6 +296,8 @@ namespace wasm_chain {
                                     3080007, "Transaction exceeded the current greylisted account network usage limit" )
       CHAIN_DECLARE_DERIVED_EXCEPTION( wasm_timeout_exception, resource_exhausted_exception,
                                     3080008, "wasm time out exception" )
+      CHAIN_DECLARE_DERIVED_EXCEPTION( wasm_steps_exhausted_exception, resource_exhausted_exception,
+                                    3080009, "wasm execution steps exhausted" )
 
 
    CHAIN_DECLARE_DERIVED_EXCEPTION( authorization_exception, chain_exception,
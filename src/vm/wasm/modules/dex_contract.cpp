@@ -6,6 +6,7 @@
 #include "dex_contract.hpp"
 #include "wasm/datastream.hpp"
 #include "wasm/types/types.hpp"
+#include "crypto/hash.h"
 #include <string>
 #include <tuple>
 
@@ -291,127 +292,75 @@ uint64_t calc_coin_amount(uint64_t asset_amount, const uint64_t price) {
     return (uint64_t)coin_amount;
 }
 
-void dex::dex_order_create(wasm_context &context) {
+// check the order and freeze its funds in from_account, the caller saves the account
+static void create_order(wasm_context &context, CAccount &from_account, const uint256 &order_id,
+                         uint64_t fee_rate, uint8_t order_type_in, uint8_t order_side_in,
+                         const wasm::asset &coin, const wasm::asset &asset, uint64_t price) {
 
-    WASM_ASSERT(context._receiver == dex_order, wasm_assert_exception,
-                "%s(), Except contract dex.order, But get %s", __func__, wasm::name(context._receiver).to_string().c_str());
-
-    dex::order_t args;
-    args.unpack_from_bin(context.trx.data);
-
-    context.require_auth(args.from());
-
-    nick_name from_name(wasm::name(args.from()).to_string());
-    shared_ptr<CAccount> sp_from_account = wasm_account::get_account(context.database,
-        from_name, ERROR_TITLE("from"));
-
-    WASM_ASSERT(sp_from_account->IsRegistered(), wasm_assert_exception, "from account must be registered! from=%s",
-            from_name.ToString());
-    // TODO: check account nonce
-
-    WASM_ASSERT(CheckOrderType(OrderType(args.order_type())), wasm_assert_exception,
-        "order_type=%d is invalid", args.order_type())
-    WASM_ASSERT(kOrderSideHelper.CheckEnum(OrderSide(args.order_side())), wasm_assert_exception,
-        "order_side=%d is invalid", args.order_side())
-
-    DexOperatorDetail operator_detail;
-    WASM_ASSERT(context.database.dexCache.GetDexOperator(args.exid(), operator_detail), wasm_assert_exception,
-        "the dex operator does not exist! exid=%u", args.exid());
+    WASM_ASSERT(CheckOrderType(OrderType(order_type_in)), wasm_assert_exception,
+        "order_type=%d is invalid", order_type_in)
+    WASM_ASSERT(kOrderSideHelper.CheckEnum(OrderSide(order_side_in)), wasm_assert_exception,
+        "order_side=%d is invalid", order_side_in)
 
-    WASM_ASSERT(args.fee_rate() <= DEX_ORDER_FEE_RATE_MAX, wasm_assert_exception,
-        "fee_rate=%d is too large", args.fee_rate())
+    WASM_ASSERT(fee_rate <= DEX_ORDER_FEE_RATE_MAX, wasm_assert_exception,
+        "fee_rate=%d is too large", fee_rate)
 
-    TokenSymbol asset_sym = args.asset().sym.code().to_string();
-    TokenSymbol coin_sym = args.coin().sym.code().to_string();
+    TokenSymbol asset_sym = asset.sym.code().to_string();
+    TokenSymbol coin_sym = coin.sym.code().to_string();
     check_order_symbol_pair(asset_sym, coin_sym);
 
-    OrderType order_type = OrderType(args.order_type());
-    OrderSide order_side = OrderSide(args.order_side());
-    uint64_t asset_amount = args.asset().amount;
+    OrderType order_type = OrderType(order_type_in);
+    OrderSide order_side = OrderSide(order_side_in);
+    uint64_t asset_amount = asset.amount;
     uint64_t coin_amount;
     if (order_type == ORDER_MARKET_PRICE && order_side == ORDER_BUY) {
         WASM_ASSERT(asset_amount == 0, wasm_assert_exception,
                     "asset.amount=%llu must be 0 when order_type=%s, order_side=%s",
                     asset_amount, kOrderTypeHelper.GetName(order_type),
                     kOrderSideHelper.GetName(order_side));
-        coin_amount = args.coin().amount;
+        coin_amount = coin.amount;
         check_order_amount_range(coin_sym, coin_amount, ERROR_TITLE("order.coin"));
     } else {
         check_order_amount_range(asset_sym, asset_amount, ERROR_TITLE("order.asset"));
-        WASM_ASSERT(args.coin().amount == 0, wasm_assert_exception,
+        WASM_ASSERT(coin.amount == 0, wasm_assert_exception,
                     "coin.amount of sell order must be 0 when order_type=%s, order_side=%s",
-                    args.coin().amount, kOrderTypeHelper.GetName(order_type),
+                    coin.amount, kOrderTypeHelper.GetName(order_type),
                     kOrderSideHelper.GetName(order_side));
-        coin_amount = calc_coin_amount(asset_amount, args.price());
+        coin_amount = calc_coin_amount(asset_amount, price);
     }
 
     if (order_side == ORDER_BUY) {
-        WASM_ASSERT(sp_from_account->OperateBalance(coin_sym, FREEZE, coin_amount), wasm_assert_exception,
+        WASM_ASSERT(from_account.OperateBalance(coin_sym, FREEZE, coin_amount), wasm_assert_exception,
             "account has insufficient funds to freeze coin.amount! symbol=%s, amount=(%llu vs %llu)", coin_sym, coin_amount,
-                sp_from_account->GetBalance(coin_sym, BalanceType::FREE_VALUE));
+                from_account.GetBalance(coin_sym, BalanceType::FREE_VALUE));
     } else {
-        WASM_ASSERT(sp_from_account->OperateBalance(asset_sym, FREEZE, asset_amount), wasm_assert_exception,
+        WASM_ASSERT(from_account.OperateBalance(asset_sym, FREEZE, asset_amount), wasm_assert_exception,
         "account has insufficient funds to freeze asset.amount! symbol=%s, amount=(%llu vs %llu)", coin_sym,
-            asset_amount, sp_from_account->GetBalance(coin_sym, BalanceType::FREE_VALUE));
+            asset_amount, from_account.GetBalance(coin_sym, BalanceType::FREE_VALUE));
     }
 
-    WASM_ASSERT(args.price() > 0 && args.price() <= DEX_PRICE_MAX, wasm_assert_exception,
-        "asset.price=%d is 0 or too large! max=%llu", args.price(), DEX_PRICE_MAX);
-
-    WASM_ASSERT(args.memo().size() <= MEMO_SIZE_MAX, wasm_assert_exception, "memo.size=%d is more than %s",
-            args.memo().size());
-
-    uint256 order_id = context.control_trx.GetHash();
+    WASM_ASSERT(price > 0 && price <= DEX_PRICE_MAX, wasm_assert_exception,
+        "asset.price=%d is 0 or too large! max=%llu", price, DEX_PRICE_MAX);
 
     auto sp_sys_order        = make_shared<CDEXOrderDetail>();
     sp_sys_order->generate_type = USER_GEN_ORDER;
-    sp_sys_order->order_type    = OrderType(args.order_type());
-    sp_sys_order->order_side    = OrderSide(args.order_side());
-    sp_sys_order->coin_symbol   = args.coin().sym.code().to_string();
-    sp_sys_order->asset_symbol  = args.asset().sym.code().to_string();
+    sp_sys_order->order_type    = order_type;
+    sp_sys_order->order_side    = order_side;
+    sp_sys_order->coin_symbol   = coin_sym;
+    sp_sys_order->asset_symbol  = asset_sym;
     sp_sys_order->coin_amount   = coin_amount;
     sp_sys_order->asset_amount  = asset_amount;
-    sp_sys_order->price         = args.price();
+    sp_sys_order->price         = price;
     // TODO:...
 //    sp_sys_order->tx_cord       = txCord;
-    sp_sys_order->user_regid    = sp_from_account->regid;
+    sp_sys_order->user_regid    = from_account.regid;
     WASM_ASSERT(context.database.dexCache.CreateActiveOrder(order_id, *sp_sys_order),
         wasm_assert_exception, "save active order error");
-    wasm_account::save(context.database, *sp_from_account, ERROR_TITLE("from"));
-    context.require_recipient(args.from());
-    uint64_t owner = NAME(operator_detail.owner.ToString().c_str());
-    context.require_recipient(owner);
 }
 
-static uint256 checksum_to_uint256(checksum256_type &checksum) {
-    static_assert(sizeof(checksum.hash) == uint256::WIDTH, "");
-    uint256 ret;
-    ret.SetReverse( &checksum.hash[0], &checksum.hash[sizeof(checksum.hash)] );
-    return ret;
-}
-
-void dex::dex_order_cancel(wasm_context &context) {
-
-    WASM_ASSERT(context._receiver == dex_order, wasm_assert_exception,
-                "%s(), Except contract dex.order, But get %s", __func__, wasm::name(context._receiver).to_string().c_str());
-
-    dex::order_cancel_t args;
-    args.unpack_from_bin(context.trx.data);
-
-    context.require_auth(args.from());
-
-    nick_name from_name(wasm::name(args.from()).to_string());
-    shared_ptr<CAccount> sp_from_account = wasm_account::get_account(context.database,
-        from_name, ERROR_TITLE("from"));
+// unfreeze the remaining funds of the order in from_account and erase it, the caller saves the account
+static void cancel_order(wasm_context &context, CAccount &from_account, const uint256 &order_id) {
 
-    WASM_ASSERT(sp_from_account->IsRegistered(), wasm_assert_exception, "from account must be registered! from=%s",
-            from_name.ToString());
-
-    DexOperatorDetail operator_detail;
-    WASM_ASSERT(context.database.dexCache.GetDexOperator(args.exid(), operator_detail), wasm_assert_exception,
-        "the dex operator does not exist! exid=%u", args.exid());
-
-    uint256 order_id = checksum_to_uint256(args.order_id());
     CDEXOrderDetail active_order;
     WASM_ASSERT(context.database.dexCache.GetActiveOrder(order_id, active_order), wasm_assert_exception,
         "the order is inactive or not existed! order_id=%s", order_id.ToString());
@@ -420,7 +369,7 @@ void dex::dex_order_cancel(wasm_context &context) {
                 "the order is not generate by tx of user, order_id=%s", order_id.ToString());
 
     WASM_ASSERT(
-        !sp_from_account->regid.IsEmpty() && sp_from_account->regid == active_order.user_regid,
+        !from_account.regid.IsEmpty() && from_account.regid == active_order.user_regid,
         wasm_assert_exception, "can not cancel other user's order tx! order_id=%s, order_regid=%s",
         order_id.ToString(), active_order.user_regid.ToString());
 
@@ -448,12 +397,143 @@ void dex::dex_order_cancel(wasm_context &context) {
         WASM_ASSERT(false,  wasm_assert_exception, "Order side must be ORDER_BUY|ORDER_SELL");
     }
 
-    WASM_ASSERT(sp_from_account->OperateBalance(frozen_symbol, UNFREEZE, frozen_amount), wasm_assert_exception,
-        "from account has insufficient frozen amount to unfreeze, from=%s", from_name.ToString());
+    WASM_ASSERT(from_account.OperateBalance(frozen_symbol, UNFREEZE, frozen_amount), wasm_assert_exception,
+        "from account has insufficient frozen amount to unfreeze, from=%s", from_account.nickid.ToString());
 
-    wasm_account::save(context.database, *sp_from_account, ERROR_TITLE("from"));
     WASM_ASSERT(context.database.dexCache.EraseActiveOrder(order_id, active_order), wasm_assert_exception,
         "erase active order failed! order_id=%s", order_id.ToString());
+}
+
+static shared_ptr<CAccount> get_order_account(wasm_context &context, uint64_t from) {
+
+    context.require_auth(from);
+
+    nick_name from_name(wasm::name(from).to_string());
+    shared_ptr<CAccount> sp_from_account = wasm_account::get_account(context.database,
+        from_name, ERROR_TITLE("from"));
+
+    WASM_ASSERT(sp_from_account->IsRegistered(), wasm_assert_exception, "from account must be registered! from=%s",
+            from_name.ToString());
+    return sp_from_account;
+}
+
+static DexOperatorDetail get_order_operator(wasm_context &context, uint32_t exid) {
+    DexOperatorDetail operator_detail;
+    WASM_ASSERT(context.database.dexCache.GetDexOperator(exid, operator_detail), wasm_assert_exception,
+        "the dex operator does not exist! exid=%u", exid);
+    return operator_detail;
+}
+
+static void check_order_batch_size(size_t size) {
+    WASM_ASSERT(size > 0 && size <= DEX_ORDER_BATCH_SIZE_MAX, wasm_assert_exception,
+        "the batch must have 1 to %u orders, but get %u", DEX_ORDER_BATCH_SIZE_MAX, size);
+}
+
+void dex::dex_order_create(wasm_context &context) {
+
+    WASM_ASSERT(context._receiver == dex_order, wasm_assert_exception,
+                "%s(), Except contract dex.order, But get %s", __func__, wasm::name(context._receiver).to_string().c_str());
+
+    dex::order_t args;
+    args.unpack_from_bin(context.trx.data);
+
+    shared_ptr<CAccount> sp_from_account = get_order_account(context, args.from());
+    // TODO: check account nonce
+
+    DexOperatorDetail operator_detail = get_order_operator(context, args.exid());
+
+    WASM_ASSERT(args.memo().size() <= MEMO_SIZE_MAX, wasm_assert_exception, "memo.size=%d is more than %s",
+            args.memo().size());
+
+    uint256 order_id = context.control_trx.GetHash();
+    create_order(context, *sp_from_account, order_id, args.fee_rate(), args.order_type(), args.order_side(),
+                 args.coin(), args.asset(), args.price());
+
+    wasm_account::save(context.database, *sp_from_account, ERROR_TITLE("from"));
+    context.require_recipient(args.from());
+    uint64_t owner = NAME(operator_detail.owner.ToString().c_str());
+    context.require_recipient(owner);
+}
+
+void dex::dex_order_batch_create(wasm_context &context) {
+
+    WASM_ASSERT(context._receiver == dex_order, wasm_assert_exception,
+                "%s(), Except contract dex.order, But get %s", __func__, wasm::name(context._receiver).to_string().c_str());
+
+    dex::order_batch_create_t args;
+    args.unpack_from_bin(context.trx.data);
+
+    check_order_batch_size(args.orders().size());
+    shared_ptr<CAccount> sp_from_account = get_order_account(context, args.from());
+    DexOperatorDetail operator_detail = get_order_operator(context, args.exid());
+
+    WASM_ASSERT(args.memo().size() <= MEMO_SIZE_MAX, wasm_assert_exception, "memo.size=%d is more than %s",
+            args.memo().size());
+
+    // the order id of the i-th order is the hash of the txid and i
+    const uint256 &txid = context.control_trx.GetHash();
+    for (uint32_t i = 0; i < args.orders().size(); i++) {
+        const auto &order = args.orders()[i];
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << txid << i;
+
+        create_order(context, *sp_from_account, ss.GetHash(),
+                     std::get<order_param_t::__enum_fee_rate>(order),
+                     std::get<order_param_t::__enum_order_type>(order),
+                     std::get<order_param_t::__enum_order_side>(order),
+                     std::get<order_param_t::__enum_coin>(order),
+                     std::get<order_param_t::__enum_asset>(order),
+                     std::get<order_param_t::__enum_price>(order));
+    }
+
+    wasm_account::save(context.database, *sp_from_account, ERROR_TITLE("from"));
+    context.require_recipient(args.from());
+    uint64_t owner = NAME(operator_detail.owner.ToString().c_str());
+    context.require_recipient(owner);
+}
+
+static uint256 checksum_to_uint256(const checksum256_type &checksum) {
+    static_assert(sizeof(checksum.hash) == uint256::WIDTH, "");
+    uint256 ret;
+    ret.SetReverse( &checksum.hash[0], &checksum.hash[sizeof(checksum.hash)] );
+    return ret;
+}
+
+void dex::dex_order_cancel(wasm_context &context) {
+
+    WASM_ASSERT(context._receiver == dex_order, wasm_assert_exception,
+                "%s(), Except contract dex.order, But get %s", __func__, wasm::name(context._receiver).to_string().c_str());
+
+    dex::order_cancel_t args;
+    args.unpack_from_bin(context.trx.data);
+
+    shared_ptr<CAccount> sp_from_account = get_order_account(context, args.from());
+    DexOperatorDetail operator_detail = get_order_operator(context, args.exid());
+
+    cancel_order(context, *sp_from_account, checksum_to_uint256(args.order_id()));
+
+    wasm_account::save(context.database, *sp_from_account, ERROR_TITLE("from"));
+    context.require_recipient(args.from());
+    uint64_t owner = NAME(operator_detail.owner.ToString().c_str());
+    context.require_recipient(owner);
+}
+
+void dex::dex_order_batch_cancel(wasm_context &context) {
+
+    WASM_ASSERT(context._receiver == dex_order, wasm_assert_exception,
+                "%s(), Except contract dex.order, But get %s", __func__, wasm::name(context._receiver).to_string().c_str());
+
+    dex::order_batch_cancel_t args;
+    args.unpack_from_bin(context.trx.data);
+
+    check_order_batch_size(args.order_ids().size());
+    shared_ptr<CAccount> sp_from_account = get_order_account(context, args.from());
+    DexOperatorDetail operator_detail = get_order_operator(context, args.exid());
+
+    for (const auto &checksum : args.order_ids())
+        cancel_order(context, *sp_from_account, checksum_to_uint256(checksum));
+
+    wasm_account::save(context.database, *sp_from_account, ERROR_TITLE("from"));
     context.require_recipient(args.from());
     uint64_t owner = NAME(operator_detail.owner.ToString().c_str());
     context.require_recipient(owner);
@@ -102,11 +102,44 @@ namespace dex {
     DEFINE( order_id,     "checksum256", wasm::checksum256_type) SEPARATOR()       /* exid  */ \
     DEFINE( memo,         "string",      string)            SEPARATOR_END()   /* memo  */
 
+//       field_name       type_name     type             separator          description
+//       ----------    ------------ -------------     ---------------    -------------------
+#define DEX_ORDER_PARAM(DEFINE, SEPARATOR, SEPARATOR_END) \
+    DEFINE( fee_rate,       "uint64",    uint64_t)    SEPARATOR()       /* fee rate  */ \
+    DEFINE( order_type,     "uint8",     uint8_t)     SEPARATOR()       /* order type  */ \
+    DEFINE( order_side,     "uint8",     uint8_t)     SEPARATOR()       /* order side  */ \
+    DEFINE( coin,           "asset",     wasm::asset) SEPARATOR()       /* coins  */ \
+    DEFINE( asset,          "asset",     wasm::asset) SEPARATOR()       /* assets  */ \
+    DEFINE( price,          "uint64",    uint64_t)    SEPARATOR_END()   /* price  */
+
+    DEFINE_WASM_NATIVE_STRUCT(order_param_t, DEX_ORDER_PARAM)
+
+//       field_name       type_name     type             separator          description
+//       ----------    ------------ -------------     ---------------    -------------------
+#define DEX_ORDER_BATCH_CREATE(DEFINE, SEPARATOR, SEPARATOR_END) \
+    DEFINE( from,         "name",          uint64_t)                              SEPARATOR()     /* from name */ \
+    DEFINE( exid,         "uint32",        uint32_t)                              SEPARATOR()     /* exid  */ \
+    DEFINE( orders,       "order_param[]", std::vector<order_param_t::pack_type>) SEPARATOR()     /* orders  */ \
+    DEFINE( memo,         "string",        string)                                SEPARATOR_END() /* memo  */
+
+//       field_name       type_name     type             separator          description
+//       ----------    ------------ -------------     ---------------    -------------------
+#define DEX_ORDER_BATCH_CANCEL(DEFINE, SEPARATOR, SEPARATOR_END) \
+    DEFINE( from,         "name",          uint64_t)                            SEPARATOR()     /* from name */ \
+    DEFINE( exid,         "uint32",        uint32_t)                            SEPARATOR()     /* exid  */ \
+    DEFINE( order_ids,    "checksum256[]", std::vector<wasm::checksum256_type>) SEPARATOR()     /* order ids  */ \
+    DEFINE( memo,         "string",        string)                              SEPARATOR_END() /* memo  */
+
     DEFINE_WASM_NATIVE_STRUCT(order_t, DEX_ORDER_CREATE)
     DEFINE_WASM_NATIVE_STRUCT(order_cancel_t, DEX_ORDER_CANCEL)
+    DEFINE_WASM_NATIVE_STRUCT(order_batch_create_t, DEX_ORDER_BATCH_CREATE)
+    DEFINE_WASM_NATIVE_STRUCT(order_batch_cancel_t, DEX_ORDER_BATCH_CANCEL)
 
     const static uint64_t dex_order     = N(dex.order);
 
+    // the orders a batch action may create or cancel
+    const static uint32_t DEX_ORDER_BATCH_SIZE_MAX = 100;
+
     inline wasm::abi_def get_order_abi() {
 
         wasm::abi_def abi;
@@ -116,17 +149,25 @@ namespace dex {
         }
 
         abi.structs = {
-            struct_def("create",  "", order_t::get_abi_fields()),
-            struct_def("cancel",  "", order_cancel_t::get_abi_fields())
+            struct_def("create",        "", order_t::get_abi_fields()),
+            struct_def("cancel",        "", order_cancel_t::get_abi_fields()),
+            struct_def("order_param",   "", order_param_t::get_abi_fields()),
+            struct_def("batchcreate",   "", order_batch_create_t::get_abi_fields()),
+            struct_def("batchcancel",   "", order_batch_cancel_t::get_abi_fields())
         };
 
         abi.actions = {
-            {"create",   "create",    ""},
-            {"cancel",   "cancel",    ""}
+            {"create",        "create",        ""},
+            {"cancel",        "cancel",        ""},
+            {"batchcreate",   "batchcreate",   ""},
+            {"batchcancel",   "batchcancel",   ""}
         };
         return abi;
     }
 
     void dex_order_create( wasm_context & );
     void dex_order_cancel( wasm_context & );
+    // the orders of one account on one dex operator, the account and the operator are loaded and saved once
+    void dex_order_batch_create( wasm_context & );
+    void dex_order_batch_cancel( wasm_context & );
 };
\ No newline at end of file
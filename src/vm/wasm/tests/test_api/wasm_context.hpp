@@ -189,6 +189,8 @@ class wasm_context : public wasm_context_interface {
         bool set_data  ( const uint64_t& contract, const string& k, const string& v )  { return cache.SetContractData(contract, k, v); }
         bool get_data  ( const uint64_t& contract, const string& k, string &v ) { return cache.GetContractData(contract, k, v); }
         bool erase_data( const uint64_t& contract, const string& k ) { return cache.EraseContractData(contract, k); }
+        bool scan_data ( const uint64_t& contract, const string& prefix, const string& last_key, uint32_t max_rows,
+                         vector<pair<string, string>> &rows ) { return false; }
 
         std::vector<uint64_t>    get_active_producers() { return std::vector<uint64_t>(); }
         vm::wasm_allocator*      get_wasm_allocator()   { return &wasm_alloc; }
@@ -201,6 +203,9 @@ class wasm_context : public wasm_context_interface {
             return wasm_alloc.is_in_range(reinterpret_cast<const char*>(p)); 
         }
         std::chrono::milliseconds get_max_transaction_duration(){ return std::chrono::milliseconds(wasm::max_wasm_execute_time_infinite); }
+        bool     is_steps_metered(){ return false; }
+        uint64_t get_max_steps(){ return std::numeric_limits<uint64_t>::max(); }
+        void     charge_steps( const uint64_t& steps ){}
 
         void update_storage_usage(const uint64_t& account, const int64_t& size_in_bytes){};
         bool contracts_console() { return true; } //should be set by console
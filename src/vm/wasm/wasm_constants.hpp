@@ -21,6 +21,7 @@ namespace wasm {
     const static uint32_t max_wasm_api_data_bytes      = 64*1024;
     const static uint16_t max_inline_transactions_size = 1024;
     const static uint16_t max_signatures_size          = 16;
+    const static uint16_t max_db_batch_size            = 1024; // keys or rows of a batched db host function
 
     const static uint64_t wasmio       = N(wasmio);
     const static uint64_t wasmio_bank  = N(wasmio.bank);
@@ -29,6 +30,7 @@ namespace wasm {
 
     const static uint64_t store_fuel_fee_per_byte       = 100;
     const static uint64_t notice_fuel_fee_per_recipient = 10000;
+    const static uint64_t execute_fuel_fee_per_step     = 1;     // a function entry or loop iteration
 
 
     namespace wasm_constraints {
@@ -7,6 +7,8 @@
 
 #include "wasm/exception/exceptions.hpp"
 
+#include <mutex>
+
 using namespace std;
 using namespace wasm;
 // using std::chrono::microseconds;
@@ -100,15 +102,12 @@ namespace wasm {
         inline_transactions.push_back(t);
     }
 
-    std::vector <uint8_t> wasm_context::get_code(const uint64_t& account) {
+    CContractCode wasm_context::get_code(const uint64_t& account) {
 
-        vector <uint8_t>   code;
-        CUniversalContract contract;
+        CContractCode code;
         CAccount contract_account ;
-        if(database.accountCache.GetAccount(CNickID(account), contract_account)
-            && database.contractCache.GetContract(contract_account.regid, contract)) {
-            code = vector <uint8_t>(contract.code.begin(), contract.code.end());
-        }
+        if(database.accountCache.GetAccount(CNickID(account), contract_account))
+            database.contractCache.GetContractCode(contract_account.regid, code);
         return code;
     }
 
@@ -122,19 +121,45 @@ namespace wasm {
 
     void wasm_context::initialize() {
 
-        static bool wasm_interface_inited = false;
-        if (!wasm_interface_inited) {
-            wasm_interface_inited = true;
+        // contexts may run on several threads at once
+        static std::once_flag wasm_interface_inited;
+        std::call_once(wasm_interface_inited, [this]() {
             wasmif.initialize(wasm::vm_type::eos_vm_jit);
             register_native_handler(wasmio,      N(setcode),  wasmio_native_setcode      );
             register_native_handler(wasmio_bank, N(transfer), wasmio_bank_native_transfer);
-        }
+        });
     }
 
-    void wasm_context::execute(inline_transaction_trace &trace) {
+    void wasm_context::execute(const inline_transaction &t, inline_transaction_trace &trace) {
 
         initialize();
 
+        // a stack, the next action to run is the last one
+        vector<pending_action> pending;
+        pending.push_back({t, &trace, 0});
+        while (!pending.empty()) {
+            pending_action action = std::move(pending.back());
+            pending.pop_back();
+            execute_action(action, pending);
+        }
+
+    }
+
+    void wasm_context::execute_action(pending_action &action, vector<pending_action> &pending) {
+
+        //check timeout
+        CHAIN_ASSERT( std::chrono::duration_cast<std::chrono::microseconds>(system_clock::now() - control_trx.pseudo_start) <
+                      control_trx.get_max_transaction_duration() * 1000,
+                      wasm_chain::wasm_timeout_exception, "%s", "timeout");
+
+        trx           = std::move(action.trx);
+        recurse_depth = action.depth;
+        _receiver     = trx.contract;
+        notified.clear();
+        inline_transactions.clear();
+        contract_regids.clear();
+
+        inline_transaction_trace &trace = *action.trace;
         notified.push_back(_receiver);
         execute_one(trace);
 
@@ -149,12 +174,11 @@ namespace wasm {
                       wasm_chain::transaction_exception,
                       "max inline transaction depth per transaction reached");
 
-        for (auto &inline_trx : inline_transactions) {
-            trace.inline_traces.emplace_back();
-            control_trx.execute_inline_transaction(trace.inline_traces.back(), inline_trx,
-                                                   inline_trx.contract, database, receipts,
-                                                   recurse_depth + 1);
-        }
+        // the traces of the action are complete but the ones of the inline actions, so they do not move
+        size_t first = trace.inline_traces.size();
+        trace.inline_traces.resize(first + inline_transactions.size());
+        for (size_t i = inline_transactions.size(); i-- > 0;)
+            pending.push_back({std::move(inline_transactions[i]), &trace.inline_traces[first + i], recurse_depth + 1});
 
     }
 
@@ -174,9 +198,21 @@ namespace wasm {
                 (*native)(*this);
             } else {
 
-                vector <uint8_t> code = get_code(_receiver);
-                if (code.size() > 0) {
-                    wasmif.execute(code, this);
+                CContractCode code = get_code(_receiver);
+                if (!code.IsEmpty()) {
+                    if (profiling) {
+                        host_calls.clear();
+                        auto start = std::chrono::steady_clock::now();
+                        auto g     = scope_guard([&]() {
+                            uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - start).count();
+                            wasm_profiler::instance().record({_receiver, trx.action}, nanos,
+                                                             std::max(wasm_alloc->get_current_page(), 0), host_calls);
+                        });
+                        wasmif.execute(code.hash, code.data, this);
+                    } else {
+                        wasmif.execute(code.hash, code.data, this);
+                    }
                 }
             }
         }  catch (wasm_chain::exception &e) {
@@ -12,6 +12,7 @@
 #include "wasm/wasm_interface.hpp"
 #include "wasm/datastream.hpp"
 #include "wasm/wasm_trace.hpp"
+#include "wasm/wasm_profiler.hpp"
 #include "eosio/vm/allocator.hpp"
 #include "persistence/cachewrapper.h"
 #include "entities/receipt.h"
@@ -24,25 +25,33 @@ namespace wasm {
     typedef CNickID nick_name;
     class wasm_context;
 
+    /**
+     * The context of the actions of a tx, one for the whole tx. The actions run one after another from a
+     * queue in the order of a depth first walk: an action runs on its receiver and then on the accounts it
+     * notified, then its inline actions run each with all of their own inline actions before the next one.
+     * trx, notified and inline_transactions are those of the action being executed, the console, the
+     * allocator and the wasm interface are shared by all of them.
+     */
     class wasm_context : public wasm_context_interface {
 
     public:
-        wasm_context(CWasmContractTx &ctrl, inline_transaction &t, CCacheWrapper &cw,
-                     vector <CReceipt> &receipts_in, bool mining, uint32_t depth = 0)
-                : trx(t), control_trx(ctrl), database(cw), receipts(receipts_in), recurse_depth(depth) {
+        wasm_context(CWasmContractTx &ctrl, CCacheWrapper &cw, vector <CReceipt> &receipts_in, bool mining)
+                : control_trx(ctrl), database(cw), receipts(receipts_in), recurse_depth(0),
+                  wasm_alloc(wasm_allocator_pool::acquire()), profiling(wasm_profiler::instance().enabled()) {
             reset_console();
         };
 
         ~wasm_context() {
-            wasm_alloc.free();
+            wasm_allocator_pool::release(wasm_alloc);
         };
 
     public:
         void                  initialize();
-        void                  execute(inline_transaction_trace &trace);
+        // execute an action of the tx and all the inline actions it sends
+        void                  execute(const inline_transaction &t, inline_transaction_trace &trace);
         void                  execute_one(inline_transaction_trace &trace);
         bool                  has_permission_from_inline_transaction(const permission &p);
-        std::vector <uint8_t> get_code(const uint64_t& account);
+        CContractCode get_code(const uint64_t& account);
 // Console methods:
     public:
         void                      reset_console();
@@ -70,7 +79,12 @@ namespace wasm {
         uint64_t    pending_block_time() { return control_trx.pending_block_time; }
         void        exit      () { wasmif.exit(); }
 
-        bool set_data( const uint64_t& contract, const string& k, const string& v ) {
+        // the regid of a contract whose data the action reads or writes, it can not change within the action
+        const CRegID& get_contract_regid( const uint64_t& contract ) {
+            auto it = contract_regids.find(contract);
+            if (it != contract_regids.end())
+                return it->second;
+
             CAccount   contract_account;
             wasm::name contract_name = wasm::name(contract);
             CHAIN_ASSERT( database.accountCache.GetAccount(nick_name(contract), contract_account),
@@ -78,29 +92,32 @@ namespace wasm {
                           "contract '%s' does not exist",
                           contract_name.to_string().c_str())
 
-            return database.contractCache.SetContractData(contract_account.regid, k, v);
+            return contract_regids.emplace(contract, contract_account.regid).first->second;
         }
 
-        bool get_data( const uint64_t& contract, const string& k, string &v ) {
-            CAccount   contract_account;
-            wasm::name contract_name = wasm::name(contract);
-            CHAIN_ASSERT( database.accountCache.GetAccount(nick_name(contract), contract_account),
-                          account_access_exception,
-                          "contract '%s' does not exist",
-                          contract_name.to_string().c_str())
+        bool set_data( const uint64_t& contract, const string& k, const string& v ) {
+            return database.contractCache.SetContractData(get_contract_regid(contract), k, v);
+        }
 
-            return database.contractCache.GetContractData(contract_account.regid, k, v);
+        bool get_data( const uint64_t& contract, const string& k, string &v ) {
+            return database.contractCache.GetContractData(get_contract_regid(contract), k, v);
         }
 
         bool erase_data( const uint64_t& contract, const string& k ) {
-            CAccount   contract_account;
-            wasm::name contract_name = wasm::name(contract);
-            CHAIN_ASSERT( database.accountCache.GetAccount(nick_name(contract), contract_account),
-                          account_access_exception,
-                          "contract '%s' does not exist",
-                          contract_name.to_string().c_str())
+            return database.contractCache.EraseContractData(get_contract_regid(contract), k);
+        }
 
-            return database.contractCache.EraseContractData(contract_account.regid, k);
+        bool scan_data( const uint64_t& contract, const string& prefix, const string& last_key, uint32_t max_rows,
+                        vector<pair<string, string>> &rows ) {
+            auto pContractDataIt = database.contractCache.CreateContractDataIterator(get_contract_regid(contract), prefix);
+            if (!pContractDataIt)
+                return false;
+
+            for (pContractDataIt->SeekUpper(&last_key); pContractDataIt->IsValid() && rows.size() < max_rows;
+                 pContractDataIt->Next()) {
+                rows.emplace_back(pContractDataIt->GetContractKey(), pContractDataIt->GetValue());
+            }
+            return true;
         }
 
         std::vector<uint64_t> get_active_producers();
@@ -113,17 +130,39 @@ namespace wasm {
             _pending_console_output << val;
         }
 
-        vm::wasm_allocator* get_wasm_allocator() { return &wasm_alloc; }
+        vm::wasm_allocator* get_wasm_allocator() { return wasm_alloc; }
         bool                is_memory_in_wasm_allocator ( const uint64_t& p ) { 
-            return wasm_alloc.is_in_range(reinterpret_cast<const char*>(p)); 
+            return wasm_alloc->is_in_range(reinterpret_cast<const char*>(p)); 
         }
         std::chrono::milliseconds get_max_transaction_duration() { return control_trx.get_max_transaction_duration(); }
+        bool     is_steps_metered() { return control_trx.steps_metered; }
+        uint64_t get_max_steps() {
+            return control_trx.fuel_limit > control_trx.run_cost ?
+                   (control_trx.fuel_limit - control_trx.run_cost) / execute_fuel_fee_per_step : 0;
+        }
+        void charge_steps( const uint64_t& steps ) { control_trx.run_cost += steps * execute_fuel_fee_per_step; }
         void                      update_storage_usage( const uint64_t& account, const int64_t& size_in_bytes);
         void                      pause_billing_timer ()  { control_trx.pause_billing_timer();  };
         void                      resume_billing_timer()  { control_trx.resume_billing_timer(); };
 
+        bool is_profiling() { return profiling; }
+        void record_host_call(uint32_t index, uint64_t nanos) {
+            auto &stats  = host_calls[index];
+            stats.calls += 1;
+            stats.nanos += nanos;
+        }
+
+    private:
+        struct pending_action {
+            inline_transaction        trx;
+            inline_transaction_trace* trace;  // in the inline traces of its sender, not moved until it runs
+            uint32_t                  depth;
+        };
+
+        void execute_action(pending_action &action, vector<pending_action> &pending);
+
     public:
-        inline_transaction&        trx;
+        inline_transaction         trx;
         CWasmContractTx&           control_trx;
         CCacheWrapper&             database;
         vector<CReceipt>&          receipts;
@@ -132,7 +171,10 @@ namespace wasm {
         vector<inline_transaction> inline_transactions;
 
         wasm::wasm_interface       wasmif;
-        vm::wasm_allocator         wasm_alloc;
+        vm::wasm_allocator*        wasm_alloc;  // from the pool of the thread
+        bool                       profiling;
+        std::map<uint64_t, CRegID> contract_regids;
+        std::map<uint32_t, wasm_host_call_stats> host_calls;  // of the action being profiled
         uint64_t                   _receiver;
 
     private:
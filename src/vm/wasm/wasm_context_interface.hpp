@@ -42,6 +42,9 @@ namespace wasm {
         virtual bool set_data  ( const uint64_t& contract, const string& k, const string& v ) = 0;//{ return 0; }
         virtual bool get_data  ( const uint64_t& contract, const string& k, string &v       ) = 0;//{ return 0; }
         virtual bool erase_data( const uint64_t& contract, const string& k                  ) = 0;//{ return 0; }
+        // the rows after last_key of the keys starting with prefix, at most max_rows, false if prefix is too long
+        virtual bool scan_data ( const uint64_t& contract, const string& prefix, const string& last_key,
+                                 uint32_t max_rows, vector<pair<string, string>> &rows ) = 0;
 
         virtual std::vector<uint64_t> get_active_producers() = 0;//{ return std::vector<uint64_t>(); }
         virtual vm::wasm_allocator*   get_wasm_allocator()   = 0;//{ return nullptr;                 }
@@ -52,12 +55,21 @@ namespace wasm {
         // }
         virtual std::chrono::milliseconds get_max_transaction_duration() = 0;//{ return std::chrono::milliseconds(max_wasm_execute_time_infinite); }
         virtual void update_storage_usage(const uint64_t& account, const int64_t& size_in_bytes) = 0;//{}
+        // the steps are function entries and loop iterations, the fee of those run is charged by charge_steps.
+        // Unless metered, e.g. before the MAJOR_VER_R4 fork, a watchdog timer bounds the execution instead
+        virtual bool     is_steps_metered() = 0;//{ return false; }
+        virtual uint64_t get_max_steps() = 0;//{ return std::numeric_limits<uint64_t>::max(); }
+        virtual void     charge_steps ( const uint64_t& steps ) = 0;//{}
         virtual bool contracts_console() = 0;//{ return true; }
         virtual void console_append   ( const string& val ) = 0;//{}
 
         virtual void pause_billing_timer () = 0;//{};
         virtual void resume_billing_timer() = 0;//{};
 
+        // -wasmprofile, the host function calls are timed and recorded by index of the host function
+        virtual bool is_profiling    () { return false; }
+        virtual void record_host_call( uint32_t index, uint64_t nanos ) {}
+
     };
 
 }
\ No newline at end of file
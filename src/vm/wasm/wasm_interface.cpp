@@ -14,10 +14,14 @@
 
 #include "wasm/exception/exceptions.hpp"
 
+#include "config/const.h"
 #include "crypto/hash.h"
 #include <openssl/ripemd.h>
 #include <openssl/sha.h>
 
+#include <list>
+#include <mutex>
+
 using namespace eosio;
 using namespace eosio::vm;
 
@@ -37,9 +41,85 @@ namespace wasm {
     using backend_validate_t = backend<wasm::wasm_context_interface, vm::interpreter>;
     using rhf_t              = eosio::vm::registered_host_functions<wasm_context_interface>;
 
-    std::optional<std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>>& get_wasm_instantiation_cache(){
-        static std::optional<std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>> wasm_instantiation_cache;
-        return wasm_instantiation_cache;
+    /**
+     * Instantiated modules by code hash, with their code to persist the cache. The least recently
+     * used module is evicted once the cache holds more than its capacity.
+     */
+    class wasm_module_cache {
+    public:
+        using module_ptr = std::shared_ptr<wasm_instantiated_module_interface>;
+        using code_ptr   = std::shared_ptr<const vector<uint8_t>>;
+
+        explicit wasm_module_cache(size_t capacity_in) : capacity(capacity_in) {}
+
+        module_ptr find(const code_version_t &code_hash) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = modules.find(code_hash);
+            if (it == modules.end())
+                return nullptr;
+
+            lru.splice(lru.begin(), lru, it->second.lru_it);
+            return it->second.module;
+        }
+
+        void insert(const code_version_t &code_hash, const module_ptr &module, const code_ptr &code) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = modules.find(code_hash);
+            if (it != modules.end()) {
+                lru.splice(lru.begin(), lru, it->second.lru_it);
+                return;
+            }
+
+            lru.push_front(code_hash);
+            modules[code_hash] = entry{module, code, lru.begin()};
+            evict();
+        }
+
+        // the codes of the cached modules, the most recently used first
+        vector<std::pair<code_version_t, code_ptr>> get_codes() {
+            std::lock_guard<std::mutex> lock(mutex);
+            vector<std::pair<code_version_t, code_ptr>> codes;
+            codes.reserve(lru.size());
+            for (const auto &code_hash : lru)
+                codes.emplace_back(code_hash, modules[code_hash].code);
+            return codes;
+        }
+
+        void set_capacity(size_t capacity_in) {
+            std::lock_guard<std::mutex> lock(mutex);
+            capacity = capacity_in;
+            evict();
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock(mutex);
+            modules.clear();
+            lru.clear();
+        }
+
+    private:
+        struct entry {
+            module_ptr module;
+            code_ptr code;
+            std::list<code_version_t>::iterator lru_it;
+        };
+
+        void evict() {
+            while (lru.size() > capacity) {
+                modules.erase(lru.back());
+                lru.pop_back();
+            }
+        }
+
+        std::mutex mutex;
+        size_t capacity;
+        std::list<code_version_t> lru;
+        std::map<code_version_t, entry> modules;
+    };
+
+    wasm_module_cache& get_wasm_module_cache(){
+        static wasm_module_cache wasm_module_cache(DEFAULT_WASM_MODULE_CACHE_SIZE);
+        return wasm_module_cache;
     }
 
     std::shared_ptr <wasm_runtime_interface>& get_runtime_interface(){
@@ -55,30 +135,29 @@ namespace wasm {
         get_runtime_interface()->immediately_exit_currently_running_module();
     }
 
-    std::shared_ptr <wasm_instantiated_module_interface> get_instantiated_backend(const vector <uint8_t> &code) {
-
-        try {
-            if(!get_wasm_instantiation_cache().has_value()){
-                 get_wasm_instantiation_cache() = std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>{};
-            }
+    std::shared_ptr <wasm_instantiated_module_interface> get_instantiated_backend(
+            const code_version_t &code_hash, const wasm_module_cache::code_ptr &code) {
 
-            auto code_id = Hash(code.begin(), code.end());
-            auto it = get_wasm_instantiation_cache()->find(code_id);
-            if (it == get_wasm_instantiation_cache()->end()) {
-                get_wasm_instantiation_cache().value()[code_id] = get_runtime_interface()->instantiate_module((const char*)code.data(), code.size());
-                return get_wasm_instantiation_cache().value()[code_id];
-            }
-            return it->second;
-        } catch (...) {
-            throw;
+        auto pModule = get_wasm_module_cache().find(code_hash);
+        if (pModule == nullptr) {
+            pModule = get_runtime_interface()->instantiate_module(code);
+            get_wasm_module_cache().insert(code_hash, pModule, code);
         }
+        return pModule;
 
     }
 
     void wasm_interface::execute(const vector <uint8_t> &code, wasm_context_interface *pWasmContext) {
 
+        execute(Hash(code.begin(), code.end()), std::make_shared<const vector<uint8_t>>(code), pWasmContext);
+
+    }
+
+    void wasm_interface::execute(const uint256 &code_hash, const std::shared_ptr<const vector <uint8_t>> &code,
+                                 wasm_context_interface *pWasmContext) {
+
         pWasmContext->pause_billing_timer();
-        auto pInstantiated_module = get_instantiated_backend(code);
+        auto pInstantiated_module = get_instantiated_backend(code_hash, code);
         pWasmContext->resume_billing_timer();
 
         //system_clock::time_point start = system_clock::now();
@@ -106,6 +185,12 @@ namespace wasm {
 
     void wasm_interface::initialize(vm_type vm) {
 
+        // the cached modules point to the runtime instantiating them
+        static std::mutex init_mutex;
+        std::lock_guard<std::mutex> lock(init_mutex);
+        if (get_runtime_interface())
+            return;
+
         if (vm == wasm::vm_type::eos_vm)
             get_runtime_interface() = std::make_shared<wasm::wasm_vm_runtime<vm::interpreter>>();
         else if (vm == wasm::vm_type::eos_vm_jit)
@@ -350,6 +435,124 @@ namespace wasm {
             return 1;
         }
 
+        // batched db, the keys and values are packed vectors. A result is written only if its buffer is large
+        // enough, the size of the packed result is returned in any case
+        int32_t db_get_batch( const void *keys, uint32_t keys_len, void *vals, uint32_t vals_len ) {
+
+            CHECK_WASM_IN_MEMORY(keys,     keys_len)
+            CHECK_WASM_DATA_SIZE(keys_len, "keys"  )
+
+            auto k_list   = wasm::unpack<std::vector<string>>((const char *) keys, keys_len);
+            auto contract = pWasmContext->receiver();
+            CHAIN_ASSERT( k_list.size() <= max_db_batch_size,
+                          wasm_chain::wasm_assert_exception,
+                          "db_get_batch keys size must be <= %u, but get %u", max_db_batch_size, k_list.size())
+
+            std::vector<std::optional<string>> v_list;
+            v_list.reserve(k_list.size());
+            for (auto &k : k_list) {
+                AddPrefix(contract, k);
+                string v;
+                if (pWasmContext->get_data(contract, k, v))
+                    v_list.emplace_back(std::move(v));
+                else
+                    v_list.emplace_back();
+            }
+
+            return copy_packed_result(v_list, vals, vals_len);
+        }
+
+        int32_t db_store_batch( const uint64_t payer, const void *kvs, uint32_t kvs_len ) {
+
+            CHECK_WASM_IN_MEMORY(kvs,     kvs_len)
+            CHECK_WASM_DATA_SIZE(kvs_len, "kvs"  )
+
+            auto kv_list  = wasm::unpack<std::vector<std::pair<string, string>>>((const char *) kvs, kvs_len);
+            auto contract = pWasmContext->receiver();
+            CHAIN_ASSERT( kv_list.size() <= max_db_batch_size,
+                          wasm_chain::wasm_assert_exception,
+                          "db_store_batch kvs size must be <= %u, but get %u", max_db_batch_size, kv_list.size())
+
+            int64_t storage_usage = 0;
+            for (auto &kv : kv_list) {
+                AddPrefix(contract, kv.first);
+                CHAIN_ASSERT( pWasmContext->set_data(contract, kv.first, kv.second),
+                              wasm_chain::wasm_assert_exception,
+                              "db_store_batch failed, key: %s", ToHex(kv.first))
+                storage_usage += kv.first.size() + kv.second.size();
+            }
+
+            pWasmContext->update_storage_usage(payer, storage_usage);
+            return kv_list.size();
+        }
+
+        int32_t db_remove_batch( const uint64_t payer, const void *keys, uint32_t keys_len ) {
+
+            CHECK_WASM_IN_MEMORY(keys,     keys_len)
+            CHECK_WASM_DATA_SIZE(keys_len, "keys"  )
+
+            auto k_list   = wasm::unpack<std::vector<string>>((const char *) keys, keys_len);
+            auto contract = pWasmContext->receiver();
+            CHAIN_ASSERT( k_list.size() <= max_db_batch_size,
+                          wasm_chain::wasm_assert_exception,
+                          "db_remove_batch keys size must be <= %u, but get %u", max_db_batch_size, k_list.size())
+
+            int64_t storage_usage = 0;
+            for (auto &k : k_list) {
+                AddPrefix(contract, k);
+                CHAIN_ASSERT( pWasmContext->erase_data(contract, k),
+                              wasm_chain::wasm_assert_exception,
+                              "db_remove_batch failed, key: %s", ToHex(k))
+                storage_usage += k.size();
+            }
+
+            pWasmContext->update_storage_usage(payer, storage_usage);
+            return k_list.size();
+        }
+
+        // the packed rows (key, value) after last_key of the keys starting with prefix, an empty last_key
+        // scans from the first key
+        int32_t db_scan( const void *prefix, uint32_t prefix_len, const void *last_key, uint32_t last_key_len,
+                         uint32_t max_rows, void *rows, uint32_t rows_len ) {
+
+            CHECK_WASM_IN_MEMORY(prefix,       prefix_len  )
+            CHECK_WASM_IN_MEMORY(last_key,     last_key_len)
+            CHECK_WASM_DATA_SIZE(prefix_len,   "prefix"    )
+            CHECK_WASM_DATA_SIZE(last_key_len, "last_key"  )
+            CHAIN_ASSERT( max_rows <= max_db_batch_size,
+                          wasm_chain::wasm_assert_exception,
+                          "db_scan max_rows must be <= %u, but get %u", max_db_batch_size, max_rows)
+
+            auto   contract = pWasmContext->receiver();
+            string p        = string((const char *) prefix, prefix_len);
+            string last     = string((const char *) last_key, last_key_len);
+            AddPrefix(contract, p);
+            if (!last.empty())
+                AddPrefix(contract, last);
+
+            std::vector<std::pair<string, string>> row_list;
+            CHAIN_ASSERT( pWasmContext->scan_data(contract, p, last, max_rows, row_list),
+                          wasm_chain::wasm_assert_exception,
+                          "db_scan failed, prefix: %s", ToHex(p))
+
+            // the keys are returned as stored by the contract, without the receiver
+            size_t receiver_size = wasm::pack(contract).size();
+            for (auto &row : row_list)
+                row.first.erase(0, receiver_size);
+
+            return copy_packed_result(row_list, rows, rows_len);
+        }
+
+        template<typename T>
+        int32_t copy_packed_result( const T &result, void *data, uint32_t data_len ) {
+            std::vector<char> packed = wasm::pack(result);
+            if (data_len >= packed.size()) {
+                CHECK_WASM_IN_MEMORY(data, packed.size())
+                std::memcpy(data, packed.data(), packed.size());
+            }
+            return packed.size();
+        }
+
 
         //memory
         void *memcpy( void *dest, const void *src, int len ) {
@@ -908,6 +1111,10 @@ namespace wasm {
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_remove, db_remove)
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_get,    db_get)
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_update, db_update)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_get_batch,    db_get_batch)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_store_batch,  db_store_batch)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_remove_batch, db_remove_batch)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_scan,         db_scan)
 
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, memcpy,  memcpy)
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, memmove, memmove)
@@ -989,5 +1196,24 @@ namespace wasm {
 
 extern  void wasm_code_cache_free() {
      //free heap before shut down
-     wasm::get_wasm_instantiation_cache().reset();
+     wasm::get_wasm_module_cache().clear();
+}
+
+extern void wasm_code_cache_set_capacity(size_t capacity) {
+     wasm::get_wasm_module_cache().set_capacity(capacity);
+}
+
+extern void wasm_code_cache_get_codes(vector<std::pair<uint256, std::shared_ptr<const vector<uint8_t>>>> &codes) {
+     codes = wasm::get_wasm_module_cache().get_codes();
+}
+
+// instantiate the code into the cache ahead of its first call, false if it is not a valid module
+extern bool wasm_code_cache_preload(const uint256 &code_hash, const vector<uint8_t> &code) {
+     try {
+          wasm::wasm_interface().initialize(wasm::vm_type::eos_vm_jit);
+          wasm::get_instantiated_backend(code_hash, std::make_shared<const vector<uint8_t>>(code));
+          return true;
+     } catch (...) {
+          return false;
+     }
 }
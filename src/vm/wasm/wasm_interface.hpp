@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <map>
+#include <memory>
+#include "commons/uint256.h"
 #include "wasm/wasm_context_interface.hpp"
 #include "wasm/wasm_runtime.hpp"
 
@@ -24,6 +26,10 @@ namespace wasm {
     public:
         void initialize(vm_type vm);
         void execute(const vector <uint8_t>& code, wasm_context_interface *pWasmContext);
+        // code_hash keys the instantiated module cache, it must be the hash of code. The cache keeps the
+        // shared code instead of a copy
+        void execute(const uint256& code_hash, const std::shared_ptr<const vector <uint8_t>>& code,
+                     wasm_context_interface *pWasmContext);
         void validate(const vector <uint8_t>& code);
         void exit();
 
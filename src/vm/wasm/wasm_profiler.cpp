@@ -0,0 +1,75 @@
+#include "wasm/wasm_profiler.hpp"
+#include "wasm/wasm_context_interface.hpp"
+#include "wasm/types/name.hpp"
+#include "eosio/vm/host_function.hpp"
+
+#include <fstream>
+
+namespace wasm {
+
+    wasm_profiler& wasm_profiler::instance() {
+        static wasm_profiler profiler;
+        return profiler;
+    }
+
+    void wasm_profiler::record(const action_key &key, uint64_t nanos, uint32_t pages,
+                               const std::map<uint32_t, wasm_host_call_stats> &host_calls) {
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &profile = profiles[key];
+        profile.executions++;
+        profile.nanos    += nanos;
+        profile.max_nanos = std::max(profile.max_nanos, nanos);
+        profile.pages    += pages;
+        profile.max_pages = std::max(profile.max_pages, pages);
+        for (const auto &item : host_calls) {
+            auto &stats  = profile.host_calls[item.first];
+            stats.calls += item.second.calls;
+            stats.nanos += item.second.nanos;
+        }
+    }
+
+    std::map<wasm_profiler::action_key, wasm_action_profile> wasm_profiler::get_profiles() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return profiles;
+    }
+
+    void wasm_profiler::reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        profiles.clear();
+    }
+
+    std::vector<std::string> wasm_profiler::get_folded_stacks() const {
+
+        std::vector<std::string> stacks;
+        for (const auto &item : get_profiles()) {
+            std::string frame   = wasm::name(item.first.first).to_string() + ";" +
+                                  wasm::name(item.first.second).to_string();
+            uint64_t host_nanos = 0;
+            for (const auto &call : item.second.host_calls) {
+                stacks.push_back(frame + ";" + get_host_function_name(call.first) + " " +
+                                 std::to_string(call.second.nanos));
+                host_nanos += call.second.nanos;
+            }
+            uint64_t self_nanos = item.second.nanos > host_nanos ? item.second.nanos - host_nanos : 0;
+            stacks.push_back(frame + " " + std::to_string(self_nanos));
+        }
+        return stacks;
+    }
+
+    bool wasm_profiler::dump(const std::string &path) const {
+
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        for (const auto &stack : get_folded_stacks())
+            file << stack << "\n";
+        return file.good();
+    }
+
+    std::string wasm_profiler::get_host_function_name(uint32_t index) {
+        return vm::registered_host_functions<wasm_context_interface>::get_name(index);
+    }
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wasm {
+
+    struct wasm_host_call_stats {
+        uint64_t calls = 0;
+        uint64_t nanos = 0;
+    };
+
+    // the executions of an action by a contract, the wall times include the host calls
+    struct wasm_action_profile {
+        uint64_t executions = 0;
+        uint64_t nanos      = 0;
+        uint64_t max_nanos  = 0;
+        uint64_t pages      = 0;  // linear memory pages in use at the end of the executions, summed
+        uint32_t max_pages  = 0;
+        std::map<uint32_t, wasm_host_call_stats> host_calls;  // by index of the host function
+    };
+
+    /**
+     * Optional profiler of the wasm contracts, enabled by -wasmprofile. The wasm contexts record the
+     * wall time, the linear memory pages and the host function calls of each action they execute, by
+     * receiver and action. The JIT backend does not count instructions, the wall time stands for them.
+     */
+    class wasm_profiler {
+    public:
+        // receiver, action
+        using action_key = std::pair<uint64_t, uint64_t>;
+
+        static wasm_profiler& instance();
+
+        bool enabled() const { return fEnabled; }
+        void set_enabled(bool fEnabledIn) { fEnabled = fEnabledIn; }
+
+        void record(const action_key &key, uint64_t nanos, uint32_t pages,
+                    const std::map<uint32_t, wasm_host_call_stats> &host_calls);
+        std::map<action_key, wasm_action_profile> get_profiles() const;
+        void reset();
+
+        // lines "receiver;action[;host function] nanos" of the self times, the input of flamegraph.pl
+        std::vector<std::string> get_folded_stacks() const;
+        bool dump(const std::string &path) const;
+
+        static std::string get_host_function_name(uint32_t index);
+
+    private:
+        wasm_profiler() : fEnabled(false) {}
+
+        std::atomic<bool> fEnabled;
+        mutable std::mutex mutex;
+        std::map<action_key, wasm_action_profile> profiles;
+    };
+
+}
@@ -109,6 +109,18 @@ namespace wasm { namespace rpc{
         > curl --user myusername -d '{"jsonrpc": "1.0", "id":"curltest", "method":"gettxtrace", "params":"68feb6a4097a45d6e56f5b84f6c381b0c638a1306eb95b7ee2354e19838461e4"}' -H 'Content-Type: application/json;' http://127.0.0.1:8332
     )=====";
 
+    const char *get_wasm_profile_rpc_help_message = R"=====(
+        getwasmprofile ( reset )
+        1."reset": (bool, optional) Clear the profile after it is returned, default false
+        Result the wall time, linear memory pages and host function calls of the wasm actions by contract, requires -wasmprofile
+        "profiles":      (array)
+        "folded_stacks": (array of string) self time in nanoseconds by "contract;action;host_function", as flamegraph.pl input
+        Examples:
+        > ./coind getwasmprofile true
+        As json rpc call 
+        > curl --user myusername -d '{"jsonrpc": "1.0", "id":"curltest", "method":"getwasmprofile", "params":[true]}' -H 'Content-Type: application/json;' http://127.0.0.1:8332
+    )=====";
+
     const char *abi_def_json_to_bin_wasm_rpc_help_message = R"=====(
         abijsontobinwasm "abijson" 
         1."abijson": (string, required) abi json file from cdt
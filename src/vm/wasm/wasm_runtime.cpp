@@ -4,6 +4,10 @@
 #include"eosio/vm/watchdog.hpp"
 #include"wasm/wasm_log.hpp"
 #include "wasm/exception/exceptions.hpp"
+#include "commons/util/allocator.h"
+
+#include <atomic>
+#include <mutex>
 
 
 using namespace eosio;
@@ -17,81 +21,195 @@ namespace wasm {
 
     wasm_runtime_interface::~wasm_runtime_interface() {}
 
+    // memories kept by a thread, enough for the contexts of the inline actions nested in a tx
+    static const size_t max_pooled_wasm_allocators = 8;
+
+    namespace {
+        std::atomic<uint32_t> mapped_wasm_allocators{0};
+
+        struct thread_wasm_allocators {
+            std::vector<vm::wasm_allocator*> free_list;
+
+            ~thread_wasm_allocators() {
+                for (auto walloc : free_list) {
+                    walloc->free();
+                    delete walloc;
+                    mapped_wasm_allocators--;
+                }
+            }
+        };
+
+        thread_wasm_allocators& get_thread_wasm_allocators() {
+            thread_local thread_wasm_allocators allocators;
+            return allocators;
+        }
+    }
+
+    vm::wasm_allocator* wasm_allocator_pool::acquire() {
+        auto &free_list = get_thread_wasm_allocators().free_list;
+        if (free_list.empty()) {
+            auto walloc = new vm::wasm_allocator();
+            // the kernel backs the pages touched by the contract with huge pages once they are in use
+            AdviseHugePages(walloc->get_base_ptr<char>(), max_memory);
+            mapped_wasm_allocators++;
+            return walloc;
+        }
+
+        auto walloc = free_list.back();
+        free_list.pop_back();
+        return walloc;
+    }
+
+    void wasm_allocator_pool::release(vm::wasm_allocator* walloc) {
+        auto &free_list = get_thread_wasm_allocators().free_list;
+        if (free_list.size() < max_pooled_wasm_allocators) {
+            try {
+                walloc->discard();
+                free_list.push_back(walloc);
+                return;
+            } catch (vm::exception &) {
+            }
+        }
+        walloc->free();
+        delete walloc;
+        mapped_wasm_allocators--;
+    }
+
+    uint32_t wasm_allocator_pool::mapped_count() {
+        return mapped_wasm_allocators.load();
+    }
+
     template<typename Impl>
     class wasm_vm_instantiated_module : public wasm_instantiated_module_interface {
         using backend_t = backend<wasm::wasm_context_interface, Impl>;
     public:
 
-        wasm_vm_instantiated_module(wasm_vm_runtime <Impl> *runtime, std::shared_ptr <backend_t> mod) :
+        wasm_vm_instantiated_module(wasm_vm_runtime <Impl> *runtime, std::shared_ptr<const vector <uint8_t>> code,
+                                    std::unique_ptr <backend_t> bkend) :
                 _runtime(runtime),
-                _instantiated_module(std::move(mod)) {}
+                _code(std::move(code)) {
+            _idle_backends.push_back(std::move(bkend));
+        }
 
         void apply(wasm::wasm_context_interface *pContext) override {
 
             //WASM_TRACE("receiver:%d contract:%d action:%d",pContext->receiver(), pContext->contract(), pContext->action() )
-            _instantiated_module->set_wasm_allocator(pContext->get_wasm_allocator());
-            _runtime->_bkend = _instantiated_module.get();
-            _runtime->_bkend->initialize(pContext);
-            // clamp WASM memory to maximum_linear_memory/wasm_page_size
-            auto &module = _runtime->_bkend->get_module();
-            if (module.memories.size() &&
-                ((module.memories.at(0).limits.maximum >
-                  wasm_constraints::maximum_linear_memory / wasm_constraints::wasm_page_size)
-                 || !module.memories.at(0).limits.flags)) {
-                module.memories.at(0).limits.flags = true;
-                module.memories.at(0).limits.maximum =
-                        wasm_constraints::maximum_linear_memory / wasm_constraints::wasm_page_size;
-            }
+            auto bkend         = acquire_backend();
+            auto saved_bkend   = wasm_vm_runtime<Impl>::_bkend;
+            auto release_guard = scope_guard([&]() {
+                wasm_vm_runtime<Impl>::_bkend = saved_bkend;
+                release_backend(std::move(bkend));
+            });
+
+            bkend->set_wasm_allocator(pContext->get_wasm_allocator());
+            wasm_vm_runtime<Impl>::_bkend = bkend.get();
+            bkend->initialize(pContext);
+
             auto fn = [&]() {
-                const auto &res = _runtime->_bkend->call(
+                const auto &res = bkend->call(
                         pContext, "env", "apply", pContext->receiver(),
                         pContext->contract(),
                         pContext->action());
             };
+
+            // metered, the steps bound the execution deterministically instead of a watchdog timer
+            bool     metered   = pContext->is_steps_metered();
+            uint64_t max_steps = metered ? pContext->get_max_steps() : std::numeric_limits<uint64_t>::max();
+            bkend->get_context().set_remaining_steps(max_steps);
+            auto charge_guard = scope_guard([&]() {
+                if (metered)
+                    pContext->charge_steps(max_steps - bkend->get_context().get_remaining_steps());
+            });
             try {
-                watchdog wd(pContext->get_max_transaction_duration());
-                _runtime->_bkend->timed_run(wd, fn);
+                if (metered) {
+                    fn();
+                } else {
+                    watchdog wd(pContext->get_max_transaction_duration());
+                    bkend->timed_run(wd, fn);
+                }
             } catch (vm::timeout_exception &) {
                 CHAIN_THROW(wasm_chain::wasm_timeout_exception, "timeout exception");
+            } catch (vm::steps_exhausted_exception &) {
+                CHAIN_THROW(wasm_chain::wasm_steps_exhausted_exception, "execution steps exhausted");
             } catch (vm::wasm_memory_exception &e) {
                 CHAIN_THROW(wasm_chain::wasm_memory_exception, "access violation");
             } catch ( vm::exception &e ) {
                 // FIXME: Do better translation
                 CHAIN_THROW(wasm_chain::wasm_execution_error, "something went wrong...");
             }
-            _runtime->_bkend = nullptr;
         }
 
     private:
-        wasm_vm_runtime <Impl> *    _runtime;
-        std::shared_ptr <backend_t> _instantiated_module;
+        // a backend runs on one thread at a time, a thread finding none idle instantiates its own
+        std::unique_ptr <backend_t> acquire_backend() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_idle_backends.empty()) {
+                    auto bkend = std::move(_idle_backends.back());
+                    _idle_backends.pop_back();
+                    return bkend;
+                }
+            }
+            return _runtime->instantiate_backend(*_code);
+        }
+
+        void release_backend(std::unique_ptr <backend_t> bkend) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _idle_backends.push_back(std::move(bkend));
+        }
+
+        wasm_vm_runtime <Impl> *                 _runtime;
+        std::shared_ptr<const vector <uint8_t>>  _code;
+        std::mutex                               _mutex;
+        std::vector<std::unique_ptr <backend_t>> _idle_backends;
     };
 
+    template<typename Impl>
+    thread_local backend <wasm::wasm_context_interface, Impl> *wasm_vm_runtime<Impl>::_bkend = nullptr;
+
     template<typename Impl>
     wasm_vm_runtime<Impl>::wasm_vm_runtime() {}
 
     template<typename Impl>
     void wasm_vm_runtime<Impl>::immediately_exit_currently_running_module() {
-        throw wasm_exit{};
+        // only the thread running a module is unwound, the backends of the other threads go on
+        if (_bkend != nullptr)
+            throw wasm_exit{};
     }
 
     template<typename Impl>
     void wasm_vm_runtime<Impl>::validate(const vector <uint8_t> &code) {}
 
     template<typename Impl>
-    std::shared_ptr <wasm_instantiated_module_interface>
-    wasm_vm_runtime<Impl>::instantiate_module(const char *code_bytes, size_t code_size) {
+    std::unique_ptr <backend <wasm::wasm_context_interface, Impl>>
+    wasm_vm_runtime<Impl>::instantiate_backend(const vector <uint8_t> &code_bytes) {
         using backend_t = backend<wasm::wasm_context_interface, Impl>;
         try {
-            wasm_code_ptr code((uint8_t *) code_bytes, code_size);
-            std::shared_ptr <backend_t> bkend = std::make_shared<backend_t>(code, code_size);
+            wasm_code_ptr code((uint8_t *) code_bytes.data(), code_bytes.size());
+            std::unique_ptr <backend_t> bkend = std::make_unique<backend_t>(code, code_bytes.size());
             registered_host_functions<wasm_context_interface>::resolve(bkend->get_module());
-            return std::make_shared<wasm_vm_instantiated_module<Impl>>(this, std::move(bkend));
+            // clamp WASM memory to maximum_linear_memory/wasm_page_size
+            auto &module = bkend->get_module();
+            if (module.memories.size() &&
+                ((module.memories.at(0).limits.maximum >
+                  wasm_constraints::maximum_linear_memory / wasm_constraints::wasm_page_size)
+                 || !module.memories.at(0).limits.flags)) {
+                module.memories.at(0).limits.flags = true;
+                module.memories.at(0).limits.maximum =
+                        wasm_constraints::maximum_linear_memory / wasm_constraints::wasm_page_size;
+            }
+            return bkend;
         } catch (vm::exception &e) {
             CHAIN_THROW(wasm_chain::wasm_execution_error, "Error building eos-vm interp: %s", e.what());
         }
     }
 
+    template<typename Impl>
+    std::shared_ptr <wasm_instantiated_module_interface>
+    wasm_vm_runtime<Impl>::instantiate_module(const std::shared_ptr<const vector <uint8_t>> &code) {
+        return std::make_shared<wasm_vm_instantiated_module<Impl>>(this, code, instantiate_backend(*code));
+    }
+
     template
     class wasm_vm_runtime<vm::interpreter>;
 
@@ -13,23 +13,40 @@ namespace wasm {
 
    class wasm_runtime_interface {
    public:
-      virtual std::shared_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size) = 0;
+      // the module keeps the code to instantiate a backend for each thread running it at once
+      virtual std::shared_ptr<wasm_instantiated_module_interface> instantiate_module(const std::shared_ptr<const vector <uint8_t>>& code) = 0;
       virtual void immediately_exit_currently_running_module() = 0;
       virtual void validate(const vector <uint8_t> &code) = 0;
 
       virtual ~wasm_runtime_interface();
    };
 
+    /**
+     * The linear memories of the wasm contexts run by a thread, mapped once and reused. A released
+     * memory gives its pages back with madvise(MADV_DONTNEED) instead of being unmapped, so a context
+     * costs neither the mmap/munmap of the whole region nor zeroing the pages used before.
+     */
+    class wasm_allocator_pool {
+    public:
+        static vm::wasm_allocator* acquire();
+        static void                release(vm::wasm_allocator* walloc);
+        // the memories mapped by all threads, pooled or in use
+        static uint32_t            mapped_count();
+    };
+
     template<typename Backend>
     class wasm_vm_runtime : public wasm_runtime_interface{
     public:
         wasm_vm_runtime();
-        std::shared_ptr <wasm_instantiated_module_interface> instantiate_module(const char *code_bytes, size_t code_size) override;
+        std::shared_ptr <wasm_instantiated_module_interface> instantiate_module(const std::shared_ptr<const vector <uint8_t>> &code) override;
         void immediately_exit_currently_running_module() override;
         void validate(const vector <uint8_t> &code) override;
 
+        std::unique_ptr <backend <wasm::wasm_context_interface, Backend>> instantiate_backend(const vector <uint8_t> &code);
+
     public:
-        backend <wasm::wasm_context_interface, Backend> *_bkend = nullptr;  // non owning pointer to allow for immediate exit
+        // the backend running on this thread, non owning pointer to allow for immediate exit
+        static thread_local backend <wasm::wasm_context_interface, Backend> *_bkend;
     };
 
 
@@ -242,6 +242,15 @@ bool CCryptoKeyStore::GetKey(const CKeyID& address, CKey& keyOut, bool isMiner)
     return false;
 }
 
+bool CCryptoKeyStore::GetKeys(const set<CKeyID>& keyIds, map<CKeyID, CKey>& keysOut) const {
+    LOCK(cs_KeyStore);
+    for (const auto& keyId : keyIds) {
+        if (!GetKey(keyId, keysOut[keyId]))
+            return false;
+    }
+    return true;
+}
+
 bool CCryptoKeyStore::GetPubKey(const CKeyID& address, CPubKey& vchPubKeyOut, bool isMiner) const {
     {
         LOCK(cs_KeyStore);
@@ -161,6 +161,8 @@ public:
         return false;
     }
     bool GetKey(const CKeyID& address, CKey& keyOut, bool IsMiner = false) const;
+    // the main keys of a batch of signatures, decrypted once under one hold of the lock, false if one is missing
+    bool GetKeys(const set<CKeyID>& keyIds, map<CKeyID, CKey>& keysOut) const;
 
     bool GetPubKey(const CKeyID& address, CPubKey& vchPubKeyOut, bool IsMiner = false) const;
 
@@ -20,6 +20,8 @@
 #include "commons/json/json_spirit_writer_template.h"
 #include "net.h"
 #include "persistence/accountdb.h"
+#include "persistence/block.h"
+#include "chain/txlookupcache.h"
 #include "persistence/contractdb.h"
 #include "../logging.h"
 #include "tx/txserializer.h"
@@ -114,62 +116,67 @@ void CWallet::SyncTransaction(const uint256 &hash, CBaseTx *pTx, const CBlock *p
     assert(pTx != nullptr || pBlock != nullptr);
 
     if (hash.IsNull() && pTx == nullptr) {  // this is block Sync
-        uint256 blockhash         = pBlock->GetHash();
-        auto GenesisBlockProgress = [&]() {};
-
-        auto ConnectBlockProgress = [&]() {
-            CAccountTx netTx(this, blockhash, pBlock->GetHeight());
-            for (const auto &sptx : pBlock->vptx) {
-                uint256 txid = sptx->GetHash();
-                // confirm the tx is mine
-                if (IsMine(sptx.get())) {
-                    netTx.AddTx(txid, sptx.get());
-                }
-                if (unconfirmedTx.count(txid) > 0) {
-                    CWalletDB(strWalletFile).EraseUnconfirmedTx(txid);
-                    unconfirmedTx.erase(txid);
-                }
-            }
-            if (netTx.GetTxSize() > 0) {          // write to disk
-                mapInBlockTx[blockhash] = netTx;  // add to map
-                netTx.WriteToDisk();
+        LOCK(cs_main);
+        auto it        = mapBlockIndex.find(pBlock->GetHash());
+        bool connected = it != mapBlockIndex.end() && chainActive.Contains(it->second);
+        CCacheWrapper cw(pCdMan);
+        SyncBlock(*pBlock, connected, cw);
+    }
+}
+
+void CWallet::SyncBlock(const CBlock &block, bool connected, CCacheWrapper &cw) {
+    uint256 blockhash = block.GetHash();
+    // GenesisBlock progress
+    if (SysCfg().GetGenesisBlockHash() == blockhash)
+        return;
+
+    LOCK(cs_wallet);
+    if (connected) {
+        CAccountTx netTx(this, blockhash, block.GetHeight());
+        uint32_t txOffset = GetSizeOfCompactSize(block.vptx.size());
+        for (const auto &sptx : block.vptx) {
+            uint256 txid = sptx->GetHash();
+            // confirm the tx is mine
+            if (IsMine(sptx.get(), cw)) {
+                netTx.AddTx(txid, sptx.get(), txOffset);
+                // the sender of a pubkey is registered by the tx
+                CRegID regId;
+                if (sptx->txUid.is<CPubKey>() &&
+                    cw.accountCache.GetRegId(sptx->txUid.get<CPubKey>().GetKeyId(), regId))
+                    idIndex.AddRegId(regId);
             }
-        };
-
-        auto DisConnectBlockProgress = [&]() {
-            for (const auto &sptx : pBlock->vptx) {
-                if (sptx->IsBlockRewardTx()) {
-                    continue;
-                }
-                if (IsMine(sptx.get())) {
-                    unconfirmedTx[sptx.get()->GetHash()] = sptx.get()->GetNewInstance();
-                    CWalletDB(strWalletFile).WriteUnconfirmedTx(sptx.get()->GetHash(), unconfirmedTx[sptx.get()->GetHash()]);
-                }
+            if (unconfirmedTx.erase(txid) > 0) {
+                txLog.EraseUnconfirmedTx(txid);
             }
-            if (mapInBlockTx.count(blockhash)) {
-                CWalletDB(strWalletFile).EraseBlockTx(blockhash);
-                mapInBlockTx.erase(blockhash);
+            txOffset += ::GetSerializeSize(sptx, SER_DISK, CLIENT_VERSION);
+        }
+        if (netTx.GetTxSize() > 0) {          // write to disk
+            mapInBlockTx[blockhash] = netTx;  // add to map
+            netTx.WriteToDisk();
+        }
+    } else {
+        idIndex.ResetRegIds();
+        for (const auto &sptx : block.vptx) {
+            if (sptx->IsBlockRewardTx()) {
+                continue;
             }
-        };
-
-        auto IsConnect = [&]() {  // Connect or disconnect
-            return mapBlockIndex.count(blockhash) && chainActive.Contains(mapBlockIndex[blockhash]);
-        };
-
-        {
-            LOCK2(cs_main, cs_wallet);
-            // GenesisBlock progress
-            if (SysCfg().GetGenesisBlockHash() == blockhash) {
-                GenesisBlockProgress();
-            } else if (IsConnect()) {
-                // connect block
-                ConnectBlockProgress();
-            } else {
-                // disconnect block
-                DisConnectBlockProgress();
+            if (IsMine(sptx.get(), cw)) {
+                uint256 txid       = sptx->GetHash();
+                unconfirmedTx[txid] = sptx->GetNewInstance();
+                txLog.WriteUnconfirmedTx(txid, unconfirmedTx[txid]);
             }
         }
+        if (mapInBlockTx.erase(blockhash) > 0) {
+            txLog.EraseBlockTx(blockhash);
+        }
     }
+    CompactTxLogIfNeeded();
+}
+
+void CWallet::CompactTxLogIfNeeded() {
+    AssertLockHeld(cs_wallet);
+    if (txLog.IsOpen() && txLog.NeedsCompaction(mapInBlockTx.size() + unconfirmedTx.size()))
+        txLog.Compact(*this);
 }
 
 void CWallet::EraseTransaction(const uint256 &hash) {
@@ -179,7 +186,7 @@ void CWallet::EraseTransaction(const uint256 &hash) {
         LOCK(cs_wallet);
         if (unconfirmedTx.count(hash)) {
             unconfirmedTx.erase(hash);
-            CWalletDB(strWalletFile).EraseUnconfirmedTx(hash);
+            txLog.EraseUnconfirmedTx(hash);
         }
     }
 
@@ -202,7 +209,7 @@ void CWallet::ResendWalletTransactions() {
         }
     }
     for (auto const &tee : erase) {
-        CWalletDB(strWalletFile).EraseUnconfirmedTx(tee);
+        txLog.EraseUnconfirmedTx(tee);
         unconfirmedTx.erase(tee);
     }
 }
@@ -228,7 +235,7 @@ std::tuple<bool, string> CWallet::CommitTx(CBaseTx *pTx) {
 
     uint256 txid        = pTx->GetHash();
     unconfirmedTx[txid] = pTx->GetNewInstance();
-    bool flag           = CWalletDB(strWalletFile).WriteUnconfirmedTx(txid, unconfirmedTx[txid]);
+    bool flag           = txLog.WriteUnconfirmedTx(txid, unconfirmedTx[txid]);
     string message      = txid.ToString();
 
     if (!flag) {
@@ -247,7 +254,34 @@ std::tuple<bool, string> CWallet::CommitTx(CBaseTx *pTx) {
 
 DBErrors CWallet::LoadWallet(bool fFirstRunRet) {
     // fFirstRunRet = false;
-    return CWalletDB(strWalletFile, "cr+").LoadWallet(this);
+    DBErrors ret = CWalletDB(strWalletFile, "cr+").LoadWallet(this);
+    if ((ret != DB_LOAD_OK && ret != DB_NONCRITICAL_ERROR) || !fFileBacked)
+        return ret;
+
+    LOCK(cs_wallet);
+    // the txs of the older wallets are in wallet.dat, they are moved to the tx log
+    vector<uint256> dbBlockTxs, dbUnconfirmedTxs;
+    for (const auto &item : mapInBlockTx)
+        dbBlockTxs.push_back(item.first);
+    for (const auto &item : unconfirmedTx)
+        dbUnconfirmedTxs.push_back(item.first);
+
+    if (!txLog.Open(strWalletFile, this))
+        return DB_LOAD_FAIL;
+
+    if (!dbBlockTxs.empty() || !dbUnconfirmedTxs.empty()) {
+        if (!txLog.Compact(*this))
+            return DB_LOAD_FAIL;
+
+        CWalletDB walletdb(strWalletFile);
+        for (const auto &blockHash : dbBlockTxs)
+            walletdb.EraseBlockTx(blockHash);
+        for (const auto &txid : dbUnconfirmedTxs)
+            walletdb.EraseUnconfirmedTx(txid);
+        LogPrint(BCLog::WALLET, "%s : moved %u block txs and %u unconfirmed txs from %s to the tx log\n", __func__,
+                 dbBlockTxs.size(), dbUnconfirmedTxs.size(), strWalletFile);
+    }
+    return ret;
 }
 
 int64_t CWallet::GetFreeCoins(TokenSymbol coinCymbol, bool isConfirmed) const {
@@ -443,12 +477,76 @@ CWallet *CWallet::GetInstance() {
     return nullptr;
 }
 
+bool CAccountTx::GetTx(const uint256 &hash, std::shared_ptr<CBaseTx> &pBaseTx) const {
+    auto it = mapAccountTx.find(hash);
+    if (it == mapAccountTx.end())
+        return false;
+
+    LOCK(cs_main);
+    auto itIndex = mapBlockIndex.find(blockHash);
+    if (itIndex == mapBlockIndex.end())
+        return ERRORMSG("%s : block %s of tx %s not found", __func__, blockHash.GetHex(), hash.GetHex());
+
+    if (it->second.txOffset != UNKNOWN_TX_OFFSET) {
+        CDiskTxPos diskTxPos(itIndex->second->GetBlockPos(), it->second.txOffset);
+        CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
+        CBlockHeader header;
+        try {
+            file >> header;
+            fseek(file, diskTxPos.nTxOffset, SEEK_CUR);
+            file >> pBaseTx;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    } else {
+        CBlockView view;
+        if (!ReadBlockViewFromDisk(itIndex->second, view))
+            return ERRORMSG("%s : read block %s failed", __func__, blockHash.GetHex());
+
+        pBaseTx = nullptr;
+        for (uint32_t index = 0; index < view.GetTxCount(); index++) {
+            auto pTx = view.GetTx(index);
+            if (pTx && pTx->GetHash() == hash) {
+                pBaseTx = pTx;
+                break;
+            }
+        }
+    }
+    if (!pBaseTx || pBaseTx->GetHash() != hash)
+        return ERRORMSG("%s : tx %s not found in block %s", __func__, hash.GetHex(), blockHash.GetHex());
+
+    return true;
+}
+
+bool CWallet::GetConfirmedTx(const uint256 &txid, CConfirmedTx &confirmedTx) const {
+    LOCK2(cs_main, cs_wallet);
+    for (const auto &item : mapInBlockTx) {
+        if (!item.second.mapAccountTx.count(txid))
+            continue;
+
+        auto it = mapBlockIndex.find(item.first);
+        if (it == mapBlockIndex.end() || !chainActive.Contains(it->second))
+            continue;
+
+        if (!item.second.GetTx(txid, confirmedTx.pBaseTx))
+            return false;
+
+        confirmedTx.height    = it->second->height;
+        confirmedTx.time      = it->second->GetBlockTime();
+        confirmedTx.blockHash = item.first;
+        return true;
+    }
+    return false;
+}
+
 Object CAccountTx::ToJsonObj(CKeyID const &key) const {
     Object obj;
 
     Array txsArr;
     for (auto const &item : mapAccountTx) {
-        txsArr.push_back(item.second.get()->ToString(*pCdMan->pAccountCache));
+        std::shared_ptr<CBaseTx> pBaseTx;
+        if (GetTx(item.first, pBaseTx))
+            txsArr.push_back(pBaseTx->ToString(*pCdMan->pAccountCache));
     }
 
     obj.push_back(Pair("block_hash",    blockHash.ToString()));
@@ -465,15 +563,15 @@ uint256 CWallet::GetCheckSum() const {
 }
 
 bool CWallet::IsMine(CBaseTx *pTx) const {
-    auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
-
-    set<CKeyID> keyIds;
-    if (!pTx->GetInvolvedKeyIds(*spCW, keyIds)) {
-        return false;
-    }
+    CCacheWrapper cw(pCdMan);
+    return IsMine(pTx, cw);
+}
 
-    for (auto &keyid : keyIds) {
-        if (HaveKey(keyid) > 0) {
+bool CWallet::IsMine(CBaseTx *pTx, CCacheWrapper &cw) const {
+    vector<CUserID> uids;
+    pTx->GetInvolvedUids(uids);
+    for (const auto &uid : uids) {
+        if (idIndex.IsMine(uid, cw)) {
             return true;
         }
     }
@@ -481,16 +579,111 @@ bool CWallet::IsMine(CBaseTx *pTx) const {
     return false;
 }
 
+void CWalletIdIndex::AddKeyId(const CKeyID &keyId) {
+    std::lock_guard<std::mutex> lock(cs);
+    if (!keyIds.insert(keyId).second)
+        return;
+
+    // the regids seen before may be of the new key
+    recentRegIds.clear();
+    recentRing.clear();
+    nextRecent = 0;
+    ++generation;
+}
+
+void CWalletIdIndex::RemoveKeyId(const CKeyID &keyId) {
+    std::lock_guard<std::mutex> lock(cs);
+    if (keyIds.erase(keyId) == 0)
+        return;
+
+    // the regids of the key are resolved again
+    regIds.clear();
+    ++generation;
+}
+
+void CWalletIdIndex::Clear() {
+    std::lock_guard<std::mutex> lock(cs);
+    keyIds.clear();
+    regIds.clear();
+    recentRegIds.clear();
+    recentRing.clear();
+    nextRecent = 0;
+    ++generation;
+}
+
+void CWalletIdIndex::AddRegId(const CRegID &regId) {
+    std::lock_guard<std::mutex> lock(cs);
+    regIds.insert(regId);
+    recentRegIds.erase(regId);
+}
+
+void CWalletIdIndex::ResetRegIds() {
+    std::lock_guard<std::mutex> lock(cs);
+    regIds.clear();
+    recentRegIds.clear();
+    recentRing.clear();
+    nextRecent = 0;
+    ++generation;
+}
+
+void CWalletIdIndex::AddRecentRegId(const CRegID &regId) {
+    if (!recentRegIds.insert(regId).second)
+        return;
+
+    if (recentRing.size() < WALLET_RECENT_REGID_SIZE) {
+        recentRing.push_back(regId);
+        return;
+    }
+    recentRegIds.erase(recentRing[nextRecent]);
+    recentRing[nextRecent] = regId;
+    nextRecent = (nextRecent + 1) % WALLET_RECENT_REGID_SIZE;
+}
+
+bool CWalletIdIndex::IsMine(const CUserID &uid, CCacheWrapper &cw) {
+    if (uid.is<CKeyID>()) {
+        std::lock_guard<std::mutex> lock(cs);
+        return keyIds.count(uid.get<CKeyID>()) > 0;
+    }
+
+    if (uid.is<CPubKey>()) {
+        CKeyID keyId = uid.get<CPubKey>().GetKeyId();
+        std::lock_guard<std::mutex> lock(cs);
+        return keyIds.count(keyId) > 0;
+    }
+
+    uint64_t lookupGeneration = 0;
+    if (uid.is<CRegID>()) {
+        std::lock_guard<std::mutex> lock(cs);
+        const CRegID &regId = uid.get<CRegID>();
+        if (regIds.count(regId))
+            return true;
+        if (recentRegIds.count(regId))
+            return false;
+        lookupGeneration = generation;
+    }
+
+    // the nickids and the regids seen for the first time are looked up without cs
+    CKeyID keyId;
+    if (!cw.accountCache.GetKeyId(uid, keyId))
+        return false;
+
+    std::lock_guard<std::mutex> lock(cs);
+    bool fMine = keyIds.count(keyId) > 0;
+    if (uid.is<CRegID>() && lookupGeneration == generation) {
+        if (fMine)
+            regIds.insert(uid.get<CRegID>());
+        else
+            AddRecentRegId(uid.get<CRegID>());
+    }
+    return fMine;
+}
+
 bool CWallet::CleanAll() {
-    for_each(unconfirmedTx.begin(), unconfirmedTx.end(),
-             [&](std::map<uint256, std::shared_ptr<CBaseTx> >::reference a) {
-                 CWalletDB(strWalletFile).EraseUnconfirmedTx(a.first);
-             });
     unconfirmedTx.clear();
-
-    for_each(mapInBlockTx.begin(), mapInBlockTx.end(),
-             [&](std::map<uint256, CAccountTx>::reference a) { CWalletDB(strWalletFile).EraseUnconfirmedTx(a.first); });
     mapInBlockTx.clear();
+    // the tx log is rewritten empty
+    if (txLog.IsOpen())
+        txLog.Compact(*this);
 
     bestBlock.SetNull();
 
@@ -499,6 +692,10 @@ bool CWallet::CleanAll() {
             CWalletDB(strWalletFile).EraseKeyStoreValue(item.first);
         });
         mapKeys.clear();
+        idIndex.Clear();
+        for (const auto &keyId : setKeyPool)
+            CWalletDB(strWalletFile).EraseKeyPool(keyId);
+        setKeyPool.clear();
     } else {
         return ERRORMSG("wallet is encrypted hence clear data forbidden!");
     }
@@ -526,6 +723,7 @@ bool CWallet::SignCompact(const CKeyID &keyId, const uint256 &hash, vector<uint8
 bool CWallet::AddCryptedKey(const CPubKey &vchPubKey, const std::vector<uint8_t> &vchCryptedSecret) {
     if (!CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret))
         return false;
+    idIndex.AddKeyId(vchPubKey.GetKeyId());
 
     if (!fFileBacked)
         return true;
@@ -541,6 +739,7 @@ bool CWallet::AddCryptedKey(const CPubKey &vchPubKey, const std::vector<uint8_t>
 }
 
 bool CWallet::LoadCryptedKey(const CPubKey &vchPubKey, const std::vector<uint8_t> &vchCryptedSecret) {
+    idIndex.AddKeyId(vchPubKey.GetKeyId());
     return CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret);
 }
 
@@ -556,15 +755,26 @@ bool CWallet::AddKey(const CKeyID &KeyId, const CKeyCombi &keyCombi) {
     if (!fFileBacked)
         return true;
 
+    CWalletDB walletdb(strWalletFile);
+    return AddKey(KeyId, keyCombi, walletdb);
+}
+
+bool CWallet::AddKey(const CKeyID &KeyId, const CKeyCombi &keyCombi, CWalletDB &walletdb) {
+    if (!fFileBacked)
+        return true;
+
     if (keyCombi.HaveMainKey()) {
         if (KeyId != keyCombi.GetCKeyID())
             return false;
     }
 
-    if (!CWalletDB(strWalletFile).WriteKeyStoreValue(KeyId, keyCombi, nWalletVersion))
+    if (!walletdb.WriteKeyStoreValue(KeyId, keyCombi, nWalletVersion))
         return false;
 
-    return CCryptoKeyStore::AddKeyCombi(KeyId, keyCombi);
+    if (!CCryptoKeyStore::AddKeyCombi(KeyId, keyCombi))
+        return false;
+    idIndex.AddKeyId(KeyId);
+    return true;
 }
 
 bool CWallet::AddKey(const CKey &key) {
@@ -575,12 +785,87 @@ bool CWallet::AddKey(const CKey &key) {
     return AddKey(key.GetPubKey().GetKeyId(), keyCombi);
 }
 
+bool CWallet::AddKeys(const vector<CKey> &keys, bool fKeyPool) {
+    LOCK(cs_wallet);
+    if (!fFileBacked || IsLocked())
+        return false;
+
+    CWalletDB walletdb(strWalletFile);
+    if (!walletdb.TxnBegin())
+        return ERRORMSG("%s : begin the wallet db txn failed", __func__);
+
+    // the crypted keys are written in the txn too
+    assert(!pWalletDbEncryption);
+    pWalletDbEncryption = &walletdb;
+    bool fAdded         = true;
+    for (const auto &key : keys) {
+        CKeyID keyId = key.GetPubKey().GetKeyId();
+        if (!AddKey(keyId, CKeyCombi(key, nWalletVersion), walletdb) ||
+            (fKeyPool && !walletdb.WriteKeyPool(keyId))) {
+            fAdded = false;
+            break;
+        }
+    }
+    pWalletDbEncryption = nullptr;
+
+    if (!fAdded || !walletdb.TxnCommit()) {
+        walletdb.TxnAbort();
+        return ERRORMSG("%s : add %u keys to the wallet failed", __func__, keys.size());
+    }
+
+    if (fKeyPool) {
+        for (const auto &key : keys)
+            setKeyPool.insert(key.GetPubKey().GetKeyId());
+    }
+    return true;
+}
+
+uint32_t CWallet::TakeKeysFromPool(uint32_t count, vector<CKeyID> &keyIds) {
+    LOCK(cs_wallet);
+    if (setKeyPool.empty() || count == 0)
+        return 0;
+
+    CWalletDB walletdb(strWalletFile);
+    if (!walletdb.TxnBegin())
+        return 0;
+
+    // the records are erased before the keys are served, a served key is never served again
+    vector<CKeyID> taken;
+    for (auto it = setKeyPool.begin(); it != setKeyPool.end() && taken.size() < count; ++it) {
+        if (!walletdb.EraseKeyPool(*it)) {
+            walletdb.TxnAbort();
+            return 0;
+        }
+        taken.push_back(*it);
+    }
+    if (!walletdb.TxnCommit())
+        return 0;
+
+    for (const auto &keyId : taken)
+        setKeyPool.erase(keyId);
+    keyIds.insert(keyIds.end(), taken.begin(), taken.end());
+    return taken.size();
+}
+
+size_t CWallet::GetKeyPoolSize() const {
+    LOCK(cs_wallet);
+    return setKeyPool.size();
+}
+
+bool CWallet::IsInKeyPool(const CKeyID &keyId) const {
+    LOCK(cs_wallet);
+    return setKeyPool.count(keyId) > 0;
+}
+
 bool CWallet::RemoveKey(const CKey &key) {
     CKeyID keyId = key.GetPubKey().GetKeyId();
     
     if (!IsEncrypted()) { //unencrypted or unlocked
         CWalletDB(strWalletFile).EraseKeyStoreValue(keyId);
         mapKeys.erase(keyId);
+        idIndex.RemoveKeyId(keyId);
+        if (setKeyPool.erase(keyId) > 0)
+            CWalletDB(strWalletFile).EraseKeyPool(keyId);
     } else {
         return ERRORMSG("wallet is being locked hence no key removal!");
     }
@@ -15,14 +15,18 @@
 #include <utility>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
 
 #include "crypter.h"
 #include "entities/key.h"
 #include "entities/keystore.h"
 #include "commons/util/util.h"
 #include "walletdb.h"
+#include "wallettxlog.h"
 #include "main.h"
 #include "commons/serialize.h"
+#include "commons/flathashmap.h"
 #include "tx/cointransfertx.h"
 #include "tx/blockrewardtx.h"
 #include "tx/contracttx.h"
@@ -34,6 +38,44 @@ enum WalletFeature {
     FEATURE_WALLETCRYPT = 10000,  // wallet encryption
 };
 
+// the regids of the other accounts remembered by IsMine
+static const uint32_t WALLET_RECENT_REGID_SIZE = 4096;
+
+/**
+ * The uids matched by IsMine: the keyids of the wallet keys, the regids resolved to them and a ring of the
+ * regids of the other accounts seen lately, so the uids of a tx are matched with hash probes and only a
+ * regid seen for the first time is looked up in the account cache. The regids of the wallet keys are added
+ * as their accounts register, the resolved regids are dropped with a disconnected block, the regids of its
+ * registrations may belong to other accounts on the new branch.
+ */
+class CWalletIdIndex {
+public:
+    CWalletIdIndex() : nextRecent(0), generation(0) {}
+
+    void AddKeyId(const CKeyID &keyId);
+    void RemoveKeyId(const CKeyID &keyId);
+    void Clear();
+
+    // the account of a wallet key was registered
+    void AddRegId(const CRegID &regId);
+    void ResetRegIds();
+
+    bool IsMine(const CUserID &uid, CCacheWrapper &cw);
+
+private:
+    typedef std::unordered_set<CRegID, CRegIDHasher> RegIdSet;
+
+    void AddRecentRegId(const CRegID &regId);  // with cs held
+
+    std::mutex cs;
+    std::unordered_set<CKeyID, CSerializeHasher<CKeyID>> keyIds;
+    RegIdSet regIds;        // the regids of keyIds
+    RegIdSet recentRegIds;  // the regids of the other accounts
+    std::vector<CRegID> recentRing;  // recentRegIds in the order seen, the oldest is replaced
+    size_t nextRecent;
+    uint64_t generation;  // changed by the resets, the lookups started before them are not kept
+};
+
 /** A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
  */
@@ -47,6 +89,8 @@ private:
 
     int32_t nWalletVersion;
     CBlockLocator  bestBlock;
+    mutable CWalletIdIndex idIndex;
+    set<CKeyID> setKeyPool;  // of the keys not served yet by getnewaddr
     uint256 GetCheckSum() const;
 
 public:
@@ -57,6 +101,7 @@ public:
 
     map<uint256, CAccountTx> mapInBlockTx;
     map<uint256, std::shared_ptr<CBaseTx> > unconfirmedTx;
+    CWalletTxLog txLog;  // of mapInBlockTx and unconfirmedTx, wallet.dat keeps the keys
     mutable CCriticalSection cs_wallet;
 
     typedef std::map<uint32_t, CMasterKey> MasterKeyMap;
@@ -96,14 +141,27 @@ public:
 
     //! Adds a key to the store, without saving it to disk (used by LoadWallet)
     bool LoadKeyCombi(const CKeyID &keyId, const CKeyCombi &keyCombi) {
+        idIndex.AddKeyId(keyId);
         return CBasicKeyStore::AddKeyCombi(keyId, keyCombi);
     }
     // Adds a key to the store, and saves it to disk.
     bool AddKey(const CKey &secret, const CKey &minerKey);
     bool AddKey(const CKeyID &keyId, const CKeyCombi &store);
+    bool AddKey(const CKeyID &keyId, const CKeyCombi &store, CWalletDB &walletdb);
     bool AddKey(const CKey &key);
+    // add the keys in one wallet.dat txn, to the key pool or not
+    bool AddKeys(const vector<CKey> &keys, bool fKeyPool);
     bool RemoveKey(const CKey &key);
 
+    void LoadKeyPool(const CKeyID &keyId) { setKeyPool.insert(keyId); }
+    // take up to count keys out of the key pool
+    uint32_t TakeKeysFromPool(uint32_t count, vector<CKeyID> &keyIds);
+    size_t GetKeyPoolSize() const;
+    bool IsInKeyPool(const CKeyID &keyId) const;
+
+    // read a wallet tx of the active chain from the block files, without the tx index
+    bool GetConfirmedTx(const uint256 &txid, CConfirmedTx &confirmedTx) const;
+
     bool CleanAll(); //just for unit test
     bool IsReadyForColdMining(const CAccountDBCache& accountView)const;
     bool DropMainKeysForColdMining();
@@ -114,14 +172,19 @@ public:
     bool LoadMinVersion(int32_t nVersion);
 
     void SyncTransaction(const uint256 &hash, CBaseTx *pTx, const CBlock* pblock);
+    // the block was connected or disconnected, its txs are matched to the keys on cw
+    void SyncBlock(const CBlock &block, bool connected, CCacheWrapper &cw);
     void EraseTransaction(const uint256 &hash);
     void ResendWalletTransactions();
 
     bool IsMine(CBaseTx*pTx)const;
+    bool IsMine(CBaseTx *pTx, CCacheWrapper &cw) const;
 
     void SetBestChain(const CBlockLocator& loc);
 
     DBErrors LoadWallet(bool fFirstRunRet);
+    // compact the tx log once it is mostly erased records
+    void CompactTxLogIfNeeded();
 
     bool EncryptWallet(const SecureString& strWalletPassphrase);
 
@@ -163,6 +226,29 @@ public:
     )
 };
 
+// the offset of a wallet tx in its block is not known, the tx is looked up by its txid in the block
+static const uint32_t UNKNOWN_TX_OFFSET = UINT32_MAX;
+
+/** The summary of a wallet tx of a block, the tx itself is read from the block files on demand */
+struct CAccountTxSummary {
+    TxType nTxType     = NULL_TX;
+    TokenSymbol feeSymbol;
+    uint64_t llFees    = 0;
+    uint32_t txOffset  = UNKNOWN_TX_OFFSET;  // the nTxOffset of its CDiskTxPos
+
+    CAccountTxSummary() {}
+    CAccountTxSummary(const CBaseTx &tx, uint32_t txOffsetIn)
+        : nTxType(tx.nTxType), feeSymbol(tx.fee_symbol), llFees(tx.llFees), txOffset(txOffsetIn) {}
+
+    IMPLEMENT_SERIALIZE
+    (
+        READWRITE((uint8_t &)nTxType);
+        READWRITE(feeSymbol);
+        READWRITE(VARINT(llFees));
+        READWRITE(VARINT(txOffset));
+    )
+};
+
 class CAccountTx {
 private:
     CWallet* pWallet;
@@ -170,7 +256,7 @@ private:
 public:
     uint256 blockHash;
     int32_t blockHeight;
-    map<uint256, std::shared_ptr<CBaseTx> > mapAccountTx;
+    map<uint256, CAccountTxSummary> mapAccountTx;
 public:
     CAccountTx(CWallet* pWalletIn = NULL, uint256 hash = uint256(), int32_t height = 0) {
         pWallet = pWalletIn;
@@ -188,11 +274,15 @@ public:
         }
     }
 
-    bool AddTx(const uint256 &hash, const CBaseTx *pTx) {
-        mapAccountTx[hash] = pTx->GetNewInstance();
+    // the offset of the tx in the block after the header, as counted by ConnectBlock() for the tx index
+    bool AddTx(const uint256 &hash, const CBaseTx *pTx, uint32_t txOffset = UNKNOWN_TX_OFFSET) {
+        mapAccountTx[hash] = CAccountTxSummary(*pTx, txOffset);
         return true;
     }
 
+    // read the tx from the block files, the block must be in mapBlockIndex
+    bool GetTx(const uint256 &hash, std::shared_ptr<CBaseTx> &pBaseTx) const;
+
     bool HaveTx(const uint256 &hash) {
         if (mapAccountTx.end() != mapAccountTx.find(hash)) {
             return true;
@@ -209,7 +299,7 @@ public:
     }
 
     bool WriteToDisk() {
-        return CWalletDB(pWallet->strWalletFile).WriteBlockTx(blockHash, *this);
+        return pWallet->txLog.WriteBlockTx(*this);
     }
 
     Object ToJsonObj(CKeyID const &key = CKeyID()) const;
@@ -220,6 +310,16 @@ public:
         READWRITE(blockHeight);
         READWRITE(mapAccountTx);
     )
+
+    // the format kept the whole txs before the summaries, the offsets of the txs are not known
+    template <typename Stream>
+    void UnserializeLegacy(Stream &s) {
+        map<uint256, std::shared_ptr<CBaseTx> > mapTx;
+        s >> blockHash >> blockHeight >> mapTx;
+        mapAccountTx.clear();
+        for (const auto &item : mapTx)
+            mapAccountTx[item.first] = CAccountTxSummary(*item.second, UNKNOWN_TX_OFFSET);
+    }
 };
 
 #endif
@@ -26,7 +26,7 @@ using namespace boost;
 // CWalletDB
 //
 
-bool ReadKeyValue(CWallet* pWallet, CDataStream& ssKey, CDataStream& ssValue, string& strType, string& strErr,
+bool ReadKeyValue(CWallet* pWallet, CSecureDataStream& ssKey, CSecureDataStream& ssValue, string& strType, string& strErr,
                   int32_t MinVersion) {
     try {
         // Unserialize
@@ -87,9 +87,14 @@ bool ReadKeyValue(CWallet* pWallet, CDataStream& ssKey, CDataStream& ssValue, st
             uint256 hash;
             CAccountTx atx;
             ssKey >> hash;
-            ssValue >> atx;
+            atx.UnserializeLegacy(ssValue);
             if (pWallet != nullptr)
                 pWallet->mapInBlockTx[hash] = atx;
+        } else if (strType == "pool") {
+            CKeyID keyId;
+            ssKey >> keyId;
+            if (pWallet != nullptr)
+                pWallet->LoadKeyPool(keyId);
         } else if (strType == "defaultkey") {
             if (pWallet != nullptr)
                 ssValue >> pWallet->vchDefaultKey;
@@ -126,8 +131,8 @@ DBErrors CWalletDB::LoadWallet(CWallet* pWallet) {
 
         while (true) {
             // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssValue(SER_DISK, CLIENT_VERSION);
             int32_t ret = ReadAtCursor(pCursor, ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
@@ -248,8 +253,8 @@ bool CWalletDB::Recover(CDBEnv& dbenv, string filename, bool fOnlyKeys) {
     DbTxn* ptxn = dbenv.TxnBegin();
     for (auto& row : salvagedData) {
         if (fOnlyKeys) {
-            CDataStream ssKey(row.first, SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(row.second, SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssKey(row.first, SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssValue(row.second, SER_DISK, CLIENT_VERSION);
             string strType, strErr;
             bool fReadOK = ReadKeyValue(nullptr, ssKey, ssValue, strType, strErr, -1);
             if (strType != "keystore")
@@ -273,11 +278,6 @@ bool CWalletDB::Recover(CDBEnv& dbenv, string filename, bool fOnlyKeys) {
 
 bool CWalletDB::Recover(CDBEnv& dbenv, string filename) { return CWalletDB::Recover(dbenv, filename, false); }
 
-bool CWalletDB::WriteBlockTx(const uint256& hash, const CAccountTx& atx) {
-    nWalletDBUpdated++;
-    return Write(make_pair(string("blocktx"), hash), atx);
-}
-
 bool CWalletDB::EraseBlockTx(const uint256& hash) {
     nWalletDBUpdated++;
     return Erase(make_pair(string("blocktx"), hash));
@@ -294,6 +294,16 @@ bool CWalletDB::EraseKeyStoreValue(const CKeyID& keyId) {
     return Erase(make_pair(string("keystore"), keyId));
 }
 
+bool CWalletDB::WriteKeyPool(const CKeyID& keyId) {
+    nWalletDBUpdated++;
+    return Write(make_pair(string("pool"), keyId), GetTime());
+}
+
+bool CWalletDB::EraseKeyPool(const CKeyID& keyId) {
+    nWalletDBUpdated++;
+    return Erase(make_pair(string("pool"), keyId));
+}
+
 bool CWalletDB::WriteCryptedKey(const CPubKey& pubkey, const std::vector<unsigned char>& vchCryptedSecret) {
     nWalletDBUpdated++;
     if (!Write(std::make_pair(std::string("ckey"), pubkey), vchCryptedSecret, true))
@@ -442,6 +452,13 @@ bool BackupWallet(const CWallet& wallet, const string& strDest) {
 #else
                     boost::filesystem::copy_file(pathSrc, pathDest);
 #endif
+                    // the txs are in the tx log, a tail torn by an append during the copy is truncated by its open
+                    boost::filesystem::path pathTxLog = pathSrc.string() + WALLET_TX_LOG_SUFFIX;
+                    if (boost::filesystem::exists(pathTxLog)) {
+                        boost::filesystem::path pathTxLogDest = pathDest.string() + WALLET_TX_LOG_SUFFIX;
+                        boost::filesystem::remove(pathTxLogDest);
+                        boost::filesystem::copy_file(pathTxLog, pathTxLogDest);
+                    }
                     LogPrint(BCLog::INFO, "copied wallet.dat into %s\n", pathDest.string());
                     return true;
                 } catch (const boost::filesystem::filesystem_error& e) {
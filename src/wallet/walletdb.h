@@ -52,7 +52,8 @@ public:
     bool WriteCryptedKey(const CPubKey& pubkey, const std::vector<unsigned char>& vchCryptedSecret);
     bool WriteKeyStoreValue(const CKeyID& keyId, const CKeyCombi& KeyStoreValue, int32_t nVersion);
     bool EraseKeyStoreValue(const CKeyID& keyId);
-    bool WriteBlockTx(const uint256& hash, const CAccountTx& atx);
+    bool WriteKeyPool(const CKeyID& keyId);
+    bool EraseKeyPool(const CKeyID& keyId);
     bool EraseBlockTx(const uint256& hash);
     bool WriteUnconfirmedTx(const uint256& hash, const std::shared_ptr<CBaseTx>& tx);
     bool EraseUnconfirmedTx(const uint256& hash);
@@ -0,0 +1,88 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "walletkeypool.h"
+
+#include "logging.h"
+#include "config/configuration.h"
+#include "wallet/wallet.h"
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+CWalletKeyPool walletKeyPool;
+
+void CWalletKeyPool::Start(CWallet *pWalletIn) {
+    pWallet    = pWalletIn;
+    targetSize = (uint32_t)max<int64_t>(0, min<int64_t>(SysCfg().GetArg("-keypool", DEFAULT_KEYPOOL_SIZE),
+                                                        MAX_KEYPOOL_SIZE));
+}
+
+void CWalletKeyPool::Notify() {
+    boost::unique_lock<boost::mutex> lock(notifyMutex);
+    fNotified = true;
+    notifyCond.notify_one();
+}
+
+void CWalletKeyPool::GenerateKeys(uint32_t count, vector<CKey> &keys) {
+    keys.resize(count);
+    uint32_t threads = max<uint32_t>(1, min<uint32_t>(boost::thread::hardware_concurrency(), MAX_KEYPOOL_THREADS));
+    threads          = min(threads, max<uint32_t>(1, count / 16));
+
+    // the keys are split in contiguous slices, the last one is generated by the calling thread
+    auto generate = [&keys, count, threads](uint32_t slice) {
+        for (uint32_t i = count * slice / threads; i < count * (slice + 1) / threads; i++)
+            keys[i].MakeNewKey();
+    };
+    boost::thread_group workers;
+    for (uint32_t slice = 0; slice + 1 < threads; slice++)
+        workers.create_thread([&generate, slice]() { generate(slice); });
+    generate(threads - 1);
+    workers.join_all();
+}
+
+bool CWalletKeyPool::Refill() {
+    size_t poolSize = pWallet->GetKeyPoolSize();
+    if (poolSize >= (targetSize + 1) / 2)
+        return true;
+
+    if (pWallet->IsLocked())
+        return false;
+
+    int64_t beginTime = GetTimeMillis();
+    while (poolSize < targetSize) {
+        boost::this_thread::interruption_point();
+
+        vector<CKey> keys;
+        GenerateKeys(min<uint32_t>(targetSize - poolSize, KEYPOOL_REFILL_BATCH), keys);
+        if (!pWallet->AddKeys(keys, true))
+            return false;
+        poolSize = pWallet->GetKeyPoolSize();
+    }
+    LogPrint(BCLog::WALLET, "%s : refilled the key pool to %u keys (%dms)\n", __func__, poolSize,
+             GetTimeMillis() - beginTime);
+    return true;
+}
+
+void CWalletKeyPool::Run() {
+    while (true) {
+        bool fRefilled = Refill();
+
+        boost::unique_lock<boost::mutex> lock(notifyMutex);
+        // a locked wallet is polled, it is unlocked without a notification
+        if (!fNotified) {
+            if (fRefilled)
+                notifyCond.wait(lock);
+            else
+                notifyCond.timed_wait(lock, boost::posix_time::seconds(KEYPOOL_RETRY_INTERVAL));
+        }
+        fNotified = false;
+    }
+}
+
+void ThreadWalletKeyPool() {
+    RenameThread("coin-keypool");
+    walletKeyPool.Run();
+}
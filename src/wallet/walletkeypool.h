@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef WALLET_WALLETKEYPOOL_H
+#define WALLET_WALLETKEYPOOL_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "entities/key.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CWallet;
+
+// the keys kept ready in the pool, set by -keypool
+static const uint32_t DEFAULT_KEYPOOL_SIZE = 100;
+static const uint32_t MAX_KEYPOOL_SIZE     = 100000;
+// the keys added to the wallet at most by one refill
+static const uint32_t KEYPOOL_REFILL_BATCH = 1000;
+static const uint32_t MAX_KEYPOOL_THREADS  = 8;
+// the refills of a locked wallet are retried after this many seconds
+static const int64_t KEYPOOL_RETRY_INTERVAL = 10;
+
+/**
+ * The pool of the wallet keys generated ahead of getnewaddr and getnewaddrs. A thread of its own tops
+ * up the pool once it is below half of -keypool: the keys are generated on up to MAX_KEYPOOL_THREADS
+ * threads, then added to the wallet in one wallet.dat txn with their "pool" records, so the keys served
+ * are never served again after a restart. The pool keys are the wallet keys already, their txs are
+ * synced before they are served. An encrypted wallet is refilled only while it is unlocked, the pool
+ * keys are served while it is locked.
+ */
+class CWalletKeyPool {
+public:
+    CWalletKeyPool() : pWallet(nullptr), targetSize(DEFAULT_KEYPOOL_SIZE), fNotified(false) {}
+
+    void Start(CWallet *pWalletIn);
+    // wake the thread for a refill, after the keys were taken from the pool
+    void Notify();
+
+    // refill the pool until shutdown
+    void Run();
+
+    // generate the keys on the key pool threads
+    static void GenerateKeys(uint32_t count, std::vector<CKey> &keys);
+
+private:
+    bool Refill();
+
+    CWallet *pWallet;
+    uint32_t targetSize;
+    boost::mutex notifyMutex;
+    boost::condition_variable notifyCond;
+    bool fNotified;
+};
+
+extern CWalletKeyPool walletKeyPool;
+
+void ThreadWalletKeyPool();
+
+#endif  // WALLET_WALLETKEYPOOL_H
@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "walletnotify.h"
+
+#include "logging.h"
+#include "persistence/statesnapshot.h"
+#include "wallet/wallet.h"
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+CWalletNotifier walletNotifier;
+
+void CWalletNotifier::Start(CWallet *pWalletIn) {
+    pWallet = pWalletIn;
+    RegisterWallet(this);
+}
+
+// called by UpdateTip() with cs_main held, the block is connected when it is the new tip
+void CWalletNotifier::SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock) {
+    // the wallet only syncs the txs of the blocks
+    if (pBlock == nullptr)
+        return;
+
+    bool connected = chainActive.Tip() != nullptr && chainActive.Tip()->GetBlockHash() == pBlock->GetHash();
+    CNotification notification(connected ? NOTIFY_BLOCK_CONNECTED : NOTIFY_BLOCK_DISCONNECTED);
+    notification.spBlock = std::make_shared<CBlock>(*pBlock);
+    Push(std::move(notification));
+}
+
+void CWalletNotifier::EraseTransaction(const uint256 &hash) {
+    CNotification notification(NOTIFY_TX_ERASED);
+    notification.txid = hash;
+    Push(std::move(notification));
+}
+
+void CWalletNotifier::SetBestChain(const CBlockLocator &locator) {
+    CNotification notification(NOTIFY_BEST_CHAIN);
+    notification.locator = locator;
+    Push(std::move(notification));
+}
+
+void CWalletNotifier::ResendWalletTransactions() { Push(CNotification(NOTIFY_RESEND_TXS)); }
+
+void CWalletNotifier::Push(CNotification &&notification) {
+    deque<CNotification> notifications;
+    {
+        boost::unique_lock<boost::mutex> lock(queueMutex);
+        if (!fStopped) {
+            queue.push_back(std::move(notification));
+            ++pushedSequence;
+            queueCond.notify_one();
+            return;
+        }
+        notifications.push_back(std::move(notification));
+    }
+    Sync(notifications);
+}
+
+void CWalletNotifier::SyncWithWallet() {
+    boost::unique_lock<boost::mutex> lock(queueMutex);
+    uint64_t sequence = pushedSequence;
+    while (syncedSequence < sequence && !fStopped)
+        syncCond.wait(lock);
+}
+
+void CWalletNotifier::Sync(deque<CNotification> &notifications) {
+    // the blocks of a batch share a view, the tip of the snapshot is at or after them
+    unique_ptr<CStateSnapshot::CReadView> pView;
+    for (auto &notification : notifications) {
+        switch (notification.type) {
+            case NOTIFY_BLOCK_CONNECTED:
+            case NOTIFY_BLOCK_DISCONNECTED:
+                if (!pView)
+                    pView.reset(new CStateSnapshot::CReadView(CStateSnapshot::GetCurrent()));
+                pWallet->SyncBlock(*notification.spBlock, notification.type == NOTIFY_BLOCK_CONNECTED, pView->cw);
+                break;
+            case NOTIFY_TX_ERASED:
+                pWallet->EraseTransaction(notification.txid);
+                break;
+            case NOTIFY_BEST_CHAIN: {
+                LOCK(pWallet->cs_wallet);
+                pWallet->SetBestChain(notification.locator);
+                break;
+            }
+            case NOTIFY_RESEND_TXS:
+                // the resent txs are committed on the live state, not on the view
+                pView.reset();
+                pWallet->ResendWalletTransactions();
+                break;
+        }
+    }
+}
+
+void CWalletNotifier::Run() {
+    bool fInterrupted = false;
+    while (true) {
+        deque<CNotification> notifications;
+        {
+            boost::unique_lock<boost::mutex> lock(queueMutex);
+            if (!fInterrupted) {
+                try {
+                    while (queue.empty())
+                        queueCond.wait(lock);
+                } catch (boost::thread_interrupted &) {
+                    fInterrupted = true;
+                }
+            }
+
+            // the pushes after the thread exits are synced by their callers, once the queue is drained
+            if (fInterrupted && queue.empty()) {
+                fStopped = true;
+                syncCond.notify_all();
+                return;
+            }
+            notifications.swap(queue);
+        }
+
+        int64_t beginTime = GetTimeMillis();
+        Sync(notifications);
+        LogPrint(BCLog::DEBUG, "%s : synced %u notifications to the wallet (%dms)\n", __func__,
+                 notifications.size(), GetTimeMillis() - beginTime);
+
+        boost::unique_lock<boost::mutex> lock(queueMutex);
+        syncedSequence += notifications.size();
+        syncCond.notify_all();
+    }
+}
+
+void ThreadWalletNotify() {
+    RenameThread("coin-walletnotify");
+    walletNotifier.Run();
+}
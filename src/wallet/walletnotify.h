@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef WALLET_WALLETNOTIFY_H
+#define WALLET_WALLETNOTIFY_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+
+#include "main.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CWallet;
+
+/**
+ * The core notifications of the wallet on their way to a thread of its own, so UpdateTip() only copies
+ * the block and never waits for the wallet db. The notifications are synced to the wallet in the order
+ * of the core, a block with whether it was connected or disconnected when it was queued, and the block
+ * txs are matched to the wallet keys on a view of the state snapshot, without cs_main.
+ *
+ * The queue is not bounded, the pushes come with cs_main held and the wallet thread takes cs_main for the
+ * snapshot of a new tip. The wallet RPCs call SyncWithWallet() before they take the locks, it returns once
+ * the notifications queued before it are synced.
+ */
+class CWalletNotifier : public CWalletInterface {
+public:
+    CWalletNotifier() : pWallet(nullptr), fStopped(false), pushedSequence(0), syncedSequence(0) {}
+
+    // register with the core signals for the wallet
+    void Start(CWallet *pWalletIn);
+    // wait for the queued notifications, neither cs_main nor cs_wallet may be held
+    void SyncWithWallet();
+
+    // sync the queued notifications until shutdown, the ones left are synced before it returns
+    void Run();
+
+protected:
+    void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock) override;
+    void EraseTransaction(const uint256 &hash) override;
+    void SetBestChain(const CBlockLocator &locator) override;
+    void ResendWalletTransactions() override;
+
+private:
+    enum NotifyType : uint8_t {
+        NOTIFY_BLOCK_CONNECTED,
+        NOTIFY_BLOCK_DISCONNECTED,
+        NOTIFY_TX_ERASED,
+        NOTIFY_BEST_CHAIN,
+        NOTIFY_RESEND_TXS,
+    };
+
+    struct CNotification {
+        NotifyType type;
+        std::shared_ptr<const CBlock> spBlock;
+        uint256 txid;
+        CBlockLocator locator;
+
+        CNotification(NotifyType typeIn) : type(typeIn) {}
+    };
+
+    void Push(CNotification &&notification);
+    void Sync(std::deque<CNotification> &notifications);
+
+    CWallet *pWallet;
+    boost::mutex queueMutex;
+    boost::condition_variable queueCond;  // notified by the pushes
+    boost::condition_variable syncCond;   // notified by the syncs
+    std::deque<CNotification> queue;
+    bool fStopped;  // the thread exited, the notifications are synced by the caller
+    uint64_t pushedSequence;
+    uint64_t syncedSequence;
+};
+
+extern CWalletNotifier walletNotifier;
+
+void ThreadWalletNotify();
+
+#endif  // WALLET_WALLETNOTIFY_H
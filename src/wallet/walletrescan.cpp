@@ -0,0 +1,171 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "walletrescan.h"
+
+#include "init.h"
+#include "logging.h"
+#include "main.h"
+#include "config/configuration.h"
+#include "persistence/block.h"
+#include "persistence/statesnapshot.h"
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+// number of blocks of a range taken by a worker
+static const int32_t RESCAN_RANGE_SIZE    = 1000;
+// false positive rate of the bloom filter of the wallet keyids, its size is capped by MAX_BLOOM_FILTER_SIZE
+static const double RESCAN_FILTER_FP_RATE = 0.0001;
+// interval of the progress log in microseconds
+static const int64_t RESCAN_LOG_INTERVAL  = 10 * 1000000;
+
+CWalletRescan::CWalletRescan(CWallet *pWalletIn, int32_t startHeightIn, uint32_t workersIn)
+    : pWallet(pWalletIn),
+      startHeight(max<int32_t>(0, startHeightIn)),
+      workers(max<uint32_t>(1, workersIn)),
+      nextRange(0),
+      scannedRanges(0),
+      fStop(false),
+      scannedBlocks(0),
+      candidateTxs(0) {}
+
+uint32_t CWalletRescan::GetWorkerCount() {
+    int64_t count = SysCfg().GetArg("-rescanthreads", 0);
+    if (count <= 0)
+        count = (int64_t)boost::thread::hardware_concurrency() - 1;
+    return (uint32_t)max<int64_t>(1, min<int64_t>(count, MAX_RESCAN_THREADS));
+}
+
+int32_t CWalletRescan::Run() {
+    int64_t startTime = GetTimeMicros();
+
+    pWallet->GetKeys(keyIds);
+    keyIdFilter = CBloomFilter(max<size_t>(1, keyIds.size()), RESCAN_FILTER_FP_RATE, GetRand(UINT32_MAX),
+                               BLOOM_UPDATE_NONE);
+    for (const auto &keyId : keyIds)
+        keyIdFilter.insert(vector<uint8_t>(keyId.begin(), keyId.end()));
+
+    {
+        LOCK(cs_main);
+        for (int32_t height = startHeight; height <= chainActive.Height(); ++height)
+            vIndex.push_back(chainActive[height]);
+    }
+
+    for (int32_t begin = 0; begin < (int32_t)vIndex.size(); begin += RESCAN_RANGE_SIZE) {
+        CRange range;
+        range.begin = begin;
+        range.end   = min<int32_t>(begin + RESCAN_RANGE_SIZE, vIndex.size());
+        ranges.push_back(std::move(range));
+    }
+
+    LogPrint(BCLog::INFO, "%s : rescanning %u blocks from height %d for %u keys on %u threads\n", __func__,
+             vIndex.size(), startHeight, keyIds.size(), workers);
+    if (keyIds.empty() || vIndex.empty())
+        return 0;
+
+    boost::thread_group scanners;
+    for (uint32_t i = 0; i < workers; ++i)
+        scanners.create_thread(boost::bind(&CWalletRescan::ScanRanges, this));
+
+    int64_t lastLogTime = startTime;
+    while (scannedRanges < ranges.size() && !fStop) {
+        MilliSleep(100);
+        if (ShutdownRequested())
+            fStop = true;
+        if (GetTimeMicros() - lastLogTime >= RESCAN_LOG_INTERVAL) {
+            lastLogTime = GetTimeMicros();
+            LogPrint(BCLog::INFO, "%s : scanned %llu of %u blocks\n", __func__, scannedBlocks, vIndex.size());
+        }
+    }
+    scanners.join_all();
+
+    if (fStop) {
+        LogPrint(BCLog::INFO, "%s : rescan aborted by shutdown\n", __func__);
+        return 0;
+    }
+
+    int32_t nFound = Merge();
+    LogPrint(BCLog::INFO, "%s : rescanned %llu blocks in %.1fs, %llu candidate txs, %d wallet txs\n", __func__,
+             scannedBlocks, (GetTimeMicros() - startTime) / 1000000.0, candidateTxs, nFound);
+    return nFound;
+}
+
+void CWalletRescan::ScanRanges() {
+    RenameThread("coin-rescan");
+
+    // the block txs are resolved against the tip, the keyids of the regids do not change once registered
+    CStateSnapshot::CReadView view(CStateSnapshot::GetCurrent());
+    while (!fStop) {
+        size_t index = nextRange++;
+        if (index >= ranges.size())
+            break;
+
+        ScanRange(ranges[index], view.cw);
+        ++scannedRanges;
+    }
+}
+
+void CWalletRescan::ScanRange(CRange &range, CCacheWrapper &cw) {
+    for (int32_t i = range.begin; i < range.end && !fStop; ++i) {
+        const CBlockIndex *pIndex = vIndex[i];
+        CBlock block;
+        if (!ReadBlockFromDisk(pIndex, block)) {
+            LogPrint(BCLog::ERROR, "%s : read block %d failed\n", __func__, pIndex->height);
+            continue;
+        }
+
+        CAccountTx accountTx(pWallet, pIndex->GetBlockHash(), pIndex->height);
+        uint32_t txOffset = GetSizeOfCompactSize(block.vptx.size());
+        for (const auto &pBaseTx : block.vptx) {
+            if (IsMine(pBaseTx.get(), cw))
+                accountTx.AddTx(pBaseTx->GetHash(), pBaseTx.get(), txOffset);
+            txOffset += ::GetSerializeSize(pBaseTx, SER_DISK, CLIENT_VERSION);
+        }
+        if (accountTx.GetTxSize() > 0)
+            range.found.push_back(std::move(accountTx));
+
+        ++scannedBlocks;
+    }
+}
+
+bool CWalletRescan::IsMine(CBaseTx *pBaseTx, CCacheWrapper &cw) {
+    set<CKeyID> txKeyIds;
+    if (!pBaseTx->GetInvolvedKeyIds(cw, txKeyIds))
+        return false;
+
+    for (const auto &keyId : txKeyIds) {
+        if (!keyIdFilter.contains(vector<uint8_t>(keyId.begin(), keyId.end())))
+            continue;
+
+        ++candidateTxs;
+        if (keyIds.count(keyId))
+            return true;
+    }
+    return false;
+}
+
+int32_t CWalletRescan::Merge() {
+    int32_t nFound = 0;
+    LOCK2(cs_main, pWallet->cs_wallet);
+    for (auto &range : ranges) {
+        for (auto &accountTx : range.found) {
+            // skip the blocks disconnected during the scan, the connected ones are synced by the wallet
+            auto it = mapBlockIndex.find(accountTx.blockHash);
+            if (it == mapBlockIndex.end() || !chainActive.Contains(it->second))
+                continue;
+
+            for (const auto &item : accountTx.mapAccountTx) {
+                if (pWallet->unconfirmedTx.erase(item.first))
+                    pWallet->txLog.EraseUnconfirmedTx(item.first);
+            }
+            nFound += accountTx.GetTxSize();
+            accountTx.WriteToDisk();
+            pWallet->mapInBlockTx[accountTx.blockHash] = std::move(accountTx);
+        }
+    }
+    pWallet->CompactTxLogIfNeeded();
+    return nFound;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef WALLET_WALLETRESCAN_H
+#define WALLET_WALLETRESCAN_H
+
+#include "commons/bloom.h"
+#include "entities/key.h"
+#include "wallet/wallet.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <set>
+#include <vector>
+
+/**
+ * Parallel rescan of the active chain for the txs of the wallet keys, for -rescan and rescanwallet.
+ *
+ * The heights are split in ranges taken by a pool of workers, which read the blocks from disk and
+ * resolve the keyids involved in each tx on a view of the state snapshot, without cs_main. The keyids
+ * are tested against a bloom filter of the wallet keys first, so only the candidates are looked up in
+ * the key set. The txs found are merged into the wallet in height order by the calling thread.
+ */
+class CWalletRescan {
+public:
+    CWalletRescan(CWallet *pWalletIn, int32_t startHeightIn, uint32_t workersIn);
+
+    // Rescan from the start height to the tip, return the number of wallet txs found
+    int32_t Run();
+
+    // Number of workers configured by -rescanthreads
+    static uint32_t GetWorkerCount();
+
+private:
+    struct CRange {
+        int32_t begin = 0;
+        int32_t end   = 0;  // exclusive
+        std::vector<CAccountTx> found;
+    };
+
+    void ScanRanges();
+    void ScanRange(CRange &range, CCacheWrapper &cw);
+    bool IsMine(CBaseTx *pBaseTx, CCacheWrapper &cw);
+    int32_t Merge();
+
+    CWallet *pWallet;
+    int32_t startHeight;
+    uint32_t workers;
+
+    std::set<CKeyID> keyIds;
+    CBloomFilter keyIdFilter;
+    std::vector<const CBlockIndex *> vIndex;  // the active chain from the start height
+    std::vector<CRange> ranges;
+    std::atomic<size_t> nextRange;
+    std::atomic<size_t> scannedRanges;
+    std::atomic<bool> fStop;
+
+    // metrics
+    std::atomic<uint64_t> scannedBlocks;
+    std::atomic<uint64_t> candidateTxs;  // the txs passing the bloom filter
+};
+
+#endif  // WALLET_WALLETRESCAN_H
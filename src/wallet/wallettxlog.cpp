@@ -0,0 +1,266 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallettxlog.h"
+
+#include "logging.h"
+#include "commons/util/util.h"
+#include "config/configuration.h"
+#include "crypto/hash.h"
+#include "persistence/diskmap.h"
+#include "wallet/wallet.h"
+
+#include <boost/filesystem.hpp>
+
+using namespace std;
+
+// the message start of the network and the version
+static const uint32_t WALLET_TX_LOG_HEADER_SIZE = MESSAGE_START_SIZE + sizeof(int32_t);
+// the size before a record and the checksum after it
+static const uint32_t WALLET_TX_LOG_FRAME_SIZE = 2 * sizeof(uint32_t);
+
+static uint32_t GetRecordChecksum(const char *pBegin, const char *pEnd) {
+    return (uint32_t)Hash(pBegin, pEnd).GetCheapHash();
+}
+
+bool CWalletTxLog::Open(const string &walletFile, CWallet *pWallet) {
+    Close();
+    path    = GetDataDir() / (walletFile + WALLET_TX_LOG_SUFFIX);
+    records = 0;
+
+    int64_t beginTime  = GetTimeMillis();
+    uint64_t validSize = 0;
+    int32_t version    = CURRENT_VERSION;
+    if (boost::filesystem::exists(path) && boost::filesystem::file_size(path) > 0) {
+        uint64_t fileSize = boost::filesystem::file_size(path);
+        // the log is read with stdio where it can not be mapped
+        auto pMapped = MapDiskFile(path);
+        if (pMapped) {
+            if (!Replay(pMapped->GetData(), pMapped->GetSize(), pWallet, validSize, version))
+                return false;
+        } else {
+            vector<char> data(fileSize);
+            FILE *fileIn = fopen(path.string().c_str(), "rb");
+            if (fileIn == nullptr || fread(data.data(), 1, data.size(), fileIn) != data.size()) {
+                if (fileIn != nullptr)
+                    fclose(fileIn);
+                return ERRORMSG("%s : failed to read %s", __func__, path.string());
+            }
+            fclose(fileIn);
+            if (!Replay(data.data(), data.size(), pWallet, validSize, version))
+                return false;
+        }
+
+        if (validSize < fileSize) {
+            LogPrint(BCLog::WALLET, "%s : truncate the torn tail of %s, %llu of %llu bytes\n", __func__,
+                     path.string(), fileSize - validSize, fileSize);
+            boost::filesystem::resize_file(path, validSize);
+        }
+    }
+
+    file = fopen(path.string().c_str(), "ab");
+    if (file == nullptr)
+        return ERRORMSG("%s : failed to open %s", __func__, path.string());
+
+    if (validSize == 0) {
+        CDataStream header(SER_DISK, CLIENT_VERSION);
+        header << FLATDATA(SysCfg().MessageStart()) << CURRENT_VERSION;
+        if (fwrite(&header[0], 1, header.size(), file) != header.size() || fflush(file) != 0)
+            return ERRORMSG("%s : failed to write the header of %s", __func__, path.string());
+    }
+
+    LogPrint(BCLog::WALLET, "%s : replayed %llu records of %s (%dms)\n", __func__, records, path.string(),
+             GetTimeMillis() - beginTime);
+
+    // the records of an older version are rewritten before the appends of this one
+    if (validSize > 0 && version < CURRENT_VERSION)
+        return Compact(*pWallet);
+
+    return true;
+}
+
+void CWalletTxLog::Close() {
+    if (file == nullptr)
+        return;
+
+    FileCommit(file);
+    fclose(file);
+    file = nullptr;
+}
+
+bool CWalletTxLog::Replay(const char *pData, uint64_t size, CWallet *pWallet, uint64_t &validSize,
+                          int32_t &version) {
+    validSize = 0;
+    if (size < WALLET_TX_LOG_HEADER_SIZE)
+        return true;  // torn while the header was written
+
+    if (memcmp(pData, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return ERRORMSG("%s : invalid network magic number of %s", __func__, path.string());
+
+    memcpy(&version, pData + MESSAGE_START_SIZE, sizeof(version));
+    version = le32toh(version);
+    if (version < 1 || version > CURRENT_VERSION)
+        return ERRORMSG("%s : unsupported version %d of %s", __func__, version, path.string());
+
+    uint64_t pos = WALLET_TX_LOG_HEADER_SIZE;
+    while (size - pos >= WALLET_TX_LOG_FRAME_SIZE) {
+        uint32_t recordSize;
+        memcpy(&recordSize, pData + pos, sizeof(recordSize));
+        recordSize = le32toh(recordSize);
+        if (recordSize == 0 || recordSize > size - pos - WALLET_TX_LOG_FRAME_SIZE)
+            break;
+
+        const char *pBegin = pData + pos + sizeof(uint32_t);
+        const char *pEnd   = pBegin + recordSize;
+        uint32_t checksum;
+        memcpy(&checksum, pEnd, sizeof(checksum));
+        if (le32toh(checksum) != GetRecordChecksum(pBegin, pEnd))
+            break;
+
+        try {
+            CDataStream ss(pBegin, pEnd, SER_DISK, CLIENT_VERSION);
+            uint8_t type;
+            uint256 hash;
+            ss >> type >> hash;
+            switch (type) {
+                case RECORD_BLOCK_TX: {
+                    CAccountTx &accountTx = pWallet->mapInBlockTx[hash];
+                    if (version == 1)
+                        accountTx.UnserializeLegacy(ss);
+                    else
+                        ss >> accountTx;
+                    accountTx.BindWallet(pWallet);
+                    break;
+                }
+                case RECORD_BLOCK_TX_ERASED:
+                    pWallet->mapInBlockTx.erase(hash);
+                    break;
+                case RECORD_UNCONFIRMED_TX: {
+                    std::shared_ptr<CBaseTx> pBaseTx;
+                    ss >> pBaseTx;
+                    if (!pBaseTx || pBaseTx->GetHash() != hash)
+                        return ERRORMSG("%s : corrupt tx %s in %s", __func__, hash.GetHex(), path.string());
+                    pWallet->unconfirmedTx[hash] = pBaseTx;
+                    break;
+                }
+                case RECORD_UNCONFIRMED_TX_ERASED:
+                    pWallet->unconfirmedTx.erase(hash);
+                    break;
+                default:
+                    return ERRORMSG("%s : unknown record type %d in %s", __func__, type, path.string());
+            }
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : deserialize a record of %s failed - %s", __func__, path.string(), e.what());
+        }
+
+        pos += recordSize + WALLET_TX_LOG_FRAME_SIZE;
+        ++records;
+    }
+    validSize = pos;
+    return true;
+}
+
+template <typename K, typename V>
+bool CWalletTxLog::Append(RecordType type, const K &key, const V *pValue) {
+    if (file == nullptr)
+        return ERRORMSG("%s : the wallet tx log is not open", __func__);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << (uint32_t)0 << (uint8_t)type << key;
+    if (pValue != nullptr)
+        ss << *pValue;
+
+    uint32_t recordSize = ss.size() - sizeof(uint32_t);
+    uint32_t sizeLE     = htole32(recordSize);
+    memcpy(&ss[0], &sizeLE, sizeof(sizeLE));
+    ss << GetRecordChecksum(&ss[sizeof(uint32_t)], &ss[0] + ss.size());
+
+    if (fwrite(&ss[0], 1, ss.size(), file) != ss.size() || fflush(file) != 0)
+        return ERRORMSG("%s : failed to append to %s", __func__, path.string());
+
+    ++records;
+    return true;
+}
+
+bool CWalletTxLog::WriteBlockTx(const CAccountTx &accountTx) {
+    return Append(RECORD_BLOCK_TX, accountTx.blockHash, &accountTx);
+}
+
+bool CWalletTxLog::EraseBlockTx(const uint256 &blockHash) {
+    return Append<uint256, uint8_t>(RECORD_BLOCK_TX_ERASED, blockHash, nullptr);
+}
+
+bool CWalletTxLog::WriteUnconfirmedTx(const uint256 &txid, const std::shared_ptr<CBaseTx> &pBaseTx) {
+    return Append(RECORD_UNCONFIRMED_TX, txid, &pBaseTx);
+}
+
+bool CWalletTxLog::EraseUnconfirmedTx(const uint256 &txid) {
+    return Append<uint256, uint8_t>(RECORD_UNCONFIRMED_TX_ERASED, txid, nullptr);
+}
+
+bool CWalletTxLog::Flush() {
+    if (file == nullptr)
+        return false;
+
+    FileCommit(file);
+    return true;
+}
+
+bool CWalletTxLog::NeedsCompaction(size_t liveTxs) const {
+    return records >= WALLET_TX_LOG_COMPACT_MIN && records >= (uint64_t)liveTxs * WALLET_TX_LOG_COMPACT_RATIO;
+}
+
+bool CWalletTxLog::Compact(const CWallet &wallet) {
+    int64_t beginTime         = GetTimeMillis();
+    uint64_t oldRecords       = records;
+    boost::filesystem::path pathTmp = path;
+    pathTmp += ".new";
+
+    // the live txs are appended to a new log, replacing the old one once synced
+    FILE *oldFile = file;
+    file          = fopen(pathTmp.string().c_str(), "wb");
+    if (file == nullptr) {
+        file = oldFile;
+        return ERRORMSG("%s : failed to open %s", __func__, pathTmp.string());
+    }
+
+    CDataStream header(SER_DISK, CLIENT_VERSION);
+    header << FLATDATA(SysCfg().MessageStart()) << CURRENT_VERSION;
+    bool fWritten = fwrite(&header[0], 1, header.size(), file) == header.size();
+    records       = 0;
+    for (const auto &item : wallet.mapInBlockTx) {
+        if (!fWritten)
+            break;
+        fWritten = WriteBlockTx(item.second);
+    }
+    for (const auto &item : wallet.unconfirmedTx) {
+        if (!fWritten)
+            break;
+        fWritten = WriteUnconfirmedTx(item.first, item.second);
+    }
+
+    if (fWritten) {
+        FileCommit(file);
+        fclose(file);
+        fWritten = RenameOver(pathTmp, path);
+    } else {
+        fclose(file);
+    }
+    if (!fWritten) {
+        boost::filesystem::remove(pathTmp);
+        file    = oldFile;
+        records = oldRecords;
+        return ERRORMSG("%s : failed to write %s", __func__, pathTmp.string());
+    }
+
+    // the old file was renamed over, the appends go to the new one
+    fclose(oldFile);
+    file = fopen(path.string().c_str(), "ab");
+    if (file == nullptr)
+        return ERRORMSG("%s : failed to open %s", __func__, path.string());
+
+    LogPrint(BCLog::WALLET, "%s : compacted %llu records of %s to %llu (%dms)\n", __func__, oldRecords,
+             path.string(), records, GetTimeMillis() - beginTime);
+    return true;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef WALLET_WALLETTXLOG_H
+#define WALLET_WALLETTXLOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+
+#include <boost/filesystem/path.hpp>
+
+class CAccountTx;
+class CBaseTx;
+class CWallet;
+
+// appended to the name of the wallet file for the name of its tx log
+static const char *const WALLET_TX_LOG_SUFFIX = ".txlog";
+// the log is compacted once it has this many records per live tx
+static const uint32_t WALLET_TX_LOG_COMPACT_RATIO = 4;
+// and at least this many records
+static const uint64_t WALLET_TX_LOG_COMPACT_MIN = 10000;
+
+/**
+ * Append-only log of the wallet txs, the txs of the blocks (mapInBlockTx) and the unconfirmed ones, which
+ * wallet.dat keeps only the keys besides. Every write or erase appends a record
+ *
+ *     <size:uint32> <type:uint8> <txid or block hash> [<CAccountTx or tx>] <checksum:uint32>
+ *
+ * flushed to the file but synced only by Flush() and the compactions: the txs lost with the tail of a
+ * crash are found again by -rescan. The open replays the log memory-mapped, a torn or corrupt tail is
+ * truncated. Once the records outnumber the live txs by WALLET_TX_LOG_COMPACT_RATIO, Compact() rewrites
+ * the live txs to a new log, a checkpoint the later records are appended to.
+ *
+ * Protected by cs_wallet.
+ */
+class CWalletTxLog {
+public:
+    enum RecordType : uint8_t {
+        RECORD_BLOCK_TX              = 1,
+        RECORD_BLOCK_TX_ERASED       = 2,
+        RECORD_UNCONFIRMED_TX        = 3,
+        RECORD_UNCONFIRMED_TX_ERASED = 4,
+    };
+
+    CWalletTxLog() : file(nullptr), records(0) {}
+    ~CWalletTxLog() { Close(); }
+
+    // replay the log of the wallet file over the txs of the wallet, then open it for the appends
+    bool Open(const std::string &walletFile, CWallet *pWallet);
+    void Close();
+    bool IsOpen() const { return file != nullptr; }
+
+    bool WriteBlockTx(const CAccountTx &accountTx);
+    bool EraseBlockTx(const uint256 &blockHash);
+    bool WriteUnconfirmedTx(const uint256 &txid, const std::shared_ptr<CBaseTx> &pBaseTx);
+    bool EraseUnconfirmedTx(const uint256 &txid);
+
+    // sync the appended records to the disk
+    bool Flush();
+
+    bool NeedsCompaction(size_t liveTxs) const;
+    // rewrite the log with the live txs of the wallet
+    bool Compact(const CWallet &wallet);
+
+    const boost::filesystem::path &GetPath() const { return path; }
+
+private:
+    // version 1 kept the whole txs of the blocks, version 2 their summaries
+    static const int32_t CURRENT_VERSION = 2;
+
+    bool Replay(const char *pData, uint64_t size, CWallet *pWallet, uint64_t &validSize, int32_t &version);
+
+    // append a record of the serialized type, key and value
+    template <typename K, typename V>
+    bool Append(RecordType type, const K &key, const V *pValue);
+
+    boost::filesystem::path path;
+    FILE *file;
+    uint64_t records;  // in the file, of the live txs or not
+};
+
+#endif  // WALLET_WALLETTXLOG_H